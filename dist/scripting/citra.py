@@ -5,31 +5,56 @@ import socket
 
 CURRENT_REQUEST_VERSION = 1
 MAX_REQUEST_DATA_SIZE = 32
-MAX_PACKET_SIZE = 48
+MAX_BATCH_REQUEST_DATA_SIZE = 0x4000
+MAX_PACKET_SIZE = 16 + MAX_BATCH_REQUEST_DATA_SIZE
+# Or'd into the request type to have the request served at the next frame, from the same memory
+# state as the other requests waiting for it
+FRAME_SYNC_FLAG = 0x80000000
 
 class RequestType(enum.IntEnum):
     ReadMemory = 1,
-    WriteMemory = 2
+    WriteMemory = 2,
+    IPCProfilerControl = 3,
+    GetIPCProfile = 4,
+    GetIPCProfileHistogram = 5,
+    ReadMemoryBatch = 6,
+    WriteMemoryBatch = 7,
+    SubscribeMemory = 8,
+    UnsubscribeMemory = 9
+
+class IPCProfilerCommand(enum.IntEnum):
+    Disable = 0,
+    Enable = 1,
+    Reset = 2
+
+IPC_PROFILE_BUCKETS = 32
 
 CITRA_PORT = 45987
 
 class Citra:
-    def __init__(self, address="127.0.0.1", port=CITRA_PORT):
+    def __init__(self, address="127.0.0.1", port=CITRA_PORT, frame_sync=False):
+        """
+        With frame_sync, every request waits for the next frame the title submits, so that the
+        values read come from a consistent state and can be polled once per frame.
+        """
         self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         self.address = address
+        self.frame_sync = frame_sync
 
     def is_connected(self):
         return self.socket is not None
 
     def _generate_header(self, request_type, data_size):
         request_id = random.getrandbits(32)
+        if self.frame_sync:
+            request_type |= FRAME_SYNC_FLAG
         return (struct.pack("IIII", CURRENT_REQUEST_VERSION, request_id, request_type, data_size), request_id)
 
     def _read_and_validate_header(self, raw_reply, expected_id, expected_type):
         reply_version, reply_id, reply_type, reply_data_size = struct.unpack("IIII", raw_reply[:4*4])
         if (CURRENT_REQUEST_VERSION == reply_version and
             expected_id == reply_id and
-            expected_type == reply_type and
+            expected_type == reply_type & ~FRAME_SYNC_FLAG and
             reply_data_size == len(raw_reply[4*4:])):
             return raw_reply[4*4:]
         return None
@@ -90,6 +115,122 @@ class Citra:
                 return False
         return True
 
+    def _request(self, request_type, first_word, second_word=0):
+        request_data = struct.pack("II", first_word, second_word)
+        request, request_id = self._generate_header(request_type, len(request_data))
+        request += request_data
+        self.socket.sendto(request, (self.address, CITRA_PORT))
+
+        raw_reply = self.socket.recv(MAX_PACKET_SIZE)
+        return self._read_and_validate_header(raw_reply, request_id, request_type)
+
+    def control_ipc_profiler(self, command):
+        """
+        >>> c.control_ipc_profiler(IPCProfilerCommand.Enable)
+        True
+        """
+        return None != self._request(RequestType.IPCProfilerControl, command)
+
+    def get_ipc_profiles(self):
+        """
+        Returns the profiles of the HLE service commands called since the profiler was enabled,
+        as dicts with the service name, header code, call count, total and max host time in ns
+        and the histogram of the host time, bucket i counting calls of [2^i, 2^(i+1)) ns.
+        """
+        profiles = []
+        while True:
+            reply_data = self._request(RequestType.GetIPCProfile, len(profiles))
+            if not reply_data:
+                return profiles
+            name, header_code, calls, total_ns, max_ns = struct.unpack("8sIIQQ", reply_data)
+            histogram = []
+            while len(histogram) < IPC_PROFILE_BUCKETS:
+                buckets = self._request(RequestType.GetIPCProfileHistogram, len(profiles),
+                                        len(histogram))
+                if not buckets:
+                    break
+                histogram += struct.unpack("%dI" % (len(buckets) // 4), buckets)
+            profiles.append({"service": name.rstrip(b"\0").decode(), "header_code": header_code,
+                             "calls": calls, "total_ns": total_ns, "max_ns": max_ns,
+                             "histogram": histogram})
+
+    def read_memory_batch(self, ranges):
+        """
+        Reads several (address, size) ranges in a single request, their sizes adding up to at
+        most MAX_BATCH_REQUEST_DATA_SIZE. Returns the contents of each range.
+        >>> c.read_memory_batch([(0x100000, 2), (0x100002, 2)])
+        [b'\\x07\\x00', b'\\x00\\xeb']
+        """
+        request_data = b"".join(struct.pack("II", address, size) for address, size in ranges)
+        request, request_id = self._generate_header(RequestType.ReadMemoryBatch, len(request_data))
+        self.socket.sendto(request + request_data, (self.address, CITRA_PORT))
+
+        raw_reply = self.socket.recv(MAX_PACKET_SIZE)
+        reply_data = self._read_and_validate_header(raw_reply, request_id,
+                                                    RequestType.ReadMemoryBatch)
+        if not reply_data:
+            return None
+        result = []
+        for _, size in ranges:
+            result.append(reply_data[:size])
+            reply_data = reply_data[size:]
+        return result
+
+    def write_memory_batch(self, writes):
+        """
+        Writes several (address, contents) pairs in a single request.
+        >>> c.write_memory_batch([(0x100000, b"\x07\x00\x00\xeb")])
+        True
+        """
+        request_data = bytes()
+        for address, contents in writes:
+            request_data += struct.pack("II", address, len(contents)) + contents
+            request_data += b"\0" * (-len(contents) % 4)
+        request, request_id = self._generate_header(RequestType.WriteMemoryBatch,
+                                                    len(request_data))
+        self.socket.sendto(request + request_data, (self.address, CITRA_PORT))
+
+        raw_reply = self.socket.recv(MAX_PACKET_SIZE)
+        return None != self._read_and_validate_header(raw_reply, request_id,
+                                                      RequestType.WriteMemoryBatch)
+
+    def subscribe_memory(self, ranges):
+        """
+        Asks for the contents of the (address, size) ranges to be sent after every frame the
+        title submits, returns the id of the subscription to pass to receive_subscription.
+        """
+        request_data = b"".join(struct.pack("II", address, size) for address, size in ranges)
+        request, request_id = self._generate_header(RequestType.SubscribeMemory, len(request_data))
+        self.socket.sendto(request + request_data, (self.address, CITRA_PORT))
+
+        raw_reply = self.socket.recv(MAX_PACKET_SIZE)
+        if None == self._read_and_validate_header(raw_reply, request_id,
+                                                  RequestType.SubscribeMemory):
+            return None
+        return request_id
+
+    def receive_subscription(self, subscription_id, ranges):
+        """
+        Waits for the next frame of a subscription, returns its frame counter and the contents
+        of each of its ranges.
+        """
+        while True:
+            raw_reply = self.socket.recv(MAX_PACKET_SIZE)
+            reply_data = self._read_and_validate_header(raw_reply, subscription_id,
+                                                        RequestType.SubscribeMemory)
+            if reply_data:
+                break
+        frame, = struct.unpack("I", reply_data[:4])
+        reply_data = reply_data[4:]
+        result = []
+        for _, size in ranges:
+            result.append(reply_data[:size])
+            reply_data = reply_data[size:]
+        return frame, result
+
+    def unsubscribe_memory(self, subscription_id):
+        return None != self._request(RequestType.UnsubscribeMemory, subscription_id)
+
 if "__main__" == __name__:
     import doctest
     doctest.testmod(extraglobs={'c': Citra()})
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# Copyright 2020 Citra Emulator Project
+# Licensed under GPLv2 or any later version
+# Refer to the license.txt file included.
+
+"""
+Bakes a directory of custom textures (or of dumped textures) into a block compressed pack that
+Citra loads without decoding PNGs.
+
+Every tex1_[width]x[height]_[hash]_[format].png found under the input directory is flipped
+vertically, the way Citra uploads textures, and handed to an external encoder. The result is
+written under the output directory with the same name and a .dds or .ktx extension:
+
+    bc1, bc3, bc7              compressonatorcli (writes DDS)
+    astc4x4, astc6x6, astc8x8  astcenc (writes KTX)
+    etc2                       EtcTool (writes KTX)
+
+Only the base level is stored, Citra doesn't read mipmaps from custom textures. Pillow is needed
+for the flip. Copy the output to load/textures/[title id]/ to use it.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from PIL import Image
+
+TEXTURE_NAME = re.compile(r"^tex1_(\d+)x(\d+)_[0-9A-Fa-f]+_\d+\.png$")
+
+FORMATS = {
+    "bc1": ("dds", lambda encoder, src, dst: [encoder, "-fd", "BC1", "-nomipmap", src, dst]),
+    "bc3": ("dds", lambda encoder, src, dst: [encoder, "-fd", "BC3", "-nomipmap", src, dst]),
+    "bc7": ("dds", lambda encoder, src, dst: [encoder, "-fd", "BC7", "-nomipmap", src, dst]),
+    "astc4x4": ("ktx", lambda encoder, src, dst: [encoder, "-cl", src, dst, "4x4", "-medium"]),
+    "astc6x6": ("ktx", lambda encoder, src, dst: [encoder, "-cl", src, dst, "6x6", "-medium"]),
+    "astc8x8": ("ktx", lambda encoder, src, dst: [encoder, "-cl", src, dst, "8x8", "-medium"]),
+    "etc2": ("ktx", lambda encoder, src, dst: [encoder, src, "-format", "RGBA8", "-output", dst]),
+}
+
+DEFAULT_ENCODERS = {
+    "dds": "compressonatorcli",
+    "ktx-astc": "astcenc",
+    "ktx-etc2": "EtcTool",
+}
+
+
+def is_power_of_two(value):
+    return value > 0 and value & (value - 1) == 0
+
+
+def default_encoder(texture_format):
+    if texture_format.startswith("bc"):
+        return DEFAULT_ENCODERS["dds"]
+    if texture_format.startswith("astc"):
+        return DEFAULT_ENCODERS["ktx-astc"]
+    return DEFAULT_ENCODERS["ktx-etc2"]
+
+
+def compress(src_path, dst_path, texture_format, encoder):
+    with Image.open(src_path) as image:
+        width, height = image.size
+        if not is_power_of_two(width) or not is_power_of_two(height):
+            print("Skipping {}, its size is not a power of 2".format(src_path))
+            return False
+        flipped = image.convert("RGBA").transpose(Image.FLIP_TOP_BOTTOM)
+
+    with tempfile.TemporaryDirectory() as temp_dir:
+        flipped_path = os.path.join(temp_dir, "flipped.png")
+        flipped.save(flipped_path)
+        command = FORMATS[texture_format][1](encoder, flipped_path, dst_path)
+        result = subprocess.run(command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    if result.returncode != 0:
+        print("Failed to compress {}: {}".format(src_path, result.stderr.decode(errors="replace")))
+        return False
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="directory holding the PNG textures")
+    parser.add_argument("output", help="directory the compressed textures are written to")
+    parser.add_argument("--format", choices=sorted(FORMATS), default="bc7",
+                        help="block compression format (default: bc7)")
+    parser.add_argument("--encoder", help="path of the encoder, found in PATH by default")
+    args = parser.parse_args()
+
+    encoder = args.encoder or default_encoder(args.format)
+    extension = FORMATS[args.format][0]
+    converted = 0
+    failed = 0
+    for root, _, files in os.walk(args.input):
+        for name in files:
+            if not TEXTURE_NAME.match(name):
+                continue
+            relative_dir = os.path.relpath(root, args.input)
+            dst_dir = os.path.join(args.output, relative_dir)
+            os.makedirs(dst_dir, exist_ok=True)
+            dst_path = os.path.join(dst_dir, os.path.splitext(name)[0] + "." + extension)
+            if compress(os.path.join(root, name), dst_path, args.format, encoder):
+                converted += 1
+            else:
+                failed += 1
+
+    print("Compressed {} textures, {} failed".format(converted, failed))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
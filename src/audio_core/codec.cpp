@@ -6,6 +6,9 @@
 #include <array>
 #include <cstddef>
 #include <cstring>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "audio_core/audio_types.h"
 #include "audio_core/codec.h"
 #include "common/assert.h"
@@ -13,20 +16,26 @@
 
 namespace AudioCore::Codec {
 
-StereoBuffer16 DecodeADPCM(const u8* const data, const std::size_t sample_count,
-                           const std::array<s16, 16>& adpcm_coeff, ADPCMState& state) {
-    // GC-ADPCM with scale factor and variable coefficients.
-    // Frames are 8 bytes long containing 14 samples each.
-    // Samples are 4 bits (one nibble) long.
+// GC-ADPCM with scale factor and variable coefficients.
+// Frames are 8 bytes long containing 14 samples each.
+// Samples are 4 bits (one nibble) long.
+constexpr std::size_t FRAME_LEN = 8;
+constexpr std::size_t SAMPLES_PER_FRAME = 14;
 
-    constexpr std::size_t FRAME_LEN = 8;
-    constexpr std::size_t SAMPLES_PER_FRAME = 14;
+std::size_t ADPCMDataSize(const std::size_t sample_count) {
+    return (sample_count + (SAMPLES_PER_FRAME - 1)) / SAMPLES_PER_FRAME * FRAME_LEN;
+}
+
+void DecodeADPCM(const u8* const data, const std::size_t sample_count,
+                 const std::array<s16, 16>& adpcm_coeff, ADPCMState& state,
+                 DecodedSamples& output) {
     constexpr std::array<int, 16> SIGNED_NIBBLES = {
         {0, 1, 2, 3, 4, 5, 6, 7, -8, -7, -6, -5, -4, -3, -2, -1}};
 
     const std::size_t ret_size =
         sample_count % 2 == 0 ? sample_count : sample_count + 1; // Ensure multiple of two.
-    StereoBuffer16 ret(ret_size);
+    output.resize(ret_size);
+    auto* const ret = output.data();
 
     int yn1 = state.yn1, yn2 = state.yn2;
 
@@ -74,52 +83,83 @@ StereoBuffer16 DecodeADPCM(const u8* const data, const std::size_t sample_count,
 
     state.yn1 = static_cast<s16>(yn1);
     state.yn2 = static_cast<s16>(yn2);
-
-    return ret;
 }
 
-StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
-                          const std::size_t sample_count) {
+void DecodePCM8(const unsigned num_channels, const u8* const data, const std::size_t sample_count,
+                DecodedSamples& output) {
     ASSERT(num_channels == 1 || num_channels == 2);
 
     const auto decode_sample = [](u8 sample) {
         return static_cast<s16>(static_cast<u16>(sample) << 8);
     };
 
-    StereoBuffer16 ret(sample_count);
+    output.resize(sample_count);
+    auto* const ret = output.data();
+    // Number of input bytes, one per channel of every sample
+    const std::size_t count = sample_count * num_channels;
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    // Interleaving with zero bytes shifts every sample into the high byte of its 16-bit lane
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i low = _mm_unpacklo_epi8(zero, bytes);
+        const __m128i high = _mm_unpackhi_epi8(zero, bytes);
+        __m128i* const out = reinterpret_cast<__m128i*>(&ret[i / num_channels]);
+        if (num_channels == 1) {
+            _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(low, low));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, low));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, high));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, high));
+        } else {
+            _mm_storeu_si128(out + 0, low);
+            _mm_storeu_si128(out + 1, high);
+        }
+    }
+#endif
 
     if (num_channels == 1) {
-        for (std::size_t i = 0; i < sample_count; i++) {
+        for (; i < count; i++) {
             ret[i].fill(decode_sample(data[i]));
         }
     } else {
-        for (std::size_t i = 0; i < sample_count; i++) {
+        for (i /= 2; i < sample_count; i++) {
             ret[i][0] = decode_sample(data[i * 2 + 0]);
             ret[i][1] = decode_sample(data[i * 2 + 1]);
         }
     }
-
-    return ret;
 }
 
-StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
-                           const std::size_t sample_count) {
+void DecodePCM16(const unsigned num_channels, const u8* const data, const std::size_t sample_count,
+                 DecodedSamples& output) {
     ASSERT(num_channels == 1 || num_channels == 2);
 
-    StereoBuffer16 ret(sample_count);
+    output.resize(sample_count);
+    auto* const ret = output.data();
 
-    if (num_channels == 1) {
-        for (std::size_t i = 0; i < sample_count; i++) {
-            s16 sample;
-            std::memcpy(&sample, data + i * sizeof(s16), sizeof(s16));
-            ret[i].fill(sample);
-        }
-    } else {
-        for (std::size_t i = 0; i < sample_count; ++i) {
-            std::memcpy(&ret[i], data + i * sizeof(s16) * 2, 2 * sizeof(s16));
-        }
+    if (num_channels == 2) {
+        // Already in the output layout
+        std::memcpy(ret, data, sample_count * 2 * sizeof(s16));
+        return;
     }
 
-    return ret;
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    for (; i + 8 <= sample_count; i += 8) {
+        const __m128i samples =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * sizeof(s16)));
+        __m128i* const out = reinterpret_cast<__m128i*>(&ret[i]);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(samples, samples));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(samples, samples));
+    }
+#endif
+
+    for (; i < sample_count; i++) {
+        s16 sample;
+        std::memcpy(&sample, data + i * sizeof(s16), sizeof(s16));
+        ret[i].fill(sample);
+    }
 }
 } // namespace AudioCore::Codec
@@ -5,11 +5,16 @@
 #pragma once
 
 #include <array>
+#include <vector>
 #include "audio_core/audio_types.h"
 #include "common/common_types.h"
 
 namespace AudioCore::Codec {
 
+/// Contiguous decoded stereo signed PCM16 samples. The storage is provided by the caller, so that
+/// its capacity can be reused from one buffer to the next.
+using DecodedSamples = std::vector<std::array<s16, 2>>;
+
 /// See: Codec::DecodeADPCM
 struct ADPCMState {
     // Two historical samples from previous processed buffer,
@@ -23,26 +28,30 @@ struct ADPCMState {
  * @param sample_count Length of buffer in terms of number of samples
  * @param adpcm_coeff ADPCM coefficients
  * @param state ADPCM state, this is updated with new state
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded data, sample_count rounded up to a multiple of two in length
  */
-StereoBuffer16 DecodeADPCM(const u8* const data, const std::size_t sample_count,
-                           const std::array<s16, 16>& adpcm_coeff, ADPCMState& state);
+void DecodeADPCM(const u8* const data, const std::size_t sample_count,
+                 const std::array<s16, 16>& adpcm_coeff, ADPCMState& state,
+                 DecodedSamples& output);
+
+/// @returns The number of bytes of ADPCM data holding sample_count samples
+std::size_t ADPCMDataSize(const std::size_t sample_count);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM8 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded data, sample_count in length
  */
-StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
-                          const std::size_t sample_count);
+void DecodePCM8(const unsigned num_channels, const u8* const data, const std::size_t sample_count,
+                DecodedSamples& output);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM16 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded data, sample_count in length
  */
-StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
-                           const std::size_t sample_count);
+void DecodePCM16(const unsigned num_channels, const u8* const data, const std::size_t sample_count,
+                 DecodedSamples& output);
 } // namespace AudioCore::Codec
@@ -123,7 +123,11 @@ void CubebInput::AdjustSampleRate(u32 sample_rate) {
 }
 
 Frontend::Mic::Samples CubebInput::Read() {
+    // Take over the first block instead of copying it, usually it is the only one
     Frontend::Mic::Samples samples{};
+    if (!impl->sample_queue->Pop(samples)) {
+        return samples;
+    }
     Frontend::Mic::Samples queue;
     while (impl->sample_queue->Pop(queue)) {
         samples.insert(samples.end(), queue.begin(), queue.end());
@@ -156,7 +160,7 @@ long CubebInput::Impl::DataCallback(cubeb_stream* stream, void* user_data, const
         const u8* data = reinterpret_cast<const u8*>(input_buffer);
         samples.insert(samples.begin(), data, data + num_frames * impl->sample_size_in_bytes);
     }
-    impl->sample_queue->Push(samples);
+    impl->sample_queue->Push(std::move(samples));
 
     // returning less than num_frames here signals cubeb to stop sampling
     return num_frames;
@@ -9,6 +9,7 @@
 #include "audio_core/audio_types.h"
 #include "audio_core/cubeb_sink.h"
 #include "common/logging/log.h"
+#include "common/thread.h"
 
 namespace AudioCore {
 
@@ -33,7 +34,13 @@ CubebSink::CubebSink(std::string_view target_device_name) : impl(std::make_uniqu
     }
     cubeb_set_log_callback(CUBEB_LOG_NORMAL, &Impl::LogCallback);
 
-    impl->sample_rate = native_sample_rate;
+    // Open the stream at the rate of the device, so the backend does not resample it again
+    if (cubeb_get_preferred_sample_rate(impl->ctx, &impl->sample_rate) != CUBEB_OK ||
+        impl->sample_rate == 0) {
+        LOG_WARNING(Audio_Sink, "Error getting the preferred sample rate");
+        impl->sample_rate = native_sample_rate;
+    }
+    LOG_INFO(Audio_Sink, "Output sample rate: {}", impl->sample_rate);
 
     cubeb_stream_params params;
     params.rate = impl->sample_rate;
@@ -117,6 +124,13 @@ void CubebSink::SetCallback(std::function<void(s16*, std::size_t)> cb) {
 
 long CubebSink::Impl::DataCallback(cubeb_stream* stream, void* user_data, const void* input_buffer,
                                    void* output_buffer, long num_frames) {
+    // The callbacks run on a thread of the audio backend
+    static thread_local bool role_set = false;
+    if (!role_set) {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Audio);
+        role_set = true;
+    }
+
     Impl* impl = static_cast<Impl*>(user_data);
     s16* buffer = reinterpret_cast<s16*>(output_buffer);
 
@@ -2,25 +2,43 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstddef>
 #include "audio_core/dsp_interface.h"
 #include "audio_core/sink.h"
 #include "audio_core/sink_details.h"
 #include "common/assert.h"
+#include "common/metrics.h"
 #include "core/core.h"
 #include "core/dumping/backend.h"
 #include "core/settings.h"
 
 namespace AudioCore {
 
+// Low latency mode: the fifo is kept close to a target fill that grows when the output runs dry
+// and slowly shrinks back while it does not. The time stretcher, which adds its own backlog, is
+// only engaged while the emulation speed keeps causing underruns.
+constexpr double low_latency_min_target = 0.010;        // seconds
+constexpr double low_latency_initial_target = 0.030;    // seconds
+constexpr double low_latency_max_target = 0.080;        // seconds
+constexpr double low_latency_stretcher_latency = 0.080; // seconds
+constexpr double low_latency_window = 1.0;              // seconds
+/// Underruns within a window that count as unstable speed
+constexpr std::size_t low_latency_unstable_underruns = 3;
+/// Windows without underruns after which the time stretcher is bypassed again
+constexpr std::size_t low_latency_stable_windows = 5;
+
+static Common::Metrics::Counter underruns_metric{
+    "citra_audio_underruns_total", "Audio output callbacks that ran out of samples"};
+
 DspInterface::DspInterface() = default;
 DspInterface::~DspInterface() = default;
 
 void DspInterface::SetSink(const std::string& sink_id, const std::string& audio_device) {
     sink = CreateSinkFromID(Settings::values.sink_id, Settings::values.audio_device_id);
+    time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
     sink->SetCallback(
         [this](s16* buffer, std::size_t num_frames) { OutputCallback(buffer, num_frames); });
-    time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
 }
 
 Sink& DspInterface::GetSink() {
@@ -38,8 +56,21 @@ void DspInterface::EnableStretching(bool enable) {
     perform_time_stretching = enable;
 }
 
+void DspInterface::EnableLowLatency(bool enable) {
+    if (low_latency == enable)
+        return;
+
+    time_stretcher.SetMaxLatency(enable ? low_latency_stretcher_latency : 0.25);
+    reset_low_latency = true;
+    low_latency = enable;
+}
+
+void DspInterface::SetOutputMuted(bool muted) {
+    output_muted = muted;
+}
+
 void DspInterface::OutputFrame(StereoFrame16 frame) {
-    if (!sink)
+    if (!sink || output_muted)
         return;
 
     fifo.Push(frame.data(), frame.size());
@@ -50,7 +81,7 @@ void DspInterface::OutputFrame(StereoFrame16 frame) {
 }
 
 void DspInterface::OutputSample(std::array<s16, 2> sample) {
-    if (!sink)
+    if (!sink || output_muted)
         return;
 
     fifo.Push(&sample, 1);
@@ -60,19 +91,94 @@ void DspInterface::OutputSample(std::array<s16, 2> sample) {
     }
 }
 
+void DspInterface::UpdateLowLatencyState(std::size_t num_frames, bool underrun) {
+    auto& state = low_latency_state;
+    const double sample_rate = sink->GetNativeSampleRate();
+    const auto frames = [sample_rate](double seconds) {
+        return static_cast<std::size_t>(seconds * sample_rate);
+    };
+
+    if (reset_low_latency.exchange(false)) {
+        state = {};
+        state.target_frames = frames(low_latency_initial_target);
+    }
+
+    if (underrun) {
+        state.underruns++;
+        state.target_frames = std::min(state.target_frames + state.target_frames / 2,
+                                       frames(low_latency_max_target));
+    }
+
+    state.window_frames += num_frames;
+    if (state.window_frames < frames(low_latency_window)) {
+        return;
+    }
+
+    if (state.underruns == 0) {
+        state.stable_windows++;
+        state.target_frames = std::max(state.target_frames - state.target_frames / 8,
+                                       frames(low_latency_min_target));
+        if (state.stretching && state.stable_windows >= low_latency_stable_windows) {
+            state.stretching = false;
+            flushing_time_stretcher = true;
+        }
+    } else {
+        state.stable_windows = 0;
+        if (state.underruns >= low_latency_unstable_underruns) {
+            state.stretching = true;
+        }
+    }
+    state.window_frames = 0;
+    state.underruns = 0;
+}
+
+std::size_t DspInterface::PopFifo(s16* buffer, std::size_t num_frames) {
+    if (!time_stretcher.IsConverting()) {
+        return fifo.Pop(buffer, num_frames);
+    }
+
+    const std::size_t num_in = std::min(time_stretcher.ConvertInputFrames(num_frames), fifo.Size());
+    convert_buffer.resize(num_in * 2);
+    fifo.Pop(convert_buffer.data(), num_in);
+    return time_stretcher.Convert(convert_buffer.data(), num_in, buffer, num_frames);
+}
+
 void DspInterface::OutputCallback(s16* buffer, std::size_t num_frames) {
+    const bool use_low_latency = low_latency;
+    if (use_low_latency && reset_low_latency) {
+        UpdateLowLatencyState(0, false);
+    }
+
     std::size_t frames_written;
-    if (perform_time_stretching) {
+    if (perform_time_stretching && (!use_low_latency || low_latency_state.stretching)) {
         const std::vector<s16> in{fifo.Pop()};
         const std::size_t num_in{in.size() / 2};
         frames_written = time_stretcher.Process(in.data(), num_in, buffer, num_frames);
     } else if (flushing_time_stretcher) {
         time_stretcher.Flush();
         frames_written = time_stretcher.Process(nullptr, 0, buffer, num_frames);
-        frames_written += fifo.Pop(buffer, num_frames - frames_written);
+        frames_written += PopFifo(buffer + 2 * frames_written, num_frames - frames_written);
         flushing_time_stretcher = false;
     } else {
-        frames_written = fifo.Pop(buffer, num_frames);
+        if (use_low_latency) {
+            // The emulation got ahead of the output, skip what would only add latency
+            const double input_ratio =
+                static_cast<double>(native_sample_rate) / sink->GetNativeSampleRate();
+            const auto limit = static_cast<std::size_t>(
+                (low_latency_state.target_frames + num_frames) * input_ratio);
+            const std::size_t filled = fifo.Size();
+            if (filled > limit * 2) {
+                fifo.Discard(filled - limit);
+            }
+        }
+        frames_written = PopFifo(buffer, num_frames);
+    }
+
+    if (use_low_latency) {
+        UpdateLowLatencyState(num_frames, frames_written < num_frames);
+    }
+    if (frames_written < num_frames) {
+        underruns_metric.Add();
     }
 
     if (frames_written > 0) {
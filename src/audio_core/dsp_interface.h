@@ -99,6 +99,10 @@ public:
     Sink& GetSink();
     /// Enable/Disable audio stretching.
     void EnableStretching(bool enable);
+    /// Enable/Disable the low latency output mode.
+    void EnableLowLatency(bool enable);
+    /// Drops the output while muted, used for the frames that are emulated again.
+    void SetOutputMuted(bool muted);
 
 protected:
     void OutputFrame(StereoFrame16 frame);
@@ -107,13 +111,34 @@ protected:
 private:
     void FlushResidualStretcherAudio();
     void OutputCallback(s16* buffer, std::size_t num_frames);
+    /// Pops num_frames frames at the rate of the sink, converting from the fifo when needed
+    std::size_t PopFifo(s16* buffer, std::size_t num_frames);
+    /// Adapts the low latency buffering to how often the output ran dry
+    void UpdateLowLatencyState(std::size_t num_frames, bool underrun);
 
     std::unique_ptr<Sink> sink;
     std::atomic<bool> perform_time_stretching = false;
     std::atomic<bool> flushing_time_stretcher = false;
+    std::atomic<bool> low_latency = false;
+    std::atomic<bool> reset_low_latency = false;
+    std::atomic<bool> output_muted = false;
+    /// State of the low latency mode, only accessed from the sink callback
+    struct {
+        /// Number of frames left in the fifo after each callback, anything above is dropped
+        std::size_t target_frames = 0;
+        /// Number of frames output and underruns since the start of the current measurement
+        std::size_t window_frames = 0;
+        std::size_t underruns = 0;
+        /// Number of consecutive measurements without underruns
+        std::size_t stable_windows = 0;
+        /// Whether the speed is unstable, and the time stretcher is used to smooth it
+        bool stretching = false;
+    } low_latency_state;
     Common::RingBuffer<s16, 0x2000, 2> fifo;
     std::array<s16, 2> last_frame{};
     TimeStretcher time_stretcher;
+    /// Input of the rate conversion, only accessed from the sink callback
+    std::vector<s16> convert_buffer;
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {}
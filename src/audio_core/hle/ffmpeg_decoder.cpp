@@ -21,6 +21,9 @@ private:
 
     void Clear();
 
+    /// Resets the opened codec for a new stream, instead of creating it again
+    bool Restart();
+
     std::optional<BinaryResponse> Decode(const BinaryRequest& request);
 
     struct AVPacketDeleter {
@@ -57,6 +60,9 @@ private:
     std::unique_ptr<AVCodecParserContext, AVCodecParserContextDeleter> parser;
     std::unique_ptr<AVPacket, AVPacketDeleter> av_packet;
     std::unique_ptr<AVFrame, AVFrameDeleter> decoded_frame;
+
+    /// Decoded s16 PCM of each channel, kept to reuse its capacity from request to request
+    std::array<std::vector<u8>, 2> out_streams;
 };
 
 FFMPEGDecoder::Impl::Impl(Memory::MemorySystem& memory) : memory(memory) {
@@ -91,10 +97,6 @@ std::optional<BinaryResponse> FFMPEGDecoder::Impl::ProcessRequest(const BinaryRe
 }
 
 std::optional<BinaryResponse> FFMPEGDecoder::Impl::Initalize(const BinaryRequest& request) {
-    if (initalized) {
-        Clear();
-    }
-
     BinaryResponse response;
     std::memcpy(&response, &request, sizeof(response));
     response.unknown1 = 0x0;
@@ -103,6 +105,16 @@ std::optional<BinaryResponse> FFMPEGDecoder::Impl::Initalize(const BinaryRequest
         return response;
     }
 
+    // Applications initialize the decoder for every stream they play, opening the codec again
+    // each time is much more expensive than resetting it.
+    if (initalized) {
+        if (Restart()) {
+            return response;
+        }
+        Clear();
+        initalized = false;
+    }
+
     av_packet.reset(av_packet_alloc_dl());
 
     codec = avcodec_find_decoder_dl(AV_CODEC_ID_AAC);
@@ -132,6 +144,17 @@ std::optional<BinaryResponse> FFMPEGDecoder::Impl::Initalize(const BinaryRequest
     return response;
 }
 
+bool FFMPEGDecoder::Impl::Restart() {
+    avcodec_flush_buffers_dl(av_context.get());
+    // The parser may still hold a partial frame of the previous stream
+    parser.reset(av_parser_init_dl(codec->id));
+    if (!parser) {
+        LOG_ERROR(Audio_DSP, "Parser not found\n");
+        return false;
+    }
+    return true;
+}
+
 void FFMPEGDecoder::Impl::Clear() {
     if (!have_ffmpeg_dl) {
         return;
@@ -164,7 +187,9 @@ std::optional<BinaryResponse> FFMPEGDecoder::Impl::Decode(const BinaryRequest& r
     }
     u8* data = memory.GetFCRAMPointer(request.src_addr - Memory::FCRAM_PADDR);
 
-    std::array<std::vector<u8>, 2> out_streams;
+    for (auto& stream : out_streams) {
+        stream.clear();
+    }
 
     std::size_t data_size = request.size;
     while (data_size > 0) {
@@ -217,17 +242,21 @@ std::optional<BinaryResponse> FFMPEGDecoder::Impl::Decode(const BinaryRequest& r
 
                 // FFmpeg converts to 32 signed floating point PCM, we need s16 PCM so we need to
                 // convert it
-                f32 val_float;
-                for (std::size_t current_pos(0); current_pos < size;) {
-                    for (std::size_t channel(0); channel < decoded_frame->channels; channel++) {
+                for (std::size_t channel(0); channel < decoded_frame->channels; channel++) {
+                    auto& stream = out_streams[channel];
+                    const std::size_t offset = stream.size();
+                    stream.resize(offset + size / sizeof(f32) * sizeof(s16));
+                    u8* out = stream.data() + offset;
+                    f32 val_float;
+                    for (std::size_t current_pos(0); current_pos < size;) {
                         std::memcpy(&val_float, decoded_frame->data[channel] + current_pos,
                                     sizeof(val_float));
                         val_float = std::clamp(val_float, -1.0f, 1.0f);
                         s16 val = static_cast<s16>(0x7FFF * val_float);
-                        out_streams[channel].push_back(val & 0xFF);
-                        out_streams[channel].push_back(val >> 8);
+                        *out++ = static_cast<u8>(val & 0xFF);
+                        *out++ = static_cast<u8>(val >> 8);
+                        current_pos += sizeof(val_float);
                     }
-                    current_pos += sizeof(val_float);
                 }
             }
         }
@@ -31,6 +31,7 @@ FuncDL<void(AVFrame**)> av_frame_free_dl;
 FuncDL<AVCodecContext*(const AVCodec*)> avcodec_alloc_context3_dl;
 FuncDL<void(AVCodecContext**)> avcodec_free_context_dl;
 FuncDL<int(AVCodecContext*, const AVCodec*, AVDictionary**)> avcodec_open2_dl;
+FuncDL<void(AVCodecContext*)> avcodec_flush_buffers_dl;
 FuncDL<AVPacket*(void)> av_packet_alloc_dl;
 FuncDL<void(AVPacket**)> av_packet_free_dl;
 FuncDL<AVCodec*(AVCodecID)> avcodec_find_decoder_dl;
@@ -120,6 +121,13 @@ bool InitFFmpegDL() {
         LOG_ERROR(Audio_DSP, "Can not load function avcodec_open2");
         return false;
     }
+
+    avcodec_flush_buffers_dl =
+        FuncDL<void(AVCodecContext*)>(dll_codec.get(), "avcodec_flush_buffers");
+    if (!avcodec_flush_buffers_dl) {
+        LOG_ERROR(Audio_DSP, "Can not load function avcodec_flush_buffers");
+        return false;
+    }
     av_packet_alloc_dl = FuncDL<AVPacket*(void)>(dll_codec.get(), "av_packet_alloc");
     if (!av_packet_alloc_dl) {
         LOG_ERROR(Audio_DSP, "Can not load function av_packet_alloc");
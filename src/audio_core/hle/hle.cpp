@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/base_object.hpp>
 #include <boost/serialization/shared_ptr.hpp>
@@ -28,8 +30,10 @@
 #include "common/common_types.h"
 #include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/task_scheduler.h"
 #include "core/core.h"
 #include "core/core_timing.h"
+#include "core/perf_stats.h"
 
 SERIALIZE_EXPORT_IMPL(AudioCore::DspHle)
 
@@ -54,6 +58,12 @@ SERIALIZE_IMPL(DspHle)
 // This value has been verified against a rough hardware test with hardware and LLE
 static constexpr u64 audio_frame_ticks = samples_per_frame * 4096 * 2ull; ///< Units: ARM11 cycles
 
+/// With fewer enabled sources than this, the sources are generated on the emulation thread alone
+static constexpr std::size_t min_parallel_sources = 8;
+
+/// Smallest number of sources handed to a worker thread
+static constexpr std::size_t min_sources_per_worker = 4;
+
 struct DspHle::Impl final {
 public:
     explicit Impl(DspHle& parent, Memory::MemorySystem& memory);
@@ -404,12 +414,43 @@ StereoFrame16 DspHle::Impl::GenerateCurrentFrame() {
 
     std::array<QuadFrame32, 3> intermediate_mixes = {};
 
-    // Generate intermediate mixes
+    const auto tick_source = [&](std::size_t i) {
+        write.source_statuses.status[i] = sources[i].Tick(read.source_configurations.config[i],
+                                                          read.adpcm_coefficients.coeff[i]);
+    };
+
+    // Most frames only play or reconfigure a few sources, the others only report their status
+    // and are done with in this pass. The active ones are gathered in source order.
+    std::array<std::size_t, HLE::num_sources> active_sources;
+    std::size_t num_active_sources = 0;
     for (std::size_t i = 0; i < HLE::num_sources; i++) {
-        write.source_statuses.status[i] =
-            sources[i].Tick(read.source_configurations.config[i], read.adpcm_coefficients.coeff[i]);
+        if (sources[i].IsActive(read.source_configurations.config[i])) {
+            active_sources[num_active_sources++] = i;
+        } else {
+            tick_source(i);
+        }
+    }
+
+    // The sources are independent of each other, so their frames can be generated in parallel.
+    const auto tick_sources = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            tick_source(active_sources[i]);
+        }
+    };
+    if (num_active_sources >= min_parallel_sources) {
+        // The audio frame is due every 5ms, its sources go ahead of the other queued tasks
+        Common::TaskScheduler::GetInstance().ParallelFor(num_active_sources, min_sources_per_worker,
+                                                         tick_sources,
+                                                         Common::TaskScheduler::Priority::High);
+    } else {
+        tick_sources(0, num_active_sources);
+    }
+
+    // Generate intermediate mixes, always in source order so that the result is deterministic.
+    // Idle sources are disabled and have nothing to mix.
+    for (std::size_t i = 0; i < num_active_sources; i++) {
         for (std::size_t mix = 0; mix < 3; mix++) {
-            sources[i].MixInto(intermediate_mixes[mix], mix);
+            sources[active_sources[i]].MixInto(intermediate_mixes[mix], mix);
         }
     }
 
@@ -442,6 +483,7 @@ bool DspHle::Impl::Tick() {
 }
 
 void DspHle::Impl::AudioTickCallback(s64 cycles_late) {
+    Core::ScopedPerfSubsystem audio_time{Core::PerfSubsystem::Audio};
     if (Tick()) {
         // TODO(merry): Signal all the other interrupts as appropriate.
         if (auto service = dsp_dsp.lock()) {
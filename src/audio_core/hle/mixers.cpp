@@ -4,6 +4,9 @@
 
 #include <algorithm>
 #include <cstddef>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "audio_core/hle/mixers.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
@@ -94,11 +97,59 @@ static std::array<s16, 2> AddAndClampToS16(const std::array<s16, 2>& a,
             ClampToS16(static_cast<s32>(a[1]) + static_cast<s32>(b[1]))};
 }
 
+#ifdef ARCHITECTURE_x86_64
+
+// These produce the same results as the scalar versions: the float operations happen in the same
+// order, and the saturating packs and adds are the clamps.
+
+static void DownmixToMonoAndMix(float gain, const QuadFrame32& samples, StereoFrame16& frame) {
+    const __m128 gain_v = _mm_set1_ps(gain);
+    for (std::size_t i = 0; i < samples_per_frame; i += 4) {
+        const __m128i* const in = reinterpret_cast<const __m128i*>(&samples[i]);
+        __m128 channel0 = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in)));
+        __m128 channel1 = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in + 1)));
+        __m128 channel2 = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in + 2)));
+        __m128 channel3 = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in + 3)));
+        // Every register now holds one channel of four samples
+        _MM_TRANSPOSE4_PS(channel0, channel1, channel2, channel3);
+        const __m128 sum =
+            _mm_add_ps(_mm_add_ps(_mm_add_ps(channel0, channel1), channel2), channel3);
+        const __m128i mono = _mm_cvttps_epi32(_mm_mul_ps(sum, _mm_set1_ps(0.5f)));
+        const __m128i mono16 = _mm_packs_epi32(mono, mono);
+
+        __m128i* const out = reinterpret_cast<__m128i*>(&frame[i]);
+        _mm_storeu_si128(out,
+                         _mm_adds_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi16(mono16, mono16)));
+    }
+}
+
+static void DownmixToStereoAndMix(float gain, const QuadFrame32& samples, StereoFrame16& frame) {
+    const __m128 gain_v = _mm_set1_ps(gain);
+    for (std::size_t i = 0; i < samples_per_frame; i += 2) {
+        const __m128i* const in = reinterpret_cast<const __m128i*>(&samples[i]);
+        const __m128 first = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in)));
+        const __m128 second = _mm_mul_ps(gain_v, _mm_cvtepi32_ps(_mm_loadu_si128(in + 1)));
+        // {0 + 2, 1 + 3} of both samples
+        const __m128 sum = _mm_add_ps(_mm_movelh_ps(first, second), _mm_movehl_ps(second, first));
+        const __m128i stereo = _mm_cvttps_epi32(sum);
+
+        __m128i* const out = reinterpret_cast<__m128i*>(&frame[i]);
+        const __m128i stereo16 = _mm_packs_epi32(stereo, stereo);
+        _mm_storel_epi64(out, _mm_adds_epi16(_mm_loadl_epi64(out), stereo16));
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
 void Mixers::DownmixAndMixIntoCurrentFrame(float gain, const QuadFrame32& samples) {
     // TODO(merry): Limiter. (Currently we're performing final mixing assuming a disabled limiter.)
 
     switch (state.output_format) {
     case OutputFormat::Mono:
+#ifdef ARCHITECTURE_x86_64
+        DownmixToMonoAndMix(gain, samples, current_frame);
+        return;
+#endif
         std::transform(
             current_frame.begin(), current_frame.end(), samples.begin(), current_frame.begin(),
             [gain](const std::array<s16, 2>& accumulator,
@@ -117,6 +168,10 @@ void Mixers::DownmixAndMixIntoCurrentFrame(float gain, const QuadFrame32& sample
         // fallthrough
 
     case OutputFormat::Stereo:
+#ifdef ARCHITECTURE_x86_64
+        DownmixToStereoAndMix(gain, samples, current_frame);
+        return;
+#endif
         std::transform(
             current_frame.begin(), current_frame.end(), samples.begin(), current_frame.begin(),
             [gain](const std::array<s16, 2>& accumulator,
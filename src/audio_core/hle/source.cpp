@@ -4,11 +4,15 @@
 
 #include <algorithm>
 #include <array>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "audio_core/codec.h"
 #include "audio_core/hle/common.h"
 #include "audio_core/hle/source.h"
 #include "audio_core/interpolate.h"
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "core/memory.h"
 
@@ -30,7 +34,28 @@ void Source::MixInto(QuadFrame32& dest, std::size_t intermediate_mix_id) const {
         return;
 
     const std::array<float, 4>& gains = state.gain.at(intermediate_mix_id);
-    for (std::size_t samplei = 0; samplei < samples_per_frame; samplei++) {
+    std::size_t samplei = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    // One quadraphonic sample per register, the stereo sample is duplicated as {L, R, L, R}
+    const __m128 gains_v = _mm_loadu_ps(gains.data());
+    for (; samplei + 2 <= samples_per_frame; samplei += 2) {
+        const __m128i stereo =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&current_frame[samplei]));
+        // Sign extension of the s16 lanes
+        const __m128i widened = _mm_srai_epi32(_mm_unpacklo_epi16(stereo, stereo), 16);
+        const __m128 first = _mm_cvtepi32_ps(_mm_shuffle_epi32(widened, 0x44));
+        const __m128 second = _mm_cvtepi32_ps(_mm_shuffle_epi32(widened, 0xEE));
+
+        __m128i* const out = reinterpret_cast<__m128i*>(&dest[samplei]);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out),
+                                            _mm_cvttps_epi32(_mm_mul_ps(gains_v, first))));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1),
+                                                _mm_cvttps_epi32(_mm_mul_ps(gains_v, second))));
+    }
+#endif
+
+    for (; samplei < samples_per_frame; samplei++) {
         // Conversion from stereo (current_frame) to quadraphonic (dest) occurs here.
         dest[samplei][0] += static_cast<s32>(gains[0] * current_frame[samplei][0]);
         dest[samplei][1] += static_cast<s32>(gains[1] * current_frame[samplei][1]);
@@ -318,20 +343,24 @@ bool Source::DequeueBuffer() {
         const unsigned num_channels = buf.mono_or_stereo == MonoOrStereo::Stereo ? 2 : 1;
         switch (buf.format) {
         case Format::PCM8:
-            state.current_buffer = Codec::DecodePCM8(num_channels, memory, buf.length);
+            decode_cache.is_valid = false;
+            Codec::DecodePCM8(num_channels, memory, buf.length, decode_cache.samples);
             break;
         case Format::PCM16:
-            state.current_buffer = Codec::DecodePCM16(num_channels, memory, buf.length);
+            decode_cache.is_valid = false;
+            Codec::DecodePCM16(num_channels, memory, buf.length, decode_cache.samples);
             break;
         case Format::ADPCM:
             DEBUG_ASSERT(num_channels == 1);
-            state.current_buffer =
-                Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state);
+            DecodeADPCMBuffer(buf, memory);
             break;
         default:
             UNIMPLEMENTED();
+            decode_cache.is_valid = false;
+            decode_cache.samples.clear();
             break;
         }
+        state.current_buffer.assign(decode_cache.samples.begin(), decode_cache.samples.end());
     } else {
         LOG_WARNING(Audio_DSP,
                     "source_id={} buffer_id={} length={}: Invalid physical address {:#010x}",
@@ -356,6 +385,36 @@ bool Source::DequeueBuffer() {
     return true;
 }
 
+void Source::DecodeADPCMBuffer(const Buffer& buf, const u8* memory) {
+    // Only buffers that will be played again are worth hashing
+    if (!buf.is_looping) {
+        decode_cache.is_valid = false;
+        Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state,
+                           decode_cache.samples);
+        return;
+    }
+
+    const u64 data_hash = Common::ComputeHash64(memory, Codec::ADPCMDataSize(buf.length));
+    if (decode_cache.is_valid && decode_cache.physical_address == buf.physical_address &&
+        decode_cache.length == buf.length && decode_cache.data_hash == data_hash &&
+        decode_cache.adpcm_coeffs == state.adpcm_coeffs &&
+        decode_cache.start_state.yn1 == state.adpcm_state.yn1 &&
+        decode_cache.start_state.yn2 == state.adpcm_state.yn2) {
+        state.adpcm_state = decode_cache.end_state;
+        return;
+    }
+
+    decode_cache.is_valid = true;
+    decode_cache.physical_address = buf.physical_address;
+    decode_cache.length = buf.length;
+    decode_cache.data_hash = data_hash;
+    decode_cache.adpcm_coeffs = state.adpcm_coeffs;
+    decode_cache.start_state = state.adpcm_state;
+    Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state,
+                       decode_cache.samples);
+    decode_cache.end_state = state.adpcm_state;
+}
+
 SourceStatus::Status Source::GetCurrentStatus() {
     SourceStatus::Status ret;
 
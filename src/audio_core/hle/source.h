@@ -64,6 +64,17 @@ public:
      */
     void MixInto(QuadFrame32& dest, std::size_t intermediate_mix_id) const;
 
+    /// Returns whether the source was enabled by the last configuration it was given
+    bool IsEnabled() const {
+        return state.enabled;
+    }
+
+    /// Returns whether Tick has more to do than reporting the status, i.e. the source plays or
+    /// config changes it
+    bool IsActive(const SourceConfiguration::Configuration& config) const {
+        return state.enabled || config.dirty_raw != 0;
+    }
+
 private:
     const std::size_t source_id;
     Memory::MemorySystem* memory_system;
@@ -181,6 +192,19 @@ private:
 
     } state;
 
+    /// The last decoded buffer. Looping ADPCM buffers are only decoded again if their data or the
+    /// decoder state they start from has changed. This is not serialized: a hit is always valid.
+    struct {
+        Codec::DecodedSamples samples;
+        bool is_valid = false;
+        PAddr physical_address = 0;
+        u32 length = 0;
+        u64 data_hash = 0;
+        std::array<s16, 16> adpcm_coeffs = {};
+        Codec::ADPCMState start_state = {};
+        Codec::ADPCMState end_state = {};
+    } decode_cache;
+
     // Internal functions
 
     /// INTERNAL: Update our internal state based on the current config.
@@ -190,6 +214,8 @@ private:
     /// INTERNAL: Dequeues a buffer and does preprocessing on it (decoding, resampling). Puts it
     /// into current_buffer.
     bool DequeueBuffer();
+    /// INTERNAL: Decodes an ADPCM buffer into decode_cache, unless it is already there.
+    void DecodeADPCMBuffer(const Buffer& buf, const u8* memory);
     /// INTERNAL: Generates a SourceStatus::Status based on our internal state.
     SourceStatus::Status GetCurrentStatus();
 
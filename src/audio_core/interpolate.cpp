@@ -3,6 +3,10 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <type_traits>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "audio_core/interpolate.h"
 #include "common/assert.h"
 
@@ -13,11 +17,15 @@ namespace AudioCore::AudioInterp {
 constexpr u64 scale_factor = 1 << 24;
 constexpr u64 scale_mask = scale_factor - 1;
 
+/// Number of output samples produced by one call of a block function
+constexpr std::size_t block_size = 4;
+
 /// Here we step over the input in steps of rate, until we consume all of the input.
-/// Three adjacent samples are passed to fn each step.
-template <typename Function>
+/// Three adjacent samples are passed to fn each step. If block_fn is not nullptr, it is called
+/// instead to produce block_size samples at once whenever all of their inputs are available.
+template <typename Function, typename BlockFunction>
 static void StepOverSamples(State& state, StereoBuffer16& input, float rate, StereoFrame16& output,
-                            std::size_t& outputi, Function fn) {
+                            std::size_t& outputi, Function fn, BlockFunction block_fn) {
     ASSERT(rate > 0);
 
     if (input.empty())
@@ -30,6 +38,18 @@ static void StepOverSamples(State& state, StereoBuffer16& input, float rate, Ste
     std::size_t inputi = 0;
 
     while (outputi < output.size()) {
+        if constexpr (!std::is_same_v<BlockFunction, std::nullptr_t>) {
+            const u64 last_fposition = fposition + (block_size - 1) * step_size;
+            const auto last_inputi = static_cast<std::size_t>(last_fposition / scale_factor);
+            if (outputi + block_size <= output.size() && last_inputi + 2 < input.size()) {
+                block_fn(fposition, step_size, input, &output[outputi]);
+                outputi += block_size;
+                fposition += block_size * step_size;
+                inputi = last_inputi;
+                continue;
+            }
+        }
+
         inputi = static_cast<std::size_t>(fposition / scale_factor);
 
         if (inputi + 2 >= input.size()) {
@@ -54,9 +74,62 @@ void None(State& state, StereoBuffer16& input, float rate, StereoFrame16& output
           std::size_t& outputi) {
     StepOverSamples(
         state, input, rate, output, outputi,
-        [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) { return x0; });
+        [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) { return x0; }, nullptr);
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+/// Product of the signed lanes of a and the unsigned lanes of b, high 16 bits
+static __m128i MulHiSignedUnsigned(__m128i a, __m128i b) {
+    // _mm_mulhi_epu16 reads negative lanes of a as a + 65536, which adds b to the result
+    return _mm_sub_epi16(_mm_mulhi_epu16(a, b), _mm_and_si128(_mm_srai_epi16(a, 15), b));
 }
 
+/// Linear interpolation of block_size output samples, matching the scalar version exactly
+static void LinearBlock(u64 fposition, u64 step_size, const StereoBuffer16& input,
+                        std::array<s16, 2>* output) {
+    alignas(16) std::array<std::array<s16, 2>, block_size> x0;
+    alignas(16) std::array<std::array<s16, 2>, block_size> x1;
+    alignas(16) std::array<u16, block_size * 2> fraction_high;
+    alignas(16) std::array<u16, block_size * 2> fraction_low;
+    for (std::size_t i = 0; i < block_size; i++) {
+        const std::size_t inputi = static_cast<std::size_t>(fposition / scale_factor);
+        const u64 fraction = fposition & scale_mask;
+        x0[i] = input[inputi];
+        x1[i] = input[inputi + 1];
+        // The 24-bit fraction is split so that every product fits into 16-bit lanes
+        fraction_high[i * 2] = fraction_high[i * 2 + 1] = static_cast<u16>(fraction >> 8);
+        fraction_low[i * 2] = fraction_low[i * 2 + 1] = static_cast<u16>((fraction & 0xFF) << 8);
+        fposition += step_size;
+    }
+
+    const __m128i x0_v = _mm_load_si128(reinterpret_cast<const __m128i*>(x0.data()));
+    const __m128i x1_v = _mm_load_si128(reinterpret_cast<const __m128i*>(x1.data()));
+    const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(fraction_high.data()));
+    const __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(fraction_low.data()));
+
+    // This is a saturated subtraction, as in the scalar version.
+    const __m128i delta = _mm_subs_epi16(x1_v, x0_v);
+
+    // fraction * delta >> 24 == (high * delta + (low * delta >> 16)) >> 16, where the sum still
+    // fits into 32 bits.
+    const __m128i product_lo = _mm_mullo_epi16(delta, high);
+    const __m128i product_hi = MulHiSignedUnsigned(delta, high);
+    const __m128i low_product = MulHiSignedUnsigned(delta, low);
+    const __m128i sign = _mm_srai_epi16(low_product, 15);
+    const __m128i sum_lo = _mm_add_epi32(_mm_unpacklo_epi16(product_lo, product_hi),
+                                         _mm_unpacklo_epi16(low_product, sign));
+    const __m128i sum_hi = _mm_add_epi32(_mm_unpackhi_epi16(product_lo, product_hi),
+                                         _mm_unpackhi_epi16(low_product, sign));
+    // The steps are between 0 and delta, so packing never saturates.
+    const __m128i step =
+        _mm_packs_epi32(_mm_srai_epi32(sum_lo, 16), _mm_srai_epi32(sum_hi, 16));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_add_epi16(x0_v, step));
+}
+
+#endif // ARCHITECTURE_x86_64
+
 void Linear(State& state, StereoBuffer16& input, float rate, StereoFrame16& output,
             std::size_t& outputi) {
     // Note on accuracy: Some values that this produces are +/- 1 from the actual firmware.
@@ -70,7 +143,13 @@ void Linear(State& state, StereoBuffer16& input, float rate, StereoFrame16& outp
                             static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
                             static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
                         };
-                    });
+                    },
+#ifdef ARCHITECTURE_x86_64
+                    LinearBlock
+#else
+                    nullptr
+#endif
+    );
 }
 
 } // namespace AudioCore::AudioInterp
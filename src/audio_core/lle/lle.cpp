@@ -149,6 +149,7 @@ struct DspLle::Impl final {
     static constexpr u32 TeakraSlice = 16384;
 
     void TeakraThread() {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Emulation);
         while (true) {
             teakra.Run(TeakraSlice);
             teakra_slice_barrier.Sync();
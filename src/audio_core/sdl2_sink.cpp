@@ -9,9 +9,12 @@
 #include "audio_core/sdl2_sink.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/thread.h"
 
 namespace AudioCore {
 
+constexpr int device_sample_rate = 48000;
+
 struct SDL2Sink::Impl {
     unsigned int sample_rate = 0;
 
@@ -33,7 +36,8 @@ SDL2Sink::SDL2Sink(std::string device_name) : impl(std::make_unique<Impl>()) {
     SDL_zero(desired_audiospec);
     desired_audiospec.format = AUDIO_S16;
     desired_audiospec.channels = 2;
-    desired_audiospec.freq = native_sample_rate;
+    // Most devices run at this rate, any other one is taken as is instead of being resampled
+    desired_audiospec.freq = device_sample_rate;
     desired_audiospec.samples = 512;
     desired_audiospec.userdata = impl.get();
     desired_audiospec.callback = &Impl::Callback;
@@ -55,6 +59,7 @@ SDL2Sink::SDL2Sink(std::string device_name) : impl(std::make_unique<Impl>()) {
     }
 
     impl->sample_rate = obtained_audiospec.freq;
+    LOG_INFO(Audio_Sink, "Output sample rate: {}", impl->sample_rate);
 
     // SDL2 audio devices start out paused, unpause it:
     SDL_PauseAudioDevice(impl->audio_device_id, 0);
@@ -79,6 +84,13 @@ void SDL2Sink::SetCallback(std::function<void(s16*, std::size_t)> cb) {
 }
 
 void SDL2Sink::Impl::Callback(void* impl_, u8* buffer, int buffer_size_in_bytes) {
+    // The callbacks run on a thread of the audio backend
+    static thread_local bool role_set = false;
+    if (!role_set) {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Audio);
+        role_set = true;
+    }
+
     Impl* impl = reinterpret_cast<Impl*>(impl_);
     if (!impl || !impl->cb)
         return;
@@ -14,7 +14,7 @@ constexpr char auto_device_name[] = "auto";
 /**
  * This class is an interface for an audio sink. An audio sink accepts samples in stereo signed
  * PCM16 format to be output. Sinks *do not* handle resampling and expect the correct sample rate.
- * They are dumb outputs.
+ * They are dumb outputs, which open the device at its own rate when they can.
  */
 class Sink {
 public:
@@ -13,6 +13,12 @@
 
 namespace AudioCore {
 
+// Below this deviation of the ratio from 1.0 the pitch change of resampling is inaudible, and
+// the much cheaper resampler replaces SoundTouch. The gap between both thresholds avoids
+// switching back and forth.
+constexpr double resampler_enter_deviation = 0.01;
+constexpr double resampler_leave_deviation = 0.02;
+
 TimeStretcher::TimeStretcher()
     : sample_rate(native_sample_rate), sound_touch(std::make_unique<soundtouch::SoundTouch>()) {
     sound_touch->setChannels(2);
@@ -23,9 +29,21 @@ TimeStretcher::TimeStretcher()
 
 TimeStretcher::~TimeStretcher() = default;
 
-void TimeStretcher::SetOutputSampleRate(unsigned int sample_rate) {
-    sound_touch->setSampleRate(sample_rate);
-    sample_rate = native_sample_rate;
+void TimeStretcher::SetOutputSampleRate(unsigned int output_rate) {
+    // SoundTouch keeps working at the input rate, and converts along with changing the tempo
+    sample_rate = output_rate;
+    rate_ratio = static_cast<double>(native_sample_rate) / output_rate;
+    stretch_ratio = rate_ratio;
+    sound_touch->setRate(rate_ratio);
+    Clear();
+}
+
+bool TimeStretcher::IsConverting() const {
+    return sample_rate != native_sample_rate;
+}
+
+void TimeStretcher::SetMaxLatency(double seconds) {
+    max_latency = seconds;
 }
 
 std::size_t TimeStretcher::Process(const s16* in, std::size_t num_in, s16* out,
@@ -33,9 +51,8 @@ std::size_t TimeStretcher::Process(const s16* in, std::size_t num_in, s16* out,
     const double time_delta = static_cast<double>(num_out) / sample_rate; // seconds
     double current_ratio = static_cast<double>(num_in) / static_cast<double>(num_out);
 
-    const double max_latency = 0.25; // seconds
-    const double max_backlog = sample_rate * max_latency;
-    const double backlog_fullness = sound_touch->numSamples() / max_backlog;
+    const double max_backlog = native_sample_rate * max_latency;
+    const double backlog_fullness = BackloggedFrames() / max_backlog;
     if (backlog_fullness > 4.0) {
         // Too many samples in backlog: Don't push anymore on
         num_in = 0;
@@ -56,21 +73,123 @@ std::size_t TimeStretcher::Process(const s16* in, std::size_t num_in, s16* out,
 
     // Place a lower limit of 5% speed. When a game boots up, there will be
     // many silence samples. These do not need to be timestretched.
-    stretch_ratio = std::max(stretch_ratio, 0.05);
-    sound_touch->setTempo(stretch_ratio);
+    stretch_ratio = std::max(stretch_ratio, 0.05 * rate_ratio);
 
     LOG_TRACE(Audio, "{:5}/{:5} ratio:{:0.6f} backlog:{:0.6f}", num_in, num_out, stretch_ratio,
               backlog_fullness);
 
-    sound_touch->putSamples(in, static_cast<u32>(num_in));
-    return sound_touch->receiveSamples(out, static_cast<u32>(num_out));
+    SelectEngine();
+
+    if (!use_resampler) {
+        sound_touch->setTempo(stretch_ratio / rate_ratio);
+        sound_touch->putSamples(in, static_cast<u32>(num_in));
+        return sound_touch->receiveSamples(out, static_cast<u32>(num_out));
+    }
+
+    pending.insert(pending.end(), in, in + num_in * 2);
+
+    std::size_t frames_written = 0;
+    if (draining_sound_touch) {
+        frames_written = sound_touch->receiveSamples(out, static_cast<u32>(num_out));
+        if (sound_touch->numSamples() == 0) {
+            sound_touch->clear();
+            draining_sound_touch = false;
+        }
+    }
+    return frames_written +
+           Resample(out + frames_written * 2, num_out - frames_written, stretch_ratio);
+}
+
+std::size_t TimeStretcher::Convert(const s16* in, std::size_t num_in, s16* out,
+                                   std::size_t num_out) {
+    if (!use_resampler) {
+        // Stretching stopped after a flush, SoundTouch has nothing left to return
+        use_resampler = true;
+        draining_sound_touch = false;
+        sound_touch->clear();
+    }
+
+    pending.insert(pending.end(), in, in + num_in * 2);
+    return Resample(out, num_out, rate_ratio);
+}
+
+std::size_t TimeStretcher::ConvertInputFrames(std::size_t num_out) const {
+    if (num_out == 0) {
+        return 0;
+    }
+    // The last output frame interpolates from the four frames starting at its index
+    const double last_position = position + static_cast<double>(num_out - 1) * rate_ratio;
+    const auto needed = static_cast<std::size_t>(last_position) + 4;
+    const std::size_t num_pending = pending.size() / 2;
+    return needed > num_pending ? needed - num_pending : 0;
+}
+
+std::size_t TimeStretcher::BackloggedFrames() const {
+    return sound_touch->numSamples() + pending.size() / 2;
+}
+
+void TimeStretcher::SelectEngine() {
+    const double deviation = std::abs(stretch_ratio / rate_ratio - 1.0);
+    if (use_resampler && deviation > resampler_leave_deviation) {
+        // Hand the pending input over, SoundTouch takes it from here
+        use_resampler = false;
+        draining_sound_touch = false;
+        sound_touch->putSamples(pending.data(), static_cast<u32>(pending.size() / 2));
+        pending.clear();
+        position = 0.0;
+    } else if (!use_resampler && deviation < resampler_enter_deviation) {
+        // Push what SoundTouch still holds to its output, and return it before resampling
+        use_resampler = true;
+        draining_sound_touch = true;
+        sound_touch->flush();
+    }
+}
+
+std::size_t TimeStretcher::Resample(s16* out, std::size_t num_out, double step) {
+    const std::size_t num_pending = pending.size() / 2;
+    std::size_t frames_written = 0;
+    for (; frames_written < num_out; frames_written++) {
+        const auto index = static_cast<std::size_t>(position);
+        if (index + 3 >= num_pending) {
+            break;
+        }
+        // Cubic Hermite interpolation between the middle two of four frames, which has a frame
+        // of predelay but keeps the imaging of large rate conversions much lower than linear
+        const double t = position - static_cast<double>(index);
+        for (std::size_t channel = 0; channel < 2; channel++) {
+            const double xm1 = pending[index * 2 + channel];
+            const double x0 = pending[(index + 1) * 2 + channel];
+            const double x1 = pending[(index + 2) * 2 + channel];
+            const double x2 = pending[(index + 3) * 2 + channel];
+            const double c1 = 0.5 * (x1 - xm1);
+            const double c2 = xm1 - 2.5 * x0 + 2.0 * x1 - 0.5 * x2;
+            const double c3 = 0.5 * (x2 - xm1) + 1.5 * (x0 - x1);
+            const double value = ((c3 * t + c2) * t + c1) * t + x0;
+            out[frames_written * 2 + channel] =
+                static_cast<s16>(std::clamp(value, -32768.0, 32767.0));
+        }
+        position += step;
+    }
+
+    // Keep the frame the next output interpolates from
+    const auto consumed = std::min(static_cast<std::size_t>(position), num_pending);
+    pending.erase(pending.begin(), pending.begin() + consumed * 2);
+    position -= static_cast<double>(consumed);
+    return frames_written;
 }
 
 void TimeStretcher::Clear() {
     sound_touch->clear();
+    pending.clear();
+    position = 0.0;
+    draining_sound_touch = false;
 }
 
 void TimeStretcher::Flush() {
+    if (use_resampler) {
+        // The resampler holds no processed output back, Process returns its pending input
+        return;
+    }
     sound_touch->flush();
 }
 
@@ -7,6 +7,7 @@
 #include <array>
 #include <cstddef>
 #include <memory>
+#include <vector>
 #include "common/common_types.h"
 
 namespace soundtouch {
@@ -20,7 +21,14 @@ public:
     TimeStretcher();
     ~TimeStretcher();
 
-    void SetOutputSampleRate(unsigned int sample_rate);
+    /// Sets the rate of the output, the input is always at native_sample_rate
+    void SetOutputSampleRate(unsigned int output_rate);
+
+    /// Whether the output rate differs from native_sample_rate, and Convert has to be used
+    bool IsConverting() const;
+
+    /// Sets the largest backlog of samples aimed for, half of it is kept filled on average
+    void SetMaxLatency(double seconds);
 
     /// @param in       Input sample buffer
     /// @param num_in   Number of input frames in `in`
@@ -29,14 +37,48 @@ public:
     /// @returns Actual number of frames written to `out`
     std::size_t Process(const s16* in, std::size_t num_in, s16* out, std::size_t num_out);
 
+    /// Converts to the output rate without stretching
+    /// @param in       Input sample buffer
+    /// @param num_in   Number of input frames in `in`
+    /// @param out      Output sample buffer
+    /// @param num_out  Desired number of output frames in `out`
+    /// @returns Actual number of frames written to `out`
+    std::size_t Convert(const s16* in, std::size_t num_in, s16* out, std::size_t num_out);
+
+    /// Number of input frames Convert needs on top of the pending ones to output num_out frames
+    std::size_t ConvertInputFrames(std::size_t num_out) const;
+
     void Clear();
 
     void Flush();
 
 private:
+    /// Number of frames held back, by SoundTouch or by the resampler
+    std::size_t BackloggedFrames() const;
+
+    /// Resamples the pending input, consuming step input frames per output frame
+    std::size_t Resample(s16* out, std::size_t num_out, double step);
+
+    /// Switches between SoundTouch and the resampler according to stretch_ratio
+    void SelectEngine();
+
+    /// Rate of the output (Units: samples/sec)
     unsigned int sample_rate;
+    /// Input frames per output frame at full speed, the resampling done besides stretching
+    double rate_ratio = 1.0;
+    double max_latency = 0.25; // seconds
     std::unique_ptr<soundtouch::SoundTouch> sound_touch;
+    /// Input frames per output frame, including rate_ratio
     double stretch_ratio = 1.0;
+
+    /// Whether the tempo is close enough to 1.0 for plain resampling to be inaudible
+    bool use_resampler = true;
+    /// Whether SoundTouch still has output to return after switching to the resampler
+    bool draining_sound_touch = false;
+    /// Interleaved stereo input waiting to be resampled
+    std::vector<s16> pending;
+    /// Position of the next output frame within pending, in frames
+    double position = 0.0;
 };
 
 } // namespace AudioCore
@@ -2,11 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <regex>
 #include <string>
 #include <thread>
+#include <vector>
 
 // This needs to be included before getopt.h because the latter #defines symbols used by it
 #include "common/microprofile.h"
@@ -30,6 +33,8 @@
 #include "common/scm_rev.h"
 #include "common/scope_exit.h"
 #include "common/string_util.h"
+#include "common/thread.h"
+#include "common/tracing.h"
 #include "core/core.h"
 #include "core/dumping/backend.h"
 #include "core/file_sys/cia_container.h"
@@ -42,8 +47,10 @@
 #include "core/loader/loader.h"
 #include "core/movie.h"
 #include "core/settings.h"
+#include "core/tracer/player.h"
 #include "network/network.h"
 #include "video_core/renderer_base.h"
+#include "video_core/renderer_opengl/gl_shader_disk_cache.h"
 
 #undef _UNICODE
 #include <getopt.h>
@@ -67,8 +74,21 @@ static void PrintHelp(const char* argv0) {
                  " Nickname, password, address and port for multiplayer\n"
                  "-r, --movie-record=[file]  Record a movie (game inputs) to the given file\n"
                  "-p, --movie-play=[file]    Playback the movie (game inputs) from the given file\n"
+                 "-k, --movie-seek=MS  Start the playback of --movie-play at its last keyframe "
+                 "before MS milliseconds of emulated time\n"
                  "-d, --dump-video=[file]    Dumps audio and video to the given video file\n"
+                 "-b, --benchmark=FILE Play the movie of --movie-play unthrottled, exit at its "
+                 "end and write a JSON performance report to FILE\n"
+                 "-s, --merge-shader-cache=FILE Merge the transferable shader cache files "
+                 "given instead of a ROM into FILE and exit\n"
                  "-f, --fullscreen     Start in fullscreen mode\n"
+                 "-n, --headless       Run without showing a window, rendering offscreen\n"
+                 "-u, --unthrottled    Run as fast as possible, without the frame limiter\n"
+                 "-x, --exit-after-frames=NUMBER Exit after NUMBER frames were emulated\n"
+                 "-t, --trace=FILE     Write a Chrome/Perfetto trace of the emulation to FILE\n"
+                 "-c, --replay-trace=FILE Replay the CiTrace FILE instead of a ROM and print how "
+                 "long each of its frames took with the configured renderer\n"
+                 "-l, --replay-loops=NUMBER Replay the CiTrace NUMBER times\n"
                  "-h, --help           Display this help and exit\n"
                  "-v, --version        Output version information and exit\n";
 }
@@ -169,6 +189,49 @@ static void OnStatusMessageReceived(const Network::StatusMessageEntry& msg) {
         std::cout << std::endl << "* " << message << std::endl << std::endl;
 }
 
+/// Replays a CiTrace and prints how long each of its frames took to render
+static int ReplayTrace(EmuWindow_SDL2& emu_window, const std::string& path, int loops) {
+    CiTrace::Player player(path);
+    if (!player.IsValid()) {
+        return -1;
+    }
+
+    Core::System& system{Core::System::GetInstance()};
+    if (system.InitTracePlayback(emu_window) != Core::System::ResultStatus::Success) {
+        LOG_CRITICAL(Frontend, "Failed to initialize the trace playback");
+        return -1;
+    }
+
+    std::thread render_thread([&emu_window] {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Render);
+        emu_window.Present();
+    });
+    for (int loop = 1; loop <= loops && emu_window.IsOpen(); ++loop) {
+        const auto frame_times = player.Play();
+        if (frame_times.empty()) {
+            continue;
+        }
+        std::cout << fmt::format("Run {} of {}:\n", loop, loops);
+        double total = 0.0;
+        for (std::size_t frame = 0; frame < frame_times.size(); ++frame) {
+            const double ms =
+                std::chrono::duration<double, std::milli>(frame_times[frame]).count();
+            total += ms;
+            std::cout << fmt::format("  Frame {}: {:.3f} ms\n", frame, ms);
+        }
+        const auto [min, max] = std::minmax_element(frame_times.begin(), frame_times.end());
+        std::cout << fmt::format(
+            "  {} frames, mean {:.3f} ms, min {:.3f} ms, max {:.3f} ms\n", frame_times.size(),
+            total / frame_times.size(), std::chrono::duration<double, std::milli>(*min).count(),
+            std::chrono::duration<double, std::milli>(*max).count());
+    }
+    emu_window.RequestClose();
+    render_thread.join();
+
+    system.Shutdown();
+    return 0;
+}
+
 static void InitializeLogging() {
     Log::Filter log_filter(Log::Level::Debug);
     log_filter.ParseFilterString(Settings::values.log_filter);
@@ -194,6 +257,10 @@ int main(int argc, char** argv) {
     std::string movie_record;
     std::string movie_play;
     std::string dump_video;
+    std::string benchmark_report;
+    long long movie_seek_ms = 0;
+    std::string shader_cache_destination;
+    std::vector<std::string> positional_args;
 
     InitializeLogging();
 
@@ -211,6 +278,12 @@ int main(int argc, char** argv) {
 
     bool use_multiplayer = false;
     bool fullscreen = false;
+    bool headless = false;
+    bool unthrottled = false;
+    int exit_after_frames = 0;
+    std::string trace_path;
+    std::string replay_trace;
+    int replay_loops = 1;
     std::string nickname{};
     std::string password{};
     std::string address{};
@@ -220,12 +293,21 @@ int main(int argc, char** argv) {
         {"gdbport", required_argument, 0, 'g'},     {"install", required_argument, 0, 'i'},
         {"multiplayer", required_argument, 0, 'm'}, {"movie-record", required_argument, 0, 'r'},
         {"movie-play", required_argument, 0, 'p'},  {"dump-video", required_argument, 0, 'd'},
-        {"fullscreen", no_argument, 0, 'f'},        {"help", no_argument, 0, 'h'},
+        {"merge-shader-cache", required_argument, 0, 's'},
+        {"fullscreen", no_argument, 0, 'f'},        {"headless", no_argument, 0, 'n'},
+        {"unthrottled", no_argument, 0, 'u'},       {"help", no_argument, 0, 'h'},
+        {"exit-after-frames", required_argument, 0, 'x'},
+        {"trace", required_argument, 0, 't'},
+        {"benchmark", required_argument, 0, 'b'},
+        {"movie-seek", required_argument, 0, 'k'},
+        {"replay-trace", required_argument, 0, 'c'},
+        {"replay-loops", required_argument, 0, 'l'},
         {"version", no_argument, 0, 'v'},           {0, 0, 0, 0},
     };
 
     while (optind < argc) {
-        int arg = getopt_long(argc, argv, "g:i:m:r:p:fhv", long_options, &option_index);
+        int arg =
+            getopt_long(argc, argv, "g:i:m:r:p:s:x:t:c:l:b:k:fnuhv", long_options, &option_index);
         if (arg != -1) {
             switch (static_cast<char>(arg)) {
             case 'g':
@@ -291,10 +373,58 @@ int main(int argc, char** argv) {
             case 'd':
                 dump_video = optarg;
                 break;
+            case 's':
+                shader_cache_destination = optarg;
+                break;
             case 'f':
                 fullscreen = true;
                 LOG_INFO(Frontend, "Starting in fullscreen mode...");
                 break;
+            case 'n':
+                headless = true;
+                break;
+            case 'u':
+                unthrottled = true;
+                break;
+            case 'x':
+                errno = 0;
+                exit_after_frames = static_cast<int>(strtol(optarg, &endarg, 0));
+                if (endarg == optarg || exit_after_frames <= 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--exit-after-frames");
+                    exit(1);
+                }
+                break;
+            case 't':
+                trace_path = optarg;
+                break;
+            case 'b':
+                benchmark_report = optarg;
+                break;
+            case 'k':
+                errno = 0;
+                movie_seek_ms = strtoll(optarg, &endarg, 0);
+                if (endarg == optarg || movie_seek_ms < 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--movie-seek");
+                    exit(1);
+                }
+                break;
+            case 'c':
+                replay_trace = optarg;
+                break;
+            case 'l':
+                errno = 0;
+                replay_loops = static_cast<int>(strtol(optarg, &endarg, 0));
+                if (endarg == optarg || replay_loops <= 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--replay-loops");
+                    exit(1);
+                }
+                break;
             case 'h':
                 PrintHelp(argv[0]);
                 return 0;
@@ -308,6 +438,7 @@ int main(int argc, char** argv) {
 #else
             filepath = argv[optind];
 #endif
+            positional_args.push_back(filepath);
             optind++;
         }
     }
@@ -316,10 +447,24 @@ int main(int argc, char** argv) {
     LocalFree(argv_w);
 #endif
 
+    if (!shader_cache_destination.empty()) {
+        const bool merged = OpenGL::ShaderDiskCache::MergeTransferableFiles(
+            shader_cache_destination, positional_args);
+        return merged ? 0 : -1;
+    }
+
     MicroProfileOnThreadCreate("EmuThread");
     SCOPE_EXIT({ MicroProfileShutdown(); });
 
-    if (filepath.empty()) {
+    if (!trace_path.empty()) {
+        Common::Tracing::SetThreadName("EmuThread");
+        if (!Common::Tracing::Start(trace_path)) {
+            return -1;
+        }
+    }
+    SCOPE_EXIT({ Common::Tracing::Stop(); });
+
+    if (filepath.empty() && replay_trace.empty()) {
         LOG_CRITICAL(Frontend, "Failed to load ROM: No ROM specified");
         return -1;
     }
@@ -329,6 +474,16 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if (movie_seek_ms != 0 && movie_play.empty()) {
+        LOG_CRITICAL(Frontend, "Seeking needs a movie to play");
+        return -1;
+    }
+
+    if (!benchmark_report.empty() && movie_play.empty()) {
+        LOG_CRITICAL(Frontend, "A benchmark needs a movie to play");
+        return -1;
+    }
+
     if (!movie_record.empty()) {
         Core::Movie::GetInstance().PrepareForRecording();
     }
@@ -339,6 +494,11 @@ int main(int argc, char** argv) {
     // Apply the command line arguments
     Settings::values.gdbstub_port = gdb_port;
     Settings::values.use_gdbstub = use_gdbstub;
+    // Replayed frames are timed, the frame limiter would only add to that
+    if (unthrottled || !replay_trace.empty() || !benchmark_report.empty()) {
+        Settings::values.use_frame_limit_alternate = false;
+        Settings::values.frame_limit = 0;
+    }
     Settings::Apply();
 
     // Register frontend applets
@@ -347,10 +507,15 @@ int main(int argc, char** argv) {
     // Register generic image interface
     Core::System::GetInstance().RegisterImageInterface(std::make_shared<LodePNGImageInterface>());
 
-    std::unique_ptr<EmuWindow_SDL2> emu_window{std::make_unique<EmuWindow_SDL2>(fullscreen)};
+    std::unique_ptr<EmuWindow_SDL2> emu_window{
+        std::make_unique<EmuWindow_SDL2>(fullscreen, headless)};
     Frontend::ScopeAcquireContext scope(*emu_window);
     Core::System& system{Core::System::GetInstance()};
 
+    if (!replay_trace.empty()) {
+        return ReplayTrace(*emu_window, replay_trace, replay_loops);
+    }
+
     const Core::System::ResultStatus load_result{system.Load(*emu_window, filepath)};
 
     switch (load_result) {
@@ -401,7 +566,17 @@ int main(int argc, char** argv) {
     }
 
     if (!movie_play.empty()) {
-        Core::Movie::GetInstance().StartPlayback(movie_play);
+        if (benchmark_report.empty()) {
+            Core::Movie::GetInstance().StartPlayback(movie_play);
+        } else {
+            Core::Movie::GetInstance().StartPlayback(movie_play, [&emu_window] {
+                LOG_INFO(Frontend, "Movie playback finished, ending the benchmark");
+                emu_window->RequestClose();
+            });
+        }
+        if (movie_seek_ms != 0) {
+            Core::Movie::GetInstance().SeekPlayback(static_cast<u64>(movie_seek_ms));
+        }
     }
     if (!movie_record.empty()) {
         Core::Movie::GetInstance().StartRecording(movie_record);
@@ -412,7 +587,10 @@ int main(int argc, char** argv) {
         system.VideoDumper().StartDumping(dump_video, layout);
     }
 
-    std::thread render_thread([&emu_window] { emu_window->Present(); });
+    std::thread render_thread([&emu_window] {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Render);
+        emu_window->Present();
+    });
 
     std::atomic_bool stop_run;
     Core::System::GetInstance().Renderer().Rasterizer()->LoadDiskResources(
@@ -421,11 +599,25 @@ int main(int argc, char** argv) {
                       total);
         });
 
+    Common::SetCurrentThreadRole(Common::ThreadRole::Emulation);
+    const auto run_begin = std::chrono::steady_clock::now();
     while (emu_window->IsOpen()) {
         system.RunLoop();
+        if (exit_after_frames > 0 && system.Renderer().GetCurrentFrame() >= exit_after_frames) {
+            LOG_INFO(Frontend, "Emulated {} frames, exiting", exit_after_frames);
+            emu_window->RequestClose();
+        }
     }
     render_thread.join();
 
+    if (!benchmark_report.empty()) {
+        const double wall_time =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - run_begin).count();
+        if (!system.perf_stats->WriteBenchmarkReport(benchmark_report, wall_time)) {
+            LOG_ERROR(Frontend, "Could not write the benchmark report to {}", benchmark_report);
+        }
+    }
+
     Core::Movie::GetInstance().Shutdown();
     if (system.VideoDumper().IsDumping()) {
         system.VideoDumper().StopDumping();
@@ -104,8 +104,29 @@ void Config::ReadValues() {
 
     // Core
     Settings::values.use_cpu_jit = sdl2_config->GetBoolean("Core", "use_cpu_jit", true);
+    Settings::values.use_fastmem = sdl2_config->GetBoolean("Core", "use_fastmem", false);
+    Settings::values.use_huge_pages = sdl2_config->GetBoolean("Core", "use_huge_pages", false);
+    Settings::values.hle_memory_routines =
+        sdl2_config->GetBoolean("Core", "hle_memory_routines", false);
+    Settings::values.use_multi_core = sdl2_config->GetBoolean("Core", "use_multi_core", false);
+    Settings::values.tune_thread_scheduling =
+        sdl2_config->GetBoolean("Core", "tune_thread_scheduling", false);
     Settings::values.cpu_clock_percentage =
         sdl2_config->GetInteger("Core", "cpu_clock_percentage", 100);
+    Settings::values.enable_rewind = sdl2_config->GetBoolean("Core", "enable_rewind", false);
+    Settings::values.rewind_interval =
+        static_cast<u32>(sdl2_config->GetInteger("Core", "rewind_interval", 1000));
+    Settings::values.rewind_buffer_size =
+        static_cast<u32>(sdl2_config->GetInteger("Core", "rewind_buffer_size", 512));
+    Settings::values.use_boot_cache = sdl2_config->GetBoolean("Core", "use_boot_cache", false);
+    Settings::values.use_title_profiles =
+        sdl2_config->GetBoolean("Core", "use_title_profiles", true);
+    Settings::values.fork_save_states =
+        sdl2_config->GetBoolean("Core", "fork_save_states", false);
+    Settings::values.run_ahead_frames =
+        static_cast<u32>(sdl2_config->GetInteger("Core", "run_ahead_frames", 0));
+    Settings::values.movie_keyframe_interval =
+        static_cast<u32>(sdl2_config->GetInteger("Core", "movie_keyframe_interval", 0));
 
     // Renderer
     Settings::values.use_gles = sdl2_config->GetBoolean("Renderer", "use_gles", false);
@@ -120,11 +141,32 @@ void Config::ReadValues() {
 #endif
     Settings::values.shaders_accurate_mul =
         sdl2_config->GetBoolean("Renderer", "shaders_accurate_mul", false);
+    Settings::values.shaders_specialize_uniforms =
+        sdl2_config->GetBoolean("Renderer", "shaders_specialize_uniforms", false);
+    Settings::values.async_shader_compilation =
+        sdl2_config->GetBoolean("Renderer", "async_shader_compilation", false);
     Settings::values.use_shader_jit = sdl2_config->GetBoolean("Renderer", "use_shader_jit", true);
+    Settings::values.shader_jit_cache_budget_mb = static_cast<u32>(
+        sdl2_config->GetInteger("Renderer", "shader_jit_cache_budget_mb", 64));
+    Settings::values.parallel_vertex_shading =
+        sdl2_config->GetBoolean("Renderer", "parallel_vertex_shading", true);
+    Settings::values.parallel_sw_rasterizer =
+        sdl2_config->GetBoolean("Renderer", "parallel_sw_rasterizer", true);
+    Settings::values.use_gpu_texture_decoding =
+        sdl2_config->GetBoolean("Renderer", "use_gpu_texture_decoding", false);
+    Settings::values.generate_mipmaps_on_gpu =
+        sdl2_config->GetBoolean("Renderer", "generate_mipmaps_on_gpu", false);
+    Settings::values.surface_cache_budget_mb =
+        static_cast<u32>(sdl2_config->GetInteger("Renderer", "surface_cache_budget_mb", 0));
+    Settings::values.use_gpu_thread = sdl2_config->GetBoolean("Renderer", "use_gpu_thread", false);
     Settings::values.resolution_factor =
         static_cast<u16>(sdl2_config->GetInteger("Renderer", "resolution_factor", 1));
+    Settings::values.dynamic_resolution =
+        sdl2_config->GetBoolean("Renderer", "dynamic_resolution", false);
     Settings::values.use_disk_shader_cache =
         sdl2_config->GetBoolean("Renderer", "use_disk_shader_cache", true);
+    Settings::values.shared_shader_cache_dir =
+        sdl2_config->GetString("Renderer", "shared_shader_cache_dir", "");
     Settings::values.frame_limit =
         static_cast<u16>(sdl2_config->GetInteger("Renderer", "frame_limit", 100));
     Settings::values.use_frame_limit_alternate =
@@ -182,6 +224,8 @@ void Config::ReadValues() {
     Settings::values.custom_textures = sdl2_config->GetBoolean("Utility", "custom_textures", false);
     Settings::values.preload_textures =
         sdl2_config->GetBoolean("Utility", "preload_textures", false);
+    Settings::values.fast_texture_dumping =
+        sdl2_config->GetBoolean("Utility", "fast_texture_dumping", false);
 
     // Audio
     Settings::values.enable_dsp_lle = sdl2_config->GetBoolean("Audio", "enable_dsp_lle", false);
@@ -190,6 +234,8 @@ void Config::ReadValues() {
     Settings::values.sink_id = sdl2_config->GetString("Audio", "output_engine", "auto");
     Settings::values.enable_audio_stretching =
         sdl2_config->GetBoolean("Audio", "enable_audio_stretching", true);
+    Settings::values.enable_audio_low_latency =
+        sdl2_config->GetBoolean("Audio", "enable_audio_low_latency", false);
     Settings::values.audio_device_id = sdl2_config->GetString("Audio", "output_device", "auto");
     Settings::values.volume = static_cast<float>(sdl2_config->GetReal("Audio", "volume", 1));
     Settings::values.mic_input_device =
@@ -200,6 +246,14 @@ void Config::ReadValues() {
     // Data Storage
     Settings::values.use_virtual_sd =
         sdl2_config->GetBoolean("Data Storage", "use_virtual_sd", true);
+    Settings::values.buffer_save_writes =
+        sdl2_config->GetBoolean("Data Storage", "buffer_save_writes", true);
+    Settings::values.use_ram_storage =
+        sdl2_config->GetBoolean("Data Storage", "use_ram_storage", false);
+    Settings::values.ram_storage_template =
+        sdl2_config->GetString("Data Storage", "ram_storage_template", "");
+    Settings::values.persist_ram_storage =
+        sdl2_config->GetBoolean("Data Storage", "persist_ram_storage", false);
 
     // System
     Settings::values.is_new_3ds = sdl2_config->GetBoolean("System", "is_new_3ds", true);
@@ -258,6 +312,12 @@ void Config::ReadValues() {
     Settings::values.use_gdbstub = sdl2_config->GetBoolean("Debugging", "use_gdbstub", false);
     Settings::values.gdbstub_port =
         static_cast<u16>(sdl2_config->GetInteger("Debugging", "gdbstub_port", 24689));
+    Settings::values.use_metrics_server =
+        sdl2_config->GetBoolean("Debugging", "use_metrics_server", false);
+    Settings::values.metrics_server_port =
+        static_cast<u16>(sdl2_config->GetInteger("Debugging", "metrics_server_port", 9233));
+    Settings::values.enable_guest_profiler =
+        sdl2_config->GetBoolean("Debugging", "enable_guest_profiler", false);
 
     for (const auto& service_module : Service::service_module_map) {
         bool use_lle = sdl2_config->GetBoolean("Debugging", "LLE\\" + service_module.name, false);
@@ -291,6 +351,10 @@ void Config::ReadValues() {
         sdl2_config->GetString("Video Dumping", "video_encoder_options", default_video_options);
     Settings::values.video_bitrate =
         sdl2_config->GetInteger("Video Dumping", "video_bitrate", 2500000);
+    Settings::values.video_dump_queue_depth = static_cast<u32>(
+        sdl2_config->GetInteger("Video Dumping", "video_dump_queue_depth", 2));
+    Settings::values.video_dump_drop_frames =
+        sdl2_config->GetBoolean("Video Dumping", "video_dump_drop_frames", false);
 
     Settings::values.audio_encoder =
         sdl2_config->GetString("Video Dumping", "audio_encoder", "libvorbis");
@@ -91,12 +91,73 @@ udp_pad_index=
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_cpu_jit =
 
+# Whether the JIT accesses guest memory through a host mirror of the address space, which is faster
+# but needs a 64-bit host with 4 KiB pages. Has no effect on Windows, with the interpreter or in
+# builds without ENABLE_DYNARMIC_FASTMEM.
+# 0 (default): Off, 1: On
+use_fastmem =
+
+# Whether the emulated RAM is backed by huge pages, which takes fewer TLB misses. Linux uses the
+# reserved hugetlbfs pages if there are enough, else transparent huge pages. Windows needs the
+# "Lock pages in memory" privilege. Takes effect on the next boot.
+# 0 (default): Off, 1: On
+use_huge_pages =
+
+# Whether the memcpy, memmove and memset routines exported by the modules loaded through LDR:RO
+# run natively instead of being emulated. Takes effect on the next module load.
+# 0 (default): Off, 1: On
+hle_memory_routines =
+
+# Whether the emulated CPU cores run on host threads of their own. Needs the JIT and GPU thread.
+# Not supported yet, has no effect.
+# 0 (default): Off, 1: On
+use_multi_core =
+
+# Whether the threads started from now on get a priority and cores matching their role: the
+# emulation and render threads prefer the performance cores of hybrid CPUs, the shader compiler,
+# dumping and save state threads are lowered and the audio callback is raised.
+# 0 (default): Off, 1: On
+tune_thread_scheduling =
+
 # Change the Clock Frequency of the emulated 3DS CPU.
 # Underclocking can increase the performance of the game at the risk of freezing.
 # Overclocking may fix lag that happens on console, but also comes with the risk of freezing.
 # Range is any positive integer (but we suspect 25 - 400 is a good idea) Default is 100
 cpu_clock_percentage =
 
+# Whether to keep recent states in memory to rewind the emulation to
+# 0 (default): Off, 1: On
+enable_rewind =
+
+# Interval between two rewind points, in milliseconds of emulated time. Default is 1000
+rewind_interval =
+
+# Memory the rewind points may take, in MiB. Default is 512
+rewind_buffer_size =
+
+# Whether to save the state of a title at its first frame and restore it on the following boots
+# with the same title, settings and data
+# 0 (default): Off, 1: On
+use_boot_cache =
+
+# Whether to override settings per title, with the presets and the profiles of the title in
+# <config dir>/profiles/<program id>.ini, made of "key = value" lines named like the keys here
+# 0: Off, 1 (default): On
+use_title_profiles =
+
+# Whether to serialize save states in a forked copy of the process, which sees the memory as it
+# was when saving while the emulation goes on. POSIX hosts only, ignored with fastmem enabled
+# 0 (default): Off, 1: On
+fork_save_states =
+
+# Number of frames to run ahead of the current one and show instead, to hide the latency the title
+# has between the input and the frames. The state is saved and loaded at every frame. Default is 0
+run_ahead_frames =
+
+# Interval between two savestates embedded in the recorded movies, which their playback can seek
+# to, in seconds of emulated time. 0 (default): No savestates
+movie_keyframe_interval =
+
 [Renderer]
 # Whether to render using GLES or OpenGL
 # 0 (default): OpenGL, 1: GLES
@@ -118,10 +179,52 @@ separable_shader =
 # 0: Off (Default. Faster, but causes issues in some games) 1: On (Slower, but correct)
 shaders_accurate_mul =
 
+# Whether to compile variants of the hardware vertex shaders with their bool and int uniforms
+# folded in, once the uniforms have stayed the same for a while
+# 0: Off (Default) 1: On
+shaders_specialize_uniforms =
+
+# Whether to compile new fragment shaders in the background, drawing with a generic shader until
+# they are ready. Requires separable shaders.
+# 0 (default): Off, 1: On
+async_shader_compilation =
+
 # Whether to use the Just-In-Time (JIT) compiler for shader emulation
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_shader_jit =
 
+# Code memory the shader JIT keeps its compiled programs in, dropping the least recently used ones
+# past it, in MiB
+# 0: Unlimited, 64 (default)
+shader_jit_cache_budget_mb =
+
+# Whether to spread software vertex shading of large draws across multiple threads
+# 0: Off, 1 (default): On
+parallel_vertex_shading =
+
+# Whether the software renderer rasterizes screen tiles on multiple threads
+# 0: Off, 1 (default): On
+parallel_sw_rasterizer =
+
+# Whether to convert tiled textures and framebuffers with compute shaders in the OpenGL renderer
+# 0 (default): Off, 1: On
+use_gpu_texture_decoding =
+
+# Whether to generate texture mipmaps from the base level in the OpenGL renderer instead of reading
+# the game's own levels. Faster, but levels the game didn't make with a box filter look different
+# 0 (default): Off, 1: On
+generate_mipmaps_on_gpu =
+
+# Video memory the OpenGL renderer may use for cached surfaces before evicting the least recently
+# used clean ones, in MiB
+# 0 (default): Unlimited
+surface_cache_budget_mb =
+
+# Whether to process the GPU command lists on a separate thread, so that the emulated CPU keeps
+# running while they are drawn. Experimental, the debugging widgets don't support it.
+# 0 (default): Off, 1: On
+use_gpu_thread =
+
 # Forces VSync on the display thread. Usually doesn't impact performance, but on some drivers it can
 # so only turn this off if you notice a speed difference.
 # 0: Off, 1 (default): On
@@ -131,11 +234,22 @@ use_vsync_new =
 # 0: Off, 1 (default. On)
 use_disk_shader_cache =
 
+# Directory holding a transferable shader cache shared by several instances of the emulator.
+# Shaders generated by any instance are appended there and reused by the others. The compiled
+# shaders, which depend on the graphics driver, stay in the user directory.
+# Empty (default): Keep the whole shader cache in the user directory
+shared_shader_cache_dir =
+
 # Resolution scale factor
 # 0: Auto (scales resolution to window size), 1: Native 3DS screen resolution, Otherwise a scale
 # factor for the 3DS resolution
 resolution_factor =
 
+# Whether to lower the resolution of the rendered frames below resolution_factor when the GPU can't
+# draw them in time, and raise it back when it can. Not available with OpenGL ES.
+# 0 (default): Off, 1: On
+dynamic_resolution =
+
 # Texture filter name
 texture_filter_name =
 
@@ -209,6 +323,10 @@ upright_screen =
 # 0 (default): Off, 1: On
 dump_textures =
 
+# Encodes dumped textures with faster PNG settings, which makes the files larger.
+# 0 (default): Off, 1: On
+fast_texture_dumping =
+
 # Reads PNG files from load/textures/[Title ID]/ and replaces textures.
 # 0 (default): Off, 1: On
 custom_textures =
@@ -237,6 +355,11 @@ output_engine =
 # 0: No, 1 (default): Yes
 enable_audio_stretching =
 
+# Whether or not to keep the audio latency low. The buffering adapts to how often the audio runs
+# dry, and audio stretching, if enabled, is only used while the emulation speed is unstable.
+# 0 (default): No, 1: Yes
+enable_audio_low_latency =
+
 # Which audio device to use.
 # auto (default): Auto-select
 output_device =
@@ -250,6 +373,23 @@ volume =
 # 1 (default): Yes, 0: No
 use_virtual_sd =
 
+# Whether to merge small writes to save data in memory until the game flushes or closes the file
+# 0: No, 1 (default): Yes
+buffer_save_writes =
+
+# Whether to run on a copy of the SD card and the NAND private to the session, kept in memory where
+# the host allows it. Meant for batch runs, where several instances may run at once.
+# 0 (default): Off, 1: On
+use_ram_storage =
+
+# Directory holding the "sdmc" and "nand" directories the copy starts from, laid out like the user
+# directory. Empty (default) for the user directory.
+ram_storage_template =
+
+# Whether to write the copy back to the template directory when the emulation stops
+# 0 (default): Off, 1: On
+persist_ram_storage =
+
 [System]
 # The system model that Citra will try to emulate
 # 0: Old 3DS, 1: New 3DS (default)
@@ -301,6 +441,14 @@ record_frame_times =
 # Port for listening to GDB connections.
 use_gdbstub=false
 gdbstub_port=24689
+# Serve the performance counters in the Prometheus text format at http://<host>:<port>/metrics,
+# on all network interfaces, while a game is running.
+use_metrics_server=false
+metrics_server_port=9233
+# Sample the guest code run by the CPU, written as folded stacks for flame graphs to the log
+# directory when the game stops.
+# 0 (default): Off, 1: On
+enable_guest_profiler =
 # To LLE a service module add "LLE\<module name>=true"
 
 [WebService]
@@ -331,6 +479,13 @@ video_encoder_options =
 # Video bitrate, default: 2500000
 video_bitrate =
 
+# Number of video frames that can wait for the encoder, default: 2
+video_dump_queue_depth =
+
+# What to do when the video encoder falls behind and its queue is full
+# 0 (default): Wait for the encoder, slowing down the emulation, 1: Drop the frame
+video_dump_drop_frames =
+
 # Audio encoder used, default: libvorbis
 audio_encoder =
 
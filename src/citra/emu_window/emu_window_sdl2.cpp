@@ -26,7 +26,13 @@
 SharedContext_SDL2::SharedContext_SDL2() {
     window = SDL_CreateWindow(NULL, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 0, 0,
                               SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+    // SDL makes the new context current, so restore whatever the calling thread was using
+    SDL_Window* const previous_window = SDL_GL_GetCurrentWindow();
+    SDL_GLContext const previous_context = SDL_GL_GetCurrentContext();
     context = SDL_GL_CreateContext(window);
+    if (previous_context != nullptr) {
+        SDL_GL_MakeCurrent(previous_window, previous_context);
+    }
 }
 
 SharedContext_SDL2::~SharedContext_SDL2() {
@@ -105,6 +111,10 @@ bool EmuWindow_SDL2::IsOpen() const {
     return is_open;
 }
 
+void EmuWindow_SDL2::RequestClose() {
+    is_open = false;
+}
+
 void EmuWindow_SDL2::OnResize() {
     int width, height;
     SDL_GetWindowSize(render_window, &width, &height);
@@ -132,9 +142,23 @@ void EmuWindow_SDL2::Fullscreen() {
     SDL_MaximizeWindow(render_window);
 }
 
-EmuWindow_SDL2::EmuWindow_SDL2(bool fullscreen) {
+EmuWindow_SDL2::EmuWindow_SDL2(bool fullscreen, bool headless) : headless(headless) {
+    // Prefer SDL's offscreen driver when headless, it renders into an EGL pbuffer without any
+    // display. An explicitly chosen driver is left alone.
+    const bool use_offscreen_driver = headless && SDL_getenv("SDL_VIDEODRIVER") == nullptr;
+    if (use_offscreen_driver) {
+        SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+    }
+
     // Initialize the window
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0) {
+    bool initialized = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) == 0;
+    if (!initialized && use_offscreen_driver) {
+        LOG_WARNING(Frontend, "Offscreen video driver unavailable, using a hidden window: {}",
+                    SDL_GetError());
+        SDL_setenv("SDL_VIDEODRIVER", "", 1);
+        initialized = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) == 0;
+    }
+    if (!initialized) {
         LOG_CRITICAL(Frontend, "Failed to initialize SDL2! Exiting...");
         exit(1);
     }
@@ -169,7 +193,8 @@ EmuWindow_SDL2::EmuWindow_SDL2(bool fullscreen) {
                          SDL_WINDOWPOS_UNDEFINED, // x position
                          SDL_WINDOWPOS_UNDEFINED, // y position
                          Core::kScreenTopWidth, Core::kScreenTopHeight + Core::kScreenBottomHeight,
-                         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+                         SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI |
+                             (headless ? SDL_WINDOW_HIDDEN : 0));
 
     if (render_window == nullptr) {
         LOG_CRITICAL(Frontend, "Failed to create SDL2 window: {}", SDL_GetError());
@@ -179,7 +204,7 @@ EmuWindow_SDL2::EmuWindow_SDL2(bool fullscreen) {
     dummy_window = SDL_CreateWindow(NULL, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 0, 0,
                                     SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
 
-    if (fullscreen) {
+    if (fullscreen && !headless) {
         Fullscreen();
     }
 
@@ -224,7 +249,8 @@ std::unique_ptr<Frontend::GraphicsContext> EmuWindow_SDL2::CreateSharedContext()
 
 void EmuWindow_SDL2::Present() {
     SDL_GL_MakeCurrent(render_window, window_context);
-    SDL_GL_SetSwapInterval(1);
+    // Nobody is watching a headless window, don't let vsync throttle the emulation
+    SDL_GL_SetSwapInterval(headless ? 0 : 1);
     while (IsOpen()) {
         VideoCore::g_renderer->TryPresent(100);
         SDL_GL_SwapWindow(render_window);
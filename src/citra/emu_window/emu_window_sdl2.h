@@ -29,7 +29,12 @@ private:
 
 class EmuWindow_SDL2 : public Frontend::EmuWindow {
 public:
-    explicit EmuWindow_SDL2(bool fullscreen);
+    /**
+     * @param fullscreen Whether to start in fullscreen mode
+     * @param headless Whether to keep the window hidden and render into an offscreen surface where
+     *     the platform allows it, without vsync
+     */
+    explicit EmuWindow_SDL2(bool fullscreen, bool headless);
     ~EmuWindow_SDL2();
 
     void Present();
@@ -46,6 +51,9 @@ public:
     /// Whether the window is still open, and a close request hasn't yet been sent
     bool IsOpen() const;
 
+    /// Closes the window as if the user did, stopping the emulation and presentation loops
+    void RequestClose();
+
     /// Creates a new context that is shared with the current context
     std::unique_ptr<GraphicsContext> CreateSharedContext() const override;
 
@@ -83,6 +91,9 @@ private:
     /// Is the window still open?
     bool is_open = true;
 
+    /// Is the window hidden and presenting without vsync?
+    bool headless = false;
+
     /// Internal SDL2 render window
     SDL_Window* render_window;
 
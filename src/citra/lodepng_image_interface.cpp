@@ -18,8 +18,20 @@ bool LodePNGImageInterface::DecodePNG(std::vector<u8>& dst, u32& width, u32& hei
 }
 
 bool LodePNGImageInterface::EncodePNG(const std::string& path, const std::vector<u8>& src,
-                                      u32 width, u32 height) {
-    u32 lodepng_ret = lodepng::encode(path, src, width, height);
+                                      u32 width, u32 height, bool fast) {
+    lodepng::State state;
+    if (fast) {
+        // Skip the filter search and use a small window with greedy matching
+        state.encoder.filter_strategy = LFS_ZERO;
+        state.encoder.zlibsettings.windowsize = 1024;
+        state.encoder.zlibsettings.nicematch = 32;
+        state.encoder.zlibsettings.lazymatching = 0;
+    }
+    std::vector<u8> png;
+    u32 lodepng_ret = lodepng::encode(png, src, width, height, state);
+    if (!lodepng_ret) {
+        lodepng_ret = lodepng::save_file(png, path);
+    }
     if (lodepng_ret) {
         LOG_CRITICAL(Frontend, "Failed to encode {} because {}", path,
                      lodepng_error_text(lodepng_ret));
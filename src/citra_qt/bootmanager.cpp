@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <functional>
+#include <utility>
 #include <QApplication>
 #include <QDragEnterEvent>
 #include <QHBoxLayout>
@@ -16,8 +18,10 @@
 #include <fmt/format.h>
 #include "citra_qt/bootmanager.h"
 #include "citra_qt/main.h"
+#include "citra_qt/uisettings.h"
 #include "common/microprofile.h"
 #include "common/scm_rev.h"
+#include "common/thread.h"
 #include "core/3ds.h"
 #include "core/core.h"
 #include "core/frontend/scope_acquire_context.h"
@@ -44,6 +48,7 @@ static GMainWindow* GetMainWindow() {
 
 void EmuThread::run() {
     MicroProfileOnThreadCreate("EmuThread");
+    Common::SetCurrentThreadRole(Common::ThreadRole::Emulation);
     Frontend::ScopeAcquireContext scope(core_context);
 
     emit LoadProgress(VideoCore::LoadCallbackStage::Prepare, 0, 0);
@@ -103,6 +108,22 @@ void EmuThread::run() {
 #endif
 }
 
+namespace {
+/// Runs a function on a thread the Qt objects can be moved to
+class FunctionThread final : public QThread {
+public:
+    explicit FunctionThread(std::function<void()> function) : function(std::move(function)) {}
+
+protected:
+    void run() override {
+        function();
+    }
+
+private:
+    std::function<void()> function;
+};
+} // Anonymous namespace
+
 OpenGLWindow::OpenGLWindow(QWindow* parent, QWidget* event_handler, QOpenGLContext* shared_context)
     : QWindow(parent), context(new QOpenGLContext(shared_context->parent())),
       event_handler(event_handler) {
@@ -124,11 +145,12 @@ OpenGLWindow::OpenGLWindow(QWindow* parent, QWidget* event_handler, QOpenGLConte
 }
 
 OpenGLWindow::~OpenGLWindow() {
+    StopPresentThread();
     context->doneCurrent();
 }
 
 void OpenGLWindow::Present() {
-    if (!isExposed())
+    if (!isExposed() || presenting)
         return;
 
     context->makeCurrent(this);
@@ -141,6 +163,51 @@ void OpenGLWindow::Present() {
     QWindow::requestUpdate();
 }
 
+void OpenGLWindow::StartPresentThread() {
+    if (present_thread) {
+        return;
+    }
+    if (!QOpenGLContext::supportsThreadedOpenGL()) {
+        LOG_WARNING(Frontend, "OpenGL can't be used from other threads, presenting on updates");
+        return;
+    }
+    exposed = isExposed();
+    presenting = true;
+    context->doneCurrent();
+    present_thread = std::make_unique<FunctionThread>([this] { PresentLoop(); });
+    context->moveToThread(present_thread.get());
+    present_thread->start();
+}
+
+void OpenGLWindow::StopPresentThread() {
+    if (!present_thread) {
+        return;
+    }
+    presenting = false;
+    present_thread->wait();
+    present_thread.reset();
+    QWindow::requestUpdate();
+}
+
+void OpenGLWindow::PresentLoop() {
+    while (presenting) {
+        if (!exposed) {
+            QThread::msleep(10);
+            continue;
+        }
+        context->makeCurrent(this);
+        // Waits for the next frame, so the loop runs at the rate frames are rendered at
+        if (VideoCore::g_renderer) {
+            VideoCore::g_renderer->TryPresent(100);
+        }
+        context->swapBuffers(this);
+        context->versionFunctions<QOpenGLFunctions_3_3_Core>()->glFinish();
+    }
+    context->doneCurrent();
+    // Only the thread owning the context can give it back
+    context->moveToThread(QCoreApplication::instance()->thread());
+}
+
 bool OpenGLWindow::event(QEvent* event) {
     switch (event->type()) {
     case QEvent::UpdateRequest:
@@ -184,6 +251,7 @@ bool OpenGLWindow::event(QEvent* event) {
 }
 
 void OpenGLWindow::exposeEvent(QExposeEvent* event) {
+    exposed = isExposed();
     QWindow::requestUpdate();
     QWindow::exposeEvent(event);
 }
@@ -406,6 +474,7 @@ void GRenderWindow::ReleaseRenderTarget() {
         layout()->removeWidget(child_widget);
         delete child_widget;
         child_widget = nullptr;
+        child_window = nullptr;
     }
 }
 
@@ -433,10 +502,17 @@ void GRenderWindow::OnMinimalClientAreaChangeRequest(std::pair<u32, u32> minimal
 
 void GRenderWindow::OnEmulationStarting(EmuThread* emu_thread) {
     this->emu_thread = emu_thread;
+    if (UISettings::values.present_thread && child_window) {
+        child_window->StartPresentThread();
+    }
 }
 
 void GRenderWindow::OnEmulationStopping() {
     emu_thread = nullptr;
+    // The renderer is destroyed with the emulation, which mustn't happen while presenting
+    if (child_window) {
+        child_window->StopPresentThread();
+    }
 }
 
 void GRenderWindow::showEvent(QShowEvent* event) {
@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <QThread>
 #include <QWidget>
@@ -133,13 +134,29 @@ public:
 
     void Present();
 
+    /**
+     * Presents the frames from a thread of its own as soon as they are rendered, instead of on the
+     * update requests of the Qt event loop. The context is moved to that thread meanwhile.
+     */
+    void StartPresentThread();
+
+    /// Stops the presentation thread, after which the frames are presented on update requests
+    void StopPresentThread();
+
 protected:
     bool event(QEvent* event) override;
     void exposeEvent(QExposeEvent* event) override;
 
 private:
+    void PresentLoop();
+
     QOpenGLContext* context;
     QWidget* event_handler;
+
+    std::unique_ptr<QThread> present_thread;
+    std::atomic<bool> presenting{false};
+    /// Whether the window is exposed, for the presentation thread which can't query it
+    std::atomic<bool> exposed{false};
 };
 
 class GRenderWindow : public QWidget, public Frontend::EmuWindow {
@@ -212,7 +229,7 @@ private:
     QByteArray geometry;
 
     /// Native window handle that backs this presentation widget
-    QWindow* child_window = nullptr;
+    OpenGLWindow* child_window = nullptr;
 
     /// In order to embed the window into GRenderWindow, you need to use createWindowContainer to
     /// put the child_window into a widget then add it to the layout. This child_widget can be
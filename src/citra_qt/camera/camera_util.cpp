@@ -171,14 +171,18 @@ static constexpr int V(int r, int g, int b) {
 }
 } // namespace YuvTable
 
-std::vector<u16> Rgb2Yuv(const QImage& source, int width, int height) {
-    auto buffer = std::vector<u16>(width * height);
+void Rgb2Yuv(const QImage& source, int width, int height, std::vector<u16>& buffer) {
+    buffer.resize(width * height);
+    // Read the pixels straight from the scan lines, QImage::pixel checks the bounds and converts
+    // the format for every single pixel
+    const QImage image = source.convertToFormat(QImage::Format_RGB32);
     auto dest = buffer.begin();
     bool write = false;
     int py, pu, pv;
     for (int y = 0; y < height; ++y) {
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
         for (int x = 0; x < width; ++x) {
-            QRgb rgb = source.pixel(x, y);
+            QRgb rgb = line[x];
             int r = qRed(rgb);
             int g = qGreen(rgb);
             int b = qBlue(rgb);
@@ -203,14 +207,13 @@ std::vector<u16> Rgb2Yuv(const QImage& source, int width, int height) {
             write = !write;
         }
     }
-    return buffer;
 }
 
-std::vector<u16> ProcessImage(const QImage& image, int width, int height, bool output_rgb = false,
-                              bool flip_horizontal = false, bool flip_vertical = false) {
-    std::vector<u16> buffer(width * height);
+void ProcessImage(const QImage& image, int width, int height, bool output_rgb,
+                  bool flip_horizontal, bool flip_vertical, std::vector<u16>& buffer) {
     if (image.isNull()) {
-        return buffer;
+        buffer.assign(width * height, 0);
+        return;
     }
     QImage scaled =
         image.scaled(width, height, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
@@ -219,11 +222,11 @@ std::vector<u16> ProcessImage(const QImage& image, int width, int height, bool o
             .mirrored(flip_horizontal, flip_vertical);
     if (output_rgb) {
         QImage converted = transformed.convertToFormat(QImage::Format_RGB16);
+        buffer.resize(width * height);
         std::memcpy(buffer.data(), converted.bits(), width * height * sizeof(u16));
     } else {
-        return CameraUtil::Rgb2Yuv(transformed, width, height);
+        CameraUtil::Rgb2Yuv(transformed, width, height, buffer);
     }
-    return buffer;
 }
 
 } // namespace CameraUtil
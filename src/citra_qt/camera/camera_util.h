@@ -11,11 +11,11 @@ class QImage;
 
 namespace CameraUtil {
 
-/// Converts QImage to a yuv formatted std::vector
-std::vector<u16> Rgb2Yuv(const QImage& source, int width, int height);
+/// Converts QImage to yuv, writing it to the buffer which is resized to width * height
+void Rgb2Yuv(const QImage& source, int width, int height, std::vector<u16>& buffer);
 
-/// Processes the QImage (resizing, flipping ...) and converts it to a std::vector
-std::vector<u16> ProcessImage(const QImage& source, int width, int height, bool output_rgb,
-                              bool flip_horizontal, bool flip_vertical);
+/// Processes the QImage (resizing, flipping ...) and converts it into the buffer
+void ProcessImage(const QImage& source, int width, int height, bool output_rgb,
+                  bool flip_horizontal, bool flip_vertical, std::vector<u16>& buffer);
 
 } // namespace CameraUtil
@@ -17,7 +17,7 @@ public:
     void SetFlip(Service::CAM::Flip) override;
     void SetEffect(Service::CAM::Effect) override;
     void SetFormat(Service::CAM::OutputFormat) override;
-    std::vector<u16> ReceiveFrame() override;
+    void ReceiveFrame(std::vector<u16>& frame) override;
     virtual QImage QtReceiveFrame() = 0;
 
 private:
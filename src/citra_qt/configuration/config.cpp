@@ -10,6 +10,7 @@
 #include "citra_qt/configuration/config.h"
 #include "citra_qt/uisettings.h"
 #include "common/file_util.h"
+#include "core/core.h"
 #include "core/frontend/mic.h"
 #include "core/hle/service/service.h"
 #include "input_common/main.h"
@@ -57,7 +58,7 @@ const std::array<std::array<int, 5>, Settings::NativeAnalog::NumAnalogs> Config:
 // This must be in alphabetical order according to action name as it must have the same order as
 // UISetting::values.shortcuts, which is alphabetically ordered.
 // clang-format off
-const std::array<UISettings::Shortcut, 23> default_hotkeys{
+const std::array<UISettings::Shortcut, 24> default_hotkeys{
     {{QStringLiteral("Advance Frame"),            QStringLiteral("Main Window"), {QStringLiteral("\\"), Qt::ApplicationShortcut}},
      {QStringLiteral("Capture Screenshot"),       QStringLiteral("Main Window"), {QStringLiteral("Ctrl+P"), Qt::ApplicationShortcut}},
      {QStringLiteral("Continue/Pause Emulation"), QStringLiteral("Main Window"), {QStringLiteral("F4"), Qt::WindowShortcut}},
@@ -70,6 +71,7 @@ const std::array<UISettings::Shortcut, 23> default_hotkeys{
      {QStringLiteral("Load File"),                QStringLiteral("Main Window"), {QStringLiteral("Ctrl+O"), Qt::WindowShortcut}},
      {QStringLiteral("Remove Amiibo"),            QStringLiteral("Main Window"), {QStringLiteral("F3"), Qt::ApplicationShortcut}},
      {QStringLiteral("Restart Emulation"),        QStringLiteral("Main Window"), {QStringLiteral("F6"), Qt::WindowShortcut}},
+     {QStringLiteral("Rewind"),                   QStringLiteral("Main Window"), {QStringLiteral("Ctrl+R"), Qt::ApplicationShortcut}},
      {QStringLiteral("Rotate Screens Upright"),   QStringLiteral("Main Window"), {QStringLiteral("F8"), Qt::WindowShortcut}},
      {QStringLiteral("Stop Emulation"),           QStringLiteral("Main Window"), {QStringLiteral("F5"), Qt::WindowShortcut}},
      {QStringLiteral("Swap Screens"),             QStringLiteral("Main Window"), {QStringLiteral("F9"), Qt::WindowShortcut}},
@@ -111,6 +113,8 @@ void Config::ReadAudioValues() {
                                    .toStdString();
     Settings::values.enable_audio_stretching =
         ReadSetting(QStringLiteral("enable_audio_stretching"), true).toBool();
+    Settings::values.enable_audio_low_latency =
+        ReadSetting(QStringLiteral("enable_audio_low_latency"), false).toBool();
     Settings::values.audio_device_id =
         ReadSetting(QStringLiteral("output_device"), QStringLiteral("auto"))
             .toString()
@@ -284,8 +288,12 @@ void Config::ReadUtilityValues() {
         ReadSetting(QStringLiteral("custom_textures"), false).toBool();
     Settings::values.preload_textures =
         ReadSetting(QStringLiteral("preload_textures"), false).toBool();
+    Settings::values.fast_texture_dumping =
+        ReadSetting(QStringLiteral("fast_texture_dumping"), false).toBool();
     Settings::values.use_disk_shader_cache =
         ReadSetting(QStringLiteral("use_disk_shader_cache"), true).toBool();
+    Settings::values.shared_shader_cache_dir =
+        ReadSetting(QStringLiteral("shared_shader_cache_dir"), QString{}).toString().toStdString();
 
     qt_config->endGroup();
 }
@@ -294,8 +302,31 @@ void Config::ReadCoreValues() {
     qt_config->beginGroup(QStringLiteral("Core"));
 
     Settings::values.use_cpu_jit = ReadSetting(QStringLiteral("use_cpu_jit"), true).toBool();
+    Settings::values.use_fastmem = ReadSetting(QStringLiteral("use_fastmem"), false).toBool();
+    Settings::values.use_huge_pages =
+        ReadSetting(QStringLiteral("use_huge_pages"), false).toBool();
+    Settings::values.hle_memory_routines =
+        ReadSetting(QStringLiteral("hle_memory_routines"), false).toBool();
+    Settings::values.use_multi_core = ReadSetting(QStringLiteral("use_multi_core"), false).toBool();
+    Settings::values.tune_thread_scheduling =
+        ReadSetting(QStringLiteral("tune_thread_scheduling"), false).toBool();
     Settings::values.cpu_clock_percentage =
         ReadSetting(QStringLiteral("cpu_clock_percentage"), 100).toInt();
+    Settings::values.enable_rewind = ReadSetting(QStringLiteral("enable_rewind"), false).toBool();
+    Settings::values.rewind_interval =
+        ReadSetting(QStringLiteral("rewind_interval"), 1000).toUInt();
+    Settings::values.rewind_buffer_size =
+        ReadSetting(QStringLiteral("rewind_buffer_size"), 512).toUInt();
+    Settings::values.use_boot_cache =
+        ReadSetting(QStringLiteral("use_boot_cache"), false).toBool();
+    Settings::values.use_title_profiles =
+        ReadSetting(QStringLiteral("use_title_profiles"), true).toBool();
+    Settings::values.fork_save_states =
+        ReadSetting(QStringLiteral("fork_save_states"), false).toBool();
+    Settings::values.run_ahead_frames =
+        ReadSetting(QStringLiteral("run_ahead_frames"), 0).toUInt();
+    Settings::values.movie_keyframe_interval =
+        ReadSetting(QStringLiteral("movie_keyframe_interval"), 0).toUInt();
 
     qt_config->endGroup();
 }
@@ -304,6 +335,14 @@ void Config::ReadDataStorageValues() {
     qt_config->beginGroup(QStringLiteral("Data Storage"));
 
     Settings::values.use_virtual_sd = ReadSetting(QStringLiteral("use_virtual_sd"), true).toBool();
+    Settings::values.buffer_save_writes =
+        ReadSetting(QStringLiteral("buffer_save_writes"), true).toBool();
+    Settings::values.use_ram_storage =
+        ReadSetting(QStringLiteral("use_ram_storage"), false).toBool();
+    Settings::values.ram_storage_template =
+        ReadSetting(QStringLiteral("ram_storage_template"), QString{}).toString().toStdString();
+    Settings::values.persist_ram_storage =
+        ReadSetting(QStringLiteral("persist_ram_storage"), false).toBool();
 
     qt_config->endGroup();
 }
@@ -316,6 +355,12 @@ void Config::ReadDebuggingValues() {
         qt_config->value(QStringLiteral("record_frame_times"), false).toBool();
     Settings::values.use_gdbstub = ReadSetting(QStringLiteral("use_gdbstub"), false).toBool();
     Settings::values.gdbstub_port = ReadSetting(QStringLiteral("gdbstub_port"), 24689).toInt();
+    Settings::values.use_metrics_server =
+        ReadSetting(QStringLiteral("use_metrics_server"), false).toBool();
+    Settings::values.metrics_server_port =
+        ReadSetting(QStringLiteral("metrics_server_port"), 9233).toInt();
+    Settings::values.enable_guest_profiler =
+        ReadSetting(QStringLiteral("enable_guest_profiler"), false).toBool();
 
     qt_config->beginGroup(QStringLiteral("LLE"));
     for (const auto& service_module : Service::service_module_map) {
@@ -479,10 +524,29 @@ void Config::ReadRendererValues() {
 #endif
     Settings::values.shaders_accurate_mul =
         ReadSetting(QStringLiteral("shaders_accurate_mul"), false).toBool();
+    Settings::values.shaders_specialize_uniforms =
+        ReadSetting(QStringLiteral("shaders_specialize_uniforms"), false).toBool();
+    Settings::values.async_shader_compilation =
+        ReadSetting(QStringLiteral("async_shader_compilation"), false).toBool();
     Settings::values.use_shader_jit = ReadSetting(QStringLiteral("use_shader_jit"), true).toBool();
+    Settings::values.shader_jit_cache_budget_mb =
+        ReadSetting(QStringLiteral("shader_jit_cache_budget_mb"), 64).toUInt();
+    Settings::values.parallel_vertex_shading =
+        ReadSetting(QStringLiteral("parallel_vertex_shading"), true).toBool();
+    Settings::values.parallel_sw_rasterizer =
+        ReadSetting(QStringLiteral("parallel_sw_rasterizer"), true).toBool();
+    Settings::values.use_gpu_texture_decoding =
+        ReadSetting(QStringLiteral("use_gpu_texture_decoding"), false).toBool();
+    Settings::values.generate_mipmaps_on_gpu =
+        ReadSetting(QStringLiteral("generate_mipmaps_on_gpu"), false).toBool();
+    Settings::values.surface_cache_budget_mb =
+        ReadSetting(QStringLiteral("surface_cache_budget_mb"), 0).toUInt();
+    Settings::values.use_gpu_thread = ReadSetting(QStringLiteral("use_gpu_thread"), false).toBool();
     Settings::values.use_vsync_new = ReadSetting(QStringLiteral("use_vsync_new"), true).toBool();
     Settings::values.resolution_factor =
         static_cast<u16>(ReadSetting(QStringLiteral("resolution_factor"), 1).toInt());
+    Settings::values.dynamic_resolution =
+        ReadSetting(QStringLiteral("dynamic_resolution"), false).toBool();
     Settings::values.frame_limit = ReadSetting(QStringLiteral("frame_limit"), 100).toInt();
     Settings::values.use_frame_limit_alternate =
         ReadSetting(QStringLiteral("use_frame_limit_alternate"), false).toBool();
@@ -563,6 +627,10 @@ void Config::ReadVideoDumpingValues() {
 
     Settings::values.video_bitrate =
         ReadSetting(QStringLiteral("video_bitrate"), 2500000).toULongLong();
+    Settings::values.video_dump_queue_depth =
+        ReadSetting(QStringLiteral("video_dump_queue_depth"), 2).toUInt();
+    Settings::values.video_dump_drop_frames =
+        ReadSetting(QStringLiteral("video_dump_drop_frames"), false).toBool();
 
     Settings::values.audio_encoder =
         ReadSetting(QStringLiteral("audio_encoder"), QStringLiteral("libvorbis"))
@@ -614,6 +682,8 @@ void Config::ReadUIValues() {
         ReadSetting(QStringLiteral("pauseWhenInBackground"), false).toBool();
     UISettings::values.hide_mouse =
         ReadSetting(QStringLiteral("hideInactiveMouse"), false).toBool();
+    UISettings::values.present_thread =
+        ReadSetting(QStringLiteral("presentThread"), false).toBool();
 
     qt_config->endGroup();
 }
@@ -701,6 +771,12 @@ void Config::ReadWebServiceValues() {
 }
 
 void Config::SaveValues() {
+    // Settings overridden by the profile of the running title are saved with their global values
+    Core::TitleProfile* title_profile = Core::System::GetInstance().GetTitleProfile();
+    if (title_profile) {
+        title_profile->Restore();
+    }
+
     SaveControlValues();
     SaveCoreValues();
     SaveRendererValues();
@@ -715,6 +791,10 @@ void Config::SaveValues() {
     SaveVideoDumpingValues();
     SaveUIValues();
     SaveUtilityValues();
+
+    if (title_profile) {
+        title_profile->Apply();
+    }
 }
 
 void Config::SaveAudioValues() {
@@ -727,6 +807,8 @@ void Config::SaveAudioValues() {
                  QStringLiteral("auto"));
     WriteSetting(QStringLiteral("enable_audio_stretching"),
                  Settings::values.enable_audio_stretching, true);
+    WriteSetting(QStringLiteral("enable_audio_low_latency"),
+                 Settings::values.enable_audio_low_latency, false);
     WriteSetting(QStringLiteral("output_device"),
                  QString::fromStdString(Settings::values.audio_device_id), QStringLiteral("auto"));
     WriteSetting(QStringLiteral("volume"), Settings::values.volume, 1.0f);
@@ -834,8 +916,12 @@ void Config::SaveUtilityValues() {
     WriteSetting(QStringLiteral("dump_textures"), Settings::values.dump_textures, false);
     WriteSetting(QStringLiteral("custom_textures"), Settings::values.custom_textures, false);
     WriteSetting(QStringLiteral("preload_textures"), Settings::values.preload_textures, false);
+    WriteSetting(QStringLiteral("fast_texture_dumping"), Settings::values.fast_texture_dumping,
+                 false);
     WriteSetting(QStringLiteral("use_disk_shader_cache"), Settings::values.use_disk_shader_cache,
                  true);
+    WriteSetting(QStringLiteral("shared_shader_cache_dir"),
+                 QString::fromStdString(Settings::values.shared_shader_cache_dir), QString{});
 
     qt_config->endGroup();
 }
@@ -844,8 +930,24 @@ void Config::SaveCoreValues() {
     qt_config->beginGroup(QStringLiteral("Core"));
 
     WriteSetting(QStringLiteral("use_cpu_jit"), Settings::values.use_cpu_jit, true);
+    WriteSetting(QStringLiteral("use_fastmem"), Settings::values.use_fastmem, false);
+    WriteSetting(QStringLiteral("use_huge_pages"), Settings::values.use_huge_pages, false);
+    WriteSetting(QStringLiteral("hle_memory_routines"), Settings::values.hle_memory_routines,
+                 false);
+    WriteSetting(QStringLiteral("use_multi_core"), Settings::values.use_multi_core, false);
+    WriteSetting(QStringLiteral("tune_thread_scheduling"), Settings::values.tune_thread_scheduling,
+                 false);
     WriteSetting(QStringLiteral("cpu_clock_percentage"), Settings::values.cpu_clock_percentage,
                  100);
+    WriteSetting(QStringLiteral("enable_rewind"), Settings::values.enable_rewind, false);
+    WriteSetting(QStringLiteral("rewind_interval"), Settings::values.rewind_interval, 1000);
+    WriteSetting(QStringLiteral("rewind_buffer_size"), Settings::values.rewind_buffer_size, 512);
+    WriteSetting(QStringLiteral("use_boot_cache"), Settings::values.use_boot_cache, false);
+    WriteSetting(QStringLiteral("use_title_profiles"), Settings::values.use_title_profiles, true);
+    WriteSetting(QStringLiteral("fork_save_states"), Settings::values.fork_save_states, false);
+    WriteSetting(QStringLiteral("run_ahead_frames"), Settings::values.run_ahead_frames, 0);
+    WriteSetting(QStringLiteral("movie_keyframe_interval"),
+                 Settings::values.movie_keyframe_interval, 0);
 
     qt_config->endGroup();
 }
@@ -854,6 +956,12 @@ void Config::SaveDataStorageValues() {
     qt_config->beginGroup(QStringLiteral("Data Storage"));
 
     WriteSetting(QStringLiteral("use_virtual_sd"), Settings::values.use_virtual_sd, true);
+    WriteSetting(QStringLiteral("buffer_save_writes"), Settings::values.buffer_save_writes, true);
+    WriteSetting(QStringLiteral("use_ram_storage"), Settings::values.use_ram_storage, false);
+    WriteSetting(QStringLiteral("ram_storage_template"),
+                 QString::fromStdString(Settings::values.ram_storage_template), QString{});
+    WriteSetting(QStringLiteral("persist_ram_storage"), Settings::values.persist_ram_storage,
+                 false);
 
     qt_config->endGroup();
 }
@@ -865,6 +973,10 @@ void Config::SaveDebuggingValues() {
     qt_config->setValue(QStringLiteral("record_frame_times"), Settings::values.record_frame_times);
     WriteSetting(QStringLiteral("use_gdbstub"), Settings::values.use_gdbstub, false);
     WriteSetting(QStringLiteral("gdbstub_port"), Settings::values.gdbstub_port, 24689);
+    WriteSetting(QStringLiteral("use_metrics_server"), Settings::values.use_metrics_server, false);
+    WriteSetting(QStringLiteral("metrics_server_port"), Settings::values.metrics_server_port, 9233);
+    WriteSetting(QStringLiteral("enable_guest_profiler"), Settings::values.enable_guest_profiler,
+                 false);
 
     qt_config->beginGroup(QStringLiteral("LLE"));
     for (const auto& service_module : Settings::values.lle_modules) {
@@ -982,9 +1094,27 @@ void Config::SaveRendererValues() {
 #endif
     WriteSetting(QStringLiteral("shaders_accurate_mul"), Settings::values.shaders_accurate_mul,
                  false);
+    WriteSetting(QStringLiteral("shaders_specialize_uniforms"),
+                 Settings::values.shaders_specialize_uniforms, false);
+    WriteSetting(QStringLiteral("async_shader_compilation"),
+                 Settings::values.async_shader_compilation, false);
     WriteSetting(QStringLiteral("use_shader_jit"), Settings::values.use_shader_jit, true);
+    WriteSetting(QStringLiteral("shader_jit_cache_budget_mb"),
+                 Settings::values.shader_jit_cache_budget_mb, 64);
+    WriteSetting(QStringLiteral("parallel_vertex_shading"),
+                 Settings::values.parallel_vertex_shading, true);
+    WriteSetting(QStringLiteral("parallel_sw_rasterizer"),
+                 Settings::values.parallel_sw_rasterizer, true);
+    WriteSetting(QStringLiteral("use_gpu_texture_decoding"),
+                 Settings::values.use_gpu_texture_decoding, false);
+    WriteSetting(QStringLiteral("generate_mipmaps_on_gpu"),
+                 Settings::values.generate_mipmaps_on_gpu, false);
+    WriteSetting(QStringLiteral("surface_cache_budget_mb"),
+                 Settings::values.surface_cache_budget_mb, 0);
+    WriteSetting(QStringLiteral("use_gpu_thread"), Settings::values.use_gpu_thread, false);
     WriteSetting(QStringLiteral("use_vsync_new"), Settings::values.use_vsync_new, true);
     WriteSetting(QStringLiteral("resolution_factor"), Settings::values.resolution_factor, 1);
+    WriteSetting(QStringLiteral("dynamic_resolution"), Settings::values.dynamic_resolution, false);
     WriteSetting(QStringLiteral("frame_limit"), Settings::values.frame_limit, 100);
     WriteSetting(QStringLiteral("use_frame_limit_alternate"),
                  Settings::values.use_frame_limit_alternate, false);
@@ -1051,6 +1181,10 @@ void Config::SaveVideoDumpingValues() {
                  DEFAULT_VIDEO_ENCODER_OPTIONS);
     WriteSetting(QStringLiteral("video_bitrate"),
                  static_cast<unsigned long long>(Settings::values.video_bitrate), 2500000);
+    WriteSetting(QStringLiteral("video_dump_queue_depth"), Settings::values.video_dump_queue_depth,
+                 2);
+    WriteSetting(QStringLiteral("video_dump_drop_frames"), Settings::values.video_dump_drop_frames,
+                 false);
     WriteSetting(QStringLiteral("audio_encoder"),
                  QString::fromStdString(Settings::values.audio_encoder),
                  QStringLiteral("libvorbis"));
@@ -1092,6 +1226,7 @@ void Config::SaveUIValues() {
     WriteSetting(QStringLiteral("pauseWhenInBackground"),
                  UISettings::values.pause_when_in_background, false);
     WriteSetting(QStringLiteral("hideInactiveMouse"), UISettings::values.hide_mouse, false);
+    WriteSetting(QStringLiteral("presentThread"), UISettings::values.present_thread, false);
 
     qt_config->endGroup();
 }
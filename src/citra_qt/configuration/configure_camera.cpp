@@ -228,7 +228,8 @@ void ConfigureCamera::timerEvent(QTimerEvent* event) {
         timer_id = 0;
         return;
     }
-    std::vector<u16> frame = previewing_camera->ReceiveFrame();
+    std::vector<u16> frame;
+    previewing_camera->ReceiveFrame(frame);
     int width = ui->preview_box->size().width();
     int height = width * 0.75;
     if (width != preview_width || height != preview_height) {
@@ -97,7 +97,7 @@ void GraphicsTracingWidget::StartRecording() {
     // boost::copy(TODO: Not implemented, std::back_inserter(state.gs_float_uniforms));
 
     auto recorder = new CiTrace::Recorder(state);
-    context->recorder = std::shared_ptr<CiTrace::Recorder>(recorder);
+    context->SetRecorder(std::shared_ptr<CiTrace::Recorder>(recorder));
 
     emit SetStartTracingButtonEnabled(false);
     emit SetStopTracingButtonEnabled(true);
@@ -118,7 +118,7 @@ void GraphicsTracingWidget::StopRecording() {
     }
 
     context->recorder->Finish(filename.toStdString());
-    context->recorder = nullptr;
+    context->SetRecorder(nullptr);
 
     emit SetStopTracingButtonEnabled(false);
     emit SetAbortTracingButtonEnabled(false);
@@ -130,7 +130,7 @@ void GraphicsTracingWidget::AbortRecording() {
     if (!context)
         return;
 
-    context->recorder = nullptr;
+    context->SetRecorder(nullptr);
 
     emit SetStopTracingButtonEnabled(false);
     emit SetAbortTracingButtonEnabled(false);
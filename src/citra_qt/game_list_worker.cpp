@@ -8,6 +8,7 @@
 #include <vector>
 #include <QDir>
 #include <QFileInfo>
+#include <fmt/format.h>
 #include "citra_qt/compatibility_list.h"
 #include "citra_qt/game_list.h"
 #include "citra_qt/game_list_p.h"
@@ -15,15 +16,66 @@
 #include "citra_qt/uisettings.h"
 #include "common/common_paths.h"
 #include "common/file_util.h"
+#include "common/swap.h"
+#include "common/task_scheduler.h"
 #include "core/hle/service/am/am.h"
 #include "core/hle/service/fs/archive.h"
 #include "core/loader/loader.h"
+#include "core/loader/smdh.h"
 
 namespace {
 bool HasSupportedFileExtension(const std::string& file_name) {
     const QFileInfo file = QFileInfo(QString::fromStdString(file_name));
     return GameList::supported_file_extensions.contains(file.suffix(), Qt::CaseInsensitive);
 }
+
+constexpr u32 GAME_LIST_CACHE_MAGIC = 0x43534C47; // "GLSC"
+// Bumped whenever the layout of the cache changes
+constexpr u32 GAME_LIST_CACHE_VERSION = 1;
+
+/// Longest path the cache is trusted with, anything longer means the file is corrupted
+constexpr u32 MAX_CACHED_PATH_SIZE = 0x1000;
+
+struct GameListCacheHeader {
+    u32_le magic;
+    u32_le version;
+    u32_le num_entries;
+};
+
+/// Fixed-size part of a cached entry, followed by its path and SMDH
+struct GameListCacheEntry {
+    u64_le file_size;
+    u64_le file_mtime;
+    u64_le update_mtime;
+    u64_le program_id;
+    u64_le extdata_id;
+    u32_le file_type;
+    u32_le is_game;
+    u32_le path_size;
+    u32_le smdh_size;
+};
+
+std::string GetGameListCachePath() {
+    return fmt::format("{}game_list{}cache.bin",
+                       FileUtil::GetUserPath(FileUtil::UserPath::CacheDir), DIR_SEP);
+}
+
+/// Returns the path of the update whose icon replaces the one of the title, empty if none can
+std::string GetUpdatePath(u64 program_id) {
+    if (program_id & ~0x00040000FFFFFFFF) {
+        return {};
+    }
+    return Service::AM::GetTitleContentPath(Service::FS::MediaType::SDMC,
+                                            program_id | 0x0000000E00000000);
+}
+
+u64 GetUpdateModificationTime(u64 program_id) {
+    const std::string update_path = GetUpdatePath(program_id);
+    if (update_path.empty() || !FileUtil::Exists(update_path)) {
+        return 0;
+    }
+    return FileUtil::GetModificationTime(update_path);
+}
 } // Anonymous namespace
 
 GameListWorker::GameListWorker(QVector<UISettings::GameDir>& game_dirs,
@@ -32,6 +84,60 @@ GameListWorker::GameListWorker(QVector<UISettings::GameDir>& game_dirs,
 
 GameListWorker::~GameListWorker() = default;
 
+GameListWorker::GameInfo GameListWorker::LoadGameInfo(const std::string& physical_name) {
+    GameInfo info;
+    info.file_size = FileUtil::GetSize(physical_name);
+    info.file_mtime = FileUtil::GetModificationTime(physical_name);
+
+    std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(physical_name);
+    if (!loader) {
+        return info;
+    }
+
+    bool executable = false;
+    const auto res = loader->IsExecutable(executable);
+    if (!executable && res != Loader::ResultStatus::ErrorEncrypted) {
+        return info;
+    }
+    info.is_game = true;
+    info.file_type = static_cast<u32>(loader->GetFileType());
+
+    loader->ReadProgramId(info.program_id);
+    loader->ReadExtdataId(info.extdata_id);
+
+    // Look for an update icon if available
+    const std::string update_path = GetUpdatePath(info.program_id);
+    if (!update_path.empty() && FileUtil::Exists(update_path)) {
+        info.update_mtime = FileUtil::GetModificationTime(update_path);
+        std::unique_ptr<Loader::AppLoader> update_loader = Loader::GetLoader(update_path);
+        if (update_loader) {
+            update_loader->ReadIcon(info.smdh);
+        }
+    }
+
+    if (!Loader::IsValidSMDH(info.smdh)) {
+        // Read the original smdh if there is no valid update smdh
+        info.smdh.clear();
+        loader->ReadIcon(info.smdh);
+    }
+    return info;
+}
+
+const GameListWorker::GameInfo* GameListWorker::FindCachedGameInfo(
+    const std::string& physical_name) const {
+    const auto it = cached_games.find(physical_name);
+    if (it == cached_games.end()) {
+        return nullptr;
+    }
+    const GameInfo& info = it->second;
+    if (info.file_size != FileUtil::GetSize(physical_name) ||
+        info.file_mtime != FileUtil::GetModificationTime(physical_name) ||
+        (info.is_game && info.update_mtime != GetUpdateModificationTime(info.program_id))) {
+        return nullptr;
+    }
+    return &info;
+}
+
 void GameListWorker::AddFstEntriesToGameList(const std::string& dir_path, unsigned int recursion,
                                              GameListDir* parent_dir) {
     const auto callback = [this, recursion, parent_dir](u64* num_entries_out,
@@ -45,79 +151,154 @@ void GameListWorker::AddFstEntriesToGameList(const std::string& dir_path, unsign
         const std::string physical_name = directory + DIR_SEP + virtual_name;
         const bool is_dir = FileUtil::IsDirectory(physical_name);
         if (!is_dir && HasSupportedFileExtension(physical_name)) {
-            std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(physical_name);
-            if (!loader) {
-                return true;
-            }
+            pending_entries.push_back({physical_name, parent_dir});
+        } else if (is_dir && recursion > 0) {
+            watch_list.append(QString::fromStdString(physical_name));
+            AddFstEntriesToGameList(physical_name, recursion - 1, parent_dir);
+        }
 
-            bool executable = false;
-            const auto res = loader->IsExecutable(executable);
-            if (!executable && res != Loader::ResultStatus::ErrorEncrypted) {
-                return true;
-            }
+        return true;
+    };
 
-            u64 program_id = 0;
-            loader->ReadProgramId(program_id);
-
-            u64 extdata_id = 0;
-            loader->ReadExtdataId(extdata_id);
-
-            std::vector<u8> smdh;
-            // Look for an update icon if available
-            if (!(program_id & ~0x00040000FFFFFFFF)) {
-                std::string update_path = Service::AM::GetTitleContentPath(
-                    Service::FS::MediaType::SDMC, program_id | 0x0000000E00000000);
-                if (FileUtil::Exists(update_path)) {
-                    std::unique_ptr<Loader::AppLoader> update_loader =
-                        Loader::GetLoader(update_path);
-                    if (update_loader) {
-                        update_loader->ReadIcon(smdh);
-                    }
-                }
-            }
+    FileUtil::ForeachDirectoryEntry(nullptr, dir_path, callback);
+}
 
-            if (!Loader::IsValidSMDH(smdh)) {
-                // Read the original smdh if there is no valid update smdh
-                loader->ReadIcon(smdh);
-            }
+void GameListWorker::ProcessPendingEntries() {
+    std::vector<const GameInfo*> infos(pending_entries.size());
+    std::vector<std::size_t> misses;
+    for (std::size_t i = 0; i < pending_entries.size(); ++i) {
+        infos[i] = FindCachedGameInfo(pending_entries[i].physical_name);
+        if (!infos[i]) {
+            misses.push_back(i);
+        }
+    }
 
-            if (!Loader::IsValidSMDH(smdh) && UISettings::values.game_list_hide_no_icon) {
-                // Skip this invalid entry
-                return true;
+    // Reading the files is what takes time, it is spread over the shared workers
+    std::vector<GameInfo> loaded(misses.size());
+    Common::TaskScheduler::GetInstance().ParallelFor(
+        misses.size(), 1,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end && !stop_processing; ++i) {
+                loaded[i] = LoadGameInfo(pending_entries[misses[i]].physical_name);
             }
+        },
+        Common::TaskScheduler::Priority::Low);
+    if (stop_processing) {
+        pending_entries.clear();
+        return;
+    }
+    for (std::size_t i = 0; i < misses.size(); ++i) {
+        infos[misses[i]] = &loaded[i];
+    }
 
-            auto it = FindMatchingCompatibilityEntry(compatibility_list, program_id);
-
-            // The game list uses this as compatibility number for untested games
-            QString compatibility(QStringLiteral("99"));
-            if (it != compatibility_list.end())
-                compatibility = it->second.first;
-
-            emit EntryReady(
-                {
-                    new GameListItemPath(QString::fromStdString(physical_name), smdh, program_id,
-                                         extdata_id),
-                    new GameListItemCompat(compatibility),
-                    new GameListItemRegion(smdh),
-                    new GameListItem(
-                        QString::fromStdString(Loader::GetFileTypeString(loader->GetFileType()))),
-                    new GameListItemSize(FileUtil::GetSize(physical_name)),
-                },
-                parent_dir);
+    for (std::size_t i = 0; i < pending_entries.size(); ++i) {
+        const auto& [physical_name, parent_dir] = pending_entries[i];
+        const GameInfo& info =
+            scanned_games.insert_or_assign(physical_name, *infos[i]).first->second;
+        if (!info.is_game) {
+            continue;
+        }
 
-        } else if (is_dir && recursion > 0) {
-            watch_list.append(QString::fromStdString(physical_name));
-            AddFstEntriesToGameList(physical_name, recursion - 1, parent_dir);
+        if (!Loader::IsValidSMDH(info.smdh) && UISettings::values.game_list_hide_no_icon) {
+            // Skip this invalid entry
+            continue;
         }
 
-        return true;
-    };
+        auto it = FindMatchingCompatibilityEntry(compatibility_list, info.program_id);
 
-    FileUtil::ForeachDirectoryEntry(nullptr, dir_path, callback);
+        // The game list uses this as compatibility number for untested games
+        QString compatibility(QStringLiteral("99"));
+        if (it != compatibility_list.end())
+            compatibility = it->second.first;
+
+        emit EntryReady(
+            {
+                new GameListItemPath(QString::fromStdString(physical_name), info.smdh,
+                                     info.program_id, info.extdata_id),
+                new GameListItemCompat(compatibility),
+                new GameListItemRegion(info.smdh),
+                new GameListItem(QString::fromStdString(Loader::GetFileTypeString(
+                    static_cast<Loader::FileType>(info.file_type)))),
+                new GameListItemSize(info.file_size),
+            },
+            parent_dir);
+    }
+    pending_entries.clear();
+}
+
+void GameListWorker::LoadCache() {
+    cached_games.clear();
+    FileUtil::IOFile file(GetGameListCachePath(), "rb");
+    if (!file) {
+        return;
+    }
+    GameListCacheHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != GAME_LIST_CACHE_MAGIC || header.version != GAME_LIST_CACHE_VERSION) {
+        return;
+    }
+    for (u32 i = 0; i < header.num_entries; ++i) {
+        GameListCacheEntry entry;
+        if (file.ReadBytes(&entry, sizeof(entry)) != sizeof(entry) ||
+            entry.path_size > MAX_CACHED_PATH_SIZE || entry.smdh_size > sizeof(Loader::SMDH)) {
+            cached_games.clear();
+            return;
+        }
+        std::string path(entry.path_size, '\0');
+        GameInfo info;
+        info.file_size = entry.file_size;
+        info.file_mtime = entry.file_mtime;
+        info.update_mtime = entry.update_mtime;
+        info.is_game = entry.is_game != 0;
+        info.program_id = entry.program_id;
+        info.extdata_id = entry.extdata_id;
+        info.file_type = entry.file_type;
+        info.smdh.resize(entry.smdh_size);
+        if (file.ReadBytes(path.data(), path.size()) != path.size() ||
+            file.ReadBytes(info.smdh.data(), info.smdh.size()) != info.smdh.size()) {
+            cached_games.clear();
+            return;
+        }
+        cached_games.emplace(std::move(path), std::move(info));
+    }
+}
+
+void GameListWorker::SaveCache() const {
+    const std::string path = GetGameListCachePath();
+    FileUtil::CreateFullPath(path);
+    FileUtil::IOFile file(path, "wb");
+    if (!file) {
+        return;
+    }
+    GameListCacheHeader header{};
+    header.magic = GAME_LIST_CACHE_MAGIC;
+    header.version = GAME_LIST_CACHE_VERSION;
+    header.num_entries = static_cast<u32>(scanned_games.size());
+    file.WriteBytes(&header, sizeof(header));
+    for (const auto& [physical_name, info] : scanned_games) {
+        GameListCacheEntry entry{};
+        entry.file_size = info.file_size;
+        entry.file_mtime = info.file_mtime;
+        entry.update_mtime = info.update_mtime;
+        entry.program_id = info.program_id;
+        entry.extdata_id = info.extdata_id;
+        entry.file_type = info.file_type;
+        entry.is_game = info.is_game;
+        entry.path_size = static_cast<u32>(physical_name.size());
+        entry.smdh_size = static_cast<u32>(info.smdh.size());
+        file.WriteBytes(&entry, sizeof(entry));
+        file.WriteBytes(physical_name.data(), physical_name.size());
+        file.WriteBytes(info.smdh.data(), info.smdh.size());
+    }
+    if (!file.IsGood()) {
+        file.Close();
+        FileUtil::Delete(path);
+    }
 }
 
 void GameListWorker::run() {
     stop_processing = false;
+    LoadCache();
     for (UISettings::GameDir& game_dir : game_dirs) {
         if (game_dir.path == QStringLiteral("INSTALLED")) {
             QString games_path =
@@ -137,6 +318,7 @@ void GameListWorker::run() {
             emit DirEntryReady(game_list_dir);
             AddFstEntriesToGameList(games_path.toStdString(), 2, game_list_dir);
             AddFstEntriesToGameList(demos_path.toStdString(), 2, game_list_dir);
+            ProcessPendingEntries();
         } else if (game_dir.path == QStringLiteral("SYSTEM")) {
             QString path =
                 QString::fromStdString(FileUtil::GetUserPath(FileUtil::UserPath::NANDDir)) +
@@ -145,14 +327,20 @@ void GameListWorker::run() {
             auto* const game_list_dir = new GameListDir(game_dir, GameListItemType::SystemDir);
             emit DirEntryReady(game_list_dir);
             AddFstEntriesToGameList(path.toStdString(), 2, game_list_dir);
+            ProcessPendingEntries();
         } else {
             watch_list.append(game_dir.path);
             auto* const game_list_dir = new GameListDir(game_dir);
             emit DirEntryReady(game_list_dir);
             AddFstEntriesToGameList(game_dir.path.toStdString(), game_dir.deep_scan ? 256 : 0,
                                     game_list_dir);
+            ProcessPendingEntries();
         }
     };
+    // A cancelled scan didn't see all the files, the cache of the previous one stays
+    if (!stop_processing) {
+        SaveCache();
+    }
     emit Finished(watch_list);
 }
 
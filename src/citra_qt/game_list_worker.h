@@ -9,6 +9,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <QList>
 #include <QObject>
 #include <QRunnable>
@@ -53,12 +54,49 @@ signals:
     void Finished(QStringList watch_list);
 
 private:
+    /// What the loader tells about a file, cached across the scans by path
+    struct GameInfo {
+        u64 file_size = 0;
+        u64 file_mtime = 0;
+        /// Modification time of the update the icon is looked for in, 0 if there is none
+        u64 update_mtime = 0;
+        /// Whether the file is an executable the list shows
+        bool is_game = false;
+        u64 program_id = 0;
+        u64 extdata_id = 0;
+        u32 file_type = 0;
+        std::vector<u8> smdh;
+    };
+
+    /// A file found by the scan of a directory, listed once the loader looked at it
+    struct PendingEntry {
+        std::string physical_name;
+        GameListDir* parent_dir;
+    };
+
     void AddFstEntriesToGameList(const std::string& dir_path, unsigned int recursion,
                                  GameListDir* parent_dir);
 
+    /// Looks at the files found so far, the ones missing from the cache on several threads, and
+    /// adds them to the list
+    void ProcessPendingEntries();
+
+    /// Returns the cached information of the file, null if there is none or it is outdated
+    const GameInfo* FindCachedGameInfo(const std::string& physical_name) const;
+
+    static GameInfo LoadGameInfo(const std::string& physical_name);
+
+    void LoadCache();
+    void SaveCache() const;
+
     QVector<UISettings::GameDir>& game_dirs;
     const CompatibilityList& compatibility_list;
 
+    std::vector<PendingEntry> pending_entries;
+    /// The information of the files from the previous scans and the ones of this scan
+    std::unordered_map<std::string, GameInfo> cached_games;
+    std::unordered_map<std::string, GameInfo> scanned_games;
+
     QStringList watch_list;
     std::atomic_bool stop_processing;
 };
@@ -282,8 +282,13 @@ void GMainWindow::InitializeWidgets() {
     emu_frametime_label->setToolTip(
         tr("Time taken to emulate a 3DS frame, not counting framelimiting or v-sync. For "
            "full-speed emulation this should be at most 16.67 ms."));
+    present_latency_label = new QLabel();
+    present_latency_label->setToolTip(
+        tr("Average time from the start of a 3DS frame until it is displayed, and the longest time "
+           "between two displayed frames. A long time between frames is seen as stutter."));
 
-    for (auto& label : {emu_speed_label, game_fps_label, emu_frametime_label}) {
+    for (auto& label :
+         {emu_speed_label, game_fps_label, emu_frametime_label, present_latency_label}) {
         label->setVisible(false);
         label->setFrameStyle(QFrame::NoFrame);
         label->setContentsMargins(4, 0, 4, 0);
@@ -566,6 +571,12 @@ void GMainWindow::InitializeHotkeys() {
                     OnCaptureScreenshot();
                 }
             });
+    connect(hotkey_registry.GetHotkey(main_window, QStringLiteral("Rewind"), this),
+            &QShortcut::activated, this, [&] {
+                if (emulation_running) {
+                    Core::System::GetInstance().SendSignal(Core::System::Signal::Rewind);
+                }
+            });
     connect(hotkey_registry.GetHotkey(main_window, ui.action_Load_from_Newest_Slot->text(), this),
             &QShortcut::activated, ui.action_Load_from_Newest_Slot, &QAction::trigger);
     connect(hotkey_registry.GetHotkey(main_window, ui.action_Save_to_Oldest_Slot->text(), this),
@@ -1150,6 +1161,7 @@ void GMainWindow::ShutdownGame() {
     emu_speed_label->setVisible(false);
     game_fps_label->setVisible(false);
     emu_frametime_label->setVisible(false);
+    present_latency_label->setVisible(false);
 
     UpdateSaveStates();
 
@@ -2048,10 +2060,14 @@ void GMainWindow::UpdateStatusBar() {
     }
     game_fps_label->setText(tr("Game: %1 FPS").arg(results.game_fps, 0, 'f', 0));
     emu_frametime_label->setText(tr("Frame: %1 ms").arg(results.frametime * 1000.0, 0, 'f', 2));
+    present_latency_label->setText(tr("Latency: %1 ms / %2 ms")
+                                       .arg(results.present_latency * 1000.0, 0, 'f', 1)
+                                       .arg(results.max_present_interval * 1000.0, 0, 'f', 1));
 
     emu_speed_label->setVisible(true);
     game_fps_label->setVisible(true);
     emu_frametime_label->setVisible(true);
+    present_latency_label->setVisible(true);
 }
 
 void GMainWindow::HideMouseCursor() {
@@ -2363,6 +2379,9 @@ void GMainWindow::RetranslateStatusBar() {
     emu_frametime_label->setToolTip(
         tr("Time taken to emulate a 3DS frame, not counting framelimiting or v-sync. For "
            "full-speed emulation this should be at most 16.67 ms."));
+    present_latency_label->setToolTip(
+        tr("Average time from the start of a 3DS frame until it is displayed, and the longest time "
+           "between two displayed frames. A long time between frames is seen as stutter."));
 
     multiplayer_state->retranslateUi();
 }
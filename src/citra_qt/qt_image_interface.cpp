@@ -27,10 +27,11 @@ bool QtImageInterface::DecodePNG(std::vector<u8>& dst, u32& width, u32& height,
 }
 
 bool QtImageInterface::EncodePNG(const std::string& path, const std::vector<u8>& src, u32 width,
-                                 u32 height) {
+                                 u32 height, bool fast) {
     QImage image(src.data(), width, height, QImage::Format_RGBA8888);
 
-    if (!image.save(QString::fromStdString(path), "PNG")) {
+    // The PNG quality is the inverse of the zlib compression level, 90 stands for level 1
+    if (!image.save(QString::fromStdString(path), "PNG", fast ? 90 : -1)) {
         LOG_ERROR(Frontend, "Failed to save {}", path);
         return false;
     }
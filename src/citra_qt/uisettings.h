@@ -77,6 +77,8 @@ struct Values {
     bool first_start;
     bool pause_when_in_background;
     bool hide_mouse;
+    /// Whether the frames are presented from a thread of their own rather than the event loop
+    bool present_thread;
 
     bool updater_found;
     bool update_on_close;
@@ -0,0 +1,226 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/async_io.h"
+#include "common/common_funcs.h"
+#include "common/logging/log.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include "common/string_util.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace FileUtil {
+
+namespace {
+/// Number of I/O threads of the shared engine, enough to keep a few requests in flight
+constexpr std::size_t NumSharedWorkers = 4;
+
+/// Largest transfer made at once, which fits the 32-bit sizes of the Windows calls
+constexpr std::size_t MaxTransferSize = 1u << 30;
+} // Anonymous namespace
+
+#ifdef _WIN32
+
+AsyncFile::AsyncFile(const std::string& path, Mode mode) {
+    const DWORD access =
+        mode == Mode::Read ? GENERIC_READ
+                           : mode == Mode::Write ? GENERIC_WRITE : GENERIC_READ | GENERIC_WRITE;
+    const DWORD disposition = mode == Mode::Write ? CREATE_ALWAYS : OPEN_EXISTING;
+    handle = CreateFileW(Common::UTF8ToUTF16W(path).c_str(), access,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, disposition,
+                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        LOG_ERROR(Common_Filesystem, "Failed to open {}: {}", path, GetLastErrorMsg());
+    }
+}
+
+AsyncFile::~AsyncFile() {
+    if (IsOpen()) {
+        CloseHandle(handle);
+    }
+}
+
+bool AsyncFile::IsOpen() const {
+    return handle != INVALID_HANDLE_VALUE;
+}
+
+u64 AsyncFile::GetSize() const {
+    LARGE_INTEGER size;
+    if (!IsOpen() || !GetFileSizeEx(handle, &size)) {
+        return 0;
+    }
+    return static_cast<u64>(size.QuadPart);
+}
+
+/// Runs an overlapped transfer and waits for it, the handle has no position to move
+template <typename Transfer>
+static std::size_t RunOverlapped(HANDLE handle, std::size_t length, u64 offset,
+                                 Transfer&& transfer) {
+    const HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (event == nullptr) {
+        return 0;
+    }
+    std::size_t done = 0;
+    while (done < length) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset + done);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+        overlapped.hEvent = event;
+        const DWORD size = static_cast<DWORD>(std::min(length - done, MaxTransferSize));
+        DWORD transferred = 0;
+        if (!transfer(done, size, &overlapped) && GetLastError() != ERROR_IO_PENDING) {
+            break;
+        }
+        if (!GetOverlappedResult(handle, &overlapped, &transferred, TRUE) || transferred == 0) {
+            break;
+        }
+        done += transferred;
+    }
+    CloseHandle(event);
+    return done;
+}
+
+std::size_t AsyncFile::ReadAt(void* data, std::size_t length, u64 offset) const {
+    if (!IsOpen()) {
+        return 0;
+    }
+    return RunOverlapped(handle, length, offset,
+                         [&](std::size_t done, DWORD size, OVERLAPPED* overlapped) {
+                             return ReadFile(handle, static_cast<u8*>(data) + done, size, nullptr,
+                                             overlapped);
+                         });
+}
+
+std::size_t AsyncFile::WriteAt(const void* data, std::size_t length, u64 offset) const {
+    if (!IsOpen()) {
+        return 0;
+    }
+    return RunOverlapped(handle, length, offset,
+                         [&](std::size_t done, DWORD size, OVERLAPPED* overlapped) {
+                             return WriteFile(handle, static_cast<const u8*>(data) + done, size,
+                                              nullptr, overlapped);
+                         });
+}
+
+#else
+
+AsyncFile::AsyncFile(const std::string& path, Mode mode) {
+    const int flags =
+        mode == Mode::Read ? O_RDONLY : mode == Mode::Write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDWR;
+    do {
+        fd = open(path.c_str(), flags | O_CLOEXEC, 0644);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        LOG_ERROR(Common_Filesystem, "Failed to open {}: {}", path, GetLastErrorMsg());
+    }
+}
+
+AsyncFile::~AsyncFile() {
+    if (IsOpen()) {
+        close(fd);
+    }
+}
+
+bool AsyncFile::IsOpen() const {
+    return fd >= 0;
+}
+
+u64 AsyncFile::GetSize() const {
+    struct stat buf;
+    if (!IsOpen() || fstat(fd, &buf) != 0) {
+        return 0;
+    }
+    return static_cast<u64>(buf.st_size);
+}
+
+std::size_t AsyncFile::ReadAt(void* data, std::size_t length, u64 offset) const {
+    std::size_t done = 0;
+    while (IsOpen() && done < length) {
+        const ssize_t result = pread(fd, static_cast<u8*>(data) + done,
+                                     std::min(length - done, MaxTransferSize),
+                                     static_cast<off_t>(offset + done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(result);
+    }
+    return done;
+}
+
+std::size_t AsyncFile::WriteAt(const void* data, std::size_t length, u64 offset) const {
+    std::size_t done = 0;
+    while (IsOpen() && done < length) {
+        const ssize_t result = pwrite(fd, static_cast<const u8*>(data) + done,
+                                      std::min(length - done, MaxTransferSize),
+                                      static_cast<off_t>(offset + done));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(result);
+    }
+    return done;
+}
+
+#endif
+
+AsyncIO& AsyncIO::GetInstance() {
+    static AsyncIO instance(NumSharedWorkers);
+    return instance;
+}
+
+AsyncIO::AsyncIO(std::size_t num_workers) : pool(num_workers, "AsyncIO") {}
+
+AsyncIO::~AsyncIO() = default;
+
+std::future<std::size_t> AsyncIO::Read(std::shared_ptr<const AsyncFile> file, void* data,
+                                       std::size_t length, u64 offset) {
+    // The tasks of the pool must be copyable, which a promise isn't
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    std::future<std::size_t> future = promise->get_future();
+    Read(std::move(file), data, length, offset,
+         [promise](std::size_t bytes_read) { promise->set_value(bytes_read); });
+    return future;
+}
+
+std::future<std::size_t> AsyncIO::Write(std::shared_ptr<const AsyncFile> file, const void* data,
+                                        std::size_t length, u64 offset) {
+    auto promise = std::make_shared<std::promise<std::size_t>>();
+    std::future<std::size_t> future = promise->get_future();
+    Write(std::move(file), data, length, offset,
+          [promise](std::size_t bytes_written) { promise->set_value(bytes_written); });
+    return future;
+}
+
+void AsyncIO::Read(std::shared_ptr<const AsyncFile> file, void* data, std::size_t length,
+                   u64 offset, Callback callback) {
+    pool.Push([file = std::move(file), data, length, offset, callback = std::move(callback)] {
+        callback(file->ReadAt(data, length, offset));
+    });
+}
+
+void AsyncIO::Write(std::shared_ptr<const AsyncFile> file, const void* data, std::size_t length,
+                    u64 offset, Callback callback) {
+    pool.Push([file = std::move(file), data, length, offset, callback = std::move(callback)] {
+        callback(file->WriteAt(data, length, offset));
+    });
+}
+
+void AsyncIO::WaitForAll() {
+    pool.WaitForAll();
+}
+
+} // namespace FileUtil
@@ -0,0 +1,100 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include "common/common_types.h"
+#include "common/thread_pool.h"
+
+namespace FileUtil {
+
+/**
+ * A file accessed at explicit offsets through its native handle, a file descriptor or a Windows
+ * handle opened for overlapped I/O. Unlike IOFile, the accesses don't share a position nor a
+ * stream buffer, so they can be made from several threads at once.
+ */
+class AsyncFile {
+public:
+    enum class Mode {
+        Read,      ///< Opens an existing file for reading
+        Write,     ///< Creates the file, or truncates it if it exists
+        ReadWrite, ///< Opens an existing file for reading and writing
+    };
+
+    AsyncFile(const std::string& path, Mode mode);
+    ~AsyncFile();
+
+    AsyncFile(const AsyncFile&) = delete;
+    AsyncFile& operator=(const AsyncFile&) = delete;
+
+    bool IsOpen() const;
+
+    /// Returns the size of the file, or 0 on failure
+    u64 GetSize() const;
+
+    /**
+     * Reads from the file at the given offset, blocking until done.
+     * @returns the number of bytes read, less than length at the end of the file or on error.
+     */
+    std::size_t ReadAt(void* data, std::size_t length, u64 offset) const;
+
+    /**
+     * Writes to the file at the given offset, blocking until done.
+     * @returns the number of bytes written, less than length on error.
+     */
+    std::size_t WriteAt(const void* data, std::size_t length, u64 offset) const;
+
+private:
+#ifdef _WIN32
+    void* handle;
+#else
+    int fd;
+#endif
+};
+
+/**
+ * The engine running the reads and writes of AsyncFiles in the background. The requests are
+ * queued to a few I/O threads, which is what a blocking handle can do everywhere, and complete
+ * either through a future or a callback run on the I/O thread. The buffers must live until the
+ * request completes, the files are kept alive by the requests.
+ */
+class AsyncIO {
+public:
+    /// Called with the number of bytes transferred by the request
+    using Callback = std::function<void(std::size_t)>;
+
+    /// Returns the engine shared by the whole process
+    static AsyncIO& GetInstance();
+
+    /**
+     * Creates an engine with the given number of I/O threads.
+     * @param num_workers Number of threads to spawn. An engine with no threads runs the requests
+     *                    on the thread making them.
+     */
+    explicit AsyncIO(std::size_t num_workers);
+    ~AsyncIO();
+
+    std::future<std::size_t> Read(std::shared_ptr<const AsyncFile> file, void* data,
+                                  std::size_t length, u64 offset);
+    std::future<std::size_t> Write(std::shared_ptr<const AsyncFile> file, const void* data,
+                                   std::size_t length, u64 offset);
+
+    void Read(std::shared_ptr<const AsyncFile> file, void* data, std::size_t length, u64 offset,
+              Callback callback);
+    void Write(std::shared_ptr<const AsyncFile> file, const void* data, std::size_t length,
+               u64 offset, Callback callback);
+
+    /// Blocks until every request made so far has completed
+    void WaitForAll();
+
+private:
+    Common::ThreadPool pool;
+};
+
+} // namespace FileUtil
@@ -44,6 +44,8 @@
 #include <cstring>
 #include <dirent.h>
 #include <pwd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -368,6 +370,20 @@ u64 GetSize(FILE* f) {
     return size;
 }
 
+u64 GetModificationTime(const std::string& filename) {
+    struct stat buf;
+#ifdef _WIN32
+    if (_wstat64(Common::UTF8ToUTF16W(filename).c_str(), &buf) != 0)
+#else
+    if (stat(filename.c_str(), &buf) != 0)
+#endif
+    {
+        LOG_ERROR(Common_Filesystem, "Stat failed {}: {}", filename, GetLastErrorMsg());
+        return 0;
+    }
+    return static_cast<u64>(buf.st_mtime);
+}
+
 bool CreateEmptyFile(const std::string& filename) {
     LOG_TRACE(Common_Filesystem, "{}", filename);
 
@@ -762,6 +778,13 @@ const std::string& GetUserPath(UserPath path) {
         SetUserPath();
     return g_paths[path];
 }
+
+void UpdateUserPath(UserPath path, const std::string& new_path) {
+    if (g_paths.empty())
+        SetUserPath();
+    g_paths[path] = new_path;
+}
+
 std::size_t WriteStringToFile(bool text_file, const std::string& filename, std::string_view str) {
     return IOFile(filename, text_file ? "w" : "wb").WriteString(str);
 }
@@ -938,6 +961,7 @@ IOFile& IOFile::operator=(IOFile&& other) noexcept {
 void IOFile::Swap(IOFile& other) noexcept {
     std::swap(m_file, other.m_file);
     std::swap(m_good, other.m_good);
+    std::swap(m_locked, other.m_locked);
     std::swap(filename, other.filename);
     std::swap(openmode, other.openmode);
     std::swap(flags, other.flags);
@@ -964,6 +988,9 @@ bool IOFile::Open() {
 }
 
 bool IOFile::Close() {
+    if (m_locked) {
+        Unlock();
+    }
     if (!IsOpen() || 0 != std::fclose(m_file))
         m_good = false;
 
@@ -999,6 +1026,48 @@ bool IOFile::Flush() {
     return m_good;
 }
 
+bool IOFile::Lock() {
+    if (!IsOpen() || m_locked) {
+        m_good = false;
+        return false;
+    }
+#ifdef _WIN32
+    OVERLAPPED overlapped{};
+    m_locked = LockFileEx(reinterpret_cast<HANDLE>(_get_osfhandle(fileno(m_file))),
+                          LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped) != 0;
+#else
+    int result;
+    do {
+        result = flock(fileno(m_file), LOCK_EX);
+    } while (result != 0 && errno == EINTR);
+    m_locked = result == 0;
+#endif
+    if (!m_locked)
+        m_good = false;
+
+    return m_locked;
+}
+
+bool IOFile::Unlock() {
+    if (!IsOpen() || !m_locked) {
+        m_good = false;
+        return false;
+    }
+    // Other processes must see everything written while the lock was held
+    Flush();
+    m_locked = false;
+#ifdef _WIN32
+    OVERLAPPED overlapped{};
+    if (!UnlockFileEx(reinterpret_cast<HANDLE>(_get_osfhandle(fileno(m_file))), 0, MAXDWORD,
+                      MAXDWORD, &overlapped))
+#else
+    if (flock(fileno(m_file), LOCK_UN) != 0)
+#endif
+        m_good = false;
+
+    return m_good;
+}
+
 std::size_t IOFile::ReadImpl(void* data, std::size_t length, std::size_t data_size) {
     if (!IsOpen()) {
         m_good = false;
@@ -1045,4 +1114,58 @@ bool IOFile::Resize(u64 size) {
     return m_good;
 }
 
+MappedFileView::MappedFileView(const IOFile& file, u64 offset, std::size_t size) {
+    // Accessing a mapped page past the end of the file faults, so the view must fit in the file
+    if (!file.IsOpen() || size == 0 || offset + size > file.GetSize()) {
+        return;
+    }
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const u64 aligned_offset = offset - offset % info.dwAllocationGranularity;
+    mapped_size = static_cast<std::size_t>(offset - aligned_offset) + size;
+    const HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(fileno(file.m_file)));
+    mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        LOG_WARNING(Common_Filesystem, "Unable to map {}, error={}", file.filename,
+                    GetLastError());
+        return;
+    }
+    base = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(aligned_offset >> 32),
+                         static_cast<DWORD>(aligned_offset), mapped_size);
+    if (base == nullptr) {
+        LOG_WARNING(Common_Filesystem, "Unable to map {}, error={}", file.filename,
+                    GetLastError());
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return;
+    }
+#else
+    const u64 page_size = static_cast<u64>(sysconf(_SC_PAGESIZE));
+    const u64 aligned_offset = offset - offset % page_size;
+    mapped_size = static_cast<std::size_t>(offset - aligned_offset) + size;
+    void* result = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fileno(file.m_file),
+                        static_cast<off_t>(aligned_offset));
+    if (result == MAP_FAILED) {
+        LOG_WARNING(Common_Filesystem, "Unable to map {}, errno={}", file.filename, errno);
+        return;
+    }
+    base = result;
+#endif
+    pointer = static_cast<const u8*>(base) + (offset - aligned_offset);
+    this->size = size;
+}
+
+MappedFileView::~MappedFileView() {
+    if (base == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+#else
+    munmap(base, mapped_size);
+#endif
+}
+
 } // namespace FileUtil
@@ -105,6 +105,9 @@ u64 GetSize(const int fd);
 // Overloaded GetSize, accepts FILE*
 u64 GetSize(FILE* f);
 
+// Returns the time filename was last modified at, in seconds since the epoch, or 0 on failure
+u64 GetModificationTime(const std::string& filename);
+
 // Returns true if successful, or path already exists.
 bool CreateDir(const std::string& filename);
 
@@ -180,6 +183,9 @@ bool SetCurrentDir(const std::string& directory);
 
 void SetUserPath(const std::string& path = "");
 
+// Points one of the user paths elsewhere, until the next SetUserPath
+void UpdateUserPath(UserPath path, const std::string& new_path);
+
 void SetCurrentRomPath(const std::string& path);
 
 // Returns a pointer to a string with a Citra data dir in the user's home
@@ -247,6 +253,8 @@ enum class DirectorySeparator { ForwardSlash, BackwardSlash, PlatformDefault };
 std::string SanitizePath(std::string_view path,
                          DirectorySeparator directory_separator = DirectorySeparator::ForwardSlash);
 
+class MappedFileView;
+
 // simple wrapper for cstdlib file functions to
 // hopefully will make error checking easier
 // and make forgetting an fclose() harder
@@ -332,6 +340,12 @@ public:
     bool Resize(u64 size);
     bool Flush();
 
+    /// Blocks until this process holds an exclusive lock on the whole file, so that processes
+    /// sharing the file can read and append to it safely. The lock is released by Unlock or Close.
+    bool Lock();
+    /// Flushes pending writes and releases the lock taken by Lock
+    bool Unlock();
+
     // clear error state
     void Clear() {
         m_good = true;
@@ -344,8 +358,11 @@ private:
 
     bool Open();
 
+    friend class MappedFileView;
+
     std::FILE* m_file = nullptr;
     bool m_good = true;
+    bool m_locked = false;
 
     std::string filename;
     std::string openmode;
@@ -369,6 +386,39 @@ private:
     friend class boost::serialization::access;
 };
 
+/**
+ * A read only view of a part of an open file, mapped into memory. The view is invalid if the host
+ * can't map the file, in which case the file has to be read through IOFile.
+ */
+class MappedFileView : public NonCopyable {
+public:
+    MappedFileView(const IOFile& file, u64 offset, std::size_t size);
+    ~MappedFileView();
+
+    bool IsValid() const {
+        return pointer != nullptr;
+    }
+
+    /// Returns a pointer to the byte of the file at the offset the view starts at
+    const u8* Pointer() const {
+        return pointer;
+    }
+
+    std::size_t Size() const {
+        return size;
+    }
+
+private:
+    const u8* pointer = nullptr;
+    std::size_t size = 0;
+    /// The mapping starts at an offset aligned to the granularity of the host
+    void* base = nullptr;
+    std::size_t mapped_size = 0;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
 } // namespace FileUtil
 
 // To deal with Windows being dumb at unicode:
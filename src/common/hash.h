@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <cstring>
+#include <utility>
 #include "common/cityhash.h"
 #include "common/common_types.h"
 
@@ -21,6 +22,17 @@ static inline u64 ComputeHash64(const void* data, std::size_t len) noexcept {
     return CityHash64(static_cast<const char*>(data), len);
 }
 
+/**
+ * Computes a 128-bit hash over the specified block of data, in a single pass over it. Meant for
+ * identifying contents among many blocks, where 64 bits would make collisions likely.
+ * @param data Block of data to compute hash over
+ * @param len Length of data (in bytes) to compute hash over
+ * @returns low and high 64 bits of the hash value that was computed over the data block
+ */
+static inline std::pair<u64, u64> ComputeHash128(const void* data, std::size_t len) noexcept {
+    return CityHash128(static_cast<const char*>(data), len);
+}
+
 /**
  * Computes a 64-bit hash of a struct. In addition to being trivially copyable, it is also critical
  * that either the struct includes no padding, or that any padding is initialized to a known value
@@ -0,0 +1,203 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#endif
+#include "common/alignment.h"
+#include "common/assert.h"
+#include "common/host_memory.h"
+#include "common/logging/log.h"
+
+namespace Common {
+
+#ifdef _WIN32
+/// Large pages need the "Lock pages in memory" privilege, which the user must have been granted
+static bool EnableLockMemoryPrivilege() {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+    TOKEN_PRIVILEGES privileges{};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    // AdjustTokenPrivileges succeeds without granting anything when the privilege isn't held
+    const bool enabled =
+        LookupPrivilegeValueW(nullptr, L"SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+        GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return enabled;
+}
+#else
+/// Guest pages are mapped one by one, so the host pages must not be larger
+constexpr long GUEST_PAGE_SIZE = 0x1000;
+
+#ifdef __linux__
+/// Size of the huge pages of x86-64 and of AArch64 with 4 KiB pages
+constexpr std::size_t HUGE_PAGE_SIZE = 0x200000;
+#endif
+
+/// Asks for transparent huge pages, which the kernel may ignore depending on its configuration
+static void AdviseHugePages([[maybe_unused]] void* base, [[maybe_unused]] std::size_t size) {
+#ifdef MADV_HUGEPAGE
+    if (madvise(base, size, MADV_HUGEPAGE) != 0) {
+        LOG_WARNING(Common_Memory, "Unable to request transparent huge pages, errno={}", errno);
+    }
+#endif
+}
+
+static int CreateSharedMemory(std::size_t size) {
+#ifdef __linux__
+    const int fd = memfd_create("CitraHostMemory", MFD_CLOEXEC);
+#else
+    // Without memfd, a named object is created and unlinked right away
+    const std::string name = fmt::format("/citra-host-memory-{}", getpid());
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) {
+        shm_unlink(name.c_str());
+    }
+#endif
+    if (fd == -1) {
+        return -1;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+HostMemory::HostMemory(std::size_t size, bool shared, bool huge_pages) : size(size) {
+#ifndef _WIN32
+    if (shared && sysconf(_SC_PAGESIZE) == GUEST_PAGE_SIZE) {
+        fd = CreateSharedMemory(size);
+        if (fd != -1) {
+            void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (base != MAP_FAILED) {
+                pointer = static_cast<u8*>(base);
+                if (huge_pages) {
+                    AdviseHugePages(base, size);
+                }
+                return;
+            }
+            close(fd);
+            fd = -1;
+        }
+        LOG_WARNING(Common_Memory, "Unable to create shared host memory, errno={}", errno);
+    }
+#endif
+    if (huge_pages && AllocateHugePages()) {
+        return;
+    }
+    fallback = std::make_unique<u8[]>(size);
+    pointer = fallback.get();
+}
+
+HostMemory::~HostMemory() {
+#ifdef _WIN32
+    if (huge_page_size != 0) {
+        VirtualFree(pointer, 0, MEM_RELEASE);
+    }
+#else
+    if (fd != -1) {
+        munmap(pointer, size);
+        close(fd);
+    } else if (huge_page_size != 0) {
+        munmap(pointer, huge_page_size);
+    }
+#endif
+}
+
+bool HostMemory::AllocateHugePages() {
+#if defined(_WIN32)
+    static const bool privilege_enabled = EnableLockMemoryPrivilege();
+    const std::size_t large_page_size = GetLargePageMinimum();
+    if (!privilege_enabled || large_page_size == 0) {
+        LOG_WARNING(Common_Memory, "Large pages need the \"Lock pages in memory\" privilege");
+        return false;
+    }
+    const std::size_t rounded_size = Common::AlignUp(size, large_page_size);
+    // Large pages are always committed and zeroed
+    void* base = VirtualAlloc(nullptr, rounded_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                              PAGE_READWRITE);
+    if (base == nullptr) {
+        LOG_WARNING(Common_Memory, "Unable to allocate large pages, error={}", GetLastError());
+        return false;
+    }
+    pointer = static_cast<u8*>(base);
+    huge_page_size = rounded_size;
+    return true;
+#elif defined(__linux__)
+    const std::size_t rounded_size = Common::AlignUp(size, HUGE_PAGE_SIZE);
+    // Explicit huge pages are only available when the administrator reserved enough of them
+    void* base = mmap(nullptr, rounded_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base == MAP_FAILED) {
+        base = mmap(nullptr, rounded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                    0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        AdviseHugePages(base, rounded_size);
+    }
+    pointer = static_cast<u8*>(base);
+    huge_page_size = rounded_size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+FastmemArena::FastmemArena(const HostMemory& backing, std::size_t size)
+    : backing_fd(backing.fd), size(size) {
+#ifndef _WIN32
+    if (!backing.IsShared() || sizeof(void*) < 8) {
+        return;
+    }
+    void* base = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        LOG_WARNING(Common_Memory, "Unable to reserve the fastmem arena, errno={}", errno);
+        return;
+    }
+    pointer = static_cast<u8*>(base);
+#endif
+}
+
+FastmemArena::~FastmemArena() {
+#ifndef _WIN32
+    if (pointer != nullptr) {
+        munmap(pointer, size);
+    }
+#endif
+}
+
+void FastmemArena::Map(std::size_t offset, std::size_t backing_offset, std::size_t length) {
+#ifndef _WIN32
+    ASSERT(pointer != nullptr && offset + length <= size);
+    void* result = mmap(pointer + offset, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                        backing_fd, static_cast<off_t>(backing_offset));
+    ASSERT_MSG(result != MAP_FAILED, "Fastmem mapping failed, errno={}", errno);
+#endif
+}
+
+void FastmemArena::Unmap(std::size_t offset, std::size_t length) {
+#ifndef _WIN32
+    ASSERT(pointer != nullptr && offset + length <= size);
+    // Mapping inaccessible pages over the range keeps it reserved
+    void* result = mmap(pointer + offset, length, PROT_NONE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    ASSERT_MSG(result != MAP_FAILED, "Fastmem unmapping failed, errno={}", errno);
+#endif
+}
+
+} // namespace Common
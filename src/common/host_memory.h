@@ -0,0 +1,86 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * Zero initialized host memory. When shared, it is allocated from a shared memory object, so that
+ * its pages can be mapped a second time into a FastmemArena. Otherwise, or if the host lacks
+ * shared memory objects, it is a plain allocation.
+ *
+ * With huge_pages, the memory is backed by huge pages where the host allows it, to take fewer TLB
+ * misses. Shared memory only gets transparent huge pages, as the fastmem arenas map it page by
+ * page, the other allocations try explicit huge pages first.
+ */
+class HostMemory : NonCopyable {
+public:
+    HostMemory(std::size_t size, bool shared, bool huge_pages = false);
+    ~HostMemory();
+
+    u8* Pointer() const {
+        return pointer;
+    }
+
+    std::size_t Size() const {
+        return size;
+    }
+
+    /// Returns true if the memory can be mapped into a FastmemArena
+    bool IsShared() const {
+        return fd != -1;
+    }
+
+private:
+    friend class FastmemArena;
+
+    /// Allocates the memory from huge pages, returns false if the host refused
+    bool AllocateHugePages();
+
+    std::size_t size;
+    u8* pointer = nullptr;
+    int fd = -1;
+    /// Size of the huge page allocation, rounded up to whole huge pages, or 0 without one
+    std::size_t huge_page_size = 0;
+    std::unique_ptr<u8[]> fallback;
+};
+
+/**
+ * A reservation of host address space in which parts of a shared HostMemory are mapped at chosen
+ * offsets. Accesses to the parts that aren't mapped fault, which lets a JIT access guest memory
+ * with a single addition and fall back to its slow path for everything else.
+ */
+class FastmemArena : NonCopyable {
+public:
+    FastmemArena(const HostMemory& backing, std::size_t size);
+    ~FastmemArena();
+
+    /// Returns false if the address space couldn't be reserved or the host doesn't support it
+    bool IsValid() const {
+        return pointer != nullptr;
+    }
+
+    u8* Pointer() const {
+        return pointer;
+    }
+
+    /// Maps length bytes of the backing memory starting at backing_offset at the offset
+    void Map(std::size_t offset, std::size_t backing_offset, std::size_t length);
+
+    /// Makes accesses to length bytes at the offset fault again
+    void Unmap(std::size_t offset, std::size_t length);
+
+private:
+    int backing_fd;
+    std::size_t size;
+    u8* pointer = nullptr;
+};
+
+} // namespace Common
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -22,10 +23,16 @@
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
 #include "common/string_util.h"
-#include "common/threadsafe_queue.h"
+#include "common/thread.h"
 
 namespace Log {
 
+/// Number of entries the queue to the backend thread can hold
+constexpr std::size_t QueueSize = 4096;
+/// Messages per second of one class that are passed on, below Level::Error. The others are counted
+/// and reported when the next second starts, so that a spamming class can't stall the emulation.
+constexpr u32 MaxMessagesPerClassPerSecond = 1000;
+
 /**
  * Static state as a singleton.
  */
@@ -41,8 +48,28 @@ public:
 
     void PushEntry(Class log_class, Level log_level, const char* filename, unsigned int line_num,
                    const char* function, std::string message) {
-        message_queue.Push(
-            CreateEntry(log_class, log_level, filename, line_num, function, std::move(message)));
+        const auto timestamp = GetTimestamp();
+        if (!CheckRateLimit(log_class, log_level, timestamp)) {
+            return;
+        }
+        Enqueue(log_level, [&](QueuedEntry& entry) {
+            SetEntryHeader(entry, timestamp, log_class, log_level, filename, line_num, function);
+            entry.deferred.format_function = nullptr;
+            entry.message = std::move(message);
+        });
+    }
+
+    void PushDeferredEntry(Class log_class, Level log_level, const char* filename,
+                           unsigned int line_num, const char* function,
+                           const DeferredMessage& message) {
+        const auto timestamp = GetTimestamp();
+        if (!CheckRateLimit(log_class, log_level, timestamp)) {
+            return;
+        }
+        Enqueue(log_level, [&](QueuedEntry& entry) {
+            SetEntryHeader(entry, timestamp, log_class, log_level, filename, line_num, function);
+            entry.deferred = message;
+        });
     }
 
     void AddBackend(std::unique_ptr<Backend> backend) {
@@ -76,64 +103,231 @@ public:
     }
 
 private:
+    /// An entry of the queue. Its message is only formatted by the backend thread, unless
+    /// the arguments could not be deferred.
+    struct QueuedEntry {
+        /// Position in the queue the entry can be written or read at, see Enqueue
+        std::atomic_size_t sequence;
+        std::chrono::microseconds timestamp;
+        Class log_class;
+        Level log_level;
+        const char* filename;
+        unsigned int line_num;
+        const char* function;
+        DeferredMessage deferred;
+        /// The formatted message, used if deferred has no format function
+        std::string message;
+        bool final_entry;
+    };
+
+    struct ClassRateLimit {
+        std::atomic<s64> second{-1};
+        std::atomic<u32> count{0};
+        std::atomic<u32> suppressed{0};
+    };
+
     Impl() {
+        for (std::size_t i = 0; i < queue.size(); ++i) {
+            queue[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
         backend_thread = std::thread([&] {
-            Entry entry;
+            Common::SetCurrentThreadRole(Common::ThreadRole::Background);
             auto write_logs = [&](Entry& e) {
                 std::lock_guard lock{writing_mutex};
                 for (const auto& backend : backends) {
                     backend->Write(e);
                 }
             };
+            Entry entry;
             while (true) {
-                entry = message_queue.PopWait();
+                if (!Dequeue(entry)) {
+                    WaitForEntry();
+                    continue;
+                }
                 if (entry.final_entry) {
                     break;
                 }
                 write_logs(entry);
+
+                if (const u32 dropped = dropped_entries.exchange(0); dropped != 0) {
+                    Entry dropped_entry;
+                    dropped_entry.timestamp = GetTimestamp();
+                    dropped_entry.log_class = Class::Log;
+                    dropped_entry.log_level = Level::Warning;
+                    dropped_entry.filename = TrimSourcePath(__FILE__);
+                    dropped_entry.line_num = __LINE__;
+                    dropped_entry.function = "Enqueue";
+                    dropped_entry.message =
+                        fmt::format("{} messages were dropped, the log queue was full", dropped);
+                    write_logs(dropped_entry);
+                }
             }
 
             // Drain the logging queue. Only writes out up to MAX_LOGS_TO_WRITE to prevent a case
             // where a system is repeatedly spamming logs even on close.
             constexpr int MAX_LOGS_TO_WRITE = 100;
             int logs_written = 0;
-            while (logs_written++ < MAX_LOGS_TO_WRITE && message_queue.Pop(entry)) {
+            while (logs_written++ < MAX_LOGS_TO_WRITE && Dequeue(entry)) {
                 write_logs(entry);
             }
         });
     }
 
     ~Impl() {
-        Entry entry;
-        entry.final_entry = true;
-        message_queue.Push(entry);
+        Enqueue(Level::Critical, [](QueuedEntry& entry) { entry.final_entry = true; });
         backend_thread.join();
     }
 
-    Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
-                      const char* function, std::string message) const {
+    std::chrono::microseconds GetTimestamp() const {
         using std::chrono::duration_cast;
         using std::chrono::steady_clock;
+        return duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+    }
 
-        Entry entry;
-        entry.timestamp =
-            duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+    static void SetEntryHeader(QueuedEntry& entry, std::chrono::microseconds timestamp,
+                               Class log_class, Level log_level, const char* filename,
+                               unsigned int line_nr, const char* function) {
+        entry.timestamp = timestamp;
         entry.log_class = log_class;
         entry.log_level = log_level;
         entry.filename = filename;
         entry.line_num = line_nr;
         entry.function = function;
-        entry.message = std::move(message);
+        entry.final_entry = false;
+    }
+
+    /// Counts the message against the limit of its class, returns false if it is to be dropped
+    bool CheckRateLimit(Class log_class, Level log_level, std::chrono::microseconds timestamp) {
+        if (log_level >= Level::Error) {
+            return true;
+        }
+
+        ClassRateLimit& limit = class_rate_limits[static_cast<std::size_t>(log_class)];
+        const s64 second = timestamp.count() / 1000000;
+        s64 current_second = limit.second.load(std::memory_order_relaxed);
+        if (current_second != second &&
+            limit.second.compare_exchange_strong(current_second, second,
+                                                 std::memory_order_relaxed)) {
+            limit.count.store(0, std::memory_order_relaxed);
+            if (const u32 suppressed = limit.suppressed.exchange(0, std::memory_order_relaxed);
+                suppressed != 0) {
+                PushEntry(Class::Log, Level::Warning, TrimSourcePath(__FILE__), __LINE__, __func__,
+                          fmt::format("{} messages of class {} were suppressed", suppressed,
+                                      GetLogClassName(log_class)));
+            }
+        }
+        if (limit.count.fetch_add(1, std::memory_order_relaxed) < MaxMessagesPerClassPerSecond) {
+            return true;
+        }
+        limit.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
 
-        return entry;
+    /**
+     * Claims the next entry of the queue, fills it and hands it to the backend thread. Each entry
+     * has a sequence number telling whether it is free at the current position, see the bounded
+     * MPMC queue by Dmitry Vyukov. Messages below Level::Error are dropped when the queue is full,
+     * more important ones wait for space.
+     */
+    template <typename Fill>
+    void Enqueue(Level log_level, Fill&& fill) {
+        std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+        QueuedEntry* entry;
+        while (true) {
+            entry = &queue[position % queue.size()];
+            const std::size_t sequence = entry->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                if (log_level < Level::Error) {
+                    dropped_entries.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                std::this_thread::yield();
+                position = enqueue_position.load(std::memory_order_relaxed);
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        fill(*entry);
+        entry->sequence.store(position + 1, std::memory_order_release);
+
+        // Pairs with the fence in WaitForEntry, so that either the backend thread sees the entry
+        // or this thread sees it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (backend_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard lock{wait_mutex};
+            wait_cv.notify_one();
+        }
+    }
+
+    bool HasEntry() const {
+        const QueuedEntry& entry = queue[dequeue_position % queue.size()];
+        return entry.sequence.load(std::memory_order_acquire) == dequeue_position + 1;
+    }
+
+    /// Takes the next entry from the queue and formats its message, only for the backend thread
+    bool Dequeue(Entry& entry) {
+        if (!HasEntry()) {
+            return false;
+        }
+        QueuedEntry& queued = queue[dequeue_position % queue.size()];
+        entry.timestamp = queued.timestamp;
+        entry.log_class = queued.log_class;
+        entry.log_level = queued.log_level;
+        entry.filename = queued.filename;
+        entry.line_num = queued.line_num;
+        entry.final_entry = queued.final_entry;
+        if (!queued.final_entry) {
+            entry.function = queued.function;
+            if (queued.deferred.format_function == nullptr) {
+                entry.message = std::move(queued.message);
+            } else {
+                try {
+                    entry.message = queued.deferred.Format();
+                } catch (const fmt::format_error& error) {
+                    entry.message = fmt::format("Invalid log message \"{}\": {}",
+                                                queued.deferred.format, error.what());
+                }
+            }
+        }
+        queued.sequence.store(dequeue_position + queue.size(), std::memory_order_release);
+        ++dequeue_position;
+        return true;
+    }
+
+    void WaitForEntry() {
+        std::unique_lock lock{wait_mutex};
+        backend_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!HasEntry()) {
+            // The timeout only guards against bugs, the producers wake the thread up
+            wait_cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        backend_waiting.store(false, std::memory_order_relaxed);
     }
 
     std::mutex writing_mutex;
     std::thread backend_thread;
     std::vector<std::unique_ptr<Backend>> backends;
-    Common::MPSCQueue<Log::Entry> message_queue;
     Filter filter;
     std::chrono::steady_clock::time_point time_origin{std::chrono::steady_clock::now()};
+
+    std::array<QueuedEntry, QueueSize> queue;
+    std::atomic_size_t enqueue_position{0};
+    /// Only used by the backend thread
+    std::size_t dequeue_position = 0;
+    std::atomic<u32> dropped_entries{0};
+    std::array<ClassRateLimit, static_cast<std::size_t>(Class::Count)> class_rate_limits;
+
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+    std::atomic_bool backend_waiting{false};
 };
 
 void ConsoleBackend::Write(const Entry& entry) {
@@ -302,4 +496,14 @@ void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
     instance.PushEntry(log_class, log_level, filename, line_num, function,
                        fmt::vformat(format, args));
 }
+
+bool CheckLogFilter(Class log_class, Level log_level) {
+    return Impl::Instance().GetGlobalFilter().CheckMessage(log_class, log_level);
+}
+
+void DeferredLogMessageImpl(Class log_class, Level log_level, const char* filename,
+                            unsigned int line_num, const char* function,
+                            const DeferredMessage& message) {
+    Impl::Instance().PushDeferredEntry(log_class, log_level, filename, line_num, function, message);
+}
 } // namespace Log
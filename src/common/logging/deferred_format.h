@@ -0,0 +1,132 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <fmt/format.h>
+#include "common/common_types.h"
+
+namespace Log {
+
+namespace Detail {
+
+template <typename T>
+constexpr bool IsDeferredString =
+    std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string> ||
+    std::is_same_v<T, std::string_view>;
+
+/// Types that are copied as they are, their formatting doesn't depend on any other memory
+template <typename T>
+constexpr bool IsDeferredValue = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                 std::is_same_v<T, const void*> || std::is_same_v<T, void*>;
+
+/// Type an argument is formatted as on the backend thread
+template <typename T>
+using DeferredType = std::conditional_t<IsDeferredString<T>, std::string_view, T>;
+
+} // namespace Detail
+
+/**
+ * The arguments of a log message, copied so that the message can be formatted later on the
+ * backend thread. Only arguments whose formatting doesn't depend on memory they point to can be
+ * deferred, besides strings which are copied as a whole.
+ */
+struct DeferredMessage {
+    static constexpr std::size_t MaxPayloadSize = 192;
+
+    template <typename... Args>
+    static constexpr bool CanDefer =
+        ((Detail::IsDeferredString<std::decay_t<Args>> ||
+          Detail::IsDeferredValue<std::decay_t<Args>>)&&...);
+
+    using FormatFunction = std::string (*)(const char* format, const u8* payload);
+
+    const char* format = nullptr;
+    FormatFunction format_function = nullptr;
+    std::size_t size = 0;
+    std::array<u8, MaxPayloadSize> payload;
+
+    /**
+     * Copies the arguments of a message to be formatted later.
+     * @returns false if they don't fit, in which case the message needs to be formatted at once
+     */
+    template <typename... Args>
+    bool Store(const char* format_, const Args&... args) {
+        static_assert(CanDefer<Args...>);
+        format = format_;
+        format_function = &FormatPayload<std::decay_t<Args>...>;
+        size = 0;
+        return (StoreArg<std::decay_t<Args>>(args) && ...);
+    }
+
+    std::string Format() const {
+        return format_function(format, payload.data());
+    }
+
+private:
+    template <typename T, typename Arg>
+    bool StoreArg(const Arg& arg) {
+        if constexpr (Detail::IsDeferredString<T>) {
+            if constexpr (std::is_pointer_v<T>) {
+                // Formatting a null string fails, leave that to the immediate formatting
+                if (arg == nullptr) {
+                    return false;
+                }
+            }
+            const std::string_view string{arg};
+            const u32 length = static_cast<u32>(string.size());
+            if (MaxPayloadSize - size < sizeof(length) + string.size()) {
+                return false;
+            }
+            std::memcpy(payload.data() + size, &length, sizeof(length));
+            std::memcpy(payload.data() + size + sizeof(length), string.data(), string.size());
+            size += sizeof(length) + string.size();
+        } else {
+            const T value = arg;
+            if (MaxPayloadSize - size < sizeof(value)) {
+                return false;
+            }
+            std::memcpy(payload.data() + size, &value, sizeof(value));
+            size += sizeof(value);
+        }
+        return true;
+    }
+
+    template <typename T>
+    static Detail::DeferredType<T> LoadArg(const u8*& data) {
+        if constexpr (Detail::IsDeferredString<T>) {
+            u32 length;
+            std::memcpy(&length, data, sizeof(length));
+            const std::string_view string{reinterpret_cast<const char*>(data + sizeof(length)),
+                                          length};
+            data += sizeof(length) + length;
+            return string;
+        } else {
+            T value;
+            std::memcpy(&value, data, sizeof(value));
+            data += sizeof(value);
+            return value;
+        }
+    }
+
+    template <typename... Args>
+    static std::string FormatPayload(const char* format, const u8* payload) {
+        // Braced initialization loads the arguments in order
+        const std::tuple<Detail::DeferredType<Args>...> args{LoadArg<Args>(payload)...};
+        return std::apply(
+            [format](const auto&... loaded) {
+                return fmt::vformat(format, fmt::make_format_args(loaded...));
+            },
+            args);
+    }
+};
+
+} // namespace Log
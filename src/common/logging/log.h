@@ -6,6 +6,7 @@
 
 #include <fmt/format.h>
 #include "common/common_types.h"
+#include "common/logging/deferred_format.h"
 
 namespace Log {
 
@@ -118,9 +119,28 @@ void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
                        unsigned int line_num, const char* function, const char* format,
                        const fmt::format_args& args);
 
+/// Returns whether the global filter lets messages of the class and level through
+bool CheckLogFilter(Class log_class, Level log_level);
+
+/// Logs a message to the global logger, it is formatted on the backend thread. The global filter
+/// must have been checked already.
+void DeferredLogMessageImpl(Class log_class, Level log_level, const char* filename,
+                            unsigned int line_num, const char* function,
+                            const DeferredMessage& message);
+
 template <typename... Args>
 void FmtLogMessage(Class log_class, Level log_level, const char* filename, unsigned int line_num,
                    const char* function, const char* format, const Args&... args) {
+    if constexpr (DeferredMessage::CanDefer<Args...>) {
+        if (!CheckLogFilter(log_class, log_level)) {
+            return;
+        }
+        DeferredMessage message;
+        if (message.Store(format, args...)) {
+            DeferredLogMessageImpl(log_class, log_level, filename, line_num, function, message);
+            return;
+        }
+    }
     FmtLogMessageImpl(log_class, log_level, filename, line_num, function, format,
                       fmt::make_format_args(args...));
 }
@@ -0,0 +1,100 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include "common/metrics.h"
+
+namespace Common::Metrics {
+
+namespace {
+struct Registry {
+    std::mutex mutex;
+    std::vector<const Metric*> metrics;
+};
+
+/// Constructed on first use, as the metrics register during static initialization
+Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+} // Anonymous namespace
+
+Metric::Metric(const char* name, const char* help) : name(name), help(help) {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock{registry.mutex};
+    registry.metrics.push_back(this);
+}
+
+Metric::~Metric() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock{registry.mutex};
+    registry.metrics.erase(std::find(registry.metrics.begin(), registry.metrics.end(), this));
+}
+
+void Counter::WriteSamples(std::string& out) const {
+    out += fmt::format("{} {}\n", name, Get());
+}
+
+CounterVector::CounterVector(const char* name, const char* help, const char* label,
+                             std::vector<const char*> values, double unit)
+    : Metric(name, help), label(label), values(std::move(values)),
+      counts(std::make_unique<std::atomic<u64>[]>(this->values.size())), unit(unit) {}
+
+void CounterVector::WriteSamples(std::string& out) const {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const u64 count = Get(i);
+        if (count == 0) {
+            continue;
+        }
+        if (unit == 1.0) {
+            out += fmt::format("{}{{{}=\"{}\"}} {}\n", name, label, values[i], count);
+        } else {
+            out += fmt::format("{}{{{}=\"{}\"}} {}\n", name, label, values[i], count * unit);
+        }
+    }
+}
+
+void Gauge::WriteSamples(std::string& out) const {
+    out += fmt::format("{} {}\n", name, Get());
+}
+
+void Histogram::Observe(std::chrono::nanoseconds duration) {
+    const double milliseconds = duration.count() / 1e6;
+    const auto bound =
+        std::lower_bound(BucketBoundsMs.begin(), BucketBoundsMs.end(), milliseconds);
+    buckets[bound - BucketBoundsMs.begin()].fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(static_cast<u64>(std::max<s64>(duration.count(), 0)),
+                     std::memory_order_relaxed);
+}
+
+void Histogram::WriteSamples(std::string& out) const {
+    // The buckets of the format are cumulative
+    u64 count = 0;
+    for (std::size_t i = 0; i < NumBuckets; ++i) {
+        count += buckets[i].load(std::memory_order_relaxed);
+        out += fmt::format("{}_bucket{{le=\"{}\"}} {}\n", name, BucketBoundsMs[i] / 1000, count);
+    }
+    count += buckets[NumBuckets].load(std::memory_order_relaxed);
+    out += fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, count);
+    out += fmt::format("{}_sum {}\n", name, sum_ns.load(std::memory_order_relaxed) / 1e9);
+    out += fmt::format("{}_count {}\n", name, count);
+}
+
+std::string Serialize() {
+    Registry& registry = GetRegistry();
+    std::lock_guard lock{registry.mutex};
+    std::string out;
+    for (const Metric* metric : registry.metrics) {
+        out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", metric->name, metric->help,
+                           metric->name, metric->Type());
+        metric->WriteSamples(out);
+    }
+    return out;
+}
+
+} // namespace Common::Metrics
@@ -0,0 +1,149 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+
+/**
+ * Process-wide counters exported in the Prometheus text format. The metrics are defined as static
+ * objects next to the code updating them and register themselves on construction. Updating one
+ * only costs a relaxed atomic add.
+ */
+namespace Common::Metrics {
+
+class Metric {
+public:
+    /**
+     * @param name Name of the metric, following the Prometheus conventions
+     * @param help Description given to the scrapers, both strings must outlive the metric
+     */
+    Metric(const char* name, const char* help);
+    virtual ~Metric();
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    /// Appends the samples of the metric, without the HELP and TYPE lines
+    virtual void WriteSamples(std::string& out) const = 0;
+    virtual const char* Type() const = 0;
+
+    const char* name;
+    const char* help;
+};
+
+/// A count that only goes up
+class Counter final : public Metric {
+public:
+    using Metric::Metric;
+
+    void Add(u64 amount = 1) {
+        value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    u64 Get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void WriteSamples(std::string& out) const override;
+    const char* Type() const override {
+        return "counter";
+    }
+
+private:
+    std::atomic<u64> value{0};
+};
+
+/// Counters told apart by the value of a label, e.g. one per SVC. Counters that were never added to
+/// are left out of the samples.
+class CounterVector final : public Metric {
+public:
+    /**
+     * @param label Name of the label
+     * @param values Value of the label for each counter, the strings must outlive the metric
+     * @param unit Factor from the counted amounts to the exported values, e.g. 1e-9 to count
+     *             nanoseconds and export seconds
+     */
+    CounterVector(const char* name, const char* help, const char* label,
+                  std::vector<const char*> values, double unit = 1.0);
+
+    void Add(std::size_t index, u64 amount = 1) {
+        counts[index].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    u64 Get(std::size_t index) const {
+        return counts[index].load(std::memory_order_relaxed);
+    }
+
+    std::size_t Size() const {
+        return values.size();
+    }
+
+    void WriteSamples(std::string& out) const override;
+    const char* Type() const override {
+        return "counter";
+    }
+
+private:
+    const char* label;
+    std::vector<const char*> values;
+    std::unique_ptr<std::atomic<u64>[]> counts;
+    double unit;
+};
+
+/// A value that goes up and down
+class Gauge final : public Metric {
+public:
+    using Metric::Metric;
+
+    void Set(s64 new_value) {
+        value.store(new_value, std::memory_order_relaxed);
+    }
+
+    s64 Get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void WriteSamples(std::string& out) const override;
+    const char* Type() const override {
+        return "gauge";
+    }
+
+private:
+    std::atomic<s64> value{0};
+};
+
+/// Durations counted in buckets, with their upper bounds in milliseconds
+class Histogram final : public Metric {
+public:
+    static constexpr std::size_t NumBuckets = 8;
+    static constexpr std::array<double, NumBuckets> BucketBoundsMs{2, 4, 8, 16.7, 25, 34, 50, 100};
+
+    using Metric::Metric;
+
+    void Observe(std::chrono::nanoseconds duration);
+
+    void WriteSamples(std::string& out) const override;
+    const char* Type() const override {
+        return "histogram";
+    }
+
+private:
+    /// The count of each bucket only includes the observations above the previous bound, the
+    /// last one being the observations above all bounds
+    std::array<std::atomic<u64>, NumBuckets + 1> buckets{};
+    std::atomic<u64> sum_ns{0};
+};
+
+/// Returns all the metrics of the process in the Prometheus text exposition format
+std::string Serialize();
+
+} // namespace Common::Metrics
@@ -21,6 +21,34 @@ typedef void* HANDLE;
 #endif
 
 #include <microprofile.h>
+#include "common/tracing.h"
+
+// The timers are recorded by Common::Tracing as well, for the traces written from headless runs.
+#undef MICROPROFILE_DECLARE
+#undef MICROPROFILE_DEFINE
+#undef MICROPROFILE_SCOPE
+#define CITRA_TRACE_PASTE0(a, b) a##b
+#define CITRA_TRACE_PASTE(a, b) CITRA_TRACE_PASTE0(a, b)
+#define CITRA_TRACE_SCOPE(var)                                                                     \
+    Common::Tracing::Scope CITRA_TRACE_PASTE(trace_scope_, __LINE__)(g_trace_##var)
+
+#if MICROPROFILE_ENABLED
+#define MICROPROFILE_DECLARE(var)                                                                  \
+    extern MicroProfileToken g_mp_##var;                                                           \
+    extern Common::Tracing::Event g_trace_##var
+#define MICROPROFILE_DEFINE(var, group, name, color)                                               \
+    MicroProfileToken g_mp_##var =                                                                 \
+        MicroProfileGetToken(group, name, color, MicroProfileTokenTypeCpu);                        \
+    Common::Tracing::Event g_trace_##var{group, name}
+#define MICROPROFILE_SCOPE(var)                                                                    \
+    MicroProfileScopeHandler MICROPROFILE_TOKEN_PASTE(foo, __LINE__)(g_mp_##var);                  \
+    CITRA_TRACE_SCOPE(var)
+#else
+#define MICROPROFILE_DECLARE(var) extern Common::Tracing::Event g_trace_##var
+#define MICROPROFILE_DEFINE(var, group, name, color)                                               \
+    Common::Tracing::Event g_trace_##var{group, name}
+#define MICROPROFILE_SCOPE(var) CITRA_TRACE_SCOPE(var)
+#endif
 
 #define MP_RGB(r, g, b) ((r) << 16 | (g) << 8 | (b) << 0)
 
@@ -90,6 +90,19 @@ public:
         return out;
     }
 
+    /// Drops slots from the ring buffer without copying them
+    /// @param max_slots  Maximum number of slots to drop
+    /// @returns The number of slots actually dropped
+    std::size_t Discard(std::size_t max_slots) {
+        const std::size_t read_index = m_read_index.load();
+        const std::size_t slots_filled = m_write_index.load() - read_index;
+        const std::size_t discard_count = std::min(slots_filled, max_slots);
+
+        m_read_index.store(read_index + discard_count);
+
+        return discard_count;
+    }
+
     /// @returns Number of slots used
     std::size_t Size() const {
         return m_write_index.load() - m_read_index.load();
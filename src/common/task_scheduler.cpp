@@ -0,0 +1,187 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/task_scheduler.h"
+#include "common/thread.h"
+
+namespace Common {
+
+namespace {
+/// Scheduler the calling thread is a worker of and its index in it
+thread_local const TaskScheduler* current_scheduler = nullptr;
+thread_local std::size_t current_worker = 0;
+} // Anonymous namespace
+
+TaskScheduler::TaskScheduler(std::size_t num_workers, std::string name) : name(std::move(name)) {
+    queues.reserve(num_workers + 1);
+    for (std::size_t i = 0; i < num_workers + 1; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    workers.reserve(num_workers);
+    for (std::size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard lock{sleep_mutex};
+        stop = true;
+    }
+    worker_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+TaskScheduler& TaskScheduler::GetInstance() {
+    static TaskScheduler scheduler(std::max(std::thread::hardware_concurrency(), 2u) - 1,
+                                   "TaskWorker");
+    return scheduler;
+}
+
+void TaskScheduler::Spawn(TaskGroup& group, std::function<void()> task, Priority priority) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    // The counters change with the queue locked, so that they can't drop below zero when another
+    // thread takes the task right away
+    group.pending.fetch_add(1);
+    {
+        TaskQueue& queue = *queues[CurrentQueue()];
+        std::lock_guard lock{queue.mutex};
+        queue.tasks[static_cast<std::size_t>(priority)].push_back({std::move(task), &group});
+        group.queued.fetch_add(1);
+        queued.fetch_add(1);
+    }
+
+    // Taking the lock orders the wakeup after a sleeping thread last checked for tasks
+    bool has_waiting;
+    {
+        std::lock_guard lock{sleep_mutex};
+        has_waiting = num_waiting != 0;
+    }
+    worker_cv.notify_one();
+    if (has_waiting) {
+        wait_cv.notify_all();
+    }
+}
+
+void TaskScheduler::Wait(TaskGroup& group) {
+    const std::size_t queue_index = CurrentQueue();
+    while (group.pending.load() != 0) {
+        Task task;
+        if (TakeTask(queue_index, &group, task)) {
+            RunTask(task);
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex};
+        ++num_waiting;
+        wait_cv.wait(lock, [&group] { return group.pending == 0 || group.queued != 0; });
+        --num_waiting;
+    }
+}
+
+void TaskScheduler::ParallelFor(std::size_t count, std::size_t min_chunk_size,
+                                const std::function<void(std::size_t, std::size_t)>& func,
+                                Priority priority) {
+    if (count == 0) {
+        return;
+    }
+
+    const std::size_t max_chunks = workers.size() + 1;
+    const std::size_t num_chunks =
+        std::clamp<std::size_t>(count / std::max<std::size_t>(min_chunk_size, 1), 1, max_chunks);
+    const std::size_t chunk_size = (count + num_chunks - 1) / num_chunks;
+
+    // The calling thread takes the first chunk itself, then helps with what is left
+    TaskGroup group;
+    for (std::size_t begin = chunk_size; begin < count; begin += chunk_size) {
+        const std::size_t end = std::min(begin + chunk_size, count);
+        Spawn(group, [&func, begin, end] { func(begin, end); }, priority);
+    }
+    func(0, std::min(chunk_size, count));
+    Wait(group);
+}
+
+std::size_t TaskScheduler::CurrentQueue() const {
+    // The workers start before the others are created, so they go by the queues, built by then
+    return current_scheduler == this ? current_worker : queues.size() - 1;
+}
+
+bool TaskScheduler::TakeTask(std::size_t queue_index, const TaskGroup* group, Task& task) {
+    const bool is_worker = queue_index < queues.size() - 1;
+    for (std::size_t priority = 0; priority < NumPriorities; ++priority) {
+        // The own queue comes first, then the threads steal from the others in turn
+        for (std::size_t i = 0; i < queues.size(); ++i) {
+            const std::size_t index = (queue_index + i) % queues.size();
+            TaskQueue& queue = *queues[index];
+            std::lock_guard lock{queue.mutex};
+            auto& tasks = queue.tasks[priority];
+            if (tasks.empty()) {
+                continue;
+            }
+
+            auto iter = tasks.end();
+            if (group != nullptr) {
+                iter = std::find_if(tasks.begin(), tasks.end(),
+                                    [group](const Task& queued) { return queued.group == group; });
+            } else if (i == 0 && is_worker) {
+                // Workers run their latest task first, as its data is the most likely to be cached
+                iter = std::prev(tasks.end());
+            } else {
+                iter = tasks.begin();
+            }
+            if (iter == tasks.end()) {
+                continue;
+            }
+
+            task = std::move(*iter);
+            tasks.erase(iter);
+            task.group->queued.fetch_sub(1);
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::RunTask(Task& task) {
+    task.function();
+
+    // The group may be gone as soon as its last task finishes, so it isn't touched after that
+    if (task.group->pending.fetch_sub(1) == 1) {
+        {
+            std::lock_guard lock{sleep_mutex};
+        }
+        wait_cv.notify_all();
+    }
+}
+
+void TaskScheduler::WorkerLoop(std::size_t index) {
+    SetCurrentThreadName(name.c_str());
+    SetCurrentThreadRole(ThreadRole::Emulation);
+    current_scheduler = this;
+    current_worker = index;
+
+    while (true) {
+        Task task;
+        if (TakeTask(index, nullptr, task)) {
+            RunTask(task);
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex};
+        worker_cv.wait(lock, [this] { return stop || queued != 0; });
+        if (stop && queued == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,140 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+/**
+ * A fixed set of worker threads shared by the subsystems that split their work into short,
+ * CPU-bound tasks, so that they don't each spawn threads for all the cores. Every worker keeps its
+ * own queues of tasks, running the ones it spawned last first and taking the oldest ones of the
+ * other workers when it runs out. A thread waiting for a group of tasks runs the ones still queued
+ * in the meantime, so tasks may spawn others and wait for them.
+ */
+class TaskScheduler {
+public:
+    /// Tasks of a higher priority are run before any of a lower one waiting to be run
+    enum class Priority {
+        High,
+        Normal,
+        Low,
+    };
+
+    /// A set of tasks that can be waited for together, it must be waited for before its end
+    class TaskGroup {
+    public:
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+    private:
+        friend class TaskScheduler;
+
+        /// Tasks spawned that haven't finished yet
+        std::atomic<std::size_t> pending{0};
+        /// Tasks spawned that haven't started yet
+        std::atomic<std::size_t> queued{0};
+    };
+
+    /**
+     * Creates a scheduler with the given number of workers.
+     * @param num_workers Number of threads to spawn. A scheduler with zero workers runs every task
+     *                    on the thread spawning it.
+     * @param name Debugger-visible name given to the worker threads.
+     */
+    explicit TaskScheduler(std::size_t num_workers, std::string name = "TaskScheduler");
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /// Returns the scheduler shared by the whole emulator, with a worker for every other core
+    static TaskScheduler& GetInstance();
+
+    /// Returns the number of worker threads owned by this scheduler
+    std::size_t NumWorkers() const {
+        return workers.size();
+    }
+
+    /// Queues a task as part of the group
+    void Spawn(TaskGroup& group, std::function<void()> task, Priority priority = Priority::Normal);
+
+    /**
+     * Runs the queued tasks of the group until every task spawned in it so far has finished. Tasks
+     * of other groups are left to the workers, so that a wait doesn't get stuck behind longer
+     * tasks of a lower priority.
+     */
+    void Wait(TaskGroup& group);
+
+    /**
+     * Splits the range [0, count) into contiguous chunks and runs func(begin, end) for each of
+     * them, using the calling thread as an additional worker. Returns once all chunks are done.
+     * @param count Total number of items
+     * @param min_chunk_size Smallest number of items worth handing to a separate thread
+     * @param func Callable invoked as func(std::size_t begin, std::size_t end)
+     * @param priority Priority of the chunks run by the workers
+     */
+    void ParallelFor(std::size_t count, std::size_t min_chunk_size,
+                     const std::function<void(std::size_t, std::size_t)>& func,
+                     Priority priority = Priority::Normal);
+
+private:
+    static constexpr std::size_t NumPriorities = 3;
+
+    struct Task {
+        std::function<void()> function;
+        TaskGroup* group;
+    };
+
+    /// Tasks waiting to be run, one queue per priority
+    struct TaskQueue {
+        std::mutex mutex;
+        std::array<std::deque<Task>, NumPriorities> tasks;
+    };
+
+    /// Index of the queue of the calling thread, the one of the non-worker threads if it isn't one
+    std::size_t CurrentQueue() const;
+
+    /**
+     * Takes the next task the thread owning the queue should run, from the highest priority down.
+     * @param group Group the task must belong to, any group if null
+     * @returns false if there is no such task
+     */
+    bool TakeTask(std::size_t queue_index, const TaskGroup* group, Task& task);
+
+    void RunTask(Task& task);
+    void WorkerLoop(std::size_t index);
+
+    /// The queues of the workers followed by the one the other threads spawn their tasks into
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    /// Number of tasks in all the queues
+    std::atomic<std::size_t> queued{0};
+
+    /// Taken by the threads going to sleep and by the ones waking them up
+    std::mutex sleep_mutex;
+    /// Idle workers wait on it for new tasks
+    std::condition_variable worker_cv;
+    /// Threads in Wait wait on it for new tasks of their group or the end of its tasks
+    std::condition_variable wait_cv;
+    std::size_t num_waiting = 0;
+    bool stop = false;
+    std::string name;
+};
+
+} // namespace Common
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "common/thread.h"
+#include "common/tracing.h"
 #ifdef __APPLE__
 #include <mach/mach.h>
 #elif defined(_WIN32)
@@ -18,6 +19,17 @@
 #ifndef _WIN32
 #include <unistd.h>
 #endif
+#ifdef __APPLE__
+#include <pthread.h>
+#include <pthread/qos.h>
+#elif defined(__linux__)
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef __FreeBSD__
 #define cpu_set_t cpuset_t
@@ -31,6 +43,8 @@ namespace Common {
 // Uses trick documented in:
 // https://docs.microsoft.com/en-us/visualstudio/debugger/how-to-set-a-thread-name-in-native-code
 void SetCurrentThreadName(const char* name) {
+    Tracing::SetThreadName(name);
+
     static const DWORD MS_VC_EXCEPTION = 0x406D1388;
 
 #pragma pack(push, 8)
@@ -58,6 +72,8 @@ void SetCurrentThreadName(const char* name) {
 // MinGW with the POSIX threading model does not support pthread_setname_np
 #if !defined(_WIN32) || defined(_MSC_VER)
 void SetCurrentThreadName(const char* name) {
+    Tracing::SetThreadName(name);
+
 #ifdef __APPLE__
     pthread_setname_np(name);
 #elif defined(__Bitrig__) || defined(__DragonFly__) || defined(__FreeBSD__) || defined(__OpenBSD__)
@@ -72,4 +88,114 @@ void SetCurrentThreadName(const char* name) {
 
 #endif
 
+static std::atomic_bool thread_roles_enabled{false};
+
+void SetThreadRolesEnabled(bool enabled) {
+    thread_roles_enabled = enabled;
+}
+
+#ifdef __linux__
+/**
+ * Returns the cores with the highest capacity, or the highest maximum frequency when the kernel
+ * doesn't report capacities. Empty if all the cores are alike or the values are missing.
+ */
+static std::vector<int> GetPerformanceCores() {
+    const int num_cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+    for (const char* attribute : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+        std::vector<unsigned long> values;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/" +
+                               attribute);
+            unsigned long value = 0;
+            if (!(file >> value)) {
+                break;
+            }
+            values.push_back(value);
+        }
+        if (values.empty() || values.size() != static_cast<std::size_t>(num_cpus)) {
+            continue;
+        }
+
+        const unsigned long max_value = *std::max_element(values.begin(), values.end());
+        std::vector<int> cores;
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            if (values[cpu] == max_value) {
+                cores.push_back(cpu);
+            }
+        }
+        if (cores.size() == values.size()) {
+            return {};
+        }
+        return cores;
+    }
+    return {};
+}
+#endif
+
+void SetCurrentThreadRole(ThreadRole role) {
+    if (!thread_roles_enabled) {
+        return;
+    }
+
+#ifdef _WIN32
+    // MMCSS raises the priority of the threads of its tasks while keeping them from starving the
+    // system, it is loaded at runtime as avrt.dll isn't linked
+    using AvSetMmThreadCharacteristicsWFunc = HANDLE(WINAPI*)(LPCWSTR, LPDWORD);
+    static const auto av_set_mm_thread_characteristics = [] {
+        const HMODULE avrt = LoadLibraryW(L"avrt.dll");
+        return avrt == nullptr ? nullptr
+                               : reinterpret_cast<AvSetMmThreadCharacteristicsWFunc>(
+                                     GetProcAddress(avrt, "AvSetMmThreadCharacteristicsW"));
+    }();
+
+    const wchar_t* task = role == ThreadRole::Audio
+                              ? L"Pro Audio"
+                              : role == ThreadRole::Background ? nullptr : L"Games";
+    DWORD task_index = 0;
+    if (task != nullptr && av_set_mm_thread_characteristics != nullptr &&
+        av_set_mm_thread_characteristics(task, &task_index) != nullptr) {
+        return;
+    }
+    const int priority = role == ThreadRole::Audio
+                             ? THREAD_PRIORITY_TIME_CRITICAL
+                             : role == ThreadRole::Background ? THREAD_PRIORITY_BELOW_NORMAL
+                                                              : THREAD_PRIORITY_ABOVE_NORMAL;
+    SetThreadPriority(GetCurrentThread(), priority);
+#elif defined(__APPLE__)
+    // The real-time audio threads belong to Core Audio, a QoS class would only demote them.
+    // The classes also steer the threads between the performance and the efficiency cores.
+    if (role == ThreadRole::Audio) {
+        return;
+    }
+    pthread_set_qos_class_self_np(role == ThreadRole::Background ? QOS_CLASS_UTILITY
+                                                                 : QOS_CLASS_USER_INTERACTIVE,
+                                  0);
+#elif defined(__linux__)
+    const auto thread_id = static_cast<id_t>(syscall(SYS_gettid));
+    if (role == ThreadRole::Background) {
+        setpriority(PRIO_PROCESS, thread_id, 5);
+        return;
+    }
+
+    static const std::vector<int> performance_cores = GetPerformanceCores();
+    if (!performance_cores.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (const int cpu : performance_cores) {
+            CPU_SET(cpu, &cpu_set);
+        }
+        sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+    }
+
+    if (role == ThreadRole::Audio) {
+        sched_param param{};
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+            return;
+        }
+    }
+    setpriority(PRIO_PROCESS, thread_id, role == ThreadRole::Audio ? -10 : -5);
+#endif
+}
+
 } // namespace Common
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
@@ -72,10 +73,21 @@ public:
             generation++;
             waiting = 0;
             condvar.notify_all();
-        } else {
-            condvar.wait(lk,
-                         [this, current_generation] { return current_generation != generation; });
+            return;
         }
+
+        // Threads synchronizing in lockstep usually arrive shortly after each other, so poll for a
+        // little while before paying for a sleep and a wakeup.
+        lk.unlock();
+        for (std::size_t i = 0; i < spin_count; i++) {
+            if (generation.load(std::memory_order_acquire) != current_generation) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        lk.lock();
+
+        condvar.wait(lk, [this, current_generation] { return current_generation != generation; });
     }
 
     std::size_t Generation() const {
@@ -84,13 +96,40 @@ public:
     }
 
 private:
+    /// Number of times a waiting thread polls the generation before it sleeps
+    static constexpr std::size_t spin_count = 256;
+
     std::condition_variable condvar;
     mutable std::mutex mutex;
     std::size_t count;
     std::size_t waiting = 0;
-    std::size_t generation = 0; // Incremented once each time the barrier is used
+    std::atomic<std::size_t> generation = 0; // Incremented once each time the barrier is used
 };
 
 void SetCurrentThreadName(const char* name);
 
+/// What a thread does, which decides how the host schedules it
+enum class ThreadRole {
+    /// Emulates the CPU, the DSP or the PICA, the frame waits for it
+    Emulation,
+    /// Submits the GL commands or presents the frames
+    Render,
+    /// Fills the audio output, which crackles when it is late
+    Audio,
+    /// Work nothing waits for, like logging, compression or shader builds
+    Background,
+};
+
+/// Enables SetCurrentThreadRole, which does nothing while disabled
+void SetThreadRolesEnabled(bool enabled);
+
+/**
+ * Schedules the calling thread for its role, if enabled. The emulation, render and audio threads
+ * get a higher priority and, on hosts with performance and efficiency cores, the performance cores.
+ * On Windows they join the "Games" and "Pro Audio" MMCSS tasks. Background threads get a lower
+ * priority. What the host doesn't allow, like raising the priority without the privilege, is left
+ * as it is.
+ */
+void SetCurrentThreadRole(ThreadRole role);
+
 } // namespace Common
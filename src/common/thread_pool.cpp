@@ -0,0 +1,96 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(std::size_t num_workers, std::string name, ThreadRole role)
+    : name(std::move(name)), role(role) {
+    workers.reserve(num_workers);
+    for (std::size_t i = 0; i < num_workers; ++i) {
+        workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{mutex};
+        stop = true;
+    }
+    task_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Push(std::function<void()> task) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard lock{mutex};
+        tasks.push(std::move(task));
+        ++pending;
+    }
+    task_cv.notify_one();
+}
+
+void ThreadPool::WaitForAll() {
+    std::unique_lock lock{mutex};
+    done_cv.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t min_chunk_size,
+                             const std::function<void(std::size_t, std::size_t)>& func) {
+    if (count == 0) {
+        return;
+    }
+
+    const std::size_t max_chunks = workers.size() + 1;
+    const std::size_t num_chunks =
+        std::clamp<std::size_t>(count / std::max<std::size_t>(min_chunk_size, 1), 1, max_chunks);
+    const std::size_t chunk_size = (count + num_chunks - 1) / num_chunks;
+
+    // The calling thread takes the first chunk itself instead of idling in WaitForAll
+    for (std::size_t begin = chunk_size; begin < count; begin += chunk_size) {
+        const std::size_t end = std::min(begin + chunk_size, count);
+        Push([&func, begin, end] { func(begin, end); });
+    }
+    func(0, std::min(chunk_size, count));
+    WaitForAll();
+}
+
+void ThreadPool::WorkerLoop() {
+    SetCurrentThreadName(name.c_str());
+    SetCurrentThreadRole(role);
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{mutex};
+            task_cv.wait(lock, [this] { return stop || !tasks.empty(); });
+            if (stop && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+
+        {
+            std::lock_guard lock{mutex};
+            if (--pending == 0) {
+                done_cv.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace Common
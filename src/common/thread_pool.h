@@ -0,0 +1,76 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/thread.h"
+
+namespace Common {
+
+/**
+ * A fixed set of worker threads executing fork-join style work. Tasks are pushed into a shared
+ * FIFO and picked up by whichever worker becomes free first. The pool is intended for short,
+ * CPU-bound jobs (e.g. shading a batch of vertices) where the caller waits for the results.
+ */
+class ThreadPool {
+public:
+    /**
+     * Creates a pool with the given number of workers.
+     * @param num_workers Number of threads to spawn. A pool with zero workers runs every task on
+     *                    the calling thread.
+     * @param name Debugger-visible name given to the worker threads.
+     * @param role Role the workers are scheduled for, background pools nothing waits on should
+     *             say so.
+     */
+    explicit ThreadPool(std::size_t num_workers, std::string name = "ThreadPool",
+                        ThreadRole role = ThreadRole::Emulation);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Returns the number of worker threads owned by this pool
+    std::size_t NumWorkers() const {
+        return workers.size();
+    }
+
+    /// Queues a task for execution on one of the workers
+    void Push(std::function<void()> task);
+
+    /// Blocks until every task pushed so far has finished executing
+    void WaitForAll();
+
+    /**
+     * Splits the range [0, count) into contiguous chunks and runs func(begin, end) for each of
+     * them, using the calling thread as an additional worker. Returns once all chunks are done.
+     * @param count Total number of items
+     * @param min_chunk_size Smallest number of items worth handing to a separate thread
+     * @param func Callable invoked as func(std::size_t begin, std::size_t end)
+     */
+    void ParallelFor(std::size_t count, std::size_t min_chunk_size,
+                     const std::function<void(std::size_t, std::size_t)>& func);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_cv;
+    std::condition_variable done_cv;
+    std::size_t pending = 0;
+    bool stop = false;
+    std::string name;
+    ThreadRole role;
+};
+
+} // namespace Common
@@ -9,6 +9,7 @@
 #include <deque>
 #include <boost/serialization/deque.hpp>
 #include <boost/serialization/split_member.hpp>
+#include "common/bit_set.h"
 #include "common/common_types.h"
 
 namespace Common {
@@ -23,10 +24,7 @@ struct ThreadQueueList {
 
     // Number of priority levels. (Valid levels are [0..NUM_QUEUES).)
     static const Priority NUM_QUEUES = N;
-
-    ThreadQueueList() {
-        first = nullptr;
-    }
+    static_assert(NUM_QUEUES <= 64, "The non-empty levels must fit in the bitmap");
 
     // Only for debugging, returns priority level.
     Priority contains(const T& uid) {
@@ -41,59 +39,41 @@ struct ThreadQueueList {
     }
 
     T get_first() {
-        Queue* cur = first;
-        while (cur != nullptr) {
-            if (!cur->data.empty()) {
-                return cur->data.front();
-            }
-            cur = cur->next_nonempty;
+        if (nonempty == 0) {
+            return T();
         }
-
-        return T();
+        return queues[LeastSignificantSetBit(nonempty)].data.front();
     }
 
     T pop_first() {
-        Queue* cur = first;
-        while (cur != nullptr) {
-            if (!cur->data.empty()) {
-                auto tmp = std::move(cur->data.front());
-                cur->data.pop_front();
-                return tmp;
-            }
-            cur = cur->next_nonempty;
+        if (nonempty == 0) {
+            return T();
         }
-
-        return T();
+        return pop_front(LeastSignificantSetBit(nonempty));
     }
 
     T pop_first_better(Priority priority) {
-        Queue* cur = first;
-        Queue* stop = &queues[priority];
-        while (cur < stop) {
-            if (!cur->data.empty()) {
-                auto tmp = std::move(cur->data.front());
-                cur->data.pop_front();
-                return tmp;
-            }
-            cur = cur->next_nonempty;
+        const u64 better = nonempty & ((u64{1} << priority) - 1);
+        if (better == 0) {
+            return T();
         }
-
-        return T();
+        return pop_front(LeastSignificantSetBit(better));
     }
 
     void push_front(Priority priority, const T& thread_id) {
         Queue* cur = &queues[priority];
         cur->data.push_front(thread_id);
+        nonempty |= u64{1} << priority;
     }
 
     void push_back(Priority priority, const T& thread_id) {
         Queue* cur = &queues[priority];
         cur->data.push_back(thread_id);
+        nonempty |= u64{1} << priority;
     }
 
     void move(const T& thread_id, Priority old_priority, Priority new_priority) {
         remove(old_priority, thread_id);
-        prepare(new_priority);
         push_back(new_priority, thread_id);
     }
 
@@ -101,6 +81,7 @@ struct ThreadQueueList {
         Queue* const cur = &queues[priority];
         const auto iter = std::remove(cur->data.begin(), cur->data.end(), thread_id);
         cur->data.erase(iter, cur->data.end());
+        update_nonempty(priority);
     }
 
     void rotate(Priority priority) {
@@ -114,7 +95,7 @@ struct ThreadQueueList {
 
     void clear() {
         queues.fill(Queue());
-        first = nullptr;
+        nonempty = 0;
     }
 
     bool empty(Priority priority) const {
@@ -122,86 +103,61 @@ struct ThreadQueueList {
         return cur->data.empty();
     }
 
-    void prepare(Priority priority) {
-        Queue* cur = &queues[priority];
-        if (cur->next_nonempty == UnlinkedTag())
-            link(priority);
-    }
-
 private:
     struct Queue {
-        // Points to the next active priority, skipping over ones that have never been used.
-        Queue* next_nonempty = UnlinkedTag();
         // Double-ended queue of threads in this priority level
         std::deque<T> data;
     };
 
-    /// Special tag used to mark priority levels that have never been used.
-    static Queue* UnlinkedTag() {
-        return reinterpret_cast<Queue*>(1);
-    }
-
-    void link(Priority priority) {
+    T pop_front(Priority priority) {
         Queue* cur = &queues[priority];
-
-        for (int i = priority - 1; i >= 0; --i) {
-            if (queues[i].next_nonempty != UnlinkedTag()) {
-                cur->next_nonempty = queues[i].next_nonempty;
-                queues[i].next_nonempty = cur;
-                return;
-            }
-        }
-
-        cur->next_nonempty = first;
-        first = cur;
+        auto tmp = std::move(cur->data.front());
+        cur->data.pop_front();
+        update_nonempty(priority);
+        return tmp;
     }
 
-    // The first queue that's ever been used.
-    Queue* first;
-    // The priority level queues of thread ids.
-    std::array<Queue, NUM_QUEUES> queues;
-
-    s64 ToIndex(const Queue* q) const {
-        if (q == nullptr) {
-            return -2;
-        } else if (q == UnlinkedTag()) {
-            return -1;
+    void update_nonempty(Priority priority) {
+        if (queues[priority].data.empty()) {
+            nonempty &= ~(u64{1} << priority);
         } else {
-            return q - queues.data();
+            nonempty |= u64{1} << priority;
         }
     }
 
-    Queue* ToPointer(s64 idx) {
-        if (idx == -1) {
-            return UnlinkedTag();
-        } else if (idx < 0) {
-            return nullptr;
-        } else {
-            return &queues[idx];
-        }
-    }
+    // Bit i is set when the level i holds threads, the first thread to run is in the lowest one.
+    u64 nonempty = 0;
+    // The priority level queues of thread ids.
+    std::array<Queue, NUM_QUEUES> queues;
 
     friend class boost::serialization::access;
     template <class Archive>
     void save(Archive& ar, const unsigned int file_version) const {
-        const s64 idx = ToIndex(first);
-        ar << idx;
+        // Written as the list of used levels the queues used to keep, the non-empty levels are
+        // linked in order and the others are marked unused
+        const auto next_nonempty = [this](std::size_t i) -> s64 {
+            const u64 next = i + 1 < 64 ? nonempty & (~u64{0} << (i + 1)) : 0;
+            return next == 0 ? -2 : LeastSignificantSetBit(next);
+        };
+        const s64 first = nonempty == 0 ? -2 : LeastSignificantSetBit(nonempty);
+        ar << first;
         for (std::size_t i = 0; i < NUM_QUEUES; i++) {
-            const s64 idx1 = ToIndex(queues[i].next_nonempty);
-            ar << idx1;
+            const s64 idx = queues[i].data.empty() ? -1 : next_nonempty(i);
+            ar << idx;
             ar << queues[i].data;
         }
     }
 
     template <class Archive>
     void load(Archive& ar, const unsigned int file_version) {
+        // The links between the levels are rebuilt from their contents
         s64 idx;
         ar >> idx;
-        first = ToPointer(idx);
+        nonempty = 0;
         for (std::size_t i = 0; i < NUM_QUEUES; i++) {
             ar >> idx;
-            queues[i].next_nonempty = ToPointer(idx);
             ar >> queues[i].data;
+            update_nonempty(static_cast<Priority>(i));
         }
     }
 
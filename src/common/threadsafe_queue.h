@@ -7,10 +7,14 @@
 // a simple lockless thread-safe,
 // single reader, single writer queue
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <mutex>
+#include <new>
+#include <thread>
 #include <utility>
 
 namespace Common {
@@ -169,4 +173,140 @@ private:
     SPSCQueue<T> spsc_queue;
     std::mutex write_lock;
 };
+
+/**
+ * A bounded, lock-free queue with multiple writers and a single reader. The elements live in a
+ * ring allocated with the queue, so pushing never allocates, and each slot has a sequence number
+ * telling whether it is free at the current position, see the bounded MPMC queue by Dmitry Vyukov.
+ * The reader takes all the elements there are at once, and only has to be woken up when it waits
+ * on an empty queue.
+ */
+template <typename T, std::size_t Capacity>
+class BoundedMPSCQueue {
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    BoundedMPSCQueue() {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+    BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+    /// Pushes the element unless the queue is full, returns whether it did
+    template <typename Arg>
+    bool TryPush(Arg&& t) {
+        std::size_t position = write_position.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & (Capacity - 1)];
+            const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if (difference == 0) {
+                if (write_position.compare_exchange_weak(position, position + 1,
+                                                         std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = write_position.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::forward<Arg>(t);
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        // Pairs with the fence in PopAllWait, so that either the reader sees the element or this
+        // thread sees it waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (reader_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard lock{wait_mutex};
+            wait_cv.notify_one();
+        }
+        return true;
+    }
+
+    /// Pushes the element, waiting for the reader to make space if the queue is full
+    template <typename Arg>
+    void Push(Arg&& t) {
+        while (!TryPush(std::forward<Arg>(t))) {
+            std::this_thread::yield();
+        }
+    }
+
+    /// Only for the reader
+    bool Empty() const {
+        const Slot& slot = slots[read_position & (Capacity - 1)];
+        return slot.sequence.load(std::memory_order_acquire) != read_position + 1;
+    }
+
+    /// Takes the next element, only for the reader
+    bool Pop(T& t) {
+        if (Empty()) {
+            return false;
+        }
+        Slot& slot = slots[read_position & (Capacity - 1)];
+        t = std::move(slot.value);
+        slot.sequence.store(read_position + Capacity, std::memory_order_release);
+        ++read_position;
+        return true;
+    }
+
+    /**
+     * Passes all the elements in the queue to func, in order, only for the reader.
+     * @returns the number of elements taken.
+     */
+    template <typename Func>
+    std::size_t PopAll(Func&& func) {
+        std::size_t count = 0;
+        for (T t; Pop(t); ++count) {
+            func(std::move(t));
+        }
+        return count;
+    }
+
+    /// Like PopAll, waiting up to timeout for an element if the queue is empty
+    template <typename Func, typename Rep, typename Period>
+    std::size_t PopAllWait(Func&& func, std::chrono::duration<Rep, Period> timeout) {
+        if (Empty()) {
+            std::unique_lock lock{wait_mutex};
+            reader_waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (Empty()) {
+                wait_cv.wait_for(lock, timeout);
+            }
+            reader_waiting.store(false, std::memory_order_relaxed);
+        }
+        return PopAll(std::forward<Func>(func));
+    }
+
+private:
+    // The positions are each on a cache line of their own, so that the writers claiming slots and
+    // the reader freeing them don't invalidate each other's line.
+    // TODO: Remove this ifdef whenever clang and GCC support
+    //       std::hardware_destructive_interference_size.
+#if defined(_MSC_VER) && _MSC_VER >= 1911
+    static constexpr std::size_t cache_line_size = std::hardware_destructive_interference_size;
+#else
+    static constexpr std::size_t cache_line_size = 128;
+#endif
+
+    struct Slot {
+        std::atomic_size_t sequence;
+        T value;
+    };
+
+    alignas(cache_line_size) std::atomic_size_t write_position{0};
+    /// Only accessed by the reader
+    alignas(cache_line_size) std::size_t read_position = 0;
+    /// Read by the writers at every push, and only written when the reader waits
+    alignas(cache_line_size) std::atomic_bool reader_waiting{false};
+    alignas(cache_line_size) std::array<Slot, Capacity> slots;
+
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+};
 } // namespace Common
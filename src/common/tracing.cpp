@@ -0,0 +1,186 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <fmt/format.h>
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/tracing.h"
+
+namespace Common::Tracing {
+
+namespace {
+
+/// Number of events a thread collects before writing them to the trace file
+constexpr std::size_t ThreadBufferSize = 4096;
+
+struct RecordedEvent {
+    const char* group;
+    const char* name;
+    Clock::time_point begin;
+    Clock::time_point end;
+};
+
+struct ThreadBuffer {
+    ThreadBuffer();
+    ~ThreadBuffer();
+
+    /// Guards events, which Stop takes from every thread
+    std::mutex mutex;
+    std::vector<RecordedEvent> events;
+    u32 tid;
+    std::string name;
+    /// Trace the thread metadata was last written to
+    u32 named_in_trace = 0;
+};
+
+/// Guards everything below and the writing to the trace file
+std::mutex writer_mutex;
+FileUtil::IOFile file;
+/// Incremented for every trace started, so the threads name themselves in each of them
+u32 trace_count = 0;
+bool first_event = true;
+Clock::time_point trace_begin;
+std::vector<ThreadBuffer*> thread_buffers;
+u32 next_tid = 1;
+
+ThreadBuffer& GetThreadBuffer() {
+    thread_local ThreadBuffer buffer;
+    return buffer;
+}
+
+/// Escapes the characters JSON strings can't hold as they are
+std::string Escape(const char* string) {
+    std::string escaped;
+    for (const char* c = string; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        if (static_cast<unsigned char>(*c) >= 0x20) {
+            escaped += *c;
+        }
+    }
+    return escaped;
+}
+
+/// Writes the events of a thread to the trace file, call with writer_mutex held
+void WriteEvents(ThreadBuffer& buffer, const std::vector<RecordedEvent>& events) {
+    if (!file.IsOpen() || events.empty()) {
+        return;
+    }
+
+    std::string json;
+    const auto append = [&json](const std::string& event) {
+        json += first_event ? "\n" : ",\n";
+        json += event;
+        first_event = false;
+    };
+    if (buffer.named_in_trace != trace_count && !buffer.name.empty()) {
+        append(fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},)"
+                           R"("args":{{"name":"{}"}}}})",
+                           buffer.tid, Escape(buffer.name.c_str())));
+        buffer.named_in_trace = trace_count;
+    }
+    for (const RecordedEvent& event : events) {
+        // Events recorded before the trace began are dropped
+        if (event.begin < trace_begin) {
+            continue;
+        }
+        const auto to_us = [](Clock::duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        };
+        append(fmt::format(
+            R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{}}})",
+            Escape(event.name), Escape(event.group), to_us(event.begin - trace_begin),
+            to_us(event.end - event.begin), buffer.tid));
+    }
+    file.WriteString(json);
+}
+
+/// Takes the events collected by a thread and writes them, call with writer_mutex held
+void FlushThreadBuffer(ThreadBuffer& buffer) {
+    std::vector<RecordedEvent> events;
+    {
+        std::lock_guard lock{buffer.mutex};
+        events.swap(buffer.events);
+    }
+    WriteEvents(buffer, events);
+}
+
+ThreadBuffer::ThreadBuffer() {
+    std::lock_guard lock{writer_mutex};
+    tid = next_tid++;
+    thread_buffers.push_back(this);
+}
+
+ThreadBuffer::~ThreadBuffer() {
+    std::lock_guard lock{writer_mutex};
+    FlushThreadBuffer(*this);
+    thread_buffers.erase(std::find(thread_buffers.begin(), thread_buffers.end(), this));
+}
+
+} // Anonymous namespace
+
+namespace Detail {
+
+std::atomic_bool enabled{false};
+
+void Record(const char* group, const char* name, Clock::time_point begin, Clock::time_point end) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::vector<RecordedEvent> events;
+    {
+        std::lock_guard lock{buffer.mutex};
+        buffer.events.push_back({group, name, begin, end});
+        if (buffer.events.size() < ThreadBufferSize) {
+            return;
+        }
+        events.swap(buffer.events);
+    }
+    // The events are written outside of the buffer lock, as Stop takes the locks the other way
+    std::lock_guard lock{writer_mutex};
+    WriteEvents(buffer, events);
+}
+
+} // namespace Detail
+
+bool Start(const std::string& path) {
+    Stop();
+
+    std::lock_guard lock{writer_mutex};
+    file = FileUtil::IOFile(path, "w");
+    if (!file.IsOpen()) {
+        LOG_ERROR(Common, "Could not open trace file {}", path);
+        return false;
+    }
+    file.WriteString(R"({"displayTimeUnit":"ms","traceEvents":[)");
+    ++trace_count;
+    first_event = true;
+    trace_begin = Clock::now();
+    Detail::enabled = true;
+    LOG_INFO(Common, "Writing trace to {}", path);
+    return true;
+}
+
+void Stop() {
+    std::lock_guard lock{writer_mutex};
+    if (!Detail::enabled.exchange(false)) {
+        return;
+    }
+    for (ThreadBuffer* buffer : thread_buffers) {
+        FlushThreadBuffer(*buffer);
+    }
+    file.WriteString("\n]}\n");
+    file.Close();
+}
+
+void SetThreadName(const char* name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard lock{writer_mutex};
+    buffer.name = name;
+}
+
+} // namespace Common::Tracing
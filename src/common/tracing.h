@@ -0,0 +1,80 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Records timed scopes into a trace file in the Chrome trace event format, which Perfetto
+ * (ui.perfetto.dev), chrome://tracing and Tracy's import-chrome tool open. The MicroProfile timers
+ * of common/microprofile.h are recorded as well, so traces cover the same scopes as the profiler
+ * widget. While no trace is being written, a scope only costs a relaxed atomic load.
+ */
+namespace Common::Tracing {
+
+using Clock = std::chrono::steady_clock;
+
+/// A kind of traced scope, named like the MicroProfile timers
+struct Event {
+    const char* group;
+    const char* name;
+};
+
+namespace Detail {
+extern std::atomic_bool enabled;
+
+void Record(const char* group, const char* name, Clock::time_point begin, Clock::time_point end);
+} // namespace Detail
+
+/**
+ * Starts writing the events of all threads to a trace file, replacing the current trace if one is
+ * being written.
+ * @returns false if the file could not be opened
+ */
+bool Start(const std::string& path);
+
+/// Writes the remaining events and closes the trace file
+void Stop();
+
+inline bool IsEnabled() {
+    return Detail::enabled.load(std::memory_order_relaxed);
+}
+
+/// Names the calling thread in the traces
+void SetThreadName(const char* name);
+
+/**
+ * Records its lifetime as an event of the trace being written. The strings must outlive the trace.
+ */
+class Scope {
+public:
+    explicit Scope(const Event& event) : Scope(event.group, event.name) {}
+
+    Scope(const char* group, const char* name) {
+        if (IsEnabled()) {
+            this->group = group;
+            this->name = name;
+            begin = Clock::now();
+        }
+    }
+
+    ~Scope() {
+        if (name != nullptr) {
+            Detail::Record(group, name, begin, Clock::now());
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* group = nullptr;
+    const char* name = nullptr;
+    Clock::time_point begin;
+};
+
+} // namespace Common::Tracing
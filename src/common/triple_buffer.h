@@ -0,0 +1,59 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * Hands the latest of a series of values over from one thread to another without either of them
+ * ever waiting for the other. The writer fills the back buffer and publishes it, the reader gets the
+ * value published last, values published in between being dropped. Only one thread may write and
+ * only one may read.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial_value) {
+        buffers.fill(initial_value);
+    }
+
+    /// Returns the buffer the writer fills before publishing it
+    T& Back() {
+        return buffers[back];
+    }
+
+    /// Makes the back buffer the latest value, the writer gets another one to fill
+    void Publish() {
+        back = middle.exchange(back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+    }
+
+    /// Returns the value published last, which stays valid until the next call
+    const T& Read() {
+        if (middle.load(std::memory_order_relaxed) & FreshBit) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & IndexMask;
+        }
+        return buffers[front];
+    }
+
+private:
+    /// Set in middle when it holds a value the reader hasn't taken yet
+    static constexpr u8 FreshBit = 4;
+    static constexpr u8 IndexMask = 3;
+
+    std::array<T, 3> buffers{};
+    /// Index of the buffer owned by the writer
+    u8 back = 0;
+    /// Index of the buffer passed from one thread to the other, with the fresh bit
+    std::atomic<u8> middle{1};
+    /// Index of the buffer owned by the reader
+    u8 front = 2;
+};
+
+} // namespace Common
@@ -3,13 +3,80 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
+#include <optional>
 #include <zstd.h>
 
 #include "common/assert.h"
+#include "common/task_scheduler.h"
 #include "common/zstd_compression.h"
 
 namespace Common::Compression {
 
+/// Uncompressed size of the frames of seekable data, small enough to share the work between
+/// threads and large enough to keep the compression ratio
+constexpr std::size_t SEEKABLE_FRAME_SIZE = 8 * 1024 * 1024;
+
+// Constants of the seek table of the Zstandard seekable format
+constexpr u32 SKIPPABLE_FRAME_MAGIC = 0x184D2A5E;
+constexpr u32 SEEKABLE_MAGIC = 0x8F92EAB1;
+constexpr std::size_t SEEK_TABLE_FOOTER_SIZE = 9;
+constexpr u8 SEEK_TABLE_CHECKSUM_FLAG = 0x80;
+
+struct SeekTableEntry {
+    std::size_t compressed_offset;
+    std::size_t compressed_size;
+    std::size_t decompressed_offset;
+    std::size_t decompressed_size;
+};
+
+static u32 ReadU32(const u8* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<u32>(data[3]) << 24);
+}
+
+static void AppendU32(std::vector<u8>& out, u32 value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<u8>(value >> (8 * i)));
+    }
+}
+
+/// Returns the frames listed in the seek table at the end of the data, if there is one
+static std::optional<std::vector<SeekTableEntry>> ReadSeekTable(const std::vector<u8>& data) {
+    if (data.size() < SEEK_TABLE_FOOTER_SIZE + 8) {
+        return std::nullopt;
+    }
+    const u8* footer = data.data() + data.size() - SEEK_TABLE_FOOTER_SIZE;
+    if (ReadU32(footer + 5) != SEEKABLE_MAGIC) {
+        return std::nullopt;
+    }
+    const std::size_t num_frames = ReadU32(footer);
+    const std::size_t entry_size = (footer[4] & SEEK_TABLE_CHECKSUM_FLAG) ? 12 : 8;
+    const std::size_t table_size = num_frames * entry_size + SEEK_TABLE_FOOTER_SIZE;
+    if (data.size() < table_size + 8) {
+        return std::nullopt;
+    }
+    const u8* skippable_header = data.data() + data.size() - table_size - 8;
+    if (ReadU32(skippable_header) != SKIPPABLE_FRAME_MAGIC ||
+        ReadU32(skippable_header + 4) != table_size) {
+        return std::nullopt;
+    }
+
+    std::vector<SeekTableEntry> entries(num_frames);
+    const u8* entry = skippable_header + 8;
+    std::size_t compressed_offset = 0;
+    std::size_t decompressed_offset = 0;
+    for (auto& frame : entries) {
+        frame = {compressed_offset, ReadU32(entry), decompressed_offset, ReadU32(entry + 4)};
+        compressed_offset += frame.compressed_size;
+        decompressed_offset += frame.decompressed_size;
+        entry += entry_size;
+    }
+    if (compressed_offset != data.size() - table_size - 8) {
+        return std::nullopt;
+    }
+    return entries;
+}
+
 std::vector<u8> CompressDataZSTD(const u8* source, std::size_t source_size, s32 compression_level) {
     compression_level = std::clamp(compression_level, ZSTD_minCLevel(), ZSTD_maxCLevel());
 
@@ -33,7 +100,83 @@ std::vector<u8> CompressDataZSTDDefault(const u8* source, std::size_t source_siz
     return CompressDataZSTD(source, source_size, ZSTD_CLEVEL_DEFAULT);
 }
 
+std::vector<u8> CompressDataZSTDSeekable(const u8* source, std::size_t source_size,
+                                         s32 compression_level) {
+    compression_level = std::clamp(compression_level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+
+    const std::size_t num_frames = (source_size + SEEKABLE_FRAME_SIZE - 1) / SEEKABLE_FRAME_SIZE;
+    std::vector<std::vector<u8>> frames(num_frames);
+    std::atomic_bool failed{false};
+    // Compression happens in the background, making way for the work the emulation waits for
+    TaskScheduler::GetInstance().ParallelFor(
+        num_frames, 1,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t offset = i * SEEKABLE_FRAME_SIZE;
+                frames[i] = CompressDataZSTD(source + offset,
+                                             std::min(SEEKABLE_FRAME_SIZE, source_size - offset),
+                                             compression_level);
+                if (frames[i].empty()) {
+                    failed = true;
+                }
+            }
+        },
+        TaskScheduler::Priority::Low);
+    if (failed) {
+        return {};
+    }
+
+    std::size_t compressed_size = 0;
+    for (const auto& frame : frames) {
+        compressed_size += frame.size();
+    }
+    std::vector<u8> compressed;
+    compressed.reserve(compressed_size + num_frames * 8 + SEEK_TABLE_FOOTER_SIZE + 8);
+    for (const auto& frame : frames) {
+        compressed.insert(compressed.end(), frame.begin(), frame.end());
+    }
+
+    AppendU32(compressed, SKIPPABLE_FRAME_MAGIC);
+    AppendU32(compressed, static_cast<u32>(num_frames * 8 + SEEK_TABLE_FOOTER_SIZE));
+    for (std::size_t i = 0; i < num_frames; ++i) {
+        const std::size_t frame_size =
+            std::min(SEEKABLE_FRAME_SIZE, source_size - i * SEEKABLE_FRAME_SIZE);
+        AppendU32(compressed, static_cast<u32>(frames[i].size()));
+        AppendU32(compressed, static_cast<u32>(frame_size));
+    }
+    AppendU32(compressed, static_cast<u32>(num_frames));
+    compressed.push_back(0); // No checksums
+    AppendU32(compressed, SEEKABLE_MAGIC);
+    return compressed;
+}
+
 std::vector<u8> DecompressDataZSTD(const std::vector<u8>& compressed) {
+    if (const auto seek_table = ReadSeekTable(compressed)) {
+        const std::size_t decompressed_size =
+            seek_table->empty() ? 0
+                                : seek_table->back().decompressed_offset +
+                                      seek_table->back().decompressed_size;
+        std::vector<u8> decompressed(decompressed_size);
+        std::atomic_bool failed{false};
+        TaskScheduler::GetInstance().ParallelFor(
+            seek_table->size(), 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    const SeekTableEntry& frame = (*seek_table)[i];
+                    const std::size_t result = ZSTD_decompress(
+                        decompressed.data() + frame.decompressed_offset, frame.decompressed_size,
+                        compressed.data() + frame.compressed_offset, frame.compressed_size);
+                    if (ZSTD_isError(result) || result != frame.decompressed_size) {
+                        failed = true;
+                    }
+                }
+            });
+        if (failed) {
+            // Decompression failed
+            return {};
+        }
+        return decompressed;
+    }
+
     const std::size_t decompressed_size =
         ZSTD_getDecompressedSize(compressed.data(), compressed.size());
     std::vector<u8> decompressed(decompressed_size);
@@ -48,4 +191,21 @@ std::vector<u8> DecompressDataZSTD(const std::vector<u8>& compressed) {
     return decompressed;
 }
 
+std::vector<u8> DecompressDataZSTDBounded(const u8* source, std::size_t source_size,
+                                          std::size_t max_size) {
+    const unsigned long long decompressed_size = ZSTD_getFrameContentSize(source, source_size);
+    if (decompressed_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+        decompressed_size == ZSTD_CONTENTSIZE_ERROR || decompressed_size > max_size) {
+        return {};
+    }
+
+    std::vector<u8> decompressed(static_cast<std::size_t>(decompressed_size));
+    const std::size_t result =
+        ZSTD_decompress(decompressed.data(), decompressed.size(), source, source_size);
+    if (ZSTD_isError(result) || result != decompressed.size()) {
+        return {};
+    }
+    return decompressed;
+}
+
 } // namespace Common::Compression
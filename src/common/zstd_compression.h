@@ -32,8 +32,23 @@ std::vector<u8> CompressDataZSTD(const u8* source, std::size_t source_size, s32
  */
 std::vector<u8> CompressDataZSTDDefault(const u8* source, std::size_t source_size);
 
+/**
+ * Compresses a source memory region with Zstandard into independent frames, which are compressed
+ * in parallel and followed by a seek table in the Zstandard seekable format, so that they can be
+ * decompressed in parallel too.
+ *
+ * @param source the uncompressed source memory region.
+ * @param source_size the size in bytes of the uncompressed source memory region.
+ * @param compression_level the used compression level. Should be between 1 and 22.
+ *
+ * @return the compressed data.
+ */
+std::vector<u8> CompressDataZSTDSeekable(const u8* source, std::size_t source_size,
+                                         s32 compression_level);
+
 /**
  * Decompresses a source memory region with Zstandard and returns the uncompressed data in a vector.
+ * The frames of data compressed with CompressDataZSTDSeekable are decompressed in parallel.
  *
  * @param compressed the compressed source memory region.
  *
@@ -41,4 +56,17 @@ std::vector<u8> CompressDataZSTDDefault(const u8* source, std::size_t source_siz
  */
 std::vector<u8> DecompressDataZSTD(const std::vector<u8>& compressed);
 
+/**
+ * Decompresses a single Zstandard frame that records its uncompressed size, which must not exceed
+ * max_size. Meant for data from untrusted sources, whose claimed size can't be allocated blindly.
+ *
+ * @param source the compressed source memory region.
+ * @param source_size the size in bytes of the compressed source memory region.
+ * @param max_size the largest accepted uncompressed size in bytes.
+ *
+ * @return the uncompressed data, or an empty vector if the data is invalid or too large.
+ */
+std::vector<u8> DecompressDataZSTDBounded(const u8* source, std::size_t source_size,
+                                          std::size_t max_size);
+
 } // namespace Common::Compression
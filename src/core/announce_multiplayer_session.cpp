@@ -19,32 +19,64 @@ namespace Core {
 // Time between room is announced to web_service
 static constexpr std::chrono::seconds announce_time_interval(15);
 
-AnnounceMultiplayerSession::AnnounceMultiplayerSession() {
+static std::unique_ptr<AnnounceMultiplayerRoom::Backend> CreateBackend() {
 #ifdef ENABLE_WEB_SERVICE
-    backend = std::make_unique<WebService::RoomJson>(Settings::values.web_api_url,
-                                                     Settings::values.citra_username,
-                                                     Settings::values.citra_token);
+    return std::make_unique<WebService::RoomJson>(Settings::values.web_api_url,
+                                                  Settings::values.citra_username,
+                                                  Settings::values.citra_token);
 #else
-    backend = std::make_unique<AnnounceMultiplayerRoom::NullBackend>();
+    return std::make_unique<AnnounceMultiplayerRoom::NullBackend>();
 #endif
 }
 
+std::shared_ptr<Network::Room> AnnounceMultiplayerSession::AnnouncedRoom::GetRoom() const {
+    return use_global_room ? Network::GetRoom().lock() : room.lock();
+}
+
+AnnounceMultiplayerSession::AnnounceMultiplayerSession() {
+    auto& announced = rooms.emplace_back(std::make_unique<AnnouncedRoom>());
+    announced->use_global_room = true;
+    announced->backend = CreateBackend();
+}
+
+AnnounceMultiplayerSession::AnnounceMultiplayerSession(
+    std::vector<std::weak_ptr<Network::Room>> rooms_) {
+    ASSERT_MSG(!rooms_.empty(), "No rooms to announce");
+    for (auto& room : rooms_) {
+        auto& announced = rooms.emplace_back(std::make_unique<AnnouncedRoom>());
+        announced->room = std::move(room);
+        announced->backend = CreateBackend();
+    }
+}
+
 Common::WebResult AnnounceMultiplayerSession::Register() {
-    std::shared_ptr<Network::Room> room = Network::GetRoom().lock();
+    Common::WebResult result{Common::WebResult::Code::Success};
+    for (auto& announced : rooms) {
+        Common::WebResult room_result = Register(*announced);
+        if (room_result.result_code != Common::WebResult::Code::Success &&
+            result.result_code == Common::WebResult::Code::Success) {
+            result = std::move(room_result);
+        }
+    }
+    return result;
+}
+
+Common::WebResult AnnounceMultiplayerSession::Register(AnnouncedRoom& announced) {
+    std::shared_ptr<Network::Room> room = announced.GetRoom();
     if (!room) {
         return Common::WebResult{Common::WebResult::Code::LibError, "Network is not initialized"};
     }
     if (room->GetState() != Network::Room::State::Open) {
         return Common::WebResult{Common::WebResult::Code::LibError, "Room is not open"};
     }
-    UpdateBackendData(room);
-    Common::WebResult result = backend->Register();
+    UpdateBackendData(announced, room);
+    Common::WebResult result = announced.backend->Register();
     if (result.result_code != Common::WebResult::Code::Success) {
         return result;
     }
-    LOG_INFO(WebService, "Room has been registered");
+    LOG_INFO(WebService, "Room {} has been registered", room->GetRoomInformation().name);
     room->SetVerifyUID(result.returned_data);
-    registered = true;
+    announced.registered = true;
     return Common::WebResult{Common::WebResult::Code::Success};
 }
 
@@ -62,8 +94,10 @@ void AnnounceMultiplayerSession::Stop() {
         shutdown_event.Set();
         announce_multiplayer_thread->join();
         announce_multiplayer_thread.reset();
-        backend->Delete();
-        registered = false;
+        for (auto& announced : rooms) {
+            announced->backend->Delete();
+            announced->registered = false;
+        }
     }
 }
 
@@ -84,7 +118,9 @@ AnnounceMultiplayerSession::~AnnounceMultiplayerSession() {
     Stop();
 }
 
-void AnnounceMultiplayerSession::UpdateBackendData(std::shared_ptr<Network::Room> room) {
+void AnnounceMultiplayerSession::UpdateBackendData(AnnouncedRoom& announced,
+                                                   std::shared_ptr<Network::Room> room) {
+    auto& backend = announced.backend;
     Network::RoomInformation room_information = room->GetRoomInformation();
     std::vector<Network::Room::Member> memberlist = room->GetRoomMemberList();
     backend->SetRoomInformation(
@@ -107,43 +143,50 @@ void AnnounceMultiplayerSession::AnnounceMultiplayerLoop() {
         }
     };
 
-    if (!registered) {
-        Common::WebResult result = Register();
-        if (result.result_code != Common::WebResult::Code::Success) {
-            ErrorCallback(result);
-            return;
+    // Rooms that failed to register or were closed are no longer announced
+    std::vector<AnnouncedRoom*> active_rooms;
+    for (auto& announced : rooms) {
+        if (!announced->registered) {
+            Common::WebResult result = Register(*announced);
+            if (result.result_code != Common::WebResult::Code::Success) {
+                ErrorCallback(result);
+                continue;
+            }
         }
+        active_rooms.push_back(announced.get());
     }
 
     auto update_time = std::chrono::steady_clock::now();
     std::future<Common::WebResult> future;
-    while (!shutdown_event.WaitUntil(update_time)) {
+    while (!active_rooms.empty() && !shutdown_event.WaitUntil(update_time)) {
         update_time += announce_time_interval;
-        std::shared_ptr<Network::Room> room = Network::GetRoom().lock();
-        if (!room) {
-            break;
-        }
-        if (room->GetState() != Network::Room::State::Open) {
-            break;
-        }
-        UpdateBackendData(room);
-        Common::WebResult result = backend->Update();
-        if (result.result_code != Common::WebResult::Code::Success) {
-            ErrorCallback(result);
-        }
-        if (result.result_string == "404") {
-            registered = false;
-            // Needs to register the room again
-            Common::WebResult result = Register();
+        for (auto it = active_rooms.begin(); it != active_rooms.end();) {
+            AnnouncedRoom& announced = **it;
+            std::shared_ptr<Network::Room> room = announced.GetRoom();
+            if (!room || room->GetState() != Network::Room::State::Open) {
+                it = active_rooms.erase(it);
+                continue;
+            }
+            ++it;
+            UpdateBackendData(announced, room);
+            Common::WebResult result = announced.backend->Update();
             if (result.result_code != Common::WebResult::Code::Success) {
                 ErrorCallback(result);
             }
+            if (result.result_string == "404") {
+                announced.registered = false;
+                // Needs to register the room again
+                Common::WebResult result = Register(announced);
+                if (result.result_code != Common::WebResult::Code::Success) {
+                    ErrorCallback(result);
+                }
+            }
         }
     }
 }
 
 AnnounceMultiplayerRoom::RoomList AnnounceMultiplayerSession::GetRoomList() {
-    return backend->GetRoomList();
+    return rooms.front()->backend->GetRoomList();
 }
 
 bool AnnounceMultiplayerSession::IsRunning() const {
@@ -154,9 +197,9 @@ void AnnounceMultiplayerSession::UpdateCredentials() {
     ASSERT_MSG(!IsRunning(), "Credentials can only be updated when session is not running");
 
 #ifdef ENABLE_WEB_SERVICE
-    backend = std::make_unique<WebService::RoomJson>(Settings::values.web_api_url,
-                                                     Settings::values.citra_username,
-                                                     Settings::values.citra_token);
+    for (auto& announced : rooms) {
+        announced->backend = CreateBackend();
+    }
 #endif
 }
 
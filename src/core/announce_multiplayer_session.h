@@ -10,6 +10,7 @@
 #include <mutex>
 #include <set>
 #include <thread>
+#include <vector>
 #include "common/announce_multiplayer_room.h"
 #include "common/common_types.h"
 #include "common/thread.h"
@@ -28,7 +29,10 @@ namespace Core {
 class AnnounceMultiplayerSession : NonCopyable {
 public:
     using CallbackHandle = std::shared_ptr<std::function<void(const Common::WebResult&)>>;
+    /// Announces the room returned by Network::GetRoom
     AnnounceMultiplayerSession();
+    /// Announces several rooms, all of them updated by the same thread
+    explicit AnnounceMultiplayerSession(std::vector<std::weak_ptr<Network::Room>> rooms);
     ~AnnounceMultiplayerSession();
 
     /**
@@ -45,8 +49,8 @@ public:
     void UnbindErrorCallback(CallbackHandle handle);
 
     /**
-     * Registers a room to web services
-     * @return The result of the registration attempt.
+     * Registers the rooms to web services
+     * @return The result of the registration attempt, the first failure if there are several rooms
      */
     Common::WebResult Register();
 
@@ -79,17 +83,28 @@ public:
     void UpdateCredentials();
 
 private:
+    /// A room and the backend that announces it
+    struct AnnouncedRoom {
+        std::weak_ptr<Network::Room> room; ///< The announced room, unless use_global_room is set
+        bool use_global_room = false;      ///< Whether the room of Network::GetRoom is announced
+
+        /// Backend interface that logs fields
+        std::unique_ptr<AnnounceMultiplayerRoom::Backend> backend;
+
+        std::atomic_bool registered = false; ///< Whether the room has been registered
+
+        std::shared_ptr<Network::Room> GetRoom() const;
+    };
+
     Common::Event shutdown_event;
     std::mutex callback_mutex;
     std::set<CallbackHandle> error_callbacks;
     std::unique_ptr<std::thread> announce_multiplayer_thread;
 
-    /// Backend interface that logs fields
-    std::unique_ptr<AnnounceMultiplayerRoom::Backend> backend;
-
-    std::atomic_bool registered = false; ///< Whether the room has been registered
+    std::vector<std::unique_ptr<AnnouncedRoom>> rooms;
 
-    void UpdateBackendData(std::shared_ptr<Network::Room> room);
+    Common::WebResult Register(AnnouncedRoom& announced);
+    void UpdateBackendData(AnnouncedRoom& announced, std::shared_ptr<Network::Room> room);
     void AnnounceMultiplayerLoop();
 };
 
@@ -112,6 +112,23 @@ public:
     /// Step CPU by one instruction
     virtual void Step() = 0;
 
+    /// Returns whether RunUntilSVC and ServePendingSVC are implemented
+    virtual bool CanRunUntilSVC() const {
+        return false;
+    }
+
+    /**
+     * Runs like Run, but stops at the first SVC instead of handling it, which lets the CPU run on
+     * a host thread of its own while the kernel is only entered from the emulation thread.
+     */
+    virtual void RunUntilSVC() {}
+
+    /// Handles the SVC RunUntilSVC stopped at, on the emulation thread. Returns false if the CPU
+    /// didn't stop at one.
+    virtual bool ServePendingSVC() {
+        return false;
+    }
+
     /// Clear all instruction cache
     virtual void ClearInstructionCache() = 0;
 
@@ -6,15 +6,23 @@
 #include <dynarmic/A32/a32.h>
 #include <dynarmic/A32/context.h>
 #include "common/assert.h"
+#include "common/host_memory.h"
 #include "common/microprofile.h"
 #include "core/arm/dynarmic/arm_dynarmic.h"
 #include "core/arm/dynarmic/arm_dynarmic_cp15.h"
 #include "core/core.h"
 #include "core/core_timing.h"
 #include "core/gdbstub/gdbstub.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
 #include "core/hle/kernel/svc.h"
 #include "core/memory.h"
 
+/// Number of exited processes whose translated code is kept for another process running it
+constexpr std::size_t MAX_EXITED_JITS = 4;
+/// Size of the guest virtual address space
+constexpr std::size_t ADDRESS_SPACE_SIZE = 0x1'0000'0000;
+
 class DynarmicThreadContext final : public ARM_Interface::ThreadContext {
 public:
     DynarmicThreadContext() {
@@ -75,28 +83,36 @@ public:
     ~DynarmicUserCallbacks() = default;
 
     std::uint8_t MemoryRead8(VAddr vaddr) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Read);
         return memory.Read8(vaddr);
     }
     std::uint16_t MemoryRead16(VAddr vaddr) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Read);
         return memory.Read16(vaddr);
     }
     std::uint32_t MemoryRead32(VAddr vaddr) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Read);
         return memory.Read32(vaddr);
     }
     std::uint64_t MemoryRead64(VAddr vaddr) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Read);
         return memory.Read64(vaddr);
     }
 
     void MemoryWrite8(VAddr vaddr, std::uint8_t value) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Write);
         memory.Write8(vaddr, value);
     }
     void MemoryWrite16(VAddr vaddr, std::uint16_t value) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Write);
         memory.Write16(vaddr, value);
     }
     void MemoryWrite32(VAddr vaddr, std::uint32_t value) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Write);
         memory.Write32(vaddr, value);
     }
     void MemoryWrite64(VAddr vaddr, std::uint64_t value) override {
+        CheckWatchpoint(vaddr, GDBStub::BreakpointType::Write);
         memory.Write64(vaddr, value);
     }
 
@@ -107,6 +123,12 @@ public:
     }
 
     void CallSVC(std::uint32_t swi) override {
+        if (parent.stop_at_svc) {
+            // The PC already points past the SVC, it is served once the JIT has returned
+            parent.pending_svc = swi;
+            parent.jit->HaltExecution();
+            return;
+        }
         svc_context.CallSVC(swi);
     }
 
@@ -116,6 +138,9 @@ public:
         case Dynarmic::A32::Exception::UnpredictableInstruction:
             break;
         case Dynarmic::A32::Exception::Breakpoint:
+            if (CallGuestRoutine(pc)) {
+                return;
+            }
             if (GDBStub::IsConnected()) {
                 parent.jit->HaltExecution();
                 parent.SetPC(pc);
@@ -123,10 +148,15 @@ public:
                 return;
             }
             break;
-        case Dynarmic::A32::Exception::SendEvent:
-        case Dynarmic::A32::Exception::SendEventLocal:
         case Dynarmic::A32::Exception::WaitForInterrupt:
         case Dynarmic::A32::Exception::WaitForEvent:
+            // Interrupts and the events of the other cores are only delivered between slices, so
+            // the core has nothing to do until the end of its slice
+            parent.GetTimer().Idle();
+            parent.jit->HaltExecution();
+            return;
+        case Dynarmic::A32::Exception::SendEvent:
+        case Dynarmic::A32::Exception::SendEventLocal:
         case Dynarmic::A32::Exception::Yield:
         case Dynarmic::A32::Exception::PreloadData:
         case Dynarmic::A32::Exception::PreloadDataWithIntentToWrite:
@@ -144,6 +174,36 @@ public:
         return static_cast<u64>(ticks <= 0 ? 0 : ticks);
     }
 
+    /// Runs the guest routine patched in with the BKPT at the PC, returns false for other BKPTs
+    bool CallGuestRoutine(VAddr pc) {
+        const auto routine = HLE::DecodeRoutineBreakpoint(MemoryReadCode(pc));
+        if (!routine || (parent.jit->Cpsr() & 0x20) != 0) {
+            return false;
+        }
+        const HLE::GuestRoutineCall call(*routine, parent.jit->Regs());
+        parent.GetTimer().AddTicks(call.GetTicks());
+        if (!call.RunInPlace(memory, *parent.current_page_table)) {
+            if (parent.stop_at_svc) {
+                // The PC already points past the BKPT, it is served once the JIT has returned
+                parent.pending_routine = call;
+                parent.jit->HaltExecution();
+                return true;
+            }
+            call.Run(memory, *parent.system.Kernel().GetCurrentProcess());
+        }
+        parent.ReturnFromRoutine();
+        return true;
+    }
+
+    /// Watched pages are hidden from the JIT, so that their accesses come through the callbacks
+    void CheckWatchpoint(VAddr vaddr, GDBStub::BreakpointType type) {
+        if (GDBStub::IsConnected() && GDBStub::CheckBreakpoint(vaddr, type)) {
+            // The break is served once the JIT has returned, at the end of the current block
+            GDBStub::Break(true);
+            parent.jit->HaltExecution();
+        }
+    }
+
     ARM_Dynarmic& parent;
     Kernel::SVCContext svc_context;
     Memory::MemorySystem& memory;
@@ -165,6 +225,47 @@ void ARM_Dynarmic::Run() {
     MICROPROFILE_SCOPE(ARM_Jit);
 
     jit->Run();
+
+    if (GDBStub::IsMemoryBreak()) {
+        ServeBreak();
+    }
+}
+
+void ARM_Dynarmic::RunUntilSVC() {
+    MICROPROFILE_SCOPE(ARM_Jit);
+
+    // Only used to run the cores in parallel, which stays disabled (PARALLEL_CORES_SUPPORTED) as
+    // the exclusive state of each JIT isn't shared with the other cores
+
+    // Accesses falling back to the memory system must use this core's page table, the current one
+    // belongs to the core last set as running on the emulation thread
+    memory.SetThreadPageTable(current_page_table.get());
+    stop_at_svc = true;
+    jit->Run();
+    stop_at_svc = false;
+    memory.SetThreadPageTable(nullptr);
+}
+
+bool ARM_Dynarmic::ServePendingSVC() {
+    if (pending_routine) {
+        const HLE::GuestRoutineCall call = *pending_routine;
+        pending_routine.reset();
+        call.Run(memory, *system.Kernel().GetCurrentProcess());
+        ReturnFromRoutine();
+        return true;
+    }
+    if (!pending_svc) {
+        return false;
+    }
+    const u32 swi = *pending_svc;
+    pending_svc.reset();
+    cb->svc_context.CallSVC(swi);
+    return true;
+}
+
+void ARM_Dynarmic::ReturnFromRoutine() {
+    const bool thumb = HLE::GuestRoutineCall::Return(jit->Regs());
+    jit->SetCpsr((jit->Cpsr() & ~0x20u) | (thumb ? 0x20u : 0u));
 }
 
 void ARM_Dynarmic::Step() {
@@ -279,12 +380,18 @@ void ARM_Dynarmic::PrepareReschedule() {
 
 void ARM_Dynarmic::ClearInstructionCache() {
     for (const auto& j : jits) {
-        j.second->ClearCache();
+        j.second.jit->ClearCache();
     }
 }
 
 void ARM_Dynarmic::InvalidateCacheRange(u32 start_address, std::size_t length) {
     jit->InvalidateCacheRange(start_address, length);
+
+    const u64 end_address = u64{start_address} + length;
+    if (start_address < current_page_table->code_end &&
+        end_address > current_page_table->code_begin) {
+        jits.at(current_page_table).reusable = false;
+    }
 }
 
 std::shared_ptr<Memory::PageTable> ARM_Dynarmic::GetPageTable() const {
@@ -300,15 +407,18 @@ void ARM_Dynarmic::SetPageTable(const std::shared_ptr<Memory::PageTable>& page_t
 
     auto iter = jits.find(current_page_table);
     if (iter != jits.end()) {
-        jit = iter->second.get();
+        jit = iter->second.jit.get();
         jit->LoadContext(ctx);
         return;
     }
 
-    auto new_jit = MakeJit();
+    auto new_jit = TakeExitedJit();
+    if (!new_jit) {
+        new_jit = MakeJit();
+    }
     jit = new_jit.get();
     jit->LoadContext(ctx);
-    jits.emplace(current_page_table, std::move(new_jit));
+    jits.emplace(current_page_table, CachedJit{std::move(new_jit)});
 }
 
 void ARM_Dynarmic::ServeBreak() {
@@ -322,11 +432,83 @@ std::unique_ptr<Dynarmic::A32::Jit> ARM_Dynarmic::MakeJit() {
     Dynarmic::A32::UserConfig config;
     config.callbacks = cb.get();
     config.page_table = &current_page_table->GetPointerArray();
+#ifdef ENABLE_DYNARMIC_FASTMEM
+    if (current_page_table->fastmem_arena) {
+        // Accesses that fault in the arena are recompiled to go through the page table
+        config.fastmem_pointer = current_page_table->fastmem_arena->Pointer();
+        config.recompile_on_fastmem_failure = true;
+    }
+#endif
     config.coprocessors[15] = std::make_shared<DynarmicCP15>(cp15_state);
     config.define_unpredictable_behaviour = true;
+#ifdef ENABLE_DYNARMIC_HINT_HOOKS
+    // Lets WFI and WFE end the slice in ExceptionRaised
+    config.hook_hint_instructions = true;
+#endif
     return std::make_unique<Dynarmic::A32::Jit>(config);
 }
 
+template <typename Func>
+void ARM_Dynarmic::ForEachOtherCore(Func&& func) {
+    for (u32 i = 0; i < system.GetNumCores(); ++i) {
+        auto* core = dynamic_cast<ARM_Dynarmic*>(&system.GetCore(i));
+        if (core && core != this) {
+            func(*core);
+        }
+    }
+}
+
+bool ARM_Dynarmic::IsExited(const std::shared_ptr<Memory::PageTable>& page_table) {
+    // Nothing but the JIT maps of the cores references the page tables of exited processes
+    long num_jit_refs = 1;
+    ForEachOtherCore([&](ARM_Dynarmic& core) { num_jit_refs += core.jits.count(page_table); });
+    return page_table.use_count() == num_jit_refs;
+}
+
+std::unique_ptr<Dynarmic::A32::Jit> ARM_Dynarmic::TakeExitedJit() {
+    const Memory::PageTable& page_table = *current_page_table;
+    // The new page table hands its storage over to the exited one, so the JITs other cores
+    // already compiled against that storage would be left with freed memory
+    bool can_take = page_table.code_hash != 0;
+    ForEachOtherCore(
+        [&](ARM_Dynarmic& core) { can_take = can_take && !core.jits.count(current_page_table); });
+
+    std::unique_ptr<Dynarmic::A32::Jit> result;
+    std::size_t num_exited = 0;
+    for (auto it = jits.begin(); it != jits.end();) {
+        const Memory::PageTable& exited = *it->first;
+        if (!IsExited(it->first)) {
+            ++it;
+            continue;
+        }
+        if (can_take && !result && it->second.reusable &&
+            exited.code_hash == page_table.code_hash &&
+            exited.code_begin == page_table.code_begin && exited.code_end == page_table.code_end &&
+            !exited.fastmem_arena == !page_table.fastmem_arena) {
+            // The JITs of the other cores are bound to the storage of the exited page table too,
+            // they go before it is handed over
+            ForEachOtherCore([&](ARM_Dynarmic& core) { core.jits.erase(it->first); });
+            // The JIT is bound to the storage of the exited page table, which the new one takes
+            memory.TakePageTableStorage(*current_page_table, *it->first);
+            result = std::move(it->second.jit);
+            // Only the translations of the code stay valid, the rest of the address space may now
+            // hold anything
+            result->InvalidateCacheRange(0, page_table.code_begin);
+            result->InvalidateCacheRange(page_table.code_end,
+                                         ADDRESS_SPACE_SIZE - page_table.code_end);
+            it = jits.erase(it);
+            continue;
+        }
+        if (!it->second.reusable || exited.code_hash == 0 || num_exited >= MAX_EXITED_JITS) {
+            it = jits.erase(it);
+            continue;
+        }
+        ++num_exited;
+        ++it;
+    }
+    return result;
+}
+
 void ARM_Dynarmic::PurgeState() {
     ClearInstructionCache();
 }
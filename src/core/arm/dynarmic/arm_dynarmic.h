@@ -6,10 +6,12 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <dynarmic/A32/a32.h>
 #include "common/common_types.h"
 #include "core/arm/arm_interface.h"
 #include "core/arm/dynarmic/arm_dynarmic_cp15.h"
+#include "core/hle/guest_routines.h"
 
 namespace Memory {
 struct PageTable;
@@ -31,6 +33,12 @@ public:
     void Run() override;
     void Step() override;
 
+    bool CanRunUntilSVC() const override {
+        return true;
+    }
+    void RunUntilSVC() override;
+    bool ServePendingSVC() override;
+
     void SetPC(u32 pc) override;
     u32 GetPC() const override;
     u32 GetReg(int index) const override;
@@ -61,16 +69,39 @@ protected:
 private:
     void ServeBreak();
 
+    /// Returns from the guest routine patched in at the PC, which ran natively
+    void ReturnFromRoutine();
+
     friend class DynarmicUserCallbacks;
     Core::System& system;
     Memory::MemorySystem& memory;
     std::unique_ptr<DynarmicUserCallbacks> cb;
     std::unique_ptr<Dynarmic::A32::Jit> MakeJit();
+    std::unique_ptr<Dynarmic::A32::Jit> TakeExitedJit();
+
+    template <typename Func>
+    void ForEachOtherCore(Func&& func);
+    /// Whether the process of the page table exited, only the JITs of the cores still use it
+    bool IsExited(const std::shared_ptr<Memory::PageTable>& page_table);
 
     u32 fpexc = 0;
     CP15State cp15_state;
 
+    /// Set while running in RunUntilSVC, the SVC is then only recorded
+    bool stop_at_svc = false;
+    std::optional<u32> pending_svc;
+    /// Guest routine accessing memory that only the emulation thread may access, served along
+    /// with the SVCs
+    std::optional<HLE::GuestRoutineCall> pending_routine;
+
     Dynarmic::A32::Jit* jit = nullptr;
     std::shared_ptr<Memory::PageTable> current_page_table = nullptr;
-    std::map<std::shared_ptr<Memory::PageTable>, std::unique_ptr<Dynarmic::A32::Jit>> jits;
+
+    struct CachedJit {
+        std::unique_ptr<Dynarmic::A32::Jit> jit;
+        /// Cleared once the code of the process was patched, the translations then only apply to
+        /// that process
+        bool reusable = true;
+    };
+    std::map<std::shared_ptr<Memory::PageTable>, CachedJit> jits;
 };
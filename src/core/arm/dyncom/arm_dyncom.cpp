@@ -22,9 +22,11 @@ public:
     void Reset() override {
         cpu_registers = {};
         cpsr = 0;
-        fpu_registers = {};
-        fpscr = 0;
-        fpexc = 0;
+        for (std::size_t i = 0; i < vfp->ext_regs.size(); ++i) {
+            vfp->SetExtReg(i, 0);
+        }
+        vfp->SetFpscr(0);
+        vfp->SetFpexc(0);
     }
 
     u32 GetCpuRegister(std::size_t index) const override {
@@ -40,22 +42,22 @@ public:
         cpsr = value;
     }
     u32 GetFpuRegister(std::size_t index) const override {
-        return fpu_registers[index];
+        return vfp->GetExtReg(index);
     }
     void SetFpuRegister(std::size_t index, u32 value) override {
-        fpu_registers[index] = value;
+        vfp->SetExtReg(index, value);
     }
     u32 GetFpscr() const override {
-        return fpscr;
+        return vfp->GetFpscr();
     }
     void SetFpscr(u32 value) override {
-        fpscr = value;
+        vfp->SetFpscr(value);
     }
     u32 GetFpexc() const override {
-        return fpexc;
+        return vfp->GetFpexc();
     }
     void SetFpexc(u32 value) override {
-        fpexc = value;
+        vfp->SetFpexc(value);
     }
 
 private:
@@ -63,9 +65,8 @@ private:
 
     std::array<u32, 16> cpu_registers;
     u32 cpsr;
-    std::array<u32, 64> fpu_registers;
-    u32 fpscr;
-    u32 fpexc;
+    // Shared with the CPU while it holds these registers, so that either may go away first
+    std::shared_ptr<VFPBank> vfp = std::make_shared<VFPBank>();
 };
 
 ARM_DynCom::ARM_DynCom(Core::System* system, Memory::MemorySystem& memory,
@@ -87,12 +88,11 @@ void ARM_DynCom::Step() {
 }
 
 void ARM_DynCom::ClearInstructionCache() {
-    state->instruction_cache.clear();
-    trans_cache_buf_top = 0;
+    state->trans_cache.Clear();
 }
 
-void ARM_DynCom::InvalidateCacheRange(u32, std::size_t) {
-    ClearInstructionCache();
+void ARM_DynCom::InvalidateCacheRange(u32 start_address, std::size_t length) {
+    state->trans_cache.Invalidate(start_address, length);
 }
 
 void ARM_DynCom::SetPageTable(const std::shared_ptr<Memory::PageTable>& page_table) {
@@ -103,7 +103,9 @@ std::shared_ptr<Memory::PageTable> ARM_DynCom::GetPageTable() const {
     return nullptr;
 }
 
-void ARM_DynCom::PurgeState() {}
+void ARM_DynCom::PurgeState() {
+    state->ResetVFPBanks();
+}
 
 void ARM_DynCom::SetPC(u32 pc) {
     state->Reg[15] = pc;
@@ -122,18 +124,22 @@ void ARM_DynCom::SetReg(int index, u32 value) {
 }
 
 u32 ARM_DynCom::GetVFPReg(int index) const {
+    state->LoadPendingVFP();
     return state->ExtReg[index];
 }
 
 void ARM_DynCom::SetVFPReg(int index, u32 value) {
+    state->LoadPendingVFP();
     state->ExtReg[index] = value;
 }
 
 u32 ARM_DynCom::GetVFPSystemReg(VFPSystemRegister reg) const {
+    state->LoadPendingVFP();
     return state->VFP[reg];
 }
 
 void ARM_DynCom::SetVFPSystemReg(VFPSystemRegister reg, u32 value) {
+    state->LoadPendingVFP();
     state->VFP[reg] = value;
 }
 
@@ -172,9 +178,8 @@ void ARM_DynCom::SaveContext(const std::unique_ptr<ThreadContext>& arg) {
 
     ctx->cpu_registers = state->Reg;
     ctx->cpsr = state->Cpsr;
-    ctx->fpu_registers = state->ExtReg;
-    ctx->fpscr = state->VFP[VFP_FPSCR];
-    ctx->fpexc = state->VFP[VFP_FPEXC];
+    // The VFP registers stay in the CPU until another thread uses the VFP
+    state->SaveVFPBank(ctx->vfp);
 }
 
 void ARM_DynCom::LoadContext(const std::unique_ptr<ThreadContext>& arg) {
@@ -183,9 +188,7 @@ void ARM_DynCom::LoadContext(const std::unique_ptr<ThreadContext>& arg) {
 
     state->Reg = ctx->cpu_registers;
     state->Cpsr = ctx->cpsr;
-    state->ExtReg = ctx->fpu_registers;
-    state->VFP[VFP_FPSCR] = ctx->fpscr;
-    state->VFP[VFP_FPEXC] = ctx->fpexc;
+    state->SetVFPBank(ctx->vfp);
 }
 
 void ARM_DynCom::PrepareReschedule() {
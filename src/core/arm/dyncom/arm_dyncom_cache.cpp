@@ -0,0 +1,111 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/assert.h"
+#include "core/arm/dyncom/arm_dyncom_cache.h"
+
+TransCache::TransCache() : buffer(std::make_unique<char[]>(SIZE)) {}
+
+TransCache::~TransCache() = default;
+
+std::size_t TransCache::Find(u32 pc) {
+    // ARM and Thumb instructions are at least halfword aligned
+    Slot& slot = slots[(pc >> 1) % NUM_SLOTS];
+    if (slot.block != NO_BLOCK && slot.pc == pc) {
+        return slot.block;
+    }
+    const auto it = blocks.find(pc);
+    if (it == blocks.end()) {
+        return NO_BLOCK;
+    }
+    slot.pc = pc;
+    slot.block = it->second;
+    return it->second;
+}
+
+std::size_t TransCache::BeginBlock() {
+    if (region_end - top < MAX_BLOCK_SIZE + sizeof(TransBlockHeader)) {
+        const std::size_t current_region = top / REGION_SIZE;
+        std::size_t region = 0;
+        for (std::size_t i = 1; i < NUM_REGIONS; ++i) {
+            if (i != current_region && (region == current_region ||
+                                        region_last_use[i] < region_last_use[region])) {
+                region = i;
+            }
+        }
+        EvictRegion(region);
+        top = region * REGION_SIZE;
+        region_end = top + REGION_SIZE;
+        region_last_use[region] = ++use_counter;
+    }
+
+    const std::size_t block = top;
+    auto& header = *static_cast<TransBlockHeader*>(Allocate(sizeof(TransBlockHeader)));
+    header.next_block = NO_BLOCK;
+    return block;
+}
+
+void* TransCache::Allocate(std::size_t size) {
+    const std::size_t start = top;
+    top += size;
+    ASSERT_MSG(top <= region_end, "Translated block is too large");
+    return &buffer[start];
+}
+
+void TransCache::EndBlock(std::size_t block, u32 pc_start, u32 pc_end) {
+    reinterpret_cast<TransBlockHeader*>(&buffer[block])->pc_end = pc_end;
+    blocks[pc_start] = block;
+    Slot& slot = slots[(pc_start >> 1) % NUM_SLOTS];
+    slot.pc = pc_start;
+    slot.block = block;
+}
+
+void TransCache::Invalidate(u32 start, std::size_t length) {
+    if (length == 0) {
+        return;
+    }
+    const u64 end = u64{start} + length;
+    // Blocks end at the end of a page, apart from a Thumb instruction crossing it
+    const u32 first = start >= 0x1000 ? (start & ~0xFFFu) - 0x1000 : 0;
+    bool removed = false;
+    for (auto it = blocks.lower_bound(first); it != blocks.end() && it->first < end;) {
+        const auto& header = *reinterpret_cast<const TransBlockHeader*>(&buffer[it->second]);
+        if (header.pc_end > start) {
+            it = blocks.erase(it);
+            removed = true;
+        } else {
+            ++it;
+        }
+    }
+    if (removed) {
+        ResetLookup();
+    }
+}
+
+void TransCache::Clear() {
+    blocks.clear();
+    ResetLookup();
+    top = 0;
+    region_end = REGION_SIZE;
+    region_last_use.fill(0);
+}
+
+void TransCache::EvictRegion(std::size_t region) {
+    const std::size_t begin = region * REGION_SIZE;
+    const std::size_t end = begin + REGION_SIZE;
+    for (auto it = blocks.begin(); it != blocks.end();) {
+        if (it->second >= begin && it->second < end) {
+            it = blocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    ResetLookup();
+}
+
+void TransCache::ResetLookup() {
+    slots.fill(Slot{});
+    ++epoch;
+}
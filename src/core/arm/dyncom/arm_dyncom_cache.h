@@ -0,0 +1,99 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+
+/// Header in front of the instructions of each translated block
+struct TransBlockHeader {
+    /// Address past the last instruction of the block
+    u32 pc_end;
+    /// Address of the block executed after this one the last time, and the epoch of the cache that
+    /// link was made in. The link is stale once the epoch has changed.
+    u32 next_pc;
+    u32 next_epoch;
+    std::size_t next_block;
+};
+
+/**
+ * Buffer the interpreter translates the instructions of a core into, along with the index of the
+ * translated blocks. Blocks are looked up through a small direct-mapped table in front of the
+ * index, and remember the block that followed them so that the lookup can be skipped for it.
+ * The buffer is split into regions that are recycled least recently executed first once the
+ * buffer is full.
+ */
+class TransCache : NonCopyable {
+public:
+    static constexpr std::size_t NO_BLOCK = ~std::size_t{0};
+
+    TransCache();
+    ~TransCache();
+
+    char* Buffer() const {
+        return buffer.get();
+    }
+
+    /// Changes whenever blocks are removed, which makes all the links between blocks stale
+    u32 Epoch() const {
+        return epoch;
+    }
+
+    /// Returns the offset of the header of the block translated at pc, or NO_BLOCK
+    std::size_t Find(u32 pc);
+
+    /// Starts translating a block, making room for it first. Returns the offset of its header.
+    std::size_t BeginBlock();
+
+    /// Allocates the translation of an instruction of the block being translated
+    void* Allocate(std::size_t size);
+
+    /// Adds the block being translated to the index
+    void EndBlock(std::size_t block, u32 pc_start, u32 pc_end);
+
+    /// Notes the execution of the block, for the recycling of the regions
+    void Touch(std::size_t block) {
+        region_last_use[block / REGION_SIZE] = ++use_counter;
+    }
+
+    /// Removes the blocks overlapping the range
+    void Invalidate(u32 start, std::size_t length);
+
+    /// Removes all the blocks
+    void Clear();
+
+private:
+    static constexpr std::size_t SIZE = 64 * 1024 * 1024;
+    static constexpr std::size_t NUM_REGIONS = 16;
+    static constexpr std::size_t REGION_SIZE = SIZE / NUM_REGIONS;
+    /// Room a block of a full page of instructions is guaranteed to fit in
+    static constexpr std::size_t MAX_BLOCK_SIZE = 512 * 1024;
+    static constexpr std::size_t NUM_SLOTS = 4096;
+
+    struct Slot {
+        u32 pc = 0;
+        std::size_t block = NO_BLOCK;
+    };
+
+    void EvictRegion(std::size_t region);
+    void ResetLookup();
+
+    std::unique_ptr<char[]> buffer;
+    std::size_t top = 0;
+    std::size_t region_end = REGION_SIZE;
+
+    /// Offsets of the block headers by start address
+    std::map<u32, std::size_t> blocks;
+    std::array<Slot, NUM_SLOTS> slots;
+    u32 epoch = 0;
+
+    std::array<u64, NUM_REGIONS> region_last_use{};
+    u64 use_counter = 0;
+};
@@ -21,6 +21,9 @@
 #include "core/core.h"
 #include "core/core_timing.h"
 #include "core/gdbstub/gdbstub.h"
+#include "core/hle/guest_routines.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
 #include "core/hle/kernel/svc.h"
 #include "core/memory.h"
 
@@ -850,7 +853,8 @@ static int InterpreterTranslateBlock(ARMul_State* cpu, std::size_t& bb_start, u3
     ARM_INST_PTR inst_base = nullptr;
     TransExtData ret = TransExtData::NON_BRANCH;
     int size = 0; // instruction size of basic block
-    bb_start = trans_cache_buf_top;
+    current_trans_cache = &cpu->trans_cache;
+    bb_start = cpu->trans_cache.BeginBlock();
 
     u32 phys_addr = addr;
     u32 pc_start = cpu->Reg[15];
@@ -868,7 +872,7 @@ static int InterpreterTranslateBlock(ARMul_State* cpu, std::size_t& bb_start, u3
         ret = inst_base->br;
     };
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    cpu->trans_cache.EndBlock(bb_start, pc_start, phys_addr);
 
     return KEEP_GOING;
 }
@@ -877,18 +881,19 @@ static int InterpreterTranslateSingle(ARMul_State* cpu, std::size_t& bb_start, u
     MICROPROFILE_SCOPE(DynCom_Decode);
 
     ARM_INST_PTR inst_base = nullptr;
-    bb_start = trans_cache_buf_top;
+    current_trans_cache = &cpu->trans_cache;
+    bb_start = cpu->trans_cache.BeginBlock();
 
     u32 phys_addr = addr;
     u32 pc_start = cpu->Reg[15];
 
-    InterpreterTranslateInstruction(cpu, phys_addr, inst_base);
+    const unsigned int inst_size = InterpreterTranslateInstruction(cpu, phys_addr, inst_base);
 
     if (inst_base->br == TransExtData::NON_BRANCH) {
         inst_base->br = TransExtData::SINGLE_STEP;
     }
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    cpu->trans_cache.EndBlock(bb_start, pc_start, phys_addr + inst_size);
 
     return KEEP_GOING;
 }
@@ -1625,7 +1630,10 @@ unsigned InterpreterMainLoop(ARMul_State* cpu) {
     unsigned int addr;
     unsigned int num_instrs = 0;
 
+    char* const trans_cache_buf = cpu->trans_cache.Buffer();
     std::size_t ptr;
+    // Header of the block being executed
+    std::size_t block = TransCache::NO_BLOCK;
 
     LOAD_NZCVT;
 DISPATCH : {
@@ -1640,17 +1648,35 @@ DISPATCH : {
     else
         cpu->Reg[15] &= 0xfffffffc;
 
-    // Find the cached instruction cream, otherwise translate it...
-    auto itr = cpu->instruction_cache.find(cpu->Reg[15]);
-    if (itr != cpu->instruction_cache.end()) {
-        ptr = itr->second;
-    } else if (cpu->NumInstrsToExecute != 1) {
-        if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-            goto END;
+    // Follow the link of the previous block if it still leads here, otherwise find the cached
+    // instruction cream, otherwise translate it...
+    TransCache& trans_cache = cpu->trans_cache;
+    const u32 epoch = trans_cache.Epoch();
+    TransBlockHeader* const previous =
+        block != TransCache::NO_BLOCK ? (TransBlockHeader*)&trans_cache_buf[block] : nullptr;
+    if (previous && previous->next_epoch == epoch && previous->next_pc == cpu->Reg[15] &&
+        previous->next_block != TransCache::NO_BLOCK) {
+        block = previous->next_block;
     } else {
-        if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-            goto END;
+        block = trans_cache.Find(cpu->Reg[15]);
+        if (block == TransCache::NO_BLOCK) {
+            if (cpu->NumInstrsToExecute != 1) {
+                if (InterpreterTranslateBlock(cpu, block, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            } else {
+                if (InterpreterTranslateSingle(cpu, block, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            }
+        }
+        // The previous block is gone if blocks were removed to make room for the translation
+        if (previous && trans_cache.Epoch() == epoch) {
+            previous->next_pc = cpu->Reg[15];
+            previous->next_epoch = epoch;
+            previous->next_block = block;
+        }
     }
+    trans_cache.Touch(block);
+    ptr = block + sizeof(TransBlockHeader);
 
     // Find breakpoint if one exists within the block
     if (GDBStub::IsConnected()) {
@@ -1807,6 +1833,16 @@ BIC_INST : {
 BKPT_INST : {
     if (inst_base->cond == ConditionCode::AL || CondPassed(cpu, inst_base->cond)) {
         bkpt_inst* const inst_cream = (bkpt_inst*)inst_base->component;
+        const auto routine = HLE::GetBreakpointRoutine(inst_cream->imm);
+        if (routine && !cpu->TFlag) {
+            // The guest routine patched in runs natively, then returns as its BX LR would
+            const HLE::GuestRoutineCall call(*routine, cpu->Reg);
+            num_instrs += static_cast<unsigned>(call.GetTicks());
+            call.Run(cpu->memory, *cpu->system->Kernel().GetCurrentProcess());
+            cpu->TFlag = HLE::GuestRoutineCall::Return(cpu->Reg);
+            INC_PC(sizeof(bkpt_inst));
+            goto DISPATCH;
+        }
         LOG_DEBUG(Core_ARM11, "Breakpoint instruction hit. Immediate: {:#010X}", inst_cream->imm);
     }
     cpu->Reg[15] += cpu->GetInstructionSize();
@@ -17,6 +17,10 @@ ARMul_State::ARMul_State(Core::System* system, Memory::MemorySystem& memory,
     ChangePrivilegeMode(initial_mode);
 }
 
+ARMul_State::~ARMul_State() {
+    ResetVFPBanks();
+}
+
 void ARMul_State::ChangePrivilegeMode(u32 new_mode) {
     if (Mode == new_mode)
         return;
@@ -104,6 +108,7 @@ void ARMul_State::ChangePrivilegeMode(u32 new_mode) {
 
 // Performs a reset
 void ARMul_State::Reset() {
+    ResetVFPBanks();
     VFPInit(this);
 
     // Set stack pointer to the top of the stack
@@ -616,3 +621,71 @@ void ARMul_State::ServeBreak() {
         GDBStub::SendTrap(thread, 5);
     }
 }
+
+u32 VFPBank::GetExtReg(std::size_t index) const {
+    return loaded_into ? loaded_into->ExtReg[index] : ext_regs[index];
+}
+
+void VFPBank::SetExtReg(std::size_t index, u32 value) {
+    (loaded_into ? loaded_into->ExtReg[index] : ext_regs[index]) = value;
+}
+
+u32 VFPBank::GetFpscr() const {
+    return loaded_into ? loaded_into->VFP[VFP_FPSCR] : fpscr;
+}
+
+void VFPBank::SetFpscr(u32 value) {
+    (loaded_into ? loaded_into->VFP[VFP_FPSCR] : fpscr) = value;
+}
+
+u32 VFPBank::GetFpexc() const {
+    return loaded_into ? loaded_into->VFP[VFP_FPEXC] : fpexc;
+}
+
+void VFPBank::SetFpexc(u32 value) {
+    (loaded_into ? loaded_into->VFP[VFP_FPEXC] : fpexc) = value;
+}
+
+void ARMul_State::SetVFPBank(std::shared_ptr<VFPBank> bank) {
+    // Switching back to the thread which last used the VFP doesn't swap anything
+    if (bank == loaded_vfp_bank) {
+        pending_vfp_bank = nullptr;
+    } else {
+        pending_vfp_bank = std::move(bank);
+    }
+}
+
+void ARMul_State::SaveVFPBank(const std::shared_ptr<VFPBank>& bank) {
+    if (bank == loaded_vfp_bank || bank == pending_vfp_bank) {
+        return;
+    }
+    // The thread ran with the registers the CPU had before any bank was set
+    ResetVFPBanks();
+    loaded_vfp_bank = bank;
+    bank->loaded_into = this;
+}
+
+void ARMul_State::ResetVFPBanks() {
+    LoadPendingVFP();
+    WriteBackVFPBank();
+}
+
+void ARMul_State::WriteBackVFPBank() {
+    if (!loaded_vfp_bank) {
+        return;
+    }
+    loaded_vfp_bank->ext_regs = ExtReg;
+    loaded_vfp_bank->fpscr = VFP[VFP_FPSCR];
+    loaded_vfp_bank->fpexc = VFP[VFP_FPEXC];
+    loaded_vfp_bank->loaded_into = nullptr;
+    loaded_vfp_bank = nullptr;
+}
+
+void ARMul_State::SwapInVFPBank() {
+    WriteBackVFPBank();
+    ExtReg = pending_vfp_bank->ext_regs;
+    VFP[VFP_FPSCR] = pending_vfp_bank->fpscr;
+    VFP[VFP_FPEXC] = pending_vfp_bank->fpexc;
+    pending_vfp_bank->loaded_into = this;
+    loaded_vfp_bank = std::move(pending_vfp_bank);
+}
@@ -18,8 +18,10 @@
 #pragma once
 
 #include <array>
-#include <unordered_map>
+#include <cstddef>
+#include <memory>
 #include "common/common_types.h"
+#include "core/arm/dyncom/arm_dyncom_cache.h"
 #include "core/arm/skyeye_common/arm_regformat.h"
 #include "core/gdbstub/gdbstub.h"
 
@@ -145,10 +147,33 @@ enum {
     RUN = 3         // Continuous execution
 };
 
+struct ARMul_State;
+
+/**
+ * The VFP registers of a thread. They're only loaded into the CPU once the thread runs a VFP
+ * instruction, until then the CPU keeps those of the last thread which did.
+ */
+struct VFPBank {
+    u32 GetExtReg(std::size_t index) const;
+    void SetExtReg(std::size_t index, u32 value);
+    u32 GetFpscr() const;
+    void SetFpscr(u32 value);
+    u32 GetFpexc() const;
+    void SetFpexc(u32 value);
+
+    std::array<u32, 64> ext_regs{};
+    u32 fpscr = 0;
+    u32 fpexc = 0;
+
+    // The CPU the registers are loaded into, which holds their current values
+    ARMul_State* loaded_into = nullptr;
+};
+
 struct ARMul_State final {
 public:
     explicit ARMul_State(Core::System* system, Memory::MemorySystem& memory,
                          PrivilegeMode initial_mode);
+    ~ARMul_State();
 
     void ChangePrivilegeMode(u32 new_mode);
     void Reset();
@@ -206,6 +231,21 @@ public:
 
     void ServeBreak();
 
+    // Sets the VFP registers of the thread about to run, they're loaded once it uses the VFP
+    void SetVFPBank(std::shared_ptr<VFPBank> bank);
+    // Binds the VFP registers to the bank of the running thread, when its context is saved
+    void SaveVFPBank(const std::shared_ptr<VFPBank>& bank);
+    // Writes the loaded VFP registers back into their bank and forgets the banks, leaving the
+    // registers of the running thread in the CPU
+    void ResetVFPBanks();
+
+    // Called before accessing the VFP registers of the running thread
+    void LoadPendingVFP() {
+        if (pending_vfp_bank) {
+            SwapInVFPBank();
+        }
+    }
+
     Core::System* system;
     Memory::MemorySystem& memory;
 
@@ -254,10 +294,12 @@ public:
 
     // TODO(bunnei): Move this cache to a better place - it should be per codeset (likely per
     // process for our purposes), not per ARMul_State (which tracks CPU core state).
-    std::unordered_map<u32, std::size_t> instruction_cache;
+    TransCache trans_cache;
 
 private:
     void ResetMPCoreCP15Registers();
+    void SwapInVFPBank();
+    void WriteBackVFPBank();
 
     // Defines a reservation granule of 2 words, which protects the first 2 words starting at the
     // tag. This is the smallest granule allowed by the v7 spec, and is coincidentally just large
@@ -269,4 +311,9 @@ private:
 
     GDBStub::BreakpointAddress last_bkpt{};
     bool last_bkpt_hit = false;
+
+    // The bank whose registers are in ExtReg and VFP
+    std::shared_ptr<VFPBank> loaded_vfp_bank;
+    // The bank of the running thread while it hasn't used the VFP since it was scheduled
+    std::shared_ptr<VFPBank> pending_vfp_bank;
 };
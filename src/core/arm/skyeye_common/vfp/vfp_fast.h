@@ -0,0 +1,200 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include "common/common_types.h"
+#include "core/arm/skyeye_common/vfp/asm_vfp.h"
+
+/**
+ * Host FPU fast path for the VFP additions, subtractions, multiplications and divisions. It covers
+ * rounding to nearest and toward zero, the latter being the 3DS default, when both operands are
+ * normal numbers or zeros and the result is a normal number or an exact zero. The denormals,
+ * infinities, NaNs, overflows and underflows are left to the software implementation, so the
+ * flush-to-zero and default NaN modes make no difference here.
+ *
+ * The host rounds to nearest. The exact error of that rounding then gives the inexact flag and
+ * tells whether the result must be moved one step toward zero. Single precision operations are
+ * computed in double precision, where the sums and products of two floats are exact.
+ */
+namespace VFPFast {
+
+enum class Op { Add, Sub, Mul, NegMul, Div };
+
+template <typename T>
+struct Result {
+    T value;
+    u32 exceptions;
+};
+
+template <typename T>
+struct Traits;
+
+template <>
+struct Traits<float> {
+    using Bits = u32;
+    static constexpr int ExponentShift = 23;
+    static constexpr Bits ExponentMask = 0xFF;
+};
+
+template <>
+struct Traits<double> {
+    using Bits = u64;
+    static constexpr int ExponentShift = 52;
+    static constexpr Bits ExponentMask = 0x7FF;
+};
+
+template <typename To, typename From>
+To BitCast(From from) {
+    static_assert(sizeof(To) == sizeof(From));
+    To to;
+    std::memcpy(&to, &from, sizeof(To));
+    return to;
+}
+
+/// Returns the biased exponent of the value
+template <typename T>
+int Exponent(T value) {
+    using Bits = typename Traits<T>::Bits;
+    return static_cast<int>((BitCast<Bits>(value) >> Traits<T>::ExponentShift) &
+                            Traits<T>::ExponentMask);
+}
+
+/// Returns true for the normal numbers and the zeros
+template <typename T>
+bool IsFastOperand(T value) {
+    const int exponent = Exponent(value);
+    return (exponent != 0 && exponent != static_cast<int>(Traits<T>::ExponentMask)) || value == 0;
+}
+
+/// Returns -1, 0 or 1 depending on the sign of the value
+template <typename T>
+int Sign(T value) {
+    return (value > 0) - (value < 0);
+}
+
+/// The result rounded to nearest, with the sign of the exact result minus it
+template <typename T>
+struct Rounded {
+    T value;
+    int error_sign;
+};
+
+inline std::optional<Rounded<float>> Compute(Op op, float a, float b) {
+    switch (op) {
+    case Op::Add: {
+        // The double sum is exact unless the exponents are too far apart
+        if (a != 0 && b != 0 && std::abs(Exponent(a) - Exponent(b)) > 28) {
+            return std::nullopt;
+        }
+        const double exact = static_cast<double>(a) + static_cast<double>(b);
+        const float value = static_cast<float>(exact);
+        return Rounded<float>{value, Sign(exact - static_cast<double>(value))};
+    }
+    case Op::Mul: {
+        const double exact = static_cast<double>(a) * static_cast<double>(b);
+        const float value = static_cast<float>(exact);
+        return Rounded<float>{value, Sign(exact - static_cast<double>(value))};
+    }
+    case Op::Div: {
+        // Rounding the double quotient to float still rounds correctly, the remainder is exact as
+        // the product of two floats is and the subtraction cancels
+        const float value = static_cast<float>(static_cast<double>(a) / static_cast<double>(b));
+        const double remainder =
+            static_cast<double>(a) - static_cast<double>(value) * static_cast<double>(b);
+        return Rounded<float>{value, Sign(remainder) * Sign(b)};
+    }
+    default:
+        return std::nullopt;
+    }
+}
+
+inline std::optional<Rounded<double>> Compute(Op op, double a, double b) {
+    // Below this magnitude, the error of a product or the remainder of a quotient may not be
+    // representable. A zero from nonzero operands underflowed.
+    constexpr double MinExactMagnitude = std::numeric_limits<double>::min() * 0x1p53;
+    switch (op) {
+    case Op::Add: {
+        // Knuth's two-sum gives the exact error of the sum
+        const double value = a + b;
+        const double b_virtual = value - a;
+        const double error = (a - (value - b_virtual)) + (b - b_virtual);
+        return Rounded<double>{value, Sign(error)};
+    }
+    case Op::Mul: {
+        const double value = a * b;
+        if (value == 0 ? a != 0 && b != 0 : std::abs(value) < MinExactMagnitude) {
+            return std::nullopt;
+        }
+        return Rounded<double>{value, Sign(std::fma(a, b, -value))};
+    }
+    case Op::Div: {
+        const double value = a / b;
+        if (value == 0 ? a != 0
+                       : std::abs(value) < MinExactMagnitude || std::abs(a) < MinExactMagnitude) {
+            return std::nullopt;
+        }
+        return Rounded<double>{value, Sign(std::fma(-value, b, a)) * Sign(b)};
+    }
+    default:
+        return std::nullopt;
+    }
+}
+
+/**
+ * Computes a op b as the VFP would, or returns nothing when the software implementation must be
+ * used. Sub and NegMul are Add and Mul with the second operand or the result negated.
+ */
+template <typename T>
+std::optional<Result<T>> Calculate(Op op, T a, T b, u32 fpscr) {
+    static_assert(std::is_same_v<T, float> || std::is_same_v<T, double>);
+    using Bits = typename Traits<T>::Bits;
+
+    const u32 rounding_mode = fpscr & FPSCR_RMODE_MASK;
+    if ((rounding_mode != FPSCR_ROUND_NEAREST && rounding_mode != FPSCR_ROUND_TOZERO) ||
+        !IsFastOperand(a) || !IsFastOperand(b) || (op == Op::Div && b == 0)) {
+        return std::nullopt;
+    }
+
+    bool negate_result = false;
+    if (op == Op::Sub) {
+        b = -b;
+        op = Op::Add;
+    } else if (op == Op::NegMul) {
+        negate_result = true;
+        op = Op::Mul;
+    }
+
+    const auto rounded = Compute(op, a, b);
+    if (!rounded) {
+        return std::nullopt;
+    }
+    T value = rounded->value;
+
+    // Overflows, underflows and results that could become denormal are left to the software path
+    if (value == 0 ? rounded->error_sign != 0
+                   : !std::isfinite(value) || std::abs(value) <= std::numeric_limits<T>::min()) {
+        return std::nullopt;
+    }
+
+    u32 exceptions = 0;
+    if (rounded->error_sign != 0) {
+        exceptions |= FPSCR_IXC;
+        // Rounding to nearest went away from zero, the previous number toward zero is the result
+        if (rounding_mode == FPSCR_ROUND_TOZERO && rounded->error_sign != Sign(value)) {
+            value = BitCast<T>(static_cast<Bits>(BitCast<Bits>(value) - 1));
+        }
+    }
+    if (negate_result) {
+        value = -value;
+    }
+    return Result<T>{value, exceptions};
+}
+
+} // namespace VFPFast
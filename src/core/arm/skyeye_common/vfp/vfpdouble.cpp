@@ -55,6 +55,7 @@
 #include "common/logging/log.h"
 #include "core/arm/skyeye_common/vfp/asm_vfp.h"
 #include "core/arm/skyeye_common/vfp/vfp.h"
+#include "core/arm/skyeye_common/vfp/vfp_fast.h"
 #include "core/arm/skyeye_common/vfp/vfp_helper.h"
 
 static struct vfp_double vfp_double_default_qnan = {
@@ -1159,6 +1160,44 @@ invalid:
     return FPSCR_IOC;
 }
 
+/*
+ * Tries the host FPU fast path of VFPFast, returns false if the software implementation must be
+ * used instead.
+ */
+static bool vfp_double_fast_op(ARMul_State* state, u32 op, int dd, int dn, int dm, u32 fpscr,
+                               u32* exceptions) {
+    VFPFast::Op fast_op;
+    switch (op) {
+    case FOP_FADD:
+        fast_op = VFPFast::Op::Add;
+        break;
+    case FOP_FSUB:
+        fast_op = VFPFast::Op::Sub;
+        break;
+    case FOP_FMUL:
+        fast_op = VFPFast::Op::Mul;
+        break;
+    case FOP_FNMUL:
+        fast_op = VFPFast::Op::NegMul;
+        break;
+    case FOP_FDIV:
+        fast_op = VFPFast::Op::Div;
+        break;
+    default:
+        return false;
+    }
+
+    const auto n = VFPFast::BitCast<double>(vfp_get_double(state, dn));
+    const auto m = VFPFast::BitCast<double>(vfp_get_double(state, dm));
+    const auto result = VFPFast::Calculate(fast_op, n, m, fpscr);
+    if (!result) {
+        return false;
+    }
+    vfp_put_double(state, VFPFast::BitCast<u64>(result->value), dd);
+    *exceptions = result->exceptions;
+    return true;
+}
+
 static struct op fops[] = {
     {vfp_double_fmac, 0},  {vfp_double_fmsc, 0},  {vfp_double_fmul, 0},
     {vfp_double_fadd, 0},  {vfp_double_fnmac, 0}, {vfp_double_fnmsc, 0},
@@ -1228,7 +1267,8 @@ u32 vfp_double_cpdo(ARMul_State* state, u32 inst, u32 fpscr) {
             LOG_TRACE(Core_ARM11, "VFP: itr{} ({}{}) = (d{}) op[{}] (d{})",
                       vecitr >> FPSCR_LENGTH_BIT, type, dest, dn, FOP_TO_IDX(op), dm);
 
-        except = fop->fn(state, dest, dn, dm, fpscr);
+        if (!vfp_double_fast_op(state, op, dest, dn, dm, fpscr, &except))
+            except = fop->fn(state, dest, dn, dm, fpscr);
         LOG_TRACE(Core_ARM11, "VFP: itr{}: exceptions={:08x}", vecitr >> FPSCR_LENGTH_BIT, except);
 
         exceptions |= except & ~VFP_NAN_FLAG;
@@ -57,6 +57,7 @@
 #include "common/logging/log.h"
 #include "core/arm/skyeye_common/vfp/asm_vfp.h"
 #include "core/arm/skyeye_common/vfp/vfp.h"
+#include "core/arm/skyeye_common/vfp/vfp_fast.h"
 #include "core/arm/skyeye_common/vfp/vfp_helper.h"
 
 static struct vfp_single vfp_single_default_qnan = {
@@ -1188,6 +1189,43 @@ invalid:
     return FPSCR_IOC;
 }
 
+/*
+ * Tries the host FPU fast path of VFPFast, returns false if the software implementation must be
+ * used instead.
+ */
+static bool vfp_single_fast_op(ARMul_State* state, u32 op, int sd, int sn, s32 m, u32 fpscr,
+                               u32* exceptions) {
+    VFPFast::Op fast_op;
+    switch (op) {
+    case FOP_FADD:
+        fast_op = VFPFast::Op::Add;
+        break;
+    case FOP_FSUB:
+        fast_op = VFPFast::Op::Sub;
+        break;
+    case FOP_FMUL:
+        fast_op = VFPFast::Op::Mul;
+        break;
+    case FOP_FNMUL:
+        fast_op = VFPFast::Op::NegMul;
+        break;
+    case FOP_FDIV:
+        fast_op = VFPFast::Op::Div;
+        break;
+    default:
+        return false;
+    }
+
+    const auto n = VFPFast::BitCast<float>(vfp_get_float(state, sn));
+    const auto result = VFPFast::Calculate(fast_op, n, VFPFast::BitCast<float>(m), fpscr);
+    if (!result) {
+        return false;
+    }
+    vfp_put_float(state, VFPFast::BitCast<s32>(result->value), sd);
+    *exceptions = result->exceptions;
+    return true;
+}
+
 static struct op fops[] = {
     {vfp_single_fmac, 0},  {vfp_single_fmsc, 0},  {vfp_single_fmul, 0},
     {vfp_single_fadd, 0},  {vfp_single_fnmac, 0}, {vfp_single_fnmsc, 0},
@@ -1252,7 +1290,8 @@ u32 vfp_single_cpdo(ARMul_State* state, u32 inst, u32 fpscr) {
             LOG_TRACE(Core_ARM11, "itr{} ({}{}) = (s{}) op[{}] (s{}={:08x})",
                       vecitr >> FPSCR_LENGTH_BIT, type, dest, sn, FOP_TO_IDX(op), sm, m);
 
-        except = fop->fn(state, dest, sn, m, fpscr);
+        if (!vfp_single_fast_op(state, op, dest, sn, m, fpscr, &except))
+            except = fop->fn(state, dest, sn, m, fpscr);
         LOG_TRACE(Core_ARM11, "itr{}: exceptions={:08x}", vecitr >> FPSCR_LENGTH_BIT, except);
 
         exceptions |= except & ~VFP_NAN_FLAG;
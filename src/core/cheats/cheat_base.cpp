@@ -3,7 +3,25 @@
 // Refer to the license.txt file included.
 
 #include "core/cheats/cheat_base.h"
+#include "core/core.h"
+#include "core/hle/service/hid/hid.h"
 
 namespace Cheats {
+
+CheatContext::CheatContext(Core::System& system)
+    : system(system), memory(system.Memory()), page_table(memory.GetCurrentPageTable()),
+      page_pointers(&page_table->GetPointerArray()) {}
+
+u32 CheatContext::GetPadState() {
+    if (!pad_state) {
+        pad_state = system.ServiceManager()
+                        .GetService<Service::HID::Module::Interface>("hid:USER")
+                        ->GetModule()
+                        ->GetState()
+                        .hex;
+    }
+    return *pad_state;
+}
+
 CheatBase::~CheatBase() = default;
 } // namespace Cheats
@@ -4,17 +4,63 @@
 
 #pragma once
 
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <string>
+#include "common/common_types.h"
+#include "core/memory.h"
 
 namespace Core {
 class System;
 }
 
 namespace Cheats {
+
+/**
+ * State shared by the cheats run in one pass of the cheat engine. The emulation doesn't run during
+ * a pass, so what is looked up once stays valid for all of them.
+ */
+class CheatContext {
+public:
+    explicit CheatContext(Core::System& system);
+
+    Core::System& system;
+    Memory::MemorySystem& memory;
+
+    /// Reads guest memory, straight from the host pointer of regular memory pages
+    template <typename T>
+    T Read(VAddr addr) {
+        const u8* page_pointer = (*page_pointers)[addr >> Memory::PAGE_BITS];
+        const u32 page_offset = addr & Memory::PAGE_MASK;
+        if (page_pointer != nullptr && page_offset <= Memory::PAGE_SIZE - sizeof(T)) {
+            T value;
+            std::memcpy(&value, page_pointer + page_offset, sizeof(T));
+            return value;
+        }
+        if constexpr (sizeof(T) == 1) {
+            return memory.Read8(addr);
+        } else if constexpr (sizeof(T) == 2) {
+            return memory.Read16(addr);
+        } else {
+            return memory.Read32(addr);
+        }
+    }
+
+    /// Returns the buttons pressed on the pad
+    u32 GetPadState();
+
+private:
+    /// Keeps the page table of page_pointers alive
+    std::shared_ptr<Memory::PageTable> page_table;
+    const std::array<u8*, Memory::PAGE_TABLE_NUM_ENTRIES>* page_pointers;
+    std::optional<u32> pad_state;
+};
+
 class CheatBase {
 public:
     virtual ~CheatBase();
-    virtual void Execute(Core::System& system) const = 0;
+    virtual void Execute(CheatContext& context) const = 0;
 
     virtual bool IsEnabled() const = 0;
     virtual void SetEnabled(bool enabled) = 0;
@@ -105,9 +105,10 @@ void CheatEngine::LoadCheatFile() {
 void CheatEngine::RunCallback([[maybe_unused]] u64 userdata, int cycles_late) {
     {
         std::shared_lock<std::shared_mutex> lock(cheats_list_mutex);
+        CheatContext context{system};
         for (auto& cheat : cheats_list) {
             if (cheat->IsEnabled()) {
-                cheat->Execute(system);
+                cheat->Execute(context);
             }
         }
     }
@@ -3,7 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
-#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <string>
@@ -13,7 +13,6 @@
 #include "common/string_util.h"
 #include "core/cheats/gateway_cheat.h"
 #include "core/core.h"
-#include "core/hle/service/hid/hid.h"
 #include "core/memory.h"
 
 namespace Cheats {
@@ -28,38 +27,46 @@ struct State {
     bool loop_flag = false;
 };
 
-template <typename T, typename ReadFunction, typename WriteFunction>
-static inline std::enable_if_t<std::is_integral_v<T>> WriteOp(const GatewayCheat::CheatLine& line,
-                                                              const State& state,
-                                                              ReadFunction read_func,
-                                                              WriteFunction write_func,
-                                                              Core::System& system) {
+template <typename T>
+static inline void Write(Memory::MemorySystem& memory, VAddr addr, T value) {
+    if constexpr (sizeof(T) == 1) {
+        memory.Write8(addr, value);
+    } else if constexpr (sizeof(T) == 2) {
+        memory.Write16(addr, value);
+    } else {
+        memory.Write32(addr, value);
+    }
+}
+
+template <typename T>
+static inline std::enable_if_t<std::is_integral_v<T>> WriteOp(
+    const GatewayCheat::Instruction& line, const State& state, CheatContext& context) {
     u32 addr = line.address + state.offset;
-    T val = read_func(addr);
+    T val = context.Read<T>(addr);
     if (val != static_cast<T>(line.value)) {
-        write_func(addr, static_cast<T>(line.value));
-        system.InvalidateCacheRange(addr, sizeof(T));
+        Write<T>(context.memory, addr, static_cast<T>(line.value));
+        context.system.InvalidateCacheRange(addr, sizeof(T));
     }
 }
 
-template <typename T, typename ReadFunction, typename CompareFunc>
-static inline std::enable_if_t<std::is_integral_v<T>> CompOp(const GatewayCheat::CheatLine& line,
-                                                             State& state, ReadFunction read_func,
+template <typename T, typename CompareFunc>
+static inline std::enable_if_t<std::is_integral_v<T>> CompOp(const GatewayCheat::Instruction& line,
+                                                             State& state, CheatContext& context,
                                                              CompareFunc comp) {
     u32 addr = line.address + state.offset;
-    T val = read_func(addr);
+    T val = context.Read<T>(addr);
     if (!comp(val)) {
         state.if_flag++;
     }
 }
 
-static inline void LoadOffsetOp(Memory::MemorySystem& memory, const GatewayCheat::CheatLine& line,
+static inline void LoadOffsetOp(CheatContext& context, const GatewayCheat::Instruction& line,
                                 State& state) {
     u32 addr = line.address + state.offset;
-    state.offset = memory.Read32(addr);
+    state.offset = context.Read<u32>(addr);
 }
 
-static inline void LoopOp(const GatewayCheat::CheatLine& line, State& state) {
+static inline void LoopOp(const GatewayCheat::Instruction& line, State& state) {
     state.loop_flag = state.loop_count < line.value;
     state.loop_count++;
     state.loop_back_line = state.current_line_nr;
@@ -91,90 +98,71 @@ static inline void FullTerminateOp(State& state) {
     }
 }
 
-static inline void SetOffsetOp(const GatewayCheat::CheatLine& line, State& state) {
+static inline void SetOffsetOp(const GatewayCheat::Instruction& line, State& state) {
     state.offset = line.value;
 }
 
-static inline void AddValueOp(const GatewayCheat::CheatLine& line, State& state) {
+static inline void AddValueOp(const GatewayCheat::Instruction& line, State& state) {
     state.reg += line.value;
 }
 
-static inline void SetValueOp(const GatewayCheat::CheatLine& line, State& state) {
+static inline void SetValueOp(const GatewayCheat::Instruction& line, State& state) {
     state.reg = line.value;
 }
 
-template <typename T, typename ReadFunction, typename WriteFunction>
+template <typename T>
 static inline std::enable_if_t<std::is_integral_v<T>> IncrementiveWriteOp(
-    const GatewayCheat::CheatLine& line, State& state, ReadFunction read_func,
-    WriteFunction write_func, Core::System& system) {
+    const GatewayCheat::Instruction& line, State& state, CheatContext& context) {
     u32 addr = line.value + state.offset;
-    T val = read_func(addr);
+    T val = context.Read<T>(addr);
     if (val != static_cast<T>(state.reg)) {
-        write_func(addr, static_cast<T>(state.reg));
-        system.InvalidateCacheRange(addr, sizeof(T));
+        Write<T>(context.memory, addr, static_cast<T>(state.reg));
+        context.system.InvalidateCacheRange(addr, sizeof(T));
     }
     state.offset += sizeof(T);
 }
 
-template <typename T, typename ReadFunction>
-static inline std::enable_if_t<std::is_integral_v<T>> LoadOp(const GatewayCheat::CheatLine& line,
-                                                             State& state, ReadFunction read_func) {
+template <typename T>
+static inline std::enable_if_t<std::is_integral_v<T>> LoadOp(const GatewayCheat::Instruction& line,
+                                                             State& state, CheatContext& context) {
 
     u32 addr = line.value + state.offset;
-    state.reg = read_func(addr);
+    state.reg = context.Read<T>(addr);
 }
 
-static inline void AddOffsetOp(const GatewayCheat::CheatLine& line, State& state) {
+static inline void AddOffsetOp(const GatewayCheat::Instruction& line, State& state) {
     state.offset += line.value;
 }
 
-static inline void JokerOp(const GatewayCheat::CheatLine& line, State& state,
-                           const Core::System& system) {
-    u32 pad_state = system.ServiceManager()
-                        .GetService<Service::HID::Module::Interface>("hid:USER")
-                        ->GetModule()
-                        ->GetState()
-                        .hex;
-    bool pressed = (pad_state & line.value) == line.value;
+static inline void JokerOp(const GatewayCheat::Instruction& line, State& state,
+                           CheatContext& context) {
+    bool pressed = (context.GetPadState() & line.value) == line.value;
     if (!pressed) {
         state.if_flag++;
     }
 }
 
-static inline void PatchOp(const GatewayCheat::CheatLine& line, State& state, Core::System& system,
-                           const std::vector<GatewayCheat::CheatLine>& cheat_lines) {
-    if (state.if_flag > 0) {
-        // Skip over the additional patch lines
-        state.current_line_nr += static_cast<int>(std::ceil(line.value / 8.0));
-        return;
-    }
+static inline void PatchOp(const GatewayCheat::Instruction& line, const State& state,
+                           CheatContext& context, const std::vector<u8>& patch_data) {
     u32 num_bytes = line.value;
     u32 addr = line.address + state.offset;
-    system.InvalidateCacheRange(addr, num_bytes);
+    context.system.InvalidateCacheRange(addr, num_bytes);
 
-    bool first = true;
-    u32 bit_offset = 0;
-    if (num_bytes > 0)
-        state.current_line_nr++; // skip over the current code
+    // The data lines were folded into patch_data in the order the bytes are written
+    const u8* data = patch_data.data() + line.patch_offset;
     while (num_bytes >= 4) {
-        u32 tmp = first ? cheat_lines[state.current_line_nr].first
-                        : cheat_lines[state.current_line_nr].value;
-        if (!first && num_bytes > 4) {
-            state.current_line_nr++;
-        }
-        first = !first;
-        system.Memory().Write32(addr, tmp);
+        u32 tmp;
+        std::memcpy(&tmp, data, sizeof(tmp));
+        context.memory.Write32(addr, tmp);
+        data += 4;
         addr += 4;
         num_bytes -= 4;
     }
     while (num_bytes > 0) {
-        u32 tmp = (first ? cheat_lines[state.current_line_nr].first
-                         : cheat_lines[state.current_line_nr].value) >>
-                  bit_offset;
-        system.Memory().Write8(addr, tmp);
+        context.memory.Write8(addr, *data);
+        data += 1;
         addr += 1;
         num_bytes -= 1;
-        bit_offset += 8;
     }
 }
 
@@ -209,6 +197,7 @@ GatewayCheat::CheatLine::CheatLine(const std::string& line) {
 GatewayCheat::GatewayCheat(std::string name_, std::vector<CheatLine> cheat_lines_,
                            std::string comments_)
     : name(std::move(name_)), cheat_lines(std::move(cheat_lines_)), comments(std::move(comments_)) {
+    Compile();
 }
 
 GatewayCheat::GatewayCheat(std::string name_, std::string code, std::string comments_)
@@ -223,24 +212,49 @@ GatewayCheat::GatewayCheat(std::string name_, std::string code, std::string comm
             temp_cheat_lines.emplace_back(code_lines[i]);
     }
     cheat_lines = std::move(temp_cheat_lines);
+    Compile();
 }
 
 GatewayCheat::~GatewayCheat() = default;
 
-void GatewayCheat::Execute(Core::System& system) const {
-    State state;
+void GatewayCheat::Compile() {
+    program.clear();
+    patch_data.clear();
+    program.reserve(cheat_lines.size());
+    for (std::size_t i = 0; i < cheat_lines.size(); ++i) {
+        const CheatLine& line = cheat_lines[i];
+        Instruction instruction{line.type, line.address, line.value, 0};
+        if (line.type == CheatType::Patch) {
+            // EXXXXXXX YYYYYYYY is followed by the YYYYYYYY bytes of data, eight per line
+            const std::size_t num_lines = (std::size_t{line.value} + 7) / 8;
+            const std::size_t available = std::min(num_lines, cheat_lines.size() - i - 1);
+            if (available < num_lines) {
+                LOG_ERROR(Core_Cheats, "Patch in cheat {} lacks {} data lines", name,
+                          num_lines - available);
+                instruction.value =
+                    static_cast<u32>(std::min<std::size_t>(instruction.value, available * 8));
+            }
+            instruction.patch_offset = static_cast<u32>(patch_data.size());
+            for (std::size_t data_line = 1; data_line <= available; ++data_line) {
+                for (const u32 word : {cheat_lines[i + data_line].first,
+                                       cheat_lines[i + data_line].value}) {
+                    for (u32 byte = 0; byte < 4; ++byte) {
+                        patch_data.push_back(static_cast<u8>(word >> (byte * 8)));
+                    }
+                }
+            }
+            i += available;
+        }
+        program.push_back(instruction);
+    }
+}
 
-    Memory::MemorySystem& memory = system.Memory();
-    auto Read8 = [&memory](VAddr addr) { return memory.Read8(addr); };
-    auto Read16 = [&memory](VAddr addr) { return memory.Read16(addr); };
-    auto Read32 = [&memory](VAddr addr) { return memory.Read32(addr); };
-    auto Write8 = [&memory](VAddr addr, u8 value) { memory.Write8(addr, value); };
-    auto Write16 = [&memory](VAddr addr, u16 value) { memory.Write16(addr, value); };
-    auto Write32 = [&memory](VAddr addr, u32 value) { memory.Write32(addr, value); };
+void GatewayCheat::Execute(CheatContext& context) const {
+    State state;
 
-    for (state.current_line_nr = 0; state.current_line_nr < cheat_lines.size();
+    for (state.current_line_nr = 0; state.current_line_nr < program.size();
          state.current_line_nr++) {
-        auto line = cheat_lines[state.current_line_nr];
+        const Instruction& line = program[state.current_line_nr];
         if (state.if_flag > 0) {
             switch (line.type) {
             case CheatType::GreaterThan32:
@@ -255,12 +269,6 @@ void GatewayCheat::Execute(Core::System& system) const {
                 // Increment the if_flag to handle the end if correctly
                 state.if_flag++;
                 break;
-            case CheatType::Patch:
-                // EXXXXXXX YYYYYYYY
-                // Copies YYYYYYYY bytes from (current code location + 8) to [XXXXXXXX + offset].
-                // We need to call this here to skip the additional patch lines
-                PatchOp(line, state, system, cheat_lines);
-                break;
             case CheatType::Terminator:
                 // D0000000 00000000 - ENDIF
                 TerminateOp(state);
@@ -280,61 +288,63 @@ void GatewayCheat::Execute(Core::System& system) const {
             break;
         case CheatType::Write32:
             // 0XXXXXXX YYYYYYYY - word[XXXXXXX+offset] = YYYYYYYY
-            WriteOp<u32>(line, state, Read32, Write32, system);
+            WriteOp<u32>(line, state, context);
             break;
         case CheatType::Write16:
             // 1XXXXXXX 0000YYYY - half[XXXXXXX+offset] = YYYY
-            WriteOp<u16>(line, state, Read16, Write16, system);
+            WriteOp<u16>(line, state, context);
             break;
         case CheatType::Write8:
             // 2XXXXXXX 000000YY - byte[XXXXXXX+offset] = YY
-            WriteOp<u8>(line, state, Read8, Write8, system);
+            WriteOp<u8>(line, state, context);
             break;
         case CheatType::GreaterThan32:
             // 3XXXXXXX YYYYYYYY - Execute next block IF YYYYYYYY > word[XXXXXXX]   ;unsigned
-            CompOp<u32>(line, state, Read32, [&line](u32 val) -> bool { return line.value > val; });
+            CompOp<u32>(line, state, context,
+                        [&line](u32 val) -> bool { return line.value > val; });
             break;
         case CheatType::LessThan32:
             // 4XXXXXXX YYYYYYYY - Execute next block IF YYYYYYYY < word[XXXXXXX]   ;unsigned
-            CompOp<u32>(line, state, Read32, [&line](u32 val) -> bool { return line.value < val; });
+            CompOp<u32>(line, state, context,
+                        [&line](u32 val) -> bool { return line.value < val; });
             break;
         case CheatType::EqualTo32:
             // 5XXXXXXX YYYYYYYY - Execute next block IF YYYYYYYY == word[XXXXXXX]   ;unsigned
-            CompOp<u32>(line, state, Read32,
+            CompOp<u32>(line, state, context,
                         [&line](u32 val) -> bool { return line.value == val; });
             break;
         case CheatType::NotEqualTo32:
             // 6XXXXXXX YYYYYYYY - Execute next block IF YYYYYYYY != word[XXXXXXX]   ;unsigned
-            CompOp<u32>(line, state, Read32,
+            CompOp<u32>(line, state, context,
                         [&line](u32 val) -> bool { return line.value != val; });
             break;
         case CheatType::GreaterThan16WithMask:
             // 7XXXXXXX ZZZZYYYY - Execute next block IF YYYY > ((not ZZZZ) AND half[XXXXXXX])
-            CompOp<u16>(line, state, Read16, [&line](u16 val) -> bool {
+            CompOp<u16>(line, state, context, [&line](u16 val) -> bool {
                 return static_cast<u16>(line.value) > (static_cast<u16>(~line.value >> 16) & val);
             });
             break;
         case CheatType::LessThan16WithMask:
             // 8XXXXXXX ZZZZYYYY - Execute next block IF YYYY < ((not ZZZZ) AND half[XXXXXXX])
-            CompOp<u16>(line, state, Read16, [&line](u16 val) -> bool {
+            CompOp<u16>(line, state, context, [&line](u16 val) -> bool {
                 return static_cast<u16>(line.value) < (static_cast<u16>(~line.value >> 16) & val);
             });
             break;
         case CheatType::EqualTo16WithMask:
             // 9XXXXXXX ZZZZYYYY - Execute next block IF YYYY = ((not ZZZZ) AND half[XXXXXXX])
-            CompOp<u16>(line, state, Read16, [&line](u16 val) -> bool {
+            CompOp<u16>(line, state, context, [&line](u16 val) -> bool {
                 return static_cast<u16>(line.value) == (static_cast<u16>(~line.value >> 16) & val);
             });
             break;
         case CheatType::NotEqualTo16WithMask:
             // AXXXXXXX ZZZZYYYY - Execute next block IF YYYY <> ((not ZZZZ) AND half[XXXXXXX])
-            CompOp<u16>(line, state, Read16, [&line](u16 val) -> bool {
+            CompOp<u16>(line, state, context, [&line](u16 val) -> bool {
                 return static_cast<u16>(line.value) != (static_cast<u16>(~line.value >> 16) & val);
             });
             break;
         case CheatType::LoadOffset:
             // BXXXXXXX 00000000 - offset = word[XXXXXXX+offset]
-            LoadOffsetOp(system.Memory(), line, state);
+            LoadOffsetOp(context, line, state);
             break;
         case CheatType::Loop: {
             // C0000000 YYYYYYYY - LOOP next block YYYYYYYY times
@@ -374,32 +384,32 @@ void GatewayCheat::Execute(Core::System& system) const {
         }
         case CheatType::IncrementiveWrite32: {
             // D6000000 XXXXXXXX – (32bit) [XXXXXXXX+offset] = reg ; offset += 4
-            IncrementiveWriteOp<u32>(line, state, Read32, Write32, system);
+            IncrementiveWriteOp<u32>(line, state, context);
             break;
         }
         case CheatType::IncrementiveWrite16: {
             // D7000000 XXXXXXXX – (16bit) [XXXXXXXX+offset] = reg & 0xffff ; offset += 2
-            IncrementiveWriteOp<u16>(line, state, Read16, Write16, system);
+            IncrementiveWriteOp<u16>(line, state, context);
             break;
         }
         case CheatType::IncrementiveWrite8: {
             // D8000000 XXXXXXXX – (16bit) [XXXXXXXX+offset] = reg & 0xff ; offset++
-            IncrementiveWriteOp<u8>(line, state, Read8, Write8, system);
+            IncrementiveWriteOp<u8>(line, state, context);
             break;
         }
         case CheatType::Load32: {
             // D9000000 XXXXXXXX – reg = [XXXXXXXX+offset]
-            LoadOp<u32>(line, state, Read32);
+            LoadOp<u32>(line, state, context);
             break;
         }
         case CheatType::Load16: {
             // DA000000 XXXXXXXX – reg = [XXXXXXXX+offset] & 0xFFFF
-            LoadOp<u16>(line, state, Read16);
+            LoadOp<u16>(line, state, context);
             break;
         }
         case CheatType::Load8: {
             // DB000000 XXXXXXXX – reg = [XXXXXXXX+offset] & 0xFF
-            LoadOp<u8>(line, state, Read8);
+            LoadOp<u8>(line, state, context);
             break;
         }
         case CheatType::AddOffset: {
@@ -409,13 +419,13 @@ void GatewayCheat::Execute(Core::System& system) const {
         }
         case CheatType::Joker: {
             // DD000000 XXXXXXXX – if KEYPAD has value XXXXXXXX execute next block
-            JokerOp(line, state, system);
+            JokerOp(line, state, context);
             break;
         }
         case CheatType::Patch: {
             // EXXXXXXX YYYYYYYY
             // Copies YYYYYYYY bytes from (current code location + 8) to [XXXXXXXX + offset].
-            PatchOp(line, state, system, cheat_lines);
+            PatchOp(line, state, context, patch_data);
             break;
         }
         }
@@ -46,18 +46,27 @@ public:
     struct CheatLine {
         explicit CheatLine(const std::string& line);
         CheatType type;
-        u32 address;
-        u32 value;
-        u32 first;
+        u32 address = 0;
+        u32 value = 0;
+        u32 first = 0;
         std::string cheat_line;
         bool valid = true;
     };
 
+    /// A cheat line decoded for execution, the data lines of a Patch are folded into it
+    struct Instruction {
+        CheatType type;
+        u32 address;
+        u32 value;
+        /// Where the data of a Patch starts in patch_data
+        u32 patch_offset;
+    };
+
     GatewayCheat(std::string name, std::vector<CheatLine> cheat_lines, std::string comments);
     GatewayCheat(std::string name, std::string code, std::string comments);
     ~GatewayCheat();
 
-    void Execute(Core::System& system) const override;
+    void Execute(CheatContext& context) const override;
 
     bool IsEnabled() const override;
     void SetEnabled(bool enabled) override;
@@ -78,9 +87,15 @@ public:
     static std::vector<std::unique_ptr<CheatBase>> LoadFile(const std::string& filepath);
 
 private:
+    /// Decodes the cheat lines into the program once, rather than on every execution
+    void Compile();
+
     std::atomic<bool> enabled = false;
     const std::string name;
     std::vector<CheatLine> cheat_lines;
     const std::string comments;
+
+    std::vector<Instruction> program;
+    std::vector<u8> patch_data;
 };
 } // namespace Cheats
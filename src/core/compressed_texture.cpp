@@ -0,0 +1,188 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstring>
+#include <optional>
+#include "common/logging/log.h"
+#include "core/compressed_texture.h"
+#include "core/custom_tex_cache.h"
+
+namespace Core {
+
+namespace {
+
+constexpr u32 MakeFourCC(char a, char b, char c, char d) {
+    return static_cast<u32>(a) | static_cast<u32>(b) << 8 | static_cast<u32>(c) << 16 |
+           static_cast<u32>(d) << 24;
+}
+
+constexpr u32 DDS_MAGIC = MakeFourCC('D', 'D', 'S', ' ');
+constexpr std::size_t DDS_HEADER_SIZE = 4 + 124;
+constexpr std::size_t DDS_DX10_HEADER_SIZE = 20;
+
+constexpr std::array<u8, 12> KTX_IDENTIFIER{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                            0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr std::size_t KTX_HEADER_SIZE = 64;
+constexpr u32 KTX_ENDIANNESS = 0x04030201;
+
+struct BlockInfo {
+    u32 width;
+    u32 height;
+    u32 size;
+};
+
+BlockInfo GetBlockInfo(CustomTexFormat format) {
+    switch (format) {
+    case CustomTexFormat::BC1:
+        return {4, 4, 8};
+    case CustomTexFormat::BC3:
+    case CustomTexFormat::BC7:
+    case CustomTexFormat::ETC2:
+    case CustomTexFormat::ASTC4x4:
+        return {4, 4, 16};
+    case CustomTexFormat::ASTC6x6:
+        return {6, 6, 16};
+    case CustomTexFormat::ASTC8x8:
+        return {8, 8, 16};
+    default:
+        return {1, 1, 4};
+    }
+}
+
+u32 Read32(const std::vector<u8>& file, std::size_t offset) {
+    u32 value;
+    std::memcpy(&value, file.data() + offset, sizeof(value));
+    return value;
+}
+
+std::optional<CustomTexFormat> FromDXGIFormat(u32 dxgi_format) {
+    switch (dxgi_format) {
+    case 70: // DXGI_FORMAT_BC1_TYPELESS
+    case 71: // DXGI_FORMAT_BC1_UNORM
+        return CustomTexFormat::BC1;
+    case 76: // DXGI_FORMAT_BC3_TYPELESS
+    case 77: // DXGI_FORMAT_BC3_UNORM
+        return CustomTexFormat::BC3;
+    case 97: // DXGI_FORMAT_BC7_TYPELESS
+    case 98: // DXGI_FORMAT_BC7_UNORM
+        return CustomTexFormat::BC7;
+    default:
+        return std::nullopt;
+    }
+}
+
+std::optional<CustomTexFormat> FromGLInternalFormat(u32 internal_format) {
+    switch (internal_format) {
+    case 0x83F1: // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+        return CustomTexFormat::BC1;
+    case 0x83F3: // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        return CustomTexFormat::BC3;
+    case 0x8E8C: // GL_COMPRESSED_RGBA_BPTC_UNORM
+        return CustomTexFormat::BC7;
+    case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+        return CustomTexFormat::ETC2;
+    case 0x93B0: // GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+        return CustomTexFormat::ASTC4x4;
+    case 0x93B4: // GL_COMPRESSED_RGBA_ASTC_6x6_KHR
+        return CustomTexFormat::ASTC6x6;
+    case 0x93B7: // GL_COMPRESSED_RGBA_ASTC_8x8_KHR
+        return CustomTexFormat::ASTC8x8;
+    default:
+        return std::nullopt;
+    }
+}
+
+bool LoadDDS(const std::vector<u8>& file, CustomTexInfo& info) {
+    if (file.size() < DDS_HEADER_SIZE || Read32(file, 4) != 124) {
+        return false;
+    }
+    const u32 height = Read32(file, 12);
+    const u32 width = Read32(file, 16);
+    const u32 four_cc = Read32(file, 84);
+
+    std::optional<CustomTexFormat> format;
+    std::size_t data_offset = DDS_HEADER_SIZE;
+    if (four_cc == MakeFourCC('D', 'X', 'T', '1')) {
+        format = CustomTexFormat::BC1;
+    } else if (four_cc == MakeFourCC('D', 'X', 'T', '5')) {
+        format = CustomTexFormat::BC3;
+    } else if (four_cc == MakeFourCC('D', 'X', '1', '0')) {
+        if (file.size() < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) {
+            return false;
+        }
+        format = FromDXGIFormat(Read32(file, DDS_HEADER_SIZE));
+        data_offset += DDS_DX10_HEADER_SIZE;
+    }
+    if (!format) {
+        LOG_ERROR(Render, "Unsupported DDS texture format {:08X}", four_cc);
+        return false;
+    }
+
+    const std::size_t size = GetCustomTexSize(*format, width, height);
+    if (file.size() - data_offset < size) {
+        return false;
+    }
+    info.width = width;
+    info.height = height;
+    info.format = *format;
+    info.tex.assign(file.begin() + data_offset, file.begin() + data_offset + size);
+    return true;
+}
+
+bool LoadKTX(const std::vector<u8>& file, CustomTexInfo& info) {
+    if (file.size() < KTX_HEADER_SIZE + 4 || Read32(file, 12) != KTX_ENDIANNESS) {
+        return false;
+    }
+    const u32 internal_format = Read32(file, 28);
+    const u32 width = Read32(file, 36);
+    const u32 height = Read32(file, 40);
+    const u32 depth = Read32(file, 44);
+    const u32 num_faces = Read32(file, 52);
+    const u32 key_value_size = Read32(file, 60);
+
+    const std::optional<CustomTexFormat> format = FromGLInternalFormat(internal_format);
+    if (!format || depth > 1 || num_faces != 1) {
+        LOG_ERROR(Render, "Unsupported KTX texture format {:04X}", internal_format);
+        return false;
+    }
+
+    const std::size_t size_offset = KTX_HEADER_SIZE + key_value_size;
+    if (file.size() < size_offset + 4) {
+        return false;
+    }
+    const std::size_t image_size = Read32(file, size_offset);
+    const std::size_t data_offset = size_offset + 4;
+    if (image_size != GetCustomTexSize(*format, width, height) ||
+        file.size() - data_offset < image_size) {
+        return false;
+    }
+    info.width = width;
+    info.height = height;
+    info.format = *format;
+    info.tex.assign(file.begin() + data_offset, file.begin() + data_offset + image_size);
+    return true;
+}
+
+} // Anonymous namespace
+
+std::size_t GetCustomTexSize(CustomTexFormat format, u32 width, u32 height) {
+    const BlockInfo block = GetBlockInfo(format);
+    const std::size_t blocks_x = (width + block.width - 1) / block.width;
+    const std::size_t blocks_y = (height + block.height - 1) / block.height;
+    return blocks_x * blocks_y * block.size;
+}
+
+bool LoadCompressedTexture(const std::vector<u8>& file, CustomTexInfo& info) {
+    if (file.size() >= 4 && Read32(file, 0) == DDS_MAGIC) {
+        return LoadDDS(file, info);
+    }
+    if (file.size() >= KTX_IDENTIFIER.size() &&
+        std::memcmp(file.data(), KTX_IDENTIFIER.data(), KTX_IDENTIFIER.size()) == 0) {
+        return LoadKTX(file, info);
+    }
+    return false;
+}
+
+} // namespace Core
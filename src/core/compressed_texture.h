@@ -0,0 +1,27 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+
+struct CustomTexInfo;
+enum class CustomTexFormat : u32;
+
+/// Returns the size in bytes of the base level of a texture in the format
+std::size_t GetCustomTexSize(CustomTexFormat format, u32 width, u32 height);
+
+/**
+ * Reads the base level of a block compressed texture from the contents of a DDS (BC1, BC3, BC7)
+ * or KTX (BCn, ETC2, ASTC) file. The blocks are copied as they are, so the rows must already be
+ * stored bottom to top like the decoded PNGs are flipped to.
+ * @returns false if the file is malformed or holds an unsupported format
+ */
+bool LoadCompressedTexture(const std::vector<u8>& file, CustomTexInfo& info);
+
+} // namespace Core
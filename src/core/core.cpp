@@ -2,16 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <ctime>
 #include <fstream>
 #include <memory>
 #include <stdexcept>
 #include <utility>
 #include <boost/serialization/array.hpp>
+#include <fmt/chrono.h>
 #include "audio_core/dsp_interface.h"
 #include "audio_core/hle/hle.h"
 #include "audio_core/lle/lle.h"
+#include "common/file_util.h"
 #include "common/logging/log.h"
+#include "common/scope_exit.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
 #include "core/arm/arm_interface.h"
 #ifdef ARCHITECTURE_x86_64
 #include "core/arm/dynarmic/arm_dynarmic.h"
@@ -27,6 +32,7 @@
 #include "core/custom_tex_cache.h"
 #include "core/gdbstub/gdbstub.h"
 #include "core/global.h"
+#include "core/guest_profiler.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/process.h"
@@ -40,15 +46,28 @@
 #include "core/hw/hw.h"
 #include "core/hw/lcd.h"
 #include "core/loader/loader.h"
+#include "core/metrics_server.h"
 #include "core/movie.h"
+#include "core/ram_storage.h"
 #include "core/rpc/rpc_server.h"
+#include "core/savestate.h"
 #include "core/settings.h"
+#include "core/title_profile.h"
 #include "network/network.h"
 #include "video_core/renderer_base.h"
 #include "video_core/video_core.h"
 
 namespace Core {
 
+/**
+ * Whether use_multi_core can run the cores on host threads of their own. This depends on an
+ * exclusive monitor shared by the cores, which doesn't exist yet: the dynarmic in externals keeps
+ * the exclusive state inside each JIT and emits LDREX/STREX inline, so cores running at once don't
+ * see each other's exclusive accesses and guest spinlocks and atomics break. Only enable this once
+ * ARM_Dynarmic uses a global exclusive monitor of a newer dynarmic.
+ */
+constexpr bool PARALLEL_CORES_SUPPORTED = false;
+
 /*static*/ System System::s_instance;
 
 template <>
@@ -95,7 +114,8 @@ System::ResultStatus System::RunLoop(bool tight_loop) {
 
     Signal signal{Signal::None};
     u32 param{};
-    {
+    // The signals wait for the frames run ahead to be gone
+    if (!running_ahead) {
         std::lock_guard lock{signal_mutex};
         if (current_signal != Signal::None) {
             signal = current_signal;
@@ -135,10 +155,47 @@ System::ResultStatus System::RunLoop(bool tight_loop) {
         frame_limiter.WaitOnce();
         return ResultStatus::Success;
     }
+    case Signal::Rewind: {
+        try {
+            if (!System::Rewind()) {
+                LOG_INFO(Core, "No rewind point left");
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error rewinding: {}", e.what());
+            status_details = e.what();
+            return ResultStatus::ErrorSavestate;
+        }
+        frame_limiter.WaitOnce();
+        return ResultStatus::Success;
+    }
     default:
         break;
     }
 
+    if (!running_ahead) {
+        if (boot_cache_frame_reached) {
+            SaveBootCache();
+        }
+        try {
+            if (Movie::GetInstance().ServeKeyframes(*this)) {
+                return ResultStatus::Success;
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error seeking the movie: {}", e.what());
+            status_details = e.what();
+            return ResultStatus::ErrorSavestate;
+        }
+        if (rewind_buffer && timing->GetGlobalTicks() >= next_rewind_point_ticks) {
+            TakeRewindPoint();
+        }
+        if (run_ahead_frames != 0 && vblank_count != run_ahead_vblank) {
+            const ResultStatus run_ahead_status = RunAhead();
+            if (run_ahead_status != ResultStatus::Success) {
+                return run_ahead_status;
+            }
+        }
+    }
+
     // All cores should have executed the same amount of ticks. If this is not the case an event was
     // scheduled with a cycles_into_future smaller then the current downcount.
     // So we have to get those cores to the same global time first
@@ -177,45 +234,63 @@ System::ResultStatus System::RunLoop(bool tight_loop) {
             current_core_to_execute->GetTimer().Idle();
             PrepareReschedule();
         } else {
+            ScopedPerfSubsystem cpu_time{PerfSubsystem::CPU};
             if (tight_loop) {
                 current_core_to_execute->Run();
             } else {
                 current_core_to_execute->Step();
             }
+            SampleGuestCode(*current_core_to_execute);
         }
     } else {
         // Now all cores are at the same global time. So we will run them one after the other
         // with a max slice that is the minimum of all max slices of all cores
         // TODO: Make special check for idle since we can easily revert the time of idle cores
-        s64 max_slice = Timing::MAX_SLICE_LENGTH;
+        s64 max_slice = Timing::MAX_SINGLE_CORE_SLICE_LENGTH;
+        std::size_t num_runnable_cores = 0;
         for (const auto& cpu_core : cpu_cores) {
             kernel->SetRunningCPU(cpu_core.get());
             cpu_core->GetTimer().Advance();
             cpu_core->PrepareReschedule();
-            kernel->GetThreadManager(cpu_core->GetID()).Reschedule();
+            auto& thread_manager = kernel->GetThreadManager(cpu_core->GetID());
+            thread_manager.Reschedule();
+            if (thread_manager.GetCurrentThread() != nullptr) {
+                ++num_runnable_cores;
+            }
             max_slice = std::min(max_slice, cpu_core->GetTimer().GetMaxSliceLength());
         }
-        for (auto& cpu_core : cpu_cores) {
-            cpu_core->GetTimer().SetNextSlice(max_slice);
-            auto start_ticks = cpu_core->GetTimer().GetTicks();
-            LOG_TRACE(Core_ARM11, "Core {} running for {} ticks", cpu_core->GetID(),
-                      cpu_core->GetTimer().GetDowncount());
-            running_core = cpu_core.get();
-            kernel->SetRunningCPU(running_core);
-            // If we don't have a currently active thread then don't execute instructions,
-            // instead advance to the next event and try to yield to the next thread
-            if (kernel->GetCurrentThreadManager().GetCurrentThread() == nullptr) {
-                LOG_TRACE(Core_ARM11, "Core {} idling", cpu_core->GetID());
-                cpu_core->GetTimer().Idle();
-                PrepareReschedule();
-            } else {
-                if (tight_loop) {
-                    cpu_core->Run();
+        // Cores running side by side only see each other's writes and wake each other up at slice
+        // boundaries, so their slices stay short
+        if (num_runnable_cores > 1) {
+            max_slice = std::min<s64>(max_slice, Timing::MAX_SLICE_LENGTH);
+        }
+        if (core_threads && tight_loop && !GDBStub::IsServerEnabled()) {
+            RunCoresInParallel(max_slice);
+        } else {
+            for (auto& cpu_core : cpu_cores) {
+                cpu_core->GetTimer().SetNextSlice(max_slice);
+                auto start_ticks = cpu_core->GetTimer().GetTicks();
+                LOG_TRACE(Core_ARM11, "Core {} running for {} ticks", cpu_core->GetID(),
+                          cpu_core->GetTimer().GetDowncount());
+                running_core = cpu_core.get();
+                kernel->SetRunningCPU(running_core);
+                // If we don't have a currently active thread then don't execute instructions,
+                // instead advance to the next event and try to yield to the next thread
+                if (kernel->GetCurrentThreadManager().GetCurrentThread() == nullptr) {
+                    LOG_TRACE(Core_ARM11, "Core {} idling", cpu_core->GetID());
+                    cpu_core->GetTimer().Idle();
+                    PrepareReschedule();
                 } else {
-                    cpu_core->Step();
+                    ScopedPerfSubsystem cpu_time{PerfSubsystem::CPU};
+                    if (tight_loop) {
+                        cpu_core->Run();
+                    } else {
+                        cpu_core->Step();
+                    }
+                    SampleGuestCode(*cpu_core);
                 }
+                max_slice = cpu_core->GetTimer().GetTicks() - start_ticks;
             }
-            max_slice = cpu_core->GetTimer().GetTicks() - start_ticks;
         }
     }
 
@@ -240,6 +315,69 @@ bool System::SendSignal(System::Signal signal, u32 param) {
     return true;
 }
 
+void System::SampleGuestCode(const ARM_Interface& cpu_core) {
+    if (guest_profiler) {
+        guest_profiler->Sample(kernel->GetCurrentProcess()->process_id, cpu_core.GetPC());
+    }
+}
+
+void System::WriteGuestProfile() const {
+    if (!guest_profiler || guest_profiler->GetSampleCount() == 0) {
+        return;
+    }
+    const std::time_t t = std::time(nullptr);
+    const std::string& path = FileUtil::GetUserPath(FileUtil::UserPath::LogDir);
+    // %F Date format expanded is "%Y-%m-%d"
+    const std::string filename =
+        fmt::format("{}/{:%F-%H-%M}_{:016X}_guest.folded", path, *std::localtime(&t), title_id);
+    FileUtil::IOFile file(filename, "w");
+    file.WriteString(guest_profiler->GetFoldedStacks());
+    LOG_INFO(Core, "Wrote {} guest code samples to {}", guest_profiler->GetSampleCount(), filename);
+}
+
+void System::RunCoresInParallel(s64 slice_length) {
+    std::vector<ARM_Interface*> cores;
+    for (auto& cpu_core : cpu_cores) {
+        cpu_core->GetTimer().SetNextSlice(slice_length);
+        running_core = cpu_core.get();
+        kernel->SetRunningCPU(running_core);
+        if (kernel->GetCurrentThreadManager().GetCurrentThread() == nullptr) {
+            LOG_TRACE(Core_ARM11, "Core {} idling", cpu_core->GetID());
+            cpu_core->GetTimer().Idle();
+            PrepareReschedule();
+        } else {
+            cores.push_back(cpu_core.get());
+        }
+    }
+
+    while (!cores.empty()) {
+        core_threads->ParallelFor(cores.size(), 1, [&cores](std::size_t begin, std::size_t end) {
+            ScopedPerfSubsystem cpu_time{PerfSubsystem::CPU};
+            for (std::size_t i = begin; i < end; ++i) {
+                cores[i]->RunUntilSVC();
+            }
+        });
+
+        // The kernel is entered from this thread only, one core after the other. A core goes on
+        // with its slice afterwards unless the SVC asked for a reschedule, which ends the slice
+        // when the cores run one after the other too.
+        std::vector<ARM_Interface*> unfinished_cores;
+        for (ARM_Interface* core : cores) {
+            running_core = core;
+            kernel->SetRunningCPU(running_core);
+            SampleGuestCode(*core);
+            const bool was_reschedule_pending = reschedule_pending;
+            reschedule_pending = false;
+            if (core->ServePendingSVC() && !reschedule_pending &&
+                core->GetTimer().GetDowncount() > 0) {
+                unfinished_cores.push_back(core);
+            }
+            reschedule_pending |= was_reschedule_pending;
+        }
+        cores = std::move(unfinished_cores);
+    }
+}
+
 System::ResultStatus System::SingleStep() {
     return RunLoop(false);
 }
@@ -271,10 +409,30 @@ System::ResultStatus System::Load(Frontend::EmuWindow& emu_window, const std::st
     ASSERT(system_mode.first);
     auto n3ds_mode = app_loader->LoadKernelN3dsMode();
     ASSERT(n3ds_mode.first);
+
+    // Before anything reads the settings the profile of the title overrides
+    u64 profile_program_id = 0;
+    if (Settings::values.use_title_profiles &&
+        app_loader->ReadProgramId(profile_program_id) == Loader::ResultStatus::Success) {
+        title_profile = std::make_unique<Core::TitleProfile>(profile_program_id);
+        if (title_profile->IsEmpty()) {
+            title_profile.reset();
+        } else {
+            title_profile->Apply();
+            Settings::Apply();
+        }
+    }
+
     u32 num_cores = 2;
     if (Settings::values.is_new_3ds) {
         num_cores = 4;
     }
+
+    // The archives take the SDMC and NAND paths when they are created
+    if (Settings::values.use_ram_storage && !ram_storage) {
+        ram_storage = std::make_unique<RamStorage>(Settings::values.ram_storage_template,
+                                                   Settings::values.persist_ram_storage);
+    }
     ResultStatus init_result{Init(emu_window, *system_mode.first, *n3ds_mode.first, num_cores)};
     if (init_result != ResultStatus::Success) {
         LOG_CRITICAL(Core, "Failed to initialize system (Error {})!",
@@ -308,13 +466,21 @@ System::ResultStatus System::Load(Frontend::EmuWindow& emu_window, const std::st
     }
     perf_stats = std::make_unique<PerfStats>(title_id);
     custom_tex_cache = std::make_unique<Core::CustomTexCache>();
+    if (Settings::values.enable_guest_profiler) {
+        guest_profiler = std::make_unique<GuestProfiler>();
+        const auto& code = process->codeset->CodeSegment();
+        guest_profiler->AddModule(process->process_id, process->codeset->name, code.addr,
+                                  code.size, {});
+    }
 
+    const u64 program_id = Kernel().GetCurrentProcess()->codeset->program_id;
     if (Settings::values.custom_textures) {
-        const u64 program_id = Kernel().GetCurrentProcess()->codeset->program_id;
         FileUtil::CreateFullPath(fmt::format(
             "{}textures/{:016X}/", FileUtil::GetUserPath(FileUtil::UserPath::LoadDir), program_id));
         custom_tex_cache->FindCustomTextures(program_id);
     }
+    // Dumping may be turned on while the title is running
+    custom_tex_cache->LoadDumpManifest(program_id);
     if (Settings::values.preload_textures) {
         custom_tex_cache->PreloadTextures(*GetImageInterface());
     }
@@ -323,17 +489,82 @@ System::ResultStatus System::Load(Frontend::EmuWindow& emu_window, const std::st
     m_emu_window = &emu_window;
     m_filepath = filepath;
 
+    // The boot cache only stands for a boot that nothing but its key can change
+    boot_cache_key = 0;
+    boot_cache_frame_reached = false;
+    if (Settings::values.use_boot_cache && !Settings::values.enable_dsp_lle &&
+        !Movie::GetInstance().IsPlayingInput() && !Movie::GetInstance().IsRecordingInput() &&
+        !GDBStub::IsServerEnabled()) {
+        try {
+            if (LoadBootCache()) {
+                LOG_INFO(Core, "Boot restored from the boot cache");
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error loading boot cache, booting again: {}", e.what());
+            System::Shutdown();
+            return Load(emu_window, filepath);
+        }
+    }
+
     // Reset counters and set time origin to current frame
     GetAndResetPerfStats();
     perf_stats->BeginSystemFrame();
     return status;
 }
 
+System::ResultStatus System::InitTracePlayback(Frontend::EmuWindow& emu_window) {
+    // Without an application there is no title to load shaders from the disk cache for
+    VideoCore::g_use_disk_shader_cache = false;
+    const ResultStatus init_result{Init(emu_window, 0, 0, 2)};
+    if (init_result != ResultStatus::Success) {
+        LOG_CRITICAL(Core, "Failed to initialize system (Error {})!",
+                     static_cast<u32>(init_result));
+        System::Shutdown();
+        return init_result;
+    }
+
+    title_id = 0;
+    perf_stats = std::make_unique<PerfStats>(title_id);
+    custom_tex_cache = std::make_unique<Core::CustomTexCache>();
+
+    status = ResultStatus::Success;
+    m_emu_window = &emu_window;
+
+    GetAndResetPerfStats();
+    perf_stats->BeginSystemFrame();
+    return status;
+}
+
 void System::PrepareReschedule() {
     running_core->PrepareReschedule();
     reschedule_pending = true;
 }
 
+void System::NotifyFrameSubmitted() {
+    if (boot_cache_key != 0) {
+        boot_cache_frame_reached = true;
+    }
+    if (rpc_server) {
+        rpc_server->OnFrameSubmitted();
+    }
+}
+
+bool System::NotifyVBlank() {
+    ++vblank_count;
+    if (running_ahead) {
+        return vblank_count == run_ahead_target_vblank;
+    }
+    // The frames of the current time are hidden behind the ones run ahead
+    return !CanRunAhead();
+}
+
+bool System::CanRunAhead() const {
+    if (run_ahead_frames == 0) {
+        return false;
+    }
+    return !Network::GetRoomMember().lock()->IsConnected();
+}
+
 PerfStats::Results System::GetAndResetPerfStats() {
     return (perf_stats && timing) ? perf_stats->GetAndResetStats(timing->GetGlobalTimeUs())
                                   : PerfStats::Results{};
@@ -383,6 +614,28 @@ System::ResultStatus System::Init(Frontend::EmuWindow& emu_window, u32 system_mo
     }
     running_core = cpu_cores[0].get();
 
+    if (!save_state_writer) {
+        save_state_writer = std::make_unique<SaveStateWriter>();
+    }
+    if (Settings::values.enable_rewind && !rewind_buffer) {
+        rewind_buffer = std::make_unique<RewindBuffer>(
+            std::size_t{Settings::values.rewind_buffer_size} * 1024 * 1024);
+        next_rewind_point_ticks = 0;
+    }
+    run_ahead_frames = Settings::values.run_ahead_frames;
+
+    // Cores running in parallel reach the rasterizer cache from their own threads, which only
+    // works when it lives on the GPU thread
+    if (Settings::values.use_multi_core && num_cores > 1 && cpu_cores[0]->CanRunUntilSVC()) {
+        if (!PARALLEL_CORES_SUPPORTED) {
+            LOG_WARNING(Core, "Running the cores in parallel is not supported yet");
+        } else if (Settings::values.use_gpu_thread) {
+            core_threads = std::make_unique<Common::ThreadPool>(num_cores - 1, "CoreThread");
+        } else {
+            LOG_WARNING(Core, "Running the cores in parallel needs the GPU thread");
+        }
+    }
+
     kernel->SetCPUs(cpu_cores);
     kernel->SetRunningCPU(cpu_cores[0].get());
 
@@ -402,6 +655,14 @@ System::ResultStatus System::Init(Frontend::EmuWindow& emu_window, u32 system_mo
 
     rpc_server = std::make_unique<RPC::RPCServer>();
 
+    if (Settings::values.use_metrics_server) {
+        try {
+            metrics_server = std::make_unique<MetricsServer>(Settings::values.metrics_server_port);
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Failed to start the metrics server: {}", e.what());
+        }
+    }
+
     service_manager = std::make_unique<Service::SM::ServiceManager>(*this);
     archive_manager = std::make_unique<Service::FS::ArchiveManager>(*this);
 
@@ -409,11 +670,14 @@ System::ResultStatus System::Init(Frontend::EmuWindow& emu_window, u32 system_mo
     Service::Init(*this);
     GDBStub::DeferStart();
 
+    // The renderer kept across the load of a state refers to the video dumper
+    if (!VideoCore::g_renderer) {
 #ifdef ENABLE_FFMPEG_VIDEO_DUMPER
-    video_dumper = std::make_unique<VideoDumper::FFmpegBackend>();
+        video_dumper = std::make_unique<VideoDumper::FFmpegBackend>();
 #else
-    video_dumper = std::make_unique<VideoDumper::NullBackend>();
+        video_dumper = std::make_unique<VideoDumper::NullBackend>();
 #endif
+    }
 
     VideoCore::ResultStatus result = VideoCore::Init(emu_window, *memory);
     if (result != VideoCore::ResultStatus::Success) {
@@ -525,25 +789,48 @@ void System::Shutdown(bool is_deserializing) {
                                 perf_results.frametime * 1000.0);
     telemetry_session->AddField(Telemetry::FieldType::Performance, "Mean_Frametime_MS",
                                 perf_stats->GetMeanFrametime());
+    telemetry_session->AddField(Telemetry::FieldType::Performance, "Shutdown_PresentLatency",
+                                perf_results.present_latency * 1000.0);
 
     // Shutdown emulation session
-    VideoCore::Shutdown();
+    if (is_deserializing) {
+        VideoCore::ShutdownForStateLoad();
+    } else {
+        VideoCore::Shutdown();
+    }
     HW::Shutdown();
     if (!is_deserializing) {
         GDBStub::Shutdown();
         perf_stats.reset();
+        WriteGuestProfile();
+        guest_profiler.reset();
         cheat_engine.reset();
         app_loader.reset();
+        save_state_writer.reset();
+        rewind_buffer.reset();
     }
     telemetry_session.reset();
     rpc_server.reset();
+    metrics_server.reset();
     archive_manager.reset();
     service_manager.reset();
     dsp_core.reset();
+    core_threads.reset();
     cpu_cores.clear();
     kernel.reset();
     timing.reset();
 
+    // Only once the archives have closed their files
+    if (!is_deserializing) {
+        ram_storage.reset();
+    }
+
+    // The next title starts from the global settings
+    if (!is_deserializing && title_profile) {
+        title_profile.reset();
+        Settings::Apply();
+    }
+
     if (video_dumper->IsDumping()) {
         video_dumper->StopDumping();
     }
@@ -586,9 +873,16 @@ void System::serialize(Archive& ar, const unsigned int file_version) {
         Init(*m_emu_window, *system_mode.first, *n3ds_mode.first, num_cores);
     }
 
-    // flush on save, don't flush on load
-    bool should_flush = !Archive::is_loading::value;
-    Memory::RasterizerClearAll(should_flush);
+    // The rasterizer caches are flushed on save and put back once the state is written. On load
+    // they were detached by Shutdown and are put back below if the memory of the state matches.
+    if (Archive::is_saving::value) {
+        Memory::RasterizerDetachCaches(true);
+    }
+    SCOPE_EXIT({
+        if (Archive::is_saving::value) {
+            Memory::RasterizerReattachCaches();
+        }
+    });
     ar&* timing.get();
     for (u32 i = 0; i < num_cores; i++) {
         ar&* cpu_cores[i].get();
@@ -619,7 +913,8 @@ void System::serialize(Archive& ar, const unsigned int file_version) {
         Service::GSP::SetGlobalModule(*this);
         memory->SetDSP(*dsp_core);
         cheat_engine->Connect();
-        VideoCore::g_renderer->Sync();
+        Memory::RasterizerReattachCaches();
+        VideoCore::RunOnGPUThread([] { VideoCore::g_renderer->Sync(); });
     }
 }
 
@@ -17,9 +17,14 @@
 #include "core/memory.h"
 #include "core/perf_stats.h"
 #include "core/telemetry_session.h"
+#include "core/title_profile.h"
 
 class ARM_Interface;
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace Frontend {
 class EmuWindow;
 }
@@ -61,6 +66,11 @@ class RendererBase;
 
 namespace Core {
 
+class GuestProfiler;
+class MetricsServer;
+class RamStorage;
+class RewindBuffer;
+class SaveStateWriter;
 class Timing;
 
 class System {
@@ -120,7 +130,7 @@ public:
     /// Shutdown and then load again
     void Reset();
 
-    enum class Signal : u32 { None, Shutdown, Reset, Save, Load };
+    enum class Signal : u32 { None, Shutdown, Reset, Save, Load, Rewind };
 
     bool SendSignal(Signal signal, u32 param = 0);
 
@@ -143,6 +153,14 @@ public:
      */
     ResultStatus Load(Frontend::EmuWindow& emu_window, const std::string& filepath);
 
+    /**
+     * Initializes the emulated system without an application, to replay a CiTrace through the GPU
+     * emulation with CiTrace::Player.
+     * @param emu_window Reference to the host-system window used for video output.
+     * @returns ResultStatus code, indicating if the operation succeeded.
+     */
+    ResultStatus InitTracePlayback(Frontend::EmuWindow& emu_window);
+
     /**
      * Indicates if the emulated system is powered on (all subsystems initialized and able to run an
      * application).
@@ -255,6 +273,11 @@ public:
     /// Gets a const reference to the custom texture cache system
     const Core::CustomTexCache& CustomTexCache() const;
 
+    /// Gets the profile overriding the settings for the running title, null when it has none
+    Core::TitleProfile* GetTitleProfile() {
+        return title_profile.get();
+    }
+
     /// Handles loading all custom textures from disk into cache.
     void PreloadCustomTextures();
 
@@ -267,6 +290,9 @@ public:
     std::unique_ptr<PerfStats> perf_stats;
     FrameLimiter frame_limiter;
 
+    /// Samples the guest code run by the cores, null unless enabled
+    std::unique_ptr<GuestProfiler> guest_profiler;
+
     void SetStatus(ResultStatus new_status, const char* details = nullptr) {
         status = new_status;
         if (details) {
@@ -308,6 +334,27 @@ public:
 
     void LoadState(u32 slot);
 
+    /// Serializes the current state into memory, uncompressed
+    std::vector<u8> SaveStateToBuffer() const;
+
+    /// Replaces the current state with one serialized by SaveStateToBuffer
+    void LoadStateFromBuffer(const std::vector<u8>& state);
+
+    /// Steps back to the newest rewind point, returns false if there is none
+    bool Rewind();
+
+    /**
+     * Called when the title submits a frame. The boot cache is written after the first one and the
+     * memory ranges subscribed to over RPC are sent after every one.
+     */
+    void NotifyFrameSubmitted();
+
+    /**
+     * Called at every VBlank, returns whether its frame is shown. When running ahead, only the
+     * last of the frames run ahead is.
+     */
+    bool NotifyVBlank();
+
 private:
     /**
      * Initialize the emulated system.
@@ -322,6 +369,38 @@ private:
     /// Reschedule the core emulation
     void Reschedule();
 
+    /// Runs a slice of all cores at once on the core threads
+    void RunCoresInParallel(s64 slice_length);
+
+    /// Samples the PC of the core, which just ran a slice, if the guest profiler is enabled
+    void SampleGuestCode(const ARM_Interface& cpu_core);
+
+    /// Writes the samples of the guest profiler to the log directory
+    void WriteGuestProfile() const;
+
+    /// Adds the current state to the rewind buffer
+    void TakeRewindPoint();
+
+    /// Returns whether the frames are run ahead, which multiplayer rules out
+    bool CanRunAhead() const;
+
+    /// Runs the frames ahead of the current one, the last of which is shown, then goes back to it
+    ResultStatus RunAhead();
+
+    /// Replaces the freshly loaded title with its cached boot, returns false if there is none
+    bool LoadBootCache();
+
+    /// Writes the current state as the boot cache of the title
+    void SaveBootCache();
+
+    /**
+     * Serializes the state in a forked child, whose copy-on-write view of the memory stays as it
+     * was at the fork while the emulation goes on. Returns false if the state should be saved in
+     * this process: on Windows, when the memory is shared with the fastmem arenas or when the
+     * fork fails.
+     */
+    bool SaveStateInChild(u32 slot) const;
+
     /// AppLoader used to load the current executing application
     std::unique_ptr<Loader::AppLoader> app_loader;
 
@@ -329,6 +408,9 @@ private:
     std::vector<std::shared_ptr<ARM_Interface>> cpu_cores;
     ARM_Interface* running_core = nullptr;
 
+    /// Threads running the cores at the same time, null when they run one after the other
+    std::unique_ptr<Common::ThreadPool> core_threads;
+
     /// DSP core
     std::unique_ptr<AudioCore::DspInterface> dsp_core;
 
@@ -354,12 +436,46 @@ private:
     /// Custom texture cache system
     std::unique_ptr<Core::CustomTexCache> custom_tex_cache;
 
+    /// Settings overridden for the running title, null when it has none
+    std::unique_ptr<Core::TitleProfile> title_profile;
+
     /// Image interface
     std::shared_ptr<Frontend::ImageInterface> registered_image_interface;
 
     /// RPC Server for scripting support
     std::unique_ptr<RPC::RPCServer> rpc_server;
 
+    /// Serves the performance counters over HTTP, null unless enabled
+    std::unique_ptr<MetricsServer> metrics_server;
+
+    /// Writes the save states in the background, kept across the loads of a state
+    std::unique_ptr<SaveStateWriter> save_state_writer;
+
+    /// Recent states to rewind to, null when rewinding is disabled. Kept across the loads of a
+    /// state.
+    std::unique_ptr<RewindBuffer> rewind_buffer;
+    /// Global ticks at which the next rewind point is taken
+    u64 next_rewind_point_ticks = 0;
+
+    /// Number of frames run ahead, 0 when not running ahead
+    u32 run_ahead_frames = 0;
+    /// Number of VBlanks so far, not part of the state so that it goes on across the loads
+    u64 vblank_count = 0;
+    /// VBlank count when the frames were last run ahead, and the one to run ahead to
+    u64 run_ahead_vblank = 0;
+    u64 run_ahead_target_vblank = 0;
+    /// Whether the frames being run are the ones ahead of the current frame
+    bool running_ahead = false;
+
+    /// Storage of the SD card and the NAND of the session, null unless enabled. Kept across the
+    /// loads of a state.
+    std::unique_ptr<RamStorage> ram_storage;
+
+    /// Key of the boot cache to write, 0 once it is written or when there is none to write
+    u64 boot_cache_key = 0;
+    /// Set by the first frame of the title, the boot cache is written at the next loop
+    bool boot_cache_frame_reached = false;
+
     std::unique_ptr<Service::FS::ArchiveManager> archive_manager;
 
     std::unique_ptr<Memory::MemorySystem> memory;
@@ -64,26 +64,21 @@ void Timing::ScheduleEvent(s64 cycles_into_future, const TimingEventType* event_
         if (!timer->is_timer_sane)
             timer->ForceExceptionCheck(cycles_into_future);
 
-        timer->event_queue.emplace_back(
-            Event{timeout, timer->event_fifo_id++, userdata, event_type});
-        std::push_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
+        timer->PushEvent(Event{timeout, timer->event_fifo_id++, userdata, event_type});
     } else {
-        timer->ts_queue.Push(Event{static_cast<s64>(timer->GetTicks() + cycles_into_future), 0,
-                                   userdata, event_type});
+        const Event event{static_cast<s64>(timer->GetTicks() + cycles_into_future), 0, userdata,
+                          event_type};
+        if (!timer->ts_queue.TryPush(event)) {
+            std::lock_guard lock{timer->ts_overflow_mutex};
+            timer->ts_overflow.push_back(event);
+            timer->has_ts_overflow.store(true, std::memory_order_release);
+        }
     }
 }
 
 void Timing::UnscheduleEvent(const TimingEventType* event_type, u64 userdata) {
-    for (auto timer : timers) {
-        auto itr = std::remove_if(
-            timer->event_queue.begin(), timer->event_queue.end(),
-            [&](const Event& e) { return e.type == event_type && e.userdata == userdata; });
-
-        // Removing random items breaks the invariant so we have to re-establish it.
-        if (itr != timer->event_queue.end()) {
-            timer->event_queue.erase(itr, timer->event_queue.end());
-            std::make_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
-        }
+    for (auto& timer : timers) {
+        timer->CancelEvents({event_type, userdata});
     }
     // TODO:remove events from ts_queue
 }
@@ -97,6 +92,7 @@ void Timing::RemoveEvent(const TimingEventType* event_type) {
         if (itr != timer->event_queue.end()) {
             timer->event_queue.erase(itr, timer->event_queue.end());
             std::make_heap(timer->event_queue.begin(), timer->event_queue.end(), std::greater<>());
+            timer->RebuildPendingEvents();
         }
     }
     // TODO:remove events from ts_queue
@@ -157,10 +153,74 @@ void Timing::Timer::ForceExceptionCheck(s64 cycles) {
 }
 
 void Timing::Timer::MoveEvents() {
-    for (Event ev; ts_queue.Pop(ev);) {
+    // Popping doesn't lock, the events are taken from the ring all at once
+    ts_queue.PopAll([this](Event ev) {
         ev.fifo_order = event_fifo_id++;
-        event_queue.emplace_back(std::move(ev));
-        std::push_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+        PushEvent(std::move(ev));
+    });
+    if (has_ts_overflow.load(std::memory_order_acquire)) {
+        std::lock_guard lock{ts_overflow_mutex};
+        has_ts_overflow.store(false, std::memory_order_relaxed);
+        for (Event& ev : ts_overflow) {
+            ev.fifo_order = event_fifo_id++;
+            PushEvent(std::move(ev));
+        }
+        ts_overflow.clear();
+    }
+}
+
+void Timing::Timer::PushEvent(Event event) {
+    ++pending_events[{event.type, event.userdata}].count;
+    event_queue.emplace_back(std::move(event));
+    std::push_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+}
+
+Timing::Event Timing::Timer::PopEvent() {
+    std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+    Event event = std::move(event_queue.back());
+    event_queue.pop_back();
+
+    const auto it = pending_events.find({event.type, event.userdata});
+    if (it != pending_events.end() && --it->second.count == 0) {
+        pending_events.erase(it);
+    }
+    return event;
+}
+
+bool Timing::Timer::IsCancelled(const Event& event) const {
+    const auto it = pending_events.find({event.type, event.userdata});
+    return it != pending_events.end() && event.fifo_order < it->second.cancel_before;
+}
+
+void Timing::Timer::CancelEvents(const EventKey& key) {
+    const auto it = pending_events.find(key);
+    if (it == pending_events.end()) {
+        return;
+    }
+    it->second.cancel_before = event_fifo_id;
+    DropCancelledFront();
+}
+
+void Timing::Timer::DropCancelledFront() {
+    while (!event_queue.empty() && IsCancelled(event_queue.front())) {
+        PopEvent();
+    }
+}
+
+void Timing::Timer::PurgeCancelled() {
+    auto itr = std::remove_if(event_queue.begin(), event_queue.end(),
+                              [this](const Event& e) { return IsCancelled(e); });
+    if (itr != event_queue.end()) {
+        event_queue.erase(itr, event_queue.end());
+        std::make_heap(event_queue.begin(), event_queue.end(), std::greater<>());
+    }
+    RebuildPendingEvents();
+}
+
+void Timing::Timer::RebuildPendingEvents() {
+    pending_events.clear();
+    for (const Event& event : event_queue) {
+        ++pending_events[{event.type, event.userdata}].count;
     }
 }
 
@@ -170,7 +230,7 @@ s64 Timing::Timer::GetMaxSliceLength() const {
         ASSERT(next_event->time - executed_ticks > 0);
         return next_event->time - executed_ticks;
     }
-    return MAX_SLICE_LENGTH;
+    return MAX_SINGLE_CORE_SLICE_LENGTH;
 }
 
 void Timing::Timer::Advance() {
@@ -185,15 +245,18 @@ void Timing::Timer::Advance() {
     is_timer_sane = true;
 
     while (!event_queue.empty() && event_queue.front().time <= executed_ticks) {
-        Event evt = std::move(event_queue.front());
-        std::pop_heap(event_queue.begin(), event_queue.end(), std::greater<>());
-        event_queue.pop_back();
+        if (IsCancelled(event_queue.front())) {
+            PopEvent();
+            continue;
+        }
+        Event evt = PopEvent();
         if (evt.type->callback != nullptr) {
             evt.type->callback(evt.userdata, executed_ticks - evt.time);
         } else {
             LOG_ERROR(Core, "Event '{}' has no callback", *evt.type->name);
         }
     }
+    DropCancelledFront();
 
     is_timer_sane = false;
 }
@@ -17,12 +17,16 @@
  *   ScheduleEvent(periodInCycles - cyclesLate, callback, "whatever")
  */
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <limits>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
+#include <boost/functional/hash.hpp>
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 #include "common/common_types.h"
@@ -178,6 +182,9 @@ public:
     // run small slices to sync up again. This is especially important for events that are always
     // scheduled and repated.
     static constexpr int MAX_SLICE_LENGTH = BASE_CLOCK_RATE_ARM11 / 234;
+    // When at most one core has a thread to run there is nothing to keep in sync, so the slice
+    // only ends at the next event, up to a frame.
+    static constexpr int MAX_SINGLE_CORE_SLICE_LENGTH = BASE_CLOCK_RATE_ARM11 / 60;
 
     class Timer {
     public:
@@ -205,15 +212,44 @@ public:
 
     private:
         friend class Timing;
+
+        using EventKey = std::pair<const TimingEventType*, u64>;
+
+        struct PendingEvents {
+            /// Number of events with this type and userdata in event_queue, cancelled or not
+            u32 count = 0;
+            /// The events queued before this fifo id have been unscheduled
+            u64 cancel_before = 0;
+        };
+
+        void PushEvent(Event event);
+        Event PopEvent();
+        bool IsCancelled(const Event& event) const;
+        /// Unschedules the queued events with this type and userdata, in constant time
+        void CancelEvents(const EventKey& key);
+        /// Pops the cancelled events at the front of the queue
+        void DropCancelledFront();
+        /// Erases all the cancelled events from the queue
+        void PurgeCancelled();
+        void RebuildPendingEvents();
+
         // The queue is a min-heap using std::make_heap/push_heap/pop_heap.
         // We don't use std::priority_queue because we need to be able to serialize, unserialize and
         // erase arbitrary events (RemoveEvent()) regardless of the queue order. These aren't
         // accomodated by the standard adaptor class.
+        // Unscheduled events are left in the heap and skipped once they reach the front, so that
+        // unscheduling the periodic events doesn't need a scan and a rebuild of the heap.
         std::vector<Event> event_queue;
         u64 event_fifo_id = 0;
+        std::unordered_map<EventKey, PendingEvents, boost::hash<EventKey>> pending_events;
         // the queue for storing the events from other threads threadsafe until they will be added
         // to the event_queue by the emu thread
-        Common::MPSCQueue<Event> ts_queue;
+        Common::BoundedMPSCQueue<Event, 1024> ts_queue;
+        // Where the events go when ts_queue is full. Its owner may only drain ts_queue once the
+        // threads scheduling into it are done, so they can't wait for space.
+        std::mutex ts_overflow_mutex;
+        std::vector<Event> ts_overflow;
+        std::atomic_bool has_ts_overflow{false};
         // Are we in a function that has been called from Advance()
         // If events are sheduled from a function that gets called from Advance(),
         // don't change slice_length and downcount.
@@ -234,6 +270,7 @@ public:
         template <class Archive>
         void serialize(Archive& ar, const unsigned int) {
             MoveEvents();
+            PurgeCancelled();
             // NOTE: ts_queue should be empty now
             // TODO(SaveState): Remove the next two lines when we break compatibility
             s64 x;
@@ -244,6 +281,9 @@ public:
             ar& downcount;
             ar& executed_ticks;
             ar& idled_cycles;
+            if (Archive::is_loading::value) {
+                RebuildPendingEvents();
+            }
         }
         friend class boost::serialization::access;
     };
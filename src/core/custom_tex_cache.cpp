@@ -2,16 +2,36 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
 #include <fmt/format.h>
 #include "common/file_util.h"
 #include "common/texture.h"
+#include "common/thread_pool.h"
 #include "core.h"
+#include "core/compressed_texture.h"
 #include "core/custom_tex_cache.h"
+#include "core/frontend/image_interface.h"
+#include "core/settings.h"
 
 namespace Core {
+
+/// Memory the decoded textures that were not preloaded may take
+constexpr std::size_t MAX_CACHE_SIZE = 512 * 1024 * 1024;
+/// Hashes of the dumped textures, one hexadecimal hash per line
+constexpr char DUMP_MANIFEST_NAME[] = "dumped_textures.txt";
+
 CustomTexCache::CustomTexCache() = default;
 
-CustomTexCache::~CustomTexCache() = default;
+CustomTexCache::~CustomTexCache() {
+    // The workers are joined before the members they use are destroyed
+    stop_decoding = true;
+    worker_pool.reset();
+}
 
 bool CustomTexCache::IsTextureDumped(u64 hash) const {
     return dumped_textures.count(hash);
@@ -21,28 +41,142 @@ void CustomTexCache::SetTextureDumped(const u64 hash) {
     dumped_textures.insert(hash);
 }
 
-bool CustomTexCache::IsTextureCached(u64 hash) const {
-    return custom_textures.count(hash);
+void CustomTexCache::LoadDumpManifest(u64 program_id) {
+    dump_dir = fmt::format("{}textures/{:016X}/",
+                           FileUtil::GetUserPath(FileUtil::UserPath::DumpDir), program_id);
+
+    std::string manifest;
+    FileUtil::ReadFileToString(true, dump_dir + DUMP_MANIFEST_NAME, manifest);
+    std::size_t line_start = 0;
+    while (line_start < manifest.size()) {
+        std::size_t line_end = manifest.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = manifest.size();
+        }
+        const std::string line = manifest.substr(line_start, line_end - line_start);
+        char* end = nullptr;
+        const u64 hash = std::strtoull(line.c_str(), &end, 16);
+        if (end != line.c_str()) {
+            dumped_textures.insert(hash);
+        }
+        line_start = line_end + 1;
+    }
+    if (!dumped_textures.empty()) {
+        LOG_INFO(Render_OpenGL, "{} textures were dumped in earlier sessions",
+                 dumped_textures.size());
+    }
+}
+
+void CustomTexCache::DumpTexture(u64 hash, const std::string& file_name, std::vector<u8>&& pixels,
+                                 u32 width, u32 height,
+                                 std::shared_ptr<Frontend::ImageInterface> image_interface) {
+    SetTextureDumped(hash);
+    if (dump_dir.empty() || !FileUtil::CreateFullPath(dump_dir)) {
+        LOG_ERROR(Render, "Unable to create {}", dump_dir);
+        return;
+    }
+
+    GetWorkerPool().Push([this, hash, path = dump_dir + file_name, pixels = std::move(pixels),
+                         width, height, image_interface = std::move(image_interface)]() mutable {
+        // Files from before the manifest existed are only added to it
+        if (!FileUtil::Exists(path)) {
+            LOG_INFO(Render_OpenGL, "Dumping texture to {}", path);
+            Common::FlipRGBA8Texture(pixels, width, height);
+            if (!image_interface->EncodePNG(path, pixels, width, height,
+                                            Settings::values.fast_texture_dumping)) {
+                LOG_ERROR(Render_OpenGL, "Failed to save decoded texture");
+                return;
+            }
+        }
+        std::lock_guard lock{manifest_mutex};
+        FileUtil::IOFile manifest(dump_dir + DUMP_MANIFEST_NAME, "a");
+        manifest.WriteString(fmt::format("{:016X}\n", hash));
+    });
+}
+
+bool CustomTexCache::LookupTexture(u64 hash, CustomTexInfo& info) {
+    std::lock_guard lock{mutex};
+    const auto it = custom_textures.find(hash);
+    if (it == custom_textures.end()) {
+        return false;
+    }
+    it->second.last_use = ++use_counter;
+    info = it->second.info;
+    return true;
+}
+
+void CustomTexCache::CacheTexture(u64 hash, CustomTexInfo&& info, bool preloaded) {
+    std::lock_guard lock{mutex};
+    auto& cached = custom_textures[hash];
+    cache_size -= cached.preloaded ? 0 : cached.info.tex.size();
+    cached = {std::move(info), ++use_counter, preloaded};
+    if (!preloaded) {
+        cache_size += cached.info.tex.size();
+        EvictTextures(hash);
+    }
+}
+
+bool CustomTexCache::RequestTexture(u64 hash,
+                                    std::shared_ptr<Frontend::ImageInterface> image_interface) {
+    {
+        std::lock_guard lock{mutex};
+        if (failed_textures.count(hash)) {
+            return false;
+        }
+        if (!pending_textures.insert(hash).second) {
+            return true;
+        }
+    }
+
+    // The path map doesn't change once the title has booted
+    std::string path = custom_texture_paths.at(hash).path;
+    GetWorkerPool().Push([this, hash, path = std::move(path),
+                         image_interface = std::move(image_interface)] {
+        if (stop_decoding) {
+            return;
+        }
+        CustomTexInfo info;
+        const bool decoded = DecodeTexture(*image_interface, path, info);
+        if (decoded) {
+            CacheTexture(hash, std::move(info));
+        }
+        std::lock_guard lock{mutex};
+        pending_textures.erase(hash);
+        if (!decoded) {
+            failed_textures.insert(hash);
+        }
+        finished_textures.push_back(hash);
+    });
+    return true;
 }
 
-const CustomTexInfo& CustomTexCache::LookupTexture(u64 hash) const {
-    return custom_textures.at(hash);
+std::vector<u64> CustomTexCache::TakeFinishedTextures() {
+    std::lock_guard lock{mutex};
+    return std::exchange(finished_textures, {});
 }
 
-void CustomTexCache::CacheTexture(u64 hash, const std::vector<u8>& tex, u32 width, u32 height) {
-    custom_textures[hash] = {width, height, tex};
+static bool IsPNGPath(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
 }
 
 void CustomTexCache::AddTexturePath(u64 hash, const std::string& path) {
-    if (custom_texture_paths.count(hash))
-        LOG_ERROR(Core, "Textures {} and {} conflict!", custom_texture_paths[hash].path, path);
-    else
+    const auto it = custom_texture_paths.find(hash);
+    if (it == custom_texture_paths.end()) {
         custom_texture_paths[hash] = {path, hash};
+    } else if (IsPNGPath(it->second.path) != IsPNGPath(path)) {
+        // Packs may keep the PNG next to its compressed copy, which takes less memory
+        if (IsPNGPath(it->second.path)) {
+            it->second.path = path;
+        }
+    } else {
+        LOG_ERROR(Core, "Textures {} and {} conflict!", it->second.path, path);
+    }
 }
 
 void CustomTexCache::FindCustomTextures(u64 program_id) {
     // Custom textures are currently stored as
     // [TitleID]/tex1_[width]x[height]_[64-bit hash]_[format].png
+    // with .dds or .ktx in place of .png for block compressed ones
 
     const std::string load_path = fmt::format(
         "{}textures/{:016X}/", FileUtil::GetUserPath(FileUtil::UserPath::LoadDir), program_id);
@@ -64,9 +198,12 @@ void CustomTexCache::FindCustomTextures(u64 program_id) {
             u32 height;
             u64 hash;
             u32 format; // unused
+            char extension[4]{};
             // TODO: more modern way of doing this
-            if (std::sscanf(file.virtualName.c_str(), "tex1_%ux%u_%llX_%u.png", &width, &height,
-                            &hash, &format) == 4) {
+            if (std::sscanf(file.virtualName.c_str(), "tex1_%ux%u_%llX_%u.%3s", &width, &height,
+                            &hash, &format, extension) == 5 &&
+                (std::strcmp(extension, "png") == 0 || std::strcmp(extension, "dds") == 0 ||
+                 std::strcmp(extension, "ktx") == 0)) {
                 AddTexturePath(hash, file.physicalName);
             }
         }
@@ -74,25 +211,23 @@ void CustomTexCache::FindCustomTextures(u64 program_id) {
 }
 
 void CustomTexCache::PreloadTextures(Frontend::ImageInterface& image_interface) {
+    std::vector<const CustomTexPathInfo*> path_infos;
+    path_infos.reserve(custom_texture_paths.size());
     for (const auto& path : custom_texture_paths) {
-        const auto& path_info = path.second;
-        Core::CustomTexInfo tex_info;
-        if (image_interface.DecodePNG(tex_info.tex, tex_info.width, tex_info.height,
-                                      path_info.path)) {
-            // Make sure the texture size is a power of 2
-            std::bitset<32> width_bits(tex_info.width);
-            std::bitset<32> height_bits(tex_info.height);
-            if (width_bits.count() == 1 && height_bits.count() == 1) {
-                LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path_info.path);
-                Common::FlipRGBA8Texture(tex_info.tex, tex_info.width, tex_info.height);
-                CacheTexture(path_info.hash, tex_info.tex, tex_info.width, tex_info.height);
-            } else {
-                LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2", path_info.path);
+        path_infos.push_back(&path.second);
+    }
+
+    // PNG decoding dominates the boot time of large packs, and the textures are independent
+    Common::ThreadPool pool{std::max(std::thread::hardware_concurrency(), 2u) - 1,
+                            "CustomTexPreload"};
+    pool.ParallelFor(path_infos.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Core::CustomTexInfo tex_info;
+            if (DecodeTexture(image_interface, path_infos[i]->path, tex_info)) {
+                CacheTexture(path_infos[i]->hash, std::move(tex_info), true);
             }
-        } else {
-            LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path_info.path);
         }
-    }
+    });
 }
 
 bool CustomTexCache::CustomTextureExists(u64 hash) const {
@@ -106,4 +241,64 @@ const CustomTexPathInfo& CustomTexCache::LookupTexturePathInfo(u64 hash) const {
 bool CustomTexCache::IsTexturePathMapEmpty() const {
     return custom_texture_paths.size() == 0;
 }
+
+bool CustomTexCache::DecodeTexture(Frontend::ImageInterface& image_interface,
+                                   const std::string& path, CustomTexInfo& info) {
+    if (IsPNGPath(path)) {
+        info.format = CustomTexFormat::RGBA8;
+        if (!image_interface.DecodePNG(info.tex, info.width, info.height, path)) {
+            LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path);
+            return false;
+        }
+    } else {
+        std::string file;
+        FileUtil::ReadFileToString(false, path, file);
+        if (!LoadCompressedTexture({file.begin(), file.end()}, info)) {
+            LOG_ERROR(Render_OpenGL, "Failed to load compressed custom texture {}", path);
+            return false;
+        }
+    }
+
+    // Make sure the texture size is a power of 2
+    const std::bitset<32> width_bits(info.width);
+    const std::bitset<32> height_bits(info.height);
+    if (width_bits.count() != 1 || height_bits.count() != 1) {
+        LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2", path);
+        return false;
+    }
+
+    LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path);
+    if (info.format == CustomTexFormat::RGBA8) {
+        Common::FlipRGBA8Texture(info.tex, info.width, info.height);
+    }
+    return true;
+}
+
+Common::ThreadPool& CustomTexCache::GetWorkerPool() {
+    std::lock_guard lock{mutex};
+    if (!worker_pool) {
+        // The workers run beside the emulation and GPU threads, a couple of them keep up
+        const std::size_t num_workers = std::max(std::thread::hardware_concurrency() / 4, 1u);
+        worker_pool = std::make_unique<Common::ThreadPool>(num_workers, "CustomTexWorker",
+                                                            Common::ThreadRole::Background);
+    }
+    return *worker_pool;
+}
+
+void CustomTexCache::EvictTextures(u64 keep_hash) {
+    while (cache_size > MAX_CACHE_SIZE) {
+        auto lru = custom_textures.end();
+        for (auto it = custom_textures.begin(); it != custom_textures.end(); ++it) {
+            if (!it->second.preloaded && it->first != keep_hash &&
+                (lru == custom_textures.end() || it->second.last_use < lru->second.last_use)) {
+                lru = it;
+            }
+        }
+        if (lru == custom_textures.end()) {
+            return;
+        }
+        cache_size -= lru->second.info.tex.size();
+        custom_textures.erase(lru);
+    }
+}
 } // namespace Core
@@ -4,21 +4,42 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include "common/common_types.h"
 
+namespace Common {
+class ThreadPool;
+} // namespace Common
+
 namespace Frontend {
 class ImageInterface;
 } // namespace Frontend
 
 namespace Core {
+/// Layout of the pixels of a custom texture, RGBA8 for PNGs and block compressed otherwise
+enum class CustomTexFormat : u32 {
+    RGBA8,
+    BC1,
+    BC3,
+    BC7,
+    ETC2,
+    ASTC4x4,
+    ASTC6x6,
+    ASTC8x8,
+};
+
 struct CustomTexInfo {
     u32 width;
     u32 height;
     std::vector<u8> tex;
+    CustomTexFormat format = CustomTexFormat::RGBA8;
 };
 
 // This is to avoid parsing the filename multiple times
@@ -27,6 +48,13 @@ struct CustomTexPathInfo {
     u64 hash;
 };
 
+/**
+ * Index of the custom textures of the running title, built from their file names, and cache of
+ * the decoded ones. Textures are either all decoded when the title boots, or decoded on worker
+ * threads the first time they are used, in which case the least recently used ones are dropped
+ * when the decoded textures go over a memory budget. Dumped textures are encoded on the same
+ * workers, and listed in a manifest next to them so that later sessions skip them.
+ */
 // TODO: think of a better name for this class...
 class CustomTexCache {
 public:
@@ -36,9 +64,29 @@ public:
     bool IsTextureDumped(u64 hash) const;
     void SetTextureDumped(u64 hash);
 
-    bool IsTextureCached(u64 hash) const;
-    const CustomTexInfo& LookupTexture(u64 hash) const;
-    void CacheTexture(u64 hash, const std::vector<u8>& tex, u32 width, u32 height);
+    /// Reads the hashes of the textures of the title that were dumped in earlier sessions
+    void LoadDumpManifest(u64 program_id);
+
+    /**
+     * Marks the texture as dumped, then flips and encodes its RGBA8 pixels to the dump directory
+     * on a worker thread. The hash is added to the manifest once the file has been written.
+     */
+    void DumpTexture(u64 hash, const std::string& file_name, std::vector<u8>&& pixels, u32 width,
+                     u32 height, std::shared_ptr<Frontend::ImageInterface> image_interface);
+
+    /// Copies the decoded texture to info and returns true if it is in memory
+    bool LookupTexture(u64 hash, CustomTexInfo& info);
+    void CacheTexture(u64 hash, CustomTexInfo&& info, bool preloaded = false);
+
+    /**
+     * Queues the decoding of the texture on a worker thread, unless it is already queued. Returns
+     * false if the texture failed to decode before, otherwise its hash is returned by
+     * TakeFinishedTextures once it has been decoded.
+     */
+    bool RequestTexture(u64 hash, std::shared_ptr<Frontend::ImageInterface> image_interface);
+
+    /// Returns the hashes of the requested textures that finished decoding since the last call
+    std::vector<u64> TakeFinishedTextures();
 
     void AddTexturePath(u64 hash, const std::string& path);
     void FindCustomTextures(u64 program_id);
@@ -48,8 +96,44 @@ public:
     bool IsTexturePathMapEmpty() const;
 
 private:
+    struct CachedTexture {
+        CustomTexInfo info;
+        /// Value of use_counter when the texture was last looked up
+        u64 last_use;
+        /// Textures decoded at boot stay in memory
+        bool preloaded;
+    };
+
+    /// Decodes the texture at the path, returns false if it is missing or unusable
+    static bool DecodeTexture(Frontend::ImageInterface& image_interface, const std::string& path,
+                              CustomTexInfo& info);
+
+    /// Returns the pool running the decodes and dumps, creating it on first use
+    Common::ThreadPool& GetWorkerPool();
+
+    /// Drops the least recently used textures that were not preloaded while over the budget,
+    /// except for the one that was just added
+    void EvictTextures(u64 keep_hash);
+
     std::unordered_set<u64> dumped_textures;
-    std::unordered_map<u64, CustomTexInfo> custom_textures;
     std::unordered_map<u64, CustomTexPathInfo> custom_texture_paths;
+
+    /// Directory the textures of the title are dumped to, with a trailing slash
+    std::string dump_dir;
+    /// Guards the appends of the workers to the dump manifest
+    std::mutex manifest_mutex;
+
+    /// Guards the decoded textures and the decode requests, which the workers update
+    std::mutex mutex;
+    std::unordered_map<u64, CachedTexture> custom_textures;
+    std::size_t cache_size = 0;
+    u64 use_counter = 0;
+    std::unordered_set<u64> pending_textures;
+    std::unordered_set<u64> failed_textures;
+    std::vector<u64> finished_textures;
+
+    /// Tells the queued decodes to give up, set on destruction. Queued dumps still finish.
+    std::atomic_bool stop_decoding{false};
+    std::unique_ptr<Common::ThreadPool> worker_pool;
 };
 } // namespace Core
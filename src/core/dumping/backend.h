@@ -13,16 +13,26 @@
 namespace VideoDumper {
 /**
  * Frame dump data for a single screen
- * data is in RGB888 format, left to right then top to bottom
+ * data is left to right then top to bottom, in one of the formats below
  */
 class VideoFrame {
 public:
+    enum class Format {
+        BGRA,    ///< Packed BGRA8888
+        YUV420P, ///< Planar YUV 4:2:0, the Y plane followed by the quarter sized U and V planes
+    };
+
     std::size_t width;
     std::size_t height;
-    u32 stride;
+    u32 stride; ///< Stride of the BGRA data or of the Y plane
+    Format format;
     std::vector<u8> data;
 
-    VideoFrame(std::size_t width_ = 0, std::size_t height_ = 0, u8* data_ = nullptr);
+    VideoFrame(std::size_t width_ = 0, std::size_t height_ = 0, u8* data_ = nullptr,
+               Format format_ = Format::BGRA);
+
+    /// Returns the size of a frame in bytes
+    static std::size_t GetSize(std::size_t width, std::size_t height, Format format);
 };
 
 class Backend {
@@ -35,6 +45,8 @@ public:
     virtual void StopDumping() = 0;
     virtual bool IsDumping() const = 0;
     virtual Layout::FramebufferLayout GetLayout() const = 0;
+    /// Returns the format the frames are preferably sent in, any format is accepted however
+    virtual VideoFrame::Format GetVideoFrameFormat() const = 0;
 };
 
 class NullBackend : public Backend {
@@ -54,5 +66,8 @@ public:
     Layout::FramebufferLayout GetLayout() const override {
         return Layout::FramebufferLayout{};
     }
+    VideoFrame::Format GetVideoFrameFormat() const override {
+        return VideoFrame::Format::BGRA;
+    }
 };
 } // namespace VideoDumper
@@ -2,12 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <unordered_set>
 #include "common/assert.h"
 #include "common/file_util.h"
 #include "common/logging/log.h"
 #include "common/param_package.h"
 #include "common/string_util.h"
+#include "common/thread.h"
 #include "core/dumping/ffmpeg_backend.h"
 #include "core/hw/gpu.h"
 #include "core/settings.h"
@@ -190,6 +192,31 @@ void FFmpegVideoStream::ProcessFrame(VideoFrame& frame) {
         LOG_ERROR(Render, "Frame dropped: resolution does not match");
         return;
     }
+    if (av_frame_make_writable(scaled_frame.get()) < 0) {
+        LOG_ERROR(Render, "Video frame dropped: Could not prepare frame");
+        return;
+    }
+
+    if (frame.format == VideoFrame::Format::YUV420P) {
+        // The frame was converted on the GPU, only the planes have to be copied
+        if (codec_context->pix_fmt != AV_PIX_FMT_YUV420P) {
+            LOG_ERROR(Render, "Frame dropped: the encoder does not take YUV420P frames");
+            return;
+        }
+        const int width = static_cast<int>(frame.width);
+        const int height = static_cast<int>(frame.height);
+        const u8* y_plane = frame.data.data();
+        const u8* u_plane = y_plane + width * height;
+        const u8* v_plane = u_plane + (width / 2) * (height / 2);
+        const u8* planes[4] = {y_plane, u_plane, v_plane, nullptr};
+        const int linesizes[4] = {static_cast<int>(frame.stride), width / 2, width / 2, 0};
+        av_image_copy(scaled_frame->data, scaled_frame->linesize, planes, linesizes,
+                      AV_PIX_FMT_YUV420P, width, height);
+        scaled_frame->pts = frame_count++;
+        SendFrame(scaled_frame.get());
+        return;
+    }
+
     // Prepare frame
     current_frame->data[0] = frame.data.data();
     current_frame->linesize[0] = frame.stride;
@@ -198,10 +225,6 @@ void FFmpegVideoStream::ProcessFrame(VideoFrame& frame) {
     current_frame->height = layout.height;
 
     // Scale the frame
-    if (av_frame_make_writable(scaled_frame.get()) < 0) {
-        LOG_ERROR(Render, "Video frame dropped: Could not prepare frame");
-        return;
-    }
     if (sws_context) {
         sws_scale(sws_context.get(), current_frame->data, current_frame->linesize, 0, layout.height,
                   scaled_frame->data, scaled_frame->linesize);
@@ -212,6 +235,19 @@ void FFmpegVideoStream::ProcessFrame(VideoFrame& frame) {
     SendFrame(scaled_frame.get());
 }
 
+void FFmpegVideoStream::SkipFrames(u64 count) {
+    frame_count += count;
+}
+
+VideoFrame::Format FFmpegVideoStream::GetPreferredFormat() const {
+    // Odd sizes have no whole chroma samples, leave those to swscale
+    if (codec_context && codec_context->pix_fmt == AV_PIX_FMT_YUV420P && layout.width % 2 == 0 &&
+        layout.height % 2 == 0) {
+        return VideoFrame::Format::YUV420P;
+    }
+    return VideoFrame::Format::BGRA;
+}
+
 FFmpegAudioStream::~FFmpegAudioStream() {
     Free();
 }
@@ -465,11 +501,19 @@ void FFmpegMuxer::ProcessVideoFrame(VideoFrame& frame) {
     video_stream.ProcessFrame(frame);
 }
 
+void FFmpegMuxer::SkipVideoFrames(u64 count) {
+    video_stream.SkipFrames(count);
+}
+
 void FFmpegMuxer::ProcessAudioFrame(const VariableAudioFrame& channel0,
                                     const VariableAudioFrame& channel1) {
     audio_stream.ProcessFrame(channel0, channel1);
 }
 
+VideoFrame::Format FFmpegMuxer::GetVideoFrameFormat() const {
+    return video_stream.GetPreferredFormat();
+}
+
 void FFmpegMuxer::FlushVideo() {
     video_stream.Flush();
 }
@@ -506,24 +550,46 @@ bool FFmpegBackend::StartDumping(const std::string& path, const Layout::Framebuf
     }
 
     video_layout = layout;
+    video_frame_format = ffmpeg.GetVideoFrameFormat();
 
     if (video_processing_thread.joinable())
         video_processing_thread.join();
+
+    video_frame_queue.clear();
+    video_queue_depth = std::max<std::size_t>(Settings::values.video_dump_queue_depth, 1);
+    drop_video_frames = Settings::values.video_dump_drop_frames;
+    pending_dropped_frames = 0;
+    video_queue_stats = {};
+    queued_audio_samples = 0;
+
     video_processing_thread = std::thread([&] {
-        event1.Set();
+        Common::SetCurrentThreadRole(Common::ThreadRole::Background);
         while (true) {
-            event2.Wait();
-            current_buffer = (current_buffer + 1) % 2;
-            next_buffer = (current_buffer + 1) % 2;
-            event1.Set();
+            QueuedVideoFrame queued;
+            {
+                std::unique_lock lock{video_queue_mutex};
+                video_queue_cv.wait(lock, [this] { return !video_frame_queue.empty(); });
+                queued = std::move(video_frame_queue.front());
+                video_frame_queue.pop_front();
+            }
+            video_queue_cv.notify_all();
+
             // Process this frame
-            auto& frame = video_frame_buffers[current_buffer];
+            auto& frame = queued.frame;
             if (frame.width == 0 && frame.height == 0) {
                 // An empty frame marks the end of frame data
                 ffmpeg.FlushVideo();
                 break;
             }
+            ffmpeg.SkipVideoFrames(queued.dropped_before);
             ffmpeg.ProcessVideoFrame(frame);
+
+            const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - queued.queue_time);
+            std::lock_guard lock{video_queue_mutex};
+            ++video_queue_stats.frames;
+            video_queue_stats.total_latency += latency;
+            video_queue_stats.max_latency = std::max(video_queue_stats.max_latency, latency);
         }
         // Finish audio execution first if not done yet
         if (audio_processing_thread.joinable())
@@ -534,10 +600,16 @@ bool FFmpegBackend::StartDumping(const std::string& path, const Layout::Framebuf
     if (audio_processing_thread.joinable())
         audio_processing_thread.join();
     audio_processing_thread = std::thread([&] {
+        Common::SetCurrentThreadRole(Common::ThreadRole::Background);
         VariableAudioFrame channel0, channel1;
         while (true) {
             channel0 = audio_frame_queues[0].PopWait();
             channel1 = audio_frame_queues[1].PopWait();
+            {
+                std::lock_guard lock{audio_queue_mutex};
+                queued_audio_samples -= std::min(queued_audio_samples, channel0.size());
+            }
+            audio_queue_cv.notify_all();
             if (channel0.empty()) {
                 // An empty frame marks the end of frame data
                 ffmpeg.FlushAudio();
@@ -554,12 +626,42 @@ bool FFmpegBackend::StartDumping(const std::string& path, const Layout::Framebuf
 }
 
 void FFmpegBackend::AddVideoFrame(VideoFrame frame) {
-    event1.Wait();
-    video_frame_buffers[next_buffer] = std::move(frame);
-    event2.Set();
+    // The empty frame marking the end of the dump is never dropped
+    const bool is_end = frame.width == 0 && frame.height == 0;
+    {
+        std::unique_lock lock{video_queue_mutex};
+        if (!is_end && video_frame_queue.size() >= video_queue_depth) {
+            if (drop_video_frames) {
+                if (video_queue_stats.dropped_frames++ == 0) {
+                    LOG_WARNING(Render, "The video encoder is falling behind, dropping frames");
+                }
+                ++pending_dropped_frames;
+                return;
+            }
+            video_queue_cv.wait(lock,
+                                [this] { return video_frame_queue.size() < video_queue_depth; });
+        }
+        video_frame_queue.push_back(
+            {std::move(frame), std::chrono::steady_clock::now(), pending_dropped_frames});
+        pending_dropped_frames = 0;
+        video_queue_stats.max_depth =
+            std::max(video_queue_stats.max_depth, video_frame_queue.size());
+    }
+    video_queue_cv.notify_all();
+}
+
+/// Audio queued for the encoder is limited to two seconds, after which the emulation waits for it
+constexpr std::size_t MaxQueuedAudioSamples = 2 * AudioCore::native_sample_rate;
+
+void FFmpegBackend::WaitForAudioQueue(std::size_t samples) {
+    std::unique_lock lock{audio_queue_mutex};
+    audio_queue_cv.wait(lock, [this] { return queued_audio_samples < MaxQueuedAudioSamples; });
+    queued_audio_samples += samples;
 }
 
 void FFmpegBackend::AddAudioFrame(AudioCore::StereoFrame16 frame) {
+    WaitForAudioQueue(frame.size());
+
     std::array<VariableAudioFrame, 2> refactored_frame;
     for (auto& channel : refactored_frame) {
         channel.resize(frame.size());
@@ -574,6 +676,7 @@ void FFmpegBackend::AddAudioFrame(AudioCore::StereoFrame16 frame) {
 }
 
 void FFmpegBackend::AddAudioSample(const std::array<s16, 2>& sample) {
+    WaitForAudioQueue(1);
     audio_frame_queues[0].Push(VariableAudioFrame{sample[0]});
     audio_frame_queues[1].Push(VariableAudioFrame{sample[1]});
 }
@@ -600,8 +703,23 @@ Layout::FramebufferLayout FFmpegBackend::GetLayout() const {
     return video_layout;
 }
 
+VideoFrame::Format FFmpegBackend::GetVideoFrameFormat() const {
+    return video_frame_format;
+}
+
 void FFmpegBackend::EndDumping() {
     LOG_INFO(Render, "Ending frame dumping");
+    {
+        std::lock_guard lock{video_queue_mutex};
+        const auto& stats = video_queue_stats;
+        const auto average_latency = stats.frames ? stats.total_latency / stats.frames
+                                                  : std::chrono::microseconds{};
+        LOG_INFO(Render,
+                 "Video queue: {} frames encoded, {} dropped, maximum depth {}, "
+                 "encoding latency {} us on average and {} us at most",
+                 stats.frames, stats.dropped_frames, stats.max_depth, average_latency.count(),
+                 stats.max_latency.count());
+    }
 
     ffmpeg.WriteTrailer();
     ffmpeg.Free();
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <limits>
 #include <memory>
 #include <mutex>
@@ -20,6 +22,7 @@
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
 #include <libswresample/swresample.h>
 #include <libswscale/swscale.h>
@@ -79,6 +82,12 @@ public:
     void Free();
     void ProcessFrame(VideoFrame& frame);
 
+    /// Advances the timestamps past frames that were dropped, keeping the video in sync
+    void SkipFrames(u64 count);
+
+    /// Returns the frame format that can be encoded without a conversion, if any
+    VideoFrame::Format GetPreferredFormat() const;
+
 private:
     struct SwsContextDeleter {
         void operator()(SwsContext* sws_context) const {
@@ -139,7 +148,9 @@ public:
     bool Init(const std::string& path, const Layout::FramebufferLayout& layout);
     void Free();
     void ProcessVideoFrame(VideoFrame& frame);
+    void SkipVideoFrames(u64 count);
     void ProcessAudioFrame(const VariableAudioFrame& channel0, const VariableAudioFrame& channel1);
+    VideoFrame::Format GetVideoFrameFormat() const;
     void FlushVideo();
     void FlushAudio();
     void WriteTrailer();
@@ -162,7 +173,9 @@ private:
 
 /**
  * FFmpeg video dumping backend.
- * This class implements a double buffer.
+ * Frames are queued for the encoding threads. The video queue holds at most
+ * Settings::values.video_dump_queue_depth frames, when it is full the emulation either waits for
+ * the encoder or the frame is dropped. The audio queue is bounded too and always waits.
  */
 class FFmpegBackend : public Backend {
 public:
@@ -175,21 +188,49 @@ public:
     void StopDumping() override;
     bool IsDumping() const override;
     Layout::FramebufferLayout GetLayout() const override;
+    VideoFrame::Format GetVideoFrameFormat() const override;
 
 private:
     void EndDumping();
 
+    /// Waits until the audio queue has room before queueing the given number of samples
+    void WaitForAudioQueue(std::size_t samples);
+
     std::atomic_bool is_dumping = false; ///< Whether the backend is currently dumping
 
     FFmpegMuxer ffmpeg{};
 
     Layout::FramebufferLayout video_layout;
-    std::array<VideoFrame, 2> video_frame_buffers;
-    u32 current_buffer = 0, next_buffer = 1;
-    Common::Event event1, event2;
+    VideoFrame::Format video_frame_format{};
+
+    struct QueuedVideoFrame {
+        VideoFrame frame;
+        std::chrono::steady_clock::time_point queue_time;
+        u64 dropped_before{}; ///< Number of frames dropped since the previous queued one
+    };
+
+    /// Statistics of the video queue, logged when dumping ends
+    struct VideoQueueStats {
+        u64 frames{};
+        u64 dropped_frames{};
+        std::size_t max_depth{};
+        std::chrono::microseconds total_latency{}; ///< From queueing a frame to having encoded it
+        std::chrono::microseconds max_latency{};
+    };
+
+    std::deque<QueuedVideoFrame> video_frame_queue;
+    std::size_t video_queue_depth{};
+    bool drop_video_frames{};
+    u64 pending_dropped_frames{};
+    VideoQueueStats video_queue_stats;
+    std::mutex video_queue_mutex;
+    std::condition_variable video_queue_cv;
     std::thread video_processing_thread;
 
     std::array<Common::SPSCQueue<VariableAudioFrame>, 2> audio_frame_queues;
+    std::size_t queued_audio_samples{}; ///< Samples per channel waiting in audio_frame_queues
+    std::mutex audio_queue_mutex;
+    std::condition_variable audio_queue_cv;
     std::thread audio_processing_thread;
 
     Common::Event processing_ended;
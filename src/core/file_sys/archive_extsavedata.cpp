@@ -16,6 +16,7 @@
 #include "core/file_sys/path_parser.h"
 #include "core/file_sys/savedata_archive.h"
 #include "core/hle/service/fs/archive.h"
+#include "core/settings.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // FileSys namespace
@@ -32,7 +33,8 @@ class FixSizeDiskFile : public DiskFile {
 public:
     FixSizeDiskFile(FileUtil::IOFile&& file, const Mode& mode,
                     std::unique_ptr<DelayGenerator> delay_generator_)
-        : DiskFile(std::move(file), mode, std::move(delay_generator_)) {
+        : DiskFile(std::move(file), mode, std::move(delay_generator_),
+                   Settings::values.buffer_save_writes) {
         size = GetSize();
     }
 
@@ -126,7 +128,7 @@ public:
 
         const auto full_path = path_parser.BuildHostPath(mount_point);
 
-        switch (path_parser.GetHostStatus(mount_point)) {
+        switch (path_parser.GetHostStatus(mount_point, host_status_cache)) {
         case PathParser::InvalidMountPoint:
             LOG_CRITICAL(Service_FS, "(unreachable) Invalid mount point {}", mount_point);
             return ERROR_FILE_NOT_FOUND;
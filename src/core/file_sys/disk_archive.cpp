@@ -20,11 +20,18 @@ SERIALIZE_EXPORT_IMPL(FileSys::DiskDirectory)
 
 namespace FileSys {
 
+DiskFile::~DiskFile() {
+    if (file) {
+        WritePending();
+    }
+}
+
 ResultVal<std::size_t> DiskFile::Read(const u64 offset, const std::size_t length,
                                       u8* buffer) const {
     if (!mode.read_flag)
         return ERROR_INVALID_OPEN_FLAGS;
 
+    WritePending();
     file->Seek(offset, SEEK_SET);
     return MakeResult<std::size_t>(file->ReadBytes(buffer, length));
 }
@@ -34,6 +41,19 @@ ResultVal<std::size_t> DiskFile::Write(const u64 offset, const std::size_t lengt
     if (!mode.write_flag)
         return ERROR_INVALID_OPEN_FLAGS;
 
+    if (write_back && !flush && length < MAX_PENDING_SIZE) {
+        if (!pending_data.empty() && (offset != pending_offset + pending_data.size() ||
+                                      pending_data.size() + length > MAX_PENDING_SIZE)) {
+            WritePending();
+        }
+        if (pending_data.empty()) {
+            pending_offset = offset;
+        }
+        pending_data.insert(pending_data.end(), buffer, buffer + length);
+        return MakeResult<std::size_t>(length);
+    }
+
+    WritePending();
     file->Seek(offset, SEEK_SET);
     std::size_t written = file->WriteBytes(buffer, length);
     if (flush)
@@ -41,20 +61,39 @@ ResultVal<std::size_t> DiskFile::Write(const u64 offset, const std::size_t lengt
     return MakeResult<std::size_t>(written);
 }
 
+void DiskFile::WritePending() const {
+    if (pending_data.empty()) {
+        return;
+    }
+    file->Seek(pending_offset, SEEK_SET);
+    if (file->WriteBytes(pending_data.data(), pending_data.size()) != pending_data.size()) {
+        LOG_ERROR(Service_FS, "Failed to write 0x{:X} bytes at 0x{:X}", pending_data.size(),
+                  pending_offset);
+    }
+    pending_data.clear();
+}
+
 u64 DiskFile::GetSize() const {
-    return file->GetSize();
+    return std::max(file->GetSize(), pending_offset + pending_data.size());
 }
 
 bool DiskFile::SetSize(const u64 size) const {
+    WritePending();
     file->Resize(size);
     file->Flush();
     return true;
 }
 
 bool DiskFile::Close() const {
+    WritePending();
     return file->Close();
 }
 
+void DiskFile::Flush() const {
+    WritePending();
+    file->Flush();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 DiskDirectory::DiskDirectory(const std::string& path) {
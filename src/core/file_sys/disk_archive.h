@@ -23,37 +23,56 @@
 
 namespace FileSys {
 
+/**
+ * A file on the host disk. With write-back enabled, consecutive writes that the guest doesn't ask
+ * to flush are merged in memory and reach the host file in one write when the guest flushes or
+ * closes the file, reads from it, writes somewhere else, or when the state is saved.
+ */
 class DiskFile : public FileBackend {
 public:
     DiskFile(FileUtil::IOFile&& file_, const Mode& mode_,
-             std::unique_ptr<DelayGenerator> delay_generator_)
-        : file(new FileUtil::IOFile(std::move(file_))) {
+             std::unique_ptr<DelayGenerator> delay_generator_, bool write_back_ = false)
+        : file(new FileUtil::IOFile(std::move(file_))), write_back(write_back_) {
         delay_generator = std::move(delay_generator_);
         mode.hex = mode_.hex;
     }
 
+    ~DiskFile() override;
+
     ResultVal<std::size_t> Read(u64 offset, std::size_t length, u8* buffer) const override;
     ResultVal<std::size_t> Write(u64 offset, std::size_t length, bool flush,
                                  const u8* buffer) override;
     u64 GetSize() const override;
     bool SetSize(u64 size) const override;
     bool Close() const override;
-
-    void Flush() const override {
-        file->Flush();
-    }
+    void Flush() const override;
 
 protected:
     Mode mode;
     std::unique_ptr<FileUtil::IOFile> file;
 
 private:
+    /// Most data merged before it is written out
+    static constexpr std::size_t MAX_PENDING_SIZE = 0x40000;
+
+    /// Writes the merged data to the host file
+    void WritePending() const;
+
+    /// Not serialized, the files of a loaded state write through
+    bool write_back = false;
+    mutable std::vector<u8> pending_data;
+    mutable u64 pending_offset = 0;
+
     DiskFile() = default;
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
         ar& boost::serialization::base_object<FileBackend>(*this);
         ar& mode.hex;
+        if (Archive::is_saving::value) {
+            // The state only keeps the position in the file, which must hold everything written
+            WritePending();
+        }
         ar& file;
     }
     friend class boost::serialization::access;
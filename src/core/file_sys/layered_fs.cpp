@@ -4,11 +4,13 @@
 
 #include <algorithm>
 #include <cstring>
+#include <fmt/format.h>
 #include "common/alignment.h"
 #include "common/archives.h"
 #include "common/assert.h"
 #include "common/common_paths.h"
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/string_util.h"
 #include "common/swap.h"
 #include "core/file_sys/layered_fs.h"
@@ -68,6 +70,15 @@ void LayeredFS::Load() {
 
     ASSERT_MSG(header.header_length == sizeof(header), "Header size is incorrect");
 
+    // Without relocations, the tree is loaded to be extracted, which the cache doesn't keep
+    u64 fingerprint = 0;
+    if (load_relocations) {
+        fingerprint = CalculateFingerprint();
+        if (LoadCache(fingerprint)) {
+            return;
+        }
+    }
+
     // TODO: is root always the first directory in table?
     root.parent = &root;
     LoadDirectory(root, 0);
@@ -78,6 +89,10 @@ void LayeredFS::Load() {
     }
 
     RebuildMetadata();
+
+    if (load_relocations) {
+        SaveCache(fingerprint);
+    }
 }
 
 LayeredFS::~LayeredFS() = default;
@@ -275,6 +290,172 @@ void LayeredFS::LoadExtRelocations() {
     }
 }
 
+constexpr u32 LAYERED_FS_CACHE_MAGIC = 0x43534C46; // "FLSC"
+// Bumped whenever the layout of the cache or the way the metadata is built changes
+constexpr u32 LAYERED_FS_CACHE_VERSION = 1;
+
+struct LayeredFSCacheHeader {
+    u32_le magic;
+    u32_le version;
+    u64_le fingerprint;
+    u64_le metadata_size;
+    u64_le data_size;
+    u64_le num_files;
+};
+
+struct LayeredFSCacheFile {
+    u64_le data_offset;
+    u64_le original_offset;
+    u64_le size;
+    u32_le type;
+    u32_le replace_file_path_length;
+    u64_le patched_file_size;
+    // Followed by the replacement file path and the patched file
+};
+
+static void AppendDirectoryListing(const FileUtil::FSTEntry& parent, std::string& listing) {
+    std::vector<const FileUtil::FSTEntry*> entries;
+    for (const auto& entry : parent.children) {
+        entries.push_back(&entry);
+    }
+    // The order of the entries on the disk isn't meaningful
+    std::sort(entries.begin(), entries.end(),
+              [](const auto* a, const auto* b) { return a->physicalName < b->physicalName; });
+    for (const auto* entry : entries) {
+        if (entry->isDirectory) {
+            listing += fmt::format("{}/\n", entry->physicalName);
+            AppendDirectoryListing(*entry, listing);
+        } else {
+            listing += fmt::format("{}:{}:{}\n", entry->physicalName, entry->size,
+                                   FileUtil::GetModificationTime(entry->physicalName));
+        }
+    }
+}
+
+u64 LayeredFS::CalculateFingerprint() const {
+    std::vector<u8> romfs_metadata(header.file_data_offset);
+    romfs->ReadFile(0, romfs_metadata.size(), romfs_metadata.data());
+
+    std::string listing = fmt::format("{:016X}\n", romfs->GetSize());
+    for (const auto& path : {patch_path, patch_ext_path}) {
+        if (!FileUtil::Exists(path)) {
+            continue;
+        }
+        FileUtil::FSTEntry parent;
+        FileUtil::ScanDirectoryTree(std::string(FileUtil::RemoveTrailingSlash(path)), parent, 256);
+        listing += path + "\n";
+        AppendDirectoryListing(parent, listing);
+    }
+
+    return Common::ComputeHash64(romfs_metadata.data(), romfs_metadata.size()) ^
+           (Common::ComputeHash64(listing.data(), listing.size()) * 31);
+}
+
+std::string LayeredFS::GetCachePath() const {
+    const std::string paths = patch_path + '|' + patch_ext_path;
+    return fmt::format("{}layered_fs{}{:016X}.bin",
+                       FileUtil::GetUserPath(FileUtil::UserPath::CacheDir), DIR_SEP,
+                       Common::ComputeHash64(paths.data(), paths.size()));
+}
+
+bool LayeredFS::LoadCache(u64 fingerprint) {
+    FileUtil::IOFile file(GetCachePath(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    LayeredFSCacheHeader cache_header;
+    if (file.ReadBytes(&cache_header, sizeof(cache_header)) != sizeof(cache_header) ||
+        cache_header.magic != LAYERED_FS_CACHE_MAGIC ||
+        cache_header.version != LAYERED_FS_CACHE_VERSION ||
+        cache_header.fingerprint != fingerprint) {
+        return false;
+    }
+
+    std::vector<u8> cached_metadata(cache_header.metadata_size);
+    if (file.ReadBytes(cached_metadata.data(), cached_metadata.size()) != cached_metadata.size()) {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<File>> files;
+    std::map<u64, File*> offset_map;
+    for (u64 i = 0; i < cache_header.num_files; ++i) {
+        LayeredFSCacheFile entry;
+        if (file.ReadBytes(&entry, sizeof(entry)) != sizeof(entry)) {
+            return false;
+        }
+
+        auto cached = std::make_unique<File>();
+        cached->parent = &root;
+        auto& relocation = cached->relocation;
+        relocation.type = static_cast<int>(entry.type);
+        relocation.original_offset = entry.original_offset;
+        relocation.size = entry.size;
+        relocation.replace_file_path.resize(entry.replace_file_path_length);
+        relocation.patched_file.resize(entry.patched_file_size);
+        if (file.ReadBytes(relocation.replace_file_path.data(),
+                           relocation.replace_file_path.size()) !=
+                relocation.replace_file_path.size() ||
+            file.ReadBytes(relocation.patched_file.data(), relocation.patched_file.size()) !=
+                relocation.patched_file.size()) {
+            return false;
+        }
+        offset_map.emplace(entry.data_offset, cached.get());
+        files.emplace_back(std::move(cached));
+    }
+
+    metadata = std::move(cached_metadata);
+    current_data_offset = cache_header.data_size;
+    cached_files = std::move(files);
+    data_offset_map = std::move(offset_map);
+    LOG_INFO(Service_FS, "LayeredFS loaded {} files from the cache", cached_files.size());
+    return true;
+}
+
+void LayeredFS::SaveCache(u64 fingerprint) const {
+    const std::string path = GetCachePath();
+    if (!FileUtil::CreateFullPath(path)) {
+        LOG_WARNING(Service_FS, "Could not create the LayeredFS cache directory");
+        return;
+    }
+
+    FileUtil::IOFile file(path, "wb");
+    if (!file) {
+        LOG_WARNING(Service_FS, "Could not open the LayeredFS cache {}", path);
+        return;
+    }
+
+    LayeredFSCacheHeader cache_header;
+    cache_header.magic = LAYERED_FS_CACHE_MAGIC;
+    cache_header.version = LAYERED_FS_CACHE_VERSION;
+    cache_header.fingerprint = fingerprint;
+    cache_header.metadata_size = metadata.size();
+    cache_header.data_size = current_data_offset;
+    cache_header.num_files = data_offset_map.size();
+    file.WriteObject(cache_header);
+    file.WriteBytes(metadata.data(), metadata.size());
+
+    for (const auto& [data_offset, cached] : data_offset_map) {
+        const auto& relocation = cached->relocation;
+        LayeredFSCacheFile entry;
+        entry.data_offset = data_offset;
+        entry.original_offset = relocation.original_offset;
+        entry.size = relocation.size;
+        entry.type = static_cast<u32>(relocation.type);
+        entry.replace_file_path_length = static_cast<u32>(relocation.replace_file_path.size());
+        entry.patched_file_size = relocation.patched_file.size();
+        file.WriteObject(entry);
+        file.WriteString(relocation.replace_file_path);
+        file.WriteBytes(relocation.patched_file.data(), relocation.patched_file.size());
+    }
+
+    if (!file.IsGood()) {
+        LOG_WARNING(Service_FS, "Could not write the LayeredFS cache {}", path);
+        file.Close();
+        FileUtil::Delete(path);
+    }
+}
+
 static std::size_t GetNameSize(const std::string& name) {
     std::u16string u16name = Common::UTF8ToUTF16(name);
     return Common::AlignUp(u16name.size() * 2, 4);
@@ -41,6 +41,9 @@ static_assert(sizeof(RomFSHeader) == 0x28, "Size of RomFSHeader is not correct")
  * patch_ext_path: Path for RomFS extensions. Files present in this path:
  *  - When with an extension of ".stub", remove the corresponding file in the RomFS.
  *  - When with an extension of ".ips" or ".bps", patch the file in the RomFS.
+ *
+ * The rebuilt metadata and the relocations are cached in the cache directory, and reused for as
+ * long as neither the RomFS nor the patch directories change.
  */
 class LayeredFS : public RomFSReader {
 public:
@@ -96,6 +99,17 @@ private:
 
     void RebuildMetadata();
 
+    // Hashes the metadata of the RomFS and the names, sizes and modification times of everything
+    // in the patch directories, which the built metadata and relocations depend on.
+    u64 CalculateFingerprint() const;
+
+    std::string GetCachePath() const;
+
+    // Loads the metadata and relocations built by an earlier boot with the same fingerprint
+    bool LoadCache(u64 fingerprint);
+
+    void SaveCache(u64 fingerprint) const;
+
     void Load();
 
     std::shared_ptr<RomFSReader> romfs;
@@ -108,6 +122,7 @@ private:
     std::unordered_map<std::string, File*> file_path_map;
     std::unordered_map<std::string, Directory*> directory_path_map;
     std::map<u64, File*> data_offset_map; // assigned data offset -> file
+    std::vector<std::unique_ptr<File>> cached_files; // files loaded from the cache
     std::vector<u8> metadata;             // Includes header, hash table and metadata
 
     // Used for rebuilding header
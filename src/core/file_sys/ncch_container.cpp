@@ -5,9 +5,9 @@
 #include <cinttypes>
 #include <cstring>
 #include <memory>
-#include <cryptopp/aes.h>
-#include <cryptopp/modes.h>
+#include <mutex>
 #include <cryptopp/sha.h>
+#include "common/common_paths.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "core/core.h"
@@ -15,6 +15,7 @@
 #include "core/file_sys/ncch_container.h"
 #include "core/file_sys/patch.h"
 #include "core/file_sys/seed_db.h"
+#include "core/hw/aes/cipher.h"
 #include "core/hw/aes/key.h"
 #include "core/loader/loader.h"
 
@@ -65,8 +66,8 @@ static bool LZSS_Decompress(const u8* compressed, u32 compressed_size, u8* decom
     u32 index = compressed_size - ((buffer_top_and_bottom >> 24) & 0xFF);
     u32 stop_index = compressed_size - (buffer_top_and_bottom & 0xFFFFFF);
 
-    memset(decompressed, 0, decompressed_size);
     memcpy(decompressed, compressed, compressed_size);
+    memset(decompressed + compressed_size, 0, decompressed_size - compressed_size);
 
     while (index > stop_index) {
         u8 control = compressed[--index];
@@ -91,16 +92,20 @@ static bool LZSS_Decompress(const u8* compressed, u32 compressed_size, u8* decom
                 segment_offset += 2;
 
                 // Check if compression is out of bounds
-                if (out < segment_size)
+                if (out < segment_size || out + segment_offset >= decompressed_size)
                     return false;
 
-                for (unsigned j = 0; j < segment_size; j++) {
-                    // Check if compression is out of bounds
-                    if (out + segment_offset >= decompressed_size)
-                        return false;
-
-                    u8 data = decompressed[out + segment_offset];
-                    decompressed[--out] = data;
+                // The segment is read from right above where it is written, it takes
+                // segment_offset + 1 bytes for the two not to overlap
+                if (segment_offset + 1 >= segment_size) {
+                    out -= segment_size;
+                    std::memcpy(&decompressed[out], &decompressed[out + segment_offset + 1],
+                                segment_size);
+                } else {
+                    for (unsigned j = 0; j < segment_size; j++) {
+                        u8 data = decompressed[out + segment_offset];
+                        decompressed[--out] = data;
+                    }
                 }
             } else {
                 // Check if compression is out of bounds
@@ -211,6 +216,10 @@ Loader::ResultStatus NCCHContainer::Load() {
                 secondary_key.fill(0);
             } else {
                 using namespace HW::AES;
+                // The key slots are shared by all the containers, the game list opens them on
+                // several threads at once
+                static std::mutex key_slot_mutex;
+                std::lock_guard lock{key_slot_mutex};
                 InitKeys();
                 std::array<u8, 16> key_y_primary, key_y_secondary;
 
@@ -347,10 +356,9 @@ Loader::ResultStatus NCCHContainer::Load() {
                         LOG_ERROR(Service_FS, "Failed to decrypt");
                         return Loader::ResultStatus::ErrorEncrypted;
                     }
-                    CryptoPP::byte* data = reinterpret_cast<CryptoPP::byte*>(&exheader_header);
-                    CryptoPP::CTR_Mode<CryptoPP::AES>::Decryption(
-                        primary_key.data(), primary_key.size(), exheader_ctr.data())
-                        .ProcessData(data, data, sizeof(exheader_header));
+                    u8* data = reinterpret_cast<u8*>(&exheader_header);
+                    HW::AES::CTRCipher(primary_key, exheader_ctr)
+                        .Process(0, data, data, sizeof(exheader_header));
                 }
             }
 
@@ -419,10 +427,9 @@ Loader::ResultStatus NCCHContainer::Load() {
                 return Loader::ResultStatus::Error;
 
             if (is_encrypted) {
-                CryptoPP::byte* data = reinterpret_cast<CryptoPP::byte*>(&exefs_header);
-                CryptoPP::CTR_Mode<CryptoPP::AES>::Decryption(primary_key.data(),
-                                                              primary_key.size(), exefs_ctr.data())
-                    .ProcessData(data, data, sizeof(exefs_header));
+                u8* data = reinterpret_cast<u8*>(&exefs_header);
+                HW::AES::CTRCipher(primary_key, exefs_ctr).Process(0, data, data,
+                                                                   sizeof(exefs_header));
             }
 
             exefs_file = FileUtil::IOFile(filepath, "rb");
@@ -531,9 +538,8 @@ Loader::ResultStatus NCCHContainer::LoadSectionExeFS(const char* name, std::vect
                 key = secondary_key;
             }
 
-            CryptoPP::CTR_Mode<CryptoPP::AES>::Decryption dec(key.data(), key.size(),
-                                                              exefs_ctr.data());
-            dec.Seek(section.offset + sizeof(ExeFs_Header));
+            const HW::AES::CTRCipher cipher(key, exefs_ctr);
+            const u64 crypto_offset = section.offset + sizeof(ExeFs_Header);
 
             if (strcmp(section.name, ".code") == 0 && is_compressed) {
                 // Section is compressed, read compressed .code section...
@@ -548,7 +554,7 @@ Loader::ResultStatus NCCHContainer::LoadSectionExeFS(const char* name, std::vect
                     return Loader::ResultStatus::Error;
 
                 if (is_encrypted) {
-                    dec.ProcessData(&temp_buffer[0], &temp_buffer[0], section.size);
+                    cipher.Process(crypto_offset, &temp_buffer[0], &temp_buffer[0], section.size);
                 }
 
                 // Decompress .code section...
@@ -562,7 +568,7 @@ Loader::ResultStatus NCCHContainer::LoadSectionExeFS(const char* name, std::vect
                 if (exefs_file.ReadBytes(&buffer[0], section.size) != section.size)
                     return Loader::ResultStatus::Error;
                 if (is_encrypted) {
-                    dec.ProcessData(&buffer[0], &buffer[0], section.size);
+                    cipher.Process(crypto_offset, &buffer[0], &buffer[0], section.size);
                 }
             }
 
@@ -681,7 +687,7 @@ Loader::ResultStatus NCCHContainer::ReadRomFS(std::shared_ptr<RomFSReader>& romf
     if (!romfs_file_inner.IsOpen())
         return Loader::ResultStatus::Error;
 
-    std::shared_ptr<RomFSReader> direct_romfs;
+    std::shared_ptr<DirectRomFSReader> direct_romfs;
     if (is_encrypted) {
         direct_romfs =
             std::make_shared<DirectRomFSReader>(std::move(romfs_file_inner), romfs_offset,
@@ -690,6 +696,12 @@ Loader::ResultStatus NCCHContainer::ReadRomFS(std::shared_ptr<RomFSReader>& romf
         direct_romfs = std::make_shared<DirectRomFSReader>(std::move(romfs_file_inner),
                                                            romfs_offset, romfs_size);
     }
+    // The RomFS of a title is read in much the same order from one run to the next
+    if (use_layered_fs) {
+        direct_romfs->EnableAccessTrace(fmt::format(
+            "{}romfs_trace{}{:016X}.bin", FileUtil::GetUserPath(FileUtil::UserPath::CacheDir),
+            DIR_SEP, ncch_header.program_id));
+    }
 
     const auto path =
         fmt::format("{}mods/{:016X}/", FileUtil::GetUserPath(FileUtil::UserPath::LoadDir),
@@ -85,6 +85,26 @@ PathParser::HostStatus PathParser::GetHostStatus(std::string_view mount_point) c
     return FileFound;
 }
 
+PathParser::HostStatus PathParser::GetHostStatus(std::string_view mount_point,
+                                                HostStatusCache& cache) const {
+    const u64 generation = HostStatusCache::generation;
+    if (cache.cached_generation != generation || cache.statuses.size() >= cache.MaxStatuses) {
+        cache.statuses.clear();
+        cache.cached_generation = generation;
+    }
+    std::string host_path = BuildHostPath(mount_point);
+    const auto it = cache.statuses.find(host_path);
+    if (it != cache.statuses.end()) {
+        return it->second;
+    }
+    const HostStatus status = GetHostStatus(mount_point);
+    // The mount point may be created later on, by formatting the archive
+    if (status != InvalidMountPoint) {
+        cache.statuses.emplace(std::move(host_path), status);
+    }
+    return status;
+}
+
 std::string PathParser::BuildHostPath(std::string_view mount_point) const {
     std::string path{mount_point};
     for (auto& node : path_sequence) {
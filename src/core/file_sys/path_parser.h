@@ -4,12 +4,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "core/file_sys/archive_backend.h"
 
 namespace FileSys {
 
+class HostStatusCache;
+
 /**
  * A helper class parsing and verifying a string-type Path.
  * Every archives with a sub file system should use this class to parse the path argument and check
@@ -49,6 +53,9 @@ public:
     /// Checks the status of the specified file / directory by the Path on the host file system.
     HostStatus GetHostStatus(std::string_view mount_point) const;
 
+    /// Checks the status like GetHostStatus, with the statuses the archive already checked.
+    HostStatus GetHostStatus(std::string_view mount_point, HostStatusCache& cache) const;
+
     /// Builds a full path on the host file system.
     std::string BuildHostPath(std::string_view mount_point) const;
 
@@ -58,4 +65,30 @@ private:
     bool is_root{};
 };
 
+/**
+ * The statuses of the host paths an archive checked, so that opening the same files again doesn't
+ * query the host file system for every component of their path. As the mount points of the
+ * archives overlap, creating, deleting or renaming anything through any archive drops the statuses
+ * of every cache, which is also done when the archives are formatted, created or deleted.
+ */
+class HostStatusCache {
+public:
+    /// Drops the statuses of every cache, to be called whenever the host file system changes
+    static void InvalidateAll() {
+        ++generation;
+    }
+
+private:
+    friend class PathParser;
+
+    /// Bound to the size of the cache, games keeping well below it
+    static constexpr std::size_t MaxStatuses = 0x1000;
+
+    /// Bumped for every invalidation, the caches of an older generation are stale
+    static inline std::atomic<u64> generation{0};
+
+    std::unordered_map<std::string, PathParser::HostStatus> statuses;
+    u64 cached_generation = 0;
+};
+
 } // namespace FileSys
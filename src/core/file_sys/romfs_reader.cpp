@@ -1,25 +1,269 @@
 #include <algorithm>
-#include <cryptopp/aes.h>
-#include <cryptopp/modes.h>
+#include <cstring>
 #include "common/archives.h"
+#include "common/common_funcs.h"
+#include "common/metrics.h"
+#include "common/swap.h"
 #include "core/file_sys/romfs_reader.h"
 
 SERIALIZE_EXPORT_IMPL(FileSys::DirectRomFSReader)
 
 namespace FileSys {
 
+constexpr u32 ROMFS_TRACE_MAGIC = 0x43525452; // "RTRC"
+// Bumped whenever the layout of the trace or the size of the blocks changes
+constexpr u32 ROMFS_TRACE_VERSION = 1;
+
+/// Header of an access trace, followed by the u32 index of each block
+struct RomFSTraceHeader {
+    u32_le magic;
+    u32_le version;
+    u64_le data_size;
+    u32_le num_blocks;
+    INSERT_PADDING_WORDS(1);
+};
+static_assert(sizeof(RomFSTraceHeader) == 0x18, "RomFSTraceHeader has incorrect size");
+
+static Common::Metrics::Counter cache_hits_metric{
+    "citra_romfs_cache_hits_total", "Encrypted RomFS blocks read from the decrypted block cache"};
+static Common::Metrics::Counter cache_misses_metric{
+    "citra_romfs_cache_misses_total", "Encrypted RomFS blocks read and decrypted from the file"};
+
+/// Granularity at which the mapped pages are touched to have the host read them in
+constexpr std::size_t PREFETCH_TOUCH_SIZE = 0x1000;
+
+DirectRomFSReader::~DirectRomFSReader() {
+    stop_prefetch = true;
+    prefetch_thread.reset();
+    if (!trace_path.empty()) {
+        SaveAccessTrace();
+    }
+}
+
+void DirectRomFSReader::Init() {
+    view = std::make_unique<FileUtil::MappedFileView>(file, file_offset,
+                                                      static_cast<std::size_t>(data_size));
+    if (is_encrypted) {
+        cipher = std::make_unique<HW::AES::CTRCipher>(key, ctr);
+    }
+    cached_blocks.clear();
+    cached_block_map.clear();
+}
+
+void DirectRomFSReader::EnableAccessTrace(const std::string& path) {
+    trace_path = path;
+    const u64 num_blocks = (data_size + CACHE_BLOCK_SIZE - 1) / CACHE_BLOCK_SIZE;
+    accessed_blocks.assign(static_cast<std::size_t>(num_blocks), false);
+
+    FileUtil::IOFile trace_file(path, "rb");
+    if (!trace_file) {
+        return;
+    }
+    RomFSTraceHeader header;
+    if (trace_file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != ROMFS_TRACE_MAGIC || header.version != ROMFS_TRACE_VERSION ||
+        header.data_size != data_size || header.num_blocks > num_blocks) {
+        return;
+    }
+    std::vector<u32_le> blocks(header.num_blocks);
+    if (trace_file.ReadArray(blocks.data(), blocks.size()) != blocks.size()) {
+        return;
+    }
+    for (const u32 index : blocks) {
+        if (index < num_blocks && recorded_positions.emplace(index, recorded_trace.size()).second) {
+            recorded_trace.push_back(index);
+        }
+    }
+    if (!recorded_trace.empty()) {
+        prefetch_thread = std::make_unique<Common::ThreadPool>(1, "RomFSPrefetch",
+                                                               Common::ThreadRole::Background);
+    }
+}
+
+void DirectRomFSReader::SaveAccessTrace() const {
+    // A shorter run than the recorded one saw less of the title
+    if (access_trace.size() <= recorded_trace.size()) {
+        return;
+    }
+    if (!FileUtil::CreateFullPath(trace_path)) {
+        return;
+    }
+    FileUtil::IOFile trace_file(trace_path, "wb");
+    RomFSTraceHeader header{};
+    header.magic = ROMFS_TRACE_MAGIC;
+    header.version = ROMFS_TRACE_VERSION;
+    header.data_size = data_size;
+    header.num_blocks = static_cast<u32>(access_trace.size());
+    const std::vector<u32_le> blocks(access_trace.begin(), access_trace.end());
+    if (trace_file.WriteBytes(&header, sizeof(header)) != sizeof(header) ||
+        trace_file.WriteArray(blocks.data(), blocks.size()) != blocks.size()) {
+        trace_file.Close();
+        FileUtil::Delete(trace_path);
+    }
+}
+
+void DirectRomFSReader::RecordAccess(u64 offset, std::size_t length) {
+    const u64 first_block = offset / CACHE_BLOCK_SIZE;
+    const u64 last_block = (offset + length - 1) / CACHE_BLOCK_SIZE;
+
+    std::lock_guard lock{trace_mutex};
+    std::size_t position = 0;
+    bool in_recorded_trace = false;
+    for (u64 index = first_block; index <= last_block; ++index) {
+        if (!accessed_blocks[index]) {
+            accessed_blocks[index] = true;
+            access_trace.push_back(static_cast<u32>(index));
+        }
+        const auto it = recorded_positions.find(static_cast<u32>(index));
+        if (it != recorded_positions.end()) {
+            position = std::max(position, it->second);
+            in_recorded_trace = true;
+        }
+    }
+    if (!in_recorded_trace) {
+        return;
+    }
+
+    // Going back to an earlier part of the trace starts the prefetching over from there
+    std::size_t begin = std::max(prefetch_end, position + 1);
+    if (prefetch_end > position + 1 + PREFETCH_AHEAD_BLOCKS) {
+        begin = position + 1;
+    }
+    const std::size_t end = std::min(position + 1 + PREFETCH_AHEAD_BLOCKS, recorded_trace.size());
+    if (begin >= end) {
+        return;
+    }
+    prefetch_end = end;
+    prefetch_thread->Push(
+        [this, blocks = std::vector<u32>(recorded_trace.begin() + begin,
+                                         recorded_trace.begin() + end)] {
+            for (const u32 index : blocks) {
+                if (stop_prefetch) {
+                    return;
+                }
+                PrefetchBlock(index);
+            }
+        });
+}
+
+void DirectRomFSReader::PrefetchBlock(u64 index) {
+    const u64 block_offset = index * CACHE_BLOCK_SIZE;
+    const std::size_t length =
+        static_cast<std::size_t>(std::min<u64>(CACHE_BLOCK_SIZE, data_size - block_offset));
+
+    if (is_encrypted) {
+        {
+            std::lock_guard lock{cache_mutex};
+            if (cached_block_map.count(index) != 0) {
+                return;
+            }
+        }
+        // The block is read and decrypted without holding up the reads of the emulation
+        std::vector<u8> data(CACHE_BLOCK_SIZE);
+        const std::size_t size = ReadRaw(block_offset, length, data.data());
+        Decrypt(block_offset, data.data(), size);
+
+        std::lock_guard lock{cache_mutex};
+        if (cached_block_map.count(index) == 0) {
+            CachedBlock& block = InsertBlock(index);
+            block.data.swap(data);
+            block.size = size;
+        }
+        return;
+    }
+
+    if (view->IsValid()) {
+        // Touching the pages has the host read them in
+        const volatile u8* data = view->Pointer() + block_offset;
+        for (std::size_t i = 0; i < length; i += PREFETCH_TOUCH_SIZE) {
+            static_cast<void>(data[i]);
+        }
+    } else {
+        // Leaves the data in the file cache of the host
+        std::vector<u8> data(length);
+        ReadRaw(block_offset, length, data.data());
+    }
+}
+
 std::size_t DirectRomFSReader::ReadFile(std::size_t offset, std::size_t length, u8* buffer) {
-    if (length == 0)
-        return 0; // Crypto++ does not like zero size buffer
+    if (length == 0 || offset >= data_size)
+        return 0;
+    const std::size_t read_length = std::min(length, static_cast<std::size_t>(data_size) - offset);
+    if (!trace_path.empty()) {
+        RecordAccess(offset, read_length);
+    }
+
+    if (!is_encrypted || read_length >= CACHE_BYPASS_SIZE) {
+        const std::size_t read = ReadRaw(offset, read_length, buffer);
+        if (is_encrypted) {
+            Decrypt(offset, buffer, read);
+        }
+        return read;
+    }
+
+    std::lock_guard lock{cache_mutex};
+    std::size_t copied = 0;
+    while (copied < read_length) {
+        const u64 position = offset + copied;
+        const CachedBlock& block = GetDecryptedBlock(position / CACHE_BLOCK_SIZE);
+        const std::size_t block_offset = static_cast<std::size_t>(position % CACHE_BLOCK_SIZE);
+        if (block_offset >= block.size) {
+            break;
+        }
+        const std::size_t copy_length = std::min(read_length - copied, block.size - block_offset);
+        std::memcpy(buffer + copied, block.data.data() + block_offset, copy_length);
+        copied += copy_length;
+    }
+    return copied;
+}
+
+std::size_t DirectRomFSReader::ReadRaw(u64 offset, std::size_t length, u8* buffer) {
+    if (view->IsValid()) {
+        std::memcpy(buffer, view->Pointer() + offset, length);
+        return length;
+    }
+    std::lock_guard lock{read_mutex};
     file.Seek(file_offset + offset, SEEK_SET);
-    std::size_t read_length = std::min(length, static_cast<std::size_t>(data_size) - offset);
-    read_length = file.ReadBytes(buffer, read_length);
-    if (is_encrypted) {
-        CryptoPP::CTR_Mode<CryptoPP::AES>::Decryption d(key.data(), key.size(), ctr.data());
-        d.Seek(crypto_offset + offset);
-        d.ProcessData(buffer, buffer, read_length);
+    const std::size_t read = file.ReadBytes(buffer, length);
+    return read > length ? 0 : read;
+}
+
+void DirectRomFSReader::Decrypt(u64 offset, u8* data, std::size_t length) const {
+    cipher->Process(crypto_offset + offset, data, data, length);
+}
+
+const DirectRomFSReader::CachedBlock& DirectRomFSReader::GetDecryptedBlock(u64 index) {
+    const auto it = cached_block_map.find(index);
+    if (it != cached_block_map.end()) {
+        cached_blocks.splice(cached_blocks.begin(), cached_blocks, it->second);
+        cache_hits_metric.Add();
+        return cached_blocks.front();
     }
-    return read_length;
+
+    cache_misses_metric.Add();
+    CachedBlock& block = InsertBlock(index);
+    const u64 block_offset = index * CACHE_BLOCK_SIZE;
+    const std::size_t length =
+        static_cast<std::size_t>(std::min<u64>(CACHE_BLOCK_SIZE, data_size - block_offset));
+    block.size = ReadRaw(block_offset, length, block.data.data());
+    Decrypt(block_offset, block.data.data(), block.size);
+    return block;
+}
+
+DirectRomFSReader::CachedBlock& DirectRomFSReader::InsertBlock(u64 index) {
+    if (cached_blocks.size() < CACHE_NUM_BLOCKS) {
+        cached_blocks.emplace_front();
+        cached_blocks.front().data.resize(CACHE_BLOCK_SIZE);
+    } else {
+        cached_blocks.splice(cached_blocks.begin(), cached_blocks, std::prev(cached_blocks.end()));
+        cached_block_map.erase(cached_blocks.front().index);
+    }
+
+    CachedBlock& block = cached_blocks.front();
+    block.index = index;
+    block.size = 0;
+    cached_block_map.emplace(index, cached_blocks.begin());
+    return block;
 }
 
 } // namespace FileSys
@@ -1,11 +1,20 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/base_object.hpp>
 #include <boost/serialization/export.hpp>
 #include "common/common_types.h"
 #include "common/file_util.h"
+#include "common/thread_pool.h"
+#include "core/hw/aes/cipher.h"
 
 namespace FileSys {
 
@@ -26,21 +35,27 @@ private:
 };
 
 /**
- * A RomFS reader that directly reads the RomFS file.
+ * A RomFS reader that directly reads the RomFS file. The file is mapped into memory when the host
+ * allows it, and the blocks of an encrypted RomFS are kept decrypted in a small cache. With an
+ * access trace, the blocks a previous run read next are prefetched in the background.
  */
 class DirectRomFSReader : public RomFSReader {
 public:
     DirectRomFSReader(FileUtil::IOFile&& file, std::size_t file_offset, std::size_t data_size)
         : is_encrypted(false), file(std::move(file)), file_offset(file_offset),
-          data_size(data_size) {}
+          data_size(data_size) {
+        Init();
+    }
 
     DirectRomFSReader(FileUtil::IOFile&& file, std::size_t file_offset, std::size_t data_size,
                       const std::array<u8, 16>& key, const std::array<u8, 16>& ctr,
                       std::size_t crypto_offset)
         : is_encrypted(true), file(std::move(file)), key(key), ctr(ctr), file_offset(file_offset),
-          crypto_offset(crypto_offset), data_size(data_size) {}
+          crypto_offset(crypto_offset), data_size(data_size) {
+        Init();
+    }
 
-    ~DirectRomFSReader() override = default;
+    ~DirectRomFSReader() override;
 
     std::size_t GetSize() const override {
         return data_size;
@@ -48,7 +63,46 @@ public:
 
     std::size_t ReadFile(std::size_t offset, std::size_t length, u8* buffer) override;
 
+    /**
+     * Records the order in which the blocks of the RomFS are first read to the file at the path,
+     * which is written when the reader is destroyed. The order recorded there by a previous run is
+     * followed to read the blocks ahead of the emulation.
+     */
+    void EnableAccessTrace(const std::string& path);
+
 private:
+    /// Size of the blocks of an encrypted RomFS that are decrypted and cached
+    static constexpr std::size_t CACHE_BLOCK_SIZE = 0x4000;
+    /// Number of decrypted blocks kept, the least recently used one is replaced first
+    static constexpr std::size_t CACHE_NUM_BLOCKS = 256;
+    /// Reads of at least this size are decrypted in place, without going through the cache
+    static constexpr std::size_t CACHE_BYPASS_SIZE = CACHE_BLOCK_SIZE * 16;
+    /// Number of blocks of the recorded trace read ahead of the last block read
+    static constexpr std::size_t PREFETCH_AHEAD_BLOCKS = 64;
+
+    struct CachedBlock {
+        u64 index;
+        std::size_t size;
+        std::vector<u8> data;
+    };
+
+    /// Maps the file and expands the key, which aren't serialized
+    void Init();
+    /// Reads from the file without decrypting
+    std::size_t ReadRaw(u64 offset, std::size_t length, u8* buffer);
+    void Decrypt(u64 offset, u8* data, std::size_t length) const;
+    /// Returns the decrypted block, decrypting it if it isn't cached. cache_mutex must be held.
+    const CachedBlock& GetDecryptedBlock(u64 index);
+    /// Makes room for the block at the front of the cache for the caller to fill. cache_mutex
+    /// must be held.
+    CachedBlock& InsertBlock(u64 index);
+
+    /// Adds the blocks of a read to the trace and queues the prefetching of the ones that follow
+    void RecordAccess(u64 offset, std::size_t length);
+    /// Has the block read, into the cache of decrypted blocks if the RomFS is encrypted
+    void PrefetchBlock(u64 index);
+    void SaveAccessTrace() const;
+
     bool is_encrypted;
     FileUtil::IOFile file;
     std::array<u8, 16> key;
@@ -56,6 +110,31 @@ private:
     u64 file_offset;
     u64 crypto_offset;
     u64 data_size;
+    /// The files opened from the RomFS share the reader, and the FS service reads them on its
+    /// I/O threads
+    std::mutex read_mutex;
+
+    std::unique_ptr<FileUtil::MappedFileView> view;
+    std::unique_ptr<HW::AES::CTRCipher> cipher;
+
+    std::mutex cache_mutex;
+    /// Ordered from the most to the least recently used
+    std::list<CachedBlock> cached_blocks;
+    std::unordered_map<u64, std::list<CachedBlock>::iterator> cached_block_map;
+
+    /// Empty when no trace is recorded
+    std::string trace_path;
+    std::mutex trace_mutex;
+    /// Blocks in the order this run first read them in
+    std::vector<u32> access_trace;
+    std::vector<bool> accessed_blocks;
+    /// The trace of the previous run and the position of each block in it
+    std::vector<u32> recorded_trace;
+    std::unordered_map<u32, std::size_t> recorded_positions;
+    /// End of the part of the recorded trace queued for prefetching
+    std::size_t prefetch_end = 0;
+    std::atomic_bool stop_prefetch{false};
+    std::unique_ptr<Common::ThreadPool> prefetch_thread;
 
     DirectRomFSReader() = default;
 
@@ -69,6 +148,9 @@ private:
         ar& file_offset;
         ar& crypto_offset;
         ar& data_size;
+        if (Archive::is_loading::value) {
+            Init();
+        }
     }
     friend class boost::serialization::access;
 };
@@ -8,6 +8,7 @@
 #include "core/file_sys/archive_backend.h"
 #include "core/file_sys/directory_backend.h"
 #include "core/file_sys/file_backend.h"
+#include "core/file_sys/path_parser.h"
 #include "core/hle/result.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +39,8 @@ public:
 
 protected:
     std::string mount_point;
+    /// Statuses of the host paths checked by the calls, not part of the state
+    mutable HostStatusCache host_status_cache;
     SaveDataArchive() = default;
 
 private:
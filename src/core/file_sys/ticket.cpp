@@ -3,11 +3,10 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
-#include <cryptopp/aes.h>
-#include <cryptopp/modes.h>
 #include "common/alignment.h"
 #include "core/file_sys/cia_common.h"
 #include "core/file_sys/ticket.h"
+#include "core/hw/aes/cipher.h"
 #include "core/hw/aes/key.h"
 #include "core/loader/loader.h"
 
@@ -52,8 +51,7 @@ std::optional<std::array<u8, 16>> Ticket::GetTitleKey() const {
     }
     auto key = HW::AES::GetNormalKey(HW::AES::KeySlotID::TicketCommonKey);
     auto title_key = ticket_body.title_key;
-    CryptoPP::CBC_Mode<CryptoPP::AES>::Decryption{key.data(), key.size(), ctr.data()}.ProcessData(
-        title_key.data(), title_key.data(), title_key.size());
+    HW::AES::CBCDecryptor(key, ctr).Process(title_key.data(), title_key.data(), title_key.size());
     return title_key;
 }
 
@@ -58,10 +58,11 @@ public:
     /**
      * Receives a frame from the camera.
      * This function should be only called between a StartCapture call and a StopCapture call.
-     * @returns A std::vector<u16> containing pixels. The total size of the vector is width * height
-     *     where width and height are set by a call to SetResolution.
+     * @param frame The vector receiving the pixels. It is resized to width * height, where width
+     *     and height are set by a call to SetResolution, so that its storage can be reused by the
+     *     caller from frame to frame.
      */
-    virtual std::vector<u16> ReceiveFrame() = 0;
+    virtual void ReceiveFrame(std::vector<u16>& frame) = 0;
 
     /**
      * Test if the camera is opened successfully and can receive a preview frame. Only used for
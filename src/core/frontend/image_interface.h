@@ -17,8 +17,9 @@ public:
     // Error logging should be handled by the frontend
     virtual bool DecodePNG(std::vector<u8>& dst, u32& width, u32& height,
                            const std::string& path) = 0;
+    /// fast trades a larger file for a quicker encode
     virtual bool EncodePNG(const std::string& path, const std::vector<u8>& src, u32 width,
-                           u32 height) = 0;
+                           u32 height, bool fast) = 0;
 };
 
 } // namespace Frontend
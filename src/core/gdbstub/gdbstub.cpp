@@ -380,6 +380,14 @@ static u8 CalculateChecksum(const u8* buffer, std::size_t length) {
     return static_cast<u8>(std::accumulate(buffer, buffer + length, 0, std::plus<u8>()));
 }
 
+/// Drops the code the cores translated from a range of memory that was patched
+static void InvalidateCodeRange(VAddr addr, std::size_t size) {
+    const u32 num_cores = Core::GetNumCores();
+    for (u32 i = 0; i < num_cores; ++i) {
+        Core::GetCore(i).InvalidateCacheRange(addr, size);
+    }
+}
+
 /**
  * Get the map of breakpoints for a given breakpoint type.
  *
@@ -419,10 +427,9 @@ static void RemoveBreakpoint(BreakpointType type, VAddr addr) {
         Core::System::GetInstance().Memory().WriteBlock(
             *Core::System::GetInstance().Kernel().GetCurrentProcess(), bp->second.addr,
             bp->second.inst.data(), bp->second.inst.size());
-        u32 num_cores = Core::GetNumCores();
-        for (u32 i = 0; i < num_cores; ++i) {
-            Core::GetCore(i).ClearInstructionCache();
-        }
+        InvalidateCodeRange(bp->second.addr, bp->second.inst.size());
+    } else {
+        Core::System::GetInstance().Memory().WatchRegion(bp->second.addr, bp->second.len, false);
     }
     p.erase(addr);
 }
@@ -448,12 +455,13 @@ bool CheckBreakpoint(VAddr addr, BreakpointType type) {
         return false;
     }
 
+    // The breakpoint covering the address is the last one starting at or before it
     const BreakpointMap& p = GetBreakpointMap(type);
-    const auto bp = p.find(addr);
-
-    if (bp == p.end()) {
+    auto bp = p.upper_bound(addr);
+    if (bp == p.begin()) {
         return false;
     }
+    --bp;
 
     u32 len = bp->second.len;
 
@@ -883,7 +891,7 @@ static void WriteMemory() {
     GdbHexToMem(data.data(), len_pos + 1, len);
     Core::System::GetInstance().Memory().WriteBlock(
         *Core::System::GetInstance().Kernel().GetCurrentProcess(), addr, data.data(), len);
-    Core::GetRunningCore().ClearInstructionCache();
+    InvalidateCodeRange(addr, len);
     SendReply("OK");
 }
 
@@ -902,7 +910,6 @@ static void Step() {
     step_loop = true;
     halt_loop = true;
     send_trap = true;
-    Core::GetRunningCore().ClearInstructionCache();
 }
 
 bool IsMemoryBreak() {
@@ -918,7 +925,6 @@ static void Continue() {
     memory_break = false;
     step_loop = false;
     halt_loop = false;
-    Core::GetRunningCore().ClearInstructionCache();
 }
 
 /**
@@ -939,14 +945,21 @@ static bool CommitBreakpoint(BreakpointType type, VAddr addr, u32 len) {
         *Core::System::GetInstance().Kernel().GetCurrentProcess(), addr, breakpoint.inst.data(),
         breakpoint.inst.size());
 
+    if (!p.insert({addr, breakpoint}).second) {
+        return true;
+    }
+
+    // Execution breakpoints patch a BKPT into the code, which the JIT compiles into the blocks it
+    // translates again. Watchpoints make the JIT access the watched pages through its callbacks.
     static constexpr std::array<u8, 4> btrap{0x70, 0x00, 0x20, 0xe1};
     if (type == BreakpointType::Execute) {
         Core::System::GetInstance().Memory().WriteBlock(
             *Core::System::GetInstance().Kernel().GetCurrentProcess(), addr, btrap.data(),
             btrap.size());
-        Core::GetRunningCore().ClearInstructionCache();
+        InvalidateCodeRange(addr, btrap.size());
+    } else {
+        Core::System::GetInstance().Memory().WatchRegion(addr, len, true);
     }
-    p.insert({addr, breakpoint});
 
     LOG_DEBUG(Debug_GDBStub, "gdb: added {} breakpoint: {:08x} bytes at {:08x}\n",
               static_cast<int>(type), breakpoint.len, breakpoint.addr);
@@ -0,0 +1,77 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <fmt/format.h>
+#include "core/guest_profiler.h"
+
+namespace Core {
+
+void GuestProfiler::AddModule(u32 process_id, std::string name, VAddr code_begin, u32 code_size,
+                              Symbols symbols) {
+    ResolveSamples();
+    // The Thumb symbols have their lowest bit set
+    for (auto& symbol : symbols) {
+        symbol.first &= ~1u;
+    }
+    std::sort(symbols.begin(), symbols.end());
+    modules.push_back(
+        {process_id, std::move(name), code_begin, code_begin + code_size, std::move(symbols)});
+}
+
+void GuestProfiler::RemoveModule(u32 process_id, VAddr code_begin) {
+    ResolveSamples();
+    const auto it = std::find_if(modules.rbegin(), modules.rend(), [&](const Module& module) {
+        return module.process_id == process_id && module.code_begin == code_begin;
+    });
+    if (it != modules.rend()) {
+        modules.erase(std::next(it).base());
+    }
+}
+
+std::string GuestProfiler::GetFoldedStacks() {
+    ResolveSamples();
+    std::string out;
+    for (const auto& [stack, count] : stacks) {
+        out += fmt::format("{} {}\n", stack, count);
+    }
+    return out;
+}
+
+u64 GuestProfiler::GetSampleCount() const {
+    u64 count = 0;
+    for (const auto& [key, samples_count] : samples) {
+        count += samples_count;
+    }
+    for (const auto& [stack, stack_count] : stacks) {
+        count += stack_count;
+    }
+    return count;
+}
+
+void GuestProfiler::ResolveSamples() {
+    for (const auto& [key, count] : samples) {
+        stacks[GetStack(static_cast<u32>(key >> 32), static_cast<VAddr>(key))] += count;
+    }
+    samples.clear();
+}
+
+std::string GuestProfiler::GetStack(u32 process_id, VAddr pc) const {
+    const auto module = std::find_if(modules.rbegin(), modules.rend(), [&](const Module& module) {
+        return module.process_id == process_id && pc >= module.code_begin && pc < module.code_end;
+    });
+    if (module == modules.rend()) {
+        return fmt::format("process {};[unknown];0x{:08X}", process_id, pc);
+    }
+
+    const auto symbol =
+        std::upper_bound(module->symbols.begin(), module->symbols.end(), pc,
+                         [](VAddr address, const auto& symbol) { return address < symbol.first; });
+    if (symbol == module->symbols.begin()) {
+        return fmt::format("{};[unknown];0x{:08X}", module->name, pc);
+    }
+    return fmt::format("{};{};0x{:08X}", module->name, std::prev(symbol)->second, pc);
+}
+
+} // namespace Core
@@ -0,0 +1,71 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+
+/**
+ * Sampling profiler of the guest code. The CPU loop samples the PC of each running core at the end
+ * of its slices, the slices ending at the timing events this spreads the samples over guest time.
+ * The samples are named after the modules of the processes, the main executable and the loaded
+ * CROs, and after the nearest preceding symbol exported by the module. They are exported as folded
+ * stacks, "module;symbol;pc count" lines that the flame graph tools take as is.
+ */
+class GuestProfiler {
+public:
+    /// Exported symbols of a module, with their address
+    using Symbols = std::vector<std::pair<VAddr, std::string>>;
+
+    /// Counts a sample of the code the core of the process was running
+    void Sample(u32 process_id, VAddr pc) {
+        ++samples[(static_cast<u64>(process_id) << 32) | pc];
+    }
+
+    /**
+     * Names the samples taken in the code of a module until it is removed. A module added later
+     * takes precedence where they overlap, like the static module of a CRS over the executable.
+     */
+    void AddModule(u32 process_id, std::string name, VAddr code_begin, u32 code_size,
+                   Symbols symbols);
+
+    /// Removes the module of the process starting at the address
+    void RemoveModule(u32 process_id, VAddr code_begin);
+
+    /// Returns the samples taken so far as folded stacks, sorted by stack
+    std::string GetFoldedStacks();
+
+    /// Returns the number of samples taken so far
+    u64 GetSampleCount() const;
+
+private:
+    struct Module {
+        u32 process_id;
+        std::string name;
+        VAddr code_begin;
+        VAddr code_end;
+        /// Sorted by address
+        Symbols symbols;
+    };
+
+    /// Names the samples taken with the current modules, before they change
+    void ResolveSamples();
+
+    std::string GetStack(u32 process_id, VAddr pc) const;
+
+    std::vector<Module> modules;
+    /// Samples not named yet, by process id in the upper word and PC in the lower one
+    std::unordered_map<u64, u64> samples;
+    /// Samples named by ResolveSamples, by folded stack
+    std::map<std::string, u64> stacks;
+};
+
+} // namespace Core
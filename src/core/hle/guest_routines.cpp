@@ -0,0 +1,177 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include "common/logging/log.h"
+#include "common/swap.h"
+#include "core/core.h"
+#include "core/hle/guest_routines.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+
+namespace HLE {
+
+namespace {
+/// The BKPT immediate of the first routine, away from the ones the debuggers patch in
+constexpr u32 RoutineBreakpointBase = 0xC1B0;
+
+constexpr std::array<std::pair<std::string_view, GuestRoutine>, 15> RoutineNames{{
+    {"memcpy", GuestRoutine::Memmove},
+    {"memmove", GuestRoutine::Memmove},
+    {"__aeabi_memcpy", GuestRoutine::Memmove},
+    {"__aeabi_memcpy4", GuestRoutine::Memmove},
+    {"__aeabi_memcpy8", GuestRoutine::Memmove},
+    {"__aeabi_memmove", GuestRoutine::Memmove},
+    {"__aeabi_memmove4", GuestRoutine::Memmove},
+    {"__aeabi_memmove8", GuestRoutine::Memmove},
+    {"memset", GuestRoutine::Memset},
+    {"__aeabi_memset", GuestRoutine::AeabiMemset},
+    {"__aeabi_memset4", GuestRoutine::AeabiMemset},
+    {"__aeabi_memset8", GuestRoutine::AeabiMemset},
+    {"__aeabi_memclr", GuestRoutine::AeabiMemclr},
+    {"__aeabi_memclr4", GuestRoutine::AeabiMemclr},
+    {"__aeabi_memclr8", GuestRoutine::AeabiMemclr},
+}};
+
+/// Size of the chunks copied through a buffer by the block accesses
+constexpr u32 ChunkSize = Memory::PAGE_SIZE;
+
+u32 EncodeRoutineBreakpoint(GuestRoutine routine) {
+    const u32 immediate = RoutineBreakpointBase + static_cast<u32>(routine);
+    return 0xE1200070 | ((immediate & 0xFFF0) << 4) | (immediate & 0xF);
+}
+} // Anonymous namespace
+
+std::optional<GuestRoutine> GetBreakpointRoutine(u32 immediate) {
+    if (immediate < RoutineBreakpointBase ||
+        immediate >= RoutineBreakpointBase + static_cast<u32>(GuestRoutine::Count)) {
+        return std::nullopt;
+    }
+    return static_cast<GuestRoutine>(immediate - RoutineBreakpointBase);
+}
+
+std::optional<GuestRoutine> DecodeRoutineBreakpoint(u32 instruction) {
+    if ((instruction & 0xFFF000F0) != 0xE1200070) {
+        return std::nullopt;
+    }
+    return GetBreakpointRoutine(((instruction >> 4) & 0xFFF0) | (instruction & 0xF));
+}
+
+std::size_t PatchGuestRoutines(Core::System& system, const Kernel::Process& process,
+                               const std::vector<std::pair<VAddr, std::string>>& symbols) {
+    std::size_t patched = 0;
+    for (const auto& [address, name] : symbols) {
+        const auto it =
+            std::find_if(RoutineNames.begin(), RoutineNames.end(),
+                         [&name = name](const auto& entry) { return entry.first == name; });
+        // Only ARM code can take an ARM BKPT, the Thumb symbols have their lowest bit set
+        if (it == RoutineNames.end() || (address & 3) != 0) {
+            continue;
+        }
+        const u32_le instruction = EncodeRoutineBreakpoint(it->second);
+        system.Memory().WriteBlock(process, address, &instruction, sizeof(instruction));
+        system.InvalidateCacheRange(address, sizeof(instruction));
+        ++patched;
+    }
+    return patched;
+}
+
+GuestRoutineCall::GuestRoutineCall(GuestRoutine routine, const std::array<u32, 16>& regs)
+    : routine(routine), dest(regs[0]) {
+    switch (routine) {
+    case GuestRoutine::Memmove:
+        src = regs[1];
+        size = regs[2];
+        break;
+    case GuestRoutine::Memset:
+        value = static_cast<u8>(regs[1]);
+        size = regs[2];
+        break;
+    case GuestRoutine::AeabiMemset:
+        size = regs[1];
+        value = static_cast<u8>(regs[2]);
+        break;
+    default:
+        size = regs[1];
+        break;
+    }
+}
+
+u64 GuestRoutineCall::GetTicks() const {
+    // The copies move 32 bytes with a LDM and STM pair, the fills store them with one STM
+    return 8 + (routine == GuestRoutine::Memmove ? size / 8 : size / 16);
+}
+
+bool GuestRoutineCall::RunInPlace(Memory::MemorySystem& memory,
+                                  Memory::PageTable& page_table) const {
+    if (size == 0) {
+        return true;
+    }
+    u8* const dest_pointer = memory.GetContiguousPointer(page_table, dest, size);
+    if (!dest_pointer) {
+        return false;
+    }
+    if (routine != GuestRoutine::Memmove) {
+        std::memset(dest_pointer, value, size);
+        return true;
+    }
+    const u8* const src_pointer = memory.GetContiguousPointer(page_table, src, size);
+    if (!src_pointer) {
+        return false;
+    }
+    std::memmove(dest_pointer, src_pointer, size);
+    return true;
+}
+
+void GuestRoutineCall::Run(Memory::MemorySystem& memory, const Kernel::Process& process) const {
+    constexpr u64 AddressSpaceEnd = u64{1} << 32;
+    if (u64{dest} + size > AddressSpaceEnd ||
+        (routine == GuestRoutine::Memmove && u64{src} + size > AddressSpaceEnd)) {
+        LOG_ERROR(Core_ARM11, "Guest routine {} wraps around, dest=0x{:08X} src=0x{:08X} size={}",
+                  static_cast<u32>(routine), dest, src, size);
+        return;
+    }
+
+    std::array<u8, ChunkSize> buffer;
+    switch (routine) {
+    case GuestRoutine::Memmove:
+        // Copying backward when the destination overlaps the end of the source
+        if (dest > src && dest - src < size) {
+            for (u32 remaining = size; remaining > 0;) {
+                const u32 chunk = std::min(remaining, ChunkSize);
+                remaining -= chunk;
+                memory.ReadBlock(process, src + remaining, buffer.data(), chunk);
+                memory.WriteBlock(process, dest + remaining, buffer.data(), chunk);
+            }
+        } else {
+            for (u32 offset = 0; offset < size;) {
+                const u32 chunk = std::min(size - offset, ChunkSize);
+                memory.ReadBlock(process, src + offset, buffer.data(), chunk);
+                memory.WriteBlock(process, dest + offset, buffer.data(), chunk);
+                offset += chunk;
+            }
+        }
+        break;
+    case GuestRoutine::AeabiMemclr:
+        memory.ZeroBlock(process, dest, size);
+        break;
+    default:
+        buffer.fill(value);
+        for (u32 offset = 0; offset < size;) {
+            const u32 chunk = std::min(size - offset, ChunkSize);
+            memory.WriteBlock(process, dest + offset, buffer.data(), chunk);
+            offset += chunk;
+        }
+        break;
+    }
+}
+
+bool GuestRoutineCall::Return(std::array<u32, 16>& regs) {
+    regs[15] = regs[14] & ~1u;
+    return (regs[14] & 1) != 0;
+}
+
+} // namespace HLE
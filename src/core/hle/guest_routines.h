@@ -0,0 +1,92 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+class System;
+}
+
+namespace Kernel {
+class Process;
+}
+
+namespace Memory {
+struct PageTable;
+class MemorySystem;
+} // namespace Memory
+
+/**
+ * Native implementations of the memory routines of the SDK's C library. The routines exported by
+ * the modules loaded through LDR:RO are found by name, and their first instruction is replaced by
+ * a BKPT whose immediate identifies the routine. The CPU cores run the routine natively when they
+ * reach one, then return to the caller as the routine would. As the immediate is all they need,
+ * the patched code stays valid across save states.
+ */
+namespace HLE {
+
+enum class GuestRoutine : u32 {
+    Memmove,     ///< memcpy and memmove(dest, src, size), also the __aeabi_ ones
+    Memset,      ///< memset(dest, value, size)
+    AeabiMemset, ///< __aeabi_memset(dest, size, value)
+    AeabiMemclr, ///< __aeabi_memclr(dest, size)
+    Count,
+};
+
+/// Returns the routine patched in with the BKPT immediate, if it is one
+std::optional<GuestRoutine> GetBreakpointRoutine(u32 immediate);
+
+/// Returns the routine patched in with the ARM instruction, if it is one
+std::optional<GuestRoutine> DecodeRoutineBreakpoint(u32 instruction);
+
+/**
+ * Patches the routines found among the exported symbols of a module of the process.
+ * @returns the number of routines patched.
+ */
+std::size_t PatchGuestRoutines(Core::System& system, const Kernel::Process& process,
+                               const std::vector<std::pair<VAddr, std::string>>& symbols);
+
+/// A call to a patched routine, with the arguments from the registers of the core
+class GuestRoutineCall {
+public:
+    GuestRoutineCall(GuestRoutine routine, const std::array<u32, 16>& regs);
+
+    /// Returns the ticks to charge for the call, about the instructions the SDK's routine runs
+    u64 GetTicks() const;
+
+    /**
+     * Runs the routine if the memory it accesses is all regular memory, which can be done from
+     * a host thread of the core. Returns false otherwise, the routine must then run with Run.
+     */
+    bool RunInPlace(Memory::MemorySystem& memory, Memory::PageTable& page_table) const;
+
+    /**
+     * Runs the routine through the block accesses of the memory system, which flush and
+     * invalidate the rasterizer cache. Must be called on the emulation thread.
+     */
+    void Run(Memory::MemorySystem& memory, const Kernel::Process& process) const;
+
+    /**
+     * Sets the PC to the return address, as the BX LR of the routine would. The routines return
+     * their destination, which is left in r0.
+     * @returns true if the caller is Thumb code.
+     */
+    static bool Return(std::array<u32, 16>& regs);
+
+private:
+    GuestRoutine routine;
+    VAddr dest;
+    VAddr src = 0;
+    u32 size;
+    u8 value = 0;
+};
+
+} // namespace HLE
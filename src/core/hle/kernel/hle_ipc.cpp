@@ -314,6 +314,11 @@ void MappedBuffer::Write(const void* src_buffer, std::size_t offset, std::size_t
     memory->WriteBlock(*process, address + static_cast<VAddr>(offset), src_buffer, size);
 }
 
+u8* MappedBuffer::GetPointer(std::size_t offset, std::size_t size) {
+    ASSERT(offset + size <= this->size);
+    return memory->GetContiguousPointer(*process, address + static_cast<VAddr>(offset), size);
+}
+
 } // namespace Kernel
 
 SERIALIZE_EXPORT_IMPL(Kernel::HLERequestContext::ThreadCallback)
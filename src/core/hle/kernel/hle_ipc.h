@@ -132,6 +132,13 @@ public:
     // interface for service
     void Read(void* dest_buffer, std::size_t offset, std::size_t size);
     void Write(const void* src_buffer, std::size_t offset, std::size_t size);
+
+    /**
+     * Gets a pointer to a range of the buffer for accessing it in place, or nullptr if the range
+     * isn't contiguous in host memory and has to be accessed with Read and Write.
+     */
+    u8* GetPointer(std::size_t offset, std::size_t size);
+
     std::size_t GetSize() const {
         return size;
     }
@@ -215,6 +222,11 @@ public:
         return session;
     }
 
+    /// Returns the thread that made this request.
+    std::shared_ptr<Thread> ClientThread() const {
+        return thread;
+    }
+
     class WakeupCallback {
     public:
         virtual ~WakeupCallback() = default;
@@ -0,0 +1,67 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "core/hle/kernel/ipc_debugger/profiler.h"
+
+namespace IPCDebugger {
+
+namespace {
+std::size_t GetBucket(u64 duration_ns) {
+    std::size_t bucket = 0;
+    while (bucket + 1 < NUM_PROFILE_BUCKETS && (duration_ns >> (bucket + 1)) != 0) {
+        ++bucket;
+    }
+    return bucket;
+}
+} // namespace
+
+bool Profiler::IsEnabled() const {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetEnabled(bool enabled_) {
+    enabled.store(enabled_, std::memory_order_relaxed);
+}
+
+void Profiler::RecordCall(const std::string& service_name, u32 header_code,
+                          const char* function_name, std::chrono::nanoseconds duration) {
+    const u64 duration_ns = static_cast<u64>(std::max<s64>(duration.count(), 0));
+
+    std::lock_guard lock{mutex};
+    auto [it, inserted] = profile_indices.try_emplace({service_name, header_code}, profiles.size());
+    if (inserted) {
+        HandlerProfile& profile = profiles.emplace_back();
+        profile.service_name = service_name;
+        profile.header_code = header_code;
+        profile.function_name = function_name != nullptr ? function_name : "";
+    }
+
+    HandlerProfile& profile = profiles[it->second];
+    ++profile.calls;
+    profile.total_ns += duration_ns;
+    profile.max_ns = std::max(profile.max_ns, duration_ns);
+    ++profile.histogram[GetBucket(duration_ns)];
+}
+
+std::vector<HandlerProfile> Profiler::GetProfiles() const {
+    std::lock_guard lock{mutex};
+    return profiles;
+}
+
+std::optional<HandlerProfile> Profiler::GetProfile(std::size_t index) const {
+    std::lock_guard lock{mutex};
+    if (index >= profiles.size()) {
+        return std::nullopt;
+    }
+    return profiles[index];
+}
+
+void Profiler::Reset() {
+    std::lock_guard lock{mutex};
+    profiles.clear();
+    profile_indices.clear();
+}
+
+} // namespace IPCDebugger
@@ -0,0 +1,71 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/common_types.h"
+
+namespace IPCDebugger {
+
+/// Number of buckets of the host time histograms, bucket i counts the calls that took
+/// [2^i, 2^(i+1)) nanoseconds and the last one counts all the longer calls.
+constexpr std::size_t NUM_PROFILE_BUCKETS = 32;
+
+/**
+ * Aggregated host time spent in the HLE handler of one command of a service.
+ */
+struct HandlerProfile {
+    std::string service_name;
+    u32 header_code = 0;
+    std::string function_name;
+    u64 calls = 0;
+    u64 total_ns = 0;
+    u64 max_ns = 0;
+    std::array<u64, NUM_PROFILE_BUCKETS> histogram{};
+};
+
+/**
+ * Counts the calls to the HLE service handlers and the host time they take. Unlike the recorder,
+ * nothing is kept per request, so that it can stay enabled while playing. Only the synchronous
+ * part of the handlers is measured, the time a handler leaves the client thread asleep isn't.
+ */
+class Profiler {
+public:
+    bool IsEnabled() const;
+
+    /// Enabling or disabling the profiler keeps the profiles gathered so far
+    void SetEnabled(bool enabled);
+
+    /// Adds a call of the handler of a command to its profile
+    void RecordCall(const std::string& service_name, u32 header_code, const char* function_name,
+                    std::chrono::nanoseconds duration);
+
+    /// Returns the profiles, in the order their command was first called
+    std::vector<HandlerProfile> GetProfiles() const;
+
+    /// Returns the profile at the index in the order of GetProfiles
+    std::optional<HandlerProfile> GetProfile(std::size_t index) const;
+
+    /// Drops the profiles gathered so far
+    void Reset();
+
+private:
+    std::atomic_bool enabled{false};
+
+    mutable std::mutex mutex;
+    std::vector<HandlerProfile> profiles;
+    /// Index in profiles of the profile of each service and command
+    std::map<std::pair<std::string, u32>, std::size_t> profile_indices;
+};
+
+} // namespace IPCDebugger
@@ -10,6 +10,7 @@
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/config_mem.h"
 #include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/ipc_debugger/profiler.h"
 #include "core/hle/kernel/ipc_debugger/recorder.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/memory.h"
@@ -37,6 +38,7 @@ KernelSystem::KernelSystem(Memory::MemorySystem& memory, Core::Timing& timing,
     }
     timer_manager = std::make_unique<TimerManager>(timing);
     ipc_recorder = std::make_unique<IPCDebugger::Recorder>();
+    ipc_profiler = std::make_unique<IPCDebugger::Profiler>();
     stored_processes.assign(num_cores, nullptr);
 
     next_thread_id = 1;
@@ -59,7 +61,7 @@ u32 KernelSystem::GenerateObjectID() {
     return next_object_id++;
 }
 
-std::shared_ptr<Process> KernelSystem::GetCurrentProcess() const {
+const std::shared_ptr<Process>& KernelSystem::GetCurrentProcess() const {
     return current_process;
 }
 
@@ -144,6 +146,14 @@ const IPCDebugger::Recorder& KernelSystem::GetIPCRecorder() const {
     return *ipc_recorder;
 }
 
+IPCDebugger::Profiler& KernelSystem::GetIPCProfiler() {
+    return *ipc_profiler;
+}
+
+const IPCDebugger::Profiler& KernelSystem::GetIPCProfiler() const {
+    return *ipc_profiler;
+}
+
 void KernelSystem::AddNamedPort(std::string name, std::shared_ptr<ClientPort> port) {
     named_ports.emplace(std::move(name), std::move(port));
 }
@@ -177,6 +187,18 @@ void KernelSystem::serialize(Archive& ar, const unsigned int file_version) {
     ar& stored_processes;
     ar& next_thread_id;
     // Deliberately don't include debugger info to allow debugging through loads
+
+    if (Archive::is_loading::value) {
+        // Older states kept the waiting threads in the order they started waiting, any object
+        // with waiting threads is found among the objects of those threads
+        for (auto& thread_manager : thread_managers) {
+            for (auto& thread : thread_manager->GetThreadList()) {
+                for (auto& object : thread->wait_objects) {
+                    object->SortWaitingThreads();
+                }
+            }
+        }
+    }
 }
 
 SERIALIZE_IMPL(KernelSystem)
@@ -33,8 +33,9 @@ class Timing;
 }
 
 namespace IPCDebugger {
+class Profiler;
 class Recorder;
-}
+} // namespace IPCDebugger
 
 namespace Kernel {
 
@@ -210,7 +211,7 @@ public:
     /// Retrieves a process from the current list of processes.
     std::shared_ptr<Process> GetProcessById(u32 process_id) const;
 
-    std::shared_ptr<Process> GetCurrentProcess() const;
+    const std::shared_ptr<Process>& GetCurrentProcess() const;
     void SetCurrentProcess(std::shared_ptr<Process> process);
     void SetCurrentProcessForCPU(std::shared_ptr<Process> process, u32 core_id);
 
@@ -237,6 +238,9 @@ public:
     IPCDebugger::Recorder& GetIPCRecorder();
     const IPCDebugger::Recorder& GetIPCRecorder() const;
 
+    IPCDebugger::Profiler& GetIPCProfiler();
+    const IPCDebugger::Profiler& GetIPCProfiler() const;
+
     std::shared_ptr<MemoryRegionInfo> GetMemoryRegion(MemoryRegion region);
 
     void HandleSpecialMapping(VMManager& address_space, const AddressMapping& mapping);
@@ -296,6 +300,7 @@ private:
     std::shared_ptr<SharedPage::Handler> shared_page_handler;
 
     std::unique_ptr<IPCDebugger::Recorder> ipc_recorder;
+    std::unique_ptr<IPCDebugger::Profiler> ipc_profiler;
 
     u32 next_thread_id;
 
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include "common/archives.h"
@@ -112,11 +113,11 @@ void Mutex::UpdatePriority() {
     if (!holding_thread)
         return;
 
+    // The first waiting thread has the highest priority
+    const auto& waiting_threads = GetWaitingThreads();
     u32 best_priority = ThreadPrioLowest;
-    for (auto& waiter : GetWaitingThreads()) {
-        if (waiter->current_priority < best_priority)
-            best_priority = waiter->current_priority;
-    }
+    if (!waiting_threads.empty())
+        best_priority = std::min(best_priority, waiting_threads.front()->current_priority);
 
     if (best_priority != priority) {
         priority = best_priority;
@@ -10,6 +10,7 @@
 #include "common/archives.h"
 #include "common/assert.h"
 #include "common/common_funcs.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/serialization/boost_vector.hpp"
 #include "core/hle/kernel/errors.h"
@@ -157,9 +158,17 @@ void Process::Run(s32 main_thread_priority, u32 stack_size) {
 
     // Map CodeSet segments
     MapSegment(codeset->CodeSegment(), VMAPermission::ReadExecute, MemoryState::Code);
+
     MapSegment(codeset->RODataSegment(), VMAPermission::Read, MemoryState::Code);
     MapSegment(codeset->DataSegment(), VMAPermission::ReadWrite, MemoryState::Private);
 
+    // Lets the JIT recognize processes running the same code
+    const CodeSet::Segment& code = codeset->CodeSegment();
+    Memory::PageTable& page_table = *vm_manager.page_table;
+    page_table.code_hash = Common::ComputeHash64(codeset->memory.data() + code.offset, code.size);
+    page_table.code_begin = code.addr;
+    page_table.code_end = code.addr + code.size;
+
     // Allocate and map stack
     HeapAllocate(Memory::HEAP_VADDR_END - stack_size, stack_size, VMAPermission::ReadWrite,
                  MemoryState::Locked, true);
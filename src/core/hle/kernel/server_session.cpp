@@ -84,14 +84,24 @@ ResultCode ServerSession::HandleSyncRequest(std::shared_ptr<Thread> thread) {
 
     // If this ServerSession has an associated HLE handler, forward the request to it.
     if (hle_handler != nullptr) {
-        std::array<u32_le, IPC::COMMAND_BUFFER_LENGTH + 2 * IPC::MAX_STATIC_BUFFERS> cmd_buf;
+        std::array<u32_le, IPC::COMMAND_BUFFER_LENGTH + 2 * IPC::MAX_STATIC_BUFFERS> local_cmd_buf;
+        constexpr std::size_t cmd_buf_size = local_cmd_buf.size() * sizeof(u32);
         auto current_process = thread->owner_process;
-        kernel.memory.ReadBlock(*current_process, thread->GetCommandBufferAddress(), cmd_buf.data(),
-                                cmd_buf.size() * sizeof(u32));
+
+        // The command buffer is in the TLS of the thread, which is used in place when it can be
+        // accessed directly
+        const VAddr cmd_buf_address = thread->GetCommandBufferAddress();
+        auto* cmd_buf = reinterpret_cast<u32_le*>(
+            kernel.memory.GetContiguousPointer(*current_process, cmd_buf_address, cmd_buf_size));
+        const bool in_place = cmd_buf != nullptr;
+        if (!in_place) {
+            cmd_buf = local_cmd_buf.data();
+            kernel.memory.ReadBlock(*current_process, cmd_buf_address, cmd_buf, cmd_buf_size);
+        }
 
         auto context =
             std::make_shared<Kernel::HLERequestContext>(kernel, SharedFrom(this), thread);
-        context->PopulateFromIncomingCommandBuffer(cmd_buf.data(), current_process);
+        context->PopulateFromIncomingCommandBuffer(cmd_buf, current_process);
 
         hle_handler->HandleSyncRequest(*context);
 
@@ -101,9 +111,11 @@ ResultCode ServerSession::HandleSyncRequest(std::shared_ptr<Thread> thread) {
         // put the thread to sleep then the writing of the command buffer will be deferred to the
         // wakeup callback.
         if (thread->status == Kernel::ThreadStatus::Running) {
-            context->WriteToOutgoingCommandBuffer(cmd_buf.data(), *current_process);
-            kernel.memory.WriteBlock(*current_process, thread->GetCommandBufferAddress(),
-                                     cmd_buf.data(), cmd_buf.size() * sizeof(u32));
+            context->WriteToOutgoingCommandBuffer(cmd_buf, *current_process);
+            if (!in_place) {
+                kernel.memory.WriteBlock(*current_process, cmd_buf_address, cmd_buf,
+                                         cmd_buf_size);
+            }
         }
     }
 
@@ -4,10 +4,13 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cinttypes>
 #include <map>
+#include <vector>
 #include <fmt/format.h>
 #include "common/logging/log.h"
+#include "common/metrics.h"
 #include "common/microprofile.h"
 #include "common/scope_exit.h"
 #include "core/arm/arm_interface.h"
@@ -39,6 +42,7 @@
 #include "core/hle/lock.h"
 #include "core/hle/result.h"
 #include "core/hle/service/service.h"
+#include "core/perf_stats.h"
 
 namespace Kernel {
 
@@ -104,6 +108,9 @@ public:
     SVC(Core::System& system);
     void CallSVC(u32 immediate);
 
+    /// Returns the name of every SVC, indexed by their number
+    static std::vector<const char*> GetSVCNames();
+
 private:
     Core::System& system;
     Kernel::KernelSystem& kernel;
@@ -116,6 +123,21 @@ private:
     u32 GetReg(std::size_t n);
     void SetReg(std::size_t n, u32 value);
 
+    /**
+     * Called by the SVCs a thread polls with, such as waits with a zero timeout. A thread polling
+     * over and over with little else in between waits for something that can only change once
+     * another thread or an event runs, so the core skips the rest of its slice.
+     */
+    void NotePoll();
+
+    const Thread* polling_thread = nullptr;
+    u64 last_poll_ticks = 0;
+    u32 num_polls = 0;
+
+    /// The wakeup callbacks hold no state of their own, waiting threads share them
+    std::shared_ptr<WakeupCallback> sync_callback;
+    std::shared_ptr<WakeupCallback> sync_output_callback;
+
     // SVC interfaces
 
     ResultCode ControlMemory(u32* out_addr, u32 addr0, u32 addr1, u32 size, u32 operation,
@@ -474,9 +496,20 @@ private:
     friend class boost::serialization::access;
 };
 
+/// Takes the references a sleeping thread keeps to the objects it waits on
+static std::vector<std::shared_ptr<WaitObject>> ShareWaitObjects(
+    const std::vector<WaitObject*>& objects) {
+    std::vector<std::shared_ptr<WaitObject>> shared_objects;
+    shared_objects.reserve(objects.size());
+    for (WaitObject* object : objects) {
+        shared_objects.push_back(SharedFrom(object));
+    }
+    return shared_objects;
+}
+
 /// Wait for a handle to synchronize, timeout after the specified nanoseconds
 ResultCode SVC::WaitSynchronization1(Handle handle, s64 nano_seconds) {
-    auto object = kernel.GetCurrentProcess()->handle_table.Get<WaitObject>(handle);
+    WaitObject* object = kernel.GetCurrentProcess()->handle_table.GetPointer<WaitObject>(handle);
     Thread* thread = kernel.GetCurrentThreadManager().GetCurrentThread();
 
     if (object == nullptr)
@@ -487,17 +520,19 @@ ResultCode SVC::WaitSynchronization1(Handle handle, s64 nano_seconds) {
 
     if (object->ShouldWait(thread)) {
 
-        if (nano_seconds == 0)
+        if (nano_seconds == 0) {
+            NotePoll();
             return RESULT_TIMEOUT;
+        }
 
-        thread->wait_objects = {object};
+        thread->wait_objects = {SharedFrom(object)};
         object->AddWaitingThread(SharedFrom(thread));
         thread->status = ThreadStatus::WaitSynchAny;
 
         // Create an event to wake the thread up after the specified nanosecond delay has passed
         thread->WakeAfterDelay(nano_seconds);
 
-        thread->wakeup_callback = std::make_shared<SVC_SyncCallback>(false);
+        thread->wakeup_callback = sync_callback;
 
         system.PrepareReschedule();
 
@@ -528,12 +563,14 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
     if (handle_count < 0)
         return ERR_OUT_OF_RANGE;
 
-    using ObjectPtr = std::shared_ptr<WaitObject>;
+    // The references to the objects are only taken if the thread goes to sleep on them
+    using ObjectPtr = WaitObject*;
     std::vector<ObjectPtr> objects(handle_count);
 
+    const HandleTable& handle_table = kernel.GetCurrentProcess()->handle_table;
     for (int i = 0; i < handle_count; ++i) {
         Handle handle = memory.Read32(handles_address + i * sizeof(Handle));
-        auto object = kernel.GetCurrentProcess()->handle_table.Get<WaitObject>(handle);
+        WaitObject* object = handle_table.GetPointer<WaitObject>(handle);
         if (object == nullptr)
             return ERR_INVALID_HANDLE;
         objects[i] = object;
@@ -556,8 +593,10 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
 
         // If a timeout value of 0 was provided, just return the Timeout error code instead of
         // suspending the thread.
-        if (nano_seconds == 0)
+        if (nano_seconds == 0) {
+            NotePoll();
             return RESULT_TIMEOUT;
+        }
 
         // Put the thread to sleep
         thread->status = ThreadStatus::WaitSynchAll;
@@ -567,12 +606,12 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
             object->AddWaitingThread(SharedFrom(thread));
         }
 
-        thread->wait_objects = std::move(objects);
+        thread->wait_objects = ShareWaitObjects(objects);
 
         // Create an event to wake the thread up after the specified nanosecond delay has passed
         thread->WakeAfterDelay(nano_seconds);
 
-        thread->wakeup_callback = std::make_shared<SVC_SyncCallback>(false);
+        thread->wakeup_callback = sync_callback;
 
         system.PrepareReschedule();
 
@@ -589,7 +628,7 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
 
         if (itr != objects.end()) {
             // We found a ready object, acquire it and set the result value
-            WaitObject* object = itr->get();
+            WaitObject* object = *itr;
             object->Acquire(thread);
             *out = static_cast<s32>(std::distance(objects.begin(), itr));
             return RESULT_SUCCESS;
@@ -599,19 +638,21 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
 
         // If a timeout value of 0 was provided, just return the Timeout error code instead of
         // suspending the thread.
-        if (nano_seconds == 0)
+        if (nano_seconds == 0) {
+            NotePoll();
             return RESULT_TIMEOUT;
+        }
 
         // Put the thread to sleep
         thread->status = ThreadStatus::WaitSynchAny;
 
         // Add the thread to each of the objects' waiting threads.
         for (std::size_t i = 0; i < objects.size(); ++i) {
-            WaitObject* object = objects[i].get();
+            WaitObject* object = objects[i];
             object->AddWaitingThread(SharedFrom(thread));
         }
 
-        thread->wait_objects = std::move(objects);
+        thread->wait_objects = ShareWaitObjects(objects);
 
         // Note: If no handles and no timeout were given, then the thread will deadlock, this is
         // consistent with hardware behavior.
@@ -619,7 +660,7 @@ ResultCode SVC::WaitSynchronizationN(s32* out, VAddr handles_address, s32 handle
         // Create an event to wake the thread up after the specified nanosecond delay has passed
         thread->WakeAfterDelay(nano_seconds);
 
-        thread->wakeup_callback = std::make_shared<SVC_SyncCallback>(true);
+        thread->wakeup_callback = sync_output_callback;
 
         system.PrepareReschedule();
 
@@ -1012,7 +1053,7 @@ ResultCode SVC::CreateMutex(Handle* out_handle, u32 initial_locked) {
 ResultCode SVC::ReleaseMutex(Handle handle) {
     LOG_TRACE(Kernel_SVC, "called handle=0x{:08X}", handle);
 
-    std::shared_ptr<Mutex> mutex = kernel.GetCurrentProcess()->handle_table.Get<Mutex>(handle);
+    Mutex* mutex = kernel.GetCurrentProcess()->handle_table.GetPointer<Mutex>(handle);
     if (mutex == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1079,8 +1120,7 @@ ResultCode SVC::CreateSemaphore(Handle* out_handle, s32 initial_count, s32 max_c
 ResultCode SVC::ReleaseSemaphore(s32* count, Handle handle, s32 release_count) {
     LOG_TRACE(Kernel_SVC, "called release_count={}, handle=0x{:08X}", release_count, handle);
 
-    std::shared_ptr<Semaphore> semaphore =
-        kernel.GetCurrentProcess()->handle_table.Get<Semaphore>(handle);
+    Semaphore* semaphore = kernel.GetCurrentProcess()->handle_table.GetPointer<Semaphore>(handle);
     if (semaphore == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1157,7 +1197,7 @@ ResultCode SVC::DuplicateHandle(Handle* out, Handle handle) {
 ResultCode SVC::SignalEvent(Handle handle) {
     LOG_TRACE(Kernel_SVC, "called event=0x{:08X}", handle);
 
-    std::shared_ptr<Event> evt = kernel.GetCurrentProcess()->handle_table.Get<Event>(handle);
+    Event* evt = kernel.GetCurrentProcess()->handle_table.GetPointer<Event>(handle);
     if (evt == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1170,7 +1210,7 @@ ResultCode SVC::SignalEvent(Handle handle) {
 ResultCode SVC::ClearEvent(Handle handle) {
     LOG_TRACE(Kernel_SVC, "called event=0x{:08X}", handle);
 
-    std::shared_ptr<Event> evt = kernel.GetCurrentProcess()->handle_table.Get<Event>(handle);
+    Event* evt = kernel.GetCurrentProcess()->handle_table.GetPointer<Event>(handle);
     if (evt == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1194,7 +1234,7 @@ ResultCode SVC::CreateTimer(Handle* out_handle, u32 reset_type) {
 ResultCode SVC::ClearTimer(Handle handle) {
     LOG_TRACE(Kernel_SVC, "called timer=0x{:08X}", handle);
 
-    std::shared_ptr<Timer> timer = kernel.GetCurrentProcess()->handle_table.Get<Timer>(handle);
+    Timer* timer = kernel.GetCurrentProcess()->handle_table.GetPointer<Timer>(handle);
     if (timer == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1210,7 +1250,7 @@ ResultCode SVC::SetTimer(Handle handle, s64 initial, s64 interval) {
         return ERR_OUT_OF_RANGE_KERNEL;
     }
 
-    std::shared_ptr<Timer> timer = kernel.GetCurrentProcess()->handle_table.Get<Timer>(handle);
+    Timer* timer = kernel.GetCurrentProcess()->handle_table.GetPointer<Timer>(handle);
     if (timer == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1223,7 +1263,7 @@ ResultCode SVC::SetTimer(Handle handle, s64 initial, s64 interval) {
 ResultCode SVC::CancelTimer(Handle handle) {
     LOG_TRACE(Kernel_SVC, "called timer=0x{:08X}", handle);
 
-    std::shared_ptr<Timer> timer = kernel.GetCurrentProcess()->handle_table.Get<Timer>(handle);
+    Timer* timer = kernel.GetCurrentProcess()->handle_table.GetPointer<Timer>(handle);
     if (timer == nullptr)
         return ERR_INVALID_HANDLE;
 
@@ -1240,8 +1280,10 @@ void SVC::SleepThread(s64 nanoseconds) {
 
     // Don't attempt to yield execution if there are no available threads to run,
     // this way we avoid a useless reschedule to the idle thread.
-    if (nanoseconds == 0 && !thread_manager.HaveReadyThreads())
+    if (nanoseconds == 0 && !thread_manager.HaveReadyThreads()) {
+        NotePoll();
         return;
+    }
 
     // Sleep current thread and check for next thread to schedule
     thread_manager.WaitCurrentThread_Sleep();
@@ -1259,6 +1301,7 @@ s64 SVC::GetSystemTick() {
     // Advance time to defeat dumb games (like Cubic Ninja) that busy-wait for the frame to end.
     // Measured time between two calls on a 9.2 o3DS with Ninjhax 1.1b
     system.GetRunningCore().GetTimer().AddTicks(150);
+    NotePoll();
     return result;
 }
 
@@ -1596,10 +1639,38 @@ const SVC::FunctionDef* SVC::GetSVCInfo(u32 func_num) {
     return &SVC_Table[func_num];
 }
 
+std::vector<const char*> SVC::GetSVCNames() {
+    std::vector<const char*> names(SVC_Table.size());
+    std::transform(SVC_Table.begin(), SVC_Table.end(), names.begin(),
+                   [](const FunctionDef& def) { return def.name; });
+    return names;
+}
+
+static Common::Metrics::CounterVector svc_calls_metric{
+    "citra_svc_calls_total", "SVCs called by the guest", "svc", SVC::GetSVCNames()};
+static Common::Metrics::CounterVector svc_time_metric{
+    "citra_svc_seconds_total", "Walltime spent in SVCs, including waits for the HLE lock", "svc",
+    SVC::GetSVCNames(), 1e-9};
+
 MICROPROFILE_DEFINE(Kernel_SVC, "Kernel", "SVC", MP_RGB(70, 200, 70));
 
 void SVC::CallSVC(u32 immediate) {
+    const FunctionDef* info = GetSVCInfo(immediate);
+    if (info == nullptr) {
+        return;
+    }
+    LOG_TRACE(Kernel_SVC, "calling {}", info->name);
+    svc_calls_metric.Add(immediate);
+
     MICROPROFILE_SCOPE(Kernel_SVC);
+    Core::ScopedPerfSubsystem hle_time{Core::PerfSubsystem::HLE};
+    const auto start = std::chrono::steady_clock::now();
+    SCOPE_EXIT({
+        svc_time_metric.Add(immediate,
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+    });
 
     // Lock the global kernel mutex when we enter the kernel HLE.
     std::lock_guard lock{HLE::g_hle_lock};
@@ -1607,18 +1678,43 @@ void SVC::CallSVC(u32 immediate) {
     DEBUG_ASSERT_MSG(kernel.GetCurrentProcess()->status == ProcessStatus::Running,
                      "Running threads from exiting processes is unimplemented");
 
-    const FunctionDef* info = GetSVCInfo(immediate);
-    LOG_TRACE(Kernel_SVC, "calling {}", info->name);
-    if (info) {
-        if (info->func) {
-            (this->*(info->func))();
-        } else {
-            LOG_ERROR(Kernel_SVC, "unimplemented SVC function {}(..)", info->name);
-        }
+    if (info->func) {
+        (this->*(info->func))();
+    } else {
+        LOG_ERROR(Kernel_SVC, "unimplemented SVC function {}(..)", info->name);
     }
 }
 
-SVC::SVC(Core::System& system) : system(system), kernel(system.Kernel()), memory(system.Memory()) {}
+SVC::SVC(Core::System& system)
+    : system(system), kernel(system.Kernel()), memory(system.Memory()),
+      sync_callback(std::make_shared<SVC_SyncCallback>(false)),
+      sync_output_callback(std::make_shared<SVC_SyncCallback>(true)) {}
+
+/// Polls further apart than this are not part of the same loop
+constexpr u64 MAX_POLL_INTERVAL_TICKS = 2000;
+/// Number of polls in a row after which the thread is considered idle
+constexpr u32 MIN_POLLS_BEFORE_IDLE = 16;
+
+void SVC::NotePoll() {
+    Core::Timing::Timer& timer = system.GetRunningCore().GetTimer();
+    const Thread* thread = kernel.GetCurrentThreadManager().GetCurrentThread();
+    const u64 ticks = timer.GetTicks();
+    if (thread != polling_thread || ticks - last_poll_ticks > MAX_POLL_INTERVAL_TICKS) {
+        polling_thread = thread;
+        num_polls = 0;
+    }
+    last_poll_ticks = ticks;
+    if (++num_polls < MIN_POLLS_BEFORE_IDLE) {
+        return;
+    }
+
+    LOG_TRACE(Kernel_SVC, "Thread {} is polling, skipping to the next event",
+              thread->GetObjectId());
+    timer.Idle();
+    system.GetRunningCore().PrepareReschedule();
+    // The loop goes on after the skipped time
+    last_poll_ticks = timer.GetTicks();
+}
 
 u32 SVC::GetReg(std::size_t n) {
     return system.GetRunningCore().GetReg(static_cast<int>(n));
@@ -46,11 +46,13 @@ VMManager::~VMManager() = default;
 
 void VMManager::Reset() {
     vma_map.clear();
+    free_vmas.clear();
 
     // Initialize the map with a single free region covering the entire managed space.
     VirtualMemoryArea initial_vma;
     initial_vma.size = MAX_ADDRESS;
     vma_map.emplace(initial_vma.base, initial_vma);
+    free_vmas.insert(initial_vma.base);
 
     page_table->Clear();
 
@@ -67,31 +69,37 @@ VMManager::VMAHandle VMManager::FindVMA(VAddr target) const {
 
 ResultVal<VAddr> VMManager::MapBackingMemoryToBase(VAddr base, u32 region_size, MemoryRef memory,
                                                    u32 size, MemoryState state) {
+    const VAddr region_end = base + region_size;
 
-    // Find the first Free VMA.
-    VMAHandle vma_handle = std::find_if(vma_map.begin(), vma_map.end(), [&](const auto& vma) {
-        if (vma.second.type != VMAType::Free)
-            return false;
+    // Find the first Free VMA the block fits in, starting with the one holding the base address.
+    auto free_vma = free_vmas.upper_bound(base);
+    if (free_vma != free_vmas.begin()) {
+        --free_vma;
+    }
+    for (; free_vma != free_vmas.end(); ++free_vma) {
+        const VirtualMemoryArea& vma = vma_map.find(*free_vma)->second;
+        const VAddr vma_end = vma.base + vma.size;
+        const VAddr target = std::max(base, vma.base);
+
+        // Do not try to allocate the block if there are no available addresses within the desired
+        // region.
+        if (target + size > region_end) {
+            break;
+        }
+        if (vma_end <= target || target + size > vma_end) {
+            continue;
+        }
 
-        VAddr vma_end = vma.second.base + vma.second.size;
-        return vma_end > base && vma_end >= base + size;
-    });
+        auto result = MapBackingMemory(target, memory, size, state);
 
-    VAddr target = std::max(base, vma_handle->second.base);
+        if (result.Failed())
+            return result.Code();
 
-    // Do not try to allocate the block if there are no available addresses within the desired
-    // region.
-    if (vma_handle == vma_map.end() || target + size > base + region_size) {
-        return ResultCode(ErrorDescription::OutOfMemory, ErrorModule::Kernel,
-                          ErrorSummary::OutOfResource, ErrorLevel::Permanent);
+        return MakeResult<VAddr>(target);
     }
 
-    auto result = MapBackingMemory(target, memory, size, state);
-
-    if (result.Failed())
-        return result.Code();
-
-    return MakeResult<VAddr>(target);
+    return ResultCode(ErrorDescription::OutOfMemory, ErrorModule::Kernel,
+                      ErrorSummary::OutOfResource, ErrorLevel::Permanent);
 }
 
 ResultVal<VMManager::VMAHandle> VMManager::MapBackingMemory(VAddr target, MemoryRef memory,
@@ -103,6 +111,7 @@ ResultVal<VMManager::VMAHandle> VMManager::MapBackingMemory(VAddr target, Memory
     VirtualMemoryArea& final_vma = vma_handle->second;
     ASSERT(final_vma.size == size);
 
+    free_vmas.erase(final_vma.base);
     final_vma.type = VMAType::BackingMemory;
     final_vma.permissions = VMAPermission::ReadWrite;
     final_vma.meminfo_state = state;
@@ -120,6 +129,7 @@ ResultVal<VMManager::VMAHandle> VMManager::MapMMIO(VAddr target, PAddr paddr, u3
     VirtualMemoryArea& final_vma = vma_handle->second;
     ASSERT(final_vma.size == size);
 
+    free_vmas.erase(final_vma.base);
     final_vma.type = VMAType::MMIO;
     final_vma.permissions = VMAPermission::ReadWrite;
     final_vma.meminfo_state = state;
@@ -155,11 +165,11 @@ ResultCode VMManager::ChangeMemoryState(VAddr target, u32 size, MemoryState expe
 
     const VMAIter end = vma_map.end();
     // The comparison against the end of the range must be done using addresses since VMAs can be
-    // merged during this process, causing invalidation of the iterators.
+    // merged during this process, causing invalidation of the iterators. The page table doesn't
+    // depend on the state or the permissions, so it doesn't need to be updated.
     while (vma != end && vma->second.base < target_end) {
         vma->second.permissions = new_perms;
         vma->second.meminfo_state = new_state;
-        UpdatePageTableForVMA(vma->second);
         vma = std::next(MergeAdjacent(vma));
     }
 
@@ -174,8 +184,7 @@ VMManager::VMAIter VMManager::Unmap(VMAIter vma_handle) {
 
     vma.backing_memory = nullptr;
     vma.paddr = 0;
-
-    UpdatePageTableForVMA(vma);
+    free_vmas.insert(vma.base);
 
     return MergeAdjacent(vma_handle);
 }
@@ -190,6 +199,8 @@ ResultCode VMManager::UnmapRange(VAddr target, u32 size) {
     while (vma != end && vma->second.base < target_end) {
         vma = std::next(Unmap(vma));
     }
+    // The pages of all the VMAs of the range are unmapped at once
+    memory.UnmapRegion(*page_table, target, size);
 
     ASSERT(FindVMA(target)->second.size >= size);
     return RESULT_SUCCESS;
@@ -198,9 +209,8 @@ ResultCode VMManager::UnmapRange(VAddr target, u32 size) {
 VMManager::VMAHandle VMManager::Reprotect(VMAHandle vma_handle, VMAPermission new_perms) {
     VMAIter iter = StripIterConstness(vma_handle);
 
-    VirtualMemoryArea& vma = iter->second;
-    vma.permissions = new_perms;
-    UpdatePageTableForVMA(vma);
+    // The page table doesn't depend on the permissions, so it doesn't need to be updated
+    iter->second.permissions = new_perms;
 
     return MergeAdjacent(iter);
 }
@@ -316,6 +326,7 @@ VMManager::VMAIter VMManager::SplitVMA(VMAIter vma_handle, u32 offset_in_vma) {
 
     switch (new_vma.type) {
     case VMAType::Free:
+        free_vmas.insert(new_vma.base);
         break;
     case VMAType::BackingMemory:
         new_vma.backing_memory += offset_in_vma;
@@ -334,6 +345,9 @@ VMManager::VMAIter VMManager::MergeAdjacent(VMAIter iter) {
     const VMAIter next_vma = std::next(iter);
     if (next_vma != vma_map.end() && iter->second.CanBeMergedWith(next_vma->second)) {
         iter->second.size += next_vma->second.size;
+        if (next_vma->second.type == VMAType::Free) {
+            free_vmas.erase(next_vma->first);
+        }
         vma_map.erase(next_vma);
     }
 
@@ -341,6 +355,9 @@ VMManager::VMAIter VMManager::MergeAdjacent(VMAIter iter) {
         VMAIter prev_vma = std::prev(iter);
         if (prev_vma->second.CanBeMergedWith(iter->second)) {
             prev_vma->second.size += iter->second.size;
+            if (iter->second.type == VMAType::Free) {
+                free_vmas.erase(iter->first);
+            }
             vma_map.erase(iter);
             iter = prev_vma;
         }
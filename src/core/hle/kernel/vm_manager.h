@@ -6,6 +6,7 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <utility>
 #include <vector>
 #include <boost/serialization/map.hpp>
@@ -218,7 +219,7 @@ private:
     /// Converts a VMAHandle to a mutable VMAIter.
     VMAIter StripIterConstness(const VMAHandle& iter);
 
-    /// Unmaps the given VMA.
+    /// Marks the given VMA as free, leaving the update of its pages to the caller.
     VMAIter Unmap(VMAIter vma);
 
     /**
@@ -250,10 +251,25 @@ private:
 
     Memory::MemorySystem& memory;
 
+    /**
+     * Base addresses of the Free VMAs, so that looking for a free range doesn't have to go through
+     * all the mapped ones. It must be kept in sync with vma_map whenever a VMA is split, merged or
+     * changes type.
+     */
+    std::set<VAddr> free_vmas;
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
         ar& vma_map;
         ar& page_table;
+        if (Archive::is_loading::value) {
+            free_vmas.clear();
+            for (const auto& [base, vma] : vma_map) {
+                if (vma.type == VMAType::Free) {
+                    free_vmas.insert(base);
+                }
+            }
+        }
     }
     friend class boost::serialization::access;
 };
@@ -29,7 +29,16 @@ SERIALIZE_IMPL(WaitObject)
 void WaitObject::AddWaitingThread(std::shared_ptr<Thread> thread) {
     auto itr = std::find(waiting_threads.begin(), waiting_threads.end(), thread);
     if (itr == waiting_threads.end())
-        waiting_threads.push_back(std::move(thread));
+        InsertWaitingThread(std::move(thread));
+}
+
+void WaitObject::InsertWaitingThread(std::shared_ptr<Thread> thread) {
+    const auto itr = std::upper_bound(waiting_threads.begin(), waiting_threads.end(),
+                                      thread->current_priority,
+                                      [](u32 priority, const std::shared_ptr<Thread>& waiter) {
+                                          return priority < waiter->current_priority;
+                                      });
+    waiting_threads.insert(itr, std::move(thread));
 }
 
 void WaitObject::RemoveWaitingThread(Thread* thread) {
@@ -43,9 +52,7 @@ void WaitObject::RemoveWaitingThread(Thread* thread) {
 }
 
 std::shared_ptr<Thread> WaitObject::GetHighestPriorityReadyThread() const {
-    Thread* candidate = nullptr;
-    u32 candidate_priority = ThreadPrioLowest + 1;
-
+    // The list is in priority order, the first ready thread is the one to wake up
     for (const auto& thread : waiting_threads) {
         // The list of waiting threads must not contain threads that are not waiting to be awakened.
         ASSERT_MSG(thread->status == ThreadStatus::WaitSynchAny ||
@@ -53,9 +60,6 @@ std::shared_ptr<Thread> WaitObject::GetHighestPriorityReadyThread() const {
                        thread->status == ThreadStatus::WaitHleEvent,
                    "Inconsistent thread statuses in waiting_threads");
 
-        if (thread->current_priority >= candidate_priority)
-            continue;
-
         if (ShouldWait(thread.get()))
             continue;
 
@@ -70,12 +74,29 @@ std::shared_ptr<Thread> WaitObject::GetHighestPriorityReadyThread() const {
         }
 
         if (ready_to_run) {
-            candidate = thread.get();
-            candidate_priority = thread->current_priority;
+            return thread;
         }
     }
 
-    return SharedFrom(candidate);
+    return nullptr;
+}
+
+void WaitObject::UpdateWaitingThreadPriority(Thread* thread) {
+    auto itr = std::find_if(waiting_threads.begin(), waiting_threads.end(),
+                            [thread](const auto& p) { return p.get() == thread; });
+    if (itr == waiting_threads.end())
+        return;
+
+    std::shared_ptr<Thread> waiter = std::move(*itr);
+    waiting_threads.erase(itr);
+    InsertWaitingThread(std::move(waiter));
+}
+
+void WaitObject::SortWaitingThreads() {
+    std::stable_sort(waiting_threads.begin(), waiting_threads.end(),
+                     [](const std::shared_ptr<Thread>& a, const std::shared_ptr<Thread>& b) {
+                         return a->current_priority < b->current_priority;
+                     });
 }
 
 void WaitObject::WakeupAllWaitingThreads() {
@@ -53,14 +53,29 @@ public:
     /// Obtains the highest priority thread that is ready to run from this object's waiting list.
     std::shared_ptr<Thread> GetHighestPriorityReadyThread() const;
 
-    /// Get a const reference to the waiting threads list for debug use
+    /**
+     * Moves a waiting thread whose priority changed to its new place in the waiting list
+     * @param thread Pointer to the thread, does nothing if it doesn't wait on this object
+     */
+    void UpdateWaitingThreadPriority(Thread* thread);
+
+    /// Restores the priority order of the waiting list, for lists that don't follow it yet
+    void SortWaitingThreads();
+
+    /// Get a const reference to the waiting threads list, ordered by priority
     const std::vector<std::shared_ptr<Thread>>& GetWaitingThreads() const;
 
     /// Sets a callback which is called when the object becomes available
     void SetHLENotifier(std::function<void()> callback);
 
 private:
-    /// Threads waiting for this object to become available
+    /// Inserts the thread after the waiting threads of the same or a higher priority
+    void InsertWaitingThread(std::shared_ptr<Thread> thread);
+
+    /**
+     * Threads waiting for this object to become available, from the highest to the lowest
+     * priority and in the order they started waiting for a same priority
+     */
     std::vector<std::shared_ptr<Thread>> waiting_threads;
 
     /// Function to call when this object becomes available
@@ -81,4 +96,12 @@ inline std::shared_ptr<WaitObject> DynamicObjectCast<WaitObject>(std::shared_ptr
     return nullptr;
 }
 
+template <>
+inline WaitObject* DynamicObjectCast<WaitObject>(Object* object) {
+    if (object != nullptr && object->IsWaitable()) {
+        return static_cast<WaitObject*>(object);
+    }
+    return nullptr;
+}
+
 } // namespace Kernel
@@ -3,16 +3,23 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <cstddef>
 #include <cstring>
-#include <cryptopp/aes.h>
-#include <cryptopp/modes.h>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <cryptopp/sha.h>
 #include <fmt/format.h>
+#include "common/async_io.h"
 #include "common/common_paths.h"
 #include "common/file_util.h"
 #include "common/logging/log.h"
+#include "common/scope_exit.h"
 #include "common/string_util.h"
+#include "common/swap.h"
+#include "common/thread_pool.h"
 #include "core/core.h"
 #include "core/file_sys/errors.h"
 #include "core/file_sys/ncch_container.h"
@@ -32,6 +39,7 @@
 #include "core/hle/service/am/am_u.h"
 #include "core/hle/service/fs/archive.h"
 #include "core/hle/service/fs/fs_user.h"
+#include "core/hw/aes/cipher.h"
 #include "core/loader/loader.h"
 #include "core/loader/smdh.h"
 
@@ -44,6 +52,143 @@ constexpr u8 VARIATION_SYSTEM = 0x02;
 constexpr u32 TID_HIGH_UPDATE = 0x0004000E;
 constexpr u32 TID_HIGH_DLC = 0x0004008C;
 
+// Size of the reads from the CIA when it is installed from the host
+constexpr std::size_t CIA_INSTALL_CHUNK_SIZE = 0x100000;
+
+namespace {
+constexpr u32 TITLE_INDEX_MAGIC = 0x58444954; // "TIDX"
+// Bumped whenever the layout of the index changes
+constexpr u32 TITLE_INDEX_VERSION = 1;
+
+/// Longest path the index is trusted with, anything longer means the file is corrupted
+constexpr u32 MAX_INDEXED_PATH_SIZE = 0x1000;
+
+struct TitleIndexHeader {
+    u32_le magic;
+    u32_le version;
+    u32_le num_entries;
+};
+
+/// Fixed-size part of an indexed title, followed by the path of its content directory
+struct TitleIndexEntry {
+    u64_le content_mtime;
+    u32_le path_size;
+};
+
+std::string GetTitleIndexPath() {
+    return fmt::format("{}title_index.bin", FileUtil::GetUserPath(FileUtil::UserPath::CacheDir));
+}
+
+/**
+ * The installed titles whose contents loaded when they were scanned, kept across boots so that
+ * the scans only load the titles whose content directory changed since. The titles are keyed by
+ * the path of their content directory, with the modification time it had. The titles installed
+ * through CIAFile are dropped explicitly as well, as the time has a resolution of a second.
+ */
+class TitleIndex {
+public:
+    /// Returns whether the title was indexed with its content directory as it is now
+    bool Contains(const std::string& content_path, u64 content_mtime) {
+        std::lock_guard lock{mutex};
+        Load();
+        const auto it = titles.find(content_path);
+        return it != titles.end() && it->second == content_mtime;
+    }
+
+    void Add(const std::string& content_path, u64 content_mtime) {
+        std::lock_guard lock{mutex};
+        Load();
+        dirty |= titles.insert_or_assign(content_path, content_mtime).second;
+    }
+
+    void Remove(const std::string& content_path) {
+        std::lock_guard lock{mutex};
+        Load();
+        dirty |= titles.erase(content_path) != 0;
+    }
+
+    /// Writes the index back if it changed, returns false if it could not be written
+    bool Save() {
+        std::lock_guard lock{mutex};
+        if (!dirty) {
+            return true;
+        }
+        const std::string path = GetTitleIndexPath();
+        FileUtil::CreateFullPath(path);
+        FileUtil::IOFile file(path, "wb");
+        if (!file) {
+            return false;
+        }
+        TitleIndexHeader header{};
+        header.magic = TITLE_INDEX_MAGIC;
+        header.version = TITLE_INDEX_VERSION;
+        header.num_entries = static_cast<u32>(titles.size());
+        file.WriteBytes(&header, sizeof(header));
+        for (const auto& [content_path, content_mtime] : titles) {
+            TitleIndexEntry entry{};
+            entry.content_mtime = content_mtime;
+            entry.path_size = static_cast<u32>(content_path.size());
+            file.WriteBytes(&entry, sizeof(entry));
+            file.WriteBytes(content_path.data(), content_path.size());
+        }
+        if (!file.IsGood()) {
+            file.Close();
+            FileUtil::Delete(path);
+            return false;
+        }
+        dirty = false;
+        return true;
+    }
+
+private:
+    void Load() {
+        if (loaded) {
+            return;
+        }
+        loaded = true;
+        FileUtil::IOFile file(GetTitleIndexPath(), "rb");
+        if (!file) {
+            return;
+        }
+        TitleIndexHeader header;
+        if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+            header.magic != TITLE_INDEX_MAGIC || header.version != TITLE_INDEX_VERSION) {
+            return;
+        }
+        for (u32 i = 0; i < header.num_entries; ++i) {
+            TitleIndexEntry entry;
+            if (file.ReadBytes(&entry, sizeof(entry)) != sizeof(entry) ||
+                entry.path_size > MAX_INDEXED_PATH_SIZE) {
+                titles.clear();
+                return;
+            }
+            std::string content_path(entry.path_size, '\0');
+            if (file.ReadBytes(content_path.data(), content_path.size()) != content_path.size()) {
+                titles.clear();
+                return;
+            }
+            titles.emplace(std::move(content_path), entry.content_mtime);
+        }
+    }
+
+    std::mutex mutex;
+    bool loaded = false;
+    bool dirty = false;
+    std::unordered_map<std::string, u64> titles;
+};
+
+TitleIndex& GetTitleIndex() {
+    // Shared by the module and the installs from the frontend, which can outlive any system
+    static TitleIndex title_index;
+    return title_index;
+}
+
+std::string GetTitleContentDirectory(Service::FS::MediaType media_type, u64 tid) {
+    // Without a trailing separator, which stat does not take on Windows
+    return GetTitlePath(media_type, tid) + "content";
+}
+} // Anonymous namespace
+
 struct TitleInfo {
     u64_le tid;
     u64_le size;
@@ -80,11 +225,106 @@ static_assert(sizeof(TicketInfo) == 0x18, "Ticket info structure size is wrong")
 
 class CIAFile::DecryptionState {
 public:
-    std::vector<CryptoPP::CBC_Mode<CryptoPP::AES>::Decryption> content;
+    std::vector<HW::AES::CBCDecryptor> content;
+};
+
+/**
+ * Hashes and writes the decrypted contents on a thread of its own, so that the disk is kept busy
+ * while the next data is read and decrypted. The content files stay open for the whole install.
+ */
+class CIAFile::ContentWriter {
+public:
+    ContentWriter() : thread(1, "CIAInstall") {}
+
+    ~ContentWriter() {
+        thread.WaitForAll();
+    }
+
+    void Reset(const FileSys::TitleMetadata& tmd, std::vector<std::string> paths) {
+        thread.WaitForAll();
+        contents.clear();
+        contents.resize(paths.size());
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            contents[i].path = std::move(paths[i]);
+            contents[i].expected_hash = tmd.GetContentHashByIndex(i);
+        }
+        failed = false;
+        finished = false;
+        queued = 0;
+    }
+
+    /// Queues decrypted data of the content for hashing and writing after the data queued before
+    void Write(std::size_t index, std::vector<u8>&& data) {
+        // Bounds the memory held by the queue when the disk is slower than the source
+        if (++queued == MAX_QUEUED_WRITES) {
+            thread.WaitForAll();
+            queued = 0;
+        }
+        thread.Push([this, index, data = std::move(data)] {
+            Content& content = contents[index];
+            if (!content.file.IsOpen()) {
+                content.file = FileUtil::IOFile(content.path, "wb");
+            }
+            content.hash.Update(data.data(), data.size());
+            if (content.file.WriteBytes(data.data(), data.size()) != data.size()) {
+                failed = true;
+            }
+        });
+    }
+
+    bool HasFailed() const {
+        return failed;
+    }
+
+    /**
+     * Waits for the queued writes and closes the content files, checking the hashes of the
+     * contents that were written completely.
+     * @returns false if a write failed
+     */
+    bool Finish(const std::vector<bool>& complete) {
+        thread.WaitForAll();
+        if (finished) {
+            return !failed;
+        }
+        finished = true;
+        for (std::size_t i = 0; i < contents.size(); ++i) {
+            Content& content = contents[i];
+            if (!content.file.IsOpen()) {
+                continue;
+            }
+            content.file.Close();
+            if (!complete[i]) {
+                continue;
+            }
+            std::array<u8, CryptoPP::SHA256::DIGESTSIZE> hash;
+            content.hash.Final(hash.data());
+            if (hash != content.expected_hash) {
+                LOG_ERROR(Service_AM, "Content {} does not match the hash in the TMD", i);
+            }
+        }
+        return !failed;
+    }
+
+private:
+    static constexpr std::size_t MAX_QUEUED_WRITES = 32;
+
+    struct Content {
+        std::string path;
+        FileUtil::IOFile file;
+        CryptoPP::SHA256 hash;
+        std::array<u8, 0x20> expected_hash;
+    };
+
+    std::vector<Content> contents;
+    std::atomic<bool> failed{false};
+    bool finished = false;
+    std::size_t queued = 0;
+    Common::ThreadPool thread;
 };
 
 CIAFile::CIAFile(Service::FS::MediaType media_type)
-    : media_type(media_type), decryption_state(std::make_unique<DecryptionState>()) {}
+    : media_type(media_type), decryption_state(std::make_unique<DecryptionState>()),
+      content_writer(std::make_unique<ContentWriter>()) {}
 
 CIAFile::~CIAFile() {
     Close();
@@ -134,12 +374,19 @@ ResultCode CIAFile::WriteTitleMetadata() {
     auto content_count = container.GetTitleMetadata().GetContentCount();
     content_written.resize(content_count);
 
+    // Since the incoming TMD has already been written, we can use GetTitleContentPath
+    // to get the content paths to write to.
+    std::vector<std::string> content_paths(content_count);
+    for (std::size_t i = 0; i < content_count; ++i) {
+        content_paths[i] = GetTitleContentPath(media_type, tmd.GetTitleID(), i, is_update);
+    }
+    content_writer->Reset(tmd, std::move(content_paths));
+
     if (auto title_key = container.GetTicket().GetTitleKey()) {
-        decryption_state->content.resize(content_count);
+        decryption_state->content.clear();
+        decryption_state->content.reserve(content_count);
         for (std::size_t i = 0; i < content_count; ++i) {
-            auto ctr = tmd.GetContentCTRByIndex(i);
-            decryption_state->content[i].SetKeyWithIV(title_key->data(), title_key->size(),
-                                                      ctr.data());
+            decryption_state->content.emplace_back(*title_key, tmd.GetContentCTRByIndex(i));
         }
     }
 
@@ -152,6 +399,10 @@ ResultVal<std::size_t> CIAFile::WriteContentData(u64 offset, std::size_t length,
     // Data is not being buffered, so we have to keep track of how much of each <ID>.app
     // has been written since we might get a written buffer which contains multiple .app
     // contents or only part of a larger .app's contents.
+    if (content_writer->HasFailed()) {
+        return FileSys::ERROR_INSUFFICIENT_SPACE;
+    }
+
     const u64 offset_max = offset + length;
     for (std::size_t i = 0; i < container.GetTitleMetadata().GetContentCount(); i++) {
         if (content_written[i] < container.GetContentSize(i)) {
@@ -169,24 +420,15 @@ ResultVal<std::size_t> CIAFile::WriteContentData(u64 offset, std::size_t length,
             // Figure out how much of this content ID we have just recieved/can write out
             const u64 available_to_write = std::min(offset_max, range_max) - range_min;
 
-            // Since the incoming TMD has already been written, we can use GetTitleContentPath
-            // to get the content paths to write to.
-            FileSys::TitleMetadata tmd = container.GetTitleMetadata();
-            FileUtil::IOFile file(GetTitleContentPath(media_type, tmd.GetTitleID(), i, is_update),
-                                  content_written[i] ? "ab" : "wb");
-
-            if (!file.IsOpen()) {
-                return FileSys::ERROR_INSUFFICIENT_SPACE;
-            }
-
+            const FileSys::TitleMetadata& tmd = container.GetTitleMetadata();
             std::vector<u8> temp(buffer + (range_min - offset),
                                  buffer + (range_min - offset) + available_to_write);
 
             if ((tmd.GetContentTypeByIndex(i) & FileSys::TMDContentTypeFlag::Encrypted) != 0) {
-                decryption_state->content[i].ProcessData(temp.data(), temp.data(), temp.size());
+                decryption_state->content[i].Process(temp.data(), temp.data(), temp.size());
             }
 
-            file.WriteBytes(temp.data(), temp.size());
+            content_writer->Write(i, std::move(temp));
 
             // Keep tabs on how much of this content ID has been written so new range_min
             // values can be calculated.
@@ -280,11 +522,24 @@ bool CIAFile::SetSize(u64 size) const {
 
 bool CIAFile::Close() const {
     bool complete = true;
+    std::vector<bool> content_complete(container.GetTitleMetadata().GetContentCount());
     for (std::size_t i = 0; i < container.GetTitleMetadata().GetContentCount(); i++) {
-        if (content_written[i] < container.GetContentSize(static_cast<u16>(i)))
+        content_complete[i] = content_written[i] >= container.GetContentSize(static_cast<u16>(i));
+        if (!content_complete[i])
             complete = false;
     }
 
+    // The contents must be on the disk before the old ones are cleaned up
+    if (!content_writer->Finish(content_complete)) {
+        LOG_ERROR(Service_AM, "Failed to write the CIA contents, aborting install...");
+        complete = false;
+    }
+
+    // Whatever happens to the title, it has to be loaded again by the next scan
+    const u64 title_id = container.GetTitleMetadata().GetTitleID();
+    GetTitleIndex().Remove(GetTitleContentDirectory(media_type, title_id));
+    GetTitleIndex().Save();
+
     // Install aborted
     if (!complete) {
         LOG_ERROR(Service_AM, "CIAFile closed prematurely, aborting install...");
@@ -353,25 +608,50 @@ InstallStatus InstallCIA(const std::string& path,
             }
         }
 
-        FileUtil::IOFile file(path, "rb");
-        if (!file.IsOpen())
+        const auto file =
+            std::make_shared<FileUtil::AsyncFile>(path, FileUtil::AsyncFile::Mode::Read);
+        if (!file->IsOpen())
             return InstallStatus::ErrorFailedToOpenFile;
 
-        std::array<u8, 0x10000> buffer;
+        // The next chunk is read in the background while the current one is installed
+        std::array<std::vector<u8>, 2> buffers;
+        buffers.fill(std::vector<u8>(CIA_INSTALL_CHUNK_SIZE));
+        auto& async_io = FileUtil::AsyncIO::GetInstance();
+
+        const u64 file_size = file->GetSize();
+        std::size_t current = 0;
+        std::future<std::size_t> next_read =
+            async_io.Read(file, buffers[current].data(), CIA_INSTALL_CHUNK_SIZE, 0);
+        // Unlike the ones of std::async, the futures don't wait for the read in their destructor
+        SCOPE_EXIT({
+            if (next_read.valid()) {
+                next_read.wait();
+            }
+        });
         std::size_t total_bytes_read = 0;
-        while (total_bytes_read != file.GetSize()) {
-            std::size_t bytes_read = file.ReadBytes(buffer.data(), buffer.size());
+        while (total_bytes_read != file_size) {
+            const std::size_t bytes_read = next_read.get();
+            if (bytes_read == 0 || bytes_read > CIA_INSTALL_CHUNK_SIZE) {
+                LOG_ERROR(Service_AM, "Failed to read {}", path);
+                return InstallStatus::ErrorAborted;
+            }
+            if (total_bytes_read + bytes_read != file_size) {
+                next_read = async_io.Read(file, buffers[current ^ 1].data(),
+                                          CIA_INSTALL_CHUNK_SIZE, total_bytes_read + bytes_read);
+            }
+
             auto result = installFile.Write(static_cast<u64>(total_bytes_read), bytes_read, true,
-                                            static_cast<u8*>(buffer.data()));
+                                            buffers[current].data());
 
             if (update_callback)
-                update_callback(total_bytes_read, file.GetSize());
+                update_callback(total_bytes_read, file_size);
             if (result.Failed()) {
                 LOG_ERROR(Service_AM, "CIA file installation aborted with error code {:08x}",
                           result.Code().raw);
                 return InstallStatus::ErrorAborted;
             }
             total_bytes_read += bytes_read;
+            current ^= 1;
         }
         installFile.Close();
 
@@ -548,6 +828,7 @@ void Module::ScanForTitles(Service::FS::MediaType media_type) {
     am_title_list[static_cast<u32>(media_type)].clear();
 
     std::string title_path = GetMediaTitlePath(media_type);
+    TitleIndex& title_index = GetTitleIndex();
 
     FileUtil::FSTEntry entries;
     FileUtil::ScanDirectoryTree(title_path, entries, 1);
@@ -558,9 +839,24 @@ void Module::ScanForTitles(Service::FS::MediaType media_type) {
             if (tid_string.length() == TITLE_ID_VALID_LENGTH) {
                 const u64 tid = std::stoull(tid_string, nullptr, 16);
 
+                // Only the titles which changed since they were indexed are loaded again
+                const std::string content_path = GetTitleContentDirectory(media_type, tid);
+                if (!FileUtil::IsDirectory(content_path)) {
+                    continue;
+                }
+                const u64 content_mtime = FileUtil::GetModificationTime(content_path);
+                if (title_index.Contains(content_path, content_mtime)) {
+                    am_title_list[static_cast<u32>(media_type)].push_back(tid);
+                    continue;
+                }
+
                 FileSys::NCCHContainer container(GetTitleContentPath(media_type, tid));
-                if (container.Load() == Loader::ResultStatus::Success)
+                if (container.Load() == Loader::ResultStatus::Success) {
                     am_title_list[static_cast<u32>(media_type)].push_back(tid);
+                    title_index.Add(content_path, content_mtime);
+                } else {
+                    title_index.Remove(content_path);
+                }
             }
         }
     }
@@ -569,6 +865,17 @@ void Module::ScanForTitles(Service::FS::MediaType media_type) {
 void Module::ScanForAllTitles() {
     ScanForTitles(Service::FS::MediaType::NAND);
     ScanForTitles(Service::FS::MediaType::SDMC);
+    if (!GetTitleIndex().Save()) {
+        LOG_WARNING(Service_AM, "Could not write the title index");
+    }
+}
+
+void Module::RemoveTitle(Service::FS::MediaType media_type, u64 title_id) {
+    auto& title_list = am_title_list[static_cast<u32>(media_type)];
+    title_list.erase(std::remove(title_list.begin(), title_list.end(), title_id),
+                     title_list.end());
+    GetTitleIndex().Remove(GetTitleContentDirectory(media_type, title_id));
+    GetTitleIndex().Save();
 }
 
 Module::Interface::Interface(std::shared_ptr<Module> am, const char* name, u32 max_session)
@@ -814,7 +1121,7 @@ void Module::Interface::DeleteUserProgram(Kernel::HLERequestContext& ctx) {
         return;
     }
     bool success = FileUtil::DeleteDirRecursively(path);
-    am->ScanForAllTitles();
+    am->RemoveTitle(media_type, title_id);
     rb.Push(RESULT_SUCCESS);
     if (!success)
         LOG_ERROR(Service_AM, "FileUtil::DeleteDirRecursively unexpectedly failed");
@@ -1146,11 +1453,13 @@ public:
         : file(std::move(file)), file_offset(offset), file_size(size) {}
 
     ResultVal<std::size_t> Read(u64 offset, std::size_t length, u8* buffer) const override {
+        file->WaitForPendingRead();
         return file->backend->Read(offset + file_offset, length, buffer);
     }
 
     ResultVal<std::size_t> Write(u64 offset, std::size_t length, bool flush,
                                  const u8* buffer) override {
+        file->WaitForPendingRead();
         return file->backend->Write(offset + file_offset, length, flush, buffer);
     }
 
@@ -1408,7 +1717,7 @@ void Module::Interface::DeleteProgram(Kernel::HLERequestContext& ctx) {
         return;
     }
     bool success = FileUtil::DeleteDirRecursively(path);
-    am->ScanForAllTitles();
+    am->RemoveTitle(media_type, title_id);
     rb.Push(RESULT_SUCCESS);
     if (!success)
         LOG_ERROR(Service_AM, "FileUtil::DeleteDirRecursively unexpectedly failed");
@@ -99,6 +99,9 @@ private:
 
     class DecryptionState;
     std::unique_ptr<DecryptionState> decryption_state;
+
+    class ContentWriter;
+    std::unique_ptr<ContentWriter> content_writer;
 };
 
 /**
@@ -580,6 +583,13 @@ private:
      */
     void ScanForAllTitles();
 
+    /**
+     * Removes a deleted title from the listing, without scanning the storage medium again.
+     * @param media_type the storage medium the title was installed to
+     * @param title_id the ID of the title
+     */
+    void RemoveTitle(Service::FS::MediaType media_type, u64 title_id);
+
     Kernel::KernelSystem& kernel;
     bool cia_installing = false;
     std::array<std::vector<u64_le>, 3> am_title_list;
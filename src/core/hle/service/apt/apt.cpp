@@ -4,9 +4,11 @@
 
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/vector.hpp>
+#include <fmt/format.h>
 #include "common/archives.h"
 #include "common/common_paths.h"
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "core/core.h"
 #include "core/file_sys/archive_ncch.h"
@@ -21,6 +23,7 @@
 #include "core/hle/service/apt/apt_s.h"
 #include "core/hle/service/apt/apt_u.h"
 #include "core/hle/service/apt/bcfnt/bcfnt.h"
+#include "core/hle/service/am/am.h"
 #include "core/hle/service/apt/ns_s.h"
 #include "core/hle/service/cfg/cfg.h"
 #include "core/hle/service/fs/archive.h"
@@ -127,6 +130,76 @@ static u32 DecompressLZ11(const u8* in, u8* out) {
     return decompressed_size;
 }
 
+constexpr u32 SHARED_FONT_CACHE_MAGIC = 0x43534643; // "CFSC"
+// Bumped whenever the layout of the cache or the way the font is prepared changes
+constexpr u32 SHARED_FONT_CACHE_VERSION = 1;
+
+/// Header of the cached shared font, which is followed by the contents of the shared memory
+struct SharedFontCacheHeader {
+    u32_le magic;
+    u32_le version;
+    /// Hash of the system archive the font was extracted from
+    u64_le fingerprint;
+    u32_le region;
+    u32_le size;
+};
+static_assert(sizeof(SharedFontCacheHeader) == 0x18, "SharedFontCacheHeader has incorrect size");
+
+static std::string GetSharedFontCachePath(u8 font_region_code) {
+    return fmt::format("{}shared_font{}{}.bin",
+                       FileUtil::GetUserPath(FileUtil::UserPath::CacheDir), DIR_SEP,
+                       font_region_code);
+}
+
+/// Hash of the raw content of a system archive, or 0 if it can't be read
+static u64 GetArchiveFingerprint(u64 title_id) {
+    FileUtil::IOFile file(Service::AM::GetTitleContentPath(Service::FS::MediaType::NAND, title_id),
+                          "rb");
+    if (!file.IsOpen()) {
+        return 0;
+    }
+    std::vector<u8> content(file.GetSize());
+    if (file.ReadBytes(content.data(), content.size()) != content.size()) {
+        return 0;
+    }
+    return Common::ComputeHash64(content.data(), content.size());
+}
+
+/// Copies the cached font into the shared memory, returns false if it's missing or stale
+static bool LoadSharedFontCache(u8 font_region_code, u64 fingerprint, u8* dest,
+                                std::size_t dest_size) {
+    FileUtil::IOFile file(GetSharedFontCachePath(font_region_code), "rb");
+    if (!file) {
+        return false;
+    }
+    SharedFontCacheHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != SHARED_FONT_CACHE_MAGIC || header.version != SHARED_FONT_CACHE_VERSION ||
+        header.fingerprint != fingerprint || header.region != font_region_code ||
+        header.size > dest_size) {
+        return false;
+    }
+    return file.ReadBytes(dest, header.size) == header.size;
+}
+
+static void SaveSharedFontCache(u8 font_region_code, u64 fingerprint, const u8* data, u32 size) {
+    const std::string path = GetSharedFontCachePath(font_region_code);
+    FileUtil::CreateFullPath(path);
+    FileUtil::IOFile file(path, "wb");
+    SharedFontCacheHeader header{};
+    header.magic = SHARED_FONT_CACHE_MAGIC;
+    header.version = SHARED_FONT_CACHE_VERSION;
+    header.fingerprint = fingerprint;
+    header.region = font_region_code;
+    header.size = size;
+    if (file.WriteBytes(&header, sizeof(header)) != sizeof(header) ||
+        file.WriteBytes(data, size) != size) {
+        LOG_WARNING(Service_APT, "Could not write the shared font cache {}", path);
+        file.Close();
+        FileUtil::Delete(path);
+    }
+}
+
 bool Module::LoadSharedFont() {
     u8 font_region_code;
     auto cfg = Service::CFG::GetModule(system);
@@ -148,6 +221,15 @@ bool Module::LoadSharedFont() {
 
     const u64_le shared_font_archive_id_low = 0x0004009b00014002 | ((font_region_code - 1) << 8);
 
+    // Extracting the font means decrypting the archive and decompressing the font, the result is
+    // cached for as long as the archive stays the same
+    const u64 fingerprint = GetArchiveFingerprint(shared_font_archive_id_low);
+    if (fingerprint != 0 && LoadSharedFontCache(font_region_code, fingerprint,
+                                                shared_font_mem->GetPointer(),
+                                                shared_font_mem->GetSize())) {
+        return true;
+    }
+
     FileSys::NCCHArchive archive(shared_font_archive_id_low, Service::FS::MediaType::NAND);
     // 20-byte all zero path for opening RomFS
     const FileSys::Path file_path(std::vector<u8>(20, 0));
@@ -184,6 +266,10 @@ bool Module::LoadSharedFont() {
     std::memcpy(shared_font_mem->GetPointer(), &shared_font_header, sizeof(shared_font_header));
     *shared_font_mem->GetPointer(0x83) = 'U'; // Change the magic from "CFNT" to "CFNU"
 
+    if (fingerprint != 0) {
+        SaveSharedFontCache(font_region_code, fingerprint, shared_font_mem->GetPointer(),
+                            sizeof(shared_font_header) + shared_font_header.decompressed_size);
+    }
     return true;
 }
 
@@ -98,10 +98,59 @@ void Module::PortConfig::Clear() {
     transfer_bytes = 256;
 }
 
+Module::CaptureWorker::~CaptureWorker() {
+    {
+        std::lock_guard lock{mutex};
+        stop = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void Module::CaptureWorker::Start(std::function<void(std::vector<u16>&)> capture) {
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [this] { return !is_capturing; });
+    pending_capture = std::move(capture);
+    is_capturing = true;
+    if (!thread.joinable()) {
+        thread = std::thread(&CaptureWorker::Loop, this);
+    }
+    lock.unlock();
+    cv.notify_all();
+}
+
+const std::vector<u16>& Module::CaptureWorker::Wait() {
+    std::unique_lock lock{mutex};
+    cv.wait(lock, [this] { return !is_capturing; });
+    return frame;
+}
+
+void Module::CaptureWorker::Loop() {
+    std::unique_lock lock{mutex};
+    while (true) {
+        cv.wait(lock, [this] { return stop || pending_capture; });
+        if (stop) {
+            return;
+        }
+        const auto capture = std::move(pending_capture);
+        pending_capture = nullptr;
+
+        // The frame is only touched by the worker until is_capturing is cleared
+        lock.unlock();
+        capture(frame);
+        lock.lock();
+
+        is_capturing = false;
+        cv.notify_all();
+    }
+}
+
 void Module::CompletionEventCallBack(u64 port_id, s64) {
     PortConfig& port = ports[port_id];
     const CameraConfig& camera = cameras[port.camera_id];
-    const auto buffer = port.capture_result.get();
+    const std::vector<u16>& buffer = port.capture_worker.Wait();
 
     if (port.is_trimming) {
         u32 trim_width;
@@ -184,16 +233,16 @@ void Module::StartReceiving(int port_id) {
     PortConfig& port = ports[port_id];
     port.is_receiving = true;
 
-    // launches a capture task asynchronously
+    // launches a capture task on the port's capture thread
     CameraConfig& camera = cameras[port.camera_id];
-    port.capture_result = std::async(std::launch::async, [&camera, &port, this] {
+    port.capture_worker.Start([&camera, &port, this](std::vector<u16>& frame) {
         if (is_camera_reload_pending.exchange(false)) {
             // reinitialize the camera according to new settings
             camera.impl->StopCapture();
             LoadCameraImplementation(camera, port.camera_id);
             camera.impl->StartCapture();
         }
-        return camera.impl->ReceiveFrame();
+        camera.impl->ReceiveFrame(frame);
     });
 
     // schedules a completion event according to the frame rate. The event will block on the
@@ -208,7 +257,7 @@ void Module::CancelReceiving(int port_id) {
         return;
     LOG_WARNING(Service_CAM, "tries to cancel an ongoing receiving process.");
     system.CoreTiming().UnscheduleEvent(completion_event_callback, port_id);
-    ports[port_id].capture_result.wait();
+    ports[port_id].capture_worker.Wait();
     ports[port_id].is_receiving = false;
 }
 
@@ -5,9 +5,12 @@
 #pragma once
 
 #include <array>
+#include <condition_variable>
 #include <deque>
-#include <future>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/deque.hpp>
@@ -806,6 +809,33 @@ private:
         friend class boost::serialization::access;
     };
 
+    /**
+     * Receives the frames of a port on a thread that lives as long as the port, into a buffer
+     * that is reused from frame to frame, instead of spawning a thread and allocating a new frame
+     * for every capture.
+     */
+    class CaptureWorker {
+    public:
+        ~CaptureWorker();
+
+        /// Runs the capture function on the worker thread, starting the thread if needed
+        void Start(std::function<void(std::vector<u16>&)> capture);
+
+        /// Waits for the last started capture to finish and returns the frame it received
+        const std::vector<u16>& Wait();
+
+    private:
+        void Loop();
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::function<void(std::vector<u16>&)> pending_capture;
+        bool is_capturing{false};
+        bool stop{false};
+        std::vector<u16> frame;
+    };
+
     struct PortConfig {
         int camera_id{0};
 
@@ -834,7 +864,7 @@ private:
 
         std::deque<s64> vsync_timings;
 
-        std::future<std::vector<u16>> capture_result; // will hold the received frame.
+        CaptureWorker capture_worker; // will hold the received frame.
         Kernel::Process* dest_process{nullptr};
         VAddr dest{0};    // the destination address of the receiving process
         u32 dest_size{0}; // the destination size of the receiving process
@@ -859,7 +889,7 @@ private:
             ar& buffer_error_interrupt_event;
             ar& vsync_interrupt_event;
             ar& vsync_timings;
-            // Ignore capture_result. In-progress captures might be affected but this is OK.
+            // Ignore capture_worker. In-progress captures might be affected but this is OK.
             ar& dest_process;
             ar& dest;
             ar& dest_size;
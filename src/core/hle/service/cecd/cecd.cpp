@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/unique_ptr.hpp>
 #include <cryptopp/base64.h>
@@ -38,6 +39,9 @@ void Module::serialize(Archive& ar, const unsigned int) {
     ar& cecd_system_save_data_archive;
     ar& cecinfo_event;
     ar& change_state_event;
+    if (Archive::is_loading::value) {
+        outbox_indices.clear();
+    }
 }
 SERIALIZE_IMPL(Module)
 
@@ -75,6 +79,10 @@ void Module::Interface::Open(Kernel::HLERequestContext& ctx) {
         if (dir_result.Failed()) {
             if (open_mode.create) {
                 cecd->cecd_system_save_data_archive->CreateDirectory(path);
+                if (path_type == CecDataPathType::MboxDir ||
+                    path_type == CecDataPathType::OutboxDir) {
+                    cecd->InvalidateOutboxIndex(ncch_program_id);
+                }
                 rb.Push(RESULT_SUCCESS);
             } else {
                 LOG_DEBUG(Service_CECD, "Failed to open directory: {}", path.AsString());
@@ -99,6 +107,9 @@ void Module::Interface::Open(Kernel::HLERequestContext& ctx) {
         break;
     }
     default: { // If not directory, then it is a file
+        if (path_type == CecDataPathType::OutboxMsg) {
+            cecd->InvalidateOutboxIndex(ncch_program_id);
+        }
         auto file_result = cecd->cecd_system_save_data_archive->OpenFile(path, mode);
         if (file_result.Failed()) {
             LOG_DEBUG(Service_CECD, "Failed to open file: {}", path.AsString());
@@ -375,6 +386,10 @@ void Module::Interface::Write(Kernel::HLERequestContext& ctx) {
             session_data->file->Write(0, buffer.size(), true, buffer.data()).Unwrap());
         session_data->file->Close();
 
+        if (session_data->data_path_type == CecDataPathType::OutboxMsg) {
+            cecd->InvalidateOutboxIndex(session_data->ncch_program_id);
+        }
+
         rb.Push(RESULT_SUCCESS);
     }
     rb.PushMappedBuffer(read_buffer);
@@ -437,6 +452,10 @@ void Module::Interface::WriteMessage(Kernel::HLERequestContext& ctx) {
             static_cast<u32>(message->Write(0, buffer_size, true, buffer.data()).Unwrap());
         message->Close();
 
+        if (is_outbox) {
+            cecd->UpdateOutboxMessage(ncch_program_id, id_buffer, buffer);
+        }
+
         rb.Push(RESULT_SUCCESS);
     } else {
         rb.Push(ResultCode(ErrorDescription::NoData, ErrorModule::CEC, ErrorSummary::NotFound,
@@ -524,6 +543,10 @@ void Module::Interface::WriteMessageWithHMAC(Kernel::HLERequestContext& ctx) {
             static_cast<u32>(message->Write(0, buffer_size, true, buffer.data()).Unwrap());
         message->Close();
 
+        if (is_outbox) {
+            cecd->UpdateOutboxMessage(ncch_program_id, id_buffer, buffer);
+        }
+
         rb.Push(RESULT_SUCCESS);
     } else {
         rb.Push(ResultCode(ErrorDescription::NoData, ErrorModule::CEC, ErrorSummary::NotFound,
@@ -559,10 +582,18 @@ void Module::Interface::Delete(Kernel::HLERequestContext& ctx) {
     case CecDataPathType::InboxDir:
     case CecDataPathType::OutboxDir:
         rb.Push(cecd->cecd_system_save_data_archive->DeleteDirectoryRecursively(path));
+        if (path_type == CecDataPathType::RootDir) {
+            cecd->outbox_indices.clear();
+        } else if (path_type != CecDataPathType::InboxDir) {
+            cecd->InvalidateOutboxIndex(ncch_program_id);
+        }
         break;
     default: // If not directory, then it is a file
         if (message_id_size == 0) {
             rb.Push(cecd->cecd_system_save_data_archive->DeleteFile(path));
+            if (path_type == CecDataPathType::OutboxMsg) {
+                cecd->InvalidateOutboxIndex(ncch_program_id);
+            }
         } else {
             std::vector<u8> id_buffer(message_id_size);
             message_id_buffer.Read(id_buffer.data(), 0, message_id_size);
@@ -573,6 +604,9 @@ void Module::Interface::Delete(Kernel::HLERequestContext& ctx) {
                                                  ncch_program_id, id_buffer)
                     .data();
             rb.Push(cecd->cecd_system_save_data_archive->DeleteFile(message_path));
+            if (is_outbox) {
+                cecd->RemoveOutboxMessage(ncch_program_id, id_buffer);
+            }
         }
     }
 
@@ -767,6 +801,10 @@ void Module::Interface::OpenAndWrite(Kernel::HLERequestContext& ctx) {
                 static_cast<u32>(file->Write(0, buffer.size(), true, buffer.data()).Unwrap());
             file->Close();
 
+            if (path_type == CecDataPathType::OutboxMsg) {
+                cecd->InvalidateOutboxIndex(ncch_program_id);
+            }
+
             rb.Push(RESULT_SUCCESS);
         } else {
             rb.Push(ResultCode(ErrorDescription::NoData, ErrorModule::CEC, ErrorSummary::NotFound,
@@ -1198,55 +1236,22 @@ void Module::CheckAndUpdateFile(const CecDataPathType path_type, const u32 ncch_
             LOG_DEBUG(Service_CECD, "CecOutBoxInfoHeader max batch size != max message number");
         }
 
-        /// We need to read the /CEC/<id>/OutBox directory to find out which messages, if any,
-        /// are present. The num_of_messages = (total_read_count) - 2, to adjust for
-        /// the BoxInfo____ and OBIndex_____files that are present in the directory as well.
-        FileSys::Path outbox_path(
-            GetCecDataPathTypeAsString(CecDataPathType::OutboxDir, ncch_program_id).data());
-
-        auto dir_result = cecd_system_save_data_archive->OpenDirectory(outbox_path);
-
-        auto outbox_dir = std::move(dir_result).Unwrap();
-        std::vector<FileSys::Entry> entries(outbox_info_header.max_message_num + 2);
-        const u32 entry_count =
-            outbox_dir->Read(outbox_info_header.max_message_num + 2, entries.data());
-        outbox_dir->Close();
-
-        LOG_DEBUG(Service_CECD, "Number of entries found in /OutBox: {}", entry_count);
+        /// The headers of the messages present in /CEC/<id>/OutBox come from its index. The
+        /// directory listing used to be read up to max_message_num + 2 entries, to account for
+        /// the BoxInfo____ and OBIndex_____ files that are present in the directory as well.
+        const auto& messages = GetOutboxMessages(ncch_program_id);
+        LOG_DEBUG(Service_CECD, "Number of messages indexed in /OutBox: {}", messages.size());
         std::array<CecMessageHeader, 8> message_headers;
 
-        std::string boxinfo_name("BoxInfo_____");
-        std::string obindex_name("OBIndex_____");
-        std::string file_name;
-        std::u16string u16_filename;
-
-        for (u32 i = 0; i < entry_count; i++) {
-            u16_filename = std::u16string(entries[i].filename);
-            file_name = Common::UTF16ToUTF8(u16_filename);
-
-            if (boxinfo_name.compare(file_name) != 0 && obindex_name.compare(file_name) != 0) {
-                LOG_DEBUG(Service_CECD, "Adding message to BoxInfo_____: {}", file_name);
-
-                FileSys::Path message_path(
-                    (GetCecDataPathTypeAsString(CecDataPathType::OutboxDir, ncch_program_id) + "/" +
-                     file_name)
-                        .data());
-
-                FileSys::Mode mode;
-                mode.read_flag.Assign(1);
-
-                auto message_result = cecd_system_save_data_archive->OpenFile(message_path, mode);
-
-                auto message = std::move(message_result).Unwrap();
-                const u32 message_size = static_cast<u32>(message->GetSize());
-                std::vector<u8> buffer(message_size);
-
-                message->Read(0, message_size, buffer.data()).Unwrap();
-                message->Close();
-
-                std::memcpy(&message_headers[outbox_info_header.message_num++], buffer.data(),
-                            sizeof(CecMessageHeader));
+        const std::size_t message_count =
+            std::min<std::size_t>(messages.size(), outbox_info_header.max_message_num);
+        for (std::size_t i = 0; i < message_count; i++) {
+            if (outbox_info_header.message_num >= message_headers.size()) {
+                LOG_DEBUG(Service_CECD, "Too many messages for BoxInfo_____");
+                break;
             }
+            LOG_DEBUG(Service_CECD, "Adding message to BoxInfo_____: {}", messages[i].file_name);
+            message_headers[outbox_info_header.message_num++] = messages[i].header;
         }
 
         if (outbox_info_header.message_num > 0) {
@@ -1291,52 +1296,20 @@ void Module::CheckAndUpdateFile(const CecDataPathType path_type, const u32 ncch_
             obindex_header.message_num = 0;
         }
 
-        /// We need to read the /CEC/<id>/OutBox directory to find out which messages, if any,
-        /// are present. The num_of_messages = (total_read_count) - 2, to adjust for
-        /// the BoxInfo____ and OBIndex_____files that are present in the directory as well.
-        FileSys::Path outbox_path(
-            GetCecDataPathTypeAsString(CecDataPathType::OutboxDir, ncch_program_id).data());
-
-        auto dir_result = cecd_system_save_data_archive->OpenDirectory(outbox_path);
-
-        auto outbox_dir = std::move(dir_result).Unwrap();
-        std::vector<FileSys::Entry> entries(8);
-        const u32 entry_count = outbox_dir->Read(8, entries.data());
-        outbox_dir->Close();
-
-        LOG_DEBUG(Service_CECD, "Number of entries found in /OutBox: {}", entry_count);
+        /// The ids of the messages present in /CEC/<id>/OutBox come from its index. The
+        /// directory listing used to be read up to 8 entries, two of them being the
+        /// BoxInfo____ and OBIndex_____ files that are present in the directory as well.
+        const auto& messages = GetOutboxMessages(ncch_program_id);
+        LOG_DEBUG(Service_CECD, "Number of messages indexed in /OutBox: {}", messages.size());
         std::array<std::array<u8, 8>, 8> message_ids;
 
-        std::string boxinfo_name("BoxInfo_____");
-        std::string obindex_name("OBIndex_____");
-        std::string file_name;
-        std::u16string u16_filename;
-
-        for (u32 i = 0; i < entry_count; i++) {
-            u16_filename = std::u16string(entries[i].filename);
-            file_name = Common::UTF16ToUTF8(u16_filename);
-
-            if (boxinfo_name.compare(file_name) != 0 && obindex_name.compare(file_name) != 0) {
-                FileSys::Path message_path(
-                    (GetCecDataPathTypeAsString(CecDataPathType::OutboxDir, ncch_program_id) + "/" +
-                     file_name)
-                        .data());
-
-                FileSys::Mode mode;
-                mode.read_flag.Assign(1);
-
-                auto message_result = cecd_system_save_data_archive->OpenFile(message_path, mode);
-
-                auto message = std::move(message_result).Unwrap();
-                const u32 message_size = static_cast<u32>(message->GetSize());
-                std::vector<u8> buffer(message_size);
-
-                message->Read(0, message_size, buffer.data()).Unwrap();
-                message->Close();
-
-                // Message id is at offset 0x20, and is 8 bytes
-                std::memcpy(&message_ids[obindex_header.message_num++], buffer.data() + 0x20, 8);
+        const std::size_t message_count = std::min<std::size_t>(messages.size(), 8 - 2);
+        for (std::size_t i = 0; i < message_count; i++) {
+            if (obindex_header.message_num >= message_ids.size()) {
+                LOG_DEBUG(Service_CECD, "Too many messages for OBIndex_____");
+                break;
             }
+            message_ids[obindex_header.message_num++] = messages[i].header.message_id;
         }
 
         if (obindex_header.message_num > 0) {
@@ -1365,6 +1338,94 @@ void Module::CheckAndUpdateFile(const CecDataPathType path_type, const u32 ncch_
     }
 }
 
+const std::vector<Module::OutboxMessage>& Module::GetOutboxMessages(const u32 ncch_program_id) {
+    const auto it = outbox_indices.find(ncch_program_id);
+    if (it != outbox_indices.end()) {
+        return it->second;
+    }
+
+    const std::string outbox_dir =
+        GetCecDataPathTypeAsString(CecDataPathType::OutboxDir, ncch_program_id);
+    auto dir_result =
+        cecd_system_save_data_archive->OpenDirectory(FileSys::Path(outbox_dir.data()));
+    if (dir_result.Failed()) {
+        // Not cached, the outbox may still be created
+        static const std::vector<OutboxMessage> no_messages;
+        return no_messages;
+    }
+
+    auto directory = std::move(dir_result).Unwrap();
+    std::vector<OutboxMessage> messages;
+    std::vector<FileSys::Entry> entries(32);
+    while (const u32 entry_count = directory->Read(static_cast<u32>(entries.size()),
+                                                   entries.data())) {
+        for (u32 i = 0; i < entry_count; i++) {
+            const std::string file_name =
+                Common::UTF16ToUTF8(std::u16string(entries[i].filename));
+            if (entries[i].is_directory || file_name == "BoxInfo_____" ||
+                file_name == "OBIndex_____") {
+                continue;
+            }
+
+            FileSys::Mode mode;
+            mode.read_flag.Assign(1);
+            auto message_result = cecd_system_save_data_archive->OpenFile(
+                FileSys::Path((outbox_dir + "/" + file_name).data()), mode);
+            if (message_result.Failed()) {
+                LOG_ERROR(Service_CECD, "Failed to open outbox message: {}", file_name);
+                continue;
+            }
+
+            // Only the header is needed, short messages leave the rest of it zeroed
+            auto message = std::move(message_result).Unwrap();
+            OutboxMessage& entry = messages.emplace_back();
+            entry.file_name = file_name;
+            std::memset(&entry.header, 0, sizeof(CecMessageHeader));
+            message->Read(0, sizeof(CecMessageHeader), reinterpret_cast<u8*>(&entry.header));
+            message->Close();
+        }
+    }
+    directory->Close();
+
+    LOG_DEBUG(Service_CECD, "Indexed {} messages in {}", messages.size(), outbox_dir);
+    return outbox_indices.emplace(ncch_program_id, std::move(messages)).first->second;
+}
+
+void Module::UpdateOutboxMessage(const u32 ncch_program_id, const std::vector<u8>& message_id,
+                                 const std::vector<u8>& message) {
+    const auto it = outbox_indices.find(ncch_program_id);
+    if (it == outbox_indices.end()) {
+        return;
+    }
+
+    const std::string file_name = "_" + EncodeBase64(message_id);
+    auto& messages = it->second;
+    auto entry = std::find_if(messages.begin(), messages.end(),
+                              [&](const OutboxMessage& m) { return m.file_name == file_name; });
+    if (entry == messages.end()) {
+        entry = messages.insert(messages.end(), OutboxMessage{file_name, {}});
+    }
+    std::memset(&entry->header, 0, sizeof(CecMessageHeader));
+    std::memcpy(&entry->header, message.data(), std::min(message.size(), sizeof(CecMessageHeader)));
+}
+
+void Module::RemoveOutboxMessage(const u32 ncch_program_id, const std::vector<u8>& message_id) {
+    const auto it = outbox_indices.find(ncch_program_id);
+    if (it == outbox_indices.end()) {
+        return;
+    }
+
+    const std::string file_name = "_" + EncodeBase64(message_id);
+    auto& messages = it->second;
+    messages.erase(std::remove_if(messages.begin(), messages.end(),
+                                  [&](const OutboxMessage& m) { return m.file_name == file_name; }),
+                   messages.end());
+}
+
+void Module::InvalidateOutboxIndex(const u32 ncch_program_id) {
+    outbox_indices.erase(ncch_program_id);
+}
+
 Module::SessionData::SessionData() {}
 
 Module::SessionData::~SessionData() {
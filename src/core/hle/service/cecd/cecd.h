@@ -5,6 +5,9 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "common/bit_field.h"
 #include "common/common_funcs.h"
 #include "core/hle/kernel/event.h"
@@ -620,8 +623,34 @@ private:
     void CheckAndUpdateFile(const CecDataPathType path_type, const u32 ncch_program_id,
                             std::vector<u8>& file_buffer);
 
+    /// A message of an outbox, with the header BoxInfo_____ and OBIndex_____ are built from
+    struct OutboxMessage {
+        std::string file_name;
+        CecMessageHeader header;
+    };
+
+    /**
+     * Returns the messages of a title's outbox, in the order its directory listed them. The
+     * directory is only scanned and the headers read on the first use, after that the index
+     * follows the messages written and deleted through the service.
+     */
+    const std::vector<OutboxMessage>& GetOutboxMessages(u32 ncch_program_id);
+
+    /// Records a message written to an outbox, if the index of the outbox is loaded
+    void UpdateOutboxMessage(u32 ncch_program_id, const std::vector<u8>& message_id,
+                             const std::vector<u8>& message);
+
+    /// Removes a deleted message from the index of its outbox
+    void RemoveOutboxMessage(u32 ncch_program_id, const std::vector<u8>& message_id);
+
+    /// Drops the index of an outbox changed behind its back, it is scanned again on the next use
+    void InvalidateOutboxIndex(u32 ncch_program_id);
+
     std::unique_ptr<FileSys::ArchiveBackend> cecd_system_save_data_archive;
 
+    /// Outbox message indices by program id, only a cache of the archive that isn't saved
+    std::unordered_map<u32, std::vector<OutboxMessage>> outbox_indices;
+
     std::shared_ptr<Kernel::Event> cecinfo_event;
     std::shared_ptr<Kernel::Event> change_state_event;
 
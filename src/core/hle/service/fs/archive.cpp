@@ -26,6 +26,7 @@
 #include "core/file_sys/directory_backend.h"
 #include "core/file_sys/errors.h"
 #include "core/file_sys/file_backend.h"
+#include "core/file_sys/path_parser.h"
 #include "core/hle/result.h"
 #include "core/hle/service/fs/archive.h"
 
@@ -218,6 +219,7 @@ ResultCode ArchiveManager::FormatArchive(ArchiveIdCode id_code,
         return UnimplementedFunction(ErrorModule::FS); // TODO(Subv): Find the right error
     }
 
+    FileSys::HostStatusCache::InvalidateAll();
     return archive_itr->second->Format(path, format_info, program_id);
 }
 
@@ -248,6 +250,7 @@ ResultCode ArchiveManager::CreateExtSaveData(MediaType media_type, u32 high, u32
 
     auto ext_savedata = static_cast<FileSys::ArchiveFactory_ExtSaveData*>(archive->second.get());
 
+    FileSys::HostStatusCache::InvalidateAll();
     ResultCode result = ext_savedata->Format(path, format_info, program_id);
     if (result.IsError())
         return result;
@@ -275,6 +278,7 @@ ResultCode ArchiveManager::DeleteExtSaveData(MediaType media_type, u32 high, u32
     std::string base_path =
         FileSys::GetExtDataContainerPath(media_type_directory, media_type == MediaType::NAND);
     std::string extsavedata_path = FileSys::GetExtSaveDataPath(base_path, path);
+    FileSys::HostStatusCache::InvalidateAll();
     if (FileUtil::Exists(extsavedata_path) && !FileUtil::DeleteDirRecursively(extsavedata_path))
         return ResultCode(-1); // TODO(Subv): Find the right error code
     return RESULT_SUCCESS;
@@ -287,6 +291,7 @@ ResultCode ArchiveManager::DeleteSystemSaveData(u32 high, u32 low) {
     const std::string& nand_directory = FileUtil::GetUserPath(FileUtil::UserPath::NANDDir);
     const std::string base_path = FileSys::GetSystemSaveDataContainerPath(nand_directory);
     const std::string systemsavedata_path = FileSys::GetSystemSaveDataPath(base_path, path);
+    FileSys::HostStatusCache::InvalidateAll();
     if (!FileUtil::DeleteDirRecursively(systemsavedata_path)) {
         return ResultCode(-1); // TODO(Subv): Find the right error code
     }
@@ -301,6 +306,7 @@ ResultCode ArchiveManager::CreateSystemSaveData(u32 high, u32 low) {
     const std::string& nand_directory = FileUtil::GetUserPath(FileUtil::UserPath::NANDDir);
     const std::string base_path = FileSys::GetSystemSaveDataContainerPath(nand_directory);
     const std::string systemsavedata_path = FileSys::GetSystemSaveDataPath(base_path, path);
+    FileSys::HostStatusCache::InvalidateAll();
     if (!FileUtil::CreateFullPath(systemsavedata_path)) {
         return ResultCode(-1); // TODO(Subv): Find the right error code
     }
@@ -2,9 +2,11 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/unique_ptr.hpp>
 #include "common/archives.h"
 #include "common/logging/log.h"
+#include "common/thread_pool.h"
 #include "core/core.h"
 #include "core/file_sys/errors.h"
 #include "core/file_sys/file_backend.h"
@@ -17,9 +19,74 @@
 
 SERIALIZE_EXPORT_IMPL(Service::FS::File)
 SERIALIZE_EXPORT_IMPL(Service::FS::FileSessionSlot)
+SERIALIZE_EXPORT_IMPL(Service::FS::File::ReadCallback)
 
 namespace Service::FS {
 
+/// Runs the host reads of the files, which overlap with the delay the client threads wait for
+static Common::ThreadPool& GetIOThreadPool() {
+    static Common::ThreadPool pool{2, "FileIO"};
+    return pool;
+}
+
+/// Replies to a Read request once the client thread wakes up from the read delay
+class File::ReadCallback : public Kernel::HLERequestContext::WakeupCallback {
+public:
+    ReadCallback(std::shared_ptr<File> file, std::shared_ptr<PendingRead> pending, u64 offset,
+                 u32 length, u32 buffer_id)
+        : file(std::move(file)), pending(std::move(pending)), offset(offset), length(length),
+          buffer_id(buffer_id) {}
+
+    void WakeUp(std::shared_ptr<Kernel::Thread> thread, Kernel::HLERequestContext& ctx,
+                Kernel::ThreadWakeupReason reason) override {
+        std::shared_ptr<PendingRead> result = std::move(pending);
+        if (result) {
+            // Only blocks if the host read takes longer than the delay the guest waited for
+            result->done.wait();
+            if (file->pending_read == result) {
+                file->pending_read.reset();
+            }
+        } else {
+            // The state was loaded while the read was running, it is made again
+            file->WaitForPendingRead();
+            result = std::make_shared<PendingRead>();
+            file->ReadBackend(*result, offset, length);
+        }
+
+        auto& buffer = ctx.GetMappedBuffer(buffer_id);
+        IPC::RequestBuilder rb(ctx, 0x0802, 2, 2);
+        if (result->code.IsError()) {
+            rb.Push(result->code);
+            rb.Push<u32>(0);
+        } else {
+            buffer.Write(result->data.data(), 0, result->read);
+            rb.Push(RESULT_SUCCESS);
+            rb.Push<u32>(static_cast<u32>(result->read));
+        }
+        rb.PushMappedBuffer(buffer);
+    }
+
+private:
+    std::shared_ptr<File> file;
+    /// Not serialized, null once the result is taken or after a load
+    std::shared_ptr<PendingRead> pending;
+    u64 offset;
+    u32 length;
+    u32 buffer_id;
+
+    ReadCallback() = default;
+
+    template <class Archive>
+    void serialize(Archive& ar, const unsigned int) {
+        ar& boost::serialization::base_object<Kernel::HLERequestContext::WakeupCallback>(*this);
+        ar& file;
+        ar& offset;
+        ar& length;
+        ar& buffer_id;
+    }
+    friend class boost::serialization::access;
+};
+
 template <class Archive>
 void File::serialize(Archive& ar, const unsigned int) {
     ar& boost::serialization::base_object<Kernel::SessionRequestHandler>(*this);
@@ -53,6 +120,24 @@ File::File(Kernel::KernelSystem& kernel)
     RegisterHandlers(functions);
 }
 
+File::~File() {
+    WaitForPendingRead();
+}
+
+void File::WaitForPendingRead() {
+    if (pending_read) {
+        pending_read->done.wait();
+        pending_read.reset();
+    }
+}
+
+void File::ReadBackend(PendingRead& pending, u64 offset, u32 length) {
+    pending.data.resize(length);
+    const ResultVal<std::size_t> read = backend->Read(offset, length, pending.data.data());
+    pending.code = read.Code();
+    pending.read = read.Succeeded() ? *read : 0;
+}
+
 void File::Read(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp(ctx, 0x0802, 3, 2);
     u64 offset = rp.Pop<u64>();
@@ -60,6 +145,8 @@ void File::Read(Kernel::HLERequestContext& ctx) {
     auto& buffer = rp.PopMappedBuffer();
     LOG_TRACE(Service_FS, "Read {}: offset=0x{:x} length=0x{:08X}", GetName(), offset, length);
 
+    WaitForPendingRead();
+
     const FileSessionSlot* file = GetSessionData(ctx.Session());
 
     if (file->subfile && length > file->size) {
@@ -76,22 +163,22 @@ void File::Read(Kernel::HLERequestContext& ctx) {
                   offset, length, backend->GetSize());
     }
 
-    IPC::RequestBuilder rb = rp.MakeBuilder(2, 2);
-
-    std::vector<u8> data(length);
-    ResultVal<std::size_t> read = backend->Read(offset, data.size(), data.data());
-    if (read.Failed()) {
-        rb.Push(read.Code());
-        rb.Push<u32>(0);
-    } else {
-        buffer.Write(data.data(), 0, *read);
-        rb.Push(RESULT_SUCCESS);
-        rb.Push<u32>(static_cast<u32>(*read));
-    }
-    rb.PushMappedBuffer(buffer);
-
-    std::chrono::nanoseconds read_timeout_ns{backend->GetReadDelayNs(length)};
-    ctx.SleepClientThread("file::read", read_timeout_ns, nullptr);
+    // The host read runs in the background while the client thread waits for the delay of the
+    // read, the callback replies once the thread wakes up
+    const std::chrono::nanoseconds read_timeout_ns{backend->GetReadDelayNs(length)};
+    auto pending = std::make_shared<PendingRead>();
+    auto promise = std::make_shared<std::promise<void>>();
+    pending->done = promise->get_future().share();
+    GetIOThreadPool().Push([this, pending, promise, offset, length] {
+        ReadBackend(*pending, offset, length);
+        promise->set_value();
+    });
+    pending_read = pending;
+
+    auto callback = std::make_shared<ReadCallback>(
+        std::static_pointer_cast<File>(shared_from_this()), std::move(pending), offset, length,
+        buffer.GetId());
+    ctx.SleepClientThread("file::read", read_timeout_ns, std::move(callback));
 }
 
 void File::Write(Kernel::HLERequestContext& ctx) {
@@ -115,9 +202,15 @@ void File::Write(Kernel::HLERequestContext& ctx) {
         return;
     }
 
-    std::vector<u8> data(length);
-    buffer.Read(data.data(), 0, data.size());
-    ResultVal<std::size_t> written = backend->Write(offset, data.size(), flush != 0, data.data());
+    WaitForPendingRead();
+    std::vector<u8> data;
+    const u8* src = buffer.GetPointer(0, length);
+    if (src == nullptr) {
+        data.resize(length);
+        buffer.Read(data.data(), 0, data.size());
+        src = data.data();
+    }
+    ResultVal<std::size_t> written = backend->Write(offset, length, flush != 0, src);
 
     // Update file size
     file->size = backend->GetSize();
@@ -157,6 +250,7 @@ void File::SetSize(Kernel::HLERequestContext& ctx) {
     }
 
     file->size = size;
+    WaitForPendingRead();
     backend->SetSize(size);
     rb.Push(RESULT_SUCCESS);
 }
@@ -169,6 +263,7 @@ void File::Close(Kernel::HLERequestContext& ctx) {
         LOG_WARNING(Service_FS, "Closing File backend but {} clients still connected",
                     connected_sessions.size());
 
+    WaitForPendingRead();
     backend->Close();
     IPC::RequestBuilder rb = rp.MakeBuilder(1, 0);
     rb.Push(RESULT_SUCCESS);
@@ -187,6 +282,7 @@ void File::Flush(Kernel::HLERequestContext& ctx) {
         return;
     }
 
+    WaitForPendingRead();
     backend->Flush();
     rb.Push(RESULT_SUCCESS);
 }
@@ -224,6 +320,7 @@ void File::OpenLinkFile(Kernel::HLERequestContext& ctx) {
 
     slot->priority = original_file->priority;
     slot->offset = 0;
+    WaitForPendingRead();
     slot->size = backend->GetSize();
     slot->subfile = false;
 
@@ -282,6 +379,7 @@ std::shared_ptr<Kernel::ClientSession> File::Connect() {
     FileSessionSlot* slot = GetSessionData(std::move(server));
     slot->priority = 0;
     slot->offset = 0;
+    WaitForPendingRead();
     slot->size = backend->GetSize();
     slot->subfile = false;
 
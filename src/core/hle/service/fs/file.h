@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <future>
 #include <memory>
+#include <vector>
 #include <boost/serialization/base_object.hpp>
 #include "core/file_sys/archive_backend.h"
 #include "core/global.h"
@@ -41,7 +43,9 @@ class File final : public ServiceFramework<File, FileSessionSlot> {
 public:
     File(Kernel::KernelSystem& kernel, std::unique_ptr<FileSys::FileBackend>&& backend,
          const FileSys::Path& path);
-    ~File() = default;
+    ~File();
+
+    class ReadCallback;
 
     std::string GetName() const {
         return "Path: " + path.DebugStr();
@@ -61,7 +65,22 @@ public:
     // OpenSubFile.
     std::size_t GetSessionFileSize(std::shared_ptr<Kernel::ServerSession> session);
 
+    /// Waits for the host read of a Read request running in the background, if any. The backend
+    /// must not be used before.
+    void WaitForPendingRead();
+
 private:
+    /// Results of a host read, made in the background while the client thread waits
+    struct PendingRead {
+        std::vector<u8> data;
+        ResultCode code = RESULT_SUCCESS;
+        std::size_t read = 0;
+        std::shared_future<void> done;
+    };
+
+    /// Reads into the pending read from the backend
+    void ReadBackend(PendingRead& pending, u64 offset, u32 length);
+
     void Read(Kernel::HLERequestContext& ctx);
     void Write(Kernel::HLERequestContext& ctx);
     void GetSize(Kernel::HLERequestContext& ctx);
@@ -75,6 +94,9 @@ private:
 
     Kernel::KernelSystem& kernel;
 
+    /// Not serialized, the read callback of a loaded state reads again
+    std::shared_ptr<PendingRead> pending_read;
+
     File(Kernel::KernelSystem& kernel);
     File();
 
@@ -87,3 +109,4 @@ private:
 
 BOOST_CLASS_EXPORT_KEY(Service::FS::FileSessionSlot)
 BOOST_CLASS_EXPORT_KEY(Service::FS::File)
+BOOST_CLASS_EXPORT_KEY(Service::FS::File::ReadCallback)
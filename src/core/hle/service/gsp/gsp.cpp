@@ -18,6 +18,16 @@ void SignalInterrupt(InterruptId interrupt_id) {
     return gpu->SignalInterrupt(interrupt_id);
 }
 
+void SignalInterrupts(const std::vector<InterruptId>& interrupt_ids) {
+    auto gpu = gsp_gpu.lock();
+    ASSERT(gpu != nullptr);
+    gpu->BeginInterruptBatch();
+    for (const auto interrupt_id : interrupt_ids) {
+        gpu->SignalInterrupt(interrupt_id);
+    }
+    gpu->EndInterruptBatch();
+}
+
 void InstallInterfaces(Core::System& system) {
     auto& service_manager = system.ServiceManager();
     auto gpu = std::make_shared<GSP_GPU>(system);
@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <string>
+#include <vector>
 #include "common/common_types.h"
 #include "core/hle/result.h"
 #include "core/hle/service/gsp/gsp_gpu.h"
@@ -22,6 +23,12 @@ namespace Service::GSP {
  */
 void SignalInterrupt(InterruptId interrupt_id);
 
+/**
+ * Signals the interrupts in order, waking the threads waiting on them once for all of them
+ * @param interrupt_ids IDs of the interrupts that are being signalled
+ */
+void SignalInterrupts(const std::vector<InterruptId>& interrupt_ids);
+
 void InstallInterfaces(Core::System& system);
 
 void SetGlobalModule(Core::System& system);
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 #include "common/archives.h"
 #include "common/bit_field.h"
@@ -307,12 +309,13 @@ ResultCode SetBufferSwap(u32 screen_id, const FrameBufferInfo& info) {
         base_address + 4 * static_cast<u32>(GPU_REG_INDEX(framebuffer_config[screen_id].active_fb)),
         info.shown_fb);
 
-    if (Pica::g_debug_context)
-        Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::BufferSwapped, nullptr);
+    if (Pica::DebugContext* debug_context = Pica::GetAttachedDebugContext())
+        debug_context->OnEvent(Pica::DebugContext::Event::BufferSwapped, nullptr);
 
     if (screen_id == 0) {
         MicroProfileFlip();
         Core::System::GetInstance().perf_stats->EndGameFrame();
+        Core::System::GetInstance().NotifyFrameSubmitted();
     }
 
     return RESULT_SUCCESS;
@@ -444,9 +447,38 @@ void GSP_GPU::SignalInterruptForThread(InterruptId interrupt_id, u32 thread_id)
             info->is_dirty.Assign(false);
         }
     }
+
+    // The thread reads every slot of the relay queue when it wakes up, so the interrupts of a
+    // batch take a single signal
+    if (interrupt_batch_depth > 0) {
+        pending_interrupt_events[thread_id] = true;
+        return;
+    }
     interrupt_event->Signal();
 }
 
+void GSP_GPU::BeginInterruptBatch() {
+    ++interrupt_batch_depth;
+}
+
+void GSP_GPU::EndInterruptBatch() {
+    ASSERT(interrupt_batch_depth > 0);
+    if (--interrupt_batch_depth > 0) {
+        return;
+    }
+    for (u32 thread_id = 0; thread_id < MaxGSPThreads; ++thread_id) {
+        if (!pending_interrupt_events[thread_id]) {
+            continue;
+        }
+        pending_interrupt_events[thread_id] = false;
+        // The session may have unregistered its event while the batch was running
+        SessionData* session_data = FindRegisteredThreadData(thread_id);
+        if (session_data != nullptr && session_data->interrupt_event != nullptr) {
+            session_data->interrupt_event->Signal();
+        }
+    }
+}
+
 /**
  * Signals that the specified interrupt type has occurred to userland code
  * @param interrupt_id ID of interrupt that is being signalled
@@ -478,7 +510,39 @@ void GSP_GPU::SignalInterrupt(InterruptId interrupt_id) {
 
 MICROPROFILE_DEFINE(GPU_GSP_DMA, "GPU", "GSP DMA", MP_RGB(100, 0, 255));
 
-/// Executes the next GSP command
+/**
+ * Flushes the sources and invalidates the destinations of a run of DMA requests from the
+ * rasterizer cache. The regions of the run are merged first, as games often copy adjacent blocks.
+ * Flushing all the sources before invalidating any destination keeps the copies reading what they
+ * would have read had each request been flushed on its own.
+ */
+static void FlushDMARegions(const std::vector<Command>& commands, std::size_t begin,
+                            std::size_t end) {
+    using Region = std::pair<VAddr, VAddr>;
+    auto flush_merged = [](std::vector<Region>& regions, Memory::FlushMode mode) {
+        std::sort(regions.begin(), regions.end());
+        for (std::size_t i = 0; i < regions.size();) {
+            const VAddr start = regions[i].first;
+            VAddr region_end = regions[i].second;
+            for (++i; i < regions.size() && regions[i].first <= region_end; ++i) {
+                region_end = std::max(region_end, regions[i].second);
+            }
+            Memory::RasterizerFlushVirtualRegion(start, region_end - start, mode);
+        }
+    };
+
+    std::vector<Region> sources;
+    std::vector<Region> destinations;
+    for (std::size_t i = begin; i < end; ++i) {
+        const auto& request = commands[i].dma_request;
+        sources.emplace_back(request.source_address, request.source_address + request.size);
+        destinations.emplace_back(request.dest_address, request.dest_address + request.size);
+    }
+    flush_merged(sources, Memory::FlushMode::Flush);
+    flush_merged(destinations, Memory::FlushMode::Invalidate);
+}
+
+/// Executes the next GSP command, the regions of the DMA requests must have been flushed before
 static void ExecuteCommand(const Command& command, u32 thread_id) {
     // Utility function to convert register ID to address
     static auto WriteGPURegister = [](u32 id, u32 data) {
@@ -494,12 +558,6 @@ static void ExecuteCommand(const Command& command, u32 thread_id) {
 
         // TODO: Consider attempting rasterizer-accelerated surface blit if that usage is ever
         // possible/likely
-        Memory::RasterizerFlushVirtualRegion(command.dma_request.source_address,
-                                             command.dma_request.size, Memory::FlushMode::Flush);
-        Memory::RasterizerFlushVirtualRegion(command.dma_request.dest_address,
-                                             command.dma_request.size,
-                                             Memory::FlushMode::Invalidate);
-
         // TODO(Subv): These memory accesses should not go through the application's memory mapping.
         // They should go through the GSP module's memory mapping.
         memory.CopyBlock(*Core::System::GetInstance().Kernel().GetCurrentProcess(),
@@ -607,9 +665,8 @@ static void ExecuteCommand(const Command& command, u32 thread_id) {
         LOG_ERROR(Service_GSP, "unknown command 0x{:08X}", (int)command.id.Value());
     }
 
-    if (Pica::g_debug_context)
-        Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::GSPCommandProcessed,
-                                       (void*)&command);
+    if (Pica::DebugContext* debug_context = Pica::GetAttachedDebugContext())
+        debug_context->OnEvent(Pica::DebugContext::Event::GSPCommandProcessed, (void*)&command);
 }
 
 void GSP_GPU::SetLcdForceBlack(Kernel::HLERequestContext& ctx) {
@@ -632,22 +689,44 @@ void GSP_GPU::SetLcdForceBlack(Kernel::HLERequestContext& ctx) {
 void GSP_GPU::TriggerCmdReqQueue(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp(ctx, 0xC, 0, 0);
 
+    // The interrupts the commands raise are delivered together once the queues are drained
+    BeginInterruptBatch();
+
     // Iterate through each thread's command queue...
-    for (unsigned thread_id = 0; thread_id < 0x4; ++thread_id) {
+    std::vector<Command> commands;
+    for (u32 thread_id = 0; thread_id < MaxGSPThreads; ++thread_id) {
         CommandBuffer* command_buffer = (CommandBuffer*)GetCommandBuffer(shared_memory, thread_id);
 
-        // Iterate through each command...
-        for (unsigned i = 0; i < command_buffer->number_commands; ++i) {
-            g_debugger.GXCommandProcessed((u8*)&command_buffer->commands[i]);
+        // Load every pending command, starting from the current index of the ring
+        commands.clear();
+        while (command_buffer->number_commands > 0) {
+            const u32 index = command_buffer->index;
+            commands.push_back(command_buffer->commands[index % 0xF]);
+            command_buffer->index.Assign((index + 1) % 0xF);
+            command_buffer->number_commands.Assign(command_buffer->number_commands - 1);
+        }
 
-            // Decode and execute command
-            ExecuteCommand(command_buffer->commands[i], thread_id);
+        for (std::size_t i = 0; i < commands.size(); ++i) {
+            // Flush the regions of the DMA requests that follow each other all at once
+            if (commands[i].id == CommandId::REQUEST_DMA &&
+                (i == 0 || commands[i - 1].id != CommandId::REQUEST_DMA)) {
+                std::size_t run_end = i + 1;
+                while (run_end < commands.size() &&
+                       commands[run_end].id == CommandId::REQUEST_DMA) {
+                    ++run_end;
+                }
+                FlushDMARegions(commands, i, run_end);
+            }
 
-            // Indicates that command has completed
-            command_buffer->number_commands.Assign(command_buffer->number_commands - 1);
+            g_debugger.GXCommandProcessed((u8*)&commands[i]);
+
+            // Decode and execute command
+            ExecuteCommand(commands[i], thread_id);
         }
     }
 
+    EndInterruptBatch();
+
     IPC::RequestBuilder rb = rp.MakeBuilder(1, 0);
     rb.Push(RESULT_SUCCESS);
 }
@@ -228,6 +228,16 @@ public:
      */
     void SignalInterrupt(InterruptId interrupt_id);
 
+    /**
+     * Holds back the signalling of the interrupt events until the matching EndInterruptBatch.
+     * The interrupts are still queued to the relay queues as they occur, but each thread waiting
+     * on them is woken once for the whole batch. Batches can be nested.
+     */
+    void BeginInterruptBatch();
+
+    /// Signals the events of the threads that received interrupts during the batch
+    void EndInterruptBatch();
+
     /**
      * Retrieves the framebuffer info stored in the GSP shared memory for the
      * specified screen index and thread id.
@@ -444,6 +454,12 @@ private:
     /// Thread ids currently in use by the sessions connected to the GSPGPU service.
     std::array<bool, MaxGSPThreads> used_thread_ids = {false, false, false, false};
 
+    /// Depth of the interrupt batches running, they never span a save state
+    u32 interrupt_batch_depth = 0;
+
+    /// Threads that received an interrupt during the running batch
+    std::array<bool, MaxGSPThreads> pending_interrupt_events{};
+
     friend class SessionData;
 
     template <class Archive>
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <numeric>
 #include <boost/serialization/array.hpp>
@@ -45,7 +46,7 @@ void Module::serialize(Archive& ar, const unsigned int file_version) {
     ar& enable_accelerometer_count;
     ar& enable_gyroscope_count;
     if (Archive::is_loading::value) {
-        LoadInputDevices();
+        ReloadInputDevices();
     }
     if (file_version >= 1) {
         ar& state.hex;
@@ -60,6 +61,10 @@ constexpr u64 pad_update_ticks = BASE_CLOCK_RATE_ARM11 / 234;
 constexpr u64 accelerometer_update_ticks = BASE_CLOCK_RATE_ARM11 / 104;
 constexpr u64 gyroscope_update_ticks = BASE_CLOCK_RATE_ARM11 / 101;
 
+// Period at which the input thread polls the devices, well below the update periods so that the
+// status an update takes is at most that old
+constexpr std::chrono::milliseconds input_sample_interval{1};
+
 constexpr float accelerometer_coef = 512.0f; // measured from hw test result
 constexpr float gyroscope_coef = 14.375f; // got from hwtest GetGyroscopeLowRawToDpsCoefficient call
 
@@ -111,31 +116,53 @@ void Module::LoadInputDevices() {
     }
 }
 
+void Module::SampleInputDevices() {
+    InputStatus& status = input_status.Back();
+    std::transform(buttons.begin(), buttons.end(), status.buttons.begin(),
+                   [](const auto& button) { return button->GetStatus(); });
+    status.circle_pad = circle_pad->GetStatus();
+    status.touch = touch_device->GetStatus();
+    if (!std::get<2>(status.touch) && touch_btn_device) {
+        status.touch = touch_btn_device->GetStatus();
+    }
+    status.motion = motion_device->GetStatus();
+    input_status.Publish();
+}
+
+void Module::InputThreadLoop() {
+    Common::SetCurrentThreadName("HID:Input");
+    while (!stop_input_thread) {
+        if (is_device_reload_pending.exchange(false)) {
+            LoadInputDevices();
+        }
+        SampleInputDevices();
+        input_thread_event.WaitUntil(std::chrono::steady_clock::now() + input_sample_interval);
+    }
+}
+
 void Module::UpdatePadCallback(u64 userdata, s64 cycles_late) {
     SharedMem* mem = reinterpret_cast<SharedMem*>(shared_mem->GetPointer());
-
-    if (is_device_reload_pending.exchange(false))
-        LoadInputDevices();
+    const InputStatus& input = input_status.Read();
 
     using namespace Settings::NativeButton;
-    state.a.Assign(buttons[A - BUTTON_HID_BEGIN]->GetStatus());
-    state.b.Assign(buttons[B - BUTTON_HID_BEGIN]->GetStatus());
-    state.x.Assign(buttons[X - BUTTON_HID_BEGIN]->GetStatus());
-    state.y.Assign(buttons[Y - BUTTON_HID_BEGIN]->GetStatus());
-    state.right.Assign(buttons[Right - BUTTON_HID_BEGIN]->GetStatus());
-    state.left.Assign(buttons[Left - BUTTON_HID_BEGIN]->GetStatus());
-    state.up.Assign(buttons[Up - BUTTON_HID_BEGIN]->GetStatus());
-    state.down.Assign(buttons[Down - BUTTON_HID_BEGIN]->GetStatus());
-    state.l.Assign(buttons[L - BUTTON_HID_BEGIN]->GetStatus());
-    state.r.Assign(buttons[R - BUTTON_HID_BEGIN]->GetStatus());
-    state.start.Assign(buttons[Start - BUTTON_HID_BEGIN]->GetStatus());
-    state.select.Assign(buttons[Select - BUTTON_HID_BEGIN]->GetStatus());
-    state.debug.Assign(buttons[Debug - BUTTON_HID_BEGIN]->GetStatus());
-    state.gpio14.Assign(buttons[Gpio14 - BUTTON_HID_BEGIN]->GetStatus());
+    state.a.Assign(input.buttons[A - BUTTON_HID_BEGIN]);
+    state.b.Assign(input.buttons[B - BUTTON_HID_BEGIN]);
+    state.x.Assign(input.buttons[X - BUTTON_HID_BEGIN]);
+    state.y.Assign(input.buttons[Y - BUTTON_HID_BEGIN]);
+    state.right.Assign(input.buttons[Right - BUTTON_HID_BEGIN]);
+    state.left.Assign(input.buttons[Left - BUTTON_HID_BEGIN]);
+    state.up.Assign(input.buttons[Up - BUTTON_HID_BEGIN]);
+    state.down.Assign(input.buttons[Down - BUTTON_HID_BEGIN]);
+    state.l.Assign(input.buttons[L - BUTTON_HID_BEGIN]);
+    state.r.Assign(input.buttons[R - BUTTON_HID_BEGIN]);
+    state.start.Assign(input.buttons[Start - BUTTON_HID_BEGIN]);
+    state.select.Assign(input.buttons[Select - BUTTON_HID_BEGIN]);
+    state.debug.Assign(input.buttons[Debug - BUTTON_HID_BEGIN]);
+    state.gpio14.Assign(input.buttons[Gpio14 - BUTTON_HID_BEGIN]);
 
     // Get current circle pad position and update circle pad direction
     float circle_pad_x_f, circle_pad_y_f;
-    std::tie(circle_pad_x_f, circle_pad_y_f) = circle_pad->GetStatus();
+    std::tie(circle_pad_x_f, circle_pad_y_f) = input.circle_pad;
 
     // xperia64: 0x9A seems to be the calibrated limit of the circle pad
     // Verified by using Input Redirector with very large-value digital inputs
@@ -198,10 +225,7 @@ void Module::UpdatePadCallback(u64 userdata, s64 cycles_late) {
     TouchDataEntry& touch_entry = mem->touch.entries[mem->touch.index];
     bool pressed = false;
     float x, y;
-    std::tie(x, y, pressed) = touch_device->GetStatus();
-    if (!pressed && touch_btn_device) {
-        std::tie(x, y, pressed) = touch_btn_device->GetStatus();
-    }
+    std::tie(x, y, pressed) = input.touch;
     touch_entry.x = static_cast<u16>(x * Core::kScreenBottomWidth);
     touch_entry.y = static_cast<u16>(y * Core::kScreenBottomHeight);
     touch_entry.valid.Assign(pressed ? 1 : 0);
@@ -237,7 +261,7 @@ void Module::UpdateAccelerometerCallback(u64 userdata, s64 cycles_late) {
     next_accelerometer_index = (next_accelerometer_index + 1) % mem->accelerometer.entries.size();
 
     Common::Vec3<float> accel;
-    std::tie(accel, std::ignore) = motion_device->GetStatus();
+    std::tie(accel, std::ignore) = input_status.Read().motion;
     accel *= accelerometer_coef;
     // TODO(wwylele): do a time stretch like the one in UpdateGyroscopeCallback
     // The time stretch formula should be like
@@ -284,7 +308,7 @@ void Module::UpdateGyroscopeCallback(u64 userdata, s64 cycles_late) {
     GyroscopeDataEntry& gyroscope_entry = mem->gyroscope.entries[mem->gyroscope.index];
 
     Common::Vec3<float> gyro;
-    std::tie(std::ignore, gyro) = motion_device->GetStatus();
+    std::tie(std::ignore, gyro) = input_status.Read().motion;
     double stretch = system.perf_stats->GetLastFrameTimeScale();
     gyro *= gyroscope_coef * static_cast<float>(stretch);
     gyroscope_entry.x = static_cast<s16>(gyro.x);
@@ -457,6 +481,14 @@ Module::Module(Core::System& system) : system(system) {
         });
 
     timing.ScheduleEvent(pad_update_ticks, pad_update_event);
+
+    input_thread = std::thread([this] { InputThreadLoop(); });
+}
+
+Module::~Module() {
+    stop_input_thread = true;
+    input_thread_event.Set();
+    input_thread.join();
 }
 
 void Module::ReloadInputDevices() {
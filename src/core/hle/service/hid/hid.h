@@ -8,11 +8,15 @@
 #include <atomic>
 #include <cstddef>
 #include <memory>
+#include <thread>
+#include <tuple>
 #include <vector>
 #include <boost/serialization/version.hpp>
 #include "common/bit_field.h"
 #include "common/common_funcs.h"
 #include "common/common_types.h"
+#include "common/thread.h"
+#include "common/triple_buffer.h"
 #include "core/frontend/input.h"
 #include "core/hle/service/service.h"
 #include "core/settings.h"
@@ -199,6 +203,7 @@ DirectionState GetStickDirectionState(s16 circle_pad_x, s16 circle_pad_y);
 class Module final {
 public:
     explicit Module(Core::System& system);
+    ~Module();
 
     class Interface : public ServiceFramework<Interface> {
     public:
@@ -298,7 +303,18 @@ public:
     const PadState& GetState() const;
 
 private:
+    /// The status of all the input devices at some point in time
+    struct InputStatus {
+        std::array<bool, Settings::NativeButton::NUM_BUTTONS_HID> buttons{};
+        std::tuple<float, float> circle_pad{};
+        std::tuple<float, float, bool> touch{};
+        std::tuple<Common::Vec3<float>, Common::Vec3<float>> motion{};
+    };
+
     void LoadInputDevices();
+    /// Polls the input devices and publishes their status, they are only used by the input thread
+    void SampleInputDevices();
+    void InputThreadLoop();
     void UpdatePadCallback(u64 userdata, s64 cycles_late);
     void UpdateAccelerometerCallback(u64 userdata, s64 cycles_late);
     void UpdateGyroscopeCallback(u64 userdata, s64 cycles_late);
@@ -347,6 +363,13 @@ private:
     std::unique_ptr<Input::TouchDevice> touch_device;
     std::unique_ptr<Input::TouchDevice> touch_btn_device;
 
+    /// The input devices are polled on their own thread, so that the update events only have to
+    /// take the latest status instead of waiting for the locks of the frontend devices
+    Common::TripleBuffer<InputStatus> input_status;
+    std::atomic<bool> stop_input_thread{false};
+    Common::Event input_thread_event;
+    std::thread input_thread;
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int);
     friend class boost::serialization::access;
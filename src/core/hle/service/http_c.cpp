@@ -57,24 +57,60 @@ const ResultCode ERROR_WRONG_CERT_HANDLE = // 0xD8A0A0C9
 const ResultCode ERROR_CERT_ALREADY_SET = // 0xD8A0A03D
     ResultCode(61, ErrorModule::HTTP, ErrorSummary::InvalidState, ErrorLevel::Permanent);
 
-void Context::MakeRequest() {
+#ifdef ENABLE_WEB_SERVICE
+std::unique_ptr<httplib::Client> ClientPool::Take(const Key& key) {
+    std::lock_guard lock{mutex};
+    const auto it = idle_clients.find(key);
+    if (it == idle_clients.end() || it->second.empty()) {
+        return nullptr;
+    }
+    auto client = std::move(it->second.back());
+    it->second.pop_back();
+    return client;
+}
+
+void ClientPool::Return(const Key& key, std::unique_ptr<httplib::Client> client) {
+    std::lock_guard lock{mutex};
+    auto& clients = idle_clients[key];
+    if (clients.size() < MAX_IDLE_CLIENTS_PER_HOST) {
+        clients.push_back(std::move(client));
+    }
+}
+#endif
+
+Context::~Context() {
+    if (request_future.valid()) {
+        request_future.wait();
+    }
+}
+
+void Context::MakeRequest(ClientPool& client_pool) {
     ASSERT(state == RequestState::NotStarted);
 
 #ifdef ENABLE_WEB_SERVICE
     LUrlParser::clParseURL parsedUrl = LUrlParser::clParseURL::ParseURL(url);
+    const bool use_ssl = parsedUrl.m_Scheme != "http";
     int port;
+    if (!parsedUrl.GetPort(&port)) {
+        port = use_ssl ? 443 : 80;
+    }
+
+    // The client certificate is set on the SSL context, so those clients aren't shared
+    const auto client_cert = ssl_config.client_cert_ctx.lock();
+    const bool reusable = !client_cert;
+    const ClientPool::Key key{use_ssl, parsedUrl.m_Host, port};
+
     std::unique_ptr<httplib::Client> client;
-    if (parsedUrl.m_Scheme == "http") {
-        if (!parsedUrl.GetPort(&port)) {
-            port = 80;
-        }
+    if (reusable) {
+        client = client_pool.Take(key);
+    }
+    if (client) {
+        // Reused as is, the settings only depend on the key
+    } else if (!use_ssl) {
         // TODO(B3N30): Support for setting timeout
         // Figure out what the default timeout on 3DS is
         client = std::make_unique<httplib::Client>(parsedUrl.m_Host.c_str(), port);
     } else {
-        if (!parsedUrl.GetPort(&port)) {
-            port = 443;
-        }
         // TODO(B3N30): Support for setting timeout
         // Figure out what the default timeout on 3DS is
 
@@ -82,7 +118,7 @@ void Context::MakeRequest() {
         SSL_CTX* ctx = ssl_client->ssl_context();
         client = std::move(ssl_client);
 
-        if (auto client_cert = ssl_config.client_cert_ctx.lock()) {
+        if (client_cert) {
             SSL_CTX_use_certificate_ASN1(ctx, static_cast<int>(client_cert->certificate.size()),
                                          client_cert->certificate.data());
             SSL_CTX_use_PrivateKey_ASN1(EVP_PKEY_RSA, ctx, client_cert->private_key.data(),
@@ -127,12 +163,28 @@ void Context::MakeRequest() {
         // TODO(B3N30): Verify this state on HW
         state = RequestState::ReadyToDownloadContent;
     }
+
+    if (reusable) {
+        client_pool.Return(key, std::move(client));
+    }
 #else
     LOG_ERROR(Service_HTTP, "Tried to make request but WebServices is not enabled in this build");
     state = RequestState::TimedOut;
 #endif
 }
 
+void HTTP_C::QueueRequest(Context& context) {
+    // On a 3DS BeginRequest and BeginRequestAsync will push the Request to a worker queue.
+    // You can only enqueue 8 requests at the same time.
+    // trying to enqueue any more will either fail (BeginRequestAsync), or block (BeginRequest)
+    // Note that you only can have 8 Contexts at a time. So this difference shouldn't matter
+    // Then there are 3? worker threads that pop the requests from the queue and send them
+    auto task = std::make_shared<std::packaged_task<void()>>(
+        [this, &context] { context.MakeRequest(client_pool); });
+    context.request_future = task->get_future();
+    request_workers.Push([task] { (*task)(); });
+}
+
 void HTTP_C::Initialize(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp(ctx, 0x1, 1, 4);
     const u32 shmem_size = rp.Pop<u32>();
@@ -237,15 +289,7 @@ void HTTP_C::BeginRequest(Kernel::HLERequestContext& ctx) {
     auto itr = contexts.find(context_handle);
     ASSERT(itr != contexts.end());
 
-    // On a 3DS BeginRequest and BeginRequestAsync will push the Request to a worker queue.
-    // You can only enqueue 8 requests at the same time.
-    // trying to enqueue any more will either fail (BeginRequestAsync), or block (BeginRequest)
-    // Note that you only can have 8 Contexts at a time. So this difference shouldn't matter
-    // Then there are 3? worker threads that pop the requests from the queue and send them
-    // For now make every request async in it's own thread.
-
-    itr->second.request_future =
-        std::async(std::launch::async, &Context::MakeRequest, std::ref(itr->second));
+    QueueRequest(itr->second);
 
     IPC::RequestBuilder rb = rp.MakeBuilder(1, 0);
     rb.Push(RESULT_SUCCESS);
@@ -290,15 +334,7 @@ void HTTP_C::BeginRequestAsync(Kernel::HLERequestContext& ctx) {
     auto itr = contexts.find(context_handle);
     ASSERT(itr != contexts.end());
 
-    // On a 3DS BeginRequest and BeginRequestAsync will push the Request to a worker queue.
-    // You can only enqueue 8 requests at the same time.
-    // trying to enqueue any more will either fail (BeginRequestAsync), or block (BeginRequest)
-    // Note that you only can have 8 Contexts at a time. So this difference shouldn't matter
-    // Then there are 3? worker threads that pop the requests from the queue and send them
-    // For now make every request async in it's own thread.
-
-    itr->second.request_future =
-        std::async(std::launch::async, &Context::MakeRequest, std::ref(itr->second));
+    QueueRequest(itr->second);
 
     IPC::RequestBuilder rb = rp.MakeBuilder(1, 0);
     rb.Push(RESULT_SUCCESS);
@@ -887,7 +923,7 @@ void HTTP_C::DecryptClCertA() {
     ClCertA.init = true;
 }
 
-HTTP_C::HTTP_C() : ServiceFramework("http:C", 32) {
+HTTP_C::HTTP_C() : ServiceFramework("http:C", 32), request_workers(3, "HTTPRequest") {
     static const FunctionInfo functions[] = {
         {0x00010044, &HTTP_C::Initialize, "Initialize"},
         {0x00020082, &HTTP_C::CreateContext, "CreateContext"},
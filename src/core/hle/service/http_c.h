@@ -5,9 +5,12 @@
 #pragma once
 
 #include <future>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 #include <boost/optional.hpp>
@@ -23,6 +26,7 @@
 #endif
 #include <httplib.h>
 #endif
+#include "common/thread_pool.h"
 #include "core/hle/kernel/shared_memory.h"
 #include "core/hle/service/service.h"
 
@@ -112,6 +116,30 @@ private:
     friend class boost::serialization::access;
 };
 
+/**
+ * Keeps the clients of finished requests, so that the next requests to the same host reuse their
+ * SSL contexts instead of creating new ones.
+ */
+class ClientPool {
+public:
+#ifdef ENABLE_WEB_SERVICE
+    /// Whether SSL is used, the host and the port
+    using Key = std::tuple<bool, std::string, int>;
+
+    /// Returns an idle client for the key, or nullptr if there is none
+    std::unique_ptr<httplib::Client> Take(const Key& key);
+
+    /// Gives back a client that is done with its request
+    void Return(const Key& key, std::unique_ptr<httplib::Client> client);
+
+private:
+    static constexpr std::size_t MAX_IDLE_CLIENTS_PER_HOST = 4;
+
+    std::mutex mutex;
+    std::map<Key, std::vector<std::unique_ptr<httplib::Client>>> idle_clients;
+#endif
+};
+
 /// Represents an HTTP context.
 class Context final {
 public:
@@ -121,7 +149,10 @@ public:
     Context(const Context&) = delete;
     Context& operator=(const Context&) = delete;
 
-    void MakeRequest();
+    /// Waits for the request, which refers to the context
+    ~Context();
+
+    void MakeRequest(ClientPool& client_pool);
 
     struct Proxy {
         std::string url;
@@ -421,6 +452,15 @@ private:
     /// The next handle number to use when a new ClientCert context is created.
     ClientCertContext::Handle client_certs_counter = 0;
 
+    /// Queues the request of the context to the request workers
+    void QueueRequest(Context& context);
+
+    ClientPool client_pool;
+
+    /// Like the real HTTP module, the requests are sent by a few workers. Declared before the
+    /// contexts, which wait for their requests when they are destroyed.
+    Common::ThreadPool request_workers;
+
     /// Global list of HTTP contexts currently opened.
     std::unordered_map<Context::Handle, Context> contexts;
 
@@ -195,6 +195,25 @@ VAddr CROHelper::FindExportNamedSymbol(const std::string& name) const {
     return SegmentTagToAddress(symbol_entry.symbol_position);
 }
 
+std::vector<std::pair<VAddr, std::string>> CROHelper::GetExportedSymbols() const {
+    std::vector<std::pair<VAddr, std::string>> symbols;
+    u32 export_strings_size = GetField(ExportStringsSize);
+    u32 export_named_symbol_num = GetField(ExportNamedSymbolNum);
+    for (u32 i = 0; i < export_named_symbol_num; ++i) {
+        ExportNamedSymbolEntry entry;
+        GetEntry(system.Memory(), i, entry);
+        if (entry.name_offset == 0)
+            continue;
+
+        VAddr address = SegmentTagToAddress(entry.symbol_position);
+        if (address != 0) {
+            symbols.emplace_back(
+                address, system.Memory().ReadCString(entry.name_offset, export_strings_size));
+        }
+    }
+    return symbols;
+}
+
 ResultCode CROHelper::RebaseHeader(u32 cro_size) {
     ResultCode error = CROFormatError(0x11);
 
@@ -759,10 +778,10 @@ ResultCode CROHelper::ApplyImportNamedSymbol(VAddr crs_address) {
                                   sizeof(ExternalRelocationEntry));
 
         if (!relocation_entry.is_batch_resolved) {
+            const std::string symbol_name =
+                system.Memory().ReadCString(entry.name_offset, import_strings_size);
             ResultCode result = ForEachAutoLinkCRO(
                 process, system, crs_address, [&](CROHelper source) -> ResultVal<bool> {
-                    std::string symbol_name =
-                        system.Memory().ReadCString(entry.name_offset, import_strings_size);
                     u32 symbol_address = source.FindExportNamedSymbol(symbol_name);
 
                     if (symbol_address != 0) {
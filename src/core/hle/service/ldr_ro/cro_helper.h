@@ -5,7 +5,10 @@
 #pragma once
 
 #include <array>
+#include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 #include "common/common_types.h"
 #include "common/swap.h"
 #include "core/hle/result.h"
@@ -140,6 +143,13 @@ public:
      */
     std::tuple<VAddr, u32> GetExecutablePages() const;
 
+    /**
+     * Gets the named symbols exported by the module. The table is cropped by fixing at level 3,
+     * so this must be called before Fix.
+     * @returns a list of (address, name) pairs.
+     */
+    std::vector<std::pair<VAddr, std::string>> GetExportedSymbols() const;
+
 private:
     const VAddr module_address; ///< the virtual address of this module
     Kernel::Process& process;   ///< the owner process of this module
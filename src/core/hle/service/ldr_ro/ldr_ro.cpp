@@ -8,10 +8,13 @@
 #include "common/logging/log.h"
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
+#include "core/guest_profiler.h"
+#include "core/hle/guest_routines.h"
 #include "core/hle/ipc_helpers.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/service/ldr_ro/cro_helper.h"
 #include "core/hle/service/ldr_ro/ldr_ro.h"
+#include "core/settings.h"
 
 SERVICE_CONSTRUCT_IMPL(Service::LDR::RO)
 SERIALIZE_EXPORT_IMPL(Service::LDR::RO)
@@ -59,6 +62,17 @@ static bool VerifyBufferState(Kernel::Process& process, VAddr buffer_ptr, u32 si
     return false;
 }
 
+/// Makes the CPU cores run the memory routines exported by the module natively
+static void PatchMemoryRoutines(Core::System& system, const Kernel::Process& process,
+                                const std::string& module_name,
+                                const std::vector<std::pair<VAddr, std::string>>& symbols) {
+    const std::size_t patched = HLE::PatchGuestRoutines(system, process, symbols);
+    if (patched != 0) {
+        LOG_INFO(Service_LDR, "Running {} memory routines of \"{}\" natively", patched,
+                 module_name);
+    }
+}
+
 void RO::Initialize(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp(ctx, 0x01, 3, 2);
     VAddr crs_buffer_ptr = rp.Pop<u32>();
@@ -139,6 +153,18 @@ void RO::Initialize(Kernel::HLERequestContext& ctx) {
 
     slot->loaded_crs = crs_address;
 
+    // The static module describes the executable, exporting its symbols
+    if (Settings::values.hle_memory_routines) {
+        PatchMemoryRoutines(system, *process, process->codeset->name, crs.GetExportedSymbols());
+    }
+    if (system.guest_profiler) {
+        auto [exe_begin, exe_size] = crs.GetExecutablePages();
+        if (exe_begin) {
+            system.guest_profiler->AddModule(process->process_id, process->codeset->name,
+                                             exe_begin, exe_size, crs.GetExportedSymbols());
+        }
+    }
+
     rb.Push(RESULT_SUCCESS);
 }
 
@@ -296,6 +322,12 @@ void RO::LoadCRO(Kernel::HLERequestContext& ctx, bool link_on_load_bug_fix) {
 
     cro.Register(slot->loaded_crs, auto_link);
 
+    // Fixing crops the exported symbols
+    std::vector<std::pair<VAddr, std::string>> symbols;
+    if (system.guest_profiler || Settings::values.hle_memory_routines) {
+        symbols = cro.GetExportedSymbols();
+    }
+
     u32 fix_size = cro.Fix(fix_level);
 
     if (fix_size != cro_size) {
@@ -325,8 +357,17 @@ void RO::LoadCRO(Kernel::HLERequestContext& ctx, bool link_on_load_bug_fix) {
         }
     }
 
+    if (Settings::values.hle_memory_routines) {
+        PatchMemoryRoutines(system, *process, cro.ModuleName(), symbols);
+    }
+
     system.InvalidateCacheRange(cro_address, cro_size);
 
+    if (system.guest_profiler && exe_begin) {
+        system.guest_profiler->AddModule(process->process_id, cro.ModuleName(), exe_begin,
+                                         exe_size, std::move(symbols));
+    }
+
     LOG_INFO(Service_LDR, "CRO \"{}\" loaded at 0x{:08X}, fixed_end=0x{:08X}", cro.ModuleName(),
              cro_address, cro_address + fix_size);
 
@@ -370,6 +411,11 @@ void RO::UnloadCRO(Kernel::HLERequestContext& ctx) {
 
     u32 fixed_size = cro.GetFixedSize();
 
+    if (system.guest_profiler) {
+        system.guest_profiler->RemoveModule(process->process_id,
+                                            std::get<0>(cro.GetExecutablePages()));
+    }
+
     cro.Unregister(slot->loaded_crs);
 
     ResultCode result = cro.Unlink(slot->loaded_crs);
@@ -500,6 +546,10 @@ void RO::Shutdown(Kernel::HLERequestContext& ctx) {
     }
 
     CROHelper crs(slot->loaded_crs, *process, system);
+    if (system.guest_profiler) {
+        system.guest_profiler->RemoveModule(process->process_id,
+                                            std::get<0>(crs.GetExecutablePages()));
+    }
     crs.Unrebase(true);
 
     ResultCode result = RESULT_SUCCESS;
@@ -11,6 +11,9 @@ SERIALIZE_EXPORT_IMPL(Service::MVD::MVD_STD)
 namespace Service::MVD {
 
 MVD_STD::MVD_STD() : ServiceFramework("mvd:std", 1) {
+    // Note: Initialize is deliberately left unimplemented until the service actually decodes
+    // video. Applications fall back to their own software decoder when it fails, whereas
+    // stubbing it would make them hand their NAL units to a decoder that never outputs a frame.
     static const FunctionInfo functions[] = {
         // clang-format off
         {0x00010082, nullptr, "Initialize"},
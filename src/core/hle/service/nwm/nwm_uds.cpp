@@ -55,6 +55,30 @@ constexpr u16 BroadcastNetworkNodeId = 0xFFFF;
 // The Host has always dest_node_id 1
 constexpr u16 HostDestNodeId = 1;
 
+ReceivedDataPacket& ReceivedPacketQueue::Push() {
+    if (count == slots.size()) {
+        // Unroll the ring into a larger one, the moved slots keep their buffers
+        std::vector<ReceivedDataPacket> grown(std::max<std::size_t>(slots.size() * 2, 8));
+        for (std::size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(slots[(head + i) % slots.size()]);
+        }
+        slots = std::move(grown);
+        head = 0;
+    }
+    return slots[(head + count++) % slots.size()];
+}
+
+const ReceivedDataPacket& ReceivedPacketQueue::Front() const {
+    ASSERT(count != 0);
+    return slots[head];
+}
+
+void ReceivedPacketQueue::Pop() {
+    ASSERT(count != 0);
+    head = (head + 1) % slots.size();
+    --count;
+}
+
 std::list<Network::WifiPacket> NWM_UDS::GetReceivedBeacons(const MacAddress& sender) {
     std::lock_guard lock(beacon_mutex);
     if (sender != Network::BroadcastMac) {
@@ -362,8 +386,18 @@ void NWM_UDS::HandleSecureDataPacket(const Network::WifiPacket& packet) {
         channel_info->second.network_node_id != secure_data.src_node_id)
         return;
 
-    // Add the received packet to the data queue.
-    channel_info->second.received_packets.emplace_back(packet.data);
+    // Add the received packet to the data queue. Only the payload is kept, the headers were
+    // already parsed above.
+    constexpr std::size_t payload_offset = sizeof(LLCHeader) + sizeof(SecureDataHeader);
+    const std::size_t data_size =
+        packet.data.size() < payload_offset
+            ? 0
+            : std::min<std::size_t>(secure_data.GetActualDataSize(),
+                                    packet.data.size() - payload_offset);
+    auto& received = channel_info->second.received_packets.Push();
+    received.src_node_id = secure_data.src_node_id;
+    received.payload.assign(packet.data.begin() + payload_offset,
+                            packet.data.begin() + payload_offset + data_size);
 
     // Signal the data event. We can do this directly because we locked g_hle_lock
     channel_info->second.event->Signal();
@@ -1123,7 +1157,7 @@ void NWM_UDS::PullPacket(Kernel::HLERequestContext& ctx) {
         return;
     }
 
-    if (channel->second.received_packets.empty()) {
+    if (channel->second.received_packets.Empty()) {
         std::vector<u8> output_buffer(buff_size);
         IPC::RequestBuilder rb = rp.MakeBuilder(3, 2);
         rb.Push(RESULT_SUCCESS);
@@ -1133,10 +1167,8 @@ void NWM_UDS::PullPacket(Kernel::HLERequestContext& ctx) {
         return;
     }
 
-    const auto& next_packet = channel->second.received_packets.front();
-
-    auto secure_data = ParseSecureDataHeader(next_packet);
-    auto data_size = secure_data.GetActualDataSize();
+    const auto& next_packet = channel->second.received_packets.Front();
+    const auto data_size = static_cast<u32>(next_packet.payload.size());
 
     if (data_size > max_out_buff_size) {
         IPC::RequestBuilder rb = rp.MakeBuilder(1, 0);
@@ -1149,15 +1181,14 @@ void NWM_UDS::PullPacket(Kernel::HLERequestContext& ctx) {
 
     std::vector<u8> output_buffer(buff_size);
     // Write the actual data.
-    std::memcpy(output_buffer.data(),
-                next_packet.data() + sizeof(LLCHeader) + sizeof(SecureDataHeader), data_size);
+    std::memcpy(output_buffer.data(), next_packet.payload.data(), data_size);
 
     rb.Push(RESULT_SUCCESS);
     rb.Push<u32>(data_size);
-    rb.Push<u16>(secure_data.src_node_id);
+    rb.Push<u16>(next_packet.src_node_id);
     rb.PushStaticBuffer(std::move(output_buffer), 0);
 
-    channel->second.received_packets.pop_front();
+    channel->second.received_packets.Pop();
 }
 
 void NWM_UDS::GetChannel(Kernel::HLERequestContext& ctx) {
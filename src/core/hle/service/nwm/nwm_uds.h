@@ -7,7 +7,6 @@
 #include <array>
 #include <atomic>
 #include <cstddef>
-#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -123,6 +122,38 @@ enum class TagId : u8 {
     VendorSpecific = 221
 };
 
+/// A data packet received on a bind node, with its headers already parsed out.
+struct ReceivedDataPacket {
+    u16 src_node_id;         ///< Network node id of the sender.
+    std::vector<u8> payload; ///< Data carried by the packet.
+};
+
+/**
+ * Queue of the data packets received on a bind node. It is a ring of packet slots whose buffers
+ * are kept once a packet is pulled, so that a steady stream of packets is received without any
+ * allocations. The ring only grows when the application falls behind.
+ */
+class ReceivedPacketQueue {
+public:
+    bool Empty() const {
+        return count == 0;
+    }
+
+    /// Returns a slot at the back of the queue, its payload buffer may hold an older packet.
+    ReceivedDataPacket& Push();
+
+    /// Returns the oldest packet in the queue, which must not be empty.
+    const ReceivedDataPacket& Front() const;
+
+    /// Removes the oldest packet from the queue, its slot is reused by a later Push.
+    void Pop();
+
+private:
+    std::vector<ReceivedDataPacket> slots;
+    std::size_t head = 0;
+    std::size_t count = 0;
+};
+
 class NWM_UDS final : public ServiceFramework<NWM_UDS> {
 public:
     explicit NWM_UDS(Core::System& system);
@@ -506,8 +537,8 @@ private:
         u8 channel;          ///< Channel that this bind node was bound to.
         u16 network_node_id; ///< Node id this bind node is associated with, only packets from this
                              /// network node will be received.
-        std::shared_ptr<Kernel::Event> event;         ///< Receive event for this bind node.
-        std::deque<std::vector<u8>> received_packets; ///< List of packets received on this channel.
+        std::shared_ptr<Kernel::Event> event;  ///< Receive event for this bind node.
+        ReceivedPacketQueue received_packets; ///< Packets received on this channel.
     };
 
     // Mapping of data channels to their internal data.
@@ -3,13 +3,17 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <chrono>
 #include <fmt/format.h>
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/metrics.h"
+#include "common/tracing.h"
 #include "core/core.h"
 #include "core/hle/ipc.h"
 #include "core/hle/kernel/client_port.h"
 #include "core/hle/kernel/handle_table.h"
+#include "core/hle/kernel/ipc_debugger/profiler.h"
 #include "core/hle/kernel/process.h"
 #include "core/hle/kernel/server_port.h"
 #include "core/hle/kernel/server_session.h"
@@ -140,11 +144,28 @@ void ServiceFrameworkBase::InstallAsNamedPort(Kernel::KernelSystem& kernel) {
 void ServiceFrameworkBase::RegisterHandlersBase(const FunctionInfoBase* functions, std::size_t n) {
     handlers.reserve(handlers.size() + n);
     for (std::size_t i = 0; i < n; ++i) {
-        // Usually this array is sorted by id already, so hint to insert at the end
-        handlers.emplace_hint(handlers.cend(), functions[i].expected_header, functions[i]);
+        const u32 command_id = functions[i].expected_header >> 16;
+        if (command_id >= handler_indices.size()) {
+            handler_indices.resize(command_id + 1, 0);
+        }
+        ASSERT_MSG(handler_indices[command_id] == 0, "{} registers command {:#06x} twice",
+                   service_name, command_id);
+        handlers.push_back(functions[i]);
+        handler_indices[command_id] = static_cast<u16>(handlers.size());
     }
 }
 
+const ServiceFrameworkBase::FunctionInfoBase* ServiceFrameworkBase::FindHandler(
+    u32 header_code) const {
+    const u32 command_id = header_code >> 16;
+    if (command_id >= handler_indices.size() || handler_indices[command_id] == 0) {
+        return nullptr;
+    }
+    const FunctionInfoBase& info = handlers[handler_indices[command_id] - 1];
+    // Headers with the right id but the wrong number of parameters don't match any handler
+    return info.expected_header == header_code ? &info : nullptr;
+}
+
 void ServiceFrameworkBase::ReportUnimplementedFunction(u32* cmd_buf, const FunctionInfoBase* info) {
     IPC::Header header{cmd_buf[0]};
     int num_params = header.normal_params_size + header.translate_params_size;
@@ -166,26 +187,46 @@ void ServiceFrameworkBase::ReportUnimplementedFunction(u32* cmd_buf, const Funct
     cmd_buf[1] = 0;
 }
 
+static Common::Metrics::Counter requests_metric{"citra_hle_service_requests_total",
+                                                "Requests handled by the HLE services"};
+
 void ServiceFrameworkBase::HandleSyncRequest(Kernel::HLERequestContext& context) {
+    requests_metric.Add();
     u32 header_code = context.CommandBuffer()[0];
-    auto itr = handlers.find(header_code);
-    const FunctionInfoBase* info = itr == handlers.end() ? nullptr : &itr->second;
+    const FunctionInfoBase* info = FindHandler(header_code);
     if (info == nullptr || info->handler_callback == nullptr) {
         context.ReportUnimplemented();
         return ReportUnimplementedFunction(context.CommandBuffer(), info);
     }
 
-    LOG_TRACE(Service, "{}",
-              MakeFunctionString(info->name, GetServiceName(), context.CommandBuffer()));
+#ifdef _DEBUG
+    // The arguments are only formatted when the message isn't filtered out
+    if (Log::CheckLogFilter(Log::Class::Service, Log::Level::Trace)) {
+        LOG_TRACE(Service, "{}",
+                  MakeFunctionString(info->name, GetServiceName(), context.CommandBuffer()));
+    }
+#endif
+
+    Common::Tracing::Scope trace_scope{service_name.c_str(), info->name};
+    auto& profiler = Core::System::GetInstance().Kernel().GetIPCProfiler();
+    if (!profiler.IsEnabled()) {
+        handler_invoker(this, info->handler_callback, context);
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
     handler_invoker(this, info->handler_callback, context);
+    profiler.RecordCall(service_name, header_code, info->name,
+                        std::chrono::steady_clock::now() - start);
 }
 
 std::string ServiceFrameworkBase::GetFunctionName(u32 header) const {
-    if (!handlers.count(header)) {
+    const FunctionInfoBase* info = FindHandler(header);
+    if (info == nullptr) {
         return "";
     }
 
-    return handlers.at(header).name;
+    return info->name;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
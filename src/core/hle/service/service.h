@@ -9,7 +9,7 @@
 #include <functional>
 #include <memory>
 #include <string>
-#include <boost/container/flat_map.hpp>
+#include <vector>
 #include <boost/serialization/base_object.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 #include "common/common_types.h"
@@ -95,6 +95,9 @@ private:
     void RegisterHandlersBase(const FunctionInfoBase* functions, std::size_t n);
     void ReportUnimplementedFunction(u32* cmd_buf, const FunctionInfoBase* info);
 
+    /// Returns the handler registered for the header code, or nullptr if there is none
+    const FunctionInfoBase* FindHandler(u32 header_code) const;
+
     /// Identifier string used to connect to the service.
     std::string service_name;
     /// Maximum number of concurrent sessions that this service can handle.
@@ -102,7 +105,11 @@ private:
 
     /// Function used to safely up-cast pointers to the derived class before invoking a handler.
     InvokerFn* handler_invoker;
-    boost::container::flat_map<u32, FunctionInfoBase> handlers;
+    /// The registered handlers, in registration order
+    std::vector<FunctionInfoBase> handlers;
+    /// Maps the command id in the upper half of a header code to the index of its handler plus
+    /// one, or to zero if it has none
+    std::vector<u16> handler_indices;
 };
 
 /**
@@ -14,8 +14,11 @@
 #include "common/scope_exit.h"
 #include "common/swap.h"
 #include "core/core.h"
+#include "core/core_timing.h"
 #include "core/hle/ipc_helpers.h"
+#include "core/hle/kernel/event.h"
 #include "core/hle/kernel/shared_memory.h"
+#include "core/hle/kernel/thread.h"
 #include "core/hle/result.h"
 #include "core/hle/service/soc_u.h"
 
@@ -55,6 +58,7 @@
 #endif
 
 SERIALIZE_EXPORT_IMPL(Service::SOC::SOC_U)
+SERIALIZE_EXPORT_IMPL(Service::SOC::SOC_U::SocketCallback)
 
 namespace Service::SOC {
 
@@ -351,12 +355,168 @@ struct CTRAddrInfo {
 
 static_assert(sizeof(CTRAddrInfo) == 0x130, "Size of CTRAddrInfo is not correct");
 
+/// Interval at which the sockets of the sleeping threads are polled
+constexpr s64 SOCKET_POLL_INTERVAL_US = 1000;
+
+/// Handles a blocking request once more after its thread is woken up by PollSockets or a timeout
+class SOC_U::SocketCallback : public Kernel::HLERequestContext::WakeupCallback {
+public:
+    explicit SocketCallback(std::shared_ptr<SOC_U> soc) : soc(std::move(soc)) {}
+
+    void WakeUp(std::shared_ptr<Kernel::Thread> thread, Kernel::HLERequestContext& ctx,
+                Kernel::ThreadWakeupReason reason) override {
+        auto& waiters = soc->waiters;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                     [&](const SocketWaiter& w) { return w.thread == thread; }),
+                      waiters.end());
+
+        // The request is still in the command buffer, it is parsed again but this time the
+        // handler performs the host call right away, it won't block now that the socket is ready
+        soc->resumed_context = &ctx;
+        SCOPE_EXIT({ soc->resumed_context = nullptr; });
+        const u16 command_id = static_cast<u16>(ctx.CommandBuffer()[0] >> 16);
+        switch (command_id) {
+        case 0x04:
+            soc->Accept(ctx);
+            break;
+        case 0x06:
+            soc->Connect(ctx);
+            break;
+        case 0x07:
+            soc->RecvFromOther(ctx);
+            break;
+        case 0x08:
+            soc->RecvFrom(ctx);
+            break;
+        case 0x14:
+            soc->Poll(ctx);
+            break;
+        default:
+            UNREACHABLE_MSG("Unexpected blocking soc:U command {:#x}", command_id);
+        }
+    }
+
+private:
+    std::shared_ptr<SOC_U> soc;
+
+    SocketCallback() = default;
+
+    template <class Archive>
+    void serialize(Archive& ar, const unsigned int) {
+        ar& boost::serialization::base_object<Kernel::HLERequestContext::WakeupCallback>(*this);
+        ar& soc;
+    }
+    friend class boost::serialization::access;
+};
+
 void SOC_U::CleanupSockets() {
     for (auto sock : open_sockets)
         closesocket(sock.second.socket_fd);
     open_sockets.clear();
 }
 
+bool SOC_U::IsBlocking(u32 socket_handle) const {
+#ifdef _WIN32
+    auto iter = open_sockets.find(socket_handle);
+    return iter == open_sockets.end() || iter->second.blocking;
+#else
+    int flags = ::fcntl(socket_handle, F_GETFL, 0);
+    return flags != SOCKET_ERROR_VALUE && !(flags & O_NONBLOCK);
+#endif
+}
+
+void SOC_U::SetHostBlocking(u32 socket_handle, bool blocking) {
+#ifdef _WIN32
+    unsigned long tmp = blocking ? 0 : 1;
+    ioctlsocket(socket_handle, FIONBIO, &tmp);
+#else
+    int flags = ::fcntl(socket_handle, F_GETFL, 0);
+    if (flags == SOCKET_ERROR_VALUE)
+        return;
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    ::fcntl(socket_handle, F_SETFL, flags);
+#endif
+}
+
+bool SOC_U::SleepUntilReady(Kernel::HLERequestContext& ctx, u32 socket_handle, s16 events,
+                            const std::string& reason) {
+    if (resumed_context == &ctx || !IsBlocking(socket_handle)) {
+        return false;
+    }
+
+    pollfd fd{};
+    fd.fd = socket_handle;
+    fd.events = events;
+    s32 ret = ::poll(&fd, 1, 0);
+    if (ret != 0) {
+        // Either ready or failed, the host call reports the error in the latter case
+        return false;
+    }
+
+    SleepOnSockets(ctx, {{socket_handle, events}}, std::chrono::nanoseconds{0}, reason);
+    return true;
+}
+
+void SOC_U::SleepOnSockets(Kernel::HLERequestContext& ctx, std::vector<std::pair<u32, s16>> fds,
+                           std::chrono::nanoseconds timeout, const std::string& reason) {
+    auto soc = std::static_pointer_cast<SOC_U>(shared_from_this());
+    auto event =
+        ctx.SleepClientThread("soc:u::" + reason, timeout, std::make_shared<SocketCallback>(soc));
+    waiters.push_back({std::move(fds), ctx.ClientThread(), std::move(event)});
+
+    if (waiters.size() == 1) {
+        Core::System::GetInstance().CoreTiming().ScheduleEvent(
+            usToCycles(SOCKET_POLL_INTERVAL_US), poll_sockets_event);
+    }
+}
+
+void SOC_U::PollSockets(u64 userdata, s64 cycles_late) {
+    // Threads that were stopped while sleeping, e.g. along with their process, never wake up
+    waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                 [](const SocketWaiter& w) {
+                                     return w.thread->status != Kernel::ThreadStatus::WaitHleEvent;
+                                 }),
+                  waiters.end());
+    if (waiters.empty()) {
+        return;
+    }
+
+    std::vector<pollfd> fds;
+    for (const auto& waiter : waiters) {
+        for (const auto& [socket_handle, events] : waiter.fds) {
+            pollfd fd{};
+            fd.fd = socket_handle;
+            fd.events = events;
+            fds.push_back(fd);
+        }
+    }
+
+    s32 ret = ::poll(fds.data(), static_cast<u32>(fds.size()), 0);
+    if (ret == SOCKET_ERROR_VALUE) {
+        LOG_ERROR(Service_SOC, "Failed to poll the sockets of the waiting threads: {}", GET_ERRNO);
+    }
+
+    // Wake up the threads after the loop, their callbacks remove them from the waiters
+    std::vector<std::shared_ptr<Kernel::Event>> ready;
+    auto fd = fds.begin();
+    for (const auto& waiter : waiters) {
+        const auto end = fd + waiter.fds.size();
+        if (ret == SOCKET_ERROR_VALUE ||
+            std::any_of(fd, end, [](const pollfd& p) { return p.revents != 0; })) {
+            ready.push_back(waiter.event);
+        }
+        fd = end;
+    }
+    for (auto& event : ready) {
+        event->Signal();
+    }
+
+    if (!waiters.empty()) {
+        Core::System::GetInstance().CoreTiming().ScheduleEvent(
+            usToCycles(SOCKET_POLL_INTERVAL_US) - cycles_late, poll_sockets_event);
+    }
+}
+
 void SOC_U::Socket(Kernel::HLERequestContext& ctx) {
     IPC::RequestParser rp(ctx, 0x02, 3, 2);
     u32 domain = rp.Pop<u32>(); // Address family
@@ -500,13 +660,15 @@ void SOC_U::Listen(Kernel::HLERequestContext& ctx) {
 }
 
 void SOC_U::Accept(Kernel::HLERequestContext& ctx) {
-    // TODO(Subv): Calling this function on a blocking socket will block the emu thread,
-    // preventing graceful shutdown when closing the emulator, this can be fixed by always
-    // performing nonblocking operations and spinlock until the data is available
     IPC::RequestParser rp(ctx, 0x04, 2, 2);
     const auto socket_handle = rp.Pop<u32>();
     [[maybe_unused]] const auto max_addr_len = static_cast<socklen_t>(rp.Pop<u32>());
     rp.PopPID();
+
+    if (SleepUntilReady(ctx, socket_handle, POLLIN, "Accept")) {
+        return;
+    }
+
     sockaddr addr;
     socklen_t addr_len = sizeof(addr);
     u32 ret = static_cast<u32>(::accept(socket_handle, &addr, &addr_len));
@@ -606,6 +768,10 @@ void SOC_U::RecvFromOther(Kernel::HLERequestContext& ctx) {
     rp.PopPID();
     auto& buffer = rp.PopMappedBuffer();
 
+    if (SleepUntilReady(ctx, socket_handle, POLLIN, "RecvFromOther")) {
+        return;
+    }
+
     CTRSockAddr ctr_src_addr;
     std::vector<u8> output_buff(len);
     std::vector<u8> addr_buff(sizeof(ctr_src_addr));
@@ -640,9 +806,6 @@ void SOC_U::RecvFromOther(Kernel::HLERequestContext& ctx) {
 }
 
 void SOC_U::RecvFrom(Kernel::HLERequestContext& ctx) {
-    // TODO(Subv): Calling this function on a blocking socket will block the emu thread,
-    // preventing graceful shutdown when closing the emulator, this can be fixed by always
-    // performing nonblocking operations and spinlock until the data is available
     IPC::RequestParser rp(ctx, 0x08, 4, 2);
     u32 socket_handle = rp.Pop<u32>();
     u32 len = rp.Pop<u32>();
@@ -650,6 +813,10 @@ void SOC_U::RecvFrom(Kernel::HLERequestContext& ctx) {
     u32 addr_len = rp.Pop<u32>();
     rp.PopPID();
 
+    if (SleepUntilReady(ctx, socket_handle, POLLIN, "RecvFrom")) {
+        return;
+    }
+
     CTRSockAddr ctr_src_addr;
     std::vector<u8> output_buff(len);
     std::vector<u8> addr_buff(sizeof(ctr_src_addr));
@@ -704,7 +871,19 @@ void SOC_U::Poll(Kernel::HLERequestContext& ctx) {
     std::vector<pollfd> platform_pollfd(nfds);
     std::transform(ctr_fds.begin(), ctr_fds.end(), platform_pollfd.begin(), CTRPollFD::ToPlatform);
 
-    s32 ret = ::poll(platform_pollfd.data(), nfds, timeout);
+    // The host is only polled without waiting, a guest timeout puts the thread to sleep until
+    // the reactor finds one of the sockets ready instead of blocking the emulation thread
+    s32 ret = ::poll(platform_pollfd.data(), nfds, 0);
+    if (ret == 0 && timeout != 0 && resumed_context != &ctx) {
+        std::vector<std::pair<u32, s16>> fds;
+        for (const auto& fd : platform_pollfd) {
+            fds.emplace_back(static_cast<u32>(fd.fd), fd.events);
+        }
+        const std::chrono::nanoseconds timeout_ns =
+            timeout > 0 ? std::chrono::milliseconds{timeout} : std::chrono::nanoseconds{0};
+        SleepOnSockets(ctx, std::move(fds), timeout_ns, "Poll");
+        return;
+    }
 
     // Now update the output pollfd structure
     std::transform(platform_pollfd.begin(), platform_pollfd.end(), ctr_fds.begin(),
@@ -785,9 +964,6 @@ void SOC_U::GetPeerName(Kernel::HLERequestContext& ctx) {
 }
 
 void SOC_U::Connect(Kernel::HLERequestContext& ctx) {
-    // TODO(Subv): Calling this function on a blocking socket will block the emu thread,
-    // preventing graceful shutdown when closing the emulator, this can be fixed by always
-    // performing nonblocking operations and spinlock until the data is available
     IPC::RequestParser rp(ctx, 0x06, 2, 4);
     const auto socket_handle = rp.Pop<u32>();
     [[maybe_unused]] const auto input_addr_len = rp.Pop<u32>();
@@ -797,10 +973,38 @@ void SOC_U::Connect(Kernel::HLERequestContext& ctx) {
     CTRSockAddr ctr_input_addr;
     std::memcpy(&ctr_input_addr, input_addr_buf.data(), sizeof(ctr_input_addr));
 
-    sockaddr input_addr = CTRSockAddr::ToPlatform(ctr_input_addr);
-    s32 ret = ::connect(socket_handle, &input_addr, sizeof(input_addr));
-    if (ret != 0)
-        ret = TranslateError(GET_ERRNO);
+    s32 ret = 0;
+    if (resumed_context == &ctx) {
+        // The connection started below has completed, fetch its outcome
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        ret = ::getsockopt(socket_handle, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error),
+                           &error_len);
+        if (ret != 0) {
+            ret = TranslateError(GET_ERRNO);
+        } else if (error != 0) {
+            ret = TranslateError(error);
+        }
+    } else {
+        sockaddr input_addr = CTRSockAddr::ToPlatform(ctr_input_addr);
+        const bool blocking = IsBlocking(socket_handle);
+        // A blocking connect is started without blocking and the thread sleeps until it is done
+        if (blocking) {
+            SetHostBlocking(socket_handle, false);
+        }
+        ret = ::connect(socket_handle, &input_addr, sizeof(input_addr));
+        const int error = ret != 0 ? GET_ERRNO : 0;
+        if (blocking) {
+            SetHostBlocking(socket_handle, true);
+        }
+        if (blocking && (error == ERRNO(EINPROGRESS) || error == ERRNO(EWOULDBLOCK))) {
+            SleepOnSockets(ctx, {{socket_handle, POLLOUT}}, std::chrono::nanoseconds{0},
+                           "Connect");
+            return;
+        }
+        if (ret != 0)
+            ret = TranslateError(error);
+    }
 
     IPC::RequestBuilder rb = rp.MakeBuilder(2, 0);
     rb.Push(RESULT_SUCCESS);
@@ -1019,6 +1223,10 @@ SOC_U::SOC_U() : ServiceFramework("soc:U") {
 
     RegisterHandlers(functions);
 
+    poll_sockets_event = Core::System::GetInstance().CoreTiming().RegisterEvent(
+        "SOC_U::PollSockets",
+        [this](u64 userdata, s64 cycles_late) { PollSockets(userdata, cycles_late); });
+
 #ifdef _WIN32
     WSADATA data;
     WSAStartup(MAKEWORD(2, 2), &data);
@@ -4,13 +4,26 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <unordered_map>
+#include <utility>
+#include <vector>
+#include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/unordered_map.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
 #include "core/hle/service/service.h"
 
 namespace Core {
 class System;
-}
+struct TimingEventType;
+} // namespace Core
+
+namespace Kernel {
+class Event;
+class Thread;
+} // namespace Kernel
 
 namespace Service::SOC {
 
@@ -33,6 +46,8 @@ public:
     SOC_U();
     ~SOC_U();
 
+    class SocketCallback;
+
 private:
     void Socket(Kernel::HLERequestContext& ctx);
     void Bind(Kernel::HLERequestContext& ctx);
@@ -62,13 +77,61 @@ private:
     /// Close all open sockets
     void CleanupSockets();
 
+    /// Returns whether calls on the socket should block the guest until they can complete
+    bool IsBlocking(u32 socket_handle) const;
+
+    /// Switches the host socket between blocking and non-blocking mode
+    void SetHostBlocking(u32 socket_handle, bool blocking);
+
+    /**
+     * Checks whether a blocking guest call on the socket would have to wait. If it would, the
+     * client thread is put to sleep until the socket becomes ready and the request is handled
+     * again once it wakes up, so that the emulation thread never blocks on the host socket.
+     * @param events Platform poll events that the call waits for
+     * @returns true if the thread was put to sleep, in which case the caller must not reply
+     */
+    bool SleepUntilReady(Kernel::HLERequestContext& ctx, u32 socket_handle, s16 events,
+                         const std::string& reason);
+
+    /// Puts the client thread to sleep until one of the sockets is ready or the timeout expires
+    void SleepOnSockets(Kernel::HLERequestContext& ctx, std::vector<std::pair<u32, s16>> fds,
+                        std::chrono::nanoseconds timeout, const std::string& reason);
+
+    /// Polls the sockets of all the sleeping threads at once and wakes up those that are ready
+    void PollSockets(u64 userdata, s64 cycles_late);
+
+    /// A guest thread sleeping until one of its host sockets becomes ready
+    struct SocketWaiter {
+        std::vector<std::pair<u32, s16>> fds; ///< Sockets and the platform poll events
+        std::shared_ptr<Kernel::Thread> thread;
+        std::shared_ptr<Kernel::Event> event; ///< Signaled to wake up the thread
+
+    private:
+        template <class Archive>
+        void serialize(Archive& ar, const unsigned int) {
+            ar& fds;
+            ar& thread;
+            ar& event;
+        }
+        friend class boost::serialization::access;
+    };
+
     /// Holds info about the currently open sockets
     std::unordered_map<u32, SocketHolder> open_sockets;
 
+    /// Threads waiting on sockets, polled together by the poll_sockets_event
+    std::vector<SocketWaiter> waiters;
+
+    Core::TimingEventType* poll_sockets_event = nullptr;
+
+    /// Context of the request being handled again after its thread woke up, it never sleeps
+    Kernel::HLERequestContext* resumed_context = nullptr;
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
         ar& boost::serialization::base_object<Kernel::SessionRequestHandler>(*this);
         ar& open_sockets;
+        ar& waiters;
     }
     friend class boost::serialization::access;
 };
@@ -78,3 +141,4 @@ void InstallInterfaces(Core::System& system);
 } // namespace Service::SOC
 
 BOOST_CLASS_EXPORT_KEY(Service::SOC::SOC_U)
+BOOST_CLASS_EXPORT_KEY(Service::SOC::SOC_U::SocketCallback)
@@ -0,0 +1,60 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
+#include "core/hw/aes/cipher.h"
+
+namespace HW::AES {
+
+// The external cipher modes borrow a block cipher that was keyed once, instead of expanding the key
+// every time a mode object is created. Crypto++ picks AES-NI or the ARMv8 crypto extensions for
+// the block cipher at runtime.
+
+struct CTRCipher::Impl {
+    CryptoPP::AES::Encryption aes;
+    AESKey ctr;
+};
+
+CTRCipher::CTRCipher(const AESKey& key, const AESKey& ctr) : impl(std::make_unique<Impl>()) {
+    impl->aes.SetKey(key.data(), key.size());
+    impl->ctr = ctr;
+}
+
+CTRCipher::~CTRCipher() = default;
+CTRCipher::CTRCipher(CTRCipher&&) noexcept = default;
+CTRCipher& CTRCipher::operator=(CTRCipher&&) noexcept = default;
+
+void CTRCipher::Process(u64 offset, const u8* in, u8* out, std::size_t length) const {
+    if (length == 0) {
+        return; // Crypto++ does not like zero size buffer
+    }
+    // The mode only holds the counter, it is cheap to create for every call
+    CryptoPP::CTR_Mode_ExternalCipher::Encryption mode(impl->aes, impl->ctr.data());
+    mode.Seek(offset);
+    mode.ProcessData(out, in, length);
+}
+
+struct CBCDecryptor::Impl {
+    Impl(const AESKey& key, const AESKey& iv) : aes(key.data(), key.size()), mode(aes, iv.data()) {}
+
+    CryptoPP::AES::Decryption aes;
+    CryptoPP::CBC_Mode_ExternalCipher::Decryption mode;
+};
+
+CBCDecryptor::CBCDecryptor(const AESKey& key, const AESKey& iv)
+    : impl(std::make_unique<Impl>(key, iv)) {}
+
+CBCDecryptor::~CBCDecryptor() = default;
+CBCDecryptor::CBCDecryptor(CBCDecryptor&&) noexcept = default;
+CBCDecryptor& CBCDecryptor::operator=(CBCDecryptor&&) noexcept = default;
+
+void CBCDecryptor::Process(const u8* in, u8* out, std::size_t length) {
+    if (length == 0) {
+        return;
+    }
+    impl->mode.ProcessData(out, in, length);
+}
+
+} // namespace HW::AES
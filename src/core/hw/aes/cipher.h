@@ -0,0 +1,61 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "common/common_types.h"
+#include "core/hw/aes/key.h"
+
+namespace HW::AES {
+
+/**
+ * AES-CTR with the key schedule expanded once. The keystream can be applied at any offset from
+ * the initial counter, from several threads at once. The block cipher uses the AES instructions of
+ * the host CPU when it has them.
+ */
+class CTRCipher {
+public:
+    CTRCipher(const AESKey& key, const AESKey& ctr);
+    ~CTRCipher();
+
+    CTRCipher(CTRCipher&&) noexcept;
+    CTRCipher& operator=(CTRCipher&&) noexcept;
+
+    /**
+     * Encrypts or decrypts data, which are the same operation in CTR mode.
+     * @param offset The offset in bytes of the data from the start of the stream
+     * @param in The data to process
+     * @param out Where the processed data is written to, which may be the same as in
+     * @param length The size of the data in bytes
+     */
+    void Process(u64 offset, const u8* in, u8* out, std::size_t length) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/**
+ * AES-CBC decryption with the key schedule expanded once. The chaining state is kept between
+ * calls, so a stream can be decrypted in parts of any multiple of the block size.
+ */
+class CBCDecryptor {
+public:
+    CBCDecryptor(const AESKey& key, const AESKey& iv);
+    ~CBCDecryptor();
+
+    CBCDecryptor(CBCDecryptor&&) noexcept;
+    CBCDecryptor& operator=(CBCDecryptor&&) noexcept;
+
+    /// Decrypts the next part of the stream. out may be the same as in.
+    void Process(const u8* in, u8* out, std::size_t length);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace HW::AES
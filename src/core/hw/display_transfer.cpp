@@ -0,0 +1,240 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+#include "common/color.h"
+#include "common/logging/log.h"
+#include "common/task_scheduler.h"
+#include "common/vector_math.h"
+#include "core/hw/display_transfer.h"
+#include "video_core/utils.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+namespace GPU {
+
+using PixelFormat = Regs::PixelFormat;
+using ScalingMode = Regs::DisplayTransferConfig::ScalingMode;
+
+/// Transfers with fewer output pixels than this are done on the GPU thread alone
+constexpr u32 MIN_PARALLEL_PIXEL_COUNT = 0x8000;
+
+template <PixelFormat Format>
+constexpr u32 BytesPerPixel = Format == PixelFormat::RGBA8  ? 4
+                              : Format == PixelFormat::RGB8 ? 3
+                                                            : 2;
+
+template <PixelFormat Format>
+static Common::Vec4<u8> DecodePixel(const u8* src_pixel) {
+    if constexpr (Format == PixelFormat::RGBA8) {
+        return Color::DecodeRGBA8(src_pixel);
+    } else if constexpr (Format == PixelFormat::RGB8) {
+        return Color::DecodeRGB8(src_pixel);
+    } else if constexpr (Format == PixelFormat::RGB565) {
+        return Color::DecodeRGB565(src_pixel);
+    } else if constexpr (Format == PixelFormat::RGB5A1) {
+        return Color::DecodeRGB5A1(src_pixel);
+    } else {
+        return Color::DecodeRGBA4(src_pixel);
+    }
+}
+
+template <PixelFormat Format>
+static void EncodePixel(const Common::Vec4<u8>& color, u8* dst_pixel) {
+    if constexpr (Format == PixelFormat::RGBA8) {
+        Color::EncodeRGBA8(color, dst_pixel);
+    } else if constexpr (Format == PixelFormat::RGB8) {
+        Color::EncodeRGB8(color, dst_pixel);
+    } else if constexpr (Format == PixelFormat::RGB565) {
+        Color::EncodeRGB565(color, dst_pixel);
+    } else if constexpr (Format == PixelFormat::RGB5A1) {
+        Color::EncodeRGB5A1(color, dst_pixel);
+    } else {
+        Color::EncodeRGBA4(color, dst_pixel);
+    }
+}
+
+/**
+ * Box filters the two (ScaleX) or four (ScaleXY) input pixels of an output pixel, which are
+ * consecutive in the tiled input.
+ */
+template <PixelFormat Format, ScalingMode Scaling>
+static Common::Vec4<u8> FilterPixels(const u8* src_pixel) {
+    constexpr u32 bpp = BytesPerPixel<Format>;
+#ifdef ARCHITECTURE_x86_64
+    if constexpr (Format == PixelFormat::RGBA8) {
+        // Averaging the channels doesn't depend on their order, so it's done on the raw pixels
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum;
+        if constexpr (Scaling == ScalingMode::ScaleX) {
+            const __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src_pixel));
+            const __m128i wide = _mm_unpacklo_epi8(pixels, zero);
+            sum = _mm_srli_epi16(_mm_add_epi16(wide, _mm_srli_si128(wide, 8)), 1);
+        } else {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_pixel));
+            const __m128i pairs =
+                _mm_add_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero));
+            sum = _mm_srli_epi16(_mm_add_epi16(pairs, _mm_srli_si128(pairs, 8)), 2);
+        }
+        const u32 raw = static_cast<u32>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, zero)));
+        u8 bytes[4];
+        std::memcpy(bytes, &raw, sizeof(bytes));
+        return Color::DecodeRGBA8(bytes);
+    }
+#endif
+    const Common::Vec4<u8> pixel0 = DecodePixel<Format>(src_pixel);
+    if constexpr (Scaling == ScalingMode::ScaleX) {
+        const Common::Vec4<u8> pixel1 = DecodePixel<Format>(src_pixel + bpp);
+        return ((pixel0 + pixel1) / 2).template Cast<u8>();
+    } else {
+        const Common::Vec4<u8> pixel1 = DecodePixel<Format>(src_pixel + 1 * bpp);
+        const Common::Vec4<u8> pixel2 = DecodePixel<Format>(src_pixel + 2 * bpp);
+        const Common::Vec4<u8> pixel3 = DecodePixel<Format>(src_pixel + 3 * bpp);
+        return (((pixel0 + pixel1) + (pixel2 + pixel3)) / 4).template Cast<u8>();
+    }
+}
+
+/// Offsets of the pixels of an image row, relative to the offset of the row
+static std::vector<u32> GetColumnOffsets(u32 width, u32 scale, bool tiled, u32 bytes_per_pixel) {
+    std::vector<u32> offsets(width);
+    for (u32 x = 0; x < width; ++x) {
+        const u32 column = x << scale;
+        offsets[x] = tiled ? VideoCore::GetMortonOffset(column, 0, bytes_per_pixel) :
+                           column * bytes_per_pixel;
+    }
+    return offsets;
+}
+
+/// Offset of an image row, where the row is the y coordinate of the pixels on it
+static u32 GetRowOffset(u32 row, u32 width, bool tiled, u32 bytes_per_pixel) {
+    if (!tiled) {
+        return row * width * bytes_per_pixel;
+    }
+    return VideoCore::GetMortonOffset(0, row, bytes_per_pixel) +
+           (row & ~7) * width * bytes_per_pixel;
+}
+
+template <PixelFormat InputFormat, PixelFormat OutputFormat, ScalingMode Scaling>
+static void TransferImage(const Regs::DisplayTransferConfig& config, const u8* src, u8* dst) {
+    constexpr u32 src_bpp = BytesPerPixel<InputFormat>;
+    constexpr u32 dst_bpp = BytesPerPixel<OutputFormat>;
+    constexpr u32 horizontal_scale = Scaling != ScalingMode::NoScale ? 1 : 0;
+    constexpr u32 vertical_scale = Scaling == ScalingMode::ScaleXY ? 1 : 0;
+
+    const u32 input_width = config.input_width;
+    const u32 output_width = config.output_width >> horizontal_scale;
+    const u32 output_height = config.output_height >> vertical_scale;
+    const bool flip = config.flip_vertically;
+
+    // Tiled input becomes linear output and the other way around, unless swizzling is disabled
+    const bool src_tiled = !config.input_linear;
+    const bool dst_tiled = config.input_linear != config.dont_swizzle;
+
+    const std::vector<u32> src_columns =
+        GetColumnOffsets(output_width, horizontal_scale, src_tiled, src_bpp);
+    const std::vector<u32> dst_columns = GetColumnOffsets(output_width, 0, dst_tiled, dst_bpp);
+
+    const auto transfer_rows = [&](std::size_t begin, std::size_t end) {
+        for (u32 y = static_cast<u32>(begin); y < end; ++y) {
+            // The output row is flipped after the input row is found, to account for the scaling
+            const u32 output_y = flip ? output_height - y - 1 : y;
+            const u8* src_row =
+                src + GetRowOffset(y << vertical_scale, input_width, src_tiled, src_bpp);
+            u8* dst_row = dst + GetRowOffset(output_y, output_width, dst_tiled, dst_bpp);
+
+            if constexpr (InputFormat == OutputFormat && Scaling == ScalingMode::NoScale) {
+                // Converting a pixel to its own format gives back the same bits
+                if (!src_tiled && !dst_tiled) {
+                    std::memcpy(dst_row, src_row, output_width * dst_bpp);
+                    continue;
+                }
+                for (u32 x = 0; x < output_width; ++x) {
+                    std::memcpy(dst_row + dst_columns[x], src_row + src_columns[x], dst_bpp);
+                }
+            } else {
+                for (u32 x = 0; x < output_width; ++x) {
+                    const u8* src_pixel = src_row + src_columns[x];
+                    Common::Vec4<u8> color;
+                    if constexpr (Scaling == ScalingMode::NoScale) {
+                        color = DecodePixel<InputFormat>(src_pixel);
+                    } else {
+                        color = FilterPixels<InputFormat, Scaling>(src_pixel);
+                    }
+                    EncodePixel<OutputFormat>(color, dst_row + dst_columns[x]);
+                }
+            }
+        }
+    };
+
+    if (output_width * output_height < MIN_PARALLEL_PIXEL_COUNT) {
+        transfer_rows(0, output_height);
+        return;
+    }
+    // The rows are independent, even the ones sharing tiles write separate bytes
+    Common::TaskScheduler::GetInstance().ParallelFor(
+        output_height, std::max(MIN_PARALLEL_PIXEL_COUNT / output_width, 1u), transfer_rows);
+}
+
+using TransferFunction = void (*)(const Regs::DisplayTransferConfig&, const u8*, u8*);
+
+template <PixelFormat InputFormat, PixelFormat OutputFormat>
+static constexpr std::array<TransferFunction, 3> ScalingFunctions{
+    &TransferImage<InputFormat, OutputFormat, ScalingMode::NoScale>,
+    &TransferImage<InputFormat, OutputFormat, ScalingMode::ScaleX>,
+    &TransferImage<InputFormat, OutputFormat, ScalingMode::ScaleXY>,
+};
+
+template <PixelFormat InputFormat>
+static TransferFunction GetTransferFunction(PixelFormat output_format, ScalingMode scaling) {
+    switch (output_format) {
+    case PixelFormat::RGBA8:
+        return ScalingFunctions<InputFormat, PixelFormat::RGBA8>[scaling];
+    case PixelFormat::RGB8:
+        return ScalingFunctions<InputFormat, PixelFormat::RGB8>[scaling];
+    case PixelFormat::RGB565:
+        return ScalingFunctions<InputFormat, PixelFormat::RGB565>[scaling];
+    case PixelFormat::RGB5A1:
+        return ScalingFunctions<InputFormat, PixelFormat::RGB5A1>[scaling];
+    case PixelFormat::RGBA4:
+        return ScalingFunctions<InputFormat, PixelFormat::RGBA4>[scaling];
+    default:
+        LOG_ERROR(HW_GPU, "Unknown destination framebuffer format {:x}",
+                  static_cast<u32>(output_format));
+        return nullptr;
+    }
+}
+
+static TransferFunction GetTransferFunction(PixelFormat input_format, PixelFormat output_format,
+                                            ScalingMode scaling) {
+    switch (input_format) {
+    case PixelFormat::RGBA8:
+        return GetTransferFunction<PixelFormat::RGBA8>(output_format, scaling);
+    case PixelFormat::RGB8:
+        return GetTransferFunction<PixelFormat::RGB8>(output_format, scaling);
+    case PixelFormat::RGB565:
+        return GetTransferFunction<PixelFormat::RGB565>(output_format, scaling);
+    case PixelFormat::RGB5A1:
+        return GetTransferFunction<PixelFormat::RGB5A1>(output_format, scaling);
+    case PixelFormat::RGBA4:
+        return GetTransferFunction<PixelFormat::RGBA4>(output_format, scaling);
+    default:
+        LOG_ERROR(HW_GPU, "Unknown source framebuffer format {:x}", static_cast<u32>(input_format));
+        return nullptr;
+    }
+}
+
+void SoftwareDisplayTransfer(const Regs::DisplayTransferConfig& config, const u8* src, u8* dst) {
+    const TransferFunction transfer =
+        GetTransferFunction(config.input_format, config.output_format, config.scaling);
+    if (transfer != nullptr) {
+        transfer(config, src, dst);
+    }
+}
+
+} // namespace GPU
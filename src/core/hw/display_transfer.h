@@ -0,0 +1,24 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+#include "core/hw/gpu.h"
+
+namespace GPU {
+
+/**
+ * Performs a display transfer in software, converting the pixels between the formats and layouts
+ * of the configuration and downscaling them as requested. Large transfers are split across worker
+ * threads.
+ * The configuration has to be validated by the caller, including that its scaling mode is
+ * supported, and the buffers have to hold the whole input and output images.
+ * @param config Configuration of the transfer
+ * @param src Input image
+ * @param dst Output image
+ */
+void SoftwareDisplayTransfer(const Regs::DisplayTransferConfig& config, const u8* src, u8* dst);
+
+} // namespace GPU
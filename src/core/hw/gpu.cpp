@@ -6,23 +6,23 @@
 #include <numeric>
 #include <type_traits>
 #include "common/alignment.h"
-#include "common/color.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
-#include "common/vector_math.h"
 #include "core/core.h"
 #include "core/core_timing.h"
 #include "core/hle/service/gsp/gsp.h"
+#include "core/hw/display_transfer.h"
 #include "core/hw/gpu.h"
 #include "core/hw/hw.h"
 #include "core/memory.h"
+#include "core/settings.h"
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/rasterizer_interface.h"
 #include "video_core/renderer_base.h"
-#include "video_core/utils.h"
 #include "video_core/video_core.h"
 
 namespace GPU {
@@ -32,6 +32,11 @@ Memory::MemorySystem* g_memory;
 
 /// Event id for CoreTiming
 static Core::TimingEventType* vblank_event;
+/// Event id for CoreTiming, picks up the interrupts raised on the GPU thread
+static Core::TimingEventType* gpu_thread_event;
+
+/// Interval at which the interrupts raised on the GPU thread are signaled
+constexpr u64 gpu_thread_poll_ticks = BASE_CLOCK_RATE_ARM11 / 4000;
 
 template <typename T>
 inline void Read(T& var, const u32 raw_addr) {
@@ -47,29 +52,6 @@ inline void Read(T& var, const u32 raw_addr) {
     var = g_regs[addr / 4];
 }
 
-static Common::Vec4<u8> DecodePixel(Regs::PixelFormat input_format, const u8* src_pixel) {
-    switch (input_format) {
-    case Regs::PixelFormat::RGBA8:
-        return Color::DecodeRGBA8(src_pixel);
-
-    case Regs::PixelFormat::RGB8:
-        return Color::DecodeRGB8(src_pixel);
-
-    case Regs::PixelFormat::RGB565:
-        return Color::DecodeRGB565(src_pixel);
-
-    case Regs::PixelFormat::RGB5A1:
-        return Color::DecodeRGB5A1(src_pixel);
-
-    case Regs::PixelFormat::RGBA4:
-        return Color::DecodeRGBA4(src_pixel);
-
-    default:
-        LOG_ERROR(HW_GPU, "Unknown source framebuffer format {:x}", static_cast<u32>(input_format));
-        return {0, 0, 0, 0};
-    }
-}
-
 MICROPROFILE_DEFINE(GPU_DisplayTransfer, "GPU", "DisplayTransfer", MP_RGB(100, 100, 255));
 MICROPROFILE_DEFINE(GPU_CmdlistProcessing, "GPU", "Cmdlist Processing", MP_RGB(100, 255, 100));
 
@@ -193,113 +175,46 @@ static void DisplayTransfer(const Regs::DisplayTransferConfig& config) {
     Memory::RasterizerFlushRegion(config.GetPhysicalInputAddress(), input_size);
     Memory::RasterizerInvalidateRegion(config.GetPhysicalOutputAddress(), output_size);
 
-    for (u32 y = 0; y < output_height; ++y) {
-        for (u32 x = 0; x < output_width; ++x) {
-            Common::Vec4<u8> src_color;
-
-            // Calculate the [x,y] position of the input image
-            // based on the current output position and the scale
-            u32 input_x = x << horizontal_scale;
-            u32 input_y = y << vertical_scale;
-
-            u32 output_y;
-            if (config.flip_vertically) {
-                // Flip the y value of the output data,
-                // we do this after calculating the [x,y] position of the input image
-                // to account for the scaling options.
-                output_y = output_height - y - 1;
-            } else {
-                output_y = y;
-            }
-
-            u32 dst_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.output_format);
-            u32 src_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.input_format);
-            u32 src_offset;
-            u32 dst_offset;
-
-            if (config.input_linear) {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as linear and the output as tiled
-                    u32 coarse_y = output_y & ~7;
-                    u32 stride = output_width * dst_bytes_per_pixel;
-
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 coarse_y * stride;
-                } else {
-                    // Both input and output are linear
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                }
-            } else {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as tiled and the output as linear
-                    u32 coarse_y = input_y & ~7;
-                    u32 stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 coarse_y * stride;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                } else {
-                    // Both input and output are tiled
-                    u32 out_coarse_y = output_y & ~7;
-                    u32 out_stride = output_width * dst_bytes_per_pixel;
-
-                    u32 in_coarse_y = input_y & ~7;
-                    u32 in_stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 in_coarse_y * in_stride;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 out_coarse_y * out_stride;
-                }
-            }
-
-            const u8* src_pixel = src_pointer + src_offset;
-            src_color = DecodePixel(config.input_format, src_pixel);
-            if (config.scaling == config.ScaleX) {
-                Common::Vec4<u8> pixel =
-                    DecodePixel(config.input_format, src_pixel + src_bytes_per_pixel);
-                src_color = ((src_color + pixel) / 2).Cast<u8>();
-            } else if (config.scaling == config.ScaleXY) {
-                Common::Vec4<u8> pixel1 =
-                    DecodePixel(config.input_format, src_pixel + 1 * src_bytes_per_pixel);
-                Common::Vec4<u8> pixel2 =
-                    DecodePixel(config.input_format, src_pixel + 2 * src_bytes_per_pixel);
-                Common::Vec4<u8> pixel3 =
-                    DecodePixel(config.input_format, src_pixel + 3 * src_bytes_per_pixel);
-                src_color = (((src_color + pixel1) + (pixel2 + pixel3)) / 4).Cast<u8>();
-            }
-
-            u8* dst_pixel = dst_pointer + dst_offset;
-            switch (config.output_format) {
-            case Regs::PixelFormat::RGBA8:
-                Color::EncodeRGBA8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB8:
-                Color::EncodeRGB8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB565:
-                Color::EncodeRGB565(src_color, dst_pixel);
-                break;
+    SoftwareDisplayTransfer(config, src_pointer, dst_pointer);
+}
 
-            case Regs::PixelFormat::RGB5A1:
-                Color::EncodeRGB5A1(src_color, dst_pixel);
-                break;
+static void TextureCopy(const Regs::DisplayTransferConfig& config);
+
+/**
+ * Copies the whole lines of a texture copy ending inside a line on the GPU, as the rasterizer only
+ * copies whole lines, and then the rest of it.
+ * @returns false if the lines couldn't be copied on the GPU, leaving the whole copy to be done
+ */
+static bool SplitTextureCopy(const Regs::DisplayTransferConfig& config) {
+    const u32 size = Common::AlignDown(config.texture_copy.size, 16);
+    const u32 input_gap = config.texture_copy.input_gap * 16;
+    const u32 output_gap = config.texture_copy.output_gap * 16;
+    // Without a gap the whole copy is a single line
+    const u32 input_width = input_gap == 0 ? size : config.texture_copy.input_width * 16;
+    const u32 output_width = output_gap == 0 ? size : config.texture_copy.output_width * 16;
+    if (input_width == 0 || output_width == 0) {
+        return false;
+    }
 
-            case Regs::PixelFormat::RGBA4:
-                Color::EncodeRGBA4(src_color, dst_pixel);
-                break;
+    // The lines copied on the GPU have to end on a line of both the input and the output
+    const u32 lines_size = size - size % std::lcm(input_width, output_width);
+    if (lines_size == 0 || lines_size == size) {
+        return false;
+    }
 
-            default:
-                LOG_ERROR(HW_GPU, "Unknown destination framebuffer format {:x}",
-                          static_cast<u32>(config.output_format.Value()));
-                break;
-            }
-        }
+    Regs::DisplayTransferConfig lines = config;
+    lines.texture_copy.size = lines_size;
+    if (!VideoCore::g_renderer->Rasterizer()->AccelerateTextureCopy(lines)) {
+        return false;
     }
+
+    // The addresses are stored in units of 8 bytes, which the widths and gaps are multiples of
+    Regs::DisplayTransferConfig rest = config;
+    rest.texture_copy.size = size - lines_size;
+    rest.input_address += lines_size / input_width * (input_width + input_gap) / 8;
+    rest.output_address += lines_size / output_width * (output_width + output_gap) / 8;
+    TextureCopy(rest);
+    return true;
 }
 
 static void TextureCopy(const Regs::DisplayTransferConfig& config) {
@@ -317,7 +232,8 @@ static void TextureCopy(const Regs::DisplayTransferConfig& config) {
         return;
     }
 
-    if (VideoCore::g_renderer->Rasterizer()->AccelerateTextureCopy(config))
+    if (VideoCore::g_renderer->Rasterizer()->AccelerateTextureCopy(config) ||
+        SplitTextureCopy(config))
         return;
 
     u8* src_pointer = g_memory->GetPhysicalPointer(src_addr);
@@ -406,7 +322,7 @@ inline void Write(u32 addr, const T data) {
         auto& config = g_regs.memory_fill_config[is_second_filler];
 
         if (config.trigger) {
-            MemoryFill(config);
+            VideoCore::RunOnGPUThread([&config] { MemoryFill(config); });
             LOG_TRACE(HW_GPU, "MemoryFill from {:#010X} to {:#010X}", config.GetStartAddress(),
                       config.GetEndAddress());
 
@@ -434,12 +350,12 @@ inline void Write(u32 addr, const T data) {
         const auto& config = g_regs.display_transfer_config;
         if (config.trigger & 1) {
 
-            if (Pica::g_debug_context)
-                Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::IncomingDisplayTransfer,
-                                               nullptr);
+            if (Pica::DebugContext* debug_context = Pica::GetAttachedDebugContext())
+                debug_context->OnEvent(Pica::DebugContext::Event::IncomingDisplayTransfer,
+                                       nullptr);
 
             if (config.is_texture_copy) {
-                TextureCopy(config);
+                VideoCore::RunOnGPUThread([&config] { TextureCopy(config); });
                 LOG_TRACE(HW_GPU,
                           "TextureCopy: {:#X} bytes from {:#010X}({}+{})-> "
                           "{:#010X}({}+{}), flags {:#010X}",
@@ -448,7 +364,7 @@ inline void Write(u32 addr, const T data) {
                           config.GetPhysicalOutputAddress(), config.texture_copy.output_width * 16,
                           config.texture_copy.output_gap * 16, config.flags);
             } else {
-                DisplayTransfer(config);
+                VideoCore::RunOnGPUThread([&config] { DisplayTransfer(config); });
                 LOG_TRACE(HW_GPU,
                           "DisplayTransfer: {:#010X}({}x{})-> "
                           "{:#010X}({}x{}), dst format {:x}, flags {:#010X}",
@@ -468,9 +384,12 @@ inline void Write(u32 addr, const T data) {
     case GPU_REG_INDEX(command_processor_config.trigger): {
         const auto& config = g_regs.command_processor_config;
         if (config.trigger & 1) {
-            MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
-
-            Pica::CommandProcessor::ProcessCommandList(config.GetPhysicalAddress(), config.size);
+            const PAddr list_address = config.GetPhysicalAddress();
+            const u32 list_size = config.size;
+            VideoCore::QueueOnGPUThread([list_address, list_size] {
+                MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
+                Pica::CommandProcessor::ProcessCommandList(list_address, list_size);
+            });
 
             g_regs.command_processor_config.trigger = 0;
         }
@@ -483,9 +402,10 @@ inline void Write(u32 addr, const T data) {
 
     // Notify tracer about the register write
     // This is happening *after* handling the write to make sure we properly catch all memory reads.
-    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
+    Pica::DebugContext* const debug_context = Pica::GetAttachedDebugContext();
+    if (debug_context && debug_context->recorder) {
         // addr + GPU VBase - IO VBase + IO PBase
-        Pica::g_debug_context->recorder->RegisterWritten<T>(
+        debug_context->recorder->RegisterWritten<T>(
             addr + 0x1EF00000 - 0x1EC00000 + 0x10100000, data);
     }
 }
@@ -504,7 +424,15 @@ template void Write<u8>(u32 addr, const u8 data);
 
 /// Update hardware
 static void VBlankCallback(u64 userdata, s64 cycles_late) {
-    VideoCore::g_renderer->SwapBuffers();
+    // The frame is presented with the work of the frame finished
+    const bool shown = Core::System::GetInstance().NotifyVBlank();
+    VideoCore::RunOnGPUThread([shown] {
+        VideoCore::g_renderer->SetFrameShown(shown);
+        VideoCore::g_renderer->SwapBuffers();
+    });
+    if (VideoCore::g_gpu_thread) {
+        VideoCore::g_gpu_thread->SignalPendingInterrupts();
+    }
 
     // Signal to GSP that GPU interrupt has occurred
     // TODO(yuriks): hwtest to determine if PDC0 is for the Top screen and PDC1 for the Sub
@@ -518,6 +446,14 @@ static void VBlankCallback(u64 userdata, s64 cycles_late) {
     Core::System::GetInstance().CoreTiming().ScheduleEvent(frame_ticks - cycles_late, vblank_event);
 }
 
+static void GPUThreadCallback(u64 userdata, s64 cycles_late) {
+    if (VideoCore::g_gpu_thread) {
+        VideoCore::g_gpu_thread->SignalPendingInterrupts();
+    }
+    Core::System::GetInstance().CoreTiming().ScheduleEvent(gpu_thread_poll_ticks - cycles_late,
+                                                           gpu_thread_event);
+}
+
 /// Initialize hardware
 void Init(Memory::MemorySystem& memory) {
     g_memory = &memory;
@@ -552,6 +488,10 @@ void Init(Memory::MemorySystem& memory) {
     Core::Timing& timing = Core::System::GetInstance().CoreTiming();
     vblank_event = timing.RegisterEvent("GPU::VBlankCallback", VBlankCallback);
     timing.ScheduleEvent(frame_ticks, vblank_event);
+    gpu_thread_event = timing.RegisterEvent("GPU::GPUThreadCallback", GPUThreadCallback);
+    if (Settings::values.use_gpu_thread) {
+        timing.ScheduleEvent(gpu_thread_poll_ticks, gpu_thread_event);
+    }
 
     LOG_DEBUG(HW_GPU, "initialized OK");
 }
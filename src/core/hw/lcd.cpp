@@ -43,9 +43,10 @@ inline void Write(u32 addr, const T data) {
 
     // Notify tracer about the register write
     // This is happening *after* handling the write to make sure we properly catch all memory reads.
-    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
+    Pica::DebugContext* const debug_context = Pica::GetAttachedDebugContext();
+    if (debug_context && debug_context->recorder) {
         // addr + GPU VBase - IO VBase + IO PBase
-        Pica::g_debug_context->recorder->RegisterWritten<T>(
+        debug_context->recorder->RegisterWritten<T>(
             addr + HW::VADDR_LCD - 0x1EC00000 + 0x10100000, data);
     }
 }
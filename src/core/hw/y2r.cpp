@@ -5,7 +5,11 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstring>
 #include <memory>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "common/assert.h"
 #include "common/color.h"
 #include "common/common_types.h"
@@ -23,55 +27,124 @@ static const std::size_t MAX_TILES = 1024 / 8;
 static const std::size_t TILE_SIZE = 8 * 8;
 using ImageTile = std::array<u32, TILE_SIZE>;
 
+/// Decodes the Y, U and V values of every pixel of one line of a strip from the source format.
+static void DecodeYUVLine(InputFormat input_format, const u8* input_Y, const u8* input_U,
+                          const u8* input_V, unsigned int y, unsigned int width, s16* line_Y,
+                          s16* line_U, s16* line_V) {
+    switch (input_format) {
+    case InputFormat::YUV422_Indiv8:
+    case InputFormat::YUV422_Indiv16:
+        for (unsigned int x = 0; x < width; ++x) {
+            line_Y[x] = input_Y[y * width + x];
+            line_U[x] = input_U[(y * width + x) / 2];
+            line_V[x] = input_V[(y * width + x) / 2];
+        }
+        break;
+    case InputFormat::YUV420_Indiv8:
+    case InputFormat::YUV420_Indiv16:
+        for (unsigned int x = 0; x < width; ++x) {
+            line_Y[x] = input_Y[y * width + x];
+            line_U[x] = input_U[((y / 2) * width + x) / 2];
+            line_V[x] = input_V[((y / 2) * width + x) / 2];
+        }
+        break;
+    case InputFormat::YUYV422_Interleaved:
+        for (unsigned int x = 0; x < width; ++x) {
+            line_Y[x] = input_Y[(y * width + x) * 2];
+            line_U[x] = input_Y[(y * width + (x / 2) * 2) * 2 + 1];
+            line_V[x] = input_Y[(y * width + (x / 2) * 2) * 2 + 3];
+        }
+        break;
+    }
+}
+
+/// Converts 8 YUV pixels to RGB32, which make up one line of an 8x8 tile.
+static void ConvertYUVToRGBLine(const s16* line_Y, const s16* line_U, const s16* line_V, u32* out,
+                                const CoefficientSet& coefficients) {
+    // This conversion process is bit-exact with hardware, as far as could be tested.
+    auto& c = coefficients;
+    const s32 rounding_offset = 0x18;
+#ifdef ARCHITECTURE_x86_64
+    // The products are formed with pmaddwd on (Y, V) and (Y, U) pairs. The chroma is negated
+    // instead of the coefficients for green so that any s16 coefficient stays representable.
+    const __m128i Y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line_Y));
+    const __m128i U = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line_U));
+    const __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line_V));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i neg_U = _mm_sub_epi16(zero, U);
+    const __m128i neg_V = _mm_sub_epi16(zero, V);
+
+    const auto pair = [](s16 low, s16 high) {
+        return _mm_set1_epi32(static_cast<s32>(static_cast<u16>(low) |
+                                               (static_cast<u32>(static_cast<u16>(high)) << 16)));
+    };
+    const __m128i coef_r = pair(c[0], c[1]);
+    const __m128i coef_g = pair(c[0], c[2]);
+    const __m128i coef_gu = pair(c[3], 0);
+    const __m128i coef_b = pair(c[0], c[4]);
+    const __m128i offset_r = _mm_set1_epi32(c[5] + rounding_offset);
+    const __m128i offset_g = _mm_set1_epi32(c[6] + rounding_offset);
+    const __m128i offset_b = _mm_set1_epi32(c[7] + rounding_offset);
+
+    const auto convert = [&](__m128i YV, __m128i YnV, __m128i nU0, __m128i YU, __m128i& r,
+                             __m128i& g, __m128i& b) {
+        r = _mm_madd_epi16(YV, coef_r);
+        g = _mm_add_epi32(_mm_madd_epi16(YnV, coef_g), _mm_madd_epi16(nU0, coef_gu));
+        b = _mm_madd_epi16(YU, coef_b);
+        r = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(r, 3), offset_r), 5);
+        g = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(g, 3), offset_g), 5);
+        b = _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(b, 3), offset_b), 5);
+    };
+    __m128i r_lo, g_lo, b_lo, r_hi, g_hi, b_hi;
+    convert(_mm_unpacklo_epi16(Y, V), _mm_unpacklo_epi16(Y, neg_V),
+            _mm_unpacklo_epi16(neg_U, zero), _mm_unpacklo_epi16(Y, U), r_lo, g_lo, b_lo);
+    convert(_mm_unpackhi_epi16(Y, V), _mm_unpackhi_epi16(Y, neg_V),
+            _mm_unpackhi_epi16(neg_U, zero), _mm_unpackhi_epi16(Y, U), r_hi, g_hi, b_hi);
+
+    // Saturating packs clamp the components to [0, 0xFF]
+    const __m128i r8 = _mm_packus_epi16(_mm_packs_epi32(r_lo, r_hi), zero);
+    const __m128i g8 = _mm_packus_epi16(_mm_packs_epi32(g_lo, g_hi), zero);
+    const __m128i b8 = _mm_packus_epi16(_mm_packs_epi32(b_lo, b_hi), zero);
+    const __m128i b16 = _mm_unpacklo_epi8(zero, b8);
+    const __m128i gr16 = _mm_unpacklo_epi8(g8, r8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(b16, gr16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(b16, gr16));
+#else
+    for (std::size_t x = 0; x < 8; ++x) {
+        const s32 Y = line_Y[x];
+        const s32 U = line_U[x];
+        const s32 V = line_V[x];
+        s32 cY = c[0] * Y;
+
+        s32 r = cY + c[1] * V;
+        s32 g = cY - c[2] * V - c[3] * U;
+        s32 b = cY + c[4] * U;
+
+        r = (r >> 3) + c[5] + rounding_offset;
+        g = (g >> 3) + c[6] + rounding_offset;
+        b = (b >> 3) + c[7] + rounding_offset;
+
+        out[x] = ((u32)std::clamp(r >> 5, 0, 0xFF) << 24) |
+                 ((u32)std::clamp(g >> 5, 0, 0xFF) << 16) |
+                 ((u32)std::clamp(b >> 5, 0, 0xFF) << 8);
+    }
+#endif
+}
+
 /// Converts a image strip from the source YUV format into individual 8x8 RGB32 tiles.
 static void ConvertYUVToRGB(InputFormat input_format, const u8* input_Y, const u8* input_U,
                             const u8* input_V, ImageTile output[], unsigned int width,
                             unsigned int height, const CoefficientSet& coefficients) {
+    std::array<s16, MAX_TILES * 8> line_Y;
+    std::array<s16, MAX_TILES * 8> line_U;
+    std::array<s16, MAX_TILES * 8> line_V;
 
     for (unsigned int y = 0; y < height; ++y) {
-        for (unsigned int x = 0; x < width; ++x) {
-            s32 Y = 0;
-            s32 U = 0;
-            s32 V = 0;
-            switch (input_format) {
-            case InputFormat::YUV422_Indiv8:
-            case InputFormat::YUV422_Indiv16:
-                Y = input_Y[y * width + x];
-                U = input_U[(y * width + x) / 2];
-                V = input_V[(y * width + x) / 2];
-                break;
-            case InputFormat::YUV420_Indiv8:
-            case InputFormat::YUV420_Indiv16:
-                Y = input_Y[y * width + x];
-                U = input_U[((y / 2) * width + x) / 2];
-                V = input_V[((y / 2) * width + x) / 2];
-                break;
-            case InputFormat::YUYV422_Interleaved:
-                Y = input_Y[(y * width + x) * 2];
-                U = input_Y[(y * width + (x / 2) * 2) * 2 + 1];
-                V = input_Y[(y * width + (x / 2) * 2) * 2 + 3];
-                break;
-            }
-
-            // This conversion process is bit-exact with hardware, as far as could be tested.
-            auto& c = coefficients;
-            s32 cY = c[0] * Y;
-
-            s32 r = cY + c[1] * V;
-            s32 g = cY - c[2] * V - c[3] * U;
-            s32 b = cY + c[4] * U;
-
-            const s32 rounding_offset = 0x18;
-            r = (r >> 3) + c[5] + rounding_offset;
-            g = (g >> 3) + c[6] + rounding_offset;
-            b = (b >> 3) + c[7] + rounding_offset;
-
-            unsigned int tile = x / 8;
-            unsigned int tile_x = x % 8;
-            u32* out = &output[tile][y * 8 + tile_x];
-            *out = ((u32)std::clamp(r >> 5, 0, 0xFF) << 24) |
-                   ((u32)std::clamp(g >> 5, 0, 0xFF) << 16) |
-                   ((u32)std::clamp(b >> 5, 0, 0xFF) << 8);
+        DecodeYUVLine(input_format, input_Y, input_U, input_V, y, width, line_Y.data(),
+                      line_U.data(), line_V.data());
+        for (unsigned int x = 0; x < width; x += 8) {
+            ConvertYUVToRGBLine(&line_Y[x], &line_U[x], &line_V[x], &output[x / 8][y * 8],
+                                coefficients);
         }
     }
 }
@@ -87,8 +160,23 @@ static void ReceiveData(Memory::MemorySystem& memory, u8* output, ConversionBuff
     ASSERT(amount_of_data % output_unit == 0);
 
     while (amount_of_data > 0) {
-        for (std::size_t i = 0; i < output_unit; ++i) {
-            output[i] = input[i * N];
+        if constexpr (N == 1) {
+            std::memcpy(output, input, output_unit);
+        } else {
+            std::size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+            // Keep the low byte of every 16-bit unit
+            const __m128i mask = _mm_set1_epi16(0xFF);
+            for (; i + 8 <= output_unit; i += 8) {
+                const __m128i units =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 2));
+                const __m128i bytes = _mm_packus_epi16(_mm_and_si128(units, mask), mask);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), bytes);
+            }
+#endif
+            for (; i < output_unit; ++i) {
+                output[i] = input[i * N];
+            }
         }
 
         output += output_unit;
@@ -100,40 +188,94 @@ static void ReceiveData(Memory::MemorySystem& memory, u8* output, ConversionBuff
     }
 }
 
+/// Encodes RGB32 pixels to the output format.
+template <OutputFormat output_format>
+static void EncodePixels(const u32* input, u8* output, std::size_t count, u8 alpha) {
+    std::size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    const auto load = [input](std::size_t index) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index));
+    };
+    // Packs the low 16 bits of each lane without the signed saturation of packs_epi32
+    const auto pack16 = [](__m128i low, __m128i high) {
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(low, 16), 16),
+                               _mm_srai_epi32(_mm_slli_epi32(high, 16), 16));
+    };
+    if constexpr (output_format == OutputFormat::RGBA8) {
+        const __m128i rgb_mask = _mm_set1_epi32(0xFFFFFF00);
+        const __m128i a = _mm_set1_epi32(alpha);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 4),
+                             _mm_or_si128(_mm_and_si128(load(i), rgb_mask), a));
+        }
+    } else if constexpr (output_format == OutputFormat::RGB565) {
+        const __m128i mask5 = _mm_set1_epi32(0x1F);
+        const __m128i mask6 = _mm_set1_epi32(0x3F);
+        const auto encode = [&](__m128i color) {
+            const __m128i r = _mm_srli_epi32(color, 27);
+            const __m128i g = _mm_and_si128(_mm_srli_epi32(color, 18), mask6);
+            const __m128i b = _mm_and_si128(_mm_srli_epi32(color, 11), mask5);
+            return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11), _mm_slli_epi32(g, 5)), b);
+        };
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2),
+                             pack16(encode(load(i)), encode(load(i + 4))));
+        }
+    } else if constexpr (output_format == OutputFormat::RGB5A1) {
+        const __m128i mask5 = _mm_set1_epi32(0x1F);
+        const __m128i a = _mm_set1_epi32(Color::Convert8To1(alpha));
+        const auto encode = [&](__m128i color) {
+            const __m128i r = _mm_srli_epi32(color, 27);
+            const __m128i g = _mm_and_si128(_mm_srli_epi32(color, 19), mask5);
+            const __m128i b = _mm_and_si128(_mm_srli_epi32(color, 11), mask5);
+            return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11), _mm_slli_epi32(g, 6)),
+                                _mm_or_si128(_mm_slli_epi32(b, 1), a));
+        };
+        for (; i + 8 <= count; i += 8) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2),
+                             pack16(encode(load(i)), encode(load(i + 4))));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const u32 color = input[i];
+        Common::Vec4<u8> col_vec{(u8)(color >> 24), (u8)(color >> 16), (u8)(color >> 8), alpha};
+
+        switch (output_format) {
+        case OutputFormat::RGBA8:
+            Color::EncodeRGBA8(col_vec, output + i * 4);
+            break;
+        case OutputFormat::RGB8:
+            Color::EncodeRGB8(col_vec, output + i * 3);
+            break;
+        case OutputFormat::RGB5A1:
+            Color::EncodeRGB5A1(col_vec, output + i * 2);
+            break;
+        case OutputFormat::RGB565:
+            Color::EncodeRGB565(col_vec, output + i * 2);
+            break;
+        }
+    }
+}
+
 /// Convert intermediate RGB32 format to the final output format while simulating an outgoing CDMA
 /// transfer.
+template <OutputFormat output_format>
 static void SendData(Memory::MemorySystem& memory, const u32* input, ConversionBuffer& buf,
-                     int amount_of_data, OutputFormat output_format, u8 alpha) {
+                     int amount_of_data, u8 alpha) {
+    constexpr std::size_t bytes_per_pixel = output_format == OutputFormat::RGBA8  ? 4
+                                            : output_format == OutputFormat::RGB8 ? 3
+                                                                                  : 2;
 
     u8* output = memory.GetPointer(buf.address);
 
     while (amount_of_data > 0) {
-        u8* unit_end = output + buf.transfer_unit;
-        while (output < unit_end) {
-            u32 color = *input++;
-            Common::Vec4<u8> col_vec{(u8)(color >> 24), (u8)(color >> 16), (u8)(color >> 8), alpha};
-
-            switch (output_format) {
-            case OutputFormat::RGBA8:
-                Color::EncodeRGBA8(col_vec, output);
-                output += 4;
-                break;
-            case OutputFormat::RGB8:
-                Color::EncodeRGB8(col_vec, output);
-                output += 3;
-                break;
-            case OutputFormat::RGB5A1:
-                Color::EncodeRGB5A1(col_vec, output);
-                output += 2;
-                break;
-            case OutputFormat::RGB565:
-                Color::EncodeRGB565(col_vec, output);
-                output += 2;
-                break;
-            }
-
-            amount_of_data -= 1;
-        }
+        // Like the hardware, a pixel that straddles the end of the unit is still written whole
+        const std::size_t count = (buf.transfer_unit + bytes_per_pixel - 1) / bytes_per_pixel;
+        EncodePixels<output_format>(input, output, count, alpha);
+        input += count;
+        output += count * bytes_per_pixel;
+        amount_of_data -= static_cast<int>(count);
 
         output += buf.gap;
         buf.address += buf.transfer_unit + buf.gap;
@@ -323,8 +465,6 @@ void PerformConversion(Memory::MemorySystem& memory, ConversionConfiguration& cv
             break;
         }
 
-        // Note(yuriks): If additional optimization is required, input_format can be moved to a
-        // template parameter, so that its dispatch can be moved to outside the inner loop.
         ConvertYUVToRGB(cvt.input_format, input_Y, input_U, input_V, tiles.get(),
                         cvt.input_line_width, row_height, cvt.coefficients);
 
@@ -371,10 +511,25 @@ void PerformConversion(Memory::MemorySystem& memory, ConversionConfiguration& cv
             }
         }
 
-        // Note(yuriks): If additional optimization is required, output_format can be moved to a
-        // template parameter, so that its dispatch can be moved to outside the inner loop.
-        SendData(memory, reinterpret_cast<u32*>(data_buffer.get()), cvt.dst, (int)row_data_size,
-                 cvt.output_format, (u8)cvt.alpha);
+        const u32* rgb_data = reinterpret_cast<u32*>(data_buffer.get());
+        switch (cvt.output_format) {
+        case OutputFormat::RGBA8:
+            SendData<OutputFormat::RGBA8>(memory, rgb_data, cvt.dst, (int)row_data_size,
+                                          (u8)cvt.alpha);
+            break;
+        case OutputFormat::RGB8:
+            SendData<OutputFormat::RGB8>(memory, rgb_data, cvt.dst, (int)row_data_size,
+                                         (u8)cvt.alpha);
+            break;
+        case OutputFormat::RGB5A1:
+            SendData<OutputFormat::RGB5A1>(memory, rgb_data, cvt.dst, (int)row_data_size,
+                                           (u8)cvt.alpha);
+            break;
+        case OutputFormat::RGB565:
+            SendData<OutputFormat::RGB565>(memory, rgb_data, cvt.dst, (int)row_data_size,
+                                           (u8)cvt.alpha);
+            break;
+        }
     }
 }
 } // namespace HW::Y2R
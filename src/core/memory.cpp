@@ -3,13 +3,17 @@
 // Refer to the license.txt file included.
 
 #include <array>
+#include <atomic>
 #include <cstring>
+#include <optional>
+#include <unordered_map>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/binary_object.hpp>
 #include "audio_core/dsp_interface.h"
 #include "common/archives.h"
 #include "common/assert.h"
 #include "common/common_types.h"
+#include "common/host_memory.h"
 #include "common/logging/log.h"
 #include "common/swap.h"
 #include "core/arm/arm_interface.h"
@@ -30,10 +34,45 @@ SERIALIZE_EXPORT_IMPL(Memory::MemorySystem::BackingMemImpl<Memory::Region::N3DS>
 
 namespace Memory {
 
+/// Whether the JIT was built with support for the fastmem arenas
+#if defined(ARCHITECTURE_x86_64) && defined(ENABLE_DYNARMIC_FASTMEM)
+constexpr bool JIT_HAS_FASTMEM = true;
+#else
+constexpr bool JIT_HAS_FASTMEM = false;
+#endif
+
+/// Size of the host mirror of a guest address space
+constexpr std::size_t FASTMEM_ARENA_SIZE = std::size_t{PAGE_TABLE_NUM_ENTRIES} * PAGE_SIZE;
+
+void PageTable::Pointers::Clear() {
+    for (std::size_t chunk = 0; chunk < NUM_REF_CHUNKS; ++chunk) {
+        if (ref_chunks[chunk]) {
+            const auto begin = raw->begin() + chunk * REF_CHUNK_SIZE;
+            std::fill(begin, begin + REF_CHUNK_SIZE, nullptr);
+            ref_chunks[chunk].reset();
+        }
+    }
+}
+
 void PageTable::Clear() {
-    pointers.raw.fill(nullptr);
-    pointers.refs.fill(MemoryRef());
+    pointers.Clear();
     attributes.fill(PageType::Unmapped);
+    if (fastmem_arena) {
+        fastmem_arena->Unmap(0, FASTMEM_ARENA_SIZE);
+    }
+}
+
+void PageTable::TakePointerArray(PageTable& donor) {
+    // Only the parts of the arrays that can hold pointers are copied, the rest is null in both
+    for (std::size_t chunk = 0; chunk < Pointers::NUM_REF_CHUNKS; ++chunk) {
+        if (!pointers.ref_chunks[chunk] && !donor.pointers.ref_chunks[chunk]) {
+            continue;
+        }
+        const std::size_t begin = chunk * Pointers::REF_CHUNK_SIZE;
+        std::copy_n(pointers.raw->begin() + begin, Pointers::REF_CHUNK_SIZE,
+                    donor.pointers.raw->begin() + begin);
+    }
+    std::swap(pointers.raw, donor.pointers.raw);
 }
 
 class RasterizerCacheMarker {
@@ -79,13 +118,29 @@ private:
     }
 };
 
+/// Page table of the core running on this host thread, while the cores run in parallel
+static thread_local PageTable* thread_page_table = nullptr;
+
 class MemorySystem::Impl {
 public:
-    // Visual Studio would try to allocate these on compile time if they are std::array, which would
-    // exceed the memory limit.
-    std::unique_ptr<u8[]> fcram = std::make_unique<u8[]>(Memory::FCRAM_N3DS_SIZE);
-    std::unique_ptr<u8[]> vram = std::make_unique<u8[]>(Memory::VRAM_SIZE);
-    std::unique_ptr<u8[]> n3ds_extra_ram = std::make_unique<u8[]>(Memory::N3DS_EXTRA_RAM_SIZE);
+    // FCRAM, VRAM and the N3DS extra RAM share one allocation, which can be mapped into the
+    // fastmem arenas when it is a shared memory object
+    Common::HostMemory backing{FCRAM_N3DS_SIZE + VRAM_SIZE + N3DS_EXTRA_RAM_SIZE,
+                               JIT_HAS_FASTMEM && Settings::values.use_cpu_jit &&
+                                   Settings::values.use_fastmem,
+                               Settings::values.use_huge_pages};
+    u8* fcram = backing.Pointer();
+    u8* vram = fcram + FCRAM_N3DS_SIZE;
+    u8* n3ds_extra_ram = vram + VRAM_SIZE;
+
+    /// Number of the watchpoints on each watched virtual page
+    std::unordered_map<u32, u32> watched_pages;
+
+    /// Whether the writes through the memory system are recorded in dirty_pages. All the pages of
+    /// type `Memory` are hidden meanwhile, so that the JIT writes come through the memory system.
+    bool dirty_tracking = false;
+    /// One bit per page of the backing memory, the pages may be written by several cores at once
+    std::unique_ptr<std::atomic<u64>[]> dirty_pages;
 
     std::shared_ptr<PageTable> current_page_table = nullptr;
     RasterizerCacheMarker cache_marker;
@@ -100,16 +155,20 @@ public:
 
     Impl();
 
+    PageTable& GetPageTable() {
+        return thread_page_table != nullptr ? *thread_page_table : *current_page_table;
+    }
+
     const u8* GetPtr(Region r) const {
         switch (r) {
         case Region::VRAM:
-            return vram.get();
+            return vram;
         case Region::DSP:
             return dsp->GetDspMemory().data();
         case Region::FCRAM:
-            return fcram.get();
+            return fcram;
         case Region::N3DS:
-            return n3ds_extra_ram.get();
+            return n3ds_extra_ram;
         default:
             UNREACHABLE();
         }
@@ -118,18 +177,112 @@ public:
     u8* GetPtr(Region r) {
         switch (r) {
         case Region::VRAM:
-            return vram.get();
+            return vram;
         case Region::DSP:
             return dsp->GetDspMemory().data();
         case Region::FCRAM:
-            return fcram.get();
+            return fcram;
         case Region::N3DS:
-            return n3ds_extra_ram.get();
+            return n3ds_extra_ram;
         default:
             UNREACHABLE();
         }
     }
 
+    /// The regions of the backing memory, in physical address order
+    struct BackingRegion {
+        PAddr paddr;
+        std::size_t offset;
+        u32 size;
+    };
+    static constexpr std::array<BackingRegion, 3> backing_regions{{
+        {VRAM_PADDR, FCRAM_N3DS_SIZE, VRAM_SIZE},
+        {N3DS_EXTRA_RAM_PADDR, FCRAM_N3DS_SIZE + VRAM_SIZE, N3DS_EXTRA_RAM_SIZE},
+        {FCRAM_PADDR, 0, FCRAM_N3DS_SIZE},
+    }};
+
+    void MarkDirty(std::size_t offset, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const std::size_t end_page = ((offset + size - 1) >> PAGE_BITS) + 1;
+        for (std::size_t page = offset >> PAGE_BITS; page < end_page; ++page) {
+            dirty_pages[page / 64].fetch_or(u64{1} << (page % 64), std::memory_order_relaxed);
+        }
+    }
+
+    /// Whether the fast paths and the JIT must not see the page, which is then accessed through the
+    /// slow path of the memory system
+    bool IsPageHidden(u32 page) const {
+        return dirty_tracking || watched_pages.count(page) != 0;
+    }
+
+    /// Records the pages written through a host pointer, if it points into the backing memory
+    void MarkDirty(const u8* pointer, std::size_t size) {
+        if (!dirty_tracking) {
+            return;
+        }
+        const auto offset = static_cast<std::size_t>(reinterpret_cast<uintptr_t>(pointer) -
+                                                     reinterpret_cast<uintptr_t>(fcram));
+        if (offset < backing.Size()) {
+            MarkDirty(offset, std::min(size, backing.Size() - offset));
+        }
+    }
+
+    /// Mirrors the pages of type `Memory` in the range into the fastmem arena of the page table
+    /// and makes the other ones fault
+    void UpdateFastmemArena(PageTable& page_table, u32 first_page, u32 num_pages) {
+        if (!page_table.fastmem_arena) {
+            return;
+        }
+        const u8* const backing_begin = backing.Pointer();
+        const u8* const backing_end = backing_begin + backing.Size();
+        const auto backing_offset = [&](u32 page) -> std::optional<std::size_t> {
+            const u8* pointer = page_table.GetPointerArray()[page];
+            if (page_table.attributes[page] != PageType::Memory || pointer < backing_begin ||
+                pointer >= backing_end) {
+                return std::nullopt;
+            }
+            return static_cast<std::size_t>(pointer - backing_begin);
+        };
+
+        // Runs of pages that are contiguous in both address spaces are mapped at once
+        const u32 end_page = first_page + num_pages;
+        u32 page = first_page;
+        while (page != end_page) {
+            const auto offset = backing_offset(page);
+            u32 run_end = page + 1;
+            while (run_end != end_page) {
+                const auto next_offset = backing_offset(run_end);
+                if (offset.has_value() != next_offset.has_value() ||
+                    (offset && *next_offset != *offset + std::size_t{run_end - page} * PAGE_SIZE)) {
+                    break;
+                }
+                ++run_end;
+            }
+            const std::size_t length = std::size_t{run_end - page} * PAGE_SIZE;
+            if (offset) {
+                page_table.fastmem_arena->Map(std::size_t{page} * PAGE_SIZE, *offset, length);
+            } else {
+                page_table.fastmem_arena->Unmap(std::size_t{page} * PAGE_SIZE, length);
+            }
+            page = run_end;
+        }
+    }
+
+    /// Gives the page table a fastmem arena mirroring its current mappings, if fastmem is in use
+    void CreateFastmemArena(PageTable& page_table) {
+        if (!backing.IsShared() || page_table.fastmem_arena) {
+            return;
+        }
+        auto arena = std::make_shared<Common::FastmemArena>(backing, FASTMEM_ARENA_SIZE);
+        if (!arena->IsValid()) {
+            return;
+        }
+        page_table.fastmem_arena = std::move(arena);
+        UpdateFastmemArena(page_table, 0, PAGE_TABLE_NUM_ENTRIES);
+    }
+
     u32 GetSize(Region r) const {
         switch (r) {
         case Region::VRAM:
@@ -151,13 +304,19 @@ private:
     void serialize(Archive& ar, const unsigned int file_version) {
         bool save_n3ds_ram = Settings::values.is_new_3ds;
         ar& save_n3ds_ram;
-        ar& boost::serialization::make_binary_object(vram.get(), Memory::VRAM_SIZE);
+        ar& boost::serialization::make_binary_object(vram, Memory::VRAM_SIZE);
         ar& boost::serialization::make_binary_object(
-            fcram.get(), save_n3ds_ram ? Memory::FCRAM_N3DS_SIZE : Memory::FCRAM_SIZE);
+            fcram, save_n3ds_ram ? Memory::FCRAM_N3DS_SIZE : Memory::FCRAM_SIZE);
         ar& boost::serialization::make_binary_object(
-            n3ds_extra_ram.get(), save_n3ds_ram ? Memory::N3DS_EXTRA_RAM_SIZE : 0);
+            n3ds_extra_ram, save_n3ds_ram ? Memory::N3DS_EXTRA_RAM_SIZE : 0);
         ar& cache_marker;
         ar& page_table_list;
+        if (Archive::is_loading::value) {
+            for (const auto& page_table : page_table_list) {
+                page_table->fastmem_arena.reset();
+                CreateFastmemArena(*page_table);
+            }
+        }
         // dsp is set from Core::System at startup
         ar& current_page_table;
         ar& fcram_mem;
@@ -218,6 +377,10 @@ std::shared_ptr<PageTable> MemorySystem::GetCurrentPageTable() const {
     return impl->current_page_table;
 }
 
+void MemorySystem::SetThreadPageTable(PageTable* page_table) {
+    thread_page_table = page_table;
+}
+
 void MemorySystem::MapPages(PageTable& page_table, u32 base, u32 size, MemoryRef memory,
                             PageType type) {
     LOG_DEBUG(HW_Memory, "Mapping {} onto {:08X}-{:08X}", (void*)memory.GetPtr(), base * PAGE_SIZE,
@@ -226,6 +389,7 @@ void MemorySystem::MapPages(PageTable& page_table, u32 base, u32 size, MemoryRef
     RasterizerFlushVirtualRegion(base << PAGE_BITS, size * PAGE_SIZE,
                                  FlushMode::FlushAndInvalidate);
 
+    const u32 first_page = base;
     u32 end = base + size;
     while (base != end) {
         ASSERT_MSG(base < PAGE_TABLE_NUM_ENTRIES, "out of range mapping at {:08X}", base);
@@ -237,12 +401,16 @@ void MemorySystem::MapPages(PageTable& page_table, u32 base, u32 size, MemoryRef
         if (type == PageType::Memory && impl->cache_marker.IsCached(base * PAGE_SIZE)) {
             page_table.attributes[base] = PageType::RasterizerCachedMemory;
             page_table.pointers[base] = nullptr;
+        } else if (type == PageType::Memory && impl->IsPageHidden(base)) {
+            page_table.pointers.SetHidden(base, true);
         }
 
         base += 1;
         if (memory != nullptr && memory.GetSize() > PAGE_SIZE)
             memory += PAGE_SIZE;
     }
+
+    impl->UpdateFastmemArena(page_table, first_page, size);
 }
 
 void MemorySystem::MapMemoryRegion(PageTable& page_table, VAddr base, u32 size, MemoryRef target) {
@@ -280,6 +448,7 @@ MemoryRef MemorySystem::GetPointerForRasterizerCache(VAddr addr) const {
 }
 
 void MemorySystem::RegisterPageTable(std::shared_ptr<PageTable> page_table) {
+    impl->CreateFastmemArena(*page_table);
     impl->page_table_list.push_back(page_table);
 }
 
@@ -290,9 +459,56 @@ void MemorySystem::UnregisterPageTable(std::shared_ptr<PageTable> page_table) {
     }
 }
 
+void MemorySystem::TakePageTableStorage(PageTable& page_table, PageTable& donor) {
+    page_table.TakePointerArray(donor);
+    if (page_table.fastmem_arena && donor.fastmem_arena) {
+        std::swap(page_table.fastmem_arena, donor.fastmem_arena);
+        impl->UpdateFastmemArena(page_table, 0, PAGE_TABLE_NUM_ENTRIES);
+    }
+}
+
 /**
  * This function should only be called for virtual addreses with attribute `PageType::Special`.
  */
+std::size_t MemorySystem::GetContiguousBlockSize(const PageTable& page_table, VAddr vaddr,
+                                                 std::size_t size) const {
+    const std::size_t page_index = vaddr >> PAGE_BITS;
+    const std::size_t first_size = std::min<std::size_t>(PAGE_SIZE - (vaddr & PAGE_MASK), size);
+    const PageType type = page_table.attributes[page_index];
+    if (type == PageType::Special) {
+        return first_size;
+    }
+
+    const u8* expected_ptr = nullptr;
+    if (type == PageType::Memory) {
+        expected_ptr = page_table.pointers.GetUnhidden(page_index) + PAGE_SIZE;
+    } else if (type == PageType::RasterizerCachedMemory) {
+        expected_ptr = GetPointerForRasterizerCache(vaddr & ~PAGE_MASK).GetPtr() + PAGE_SIZE;
+    }
+
+    std::size_t block_size = first_size;
+    for (std::size_t next_page = page_index + 1; block_size < size; ++next_page) {
+        if (page_table.attributes[next_page] != type) {
+            break;
+        }
+        const VAddr next_vaddr = static_cast<VAddr>(next_page << PAGE_BITS);
+        if (type == PageType::Memory) {
+            if (page_table.pointers.GetUnhidden(next_page) != expected_ptr) {
+                break;
+            }
+        } else if (type == PageType::RasterizerCachedMemory) {
+            if (GetPointerForRasterizerCache(next_vaddr).GetPtr() != expected_ptr) {
+                break;
+            }
+        }
+        block_size += std::min<std::size_t>(PAGE_SIZE, size - block_size);
+        if (expected_ptr != nullptr) {
+            expected_ptr += PAGE_SIZE;
+        }
+    }
+    return block_size;
+}
+
 static MMIORegionPointer GetMMIOHandler(const PageTable& page_table, VAddr vaddr) {
     for (const auto& region : page_table.special_regions) {
         if (vaddr >= region.base && vaddr < (region.base + region.size)) {
@@ -308,7 +524,8 @@ T ReadMMIO(MMIORegionPointer mmio_handler, VAddr addr);
 
 template <typename T>
 T MemorySystem::Read(const VAddr vaddr) {
-    const u8* page_pointer = impl->current_page_table->pointers[vaddr >> PAGE_BITS];
+    PageTable& page_table = impl->GetPageTable();
+    const u8* page_pointer = page_table.pointers[vaddr >> PAGE_BITS];
     if (page_pointer) {
         // NOTE: Avoid adding any extra logic to this fast-path block
         T value;
@@ -316,15 +533,20 @@ T MemorySystem::Read(const VAddr vaddr) {
         return value;
     }
 
-    PageType type = impl->current_page_table->attributes[vaddr >> PAGE_BITS];
+    PageType type = page_table.attributes[vaddr >> PAGE_BITS];
     switch (type) {
     case PageType::Unmapped:
         LOG_ERROR(HW_Memory, "unmapped Read{} @ 0x{:08X} at PC 0x{:08X}", sizeof(T) * 8, vaddr,
                   Core::GetRunningCore().GetPC());
         return 0;
-    case PageType::Memory:
-        ASSERT_MSG(false, "Mapped memory page without a pointer @ {:08X}", vaddr);
-        break;
+    case PageType::Memory: {
+        // The page is hidden for a watchpoint
+        const u8* const src_ptr =
+            page_table.pointers.GetUnhidden(vaddr >> PAGE_BITS) + (vaddr & PAGE_MASK);
+        T value;
+        std::memcpy(&value, src_ptr, sizeof(T));
+        return value;
+    }
     case PageType::RasterizerCachedMemory: {
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::Flush);
 
@@ -332,8 +554,11 @@ T MemorySystem::Read(const VAddr vaddr) {
         std::memcpy(&value, GetPointerForRasterizerCache(vaddr), sizeof(T));
         return value;
     }
-    case PageType::Special:
-        return ReadMMIO<T>(GetMMIOHandler(*impl->current_page_table, vaddr), vaddr);
+    case PageType::Special: {
+        // Cores running on other host threads may access the same device
+        std::lock_guard lock{HLE::g_hle_lock};
+        return ReadMMIO<T>(GetMMIOHandler(page_table, vaddr), vaddr);
+    }
     default:
         UNREACHABLE();
     }
@@ -344,30 +569,40 @@ void WriteMMIO(MMIORegionPointer mmio_handler, VAddr addr, const T data);
 
 template <typename T>
 void MemorySystem::Write(const VAddr vaddr, const T data) {
-    u8* page_pointer = impl->current_page_table->pointers[vaddr >> PAGE_BITS];
+    PageTable& page_table = impl->GetPageTable();
+    u8* page_pointer = page_table.pointers[vaddr >> PAGE_BITS];
     if (page_pointer) {
         // NOTE: Avoid adding any extra logic to this fast-path block
         std::memcpy(&page_pointer[vaddr & PAGE_MASK], &data, sizeof(T));
         return;
     }
 
-    PageType type = impl->current_page_table->attributes[vaddr >> PAGE_BITS];
+    PageType type = page_table.attributes[vaddr >> PAGE_BITS];
     switch (type) {
     case PageType::Unmapped:
         LOG_ERROR(HW_Memory, "unmapped Write{} 0x{:08X} @ 0x{:08X} at PC 0x{:08X}",
                   sizeof(data) * 8, (u32)data, vaddr, Core::GetRunningCore().GetPC());
         return;
-    case PageType::Memory:
-        ASSERT_MSG(false, "Mapped memory page without a pointer @ {:08X}", vaddr);
+    case PageType::Memory: {
+        // The page is hidden for a watchpoint or the dirty tracking
+        u8* const dest_ptr =
+            page_table.pointers.GetUnhidden(vaddr >> PAGE_BITS) + (vaddr & PAGE_MASK);
+        std::memcpy(dest_ptr, &data, sizeof(T));
+        impl->MarkDirty(dest_ptr, sizeof(T));
         break;
+    }
     case PageType::RasterizerCachedMemory: {
         RasterizerFlushVirtualRegion(vaddr, sizeof(T), FlushMode::Invalidate);
-        std::memcpy(GetPointerForRasterizerCache(vaddr), &data, sizeof(T));
+        u8* const dest_ptr = GetPointerForRasterizerCache(vaddr);
+        std::memcpy(dest_ptr, &data, sizeof(T));
+        impl->MarkDirty(dest_ptr, sizeof(T));
         break;
     }
-    case PageType::Special:
-        WriteMMIO<T>(GetMMIOHandler(*impl->current_page_table, vaddr), vaddr, data);
+    case PageType::Special: {
+        std::lock_guard lock{HLE::g_hle_lock};
+        WriteMMIO<T>(GetMMIOHandler(page_table, vaddr), vaddr, data);
         break;
+    }
     default:
         UNREACHABLE();
     }
@@ -380,7 +615,8 @@ bool IsValidVirtualAddress(const Kernel::Process& process, const VAddr vaddr) {
     if (page_pointer)
         return true;
 
-    if (page_table.attributes[vaddr >> PAGE_BITS] == PageType::RasterizerCachedMemory)
+    if (page_table.attributes[vaddr >> PAGE_BITS] == PageType::RasterizerCachedMemory ||
+        page_table.attributes[vaddr >> PAGE_BITS] == PageType::Memory)
         return true;
 
     if (page_table.attributes[vaddr >> PAGE_BITS] != PageType::Special)
@@ -409,6 +645,11 @@ u8* MemorySystem::GetPointer(const VAddr vaddr) {
         return GetPointerForRasterizerCache(vaddr);
     }
 
+    if (impl->current_page_table->attributes[vaddr >> PAGE_BITS] == PageType::Memory) {
+        return impl->current_page_table->pointers.GetUnhidden(vaddr >> PAGE_BITS) +
+               (vaddr & PAGE_MASK);
+    }
+
     LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x{:08x} at PC 0x{:08X}", vaddr,
               Core::GetRunningCore().GetPC());
     return nullptr;
@@ -425,21 +666,61 @@ const u8* MemorySystem::GetPointer(const VAddr vaddr) const {
         return GetPointerForRasterizerCache(vaddr);
     }
 
+    if (impl->current_page_table->attributes[vaddr >> PAGE_BITS] == PageType::Memory) {
+        return impl->current_page_table->pointers.GetUnhidden(vaddr >> PAGE_BITS) +
+               (vaddr & PAGE_MASK);
+    }
+
     LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x{:08x}", vaddr);
     return nullptr;
 }
 
+u8* MemorySystem::GetContiguousPointer(const Kernel::Process& process, const VAddr vaddr,
+                                       const std::size_t size) {
+    return GetContiguousPointer(*process.vm_manager.page_table, vaddr, size);
+}
+
+u8* MemorySystem::GetContiguousPointer(PageTable& page_table, const VAddr vaddr,
+                                       const std::size_t size) {
+    if (impl->dirty_tracking || size == 0 ||
+        size > (PAGE_TABLE_NUM_ENTRIES << PAGE_BITS) - static_cast<std::size_t>(vaddr)) {
+        return nullptr;
+    }
+
+    const std::size_t page_index = vaddr >> PAGE_BITS;
+    if (page_table.attributes[page_index] != PageType::Memory ||
+        GetContiguousBlockSize(page_table, vaddr, size) < size) {
+        return nullptr;
+    }
+    return page_table.pointers.GetUnhidden(page_index) + (vaddr & PAGE_MASK);
+}
+
 std::string MemorySystem::ReadCString(VAddr vaddr, std::size_t max_length) {
+    // The maximum is often the size of a whole string table, so nothing is reserved up front
     std::string string;
-    string.reserve(max_length);
-    for (std::size_t i = 0; i < max_length; ++i) {
-        char c = Read8(vaddr);
-        if (c == '\0')
+    PageTable& page_table = impl->GetPageTable();
+    while (string.size() < max_length) {
+        const u8* page_pointer = page_table.pointers[vaddr >> PAGE_BITS];
+        if (!page_pointer) {
+            // Pages without a host pointer are read through the regular path character by
+            // character
+            const char c = static_cast<char>(Read8(vaddr));
+            if (c == '\0')
+                break;
+            string.push_back(c);
+            ++vaddr;
+            continue;
+        }
+
+        const char* begin = reinterpret_cast<const char*>(page_pointer + (vaddr & PAGE_MASK));
+        const std::size_t length =
+            std::min<std::size_t>(PAGE_SIZE - (vaddr & PAGE_MASK), max_length - string.size());
+        const char* end = static_cast<const char*>(std::memchr(begin, '\0', length));
+        string.append(begin, end != nullptr ? end : begin + length);
+        if (end != nullptr)
             break;
-        string.push_back(c);
-        ++vaddr;
+        vaddr += static_cast<u32>(length);
     }
-    string.shrink_to_fit();
     return string;
 }
 
@@ -548,6 +829,7 @@ void MemorySystem::RasterizerMarkRegionCached(PAddr start, u32 size, bool cached
                     case PageType::Memory:
                         page_type = PageType::RasterizerCachedMemory;
                         page_table->pointers[vaddr >> PAGE_BITS] = nullptr;
+                        impl->UpdateFastmemArena(*page_table, vaddr >> PAGE_BITS, 1);
                         break;
                     default:
                         UNREACHABLE();
@@ -563,6 +845,10 @@ void MemorySystem::RasterizerMarkRegionCached(PAddr start, u32 size, bool cached
                         page_type = PageType::Memory;
                         page_table->pointers[vaddr >> PAGE_BITS] =
                             GetPointerForRasterizerCache(vaddr & ~PAGE_MASK);
+                        if (impl->IsPageHidden(vaddr >> PAGE_BITS)) {
+                            page_table->pointers.SetHidden(vaddr >> PAGE_BITS, true);
+                        }
+                        impl->UpdateFastmemArena(*page_table, vaddr >> PAGE_BITS, 1);
                         break;
                     }
                     default:
@@ -579,7 +865,8 @@ void RasterizerFlushRegion(PAddr start, u32 size) {
         return;
     }
 
-    VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size);
+    VideoCore::RunOnGPUThread(
+        [start, size] { VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size); });
 }
 
 void RasterizerInvalidateRegion(PAddr start, u32 size) {
@@ -587,7 +874,9 @@ void RasterizerInvalidateRegion(PAddr start, u32 size) {
         return;
     }
 
-    VideoCore::g_renderer->Rasterizer()->InvalidateRegion(start, size);
+    // The memory has been written already, later GPU work only has to see the invalidation
+    VideoCore::QueueOnGPUThread(
+        [start, size] { VideoCore::g_renderer->Rasterizer()->InvalidateRegion(start, size); });
 }
 
 void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
@@ -597,7 +886,9 @@ void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
         return;
     }
 
-    VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
+    VideoCore::RunOnGPUThread([start, size] {
+        VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
+    });
 }
 
 void RasterizerClearAll(bool flush) {
@@ -607,7 +898,24 @@ void RasterizerClearAll(bool flush) {
         return;
     }
 
-    VideoCore::g_renderer->Rasterizer()->ClearAll(flush);
+    VideoCore::RunOnGPUThread([flush] { VideoCore::g_renderer->Rasterizer()->ClearAll(flush); });
+}
+
+void RasterizerDetachCaches(bool flush) {
+    if (VideoCore::g_renderer == nullptr) {
+        return;
+    }
+
+    VideoCore::RunOnGPUThread(
+        [flush] { VideoCore::g_renderer->Rasterizer()->DetachCaches(flush); });
+}
+
+void RasterizerReattachCaches() {
+    if (VideoCore::g_renderer == nullptr) {
+        return;
+    }
+
+    VideoCore::RunOnGPUThread([] { VideoCore::g_renderer->Rasterizer()->ReattachCaches(); });
 }
 
 void RasterizerFlushVirtualRegion(VAddr start, u32 size, FlushMode mode) {
@@ -630,16 +938,15 @@ void RasterizerFlushVirtualRegion(VAddr start, u32 size, FlushMode mode) {
         PAddr physical_start = paddr_region_start + (overlap_start - region_start);
         u32 overlap_size = overlap_end - overlap_start;
 
-        auto* rasterizer = VideoCore::g_renderer->Rasterizer();
         switch (mode) {
         case FlushMode::Flush:
-            rasterizer->FlushRegion(physical_start, overlap_size);
+            RasterizerFlushRegion(physical_start, overlap_size);
             break;
         case FlushMode::Invalidate:
-            rasterizer->InvalidateRegion(physical_start, overlap_size);
+            RasterizerInvalidateRegion(physical_start, overlap_size);
             break;
         case FlushMode::FlushAndInvalidate:
-            rasterizer->FlushAndInvalidateRegion(physical_start, overlap_size);
+            RasterizerFlushAndInvalidateRegion(physical_start, overlap_size);
             break;
         }
     };
@@ -674,8 +981,9 @@ void MemorySystem::ReadBlock(const Kernel::Process& process, const VAddr src_add
     std::size_t page_offset = src_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const std::size_t copy_amount = std::min(PAGE_SIZE - page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+        const std::size_t copy_amount =
+            GetContiguousBlockSize(page_table, current_vaddr, remaining_size);
 
         switch (page_table.attributes[page_index]) {
         case PageType::Unmapped: {
@@ -687,9 +995,9 @@ void MemorySystem::ReadBlock(const Kernel::Process& process, const VAddr src_add
             break;
         }
         case PageType::Memory: {
-            DEBUG_ASSERT(page_table.pointers[page_index]);
+            DEBUG_ASSERT(page_table.pointers.GetUnhidden(page_index));
 
-            const u8* src_ptr = page_table.pointers[page_index] + page_offset;
+            const u8* src_ptr = page_table.pointers.GetUnhidden(page_index) + page_offset;
             std::memcpy(dest_buffer, src_ptr, copy_amount);
             break;
         }
@@ -709,7 +1017,7 @@ void MemorySystem::ReadBlock(const Kernel::Process& process, const VAddr src_add
             UNREACHABLE();
         }
 
-        page_index++;
+        page_index += (page_offset + copy_amount) >> PAGE_BITS;
         page_offset = 0;
         dest_buffer = static_cast<u8*>(dest_buffer) + copy_amount;
         remaining_size -= copy_amount;
@@ -740,8 +1048,9 @@ void MemorySystem::WriteBlock(const Kernel::Process& process, const VAddr dest_a
     std::size_t page_offset = dest_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const std::size_t copy_amount = std::min(PAGE_SIZE - page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+        const std::size_t copy_amount =
+            GetContiguousBlockSize(page_table, current_vaddr, remaining_size);
 
         switch (page_table.attributes[page_index]) {
         case PageType::Unmapped: {
@@ -752,10 +1061,11 @@ void MemorySystem::WriteBlock(const Kernel::Process& process, const VAddr dest_a
             break;
         }
         case PageType::Memory: {
-            DEBUG_ASSERT(page_table.pointers[page_index]);
+            DEBUG_ASSERT(page_table.pointers.GetUnhidden(page_index));
 
-            u8* dest_ptr = page_table.pointers[page_index] + page_offset;
+            u8* dest_ptr = page_table.pointers.GetUnhidden(page_index) + page_offset;
             std::memcpy(dest_ptr, src_buffer, copy_amount);
+            impl->MarkDirty(dest_ptr, copy_amount);
             break;
         }
         case PageType::Special: {
@@ -767,14 +1077,16 @@ void MemorySystem::WriteBlock(const Kernel::Process& process, const VAddr dest_a
         case PageType::RasterizerCachedMemory: {
             RasterizerFlushVirtualRegion(current_vaddr, static_cast<u32>(copy_amount),
                                          FlushMode::Invalidate);
-            std::memcpy(GetPointerForRasterizerCache(current_vaddr), src_buffer, copy_amount);
+            u8* const dest_ptr = GetPointerForRasterizerCache(current_vaddr);
+            std::memcpy(dest_ptr, src_buffer, copy_amount);
+            impl->MarkDirty(dest_ptr, copy_amount);
             break;
         }
         default:
             UNREACHABLE();
         }
 
-        page_index++;
+        page_index += (page_offset + copy_amount) >> PAGE_BITS;
         page_offset = 0;
         src_buffer = static_cast<const u8*>(src_buffer) + copy_amount;
         remaining_size -= copy_amount;
@@ -791,8 +1103,9 @@ void MemorySystem::ZeroBlock(const Kernel::Process& process, const VAddr dest_ad
     static const std::array<u8, PAGE_SIZE> zeros = {};
 
     while (remaining_size > 0) {
-        const std::size_t copy_amount = std::min(PAGE_SIZE - page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+        const std::size_t copy_amount =
+            GetContiguousBlockSize(page_table, current_vaddr, remaining_size);
 
         switch (page_table.attributes[page_index]) {
         case PageType::Unmapped: {
@@ -803,10 +1116,11 @@ void MemorySystem::ZeroBlock(const Kernel::Process& process, const VAddr dest_ad
             break;
         }
         case PageType::Memory: {
-            DEBUG_ASSERT(page_table.pointers[page_index]);
+            DEBUG_ASSERT(page_table.pointers.GetUnhidden(page_index));
 
-            u8* dest_ptr = page_table.pointers[page_index] + page_offset;
+            u8* dest_ptr = page_table.pointers.GetUnhidden(page_index) + page_offset;
             std::memset(dest_ptr, 0, copy_amount);
+            impl->MarkDirty(dest_ptr, copy_amount);
             break;
         }
         case PageType::Special: {
@@ -818,14 +1132,16 @@ void MemorySystem::ZeroBlock(const Kernel::Process& process, const VAddr dest_ad
         case PageType::RasterizerCachedMemory: {
             RasterizerFlushVirtualRegion(current_vaddr, static_cast<u32>(copy_amount),
                                          FlushMode::Invalidate);
-            std::memset(GetPointerForRasterizerCache(current_vaddr), 0, copy_amount);
+            u8* const dest_ptr = GetPointerForRasterizerCache(current_vaddr);
+            std::memset(dest_ptr, 0, copy_amount);
+            impl->MarkDirty(dest_ptr, copy_amount);
             break;
         }
         default:
             UNREACHABLE();
         }
 
-        page_index++;
+        page_index += (page_offset + copy_amount) >> PAGE_BITS;
         page_offset = 0;
         remaining_size -= copy_amount;
     }
@@ -845,8 +1161,9 @@ void MemorySystem::CopyBlock(const Kernel::Process& dest_process,
     std::size_t page_offset = src_addr & PAGE_MASK;
 
     while (remaining_size > 0) {
-        const std::size_t copy_amount = std::min(PAGE_SIZE - page_offset, remaining_size);
         const VAddr current_vaddr = static_cast<VAddr>((page_index << PAGE_BITS) + page_offset);
+        const std::size_t copy_amount =
+            GetContiguousBlockSize(page_table, current_vaddr, remaining_size);
 
         switch (page_table.attributes[page_index]) {
         case PageType::Unmapped: {
@@ -858,8 +1175,8 @@ void MemorySystem::CopyBlock(const Kernel::Process& dest_process,
             break;
         }
         case PageType::Memory: {
-            DEBUG_ASSERT(page_table.pointers[page_index]);
-            const u8* src_ptr = page_table.pointers[page_index] + page_offset;
+            DEBUG_ASSERT(page_table.pointers.GetUnhidden(page_index));
+            const u8* src_ptr = page_table.pointers.GetUnhidden(page_index) + page_offset;
             WriteBlock(dest_process, dest_addr, src_ptr, copy_amount);
             break;
         }
@@ -882,7 +1199,7 @@ void MemorySystem::CopyBlock(const Kernel::Process& dest_process,
             UNREACHABLE();
         }
 
-        page_index++;
+        page_index += (page_offset + copy_amount) >> PAGE_BITS;
         page_offset = 0;
         dest_addr += static_cast<VAddr>(copy_amount);
         src_addr += static_cast<VAddr>(copy_amount);
@@ -931,18 +1248,126 @@ void WriteMMIO<u64>(MMIORegionPointer mmio_handler, VAddr addr, const u64 data)
 }
 
 u32 MemorySystem::GetFCRAMOffset(const u8* pointer) const {
-    ASSERT(pointer >= impl->fcram.get() && pointer <= impl->fcram.get() + Memory::FCRAM_N3DS_SIZE);
-    return static_cast<u32>(pointer - impl->fcram.get());
+    ASSERT(pointer >= impl->fcram && pointer <= impl->fcram + Memory::FCRAM_N3DS_SIZE);
+    return static_cast<u32>(pointer - impl->fcram);
+}
+
+void MemorySystem::SetDirtyTracking(bool enabled) {
+    if (enabled && !impl->dirty_pages) {
+        impl->dirty_pages = std::make_unique<std::atomic<u64>[]>(
+            (impl->backing.Size() / PAGE_SIZE + 63) / 64);
+    }
+    if (enabled) {
+        ClearDirtyRegions();
+    }
+    if (impl->dirty_tracking == enabled) {
+        return;
+    }
+    impl->dirty_tracking = enabled;
+    for (const auto& page_table : impl->page_table_list) {
+        for (u32 page = 0; page < PAGE_TABLE_NUM_ENTRIES; ++page) {
+            if (page_table->attributes[page] == PageType::Memory) {
+                page_table->pointers.SetHidden(page, impl->IsPageHidden(page));
+            }
+        }
+        impl->UpdateFastmemArena(*page_table, 0, PAGE_TABLE_NUM_ENTRIES);
+    }
+}
+
+bool MemorySystem::IsDirtyTrackingEnabled() const {
+    return impl->dirty_tracking;
+}
+
+void MemorySystem::WatchRegion(VAddr start, u32 size, bool watched) {
+    if (size == 0) {
+        return;
+    }
+    const u32 first_page = start >> PAGE_BITS;
+    const u32 end_page = static_cast<u32>((u64{start} + size - 1) >> PAGE_BITS) + 1;
+    for (u32 page = first_page; page != end_page; ++page) {
+        if (watched) {
+            if (impl->watched_pages[page]++ != 0) {
+                continue;
+            }
+        } else {
+            const auto it = impl->watched_pages.find(page);
+            if (it == impl->watched_pages.end() || --it->second != 0) {
+                continue;
+            }
+            impl->watched_pages.erase(it);
+        }
+        for (const auto& page_table : impl->page_table_list) {
+            if (page_table->attributes[page] == PageType::Memory) {
+                page_table->pointers.SetHidden(page, impl->IsPageHidden(page));
+                impl->UpdateFastmemArena(*page_table, page, 1);
+            }
+        }
+    }
+}
+
+bool MemorySystem::IsMemoryShared() const {
+    return impl->backing.IsShared();
+}
+
+void MemorySystem::MarkRegionDirty(PAddr start, u32 size) {
+    if (!impl->dirty_tracking) {
+        return;
+    }
+    for (const auto& region : Impl::backing_regions) {
+        const PAddr region_end = region.paddr + region.size;
+        if (start >= region_end || start + size <= region.paddr) {
+            continue;
+        }
+        const PAddr overlap_start = std::max(start, region.paddr);
+        const PAddr overlap_end = std::min(start + size, region_end);
+        impl->MarkDirty(region.offset + (overlap_start - region.paddr),
+                        overlap_end - overlap_start);
+    }
+}
+
+std::vector<std::pair<PAddr, u32>> MemorySystem::GetDirtyRegions() const {
+    std::vector<std::pair<PAddr, u32>> regions;
+    if (!impl->dirty_pages) {
+        return regions;
+    }
+    for (const auto& region : Impl::backing_regions) {
+        const std::size_t first_page = region.offset / PAGE_SIZE;
+        const std::size_t num_pages = region.size / PAGE_SIZE;
+        for (std::size_t i = 0; i < num_pages; ++i) {
+            const std::size_t page = first_page + i;
+            if ((impl->dirty_pages[page / 64].load(std::memory_order_relaxed) &
+                 (u64{1} << (page % 64))) == 0) {
+                continue;
+            }
+            const PAddr paddr = region.paddr + static_cast<u32>(i * PAGE_SIZE);
+            if (!regions.empty() && regions.back().first + regions.back().second == paddr) {
+                regions.back().second += PAGE_SIZE;
+            } else {
+                regions.emplace_back(paddr, PAGE_SIZE);
+            }
+        }
+    }
+    return regions;
+}
+
+void MemorySystem::ClearDirtyRegions() {
+    if (!impl->dirty_pages) {
+        return;
+    }
+    const std::size_t num_words = (impl->backing.Size() / PAGE_SIZE + 63) / 64;
+    for (std::size_t i = 0; i < num_words; ++i) {
+        impl->dirty_pages[i].store(0, std::memory_order_relaxed);
+    }
 }
 
 u8* MemorySystem::GetFCRAMPointer(std::size_t offset) {
     ASSERT(offset <= Memory::FCRAM_N3DS_SIZE);
-    return impl->fcram.get() + offset;
+    return impl->fcram + offset;
 }
 
 const u8* MemorySystem::GetFCRAMPointer(std::size_t offset) const {
     ASSERT(offset <= Memory::FCRAM_N3DS_SIZE);
-    return impl->fcram.get() + offset;
+    return impl->fcram + offset;
 }
 
 MemoryRef MemorySystem::GetFCRAMRef(std::size_t offset) const {
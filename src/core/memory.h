@@ -4,10 +4,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdlib>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <boost/serialization/array.hpp>
 #include <boost/serialization/vector.hpp>
@@ -17,6 +20,10 @@
 
 class ARM_Interface;
 
+namespace Common {
+class FastmemArena;
+}
+
 namespace Kernel {
 class Process;
 }
@@ -75,24 +82,40 @@ private:
 struct PageTable {
     /**
      * Array of memory pointers backing each page. An entry can only be non-null if the
-     * corresponding entry in the `attributes` array is of type `Memory`.
+     * corresponding entry in the `attributes` array is of type `Memory`. It is null as well for
+     * the pages of type `Memory` that are hidden while a watchpoint covers them or their writes
+     * are tracked.
      */
 
     // The reason for this rigmarole is to keep the 'raw' and 'refs' arrays in sync.
     // We need 'raw' for dynarmic and 'refs' for serialization
     struct Pointers {
+        /// Number of pages whose references are allocated together, 4 MiB of address space
+        static constexpr std::size_t REF_CHUNK_SIZE = 1024;
+        static constexpr std::size_t NUM_REF_CHUNKS = PAGE_TABLE_NUM_ENTRIES / REF_CHUNK_SIZE;
+
+        using RawArray = std::array<u8*, PAGE_TABLE_NUM_ENTRIES>;
+        using RefChunk = std::array<MemoryRef, REF_CHUNK_SIZE>;
 
         struct Entry {
             Entry(Pointers& pointers_, VAddr idx_) : pointers(pointers_), idx(idx_) {}
 
             Entry& operator=(MemoryRef value) {
-                pointers.raw[idx] = value.GetPtr();
-                pointers.refs[idx] = std::move(value);
+                (*pointers.raw)[idx] = value.GetPtr();
+                auto& chunk = pointers.ref_chunks[idx / REF_CHUNK_SIZE];
+                if (!chunk) {
+                    // Unmapping a page that was never mapped leaves its chunk unallocated
+                    if (!value) {
+                        return *this;
+                    }
+                    chunk = std::make_unique<RefChunk>();
+                }
+                (*chunk)[idx % REF_CHUNK_SIZE] = std::move(value);
                 return *this;
             }
 
             operator u8*() {
-                return pointers.raw[idx];
+                return (*pointers.raw)[idx];
             }
 
         private:
@@ -104,10 +127,43 @@ struct PageTable {
             return Entry(*this, static_cast<VAddr>(idx));
         }
 
+        u8* operator[](std::size_t idx) const {
+            return (*raw)[idx];
+        }
+
+        /// Returns the pointer of the page from its reference, which stays set while the page is
+        /// hidden
+        u8* GetUnhidden(std::size_t idx) const {
+            const auto& chunk = ref_chunks[idx / REF_CHUNK_SIZE];
+            return chunk ? (*chunk)[idx % REF_CHUNK_SIZE].GetPtr() : nullptr;
+        }
+
+        /**
+         * Hides the page from the fast paths and the JIT, which then see a null pointer and go
+         * through the slow path of the memory system, or shows it again. The reference is kept.
+         */
+        void SetHidden(std::size_t idx, bool hidden) {
+            (*raw)[idx] = hidden ? nullptr : GetUnhidden(idx);
+        }
+
     private:
-        std::array<u8*, PAGE_TABLE_NUM_ENTRIES> raw;
+        struct FreeDeleter {
+            void operator()(RawArray* array) const {
+                std::free(array);
+            }
+        };
 
-        std::array<MemoryRef, PAGE_TABLE_NUM_ENTRIES> refs;
+        /// Resets every entry, only touching the parts of the raw array that can be set
+        void Clear();
+
+        // Kept on the heap, so that code compiled against its address can be handed over to
+        // another page table. Allocated zeroed by the system rather than filled, so that the pages
+        // of the array covering unmapped regions are never committed.
+        std::unique_ptr<RawArray, FreeDeleter> raw{
+            static_cast<RawArray*>(std::calloc(1, sizeof(RawArray)))};
+
+        /// The references of the pages, with chunks only allocated where pages have been mapped
+        std::array<std::unique_ptr<RefChunk>, NUM_REF_CHUNKS> ref_chunks;
 
         friend struct PageTable;
     };
@@ -125,20 +181,59 @@ struct PageTable {
      */
     std::array<PageType, PAGE_TABLE_NUM_ENTRIES> attributes;
 
+    /**
+     * Host mirror of the address space, in which the pages of type `Memory` are mapped at their
+     * virtual address and all the others fault. Null when fastmem isn't in use. It is rebuilt from
+     * the arrays above rather than serialized.
+     */
+    std::shared_ptr<Common::FastmemArena> fastmem_arena;
+
+    /**
+     * Identifies the code the owning process was started with and the range it is mapped at, so
+     * that code translated for an exited process can be reused by another one running the same
+     * code. Zero when unknown. Not serialized.
+     */
+    u64 code_hash = 0;
+    VAddr code_begin = 0;
+    VAddr code_end = 0;
+
     std::array<u8*, PAGE_TABLE_NUM_ENTRIES>& GetPointerArray() {
-        return pointers.raw;
+        return *pointers.raw;
     }
 
     void Clear();
 
+    /**
+     * Takes over the pointer array of the donor while keeping the current entries, so that code
+     * bound to the address of that array now sees this page table. The donor gets this page
+     * table's former array and must not be used anymore.
+     */
+    void TakePointerArray(PageTable& donor);
+
 private:
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
-        ar& pointers.refs;
+        // Savestates hold the references of all the pages as a single array
+        const auto all_refs = std::make_unique<std::array<MemoryRef, PAGE_TABLE_NUM_ENTRIES>>();
+        auto& refs = *all_refs;
+        if (Archive::is_saving::value) {
+            for (std::size_t chunk = 0; chunk < Pointers::NUM_REF_CHUNKS; ++chunk) {
+                if (const auto& refs_chunk = pointers.ref_chunks[chunk]) {
+                    std::copy(refs_chunk->begin(), refs_chunk->end(),
+                              refs.begin() + chunk * Pointers::REF_CHUNK_SIZE);
+                }
+            }
+        }
+        ar& refs;
         ar& special_regions;
         ar& attributes;
-        for (std::size_t i = 0; i < PAGE_TABLE_NUM_ENTRIES; i++) {
-            pointers.raw[i] = pointers.refs[i].GetPtr();
+        if (Archive::is_loading::value) {
+            pointers.Clear();
+            for (std::size_t i = 0; i < PAGE_TABLE_NUM_ENTRIES; i++) {
+                if (refs[i]) {
+                    pointers[i] = std::move(refs[i]);
+                }
+            }
         }
     }
     friend class boost::serialization::access;
@@ -281,6 +376,15 @@ enum class FlushMode {
  */
 void RasterizerClearAll(bool flush);
 
+/**
+ * Like RasterizerClearAll, but the rasterizer may keep aside the caches holding the contents of
+ * the memory, to be put back by RasterizerReattachCaches after the state is saved or loaded
+ */
+void RasterizerDetachCaches(bool flush);
+
+/// Puts back the rasterizer caches kept aside whose memory still has the same contents
+void RasterizerReattachCaches();
+
 /**
  * Flushes and invalidates any externally cached rasterizer resources touching the given virtual
  * address region.
@@ -317,6 +421,12 @@ public:
     void SetCurrentPageTable(std::shared_ptr<PageTable> page_table);
     std::shared_ptr<PageTable> GetCurrentPageTable() const;
 
+    /**
+     * Makes the accesses from the calling host thread through Read and Write use the page table
+     * instead of the current one, for a core running on a host thread of its own. Null resets it.
+     */
+    void SetThreadPageTable(PageTable* page_table);
+
     u8 Read8(VAddr addr);
     u16 Read16(VAddr addr);
     u32 Read32(VAddr addr);
@@ -350,6 +460,17 @@ public:
     u8* GetPointer(VAddr vaddr);
     const u8* GetPointer(VAddr vaddr) const;
 
+    /**
+     * Gets a pointer to the size bytes of the process memory at vaddr, for accessing them in
+     * place. Returns nullptr if they aren't all regular memory contiguous in host memory, or if
+     * dirty tracking is enabled, they have to be accessed with ReadBlock and WriteBlock then.
+     */
+    u8* GetContiguousPointer(const Kernel::Process& process, VAddr vaddr, std::size_t size);
+
+    /// Same as above for the memory mapped by the page table, which may be the one of a core
+    /// running on a host thread of its own
+    u8* GetContiguousPointer(PageTable& page_table, VAddr vaddr, std::size_t size);
+
     bool IsValidPhysicalAddress(PAddr paddr) const;
 
     /// Gets offset in FCRAM from a pointer inside FCRAM range
@@ -369,12 +490,55 @@ public:
      */
     void RasterizerMarkRegionCached(PAddr start, u32 size, bool cached);
 
+    /**
+     * Starts or stops recording which pages of FCRAM, VRAM and the N3DS extra RAM are written,
+     * starting clears the record. Meanwhile the pages of type `Memory` are hidden like watched
+     * ones, so that the JIT accesses them through its memory callbacks and every write made
+     * through this class is seen. The callers holding a host pointer aren't, they should report
+     * their writes with MarkRegionDirty.
+     */
+    void SetDirtyTracking(bool enabled);
+    bool IsDirtyTrackingEnabled() const;
+
+    /// Records the physical range as written, if dirty tracking is enabled
+    void MarkRegionDirty(PAddr start, u32 size);
+
+    /**
+     * Returns the physical ranges whose pages were written since dirty tracking started or the
+     * record was last cleared, as merged (start, size) pairs in address order.
+     */
+    std::vector<std::pair<PAddr, u32>> GetDirtyRegions() const;
+
+    void ClearDirtyRegions();
+
+    /**
+     * Starts or stops watching the pages touching the virtual region in every page table. Watched
+     * pages of type `Memory` are hidden, so that the JIT accesses them through its memory
+     * callbacks, where the debugger checks its watchpoints. The calls are counted per page, a page
+     * watched twice must be unwatched twice.
+     */
+    void WatchRegion(VAddr start, u32 size, bool watched);
+
+    /**
+     * Returns true if FCRAM, VRAM and the N3DS extra RAM are a shared memory object, for fastmem.
+     * A forked process then keeps sharing them instead of getting a copy-on-write view.
+     */
+    bool IsMemoryShared() const;
+
     /// Registers page table for rasterizer cache marking
     void RegisterPageTable(std::shared_ptr<PageTable> page_table);
 
     /// Unregisters page table for rasterizer cache marking
     void UnregisterPageTable(std::shared_ptr<PageTable> page_table);
 
+    /**
+     * Hands the host storage the JIT compiles against, the pointer array and the fastmem arena,
+     * from the page table of an exited process over to the page table, keeping the mappings of
+     * the latter. Both page tables must either have a fastmem arena or not. The only JIT that may
+     * still be bound to the storage of either page table is the one taking over the donor's.
+     */
+    void TakePageTableStorage(PageTable& page_table, PageTable& donor);
+
     void SetDSP(AudioCore::DspInterface& dsp);
 
 private:
@@ -392,6 +556,14 @@ private:
      */
     MemoryRef GetPointerForRasterizerCache(VAddr addr) const;
 
+    /**
+     * Returns how many of the size bytes starting at vaddr can be accessed as one block: the
+     * following pages have the same type and, for memory, are contiguous in host memory. MMIO
+     * pages are accessed one page at a time.
+     */
+    std::size_t GetContiguousBlockSize(const PageTable& page_table, VAddr vaddr,
+                                       std::size_t size) const;
+
     void MapPages(PageTable& page_table, u32 base, u32 size, MemoryRef memory, PageType type);
 
     class Impl;
@@ -0,0 +1,102 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include <fmt/format.h>
+#include "common/logging/log.h"
+#include "common/metrics.h"
+#include "core/metrics_server.h"
+
+namespace Core {
+
+class MetricsServer::Impl {
+public:
+    explicit Impl(u16 port)
+        : acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
+          socket(io_context) {
+
+        StartAccept();
+        worker_thread = std::thread([this] { io_context.run(); });
+    }
+
+    ~Impl() {
+        io_context.stop();
+        worker_thread.join();
+    }
+
+private:
+    void StartAccept() {
+        acceptor.async_accept(socket, [this](const boost::system::error_code& error) {
+            if (error) {
+                LOG_WARNING(Core, "Failed to accept metrics connection: {}", error.message());
+                StartAccept();
+                return;
+            }
+            request.clear();
+            StartRead();
+        });
+    }
+
+    void StartRead() {
+        boost::asio::async_read_until(
+            socket, boost::asio::dynamic_buffer(request, MaxRequestSize), "\r\n\r\n",
+            [this](const boost::system::error_code& error, std::size_t) {
+                if (error) {
+                    CloseConnection();
+                    return;
+                }
+                StartWrite();
+            });
+    }
+
+    void StartWrite() {
+        std::string body;
+        const char* status;
+        if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0) {
+            status = "200 OK";
+            body = Common::Metrics::Serialize();
+        } else {
+            status = "404 Not Found";
+        }
+        response = fmt::format("HTTP/1.1 {}\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: {}\r\n"
+                               "Connection: close\r\n"
+                               "\r\n"
+                               "{}",
+                               status, body.size(), body);
+        boost::asio::async_write(socket, boost::asio::buffer(response),
+                                 [this](const boost::system::error_code&, std::size_t) {
+                                     CloseConnection();
+                                 });
+    }
+
+    void CloseConnection() {
+        boost::system::error_code error;
+        socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+        socket.close(error);
+        StartAccept();
+    }
+
+    /// Scrapers send short requests, anything longer is dropped
+    static constexpr std::size_t MaxRequestSize = 0x2000;
+
+    std::thread worker_thread;
+
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor;
+    boost::asio::ip::tcp::socket socket;
+    std::string request;
+    std::string response;
+};
+
+MetricsServer::MetricsServer(u16 port) : impl(std::make_unique<Impl>(port)) {
+    LOG_INFO(Core, "Serving metrics on port {}", port);
+}
+
+MetricsServer::~MetricsServer() = default;
+
+} // namespace Core
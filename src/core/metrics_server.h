@@ -0,0 +1,27 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include "common/common_types.h"
+
+namespace Core {
+
+/**
+ * Minimal HTTP server answering GET /metrics with the metrics of common/metrics.h in the
+ * Prometheus text format, so that monitoring systems can scrape running instances. Requests are
+ * served on a thread of the server, one connection at a time.
+ */
+class MetricsServer {
+public:
+    explicit MetricsServer(u16 port);
+    ~MetricsServer();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace Core
@@ -2,7 +2,10 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <boost/optional.hpp>
@@ -15,7 +18,9 @@
 #include "common/string_util.h"
 #include "common/swap.h"
 #include "common/timer.h"
+#include "common/zstd_compression.h"
 #include "core/core.h"
+#include "core/core_timing.h"
 #include "core/hle/service/hid/hid.h"
 #include "core/hle/service/ir/extra_hid.h"
 #include "core/hle/service/ir/ir_rst.h"
@@ -111,16 +116,40 @@ static_assert(sizeof(ControllerState) == 7, "ControllerState should be 7 bytes")
 
 constexpr std::array<u8, 4> header_magic_bytes{{'C', 'T', 'M', 0x1B}};
 
+/// The movies of the first format have a version of 0 and their input follows the header as is.
+/// Those of the second one are made of chunks, see CTMChunkHeader.
+constexpr u32 movie_format_version = 2;
+
+/// Uncompressed size of the input blocks of a movie
+constexpr std::size_t input_block_size = 64 * 1024;
+
+constexpr s32 keyframe_compression_level = 3;
+
 #pragma pack(push, 1)
 struct CTMHeader {
     std::array<u8, 4> filetype;  /// Unique Identifier to check the file type (always "CTM"0x1B)
     u64_le program_id;           /// ID of the ROM being executed. Also called title_id
     std::array<u8, 20> revision; /// Git hash of the revision this movie was created with
     u64_le clock_init_time;      /// The init time of the system clock
+    u32_le format_version;       /// Format of what follows the header
+    u64_le input_size;           /// Uncompressed size of the input, in the second format
 
-    std::array<u8, 216> reserved; /// Make heading 256 bytes so it has consistent size
+    std::array<u8, 204> reserved; /// Make heading 256 bytes so it has consistent size
 };
 static_assert(sizeof(CTMHeader) == 256, "CTMHeader should be 256 bytes");
+
+enum class CTMChunkType : u8 {
+    Input,    ///< A zstd compressed block of the input
+    Keyframe, ///< A zstd compressed savestate
+};
+
+struct CTMChunkHeader {
+    CTMChunkType type;
+    u32_le compressed_size; /// Size of the chunk data that follows
+    u64_le input_offset;    /// Where the block goes in the input, or where it goes on from the state
+    u64_le ticks;           /// Global ticks at which the state was taken
+};
+static_assert(sizeof(CTMChunkHeader) == 21, "CTMChunkHeader should be 21 bytes");
 #pragma pack(pop)
 
 bool Movie::IsPlayingInput() const {
@@ -402,8 +431,31 @@ void Movie::SaveMovie() {
                            new CryptoPP::HexDecoder(new CryptoPP::StringSink(rev_bytes)));
     std::memcpy(header.revision.data(), rev_bytes.data(), sizeof(CTMHeader::revision));
 
+    header.format_version = movie_format_version;
+    header.input_size = recorded_input.size();
+
     save_record.WriteBytes(&header, sizeof(CTMHeader));
-    save_record.WriteBytes(recorded_input.data(), recorded_input.size());
+    for (std::size_t offset = 0; offset < recorded_input.size(); offset += input_block_size) {
+        const std::size_t size = std::min(input_block_size, recorded_input.size() - offset);
+        const std::vector<u8> compressed =
+            Common::Compression::CompressDataZSTDDefault(recorded_input.data() + offset, size);
+
+        CTMChunkHeader chunk{};
+        chunk.type = CTMChunkType::Input;
+        chunk.compressed_size = static_cast<u32>(compressed.size());
+        chunk.input_offset = offset;
+        save_record.WriteBytes(&chunk, sizeof(CTMChunkHeader));
+        save_record.WriteBytes(compressed.data(), compressed.size());
+    }
+    for (const Keyframe& keyframe : keyframes) {
+        CTMChunkHeader chunk{};
+        chunk.type = CTMChunkType::Keyframe;
+        chunk.compressed_size = static_cast<u32>(keyframe.compressed.size());
+        chunk.input_offset = keyframe.input_offset;
+        chunk.ticks = keyframe.ticks;
+        save_record.WriteBytes(&chunk, sizeof(CTMChunkHeader));
+        save_record.WriteBytes(keyframe.compressed.data(), keyframe.compressed.size());
+    }
 
     if (!save_record.IsGood()) {
         LOG_ERROR(Movie, "Error saving movie");
@@ -420,9 +472,18 @@ void Movie::StartPlayback(const std::string& movie_file,
         CTMHeader header;
         save_record.ReadArray(&header, 1);
         if (ValidateHeader(header) != ValidationResult::Invalid) {
+            keyframes.clear();
+            if (header.format_version == 0) {
+                recorded_input.resize(size - sizeof(CTMHeader));
+                save_record.ReadArray(recorded_input.data(), recorded_input.size());
+            } else if (!ReadMovieChunks(save_record, header)) {
+                LOG_ERROR(Movie, "Failed to playback movie: '{}' is corrupted", movie_file);
+                recorded_input.clear();
+                keyframes.clear();
+                return;
+            }
             play_mode = PlayMode::Playing;
-            recorded_input.resize(size - sizeof(CTMHeader));
-            save_record.ReadArray(recorded_input.data(), recorded_input.size());
+            play_movie_file = movie_file;
             current_byte = 0;
             playback_completion_callback = completion_callback;
         }
@@ -435,6 +496,145 @@ void Movie::StartRecording(const std::string& movie_file) {
     LOG_INFO(Movie, "Enabling Movie recording");
     play_mode = PlayMode::Recording;
     record_movie_file = movie_file;
+    keyframes.clear();
+
+    // The recording starts at the boot, where the movie can be played from anyway
+    const u32 interval = Settings::values.movie_keyframe_interval;
+    next_keyframe_ticks = interval != 0 ? msToCycles(static_cast<int>(interval * 1000))
+                                        : std::numeric_limits<u64>::max();
+}
+
+bool Movie::ReadMovieChunks(FileUtil::IOFile& file, const CTMHeader& header) {
+    if (header.format_version != movie_format_version) {
+        LOG_ERROR(Movie, "Unsupported movie format version {}",
+                  static_cast<u32>(header.format_version));
+        return false;
+    }
+
+    // Each input block takes at least a chunk header, which bounds the size of the input before
+    // it is allocated
+    const u64 file_size = file.GetSize();
+    if (header.input_size > file_size / sizeof(CTMChunkHeader) * input_block_size) {
+        return false;
+    }
+    recorded_input.assign(header.input_size, 0);
+
+    std::vector<u8> compressed;
+    CTMChunkHeader chunk;
+    while (file.Tell() < file_size) {
+        if (file.ReadBytes(&chunk, sizeof(CTMChunkHeader)) != sizeof(CTMChunkHeader) ||
+            chunk.compressed_size > file_size - file.Tell()) {
+            return false;
+        }
+        switch (chunk.type) {
+        case CTMChunkType::Input: {
+            if (chunk.input_offset >= recorded_input.size()) {
+                return false;
+            }
+            compressed.resize(chunk.compressed_size);
+            file.ReadBytes(compressed.data(), compressed.size());
+            const u64 max_size = std::min<u64>(input_block_size,
+                                               recorded_input.size() - chunk.input_offset);
+            const std::vector<u8> block = Common::Compression::DecompressDataZSTDBounded(
+                compressed.data(), compressed.size(), static_cast<std::size_t>(max_size));
+            if (block.empty()) {
+                return false;
+            }
+            std::copy(block.begin(), block.end(), recorded_input.begin() + chunk.input_offset);
+            break;
+        }
+        case CTMChunkType::Keyframe:
+            if (chunk.input_offset > recorded_input.size()) {
+                return false;
+            }
+            // The states are only read when seeking to them
+            keyframes.push_back(
+                {chunk.ticks, chunk.input_offset, {}, file.Tell(), chunk.compressed_size});
+            file.Seek(chunk.compressed_size, SEEK_CUR);
+            break;
+        default:
+            LOG_WARNING(Movie, "Skipping movie chunk of unknown type {}",
+                        static_cast<u32>(chunk.type));
+            file.Seek(chunk.compressed_size, SEEK_CUR);
+            break;
+        }
+    }
+
+    std::sort(keyframes.begin(), keyframes.end(),
+              [](const Keyframe& a, const Keyframe& b) { return a.ticks < b.ticks; });
+    return file.IsGood();
+}
+
+void Movie::SeekPlayback(u64 time_ms) {
+    pending_seek_ticks = BASE_CLOCK_RATE_ARM11 * time_ms / 1000;
+}
+
+bool Movie::ServeKeyframes(System& system) {
+    if (IsRecordingInput() &&
+        static_cast<u64>(system.CoreTiming().GetGlobalTicks()) >= next_keyframe_ticks) {
+        TakeKeyframe(system);
+    }
+    if (IsPlayingInput() && pending_seek_ticks) {
+        const u64 seek_ticks = *pending_seek_ticks;
+        pending_seek_ticks.reset();
+        return SeekToKeyframe(system, seek_ticks);
+    }
+    return false;
+}
+
+void Movie::TakeKeyframe(System& system) {
+    const u64 ticks = static_cast<u64>(system.CoreTiming().GetGlobalTicks());
+    std::vector<u8> state;
+    try {
+        state = system.SaveStateToBuffer();
+    } catch (const std::exception& e) {
+        LOG_ERROR(Movie, "Disabling the movie keyframes, the state can't be saved: {}", e.what());
+        next_keyframe_ticks = std::numeric_limits<u64>::max();
+        return;
+    }
+
+    const u32 interval = Settings::values.movie_keyframe_interval;
+    next_keyframe_ticks = ticks + msToCycles(static_cast<int>(interval * 1000));
+    keyframes.push_back({ticks, recorded_input.size(),
+                         Common::Compression::CompressDataZSTDSeekable(
+                             state.data(), state.size(), keyframe_compression_level),
+                         0, 0});
+    LOG_DEBUG(Movie, "Keyframe at input offset {}, {} bytes", recorded_input.size(),
+              keyframes.back().compressed.size());
+}
+
+bool Movie::SeekToKeyframe(System& system, u64 ticks) {
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), ticks,
+                                     [](u64 t, const Keyframe& k) { return t < k.ticks; });
+    if (keyframe == keyframes.begin()) {
+        LOG_INFO(Movie, "No keyframe to seek to, playing from the start");
+        return false;
+    }
+    --keyframe;
+
+    FileUtil::IOFile file(play_movie_file, "rb");
+    std::vector<u8> compressed(keyframe->compressed_size);
+    if (!file.Seek(static_cast<s64>(keyframe->file_offset), SEEK_SET) ||
+        file.ReadBytes(compressed.data(), compressed.size()) != compressed.size()) {
+        throw std::runtime_error("Unable to read the movie keyframe");
+    }
+    const std::vector<u8> state = Common::Compression::DecompressDataZSTD(compressed);
+    if (state.empty()) {
+        throw std::runtime_error("The movie keyframe is corrupted");
+    }
+
+    // The state holds the input recorded up to it, the playback goes on with the whole input
+    std::vector<u8> input = std::move(recorded_input);
+    try {
+        system.LoadStateFromBuffer(state);
+    } catch (...) {
+        recorded_input = std::move(input);
+        throw;
+    }
+    recorded_input = std::move(input);
+    current_byte = static_cast<std::size_t>(keyframe->input_offset);
+    LOG_INFO(Movie, "Seeked to the keyframe at input offset {}", current_byte);
+    return true;
 }
 
 static boost::optional<CTMHeader> ReadHeader(const std::string& movie_file) {
@@ -494,6 +694,9 @@ void Movie::Shutdown() {
     play_mode = PlayMode::None;
     recorded_input.resize(0);
     record_movie_file.clear();
+    play_movie_file.clear();
+    keyframes.clear();
+    pending_seek_ticks.reset();
     current_byte = 0;
     init_time = 0;
 }
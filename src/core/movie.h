@@ -5,9 +5,16 @@
 #pragma once
 
 #include <functional>
+#include <optional>
+#include <string>
+#include <vector>
 #include <boost/serialization/vector.hpp>
 #include "common/common_types.h"
 
+namespace FileUtil {
+class IOFile;
+}
+
 namespace Service {
 namespace HID {
 struct AccelerometerDataEntry;
@@ -22,6 +29,7 @@ union PadState;
 } // namespace Service
 
 namespace Core {
+class System;
 struct CTMHeader;
 struct ControllerState;
 enum class PlayMode;
@@ -60,6 +68,20 @@ public:
 
     void Shutdown();
 
+    /**
+     * Makes the playback go to the last keyframe of the movie at or before the given emulated
+     * time, once the run loop comes by. The playback goes on from the start if there is none.
+     */
+    void SeekPlayback(u64 time_ms);
+
+    /**
+     * Called by the run loop between two slices. Embeds a keyframe in the recording when one is
+     * due, and serves the pending seek of the playback.
+     * @returns whether the state was replaced by a keyframe.
+     * @throws std::runtime_error if the keyframe can't be loaded.
+     */
+    bool ServeKeyframes(System& system);
+
     /**
      * When recording: Takes a copy of the given input states so they can be used for playback
      * When playing: Replaces the given input states with the ones stored in the playback file
@@ -125,8 +147,25 @@ private:
 
     ValidationResult ValidateHeader(const CTMHeader& header, u64 program_id = 0) const;
 
+    /// Reads the input blocks and indexes the keyframes of a movie of the second format
+    bool ReadMovieChunks(FileUtil::IOFile& file, const CTMHeader& header);
+
+    void TakeKeyframe(System& system);
+    bool SeekToKeyframe(System& system, u64 ticks);
+
     void SaveMovie();
 
+    /// A savestate embedded in the movie
+    struct Keyframe {
+        u64 ticks;        ///< Global ticks at which the state was taken
+        u64 input_offset; ///< Where the input goes on from the state
+        /// The compressed state of a recording, empty when playing as the state is read from the
+        /// movie file when seeking
+        std::vector<u8> compressed;
+        u64 file_offset;
+        u32 compressed_size;
+    };
+
     PlayMode play_mode;
     std::string record_movie_file;
     std::vector<u8> recorded_input;
@@ -134,6 +173,11 @@ private:
     std::function<void()> playback_completion_callback;
     std::size_t current_byte = 0;
 
+    std::string play_movie_file;
+    std::vector<Keyframe> keyframes;
+    u64 next_keyframe_ticks = 0;
+    std::optional<u64> pending_seek_ticks;
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
         // Only serialize what's needed to make savestates useful for TAS:
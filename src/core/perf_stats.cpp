@@ -11,6 +11,7 @@
 #include <fmt/chrono.h>
 #include <fmt/format.h>
 #include "common/file_util.h"
+#include "common/metrics.h"
 #include "core/hw/gpu.h"
 #include "core/perf_stats.h"
 #include "core/settings.h"
@@ -24,8 +25,59 @@ using std::chrono::microseconds;
 // booting that we shouldn't account for
 constexpr std::size_t IgnoreFrames = 5;
 
+static Common::Metrics::Counter system_frames_metric{
+    "citra_system_frames_total", "Emulated LCD VBlanks, 59.83 per second at full speed"};
+static Common::Metrics::Counter game_frames_metric{"citra_game_frames_total",
+                                                   "Frames submitted by the title through GSP"};
+static Common::Metrics::Counter presented_frames_metric{"citra_presented_frames_total",
+                                                        "Frames shown by the renderer"};
+static Common::Metrics::Histogram frame_time_metric{
+    "citra_frame_time_seconds", "Walltime of the system frames, excluding any waits"};
+
 namespace Core {
 
+namespace {
+
+/// Column names of the PerfSubsystems in the frame time breakdown CSV
+constexpr std::array<const char*, NumPerfSubsystems> SubsystemNames{
+    "cpu", "hle", "gpu_commands", "rasterizer", "audio", "present",
+};
+
+/// Walltime charged to each PerfSubsystem by all threads since the end of the last system frame
+std::array<std::atomic<PerfStats::Clock::rep>, NumPerfSubsystems> subsystem_time{};
+
+/// PerfSubsystem the calling thread is currently charging its walltime to
+struct ThreadSubsystemState {
+    PerfSubsystem current = PerfSubsystem::Count;
+    PerfStats::Clock::time_point since = PerfStats::Clock::now();
+};
+
+thread_local ThreadSubsystemState thread_subsystem_state;
+
+/// Charges the walltime since the last switch of the calling thread to its current subsystem
+void ChargeThreadSubsystem(ThreadSubsystemState& state, PerfStats::Clock::time_point now) {
+    if (state.current != PerfSubsystem::Count) {
+        subsystem_time[static_cast<std::size_t>(state.current)].fetch_add(
+            (now - state.since).count(), std::memory_order_relaxed);
+    }
+    state.since = now;
+}
+
+} // Anonymous namespace
+
+ScopedPerfSubsystem::ScopedPerfSubsystem(PerfSubsystem subsystem) {
+    ThreadSubsystemState& state = thread_subsystem_state;
+    ChargeThreadSubsystem(state, PerfStats::Clock::now());
+    previous = state.current;
+    state.current = subsystem;
+}
+
+ScopedPerfSubsystem::~ScopedPerfSubsystem() {
+    ThreadSubsystemState& state = thread_subsystem_state;
+    ChargeThreadSubsystem(state, PerfStats::Clock::now());
+    state.current = previous;
+}
+
 PerfStats::PerfStats(u64 title_id) : title_id(title_id) {}
 
 PerfStats::~PerfStats() {
@@ -43,12 +95,42 @@ PerfStats::~PerfStats() {
         fmt::format("{}/{:%F-%H-%M}_{:016X}.csv", path, *std::localtime(&t), title_id);
     FileUtil::IOFile file(filename, "w");
     file.WriteString(stream.str());
+
+    WriteFrameBreakdowns(
+        fmt::format("{}/{:%F-%H-%M}_{:016X}_breakdown.csv", path, *std::localtime(&t), title_id));
+}
+
+void PerfStats::WriteFrameBreakdowns(const std::string& filename) const {
+    std::string csv = "frametime";
+    for (const char* name : SubsystemNames) {
+        csv += fmt::format(",{}", name);
+    }
+    csv += '\n';
+
+    const std::size_t count = std::min(frame_breakdown_count, frame_breakdowns.size());
+    const std::size_t first = frame_breakdown_count - count;
+    for (std::size_t i = std::max(first, IgnoreFrames); i < frame_breakdown_count; ++i) {
+        const FrameBreakdown& frame = frame_breakdowns[i % frame_breakdowns.size()];
+        csv += fmt::format("{}", frame.frametime);
+        for (const float time : frame.subsystem_time) {
+            csv += fmt::format(",{}", time);
+        }
+        csv += '\n';
+    }
+
+    FileUtil::IOFile file(filename, "w");
+    file.WriteString(csv);
 }
 
 void PerfStats::BeginSystemFrame() {
     std::lock_guard lock{object_mutex};
 
     frame_begin = Clock::now();
+    // Drop what was charged in between frames, e.g. by the frame limiting
+    ChargeThreadSubsystem(thread_subsystem_state, frame_begin);
+    for (auto& time : subsystem_time) {
+        time.store(0, std::memory_order_relaxed);
+    }
 }
 
 void PerfStats::EndSystemFrame() {
@@ -61,7 +143,20 @@ void PerfStats::EndSystemFrame() {
             std::chrono::duration<double, std::milli>(frame_time).count();
     }
     accumulated_frametime += frame_time;
+
+    // Charge the scope this thread may still be in up to the end of the frame
+    ChargeThreadSubsystem(thread_subsystem_state, frame_end);
+    FrameBreakdown& breakdown =
+        frame_breakdowns[frame_breakdown_count++ % frame_breakdowns.size()];
+    breakdown.frametime = std::chrono::duration<float, std::milli>(frame_time).count();
+    for (std::size_t i = 0; i < NumPerfSubsystems; ++i) {
+        const Clock::duration time{subsystem_time[i].exchange(0, std::memory_order_relaxed)};
+        accumulated_subsystem_time[i] += time;
+        breakdown.subsystem_time[i] = std::chrono::duration<float, std::milli>(time).count();
+    }
     system_frames += 1;
+    system_frames_metric.Add();
+    frame_time_metric.Observe(frame_time);
 
     previous_frame_length = frame_end - previous_frame_end;
     previous_frame_end = frame_end;
@@ -71,6 +166,17 @@ void PerfStats::EndGameFrame() {
     std::lock_guard lock{object_mutex};
 
     game_frames += 1;
+    game_frames_metric.Add();
+}
+
+void PerfStats::AddPresentedFrames(u32 count, Clock::duration total_latency,
+                                   Clock::duration max_interval) {
+    std::lock_guard lock{object_mutex};
+
+    presented_frames += count;
+    presented_frames_metric.Add(count);
+    accumulated_present_latency += total_latency;
+    max_present_interval = std::max(max_present_interval, max_interval);
 }
 
 double PerfStats::GetMeanFrametime() {
@@ -99,6 +205,16 @@ PerfStats::Results PerfStats::GetAndResetStats(microseconds current_system_time_
     results.frametime = duration_cast<DoubleSecs>(accumulated_frametime).count() /
                         static_cast<double>(system_frames);
     results.emulation_speed = system_us_per_second.count() / 1'000'000.0;
+    results.present_latency =
+        presented_frames != 0 ? duration_cast<DoubleSecs>(accumulated_present_latency).count() /
+                                    static_cast<double>(presented_frames)
+                              : 0.0;
+    results.max_present_interval = duration_cast<DoubleSecs>(max_present_interval).count();
+    for (std::size_t i = 0; i < NumPerfSubsystems; ++i) {
+        results.subsystem_frametime[i] =
+            duration_cast<DoubleSecs>(accumulated_subsystem_time[i]).count() /
+            static_cast<double>(system_frames);
+    }
 
     // Reset counters
     reset_point = now;
@@ -106,6 +222,10 @@ PerfStats::Results PerfStats::GetAndResetStats(microseconds current_system_time_
     accumulated_frametime = Clock::duration::zero();
     system_frames = 0;
     game_frames = 0;
+    presented_frames = 0;
+    accumulated_present_latency = Clock::duration::zero();
+    max_present_interval = Clock::duration::zero();
+    accumulated_subsystem_time.fill(Clock::duration::zero());
 
     return results;
 }
@@ -117,6 +237,68 @@ double PerfStats::GetLastFrameTimeScale() {
     return duration_cast<DoubleSecs>(previous_frame_length).count() / FRAME_LENGTH;
 }
 
+std::vector<PerfStats::FrameBreakdown> PerfStats::GetFrameBreakdowns() {
+    std::lock_guard lock{object_mutex};
+
+    const std::size_t count = std::min(frame_breakdown_count, frame_breakdowns.size());
+    std::vector<FrameBreakdown> breakdowns;
+    breakdowns.reserve(count);
+    for (std::size_t i = frame_breakdown_count - count; i < frame_breakdown_count; ++i) {
+        breakdowns.push_back(frame_breakdowns[i % frame_breakdowns.size()]);
+    }
+    return breakdowns;
+}
+
+bool PerfStats::WriteBenchmarkReport(const std::string& filename, double wall_time) {
+    std::vector<FrameBreakdown> breakdowns = GetFrameBreakdowns();
+    std::size_t emulated_frames;
+    {
+        std::lock_guard lock{object_mutex};
+        emulated_frames = frame_breakdown_count;
+    }
+    if (emulated_frames <= breakdowns.size()) {
+        breakdowns.erase(breakdowns.begin(),
+                         breakdowns.begin() + std::min(IgnoreFrames, breakdowns.size()));
+    }
+
+    std::vector<float> frametimes(breakdowns.size());
+    std::transform(breakdowns.begin(), breakdowns.end(), frametimes.begin(),
+                   [](const FrameBreakdown& frame) { return frame.frametime; });
+    std::sort(frametimes.begin(), frametimes.end());
+    const auto percentile = [&frametimes](double fraction) {
+        if (frametimes.empty()) {
+            return 0.0f;
+        }
+        const auto index = static_cast<std::size_t>(fraction * (frametimes.size() - 1) + 0.5);
+        return frametimes[index];
+    };
+
+    const double mean =
+        frametimes.empty()
+            ? 0.0
+            : std::accumulate(frametimes.begin(), frametimes.end(), 0.0) / frametimes.size();
+
+    std::string json = fmt::format(R"({{"wall_time":{:.3f},"emulated_frames":{},)"
+                                   R"("measured_frames":{},"frametime_ms":{{)",
+                                   wall_time, emulated_frames, frametimes.size());
+    json += fmt::format(R"("mean":{:.3f},"p50":{:.3f},"p90":{:.3f},"p95":{:.3f},"p99":{:.3f},)"
+                        R"("max":{:.3f}}},"subsystem_ms":{{)",
+                        mean, percentile(0.5), percentile(0.9), percentile(0.95), percentile(0.99),
+                        frametimes.empty() ? 0.0f : frametimes.back());
+    for (std::size_t i = 0; i < NumPerfSubsystems; ++i) {
+        double total = 0.0;
+        for (const FrameBreakdown& frame : breakdowns) {
+            total += frame.subsystem_time[i];
+        }
+        json += fmt::format(R"({}"{}":{:.3f})", i == 0 ? "" : ",", SubsystemNames[i],
+                            breakdowns.empty() ? 0.0 : total / breakdowns.size());
+    }
+    json += "}}\n";
+
+    FileUtil::IOFile file(filename, "w");
+    return file.IsOpen() && file.WriteString(json) == json.size();
+}
+
 void FrameLimiter::WaitOnce() {
     if (frame_advancing_enabled) {
         // Frame advancing is enabled: wait on event instead of doing framelimiting
@@ -168,6 +350,13 @@ void FrameLimiter::DoFrameLimiting(microseconds current_system_time_us) {
     previous_walltime = now;
 }
 
+bool FrameLimiter::IsFastForwarding() const {
+    const u16 limit = Settings::values.use_frame_limit_alternate
+                          ? Settings::values.frame_limit_alternate
+                          : Settings::values.frame_limit;
+    return limit == 0 || limit > 100;
+}
+
 void FrameLimiter::SetFrameAdvancing(bool value) {
     const bool was_enabled = frame_advancing_enabled.exchange(value);
     if (was_enabled && !value) {
@@ -9,11 +9,43 @@
 #include <chrono>
 #include <cstddef>
 #include <mutex>
+#include <string>
+#include <vector>
 #include "common/common_types.h"
 #include "common/thread.h"
 
 namespace Core {
 
+/// Parts of the emulator whose walltime is broken down for every system frame
+enum class PerfSubsystem : u8 {
+    CPU,         ///< Guest code running in the JIT or the interpreter
+    HLE,         ///< SVCs and the HLE services they call into
+    GPUCommands, ///< PICA command list processing, including software vertex shading
+    Rasterizer,  ///< Draw calls of the hardware renderer
+    Audio,       ///< Audio frames generated by the HLE DSP
+    Present,     ///< Drawing the screens and handing them over for presentation
+    Count,
+};
+
+constexpr std::size_t NumPerfSubsystems = static_cast<std::size_t>(PerfSubsystem::Count);
+
+/**
+ * Charges the walltime the calling thread spends in its scope to a subsystem of the frame time
+ * breakdown. A nested scope takes over from the enclosing one until it ends, so each subsystem
+ * only counts its own work.
+ */
+class ScopedPerfSubsystem {
+public:
+    explicit ScopedPerfSubsystem(PerfSubsystem subsystem);
+    ~ScopedPerfSubsystem();
+
+    ScopedPerfSubsystem(const ScopedPerfSubsystem&) = delete;
+    ScopedPerfSubsystem& operator=(const ScopedPerfSubsystem&) = delete;
+
+private:
+    PerfSubsystem previous;
+};
+
 /**
  * Class to manage and query performance/timing statistics. All public functions of this class are
  * thread-safe unless stated otherwise.
@@ -35,12 +67,34 @@ public:
         double frametime;
         /// Ratio of walltime / emulated time elapsed
         double emulation_speed;
+        /// Walltime from the start of a system frame until it was presented, in seconds. This is
+        /// the latency between the input read during the frame and its display.
+        double present_latency;
+        /// Longest walltime between two newly presented frames, in seconds
+        double max_present_interval;
+        /// Walltime per system frame spent in each PerfSubsystem, in seconds
+        std::array<double, NumPerfSubsystems> subsystem_frametime;
     };
 
+    struct FrameBreakdown {
+        /// Walltime of the system frame, in milliseconds, excluding any waits
+        float frametime;
+        /// Walltime spent in each PerfSubsystem during the frame, in milliseconds. Threads running
+        /// in parallel add up, so the sum can exceed the frametime.
+        std::array<float, NumPerfSubsystems> subsystem_time;
+    };
+
+    /// Number of system frames kept in the frame time breakdown history, ten minutes at 60 FPS
+    static constexpr std::size_t FrameBreakdownHistorySize = 36000;
+
     void BeginSystemFrame();
     void EndSystemFrame();
     void EndGameFrame();
 
+    /// Adds frames shown by the presentation thread, with their total latency from the start of
+    /// the system frame and the longest interval between two of them
+    void AddPresentedFrames(u32 count, Clock::duration total_latency, Clock::duration max_interval);
+
     Results GetAndResetStats(std::chrono::microseconds current_system_time_us);
 
     /**
@@ -54,7 +108,22 @@ public:
      */
     double GetLastFrameTimeScale();
 
+    /// Returns the breakdown of the most recent system frames, from the oldest to the newest
+    std::vector<FrameBreakdown> GetFrameBreakdowns();
+
+    /**
+     * Writes a JSON report for automated benchmarks: the wall time and number of emulated frames,
+     * the percentiles of the frame times and the mean time per frame of each subsystem. The
+     * statistics cover the frame time breakdown history, without the first frames.
+     * @param wall_time Walltime the benchmark took, in seconds
+     * @returns false if the report could not be written
+     */
+    bool WriteBenchmarkReport(const std::string& filename, double wall_time);
+
 private:
+    /// Writes the frame time breakdown history as CSV, with one row per system frame
+    void WriteFrameBreakdowns(const std::string& filename) const;
+
     std::mutex object_mutex{};
 
     /// Title ID for the game that is running. 0 if there is no game running yet
@@ -64,6 +133,10 @@ private:
     /// Stores an hour of historical frametime data useful for processing and tracking performance
     /// regressions with code changes.
     std::array<double, 216000> perf_history = {};
+    /// Ring buffer with the breakdown of the most recent system frames
+    std::array<FrameBreakdown, FrameBreakdownHistorySize> frame_breakdowns = {};
+    /// Number of system frames added to frame_breakdowns since the start
+    std::size_t frame_breakdown_count{0};
 
     /// Point when the cumulative counters were reset
     Clock::time_point reset_point = Clock::now();
@@ -76,6 +149,14 @@ private:
     u32 system_frames = 0;
     /// Cumulative number of game frames (GSP frame submissions) since last reset
     u32 game_frames = 0;
+    /// Cumulative number of frames presented since last reset
+    u32 presented_frames = 0;
+    /// Cumulative latency of the frames presented since last reset
+    Clock::duration accumulated_present_latency = Clock::duration::zero();
+    /// Longest interval between two presented frames since last reset
+    Clock::duration max_present_interval = Clock::duration::zero();
+    /// Cumulative duration spent in each PerfSubsystem since last reset
+    std::array<Clock::duration, NumPerfSubsystems> accumulated_subsystem_time = {};
 
     /// Point when the previous system frame ended
     Clock::time_point previous_frame_end = reset_point;
@@ -100,6 +181,9 @@ public:
     void AdvanceFrame();
     void WaitOnce();
 
+    /// Returns whether the emulation may run faster than the real console
+    bool IsFastForwarding() const;
+
 private:
     /// Emulated system time (in microseconds) at the last limiter invocation
     std::chrono::microseconds previous_system_time_us{0};
@@ -0,0 +1,92 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <utility>
+#include <fmt/format.h>
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "core/ram_storage.h"
+
+namespace Core {
+
+namespace {
+/// Returns the directory the session directories are made in
+std::string GetStorageParentDir() {
+#ifdef __linux__
+    // A tmpfs mounted by every common distribution
+    if (FileUtil::IsDirectory("/dev/shm")) {
+        return "/dev/shm/";
+    }
+#endif
+    return FileUtil::GetUserPath(FileUtil::UserPath::CacheDir) + "storage" DIR_SEP;
+}
+
+/// Copies a directory tree, replacing the files already at the destination
+bool CopyTree(const std::string& source, const std::string& dest) {
+    if (!FileUtil::CreateFullPath(dest)) {
+        return false;
+    }
+    // A template without one of the directories starts it empty
+    if (!FileUtil::IsDirectory(source)) {
+        return true;
+    }
+    return FileUtil::ForeachDirectoryEntry(
+        nullptr, source,
+        [&dest](u64*, const std::string& directory, const std::string& virtual_name) {
+            const std::string source_path = directory + DIR_SEP + virtual_name;
+            const std::string dest_path = dest + virtual_name;
+            if (FileUtil::IsDirectory(source_path)) {
+                return CopyTree(source_path + DIR_SEP, dest_path + DIR_SEP);
+            }
+            return FileUtil::Copy(source_path, dest_path);
+        });
+}
+} // Anonymous namespace
+
+RamStorage::RamStorage(std::string template_dir_, bool persist)
+    : template_dir(std::move(template_dir_)), persist(persist) {
+    original_sdmc_dir = FileUtil::GetUserPath(FileUtil::UserPath::SDMCDir);
+    original_nand_dir = FileUtil::GetUserPath(FileUtil::UserPath::NANDDir);
+    if (template_dir.empty()) {
+        template_dir = FileUtil::GetUserPath(FileUtil::UserPath::UserDir);
+    } else if (template_dir.back() != '/' && template_dir.back() != DIR_SEP_CHR) {
+        template_dir += DIR_SEP;
+    }
+
+    // The name only has to differ from the ones of the other instances running
+    std::random_device random_device;
+    root = fmt::format("{}citra-storage-{:016x}" DIR_SEP, GetStorageParentDir(),
+                       std::uniform_int_distribution<u64>{}(random_device));
+    const std::string sdmc_dir = root + SDMC_DIR DIR_SEP;
+    const std::string nand_dir = root + NAND_DIR DIR_SEP;
+    copied = CopyTree(template_dir + SDMC_DIR DIR_SEP, sdmc_dir) &&
+             CopyTree(template_dir + NAND_DIR DIR_SEP, nand_dir);
+    if (!copied) {
+        LOG_ERROR(Core, "Failed to copy the storage template {} to {}", template_dir, root);
+    }
+    FileUtil::UpdateUserPath(FileUtil::UserPath::SDMCDir, sdmc_dir);
+    FileUtil::UpdateUserPath(FileUtil::UserPath::NANDDir, nand_dir);
+    LOG_INFO(Core, "Using {} as the storage, from {}", root, template_dir);
+}
+
+RamStorage::~RamStorage() {
+    FileUtil::UpdateUserPath(FileUtil::UserPath::SDMCDir, original_sdmc_dir);
+    FileUtil::UpdateUserPath(FileUtil::UserPath::NANDDir, original_nand_dir);
+
+    // An incomplete copy would lose what it is missing from the template
+    if (persist && copied) {
+        // The files deleted during the session have to go from the template as well
+        for (const char* dir : {SDMC_DIR DIR_SEP, NAND_DIR DIR_SEP}) {
+            FileUtil::DeleteDirRecursively(template_dir + dir);
+            if (!CopyTree(root + dir, template_dir + dir)) {
+                LOG_ERROR(Core, "Failed to write the storage back to {}", template_dir);
+            }
+        }
+    }
+    FileUtil::DeleteDirRecursively(root);
+}
+
+} // namespace Core
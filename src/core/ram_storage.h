@@ -0,0 +1,50 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+namespace Core {
+
+/**
+ * Storage of the SD card and the NAND private to one emulation session, for the batch and CI runs.
+ * The "sdmc" and "nand" directories of a template directory, laid out like the user directory, are
+ * copied to a directory of the session on a RAM-backed file system where the host has one, and the
+ * user paths point at the copy while it lives. The save data, extra data and SD card archives then
+ * only copy memory, and instances running at once don't share their files. The copy is written
+ * back to the template when the storage is persisted, otherwise it is thrown away.
+ */
+class RamStorage {
+public:
+    /**
+     * Copies the template in and points the SDMC and NAND paths at the copy.
+     * @param template_dir Directory holding the "sdmc" and "nand" directories to start from,
+     *                     the user directory if empty.
+     * @param persist Whether to write the storage back to the template at the end of the session.
+     */
+    RamStorage(std::string template_dir, bool persist);
+
+    /// Writes the storage back if persisted, restores the user paths and deletes the copy
+    ~RamStorage();
+
+    RamStorage(const RamStorage&) = delete;
+    RamStorage& operator=(const RamStorage&) = delete;
+
+    /// Returns the directory holding the copy of the storage
+    const std::string& GetRoot() const {
+        return root;
+    }
+
+private:
+    std::string template_dir;
+    bool persist;
+    /// Whether the template was copied in whole
+    bool copied = false;
+    std::string root;
+    std::string original_sdmc_dir;
+    std::string original_nand_dir;
+};
+
+} // namespace Core
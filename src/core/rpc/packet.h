@@ -14,6 +14,29 @@ enum class PacketType {
     Undefined = 0,
     ReadMemory,
     WriteMemory,
+    IPCProfilerControl,
+    GetIPCProfile,
+    GetIPCProfileHistogram,
+    ReadMemoryBatch,
+    WriteMemoryBatch,
+    SubscribeMemory,
+    UnsubscribeMemory,
+};
+
+/// Command of an IPCProfilerControl packet, given as its first word
+enum class IPCProfilerCommand : u32 {
+    Disable = 0,
+    Enable = 1,
+    Reset = 2,
+};
+
+/// Reply to a GetIPCProfile packet, the counters saturate at their maximum value
+struct IPCProfileReply {
+    std::array<char, 8> service_name; ///< Not null-terminated when 8 characters long
+    u32 header_code;
+    u32 calls;
+    u64 total_ns;
+    u64 max_ns;
 };
 
 struct PacketHeader {
@@ -23,11 +46,32 @@ struct PacketHeader {
     u32 packet_size;
 };
 
+/// A range of memory of a ReadMemoryBatch or SubscribeMemory packet. The ranges of a
+/// WriteMemoryBatch packet are each followed by their data, padded to a multiple of 4 bytes.
+struct MemoryRange {
+    u32 address;
+    u32 size;
+};
+
 constexpr u32 CURRENT_VERSION = 1;
 constexpr u32 MIN_PACKET_SIZE = sizeof(PacketHeader);
+/// Data size of all the packets but the batched ones
 constexpr u32 MAX_PACKET_DATA_SIZE = 32;
-constexpr u32 MAX_PACKET_SIZE = MIN_PACKET_SIZE + MAX_PACKET_DATA_SIZE;
+/// Data size of the batched packets and of the replies to them, which fit in a UDP datagram
+constexpr u32 MAX_BATCH_PACKET_DATA_SIZE = 0x4000;
+constexpr u32 MAX_PACKET_SIZE = MIN_PACKET_SIZE + MAX_BATCH_PACKET_DATA_SIZE;
 constexpr u32 MAX_READ_SIZE = MAX_PACKET_DATA_SIZE;
+constexpr u32 MAX_HISTOGRAM_BUCKETS_PER_PACKET = MAX_PACKET_DATA_SIZE / sizeof(u32);
+/**
+ * Set in the packet type of a request to have it served when the title submits its next frame,
+ * on the emulation thread. The requests held this way are served one after the other before the
+ * emulation resumes, so they all see the memory in the same state.
+ */
+constexpr u32 FRAME_SYNC_FLAG = 0x80000000;
+/// Memory subscriptions kept at once, the oldest one is dropped for a new one
+constexpr std::size_t MAX_MEMORY_SUBSCRIPTIONS = 16;
+
+static_assert(sizeof(IPCProfileReply) == MAX_PACKET_DATA_SIZE);
 
 class Packet {
 public:
@@ -42,7 +86,11 @@ public:
     }
 
     PacketType GetPacketType() const {
-        return header.packet_type;
+        return static_cast<PacketType>(static_cast<u32>(header.packet_type) & ~FRAME_SYNC_FLAG);
+    }
+
+    bool IsFrameSynchronized() const {
+        return (static_cast<u32>(header.packet_type) & FRAME_SYNC_FLAG) != 0;
     }
 
     u32 GetPacketDataSize() const {
@@ -53,7 +101,7 @@ public:
         return header;
     }
 
-    std::array<u8, MAX_PACKET_DATA_SIZE>& GetPacketData() {
+    std::array<u8, MAX_BATCH_PACKET_DATA_SIZE>& GetPacketData() {
         return packet_data;
     }
 
@@ -70,7 +118,7 @@ private:
     void HandleWriteMemory(u32 address, const u8* data, u32 data_size);
 
     struct PacketHeader header;
-    std::array<u8, MAX_PACKET_DATA_SIZE> packet_data;
+    std::array<u8, MAX_BATCH_PACKET_DATA_SIZE> packet_data;
 
     std::function<void(Packet&)> send_reply_callback;
 };
@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include "common/logging/log.h"
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
+#include "core/hle/kernel/ipc_debugger/profiler.h"
 #include "core/hle/kernel/process.h"
 #include "core/memory.h"
 #include "core/rpc/packet.h"
@@ -24,12 +28,50 @@ RPCServer::~RPCServer() {
     LOG_INFO(RPC_Server, "RPC stopped.");
 }
 
+/// Only allow writing to certain memory regions
+static bool IsWritableAddress(u32 address) {
+    return (address >= Memory::PROCESS_IMAGE_VADDR && address <= Memory::PROCESS_IMAGE_VADDR_END) ||
+           (address >= Memory::HEAP_VADDR && address <= Memory::HEAP_VADDR_END) ||
+           (address >= Memory::N3DS_EXTRA_RAM_VADDR && address <= Memory::N3DS_EXTRA_RAM_VADDR_END);
+}
+
+/**
+ * Reads the ranges of a ReadMemoryBatch or SubscribeMemory packet.
+ * @param reserved Bytes of the reply taken before the data of the ranges
+ * @returns false if the packet isn't a list of ranges or their data doesn't fit in a reply
+ */
+static bool ParseMemoryRanges(Packet& packet, u32 reserved, std::vector<MemoryRange>& ranges) {
+    const u32 size = packet.GetPacketDataSize();
+    if (size == 0 || size % sizeof(MemoryRange) != 0) {
+        return false;
+    }
+    ranges.resize(size / sizeof(MemoryRange));
+    std::memcpy(ranges.data(), packet.GetPacketData().data(), size);
+
+    u64 total_size = reserved;
+    for (const MemoryRange& range : ranges) {
+        total_size += range.size;
+    }
+    return total_size <= MAX_BATCH_PACKET_DATA_SIZE;
+}
+
+/// Reads the ranges one after the other into the buffer
+static void ReadMemoryRanges(const std::vector<MemoryRange>& ranges, u8* buffer) {
+    auto& system = Core::System::GetInstance();
+    const auto& process = *system.Kernel().GetCurrentProcess();
+    for (const MemoryRange& range : ranges) {
+        system.Memory().ReadBlock(process, range.address, buffer, range.size);
+        buffer += range.size;
+    }
+}
+
 void RPCServer::HandleReadMemory(Packet& packet, u32 address, u32 data_size) {
     if (data_size > MAX_READ_SIZE) {
         return;
     }
 
-    // Note: Memory read occurs asynchronously from the state of the emulator
+    // Note: Memory read occurs asynchronously from the state of the emulator, unless the request
+    // waited for a frame
     Core::System::GetInstance().Memory().ReadBlock(
         *Core::System::GetInstance().Kernel().GetCurrentProcess(), address,
         packet.GetPacketData().data(), data_size);
@@ -38,11 +80,9 @@ void RPCServer::HandleReadMemory(Packet& packet, u32 address, u32 data_size) {
 }
 
 void RPCServer::HandleWriteMemory(Packet& packet, u32 address, const u8* data, u32 data_size) {
-    // Only allow writing to certain memory regions
-    if ((address >= Memory::PROCESS_IMAGE_VADDR && address <= Memory::PROCESS_IMAGE_VADDR_END) ||
-        (address >= Memory::HEAP_VADDR && address <= Memory::HEAP_VADDR_END) ||
-        (address >= Memory::N3DS_EXTRA_RAM_VADDR && address <= Memory::N3DS_EXTRA_RAM_VADDR_END)) {
-        // Note: Memory write occurs asynchronously from the state of the emulator
+    if (IsWritableAddress(address)) {
+        // Note: Memory write occurs asynchronously from the state of the emulator, unless the
+        // request waited for a frame
         Core::System::GetInstance().Memory().WriteBlock(
             *Core::System::GetInstance().Kernel().GetCurrentProcess(), address, data, data_size);
         // If the memory happens to be executable code, make sure the changes become visible
@@ -54,15 +94,208 @@ void RPCServer::HandleWriteMemory(Packet& packet, u32 address, const u8* data, u
     packet.SendReply();
 }
 
-bool RPCServer::ValidatePacket(const PacketHeader& packet_header) {
+void RPCServer::HandleIPCProfilerControl(Packet& packet, IPCProfilerCommand command) {
+    auto& profiler = Core::System::GetInstance().Kernel().GetIPCProfiler();
+    switch (command) {
+    case IPCProfilerCommand::Disable:
+        profiler.SetEnabled(false);
+        break;
+    case IPCProfilerCommand::Enable:
+        profiler.SetEnabled(true);
+        break;
+    case IPCProfilerCommand::Reset:
+        profiler.Reset();
+        break;
+    }
+    packet.SetPacketDataSize(0);
+    packet.SendReply();
+}
+
+static u32 SaturateToU32(u64 value) {
+    return static_cast<u32>(std::min<u64>(value, std::numeric_limits<u32>::max()));
+}
+
+void RPCServer::HandleGetIPCProfile(Packet& packet, u32 index) {
+    // An empty reply marks the end of the profiles
+    const auto profile = Core::System::GetInstance().Kernel().GetIPCProfiler().GetProfile(index);
+    if (!profile) {
+        packet.SetPacketDataSize(0);
+        packet.SendReply();
+        return;
+    }
+
+    IPCProfileReply reply{};
+    std::copy_n(profile->service_name.begin(),
+                std::min(profile->service_name.size(), reply.service_name.size()),
+                reply.service_name.begin());
+    reply.header_code = profile->header_code;
+    reply.calls = SaturateToU32(profile->calls);
+    reply.total_ns = profile->total_ns;
+    reply.max_ns = profile->max_ns;
+    std::memcpy(packet.GetPacketData().data(), &reply, sizeof(reply));
+    packet.SetPacketDataSize(sizeof(reply));
+    packet.SendReply();
+}
+
+void RPCServer::HandleGetIPCProfileHistogram(Packet& packet, u32 index, u32 first_bucket) {
+    const auto profile = Core::System::GetInstance().Kernel().GetIPCProfiler().GetProfile(index);
+    if (!profile || first_bucket >= profile->histogram.size()) {
+        packet.SetPacketDataSize(0);
+        packet.SendReply();
+        return;
+    }
+
+    const u32 num_buckets = std::min<u32>(MAX_HISTOGRAM_BUCKETS_PER_PACKET,
+                                          static_cast<u32>(profile->histogram.size()) -
+                                              first_bucket);
+    for (u32 i = 0; i < num_buckets; ++i) {
+        const u32 count = SaturateToU32(profile->histogram[first_bucket + i]);
+        std::memcpy(packet.GetPacketData().data() + i * sizeof(u32), &count, sizeof(count));
+    }
+    packet.SetPacketDataSize(num_buckets * sizeof(u32));
+    packet.SendReply();
+}
+
+void RPCServer::HandleReadMemoryBatch(Packet& packet) {
+    std::vector<MemoryRange> ranges;
+    if (!ParseMemoryRanges(packet, 0, ranges)) {
+        packet.SetPacketDataSize(0);
+        packet.SendReply();
+        return;
+    }
+
+    // Note: Memory read occurs asynchronously from the state of the emulator, unless the request
+    // waited for a frame
+    ReadMemoryRanges(ranges, packet.GetPacketData().data());
+    u32 size = 0;
+    for (const MemoryRange& range : ranges) {
+        size += range.size;
+    }
+    packet.SetPacketDataSize(size);
+    packet.SendReply();
+}
+
+void RPCServer::HandleWriteMemoryBatch(Packet& packet) {
+    auto& system = Core::System::GetInstance();
+    const u8* data = packet.GetPacketData().data();
+    const u32 size = packet.GetPacketDataSize();
+
+    // The ranges are checked as a whole first, so that a malformed packet writes nothing
+    std::vector<std::pair<MemoryRange, const u8*>> writes;
+    u32 offset = 0;
+    while (offset < size) {
+        MemoryRange range;
+        if (size - offset < sizeof(range)) {
+            writes.clear();
+            break;
+        }
+        std::memcpy(&range, data + offset, sizeof(range));
+        offset += sizeof(range);
+        const u32 padded_size = (range.size + 3) & ~3u;
+        if (range.size > size - offset || padded_size > size - offset) {
+            writes.clear();
+            break;
+        }
+        writes.emplace_back(range, data + offset);
+        offset += padded_size;
+    }
+
+    for (const auto& [range, range_data] : writes) {
+        if (!IsWritableAddress(range.address)) {
+            continue;
+        }
+        // Note: Memory write occurs asynchronously from the state of the emulator, unless the
+        // request waited for a frame
+        system.Memory().WriteBlock(*system.Kernel().GetCurrentProcess(), range.address,
+                                   range_data, range.size);
+        system.InvalidateCacheRange(range.address, range.size);
+    }
+    packet.SetPacketDataSize(0);
+    packet.SendReply();
+}
+
+void RPCServer::HandleSubscribeMemory(std::unique_ptr<Packet> packet) {
+    // The frame counter comes before the data of the ranges
+    std::vector<MemoryRange> ranges;
+    const bool valid = ParseMemoryRanges(*packet, sizeof(u32), ranges);
+
+    // The subscription is acknowledged with an empty reply, its frames follow with the same id
+    packet->SetPacketDataSize(0);
+    packet->SendReply();
+    if (!valid) {
+        return;
+    }
+
+    std::lock_guard lock{subscription_mutex};
+    if (subscriptions.size() >= MAX_MEMORY_SUBSCRIPTIONS) {
+        LOG_WARNING(RPC_Server, "Dropping memory subscription {}",
+                    subscriptions.front().packet->GetId());
+        subscriptions.pop_front();
+    }
+    subscriptions.push_back({std::move(packet), std::move(ranges)});
+}
+
+void RPCServer::HandleUnsubscribeMemory(Packet& packet, u32 id) {
+    {
+        std::lock_guard lock{subscription_mutex};
+        const auto it =
+            std::find_if(subscriptions.begin(), subscriptions.end(),
+                         [id](const MemorySubscription& s) { return s.packet->GetId() == id; });
+        if (it != subscriptions.end()) {
+            subscriptions.erase(it);
+        }
+    }
+    packet.SetPacketDataSize(0);
+    packet.SendReply();
+}
+
+void RPCServer::OnFrameSubmitted() {
+    std::vector<std::unique_ptr<Packet>> requests;
+    {
+        std::lock_guard lock{frame_request_mutex};
+        requests.swap(frame_requests);
+    }
+    for (auto& request : requests) {
+        HandleSingleRequest(std::move(request));
+    }
+
+    std::lock_guard lock{subscription_mutex};
+    for (MemorySubscription& subscription : subscriptions) {
+        Packet& packet = *subscription.packet;
+        u8* data = packet.GetPacketData().data();
+        const u32 frame = subscription.frame++;
+        std::memcpy(data, &frame, sizeof(frame));
+        ReadMemoryRanges(subscription.ranges, data + sizeof(frame));
+
+        u32 size = sizeof(frame);
+        for (const MemoryRange& range : subscription.ranges) {
+            size += range.size;
+        }
+        packet.SetPacketDataSize(size);
+        packet.SendReply();
+    }
+}
+
+bool RPCServer::ValidatePacket(const Packet& packet) {
+    const PacketHeader& packet_header = packet.GetHeader();
     if (packet_header.version <= CURRENT_VERSION) {
-        switch (packet_header.packet_type) {
+        switch (packet.GetPacketType()) {
         case PacketType::ReadMemory:
         case PacketType::WriteMemory:
-            if (packet_header.packet_size >= (sizeof(u32) * 2)) {
+        case PacketType::IPCProfilerControl:
+        case PacketType::GetIPCProfile:
+        case PacketType::GetIPCProfileHistogram:
+        case PacketType::UnsubscribeMemory:
+            if (packet_header.packet_size >= (sizeof(u32) * 2) &&
+                packet_header.packet_size <= MAX_PACKET_DATA_SIZE) {
                 return true;
             }
             break;
+        // The batched requests check the contents of their data themselves
+        case PacketType::ReadMemoryBatch:
+        case PacketType::WriteMemoryBatch:
+        case PacketType::SubscribeMemory:
+            return packet_header.packet_size <= MAX_BATCH_PACKET_DATA_SIZE;
         default:
             break;
         }
@@ -73,7 +306,13 @@ bool RPCServer::ValidatePacket(const PacketHeader& packet_header) {
 void RPCServer::HandleSingleRequest(std::unique_ptr<Packet> request_packet) {
     bool success = false;
 
-    if (ValidatePacket(request_packet->GetHeader())) {
+    if (ValidatePacket(*request_packet)) {
+        // The subscriptions keep their packet to send the frames through
+        if (request_packet->GetPacketType() == PacketType::SubscribeMemory) {
+            HandleSubscribeMemory(std::move(request_packet));
+            return;
+        }
+
         // Currently, all request types use the address/data_size wire format
         u32 address = 0;
         u32 data_size = 0;
@@ -95,6 +334,35 @@ void RPCServer::HandleSingleRequest(std::unique_ptr<Packet> request_packet) {
                 success = true;
             }
             break;
+        // The profiler requests reuse the two words, as the command or the profile index and
+        // as the first histogram bucket
+        case PacketType::IPCProfilerControl:
+            if (address <= static_cast<u32>(IPCProfilerCommand::Reset)) {
+                const auto command = static_cast<IPCProfilerCommand>(address);
+                HandleIPCProfilerControl(*request_packet, command);
+                success = true;
+            }
+            break;
+        case PacketType::GetIPCProfile:
+            HandleGetIPCProfile(*request_packet, address);
+            success = true;
+            break;
+        case PacketType::GetIPCProfileHistogram:
+            HandleGetIPCProfileHistogram(*request_packet, address, data_size);
+            success = true;
+            break;
+        case PacketType::ReadMemoryBatch:
+            HandleReadMemoryBatch(*request_packet);
+            success = true;
+            break;
+        case PacketType::WriteMemoryBatch:
+            HandleWriteMemoryBatch(*request_packet);
+            success = true;
+            break;
+        case PacketType::UnsubscribeMemory:
+            HandleUnsubscribeMemory(*request_packet, address);
+            success = true;
+            break;
         default:
             break;
         }
@@ -113,6 +381,11 @@ void RPCServer::HandleRequestsLoop() {
     LOG_INFO(RPC_Server, "Request handler started.");
 
     while ((request_packet = request_queue.PopWait())) {
+        if (request_packet->IsFrameSynchronized()) {
+            std::lock_guard lock{frame_request_mutex};
+            frame_requests.push_back(std::move(request_packet));
+            continue;
+        }
         HandleSingleRequest(std::move(request_packet));
     }
 }
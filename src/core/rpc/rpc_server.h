@@ -5,17 +5,17 @@
 #pragma once
 
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include "common/threadsafe_queue.h"
+#include "core/rpc/packet.h"
 #include "core/rpc/server.h"
 
 namespace RPC {
 
-class Packet;
-struct PacketHeader;
-
 class RPCServer {
 public:
     RPCServer();
@@ -23,18 +23,46 @@ public:
 
     void QueueRequest(std::unique_ptr<RPC::Packet> request);
 
+    /**
+     * Serves the requests held until the next frame and sends the contents of the memory ranges
+     * subscribed to. Called by the emulation thread at every frame the title submits, so that
+     * they all see the memory in the same state.
+     */
+    void OnFrameSubmitted();
+
 private:
+    /// Ranges streamed at every frame, through the packet of the request subscribing to them
+    struct MemorySubscription {
+        std::unique_ptr<Packet> packet;
+        std::vector<MemoryRange> ranges;
+        u32 frame = 0;
+    };
+
     void Start();
     void Stop();
     void HandleReadMemory(Packet& packet, u32 address, u32 data_size);
     void HandleWriteMemory(Packet& packet, u32 address, const u8* data, u32 data_size);
-    bool ValidatePacket(const PacketHeader& packet_header);
+    void HandleIPCProfilerControl(Packet& packet, IPCProfilerCommand command);
+    void HandleGetIPCProfile(Packet& packet, u32 index);
+    void HandleGetIPCProfileHistogram(Packet& packet, u32 index, u32 first_bucket);
+    void HandleReadMemoryBatch(Packet& packet);
+    void HandleWriteMemoryBatch(Packet& packet);
+    void HandleSubscribeMemory(std::unique_ptr<Packet> packet);
+    void HandleUnsubscribeMemory(Packet& packet, u32 id);
+    bool ValidatePacket(const Packet& packet);
     void HandleSingleRequest(std::unique_ptr<Packet> request);
     void HandleRequestsLoop();
 
     Server server;
     Common::SPSCQueue<std::unique_ptr<Packet>> request_queue;
     std::thread request_handler_thread;
+
+    std::mutex frame_request_mutex;
+    /// Requests with FRAME_SYNC_FLAG set, waiting for the next frame
+    std::vector<std::unique_ptr<Packet>> frame_requests;
+
+    std::mutex subscription_mutex;
+    std::deque<MemorySubscription> subscriptions;
 };
 
 } // namespace RPC
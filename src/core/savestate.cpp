@@ -2,21 +2,135 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <utility>
 #include <boost/serialization/binary_object.hpp>
 #include <cryptopp/hex.h>
+#include "audio_core/dsp_interface.h"
 #include "common/archives.h"
+#include "common/assert.h"
+#include "common/common_paths.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/scm_rev.h"
+#include "common/scope_exit.h"
+#include "common/thread_pool.h"
 #include "common/zstd_compression.h"
 #include "core/cheats/cheats.h"
 #include "core/core.h"
+#include "core/core_timing.h"
+#include "core/file_sys/archive_source_sd_savedata.h"
+#include "core/file_sys/archive_systemsavedata.h"
+#include "core/hle/service/am/am.h"
 #include "core/savestate.h"
+#include "core/settings.h"
 #include "network/network.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/video_core.h"
 
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 namespace Core {
 
+namespace {
+
+/// Lets an archive read a state straight from the buffer it was decompressed to
+class StateReadBuffer : public std::streambuf {
+public:
+    explicit StateReadBuffer(const std::vector<u8>& state) {
+        char* begin = const_cast<char*>(reinterpret_cast<const char*>(state.data()));
+        setg(begin, begin, begin + state.size());
+    }
+};
+
+/// Lets an archive write a state straight to a buffer that is then handed over without a copy
+class StateWriteBuffer : public std::streambuf {
+public:
+    std::vector<u8>& Data() {
+        return data;
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            data.push_back(static_cast<u8>(traits_type::to_char_type(c)));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override {
+        data.insert(data.end(), s, s + count);
+        return count;
+    }
+
+private:
+    std::vector<u8> data;
+};
+
+#ifndef _WIN32
+/// A child sending nothing for this long is stuck, likely on a lock another thread held at the fork
+constexpr int CHILD_STATE_TIMEOUT_MS = 10000;
+
+constexpr std::size_t PIPE_READ_SIZE = 1024 * 1024;
+
+/// Writes all of the data to the pipe, returns false on error
+bool WriteToPipe(int fd, const u8* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+/// Reads the pipe until it is closed, returns false on error or if the writer stalls
+bool ReadFromPipe(int fd, std::vector<u8>& data) {
+    pollfd poll_fd{fd, POLLIN, 0};
+    while (true) {
+        const int ready = poll(&poll_fd, 1, CHILD_STATE_TIMEOUT_MS);
+        if (ready == 0) {
+            return false;
+        }
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        const std::size_t offset = data.size();
+        data.resize(offset + PIPE_READ_SIZE);
+        const ssize_t count = read(fd, data.data() + offset, PIPE_READ_SIZE);
+        data.resize(offset + static_cast<std::size_t>(std::max<ssize_t>(count, 0)));
+        if (count == 0) {
+            return true;
+        }
+        if (count < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+}
+#endif
+
+} // Anonymous namespace
+
 #pragma pack(push, 1)
 struct CSTHeader {
     std::array<u8, 4> filetype;  /// Unique Identifier to check the file type (always "CST"0x1B)
@@ -24,7 +138,12 @@ struct CSTHeader {
     std::array<u8, 20> revision; /// Git hash of the revision this savestate was created with
     u64_le time;                 /// The time when this save state was created
 
-    std::array<u8, 216> reserved; /// Make heading 256 bytes so it has consistent size
+    /// Delta states only: the time of the full state they apply to and the size of the state
+    /// once applied
+    u64_le base_time;
+    u64_le state_size;
+
+    std::array<u8, 200> reserved; /// Make heading 256 bytes so it has consistent size
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int) {
@@ -35,12 +154,281 @@ static_assert(sizeof(CSTHeader) == 256, "CSTHeader should be 256 bytes");
 #pragma pack(pop)
 
 constexpr std::array<u8, 4> header_magic_bytes{{'C', 'S', 'T', 0x1B}};
+constexpr std::array<u8, 4> delta_header_magic_bytes{{'C', 'S', 'D', 0x1B}};
+
+/// The default level of zstd, the frames of a state are compressed in parallel
+constexpr s32 SAVE_STATE_COMPRESSION_LEVEL = 3;
+
+/// A delta bigger than this part of the state is replaced by a new full state
+constexpr std::size_t MAX_DELTA_RATIO = 2;
+
+constexpr std::size_t MIN_CHUNK_SIZE = 2 * 1024;
+constexpr std::size_t MAX_CHUNK_SIZE = 64 * 1024;
+/// A chunk ends where the top bits of the rolling hash are zero, about every 8 KiB
+constexpr u64 CHUNK_BOUNDARY_MASK = ~u64{0} << (64 - 13);
+
+enum class DeltaOp : u8 {
+    Copy,    ///< Followed by the u64 offset and u32 size of a range of the full state
+    Literal, ///< Followed by a u32 size and as many bytes of data
+};
 
 std::string GetSaveStatePath(u64 program_id, u32 slot) {
     return fmt::format("{}{:016X}.{:02d}.cst", FileUtil::GetUserPath(FileUtil::UserPath::StatesDir),
                        program_id, slot);
 }
 
+static std::string GetDeltaStatePath(u64 program_id, u32 slot) {
+    return fmt::format("{}{:016X}.{:02d}.csd",
+                       FileUtil::GetUserPath(FileUtil::UserPath::StatesDir), program_id, slot);
+}
+
+static std::string GetBootCachePath(u64 key) {
+    return fmt::format("{}boot{}{:016X}.cst", FileUtil::GetUserPath(FileUtil::UserPath::CacheDir),
+                       DIR_SEP, key);
+}
+
+/// Seconds since the epoch, the time stamp of the states
+static u64 GetCurrentTime() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/// Reads the header of a state file, returns false if the file isn't one of the given type
+static bool ReadHeader(const std::string& path, const std::array<u8, 4>& magic,
+                       CSTHeader& header) {
+    FileUtil::IOFile file(path, "rb");
+    if (!file) {
+        LOG_ERROR(Core, "Could not open file {}", path);
+        return false;
+    }
+    if (file.GetSize() < sizeof(header)) {
+        LOG_ERROR(Core, "File too small {}", path);
+        return false;
+    }
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header)) {
+        LOG_ERROR(Core, "Could not read from file {}", path);
+        return false;
+    }
+    if (header.filetype != magic) {
+        LOG_WARNING(Core, "Invalid save state file {}", path);
+        return false;
+    }
+    return true;
+}
+
+/// Reads and decompresses the contents of a state file
+static std::vector<u8> ReadStateFile(const std::string& path, const std::array<u8, 4>& magic,
+                                     CSTHeader& header) {
+    if (!ReadHeader(path, magic, header)) {
+        throw std::runtime_error("Invalid save state file " + path);
+    }
+    std::vector<u8> buffer(FileUtil::GetSize(path) - sizeof(CSTHeader));
+
+    FileUtil::IOFile file(path, "rb");
+    file.Seek(sizeof(CSTHeader), SEEK_SET); // Skip header
+    if (file.ReadBytes(buffer.data(), buffer.size()) != buffer.size()) {
+        throw std::runtime_error("Could not read from file at " + path);
+    }
+    return Common::Compression::DecompressDataZSTD(buffer);
+}
+
+/// Compresses the data into the file, through a temporary file so that a state is never seen
+/// half written
+static void WriteStateFile(const std::string& path, const CSTHeader& header, const u8* data,
+                           std::size_t size) {
+    const auto buffer =
+        Common::Compression::CompressDataZSTDSeekable(data, size, SAVE_STATE_COMPRESSION_LEVEL);
+
+    if (!FileUtil::CreateFullPath(path)) {
+        throw std::runtime_error("Could not create path " + path);
+    }
+    const std::string temp_path = path + ".tmp";
+    {
+        FileUtil::IOFile file(temp_path, "wb");
+        if (!file) {
+            throw std::runtime_error("Could not open file " + temp_path);
+        }
+        if (file.WriteBytes(&header, sizeof(header)) != sizeof(header) ||
+            file.WriteBytes(buffer.data(), buffer.size()) != buffer.size()) {
+            throw std::runtime_error("Could not write to file " + temp_path);
+        }
+    }
+    if (FileUtil::Exists(path)) {
+        FileUtil::Delete(path);
+    }
+    if (!FileUtil::Rename(temp_path, path)) {
+        throw std::runtime_error("Could not write to file " + path);
+    }
+}
+
+static std::array<u64, 256> MakeGearTable() {
+    std::array<u64, 256> table;
+    u64 state = 0x9E3779B97F4A7C15;
+    for (auto& value : table) {
+        // splitmix64
+        state += 0x9E3779B97F4A7C15;
+        u64 z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+/// Calls func(offset, size) for each chunk of the data
+template <typename Func>
+static void ForEachChunk(const u8* data, std::size_t size, Func&& func) {
+    static const std::array<u64, 256> gear_table = MakeGearTable();
+    std::size_t begin = 0;
+    while (begin < size) {
+        const std::size_t end = std::min(size, begin + MAX_CHUNK_SIZE);
+        std::size_t pos = std::min(size, begin + MIN_CHUNK_SIZE);
+        u64 hash = 0;
+        while (pos < end) {
+            hash = (hash << 1) + gear_table[data[pos++]];
+            if ((hash & CHUNK_BOUNDARY_MASK) == 0) {
+                break;
+            }
+        }
+        func(begin, pos - begin);
+        begin = pos;
+    }
+}
+
+template <typename T>
+static void AppendValue(std::vector<u8>& out, T value) {
+    const std::size_t offset = out.size();
+    out.resize(offset + sizeof(T));
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+static T ReadValue(const std::vector<u8>& in, std::size_t& offset) {
+    if (in.size() - offset < sizeof(T)) {
+        throw std::runtime_error("Corrupted delta save state");
+    }
+    T value;
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+static StateChunks IndexChunks(const u8* data, std::size_t size) {
+    StateChunks index;
+    ForEachChunk(data, size, [&](std::size_t offset, std::size_t chunk_size) {
+        index.chunks.emplace(Common::ComputeHash64(data + offset, chunk_size),
+                             StateChunks::Chunk{offset, static_cast<u32>(chunk_size)});
+    });
+    return index;
+}
+
+/// Encodes the data as copies of the chunks of the base and literal data, returns the delta and
+/// the amount of literal data in it
+static std::pair<std::vector<u8>, std::size_t> MakeDelta(const StateChunks& base, const u8* data,
+                                                         std::size_t size) {
+    std::vector<u8> delta;
+    std::size_t literal_size = 0;
+    ForEachChunk(data, size, [&](std::size_t offset, std::size_t chunk_size) {
+        const auto it = base.chunks.find(Common::ComputeHash64(data + offset, chunk_size));
+        if (it != base.chunks.end() && it->second.size == chunk_size) {
+            AppendValue(delta, DeltaOp::Copy);
+            AppendValue(delta, u64_le{it->second.offset});
+            AppendValue(delta, u32_le{static_cast<u32>(chunk_size)});
+            return;
+        }
+        AppendValue(delta, DeltaOp::Literal);
+        AppendValue(delta, u32_le{static_cast<u32>(chunk_size)});
+        delta.insert(delta.end(), data + offset, data + offset + chunk_size);
+        literal_size += chunk_size;
+    });
+    return {std::move(delta), literal_size};
+}
+
+static std::vector<u8> ApplyDelta(const std::vector<u8>& base, const std::vector<u8>& delta,
+                                  std::size_t state_size) {
+    std::vector<u8> state;
+    state.reserve(state_size);
+    std::size_t offset = 0;
+    while (offset < delta.size()) {
+        const auto op = static_cast<DeltaOp>(ReadValue<u8>(delta, offset));
+        if (op == DeltaOp::Copy) {
+            const auto base_offset = ReadValue<u64_le>(delta, offset);
+            const auto size = ReadValue<u32_le>(delta, offset);
+            if (base_offset > base.size() || base.size() - base_offset < size) {
+                throw std::runtime_error("Corrupted delta save state");
+            }
+            state.insert(state.end(), base.begin() + base_offset,
+                         base.begin() + base_offset + size);
+        } else if (op == DeltaOp::Literal) {
+            const auto size = ReadValue<u32_le>(delta, offset);
+            if (delta.size() - offset < size) {
+                throw std::runtime_error("Corrupted delta save state");
+            }
+            state.insert(state.end(), delta.begin() + offset, delta.begin() + offset + size);
+            offset += size;
+        } else {
+            throw std::runtime_error("Corrupted delta save state");
+        }
+    }
+    if (state.size() != state_size) {
+        throw std::runtime_error("Corrupted delta save state");
+    }
+    return state;
+}
+
+static CSTHeader MakeHeader(const std::array<u8, 4>& magic, u64 program_id, u64 time) {
+    CSTHeader header{};
+    header.filetype = magic;
+    header.program_id = program_id;
+    std::string rev_bytes;
+    CryptoPP::StringSource(Common::g_scm_rev, true,
+                           new CryptoPP::HexDecoder(new CryptoPP::StringSink(rev_bytes)));
+    std::memcpy(header.revision.data(), rev_bytes.data(), sizeof(header.revision));
+    header.time = time;
+    return header;
+}
+
+/// Appends the names, sizes and modification times of the files under the directory
+static void AppendFileListing(const std::string& directory, std::string& listing) {
+    FileUtil::FSTEntry root;
+    FileUtil::ScanDirectoryTree(directory, root, 64);
+    std::vector<FileUtil::FSTEntry> files;
+    FileUtil::GetAllFilesFromNestedEntries(root, files);
+    // The order of the entries on the disk isn't meaningful
+    std::sort(files.begin(), files.end(),
+              [](const auto& a, const auto& b) { return a.physicalName < b.physicalName; });
+    for (const auto& file : files) {
+        listing += fmt::format("{}:{}:{}\n", file.physicalName, file.size,
+                               FileUtil::GetModificationTime(file.physicalName));
+    }
+}
+
+u64 GetBootCacheKey(u64 program_id, const std::string& filepath) {
+    const auto& values = Settings::values;
+    std::string description =
+        fmt::format("{}\n{:016X}\n{}:{}:{}\n", Common::g_scm_rev, program_id, filepath,
+                    FileUtil::GetSize(filepath), FileUtil::GetModificationTime(filepath));
+    description += fmt::format("{}:{}:{}:{}:{}:{}:{}:{}:{}\n", values.is_new_3ds,
+                               values.region_value, static_cast<int>(values.init_clock),
+                               values.init_time, values.cpu_clock_percentage, values.use_cpu_jit,
+                               values.use_multi_core, values.use_virtual_sd,
+                               values.hle_memory_routines);
+
+    // The update is loaded along with the title, which may read its save data and the system
+    // settings before its first frame
+    const u64 update_id = (program_id & 0xFFFFFFFF) | 0x0004000E00000000;
+    AppendFileListing(Service::AM::GetTitlePath(Service::FS::MediaType::SDMC, update_id),
+                      description);
+    AppendFileListing(FileSys::ArchiveSource_SDSaveData::GetSaveDataPathFor(
+                          FileUtil::GetUserPath(FileUtil::UserPath::SDMCDir), program_id),
+                      description);
+    AppendFileListing(FileSys::GetSystemSaveDataContainerPath(
+                          FileUtil::GetUserPath(FileUtil::UserPath::NANDDir)),
+                      description);
+    return Common::ComputeHash64(description.data(), description.size());
+}
+
 std::vector<SaveStateInfo> ListSaveStates(u64 program_id) {
     std::vector<SaveStateInfo> result;
     for (u32 slot = 1; slot <= SaveStateSlotCount; ++slot) {
@@ -52,22 +440,8 @@ std::vector<SaveStateInfo> ListSaveStates(u64 program_id) {
         SaveStateInfo info;
         info.slot = slot;
 
-        FileUtil::IOFile file(path, "rb");
-        if (!file) {
-            LOG_ERROR(Core, "Could not open file {}", path);
-            continue;
-        }
         CSTHeader header;
-        if (file.GetSize() < sizeof(header)) {
-            LOG_ERROR(Core, "File too small {}", path);
-            continue;
-        }
-        if (file.ReadBytes(&header, sizeof(header)) != sizeof(header)) {
-            LOG_ERROR(Core, "Could not read from file {}", path);
-            continue;
-        }
-        if (header.filetype != header_magic_bytes) {
-            LOG_WARNING(Core, "Invalid save state file {}", path);
+        if (!ReadHeader(path, header_magic_bytes, header)) {
             continue;
         }
         info.time = header.time;
@@ -83,46 +457,411 @@ std::vector<SaveStateInfo> ListSaveStates(u64 program_id) {
             LOG_WARNING(Core, "Save state file created from a different revision {}", path);
             info.status = SaveStateInfo::ValidationStatus::RevisionDismatch;
         }
+
+        const auto delta_path = GetDeltaStatePath(program_id, slot);
+        CSTHeader delta_header;
+        if (FileUtil::Exists(delta_path) &&
+            ReadHeader(delta_path, delta_header_magic_bytes, delta_header) &&
+            delta_header.base_time == header.time) {
+            info.time = delta_header.time;
+        }
         result.emplace_back(std::move(info));
     }
     return result;
 }
 
+SaveStateWriter::SaveStateWriter()
+    : thread(std::make_unique<Common::ThreadPool>(1, "SaveStateWriter",
+                                                  Common::ThreadRole::Background)) {}
+
+SaveStateWriter::~SaveStateWriter() = default;
+
+void SaveStateWriter::Write(u64 program_id, u32 slot, std::vector<u8> state) {
+    const u64 time = GetCurrentTime();
+    auto shared_state = std::make_shared<std::vector<u8>>(std::move(state));
+    thread->Push([this, program_id, slot, shared_state, time] {
+        try {
+            WriteState(program_id, slot, *shared_state, time);
+            LOG_INFO(Core, "Save state written to slot {}", slot);
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error writing save state: {}", e.what());
+        }
+    });
+}
+
+void SaveStateWriter::WriteBootCache(u64 program_id, u64 key, std::vector<u8> state) {
+    const u64 time = GetCurrentTime();
+    auto shared_state = std::make_shared<std::vector<u8>>(std::move(state));
+    thread->Push([program_id, key, shared_state, time] {
+        try {
+            WriteStateFile(GetBootCachePath(key), MakeHeader(header_magic_bytes, program_id, time),
+                           shared_state->data(), shared_state->size());
+            LOG_INFO(Core, "Boot cache written");
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error writing boot cache: {}", e.what());
+        }
+    });
+}
+
+void SaveStateWriter::WriteFromChild(u64 program_id, u32 slot, int pipe_fd, int child_pid) {
+#ifndef _WIN32
+    const u64 time = GetCurrentTime();
+    thread->Push([this, program_id, slot, pipe_fd, child_pid, time] {
+        std::vector<u8> state;
+        const bool received = ReadFromPipe(pipe_fd, state);
+        close(pipe_fd);
+        if (!received) {
+            kill(child_pid, SIGKILL);
+        }
+        int status = 0;
+        while (waitpid(child_pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        if (!received || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            LOG_ERROR(Core, "Error writing save state: the process serializing it failed");
+            return;
+        }
+
+        try {
+            WriteState(program_id, slot, state, time);
+            LOG_INFO(Core, "Save state written to slot {}", slot);
+        } catch (const std::exception& e) {
+            LOG_ERROR(Core, "Error writing save state: {}", e.what());
+        }
+    });
+#else
+    UNREACHABLE();
+#endif
+}
+
+void SaveStateWriter::WaitIdle() {
+    thread->WaitForAll();
+}
+
+void SaveStateWriter::WriteState(u64 program_id, u32 slot, const std::vector<u8>& state,
+                                 u64 time) {
+    const u8* data = state.data();
+    const auto path = GetSaveStatePath(program_id, slot);
+    const auto delta_path = GetDeltaStatePath(program_id, slot);
+
+    const auto base_it = base_states.find({program_id, slot});
+    if (base_it != base_states.end() && FileUtil::Exists(path)) {
+        const BaseState& base = base_it->second;
+        const auto [delta, literal_size] = MakeDelta(base.chunks, data, state.size());
+        if (literal_size <= state.size() / MAX_DELTA_RATIO) {
+            CSTHeader header = MakeHeader(delta_header_magic_bytes, program_id, time);
+            header.base_time = base.time;
+            header.state_size = state.size();
+            WriteStateFile(delta_path, header, delta.data(), delta.size());
+            return;
+        }
+    }
+
+    // The delta goes away first, a full state left alone is consistent
+    if (FileUtil::Exists(delta_path)) {
+        FileUtil::Delete(delta_path);
+    }
+    WriteStateFile(path, MakeHeader(header_magic_bytes, program_id, time), data, state.size());
+
+    base_states[{program_id, slot}] = {time, IndexChunks(data, state.size())};
+}
+
+/// Rewind points favour compression speed, a full state is compressed every few points
+constexpr s32 REWIND_COMPRESSION_LEVEL = 1;
+
+RewindBuffer::RewindBuffer(std::size_t memory_budget)
+    : memory_budget(memory_budget),
+      thread(std::make_unique<Common::ThreadPool>(1, "RewindBuffer",
+                                                  Common::ThreadRole::Background)) {}
+
+RewindBuffer::~RewindBuffer() = default;
+
+void RewindBuffer::Push(std::vector<u8> state) {
+    if (busy.exchange(true)) {
+        LOG_DEBUG(Core, "Dropping rewind point, the previous one is still being compressed");
+        return;
+    }
+    auto shared_state = std::make_shared<std::vector<u8>>(std::move(state));
+    thread->Push([this, shared_state] {
+        AddPoint(*shared_state);
+        busy = false;
+    });
+}
+
+std::optional<std::vector<u8>> RewindBuffer::Pop() {
+    thread->WaitForAll();
+    if (points.empty()) {
+        return std::nullopt;
+    }
+
+    const Point point = std::move(points.back());
+    points.pop_back();
+    memory_used -= point.compressed.size();
+    std::vector<u8> state = Common::Compression::DecompressDataZSTD(point.compressed);
+    if (point.is_full) {
+        base_chunks.chunks.clear();
+    } else {
+        const auto base = std::find_if(points.rbegin(), points.rend(),
+                                       [](const Point& p) { return p.is_full; });
+        // The full point of a delta is dropped along with it
+        ASSERT(base != points.rend());
+        state = ApplyDelta(Common::Compression::DecompressDataZSTD(base->compressed), state,
+                           point.state_size);
+    }
+    return state;
+}
+
+void RewindBuffer::Clear() {
+    thread->WaitForAll();
+    points.clear();
+    memory_used = 0;
+    base_chunks.chunks.clear();
+}
+
+void RewindBuffer::AddPoint(const std::vector<u8>& state) {
+    const u8* data = state.data();
+    Point point{false, state.size(), {}};
+    if (!base_chunks.chunks.empty()) {
+        const auto [delta, literal_size] = MakeDelta(base_chunks, data, state.size());
+        if (literal_size <= state.size() / MAX_DELTA_RATIO) {
+            point.compressed = Common::Compression::CompressDataZSTDSeekable(
+                delta.data(), delta.size(), REWIND_COMPRESSION_LEVEL);
+        }
+    }
+    if (point.compressed.empty()) {
+        point.is_full = true;
+        point.compressed = Common::Compression::CompressDataZSTDSeekable(
+            data, state.size(), REWIND_COMPRESSION_LEVEL);
+        base_chunks = IndexChunks(data, state.size());
+    }
+    memory_used += point.compressed.size();
+    points.push_back(std::move(point));
+    DropOldestPoints();
+}
+
+void RewindBuffer::DropOldestPoints() {
+    while (memory_used > memory_budget) {
+        // The oldest full point goes with its deltas, the newest one is kept
+        const auto next_full = std::find_if(points.begin() + 1, points.end(),
+                                            [](const Point& p) { return p.is_full; });
+        if (next_full == points.end()) {
+            // Start a new full point next time so that this one can go
+            base_chunks.chunks.clear();
+            return;
+        }
+        for (auto it = points.begin(); it != next_full; ++it) {
+            memory_used -= it->compressed.size();
+        }
+        points.erase(points.begin(), next_full);
+    }
+}
+
 void System::SaveState(u32 slot) const {
-    std::ostringstream sstream{std::ios_base::binary};
-    // Serialize
-    oarchive oa{sstream};
-    oa&* this;
+    if (Settings::values.fork_save_states && SaveStateInChild(slot)) {
+        return;
+    }
 
-    const std::string& str{sstream.str()};
-    auto buffer = Common::Compression::CompressDataZSTDDefault(
-        reinterpret_cast<const u8*>(str.data()), str.size());
+    // Compressing and writing the state is left to the writer thread
+    save_state_writer->Write(title_id, slot, SaveStateToBuffer());
+}
 
-    const auto path = GetSaveStatePath(title_id, slot);
-    if (!FileUtil::CreateFullPath(path)) {
-        throw std::runtime_error("Could not create path " + path);
+std::vector<u8> System::SaveStateToBuffer() const {
+    StateWriteBuffer buffer;
+    {
+        std::ostream stream{&buffer};
+        oarchive oa{stream};
+        oa&* this;
     }
+    return std::move(buffer.Data());
+}
 
-    FileUtil::IOFile file(path, "wb");
-    if (!file) {
-        throw std::runtime_error("Could not open file " + path);
+bool System::SaveStateInChild(u32 slot) const {
+#ifndef _WIN32
+    if (memory->IsMemoryShared()) {
+        return false;
     }
 
-    CSTHeader header{};
-    header.filetype = header_magic_bytes;
-    header.program_id = title_id;
-    std::string rev_bytes;
-    CryptoPP::StringSource(Common::g_scm_rev, true,
-                           new CryptoPP::HexDecoder(new CryptoPP::StringSink(rev_bytes)));
-    std::memcpy(header.revision.data(), rev_bytes.data(), sizeof(header.revision));
-    header.time = std::chrono::duration_cast<std::chrono::seconds>(
-                      std::chrono::system_clock::now().time_since_epoch())
-                      .count();
+    // The child only has this thread, what the serialization needs from the GPU thread and the
+    // renderer is done before the fork
+    Memory::RasterizerDetachCaches(true);
+    SCOPE_EXIT({ Memory::RasterizerReattachCaches(); });
+    if (VideoCore::g_gpu_thread) {
+        VideoCore::g_gpu_thread->WaitIdle();
+    }
 
-    if (file.WriteBytes(&header, sizeof(header)) != sizeof(header) ||
-        file.WriteBytes(buffer.data(), buffer.size()) != buffer.size()) {
-        throw std::runtime_error("Could not write to file " + path);
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        LOG_WARNING(Core, "Saving the state in this process, pipe failed: errno={}", errno);
+        return false;
+    }
+    const pid_t pid = fork();
+    if (pid < 0) {
+        LOG_WARNING(Core, "Saving the state in this process, fork failed: errno={}", errno);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(pipe_fds[0]);
+        // The renderer and the GPU thread belong to the parent. Without them the serialization
+        // doesn't detach the rasterizer caches again nor wait for the GPU thread.
+        VideoCore::g_renderer.release();
+        VideoCore::g_gpu_thread.release();
+
+        int status = EXIT_FAILURE;
+        try {
+            StateWriteBuffer buffer;
+            {
+                std::ostream stream{&buffer};
+                oarchive oa{stream};
+                oa&* this;
+            }
+            if (WriteToPipe(pipe_fds[1], buffer.Data().data(), buffer.Data().size())) {
+                status = EXIT_SUCCESS;
+            }
+        } catch (...) {
+        }
+        // The objects of the process are the parent's, none of them is destroyed here
+        _exit(status);
+    }
+
+    close(pipe_fds[1]);
+    save_state_writer->WriteFromChild(title_id, slot, pipe_fds[0], pid);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void System::SaveBootCache() {
+    boot_cache_frame_reached = false;
+    const u64 key = std::exchange(boot_cache_key, 0);
+
+    StateWriteBuffer buffer;
+    try {
+        std::ostream stream{&buffer};
+        oarchive oa{stream};
+        oa&* this;
+    } catch (const std::exception& e) {
+        LOG_WARNING(Core, "Not caching the boot, the state can't be saved: {}", e.what());
+        return;
+    }
+    save_state_writer->WriteBootCache(title_id, key, std::move(buffer.Data()));
+}
+
+bool System::LoadBootCache() {
+    const u64 key = GetBootCacheKey(title_id, m_filepath);
+    const std::string path = GetBootCachePath(key);
+    if (!FileUtil::Exists(path)) {
+        boot_cache_key = key;
+        return false;
     }
+
+    CSTHeader header;
+    std::vector<u8> state;
+    try {
+        state = ReadStateFile(path, header_magic_bytes, header);
+    } catch (const std::exception& e) {
+        LOG_WARNING(Core, "Discarding boot cache {}: {}", path, e.what());
+        FileUtil::Delete(path);
+        boot_cache_key = key;
+        return false;
+    }
+
+    // A state that fails to load leaves the system half replaced, the caller boots again
+    try {
+        StateReadBuffer buffer{state};
+        std::istream stream{&buffer};
+        iarchive ia{stream};
+        ia&* this;
+    } catch (...) {
+        FileUtil::Delete(path);
+        throw;
+    }
+    return true;
+}
+
+void System::TakeRewindPoint() {
+    next_rewind_point_ticks =
+        timing->GetGlobalTicks() + msToCycles(static_cast<int>(Settings::values.rewind_interval));
+
+    StateWriteBuffer buffer;
+    try {
+        std::ostream stream{&buffer};
+        oarchive oa{stream};
+        oa&* this;
+    } catch (const std::exception& e) {
+        LOG_ERROR(Core, "Disabling rewind, the state can't be saved: {}", e.what());
+        rewind_buffer.reset();
+        return;
+    }
+    rewind_buffer->Push(std::move(buffer.Data()));
+}
+
+bool System::Rewind() {
+    if (!rewind_buffer) {
+        return false;
+    }
+    if (Network::GetRoomMember().lock()->IsConnected()) {
+        throw std::runtime_error("Unable to rewind while connected to multiplayer");
+    }
+
+    const auto state = rewind_buffer->Pop();
+    if (!state) {
+        return false;
+    }
+    StateReadBuffer buffer{*state};
+    std::istream stream{&buffer};
+    iarchive ia{stream};
+    ia&* this;
+    boot_cache_key = 0;
+
+    next_rewind_point_ticks =
+        timing->GetGlobalTicks() + msToCycles(static_cast<int>(Settings::values.rewind_interval));
+    return true;
+}
+
+System::ResultStatus System::RunAhead() {
+    run_ahead_vblank = vblank_count;
+    if (!CanRunAhead()) {
+        return ResultStatus::Success;
+    }
+
+    StateWriteBuffer buffer;
+    try {
+        std::ostream stream{&buffer};
+        oarchive oa{stream};
+        oa&* this;
+    } catch (const std::exception& e) {
+        LOG_ERROR(Core, "Disabling run-ahead, the state can't be saved: {}", e.what());
+        run_ahead_frames = 0;
+        return ResultStatus::Success;
+    }
+
+    // The frames ahead are emulated again from the state, only the last one is shown and none is
+    // heard. They run with the input of the current frame, the recording of a movie included.
+    running_ahead = true;
+    run_ahead_target_vblank = vblank_count + run_ahead_frames;
+    dsp_core->SetOutputMuted(true);
+    ResultStatus run_status = ResultStatus::Success;
+    while (run_status == ResultStatus::Success && vblank_count < run_ahead_target_vblank) {
+        run_status = RunLoop();
+    }
+    dsp_core->SetOutputMuted(false);
+    running_ahead = false;
+
+    try {
+        StateReadBuffer read_buffer{buffer.Data()};
+        std::istream stream{&read_buffer};
+        iarchive ia{stream};
+        ia&* this;
+    } catch (const std::exception& e) {
+        LOG_ERROR(Core, "Error going back from the frames run ahead: {}", e.what());
+        status_details = e.what();
+        return ResultStatus::ErrorSavestate;
+    }
+    run_ahead_vblank = vblank_count;
+    return ResultStatus::Success;
 }
 
 void System::LoadState(u32 slot) {
@@ -130,27 +869,39 @@ void System::LoadState(u32 slot) {
         throw std::runtime_error("Unable to load while connected to multiplayer");
     }
 
-    const auto path = GetSaveStatePath(title_id, slot);
+    // The state may still be on its way to the file
+    save_state_writer->WaitIdle();
 
-    std::vector<u8> decompressed;
-    {
-        std::vector<u8> buffer(FileUtil::GetSize(path) - sizeof(CSTHeader));
+    const auto path = GetSaveStatePath(title_id, slot);
+    CSTHeader header;
+    std::vector<u8> decompressed = ReadStateFile(path, header_magic_bytes, header);
 
-        FileUtil::IOFile file(path, "rb");
-        file.Seek(sizeof(CSTHeader), SEEK_SET); // Skip header
-        if (file.ReadBytes(buffer.data(), buffer.size()) != buffer.size()) {
-            throw std::runtime_error("Could not read from file at " + path);
+    const auto delta_path = GetDeltaStatePath(title_id, slot);
+    if (FileUtil::Exists(delta_path)) {
+        CSTHeader delta_header;
+        const auto delta = ReadStateFile(delta_path, delta_header_magic_bytes, delta_header);
+        if (delta_header.base_time == header.time) {
+            decompressed = ApplyDelta(decompressed, delta, delta_header.state_size);
+        } else {
+            LOG_WARNING(Core, "Ignoring delta save state {} made for another state", delta_path);
         }
-        decompressed = Common::Compression::DecompressDataZSTD(buffer);
     }
-    std::istringstream sstream{
-        std::string{reinterpret_cast<char*>(decompressed.data()), decompressed.size()},
-        std::ios_base::binary};
-    decompressed.clear();
 
-    // Deserialize
-    iarchive ia{sstream};
+    LoadStateFromBuffer(decompressed);
+}
+
+void System::LoadStateFromBuffer(const std::vector<u8>& state) {
+    // Deserialize, straight from the decompressed state
+    StateReadBuffer buffer{state};
+    std::istream stream{&buffer};
+    iarchive ia{stream};
     ia&* this;
+    boot_cache_key = 0;
+
+    // The rewind points lead to the state that was replaced
+    if (rewind_buffer) {
+        rewind_buffer->Clear();
+    }
 }
 
 } // namespace Core
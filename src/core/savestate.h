@@ -4,9 +4,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#include "common/common_funcs.h"
 #include "common/common_types.h"
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace Core {
 
 struct CSTHeader;
@@ -24,4 +37,107 @@ constexpr u32 SaveStateSlotCount = 10; // Maximum count of savestate slots
 
 std::vector<SaveStateInfo> ListSaveStates(u64 program_id);
 
+/**
+ * Returns the key of the boot cache of a title. It covers what the boot of the title depends on:
+ * the build, the application file and its update, the settings the system is set up with and the
+ * system and save data the title reads.
+ */
+u64 GetBootCacheKey(u64 program_id, const std::string& filepath);
+
+/**
+ * Where the chunks of a serialized state are, by hash of their contents. The states are cut into
+ * chunks at content-defined boundaries, so that the chunks of a state are found again in a later
+ * one even if some data in front of them changed size.
+ */
+struct StateChunks {
+    struct Chunk {
+        u64 offset;
+        u32 size;
+    };
+    std::unordered_map<u64, Chunk> chunks;
+};
+
+/**
+ * Compresses and writes the serialized states on a thread of its own, so that saving only costs
+ * the emulation thread the serialization. A slot holds a full state and, once the writer knows
+ * the contents of that full state, the following saves are written as a delta against it as long
+ * as the delta stays small.
+ */
+class SaveStateWriter : NonCopyable {
+public:
+    SaveStateWriter();
+    ~SaveStateWriter();
+
+    /// Queues the writing of the serialized state to the slot
+    void Write(u64 program_id, u32 slot, std::vector<u8> state);
+
+    /// Queues the writing of the serialized state as the boot cache with the given key
+    void WriteBootCache(u64 program_id, u64 key, std::vector<u8> state);
+
+    /**
+     * Queues the writing of the serialized state a child process sends through the pipe, see
+     * System::SaveStateInChild. The writer closes the pipe and reaps the child. POSIX hosts only.
+     */
+    void WriteFromChild(u64 program_id, u32 slot, int pipe_fd, int child_pid);
+
+    /// Waits until the queued states are written
+    void WaitIdle();
+
+private:
+    /// The chunks of a full state written by this writer
+    struct BaseState {
+        u64 time;
+        StateChunks chunks;
+    };
+
+    void WriteState(u64 program_id, u32 slot, const std::vector<u8>& state, u64 time);
+
+    /// Accessed on the writer thread only
+    std::map<std::pair<u64, u32>, BaseState> base_states;
+    std::unique_ptr<Common::ThreadPool> thread;
+};
+
+/**
+ * Keeps recent states of the emulation in memory to step back through them. The states are
+ * compressed in the background, each one as a delta against the last full state kept, and the
+ * oldest ones are dropped once the buffer goes over its memory budget.
+ */
+class RewindBuffer : NonCopyable {
+public:
+    /// @param memory_budget Memory the compressed states may take, in bytes
+    explicit RewindBuffer(std::size_t memory_budget);
+    ~RewindBuffer();
+
+    /**
+     * Queues the serialized state to be added as the newest one. The state is dropped if the
+     * previous one is still being compressed, the interval between two states is then too short.
+     */
+    void Push(std::vector<u8> state);
+
+    /// Removes the newest state and returns it, once the queued ones are added
+    std::optional<std::vector<u8>> Pop();
+
+    /// Drops all the states
+    void Clear();
+
+private:
+    struct Point {
+        /// Whether the point is a full state rather than a delta against the previous full one
+        bool is_full;
+        std::size_t state_size;
+        std::vector<u8> compressed;
+    };
+
+    void AddPoint(const std::vector<u8>& state);
+    void DropOldestPoints();
+
+    std::size_t memory_budget;
+    std::size_t memory_used = 0;
+    std::deque<Point> points;
+    /// Chunks of the newest full point, empty when the next point should be a full one
+    StateChunks base_chunks;
+    std::atomic_bool busy{false};
+    std::unique_ptr<Common::ThreadPool> thread;
+};
+
 } // namespace Core
@@ -5,6 +5,7 @@
 #include <string_view>
 #include <utility>
 #include "audio_core/dsp_interface.h"
+#include "common/thread.h"
 #include "core/core.h"
 #include "core/gdbstub/gdbstub.h"
 #include "core/hle/kernel/shared_page.h"
@@ -25,11 +26,16 @@ void Apply() {
     GDBStub::SetServerPort(values.gdbstub_port);
     GDBStub::ToggleServer(values.use_gdbstub);
 
+    Common::SetThreadRolesEnabled(values.tune_thread_scheduling);
+
     VideoCore::g_hw_renderer_enabled = values.use_hw_renderer;
     VideoCore::g_shader_jit_enabled = values.use_shader_jit;
+    VideoCore::g_parallel_vertex_shading = values.parallel_vertex_shading;
+    VideoCore::g_parallel_sw_rasterizer = values.parallel_sw_rasterizer;
     VideoCore::g_hw_shader_enabled = values.use_hw_shader;
     VideoCore::g_separable_shader_enabled = values.separable_shader;
     VideoCore::g_hw_shader_accurate_mul = values.shaders_accurate_mul;
+    VideoCore::g_hw_shader_specialize_uniforms = values.shaders_specialize_uniforms;
     VideoCore::g_use_disk_shader_cache = values.use_disk_shader_cache;
 
     if (VideoCore::g_renderer) {
@@ -46,6 +52,7 @@ void Apply() {
         system.CoreTiming().UpdateClockSpeed(values.cpu_clock_percentage);
         Core::DSP().SetSink(values.sink_id, values.audio_device_id);
         Core::DSP().EnableStretching(values.enable_audio_stretching);
+        Core::DSP().EnableLowLatency(values.enable_audio_low_latency);
 
         auto hid = Service::HID::GetModule(system);
         if (hid) {
@@ -76,13 +83,36 @@ void LogSettings() {
 
     LOG_INFO(Config, "Citra Configuration:");
     log_setting("Core_UseCpuJit", values.use_cpu_jit);
+    log_setting("Core_UseFastmem", values.use_fastmem);
+    log_setting("Core_UseHugePages", values.use_huge_pages);
+    log_setting("Core_HLEMemoryRoutines", values.hle_memory_routines);
+    log_setting("Core_UseMultiCore", values.use_multi_core);
+    log_setting("Core_TuneThreadScheduling", values.tune_thread_scheduling);
+    log_setting("Core_EnableRewind", values.enable_rewind);
+    log_setting("Core_RewindInterval", values.rewind_interval);
+    log_setting("Core_RewindBufferSize", values.rewind_buffer_size);
+    log_setting("Core_UseBootCache", values.use_boot_cache);
+    log_setting("Core_UseTitleProfiles", values.use_title_profiles);
+    log_setting("Core_ForkSaveStates", values.fork_save_states);
+    log_setting("Core_RunAheadFrames", values.run_ahead_frames);
+    log_setting("Core_MovieKeyframeInterval", values.movie_keyframe_interval);
     log_setting("Renderer_UseGLES", values.use_gles);
     log_setting("Renderer_UseHwRenderer", values.use_hw_renderer);
     log_setting("Renderer_UseHwShader", values.use_hw_shader);
     log_setting("Renderer_SeparableShader", values.separable_shader);
     log_setting("Renderer_ShadersAccurateMul", values.shaders_accurate_mul);
+    log_setting("Renderer_ShadersSpecializeUniforms", values.shaders_specialize_uniforms);
+    log_setting("Renderer_AsyncShaderCompilation", values.async_shader_compilation);
     log_setting("Renderer_UseShaderJit", values.use_shader_jit);
+    log_setting("Renderer_ShaderJitCacheBudgetMb", values.shader_jit_cache_budget_mb);
+    log_setting("Renderer_ParallelVertexShading", values.parallel_vertex_shading);
+    log_setting("Renderer_ParallelSwRasterizer", values.parallel_sw_rasterizer);
+    log_setting("Renderer_UseGpuTextureDecoding", values.use_gpu_texture_decoding);
+    log_setting("Renderer_GenerateMipmapsOnGpu", values.generate_mipmaps_on_gpu);
+    log_setting("Renderer_SurfaceCacheBudgetMb", values.surface_cache_budget_mb);
+    log_setting("Renderer_UseGpuThread", values.use_gpu_thread);
     log_setting("Renderer_UseResolutionFactor", values.resolution_factor);
+    log_setting("Renderer_DynamicResolution", values.dynamic_resolution);
     log_setting("Renderer_FrameLimit", values.frame_limit);
     log_setting("Renderer_UseFrameLimitAlternate", values.use_frame_limit_alternate);
     log_setting("Renderer_FrameLimitAlternate", values.frame_limit_alternate);
@@ -95,12 +125,15 @@ void LogSettings() {
     log_setting("Layout_SwapScreen", values.swap_screen);
     log_setting("Layout_UprightScreen", values.upright_screen);
     log_setting("Utility_DumpTextures", values.dump_textures);
+    log_setting("Utility_FastTextureDumping", values.fast_texture_dumping);
     log_setting("Utility_CustomTextures", values.custom_textures);
     log_setting("Utility_UseDiskShaderCache", values.use_disk_shader_cache);
+    log_setting("Utility_SharedShaderCacheDir", values.shared_shader_cache_dir);
     log_setting("Audio_EnableDspLle", values.enable_dsp_lle);
     log_setting("Audio_EnableDspLleMultithread", values.enable_dsp_lle_multithread);
     log_setting("Audio_OutputEngine", values.sink_id);
     log_setting("Audio_EnableAudioStretching", values.enable_audio_stretching);
+    log_setting("Audio_EnableAudioLowLatency", values.enable_audio_low_latency);
     log_setting("Audio_OutputDevice", values.audio_device_id);
     log_setting("Audio_InputDeviceType", static_cast<int>(values.mic_input_type));
     log_setting("Audio_InputDevice", values.mic_input_device);
@@ -115,10 +148,17 @@ void LogSettings() {
     log_setting("Camera_OuterLeftConfig", values.camera_config[OuterLeftCamera]);
     log_setting("Camera_OuterLeftFlip", values.camera_flip[OuterLeftCamera]);
     log_setting("DataStorage_UseVirtualSd", values.use_virtual_sd);
+    log_setting("DataStorage_BufferSaveWrites", values.buffer_save_writes);
+    log_setting("DataStorage_UseRamStorage", values.use_ram_storage);
+    log_setting("DataStorage_RamStorageTemplate", values.ram_storage_template);
+    log_setting("DataStorage_PersistRamStorage", values.persist_ram_storage);
     log_setting("System_IsNew3ds", values.is_new_3ds);
     log_setting("System_RegionValue", values.region_value);
     log_setting("Debugging_UseGdbstub", values.use_gdbstub);
     log_setting("Debugging_GdbstubPort", values.gdbstub_port);
+    log_setting("Debugging_UseMetricsServer", values.use_metrics_server);
+    log_setting("Debugging_MetricsServerPort", values.metrics_server_port);
+    log_setting("Debugging_EnableGuestProfiler", values.enable_guest_profiler);
 }
 
 void LoadProfile(int index) {
@@ -136,10 +136,27 @@ struct Values {
 
     // Core
     bool use_cpu_jit;
+    bool use_fastmem;
+    bool use_huge_pages;
+    bool hle_memory_routines;
+    bool use_multi_core;
+    bool tune_thread_scheduling;
     int cpu_clock_percentage;
+    bool enable_rewind;
+    u32 rewind_interval;
+    u32 rewind_buffer_size;
+    bool use_boot_cache;
+    bool use_title_profiles;
+    bool fork_save_states;
+    u32 run_ahead_frames;
+    u32 movie_keyframe_interval;
 
     // Data Storage
     bool use_virtual_sd;
+    bool buffer_save_writes;
+    bool use_ram_storage;
+    std::string ram_storage_template;
+    bool persist_ram_storage;
 
     // System
     int region_value;
@@ -152,9 +169,20 @@ struct Values {
     bool use_hw_shader;
     bool separable_shader;
     bool use_disk_shader_cache;
+    std::string shared_shader_cache_dir;
     bool shaders_accurate_mul;
+    bool shaders_specialize_uniforms;
+    bool async_shader_compilation;
     bool use_shader_jit;
+    u32 shader_jit_cache_budget_mb;
+    bool parallel_vertex_shading;
+    bool parallel_sw_rasterizer;
+    bool use_gpu_texture_decoding;
+    bool generate_mipmaps_on_gpu;
+    u32 surface_cache_budget_mb;
+    bool use_gpu_thread;
     u16 resolution_factor;
+    bool dynamic_resolution;
     bool use_frame_limit_alternate;
     u16 frame_limit;
     u16 frame_limit_alternate;
@@ -186,6 +214,7 @@ struct Values {
     bool dump_textures;
     bool custom_textures;
     bool preload_textures;
+    bool fast_texture_dumping;
 
     bool use_vsync_new;
 
@@ -194,6 +223,7 @@ struct Values {
     bool enable_dsp_lle_multithread;
     std::string sink_id;
     bool enable_audio_stretching;
+    bool enable_audio_low_latency;
     std::string audio_device_id;
     float volume;
     MicInputType mic_input_type;
@@ -208,6 +238,9 @@ struct Values {
     bool record_frame_times;
     bool use_gdbstub;
     u16 gdbstub_port;
+    bool use_metrics_server;
+    u16 metrics_server_port;
+    bool enable_guest_profiler;
     std::string log_filter;
     std::unordered_map<std::string, bool> lle_modules;
 
@@ -224,6 +257,8 @@ struct Values {
     std::string video_encoder;
     std::string video_encoder_options;
     u64 video_bitrate;
+    u32 video_dump_queue_depth;
+    bool video_dump_drop_frames;
 
     std::string audio_encoder;
     std::string audio_encoder_options;
@@ -0,0 +1,211 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <fmt/format.h>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "core/settings.h"
+#include "core/title_profile.h"
+
+namespace Core {
+
+namespace {
+
+struct ProfileSetting {
+    const char* name;
+    std::function<std::string()> get;
+    std::function<bool(const std::string&)> set;
+};
+
+template <typename T>
+ProfileSetting MakeSetting(const char* name, T Settings::Values::*member) {
+    const auto get = [member]() -> std::string {
+        const T& value = Settings::values.*member;
+        if constexpr (std::is_same_v<T, bool>) {
+            return value ? "true" : "false";
+        } else {
+            return std::to_string(value);
+        }
+    };
+    const auto set = [member](const std::string& text) {
+        T& value = Settings::values.*member;
+        if constexpr (std::is_same_v<T, bool>) {
+            if (text == "true" || text == "1") {
+                value = true;
+            } else if (text == "false" || text == "0") {
+                value = false;
+            } else {
+                return false;
+            }
+        } else {
+            char* end = nullptr;
+            errno = 0;
+            const long long number = std::strtoll(text.c_str(), &end, 10);
+            if (end == text.c_str() || *end != '\0' || errno == ERANGE ||
+                number < static_cast<long long>(std::numeric_limits<T>::min()) ||
+                number > static_cast<long long>(std::numeric_limits<T>::max())) {
+                return false;
+            }
+            value = static_cast<T>(number);
+        }
+        return true;
+    };
+    return {name, get, set};
+}
+
+/// The settings a profile can override, all of them read when the emulation starts
+const std::vector<ProfileSetting>& GetProfileSettings() {
+    using Settings::Values;
+    static const std::vector<ProfileSetting> settings{
+        MakeSetting("use_cpu_jit", &Values::use_cpu_jit),
+        MakeSetting("use_multi_core", &Values::use_multi_core),
+        MakeSetting("cpu_clock_percentage", &Values::cpu_clock_percentage),
+        MakeSetting("use_hw_renderer", &Values::use_hw_renderer),
+        MakeSetting("use_hw_shader", &Values::use_hw_shader),
+        MakeSetting("separable_shader", &Values::separable_shader),
+        MakeSetting("shaders_accurate_mul", &Values::shaders_accurate_mul),
+        MakeSetting("shaders_specialize_uniforms", &Values::shaders_specialize_uniforms),
+        MakeSetting("async_shader_compilation", &Values::async_shader_compilation),
+        MakeSetting("use_shader_jit", &Values::use_shader_jit),
+        MakeSetting("parallel_vertex_shading", &Values::parallel_vertex_shading),
+        MakeSetting("parallel_sw_rasterizer", &Values::parallel_sw_rasterizer),
+        MakeSetting("use_gpu_texture_decoding", &Values::use_gpu_texture_decoding),
+        MakeSetting("generate_mipmaps_on_gpu", &Values::generate_mipmaps_on_gpu),
+        MakeSetting("use_gpu_thread", &Values::use_gpu_thread),
+        MakeSetting("resolution_factor", &Values::resolution_factor),
+        MakeSetting("dynamic_resolution", &Values::dynamic_resolution),
+        MakeSetting("enable_dsp_lle", &Values::enable_dsp_lle),
+        MakeSetting("enable_dsp_lle_multithread", &Values::enable_dsp_lle_multithread),
+        MakeSetting("enable_audio_stretching", &Values::enable_audio_stretching),
+    };
+    return settings;
+}
+
+struct Preset {
+    u64 program_id;
+    const char* profile;
+};
+
+/// Profiles shipped with Citra, only for titles whose overrides were measured to be safe. Keep
+/// them sorted by program id.
+constexpr std::array<Preset, 0> presets{};
+
+} // Anonymous namespace
+
+TitleProfile::TitleProfile(u64 program_id) {
+    const auto preset = std::find_if(presets.begin(), presets.end(), [program_id](const Preset& p) {
+        return p.program_id == program_id;
+    });
+    if (preset != presets.end()) {
+        Parse(preset->profile, "preset");
+    }
+
+    const std::string path = fmt::format(
+        "{}profiles/{:016X}.ini", FileUtil::GetUserPath(FileUtil::UserPath::ConfigDir), program_id);
+    std::string profile;
+    if (FileUtil::ReadFileToString(true, path, profile) > 0) {
+        Parse(profile, path);
+    }
+
+    if (!overrides.empty()) {
+        LOG_INFO(Core, "Title profile of {:016X} overrides {} settings", program_id,
+                 overrides.size());
+    }
+}
+
+TitleProfile::~TitleProfile() {
+    Restore();
+}
+
+void TitleProfile::Apply() {
+    if (applied) {
+        return;
+    }
+    const auto& settings = GetProfileSettings();
+    for (Override& entry : overrides) {
+        const ProfileSetting& setting = settings[entry.setting];
+        entry.global_value = setting.get();
+        setting.set(entry.value);
+        // Compare against the formatted value, a profile may spell it differently
+        entry.value = setting.get();
+    }
+    applied = true;
+}
+
+void TitleProfile::Restore() {
+    if (!applied) {
+        return;
+    }
+    const auto& settings = GetProfileSettings();
+    for (const Override& entry : overrides) {
+        const ProfileSetting& setting = settings[entry.setting];
+        if (setting.get() == entry.value) {
+            setting.set(entry.global_value);
+        }
+    }
+    applied = false;
+}
+
+void TitleProfile::Parse(const std::string& profile, const std::string& source) {
+    const auto& settings = GetProfileSettings();
+    std::size_t line_start = 0;
+    while (line_start < profile.size()) {
+        std::size_t line_end = profile.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = profile.size();
+        }
+        std::string line = profile.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        line = Common::StripSpaces(line.substr(0, line.find_first_of("#;")));
+        if (line.empty() || line.front() == '[') {
+            continue;
+        }
+
+        const std::size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            LOG_ERROR(Core, "Ignoring line \"{}\" of {}", line, source);
+            continue;
+        }
+        const std::string key = Common::StripSpaces(line.substr(0, separator));
+        const std::string value = Common::StripSpaces(line.substr(separator + 1));
+
+        const auto setting =
+            std::find_if(settings.begin(), settings.end(),
+                         [&key](const ProfileSetting& setting) { return key == setting.name; });
+        if (setting == settings.end()) {
+            LOG_ERROR(Core, "Unknown setting {} in {}", key, source);
+            continue;
+        }
+
+        // Check the value right away, the global one is put back right after
+        const std::string global_value = setting->get();
+        const bool valid = setting->set(value);
+        setting->set(global_value);
+        if (!valid) {
+            LOG_ERROR(Core, "Invalid value {} of {} in {}", value, key, source);
+            continue;
+        }
+
+        const std::size_t index = static_cast<std::size_t>(setting - settings.begin());
+        const auto existing =
+            std::find_if(overrides.begin(), overrides.end(),
+                         [index](const Override& entry) { return entry.setting == index; });
+        if (existing != overrides.end()) {
+            existing->value = value;
+        } else {
+            overrides.push_back({index, value, {}});
+        }
+    }
+}
+
+} // namespace Core
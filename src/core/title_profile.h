@@ -0,0 +1,62 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Core {
+
+/**
+ * Overrides of the global settings for one title, so that each title of a catalog runs with the
+ * fastest settings known to be safe for it instead of the ones every title tolerates. The
+ * overrides come from the presets built into Citra, then from the local profile in
+ * "<config dir>/profiles/<program id>.ini", whose keys win. A profile holds "key = value" lines
+ * named like the keys of the configuration files, "#" and ";" start comments and section headers
+ * are ignored. Only the settings read when the emulation starts can be overridden.
+ */
+class TitleProfile {
+public:
+    /// Loads the preset and the local profile of a title
+    explicit TitleProfile(u64 program_id);
+
+    /// Restores the global settings
+    ~TitleProfile();
+
+    TitleProfile(const TitleProfile&) = delete;
+    TitleProfile& operator=(const TitleProfile&) = delete;
+
+    /// Returns whether the title has no override at all
+    bool IsEmpty() const {
+        return overrides.empty();
+    }
+
+    /// Writes the overrides to Settings::values, keeping the global values they replace
+    void Apply();
+
+    /**
+     * Puts the global values back into Settings::values. A setting changed since Apply, from
+     * the configuration of the frontend, keeps its new value as the global one.
+     */
+    void Restore();
+
+private:
+    struct Override {
+        /// Index of the setting in the table of overridable settings
+        std::size_t setting;
+        std::string value;
+        /// Value of the setting before Apply
+        std::string global_value;
+    };
+
+    /// Parses a profile, adding its overrides over the ones already loaded
+    void Parse(const std::string& profile, const std::string& source);
+
+    std::vector<Override> overrides;
+    bool applied = false;
+};
+
+} // namespace Core
@@ -10,6 +10,15 @@ namespace CiTrace {
 
 // NOTE: Things are stored in little-endian
 
+// Version 1 stores the memory data and then the stream elements uncompressed, with memory loads
+// referring to their data by file offset.
+//
+// Version 2 stores the stream as a sequence of chunks running from stream_offset to the end of the
+// file, so that it can be written while recording. Each chunk is a CTStreamChunk followed by a
+// Zstandard frame. Decompressed and concatenated, the chunks hold the stream elements, each memory
+// load directly followed by its data unless it reuses the data of an earlier one. The file offset
+// of a memory load is the offset of its data within that decompressed stream.
+
 #pragma pack(1)
 
 struct CTHeader {
@@ -18,7 +27,7 @@ struct CTHeader {
     }
 
     static u32 ExpectedVersion() {
-        return 1;
+        return 2;
     }
 
     char magic[4];
@@ -57,7 +66,12 @@ struct CTHeader {
     } initial_state_offsets;
 
     u32 stream_offset;
-    u32 stream_size;
+    u32 stream_size; ///< Number of stream elements
+};
+
+struct CTStreamChunk {
+    u32 compressed_size;
+    u32 decompressed_size;
 };
 
 enum CTStreamElementType : u32 {
@@ -70,7 +84,7 @@ struct CTMemoryLoad {
     u32 file_offset;
     u32 size;
     u32 physical_address;
-    u32 pad;
+    u32 file_offset_high; ///< High bits of the offset into the decompressed stream in version 2
 };
 
 struct CTRegisterWrite {
@@ -0,0 +1,274 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/zstd_compression.h"
+#include "core/hw/gpu.h"
+#include "core/hw/hw.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/tracer/player.h"
+#include "video_core/pica_state.h"
+#include "video_core/rasterizer_interface.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace CiTrace {
+
+Player::Player(const std::string& filename) {
+    FileUtil::IOFile file(filename, "rb");
+    if (!file.IsOpen()) {
+        LOG_ERROR(HW_GPU, "Could not open CiTrace {}", filename);
+        return;
+    }
+    data.resize(file.GetSize());
+    if (file.ReadBytes(data.data(), data.size()) != data.size() || data.size() < sizeof(header)) {
+        LOG_ERROR(HW_GPU, "Could not read CiTrace {}", filename);
+        return;
+    }
+
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, CTHeader::ExpectedMagicWord(), sizeof(header.magic)) != 0 ||
+        (header.version != 1 && header.version != CTHeader::ExpectedVersion())) {
+        LOG_ERROR(HW_GPU, "{} is not a CiTrace of version 1 to {}", filename,
+                  CTHeader::ExpectedVersion());
+        return;
+    }
+
+    const auto& initial = header.initial_state_offsets;
+    const std::pair<u32, u32> ranges[] = {
+        {initial.gpu_registers, initial.gpu_registers_size},
+        {initial.lcd_registers, initial.lcd_registers_size},
+        {initial.pica_registers, initial.pica_registers_size},
+        {initial.default_attributes, initial.default_attributes_size},
+        {initial.vs_program_binary, initial.vs_program_binary_size},
+        {initial.vs_swizzle_data, initial.vs_swizzle_data_size},
+        {initial.vs_float_uniforms, initial.vs_float_uniforms_size},
+        {initial.gs_program_binary, initial.gs_program_binary_size},
+        {initial.gs_swizzle_data, initial.gs_swizzle_data_size},
+        {initial.gs_float_uniforms, initial.gs_float_uniforms_size},
+    };
+    for (const auto& [offset, size] : ranges) {
+        if (!IsInFile(offset, u64{size} * sizeof(u32))) {
+            LOG_ERROR(HW_GPU, "The initial state of CiTrace {} is truncated", filename);
+            return;
+        }
+    }
+    if (header.version == 1) {
+        if (!IsInFile(header.stream_offset, u64{header.stream_size} * sizeof(CTStreamElement))) {
+            LOG_ERROR(HW_GPU, "The command stream of CiTrace {} is truncated", filename);
+            return;
+        }
+        stream.resize(header.stream_size);
+        std::memcpy(stream.data(), data.data() + header.stream_offset,
+                    stream.size() * sizeof(CTStreamElement));
+        memory_data = &data;
+    } else {
+        if (!ReadStreamChunks()) {
+            LOG_ERROR(HW_GPU, "The command stream of CiTrace {} is corrupted", filename);
+            return;
+        }
+        memory_data = &stream_data;
+    }
+
+    for (const CTStreamElement& element : stream) {
+        const u64 size = memory_data->size();
+        if (element.type == MemoryLoad && (MemoryLoadOffset(element.memory_load) > size ||
+                                           element.memory_load.size >
+                                               size - MemoryLoadOffset(element.memory_load))) {
+            LOG_ERROR(HW_GPU, "A memory load of CiTrace {} is truncated", filename);
+            return;
+        }
+        if (element.type == FrameMarker) {
+            ++num_frames;
+        }
+    }
+    valid = true;
+}
+
+bool Player::IsInFile(u64 offset, u64 size) const {
+    return offset <= data.size() && size <= data.size() - offset;
+}
+
+bool Player::ReadStreamChunks() {
+    u64 offset = header.stream_offset;
+    while (offset < data.size()) {
+        CTStreamChunk chunk;
+        if (!IsInFile(offset, sizeof(chunk))) {
+            return false;
+        }
+        std::memcpy(&chunk, data.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        if (!IsInFile(offset, chunk.compressed_size)) {
+            return false;
+        }
+        const std::vector<u8> decompressed = Common::Compression::DecompressDataZSTDBounded(
+            data.data() + offset, chunk.compressed_size, chunk.decompressed_size);
+        if (decompressed.size() != chunk.decompressed_size) {
+            return false;
+        }
+        stream_data.insert(stream_data.end(), decompressed.begin(), decompressed.end());
+        offset += chunk.compressed_size;
+    }
+
+    // Memory loads bringing new data along are directly followed by it
+    std::size_t position = 0;
+    stream.reserve(header.stream_size);
+    while (stream.size() < header.stream_size) {
+        CTStreamElement element;
+        if (position > stream_data.size() || stream_data.size() - position < sizeof(element)) {
+            return false;
+        }
+        std::memcpy(&element, stream_data.data() + position, sizeof(element));
+        position += sizeof(element);
+        if (element.type == MemoryLoad && MemoryLoadOffset(element.memory_load) == position) {
+            position += element.memory_load.size;
+        }
+        stream.push_back(element);
+    }
+    return true;
+}
+
+std::vector<u32> Player::ReadWords(u32 offset, u32 size) const {
+    std::vector<u32> words(size);
+    std::memcpy(words.data(), data.data() + offset, words.size() * sizeof(u32));
+    return words;
+}
+
+std::vector<Player::Clock::duration> Player::Play() {
+    std::vector<Clock::duration> frame_times;
+    if (!valid) {
+        return frame_times;
+    }
+    frame_times.reserve(num_frames);
+
+    ApplyInitialState();
+    Clock::time_point frame_begin = Clock::now();
+    for (const CTStreamElement& element : stream) {
+        switch (element.type) {
+        case FrameMarker: {
+            // The frame ends like it does on the console with the vblank presenting it
+            VideoCore::RunOnGPUThread([] { VideoCore::g_renderer->SwapBuffers(); });
+            const Clock::time_point frame_end = Clock::now();
+            frame_times.push_back(frame_end - frame_begin);
+            frame_begin = frame_end;
+            break;
+        }
+        case MemoryLoad:
+            ApplyMemoryLoad(element.memory_load);
+            break;
+        case RegisterWrite:
+            ApplyRegisterWrite(element.register_write);
+            break;
+        default:
+            LOG_ERROR(HW_GPU, "Unknown CiTrace stream element {:#X}",
+                      static_cast<u32>(element.type));
+            break;
+        }
+    }
+    return frame_times;
+}
+
+void Player::ApplyInitialState() {
+    const auto& initial = header.initial_state_offsets;
+    const auto copy_words = [this](u32 offset, u32 size, void* dest, std::size_t dest_size) {
+        const std::vector<u32> words = ReadWords(offset, size);
+        std::memcpy(dest, words.data(), std::min(dest_size, words.size() * sizeof(u32)));
+    };
+    // Float24 values are stored as their raw bits in the low 24 bits of each word, with four words
+    // per vector of which the recorder only fills the first three
+    const auto copy_float24 = [this](u32 offset, u32 size, auto& vectors) {
+        const std::vector<u32> words = ReadWords(offset, size);
+        const std::size_t count = std::min<std::size_t>(std::size(vectors), words.size() / 4);
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t comp = 0; comp < 3; ++comp) {
+                vectors[i][comp] = Pica::float24::FromRaw(words[4 * i + comp] & 0xFFFFFF);
+            }
+        }
+    };
+
+    copy_words(initial.gpu_registers, initial.gpu_registers_size, &GPU::g_regs,
+               sizeof(GPU::g_regs));
+    copy_words(initial.lcd_registers, initial.lcd_registers_size, &LCD::g_regs,
+               sizeof(LCD::g_regs));
+
+    VideoCore::RunOnGPUThread([&] {
+        auto& state = Pica::g_state;
+        copy_words(initial.pica_registers, initial.pica_registers_size, &state.regs,
+                   sizeof(state.regs));
+        copy_float24(initial.default_attributes, initial.default_attributes_size,
+                     state.input_default_attributes.attr);
+
+        const auto copy_shader = [&](Pica::Shader::ShaderSetup& setup, u32 program_binary,
+                                     u32 program_binary_size, u32 swizzle_data,
+                                     u32 swizzle_data_size, u32 float_uniforms,
+                                     u32 float_uniforms_size) {
+            copy_words(program_binary, program_binary_size, setup.program_code.data(),
+                       sizeof(setup.program_code));
+            copy_words(swizzle_data, swizzle_data_size, setup.swizzle_data.data(),
+                       sizeof(setup.swizzle_data));
+            copy_float24(float_uniforms, float_uniforms_size, setup.uniforms.f);
+            setup.MarkProgramCodeDirty();
+            setup.MarkSwizzleDataDirty();
+        };
+        copy_shader(state.vs, initial.vs_program_binary, initial.vs_program_binary_size,
+                    initial.vs_swizzle_data, initial.vs_swizzle_data_size,
+                    initial.vs_float_uniforms, initial.vs_float_uniforms_size);
+        copy_shader(state.gs, initial.gs_program_binary, initial.gs_program_binary_size,
+                    initial.gs_swizzle_data, initial.gs_swizzle_data_size,
+                    initial.gs_float_uniforms, initial.gs_float_uniforms_size);
+
+        // Every run starts without the surfaces cached by the previous one
+        auto* rasterizer = VideoCore::g_renderer->Rasterizer();
+        rasterizer->ClearAll(false);
+        rasterizer->SyncEntireState();
+    });
+}
+
+void Player::ApplyMemoryLoad(const CTMemoryLoad& load) {
+    if (load.size == 0) {
+        return;
+    }
+    Memory::MemorySystem& memory = *VideoCore::g_memory;
+    if (!memory.IsValidPhysicalAddress(load.physical_address) ||
+        !memory.IsValidPhysicalAddress(load.physical_address + load.size - 1)) {
+        LOG_ERROR(HW_GPU, "CiTrace memory load to invalid address {:#010X}",
+                  load.physical_address);
+        return;
+    }
+    VideoCore::RunOnGPUThread([&] {
+        std::memcpy(memory.GetPhysicalPointer(load.physical_address),
+                    memory_data->data() + MemoryLoadOffset(load), load.size);
+        VideoCore::g_renderer->Rasterizer()->InvalidateRegion(load.physical_address, load.size);
+    });
+}
+
+void Player::ApplyRegisterWrite(const CTRegisterWrite& write) {
+    // The recorder stores the physical addresses of the registers
+    const u32 address = write.physical_address - Memory::IO_AREA_PADDR + Memory::IO_AREA_VADDR;
+    switch (write.size) {
+    case CTRegisterWrite::SIZE_8:
+        HW::Write<u8>(address, static_cast<u8>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_16:
+        HW::Write<u16>(address, static_cast<u16>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_32:
+        HW::Write<u32>(address, static_cast<u32>(write.value));
+        break;
+    case CTRegisterWrite::SIZE_64:
+        HW::Write<u64>(address, write.value);
+        break;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown CiTrace register write size {:#X}",
+                  static_cast<u32>(write.size));
+        break;
+    }
+}
+
+} // namespace CiTrace
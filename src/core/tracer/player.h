@@ -0,0 +1,73 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "common/common_types.h"
+#include "core/tracer/citrace.h"
+
+namespace CiTrace {
+
+/**
+ * Replays a CiTrace recorded by the Recorder through the GPU emulation, so that the rendering of
+ * the same frames can be timed again and again. The system has to be initialized with
+ * Core::System::InitTracePlayback first.
+ */
+class Player {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Loads the trace, check IsValid to know whether that worked
+    explicit Player(const std::string& filename);
+
+    bool IsValid() const {
+        return valid;
+    }
+
+    /// Number of frames the trace holds
+    u32 NumFrames() const {
+        return num_frames;
+    }
+
+    /**
+     * Replays all frames of the trace, starting from its initial state.
+     * @returns the time taken by each frame, which covers processing its commands and presenting
+     *          it
+     */
+    std::vector<Clock::duration> Play();
+
+private:
+    /// Returns whether the range of the file lies within the loaded data
+    bool IsInFile(u64 offset, u64 size) const;
+
+    /// Decompresses the chunks of a version 2 stream and parses its elements
+    bool ReadStreamChunks();
+
+    /// Returns the u32 values of an initial state range
+    std::vector<u32> ReadWords(u32 offset, u32 size) const;
+
+    void ApplyInitialState();
+    void ApplyMemoryLoad(const CTMemoryLoad& load);
+    void ApplyRegisterWrite(const CTRegisterWrite& write);
+
+    /// Offset of the data of a memory load within the memory data
+    static u64 MemoryLoadOffset(const CTMemoryLoad& load) {
+        return (u64{load.file_offset_high} << 32) | load.file_offset;
+    }
+
+    std::vector<u8> data;
+    /// The decompressed stream of a version 2 trace
+    std::vector<u8> stream_data;
+    /// Where the data of memory loads lies, the file itself or the decompressed stream
+    const std::vector<u8>* memory_data = nullptr;
+    CTHeader header;
+    std::vector<CTStreamElement> stream;
+    u32 num_frames = 0;
+    bool valid = false;
+};
+
+} // namespace CiTrace
@@ -3,18 +3,19 @@
 // Refer to the license.txt file included.
 
 #include <cstring>
-#include "common/assert.h"
-#include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
+#include "common/thread.h"
+#include "common/zstd_compression.h"
 #include "core/tracer/recorder.h"
 
 namespace CiTrace {
 
-Recorder::Recorder(const InitialState& initial_state) : initial_state(initial_state) {}
+/// Decompressed size at which a chunk is handed to the writer thread
+constexpr std::size_t ChunkSize = 1024 * 1024;
 
-void Recorder::Finish(const std::string& filename) {
+Recorder::Recorder(const InitialState& initial_state) {
     // Setup CiTrace header
-    CTHeader header;
     std::memcpy(header.magic, CTHeader::ExpectedMagicWord(), 4);
     header.version = CTHeader::ExpectedVersion();
     header.header_size = sizeof(CTHeader);
@@ -32,12 +33,10 @@ void Recorder::Finish(const std::string& filename) {
     initial.gs_program_binary_size = static_cast<u32>(initial_state.gs_program_binary.size());
     initial.gs_swizzle_data_size = static_cast<u32>(initial_state.gs_swizzle_data.size());
     initial.gs_float_uniforms_size = static_cast<u32>(initial_state.gs_float_uniforms.size());
-    header.stream_size = static_cast<u32>(stream.size());
 
     initial.gpu_registers = sizeof(header);
     initial.lcd_registers = initial.gpu_registers + initial.gpu_registers_size * sizeof(u32);
     initial.pica_registers = initial.lcd_registers + initial.lcd_registers_size * sizeof(u32);
-    ;
     initial.default_attributes = initial.pica_registers + initial.pica_registers_size * sizeof(u32);
     initial.vs_program_binary =
         initial.default_attributes + initial.default_attributes_size * sizeof(u32);
@@ -53,29 +52,13 @@ void Recorder::Finish(const std::string& filename) {
         initial.gs_swizzle_data + initial.gs_swizzle_data_size * sizeof(u32);
     header.stream_offset = initial.gs_float_uniforms + initial.gs_float_uniforms_size * sizeof(u32);
 
-    // Iterate through stream elements, update relevant stream element data
-    for (auto& stream_element : stream) {
-        switch (stream_element.data.type) {
-        case MemoryLoad: {
-            auto& file_offset = memory_regions[stream_element.hash];
-            if (!stream_element.uses_existing_data) {
-                file_offset = header.stream_offset;
-            }
-            stream_element.data.memory_load.file_offset = file_offset;
-            break;
-        }
-
-        default:
-            // Other commands don't use any extra data
-            DEBUG_ASSERT(stream_element.extra_data.size() == 0);
-            break;
-        }
-        header.stream_offset += static_cast<u32>(stream_element.extra_data.size());
-    }
+    const std::string& cache_dir = FileUtil::GetUserPath(FileUtil::UserPath::CacheDir);
+    FileUtil::CreateFullPath(cache_dir);
+    temporary_path = cache_dir + "citrace_recording.ctf";
 
     try {
-        // Open file and write header
-        FileUtil::IOFile file(filename, "wb");
+        // Open file and write header, it is written again with the stream size in Finish
+        file = FileUtil::IOFile(temporary_path, "wb");
         std::size_t written = file.WriteObject(header);
         if (written != 1 || file.Tell() != initial.gpu_registers)
             throw "Failed to write header";
@@ -136,69 +119,150 @@ void Recorder::Finish(const std::string& filename) {
         written = file.WriteArray(initial_state.gs_float_uniforms.data(),
                                   initial_state.gs_float_uniforms.size());
         if (written != initial_state.gs_float_uniforms.size() ||
-            file.Tell() != initial.gs_float_uniforms + sizeof(u32) * initial.gs_float_uniforms_size)
+            file.Tell() != header.stream_offset)
             throw "Failed to write geometry shader float uniforms";
+    } catch (const char* str) {
+        LOG_ERROR(HW_GPU, "Writing CiTrace file failed: {}", str);
+        write_failed = true;
+    }
 
-        // Iterate through stream elements, write "extra data"
-        for (const auto& stream_element : stream) {
-            if (stream_element.extra_data.size() == 0)
-                continue;
+    chunk.reserve(ChunkSize);
+    writer_thread = std::thread([this] { WriterLoop(); });
+}
 
-            written =
-                file.WriteBytes(stream_element.extra_data.data(), stream_element.extra_data.size());
-            if (written != stream_element.extra_data.size())
-                throw "Failed to write extra data";
-        }
+Recorder::~Recorder() {
+    if (writer_thread.joinable()) {
+        StopWriter();
+        file.Close();
+        FileUtil::Delete(temporary_path);
+    }
+}
 
-        if (file.Tell() != header.stream_offset)
-            throw "Unexpected end of extra data";
+void Recorder::Finish(const std::string& filename) {
+    if (!writer_thread.joinable()) {
+        LOG_ERROR(HW_GPU, "CiTrace recording was already finished");
+        return;
+    }
+    {
+        std::lock_guard lock{mutex};
+        SubmitChunk();
+        header.stream_size = num_elements;
+    }
+    StopWriter();
+
+    try {
+        if (write_failed)
+            throw "Failed to write stream chunks";
+
+        // Write the header again now that the stream size is known
+        if (!file.Seek(0, SEEK_SET) || file.WriteObject(header) != 1)
+            throw "Failed to write header";
+        file.Close();
 
-        // Write actual stream elements
-        for (const auto& stream_element : stream) {
-            if (1 != file.WriteObject(stream_element.data))
-                throw "Failed to write stream element";
+        if (!FileUtil::Rename(temporary_path, filename)) {
+            // The cache directory may lie on another file system
+            if (!FileUtil::Copy(temporary_path, filename))
+                throw "Failed to move the recording to its destination";
+            FileUtil::Delete(temporary_path);
         }
     } catch (const char* str) {
         LOG_ERROR(HW_GPU, "Writing CiTrace file failed: {}", str);
+        file.Close();
+        FileUtil::Delete(temporary_path);
     }
 }
 
+void Recorder::AddElement(const CTStreamElement& element, const u8* extra_data, u32 extra_size) {
+    const std::size_t offset = chunk.size();
+    chunk.resize(offset + sizeof(element) + extra_size);
+    std::memcpy(chunk.data() + offset, &element, sizeof(element));
+    if (extra_size != 0) {
+        std::memcpy(chunk.data() + offset + sizeof(element), extra_data, extra_size);
+    }
+    stream_position += sizeof(element) + extra_size;
+    ++num_elements;
+
+    if (chunk.size() >= ChunkSize) {
+        SubmitChunk();
+    }
+}
+
+void Recorder::SubmitChunk() {
+    if (chunk.empty()) {
+        return;
+    }
+    chunks.Push(std::move(chunk));
+    chunk = std::vector<u8>();
+    chunk.reserve(ChunkSize);
+}
+
+void Recorder::WriterLoop() {
+    Common::SetCurrentThreadName("CiTraceWriter");
+    Common::SetCurrentThreadRole(Common::ThreadRole::Background);
+    while (true) {
+        const std::vector<u8> data = chunks.PopWait();
+        if (data.empty()) {
+            return;
+        }
+        if (write_failed) {
+            continue;
+        }
+
+        const std::vector<u8> compressed =
+            Common::Compression::CompressDataZSTDDefault(data.data(), data.size());
+        const CTStreamChunk chunk_header{static_cast<u32>(compressed.size()),
+                                         static_cast<u32>(data.size())};
+        if (compressed.empty() || file.WriteObject(chunk_header) != 1 ||
+            file.WriteBytes(compressed.data(), compressed.size()) != compressed.size()) {
+            LOG_ERROR(HW_GPU, "Writing CiTrace file failed: Failed to write stream chunk");
+            write_failed = true;
+        }
+    }
+}
+
+void Recorder::StopWriter() {
+    chunks.Push(std::vector<u8>());
+    writer_thread.join();
+}
+
 void Recorder::FrameFinished() {
-    stream.push_back({{FrameMarker}});
+    std::lock_guard lock{mutex};
+    AddElement({FrameMarker});
 }
 
 void Recorder::MemoryAccessed(const u8* data, u32 size, u32 physical_address) {
-    StreamElement element = {{MemoryLoad}};
-    element.data.memory_load.size = size;
-    element.data.memory_load.physical_address = physical_address;
-
-    // Compute hash over given memory region to check if the contents are already stored internally
-    boost::crc_32_type result;
-    result.process_bytes(data, size);
-    element.hash = result.checksum();
-
-    element.uses_existing_data = (memory_regions.find(element.hash) != memory_regions.end());
-    if (!element.uses_existing_data) {
-        element.extra_data.resize(size);
-        memcpy(element.extra_data.data(), data, size);
-        memory_regions.insert({element.hash, 0}); // file offset will be initialized in Finish()
+    CTStreamElement element = {MemoryLoad};
+    element.memory_load.size = size;
+    element.memory_load.physical_address = physical_address;
+
+    // Hash the given memory region to check if the contents are already stored
+    const auto [hash_low, hash_high] = Common::ComputeHash128(data, size);
+    const MemoryRegionKey key{hash_low, hash_high, size};
+
+    std::lock_guard lock{mutex};
+    const auto [it, inserted] = memory_regions.try_emplace(key, stream_position + sizeof(element));
+    element.memory_load.file_offset = static_cast<u32>(it->second);
+    element.memory_load.file_offset_high = static_cast<u32>(it->second >> 32);
+    if (inserted) {
+        AddElement(element, data, size);
+    } else {
+        AddElement(element);
     }
-
-    stream.push_back(element);
 }
 
 template <typename T>
 void Recorder::RegisterWritten(u32 physical_address, T value) {
-    StreamElement element = {{RegisterWrite}};
-    element.data.register_write.size =
+    CTStreamElement element = {RegisterWrite};
+    element.register_write.size =
         (sizeof(T) == 1) ? CTRegisterWrite::SIZE_8
                          : (sizeof(T) == 2) ? CTRegisterWrite::SIZE_16
                                             : (sizeof(T) == 4) ? CTRegisterWrite::SIZE_32
                                                                : CTRegisterWrite::SIZE_64;
-    element.data.register_write.physical_address = physical_address;
-    element.data.register_write.value = value;
+    element.register_write.physical_address = physical_address;
+    element.register_write.value = value;
 
-    stream.push_back(element);
+    std::lock_guard lock{mutex};
+    AddElement(element);
 }
 
 template void Recorder::RegisterWritten(u32, u8);
@@ -4,11 +4,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
-#include <boost/crc.hpp>
 #include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/threadsafe_queue.h"
 #include "core/tracer/citrace.h"
 
 namespace CiTrace {
@@ -29,11 +33,15 @@ public:
     };
 
     /**
-     * Recorder constructor
+     * Recorder constructor. The recording is written to a temporary file in the cache directory
+     * while it goes on, compressed on a background thread.
      * @param initial_state Initial recorder state
      */
     explicit Recorder(const InitialState& initial_state);
 
+    /// Discards the recording if it wasn't finished
+    ~Recorder();
+
     /// Finish recording of this Citrace and save it using the given filename.
     void Finish(const std::string& filename);
 
@@ -55,33 +63,55 @@ public:
     void RegisterWritten(u32 physical_address, T value);
 
 private:
-    // Initial state of recording start
-    InitialState initial_state;
+    /// Identifies memory contents, 64 bits of hash alone collide too easily over long recordings
+    struct MemoryRegionKey {
+        u64 hash_low;
+        u64 hash_high;
+        u32 size;
+
+        bool operator==(const MemoryRegionKey& other) const {
+            return hash_low == other.hash_low && hash_high == other.hash_high &&
+                   size == other.size;
+        }
+    };
 
-    // Command stream
-    struct StreamElement {
-        CTStreamElement data;
+    struct MemoryRegionKeyHash {
+        std::size_t operator()(const MemoryRegionKey& key) const {
+            return static_cast<std::size_t>(key.hash_low);
+        }
+    };
 
-        /**
-         * Extra data to store along "core" data.
-         * This is e.g. used for data used in MemoryUpdates.
-         */
-        std::vector<u8> extra_data;
+    /// Appends a stream element and the data following it to the current chunk
+    void AddElement(const CTStreamElement& element, const u8* extra_data = nullptr,
+                    u32 extra_size = 0);
 
-        /// Optional CRC hash (e.g. for hashing memory regions)
-        boost::crc_32_type::value_type hash;
+    /// Hands the current chunk to the writer thread, call with mutex held
+    void SubmitChunk();
 
-        /// If true, refer to data already written to the output file instead of extra_data
-        bool uses_existing_data;
-    };
+    void WriterLoop();
 
-    std::vector<StreamElement> stream;
+    /// Stops the writer thread after it wrote all submitted chunks
+    void StopWriter();
 
-    /**
-     * Internal cache which maps hashes of memory contents to file offsets at which those memory
-     * contents are stored.
-     */
-    std::unordered_map<boost::crc_32_type::value_type /*hash*/, u32 /*file_offset*/> memory_regions;
+    CTHeader header{};
+    std::string temporary_path;
+    /// Only accessed by the writer thread while it runs
+    FileUtil::IOFile file;
+    std::atomic_bool write_failed{false};
+
+    /// Guards the state below, the GPU registers are written from the CPU and GPU threads
+    std::mutex mutex;
+    std::vector<u8> chunk;
+    /// Size of the decompressed stream so far
+    u64 stream_position = 0;
+    u32 num_elements = 0;
+
+    /// Maps memory contents to their offset in the decompressed stream
+    std::unordered_map<MemoryRegionKey, u64, MemoryRegionKeyHash> memory_regions;
+
+    /// Decompressed chunks for the writer thread, an empty chunk stops it
+    Common::SPSCQueue<std::vector<u8>> chunks;
+    std::thread writer_thread;
 };
 
 } // namespace CiTrace
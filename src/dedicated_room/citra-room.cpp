@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <iostream>
@@ -9,6 +10,7 @@
 #include <regex>
 #include <string>
 #include <thread>
+#include <vector>
 #include <cryptopp/base64.h>
 #include <glad/glad.h>
 
@@ -47,7 +49,7 @@
 static void PrintHelp(const char* argv0) {
     std::cout << "Usage: " << argv0
               << " [options] <filename>\n"
-                 "--room-name         The name of the room\n"
+                 "--room-name         The name of the room, repeat it to host several rooms\n"
                  "--room-description  The room description\n"
                  "--port              The port used for the room\n"
                  "--max_members       The maximum number of players for this room\n"
@@ -61,7 +63,11 @@ static void PrintHelp(const char* argv0) {
                  "--log-file          The file for storing the room log\n"
                  "--enable-citra-mods Allow Citra Community Moderators to moderate on your room\n"
                  "-h, --help          Display this help and exit\n"
-                 "-v, --version       Output version information and exit\n";
+                 "-v, --version       Output version information and exit\n"
+                 "\n"
+                 "The name, description, port, max_members, password, preferred game and\n"
+                 "ban list file apply to the room of the last --room-name given before them,\n"
+                 "or to the first room if none was given yet. Each room needs its own port.\n";
 }
 
 static void PrintVersion() {
@@ -164,6 +170,50 @@ static void InitializeLogging(const std::string& log_file) {
 #endif
 }
 
+/// Settings of a room hosted by this process
+struct RoomConfig {
+    std::string name;
+    std::string description;
+    std::string password;
+    std::string preferred_game;
+    std::string ban_list_file;
+    u64 preferred_game_id = 0;
+    u32 port = Network::DefaultRoomPort;
+    u32 max_members = 16;
+};
+
+/// Checks the settings of a room, printing what is wrong with them
+static bool ValidateRoomConfig(const RoomConfig& config) {
+    if (config.name.empty()) {
+        std::cout << "room name is empty!\n\n";
+        return false;
+    }
+    if (config.preferred_game.empty()) {
+        std::cout << "preferred game of " << config.name << " is empty!\n\n";
+        return false;
+    }
+    if (config.preferred_game_id == 0) {
+        std::cout << "preferred-game-id of " << config.name
+                  << " not set!\nThis should get set to allow users to find your "
+                     "room.\nSet with --preferred-game-id id\n\n";
+    }
+    if (config.max_members > Network::MaxConcurrentConnections || config.max_members < 2) {
+        std::cout << "max_members needs to be in the range 2 - "
+                  << Network::MaxConcurrentConnections << "!\n\n";
+        return false;
+    }
+    if (config.port > 65535) {
+        std::cout << "port needs to be in the range 0 - 65535!\n\n";
+        return false;
+    }
+    if (config.ban_list_file.empty()) {
+        std::cout << "Ban list file of " << config.name
+                  << " not set!\nThis should get set to load and save room ban "
+                     "list.\nSet with --ban-list-file <file>\n\n";
+    }
+    return true;
+}
+
 /// Application entry point
 int main(int argc, char** argv) {
     Common::DetachedTasks detached_tasks;
@@ -173,18 +223,11 @@ int main(int argc, char** argv) {
     // This is just to be able to link against core
     gladLoadGL();
 
-    std::string room_name;
-    std::string room_description;
-    std::string password;
-    std::string preferred_game;
+    std::vector<RoomConfig> room_configs(1);
     std::string username;
     std::string token;
     std::string web_api_url;
-    std::string ban_list_file;
     std::string log_file = "citra-room.log";
-    u64 preferred_game_id = 0;
-    u32 port = Network::DefaultRoomPort;
-    u32 max_members = 16;
     bool enable_citra_mods = false;
 
     static struct option long_options[] = {
@@ -211,25 +254,29 @@ int main(int argc, char** argv) {
         if (arg != -1) {
             switch (static_cast<char>(arg)) {
             case 'n':
-                room_name.assign(optarg);
+                // Another room name starts the settings of the next room
+                if (!room_configs.back().name.empty()) {
+                    room_configs.emplace_back();
+                }
+                room_configs.back().name.assign(optarg);
                 break;
             case 'd':
-                room_description.assign(optarg);
+                room_configs.back().description.assign(optarg);
                 break;
             case 'p':
-                port = strtoul(optarg, &endarg, 0);
+                room_configs.back().port = strtoul(optarg, &endarg, 0);
                 break;
             case 'm':
-                max_members = strtoul(optarg, &endarg, 0);
+                room_configs.back().max_members = strtoul(optarg, &endarg, 0);
                 break;
             case 'w':
-                password.assign(optarg);
+                room_configs.back().password.assign(optarg);
                 break;
             case 'g':
-                preferred_game.assign(optarg);
+                room_configs.back().preferred_game.assign(optarg);
                 break;
             case 'i':
-                preferred_game_id = strtoull(optarg, &endarg, 16);
+                room_configs.back().preferred_game_id = strtoull(optarg, &endarg, 16);
                 break;
             case 'u':
                 username.assign(optarg);
@@ -241,7 +288,7 @@ int main(int argc, char** argv) {
                 web_api_url.assign(optarg);
                 break;
             case 'b':
-                ban_list_file.assign(optarg);
+                room_configs.back().ban_list_file.assign(optarg);
                 break;
             case 'l':
                 log_file.assign(optarg);
@@ -259,34 +306,19 @@ int main(int argc, char** argv) {
         }
     }
 
-    if (room_name.empty()) {
-        std::cout << "room name is empty!\n\n";
-        PrintHelp(argv[0]);
-        return -1;
-    }
-    if (preferred_game.empty()) {
-        std::cout << "preferred game is empty!\n\n";
-        PrintHelp(argv[0]);
-        return -1;
-    }
-    if (preferred_game_id == 0) {
-        std::cout << "preferred-game-id not set!\nThis should get set to allow users to find your "
-                     "room.\nSet with --preferred-game-id id\n\n";
-    }
-    if (max_members > Network::MaxConcurrentConnections || max_members < 2) {
-        std::cout << "max_members needs to be in the range 2 - "
-                  << Network::MaxConcurrentConnections << "!\n\n";
-        PrintHelp(argv[0]);
-        return -1;
-    }
-    if (port > 65535) {
-        std::cout << "port needs to be in the range 0 - 65535!\n\n";
-        PrintHelp(argv[0]);
-        return -1;
-    }
-    if (ban_list_file.empty()) {
-        std::cout << "Ban list file not set!\nThis should get set to load and save room ban "
-                     "list.\nSet with --ban-list-file <file>\n\n";
+    for (const auto& config : room_configs) {
+        if (!ValidateRoomConfig(config)) {
+            PrintHelp(argv[0]);
+            return -1;
+        }
+        const auto same_port = [&config](const RoomConfig& other) {
+            return other.port == config.port;
+        };
+        if (std::count_if(room_configs.begin(), room_configs.end(), same_port) > 1) {
+            std::cout << "port " << config.port << " is used by several rooms!\n\n";
+            PrintHelp(argv[0]);
+            return -1;
+        }
     }
     bool announce = true;
     if (token.empty() && announce) {
@@ -318,39 +350,66 @@ int main(int argc, char** argv) {
 
     InitializeLogging(log_file);
 
-    // Load the ban list
-    Network::Room::BanList ban_list;
-    if (!ban_list_file.empty()) {
-        ban_list = LoadBanList(ban_list_file);
-    }
+    Network::Init();
 
-    std::unique_ptr<Network::VerifyUser::Backend> verify_backend;
-    if (announce) {
+    // All the rooms share this process, the first one is the room of Network::GetRoom
+    std::vector<std::shared_ptr<Network::Room>> rooms;
+    std::vector<std::weak_ptr<Network::Room>> announced_rooms;
+    for (const auto& config : room_configs) {
+        // Load the ban list
+        Network::Room::BanList ban_list;
+        if (!config.ban_list_file.empty()) {
+            ban_list = LoadBanList(config.ban_list_file);
+        }
+
+        std::unique_ptr<Network::VerifyUser::Backend> verify_backend;
+        if (announce) {
 #ifdef ENABLE_WEB_SERVICE
-        verify_backend = std::make_unique<WebService::VerifyUserJWT>(Settings::values.web_api_url);
+            verify_backend =
+                std::make_unique<WebService::VerifyUserJWT>(Settings::values.web_api_url);
 #else
-        std::cout
-            << "Citra Web Services is not available with this build: validation is disabled.\n\n";
-        verify_backend = std::make_unique<Network::VerifyUser::NullBackend>();
+            std::cout << "Citra Web Services is not available with this build: validation is "
+                         "disabled.\n\n";
+            verify_backend = std::make_unique<Network::VerifyUser::NullBackend>();
 #endif
-    } else {
-        verify_backend = std::make_unique<Network::VerifyUser::NullBackend>();
-    }
+        } else {
+            verify_backend = std::make_unique<Network::VerifyUser::NullBackend>();
+        }
 
-    Network::Init();
-    if (std::shared_ptr<Network::Room> room = Network::GetRoom().lock()) {
-        if (!room->Create(room_name, room_description, "", port, password, max_members, username,
-                          preferred_game, preferred_game_id, std::move(verify_backend), ban_list,
+        auto room = rooms.empty() ? Network::GetRoom().lock() : std::make_shared<Network::Room>();
+        if (!room) {
+            break;
+        }
+        if (!room->Create(config.name, config.description, "", config.port, config.password,
+                          config.max_members, username, config.preferred_game,
+                          config.preferred_game_id, std::move(verify_backend), ban_list,
                           enable_citra_mods)) {
-            std::cout << "Failed to create room: \n\n";
+            std::cout << "Failed to create room " << config.name << ": \n\n";
+            for (auto& created : rooms) {
+                created->Destroy();
+            }
+            Network::Shutdown();
             return -1;
         }
-        std::cout << "Room is open. Close with Q+Enter...\n\n";
-        auto announce_session = std::make_unique<Core::AnnounceMultiplayerSession>();
+        rooms.push_back(room);
+        announced_rooms.push_back(room);
+    }
+
+    if (rooms.size() == room_configs.size()) {
+        std::cout << (rooms.size() == 1 ? "Room is open." : "Rooms are open.")
+                  << " Close with Q+Enter...\n\n";
+        // A single thread announces all the rooms
+        auto announce_session =
+            std::make_unique<Core::AnnounceMultiplayerSession>(std::move(announced_rooms));
         if (announce) {
             announce_session->Start();
         }
-        while (room->GetState() == Network::Room::State::Open) {
+        const auto any_open = [&rooms] {
+            return std::any_of(rooms.begin(), rooms.end(), [](const auto& room) {
+                return room->GetState() == Network::Room::State::Open;
+            });
+        };
+        while (any_open()) {
             std::string in;
             std::cin >> in;
             if (in.size() > 0) {
@@ -362,12 +421,15 @@ int main(int argc, char** argv) {
             announce_session->Stop();
         }
         announce_session.reset();
-        // Save the ban list
-        if (!ban_list_file.empty()) {
-            SaveBanList(room->GetBanList(), ban_list_file);
+        for (std::size_t i = 0; i < rooms.size(); ++i) {
+            // Save the ban list
+            if (!room_configs[i].ban_list_file.empty()) {
+                SaveBanList(rooms[i]->GetBanList(), room_configs[i].ban_list_file);
+            }
+            rooms[i]->Destroy();
         }
-        room->Destroy();
     }
+    rooms.clear();
     Network::Shutdown();
     detached_tasks.WaitForAllTasks();
     return 0;
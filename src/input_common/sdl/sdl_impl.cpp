@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <functional>
@@ -54,24 +55,26 @@ public:
                 decltype(&SDL_JoystickClose) deleter = &SDL_JoystickClose)
         : guid{std::move(guid_)}, port{port_}, sdl_joystick{joystick, deleter} {}
 
-    void SetButton(int button, bool value) {
-        std::lock_guard lock{mutex};
-        state.buttons[button] = value;
+    void SetButton(Uint8 button, bool value) {
+        state.buttons[button].store(value, std::memory_order_relaxed);
     }
 
     bool GetButton(int button) const {
-        std::lock_guard lock{mutex};
-        return state.buttons.at(button);
+        if (button < 0 || button >= static_cast<int>(state.buttons.size())) {
+            return false;
+        }
+        return state.buttons[button].load(std::memory_order_relaxed);
     }
 
-    void SetAxis(int axis, Sint16 value) {
-        std::lock_guard lock{mutex};
-        state.axes[axis] = value;
+    void SetAxis(Uint8 axis, Sint16 value) {
+        state.axes[axis].store(value, std::memory_order_relaxed);
     }
 
     float GetAxis(int axis) const {
-        std::lock_guard lock{mutex};
-        return state.axes.at(axis) / 32767.0f;
+        if (axis < 0 || axis >= static_cast<int>(state.axes.size())) {
+            return 0.0f;
+        }
+        return state.axes[axis].load(std::memory_order_relaxed) / 32767.0f;
     }
 
     std::tuple<float, float> GetAnalog(int axis_x, int axis_y) const {
@@ -91,14 +94,15 @@ public:
         return std::make_tuple(x, y);
     }
 
-    void SetHat(int hat, Uint8 direction) {
-        std::lock_guard lock{mutex};
-        state.hats[hat] = direction;
+    void SetHat(Uint8 hat, Uint8 direction) {
+        state.hats[hat].store(direction, std::memory_order_relaxed);
     }
 
     bool GetHatDirection(int hat, Uint8 direction) const {
-        std::lock_guard lock{mutex};
-        return (state.hats.at(hat) & direction) != 0;
+        if (hat < 0 || hat >= static_cast<int>(state.hats.size())) {
+            return false;
+        }
+        return (state.hats[hat].load(std::memory_order_relaxed) & direction) != 0;
     }
     /**
      * The guid of the joystick
@@ -125,15 +129,17 @@ public:
     }
 
 private:
+    /// Indexed by the Uint8 indices of SDL events, so that the devices can read the values without
+    /// taking a lock while the SDL thread updates them. Values not reported yet read as released
+    /// or centered.
     struct State {
-        std::unordered_map<int, bool> buttons;
-        std::unordered_map<int, Sint16> axes;
-        std::unordered_map<int, Uint8> hats;
+        std::array<std::atomic<bool>, 256> buttons{};
+        std::array<std::atomic<Sint16>, 256> axes{};
+        std::array<std::atomic<Uint8>, 256> hats{};
     } state;
     std::string guid;
     int port;
     std::unique_ptr<SDL_Joystick, decltype(&SDL_JoystickClose)> sdl_joystick;
-    mutable std::mutex mutex;
 };
 
 /**
@@ -485,10 +491,12 @@ SDLState::SDLState() {
     initialized = true;
     if (start_thread) {
         poll_thread = std::thread([this] {
-            using namespace std::chrono_literals;
+            // Nothing else takes the SDL events here, the joystick ones are handled by the event
+            // watcher as they get pumped. Waiting for them wakes the thread up as soon as one
+            // comes, rather than pumping at a fixed interval, and keeps the queue from filling up.
+            SDL_Event event;
             while (initialized) {
-                SDL_PumpEvents();
-                std::this_thread::sleep_for(10ms);
+                SDL_WaitEventTimeout(&event, 10);
             }
         });
     }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <type_traits>
 #include <vector>
 #include "common/common_types.h"
 
@@ -124,6 +125,12 @@ Packet& Packet::operator>>(std::vector<T>& out_data) {
     *this >> size;
     out_data.resize(size);
 
+    // Bytes need no endianness conversion, they are read at once
+    if constexpr (std::is_same_v<T, u8> || std::is_same_v<T, s8>) {
+        Read(out_data.data(), out_data.size());
+        return *this;
+    }
+
     // Then extract the data
     for (std::size_t i = 0; i < out_data.size(); ++i) {
         T character;
@@ -148,6 +155,11 @@ Packet& Packet::operator<<(const std::vector<T>& in_data) {
     // First insert the size
     *this << static_cast<u32>(in_data.size());
 
+    if constexpr (std::is_same_v<T, u8> || std::is_same_v<T, s8>) {
+        Append(in_data.data(), in_data.size());
+        return *this;
+    }
+
     // Then insert the data
     for (std::size_t i = 0; i < in_data.size(); ++i) {
         *this << in_data[i];
@@ -4,17 +4,21 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstring>
 #include <iomanip>
 #include <mutex>
 #include <random>
 #include <regex>
+#include <shared_mutex>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 #include "common/logging/log.h"
 #include "enet/enet.h"
 #include "network/packet.h"
 #include "network/room.h"
 #include "network/verify_user.h"
+#include "network/wifi_packet_batch.h"
 
 namespace Network {
 
@@ -42,11 +46,13 @@ public:
         /// Data of the user, often including authenticated forum username.
         VerifyUser::UserData user_data;
         ENetPeer* peer; ///< The remote peer.
+        bool supports_wifi_batches; ///< Whether the member understands IdWifiPacketBatch.
     };
     using MemberList = std::vector<Member>;
     MemberList members;              ///< Information about the members of this room
-    mutable std::mutex member_mutex; ///< Mutex for locking the members list
-    /// This should be a std::shared_mutex as soon as C++17 is supported
+    /// Mutex for the members list. It is only modified by the room thread, which together with
+    /// all the readers elsewhere takes it shared for lookups.
+    mutable std::shared_mutex member_mutex;
 
     UsernameBanList username_ban_list; ///< List of banned usernames
     IPBanList ip_ban_list;             ///< List of banned IP addresses
@@ -61,10 +67,17 @@ public:
     /// Verification backend of the room
     std::unique_ptr<VerifyUser::Backend> verify_backend;
 
+    /// Wifi packets relayed to members that support batches, sent out together by the ServerLoop.
+    /// Only used by the room thread.
+    std::unordered_map<ENetPeer*, WifiPacketBatch> pending_wifi_batches;
+
     /// Thread function that will receive and dispatch messages until the room is destroyed.
     void ServerLoop();
     void StartLoop();
 
+    /// Dispatches a single event received by the server.
+    void HandleEvent(ENetEvent& event);
+
     /**
      * Parses and answers a room join request from a client.
      * Validates the uniqueness of the username and assigns the MAC address
@@ -223,11 +236,28 @@ public:
     MacAddress GenerateMacAddress();
 
     /**
-     * Broadcasts this packet to all members except the sender.
+     * Broadcasts this packet to all members except the sender. The received packet is forwarded
+     * as it is, ENet frees it once it has been sent to every recipient.
      * @param event The ENet event containing the data
      */
     void HandleWifiPacket(const ENetEvent* event);
 
+    /// Relays every wifi packet of a batch received from a member.
+    void HandleWifiPacketBatch(const ENetEvent* event);
+
+    /**
+     * Sends a serialized IdWifiPacket message on to its recipients, adding it to the pending
+     * batches of the members that support them.
+     * @param sender The member that sent the packet, which doesn't get it back
+     * @param received The ENet packet holding the message if it came on its own, it is forwarded
+     * to the other members as it is, otherwise nullptr
+     */
+    void RelayWifiPacket(const ENetPeer* sender, const u8* message, std::size_t size,
+                         ENetPacket* received);
+
+    /// Sends the pending wifi packet batches of all members.
+    void SendWifiPacketBatches();
+
     /**
      * Extracts a chat entry from a received ENet packet and adds it to the chat queue.
      * @param event The ENet event that was received.
@@ -252,50 +282,66 @@ void Room::RoomImpl::ServerLoop() {
     while (state != State::Closed) {
         ENetEvent event;
         if (enet_host_service(server, &event, 50) > 0) {
-            switch (event.type) {
-            case ENET_EVENT_TYPE_RECEIVE:
-                switch (event.packet->data[0]) {
-                case IdJoinRequest:
-                    HandleJoinRequest(&event);
-                    break;
-                case IdSetGameInfo:
-                    HandleGameNamePacket(&event);
-                    break;
-                case IdWifiPacket:
-                    HandleWifiPacket(&event);
-                    break;
-                case IdChatMessage:
-                    HandleChatPacket(&event);
-                    break;
-                // Moderation
-                case IdModKick:
-                    HandleModKickPacket(&event);
-                    break;
-                case IdModBan:
-                    HandleModBanPacket(&event);
-                    break;
-                case IdModUnban:
-                    HandleModUnbanPacket(&event);
-                    break;
-                case IdModGetBanList:
-                    HandleModGetBanListPacket(&event);
-                    break;
-                }
-                enet_packet_destroy(event.packet);
-                break;
-            case ENET_EVENT_TYPE_DISCONNECT:
-                HandleClientDisconnection(event.peer);
-                break;
-            case ENET_EVENT_TYPE_NONE:
-            case ENET_EVENT_TYPE_CONNECT:
-                break;
-            }
+            // Handle all the events that were received together before flushing, so that the
+            // packets relayed to each member go out in as few datagrams as possible.
+            do {
+                HandleEvent(event);
+            } while (enet_host_check_events(server, &event) > 0);
+            SendWifiPacketBatches();
+            enet_host_flush(server);
         }
     }
     // Close the connection to all members:
     SendCloseMessage();
 }
 
+void Room::RoomImpl::HandleEvent(ENetEvent& event) {
+    switch (event.type) {
+    case ENET_EVENT_TYPE_RECEIVE:
+        switch (event.packet->data[0]) {
+        case IdJoinRequest:
+            HandleJoinRequest(&event);
+            break;
+        case IdSetGameInfo:
+            HandleGameNamePacket(&event);
+            break;
+        case IdWifiPacket:
+            HandleWifiPacket(&event);
+            break;
+        case IdWifiPacketBatch:
+            HandleWifiPacketBatch(&event);
+            break;
+        case IdChatMessage:
+            HandleChatPacket(&event);
+            break;
+        // Moderation
+        case IdModKick:
+            HandleModKickPacket(&event);
+            break;
+        case IdModBan:
+            HandleModBanPacket(&event);
+            break;
+        case IdModUnban:
+            HandleModUnbanPacket(&event);
+            break;
+        case IdModGetBanList:
+            HandleModGetBanListPacket(&event);
+            break;
+        }
+        // Packets that were forwarded to other peers are freed by ENet once they are sent
+        if (event.packet->referenceCount == 0) {
+            enet_packet_destroy(event.packet);
+        }
+        break;
+    case ENET_EVENT_TYPE_DISCONNECT:
+        HandleClientDisconnection(event.peer);
+        break;
+    case ENET_EVENT_TYPE_NONE:
+    case ENET_EVENT_TYPE_CONNECT:
+        break;
+    }
+}
+
 void Room::RoomImpl::StartLoop() {
     room_thread = std::make_unique<std::thread>(&Room::RoomImpl::ServerLoop, this);
 }
@@ -329,6 +375,12 @@ void Room::RoomImpl::HandleJoinRequest(const ENetEvent* event) {
     std::string token;
     packet >> token;
 
+    // Members of older versions don't send their capabilities
+    u8 client_capabilities = 0;
+    if (!packet.EndOfPacket()) {
+        packet >> client_capabilities;
+    }
+
     if (pass != password) {
         SendWrongPassword(event->peer);
         return;
@@ -366,6 +418,7 @@ void Room::RoomImpl::HandleJoinRequest(const ENetEvent* event) {
     member.console_id_hash = console_id_hash;
     member.nickname = nickname;
     member.peer = event->peer;
+    member.supports_wifi_batches = (client_capabilities & RoomCapabilityWifiBatches) != 0;
 
     std::string uid;
     {
@@ -571,28 +624,28 @@ bool Room::RoomImpl::IsValidNickname(const std::string& nickname) const {
     if (!std::regex_match(nickname, nickname_regex))
         return false;
 
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     return std::all_of(members.begin(), members.end(),
                        [&nickname](const auto& member) { return member.nickname != nickname; });
 }
 
 bool Room::RoomImpl::IsValidMacAddress(const MacAddress& address) const {
     // A MAC address is valid if it is not already taken by anybody else in the room.
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     return std::all_of(members.begin(), members.end(),
                        [&address](const auto& member) { return member.mac_address != address; });
 }
 
 bool Room::RoomImpl::IsValidConsoleId(const std::string& console_id_hash) const {
     // A Console ID is valid if it is not already taken by anybody else in the room.
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     return std::all_of(members.begin(), members.end(), [&console_id_hash](const auto& member) {
         return member.console_id_hash != console_id_hash;
     });
 }
 
 bool Room::RoomImpl::HasModPermission(const ENetPeer* client) const {
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     const auto sending_member =
         std::find_if(members.begin(), members.end(),
                      [client](const auto& member) { return member.peer == client; });
@@ -677,6 +730,7 @@ void Room::RoomImpl::SendJoinSuccess(ENetPeer* client, MacAddress mac_address) {
     Packet packet;
     packet << static_cast<u8>(IdJoinSuccess);
     packet << mac_address;
+    packet << static_cast<u8>(RoomCapabilityWifiBatches);
     ENetPacket* enet_packet =
         enet_packet_create(packet.GetData(), packet.GetDataSize(), ENET_PACKET_FLAG_RELIABLE);
     enet_peer_send(client, 0, enet_packet);
@@ -687,6 +741,7 @@ void Room::RoomImpl::SendJoinSuccessAsMod(ENetPeer* client, MacAddress mac_addre
     Packet packet;
     packet << static_cast<u8>(IdJoinSuccessAsMod);
     packet << mac_address;
+    packet << static_cast<u8>(RoomCapabilityWifiBatches);
     ENetPacket* enet_packet =
         enet_packet_create(packet.GetData(), packet.GetDataSize(), ENET_PACKET_FLAG_RELIABLE);
     enet_peer_send(client, 0, enet_packet);
@@ -751,7 +806,7 @@ void Room::RoomImpl::SendModBanListResponse(ENetPeer* client) {
 void Room::RoomImpl::SendCloseMessage() {
     Packet packet;
     packet << static_cast<u8>(IdCloseRoom);
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     if (!members.empty()) {
         ENetPacket* enet_packet =
             enet_packet_create(packet.GetData(), packet.GetDataSize(), ENET_PACKET_FLAG_RELIABLE);
@@ -772,7 +827,7 @@ void Room::RoomImpl::SendStatusMessage(StatusMessageTypes type, const std::strin
     packet << static_cast<u8>(type);
     packet << nickname;
     packet << username;
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     if (!members.empty()) {
         ENetPacket* enet_packet =
             enet_packet_create(packet.GetData(), packet.GetDataSize(), ENET_PACKET_FLAG_RELIABLE);
@@ -816,7 +871,7 @@ void Room::RoomImpl::BroadcastRoomInformation() {
 
     packet << static_cast<u32>(members.size());
     {
-        std::lock_guard lock(member_mutex);
+        std::shared_lock lock(member_mutex);
         for (const auto& member : members) {
             packet << member.nickname;
             packet << member.mac_address;
@@ -847,51 +902,97 @@ MacAddress Room::RoomImpl::GenerateMacAddress() {
 }
 
 void Room::RoomImpl::HandleWifiPacket(const ENetEvent* event) {
-    Packet in_packet;
-    in_packet.Append(event->packet->data, event->packet->dataLength);
-    in_packet.IgnoreBytes(sizeof(u8));         // Message type
-    in_packet.IgnoreBytes(sizeof(u8));         // WifiPacket Type
-    in_packet.IgnoreBytes(sizeof(u8));         // WifiPacket Channel
-    in_packet.IgnoreBytes(sizeof(MacAddress)); // WifiPacket Transmitter Address
+    RelayWifiPacket(event->peer, event->packet->data, event->packet->dataLength, event->packet);
+}
+
+void Room::RoomImpl::HandleWifiPacketBatch(const ENetEvent* event) {
+    const bool valid = WifiPacketBatch::Unpack(
+        event->packet->data, event->packet->dataLength, [&](const u8* message, std::size_t size) {
+            // Batches carry nothing but wifi packets
+            if (size > 0 && message[0] == IdWifiPacket) {
+                RelayWifiPacket(event->peer, message, size, nullptr);
+            }
+        });
+    if (!valid) {
+        LOG_ERROR(Network, "Received a malformed wifi packet batch");
+    }
+}
+
+void Room::RoomImpl::RelayWifiPacket(const ENetPeer* sender, const u8* message, std::size_t size,
+                                     ENetPacket* received) {
+    // Message type, WifiPacket type, WifiPacket channel and WifiPacket transmitter address
+    constexpr std::size_t destination_offset = 3 * sizeof(u8) + sizeof(MacAddress);
+    if (size < destination_offset + sizeof(MacAddress)) {
+        return;
+    }
     MacAddress destination_address;
-    in_packet >> destination_address;
+    std::memcpy(destination_address.data(), message + destination_offset, sizeof(MacAddress));
 
-    Packet out_packet;
-    out_packet.Append(event->packet->data, event->packet->dataLength);
-    ENetPacket* enet_packet = enet_packet_create(out_packet.GetData(), out_packet.GetDataSize(),
-                                                 ENET_PACKET_FLAG_RELIABLE);
+    // A packet that came on its own is sent on to the recipients without copying it, ENet keeps
+    // a reference to it for each of them. Otherwise one is created the first time it is needed.
+    ENetPacket* enet_packet = received;
+    if (enet_packet) {
+        enet_packet->flags |= ENET_PACKET_FLAG_RELIABLE;
+    }
+    const bool batchable = WifiPacketBatch::IsBatchable(size);
+    const auto send = [&](const Member& member) {
+        if (member.supports_wifi_batches && batchable) {
+            auto& batch = pending_wifi_batches[member.peer];
+            if (!batch.Fits(size)) {
+                const std::vector<u8> batch_message = batch.Finish();
+                enet_peer_send(member.peer, 0,
+                               enet_packet_create(batch_message.data(), batch_message.size(),
+                                                  ENET_PACKET_FLAG_RELIABLE));
+            }
+            batch.Add(message, size);
+            return;
+        }
+        if (!enet_packet) {
+            enet_packet = enet_packet_create(message, size, ENET_PACKET_FLAG_RELIABLE);
+        }
+        enet_peer_send(member.peer, 0, enet_packet);
+    };
 
+    // Everything is flushed by the ServerLoop
     if (destination_address == BroadcastMac) { // Send the data to everyone except the sender
-        std::lock_guard lock(member_mutex);
-        bool sent_packet = false;
+        std::shared_lock lock(member_mutex);
         for (const auto& member : members) {
-            if (member.peer != event->peer) {
-                sent_packet = true;
-                enet_peer_send(member.peer, 0, enet_packet);
+            if (member.peer != sender) {
+                send(member);
             }
         }
-
-        if (!sent_packet) {
-            enet_packet_destroy(enet_packet);
-        }
     } else { // Send the data only to the destination client
-        std::lock_guard lock(member_mutex);
+        std::shared_lock lock(member_mutex);
         auto member = std::find_if(members.begin(), members.end(),
                                    [destination_address](const Member& member) -> bool {
                                        return member.mac_address == destination_address;
                                    });
         if (member != members.end()) {
-            enet_peer_send(member->peer, 0, enet_packet);
+            send(*member);
         } else {
             LOG_ERROR(Network,
                       "Attempting to send to unknown MAC address: "
                       "{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}",
                       destination_address[0], destination_address[1], destination_address[2],
                       destination_address[3], destination_address[4], destination_address[5]);
-            enet_packet_destroy(enet_packet);
         }
     }
-    enet_host_flush(server);
+
+    if (enet_packet && enet_packet != received && enet_packet->referenceCount == 0) {
+        enet_packet_destroy(enet_packet);
+    }
+}
+
+void Room::RoomImpl::SendWifiPacketBatches() {
+    for (auto& [peer, batch] : pending_wifi_batches) {
+        if (batch.Empty()) {
+            continue;
+        }
+        const std::vector<u8> message = batch.Finish();
+        ENetPacket* enet_packet =
+            enet_packet_create(message.data(), message.size(), ENET_PACKET_FLAG_RELIABLE);
+        enet_peer_send(peer, 0, enet_packet);
+    }
 }
 
 void Room::RoomImpl::HandleChatPacket(const ENetEvent* event) {
@@ -905,7 +1006,7 @@ void Room::RoomImpl::HandleChatPacket(const ENetEvent* event) {
         return member.peer == event->peer;
     };
 
-    std::lock_guard lock(member_mutex);
+    std::shared_lock lock(member_mutex);
     const auto sending_member = std::find_if(members.begin(), members.end(), CompareNetworkAddress);
     if (sending_member == members.end()) {
         return; // Received a chat message from a unknown sender
@@ -978,6 +1079,8 @@ void Room::RoomImpl::HandleGameNamePacket(const ENetEvent* event) {
 }
 
 void Room::RoomImpl::HandleClientDisconnection(ENetPeer* client) {
+    pending_wifi_batches.erase(client);
+
     // Remove the client from the members list.
     std::string nickname, username, ip;
     {
@@ -1067,7 +1170,7 @@ Room::BanList Room::GetBanList() const {
 
 std::vector<Room::Member> Room::GetRoomMemberList() const {
     std::vector<Room::Member> member_list;
-    std::lock_guard lock(room_impl->member_mutex);
+    std::shared_lock lock(room_impl->member_mutex);
     for (const auto& member_impl : room_impl->members) {
         Member member;
         member.nickname = member_impl.nickname;
@@ -76,6 +76,15 @@ enum RoomMessageTypes : u8 {
     IdModPermissionDenied,
     IdModNoSuchUser,
     IdJoinSuccessAsMod,
+    /// Several compressed IdWifiPacket messages, see WifiPacketBatch
+    IdWifiPacketBatch,
+};
+
+/// Optional protocol features. Rooms and members announce the ones they support at the end of
+/// IdJoinSuccess and IdJoinRequest, where older versions ignore them.
+enum RoomCapabilities : u8 {
+    /// IdWifiPacketBatch messages are understood
+    RoomCapabilityWifiBatches = 1 << 0,
 };
 
 /// Types of system status messages
@@ -8,9 +8,11 @@
 #include <set>
 #include <thread>
 #include "common/assert.h"
+#include "common/logging/log.h"
 #include "enet/enet.h"
 #include "network/packet.h"
 #include "network/room_member.h"
+#include "network/wifi_packet_batch.h"
 
 namespace Network {
 
@@ -47,6 +49,15 @@ public:
     std::mutex send_list_mutex;  ///< Mutex that controls access to the `send_list` variable.
     std::list<Packet> send_list; ///< A list that stores all packets to send the async
 
+    /// Reused by the loop thread for every received wifi packet so that their buffers are kept
+    Packet wifi_receive_packet;
+    WifiPacket received_wifi_packet;
+
+    /// Whether the room understands IdWifiPacketBatch, only used by the loop thread
+    bool room_supports_wifi_batches = false;
+    /// Wifi packets collected by the loop thread while sending the send_list
+    WifiPacketBatch wifi_send_batch;
+
     template <typename T>
     using CallbackSet = std::set<CallbackHandle<T>>;
     std::mutex callback_mutex; ///< The mutex used for handling callbacks
@@ -107,6 +118,18 @@ public:
      */
     void HandleWifiPackets(const ENetEvent* event);
 
+    /**
+     * Extracts the WifiPackets from a received IdWifiPacketBatch ENet packet.
+     * @param event The  ENet event that was received.
+     */
+    void HandleWifiPacketBatch(const ENetEvent* event);
+
+    /// Extracts a WifiPacket from a serialized IdWifiPacket message and hands it to the callbacks.
+    void HandleWifiPacketMessage(const u8* message, std::size_t size);
+
+    /// Sends the packets of the send_list, batching the wifi packets if the room supports it.
+    void SendPendingPackets();
+
     /**
      * Extracts a chat entry from a received ENet packet and adds it to the chat queue.
      * @param event The ENet event that was received.
@@ -166,6 +189,9 @@ void RoomMember::RoomMemberImpl::MemberLoop() {
                 case IdWifiPacket:
                     HandleWifiPackets(&event);
                     break;
+                case IdWifiPacketBatch:
+                    HandleWifiPacketBatch(&event);
+                    break;
                 case IdChatMessage:
                     HandleChatPacket(&event);
                     break;
@@ -251,20 +277,45 @@ void RoomMember::RoomMemberImpl::MemberLoop() {
                 break;
             }
         }
-        {
-            std::lock_guard lock(send_list_mutex);
-            for (const auto& packet : send_list) {
-                ENetPacket* enetPacket = enet_packet_create(packet.GetData(), packet.GetDataSize(),
-                                                            ENET_PACKET_FLAG_RELIABLE);
-                enet_peer_send(server, 0, enetPacket);
-            }
-            enet_host_flush(client);
-            send_list.clear();
-        }
+        SendPendingPackets();
     }
     Disconnect();
 };
 
+void RoomMember::RoomMemberImpl::SendPendingPackets() {
+    const auto send = [this](const void* data, std::size_t size) {
+        ENetPacket* enetPacket = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
+        enet_peer_send(server, 0, enetPacket);
+    };
+    const auto send_batch = [&] {
+        if (!wifi_send_batch.Empty()) {
+            const std::vector<u8> message = wifi_send_batch.Finish();
+            send(message.data(), message.size());
+        }
+    };
+
+    std::lock_guard lock(send_list_mutex);
+    for (const auto& packet : send_list) {
+        const auto data = static_cast<const u8*>(packet.GetData());
+        const std::size_t size = packet.GetDataSize();
+        // The wifi packets queued since the last iteration go out together in one batch
+        if (room_supports_wifi_batches && size > 0 && data[0] == IdWifiPacket &&
+            WifiPacketBatch::IsBatchable(size)) {
+            if (!wifi_send_batch.Fits(size)) {
+                send_batch();
+            }
+            wifi_send_batch.Add(data, size);
+            continue;
+        }
+        // Keep the order of the other messages relative to the wifi packets
+        send_batch();
+        send(data, size);
+    }
+    send_batch();
+    enet_host_flush(client);
+    send_list.clear();
+}
+
 void RoomMember::RoomMemberImpl::StartLoop() {
     loop_thread = std::make_unique<std::thread>(&RoomMember::RoomMemberImpl::MemberLoop, this);
 }
@@ -287,6 +338,7 @@ void RoomMember::RoomMemberImpl::SendJoinRequest(const std::string& nickname,
     packet << network_version;
     packet << password;
     packet << token;
+    packet << static_cast<u8>(RoomCapabilityWifiBatches);
     Send(std::move(packet));
 }
 
@@ -343,12 +395,37 @@ void RoomMember::RoomMemberImpl::HandleJoinPacket(const ENetEvent* event) {
 
     // Parse the MAC Address from the packet
     packet >> mac_address;
+
+    // Rooms of older versions don't send their capabilities
+    u8 room_capabilities = 0;
+    if (!packet.EndOfPacket()) {
+        packet >> room_capabilities;
+    }
+    room_supports_wifi_batches = (room_capabilities & RoomCapabilityWifiBatches) != 0;
 }
 
 void RoomMember::RoomMemberImpl::HandleWifiPackets(const ENetEvent* event) {
-    WifiPacket wifi_packet{};
-    Packet packet;
-    packet.Append(event->packet->data, event->packet->dataLength);
+    HandleWifiPacketMessage(event->packet->data, event->packet->dataLength);
+}
+
+void RoomMember::RoomMemberImpl::HandleWifiPacketBatch(const ENetEvent* event) {
+    const auto handle = [this](const u8* message, std::size_t size) {
+        if (size > 0 && message[0] == IdWifiPacket) {
+            HandleWifiPacketMessage(message, size);
+        }
+    };
+    const bool valid =
+        WifiPacketBatch::Unpack(event->packet->data, event->packet->dataLength, handle);
+    if (!valid) {
+        LOG_ERROR(Network, "Received a malformed wifi packet batch");
+    }
+}
+
+void RoomMember::RoomMemberImpl::HandleWifiPacketMessage(const u8* message, std::size_t size) {
+    WifiPacket& wifi_packet = received_wifi_packet;
+    Packet& packet = wifi_receive_packet;
+    packet.Clear();
+    packet.Append(message, size);
 
     // Ignore the first byte, which is the message id.
     packet.IgnoreBytes(sizeof(u8)); // Ignore the message type
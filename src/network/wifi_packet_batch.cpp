@@ -0,0 +1,77 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include "common/swap.h"
+#include "common/zstd_compression.h"
+#include "network/room.h"
+#include "network/wifi_packet_batch.h"
+
+namespace Network {
+
+/// Low level, the batches are small and compressing them must not add to the latency
+constexpr s32 BatchCompressionLevel = 1;
+
+bool WifiPacketBatch::IsBatchable(std::size_t size) {
+    return size + sizeof(u32_le) <= MaxWifiPacketBatchSize;
+}
+
+bool WifiPacketBatch::Fits(std::size_t size) const {
+    return data.size() + sizeof(u32_le) + size <= MaxWifiPacketBatchSize;
+}
+
+void WifiPacketBatch::Add(const u8* message, std::size_t size) {
+    const u32_le length = static_cast<u32>(size);
+    const std::size_t offset = data.size();
+    data.resize(offset + sizeof(length) + size);
+    std::memcpy(data.data() + offset, &length, sizeof(length));
+    std::memcpy(data.data() + offset + sizeof(length), message, size);
+    ++count;
+}
+
+std::vector<u8> WifiPacketBatch::Finish() {
+    std::vector<u8> message;
+    if (count == 1) {
+        message.assign(data.begin() + sizeof(u32_le), data.end());
+    } else if (count > 1) {
+        const std::vector<u8> compressed =
+            Common::Compression::CompressDataZSTD(data.data(), data.size(), BatchCompressionLevel);
+        message.reserve(compressed.size() + 1);
+        message.push_back(IdWifiPacketBatch);
+        message.insert(message.end(), compressed.begin(), compressed.end());
+    }
+    data.clear();
+    count = 0;
+    return message;
+}
+
+bool WifiPacketBatch::Unpack(const u8* data, std::size_t size,
+                             const std::function<void(const u8*, std::size_t)>& callback) {
+    if (size < 1 || data[0] != IdWifiPacketBatch) {
+        return false;
+    }
+    const std::vector<u8> messages = Common::Compression::DecompressDataZSTDBounded(
+        data + 1, size - 1, MaxWifiPacketBatchSize);
+    if (messages.empty()) {
+        return false;
+    }
+
+    std::size_t offset = 0;
+    while (offset < messages.size()) {
+        u32_le length;
+        if (messages.size() - offset < sizeof(length)) {
+            return false;
+        }
+        std::memcpy(&length, messages.data() + offset, sizeof(length));
+        offset += sizeof(length);
+        if (messages.size() - offset < length) {
+            return false;
+        }
+        callback(messages.data() + offset, length);
+        offset += length;
+    }
+    return true;
+}
+
+} // namespace Network
@@ -0,0 +1,55 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Network {
+
+/// Largest amount of uncompressed wifi packet messages that are sent in one batch
+constexpr std::size_t MaxWifiPacketBatchSize = 0x4000;
+
+/**
+ * Collects IdWifiPacket messages to send them together, compressed, as one IdWifiPacketBatch
+ * message. This is only used between a room and the members that announced
+ * RoomCapabilityWifiBatches when joining.
+ */
+class WifiPacketBatch {
+public:
+    /// Returns whether the message is small enough to be batched, larger ones are sent on their own
+    static bool IsBatchable(std::size_t size);
+
+    /// Returns whether the message can be added without exceeding MaxWifiPacketBatchSize
+    bool Fits(std::size_t size) const;
+
+    /// Appends a serialized IdWifiPacket message to the batch
+    void Add(const u8* message, std::size_t size);
+
+    bool Empty() const {
+        return count == 0;
+    }
+
+    /**
+     * Builds the message to send for the collected packets and clears the batch. A single packet
+     * is returned as the IdWifiPacket message itself, since compressing it gains nothing.
+     */
+    std::vector<u8> Finish();
+
+    /**
+     * Splits a received IdWifiPacketBatch message into the IdWifiPacket messages it holds.
+     * @returns false if the batch is malformed, in which case part of it may have been handled
+     */
+    static bool Unpack(const u8* data, std::size_t size,
+                       const std::function<void(const u8*, std::size_t)>& callback);
+
+private:
+    std::vector<u8> data; ///< Length prefixed messages
+    std::size_t count = 0;
+};
+
+} // namespace Network
@@ -0,0 +1,36 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "audio_core/codec.h"
+
+namespace AudioCore::Codec {
+
+TEST_CASE("DecodeADPCM", "[audio_core]") {
+    // About 100 ms of audio, as games stream it
+    constexpr std::size_t SampleCount = 3276;
+    std::vector<u8> data(ADPCMDataSize(SampleCount));
+    std::mt19937 rng(0xC17A);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        // The frame headers hold the scale in the low nibble and the coefficient index above it
+        data[i] = static_cast<u8>(i % 8 == 0 ? byte_dist(rng) & 0x7B : byte_dist(rng));
+    }
+    const std::array<s16, 16> coeffs{
+        0x0800, 0x0000, 0x0400, 0x0400, 0x1000, -0x0800, 0x0E00, -0x0600,
+        0x0C00, -0x0400, 0x0A00, -0x0200, 0x1200, -0x0A00, 0x0900, -0x0100,
+    };
+
+    DecodedSamples output;
+    BENCHMARK("3276 samples") {
+        ADPCMState state{};
+        DecodeADPCM(data.data(), SampleCount, coeffs, state, output);
+        return output[0][0];
+    };
+}
+
+} // namespace AudioCore::Codec
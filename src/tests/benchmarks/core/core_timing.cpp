@@ -0,0 +1,34 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch2/catch.hpp>
+#include "core/core_timing.h"
+
+static u64 callbacks_ran = 0;
+
+static void Callback(u64 userdata, s64 cycles_late) {
+    callbacks_ran += userdata;
+}
+
+TEST_CASE("CoreTiming", "[core]") {
+    Core::Timing timing(1, 100);
+    Core::TimingEventType* event = timing.RegisterEvent("benchmark", Callback);
+    Core::Timing::Timer& timer = *timing.GetTimer(0);
+    timer.Advance();
+    timer.SetNextSlice();
+
+    constexpr s64 EventCount = 256;
+    BENCHMARK("Schedule and run 256 events") {
+        for (s64 i = 0; i < EventCount; ++i) {
+            timing.ScheduleEvent((i * 7919) % 10000 + 1, event, 1, 0);
+        }
+        const u64 target = callbacks_ran + EventCount;
+        while (callbacks_ran < target) {
+            timer.AddTicks(timer.GetDowncount());
+            timer.Advance();
+            timer.SetNextSlice();
+        }
+        return callbacks_ran;
+    };
+}
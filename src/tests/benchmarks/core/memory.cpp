@@ -0,0 +1,73 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/archives.h"
+#include "common/memory_ref.h"
+#include "common/zstd_compression.h"
+#include "core/core_timing.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+
+/// Same level as the save states use
+constexpr s32 SaveStateCompressionLevel = 3;
+
+TEST_CASE("Memory::ReadBlock", "[core][memory]") {
+    Core::Timing timing(1, 100);
+    Memory::MemorySystem memory;
+    Kernel::KernelSystem kernel(memory, timing, [] {}, 0, 1, 0);
+    auto process = kernel.CreateProcess(kernel.CreateCodeSet("", 0));
+
+    constexpr VAddr address = 0x10000000;
+    constexpr std::size_t size = 0x100000;
+    MemoryRef buffer{std::make_shared<BufferMem>(size)};
+    const auto mapped =
+        process->vm_manager.MapBackingMemory(address, buffer, size, Kernel::MemoryState::Private);
+    REQUIRE(mapped.Succeeded());
+
+    std::vector<u8> dest(size);
+    BENCHMARK("16 bytes") {
+        memory.ReadBlock(*process, address + 0x1234, dest.data(), 16);
+        return dest[0];
+    };
+    BENCHMARK("64 KiB, crossing pages") {
+        memory.ReadBlock(*process, address + 0x800, dest.data(), 0x10000);
+        return dest[0];
+    };
+    BENCHMARK("1 MiB") {
+        memory.ReadBlock(*process, address, dest.data(), size);
+        return dest[0];
+    };
+}
+
+TEST_CASE("Save state memory", "[core][savestate]") {
+    Memory::MemorySystem memory;
+    // Mostly empty like the FCRAM of most games, with some varied data
+    u8* fcram = memory.GetFCRAMPointer(0);
+    for (std::size_t i = 0; i < Memory::FCRAM_SIZE / 4; ++i) {
+        fcram[i] = static_cast<u8>((i * 2654435761u) >> 24);
+    }
+
+    std::string state;
+    BENCHMARK("Serialize") {
+        std::ostringstream stream;
+        {
+            oarchive oa{stream};
+            oa& memory;
+        }
+        state = stream.str();
+        return state.size();
+    };
+
+    BENCHMARK("Compress") {
+        return Common::Compression::CompressDataZSTDSeekable(
+                   reinterpret_cast<const u8*>(state.data()), state.size(),
+                   SaveStateCompressionLevel)
+            .size();
+    };
+}
@@ -0,0 +1,9 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+// Benchmarks of the emulator hot paths, built with Catch's benchmarking support. They are not run
+// by ctest. Run `benchmarks -r xml` to get the results in a machine-readable form, or pass a tag
+// such as `[video_core]` to only run some of them.
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
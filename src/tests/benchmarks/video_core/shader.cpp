@@ -0,0 +1,88 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <catch2/catch.hpp>
+#include <nihstro/inline_assembly.h>
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/shader/shader_jit_x64.h"
+#include "video_core/shader/shader_jit_x64_compiler.h"
+#endif
+
+namespace Pica::Shader {
+
+using DestRegister = nihstro::DestRegister;
+using OpCode = nihstro::OpCode;
+using SourceRegister = nihstro::SourceRegister;
+
+constexpr std::size_t VertexCount = 1024;
+
+/// A vertex transform as games commonly use it: position by a 4x4 matrix, color by a factor
+static std::unique_ptr<ShaderSetup> MakeTransformShader() {
+    const auto position = SourceRegister::MakeInput(0);
+    const auto color = SourceRegister::MakeInput(1);
+    const auto shbin = nihstro::InlineAsm::CompileToRawBinary({
+        // clang-format off
+        {OpCode::Id::DP4, DestRegister::MakeOutput(0), position, SourceRegister::MakeFloat(0)},
+        {OpCode::Id::DP4, DestRegister::MakeOutput(1), position, SourceRegister::MakeFloat(1)},
+        {OpCode::Id::DP4, DestRegister::MakeOutput(2), position, SourceRegister::MakeFloat(2)},
+        {OpCode::Id::DP4, DestRegister::MakeOutput(3), position, SourceRegister::MakeFloat(3)},
+        {OpCode::Id::MUL, DestRegister::MakeOutput(4), color, SourceRegister::MakeFloat(4)},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    auto setup = std::make_unique<ShaderSetup>();
+    std::transform(shbin.program.begin(), shbin.program.end(), setup->program_code.begin(),
+                   [](const auto& x) { return x.hex; });
+    std::transform(shbin.swizzle_table.begin(), shbin.swizzle_table.end(),
+                   setup->swizzle_data.begin(), [](const auto& x) { return x.hex; });
+    for (std::size_t i = 0; i < 5; ++i) {
+        for (std::size_t component = 0; component < 4; ++component) {
+            setup->uniforms.f[i][component] = float24::FromFloat32(i == component ? 1.0f : 0.5f);
+        }
+    }
+    return setup;
+}
+
+static float RunVertices(const ShaderEngine& engine, const ShaderSetup& setup, UnitState& unit) {
+    float sum = 0.0f;
+    for (std::size_t vertex = 0; vertex < VertexCount; ++vertex) {
+        unit.registers.input[0].x = float24::FromFloat32(static_cast<float>(vertex));
+        unit.registers.input[1].x = float24::FromFloat32(1.0f);
+        engine.Run(setup, unit);
+        sum += unit.registers.output[0].x.ToFloat32();
+    }
+    return sum;
+}
+
+TEST_CASE("Shader engines", "[video_core][shader]") {
+    auto setup = MakeTransformShader();
+    UnitState unit;
+
+    InterpreterEngine interpreter;
+    interpreter.SetupBatch(*setup, 0);
+    BENCHMARK("Interpreter, 1024 vertices") {
+        return RunVertices(interpreter, *setup, unit);
+    };
+
+#ifdef ARCHITECTURE_x86_64
+    JitX64Engine jit;
+    jit.SetupBatch(*setup, 0);
+    BENCHMARK("JIT, 1024 vertices") {
+        return RunVertices(jit, *setup, unit);
+    };
+
+    BENCHMARK("JIT compile") {
+        JitShader shader;
+        shader.Compile(&setup->program_code, &setup->swizzle_data);
+    };
+#endif
+}
+
+} // namespace Pica::Shader
@@ -0,0 +1,87 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "video_core/texture/texture_decode.h"
+#include "video_core/utils.h"
+
+namespace Pica::Texture {
+
+using TextureFormat = TexturingRegs::TextureFormat;
+
+constexpr unsigned int TextureSize = 256;
+
+static std::vector<u8> RandomBytes(std::size_t size) {
+    std::mt19937 rng(0xC17A);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+    std::vector<u8> bytes(size);
+    for (auto& byte : bytes) {
+        byte = static_cast<u8>(byte_dist(rng));
+    }
+    return bytes;
+}
+
+TEST_CASE("Texture decode", "[video_core][texture]") {
+    constexpr std::array<std::pair<TextureFormat, const char*>, 14> formats{{
+        {TextureFormat::RGBA8, "RGBA8"},
+        {TextureFormat::RGB8, "RGB8"},
+        {TextureFormat::RGB5A1, "RGB5A1"},
+        {TextureFormat::RGB565, "RGB565"},
+        {TextureFormat::RGBA4, "RGBA4"},
+        {TextureFormat::IA8, "IA8"},
+        {TextureFormat::RG8, "RG8"},
+        {TextureFormat::I8, "I8"},
+        {TextureFormat::A8, "A8"},
+        {TextureFormat::IA4, "IA4"},
+        {TextureFormat::I4, "I4"},
+        {TextureFormat::A4, "A4"},
+        {TextureFormat::ETC1, "ETC1"},
+        {TextureFormat::ETC1A4, "ETC1A4"},
+    }};
+
+    const std::vector<u8> source = RandomBytes(TextureSize * TextureSize * 4);
+    std::vector<Common::Vec4<u8>> decoded(TextureSize * TextureSize);
+
+    for (const auto& [format, name] : formats) {
+        TextureInfo info{};
+        info.width = TextureSize;
+        info.height = TextureSize;
+        info.format = format;
+        info.SetDefaultStride();
+        const std::size_t tile_size = CalculateTileSize(format);
+        constexpr std::size_t tile_count = TextureSize * TextureSize / 64;
+
+        BENCHMARK(std::string(name) + " 256x256") {
+            for (std::size_t tile = 0; tile < tile_count; ++tile) {
+                DecodeTile(source.data() + tile * tile_size, info, &decoded[tile * 64]);
+            }
+            return decoded[0].r();
+        };
+    }
+}
+
+TEST_CASE("Morton swizzle", "[video_core][texture]") {
+    constexpr u32 bytes_per_pixel = 4;
+    const std::vector<u8> linear = RandomBytes(TextureSize * TextureSize * bytes_per_pixel);
+    std::vector<u8> tiled(linear.size());
+
+    BENCHMARK("RGBA8 256x256 linear to tiled") {
+        for (u32 y = 0; y < TextureSize; ++y) {
+            const u32 tile_row = (y / 8) * 8 * TextureSize * bytes_per_pixel;
+            for (u32 x = 0; x < TextureSize; ++x) {
+                const u32 offset = tile_row + VideoCore::GetMortonOffset(x, y, bytes_per_pixel);
+                const u8* pixel = &linear[(y * TextureSize + x) * bytes_per_pixel];
+                std::copy(pixel, pixel + bytes_per_pixel, &tiled[offset]);
+            }
+        }
+        return tiled[0];
+    };
+}
+
+} // namespace Pica::Texture
@@ -0,0 +1,55 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <atomic>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/async_io.h"
+#include "common/file_util.h"
+
+namespace FileUtil {
+
+TEST_CASE("AsyncIO: reads what was written at the same offsets", "[common]") {
+    const std::string path = "citra_async_io_test.bin";
+    std::vector<u8> data(0x10000);
+    std::iota(data.begin(), data.end(), u8{0});
+
+    for (std::size_t num_workers : {0, 2}) {
+        AsyncIO engine(num_workers);
+        {
+            const auto file = std::make_shared<AsyncFile>(path, AsyncFile::Mode::Write);
+            REQUIRE(file->IsOpen());
+            // Written backward in chunks, the writes complete in any order
+            std::vector<std::future<std::size_t>> writes;
+            for (std::size_t offset = data.size(); offset > 0;) {
+                offset -= 0x1000;
+                writes.push_back(engine.Write(file, data.data() + offset, 0x1000, offset));
+            }
+            for (auto& write : writes) {
+                CHECK(write.get() == 0x1000);
+            }
+        }
+
+        const auto file = std::make_shared<AsyncFile>(path, AsyncFile::Mode::Read);
+        REQUIRE(file->GetSize() == data.size());
+
+        std::array<u8, 4> head{};
+        CHECK(engine.Read(file, head.data(), head.size(), 0x1234).get() == head.size());
+        CHECK(head == std::array<u8, 4>{0x34, 0x35, 0x36, 0x37});
+
+        // Past the end of the file, the reads stop short
+        std::vector<u8> tail(0x100);
+        std::atomic<std::size_t> tail_read{0};
+        engine.Read(file, tail.data(), tail.size(), data.size() - 0x10,
+                    [&](std::size_t bytes_read) { tail_read = bytes_read; });
+        engine.WaitForAll();
+        CHECK(tail_read == 0x10);
+    }
+    Delete(path);
+}
+
+} // namespace FileUtil
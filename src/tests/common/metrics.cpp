@@ -0,0 +1,62 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <catch2/catch.hpp>
+#include "common/metrics.h"
+
+namespace Common::Metrics {
+
+TEST_CASE("Metrics: counters and gauges are serialized with their help and type", "[common]") {
+    Counter counter{"test_counter_total", "A counter"};
+    Gauge gauge{"test_gauge", "A gauge"};
+    counter.Add();
+    counter.Add(2);
+    gauge.Set(-4);
+
+    const std::string out = Serialize();
+    REQUIRE(out.find("# HELP test_counter_total A counter\n"
+                     "# TYPE test_counter_total counter\n"
+                     "test_counter_total 3\n") != std::string::npos);
+    REQUIRE(out.find("# TYPE test_gauge gauge\ntest_gauge -4\n") != std::string::npos);
+}
+
+TEST_CASE("Metrics: counter vectors only serialize the labels that were counted", "[common]") {
+    CounterVector calls{"test_calls_total", "Calls", "call", {"first", "second", "third"}};
+    CounterVector time{"test_call_seconds_total", "Time", "call", {"first", "second"}, 1e-3};
+    calls.Add(0);
+    calls.Add(2, 5);
+    time.Add(1, 1500);
+
+    const std::string out = Serialize();
+    REQUIRE(out.find("# TYPE test_calls_total counter\n"
+                     "test_calls_total{call=\"first\"} 1\n"
+                     "test_calls_total{call=\"third\"} 5\n") != std::string::npos);
+    REQUIRE(out.find("test_calls_total{call=\"second\"}") == std::string::npos);
+    REQUIRE(out.find("test_call_seconds_total{call=\"second\"} 1.5\n") != std::string::npos);
+}
+
+TEST_CASE("Metrics: histogram buckets are cumulative", "[common]") {
+    Histogram histogram{"test_duration_seconds", "A histogram"};
+    histogram.Observe(std::chrono::milliseconds(1));
+    histogram.Observe(std::chrono::milliseconds(20));
+    histogram.Observe(std::chrono::seconds(1));
+
+    const std::string out = Serialize();
+    REQUIRE(out.find("test_duration_seconds_bucket{le=\"0.002\"} 1\n") != std::string::npos);
+    REQUIRE(out.find("test_duration_seconds_bucket{le=\"0.025\"} 2\n") != std::string::npos);
+    REQUIRE(out.find("test_duration_seconds_bucket{le=\"0.1\"} 2\n") != std::string::npos);
+    REQUIRE(out.find("test_duration_seconds_bucket{le=\"+Inf\"} 3\n") != std::string::npos);
+    REQUIRE(out.find("test_duration_seconds_sum 1.021\n") != std::string::npos);
+    REQUIRE(out.find("test_duration_seconds_count 3\n") != std::string::npos);
+}
+
+TEST_CASE("Metrics: destroyed metrics are no longer serialized", "[common]") {
+    {
+        Counter counter{"test_scoped_total", "A counter"};
+    }
+    REQUIRE(Serialize().find("test_scoped_total") == std::string::npos);
+}
+
+} // namespace Common::Metrics
@@ -0,0 +1,56 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/task_scheduler.h"
+
+namespace Common {
+
+TEST_CASE("TaskScheduler: ParallelFor covers the whole range once", "[common]") {
+    for (std::size_t num_workers : {0, 1, 3}) {
+        TaskScheduler scheduler(num_workers);
+        std::vector<int> visited(1000, 0);
+        scheduler.ParallelFor(visited.size(), 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                ++visited[i];
+            }
+        });
+        for (int count : visited) {
+            REQUIRE(count == 1);
+        }
+    }
+}
+
+TEST_CASE("TaskScheduler: Wait only waits for its own group", "[common]") {
+    TaskScheduler scheduler(2);
+    std::atomic<int> first{0};
+    std::atomic<int> second{0};
+    TaskScheduler::TaskGroup first_group;
+    TaskScheduler::TaskGroup second_group;
+    for (int i = 0; i < 100; ++i) {
+        scheduler.Spawn(first_group, [&first] { ++first; });
+        scheduler.Spawn(second_group, [&second] { ++second; }, TaskScheduler::Priority::Low);
+    }
+    scheduler.Wait(first_group);
+    REQUIRE(first == 100);
+    scheduler.Wait(second_group);
+    REQUIRE(second == 100);
+}
+
+TEST_CASE("TaskScheduler: Tasks can wait for the tasks they spawn", "[common]") {
+    TaskScheduler scheduler(3);
+    std::atomic<int> counter{0};
+    scheduler.ParallelFor(8, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            scheduler.ParallelFor(64, 1, [&](std::size_t inner_begin, std::size_t inner_end) {
+                counter += static_cast<int>(inner_end - inner_begin);
+            });
+        }
+    });
+    REQUIRE(counter == 8 * 64);
+}
+
+} // namespace Common
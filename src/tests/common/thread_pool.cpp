@@ -0,0 +1,37 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/thread_pool.h"
+
+namespace Common {
+
+TEST_CASE("ThreadPool: ParallelFor covers the whole range once", "[common]") {
+    for (std::size_t num_workers : {0, 1, 3}) {
+        ThreadPool pool(num_workers);
+        std::vector<int> visited(1000, 0);
+        pool.ParallelFor(visited.size(), 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                ++visited[i];
+            }
+        });
+        for (int count : visited) {
+            REQUIRE(count == 1);
+        }
+    }
+}
+
+TEST_CASE("ThreadPool: WaitForAll waits for pushed tasks", "[common]") {
+    ThreadPool pool(2);
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 100; ++i) {
+        pool.Push([&counter] { ++counter; });
+    }
+    pool.WaitForAll();
+    REQUIRE(counter == 100);
+}
+
+} // namespace Common
@@ -0,0 +1,57 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch2/catch.hpp>
+#include "common/thread_queue_list.h"
+
+namespace Common {
+
+TEST_CASE("ThreadQueueList: pops the highest priority first", "[common]") {
+    ThreadQueueList<int, 64> queue;
+    REQUIRE(queue.get_first() == 0);
+
+    queue.push_back(40, 1);
+    queue.push_back(10, 2);
+    queue.push_back(63, 3);
+    queue.push_back(10, 4);
+    queue.push_front(40, 5);
+
+    REQUIRE(queue.get_first() == 2);
+    REQUIRE(queue.pop_first() == 2);
+    REQUIRE(queue.pop_first() == 4);
+    REQUIRE(queue.empty(10));
+    REQUIRE(queue.pop_first() == 5);
+    REQUIRE(queue.pop_first() == 1);
+    REQUIRE(queue.pop_first() == 3);
+    REQUIRE(queue.pop_first() == 0);
+}
+
+TEST_CASE("ThreadQueueList: pop_first_better only takes higher priorities", "[common]") {
+    ThreadQueueList<int, 64> queue;
+    queue.push_back(20, 1);
+    queue.push_back(30, 2);
+
+    REQUIRE(queue.pop_first_better(20) == 0);
+    REQUIRE(queue.pop_first_better(21) == 1);
+    REQUIRE(queue.pop_first_better(30) == 0);
+    REQUIRE(queue.pop_first_better(31) == 2);
+}
+
+TEST_CASE("ThreadQueueList: move and remove keep the levels up to date", "[common]") {
+    ThreadQueueList<int, 64> queue;
+    queue.push_back(30, 1);
+    queue.push_back(30, 2);
+
+    queue.move(1, 30, 5);
+    REQUIRE(queue.get_first() == 1);
+
+    queue.remove(5, 1);
+    REQUIRE(queue.empty(5));
+    REQUIRE(queue.get_first() == 2);
+
+    queue.remove(30, 2);
+    REQUIRE(queue.get_first() == 0);
+}
+
+} // namespace Common
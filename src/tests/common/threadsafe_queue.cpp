@@ -0,0 +1,68 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/threadsafe_queue.h"
+
+namespace Common {
+
+TEST_CASE("BoundedMPSCQueue: holds up to its capacity, in order", "[common]") {
+    BoundedMPSCQueue<int, 4> queue;
+    REQUIRE(queue.Empty());
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPush(i));
+    }
+    REQUIRE_FALSE(queue.TryPush(4));
+
+    int value = -1;
+    REQUIRE(queue.Pop(value));
+    REQUIRE(value == 0);
+    // The freed slot is reused past the end of the ring
+    REQUIRE(queue.TryPush(4));
+
+    std::vector<int> popped;
+    REQUIRE(queue.PopAll([&](int v) { popped.push_back(v); }) == 4);
+    REQUIRE(popped == std::vector<int>{1, 2, 3, 4});
+    REQUIRE(queue.Empty());
+    REQUIRE(queue.PopAll([](int) {}) == 0);
+}
+
+TEST_CASE("BoundedMPSCQueue: takes every element of several writers", "[common]") {
+    constexpr int NumWriters = 4;
+    constexpr int ElementsPerWriter = 10000;
+    BoundedMPSCQueue<int, 64> queue;
+
+    std::vector<std::thread> writers;
+    for (int writer = 0; writer < NumWriters; ++writer) {
+        writers.emplace_back([&queue, writer] {
+            for (int i = 0; i < ElementsPerWriter; ++i) {
+                queue.Push(writer * ElementsPerWriter + i);
+            }
+        });
+    }
+
+    // The elements of each writer arrive in the order it pushed them
+    std::array<int, NumWriters> next_index{};
+    int total = 0;
+    bool in_order = true;
+    while (total < NumWriters * ElementsPerWriter) {
+        total += static_cast<int>(queue.PopAllWait(
+            [&](int v) {
+                const int writer = v / ElementsPerWriter;
+                in_order &= v % ElementsPerWriter == next_index[writer]++;
+            },
+            std::chrono::milliseconds(10)));
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    REQUIRE(in_order);
+    REQUIRE(queue.Empty());
+}
+
+} // namespace Common
@@ -0,0 +1,60 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <thread>
+#include <catch2/catch.hpp>
+#include "common/file_util.h"
+#include "common/tracing.h"
+
+namespace Common::Tracing {
+
+static const Event TestEvent{"Test", "Scope"};
+
+static std::string ReadTrace(const std::string& path) {
+    std::string trace;
+    FileUtil::ReadFileToString(true, path, trace);
+    FileUtil::Delete(path);
+    return trace;
+}
+
+TEST_CASE("Tracing", "[common]") {
+    const std::string path = "citra_tracing_test.json";
+
+    SECTION("scopes are only recorded while tracing") {
+        { Scope scope{TestEvent}; }
+        REQUIRE(Start(path));
+        REQUIRE(IsEnabled());
+        {
+            Scope scope{TestEvent};
+            Scope nested{"Test", "Nested \"quoted\""};
+        }
+        Stop();
+        REQUIRE(!IsEnabled());
+        { Scope scope{TestEvent}; }
+
+        const std::string trace = ReadTrace(path);
+        REQUIRE(trace.rfind(R"({"displayTimeUnit":"ms","traceEvents":[)", 0) == 0);
+        REQUIRE(trace.find("\n]}\n") == trace.size() - 4);
+        REQUIRE(trace.find(R"("name":"Scope","cat":"Test","ph":"X")") != std::string::npos);
+        REQUIRE(trace.find(R"("name":"Nested \"quoted\"")") != std::string::npos);
+        REQUIRE(trace.find(R"("name":"Scope")") == trace.rfind(R"("name":"Scope")"));
+    }
+
+    SECTION("events of other threads are written with their name") {
+        REQUIRE(Start(path));
+        std::thread thread{[] {
+            SetThreadName("TracingTest");
+            Scope scope{TestEvent};
+        }};
+        thread.join();
+        Stop();
+
+        const std::string trace = ReadTrace(path);
+        REQUIRE(trace.find(R"("args":{"name":"TracingTest"})") != std::string::npos);
+        REQUIRE(trace.find(R"("name":"Scope")") != std::string::npos);
+    }
+}
+
+} // namespace Common::Tracing
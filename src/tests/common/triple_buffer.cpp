@@ -0,0 +1,55 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <thread>
+#include <catch2/catch.hpp>
+#include "common/triple_buffer.h"
+
+namespace Common {
+
+TEST_CASE("TripleBuffer: Read returns the value published last", "[common]") {
+    TripleBuffer<int> buffer(-1);
+    REQUIRE(buffer.Read() == -1);
+
+    buffer.Back() = 1;
+    buffer.Publish();
+    buffer.Back() = 2;
+    buffer.Publish();
+    REQUIRE(buffer.Read() == 2);
+    // Nothing new was published
+    REQUIRE(buffer.Read() == 2);
+
+    // The writer doesn't get the buffer the reader holds
+    buffer.Back() = 3;
+    REQUIRE(buffer.Read() == 2);
+    buffer.Publish();
+    REQUIRE(buffer.Read() == 3);
+}
+
+TEST_CASE("TripleBuffer: values published by another thread arrive whole and in order",
+          "[common]") {
+    struct Value {
+        int first;
+        int second;
+    };
+    constexpr int NumValues = 100000;
+    TripleBuffer<Value> buffer({0, 0});
+
+    std::thread writer([&buffer] {
+        for (int i = 1; i <= NumValues; ++i) {
+            buffer.Back() = {i, -i};
+            buffer.Publish();
+        }
+    });
+    int last = 0;
+    while (last != NumValues) {
+        const Value& value = buffer.Read();
+        REQUIRE(value.second == -value.first);
+        REQUIRE(value.first >= last);
+        last = value.first;
+    }
+    writer.join();
+}
+
+} // namespace Common
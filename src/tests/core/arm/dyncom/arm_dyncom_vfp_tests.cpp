@@ -47,4 +47,37 @@ TEST_CASE("ARM_DynCom (vfp): vadd", "[arm_dyncom]") {
     }
 }
 
+TEST_CASE("ARM_DynCom (vfp): context switches", "[arm_dyncom]") {
+    TestEnvironment test_env(false);
+    test_env.SetMemory32(0, 0xEE321A03); // vadd.f32 s2, s4, s6
+    test_env.SetMemory32(4, 0xEAFFFFFE); // b +#0
+
+    ARM_DynCom dyncom(nullptr, test_env.GetMemory(), USER32MODE, 0, nullptr);
+    auto first = dyncom.NewContext();
+    auto second = dyncom.NewContext();
+    first->SetFpuRegister(2, 0x12345678);
+    second->SetFpuRegister(4, 0x3F800000); // 1.0f
+    second->SetFpuRegister(6, 0x3F800000);
+
+    dyncom.LoadContext(first);
+    REQUIRE(dyncom.GetVFPReg(2) == 0x12345678);
+    dyncom.SaveContext(first);
+
+    dyncom.LoadContext(second);
+    dyncom.SetPC(0);
+    dyncom.Step();
+    dyncom.SaveContext(second);
+    REQUIRE(second->GetFpuRegister(2) == 0x40000000); // 2.0f
+    REQUIRE(first->GetFpuRegister(2) == 0x12345678);
+
+    // The registers of the thread which used the VFP last are still current when switching away
+    dyncom.LoadContext(first);
+    dyncom.SaveContext(first);
+    second->SetFpuRegister(2, 0);
+    REQUIRE(second->GetFpuRegister(2) == 0);
+
+    dyncom.LoadContext(first);
+    REQUIRE(dyncom.GetVFPReg(2) == 0x12345678);
+}
+
 } // namespace ArmTests
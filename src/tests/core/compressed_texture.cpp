@@ -0,0 +1,77 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "core/compressed_texture.h"
+#include "core/custom_tex_cache.h"
+
+namespace Core {
+
+static void Write32(std::vector<u8>& file, std::size_t offset, u32 value) {
+    std::memcpy(file.data() + offset, &value, sizeof(value));
+}
+
+static std::vector<u8> MakeDDS(u32 width, u32 height, const char* four_cc, std::size_t data_size) {
+    std::vector<u8> file(128 + data_size);
+    std::memcpy(file.data(), "DDS ", 4);
+    Write32(file, 4, 124);
+    Write32(file, 12, height);
+    Write32(file, 16, width);
+    std::memcpy(file.data() + 84, four_cc, 4);
+    for (std::size_t i = 0; i < data_size; ++i) {
+        file[128 + i] = static_cast<u8>(i);
+    }
+    return file;
+}
+
+static std::vector<u8> MakeKTX(u32 width, u32 height, u32 internal_format, u32 image_size) {
+    static constexpr u8 identifier[12]{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                       0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    std::vector<u8> file(64 + 4 + image_size);
+    std::memcpy(file.data(), identifier, sizeof(identifier));
+    Write32(file, 12, 0x04030201);
+    Write32(file, 28, internal_format);
+    Write32(file, 36, width);
+    Write32(file, 40, height);
+    Write32(file, 52, 1);
+    Write32(file, 56, 1);
+    Write32(file, 64, image_size);
+    return file;
+}
+
+TEST_CASE("CompressedTexture: block sizes", "[core]") {
+    REQUIRE(GetCustomTexSize(CustomTexFormat::RGBA8, 16, 8) == 16 * 8 * 4);
+    REQUIRE(GetCustomTexSize(CustomTexFormat::BC1, 16, 8) == 4 * 2 * 8);
+    REQUIRE(GetCustomTexSize(CustomTexFormat::BC7, 16, 8) == 4 * 2 * 16);
+    REQUIRE(GetCustomTexSize(CustomTexFormat::ASTC6x6, 16, 8) == 3 * 2 * 16);
+}
+
+TEST_CASE("CompressedTexture: DDS", "[core]") {
+    CustomTexInfo info{};
+    REQUIRE(LoadCompressedTexture(MakeDDS(16, 8, "DXT5", 128), info));
+    REQUIRE(info.width == 16);
+    REQUIRE(info.height == 8);
+    REQUIRE(info.format == CustomTexFormat::BC3);
+    REQUIRE(info.tex.size() == 128);
+    REQUIRE(info.tex[1] == 1);
+
+    // Truncated data and unsupported formats are rejected
+    REQUIRE(!LoadCompressedTexture(MakeDDS(16, 8, "DXT1", 63), info));
+    REQUIRE(!LoadCompressedTexture(MakeDDS(16, 8, "ATI2", 128), info));
+}
+
+TEST_CASE("CompressedTexture: KTX", "[core]") {
+    CustomTexInfo info{};
+    REQUIRE(LoadCompressedTexture(MakeKTX(32, 32, 0x93B0, 1024), info));
+    REQUIRE(info.format == CustomTexFormat::ASTC4x4);
+    REQUIRE(info.width == 32);
+    REQUIRE(info.tex.size() == 1024);
+
+    REQUIRE(!LoadCompressedTexture(MakeKTX(32, 32, 0x93B0, 512), info));
+    REQUIRE(!LoadCompressedTexture(MakeKTX(32, 32, 0x8058, 4096), info));
+}
+
+} // namespace Core
@@ -140,6 +140,35 @@ TEST_CASE("CoreTiming[PredictableLateness]", "[core]") {
     AdvanceAndCheck(timing, 1, MAX_SLICE_LENGTH, 50, -50);
 }
 
+TEST_CASE("CoreTiming[Unschedule]", "[core]") {
+    Core::Timing timing(1, 100);
+
+    Core::TimingEventType* cb_a = timing.RegisterEvent("callbackA", CallbackTemplate<0>);
+    Core::TimingEventType* cb_b = timing.RegisterEvent("callbackB", CallbackTemplate<1>);
+    Core::TimingEventType* cb_c = timing.RegisterEvent("callbackC", CallbackTemplate<2>);
+
+    // Enter slice 0
+    timing.GetTimer(0)->Advance();
+    timing.GetTimer(0)->SetNextSlice();
+
+    timing.ScheduleEvent(100, cb_a, CB_IDS[0], 0);
+    timing.ScheduleEvent(200, cb_b, CB_IDS[1], 0);
+    timing.ScheduleEvent(300, cb_c, CB_IDS[2], 0);
+    timing.ScheduleEvent(400, cb_c, CB_IDS[3], 0);
+    timing.UnscheduleEvent(cb_a, CB_IDS[0]);
+    timing.UnscheduleEvent(cb_c, CB_IDS[3]);
+    timing.GetTimer(0)->SetNextSlice();
+    REQUIRE(200 == timing.GetTimer(0)->GetDowncount());
+
+    // An event scheduled again after being unscheduled still runs
+    timing.ScheduleEvent(150, cb_a, CB_IDS[0], 0);
+    REQUIRE(150 == timing.GetTimer(0)->GetDowncount());
+
+    AdvanceAndCheck(timing, 0, 50);
+    AdvanceAndCheck(timing, 1, 100);
+    AdvanceAndCheck(timing, 2, MAX_SLICE_LENGTH);
+}
+
 namespace ChainSchedulingTest {
 static int reschedules = 0;
 
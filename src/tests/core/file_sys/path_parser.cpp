@@ -35,4 +35,19 @@ TEST_CASE("PathParser - Host file system", "[core][file_sys]") {
     FileUtil::DeleteDirRecursively(test_dir);
 }
 
+TEST_CASE("PathParser - Host status cache", "[core][file_sys]") {
+    std::string test_dir = "./test_cache";
+    FileUtil::CreateDir(test_dir);
+    HostStatusCache cache;
+
+    REQUIRE(PathParser(Path("/a")).GetHostStatus(test_dir, cache) == PathParser::NotFound);
+    FileUtil::CreateEmptyFile(test_dir + "/a");
+    // The cached status holds until the host file system is reported changed
+    REQUIRE(PathParser(Path("/a")).GetHostStatus(test_dir, cache) == PathParser::NotFound);
+    HostStatusCache::InvalidateAll();
+    REQUIRE(PathParser(Path("/a")).GetHostStatus(test_dir, cache) == PathParser::FileFound);
+
+    FileUtil::DeleteDirRecursively(test_dir);
+}
+
 } // namespace FileSys
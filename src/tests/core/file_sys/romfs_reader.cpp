@@ -0,0 +1,100 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/file_util.h"
+#include "core/file_sys/romfs_reader.h"
+
+namespace FileSys {
+
+constexpr char TEST_FILE_NAME[] = "romfs_reader_test.bin";
+constexpr char TEST_TRACE_NAME[] = "romfs_reader_trace.bin";
+constexpr std::size_t TEST_FILE_OFFSET = 0x1234;
+constexpr std::size_t TEST_DATA_SIZE = 0x90321;
+
+static std::vector<u8> WriteTestFile() {
+    std::vector<u8> contents(TEST_FILE_OFFSET + TEST_DATA_SIZE);
+    for (std::size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<u8>(i * 7 + (i >> 12));
+    }
+    FileUtil::IOFile file(TEST_FILE_NAME, "wb");
+    REQUIRE(file.WriteBytes(contents.data(), contents.size()) == contents.size());
+    return contents;
+}
+
+TEST_CASE("DirectRomFSReader", "[core][file_sys]") {
+    const std::vector<u8> contents = WriteTestFile();
+    const std::vector<u8> data(contents.begin() + TEST_FILE_OFFSET, contents.end());
+
+    SECTION("plain reads match the file") {
+        DirectRomFSReader reader(FileUtil::IOFile(TEST_FILE_NAME, "rb"), TEST_FILE_OFFSET,
+                                 TEST_DATA_SIZE);
+        REQUIRE(reader.GetSize() == TEST_DATA_SIZE);
+
+        std::vector<u8> buffer(0x100);
+        REQUIRE(reader.ReadFile(0x4567, buffer.size(), buffer.data()) == buffer.size());
+        REQUIRE(std::equal(buffer.begin(), buffer.end(), data.begin() + 0x4567));
+
+        // Reads past the end are truncated
+        REQUIRE(reader.ReadFile(TEST_DATA_SIZE - 0x10, buffer.size(), buffer.data()) == 0x10);
+        REQUIRE(std::equal(buffer.begin(), buffer.begin() + 0x10, data.end() - 0x10));
+        REQUIRE(reader.ReadFile(TEST_DATA_SIZE, buffer.size(), buffer.data()) == 0);
+    }
+
+    SECTION("cached reads of an encrypted RomFS match uncached ones") {
+        const std::array<u8, 16> key{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+        const std::array<u8, 16> ctr{16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+        DirectRomFSReader reader(FileUtil::IOFile(TEST_FILE_NAME, "rb"), TEST_FILE_OFFSET,
+                                 TEST_DATA_SIZE, key, ctr, 0x1000);
+
+        // Large enough to bypass the cache and be decrypted in place
+        std::vector<u8> whole(TEST_DATA_SIZE);
+        REQUIRE(reader.ReadFile(0, whole.size(), whole.data()) == whole.size());
+
+        // Small reads, some of them crossing blocks, go through the cache
+        std::vector<u8> buffer(0x3000);
+        for (std::size_t offset : {0x0, 0x3ff0, 0x3ff0, 0x7f00, 0x10, 0x8e000}) {
+            const std::size_t read = reader.ReadFile(offset, buffer.size(), buffer.data());
+            REQUIRE(read == std::min(buffer.size(), TEST_DATA_SIZE - offset));
+            REQUIRE(std::equal(buffer.begin(), buffer.begin() + read, whole.begin() + offset));
+        }
+
+        // The last block of the RomFS is only partly filled
+        REQUIRE(reader.ReadFile(TEST_DATA_SIZE - 0x20, buffer.size(), buffer.data()) == 0x20);
+        REQUIRE(std::equal(buffer.begin(), buffer.begin() + 0x20, whole.end() - 0x20));
+    }
+
+    SECTION("reads following a recorded trace match the file") {
+        const std::array<u8, 16> key{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+        const std::array<u8, 16> ctr{16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1};
+        std::vector<u8> whole(TEST_DATA_SIZE);
+        {
+            DirectRomFSReader reader(FileUtil::IOFile(TEST_FILE_NAME, "rb"), TEST_FILE_OFFSET,
+                                     TEST_DATA_SIZE, key, ctr, 0x1000);
+            REQUIRE(reader.ReadFile(0, whole.size(), whole.data()) == whole.size());
+        }
+
+        const std::size_t offsets[] = {0x8e000, 0x100, 0x40000, 0x4100, 0x8000, 0x60000};
+        std::vector<u8> buffer(0x800);
+        for (int run = 0; run < 2; ++run) {
+            // The first run records the trace which the second one prefetches from
+            DirectRomFSReader reader(FileUtil::IOFile(TEST_FILE_NAME, "rb"), TEST_FILE_OFFSET,
+                                     TEST_DATA_SIZE, key, ctr, 0x1000);
+            reader.EnableAccessTrace(TEST_TRACE_NAME);
+            for (std::size_t offset : offsets) {
+                REQUIRE(reader.ReadFile(offset, buffer.size(), buffer.data()) == buffer.size());
+                REQUIRE(std::equal(buffer.begin(), buffer.end(), whole.begin() + offset));
+            }
+            REQUIRE(FileUtil::Exists(TEST_TRACE_NAME) == (run == 1));
+        }
+        REQUIRE(FileUtil::Exists(TEST_TRACE_NAME));
+        FileUtil::Delete(TEST_TRACE_NAME);
+    }
+
+    FileUtil::Delete(TEST_FILE_NAME);
+}
+
+} // namespace FileSys
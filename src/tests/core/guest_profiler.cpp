@@ -0,0 +1,42 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch2/catch.hpp>
+#include "core/guest_profiler.h"
+
+namespace Core {
+
+TEST_CASE("GuestProfiler names the samples after the modules and their symbols", "[core]") {
+    GuestProfiler profiler;
+    profiler.AddModule(1, "Game", 0x00100000, 0x10000, {});
+    profiler.AddModule(1, "Sound", 0x00200000, 0x1000, {{0x00200101, "Mix"}, {0x00200000, "Init"}});
+
+    profiler.Sample(1, 0x00100010);
+    profiler.Sample(1, 0x00200010);
+    profiler.Sample(1, 0x00200200);
+    profiler.Sample(1, 0x00200200);
+    profiler.Sample(2, 0x00100010);
+
+    CHECK(profiler.GetSampleCount() == 5);
+    CHECK(profiler.GetFoldedStacks() == "Game;[unknown];0x00100010 1\n"
+                                        "Sound;Init;0x00200010 1\n"
+                                        "Sound;Mix;0x00200200 2\n"
+                                        "process 2;[unknown];0x00100010 1\n");
+}
+
+TEST_CASE("GuestProfiler keeps the names of the samples taken before a module is removed",
+          "[core]") {
+    GuestProfiler profiler;
+    profiler.AddModule(1, "Game", 0x00100000, 0x10000, {});
+    profiler.AddModule(1, "Static", 0x00100000, 0x10000, {{0x00100000, "main"}});
+    profiler.Sample(1, 0x00100010);
+
+    profiler.RemoveModule(1, 0x00100000);
+    profiler.Sample(1, 0x00100010);
+
+    CHECK(profiler.GetFoldedStacks() == "Game;[unknown];0x00100010 1\n"
+                                        "Static;main;0x00100010 1\n");
+}
+
+} // namespace Core
@@ -0,0 +1,72 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <catch2/catch.hpp>
+#include "core/core_timing.h"
+#include "core/hle/guest_routines.h"
+#include "core/hle/kernel/kernel.h"
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+
+namespace HLE {
+
+TEST_CASE("Guest routines are identified by their BKPT", "[core][hle]") {
+    CHECK(DecodeRoutineBreakpoint(0xE12C1B70) == GuestRoutine::Memmove);
+    CHECK(DecodeRoutineBreakpoint(0xE12C1B73) == GuestRoutine::AeabiMemclr);
+    // The BKPT the GDB stub patches in, a BKPT past the routines and a conditional one
+    CHECK(!DecodeRoutineBreakpoint(0xE1200070));
+    CHECK(!DecodeRoutineBreakpoint(0xE12C1B74));
+    CHECK(!DecodeRoutineBreakpoint(0x012C1B70));
+}
+
+TEST_CASE("Guest routines run natively", "[core][hle]") {
+    Core::Timing timing(1, 100);
+    Memory::MemorySystem memory;
+    Kernel::KernelSystem kernel(memory, timing, [] {}, 0, 1, 0);
+    auto process = kernel.CreateProcess(kernel.CreateCodeSet("", 0));
+    kernel.MapSharedPages(process->vm_manager);
+
+    const VAddr page = Memory::SHARED_PAGE_VADDR;
+    const std::array<u8, 8> data{1, 2, 3, 4, 5, 6, 7, 8};
+    memory.WriteBlock(*process, page, data.data(), data.size());
+
+    std::array<u32, 16> regs{};
+    std::array<u8, 8> result{};
+
+    SECTION("memmove copies overlapping ranges in place") {
+        regs[0] = page + 2;
+        regs[1] = page;
+        regs[2] = 6;
+        const GuestRoutineCall call(GuestRoutine::Memmove, regs);
+        REQUIRE(call.RunInPlace(memory, *process->vm_manager.page_table));
+        memory.ReadBlock(*process, page, result.data(), result.size());
+        CHECK(result == std::array<u8, 8>{1, 2, 1, 2, 3, 4, 5, 6});
+    }
+
+    SECTION("__aeabi_memset takes the size before the value") {
+        regs[0] = page + 1;
+        regs[1] = 3;
+        regs[2] = 0x1AB;
+        GuestRoutineCall(GuestRoutine::AeabiMemset, regs).Run(memory, *process);
+        memory.ReadBlock(*process, page, result.data(), result.size());
+        CHECK(result == std::array<u8, 8>{1, 0xAB, 0xAB, 0xAB, 5, 6, 7, 8});
+    }
+
+    SECTION("unmapped memory is left to the block accesses") {
+        regs[0] = Memory::HEAP_VADDR;
+        regs[1] = page;
+        regs[2] = 4;
+        CHECK(!GuestRoutineCall(GuestRoutine::Memmove, regs)
+                   .RunInPlace(memory, *process->vm_manager.page_table));
+    }
+
+    SECTION("the routine returns to Thumb code") {
+        regs[14] = 0x00100001;
+        CHECK(GuestRoutineCall::Return(regs));
+        CHECK(regs[15] == 0x00100000);
+    }
+}
+
+} // namespace HLE
@@ -0,0 +1,37 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch2/catch.hpp>
+#include "core/hle/kernel/ipc_debugger/profiler.h"
+
+namespace IPCDebugger {
+
+TEST_CASE("IPC Profiler aggregates the calls per command", "[core][kernel]") {
+    using namespace std::chrono_literals;
+    Profiler profiler;
+    profiler.RecordCall("fs:USER", 0x08030102, "OpenFile", 1000ns);
+    profiler.RecordCall("hid:USER", 0x000A0000, "GetIPCHandles", 3ns);
+    profiler.RecordCall("fs:USER", 0x08030102, "OpenFile", 3000ns);
+
+    const auto profiles = profiler.GetProfiles();
+    REQUIRE(profiles.size() == 2);
+    CHECK(profiles[0].service_name == "fs:USER");
+    CHECK(profiles[0].function_name == "OpenFile");
+    CHECK(profiles[0].calls == 2);
+    CHECK(profiles[0].total_ns == 4000);
+    CHECK(profiles[0].max_ns == 3000);
+    // 1000ns falls in [512, 1024) and 3000ns in [2048, 4096)
+    CHECK(profiles[0].histogram[9] == 1);
+    CHECK(profiles[0].histogram[11] == 1);
+    CHECK(profiles[1].header_code == 0x000A0000);
+    CHECK(profiles[1].histogram[1] == 1);
+
+    CHECK(profiler.GetProfile(1)->service_name == "hid:USER");
+    CHECK(!profiler.GetProfile(2));
+
+    profiler.Reset();
+    CHECK(profiler.GetProfiles().empty());
+}
+
+} // namespace IPCDebugger
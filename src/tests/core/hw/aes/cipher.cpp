@@ -0,0 +1,59 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <catch2/catch.hpp>
+#include "core/hw/aes/cipher.h"
+
+namespace HW::AES {
+
+// Test vectors from NIST SP 800-38A, F.2.2 and F.5.1
+constexpr AESKey TEST_KEY{0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+constexpr std::array<u8, 32> TEST_PLAIN{
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51};
+
+TEST_CASE("CTRCipher", "[core][hw][aes]") {
+    constexpr AESKey ctr{0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                         0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+    constexpr std::array<u8, 32> expected{
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68,
+        0x64, 0x99, 0x0d, 0xb6, 0xce, 0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70,
+        0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff};
+    const CTRCipher cipher(TEST_KEY, ctr);
+
+    std::array<u8, 32> output{};
+    cipher.Process(0, TEST_PLAIN.data(), output.data(), output.size());
+    REQUIRE(output == expected);
+
+    // Parts of the stream starting in the middle of a block give the same result
+    output = TEST_PLAIN;
+    cipher.Process(0, output.data(), output.data(), 7);
+    cipher.Process(7, output.data() + 7, output.data() + 7, 20);
+    cipher.Process(27, output.data() + 27, output.data() + 27, 5);
+    REQUIRE(output == expected);
+
+    // Decryption is the same operation
+    cipher.Process(0, output.data(), output.data(), output.size());
+    REQUIRE(output == TEST_PLAIN);
+}
+
+TEST_CASE("CBCDecryptor", "[core][hw][aes]") {
+    constexpr AESKey iv{0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+    constexpr std::array<u8, 32> encrypted{
+        0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e,
+        0x9b, 0x12, 0xe9, 0x19, 0x7d, 0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72,
+        0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2};
+
+    // The chaining state carries over between the two blocks
+    CBCDecryptor decryptor(TEST_KEY, iv);
+    std::array<u8, 32> output{};
+    decryptor.Process(encrypted.data(), output.data(), 16);
+    decryptor.Process(encrypted.data() + 16, output.data() + 16, 16);
+    REQUIRE(output == TEST_PLAIN);
+}
+
+} // namespace HW::AES
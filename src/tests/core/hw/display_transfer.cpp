@@ -0,0 +1,154 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/color.h"
+#include "common/vector_math.h"
+#include "core/hw/display_transfer.h"
+#include "video_core/utils.h"
+
+namespace GPU {
+
+using Config = Regs::DisplayTransferConfig;
+
+static Common::Vec4<u8> ReferenceDecode(Regs::PixelFormat format, const u8* pixel) {
+    switch (format) {
+    case Regs::PixelFormat::RGBA8:
+        return Color::DecodeRGBA8(pixel);
+    case Regs::PixelFormat::RGB8:
+        return Color::DecodeRGB8(pixel);
+    case Regs::PixelFormat::RGB565:
+        return Color::DecodeRGB565(pixel);
+    case Regs::PixelFormat::RGB5A1:
+        return Color::DecodeRGB5A1(pixel);
+    default:
+        return Color::DecodeRGBA4(pixel);
+    }
+}
+
+static void ReferenceEncode(Regs::PixelFormat format, const Common::Vec4<u8>& color, u8* pixel) {
+    switch (format) {
+    case Regs::PixelFormat::RGBA8:
+        return Color::EncodeRGBA8(color, pixel);
+    case Regs::PixelFormat::RGB8:
+        return Color::EncodeRGB8(color, pixel);
+    case Regs::PixelFormat::RGB565:
+        return Color::EncodeRGB565(color, pixel);
+    case Regs::PixelFormat::RGB5A1:
+        return Color::EncodeRGB5A1(color, pixel);
+    default:
+        return Color::EncodeRGBA4(color, pixel);
+    }
+}
+
+/// The display transfer as it was done pixel by pixel
+static void ReferenceDisplayTransfer(const Config& config, const u8* src, u8* dst) {
+    const u32 horizontal_scale = config.scaling != Config::NoScale ? 1 : 0;
+    const u32 vertical_scale = config.scaling == Config::ScaleXY ? 1 : 0;
+    const u32 output_width = config.output_width >> horizontal_scale;
+    const u32 output_height = config.output_height >> vertical_scale;
+    const u32 src_bpp = Regs::BytesPerPixel(config.input_format);
+    const u32 dst_bpp = Regs::BytesPerPixel(config.output_format);
+
+    for (u32 y = 0; y < output_height; ++y) {
+        for (u32 x = 0; x < output_width; ++x) {
+            const u32 input_x = x << horizontal_scale;
+            const u32 input_y = y << vertical_scale;
+            const u32 output_y = config.flip_vertically ? output_height - y - 1 : y;
+
+            u32 src_offset = (input_x + input_y * config.input_width) * src_bpp;
+            u32 dst_offset = (x + output_y * output_width) * dst_bpp;
+            if (!config.input_linear) {
+                src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bpp) +
+                             (input_y & ~7) * config.input_width * src_bpp;
+            }
+            if (config.input_linear != config.dont_swizzle) {
+                dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bpp) +
+                             (output_y & ~7) * output_width * dst_bpp;
+            }
+
+            const u8* src_pixel = src + src_offset;
+            Common::Vec4<u8> color = ReferenceDecode(config.input_format, src_pixel);
+            if (config.scaling == Config::ScaleX) {
+                const auto pixel = ReferenceDecode(config.input_format, src_pixel + src_bpp);
+                color = ((color + pixel) / 2).Cast<u8>();
+            } else if (config.scaling == Config::ScaleXY) {
+                const auto pixel1 = ReferenceDecode(config.input_format, src_pixel + src_bpp);
+                const auto pixel2 = ReferenceDecode(config.input_format, src_pixel + 2 * src_bpp);
+                const auto pixel3 = ReferenceDecode(config.input_format, src_pixel + 3 * src_bpp);
+                color = (((color + pixel1) + (pixel2 + pixel3)) / 4).Cast<u8>();
+            }
+            ReferenceEncode(config.output_format, color, dst + dst_offset);
+        }
+    }
+}
+
+static void CheckTransfer(u32 width, u32 height, Regs::PixelFormat input_format,
+                          Regs::PixelFormat output_format, Config::ScalingMode scaling,
+                          bool input_linear, bool dont_swizzle, bool flip) {
+    Config config{};
+    config.input_width.Assign(width);
+    config.input_height.Assign(height);
+    config.output_width.Assign(width);
+    config.output_height.Assign(height);
+    config.input_format.Assign(input_format);
+    config.output_format.Assign(output_format);
+    config.scaling.Assign(scaling);
+    config.input_linear.Assign(input_linear);
+    config.dont_swizzle.Assign(dont_swizzle);
+    config.flip_vertically.Assign(flip);
+
+    std::mt19937 random(width * 7 + static_cast<u32>(input_format));
+    std::vector<u8> src(width * height * Regs::BytesPerPixel(input_format));
+    for (u8& byte : src) {
+        byte = static_cast<u8>(random());
+    }
+    std::vector<u8> expected(width * height * Regs::BytesPerPixel(output_format));
+    std::vector<u8> output(expected.size());
+
+    ReferenceDisplayTransfer(config, src.data(), expected.data());
+    SoftwareDisplayTransfer(config, src.data(), output.data());
+    INFO("formats " << static_cast<u32>(input_format) << " -> " << static_cast<u32>(output_format)
+                    << ", scaling " << static_cast<u32>(scaling) << ", linear " << input_linear
+                    << ", don't swizzle " << dont_swizzle << ", flip " << flip);
+    REQUIRE(output == expected);
+}
+
+constexpr Regs::PixelFormat FORMATS[] = {
+    Regs::PixelFormat::RGBA8,  Regs::PixelFormat::RGB8,  Regs::PixelFormat::RGB565,
+    Regs::PixelFormat::RGB5A1, Regs::PixelFormat::RGBA4,
+};
+
+TEST_CASE("SoftwareDisplayTransfer matches the per-pixel conversion", "[core][hw][gpu]") {
+    for (const auto input_format : FORMATS) {
+        for (const auto output_format : FORMATS) {
+            for (const bool flip : {false, true}) {
+                for (const bool dont_swizzle : {false, true}) {
+                    CheckTransfer(64, 32, input_format, output_format, Config::NoScale, true,
+                                  dont_swizzle, flip);
+                    CheckTransfer(64, 32, input_format, output_format, Config::NoScale, false,
+                                  dont_swizzle, flip);
+                    CheckTransfer(64, 32, input_format, output_format, Config::ScaleX, false,
+                                  dont_swizzle, flip);
+                    CheckTransfer(64, 32, input_format, output_format, Config::ScaleXY, false,
+                                  dont_swizzle, flip);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("SoftwareDisplayTransfer splits large transfers", "[core][hw][gpu]") {
+    // Screen sized transfers are done by several threads
+    CheckTransfer(240, 400, Regs::PixelFormat::RGBA8, Regs::PixelFormat::RGB8, Config::NoScale,
+                  false, false, true);
+    CheckTransfer(480, 800, Regs::PixelFormat::RGBA8, Regs::PixelFormat::RGB8, Config::ScaleXY,
+                  false, false, true);
+    CheckTransfer(240, 400, Regs::PixelFormat::RGB565, Regs::PixelFormat::RGB565,
+                  Config::NoScale, true, true, false);
+}
+
+} // namespace GPU
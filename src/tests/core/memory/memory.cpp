@@ -2,6 +2,9 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #include <catch2/catch.hpp>
 #include "core/core.h"
 #include "core/core_timing.h"
@@ -54,3 +57,159 @@ TEST_CASE("Memory::IsValidVirtualAddress", "[core][memory]") {
         CHECK(Memory::IsValidVirtualAddress(*process, Memory::CONFIG_MEMORY_VADDR) == false);
     }
 }
+
+TEST_CASE("Memory::ReadBlock and WriteBlock", "[core][memory]") {
+    Core::Timing timing(1, 100);
+    Memory::MemorySystem memory;
+    Kernel::KernelSystem kernel(memory, timing, [] {}, 0, 1, 0);
+    auto process = kernel.CreateProcess(kernel.CreateCodeSet("", 0));
+    kernel.HandleSpecialMapping(process->vm_manager,
+                                {Memory::VRAM_VADDR, Memory::VRAM_SIZE, false, false});
+
+    // Spans several pages and starts and ends in the middle of one
+    std::vector<u8> data(3 * Memory::PAGE_SIZE + 0x123);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<u8>(i * 7);
+    }
+    const VAddr src_addr = Memory::VRAM_VADDR + 0x456;
+    const VAddr dest_addr = Memory::VRAM_VADDR + 0x10 * Memory::PAGE_SIZE + 0x789;
+
+    SECTION("a block written is read back") {
+        memory.WriteBlock(*process, src_addr, data.data(), data.size());
+        std::vector<u8> read(data.size());
+        memory.ReadBlock(*process, src_addr, read.data(), read.size());
+        CHECK(read == data);
+    }
+
+    SECTION("a copied block is read back") {
+        memory.WriteBlock(*process, src_addr, data.data(), data.size());
+        memory.CopyBlock(*process, dest_addr, src_addr, data.size());
+        std::vector<u8> read(data.size());
+        memory.ReadBlock(*process, dest_addr, read.data(), read.size());
+        CHECK(read == data);
+    }
+
+    SECTION("a zeroed block is read back") {
+        memory.WriteBlock(*process, src_addr, data.data(), data.size());
+        memory.ZeroBlock(*process, src_addr + 1, data.size() - 2);
+        std::vector<u8> read(data.size());
+        memory.ReadBlock(*process, src_addr, read.data(), read.size());
+        CHECK(read.front() == data.front());
+        CHECK(read.back() == data.back());
+        CHECK(std::all_of(read.begin() + 1, read.end() - 1, [](u8 value) { return value == 0; }));
+    }
+
+    SECTION("the written pages are reported dirty") {
+        memory.SetCurrentPageTable(process->vm_manager.page_table);
+        memory.SetDirtyTracking(true);
+        memory.WriteBlock(*process, src_addr, data.data(), data.size());
+        memory.Write32(dest_addr, 0x12345678);
+        const auto regions = memory.GetDirtyRegions();
+        REQUIRE(regions.size() == 2);
+        CHECK(regions[0].first == Memory::VRAM_PADDR);
+        CHECK(regions[0].second == 4 * Memory::PAGE_SIZE);
+        CHECK(regions[1].first == Memory::VRAM_PADDR + 0x10 * Memory::PAGE_SIZE);
+        CHECK(regions[1].second == Memory::PAGE_SIZE);
+
+        memory.ClearDirtyRegions();
+        CHECK(memory.GetDirtyRegions().empty());
+
+        // The JIT must not write the tracked pages through the page table
+        const auto& pointers = process->vm_manager.page_table->GetPointerArray();
+        const u32 page = src_addr >> Memory::PAGE_BITS;
+        CHECK(pointers[page] == nullptr);
+        memory.SetDirtyTracking(false);
+        CHECK(pointers[page] != nullptr);
+    }
+
+    SECTION("a string is read across pages") {
+        memory.SetCurrentPageTable(process->vm_manager.page_table);
+        const char string[] = "crossing";
+        const VAddr string_addr = Memory::VRAM_VADDR + Memory::PAGE_SIZE - 3;
+        memory.WriteBlock(*process, string_addr, string, sizeof(string));
+
+        CHECK(memory.ReadCString(string_addr, 0x100) == "crossing");
+        CHECK(memory.ReadCString(string_addr, 5) == "cross");
+        CHECK(memory.ReadCString(string_addr + 8, 0x100).empty());
+    }
+
+    SECTION("a contiguous block is accessed in place") {
+        u8* pointer = memory.GetContiguousPointer(*process, src_addr, data.size());
+        REQUIRE(pointer != nullptr);
+        std::memcpy(pointer, data.data(), data.size());
+        std::vector<u8> read(data.size());
+        memory.ReadBlock(*process, src_addr, read.data(), read.size());
+        CHECK(read == data);
+
+        CHECK(memory.GetContiguousPointer(*process, Memory::VRAM_VADDR_END - 4, 8) == nullptr);
+
+        memory.SetDirtyTracking(true);
+        CHECK(memory.GetContiguousPointer(*process, src_addr, data.size()) == nullptr);
+    }
+
+    SECTION("a watched page is hidden and still accessed") {
+        memory.SetCurrentPageTable(process->vm_manager.page_table);
+        const auto& pointers = process->vm_manager.page_table->GetPointerArray();
+        const u32 page = src_addr >> Memory::PAGE_BITS;
+        u8* const page_pointer = pointers[page];
+        REQUIRE(page_pointer != nullptr);
+
+        memory.WatchRegion(src_addr, 4, true);
+        memory.WatchRegion(src_addr + 8, 4, true);
+        CHECK(pointers[page] == nullptr);
+        CHECK(pointers[page + 1] == page_pointer + Memory::PAGE_SIZE);
+
+        memory.Write32(src_addr, 0x12345678);
+        CHECK(memory.Read32(src_addr) == 0x12345678);
+        memory.WriteBlock(*process, src_addr, data.data(), data.size());
+        std::vector<u8> read(data.size());
+        memory.ReadBlock(*process, src_addr, read.data(), read.size());
+        CHECK(read == data);
+
+        memory.WatchRegion(src_addr, 4, false);
+        CHECK(pointers[page] == nullptr);
+        memory.WatchRegion(src_addr + 8, 4, false);
+        CHECK(pointers[page] == page_pointer);
+    }
+}
+
+TEST_CASE("Memory::PageTable", "[core][memory]") {
+    const auto backing = std::make_shared<BufferMem>(2 * Memory::PAGE_SIZE);
+    auto page_table = std::make_unique<Memory::PageTable>();
+    page_table->pointers[0x100] = MemoryRef(backing);
+    page_table->pointers[0x80000] = MemoryRef(backing, Memory::PAGE_SIZE);
+    page_table->pointers[0x101] = nullptr;
+    page_table->pointers[0x40000] = nullptr;
+
+    const auto& pointers = page_table->GetPointerArray();
+    CHECK(pointers[0x100] == backing->GetPtr());
+    CHECK(pointers[0x80000] == backing->GetPtr() + Memory::PAGE_SIZE);
+    CHECK(pointers[0x101] == nullptr);
+    CHECK(pointers[0x40000] == nullptr);
+
+    SECTION("taking over a pointer array keeps the entries") {
+        auto donor = std::make_unique<Memory::PageTable>();
+        donor->pointers[0x200] = MemoryRef(backing);
+        const auto* donor_array = &donor->GetPointerArray();
+
+        page_table->TakePointerArray(*donor);
+        CHECK(&page_table->GetPointerArray() == donor_array);
+        CHECK(page_table->GetPointerArray()[0x100] == backing->GetPtr());
+        CHECK(page_table->GetPointerArray()[0x80000] == backing->GetPtr() + Memory::PAGE_SIZE);
+        CHECK(page_table->GetPointerArray()[0x200] == nullptr);
+    }
+
+    SECTION("a hidden entry keeps its reference") {
+        page_table->pointers.SetHidden(0x100, true);
+        CHECK(pointers[0x100] == nullptr);
+        CHECK(page_table->pointers.GetUnhidden(0x100) == backing->GetPtr());
+        page_table->pointers.SetHidden(0x100, false);
+        CHECK(pointers[0x100] == backing->GetPtr());
+    }
+
+    SECTION("clearing resets the mapped entries") {
+        page_table->Clear();
+        CHECK(pointers[0x100] == nullptr);
+        CHECK(pointers[0x80000] == nullptr);
+    }
+}
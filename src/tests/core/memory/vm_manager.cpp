@@ -44,6 +44,50 @@ TEST_CASE("Memory Basics", "[kernel][memory]") {
         CHECK(vma->second.backing_memory.GetPtr() == nullptr);
     }
 
+    SECTION("mapping memory at the first free range it fits in") {
+        // Because of the PageTable, Kernel::VMManager is too big to be created on the stack.
+        auto manager = std::make_unique<Kernel::VMManager>(memory);
+        for (u32 page : {0, 2}) {
+            auto result =
+                manager->MapBackingMemory(Memory::HEAP_VADDR + page * Memory::PAGE_SIZE, block,
+                                          block.GetSize(), Kernel::MemoryState::Private);
+            REQUIRE(result.Code() == RESULT_SUCCESS);
+        }
+
+        // The page left between the two blocks is too small
+        auto large_mem = std::make_shared<BufferMem>(2 * Memory::PAGE_SIZE);
+        MemoryRef large_block{large_mem};
+        auto result =
+            manager->MapBackingMemoryToBase(Memory::HEAP_VADDR, Memory::HEAP_SIZE, large_block,
+                                            large_block.GetSize(), Kernel::MemoryState::Private);
+        REQUIRE(result.Code() == RESULT_SUCCESS);
+        CHECK(result.Unwrap() == Memory::HEAP_VADDR + 3 * Memory::PAGE_SIZE);
+
+        for (u32 page : {0, 2}) {
+            ResultCode code = manager->UnmapRange(Memory::HEAP_VADDR + page * Memory::PAGE_SIZE,
+                                                  block.GetSize());
+            REQUIRE(code == RESULT_SUCCESS);
+        }
+        ResultCode code = manager->UnmapRange(result.Unwrap(), large_block.GetSize());
+        REQUIRE(code == RESULT_SUCCESS);
+
+        auto vma = manager->FindVMA(Memory::HEAP_VADDR);
+        CHECK(vma->second.type == Kernel::VMAType::Free);
+        CHECK(vma->second.base == 0);
+        CHECK(vma->second.size == Kernel::VMManager::MAX_ADDRESS);
+        for (u32 page = 0; page < 5; ++page) {
+            CHECK(manager->page_table->attributes[(Memory::HEAP_VADDR >> Memory::PAGE_BITS) +
+                                                  page] == Memory::PageType::Unmapped);
+        }
+
+        // The free range is found again once it has been merged back
+        result = manager->MapBackingMemoryToBase(Memory::HEAP_VADDR, Memory::HEAP_SIZE,
+                                                 large_block, large_block.GetSize(),
+                                                 Kernel::MemoryState::Private);
+        REQUIRE(result.Code() == RESULT_SUCCESS);
+        CHECK(result.Unwrap() == Memory::HEAP_VADDR);
+    }
+
     SECTION("changing memory permissions") {
         // Because of the PageTable, Kernel::VMManager is too big to be created on the stack.
         auto manager = std::make_unique<Kernel::VMManager>(memory);
@@ -0,0 +1,90 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <string>
+#include <catch2/catch.hpp>
+#include "common/file_util.h"
+#include "core/perf_stats.h"
+
+namespace Core {
+
+using namespace std::chrono_literals;
+
+static float Time(const PerfStats::FrameBreakdown& frame, PerfSubsystem subsystem) {
+    return frame.subsystem_time[static_cast<std::size_t>(subsystem)];
+}
+
+TEST_CASE("PerfStats::FrameBreakdown", "[core]") {
+    // The histories are too large for the stack
+    auto perf_stats_ptr = std::make_unique<PerfStats>(0);
+    PerfStats& perf_stats = *perf_stats_ptr;
+
+    SECTION("nested scopes only count their own time") {
+        perf_stats.BeginSystemFrame();
+        {
+            ScopedPerfSubsystem cpu_time{PerfSubsystem::CPU};
+            std::this_thread::sleep_for(2ms);
+            {
+                ScopedPerfSubsystem hle_time{PerfSubsystem::HLE};
+                std::this_thread::sleep_for(10ms);
+            }
+        }
+        perf_stats.EndSystemFrame();
+
+        const auto breakdowns = perf_stats.GetFrameBreakdowns();
+        REQUIRE(breakdowns.size() == 1);
+        const auto& frame = breakdowns[0];
+        REQUIRE(Time(frame, PerfSubsystem::HLE) >= 10.0f);
+        REQUIRE(Time(frame, PerfSubsystem::CPU) >= 2.0f);
+        REQUIRE(Time(frame, PerfSubsystem::CPU) < Time(frame, PerfSubsystem::HLE));
+        REQUIRE(Time(frame, PerfSubsystem::Audio) == 0.0f);
+        REQUIRE(Time(frame, PerfSubsystem::CPU) + Time(frame, PerfSubsystem::HLE) <=
+                frame.frametime);
+    }
+
+    SECTION("an open scope is split at the frame boundaries") {
+        ScopedPerfSubsystem present_time{PerfSubsystem::Present};
+        std::this_thread::sleep_for(5ms);
+        perf_stats.BeginSystemFrame();
+        std::this_thread::sleep_for(2ms);
+        perf_stats.EndSystemFrame();
+
+        const auto breakdowns = perf_stats.GetFrameBreakdowns();
+        REQUIRE(breakdowns.size() == 1);
+        REQUIRE(Time(breakdowns[0], PerfSubsystem::Present) >= 2.0f);
+        REQUIRE(Time(breakdowns[0], PerfSubsystem::Present) <= breakdowns[0].frametime);
+    }
+
+    SECTION("the history keeps the most recent frames") {
+        for (std::size_t i = 0; i < PerfStats::FrameBreakdownHistorySize + 3; ++i) {
+            perf_stats.BeginSystemFrame();
+            perf_stats.EndSystemFrame();
+        }
+        REQUIRE(perf_stats.GetFrameBreakdowns().size() == PerfStats::FrameBreakdownHistorySize);
+    }
+
+    SECTION("the benchmark report skips the first frames") {
+        for (int i = 0; i < 10; ++i) {
+            perf_stats.BeginSystemFrame();
+            ScopedPerfSubsystem cpu_time{PerfSubsystem::CPU};
+            std::this_thread::sleep_for(1ms);
+            perf_stats.EndSystemFrame();
+        }
+
+        const std::string path = "citra_benchmark_report.json";
+        REQUIRE(perf_stats.WriteBenchmarkReport(path, 1.5));
+        std::string report;
+        FileUtil::ReadFileToString(true, path, report);
+        FileUtil::Delete(path);
+        REQUIRE(report.rfind(R"({"wall_time":1.500,"emulated_frames":10,"measured_frames":5,)",
+                             0) == 0);
+        REQUIRE(report.find(R"("p99":)") != std::string::npos);
+        REQUIRE(report.find(R"("subsystem_ms":{"cpu":)") != std::string::npos);
+    }
+}
+
+} // namespace Core
@@ -0,0 +1,46 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <catch2/catch.hpp>
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "core/ram_storage.h"
+
+namespace Core {
+
+TEST_CASE("RamStorage runs on a copy of the template", "[core]") {
+    const std::string template_dir = "citra_ram_storage_test" DIR_SEP;
+    const std::string sdmc_file = template_dir + SDMC_DIR DIR_SEP "save" DIR_SEP "data.bin";
+    FileUtil::CreateFullPath(sdmc_file);
+    REQUIRE(FileUtil::WriteStringToFile(false, sdmc_file, "seed") == 4);
+    const std::string user_sdmc_dir = FileUtil::GetUserPath(FileUtil::UserPath::SDMCDir);
+
+    for (const bool persist : {false, true}) {
+        std::string root;
+        {
+            RamStorage storage(template_dir, persist);
+            root = storage.GetRoot();
+            const std::string& sdmc_dir = FileUtil::GetUserPath(FileUtil::UserPath::SDMCDir);
+            REQUIRE(sdmc_dir == root + SDMC_DIR DIR_SEP);
+
+            std::string data;
+            FileUtil::ReadFileToString(false, sdmc_dir + "save" DIR_SEP "data.bin", data);
+            CHECK(data == "seed");
+            FileUtil::WriteStringToFile(false, sdmc_dir + "save" DIR_SEP "data.bin", "game");
+            // The template only changes if the storage is persisted
+            FileUtil::ReadFileToString(false, sdmc_file, data);
+            CHECK(data == "seed");
+        }
+        CHECK(FileUtil::GetUserPath(FileUtil::UserPath::SDMCDir) == user_sdmc_dir);
+        CHECK(!FileUtil::Exists(root));
+
+        std::string data;
+        FileUtil::ReadFileToString(false, sdmc_file, data);
+        CHECK(data == (persist ? "game" : "seed"));
+    }
+    FileUtil::DeleteDirRecursively(template_dir);
+}
+
+} // namespace Core
@@ -0,0 +1,77 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "common/file_util.h"
+#include "core/tracer/player.h"
+#include "core/tracer/recorder.h"
+
+namespace CiTrace {
+
+TEST_CASE("CiTrace::Player loads the traces of the Recorder", "[core]") {
+    const std::string path = "citra_player_test.ctf";
+
+    Recorder::InitialState state;
+    state.gpu_registers.assign(4, 0x12345678);
+    state.pica_registers.assign(8, 0);
+    Recorder recorder{state};
+    const std::vector<u8> memory(0x100, 0xAB);
+    recorder.MemoryAccessed(memory.data(), static_cast<u32>(memory.size()), 0x18000000);
+    recorder.RegisterWritten<u32>(0x10401000, 1);
+    recorder.FrameFinished();
+    recorder.FrameFinished();
+    recorder.Finish(path);
+
+    SECTION("valid trace") {
+        Player player{path};
+        REQUIRE(player.IsValid());
+        REQUIRE(player.NumFrames() == 2);
+    }
+
+    SECTION("truncated trace") {
+        {
+            FileUtil::IOFile file{path, "r+b"};
+            file.Resize(file.GetSize() - 1);
+        }
+        Player player{path};
+        REQUIRE(!player.IsValid());
+    }
+
+    SECTION("missing trace") {
+        Player player{path + ".missing"};
+        REQUIRE(!player.IsValid());
+    }
+
+    FileUtil::Delete(path);
+}
+
+TEST_CASE("CiTrace::Recorder stores repeated memory contents once", "[core]") {
+    const std::string path = "citra_recorder_test.ctf";
+
+    // Hardly compressible contents, so that the file size shows how often they are stored
+    std::vector<u8> memory(0x10000);
+    u32 seed = 1;
+    for (u8& value : memory) {
+        seed = seed * 1103515245 + 12345;
+        value = static_cast<u8>(seed >> 16);
+    }
+
+    Recorder recorder{{}};
+    for (int i = 0; i < 4; ++i) {
+        recorder.MemoryAccessed(memory.data(), static_cast<u32>(memory.size()), 0x18000000);
+        recorder.FrameFinished();
+    }
+    recorder.Finish(path);
+
+    REQUIRE(FileUtil::GetSize(path) < 2 * memory.size());
+    Player player{path};
+    REQUIRE(player.IsValid());
+    REQUIRE(player.NumFrames() == 4);
+
+    FileUtil::Delete(path);
+}
+
+} // namespace CiTrace
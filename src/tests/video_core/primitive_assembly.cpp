@@ -0,0 +1,48 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch2/catch.hpp>
+#include "video_core/primitive_assembly.h"
+#include "video_core/shader/shader.h"
+
+namespace Pica {
+
+using Shader::OutputVertex;
+using TriangleTopology = PipelineRegs::TriangleTopology;
+
+TEST_CASE("PrimitiveAssembler - SubmitVertices matches SubmitVertex", "[video_core]") {
+    std::vector<OutputVertex> vertices(17);
+    for (std::size_t i = 0; i < vertices.size(); ++i) {
+        vertices[i] = {};
+        vertices[i].pos.x = float24::FromFloat32(static_cast<float>(i));
+    }
+
+    for (const auto topology : {TriangleTopology::List, TriangleTopology::Strip,
+                                TriangleTopology::Fan, TriangleTopology::Shader}) {
+        PrimitiveAssembler<OutputVertex> single(topology);
+        std::vector<float> expected;
+        for (const auto& vertex : vertices) {
+            single.SubmitVertex(vertex, [&](const OutputVertex& v0, const OutputVertex& v1,
+                                            const OutputVertex& v2) {
+                for (const auto* v : {&v0, &v1, &v2}) {
+                    expected.push_back(v->pos.x.ToFloat32());
+                }
+            });
+        }
+
+        // Split in two runs, the assembler carries its partial primitives over
+        PrimitiveAssembler<OutputVertex> bulk(topology);
+        std::vector<OutputVertex> triangles;
+        bulk.SubmitVertices(vertices.data(), 7, triangles);
+        bulk.SubmitVertices(vertices.data() + 7, vertices.size() - 7, triangles);
+
+        REQUIRE(triangles.size() == expected.size());
+        for (std::size_t i = 0; i < triangles.size(); ++i) {
+            REQUIRE(triangles[i].pos.x.ToFloat32() == expected[i]);
+        }
+    }
+}
+
+} // namespace Pica
@@ -0,0 +1,71 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include <catch2/catch.hpp>
+#include <fmt/format.h>
+#include <nihstro/inline_assembly.h>
+#include "video_core/renderer_opengl/gl_shader_decompiler.h"
+
+using DestRegister = nihstro::DestRegister;
+using OpCode = nihstro::OpCode;
+using SourceRegister = nihstro::SourceRegister;
+
+static std::string Decompile(std::initializer_list<nihstro::InlineAsm> code) {
+    const auto shbin = nihstro::InlineAsm::CompileToRawBinary(code);
+
+    Pica::Shader::ProgramCode program_code{};
+    Pica::Shader::SwizzleData swizzle_data{};
+    std::transform(shbin.program.begin(), shbin.program.end(), program_code.begin(),
+                   [](const auto& x) { return x.hex; });
+    std::transform(shbin.swizzle_table.begin(), shbin.swizzle_table.end(), swizzle_data.begin(),
+                   [](const auto& x) { return x.hex; });
+
+    // Only the first output register is in the output map
+    const auto result = OpenGL::ShaderDecompiler::DecompileProgram(
+        program_code, swizzle_data, 0, [](u32 reg) { return fmt::format("in{}", reg); },
+        [](u32 reg) { return reg == 0 ? std::string{"out0"} : std::string{}; }, false, false);
+    REQUIRE(result);
+    return result->code;
+}
+
+TEST_CASE("ShaderDecompiler drops the unread writes", "[video_core][renderer_opengl]") {
+    const auto code = Decompile({
+        // clang-format off
+        {OpCode::Id::MOV, DestRegister::MakeTemporary(0), SourceRegister::MakeInput(0)},
+        {OpCode::Id::MOV, DestRegister::MakeTemporary(1), SourceRegister::MakeInput(1)},
+        {OpCode::Id::MOV, DestRegister::MakeTemporary(2), SourceRegister::MakeInput(2)},
+        {OpCode::Id::MOV, DestRegister::MakeOutput(1), SourceRegister::MakeTemporary(2)},
+        {OpCode::Id::MOV, DestRegister::MakeOutput(0), SourceRegister::MakeTemporary(0)},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    REQUIRE(code.find("reg_tmp0 = in0;") != std::string::npos);
+    REQUIRE(code.find("out0 = reg_tmp0;") != std::string::npos);
+    // Neither the temporaries nor the writes to an unmapped output are left
+    REQUIRE(code.find("reg_tmp1") == std::string::npos);
+    REQUIRE(code.find("reg_tmp2") == std::string::npos);
+    REQUIRE(code.find(".xyzw") == std::string::npos);
+}
+
+TEST_CASE("ShaderDecompiler keeps the writes read on the way to an output",
+          "[video_core][renderer_opengl]") {
+    const auto code = Decompile({
+        // clang-format off
+        {OpCode::Id::MOV, DestRegister::MakeTemporary(1), SourceRegister::MakeInput(1)},
+        {OpCode::Id::MOV, DestRegister::MakeTemporary(0), SourceRegister::MakeTemporary(1)},
+        {OpCode::Id::DPH, DestRegister::MakeTemporary(2), SourceRegister::MakeTemporary(0),
+                          SourceRegister::MakeInput(0)},
+        {OpCode::Id::MOV, DestRegister::MakeOutput(0), SourceRegister::MakeTemporary(2)},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    REQUIRE(code.find("reg_tmp1 = in1;") != std::string::npos);
+    REQUIRE(code.find("reg_tmp0 = reg_tmp1;") != std::string::npos);
+    REQUIRE(code.find("reg_tmp2 = vec4(dot(reg_tmp0, in0));") != std::string::npos);
+    REQUIRE(code.find("out0 = reg_tmp2;") != std::string::npos);
+}
@@ -0,0 +1,81 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <catch2/catch.hpp>
+#include <nihstro/inline_assembly.h>
+#include "video_core/shader/shader_interpreter.h"
+
+using float24 = Pica::float24;
+using InterpreterEngine = Pica::Shader::InterpreterEngine;
+using ShaderSetup = Pica::Shader::ShaderSetup;
+
+using DestRegister = nihstro::DestRegister;
+using OpCode = nihstro::OpCode;
+using SourceRegister = nihstro::SourceRegister;
+
+static std::unique_ptr<ShaderSetup> MakeSetup(std::initializer_list<nihstro::InlineAsm> code) {
+    const auto shbin = nihstro::InlineAsm::CompileToRawBinary(code);
+
+    auto setup = std::make_unique<ShaderSetup>();
+    std::transform(shbin.program.begin(), shbin.program.end(), setup->program_code.begin(),
+                   [](const auto& x) { return x.hex; });
+    std::transform(shbin.swizzle_table.begin(), shbin.swizzle_table.end(),
+                   setup->swizzle_data.begin(), [](const auto& x) { return x.hex; });
+    return setup;
+}
+
+static float RunShader(InterpreterEngine& engine, ShaderSetup& setup, float input) {
+    Pica::Shader::UnitState unit;
+
+    engine.SetupBatch(setup, 0);
+    unit.registers.input[0].x = float24::FromFloat32(input);
+    engine.Run(setup, unit);
+    return unit.registers.output[0].x.ToFloat32();
+}
+
+TEST_CASE("Interpreter LG2", "[video_core][shader][shader_interpreter]") {
+    const auto sh_input = SourceRegister::MakeInput(0);
+    const auto sh_output = DestRegister::MakeOutput(0);
+
+    InterpreterEngine engine;
+    auto setup = MakeSetup({
+        // clang-format off
+        {OpCode::Id::LG2, sh_output, sh_input},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    REQUIRE(std::isnan(RunShader(engine, *setup, NAN)));
+    REQUIRE(std::isinf(RunShader(engine, *setup, 0.f)));
+    REQUIRE(RunShader(engine, *setup, 4.f) == Approx(2.f));
+    REQUIRE(RunShader(engine, *setup, 64.f) == Approx(6.f));
+}
+
+TEST_CASE("Interpreter programs", "[video_core][shader][shader_interpreter]") {
+    const auto sh_input = SourceRegister::MakeInput(0);
+    const auto sh_output = DestRegister::MakeOutput(0);
+
+    InterpreterEngine engine;
+    auto setup = MakeSetup({
+        // clang-format off
+        {OpCode::Id::EX2, sh_output, sh_input},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+    REQUIRE(RunShader(engine, *setup, 6.f) == Approx(64.f));
+
+    // Another program used with the same engine must not run the one decoded before
+    auto other_setup = MakeSetup({
+        // clang-format off
+        {OpCode::Id::MOV, sh_output, sh_input},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+    REQUIRE(RunShader(engine, *other_setup, 6.f) == Approx(6.f));
+    REQUIRE(RunShader(engine, *other_setup, -3.f) == Approx(-3.f));
+    REQUIRE(RunShader(engine, *setup, 2.f) == Approx(4.f));
+}
@@ -7,6 +7,9 @@
 #include <memory>
 #include <catch2/catch.hpp>
 #include <nihstro/inline_assembly.h>
+#include "video_core/regs_shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#include "video_core/shader/shader_jit_x64.h"
 #include "video_core/shader/shader_jit_x64_compiler.h"
 
 using float24 = Pica::float24;
@@ -89,3 +92,79 @@ TEST_CASE("EX2", "[video_core][shader][shader_jit]") {
     REQUIRE(shader.Run(79.7262742773f) == Approx(1.e24f));
     REQUIRE(std::isinf(shader.Run(800.f)));
 }
+
+TEST_CASE("Serialized program", "[video_core][shader][shader_jit]") {
+    const auto sh_input = SourceRegister::MakeInput(0);
+    const auto sh_output = DestRegister::MakeOutput(0);
+
+    auto shader = ShaderTest({
+        // clang-format off
+        {OpCode::Id::EX2, sh_output, sh_input},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    // Reloading the code into a different buffer must produce an equivalent program
+    const auto blob = shader.shader->Serialize();
+    shader.shader = std::make_unique<JitShader>();
+    REQUIRE(shader.shader->Deserialize(blob));
+
+    REQUIRE(shader.Run(2.f) == Approx(4.f));
+    REQUIRE(shader.Run(6.f) == Approx(64.f));
+
+    auto truncated = blob;
+    truncated.pop_back();
+    REQUIRE_FALSE(JitShader().Deserialize(truncated));
+}
+
+TEST_CASE("Batch matches the interpreter", "[video_core][shader][shader_jit]") {
+    const auto sh_input = SourceRegister::MakeInput(0);
+    const auto sh_output0 = DestRegister::MakeOutput(0);
+    const auto sh_output1 = DestRegister::MakeOutput(1);
+    const auto shbin = nihstro::InlineAsm::CompileToRawBinary({
+        // clang-format off
+        {OpCode::Id::EX2, sh_output0, sh_input},
+        {OpCode::Id::LG2, sh_output1, sh_input},
+        {OpCode::Id::END},
+        // clang-format on
+    });
+
+    Pica::Shader::ShaderSetup setup;
+    std::transform(shbin.program.begin(), shbin.program.end(), setup.program_code.begin(),
+                   [](const auto& x) { return x.hex; });
+    std::transform(shbin.swizzle_table.begin(), shbin.swizzle_table.end(),
+                   setup.swizzle_data.begin(), [](const auto& x) { return x.hex; });
+
+    Pica::ShaderRegs config{};
+    config.output_mask.Assign(0b11);
+
+    constexpr std::size_t count = 5;
+    const std::array<float, count> values{0.5f, 2.f, 6.f, 10.f, 79.7262742773f};
+    std::array<Pica::Shader::AttributeBuffer, count> inputs{};
+    for (std::size_t i = 0; i < count; ++i) {
+        inputs[i].attr[0].x = float24::FromFloat32(values[i]);
+    }
+
+    // Every vertex of the batch must see its own input, as if shaded on its own
+    std::array<Pica::Shader::AttributeBuffer, count> interpreter_outputs{};
+    Pica::Shader::InterpreterEngine interpreter;
+    Pica::Shader::UnitState interpreter_unit;
+    interpreter.SetupBatch(setup, 0);
+    interpreter.RunBatch(setup, config, interpreter_unit, inputs.data(),
+                         interpreter_outputs.data(), count);
+
+    std::array<Pica::Shader::AttributeBuffer, count> jit_outputs{};
+    Pica::Shader::JitX64Engine jit;
+    Pica::Shader::UnitState jit_unit;
+    jit.SetupBatch(setup, 0);
+    jit.RunBatch(setup, config, jit_unit, inputs.data(), jit_outputs.data(), count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t attr = 0; attr < 2; ++attr) {
+            REQUIRE(jit_outputs[i].attr[attr].x.ToFloat32() ==
+                    Approx(interpreter_outputs[i].attr[attr].x.ToFloat32()));
+        }
+    }
+    REQUIRE(jit_outputs[2].attr[0].x.ToFloat32() == Approx(64.f));
+    REQUIRE(jit_outputs[4].attr[1].x.ToFloat32() == Approx(6.3170f).epsilon(0.001));
+}
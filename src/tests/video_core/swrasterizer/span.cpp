@@ -0,0 +1,169 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstring>
+#include <random>
+#include <catch2/catch.hpp>
+#include "video_core/swrasterizer/span.h"
+#include "video_core/swrasterizer/texturing.h"
+
+namespace Pica::Rasterizer {
+
+using Operation = TexturingRegs::TevStageConfig::Operation;
+using ColorModifier = TexturingRegs::TevStageConfig::ColorModifier;
+using AlphaModifier = TexturingRegs::TevStageConfig::AlphaModifier;
+using BlendEquation = FramebufferRegs::BlendEquation;
+using BlendFactor = FramebufferRegs::BlendFactor;
+
+using Span = std::array<Common::Vec4<u8>, SPAN_SIZE>;
+
+// A span of a single fragment always takes the scalar path, which serves as the reference for
+// the vectorized one.
+
+static Span RandomSpan(std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(0, 255);
+    Span span;
+    for (auto& fragment : span) {
+        fragment = Common::MakeVec<int>(dist(rng), dist(rng), dist(rng), dist(rng)).Cast<u8>();
+    }
+    // Make sure the saturation boundaries are covered
+    span[0] = {0, 0, 0, 0};
+    span[1] = {255, 255, 255, 255};
+    return span;
+}
+
+static bool SameFragments(const Span& a, const Span& b) {
+    return std::memcmp(a.data(), b.data(), sizeof(Span)) == 0;
+}
+
+TEST_CASE("CombineSpan matches the per-fragment combiner", "[video_core][swrasterizer]") {
+    constexpr std::array<Operation, 10> operations = {
+        Operation::Replace,         Operation::Modulate,        Operation::Add,
+        Operation::AddSigned,       Operation::Lerp,            Operation::Subtract,
+        Operation::MultiplyThenAdd, Operation::AddThenMultiply, Operation::Dot3_RGB,
+        Operation::Dot3_RGBA,
+    };
+
+    std::mt19937 rng(1234);
+    for (int iteration = 0; iteration < 16; ++iteration) {
+        const Span input0 = RandomSpan(rng);
+        const Span input1 = RandomSpan(rng);
+        const Span input2 = RandomSpan(rng);
+        for (const auto color_op : operations) {
+            for (const auto alpha_op : operations) {
+                if (alpha_op == Operation::Dot3_RGB || alpha_op == Operation::Dot3_RGBA)
+                    continue;
+
+                Span vector, scalar;
+                CombineSpan(color_op, alpha_op, input0.data(), input1.data(), input2.data(),
+                            vector.data(), SPAN_SIZE);
+                for (std::size_t i = 0; i < SPAN_SIZE; ++i) {
+                    CombineSpan(color_op, alpha_op, &input0[i], &input1[i], &input2[i], &scalar[i],
+                                1);
+                }
+                REQUIRE(SameFragments(vector, scalar));
+            }
+        }
+    }
+}
+
+TEST_CASE("ModifyColorSpan and ModifyAlphaSpan match the per-fragment modifiers",
+          "[video_core][swrasterizer]") {
+    constexpr std::array<ColorModifier, 10> color_modifiers = {
+        ColorModifier::SourceColor, ColorModifier::OneMinusSourceColor,
+        ColorModifier::SourceAlpha, ColorModifier::OneMinusSourceAlpha,
+        ColorModifier::SourceRed,   ColorModifier::OneMinusSourceRed,
+        ColorModifier::SourceGreen, ColorModifier::OneMinusSourceGreen,
+        ColorModifier::SourceBlue,  ColorModifier::OneMinusSourceBlue,
+    };
+
+    std::mt19937 rng(4321);
+    const Span input = RandomSpan(rng);
+    for (const auto color_modifier : color_modifiers) {
+        for (u32 alpha_modifier = 0; alpha_modifier < 8; ++alpha_modifier) {
+            const auto modifier = static_cast<AlphaModifier>(alpha_modifier);
+            Span output;
+            ModifyColorSpan(color_modifier, input.data(), output.data(), SPAN_SIZE);
+            ModifyAlphaSpan(modifier, input.data(), output.data(), SPAN_SIZE);
+            for (std::size_t i = 0; i < SPAN_SIZE; ++i) {
+                const auto color = GetColorModifier(color_modifier, input[i]);
+                REQUIRE(output[i].r() == color.r());
+                REQUIRE(output[i].g() == color.g());
+                REQUIRE(output[i].b() == color.b());
+                REQUIRE(output[i].a() == GetAlphaModifier(modifier, input[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("ScaleSpan and FogSpan match the per-fragment code", "[video_core][swrasterizer]") {
+    std::mt19937 rng(42);
+    const Span input = RandomSpan(rng);
+
+    for (unsigned color_multiplier : {1, 2, 4}) {
+        for (unsigned alpha_multiplier : {1, 2, 4}) {
+            Span vector = input;
+            Span scalar = input;
+            ScaleSpan(vector.data(), color_multiplier, alpha_multiplier, SPAN_SIZE);
+            for (std::size_t i = 0; i < SPAN_SIZE; ++i) {
+                ScaleSpan(&scalar[i], color_multiplier, alpha_multiplier, 1);
+            }
+            REQUIRE(SameFragments(vector, scalar));
+        }
+    }
+
+    std::uniform_real_distribution<float> factor_dist(0.0f, 1.0f);
+    std::array<float, SPAN_SIZE> fog_factors;
+    for (auto& factor : fog_factors) {
+        factor = factor_dist(rng);
+    }
+    fog_factors[0] = 0.0f;
+    fog_factors[1] = 1.0f;
+
+    const Common::Vec3<u8> fog_color{12, 200, 255};
+    Span vector = input;
+    Span scalar = input;
+    FogSpan(vector.data(), fog_factors.data(), fog_color, SPAN_SIZE);
+    for (std::size_t i = 0; i < SPAN_SIZE; ++i) {
+        FogSpan(&scalar[i], &fog_factors[i], fog_color, 1);
+    }
+    REQUIRE(SameFragments(vector, scalar));
+}
+
+TEST_CASE("BlendSpan matches the per-fragment blender", "[video_core][swrasterizer]") {
+    constexpr std::array<BlendEquation, 5> equations = {
+        BlendEquation::Add, BlendEquation::Subtract, BlendEquation::ReverseSubtract,
+        BlendEquation::Min, BlendEquation::Max,
+    };
+
+    std::mt19937 rng(5678);
+    const Span src = RandomSpan(rng);
+    const Span dest = RandomSpan(rng);
+
+    for (const auto equation : equations) {
+        for (u32 src_factor = 0; src_factor <= 14; ++src_factor) {
+            for (u32 dest_factor = 0; dest_factor <= 14; ++dest_factor) {
+                const BlendState state{
+                    equation,
+                    equations[(src_factor + dest_factor) % equations.size()],
+                    static_cast<BlendFactor>(src_factor),
+                    static_cast<BlendFactor>(dest_factor),
+                    static_cast<BlendFactor>(14 - src_factor),
+                    static_cast<BlendFactor>(14 - dest_factor),
+                    {40, 90, 160, 230},
+                };
+
+                Span vector, scalar;
+                BlendSpan(src.data(), dest.data(), vector.data(), state, SPAN_SIZE);
+                for (std::size_t i = 0; i < SPAN_SIZE; ++i) {
+                    BlendSpan(&src[i], &dest[i], &scalar[i], state, 1);
+                }
+                REQUIRE(SameFragments(vector, scalar));
+            }
+        }
+    }
+}
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,57 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "video_core/swrasterizer/texture_cache.h"
+
+namespace Pica::Rasterizer {
+
+using TextureFormat = TexturingRegs::TextureFormat;
+
+TEST_CASE("DecodedTextureCache matches LookupTexture", "[video_core][swrasterizer]") {
+    std::mt19937 rng(0x7E8);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+
+    for (const auto format : {TextureFormat::RGBA8, TextureFormat::ETC1A4, TextureFormat::I4}) {
+        Texture::TextureInfo info{};
+        info.width = 32;
+        info.height = 16;
+        info.format = format;
+        info.SetDefaultStride();
+
+        std::vector<u8> data(info.width * info.height * 4);
+        for (auto& byte : data) {
+            byte = static_cast<u8>(byte_dist(rng));
+        }
+
+        auto& cache = DecodedTextureCache::GetThreadInstance();
+        auto CheckTexels = [&] {
+            DecodedTexture& texture = cache.Get(data.data(), info);
+            REQUIRE(texture.Matches(data.data(), info));
+            for (unsigned t = 0; t < info.height; ++t) {
+                for (unsigned s = 0; s < info.width; ++s) {
+                    const auto expected = Texture::LookupTexture(data.data(), s, t, info);
+                    const auto actual = texture.Lookup(s, t);
+                    INFO("format " << static_cast<u32>(format) << " texel " << s << "," << t);
+                    REQUIRE(actual.r() == expected.r());
+                    REQUIRE(actual.g() == expected.g());
+                    REQUIRE(actual.b() == expected.b());
+                    REQUIRE(actual.a() == expected.a());
+                }
+            }
+        };
+        CheckTexels();
+
+        // The texels of the next draw are decoded again
+        for (auto& byte : data) {
+            byte = static_cast<u8>(byte_dist(rng));
+        }
+        DecodedTextureCache::InvalidateAll();
+        CheckTexels();
+    }
+}
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,56 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <random>
+#include <catch2/catch.hpp>
+#include "video_core/texture/texture_decode.h"
+
+namespace Pica::Texture {
+
+using TextureFormat = TexturingRegs::TextureFormat;
+
+TEST_CASE("DecodeTile matches LookupTexelInTile", "[video_core][texture]") {
+    constexpr std::array<TextureFormat, 14> formats = {
+        TextureFormat::RGBA8, TextureFormat::RGB8, TextureFormat::RGB5A1, TextureFormat::RGB565,
+        TextureFormat::RGBA4, TextureFormat::IA8,  TextureFormat::RG8,    TextureFormat::I8,
+        TextureFormat::A8,    TextureFormat::IA4,  TextureFormat::I4,     TextureFormat::A4,
+        TextureFormat::ETC1,  TextureFormat::ETC1A4,
+    };
+
+    std::mt19937 rng(0xC17A);
+    std::uniform_int_distribution<int> byte_dist(0, 255);
+
+    for (const auto format : formats) {
+        TextureInfo info{};
+        info.width = 8;
+        info.height = 8;
+        info.format = format;
+        info.SetDefaultStride();
+
+        for (int iteration = 0; iteration < 64; ++iteration) {
+            std::array<u8, 4 * 64> tile;
+            for (auto& byte : tile) {
+                byte = static_cast<u8>(byte_dist(rng));
+            }
+
+            std::array<Common::Vec4<u8>, 64> decoded;
+            DecodeTile(tile.data(), info, decoded.data());
+
+            for (unsigned int y = 0; y < 8; ++y) {
+                for (unsigned int x = 0; x < 8; ++x) {
+                    const auto expected = LookupTexelInTile(tile.data(), x, y, info, false);
+                    const auto& actual = decoded[y * 8 + x];
+                    INFO("format " << static_cast<u32>(format) << " texel " << x << "," << y);
+                    REQUIRE(actual.r() == expected.r());
+                    REQUIRE(actual.g() == expected.g());
+                    REQUIRE(actual.b() == expected.b());
+                    REQUIRE(actual.a() == expected.a());
+                }
+            }
+        }
+    }
+}
+
+} // namespace Pica::Texture
@@ -2,21 +2,29 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstring>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/task_scheduler.h"
 #include "common/vector_math.h"
 #include "core/hle/service/gsp/gsp.h"
 #include "core/hw/gpu.h"
 #include "core/memory.h"
+#include "core/perf_stats.h"
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
 #include "video_core/primitive_assembly.h"
@@ -39,6 +47,48 @@ constexpr std::array<u32, 16> expand_bits_to_bytes{
 
 MICROPROFILE_DEFINE(GPU_Drawing, "GPU", "Drawing", MP_RGB(50, 50, 240));
 
+/// Draws with fewer vertices than this are shaded on the emulation thread alone
+constexpr unsigned int MIN_PARALLEL_VERTEX_COUNT = 256;
+
+/// Number of vertices loaded ahead and handed to the shader engine in one call
+constexpr unsigned int VERTEX_BATCH_SIZE = 16;
+
+/// Per-draw list of the distinct vertices referenced by an index buffer
+struct UniqueVertexList {
+    /// Vertex ids to shade, in order of first appearance in the index buffer
+    std::vector<u16> vertices;
+    /// Index position at which each unique vertex first appeared (used for logging)
+    std::vector<u32> first_index;
+    /// Maps each index position to its slot in `vertices`
+    std::vector<u16> slot_of_index;
+    /// Maps a vertex id to its slot in `vertices`, or INVALID_SLOT if not yet seen
+    std::vector<u32> slot_of_vertex = std::vector<u32>(0x10000, INVALID_SLOT);
+
+    static constexpr u32 INVALID_SLOT = 0xFFFFFFFF;
+
+    /// Scans the index buffer and deduplicates the vertex ids it references
+    template <typename IndexType>
+    void Build(const IndexType* indices, u32 count) {
+        vertices.clear();
+        first_index.clear();
+        slot_of_index.resize(count);
+        for (u32 index = 0; index < count; ++index) {
+            const u16 vertex = indices[index];
+            u32& slot = slot_of_vertex[vertex];
+            if (slot == INVALID_SLOT) {
+                slot = static_cast<u32>(vertices.size());
+                vertices.push_back(vertex);
+                first_index.push_back(index);
+            }
+            slot_of_index[index] = static_cast<u16>(slot);
+        }
+        // Reset only the entries touched by this draw so the table can be reused cheaply
+        for (u16 vertex : vertices) {
+            slot_of_vertex[vertex] = INVALID_SLOT;
+        }
+    }
+};
+
 static const char* GetShaderSetupTypeName(Shader::ShaderSetup& setup) {
     if (&setup == &g_state.vs) {
         return "vertex shader";
@@ -113,8 +163,50 @@ static void WriteUniformFloatReg(ShaderRegs& config, Shader::ShaderSetup& setup,
     }
 }
 
+/// Marks the registers in [first, first + count) in the table
+static constexpr void MarkRegisters(std::array<bool, Regs::NUM_REGS>& table, std::size_t first,
+                                    std::size_t count = 1) {
+    for (std::size_t id = first; id < first + count; ++id) {
+        table[id] = true;
+    }
+}
+
+/**
+ * Builds the table of the registers whose writes act even when they leave the value unchanged,
+ * which are the ones WritePicaReg handles beyond storing the value. Rewriting any other register
+ * with the value it holds changes nothing, neither here nor in the rasterizer.
+ */
+static constexpr std::array<bool, Regs::NUM_REGS> MakeTriggerRegisterTable() {
+    std::array<bool, Regs::NUM_REGS> table{};
+    MarkRegisters(table, PICA_REG_INDEX(trigger_irq));
+    MarkRegisters(table, PICA_REG_INDEX(texturing.fog_lut_data[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(texturing.proctex_lut_data[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(lighting.lut_data[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.triangle_topology));
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.restart_primitive));
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.vs_default_attributes_setup.index));
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.vs_default_attributes_setup.set_value[0]), 3);
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.command_buffer.trigger[0]), 2);
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.trigger_draw));
+    MarkRegisters(table, PICA_REG_INDEX(pipeline.trigger_draw_indexed));
+    MarkRegisters(table, PICA_REG_INDEX(gs.bool_uniforms));
+    MarkRegisters(table, PICA_REG_INDEX(gs.int_uniforms[0]), 4);
+    MarkRegisters(table, PICA_REG_INDEX(gs.uniform_setup.set_value[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(gs.program.set_word[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(gs.swizzle_patterns.set_word[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(vs.bool_uniforms));
+    MarkRegisters(table, PICA_REG_INDEX(vs.int_uniforms[0]), 4);
+    MarkRegisters(table, PICA_REG_INDEX(vs.uniform_setup.set_value[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(vs.program.set_word[0]), 8);
+    MarkRegisters(table, PICA_REG_INDEX(vs.swizzle_patterns.set_word[0]), 8);
+    return table;
+}
+
+static constexpr std::array<bool, Regs::NUM_REGS> trigger_registers = MakeTriggerRegisterTable();
+
 static void WritePicaReg(u32 id, u32 value, u32 mask) {
     auto& regs = g_state.regs;
+    DebugContext* const debug_context = GetAttachedDebugContext();
 
     if (id >= Regs::NUM_REGS) {
         LOG_ERROR(
@@ -128,22 +220,45 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
     u32 old_value = regs.reg_array[id];
 
     const u32 write_mask = expand_bits_to_bytes[mask];
+    const u32 new_value = (old_value & ~write_mask) | (value & write_mask);
+
+    const bool has_effect = new_value != old_value || trigger_registers[id];
+
+    // Triangles from the software vertex pipeline are queued across draws. Only the registers
+    // before the pipeline ones affect how they are drawn, so a write there that changes something
+    // draws them first, while the registers still hold the configuration they were queued with.
+    if (id < PICA_REG_INDEX(pipeline) && has_effect) {
+        VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+    }
 
-    regs.reg_array[id] = (old_value & ~write_mask) | (value & write_mask);
+    regs.reg_array[id] = new_value;
 
     // Double check for is_pica_tracing to avoid call overhead
     if (DebugUtils::IsPicaTracing()) {
         DebugUtils::OnPicaRegWrite({(u16)id, (u16)mask, regs.reg_array[id]});
     }
 
-    if (g_debug_context)
-        g_debug_context->OnEvent(DebugContext::Event::PicaCommandLoaded,
-                                 reinterpret_cast<void*>(&id));
+    if (debug_context)
+        debug_context->OnEvent(DebugContext::Event::PicaCommandLoaded,
+                               reinterpret_cast<void*>(&id));
+
+    // Games rewrite whole blocks of configuration registers for every draw, most of them with the
+    // values they already hold
+    if (!has_effect) {
+        if (debug_context)
+            debug_context->OnEvent(DebugContext::Event::PicaCommandProcessed,
+                                   reinterpret_cast<void*>(&id));
+        return;
+    }
 
     switch (id) {
     // Trigger IRQ
     case PICA_REG_INDEX(trigger_irq):
-        Service::GSP::SignalInterrupt(Service::GSP::InterruptId::P3D);
+        if (VideoCore::g_gpu_thread) {
+            VideoCore::g_gpu_thread->SignalInterrupt(Service::GSP::InterruptId::P3D);
+        } else {
+            Service::GSP::SignalInterrupt(Service::GSP::InterruptId::P3D);
+        }
         break;
 
     case PICA_REG_INDEX(pipeline.triangle_topology):
@@ -222,9 +337,9 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
 
                     // Send to vertex shader
-                    if (g_debug_context)
-                        g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
-                                                 static_cast<void*>(&immediate_input));
+                    if (debug_context)
+                        debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
+                                               static_cast<void*>(&immediate_input));
                     Shader::UnitState shader_unit;
                     Shader::AttributeBuffer output{};
 
@@ -241,13 +356,11 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                     g_state.geometry_pipeline.Setup(shader_engine);
                     g_state.geometry_pipeline.SubmitVertex(output);
 
-                    // TODO: If drawing after every immediate mode triangle kills performance,
-                    // change it to flush triangles whenever a drawing config register changes
-                    // See: https://github.com/citra-emu/citra/pull/2866#issuecomment-327011550
-                    VideoCore::g_renderer->Rasterizer()->DrawTriangles();
-                    if (g_debug_context) {
-                        g_debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch,
-                                                 nullptr);
+                    // The triangles are drawn once a drawing config register changes
+                    if (debug_context) {
+                        VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+                        debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch,
+                                               nullptr);
                     }
                 }
             }
@@ -278,8 +391,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 #if PICA_LOG_TEV
         DebugUtils::DumpTevStageConfig(regs.GetTevStages());
 #endif
-        if (g_debug_context)
-            g_debug_context->OnEvent(DebugContext::Event::IncomingPrimitiveBatch, nullptr);
+        if (debug_context)
+            debug_context->OnEvent(DebugContext::Event::IncomingPrimitiveBatch, nullptr);
 
         PrimitiveAssembler<Shader::OutputVertex>& primitive_assembler = g_state.primitive_assembler;
 
@@ -305,8 +418,8 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
         if (accelerate_draw &&
             VideoCore::g_renderer->Rasterizer()->AccelerateDrawBatch(is_indexed)) {
-            if (g_debug_context) {
-                g_debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
+            if (debug_context) {
+                debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
             }
             break;
         }
@@ -325,7 +438,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
         bool index_u16 = index_info.format != 0;
 
-        if (g_debug_context && g_debug_context->recorder) {
+        if (debug_context && debug_context->recorder) {
             for (int i = 0; i < 3; ++i) {
                 const auto texture = regs.texturing.GetTextures()[i];
                 if (!texture.enabled)
@@ -333,7 +446,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
                 u8* texture_data =
                     VideoCore::g_memory->GetPhysicalPointer(texture.config.GetPhysicalAddress());
-                g_debug_context->recorder->MemoryAccessed(
+                debug_context->recorder->MemoryAccessed(
                     texture_data,
                     Pica::TexturingRegs::NibblesPerPixel(texture.format) * texture.config.width /
                         2 * texture.config.height,
@@ -343,19 +456,7 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
         DebugUtils::MemoryAccessTracker memory_accesses;
 
-        // Simple circular-replacement vertex cache
-        // The size has been tuned for optimal balance between hit-rate and the cost of lookup
-        const std::size_t VERTEX_CACHE_SIZE = 32;
-        std::array<bool, VERTEX_CACHE_SIZE> vertex_cache_valid{};
-        std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
-        std::array<Shader::AttributeBuffer, VERTEX_CACHE_SIZE> vertex_cache;
-        Shader::AttributeBuffer vs_output;
-
-        unsigned int vertex_cache_pos = 0;
-
         auto* shader_engine = Shader::GetEngine();
-        Shader::UnitState shader_unit;
-
         shader_engine->SetupBatch(g_state.vs, regs.vs.main_offset);
 
         g_state.geometry_pipeline.Reconfigure();
@@ -363,68 +464,136 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
         if (g_state.geometry_pipeline.NeedIndexInput())
             ASSERT(is_indexed);
 
-        for (unsigned int index = 0; index < regs.pipeline.num_vertices; ++index) {
-            // Indexed rendering doesn't use the start offset
-            unsigned int vertex =
-                is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index])
-                           : (index + regs.pipeline.vertex_offset);
+        const unsigned int num_vertices = regs.pipeline.num_vertices;
 
-            bool vertex_cache_hit = false;
+        if (is_indexed && debug_context && debug_context->recorder) {
+            const u32 size = index_u16 ? 2 : 1;
+            memory_accesses.AddAccess(base_address + index_info.offset, size * num_vertices);
+        }
 
+        if (g_state.geometry_pipeline.NeedIndexInput()) {
+            for (unsigned int index = 0; index < num_vertices; ++index) {
+                g_state.geometry_pipeline.SubmitIndex(index_u16 ? index_address_16[index]
+                                                                : index_address_8[index]);
+            }
+        } else {
+            // Indexed draws are deduplicated up front so that every distinct vertex is shaded
+            // exactly once, regardless of how far apart its references are in the index buffer.
+            static UniqueVertexList unique_list;
             if (is_indexed) {
-                if (g_state.geometry_pipeline.NeedIndexInput()) {
-                    g_state.geometry_pipeline.SubmitIndex(vertex);
-                    continue;
-                }
-
-                if (g_debug_context && Pica::g_debug_context->recorder) {
-                    int size = index_u16 ? 2 : 1;
-                    memory_accesses.AddAccess(base_address + index_info.offset + size * index,
-                                              size);
+                if (index_u16) {
+                    unique_list.Build(index_address_16, num_vertices);
+                } else {
+                    unique_list.Build(index_address_8, num_vertices);
                 }
+            }
 
-                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
-                    if (vertex_cache_valid[i] && vertex == vertex_cache_ids[i]) {
-                        vs_output = vertex_cache[i];
-                        vertex_cache_hit = true;
-                        break;
+            const unsigned int num_shaded =
+                is_indexed ? static_cast<unsigned int>(unique_list.vertices.size()) : num_vertices;
+            // Instantiated once with the debug hooks and once without, so that the loop of the
+            // undebugged draws carries no check at all
+            const auto shade_range = [&](auto debugging, Shader::UnitState& shader_unit,
+                                         unsigned int begin, unsigned int end,
+                                         DebugUtils::MemoryAccessTracker& accesses,
+                                         Shader::AttributeBuffer* outputs) {
+                constexpr bool is_debugging = decltype(debugging)::value;
+                // The debug context inspects each input right before it is shaded
+                constexpr unsigned int batch_size = is_debugging ? 1 : VERTEX_BATCH_SIZE;
+                std::array<Shader::AttributeBuffer, VERTEX_BATCH_SIZE> inputs;
+                for (unsigned int batch = begin; batch < end; batch += batch_size) {
+                    const unsigned int count = std::min(batch_size, end - batch);
+                    for (unsigned int i = 0; i < count; ++i) {
+                        // Indexed rendering doesn't use the start offset
+                        const unsigned int slot = batch + i;
+                        const unsigned int index = is_indexed ? unique_list.first_index[slot] : slot;
+                        const unsigned int vertex = is_indexed
+                                                        ? unique_list.vertices[slot]
+                                                        : (slot + regs.pipeline.vertex_offset);
+                        loader.LoadVertex(index, vertex, inputs[i], accesses);
+                        if constexpr (is_debugging) {
+                            debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
+                                                   (void*)&inputs[i]);
+                        }
                     }
+                    shader_engine->RunBatch(g_state.vs, regs.vs, shader_unit, inputs.data(),
+                                            outputs + batch, count);
                 }
+            };
+
+            static std::vector<Shader::AttributeBuffer> vs_outputs;
+            vs_outputs.resize(num_shaded);
+
+            // The debug context observes every shader invocation in order, so only undebugged
+            // batches are shaded in parallel.
+            if (VideoCore::g_parallel_vertex_shading && !debug_context &&
+                num_shaded >= MIN_PARALLEL_VERTEX_COUNT) {
+                Common::TaskScheduler::GetInstance().ParallelFor(
+                    num_shaded, MIN_PARALLEL_VERTEX_COUNT / 2,
+                    [&](std::size_t begin, std::size_t end) {
+                        // Each worker acts as its own shader unit
+                        Shader::UnitState shader_unit;
+                        DebugUtils::MemoryAccessTracker unused_accesses;
+                        shade_range(std::false_type{}, shader_unit,
+                                    static_cast<unsigned int>(begin),
+                                    static_cast<unsigned int>(end), unused_accesses,
+                                    vs_outputs.data());
+                    });
+            } else if (debug_context) {
+                Shader::UnitState shader_unit;
+                shade_range(std::true_type{}, shader_unit, 0, num_shaded, memory_accesses,
+                            vs_outputs.data());
+            } else {
+                Shader::UnitState shader_unit;
+                shade_range(std::false_type{}, shader_unit, 0, num_shaded, memory_accesses,
+                            vs_outputs.data());
             }
 
-            if (!vertex_cache_hit) {
-                // Initialize data for the current vertex
-                Shader::AttributeBuffer input;
-                loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
-
-                // Send to vertex shader
-                if (g_debug_context)
-                    g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
-                                             (void*)&input);
-                shader_unit.LoadInput(regs.vs, input);
-                shader_engine->Run(g_state.vs, shader_unit);
-                shader_unit.WriteOutput(regs.vs, vs_output);
-
+            if (regs.pipeline.use_gs == PipelineRegs::UseGS::No) {
+                // Without a geometry shader, the primitives are assembled and handed to the
+                // rasterizer in bulk. Each shaded vertex is converted only once.
+                static std::vector<Shader::OutputVertex> output_vertices;
+                static std::vector<Shader::OutputVertex> ordered_vertices;
+                static std::vector<Shader::OutputVertex> triangles;
+                output_vertices.resize(num_shaded);
+                for (unsigned int slot = 0; slot < num_shaded; ++slot) {
+                    output_vertices[slot] = Shader::OutputVertex::FromAttributeBuffer(
+                        regs.rasterizer, vs_outputs[slot]);
+                }
+                const Shader::OutputVertex* vertices = output_vertices.data();
                 if (is_indexed) {
-                    vertex_cache[vertex_cache_pos] = vs_output;
-                    vertex_cache_valid[vertex_cache_pos] = true;
-                    vertex_cache_ids[vertex_cache_pos] = vertex;
-                    vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
+                    ordered_vertices.resize(num_vertices);
+                    for (unsigned int index = 0; index < num_vertices; ++index) {
+                        ordered_vertices[index] = output_vertices[unique_list.slot_of_index[index]];
+                    }
+                    vertices = ordered_vertices.data();
                 }
-            }
 
-            // Send to geometry pipeline
-            g_state.geometry_pipeline.SubmitVertex(vs_output);
+                triangles.clear();
+                primitive_assembler.SubmitVertices(vertices, num_vertices, triangles);
+                VideoCore::g_renderer->Rasterizer()->AddTriangles(triangles.data(),
+                                                                  triangles.size() / 3);
+            } else {
+                // Replay the results to the geometry pipeline in the original submission order
+                for (unsigned int index = 0; index < num_vertices; ++index) {
+                    g_state.geometry_pipeline.SubmitVertex(
+                        vs_outputs[is_indexed ? unique_list.slot_of_index[index] : index]);
+                }
+            }
         }
 
-        for (auto& range : memory_accesses.ranges) {
-            g_debug_context->recorder->MemoryAccessed(
-                VideoCore::g_memory->GetPhysicalPointer(range.first), range.second, range.first);
+        if (debug_context && debug_context->recorder) {
+            for (auto& range : memory_accesses.ranges) {
+                debug_context->recorder->MemoryAccessed(
+                    VideoCore::g_memory->GetPhysicalPointer(range.first), range.second,
+                    range.first);
+            }
         }
 
-        VideoCore::g_renderer->Rasterizer()->DrawTriangles();
-        if (g_debug_context) {
-            g_debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
+        // The triangles stay queued so that following draws with the same configuration are
+        // merged with them, see WritePicaReg
+        if (debug_context) {
+            VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+            debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
         }
 
         break;
@@ -640,23 +809,73 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
     VideoCore::g_renderer->Rasterizer()->NotifyPicaRegisterChanged(id);
 
-    if (g_debug_context)
-        g_debug_context->OnEvent(DebugContext::Event::PicaCommandProcessed,
-                                 reinterpret_cast<void*>(&id));
+    if (debug_context)
+        debug_context->OnEvent(DebugContext::Event::PicaCommandProcessed,
+                               reinterpret_cast<void*>(&id));
 }
 
-void ProcessCommandList(PAddr list, u32 size) {
+static bool IsCommandBufferTrigger(u32 id) {
+    return id == PICA_REG_INDEX(pipeline.command_buffer.trigger[0]) ||
+           id == PICA_REG_INDEX(pipeline.command_buffer.trigger[1]);
+}
 
-    u32* buffer = (u32*)VideoCore::g_memory->GetPhysicalPointer(list);
+/// A register write decoded from a command list
+struct DecodedWrite {
+    u32 id;
+    u32 value;
+    u32 mask;
+};
 
-    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
-        Pica::g_debug_context->recorder->MemoryAccessed((u8*)buffer, size, list);
-    }
+/// The register writes of a command list, replayed for as long as the list stays the same
+struct DecodedCommandList {
+    u32 size;
+    u64 hash;
+    std::vector<DecodedWrite> writes;
+};
 
-    g_state.cmd_list.addr = list;
-    g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = buffer;
-    g_state.cmd_list.length = size / sizeof(u32);
+/// Number of command lists kept decoded, the cache is emptied when it grows beyond it
+constexpr std::size_t COMMAND_LIST_CACHE_SIZE = 256;
+
+static std::unordered_map<PAddr, DecodedCommandList> command_list_cache;
+
+/**
+ * Decodes the register writes of a command list the way RunCommandList processes them.
+ * @returns false if the list can't be replayed from its writes, because its commands reach past
+ *          its end or it jumps to another list in the middle of a command
+ */
+static bool DecodeCommandList(const u32* buffer, u32 length, std::vector<DecodedWrite>& writes) {
+    writes.clear();
+    const u32* current = buffer;
+    const u32* const end = buffer + length;
+    while (current < end) {
+        // Align read pointer to 8 bytes
+        if ((buffer - current) % 2 != 0)
+            ++current;
 
+        if (end - current < 2) {
+            return false;
+        }
+        const u32 value = *current++;
+        const CommandHeader header = {*current++};
+        if (static_cast<u32>(end - current) < header.extra_data_length ||
+            (header.extra_data_length != 0 && IsCommandBufferTrigger(header.cmd_id))) {
+            return false;
+        }
+
+        writes.push_back({header.cmd_id, value, header.parameter_mask});
+        for (unsigned i = 0; i < header.extra_data_length; ++i) {
+            const u32 cmd = header.cmd_id + (header.group_commands ? i + 1 : 0);
+            if (i + 1 != header.extra_data_length && IsCommandBufferTrigger(cmd)) {
+                return false;
+            }
+            writes.push_back({cmd, *current++, header.parameter_mask});
+        }
+    }
+    return true;
+}
+
+/// Processes the commands of the current command list, following the jumps to other lists
+static void RunCommandList() {
     while (g_state.cmd_list.current_ptr < g_state.cmd_list.head_ptr + g_state.cmd_list.length) {
 
         // Align read pointer to 8 bytes
@@ -675,4 +894,62 @@ void ProcessCommandList(PAddr list, u32 size) {
     }
 }
 
+/**
+ * Replays the decoded writes of a command list.
+ * @returns false if the list jumped to another one, which then remains to be run
+ */
+static bool ReplayCommandList(const DecodedCommandList& decoded) {
+    for (const DecodedWrite& write : decoded.writes) {
+        WritePicaReg(write.id, write.value, write.mask);
+        if (IsCommandBufferTrigger(write.id)) {
+            return false;
+        }
+    }
+    g_state.cmd_list.current_ptr = g_state.cmd_list.head_ptr + g_state.cmd_list.length;
+    return true;
+}
+
+/**
+ * Runs a command list from its decoded writes, decoding it first if it isn't cached or has changed.
+ * Titles mostly submit the same lists every frame.
+ * @returns false if the list was run another way or not fully, leaving the rest to RunCommandList
+ */
+static bool RunCachedCommandList(PAddr list, const u32* buffer, u32 size) {
+    const u64 hash = Common::ComputeHash64(buffer, size);
+    auto it = command_list_cache.find(list);
+    if (it == command_list_cache.end() || it->second.size != size || it->second.hash != hash) {
+        if (command_list_cache.size() >= COMMAND_LIST_CACHE_SIZE) {
+            command_list_cache.clear();
+        }
+        DecodedCommandList decoded{size, hash, {}};
+        if (!DecodeCommandList(buffer, size / sizeof(u32), decoded.writes)) {
+            command_list_cache.erase(list);
+            return false;
+        }
+        it = command_list_cache.insert_or_assign(list, std::move(decoded)).first;
+    }
+    return ReplayCommandList(it->second);
+}
+
+void ProcessCommandList(PAddr list, u32 size) {
+    Core::ScopedPerfSubsystem gpu_time{Core::PerfSubsystem::GPUCommands};
+
+    u32* buffer = (u32*)VideoCore::g_memory->GetPhysicalPointer(list);
+
+    DebugContext* const debug_context = GetAttachedDebugContext();
+    if (debug_context && debug_context->recorder) {
+        debug_context->recorder->MemoryAccessed((u8*)buffer, size, list);
+    }
+
+    g_state.cmd_list.addr = list;
+    g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = buffer;
+    g_state.cmd_list.length = size / sizeof(u32);
+
+    // The debugger inspects the commands as they are read, so it always gets them parsed anew
+    if (buffer != nullptr && !debug_context && RunCachedCommandList(list, buffer, size)) {
+        return;
+    }
+    RunCommandList();
+}
+
 } // namespace Pica::CommandProcessor
@@ -80,7 +80,15 @@ void DebugContext::Resume() {
     resume_from_breakpoint.notify_one();
 }
 
+void DebugContext::UpdateAttached() {
+    const bool any_breakpoint = std::any_of(breakpoints.begin(), breakpoints.end(),
+                                            [](const BreakPoint& bp) { return bp.enabled; });
+    g_debug_context_attached.store(any_breakpoint || recorder != nullptr,
+                                   std::memory_order_relaxed);
+}
+
 std::shared_ptr<DebugContext> g_debug_context; // TODO: Get rid of this global
+std::atomic<bool> g_debug_context_attached{false};
 
 namespace DebugUtils {
 
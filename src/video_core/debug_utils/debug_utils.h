@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <condition_variable>
 #include <iterator>
 #include <list>
@@ -150,10 +151,25 @@ public:
         for (auto& bp : breakpoints) {
             bp.enabled = false;
         }
+        UpdateAttached();
         Resume();
     }
 
+    /// Enables or disables the breakpoint of an event
+    void SetBreakpoint(Event event, bool enabled) {
+        breakpoints[(int)event].enabled = enabled;
+        UpdateAttached();
+    }
+
+    /// Records a CiTrace with the given recorder, or stops recording if it is null
+    void SetRecorder(std::shared_ptr<CiTrace::Recorder> new_recorder) {
+        recorder = std::move(new_recorder);
+        UpdateAttached();
+    }
+
     // TODO: Evaluate if access to these members should be hidden behind a public interface.
+    // The breakpoints and the recorder are only changed through the functions above, which keep
+    // g_debug_context_attached up to date.
     std::array<BreakPoint, (int)Event::NumEvents> breakpoints;
     Event active_breakpoint;
     bool at_breakpoint = false;
@@ -167,6 +183,9 @@ private:
      */
     DebugContext() = default;
 
+    /// Updates g_debug_context_attached after the breakpoints or the recorder changed
+    void UpdateAttached();
+
     /// Mutex protecting current breakpoint state and the observer list.
     std::mutex breakpoint_mutex;
 
@@ -179,6 +198,17 @@ private:
 
 extern std::shared_ptr<DebugContext> g_debug_context; // TODO: Get rid of this global
 
+/// Whether g_debug_context has a breakpoint set or records a CiTrace, otherwise nothing observes
+/// its events and the emulation skips them, along with the slower paths they need.
+extern std::atomic<bool> g_debug_context_attached;
+
+/// Returns the debug context if a debugger is attached to it, null otherwise. This is a single
+/// flag test while no debugger is attached, and is meant to be read once per batch of work.
+inline DebugContext* GetAttachedDebugContext() {
+    return g_debug_context_attached.load(std::memory_order_relaxed) ? g_debug_context.get()
+                                                                     : nullptr;
+}
+
 namespace DebugUtils {
 
 #define PICA_LOG_TEV 0
@@ -0,0 +1,126 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/thread.h"
+#include "core/frontend/emu_window.h"
+#include "core/hle/service/gsp/gsp.h"
+#include "video_core/gpu_thread.h"
+
+namespace VideoCore {
+
+GPUThread::GPUThread(Frontend::EmuWindow& emu_window) : emu_window(emu_window) {}
+
+GPUThread::~GPUThread() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock{job_mutex};
+        stop = true;
+    }
+    job_cv.notify_one();
+    thread.join();
+
+    // Hand the graphics context back to the thread shutting the renderer down
+    emu_window.MakeCurrent();
+}
+
+void GPUThread::Push(std::function<void()> job) {
+    if (IsGPUThread()) {
+        job();
+        return;
+    }
+    if (!thread.joinable()) {
+        Start();
+    }
+    {
+        std::lock_guard lock{job_mutex};
+        jobs.push_back(std::move(job));
+    }
+    job_cv.notify_one();
+}
+
+void GPUThread::PushAndWait(std::function<void()> job) {
+    if (IsGPUThread() || !thread.joinable()) {
+        job();
+        return;
+    }
+    Push(std::move(job));
+    WaitIdle();
+}
+
+void GPUThread::WaitIdle() {
+    if (!thread.joinable() || IsGPUThread()) {
+        return;
+    }
+    std::unique_lock lock{job_mutex};
+    idle_cv.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+bool GPUThread::IsGPUThread() const {
+    return std::this_thread::get_id() == thread_id.load();
+}
+
+void GPUThread::SignalInterrupt(Service::GSP::InterruptId interrupt_id) {
+    if (!IsGPUThread()) {
+        Service::GSP::SignalInterrupt(interrupt_id);
+        return;
+    }
+    std::lock_guard lock{interrupt_mutex};
+    pending_interrupts.push_back(interrupt_id);
+}
+
+void GPUThread::SignalPendingInterrupts() {
+    std::vector<Service::GSP::InterruptId> interrupts;
+    {
+        std::lock_guard lock{interrupt_mutex};
+        interrupts.swap(pending_interrupts);
+    }
+    if (!interrupts.empty()) {
+        Service::GSP::SignalInterrupts(interrupts);
+    }
+}
+
+void GPUThread::Start() {
+    // The context is current on the submitting thread until the first job is pushed, which lets
+    // the disk shader cache load there beforehand
+    emu_window.DoneCurrent();
+    thread = std::thread(&GPUThread::ThreadLoop, this);
+    LOG_INFO(Render, "GPU thread started");
+}
+
+void GPUThread::ThreadLoop() {
+    Common::SetCurrentThreadName("GPUThread");
+    Common::SetCurrentThreadRole(Common::ThreadRole::Render);
+    MicroProfileOnThreadCreate("GPUThread");
+    thread_id = std::this_thread::get_id();
+    emu_window.MakeCurrent();
+
+    std::unique_lock lock{job_mutex};
+    while (true) {
+        job_cv.wait(lock, [this] { return stop || !jobs.empty(); });
+        if (jobs.empty()) {
+            break;
+        }
+        auto job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        busy = false;
+        if (jobs.empty()) {
+            idle_cv.notify_all();
+        }
+    }
+
+    emu_window.DoneCurrent();
+}
+
+} // namespace VideoCore
@@ -0,0 +1,77 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+
+namespace Frontend {
+class EmuWindow;
+}
+
+namespace Service::GSP {
+enum class InterruptId : u8;
+}
+
+namespace VideoCore {
+
+/**
+ * Runs the GPU work submitted by the emulation thread on a thread of its own, which owns the
+ * graphics context once it has started. Jobs run in the order they are pushed. The interrupts
+ * raised by the jobs are held back until the emulation thread picks them up, so that the GSP
+ * service is only touched there.
+ */
+class GPUThread : NonCopyable {
+public:
+    explicit GPUThread(Frontend::EmuWindow& emu_window);
+    ~GPUThread();
+
+    /// Queues the job without waiting for it. Runs it right away when called on the GPU thread.
+    void Push(std::function<void()> job);
+
+    /// Queues the job and waits until it has run. Runs it right away when called on the GPU
+    /// thread, or when the thread hasn't started yet.
+    void PushAndWait(std::function<void()> job);
+
+    /// Waits until all the queued jobs have run
+    void WaitIdle();
+
+    /// Returns whether the caller is running on the GPU thread
+    bool IsGPUThread() const;
+
+    /// Signals the interrupt, deferring it to SignalPendingInterrupts when on the GPU thread
+    void SignalInterrupt(Service::GSP::InterruptId interrupt_id);
+
+    /// Signals the interrupts raised by the jobs that have run, on the emulation thread
+    void SignalPendingInterrupts();
+
+private:
+    void Start();
+    void ThreadLoop();
+
+    Frontend::EmuWindow& emu_window;
+    std::thread thread;
+    /// Set by the thread itself, the thread object may still be getting assigned
+    std::atomic<std::thread::id> thread_id{};
+
+    std::mutex job_mutex;
+    std::condition_variable job_cv;
+    std::condition_variable idle_cv;
+    std::deque<std::function<void()>> jobs;
+    bool busy = false;
+    bool stop = false;
+
+    std::mutex interrupt_mutex;
+    std::vector<Service::GSP::InterruptId> pending_interrupts;
+};
+
+} // namespace VideoCore
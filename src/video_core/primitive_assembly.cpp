@@ -53,6 +53,65 @@ void PrimitiveAssembler<VertexType>::SubmitVertex(const VertexType& vtx,
     }
 }
 
+template <typename VertexType>
+template <PipelineRegs::TriangleTopology Topology>
+void PrimitiveAssembler<VertexType>::AssembleVertices(const VertexType* vertices,
+                                                      std::size_t count,
+                                                      std::vector<VertexType>& triangles) {
+    using TriangleTopology = PipelineRegs::TriangleTopology;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const VertexType& vtx = vertices[i];
+        if constexpr (Topology == TriangleTopology::List || Topology == TriangleTopology::Shader) {
+            if (buffer_index < 2) {
+                buffer[buffer_index++] = vtx;
+                continue;
+            }
+            buffer_index = 0;
+            const bool invert = Topology == TriangleTopology::Shader && winding;
+            if (invert)
+                winding = false;
+            triangles.push_back(buffer[invert ? 1 : 0]);
+            triangles.push_back(buffer[invert ? 0 : 1]);
+            triangles.push_back(vtx);
+        } else {
+            if (strip_ready) {
+                triangles.push_back(buffer[0]);
+                triangles.push_back(buffer[1]);
+                triangles.push_back(vtx);
+            }
+
+            buffer[buffer_index] = vtx;
+            strip_ready |= (buffer_index == 1);
+            buffer_index = Topology == TriangleTopology::Strip ? !buffer_index : 1;
+        }
+    }
+}
+
+template <typename VertexType>
+void PrimitiveAssembler<VertexType>::SubmitVertices(const VertexType* vertices, std::size_t count,
+                                                    std::vector<VertexType>& triangles) {
+    using TriangleTopology = PipelineRegs::TriangleTopology;
+
+    switch (topology) {
+    case TriangleTopology::List:
+        AssembleVertices<TriangleTopology::List>(vertices, count, triangles);
+        break;
+    case TriangleTopology::Strip:
+        AssembleVertices<TriangleTopology::Strip>(vertices, count, triangles);
+        break;
+    case TriangleTopology::Fan:
+        AssembleVertices<TriangleTopology::Fan>(vertices, count, triangles);
+        break;
+    case TriangleTopology::Shader:
+        AssembleVertices<TriangleTopology::Shader>(vertices, count, triangles);
+        break;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown triangle topology {:x}:", (int)topology);
+        break;
+    }
+}
+
 template <typename VertexType>
 void PrimitiveAssembler<VertexType>::SetWinding() {
     winding = true;
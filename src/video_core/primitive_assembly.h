@@ -5,7 +5,9 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <functional>
+#include <vector>
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/array.hpp>
 #include "video_core/regs_pipeline.h"
@@ -32,6 +34,14 @@ struct PrimitiveAssembler {
      */
     void SubmitVertex(const VertexType& vtx, const TriangleHandler& triangle_handler);
 
+    /**
+     * Queues a run of vertices like SubmitVertex does for each of them, but appends the vertices
+     * of the generated primitives to the given list, three per triangle, instead of calling a
+     * handler. The topology is resolved once for the whole run.
+     */
+    void SubmitVertices(const VertexType* vertices, std::size_t count,
+                        std::vector<VertexType>& triangles);
+
     /**
      * Invert the vertex order of the next triangle. Called by geometry shader emitter.
      * This only takes effect for TriangleTopology::Shader.
@@ -59,6 +69,10 @@ struct PrimitiveAssembler {
     PipelineRegs::TriangleTopology GetTopology() const;
 
 private:
+    template <PipelineRegs::TriangleTopology Topology>
+    void AssembleVertices(const VertexType* vertices, std::size_t count,
+                          std::vector<VertexType>& triangles);
+
     PipelineRegs::TriangleTopology topology;
 
     int buffer_index = 0;
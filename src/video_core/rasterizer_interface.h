@@ -5,6 +5,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 #include <functional>
 #include "common/common_types.h"
 #include "core/hw/gpu.h"
@@ -36,6 +37,13 @@ public:
                              const Pica::Shader::OutputVertex& v1,
                              const Pica::Shader::OutputVertex& v2) = 0;
 
+    /**
+     * Queues a run of primitives, given by consecutive triples of vertices, converting them in
+     * bulk instead of through one AddTriangle call per triangle
+     */
+    virtual void AddTriangles(const Pica::Shader::OutputVertex* vertices,
+                              std::size_t num_triangles) = 0;
+
     /// Draw the current batch of triangles
     virtual void DrawTriangles() = 0;
 
@@ -58,6 +66,17 @@ public:
     /// Removes as much state as possible from the rasterizer in preparation for a save/load state
     virtual void ClearAll(bool flush) = 0;
 
+    /**
+     * Like ClearAll, but the caches holding the contents of the memory may be kept aside, to be
+     * put back by ReattachCaches after the state is saved or loaded
+     */
+    virtual void DetachCaches(bool flush) {
+        ClearAll(flush);
+    }
+
+    /// Puts back the caches kept aside by DetachCaches whose memory still has the same contents
+    virtual void ReattachCaches() {}
+
     /// Attempt to use a faster method to perform a display transfer with is_texture_copy = 0
     virtual bool AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) {
         return false;
@@ -51,6 +51,11 @@ public:
         return m_current_frame;
     }
 
+    /// Sets whether the next frame is shown, the ones hidden are neither presented nor limited
+    void SetFrameShown(bool shown) {
+        frame_shown = shown;
+    }
+
     VideoCore::RasterizerInterface* Rasterizer() const {
         return rasterizer.get();
     }
@@ -71,6 +76,7 @@ protected:
     std::unique_ptr<VideoCore::RasterizerInterface> rasterizer;
     f32 m_current_fps = 0.0f; ///< Current framerate, should be set by the renderer
     int m_current_frame = 0;  ///< Current frame, should be set by the renderer
+    bool frame_shown = true;  ///< Whether the frame being swapped is shown
 
 private:
     bool opengl_rasterizer_active = false;
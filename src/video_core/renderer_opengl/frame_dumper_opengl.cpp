@@ -6,10 +6,57 @@
 #include "core/frontend/emu_window.h"
 #include "core/frontend/scope_acquire_context.h"
 #include "video_core/renderer_opengl/frame_dumper_opengl.h"
+#include "video_core/renderer_opengl/gl_vars.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 
 namespace OpenGL {
 
+// Covers the viewport with a single triangle
+static const char yuv_vertex_shader[] = R"(
+void main() {
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Writes one byte of the YUV420P frame per fragment. The target is as wide as the frame and one
+// and a half times as tall, so that reading it back linearly yields the Y, U and V planes one
+// after another. Uses the BT.601 limited range coefficients which swscale defaults to.
+static const char yuv_fragment_shader[] = R"(
+layout(location = 0) out vec4 color;
+
+uniform sampler2D rgb_texture;
+
+vec3 Fetch(int x, int y) {
+    return texelFetch(rgb_texture, ivec2(x, y), 0).rgb;
+}
+
+void main() {
+    ivec2 size = textureSize(rgb_texture, 0);
+    int index = int(gl_FragCoord.y) * size.x + int(gl_FragCoord.x);
+    int luma_size = size.x * size.y;
+    float value;
+    if (index < luma_size) {
+        vec3 rgb = Fetch(index % size.x, index / size.x);
+        value = 16.0 + dot(rgb, vec3(65.481, 128.553, 24.966));
+    } else {
+        int chroma_width = size.x / 2;
+        int chroma_size = chroma_width * (size.y / 2);
+        int chroma_index = index - luma_size;
+        bool is_v = chroma_index >= chroma_size;
+        if (is_v) {
+            chroma_index -= chroma_size;
+        }
+        int x = (chroma_index % chroma_width) * 2;
+        int y = (chroma_index / chroma_width) * 2;
+        vec3 rgb = (Fetch(x, y) + Fetch(x + 1, y) + Fetch(x, y + 1) + Fetch(x + 1, y + 1)) * 0.25;
+        value = 128.0 + dot(rgb, is_v ? vec3(112.0, -93.786, -18.214)
+                                      : vec3(-37.797, -74.203, 112.0));
+    }
+    color = vec4(value / 255.0, 0.0, 0.0, 1.0);
+}
+)";
+
 FrameDumperOpenGL::FrameDumperOpenGL(VideoDumper::Backend& video_dumper_,
                                      Frontend::EmuWindow& emu_window)
     : video_dumper(video_dumper_), context(emu_window.CreateSharedContext()) {}
@@ -55,9 +102,14 @@ void FrameDumperOpenGL::PresentLoop() {
         }
         glWaitSync(frame->render_fence, 0, GL_TIMEOUT_IGNORED);
 
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, frame->present.handle);
         glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[current_pbo].handle);
-        glReadPixels(0, 0, layout.width, layout.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+        if (frame_format == VideoDumper::VideoFrame::Format::YUV420P) {
+            ReadPixelsYUV(frame->present, layout.width, layout.height);
+        } else {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, frame->present.handle);
+            glReadPixels(0, 0, layout.width, layout.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                         0);
+        }
 
         // Insert fence for the main thread to block on
         frame->present_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
@@ -66,7 +118,7 @@ void FrameDumperOpenGL::PresentLoop() {
         // Bind the previous PBO and read the pixels
         glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[next_pbo].handle);
         GLubyte* pixels = static_cast<GLubyte*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
-        VideoDumper::VideoFrame frame_data{layout.width, layout.height, pixels};
+        VideoDumper::VideoFrame frame_data{layout.width, layout.height, pixels, frame_format};
         video_dumper.AddVideoFrame(std::move(frame_data));
         glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
         glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
@@ -78,13 +130,61 @@ void FrameDumperOpenGL::PresentLoop() {
     CleanupOpenGLObjects();
 }
 
+void FrameDumperOpenGL::ReadPixelsYUV(const OGLFramebuffer& present, u32 width, u32 height) {
+    // The present frame only has a renderbuffer, copy it to a texture that can be sampled
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, present.handle);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, rgb_framebuffer.handle);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, yuv_framebuffer.handle);
+    glViewport(0, 0, width, height * 3 / 2);
+    glUseProgram(yuv_program.handle);
+    glBindVertexArray(yuv_vertex_array.handle);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, rgb_texture.handle);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, yuv_framebuffer.handle);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height * 3 / 2, GL_RED, GL_UNSIGNED_BYTE, 0);
+}
+
 void FrameDumperOpenGL::InitializeOpenGLObjects() {
     const auto& layout = GetLayout();
+
+    // Reading back a single channel is not guaranteed to work on GLES
+    frame_format = GLES ? VideoDumper::VideoFrame::Format::BGRA
+                        : video_dumper.GetVideoFrameFormat();
+    if (frame_format == VideoDumper::VideoFrame::Format::YUV420P) {
+        const auto create_target = [](OGLTexture& texture, OGLFramebuffer& framebuffer,
+                                      GLenum internal_format, u32 width, u32 height) {
+            texture.Create();
+            glBindTexture(GL_TEXTURE_2D, texture.handle);
+            glTexStorage2D(GL_TEXTURE_2D, 1, internal_format, width, height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            framebuffer.Create();
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.handle);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                   texture.handle, 0);
+        };
+        create_target(rgb_texture, rgb_framebuffer, GL_RGBA8, layout.width, layout.height);
+        create_target(yuv_texture, yuv_framebuffer, GL_R8, layout.width, layout.height * 3 / 2);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        yuv_program.Create(yuv_vertex_shader, yuv_fragment_shader);
+        glUseProgram(yuv_program.handle);
+        glUniform1i(glGetUniformLocation(yuv_program.handle, "rgb_texture"), 0);
+        yuv_vertex_array.Create();
+    }
+
+    const std::size_t frame_size =
+        VideoDumper::VideoFrame::GetSize(layout.width, layout.height, frame_format);
     for (auto& buffer : pbos) {
         buffer.Create();
         glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.handle);
-        glBufferData(GL_PIXEL_PACK_BUFFER, layout.width * layout.height * 4, nullptr,
-                     GL_STREAM_READ);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
         glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     }
 }
@@ -93,6 +193,12 @@ void FrameDumperOpenGL::CleanupOpenGLObjects() {
     for (auto& buffer : pbos) {
         buffer.Release();
     }
+    yuv_vertex_array.Release();
+    yuv_program.Release();
+    yuv_framebuffer.Release();
+    yuv_texture.Release();
+    rgb_framebuffer.Release();
+    rgb_texture.Release();
 }
 
 } // namespace OpenGL
@@ -43,6 +43,9 @@ private:
     void CleanupOpenGLObjects();
     void PresentLoop();
 
+    /// Converts the present framebuffer to YUV420P and reads it into the bound pack buffer
+    void ReadPixelsYUV(const OGLFramebuffer& present, u32 width, u32 height);
+
     VideoDumper::Backend& video_dumper;
     std::unique_ptr<Frontend::GraphicsContext> context;
     std::thread present_thread;
@@ -52,6 +55,15 @@ private:
     std::array<OGLBuffer, 2> pbos;
     GLuint current_pbo = 1;
     GLuint next_pbo = 0;
+
+    // Objects used to convert the frames on the GPU when the encoder takes YUV420P
+    VideoDumper::VideoFrame::Format frame_format{};
+    OGLTexture rgb_texture;
+    OGLFramebuffer rgb_framebuffer;
+    OGLTexture yuv_texture;
+    OGLFramebuffer yuv_framebuffer;
+    OGLProgram yuv_program;
+    OGLVertexArray yuv_vertex_array;
 };
 
 } // namespace OpenGL
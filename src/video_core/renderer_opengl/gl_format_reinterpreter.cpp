@@ -2,6 +2,9 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
+#include <string>
+#include <string_view>
 #include "common/assert.h"
 #include "common/scope_exit.h"
 #include "video_core/renderer_opengl/gl_format_reinterpreter.h"
@@ -220,11 +223,238 @@ private:
     GLint d24s8_abgr_viewport_u_id;
 };
 
+/**
+ * Reinterprets between any two formats with the same bits per pixel whose source can be sampled
+ * and whose destination can be drawn to. The source pixel is turned back into its bits in guest
+ * memory, which are then decoded as the destination format. Texture formats are decoded to RGBA8
+ * like the rasterizer cache does when loading them.
+ */
+class ShaderReinterpreter final : public FormatReinterpreterBase {
+public:
+    ShaderReinterpreter(PixelFormat src_format, PixelFormat dst_format)
+        : src_format(src_format), dst_format(dst_format) {}
+
+    static bool CanReadFrom(PixelFormat format) {
+        switch (format) {
+        case PixelFormat::RGB8:
+        case PixelFormat::RGB5A1:
+        case PixelFormat::RGB565:
+        case PixelFormat::RGBA4:
+        case PixelFormat::D16:
+        case PixelFormat::D24:
+            return true;
+        default:
+            // Stencil can't be sampled, D24S8 is read back through a buffer instead
+            return false;
+        }
+    }
+
+    static bool CanWriteTo(PixelFormat format) {
+        switch (format) {
+        case PixelFormat::RGB8:
+        case PixelFormat::RGB5A1:
+        case PixelFormat::RGB565:
+        case PixelFormat::RGBA4:
+        case PixelFormat::IA8:
+        case PixelFormat::RG8:
+        case PixelFormat::D16:
+        case PixelFormat::D24:
+            return true;
+        default:
+            // Writing stencil from a shader needs ARB_shader_stencil_export
+            return false;
+        }
+    }
+
+    void Reinterpret(GLuint src_tex, const Common::Rectangle<u32>& src_rect, GLuint read_fb_handle,
+                     GLuint dst_tex, const Common::Rectangle<u32>& dst_rect,
+                     GLuint draw_fb_handle) override {
+        if (program.handle == 0) {
+            CreateProgram();
+        }
+
+        OpenGLState prev_state = OpenGLState::GetCurState();
+        SCOPE_EXIT({ prev_state.Apply(); });
+
+        const bool depth_dst = SurfaceParams::GetFormatType(dst_format) == SurfaceType::Depth;
+        OpenGLState state;
+        state.texture_units[0].texture_2d = src_tex;
+        state.draw.draw_framebuffer = draw_fb_handle;
+        state.draw.shader_program = program.handle;
+        state.draw.vertex_array = vao.handle;
+        state.viewport = {static_cast<GLint>(dst_rect.left), static_cast<GLint>(dst_rect.bottom),
+                          static_cast<GLsizei>(dst_rect.GetWidth()),
+                          static_cast<GLsizei>(dst_rect.GetHeight())};
+        if (depth_dst) {
+            state.depth.test_enabled = true;
+            state.depth.test_func = GL_ALWAYS;
+            state.depth.write_mask = GL_TRUE;
+        }
+        state.Apply();
+
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                               depth_dst ? 0 : dst_tex, 0);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0,
+                               0);
+        if (depth_dst) {
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                                   dst_tex, 0);
+        }
+
+        glUniform4i(src_rect_loc, src_rect.left, src_rect.bottom, src_rect.GetWidth(),
+                    src_rect.GetHeight());
+        glUniform4i(dst_rect_loc, dst_rect.left, dst_rect.bottom, dst_rect.GetWidth(),
+                    dst_rect.GetHeight());
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+        if (depth_dst) {
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        }
+    }
+
+private:
+    using SurfaceType = SurfaceParams::SurfaceType;
+
+    /// Returns the GLSL that stores the bits of the source texel in raw
+    static std::string_view GetReadCode(PixelFormat format) {
+        switch (format) {
+        case PixelFormat::RGB8:
+            return R"(
+    uvec3 c = uvec3(round(texel.rgb * 255.0));
+    raw = (c.r << 16) | (c.g << 8) | c.b;)";
+        case PixelFormat::RGB5A1:
+            return R"(
+    uvec4 c = uvec4(round(texel * vec4(31.0, 31.0, 31.0, 1.0)));
+    raw = (c.r << 11) | (c.g << 6) | (c.b << 1) | c.a;)";
+        case PixelFormat::RGB565:
+            return R"(
+    uvec3 c = uvec3(round(texel.rgb * vec3(31.0, 63.0, 31.0)));
+    raw = (c.r << 11) | (c.g << 5) | c.b;)";
+        case PixelFormat::RGBA4:
+            return R"(
+    uvec4 c = uvec4(round(texel * 15.0));
+    raw = (c.r << 12) | (c.g << 8) | (c.b << 4) | c.a;)";
+        case PixelFormat::D16:
+            return R"(
+    raw = uint(round(texel.r * 65535.0));)";
+        case PixelFormat::D24:
+            return R"(
+    raw = uint(round(texel.r * 16777215.0));)";
+        default:
+            UNREACHABLE();
+            return {};
+        }
+    }
+
+    /// Returns the GLSL that writes the destination pixel holding the bits in raw
+    static std::string_view GetWriteCode(PixelFormat format) {
+        switch (format) {
+        case PixelFormat::RGB8:
+            return R"(
+    frag_color = vec4(vec3((uvec3(raw) >> uvec3(16, 8, 0)) & 0xFFu) / 255.0, 1.0);)";
+        case PixelFormat::RGB5A1:
+            return R"(
+    frag_color = vec4((uvec4(raw) >> uvec4(11, 6, 1, 0)) & uvec4(0x1Fu, 0x1Fu, 0x1Fu, 1u)) /
+                 vec4(31.0, 31.0, 31.0, 1.0);)";
+        case PixelFormat::RGB565:
+            return R"(
+    frag_color = vec4(vec3((uvec3(raw) >> uvec3(11, 5, 0)) & uvec3(0x1Fu, 0x3Fu, 0x1Fu)) /
+                      vec3(31.0, 63.0, 31.0), 1.0);)";
+        case PixelFormat::RGBA4:
+            return R"(
+    frag_color = vec4((uvec4(raw) >> uvec4(12, 8, 4, 0)) & 0xFu) / 15.0;)";
+        case PixelFormat::IA8:
+            return R"(
+    float intensity = float((raw >> 8) & 0xFFu) / 255.0;
+    frag_color = vec4(vec3(intensity), float(raw & 0xFFu) / 255.0);)";
+        case PixelFormat::RG8:
+            return R"(
+    frag_color = vec4(float((raw >> 8) & 0xFFu) / 255.0, float(raw & 0xFFu) / 255.0, 0.0, 1.0);)";
+        case PixelFormat::D16:
+            return R"(
+    gl_FragDepth = float(raw) / 65535.0;)";
+        case PixelFormat::D24:
+            return R"(
+    gl_FragDepth = float(raw) / 16777215.0;)";
+        default:
+            UNREACHABLE();
+            return {};
+        }
+    }
+
+    /// Compiled on first use, most pairs never show up in a given title
+    void CreateProgram() {
+        constexpr std::string_view vs_source = R"(
+const vec2 vertices[4] =
+    vec2[4](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0), vec2(1.0, 1.0));
+
+void main() {
+    gl_Position = vec4(vertices[gl_VertexID], 0.0, 1.0);
+}
+)";
+
+        std::string fs_source = R"(
+#ifdef CITRA_GLES
+precision highp float;
+precision highp int;
+precision highp sampler2D;
+#endif
+
+out vec4 frag_color;
+
+uniform sampler2D source;
+// x, y, width, height
+uniform ivec4 src_rect;
+uniform ivec4 dst_rect;
+
+void main() {
+    ivec2 dst_coord = ivec2(gl_FragCoord.xy) - dst_rect.xy;
+    // The surfaces may be at different resolution scales
+    ivec2 src_coord = src_rect.xy + dst_coord * src_rect.zw / dst_rect.zw;
+    vec4 texel = texelFetch(source, src_coord, 0);
+    uint raw;)";
+        fs_source += GetReadCode(src_format);
+        fs_source += GetWriteCode(dst_format);
+        fs_source += "\n}\n";
+
+        program.Create(vs_source.data(), fs_source.c_str());
+        src_rect_loc = glGetUniformLocation(program.handle, "src_rect");
+        dst_rect_loc = glGetUniformLocation(program.handle, "dst_rect");
+        vao.Create();
+    }
+
+    PixelFormat src_format;
+    PixelFormat dst_format;
+    OGLProgram program;
+    GLint src_rect_loc{-1}, dst_rect_loc{-1};
+    OGLVertexArray vao;
+};
+
 FormatReinterpreterOpenGL::FormatReinterpreterOpenGL() {
     reinterpreters.emplace(PixelFormatPair{PixelFormat::RGBA8, PixelFormat::D24S8},
                            std::make_unique<PixelBufferD24S8toABGR>());
     reinterpreters.emplace(PixelFormatPair{PixelFormat::RGB5A1, PixelFormat::RGBA4},
                            std::make_unique<RGBA4toRGB5A1>());
+
+    static constexpr std::array<PixelFormat, 8> formats{
+        PixelFormat::RGB8, PixelFormat::RGB5A1, PixelFormat::RGB565, PixelFormat::RGBA4,
+        PixelFormat::IA8,  PixelFormat::RG8,    PixelFormat::D16,    PixelFormat::D24,
+    };
+    for (const PixelFormat src_format : formats) {
+        if (!ShaderReinterpreter::CanReadFrom(src_format)) {
+            continue;
+        }
+        for (const PixelFormat dst_format : formats) {
+            if (src_format == dst_format || !ShaderReinterpreter::CanWriteTo(dst_format) ||
+                SurfaceParams::GetFormatBpp(src_format) !=
+                    SurfaceParams::GetFormatBpp(dst_format)) {
+                continue;
+            }
+            // Keeps the dedicated reinterpreters added above
+            reinterpreters.emplace(PixelFormatPair{dst_format, src_format},
+                                   std::make_unique<ShaderReinterpreter>(src_format, dst_format));
+        }
+    }
 }
 
 FormatReinterpreterOpenGL::~FormatReinterpreterOpenGL() = default;
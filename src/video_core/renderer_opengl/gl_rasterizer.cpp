@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <glad/glad.h>
@@ -15,7 +16,10 @@
 #include "common/microprofile.h"
 #include "common/scope_exit.h"
 #include "common/vector_math.h"
+#include "core/frontend/emu_window.h"
 #include "core/hw/gpu.h"
+#include "core/perf_stats.h"
+#include "core/settings.h"
 #include "video_core/pica_state.h"
 #include "video_core/regs_framebuffer.h"
 #include "video_core/regs_rasterizer.h"
@@ -48,7 +52,7 @@ static bool IsVendorIntel() {
     return gpu_vendor == "Intel Inc.";
 }
 
-RasterizerOpenGL::RasterizerOpenGL()
+RasterizerOpenGL::RasterizerOpenGL(Frontend::EmuWindow& emu_window)
     : is_amd(IsVendorAmd()), vertex_buffer(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE, is_amd),
       uniform_buffer(GL_UNIFORM_BUFFER, UNIFORM_BUFFER_SIZE, false),
       index_buffer(GL_ELEMENT_ARRAY_BUFFER, INDEX_BUFFER_SIZE, false),
@@ -87,6 +91,8 @@ RasterizerOpenGL::RasterizerOpenGL()
     hw_vao.Create();
 
     uniform_block_data.dirty = true;
+    uniform_block_data.vs_uniforms_dirty = true;
+    uniform_block_data.gs_uniforms_dirty = true;
 
     uniform_block_data.lighting_lut_dirty.fill(true);
     uniform_block_data.lighting_lut_dirty_any = true;
@@ -102,6 +108,8 @@ RasterizerOpenGL::RasterizerOpenGL()
     glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
     uniform_size_aligned_vs =
         Common::AlignUp<std::size_t>(sizeof(VSUniformData), uniform_buffer_alignment);
+    uniform_size_aligned_gs =
+        Common::AlignUp<std::size_t>(sizeof(GSUniformData), uniform_buffer_alignment);
     uniform_size_aligned_fs =
         Common::AlignUp<std::size_t>(sizeof(UniformData), uniform_buffer_alignment);
 
@@ -158,6 +166,7 @@ RasterizerOpenGL::RasterizerOpenGL()
     state.draw.vertex_array = hw_vao.handle;
     state.Apply();
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer.GetHandle());
+    hw_vao_index_buffer = index_buffer.GetHandle();
 
 #ifdef __APPLE__
     if (IsVendorIntel()) {
@@ -173,6 +182,28 @@ RasterizerOpenGL::RasterizerOpenGL()
         std::make_unique<ShaderProgramManager>(GLAD_GL_ARB_separate_shader_objects, is_amd);
 #endif
 
+    if (Settings::values.async_shader_compilation) {
+        if (auto context = emu_window.CreateSharedContext()) {
+            shader_program_manager->EnableAsyncCompilation(std::move(context));
+        } else {
+            LOG_WARNING(Render_OpenGL, "Asynchronous shader compilation needs a shared context");
+        }
+    }
+
+    // Building the disk shader cache is spread over extra contexts, the calling thread being one
+    // of the workers. Frontends that cannot share contexts simply load it on the calling thread.
+    if (VideoCore::g_hw_shader_enabled && VideoCore::g_use_disk_shader_cache) {
+        const u32 num_workers =
+            std::min(std::max(std::thread::hardware_concurrency(), 2U), MAX_SHADER_WORKERS) - 1;
+        for (u32 i = 0; i < num_workers; ++i) {
+            auto context = emu_window.CreateSharedContext();
+            if (!context) {
+                break;
+            }
+            shader_worker_contexts.push_back(std::move(context));
+        }
+    }
+
     glEnable(GL_BLEND);
 
     SyncEntireState();
@@ -182,7 +213,7 @@ RasterizerOpenGL::~RasterizerOpenGL() = default;
 
 void RasterizerOpenGL::LoadDiskResources(const std::atomic_bool& stop_loading,
                                          const VideoCore::DiskResourceLoadCallback& callback) {
-    shader_program_manager->LoadDiskCache(stop_loading, callback);
+    shader_program_manager->LoadDiskCache(stop_loading, callback, shader_worker_contexts);
 }
 
 void RasterizerOpenGL::SyncEntireState() {
@@ -225,6 +256,9 @@ void RasterizerOpenGL::SyncEntireState() {
     SyncProcTexBias();
     SyncShadowBias();
     SyncShadowTextureBias();
+
+    uniform_block_data.vs_uniforms_dirty = true;
+    uniform_block_data.gs_uniforms_dirty = true;
 }
 
 /**
@@ -258,6 +292,40 @@ void RasterizerOpenGL::AddTriangle(const Pica::Shader::OutputVertex& v0,
     vertex_batch.emplace_back(v0, false);
     vertex_batch.emplace_back(v1, AreQuaternionsOpposite(v0.quat, v1.quat));
     vertex_batch.emplace_back(v2, AreQuaternionsOpposite(v0.quat, v2.quat));
+
+    // Triangles are queued across PICA draws, so keep the queue within one vertex buffer
+    if (vertex_batch.size() * sizeof(HardwareVertex) >= VERTEX_BUFFER_SIZE) {
+        DrawTriangles();
+    }
+}
+
+void RasterizerOpenGL::AddTriangles(const Pica::Shader::OutputVertex* vertices,
+                                    std::size_t num_triangles) {
+    // Number of queued triangles at which AddTriangle draws the queue
+    constexpr std::size_t triangle_size = 3 * sizeof(HardwareVertex);
+    constexpr std::size_t max_batch_triangles =
+        (VERTEX_BUFFER_SIZE + triangle_size - 1) / triangle_size;
+
+    while (num_triangles != 0) {
+        // The vertices are converted in place at the end of the queue
+        const std::size_t count =
+            std::min(num_triangles, max_batch_triangles - vertex_batch.size() / 3);
+        std::size_t index = vertex_batch.size();
+        vertex_batch.resize(index + 3 * count);
+        for (std::size_t i = 0; i < count; ++i, vertices += 3) {
+            const auto& v0 = vertices[0];
+            const auto& v1 = vertices[1];
+            const auto& v2 = vertices[2];
+            vertex_batch[index++] = HardwareVertex(v0, false);
+            vertex_batch[index++] = HardwareVertex(v1, AreQuaternionsOpposite(v0.quat, v1.quat));
+            vertex_batch[index++] = HardwareVertex(v2, AreQuaternionsOpposite(v0.quat, v2.quat));
+        }
+        num_triangles -= count;
+
+        if (vertex_batch.size() * sizeof(HardwareVertex) >= VERTEX_BUFFER_SIZE) {
+            DrawTriangles();
+        }
+    }
 }
 
 static constexpr std::array<GLenum, 4> vs_attrib_types{
@@ -279,6 +347,7 @@ RasterizerOpenGL::VertexArrayInfo RasterizerOpenGL::AnalyzeVertexArray(bool is_i
 
     u32 vertex_min;
     u32 vertex_max;
+    VertexBufferCache::Entry* index_entry = nullptr;
     if (is_indexed) {
         const auto& index_info = regs.pipeline.index_array;
         const PAddr address = vertex_attributes.GetPhysicalBaseAddress() + index_info.offset;
@@ -286,14 +355,26 @@ RasterizerOpenGL::VertexArrayInfo RasterizerOpenGL::AnalyzeVertexArray(bool is_i
         const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
         const bool index_u16 = index_info.format != 0;
 
-        vertex_min = 0xFFFF;
-        vertex_max = 0;
         const u32 size = regs.pipeline.num_vertices * (index_u16 ? 2 : 1);
-        res_cache.FlushRegion(address, size, nullptr);
-        for (u32 index = 0; index < regs.pipeline.num_vertices; ++index) {
-            const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
-            vertex_min = std::min(vertex_min, vertex);
-            vertex_max = std::max(vertex_max, vertex);
+        index_entry = GetCachedVertexData(address, size);
+        if (index_entry != nullptr && index_entry->has_index_range) {
+            vertex_min = index_entry->min_index;
+            vertex_max = index_entry->max_index;
+        } else {
+            vertex_min = 0xFFFF;
+            vertex_max = 0;
+            for (u32 index = 0; index < regs.pipeline.num_vertices; ++index) {
+                const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+                vertex_min = std::min(vertex_min, vertex);
+                vertex_max = std::max(vertex_max, vertex);
+            }
+            if (index_entry != nullptr) {
+                // The same region is always read with the same index format, as its size
+                // would differ otherwise
+                index_entry->has_index_range = true;
+                index_entry->min_index = vertex_min;
+                index_entry->max_index = vertex_max;
+            }
         }
     } else {
         vertex_min = regs.pipeline.vertex_offset;
@@ -308,11 +389,21 @@ RasterizerOpenGL::VertexArrayInfo RasterizerOpenGL::AnalyzeVertexArray(bool is_i
         }
     }
 
-    return {vertex_min, vertex_max, vs_input_size};
+    return {vertex_min, vertex_max, vs_input_size, index_entry != nullptr};
 }
 
-void RasterizerOpenGL::SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
-                                        GLuint vs_input_index_min, GLuint vs_input_index_max) {
+VertexBufferCache::Entry* RasterizerOpenGL::GetCachedVertexData(PAddr addr, u32 size) {
+    // Surfaces holding newer data, e.g. rendered vertices, make the old copy outdated
+    if (res_cache.IsRegionDirty(addr, size)) {
+        res_cache.FlushRegion(addr, size, nullptr);
+        vertex_buffer_cache.InvalidateRegion(addr, size);
+    }
+    return vertex_buffer_cache.Get(addr, size);
+}
+
+std::size_t RasterizerOpenGL::SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
+                                               GLuint vs_input_index_min,
+                                               GLuint vs_input_index_max) {
     MICROPROFILE_SCOPE(OpenGL_VAO);
     const auto& regs = Pica::g_state.regs;
     const auto& vertex_attributes = regs.pipeline.vertex_attributes;
@@ -323,12 +414,34 @@ void RasterizerOpenGL::SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
     state.Apply();
 
     std::array<bool, 16> enable_attributes{};
+    std::size_t streamed_size = 0;
 
     for (const auto& loader : vertex_attributes.attribute_loaders) {
         if (loader.component_count == 0 || loader.byte_count == 0) {
             continue;
         }
 
+        PAddr data_addr =
+            base_address + loader.data_offset + (vs_input_index_min * loader.byte_count);
+
+        u32 vertex_num = vs_input_index_max - vs_input_index_min + 1;
+        u32 data_size = loader.byte_count * vertex_num;
+
+        // Static data is read from its own copy, the rest is streamed
+        GLintptr loader_offset = 0;
+        if (const auto* entry = GetCachedVertexData(data_addr, data_size)) {
+            state.draw.vertex_buffer = entry->buffer.handle;
+        } else {
+            std::memcpy(array_ptr, VideoCore::g_memory->GetPhysicalPointer(data_addr), data_size);
+            state.draw.vertex_buffer = vertex_buffer.GetHandle();
+            loader_offset = buffer_offset;
+
+            array_ptr += data_size;
+            buffer_offset += data_size;
+            streamed_size += data_size;
+        }
+        state.Apply();
+
         u32 offset = 0;
         for (u32 comp = 0; comp < loader.component_count && comp < 12; ++comp) {
             u32 attribute_index = loader.GetComponent(comp);
@@ -343,7 +456,7 @@ void RasterizerOpenGL::SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
                         vertex_attributes.GetFormat(attribute_index))];
                     GLsizei stride = loader.byte_count;
                     glVertexAttribPointer(input_reg, size, type, GL_FALSE, stride,
-                                          reinterpret_cast<GLvoid*>(buffer_offset + offset));
+                                          reinterpret_cast<GLvoid*>(loader_offset + offset));
                     enable_attributes[input_reg] = true;
 
                     offset += vertex_attributes.GetStride(attribute_index);
@@ -355,20 +468,11 @@ void RasterizerOpenGL::SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
                 offset += (attribute_index - 11) * 4;
             }
         }
-
-        PAddr data_addr =
-            base_address + loader.data_offset + (vs_input_index_min * loader.byte_count);
-
-        u32 vertex_num = vs_input_index_max - vs_input_index_min + 1;
-        u32 data_size = loader.byte_count * vertex_num;
-
-        res_cache.FlushRegion(data_addr, data_size, nullptr);
-        std::memcpy(array_ptr, VideoCore::g_memory->GetPhysicalPointer(data_addr), data_size);
-
-        array_ptr += data_size;
-        buffer_offset += data_size;
     }
 
+    state.draw.vertex_buffer = vertex_buffer.GetHandle();
+    state.Apply();
+
     for (std::size_t i = 0; i < enable_attributes.size(); ++i) {
         if (enable_attributes[i] != hw_vao_enabled_attributes[i]) {
             if (enable_attributes[i]) {
@@ -400,16 +504,22 @@ bool RasterizerOpenGL::SetupGeometryShader() {
     MICROPROFILE_SCOPE(OpenGL_GS);
     const auto& regs = Pica::g_state.regs;
 
-    if (regs.pipeline.use_gs != Pica::PipelineRegs::UseGS::No) {
-        LOG_ERROR(Render_OpenGL, "Accelerate draw doesn't support geometry shader");
-        return false;
+    if (regs.pipeline.use_gs == Pica::PipelineRegs::UseGS::No) {
+        shader_program_manager->UseFixedGeometryShader(regs);
+        return true;
     }
 
-    shader_program_manager->UseFixedGeometryShader(regs);
-    return true;
+    // Only programs taking their inputs straight from the vertex shader outputs are translated
+    if (regs.pipeline.variable_primitive != 0 || regs.gs.input_to_uniform != 0) {
+        return false;
+    }
+    return shader_program_manager->UseProgrammableGeometryShader(regs, Pica::g_state.gs);
 }
 
 bool RasterizerOpenGL::AccelerateDrawBatch(bool is_indexed) {
+    // Queued triangles come first
+    DrawTriangles();
+
     const auto& regs = Pica::g_state.regs;
     if (regs.pipeline.use_gs != Pica::PipelineRegs::UseGS::No) {
         if (regs.pipeline.gs_config.mode != Pica::PipelineRegs::GSMode::Point) {
@@ -429,8 +539,31 @@ bool RasterizerOpenGL::AccelerateDrawBatch(bool is_indexed) {
     return Draw(true, is_indexed);
 }
 
+/// Returns the primitive each geometry shader invocation consumes, see GenerateGeometryShader
+static GLenum GetGeometryShaderInputMode(const Pica::Regs& regs) {
+    const u32 num_inputs = regs.gs.max_input_attribute_index + 1;
+    const u32 attributes_per_vertex = regs.pipeline.vs_outmap_total_minus_1_a + 1;
+    switch (num_inputs / attributes_per_vertex) {
+    case 1:
+        return GL_POINTS;
+    case 2:
+        return GL_LINES;
+    case 3:
+        return GL_TRIANGLES;
+    case 4:
+        return GL_LINES_ADJACENCY;
+    case 6:
+        return GL_TRIANGLES_ADJACENCY;
+    default:
+        UNREACHABLE();
+    }
+}
+
 static GLenum GetCurrentPrimitiveMode() {
     const auto& regs = Pica::g_state.regs;
+    if (regs.pipeline.use_gs != Pica::PipelineRegs::UseGS::No) {
+        return GetGeometryShaderInputMode(regs);
+    }
     switch (regs.pipeline.triangle_topology) {
     case Pica::PipelineRegs::TriangleTopology::Shader:
     case Pica::PipelineRegs::TriangleTopology::List:
@@ -448,7 +581,8 @@ bool RasterizerOpenGL::AccelerateDrawBatchInternal(bool is_indexed) {
     const auto& regs = Pica::g_state.regs;
     GLenum primitive_mode = GetCurrentPrimitiveMode();
 
-    auto [vs_input_index_min, vs_input_index_max, vs_input_size] = AnalyzeVertexArray(is_indexed);
+    auto [vs_input_index_min, vs_input_index_max, vs_input_size, index_cached] =
+        AnalyzeVertexArray(is_indexed);
 
     if (vs_input_size > VERTEX_BUFFER_SIZE) {
         LOG_WARNING(Render_OpenGL, "Too large vertex input size {}", vs_input_size);
@@ -461,8 +595,9 @@ bool RasterizerOpenGL::AccelerateDrawBatchInternal(bool is_indexed) {
     u8* buffer_ptr;
     GLintptr buffer_offset;
     std::tie(buffer_ptr, buffer_offset, std::ignore) = vertex_buffer.Map(vs_input_size, 4);
-    SetupVertexArray(buffer_ptr, buffer_offset, vs_input_index_min, vs_input_index_max);
-    vertex_buffer.Unmap(vs_input_size);
+    const std::size_t streamed_size =
+        SetupVertexArray(buffer_ptr, buffer_offset, vs_input_index_min, vs_input_index_max);
+    vertex_buffer.Unmap(streamed_size);
 
     shader_program_manager->ApplyTo(state);
     state.Apply();
@@ -476,12 +611,29 @@ bool RasterizerOpenGL::AccelerateDrawBatchInternal(bool is_indexed) {
             return false;
         }
 
-        const u8* index_data = VideoCore::g_memory->GetPhysicalPointer(
-            regs.pipeline.vertex_attributes.GetPhysicalBaseAddress() +
-            regs.pipeline.index_array.offset);
-        std::tie(buffer_ptr, buffer_offset, std::ignore) = index_buffer.Map(index_buffer_size, 4);
-        std::memcpy(buffer_ptr, index_data, index_buffer_size);
-        index_buffer.Unmap(index_buffer_size);
+        const PAddr index_address = regs.pipeline.vertex_attributes.GetPhysicalBaseAddress() +
+                                    regs.pipeline.index_array.offset;
+        // Looked up again as setting up the vertex array may have invalidated the copy
+        const auto* index_entry =
+            index_cached ? vertex_buffer_cache.Find(index_address,
+                                                    static_cast<u32>(index_buffer_size))
+                         : nullptr;
+        const GLuint index_buffer_handle =
+            index_entry != nullptr ? index_entry->buffer.handle : index_buffer.GetHandle();
+        if (index_buffer_handle != hw_vao_index_buffer) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_handle);
+            hw_vao_index_buffer = index_buffer_handle;
+        }
+
+        if (index_entry != nullptr) {
+            buffer_offset = 0;
+        } else {
+            const u8* index_data = VideoCore::g_memory->GetPhysicalPointer(index_address);
+            std::tie(buffer_ptr, buffer_offset, std::ignore) =
+                index_buffer.Map(index_buffer_size, 4);
+            std::memcpy(buffer_ptr, index_data, index_buffer_size);
+            index_buffer.Unmap(index_buffer_size);
+        }
 
         glDrawRangeElementsBaseVertex(
             primitive_mode, vs_input_index_min, vs_input_index_max, regs.pipeline.num_vertices,
@@ -501,6 +653,7 @@ void RasterizerOpenGL::DrawTriangles() {
 
 bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
     MICROPROFILE_SCOPE(OpenGL_Drawing);
+    Core::ScopedPerfSubsystem rasterizer_time{Core::PerfSubsystem::Rasterizer};
     const auto& regs = Pica::g_state.regs;
 
     bool shadow_rendering = regs.framebuffer.output_merger.fragment_operation_mode ==
@@ -772,20 +925,25 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
     }
 
     OGLTexture temp_tex;
+    SCOPE_EXIT({
+        if (temp_tex.handle != 0) {
+            const FormatTuple& tuple = GetFormatTuple(color_surface->pixel_format);
+            res_cache.texture_pool.Release(std::move(temp_tex), tuple.internal_format,
+                                           tuple.format, tuple.type,
+                                           color_surface->GetScaledWidth(),
+                                           color_surface->GetScaledHeight(),
+                                           color_surface->max_level + 1);
+        }
+    });
     if (need_duplicate_texture) {
         // The game is trying to use a surface as a texture and framebuffer at the same time
         // which causes unpredictable behavior on the host.
         // Making a copy to sample from eliminates this issue and seems to be fairly cheap.
-        temp_tex.Create();
-        glBindTexture(GL_TEXTURE_2D, temp_tex.handle);
         auto [internal_format, format, type] = GetFormatTuple(color_surface->pixel_format);
-        OGLTexture::Allocate(GL_TEXTURE_2D, color_surface->max_level + 1, internal_format, format,
-                             type, color_surface->GetScaledWidth(),
-                             color_surface->GetScaledHeight());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glBindTexture(GL_TEXTURE_2D, state.texture_units[0].texture_2d);
+        temp_tex = res_cache.texture_pool.Acquire(internal_format, format, type,
+                                                  color_surface->GetScaledWidth(),
+                                                  color_surface->GetScaledHeight(),
+                                                  color_surface->max_level + 1);
 
         for (std::size_t level{0}; level <= color_surface->max_level; ++level) {
             glCopyImageSubData(color_surface->texture.handle, GL_TEXTURE_2D, level, 0, 0, 0,
@@ -809,7 +967,8 @@ bool RasterizerOpenGL::Draw(bool accelerate, bool is_indexed) {
     }
 
     // Sync and bind the shader
-    if (shader_dirty) {
+    // Keep checking on the fragment shader while it is being built in the background
+    if (shader_dirty || shader_program_manager->IsUsingUberFragmentShader()) {
         SetShader();
         shader_dirty = false;
     }
@@ -938,6 +1097,10 @@ void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
     // Blending
     case PICA_REG_INDEX(framebuffer.output_merger.alphablend_enable):
         SyncBlendEnabled();
+        // The fragment shaders apply the logic ops on GLES
+        if (GLES) {
+            shader_dirty = true;
+        }
         break;
     case PICA_REG_INDEX(framebuffer.output_merger.alpha_blending):
         SyncBlendFuncs();
@@ -1058,6 +1221,9 @@ void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
     // Logic op
     case PICA_REG_INDEX(framebuffer.output_merger.logic_op):
         SyncLogicOp();
+        if (GLES) {
+            shader_dirty = true;
+        }
         break;
 
     case PICA_REG_INDEX(texturing.main_config):
@@ -1388,36 +1554,90 @@ void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
         uniform_block_data.lighting_lut_dirty_any = true;
         break;
     }
+
+    // Vertex shader uniforms
+    case PICA_REG_INDEX(vs.bool_uniforms):
+    case PICA_REG_INDEX(vs.int_uniforms[0]):
+    case PICA_REG_INDEX(vs.int_uniforms[1]):
+    case PICA_REG_INDEX(vs.int_uniforms[2]):
+    case PICA_REG_INDEX(vs.int_uniforms[3]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[0]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[1]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[2]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[3]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[4]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[5]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[6]):
+    case PICA_REG_INDEX(vs.uniform_setup.set_value[7]):
+        uniform_block_data.vs_uniforms_dirty = true;
+        break;
+
+    // Geometry shader uniforms
+    case PICA_REG_INDEX(gs.bool_uniforms):
+    case PICA_REG_INDEX(gs.int_uniforms[0]):
+    case PICA_REG_INDEX(gs.int_uniforms[1]):
+    case PICA_REG_INDEX(gs.int_uniforms[2]):
+    case PICA_REG_INDEX(gs.int_uniforms[3]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[0]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[1]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[2]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[3]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[4]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[5]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[6]):
+    case PICA_REG_INDEX(gs.uniform_setup.set_value[7]):
+        uniform_block_data.gs_uniforms_dirty = true;
+        break;
     }
 }
 
 void RasterizerOpenGL::FlushAll() {
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
+    DrawTriangles();
     res_cache.FlushAll();
 }
 
 void RasterizerOpenGL::FlushRegion(PAddr addr, u32 size) {
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
+    DrawTriangles();
     res_cache.FlushRegion(addr, size);
 }
 
 void RasterizerOpenGL::InvalidateRegion(PAddr addr, u32 size) {
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
+    DrawTriangles();
     res_cache.InvalidateRegion(addr, size, nullptr);
+    vertex_buffer_cache.InvalidateRegion(addr, size);
 }
 
 void RasterizerOpenGL::FlushAndInvalidateRegion(PAddr addr, u32 size) {
     MICROPROFILE_SCOPE(OpenGL_CacheManagement);
+    DrawTriangles();
     res_cache.FlushRegion(addr, size);
     res_cache.InvalidateRegion(addr, size, nullptr);
+    vertex_buffer_cache.InvalidateRegion(addr, size);
 }
 
 void RasterizerOpenGL::ClearAll(bool flush) {
+    DrawTriangles();
+    // Unmarks the pages of the copies before the surface cache unmarks every page
+    vertex_buffer_cache.Clear();
     res_cache.ClearAll(flush);
 }
 
+void RasterizerOpenGL::DetachCaches(bool flush) {
+    DrawTriangles();
+    vertex_buffer_cache.Clear();
+    res_cache.DetachSurfaces(flush);
+}
+
+void RasterizerOpenGL::ReattachCaches() {
+    res_cache.ReattachSurfaces();
+}
+
 bool RasterizerOpenGL::AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) {
     MICROPROFILE_SCOPE(OpenGL_Blits);
+    DrawTriangles();
 
     SurfaceParams src_params;
     src_params.addr = config.GetPhysicalInputAddress();
@@ -1464,10 +1684,12 @@ bool RasterizerOpenGL::AccelerateDisplayTransfer(const GPU::Regs::DisplayTransfe
         return false;
 
     res_cache.InvalidateRegion(dst_params.addr, dst_params.size, dst_surface);
+    res_cache.StartFlushRegion(dst_params.addr, dst_params.size);
     return true;
 }
 
 bool RasterizerOpenGL::AccelerateTextureCopy(const GPU::Regs::DisplayTransferConfig& config) {
+    DrawTriangles();
     u32 copy_size = Common::AlignDown(config.texture_copy.size, 16);
     if (copy_size == 0) {
         return false;
@@ -1553,6 +1775,7 @@ bool RasterizerOpenGL::AccelerateTextureCopy(const GPU::Regs::DisplayTransferCon
 }
 
 bool RasterizerOpenGL::AccelerateFill(const GPU::Regs::MemoryFillConfig& config) {
+    DrawTriangles();
     Surface dst_surface = res_cache.GetFillSurface(config);
     if (dst_surface == nullptr)
         return false;
@@ -1564,6 +1787,7 @@ bool RasterizerOpenGL::AccelerateFill(const GPU::Regs::MemoryFillConfig& config)
 bool RasterizerOpenGL::AccelerateDisplay(const GPU::Regs::FramebufferConfig& config,
                                          PAddr framebuffer_addr, u32 pixel_stride,
                                          ScreenInfo& screen_info) {
+    DrawTriangles();
     if (framebuffer_addr == 0) {
         return false;
     }
@@ -1596,6 +1820,9 @@ bool RasterizerOpenGL::AccelerateDisplay(const GPU::Regs::FramebufferConfig& con
 
     screen_info.display_texture = src_surface->texture.handle;
 
+    // The framebuffer is final once it is displayed, start its readback if it is usually needed
+    res_cache.StartFlushRegion(framebuffer_addr, src_params.size);
+
     return true;
 }
 
@@ -2155,18 +2382,24 @@ void RasterizerOpenGL::SyncAndUploadLUTs() {
 }
 
 void RasterizerOpenGL::UploadUniforms(bool accelerate_draw) {
+    // The blocks bound by earlier draws stay valid until the stream buffer wraps around, so only
+    // the ones that changed since are uploaded again
+    const bool use_gs = accelerate_draw &&
+                        Pica::g_state.regs.pipeline.use_gs != Pica::PipelineRegs::UseGS::No;
+    bool sync_vs = accelerate_draw && uniform_block_data.vs_uniforms_dirty;
+    bool sync_gs = use_gs && uniform_block_data.gs_uniforms_dirty;
+    bool sync_fs = uniform_block_data.dirty;
+
+    if (!sync_vs && !sync_gs && !sync_fs)
+        return;
+
     // glBindBufferRange below also changes the generic buffer binding point, so we sync the state
     // first
     state.draw.uniform_buffer = uniform_buffer.GetHandle();
     state.Apply();
 
-    bool sync_vs = accelerate_draw;
-    bool sync_fs = uniform_block_data.dirty;
-
-    if (!sync_vs && !sync_fs)
-        return;
-
-    std::size_t uniform_size = uniform_size_aligned_vs + uniform_size_aligned_fs;
+    std::size_t uniform_size =
+        uniform_size_aligned_vs + uniform_size_aligned_gs + uniform_size_aligned_fs;
     std::size_t used_bytes = 0;
     u8* uniforms;
     GLintptr offset;
@@ -2174,16 +2407,36 @@ void RasterizerOpenGL::UploadUniforms(bool accelerate_draw) {
     std::tie(uniforms, offset, invalidate) =
         uniform_buffer.Map(uniform_size, uniform_buffer_alignment);
 
+    if (invalidate) {
+        // The previous contents of the buffer are gone
+        uniform_block_data.vs_uniforms_dirty = true;
+        uniform_block_data.gs_uniforms_dirty = true;
+        sync_vs = accelerate_draw;
+        sync_gs = use_gs;
+        sync_fs = true;
+    }
+
     if (sync_vs) {
         VSUniformData vs_uniforms;
         vs_uniforms.uniforms.SetFromRegs(Pica::g_state.regs.vs, Pica::g_state.vs);
         std::memcpy(uniforms + used_bytes, &vs_uniforms, sizeof(vs_uniforms));
         glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBindings::VS),
                           uniform_buffer.GetHandle(), offset + used_bytes, sizeof(VSUniformData));
+        uniform_block_data.vs_uniforms_dirty = false;
         used_bytes += uniform_size_aligned_vs;
     }
 
-    if (sync_fs || invalidate) {
+    if (sync_gs) {
+        GSUniformData gs_uniforms;
+        gs_uniforms.uniforms.SetFromRegs(Pica::g_state.regs.gs, Pica::g_state.gs);
+        std::memcpy(uniforms + used_bytes, &gs_uniforms, sizeof(gs_uniforms));
+        glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBindings::GS),
+                          uniform_buffer.GetHandle(), offset + used_bytes, sizeof(GSUniformData));
+        uniform_block_data.gs_uniforms_dirty = false;
+        used_bytes += uniform_size_aligned_gs;
+    }
+
+    if (sync_fs) {
         std::memcpy(uniforms + used_bytes, &uniform_block_data.data, sizeof(UniformData));
         glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBindings::Common),
                           uniform_buffer.GetHandle(), offset + used_bytes, sizeof(UniformData));
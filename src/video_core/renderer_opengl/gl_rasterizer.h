@@ -26,11 +26,13 @@
 #include "video_core/renderer_opengl/gl_shader_manager.h"
 #include "video_core/renderer_opengl/gl_state.h"
 #include "video_core/renderer_opengl/gl_stream_buffer.h"
+#include "video_core/renderer_opengl/gl_vertex_buffer_cache.h"
 #include "video_core/renderer_opengl/pica_to_gl.h"
 #include "video_core/shader/shader.h"
 
 namespace Frontend {
 class EmuWindow;
+class GraphicsContext;
 }
 
 namespace OpenGL {
@@ -38,7 +40,7 @@ class ShaderProgramManager;
 
 class RasterizerOpenGL : public VideoCore::RasterizerInterface {
 public:
-    explicit RasterizerOpenGL();
+    explicit RasterizerOpenGL(Frontend::EmuWindow& emu_window);
     ~RasterizerOpenGL() override;
 
     void LoadDiskResources(const std::atomic_bool& stop_loading,
@@ -46,6 +48,8 @@ public:
 
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
+    void AddTriangles(const Pica::Shader::OutputVertex* vertices,
+                      std::size_t num_triangles) override;
     void DrawTriangles() override;
     void NotifyPicaRegisterChanged(u32 id) override;
     void FlushAll() override;
@@ -53,6 +57,8 @@ public:
     void InvalidateRegion(PAddr addr, u32 size) override;
     void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
     void ClearAll(bool flush) override;
+    void DetachCaches(bool flush) override;
+    void ReattachCaches() override;
     bool AccelerateDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config) override;
     bool AccelerateTextureCopy(const GPU::Regs::DisplayTransferConfig& config) override;
     bool AccelerateFill(const GPU::Regs::MemoryFillConfig& config) override;
@@ -247,14 +253,19 @@ private:
         u32 vs_input_index_min;
         u32 vs_input_index_max;
         u32 vs_input_size;
+        /// Whether the index data has a static copy
+        bool index_cached;
     };
 
     /// Retrieve the range and the size of the input vertex
     VertexArrayInfo AnalyzeVertexArray(bool is_indexed);
 
-    /// Setup vertex array for AccelerateDrawBatch
-    void SetupVertexArray(u8* array_ptr, GLintptr buffer_offset, GLuint vs_input_index_min,
-                          GLuint vs_input_index_max);
+    /// Setup vertex array for AccelerateDrawBatch, returns the number of bytes streamed
+    std::size_t SetupVertexArray(u8* array_ptr, GLintptr buffer_offset,
+                                 GLuint vs_input_index_min, GLuint vs_input_index_max);
+
+    /// Flushes the region and returns its static copy, nullptr if it has to be streamed
+    VertexBufferCache::Entry* GetCachedVertexData(PAddr addr, u32 size);
 
     /// Setup vertex shader for AccelerateDrawBatch
     bool SetupVertexShader();
@@ -268,6 +279,7 @@ private:
     GLuint default_texture;
 
     RasterizerCacheOpenGL res_cache;
+    VertexBufferCache vertex_buffer_cache{res_cache};
 
     std::vector<HardwareVertex> vertex_batch;
 
@@ -284,19 +296,30 @@ private:
         bool proctex_lut_dirty;
         bool proctex_diff_lut_dirty;
         bool dirty;
+        /// Set when the vertex shader uniforms change through register writes
+        bool vs_uniforms_dirty;
+        /// Set when the geometry shader uniforms change through register writes
+        bool gs_uniforms_dirty;
     } uniform_block_data = {};
 
     std::unique_ptr<ShaderProgramManager> shader_program_manager;
 
+    /// Contexts shared with the main one, used to build the disk shader cache on worker threads
+    std::vector<std::unique_ptr<Frontend::GraphicsContext>> shader_worker_contexts;
+
     // They shall be big enough for about one frame.
     static constexpr std::size_t VERTEX_BUFFER_SIZE = 16 * 1024 * 1024;
     static constexpr std::size_t INDEX_BUFFER_SIZE = 1 * 1024 * 1024;
     static constexpr std::size_t UNIFORM_BUFFER_SIZE = 2 * 1024 * 1024;
     static constexpr std::size_t TEXTURE_BUFFER_SIZE = 1 * 1024 * 1024;
 
+    /// Maximum number of threads building the disk shader cache, including the loading thread
+    static constexpr u32 MAX_SHADER_WORKERS = 4;
+
     OGLVertexArray sw_vao; // VAO for software shader draw
     OGLVertexArray hw_vao; // VAO for hardware shader / accelerate draw
     std::array<bool, 16> hw_vao_enabled_attributes{};
+    GLuint hw_vao_index_buffer = 0;
 
     std::array<SamplerInfo, 3> texture_samplers;
     OGLStreamBuffer vertex_buffer;
@@ -306,6 +329,7 @@ private:
     OGLFramebuffer framebuffer;
     GLint uniform_buffer_alignment;
     std::size_t uniform_size_aligned_vs;
+    std::size_t uniform_size_aligned_gs;
     std::size_t uniform_size_aligned_fs;
 
     SamplerInfo texture_cube_sampler;
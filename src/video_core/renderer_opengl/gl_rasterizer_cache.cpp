@@ -13,19 +13,26 @@
 #include <unordered_set>
 #include <utility>
 #include <vector>
+#include <boost/functional/hash.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <glad/glad.h>
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
 #include "common/alignment.h"
 #include "common/bit_field.h"
 #include "common/color.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/microprofile.h"
 #include "common/scope_exit.h"
+#include "common/task_scheduler.h"
 #include "common/texture.h"
 #include "common/vector_math.h"
 #include "core/core.h"
 #include "core/custom_tex_cache.h"
+#include "core/hw/gpu.h"
 #include "core/frontend/emu_window.h"
 #include "core/hle/kernel/process.h"
 #include "core/memory.h"
@@ -34,7 +41,9 @@
 #include "video_core/renderer_base.h"
 #include "video_core/renderer_opengl/gl_format_reinterpreter.h"
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
+#include "video_core/renderer_opengl/gl_resolution_controller.h"
 #include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_texture_decoder.h"
 #include "video_core/renderer_opengl/gl_vars.h"
 #include "video_core/renderer_opengl/texture_filters/texture_filterer.h"
 #include "video_core/utils.h"
@@ -203,6 +212,90 @@ static void MortonCopyTile(u32 stride, u8* tile_buffer, u8* gl_buffer) {
     }
 }
 
+#ifdef ARCHITECTURE_x86_64
+/// Moves the stencil byte of each packed GL D24S8 value behind its depth bytes
+static inline __m128i RepackD24S8(__m128i v) {
+    return _mm_or_si128(_mm_srli_epi32(v, 8), _mm_slli_epi32(v, 24));
+}
+#endif
+
+/**
+ * Encodes an 8x8 tile from the GL buffer. Morton order keeps each 2x2 block contiguous (two pixels
+ * of an even row followed by the same two pixels of the row below it), so the tile is written one
+ * row pair at a time instead of one pixel at a time.
+ */
+template <PixelFormat format>
+static void EncodeMortonTile(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
+    constexpr u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(format);
+    if constexpr (gl_bytes_per_pixel != bytes_per_pixel) {
+        // D24 is padded to 32 bits in the GL buffer, so there is nothing contiguous to copy
+        MortonCopyTile<false, format>(stride, tile_buffer, gl_buffer);
+        return;
+    }
+
+    const u32 row_size = stride * gl_bytes_per_pixel;
+    for (u32 y = 0; y < 8; y += 2) {
+        const u8* row0 = gl_buffer + (7 - y) * row_size;
+        const u8* row1 = row0 - row_size;
+        u8* out = tile_buffer + VideoCore::MortonInterleave(0, y) * bytes_per_pixel;
+#ifdef ARCHITECTURE_x86_64
+        if constexpr (bytes_per_pixel == 4) {
+            // Blocks x = 0 and 2 are adjacent in the tile, as are x = 4 and 6
+            for (u32 x = 0; x < 8; x += 4) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 4));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 4));
+                __m128i lo = _mm_unpacklo_epi64(a, b);
+                __m128i hi = _mm_unpackhi_epi64(a, b);
+                if constexpr (format == PixelFormat::D24S8) {
+                    lo = RepackD24S8(lo);
+                    hi = RepackD24S8(hi);
+                }
+                u8* block = out + VideoCore::MortonInterleave(x, 0) * 4;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(block), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(block + 16), hi);
+            }
+            continue;
+        } else if constexpr (bytes_per_pixel == 2) {
+            // A whole row is one vector, and each half of a row pair lands in 16 contiguous bytes
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi32(a, b));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(out + VideoCore::MortonInterleave(4, 0) * 2),
+                _mm_unpackhi_epi32(a, b));
+            continue;
+        }
+#endif
+        for (u32 x = 0; x < 8; x += 2) {
+            u8* block = out + VideoCore::MortonInterleave(x, 0) * bytes_per_pixel;
+            std::memcpy(block, row0 + x * bytes_per_pixel, 2 * bytes_per_pixel);
+            std::memcpy(block + 2 * bytes_per_pixel, row1 + x * bytes_per_pixel,
+                        2 * bytes_per_pixel);
+            if constexpr (format == PixelFormat::D24S8) {
+                for (u32 i = 0; i < 4; ++i) {
+                    u32 value;
+                    std::memcpy(&value, block + i * 4, sizeof(u32));
+                    value = (value >> 8) | (value << 24);
+                    std::memcpy(block + i * 4, &value, sizeof(u32));
+                }
+            }
+        }
+    }
+}
+
+template <bool morton_to_gl, PixelFormat format>
+static void CopyTile(u32 stride, u8* tile_buffer, u8* gl_buffer) {
+    if constexpr (morton_to_gl) {
+        MortonCopyTile<true, format>(stride, tile_buffer, gl_buffer);
+    } else {
+        EncodeMortonTile<format>(stride, tile_buffer, gl_buffer);
+    }
+}
+
+/// Flushes with at least this many whole tiles are encoded across the task scheduler's workers
+constexpr u32 MIN_PARALLEL_ENCODE_TILES = 256;
+
 template <bool morton_to_gl, PixelFormat format>
 static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr start, PAddr end) {
     constexpr u32 bytes_per_pixel = SurfaceParams::GetFormatBpp(format) / 8;
@@ -211,6 +304,7 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
     constexpr u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(format);
     static_assert(gl_bytes_per_pixel >= bytes_per_pixel, "");
     gl_buffer += gl_bytes_per_pixel - bytes_per_pixel;
+    u8* const gl_buffer_base = gl_buffer;
 
     const PAddr aligned_down_start = base + Common::AlignDown(start - base, tile_size);
     const PAddr aligned_start = base + Common::AlignUp(start - base, tile_size);
@@ -237,7 +331,7 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
 
     if (start < aligned_start && !morton_to_gl) {
         std::array<u8, tile_size> tmp_buf;
-        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
+        CopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
         std::memcpy(tile_buffer, &tmp_buf[start - aligned_down_start],
                     std::min(aligned_start, end) - start);
 
@@ -247,6 +341,38 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
 
     const u8* const buffer_end = tile_buffer + aligned_end - aligned_start;
     PAddr current_paddr = aligned_start;
+
+    if constexpr (!morton_to_gl) {
+        // Every tile's GL position follows from its index, so large flushes are split into ranges
+        // of tiles. The same bounds checks as below apply, just to the whole range at once
+        const u32 num_tiles = static_cast<u32>(buffer_end - tile_buffer) / tile_size;
+        if (num_tiles >= MIN_PARALLEL_ENCODE_TILES &&
+            VideoCore::g_memory->IsValidPhysicalAddress(aligned_start) &&
+            VideoCore::g_memory->IsValidPhysicalAddress(aligned_end)) {
+            const u32 first_tile = (aligned_start - base) / tile_size;
+            const auto tile_gl_buffer = [&](u32 tile) {
+                const u32 tile_x = (tile % (stride / 8)) * 8;
+                const u32 tile_y = (tile / (stride / 8)) * 8;
+                return gl_buffer_base +
+                       ((height - 8 - tile_y) * stride + tile_x) * gl_bytes_per_pixel;
+            };
+            u8* const tiles = tile_buffer;
+            Common::TaskScheduler::GetInstance().ParallelFor(
+                num_tiles, MIN_PARALLEL_ENCODE_TILES / 4, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        const u32 tile = static_cast<u32>(i);
+                        EncodeMortonTile<format>(stride, tiles + tile * tile_size,
+                                                 tile_gl_buffer(first_tile + tile));
+                    }
+                });
+            tile_buffer += num_tiles * tile_size;
+            current_paddr += num_tiles * tile_size;
+            if (end > aligned_end) {
+                gl_buffer = tile_gl_buffer(first_tile + num_tiles);
+            }
+        }
+    }
+
     while (tile_buffer < buffer_end) {
         // Pokemon Super Mystery Dungeon will try to use textures that go beyond
         // the end address of VRAM. Stop reading if reaches invalid address
@@ -255,7 +381,7 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
             LOG_ERROR(Render_OpenGL, "Out of bound texture");
             break;
         }
-        MortonCopyTile<morton_to_gl, format>(stride, tile_buffer, gl_buffer);
+        CopyTile<morton_to_gl, format>(stride, tile_buffer, gl_buffer);
         tile_buffer += tile_size;
         current_paddr += tile_size;
         glbuf_next_tile();
@@ -263,7 +389,7 @@ static void MortonCopy(u32 stride, u32 height, u8* gl_buffer, PAddr base, PAddr
 
     if (end > std::max(aligned_start, aligned_end) && !morton_to_gl) {
         std::array<u8, tile_size> tmp_buf;
-        MortonCopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
+        CopyTile<morton_to_gl, format>(stride, &tmp_buf[0], gl_buffer);
         std::memcpy(tile_buffer, &tmp_buf[0], end - aligned_end);
     }
 }
@@ -334,6 +460,67 @@ static void AllocateSurfaceTexture(GLuint texture, const FormatTuple& format_tup
     cur_state.Apply();
 }
 
+/// Returns the GL format of a compressed custom texture format, or 0 if the driver lacks it
+static GLenum GetCompressedFormat(Core::CustomTexFormat format) {
+    switch (format) {
+    case Core::CustomTexFormat::BC1:
+        return GLAD_GL_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : 0;
+    case Core::CustomTexFormat::BC3:
+        return GLAD_GL_EXT_texture_compression_s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+    case Core::CustomTexFormat::BC7:
+        return GLAD_GL_ARB_texture_compression_bptc || GLAD_GL_EXT_texture_compression_bptc
+                   ? GL_COMPRESSED_RGBA_BPTC_UNORM_ARB
+                   : 0;
+    case Core::CustomTexFormat::ETC2:
+        return GLES || GLAD_GL_ARB_ES3_compatibility ? GL_COMPRESSED_RGBA8_ETC2_EAC : 0;
+    case Core::CustomTexFormat::ASTC4x4:
+        return GLAD_GL_KHR_texture_compression_astc_ldr ? GL_COMPRESSED_RGBA_ASTC_4x4_KHR : 0;
+    case Core::CustomTexFormat::ASTC6x6:
+        return GLAD_GL_KHR_texture_compression_astc_ldr ? GL_COMPRESSED_RGBA_ASTC_6x6_KHR : 0;
+    case Core::CustomTexFormat::ASTC8x8:
+        return GLAD_GL_KHR_texture_compression_astc_ldr ? GL_COMPRESSED_RGBA_ASTC_8x8_KHR : 0;
+    default:
+        return 0;
+    }
+}
+
+/// Replace the storage of the texture with the block compressed custom texture
+static void AllocateCompressedTexture(GLuint texture, const Core::CustomTexInfo& tex_info) {
+    OpenGLState cur_state = OpenGLState::GetCurState();
+
+    // Keep track of previous texture bindings
+    GLuint old_tex = cur_state.texture_units[0].texture_2d;
+    cur_state.texture_units[0].texture_2d = texture;
+    cur_state.Apply();
+    glActiveTexture(GL_TEXTURE0);
+
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, GetCompressedFormat(tex_info.format), tex_info.width,
+                           tex_info.height, 0, static_cast<GLsizei>(tex_info.tex.size()),
+                           tex_info.tex.data());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Restore previous texture bindings
+    cur_state.texture_units[0].texture_2d = old_tex;
+    cur_state.Apply();
+}
+
+/// Get a texture of appropriate size and format for the surface from the pool, uninitialized
+static OGLTexture AcquireSurfaceTexture(TexturePool& pool, const FormatTuple& format_tuple,
+                                        u32 width, u32 height) {
+    return pool.Acquire(format_tuple.internal_format, format_tuple.format, format_tuple.type,
+                        width, height);
+}
+
+static void ReleaseSurfaceTexture(TexturePool& pool, OGLTexture&& texture,
+                                  const FormatTuple& format_tuple, u32 width, u32 height) {
+    pool.Release(std::move(texture), format_tuple.internal_format, format_tuple.format,
+                 format_tuple.type, width, height);
+}
+
 static void AllocateTextureCube(GLuint texture, const FormatTuple& format_tuple, u32 width) {
     OpenGLState cur_state = OpenGLState::GetCurState();
 
@@ -569,6 +756,24 @@ void RasterizerCacheOpenGL::CopySurface(const Surface& src_surface, const Surfac
     UNREACHABLE();
 }
 
+CachedSurface::~CachedSurface() {
+    // Custom textures and mipmaps respecify the texture, it no longer matches the surface params
+    if (!is_custom && max_level == 0) {
+        ReleaseSurfaceTexture(owner.texture_pool, std::move(texture),
+                              GetFormatTuple(pixel_format), GetScaledWidth(), GetScaledHeight());
+    }
+}
+
+bool CachedSurface::CanConvertOnGPU() const {
+    // Dumping and replacing textures hash the decoded data, so they need it on the CPU
+    return is_tiled && owner.texture_decoder != nullptr &&
+           Settings::values.use_gpu_texture_decoding && !Settings::values.dump_textures &&
+           !Settings::values.custom_textures &&
+           TextureDecoderOpenGL::IsFormatSupported(pixel_format) &&
+           VideoCore::g_memory->IsValidPhysicalAddress(addr) &&
+           VideoCore::g_memory->IsValidPhysicalAddress(end - 1);
+}
+
 MICROPROFILE_DEFINE(OpenGL_SurfaceLoad, "OpenGL", "Surface Load", MP_RGB(128, 192, 64));
 void CachedSurface::LoadGLBuffer(PAddr load_start, PAddr load_end) {
     ASSERT(type != SurfaceType::Fill);
@@ -579,10 +784,6 @@ void CachedSurface::LoadGLBuffer(PAddr load_start, PAddr load_end) {
     if (texture_src_data == nullptr)
         return;
 
-    if (gl_buffer.empty()) {
-        gl_buffer.resize(width * height * GetGLBytesPerPixel(pixel_format));
-    }
-
     // TODO: Should probably be done in ::Memory:: and check for other regions too
     if (load_start < Memory::VRAM_VADDR_END && load_end > Memory::VRAM_VADDR_END)
         load_end = Memory::VRAM_VADDR_END;
@@ -595,6 +796,17 @@ void CachedSurface::LoadGLBuffer(PAddr load_start, PAddr load_end) {
     ASSERT(load_start >= addr && load_end <= end);
     const u32 start_offset = load_start - addr;
 
+    if (CanConvertOnGPU()) {
+        owner.texture_decoder->Decode(*this, texture_src_data + start_offset, load_start,
+                                      load_end);
+        gl_buffer_on_gpu = true;
+        return;
+    }
+
+    if (gl_buffer.empty()) {
+        gl_buffer.resize(width * height * GetGLBytesPerPixel(pixel_format));
+    }
+
     if (!is_tiled) {
         ASSERT(type == SurfaceType::Color);
         if (need_swap) {
@@ -631,12 +843,29 @@ void CachedSurface::LoadGLBuffer(PAddr load_start, PAddr load_end) {
             const auto rect = GetSubRect(FromInterval(load_interval));
             ASSERT(FromInterval(load_interval).GetInterval() == load_interval);
 
-            for (unsigned y = rect.bottom; y < rect.top; ++y) {
-                for (unsigned x = rect.left; x < rect.right; ++x) {
-                    auto vec4 =
-                        Pica::Texture::LookupTexture(texture_src_data, x, height - 1 - y, tex_info);
-                    const std::size_t offset = (x + (width * y)) * 4;
-                    std::memcpy(&gl_buffer[offset], vec4.AsArray(), 4);
+            // Decode whole tiles at once and copy the rows that fall inside the rectangle. Rows
+            // of the rectangle are flipped vertically relative to the texture.
+            const u32 tile_size =
+                static_cast<u32>(Pica::Texture::CalculateTileSize(tex_info.format));
+            const u32 texel_begin_y = height - rect.top;
+            const u32 texel_end_y = height - rect.bottom;
+            std::array<Common::Vec4<u8>, 8 * 8> tile_texels;
+            for (u32 tile_y = texel_begin_y / 8 * 8; tile_y < texel_end_y; tile_y += 8) {
+                for (u32 tile_x = rect.left / 8 * 8; tile_x < rect.right; tile_x += 8) {
+                    const u8* tile_data = texture_src_data + (tile_y / 8) * tex_info.stride +
+                                          (tile_x / 8) * tile_size;
+                    Pica::Texture::DecodeTile(tile_data, tex_info, tile_texels.data());
+
+                    const u32 begin_x = std::max<u32>(tile_x, rect.left);
+                    const u32 end_x = std::min<u32>(tile_x + 8, rect.right);
+                    const u32 begin_y = std::max(tile_y, texel_begin_y);
+                    const u32 end_y = std::min(tile_y + 8, texel_end_y);
+                    for (u32 y = begin_y; y < end_y; ++y) {
+                        const std::size_t offset = (begin_x + width * (height - 1 - y)) * 4;
+                        std::memcpy(&gl_buffer[offset],
+                                    &tile_texels[(y - tile_y) * 8 + begin_x - tile_x],
+                                    (end_x - begin_x) * 4);
+                    }
                 }
             }
         } else {
@@ -652,7 +881,8 @@ void CachedSurface::FlushGLBuffer(PAddr flush_start, PAddr flush_end) {
     if (dst_buffer == nullptr)
         return;
 
-    ASSERT(gl_buffer.size() == width * height * GetGLBytesPerPixel(pixel_format));
+    ASSERT(gl_buffer_on_gpu ||
+           gl_buffer.size() == width * height * GetGLBytesPerPixel(pixel_format));
 
     // TODO: Should probably be done in ::Memory:: and check for other regions too
     // same as loadglbuffer()
@@ -668,7 +898,11 @@ void CachedSurface::FlushGLBuffer(PAddr flush_start, PAddr flush_end) {
     const u32 start_offset = flush_start - addr;
     const u32 end_offset = flush_end - addr;
 
-    if (type == SurfaceType::Fill) {
+    if (gl_buffer_on_gpu) {
+        // DownloadGLTexture left the pixels in the texture decoder
+        owner.texture_decoder->Encode(*this, dst_buffer, flush_start, flush_end);
+        gl_buffer_on_gpu = false;
+    } else if (type == SurfaceType::Fill) {
         const u32 coarse_start_offset = start_offset - (start_offset % fill_size);
         const u32 backup_bytes = start_offset % fill_size;
         std::array<u8, 4> backup_data;
@@ -693,10 +927,16 @@ void CachedSurface::FlushGLBuffer(PAddr flush_start, PAddr flush_end) {
 
 bool CachedSurface::LoadCustomTexture(u64 tex_hash) {
     auto& custom_tex_cache = Core::System::GetInstance().CustomTexCache();
-    const auto& image_interface = Core::System::GetInstance().GetImageInterface();
 
-    if (custom_tex_cache.IsTextureCached(tex_hash)) {
-        custom_tex_info = custom_tex_cache.LookupTexture(tex_hash);
+    if (custom_tex_cache.LookupTexture(tex_hash, custom_tex_info)) {
+        // Scaled surfaces are filled by blitting the custom texture, compressed ones can't be read
+        // by a framebuffer
+        if (custom_tex_info.format != Core::CustomTexFormat::RGBA8 &&
+            (res_scale != 1 || GetCompressedFormat(custom_tex_info.format) == 0)) {
+            LOG_DEBUG(Render_OpenGL, "Not using compressed custom texture {:016X}", tex_hash);
+            custom_tex_info.tex = {};
+            return false;
+        }
         return true;
     }
 
@@ -704,25 +944,14 @@ bool CachedSurface::LoadCustomTexture(u64 tex_hash) {
         return false;
     }
 
-    const auto& path_info = custom_tex_cache.LookupTexturePathInfo(tex_hash);
-    if (!image_interface->DecodePNG(custom_tex_info.tex, custom_tex_info.width,
-                                    custom_tex_info.height, path_info.path)) {
-        LOG_ERROR(Render_OpenGL, "Failed to load custom texture {}", path_info.path);
-        return false;
-    }
-
-    const std::bitset<32> width_bits(custom_tex_info.width);
-    const std::bitset<32> height_bits(custom_tex_info.height);
-    if (width_bits.count() != 1 || height_bits.count() != 1) {
-        LOG_ERROR(Render_OpenGL, "Texture {} size is not a power of 2", path_info.path);
-        return false;
+    // The surface shows the texture from guest memory until the custom one has been decoded, it
+    // is loaded again then
+    if (type == SurfaceType::Texture &&
+        custom_tex_cache.RequestTexture(tex_hash,
+                                        Core::System::GetInstance().GetImageInterface())) {
+        owner.pending_custom_surfaces[tex_hash].push_back(weak_from_this());
     }
-
-    LOG_DEBUG(Render_OpenGL, "Loaded custom texture from {}", path_info.path);
-    Common::FlipRGBA8Texture(custom_tex_info.tex, custom_tex_info.width, custom_tex_info.height);
-    custom_tex_cache.CacheTexture(tex_hash, custom_tex_info.tex, custom_tex_info.width,
-                                  custom_tex_info.height);
-    return true;
+    return false;
 }
 
 void CachedSurface::DumpTexture(GLuint target_tex, u64 tex_hash) {
@@ -736,23 +965,9 @@ void CachedSurface::DumpTexture(GLuint target_tex, u64 tex_hash) {
         return;
     }
 
-    // Dump texture to RGBA8 and encode as PNG
-    const auto& image_interface = Core::System::GetInstance().GetImageInterface();
+    // Dump texture to RGBA8, the PNG is encoded by the custom texture cache's workers
     auto& custom_tex_cache = Core::System::GetInstance().CustomTexCache();
-    std::string dump_path =
-        fmt::format("{}textures/{:016X}/", FileUtil::GetUserPath(FileUtil::UserPath::DumpDir),
-                    Core::System::GetInstance().Kernel().GetCurrentProcess()->codeset->program_id);
-    if (!FileUtil::CreateFullPath(dump_path)) {
-        LOG_ERROR(Render, "Unable to create {}", dump_path);
-        return;
-    }
-
-    dump_path += fmt::format("tex1_{}x{}_{:016X}_{}.png", width, height, tex_hash,
-                             static_cast<u32>(pixel_format));
-    if (!custom_tex_cache.IsTextureDumped(tex_hash) && !FileUtil::Exists(dump_path)) {
-        custom_tex_cache.SetTextureDumped(tex_hash);
-
-        LOG_INFO(Render_OpenGL, "Dumping texture to {}", dump_path);
+    if (!custom_tex_cache.IsTextureDumped(tex_hash)) {
         std::vector<u8> decoded_texture;
         decoded_texture.resize(width * height * 4);
         glBindTexture(GL_TEXTURE_2D, target_tex);
@@ -772,9 +987,11 @@ void CachedSurface::DumpTexture(GLuint target_tex, u64 tex_hash) {
         GetTexImageOES(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, height, width, 0,
                        &decoded_texture[0], decoded_texture.size());
         glBindTexture(GL_TEXTURE_2D, 0);
-        Common::FlipRGBA8Texture(decoded_texture, width, height);
-        if (!image_interface->EncodePNG(dump_path, decoded_texture, width, height))
-            LOG_ERROR(Render_OpenGL, "Failed to save decoded texture");
+        custom_tex_cache.DumpTexture(tex_hash,
+                                     fmt::format("tex1_{}x{}_{:016X}_{}.png", width, height,
+                                                 tex_hash, static_cast<u32>(pixel_format)),
+                                     std::move(decoded_texture), width, height,
+                                     Core::System::GetInstance().GetImageInterface());
     }
 }
 
@@ -786,17 +1003,24 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
 
     MICROPROFILE_SCOPE(OpenGL_TextureUL);
 
-    ASSERT(gl_buffer.size() == width * height * GetGLBytesPerPixel(pixel_format));
+    ASSERT(gl_buffer_on_gpu ||
+           gl_buffer.size() == width * height * GetGLBytesPerPixel(pixel_format));
 
     u64 tex_hash = 0;
 
-    if (Settings::values.dump_textures || Settings::values.custom_textures) {
+    if (!gl_buffer_on_gpu && (Settings::values.dump_textures || Settings::values.custom_textures)) {
         tex_hash = Common::ComputeHash64(gl_buffer.data(), gl_buffer.size());
     }
 
-    if (Settings::values.custom_textures) {
+    const bool was_custom = is_custom;
+    if (!gl_buffer_on_gpu && Settings::values.custom_textures) {
         is_custom = LoadCustomTexture(tex_hash);
     }
+    if (was_custom && !is_custom && res_scale == 1) {
+        // The texture has the size and format of the custom texture that was loaded before
+        AllocateSurfaceTexture(texture.handle, GetFormatTuple(pixel_format), width, height);
+        max_level = 0;
+    }
 
     // Load data from memory to the surface
     GLint x0 = static_cast<GLint>(rect.left);
@@ -808,21 +1032,27 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
 
     // If not 1x scale, create 1x texture that we will blit from to replace texture subrect in
     // surface
+    const FormatTuple& unscaled_tuple = is_custom ? GetFormatTuple(PixelFormat::RGBA8) : tuple;
+    const u32 unscaled_width = is_custom ? custom_tex_info.width : rect.GetWidth();
+    const u32 unscaled_height = is_custom ? custom_tex_info.height : rect.GetHeight();
     OGLTexture unscaled_tex;
+    SCOPE_EXIT({
+        ReleaseSurfaceTexture(owner.texture_pool, std::move(unscaled_tex), unscaled_tuple,
+                              unscaled_width, unscaled_height);
+    });
     if (res_scale != 1) {
         x0 = 0;
         y0 = 0;
 
-        unscaled_tex.Create();
-        if (is_custom) {
-            AllocateSurfaceTexture(unscaled_tex.handle, GetFormatTuple(PixelFormat::RGBA8),
-                                   custom_tex_info.width, custom_tex_info.height);
-        } else {
-            AllocateSurfaceTexture(unscaled_tex.handle, tuple, rect.GetWidth(), rect.GetHeight());
-        }
+        unscaled_tex = AcquireSurfaceTexture(owner.texture_pool, unscaled_tuple, unscaled_width,
+                                             unscaled_height);
         target_tex = unscaled_tex.handle;
     }
 
+    // Source and destination of the filter queued for the upload, if any
+    std::optional<std::pair<Common::Rectangle<u32>, Common::Rectangle<u32>>> queued_filter_rects;
+    u64 filter_hash = 0;
+
     OpenGLState cur_state = OpenGLState::GetCurState();
 
     GLuint old_tex = cur_state.texture_units[0].texture_2d;
@@ -831,7 +1061,12 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
 
     // Ensure no bad interactions with GL_UNPACK_ALIGNMENT
     ASSERT(stride * GetGLBytesPerPixel(pixel_format) % 4 == 0);
-    if (is_custom) {
+    if (is_custom && custom_tex_info.format != Core::CustomTexFormat::RGBA8) {
+        // Only unscaled surfaces use compressed custom textures
+        AllocateCompressedTexture(texture.handle, custom_tex_info);
+        max_level = 0;
+        custom_tex_info.tex = {};
+    } else if (is_custom) {
         if (res_scale == 1) {
             AllocateSurfaceTexture(texture.handle, GetFormatTuple(PixelFormat::RGBA8),
                                    custom_tex_info.width, custom_tex_info.height);
@@ -844,14 +1079,29 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
         glActiveTexture(GL_TEXTURE0);
         glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, custom_tex_info.width, custom_tex_info.height,
                         GL_RGBA, GL_UNSIGNED_BYTE, custom_tex_info.tex.data());
+        // Only the size is needed from here on, the pixels stay in the custom texture cache
+        custom_tex_info.tex = {};
     } else {
         glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(stride));
 
+        // The decoded pixels are either in gl_buffer or in the texture decoder's host buffer
+        const GLvoid* pixels = nullptr;
+        if (gl_buffer_on_gpu) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, owner.texture_decoder->GetHostBuffer());
+            pixels = reinterpret_cast<const GLvoid*>(buffer_offset);
+        } else {
+            pixels = &gl_buffer[buffer_offset];
+        }
+
         glActiveTexture(GL_TEXTURE0);
         glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, static_cast<GLsizei>(rect.GetWidth()),
-                        static_cast<GLsizei>(rect.GetHeight()), tuple.format, tuple.type,
-                        &gl_buffer[buffer_offset]);
+                        static_cast<GLsizei>(rect.GetHeight()), tuple.format, tuple.type, pixels);
+
+        if (gl_buffer_on_gpu) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
     }
+    gl_buffer_on_gpu = false;
 
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     if (Settings::values.dump_textures && !is_custom)
@@ -869,31 +1119,111 @@ void CachedSurface::UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_
         auto from_rect =
             is_custom ? Common::Rectangle<u32>{0, custom_tex_info.height, custom_tex_info.width, 0}
                       : Common::Rectangle<u32>{0, rect.GetHeight(), rect.GetWidth(), 0};
-        if (!owner.texture_filterer->Filter(unscaled_tex.handle, from_rect, texture.handle,
-                                            scaled_rect, type, read_fb_handle, draw_fb_handle)) {
+        TextureFilterer& filterer = *owner.texture_filterer;
+        if (!is_custom && filterer.CanFilter(type) &&
+            VideoCore::g_memory->IsValidPhysicalAddress(addr) &&
+            VideoCore::g_memory->IsValidPhysicalAddress(end - 1)) {
+            // The filtered copy only depends on the guest data and which part of it was loaded
+            std::size_t hash = Common::ComputeHash64(
+                VideoCore::g_memory->GetPhysicalPointer(addr), size);
+            boost::hash_combine(hash, pixel_format);
+            boost::hash_combine(hash, rect.left);
+            boost::hash_combine(hash, rect.bottom);
+            filter_hash = hash;
+            if (!filterer.FilterCached(filter_hash, from_rect, texture.handle, scaled_rect,
+                                       read_fb_handle, draw_fb_handle)) {
+                // The surface is drawn unfiltered until the queued filter has run
+                BlitTextures(unscaled_tex.handle, from_rect, texture.handle, scaled_rect, type,
+                             read_fb_handle, draw_fb_handle);
+                queued_filter_rects = {from_rect, scaled_rect};
+            }
+        } else if (!filterer.Filter(unscaled_tex.handle, from_rect, texture.handle, scaled_rect,
+                                    type, read_fb_handle, draw_fb_handle)) {
             BlitTextures(unscaled_tex.handle, from_rect, texture.handle, scaled_rect, type,
                          read_fb_handle, draw_fb_handle);
         }
     }
 
     InvalidateAllWatcher();
+
+    if (queued_filter_rects) {
+        const auto& [from_rect, scaled_rect] = *queued_filter_rects;
+        owner.texture_filterer->QueueFilter(filter_hash, std::move(unscaled_tex), from_rect,
+                                            CreateWatcher(), scaled_rect);
+    }
 }
 
 MICROPROFILE_DEFINE(OpenGL_TextureDL, "OpenGL", "Texture Download", MP_RGB(128, 192, 64));
+bool CachedSurface::CanDownloadToBuffer() const {
+    // GetTexImageOES writes through the CPU pointer it is given, so it can't read into a buffer
+    // Depth packed by the texture decoder is sampled straight from the scaled texture
+    return type != SurfaceType::Fill && (!(GLES && res_scale != 1) || CanPackDepthOnGPU());
+}
+
+bool CachedSurface::CanPackDepthOnGPU() const {
+    return owner.texture_decoder != nullptr && TextureDecoderOpenGL::CanPackDepth(pixel_format);
+}
+
 void CachedSurface::DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint read_fb_handle,
-                                      GLuint draw_fb_handle) {
+                                      GLuint draw_fb_handle, GLuint pack_buffer) {
     if (type == SurfaceType::Fill)
         return;
 
     MICROPROFILE_SCOPE(OpenGL_TextureDL);
 
-    if (gl_buffer.empty()) {
+    ASSERT(pack_buffer == 0 || CanDownloadToBuffer());
+    gl_buffer_on_gpu = pack_buffer == 0 && CanConvertOnGPU() && CanDownloadToBuffer();
+    if (gl_buffer_on_gpu) {
+        owner.texture_decoder->ReserveHostBuffer(stride * height *
+                                                 GetGLBytesPerPixel(pixel_format));
+        pack_buffer = owner.texture_decoder->GetHostBuffer();
+    } else if (pack_buffer == 0 && gl_buffer.empty()) {
         gl_buffer.resize(width * height * GetGLBytesPerPixel(pixel_format));
     }
 
+    if (CanPackDepthOnGPU()) {
+        // Reading depth back with glReadPixels often has the driver convert it on the CPU
+        if (pack_buffer != 0) {
+            owner.texture_decoder->PackDepth(*this, texture.handle, rect, pack_buffer);
+            return;
+        }
+
+        const u32 row_size = stride * GetGLBytesPerPixel(pixel_format);
+        owner.texture_decoder->ReserveHostBuffer(row_size * height);
+        owner.texture_decoder->PackDepth(*this, texture.handle, rect,
+                                         owner.texture_decoder->GetHostBuffer());
+
+        const u32 left_offset = rect.left * GetGLBytesPerPixel(pixel_format);
+        const u32 rect_row_size = rect.GetWidth() * GetGLBytesPerPixel(pixel_format);
+        glBindBuffer(GL_COPY_READ_BUFFER, owner.texture_decoder->GetHostBuffer());
+        const u8* data = static_cast<const u8*>(
+            glMapBufferRange(GL_COPY_READ_BUFFER, rect.bottom * row_size,
+                             rect.GetHeight() * row_size, GL_MAP_READ_BIT));
+        if (data != nullptr) {
+            for (u32 y = 0; y < rect.GetHeight(); ++y) {
+                std::memcpy(&gl_buffer[(rect.bottom + y) * row_size + left_offset],
+                            data + y * row_size + left_offset, rect_row_size);
+            }
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        } else {
+            LOG_ERROR(Render_OpenGL, "Failed to map the depth pack buffer");
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return;
+    }
+
+    if (pack_buffer != 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pack_buffer);
+    }
+
     OpenGLState state = OpenGLState::GetCurState();
     OpenGLState prev_state = state;
-    SCOPE_EXIT({ prev_state.Apply(); });
+    SCOPE_EXIT({
+        prev_state.Apply();
+        if (pack_buffer != 0) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    });
 
     const FormatTuple& tuple = GetFormatTuple(pixel_format);
 
@@ -902,6 +1232,9 @@ void CachedSurface::DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint
     glPixelStorei(GL_PACK_ROW_LENGTH, static_cast<GLint>(stride));
     std::size_t buffer_offset =
         (rect.bottom * stride + rect.left) * GetGLBytesPerPixel(pixel_format);
+    // With a pack buffer bound, the pixel pointers below are offsets into it
+    GLubyte* const pixels = pack_buffer != 0 ? reinterpret_cast<GLubyte*>(buffer_offset)
+                                             : &gl_buffer[buffer_offset];
 
     // If not 1x scale, blit scaled texture to a new 1x texture and use that to flush
     if (res_scale != 1) {
@@ -911,11 +1244,14 @@ void CachedSurface::DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint
         scaled_rect.right *= res_scale;
         scaled_rect.bottom *= res_scale;
 
-        OGLTexture unscaled_tex;
-        unscaled_tex.Create();
+        OGLTexture unscaled_tex = AcquireSurfaceTexture(owner.texture_pool, tuple,
+                                                        rect.GetWidth(), rect.GetHeight());
+        SCOPE_EXIT({
+            ReleaseSurfaceTexture(owner.texture_pool, std::move(unscaled_tex), tuple,
+                                  rect.GetWidth(), rect.GetHeight());
+        });
 
         Common::Rectangle<u32> unscaled_tex_rect{0, rect.GetHeight(), rect.GetWidth(), 0};
-        AllocateSurfaceTexture(unscaled_tex.handle, tuple, rect.GetWidth(), rect.GetHeight());
         BlitTextures(texture.handle, scaled_rect, unscaled_tex.handle, unscaled_tex_rect, type,
                      read_fb_handle, draw_fb_handle);
 
@@ -925,10 +1261,9 @@ void CachedSurface::DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint
         glActiveTexture(GL_TEXTURE0);
         if (GLES) {
             GetTexImageOES(GL_TEXTURE_2D, 0, tuple.format, tuple.type, rect.GetHeight(),
-                           rect.GetWidth(), 0, &gl_buffer[buffer_offset],
-                           gl_buffer.size() - buffer_offset);
+                           rect.GetWidth(), 0, pixels, gl_buffer.size() - buffer_offset);
         } else {
-            glGetTexImage(GL_TEXTURE_2D, 0, tuple.format, tuple.type, &gl_buffer[buffer_offset]);
+            glGetTexImage(GL_TEXTURE_2D, 0, tuple.format, tuple.type, pixels);
         }
     } else {
         state.ResetTexture(texture.handle);
@@ -952,7 +1287,7 @@ void CachedSurface::DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint
         }
         glReadPixels(static_cast<GLint>(rect.left), static_cast<GLint>(rect.bottom),
                      static_cast<GLsizei>(rect.GetWidth()), static_cast<GLsizei>(rect.GetHeight()),
-                     tuple.format, tuple.type, &gl_buffer[buffer_offset]);
+                     tuple.format, tuple.type, pixels);
     }
 
     glPixelStorei(GL_PACK_ROW_LENGTH, 0);
@@ -968,6 +1303,23 @@ enum MatchFlags {
     TexCopy = 1 << 5  // Surface that will match a display transfer "texture copy" parameters
 };
 
+/// Size of the level 0 texture of a surface, mipmaps are not accounted for
+static std::size_t GetSurfaceVramSize(const CachedSurface& surface) {
+    return static_cast<std::size_t>(surface.GetScaledWidth()) * surface.GetScaledHeight() *
+           CachedSurface::GetGLBytesPerPixel(surface.pixel_format);
+}
+
+static u64 GetEvictionKey(const SurfaceParams& params) {
+    return static_cast<u64>(params.addr) << 32 | params.size;
+}
+
+/// Evicted surfaces that were never created again are forgotten beyond this many
+static constexpr std::size_t MAX_EVICTED_SURFACES = 4096;
+
+/// Readbacks started ahead of time are dropped, oldest first, beyond this many
+static constexpr std::size_t MAX_PENDING_FLUSHES = 16;
+static constexpr std::size_t MAX_FREE_READBACK_BUFFERS = 8;
+
 static constexpr MatchFlags operator|(MatchFlags lhs, MatchFlags rhs) {
     return static_cast<MatchFlags>(static_cast<int>(lhs) | static_cast<int>(rhs));
 }
@@ -982,81 +1334,82 @@ static Surface FindMatch(const SurfaceCache& surface_cache, const SurfaceParams&
     u32 match_scale = 0;
     SurfaceInterval match_interval{};
 
-    for (const auto& pair : RangeFromInterval(surface_cache, params.GetInterval())) {
-        for (const auto& surface : pair.second) {
-            const bool res_scale_matched = match_scale_type == ScaleMatch::Exact
-                                               ? (params.res_scale == surface->res_scale)
-                                               : (params.res_scale <= surface->res_scale);
-            // validity will be checked in GetCopyableInterval
-            bool is_valid =
-                find_flags & MatchFlags::Copy
-                    ? true
-                    : surface->IsRegionValid(validate_interval.value_or(params.GetInterval()));
-
-            if (!(find_flags & MatchFlags::Invalid) && !is_valid)
-                continue;
+    surface_cache.ForEachOverlapping(params.GetInterval(), [&](const Surface& surface) {
+        const bool res_scale_matched = match_scale_type == ScaleMatch::Exact
+                                           ? (params.res_scale == surface->res_scale)
+                                           : (params.res_scale <= surface->res_scale);
+        // validity will be checked in GetCopyableInterval
+        bool is_valid =
+            find_flags & MatchFlags::Copy
+                ? true
+                : surface->IsRegionValid(validate_interval.value_or(params.GetInterval()));
+
+        if (!(find_flags & MatchFlags::Invalid) && !is_valid)
+            return;
+
+        auto IsMatch_Helper = [&](auto check_type, auto match_fn) {
+            if (!(find_flags & check_type))
+                return;
+
+            bool matched;
+            SurfaceInterval surface_interval;
+            std::tie(matched, surface_interval) = match_fn();
+            if (!matched)
+                return;
+
+            if (!res_scale_matched && match_scale_type != ScaleMatch::Ignore &&
+                surface->type != SurfaceType::Fill)
+                return;
+
+            // Found a match, update only if this is better than the previous one
+            auto UpdateMatch = [&] {
+                match_surface = surface;
+                match_valid = is_valid;
+                match_scale = surface->res_scale;
+                match_interval = surface_interval;
+            };
 
-            auto IsMatch_Helper = [&](auto check_type, auto match_fn) {
-                if (!(find_flags & check_type))
-                    return;
-
-                bool matched;
-                SurfaceInterval surface_interval;
-                std::tie(matched, surface_interval) = match_fn();
-                if (!matched)
-                    return;
-
-                if (!res_scale_matched && match_scale_type != ScaleMatch::Ignore &&
-                    surface->type != SurfaceType::Fill)
-                    return;
-
-                // Found a match, update only if this is better than the previous one
-                auto UpdateMatch = [&] {
-                    match_surface = surface;
-                    match_valid = is_valid;
-                    match_scale = surface->res_scale;
-                    match_interval = surface_interval;
-                };
-
-                if (surface->res_scale > match_scale) {
-                    UpdateMatch();
-                    return;
-                } else if (surface->res_scale < match_scale) {
-                    return;
-                }
+            if (surface->res_scale > match_scale) {
+                UpdateMatch();
+                return;
+            } else if (surface->res_scale < match_scale) {
+                return;
+            }
 
-                if (is_valid && !match_valid) {
-                    UpdateMatch();
-                    return;
-                } else if (is_valid != match_valid) {
-                    return;
-                }
+            if (is_valid && !match_valid) {
+                UpdateMatch();
+                return;
+            } else if (is_valid != match_valid) {
+                return;
+            }
 
-                if (boost::icl::length(surface_interval) > boost::icl::length(match_interval)) {
-                    UpdateMatch();
-                }
-            };
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Exact>{}, [&] {
-                return std::make_pair(surface->ExactMatch(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::SubRect>{}, [&] {
-                return std::make_pair(surface->CanSubRect(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Copy>{}, [&] {
-                ASSERT(validate_interval);
-                auto copy_interval =
-                    params.FromInterval(*validate_interval).GetCopyableInterval(surface);
-                bool matched = boost::icl::length(copy_interval & *validate_interval) != 0 &&
-                               surface->CanCopy(params, copy_interval);
-                return std::make_pair(matched, copy_interval);
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Expand>{}, [&] {
-                return std::make_pair(surface->CanExpand(params), surface->GetInterval());
-            });
-            IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::TexCopy>{}, [&] {
-                return std::make_pair(surface->CanTexCopy(params), surface->GetInterval());
-            });
-        }
+            if (boost::icl::length(surface_interval) > boost::icl::length(match_interval)) {
+                UpdateMatch();
+            }
+        };
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Exact>{}, [&] {
+            return std::make_pair(surface->ExactMatch(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::SubRect>{}, [&] {
+            return std::make_pair(surface->CanSubRect(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Copy>{}, [&] {
+            ASSERT(validate_interval);
+            auto copy_interval =
+                params.FromInterval(*validate_interval).GetCopyableInterval(surface);
+            bool matched = boost::icl::length(copy_interval & *validate_interval) != 0 &&
+                           surface->CanCopy(params, copy_interval);
+            return std::make_pair(matched, copy_interval);
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::Expand>{}, [&] {
+            return std::make_pair(surface->CanExpand(params), surface->GetInterval());
+        });
+        IsMatch_Helper(std::integral_constant<MatchFlags, MatchFlags::TexCopy>{}, [&] {
+            return std::make_pair(surface->CanTexCopy(params), surface->GetInterval());
+        });
+    });
+    if (match_surface != nullptr) {
+        match_surface->last_used_frame = VideoCore::g_renderer->GetCurrentFrame();
     }
     return match_surface;
 }
@@ -1066,6 +1419,12 @@ RasterizerCacheOpenGL::RasterizerCacheOpenGL() {
     texture_filterer = std::make_unique<TextureFilterer>(Settings::values.texture_filter_name,
                                                          resolution_scale_factor);
     format_reinterpreter = std::make_unique<FormatReinterpreterOpenGL>();
+    if (TextureDecoderOpenGL::IsSupported()) {
+        texture_decoder = std::make_unique<TextureDecoderOpenGL>();
+    } else if (Settings::values.use_gpu_texture_decoding) {
+        LOG_WARNING(Render_OpenGL,
+                    "GPU texture decoding requires compute shaders, decoding on the CPU instead");
+    }
 
     read_framebuffer.Create();
     draw_framebuffer.Create();
@@ -1073,6 +1432,12 @@ RasterizerCacheOpenGL::RasterizerCacheOpenGL() {
 
 RasterizerCacheOpenGL::~RasterizerCacheOpenGL() {
     ClearAll(false);
+    // Also drop the surfaces ClearAll keeps, while the texture pool is still there
+    detached_surfaces.clear();
+    for (auto& pending : pending_flushes) {
+        ReleasePendingFlush(pending);
+    }
+    pending_flushes.clear();
 }
 
 MICROPROFILE_DEFINE(OpenGL_BlitSurface, "OpenGL", "BlitSurface", MP_RGB(128, 192, 64));
@@ -1272,8 +1637,12 @@ Surface RasterizerCacheOpenGL::GetTextureSurface(const Pica::Texture::TextureInf
         SCOPE_EXIT({ prev_state.Apply(); });
         auto format_tuple = GetFormatTuple(params.pixel_format);
 
+        // Compressed custom textures only have their base level
+        const bool is_compressed = surface->is_custom && surface->custom_tex_info.format !=
+                                                             Core::CustomTexFormat::RGBA8;
+
         // Allocate more mipmap level if necessary
-        if (surface->max_level < max_level) {
+        if (surface->max_level < max_level && !is_compressed) {
             state.texture_units[0].texture_2d = surface->texture.handle;
             state.Apply();
             glActiveTexture(GL_TEXTURE0);
@@ -1291,11 +1660,29 @@ Surface RasterizerCacheOpenGL::GetTextureSurface(const Pica::Texture::TextureInf
                 glTexImage2D(GL_TEXTURE_2D, level, format_tuple.internal_format, width >> level,
                              height >> level, 0, format_tuple.format, format_tuple.type, nullptr);
             }
-            if (surface->is_custom || !texture_filterer->IsNull()) {
-                // TODO: proper mipmap support for custom textures
+            surface->max_level = max_level;
+            // The new levels are empty until they are generated again
+            surface->generated_levels_watcher.reset();
+        }
+
+        // Custom and upscaled textures don't match the guest's levels in size, so their levels
+        // are generated from the base level. That skips decoding the guest's levels at all, which
+        // can also be chosen for every texture at the cost of ignoring hand made levels.
+        const bool generate_levels = surface->is_custom || !texture_filterer->IsNull() ||
+                                     Settings::values.generate_mipmaps_on_gpu;
+        if (generate_levels) {
+            auto& watcher = surface->generated_levels_watcher;
+            if (!is_compressed && (!watcher || !watcher->IsValid())) {
+                if (!watcher) {
+                    watcher = surface->CreateWatcher();
+                }
+                state.texture_units[0].texture_2d = surface->texture.handle;
+                state.Apply();
+                glActiveTexture(GL_TEXTURE0);
                 glGenerateMipmap(GL_TEXTURE_2D);
+                watcher->Validate();
             }
-            surface->max_level = max_level;
+            return surface;
         }
 
         // Blit mipmaps that have been invalidated
@@ -1328,23 +1715,21 @@ Surface RasterizerCacheOpenGL::GetTextureSurface(const Pica::Texture::TextureInf
                 }
                 state.ResetTexture(level_surface->texture.handle);
                 state.Apply();
-                if (!surface->is_custom && texture_filterer->IsNull()) {
-                    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                                           level_surface->texture.handle, 0);
-                    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                                           GL_TEXTURE_2D, 0, 0);
-
-                    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                                           surface->texture.handle, level);
-                    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                                           GL_TEXTURE_2D, 0, 0);
-
-                    auto src_rect = level_surface->GetScaledRect();
-                    auto dst_rect = surface_params.GetScaledRect();
-                    glBlitFramebuffer(src_rect.left, src_rect.bottom, src_rect.right, src_rect.top,
-                                      dst_rect.left, dst_rect.bottom, dst_rect.right, dst_rect.top,
-                                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
-                }
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                       level_surface->texture.handle, 0);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                       GL_TEXTURE_2D, 0, 0);
+
+                glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                       surface->texture.handle, level);
+                glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                       GL_TEXTURE_2D, 0, 0);
+
+                auto src_rect = level_surface->GetScaledRect();
+                auto dst_rect = surface_params.GetScaledRect();
+                glBlitFramebuffer(src_rect.left, src_rect.bottom, src_rect.right, src_rect.top,
+                                  dst_rect.left, dst_rect.bottom, dst_rect.right, dst_rect.top,
+                                  GL_COLOR_BUFFER_BIT, GL_LINEAR);
                 watcher->Validate();
             }
         }
@@ -1355,49 +1740,51 @@ Surface RasterizerCacheOpenGL::GetTextureSurface(const Pica::Texture::TextureInf
 
 const CachedTextureCube& RasterizerCacheOpenGL::GetTextureCube(const TextureCubeConfig& config) {
     auto& cube = texture_cube_cache[config];
-
-    struct Face {
-        Face(std::shared_ptr<SurfaceWatcher>& watcher, PAddr address, GLenum gl_face)
-            : watcher(watcher), address(address), gl_face(gl_face) {}
-        std::shared_ptr<SurfaceWatcher>& watcher;
-        PAddr address;
-        GLenum gl_face;
-    };
-
-    const std::array<Face, 6> faces{{
-        {cube.px, config.px, GL_TEXTURE_CUBE_MAP_POSITIVE_X},
-        {cube.nx, config.nx, GL_TEXTURE_CUBE_MAP_NEGATIVE_X},
-        {cube.py, config.py, GL_TEXTURE_CUBE_MAP_POSITIVE_Y},
-        {cube.ny, config.ny, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y},
-        {cube.pz, config.pz, GL_TEXTURE_CUBE_MAP_POSITIVE_Z},
-        {cube.nz, config.nz, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z},
-    }};
-
-    for (const Face& face : faces) {
-        if (!face.watcher || !face.watcher->Get()) {
+    const int current_frame = VideoCore::g_renderer->GetCurrentFrame();
+    cube.last_used_frame = current_frame;
+
+    const std::array<PAddr, 6> addresses{config.px, config.nx, config.py,
+                                         config.ny, config.pz, config.nz};
+
+    // Faces whose surface still exists keep it, a bind usually finds every face clean
+    std::array<bool, 6> dirty{};
+    bool any_dirty = false;
+    const bool lookup_missing = cube.last_lookup_frame != current_frame;
+    for (std::size_t i = 0; i < cube.faces.size(); i++) {
+        auto& watcher = cube.faces[i];
+        if (watcher && watcher->Get()) {
+            // The cube is only rebuilt from its faces while they stay cached
+            watcher->Get()->last_used_frame = current_frame;
+        } else if (watcher || lookup_missing) {
             Pica::Texture::TextureInfo info;
-            info.physical_address = face.address;
+            info.physical_address = addresses[i];
             info.height = info.width = config.width;
             info.format = config.format;
             info.SetDefaultStride();
             auto surface = GetTextureSurface(info);
             if (surface) {
-                face.watcher = surface->CreateWatcher();
+                watcher = surface->CreateWatcher();
             } else {
                 // Can occur when texture address is invalid. We mark the watcher with nullptr
                 // in this case and the content of the face wouldn't get updated. These are
                 // usually leftover setup in the texture unit and games are not supposed to draw
-                // using them.
-                face.watcher = nullptr;
+                // using them, so they are only looked up again on the next frame.
+                watcher = nullptr;
             }
         }
+        dirty[i] = watcher && !watcher->IsValid();
+        any_dirty |= dirty[i];
+    }
+    cube.last_lookup_frame = current_frame;
+
+    if (!any_dirty && cube.texture.handle != 0) {
+        return cube;
     }
 
     if (cube.texture.handle == 0) {
-        for (const Face& face : faces) {
-            if (face.watcher) {
-                auto surface = face.watcher->Get();
-                cube.res_scale = std::max(cube.res_scale, surface->res_scale);
+        for (const auto& watcher : cube.faces) {
+            if (watcher) {
+                cube.res_scale = std::max(cube.res_scale, watcher->Get()->res_scale);
             }
         }
 
@@ -1418,9 +1805,10 @@ const CachedTextureCube& RasterizerCacheOpenGL::GetTextureCube(const TextureCube
     state.draw.draw_framebuffer = draw_framebuffer.handle;
     state.ResetTexture(cube.texture.handle);
 
-    for (const Face& face : faces) {
-        if (face.watcher && !face.watcher->IsValid()) {
-            auto surface = face.watcher->Get();
+    for (std::size_t i = 0; i < cube.faces.size(); i++) {
+        if (dirty[i]) {
+            const auto& watcher = cube.faces[i];
+            auto surface = watcher->Get();
             if (!surface->invalid_regions.empty()) {
                 ValidateSurface(surface, surface->addr, surface->size);
             }
@@ -1431,7 +1819,8 @@ const CachedTextureCube& RasterizerCacheOpenGL::GetTextureCube(const TextureCube
             glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
                                    0, 0);
 
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, face.gl_face,
+            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                   static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i),
                                    cube.texture.handle, 0);
             glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
                                    0, 0);
@@ -1439,29 +1828,61 @@ const CachedTextureCube& RasterizerCacheOpenGL::GetTextureCube(const TextureCube
             auto src_rect = surface->GetScaledRect();
             glBlitFramebuffer(src_rect.left, src_rect.bottom, src_rect.right, src_rect.top, 0, 0,
                               scaled_size, scaled_size, GL_COLOR_BUFFER_BIT, GL_LINEAR);
-            face.watcher->Validate();
+            watcher->Validate();
         }
     }
 
     return cube;
 }
 
+/// GPU time available to a frame at the configured speed limit, in seconds
+static double GetFrameBudget() {
+    const u16 frame_limit = Settings::values.use_frame_limit_alternate
+                                ? Settings::values.frame_limit_alternate
+                                : Settings::values.frame_limit;
+    // An unlimited speed still aims for full speed
+    const double speed = frame_limit != 0 ? frame_limit / 100.0 : 1.0;
+    return 1.0 / (GPU::SCREEN_REFRESH_RATE * speed);
+}
+
 SurfaceSurfaceRect_Tuple RasterizerCacheOpenGL::GetFramebufferSurfaces(
     bool using_color_fb, bool using_depth_fb, const Common::Rectangle<s32>& viewport_rect) {
     const auto& regs = Pica::g_state.regs;
     const auto& config = regs.framebuffer.framebuffer;
 
+    EvictSurfaces();
+    texture_pool.Trim(VideoCore::g_renderer->GetCurrentFrame());
+    texture_filterer->ProcessQueue(VideoCore::g_renderer->GetCurrentFrame(),
+                                   read_framebuffer.handle, draw_framebuffer.handle);
+    ReloadCustomTextures();
+
     // update resolution_scale_factor and reset cache if changed
     if ((resolution_scale_factor != VideoCore::GetResolutionScaleFactor()) |
         (VideoCore::g_texture_filter_update_requested.exchange(false) &&
          texture_filterer->Reset(Settings::values.texture_filter_name, resolution_scale_factor))) {
         resolution_scale_factor = VideoCore::GetResolutionScaleFactor();
         FlushAll();
-        while (!surface_cache.empty())
-            UnregisterSurface(*surface_cache.begin()->second.begin());
+        while (!surface_cache.Empty())
+            UnregisterSurface(surface_cache.Front());
         texture_cube_cache.clear();
     }
 
+    // Timer queries are not available on GLES
+    if (Settings::values.dynamic_resolution && !GLES) {
+        if (!resolution_controller) {
+            resolution_controller = std::make_unique<ResolutionController>();
+        }
+    } else {
+        resolution_controller.reset();
+    }
+    // Surfaces at other scales are kept, framebuffers are matched at the scale of the frame and
+    // filled from them when they are not found
+    const u16 framebuffer_scale =
+        resolution_controller
+            ? resolution_controller->Update(VideoCore::g_renderer->GetCurrentFrame(),
+                                            resolution_scale_factor, GetFrameBudget())
+            : resolution_scale_factor;
+
     Common::Rectangle<u32> viewport_clamped{
         static_cast<u32>(std::clamp(viewport_rect.left, 0, static_cast<s32>(config.GetWidth()))),
         static_cast<u32>(std::clamp(viewport_rect.top, 0, static_cast<s32>(config.GetHeight()))),
@@ -1472,7 +1893,7 @@ SurfaceSurfaceRect_Tuple RasterizerCacheOpenGL::GetFramebufferSurfaces(
     // get color and depth surfaces
     SurfaceParams color_params;
     color_params.is_tiled = true;
-    color_params.res_scale = resolution_scale_factor;
+    color_params.res_scale = framebuffer_scale;
     color_params.width = config.GetWidth();
     color_params.height = config.GetHeight();
     SurfaceParams depth_params = color_params;
@@ -1706,13 +2127,14 @@ bool RasterizerCacheOpenGL::NoUnimplementedReinterpretations(const Surface& surf
 bool RasterizerCacheOpenGL::IntervalHasInvalidPixelFormat(SurfaceParams& params,
                                                           const SurfaceInterval& interval) {
     params.pixel_format = PixelFormat::Invalid;
-    for (const auto& set : RangeFromInterval(surface_cache, interval))
-        for (const auto& surface : set.second)
-            if (surface->pixel_format == PixelFormat::Invalid) {
-                LOG_WARNING(Render_OpenGL, "Surface found with invalid pixel format");
-                return true;
-            }
-    return false;
+    bool found_invalid = false;
+    surface_cache.ForEachOverlapping(interval, [&](const Surface& surface) {
+        found_invalid |= surface->pixel_format == PixelFormat::Invalid;
+    });
+    if (found_invalid) {
+        LOG_WARNING(Render_OpenGL, "Surface found with invalid pixel format");
+    }
+    return found_invalid;
 }
 
 bool RasterizerCacheOpenGL::ValidateByReinterpretation(const Surface& surface,
@@ -1735,15 +2157,17 @@ bool RasterizerCacheOpenGL::ValidateByReinterpretation(const Surface& surface,
             if (!texture_filterer->IsNull() && reinterpret_surface->res_scale == 1 &&
                 surface->res_scale == resolution_scale_factor) {
                 // The destination surface is either a framebuffer, or a filtered texture.
-                OGLTexture tmp_tex;
-                tmp_tex.Create();
                 // Create an intermediate surface to convert to before blitting to the
                 // destination.
                 Common::Rectangle<u32> tmp_rect{0, dest_rect.GetHeight() / resolution_scale_factor,
                                                 dest_rect.GetWidth() / resolution_scale_factor, 0};
-                AllocateSurfaceTexture(tmp_tex.handle,
-                                       GetFormatTuple(reinterpreter->first.dst_format),
-                                       tmp_rect.right, tmp_rect.top);
+                const FormatTuple& tmp_tuple = GetFormatTuple(reinterpreter->first.dst_format);
+                OGLTexture tmp_tex = AcquireSurfaceTexture(texture_pool, tmp_tuple,
+                                                           tmp_rect.right, tmp_rect.top);
+                SCOPE_EXIT({
+                    ReleaseSurfaceTexture(texture_pool, std::move(tmp_tex), tmp_tuple,
+                                          tmp_rect.right, tmp_rect.top);
+                });
                 reinterpreter->second->Reinterpret(reinterpret_surface->texture.handle, src_rect,
                                                    read_framebuffer.handle, tmp_tex.handle,
                                                    tmp_rect, draw_framebuffer.handle);
@@ -1768,29 +2192,71 @@ bool RasterizerCacheOpenGL::ValidateByReinterpretation(const Surface& surface,
 }
 
 void RasterizerCacheOpenGL::ClearAll(bool flush) {
-    const auto flush_interval = PageMap::interval_type::right_open(0x0, 0xFFFFFFFF);
     // Force flush all surfaces from the cache
     if (flush) {
         FlushRegion(0x0, 0xFFFFFFFF);
     }
     // Unmark all of the marked pages
-    for (auto& pair : RangeFromInterval(cached_pages, flush_interval)) {
-        const auto interval = pair.first & flush_interval;
-
-        const PAddr interval_start_addr = boost::icl::first(interval) << Memory::PAGE_BITS;
-        const PAddr interval_end_addr = boost::icl::last_next(interval) << Memory::PAGE_BITS;
-        const u32 interval_size = interval_end_addr - interval_start_addr;
-
+    cached_pages.Clear([](u32 page_start, u32 page_end) {
+        const PAddr interval_start_addr = page_start << Memory::PAGE_BITS;
+        const u32 interval_size = (page_end - page_start) << Memory::PAGE_BITS;
         VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr, interval_size, false);
-    }
+    });
 
     // Remove the whole cache without really looking at it.
-    cached_pages -= flush_interval;
+    DiscardPendingFlushes(SurfaceInterval(0x0, 0xFFFFFFFF));
+    flushed_regions.clear();
     dirty_regions -= SurfaceInterval(0x0, 0xFFFFFFFF);
-    surface_cache -= SurfaceInterval(0x0, 0xFFFFFFFF);
+    surface_cache.Clear();
+    surface_vram_size = 0;
     remove_surfaces.clear();
 }
 
+void RasterizerCacheOpenGL::DetachSurfaces(bool flush) {
+    if (flush) {
+        FlushRegion(0x0, 0xFFFFFFFF);
+    }
+
+    std::unordered_set<Surface> dirty_surfaces;
+    for (const auto& pair : dirty_regions) {
+        dirty_surfaces.insert(pair.second);
+    }
+
+    // Only the surfaces fully loaded from memory and not written since hold its contents
+    detached_surfaces.clear();
+    surface_cache.ForEachOverlapping(SurfaceInterval(0x0, 0xFFFFFFFF), [&](const Surface& surface) {
+        if (!surface->invalid_regions.empty() || dirty_surfaces.count(surface) != 0) {
+            return;
+        }
+        const u8* memory = VideoCore::g_memory->GetPhysicalPointer(surface->addr);
+        if (memory == nullptr) {
+            return;
+        }
+        detached_surfaces.push_back({surface, Common::ComputeHash64(memory, surface->size)});
+    });
+
+    ClearAll(false);
+    for (const auto& detached : detached_surfaces) {
+        detached.surface->registered = false;
+    }
+}
+
+void RasterizerCacheOpenGL::ReattachSurfaces() {
+    std::size_t num_reattached = 0;
+    for (const auto& detached : detached_surfaces) {
+        const Surface& surface = detached.surface;
+        const u8* memory = VideoCore::g_memory->GetPhysicalPointer(surface->addr);
+        if (memory != nullptr &&
+            Common::ComputeHash64(memory, surface->size) == detached.memory_hash) {
+            RegisterSurface(surface);
+            ++num_reattached;
+        }
+    }
+    LOG_DEBUG(Render_OpenGL, "Reattached {} of {} surfaces", num_reattached,
+              detached_surfaces.size());
+    detached_surfaces.clear();
+}
+
 void RasterizerCacheOpenGL::FlushRegion(PAddr addr, u32 size, Surface flush_surface) {
     if (size == 0)
         return;
@@ -1812,19 +2278,154 @@ void RasterizerCacheOpenGL::FlushRegion(PAddr addr, u32 size, Surface flush_surf
         ASSERT(surface->IsRegionValid(interval));
 
         if (surface->type != SurfaceType::Fill) {
-            SurfaceParams params = surface->FromInterval(interval);
-            surface->DownloadGLTexture(surface->GetSubRect(params), read_framebuffer.handle,
-                                       draw_framebuffer.handle);
+            const auto pending =
+                std::find_if(pending_flushes.begin(), pending_flushes.end(), [&](const auto& p) {
+                    return p.surface == surface && boost::icl::contains(p.interval, interval);
+                });
+            if (pending != pending_flushes.end()) {
+                FinishPendingFlush(*pending);
+                ReleasePendingFlush(*pending);
+                pending_flushes.erase(pending);
+            } else {
+                SurfaceParams params = surface->FromInterval(interval);
+                surface->DownloadGLTexture(surface->GetSubRect(params), read_framebuffer.handle,
+                                           draw_framebuffer.handle);
+            }
         }
         surface->FlushGLBuffer(boost::icl::first(interval), boost::icl::last_next(interval));
         flushed_intervals += interval;
     }
     // Reset dirty regions
     dirty_regions -= flushed_intervals;
+    flushed_regions += flushed_intervals;
+}
+
+void RasterizerCacheOpenGL::StartFlushRegion(PAddr addr, u32 size) {
+    if (size == 0)
+        return;
+
+    const SurfaceInterval flush_interval(addr, addr + size);
+    for (const auto& pair : RangeFromInterval(dirty_regions, flush_interval)) {
+        const auto interval = pair.first & flush_interval;
+        const Surface& surface = pair.second;
+
+        // Most dirty regions are never read by the CPU, only predict the ones that were before
+        if (!surface->CanDownloadToBuffer() || !boost::icl::intersects(flushed_regions, interval))
+            continue;
+
+        const bool already_pending =
+            std::any_of(pending_flushes.begin(), pending_flushes.end(), [&](const auto& p) {
+                return p.surface == surface && boost::icl::contains(p.interval, interval);
+            });
+        if (already_pending)
+            continue;
+
+        if (pending_flushes.size() >= MAX_PENDING_FLUSHES) {
+            ReleasePendingFlush(pending_flushes.front());
+            pending_flushes.erase(pending_flushes.begin());
+        }
+
+        PendingFlush pending;
+        pending.surface = surface;
+        pending.interval = interval;
+        pending.rect = surface->GetSubRect(surface->FromInterval(interval));
+        pending.readback = AcquireReadbackBuffer(
+            surface->stride * surface->height *
+            CachedSurface::GetGLBytesPerPixel(surface->pixel_format));
+        surface->DownloadGLTexture(pending.rect, read_framebuffer.handle, draw_framebuffer.handle,
+                                   pending.readback.buffer.handle);
+        pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pending_flushes.push_back(std::move(pending));
+    }
+}
+
+RasterizerCacheOpenGL::ReadbackBuffer RasterizerCacheOpenGL::AcquireReadbackBuffer(
+    GLsizeiptr size) {
+    const auto it =
+        std::find_if(free_readback_buffers.begin(), free_readback_buffers.end(),
+                     [size](const ReadbackBuffer& readback) { return readback.size >= size; });
+    if (it != free_readback_buffers.end()) {
+        ReadbackBuffer readback = std::move(*it);
+        free_readback_buffers.erase(it);
+        return readback;
+    }
+
+    ReadbackBuffer readback;
+    readback.buffer.Create();
+    readback.size = size;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.handle);
+    if (GLAD_GL_ARB_buffer_storage) {
+        // Coherent, so the pixels are visible as soon as the fence is signaled
+        constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags);
+        readback.mapped =
+            static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags));
+    } else {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return readback;
+}
+
+MICROPROFILE_DEFINE(OpenGL_FlushWait, "OpenGL", "Surface Flush Wait", MP_RGB(128, 192, 64));
+void RasterizerCacheOpenGL::FinishPendingFlush(PendingFlush& pending) {
+    MICROPROFILE_SCOPE(OpenGL_FlushWait);
+    glClientWaitSync(pending.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+
+    CachedSurface& surface = *pending.surface;
+    const u32 bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(surface.pixel_format);
+    if (surface.gl_buffer.empty()) {
+        surface.gl_buffer.resize(surface.width * surface.height * bytes_per_pixel);
+    }
+    surface.gl_buffer_on_gpu = false;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.readback.buffer.handle);
+    const u8* const pixels =
+        pending.readback.mapped != nullptr
+            ? pending.readback.mapped
+            : static_cast<const u8*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                      pending.readback.size, GL_MAP_READ_BIT));
+
+    // Copy row by row, the layout has the surface stride but only the rect was read back
+    const Common::Rectangle<u32>& rect = pending.rect;
+    const std::size_t row_size = rect.GetWidth() * bytes_per_pixel;
+    for (u32 y = rect.bottom; y < rect.top; ++y) {
+        const std::size_t offset = (y * surface.stride + rect.left) * bytes_per_pixel;
+        if (offset + row_size > surface.gl_buffer.size())
+            break;
+        std::memcpy(&surface.gl_buffer[offset], pixels + offset, row_size);
+    }
+
+    if (pending.readback.mapped == nullptr) {
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void RasterizerCacheOpenGL::ReleasePendingFlush(PendingFlush& pending) {
+    glDeleteSync(pending.fence);
+    pending.fence = nullptr;
+    if (free_readback_buffers.size() < MAX_FREE_READBACK_BUFFERS) {
+        free_readback_buffers.push_back(std::move(pending.readback));
+    }
+}
+
+void RasterizerCacheOpenGL::DiscardPendingFlushes(const SurfaceInterval& interval) {
+    const auto it = std::remove_if(pending_flushes.begin(), pending_flushes.end(),
+                                   [&](PendingFlush& pending) {
+                                       if (!boost::icl::intersects(pending.interval, interval))
+                                           return false;
+                                       ReleasePendingFlush(pending);
+                                       return true;
+                                   });
+    pending_flushes.erase(it, pending_flushes.end());
 }
 
 void RasterizerCacheOpenGL::FlushAll() {
+    // Flushing everything says nothing about what will be read back, keep it out of the history
+    const SurfaceRegions prev_flushed_regions = flushed_regions;
     FlushRegion(0, 0xFFFFFFFF);
+    flushed_regions = prev_flushed_regions;
 }
 
 void RasterizerCacheOpenGL::InvalidateRegion(PAddr addr, u32 size, const Surface& region_owner) {
@@ -1841,30 +2442,31 @@ void RasterizerCacheOpenGL::InvalidateRegion(PAddr addr, u32 size, const Surface
         region_owner->invalid_regions.erase(invalid_interval);
     }
 
-    for (const auto& pair : RangeFromInterval(surface_cache, invalid_interval)) {
-        for (const auto& cached_surface : pair.second) {
-            if (cached_surface == region_owner)
-                continue;
+    surface_cache.ForEachOverlapping(invalid_interval, [&](const Surface& cached_surface) {
+        if (cached_surface == region_owner)
+            return;
 
-            // If cpu is invalidating this region we want to remove it
-            // to (likely) mark the memory pages as uncached
-            if (region_owner == nullptr && size <= 8) {
-                FlushRegion(cached_surface->addr, cached_surface->size, cached_surface);
-                remove_surfaces.emplace(cached_surface);
-                continue;
-            }
+        // If cpu is invalidating this region we want to remove it
+        // to (likely) mark the memory pages as uncached. Fills are kept, flushing them would write
+        // the whole fill to memory for the few bytes the cpu writes, they only lose those bytes.
+        if (region_owner == nullptr && size <= 8 && cached_surface->type != SurfaceType::Fill) {
+            FlushRegion(cached_surface->addr, cached_surface->size, cached_surface);
+            remove_surfaces.emplace(cached_surface);
+            return;
+        }
 
-            const auto interval = cached_surface->GetInterval() & invalid_interval;
-            cached_surface->invalid_regions.insert(interval);
-            cached_surface->InvalidateAllWatcher();
+        const auto interval = cached_surface->GetInterval() & invalid_interval;
+        cached_surface->invalid_regions.insert(interval);
+        cached_surface->InvalidateAllWatcher();
 
-            // Remove only "empty" fill surfaces to avoid destroying and recreating OGL textures
-            if (cached_surface->type == SurfaceType::Fill &&
-                cached_surface->IsSurfaceFullyInvalid()) {
-                remove_surfaces.emplace(cached_surface);
-            }
+        // Remove only "empty" fill surfaces to avoid destroying and recreating OGL textures
+        if (cached_surface->type == SurfaceType::Fill &&
+            cached_surface->IsSurfaceFullyInvalid()) {
+            remove_surfaces.emplace(cached_surface);
         }
-    }
+    });
+
+    DiscardPendingFlushes(invalid_interval);
 
     if (region_owner != nullptr)
         dirty_regions.set({invalid_interval, region_owner});
@@ -1893,12 +2495,12 @@ Surface RasterizerCacheOpenGL::CreateSurface(const SurfaceParams& params) {
     Surface surface = std::make_shared<CachedSurface>(*this);
     static_cast<SurfaceParams&>(*surface) = params;
 
-    surface->texture.Create();
+    surface->texture =
+        AcquireSurfaceTexture(texture_pool, GetFormatTuple(surface->pixel_format),
+                              surface->GetScaledWidth(), surface->GetScaledHeight());
 
     surface->gl_buffer.resize(0);
     surface->invalid_regions.insert(surface->GetInterval());
-    AllocateSurfaceTexture(surface->texture.handle, GetFormatTuple(surface->pixel_format),
-                           surface->GetScaledWidth(), surface->GetScaledHeight());
 
     return surface;
 }
@@ -1908,7 +2510,12 @@ void RasterizerCacheOpenGL::RegisterSurface(const Surface& surface) {
         return;
     }
     surface->registered = true;
-    surface_cache.add({surface->GetInterval(), SurfaceSet{surface}});
+    surface->last_used_frame = VideoCore::g_renderer->GetCurrentFrame();
+    surface_vram_size += GetSurfaceVramSize(*surface);
+    if (evicted_surfaces.erase(GetEvictionKey(*surface)) != 0) {
+        ++num_refetched_surfaces;
+    }
+    surface_cache.Insert(surface, surface->GetInterval());
     UpdatePagesCachedCount(surface->addr, surface->size, 1);
 }
 
@@ -1918,7 +2525,17 @@ void RasterizerCacheOpenGL::UnregisterSurface(const Surface& surface) {
     }
     surface->registered = false;
     UpdatePagesCachedCount(surface->addr, surface->size, -1);
-    surface_cache.subtract({surface->GetInterval(), SurfaceSet{surface}});
+    DiscardPendingFlushes(surface->GetInterval());
+    surface_vram_size -= GetSurfaceVramSize(*surface);
+    surface_cache.Erase(surface, surface->GetInterval());
+}
+
+bool RasterizerCacheOpenGL::IsRegionDirty(PAddr addr, u32 size) const {
+    return !RangeFromInterval(dirty_regions, SurfaceInterval(addr, addr + size)).empty();
+}
+
+void RasterizerCacheOpenGL::MarkRegionCached(PAddr addr, u32 size, bool cached) {
+    UpdatePagesCachedCount(addr, size, cached ? 1 : -1);
 }
 
 void RasterizerCacheOpenGL::UpdatePagesCachedCount(PAddr addr, u32 size, int delta) {
@@ -1927,32 +2544,118 @@ void RasterizerCacheOpenGL::UpdatePagesCachedCount(PAddr addr, u32 size, int del
     const u32 page_start = addr >> Memory::PAGE_BITS;
     const u32 page_end = page_start + num_pages;
 
-    // Interval maps will erase segments if count reaches 0, so if delta is negative we have to
-    // subtract after iterating
-    const auto pages_interval = PageMap::interval_type::right_open(page_start, page_end);
-    if (delta > 0)
-        cached_pages.add({pages_interval, delta});
+    cached_pages.Update(page_start, page_end, delta,
+                        [](u32 run_start, u32 run_end, bool cached) {
+                            const PAddr interval_start_addr = run_start << Memory::PAGE_BITS;
+                            const u32 interval_size = (run_end - run_start) << Memory::PAGE_BITS;
+                            VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr,
+                                                                            interval_size, cached);
+                        });
+}
 
-    for (const auto& pair : RangeFromInterval(cached_pages, pages_interval)) {
-        const auto interval = pair.first & pages_interval;
-        const int count = pair.second;
+void RasterizerCacheOpenGL::ReloadCustomTextures() {
+    if (pending_custom_surfaces.empty()) {
+        return;
+    }
+    const auto finished = Core::System::GetInstance().CustomTexCache().TakeFinishedTextures();
+    for (const u64 hash : finished) {
+        const auto it = pending_custom_surfaces.find(hash);
+        if (it == pending_custom_surfaces.end()) {
+            continue;
+        }
+        for (const auto& weak_surface : it->second) {
+            const Surface surface = weak_surface.lock();
+            if (surface == nullptr || !surface->registered || surface->is_custom) {
+                continue;
+            }
+            // The next use validates the surface again, which picks up the custom texture
+            surface->invalid_regions.insert(surface->GetInterval());
+            surface->InvalidateAllWatcher();
+        }
+        pending_custom_surfaces.erase(it);
+    }
+}
+
+void RasterizerCacheOpenGL::EvictSurfaces() {
+    const std::size_t budget = static_cast<std::size_t>(Settings::values.surface_cache_budget_mb)
+                               << 20;
+    const int current_frame = VideoCore::g_renderer->GetCurrentFrame();
+    if (budget == 0 || current_frame == last_eviction_frame) {
+        return;
+    }
+    last_eviction_frame = current_frame;
 
-        const PAddr interval_start_addr = boost::icl::first(interval) << Memory::PAGE_BITS;
-        const PAddr interval_end_addr = boost::icl::last_next(interval) << Memory::PAGE_BITS;
-        const u32 interval_size = interval_end_addr - interval_start_addr;
+    const auto GetCubeVramSize = [](const TextureCubeConfig& config,
+                                    const CachedTextureCube& cube) -> std::size_t {
+        if (cube.texture.handle == 0) {
+            return 0;
+        }
+        const std::size_t face_width = config.width * cube.res_scale;
+        return face_width * face_width * 4 * 6;
+    };
 
-        if (delta > 0 && count == delta)
-            VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr, interval_size,
-                                                            true);
-        else if (delta < 0 && count == -delta)
-            VideoCore::g_memory->RasterizerMarkRegionCached(interval_start_addr, interval_size,
-                                                            false);
-        else
-            ASSERT(count >= 0);
+    std::size_t vram_size = surface_vram_size;
+    for (const auto& [config, cube] : texture_cube_cache) {
+        vram_size += GetCubeVramSize(config, cube);
+    }
+    if (vram_size <= budget) {
+        return;
+    }
+
+    // Anything used this frame may still be bound, and dirty surfaces would have to be flushed
+    struct Candidate {
+        int last_used_frame;
+        Surface surface;
+        const TextureCubeConfig* cube_config;
+    };
+    std::vector<Candidate> candidates;
+    surface_cache.ForEachOverlapping(SurfaceInterval(0x0, 0xFFFFFFFF), [&](const Surface& surface) {
+        if (surface->last_used_frame == current_frame) {
+            return;
+        }
+        for (const auto& pair : RangeFromInterval(dirty_regions, surface->GetInterval())) {
+            if (pair.second == surface) {
+                return;
+            }
+        }
+        candidates.push_back({surface->last_used_frame, surface, nullptr});
+    });
+    for (const auto& [config, cube] : texture_cube_cache) {
+        if (cube.last_used_frame != current_frame) {
+            candidates.push_back({cube.last_used_frame, nullptr, &config});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.last_used_frame < rhs.last_used_frame;
+    });
+
+    std::size_t num_surfaces = 0;
+    std::size_t num_cubes = 0;
+    for (const Candidate& candidate : candidates) {
+        if (vram_size <= budget) {
+            break;
+        }
+        if (candidate.surface != nullptr) {
+            vram_size -= GetSurfaceVramSize(*candidate.surface);
+            if (evicted_surfaces.size() >= MAX_EVICTED_SURFACES) {
+                evicted_surfaces.clear();
+            }
+            evicted_surfaces.insert(GetEvictionKey(*candidate.surface));
+            UnregisterSurface(candidate.surface);
+            ++num_surfaces;
+        } else {
+            const auto it = texture_cube_cache.find(*candidate.cube_config);
+            vram_size -= GetCubeVramSize(it->first, it->second);
+            texture_cube_cache.erase(it);
+            ++num_cubes;
+        }
     }
+    num_evicted_surfaces += num_surfaces;
 
-    if (delta < 0)
-        cached_pages.add({pages_interval, delta});
+    LOG_DEBUG(Render_OpenGL,
+              "Evicted {} surfaces and {} texture cubes, {} of {} evicted surfaces were created "
+              "again so far",
+              num_surfaces, num_cubes, num_refetched_surfaces, num_evicted_surfaces);
 }
 
 } // namespace OpenGL
@@ -19,6 +19,8 @@
 #pragma GCC diagnostic pop
 #endif
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <boost/functional/hash.hpp>
 #include <glad/glad.h>
 #include "common/assert.h"
@@ -27,14 +29,18 @@
 #include "common/math_util.h"
 #include "core/custom_tex_cache.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_surface_cache.h"
 #include "video_core/renderer_opengl/gl_surface_params.h"
+#include "video_core/renderer_opengl/gl_texture_pool.h"
 #include "video_core/texture/texture_decode.h"
 
 namespace OpenGL {
 
 class RasterizerCacheOpenGL;
+class ResolutionController;
 class TextureFilterer;
 class FormatReinterpreterOpenGL;
+class TextureDecoderOpenGL;
 
 struct TextureCubeConfig {
     PAddr px;
@@ -84,19 +90,14 @@ using SurfaceRegions = boost::icl::interval_set<PAddr, std::less, SurfaceInterva
 using SurfaceMap =
     boost::icl::interval_map<PAddr, Surface, boost::icl::partial_absorber, std::less,
                              boost::icl::inplace_plus, boost::icl::inter_section, SurfaceInterval>;
-using SurfaceCache =
-    boost::icl::interval_map<PAddr, SurfaceSet, boost::icl::partial_absorber, std::less,
-                             boost::icl::inplace_plus, boost::icl::inter_section, SurfaceInterval>;
 
-static_assert(std::is_same<SurfaceRegions::interval_type, SurfaceCache::interval_type>() &&
-                  std::is_same<SurfaceMap::interval_type, SurfaceCache::interval_type>(),
+static_assert(std::is_same<SurfaceRegions::interval_type, SurfaceInterval>() &&
+                  std::is_same<SurfaceMap::interval_type, SurfaceInterval>(),
               "incorrect interval types");
 
 using SurfaceRect_Tuple = std::tuple<Surface, Common::Rectangle<u32>>;
 using SurfaceSurfaceRect_Tuple = std::tuple<Surface, Surface, Common::Rectangle<u32>>;
 
-using PageMap = boost::icl::interval_map<u32, int>;
-
 enum class ScaleMatch {
     Exact,   // only accept same res scale
     Upscale, // only allow higher scale than params
@@ -139,6 +140,7 @@ private:
 
 struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface> {
     CachedSurface(RasterizerCacheOpenGL& owner) : owner{owner} {}
+    ~CachedSurface();
 
     bool CanFill(const SurfaceParams& dest_surface, SurfaceInterval fill_interval) const;
     bool CanCopy(const SurfaceParams& dest_surface, SurfaceInterval copy_interval) const;
@@ -153,6 +155,8 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     }
 
     bool registered = false;
+    /// Frame the surface was last looked up in, used to evict the least recently used ones
+    int last_used_frame = 0;
     SurfaceRegions invalid_regions;
 
     u32 fill_size = 0; /// Number of bytes to read from fill_data
@@ -164,6 +168,8 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     u32 max_level = 0;
     /// level_watchers[i] watches the (i+1)-th level mipmap source surface
     std::array<std::shared_ptr<SurfaceWatcher>, 7> level_watchers;
+    /// Watches this surface when its mipmaps are generated from the base level instead
+    std::shared_ptr<SurfaceWatcher> generated_levels_watcher;
 
     bool is_custom = false;
     Core::CustomTexInfo custom_tex_info;
@@ -178,6 +184,8 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     }
 
     std::vector<u8> gl_buffer;
+    /// Set while the data meant for gl_buffer is in the texture decoder's host buffer instead
+    bool gl_buffer_on_gpu = false;
 
     // Read/Write data in 3DS memory to/from gl_buffer
     void LoadGLBuffer(PAddr load_start, PAddr load_end);
@@ -189,8 +197,12 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
 
     // Upload/Download data in gl_buffer in/to this surface's texture
     void UploadGLTexture(Common::Rectangle<u32> rect, GLuint read_fb_handle, GLuint draw_fb_handle);
+    /// When pack_buffer is given, the pixels are read into it at their gl_buffer offsets instead
     void DownloadGLTexture(const Common::Rectangle<u32>& rect, GLuint read_fb_handle,
-                           GLuint draw_fb_handle);
+                           GLuint draw_fb_handle, GLuint pack_buffer = 0);
+
+    /// Returns true if DownloadGLTexture can read this surface into a pack buffer
+    bool CanDownloadToBuffer() const;
 
     std::shared_ptr<SurfaceWatcher> CreateWatcher() {
         auto watcher = std::make_shared<SurfaceWatcher>(weak_from_this());
@@ -217,6 +229,12 @@ struct CachedSurface : SurfaceParams, std::enable_shared_from_this<CachedSurface
     }
 
 private:
+    /// Returns true if loads and flushes of this surface can be converted by the texture decoder
+    bool CanConvertOnGPU() const;
+
+    /// Returns true if downloads of this surface can have the texture decoder pack its depth
+    bool CanPackDepthOnGPU() const;
+
     RasterizerCacheOpenGL& owner;
     std::list<std::weak_ptr<SurfaceWatcher>> watchers;
 };
@@ -224,12 +242,12 @@ private:
 struct CachedTextureCube {
     OGLTexture texture;
     u16 res_scale = 1;
-    std::shared_ptr<SurfaceWatcher> px;
-    std::shared_ptr<SurfaceWatcher> nx;
-    std::shared_ptr<SurfaceWatcher> py;
-    std::shared_ptr<SurfaceWatcher> ny;
-    std::shared_ptr<SurfaceWatcher> pz;
-    std::shared_ptr<SurfaceWatcher> nz;
+    int last_used_frame = 0;
+    /// Watchers of the face surfaces, in the order of the GL cube map faces (+X, -X, ..., -Z).
+    /// A null watcher marks a face without a surface.
+    std::array<std::shared_ptr<SurfaceWatcher>, 6> faces;
+    /// Frame of the last lookup of the faces without a surface
+    int last_lookup_frame = -1;
 };
 
 class RasterizerCacheOpenGL : NonCopyable {
@@ -274,15 +292,39 @@ public:
     /// Write any cached resources overlapping the region back to memory (if dirty)
     void FlushRegion(PAddr addr, u32 size, Surface flush_surface = nullptr);
 
+    /// Start reading back the dirty parts of the region that were flushed before, so that the
+    /// FlushRegion that needs them later only has to wait for the transfer to finish
+    void StartFlushRegion(PAddr addr, u32 size);
+
     /// Mark region as being invalidated by region_owner (nullptr if 3DS memory)
     void InvalidateRegion(PAddr addr, u32 size, const Surface& region_owner);
 
+    /// Returns whether surfaces hold changes to the region that are not in memory yet
+    bool IsRegionDirty(PAddr addr, u32 size) const;
+
+    /// Marks the pages touching the region as cached, or unmarks them, for copies of memory kept
+    /// outside this cache. Writes to cached pages are reported through InvalidateRegion.
+    void MarkRegionCached(PAddr addr, u32 size, bool cached);
+
     /// Flush all cached resources tracked by this cache manager
     void FlushAll();
 
     /// Clear all cached resources tracked by this cache manager
     void ClearAll(bool flush);
 
+    /**
+     * Removes every surface like ClearAll, but keeps aside the ones holding the contents of the
+     * memory, with the hash of that memory. The surfaces the GPU wrote are flushed first if flush
+     * is true, dropped otherwise.
+     */
+    void DetachSurfaces(bool flush);
+
+    /// Registers again the detached surfaces whose memory hashes the same, drops the others
+    void ReattachSurfaces();
+
+    /// Declared before the surfaces, which hand their textures back to it when destroyed
+    TexturePool texture_pool;
+
 private:
     void DuplicateSurface(const Surface& src_surface, const Surface& dest_surface);
 
@@ -313,21 +355,81 @@ private:
     /// Increase/decrease the number of surface in pages touching the specified region
     void UpdatePagesCachedCount(PAddr addr, u32 size, int delta);
 
+    /// Evict the least recently used clean surfaces and texture cubes while over the VRAM budget
+    void EvictSurfaces();
+
+    /// Invalidate the surfaces waiting for custom textures that have finished decoding
+    void ReloadCustomTextures();
+
+    struct ReadbackBuffer {
+        OGLBuffer buffer;
+        GLsizeiptr size = 0;
+        /// Persistent mapping of the buffer, null when the driver lacks buffer storage
+        const u8* mapped = nullptr;
+    };
+
+    /// A surface readback started by StartFlushRegion that has not been consumed yet
+    struct PendingFlush {
+        Surface surface;
+        SurfaceInterval interval;
+        Common::Rectangle<u32> rect;
+        ReadbackBuffer readback;
+        GLsync fence = nullptr;
+    };
+
+    /// Get a readback buffer of at least size bytes, reusing a free one if possible
+    ReadbackBuffer AcquireReadbackBuffer(GLsizeiptr size);
+
+    /// Waits for a pending readback and copies its pixels into the surface's gl_buffer
+    void FinishPendingFlush(PendingFlush& pending);
+
+    /// Deletes the fence of a pending readback and returns its buffer to the free list
+    void ReleasePendingFlush(PendingFlush& pending);
+
+    /// Drop pending readbacks overlapping the interval, their pixels are outdated
+    void DiscardPendingFlushes(const SurfaceInterval& interval);
+
+    struct DetachedSurface {
+        Surface surface;
+        u64 memory_hash;
+    };
+
     SurfaceCache surface_cache;
-    PageMap cached_pages;
+    CachedPageCounter cached_pages;
+    std::vector<DetachedSurface> detached_surfaces;
     SurfaceMap dirty_regions;
     SurfaceSet remove_surfaces;
 
+    std::vector<PendingFlush> pending_flushes;
+    std::vector<ReadbackBuffer> free_readback_buffers;
+    /// Regions that have been flushed before, which makes them likely to be flushed again
+    SurfaceRegions flushed_regions;
+
+    /// Estimated video memory used by the textures of registered surfaces
+    std::size_t surface_vram_size = 0;
+    int last_eviction_frame = -1;
+    /// Address and size of evicted surfaces, to count the ones that had to be created again
+    std::unordered_set<u64> evicted_surfaces;
+    u64 num_evicted_surfaces = 0;
+    u64 num_refetched_surfaces = 0;
+
     OGLFramebuffer read_framebuffer;
     OGLFramebuffer draw_framebuffer;
 
     u16 resolution_scale_factor;
+    /// Created when dynamic resolution is enabled, picks the scale of the framebuffers below
+    /// resolution_scale_factor
+    std::unique_ptr<ResolutionController> resolution_controller;
 
     std::unordered_map<TextureCubeConfig, CachedTextureCube> texture_cube_cache;
 
 public:
     std::unique_ptr<TextureFilterer> texture_filterer;
     std::unique_ptr<FormatReinterpreterOpenGL> format_reinterpreter;
+    /// Null if the driver does not support compute shaders
+    std::unique_ptr<TextureDecoderOpenGL> texture_decoder;
+    /// Surfaces shown without their custom texture while it is decoded, by texture hash
+    std::unordered_map<u64, std::vector<std::weak_ptr<CachedSurface>>> pending_custom_surfaces;
 };
 
 struct FormatTuple {
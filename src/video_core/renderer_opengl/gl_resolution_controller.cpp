@@ -0,0 +1,106 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <glad/glad.h>
+#include "common/logging/log.h"
+#include "video_core/renderer_opengl/gl_resolution_controller.h"
+
+namespace OpenGL {
+
+/// Weight of a new sample in the moving average of the frame GPU time
+constexpr double SAMPLE_WEIGHT = 0.1;
+/// Frames measured at a scale before it may be lowered
+constexpr u32 MIN_FRAMES_BEFORE_LOWER = 10;
+/// Frames measured at a scale before it may be raised
+constexpr u32 MIN_FRAMES_BEFORE_RAISE = 120;
+/// The scale is lowered when frames take more than this part of the budget
+constexpr double LOWER_THRESHOLD = 0.95;
+/// The scale is raised when frames at the higher scale are estimated to take less than this part
+/// of the budget
+constexpr double RAISE_THRESHOLD = 0.8;
+
+ResolutionController::ResolutionController() {
+    for (auto& query : queries) {
+        query.Create();
+    }
+}
+
+ResolutionController::~ResolutionController() {
+    if (active_query) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+}
+
+u16 ResolutionController::Update(int current_frame, u16 max_scale, double frame_budget) {
+    if (scale == 0 || scale > max_scale) {
+        SetScale(max_scale);
+    }
+    if (current_frame == last_frame) {
+        return scale;
+    }
+    last_frame = current_frame;
+
+    if (active_query) {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending_queries.push_back({*active_query, scale});
+        active_query.reset();
+    }
+
+    while (!pending_queries.empty()) {
+        const PendingQuery pending = pending_queries.front();
+        const GLuint handle = queries[pending.index].handle;
+        GLint available = 0;
+        glGetQueryObjectiv(handle, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(handle, GL_QUERY_RESULT, &elapsed_ns);
+        pending_queries.pop_front();
+        AddSample(static_cast<double>(elapsed_ns) / 1'000'000'000.0, pending.scale, max_scale,
+                  frame_budget);
+    }
+
+    // Queries are used in order, this frame isn't measured if all of them are still in flight
+    if (pending_queries.size() < NUM_QUERIES) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[next_query].handle);
+        active_query = next_query;
+        next_query = (next_query + 1) % NUM_QUERIES;
+    }
+    return scale;
+}
+
+void ResolutionController::AddSample(double gpu_time, u16 sample_scale, u16 max_scale,
+                                     double frame_budget) {
+    // Frames still in flight when the scale changed say nothing about the new one
+    if (sample_scale != scale) {
+        return;
+    }
+    average_gpu_time = average_gpu_time < 0.0
+                           ? gpu_time
+                           : average_gpu_time + (gpu_time - average_gpu_time) * SAMPLE_WEIGHT;
+    ++frames_at_scale;
+
+    if (frames_at_scale >= MIN_FRAMES_BEFORE_LOWER && scale > 1 &&
+        average_gpu_time > frame_budget * LOWER_THRESHOLD) {
+        SetScale(scale - 1);
+        return;
+    }
+    if (frames_at_scale >= MIN_FRAMES_BEFORE_RAISE && scale < max_scale) {
+        // The GPU time mostly follows the number of pixels drawn
+        const double ratio = static_cast<double>(scale + 1) / scale;
+        if (average_gpu_time * ratio * ratio < frame_budget * RAISE_THRESHOLD) {
+            SetScale(scale + 1);
+        }
+    }
+}
+
+void ResolutionController::SetScale(u16 new_scale) {
+    LOG_DEBUG(Render_OpenGL, "Rendering at {}x native resolution", new_scale);
+    scale = new_scale;
+    average_gpu_time = -1.0;
+    frames_at_scale = 0;
+}
+
+} // namespace OpenGL
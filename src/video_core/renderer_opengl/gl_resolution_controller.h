@@ -0,0 +1,62 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+namespace OpenGL {
+
+/**
+ * Picks the scale of the framebuffers drawn by the hardware renderer so that a frame fits in the
+ * GPU time budget. The GPU time of each frame is measured with timer queries, whose results are
+ * read a few frames later without stalling. The scale is lowered as soon as frames take too long
+ * and raised only once there has been room for a while, so that it doesn't flip between two values.
+ */
+class ResolutionController : NonCopyable {
+public:
+    ResolutionController();
+    ~ResolutionController();
+
+    /**
+     * Ends the measurement of the previous frame and starts the one of the current frame, once per
+     * frame. Returns the scale to draw the current frame at, between 1 and max_scale.
+     * @param frame_budget GPU time a frame may take, in seconds
+     */
+    u16 Update(int current_frame, u16 max_scale, double frame_budget);
+
+private:
+    struct PendingQuery {
+        std::size_t index;
+        /// Scale the measured frame was drawn at
+        u16 scale;
+    };
+
+    void AddSample(double gpu_time, u16 sample_scale, u16 max_scale, double frame_budget);
+    void SetScale(u16 new_scale);
+
+    static constexpr std::size_t NUM_QUERIES = 4;
+    std::array<OGLQuery, NUM_QUERIES> queries;
+    /// Queries that have ended and whose result hasn't been read yet, oldest first
+    std::deque<PendingQuery> pending_queries;
+    /// Query measuring the current frame, if any
+    std::optional<std::size_t> active_query;
+    std::size_t next_query = 0;
+    int last_frame = -1;
+
+    u16 scale = 0;
+    /// Moving average of the GPU time of a frame at the current scale in seconds, negative
+    /// without samples
+    double average_gpu_time = -1.0;
+    /// Number of frames measured at the current scale
+    u32 frames_at_scale = 0;
+};
+
+} // namespace OpenGL
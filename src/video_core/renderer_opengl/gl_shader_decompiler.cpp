@@ -2,12 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
 #include <exception>
 #include <map>
 #include <set>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 #include <fmt/format.h>
 #include <nihstro/shader_bytecode.h>
 #include "common/assert.h"
@@ -195,6 +197,219 @@ private:
     }
 };
 
+/**
+ * Finds the instructions writing temporary register components that no other compiled
+ * instruction reads, so that the generator can leave them out. The reads are gathered from the
+ * whole program regardless of the control flow, which keeps the analysis valid across loops and
+ * jumps. Dropping an instruction can make the writes it read from dead too, so the analysis is
+ * repeated until nothing changes.
+ */
+class DeadCodeAnalyzer {
+public:
+    DeadCodeAnalyzer(const Pica::Shader::ProgramCode& program_code,
+                     const Pica::Shader::SwizzleData& swizzle_data,
+                     const RegGetter& outputreg_getter, const std::set<u32>& compiled_offsets) {
+        std::vector<Access> accesses;
+        for (const u32 offset : compiled_offsets) {
+            const Access access = GetAccess(program_code, swizzle_data, outputreg_getter, offset);
+            // The writes to the output registers missing from the output map are dropped by the
+            // generator, along with what they read
+            if (access.discarded) {
+                dead_offsets.insert(offset);
+            } else {
+                accesses.push_back(access);
+            }
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            std::array<u32, 16> read_masks{};
+            for (const auto& access : accesses) {
+                if (dead_offsets.count(access.offset) == 0) {
+                    for (std::size_t i = 0; i < 16; ++i) {
+                        read_masks[i] |= access.read_masks[i];
+                    }
+                }
+            }
+
+            for (const auto& access : accesses) {
+                const bool unread = access.write_reg >= 0 &&
+                                    (read_masks[access.write_reg] & access.write_mask) == 0;
+                if (unread && dead_offsets.insert(access.offset).second) {
+                    changed = true;
+                }
+            }
+
+            if (!changed) {
+                for (std::size_t i = 0; i < 16; ++i) {
+                    used_temporaries[i] = read_masks[i] != 0;
+                }
+                for (const auto& access : accesses) {
+                    if (access.write_reg >= 0 && dead_offsets.count(access.offset) == 0) {
+                        used_temporaries[access.write_reg] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    bool IsDead(u32 offset) const {
+        return dead_offsets.count(offset) != 0;
+    }
+
+    bool IsTemporaryUsed(u32 index) const {
+        return used_temporaries[index];
+    }
+
+private:
+    /// The temporary register components an instruction reads, and the ones it writes if its
+    /// only effect is writing them
+    struct Access {
+        u32 offset;
+        std::array<u32, 16> read_masks{};
+        int write_reg = -1;
+        u32 write_mask = 0;
+        bool discarded = false;
+    };
+
+    /// Adds the components the given source components are swizzled from to the access
+    template <SwizzlePattern::Selector (SwizzlePattern::*getter)(int) const>
+    static void AddRead(Access& access, const SwizzlePattern& swizzle, const SourceRegister& reg,
+                        u32 components) {
+        if (reg.GetRegisterType() != RegisterType::Temporary) {
+            return;
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (components & (1 << i)) {
+                access.read_masks[reg.GetIndex()] |= 1 << static_cast<int>((swizzle.*getter)(i));
+            }
+        }
+    }
+
+    static Access GetAccess(const Pica::Shader::ProgramCode& program_code,
+                            const Pica::Shader::SwizzleData& swizzle_data,
+                            const RegGetter& outputreg_getter, u32 offset) {
+        const Instruction instr = {program_code[offset]};
+        Access access{offset};
+
+        const OpCode::Info info = instr.opcode.Value().GetInfo();
+        if (info.type != OpCode::Type::Arithmetic && info.type != OpCode::Type::MultiplyAdd) {
+            return access;
+        }
+
+        const SwizzlePattern swizzle = {swizzle_data[info.type == OpCode::Type::MultiplyAdd
+                                                         ? instr.mad.operand_desc_id
+                                                         : instr.common.operand_desc_id]};
+        u32 dest_mask = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (swizzle.DestComponentEnabled(i)) {
+                dest_mask |= 1 << i;
+            }
+        }
+        constexpr u32 all = 0xF;
+
+        if (info.type == OpCode::Type::MultiplyAdd) {
+            const OpCode::Id opcode = instr.opcode.Value().EffectiveOpCode();
+            if (opcode != OpCode::Id::MAD && opcode != OpCode::Id::MADI) {
+                return access;
+            }
+            if (instr.mad.dest.Value() < 0x10 &&
+                outputreg_getter(static_cast<u32>(instr.mad.dest.Value().GetIndex())).empty()) {
+                access.discarded = true;
+                return access;
+            }
+            const bool is_inverted = opcode == OpCode::Id::MADI;
+            AddRead<&SwizzlePattern::GetSelectorSrc1>(access, swizzle,
+                                                      instr.mad.GetSrc1(is_inverted), dest_mask);
+            AddRead<&SwizzlePattern::GetSelectorSrc2>(access, swizzle,
+                                                      instr.mad.GetSrc2(is_inverted), dest_mask);
+            AddRead<&SwizzlePattern::GetSelectorSrc3>(access, swizzle,
+                                                      instr.mad.GetSrc3(is_inverted), dest_mask);
+            if (!(instr.mad.dest.Value() < 0x10) && instr.mad.dest.Value() < 0x20) {
+                access.write_reg = static_cast<int>(instr.mad.dest.Value().GetIndex());
+                access.write_mask = dest_mask;
+            }
+            return access;
+        }
+
+        const bool is_inverted = 0 != (info.subtype & OpCode::Info::SrcInversed);
+        const SourceRegister src1 = instr.common.GetSrc1(is_inverted);
+        const SourceRegister src2 = instr.common.GetSrc2(is_inverted);
+        u32 src1_components = 0;
+        u32 src2_components = 0;
+        bool writes_dest = true;
+
+        switch (instr.opcode.Value().EffectiveOpCode()) {
+        case OpCode::Id::ADD:
+        case OpCode::Id::MUL:
+        case OpCode::Id::MAX:
+        case OpCode::Id::MIN:
+        case OpCode::Id::SGE:
+        case OpCode::Id::SGEI:
+        case OpCode::Id::SLT:
+        case OpCode::Id::SLTI:
+            src1_components = src2_components = dest_mask;
+            break;
+        case OpCode::Id::FLR:
+        case OpCode::Id::MOV:
+            src1_components = dest_mask;
+            break;
+        case OpCode::Id::DP3:
+            src1_components = src2_components = 0x7;
+            break;
+        case OpCode::Id::DP4:
+            src1_components = src2_components = all;
+            break;
+        case OpCode::Id::DPH:
+        case OpCode::Id::DPHI:
+            // Without sanitize_mul the generated dot product reads the w of src1 too
+            src1_components = src2_components = all;
+            break;
+        case OpCode::Id::RCP:
+        case OpCode::Id::RSQ:
+        case OpCode::Id::EX2:
+        case OpCode::Id::LG2:
+            src1_components = 0x1;
+            break;
+        case OpCode::Id::MOVA:
+            src1_components = 0x3;
+            writes_dest = false;
+            break;
+        case OpCode::Id::CMP:
+            src1_components = src2_components = 0x3;
+            writes_dest = false;
+            break;
+        default:
+            // Unhandled instructions fail the decompilation anyway
+            return access;
+        }
+
+        // Without a component to write, the generator emits nothing for the instruction
+        if (writes_dest && dest_mask == 0) {
+            return access;
+        }
+
+        const auto dest = instr.common.dest.Value();
+        if (writes_dest && dest.GetRegisterType() == RegisterType::Output &&
+            outputreg_getter(static_cast<u32>(dest.GetIndex())).empty()) {
+            access.discarded = true;
+            return access;
+        }
+
+        AddRead<&SwizzlePattern::GetSelectorSrc1>(access, swizzle, src1, src1_components);
+        AddRead<&SwizzlePattern::GetSelectorSrc2>(access, swizzle, src2, src2_components);
+        if (writes_dest && dest.GetRegisterType() == RegisterType::Temporary) {
+            access.write_reg = static_cast<int>(instr.common.dest.Value().GetIndex());
+            access.write_mask = dest_mask;
+        }
+        return access;
+    }
+
+    std::set<u32> dead_offsets;
+    std::array<bool, 16> used_temporaries{};
+};
+
 class ShaderWriter {
 public:
     // Forwards all arguments directly to libfmt.
@@ -260,16 +475,26 @@ constexpr auto GetSelectorSrc1 = GetSelectorSrc<&SwizzlePattern::GetSelectorSrc1
 constexpr auto GetSelectorSrc2 = GetSelectorSrc<&SwizzlePattern::GetSelectorSrc2>;
 constexpr auto GetSelectorSrc3 = GetSelectorSrc<&SwizzlePattern::GetSelectorSrc3>;
 
+/// Appends a source swizzle to a register, leaving the identity swizzle out
+static void AppendSwizzle(std::string& src, const std::string& selector) {
+    if (selector != "xyzw") {
+        src += '.';
+        src += selector;
+    }
+}
+
 class GLSLGenerator {
 public:
     GLSLGenerator(const std::set<Subroutine>& subroutines,
                   const Pica::Shader::ProgramCode& program_code,
                   const Pica::Shader::SwizzleData& swizzle_data, u32 main_offset,
                   const RegGetter& inputreg_getter, const RegGetter& outputreg_getter,
-                  bool sanitize_mul)
+                  bool sanitize_mul, bool is_gs, const UniformConstants* uniform_constants,
+                  const DeadCodeAnalyzer* dead_code)
         : subroutines(subroutines), program_code(program_code), swizzle_data(swizzle_data),
           main_offset(main_offset), inputreg_getter(inputreg_getter),
-          outputreg_getter(outputreg_getter), sanitize_mul(sanitize_mul) {
+          outputreg_getter(outputreg_getter), sanitize_mul(sanitize_mul), is_gs(is_gs),
+          uniform_constants(uniform_constants), dead_code(dead_code) {
 
         Generate();
     }
@@ -278,6 +503,11 @@ public:
         return shader.MoveResult();
     }
 
+    /// Returns the offsets of all instructions the program was generated from
+    const std::set<u32>& GetCompiledOffsets() const {
+        return compiled_offsets;
+    }
+
 private:
     /// Gets the Subroutine object corresponding to the specified address.
     const Subroutine& GetSubroutine(u32 begin, u32 end) const {
@@ -358,9 +588,20 @@ private:
 
     /// Generates code representing a bool uniform
     std::string GetUniformBool(u32 index) const {
+        if (uniform_constants) {
+            return uniform_constants->b[index] ? "true" : "false";
+        }
         return fmt::format("uniforms.b[{}]", index);
     }
 
+    /// Generates code representing a component of an int uniform, as a uint
+    std::string GetUniformInt(u32 index, std::size_t component) const {
+        if (uniform_constants) {
+            return fmt::format("{}u", uniform_constants->i[index][component]);
+        }
+        return fmt::format("uniforms.i[{}].{}", index, "xyzw"[component]);
+    }
+
     /**
      * Adds code that calls a subroutine.
      * @param subroutine the subroutine to call.
@@ -401,8 +642,10 @@ private:
         }
         DEBUG_ASSERT(value_num_components >= dest_num_components || value_num_components == 1);
 
-        const std::string dest =
-            fmt::format("{}{}", reg, dest_num_components != 1 ? dest_mask_swizzle : "");
+        // A write to all components of a vector needs no mask
+        const bool full_mask = dest_num_components == 4 && dest_mask_num_components == 4;
+        const std::string dest = fmt::format(
+            "{}{}", reg, dest_num_components != 1 && !full_mask ? dest_mask_swizzle : "");
 
         std::string src{value};
         if (value_num_components == 1) {
@@ -432,6 +675,11 @@ private:
                 : instr.common.operand_desc_id;
         const SwizzlePattern swizzle = {swizzle_data[swizzle_offset]};
 
+        compiled_offsets.insert(offset);
+        if (dead_code && dead_code->IsDead(offset)) {
+            return offset + 1;
+        }
+
         shader.AddLine("// {}: {}", offset, instr.opcode.Value().GetInfo().name);
 
         switch (instr.opcode.Value().GetInfo().type) {
@@ -442,12 +690,12 @@ private:
             std::string src1 = swizzle.negate_src1 ? "-" : "";
             src1 += GetSourceRegister(instr.common.GetSrc1(is_inverted),
                                       !is_inverted * instr.common.address_register_index);
-            src1 += "." + GetSelectorSrc1(swizzle);
+            AppendSwizzle(src1, GetSelectorSrc1(swizzle));
 
             std::string src2 = swizzle.negate_src2 ? "-" : "";
             src2 += GetSourceRegister(instr.common.GetSrc2(is_inverted),
                                       is_inverted * instr.common.address_register_index);
-            src2 += "." + GetSelectorSrc2(swizzle);
+            AppendSwizzle(src2, GetSelectorSrc2(swizzle));
 
             std::string dest_reg = GetDestRegister(instr.common.dest.Value());
 
@@ -603,17 +851,17 @@ private:
 
                 std::string src1 = swizzle.negate_src1 ? "-" : "";
                 src1 += GetSourceRegister(instr.mad.GetSrc1(is_inverted), 0);
-                src1 += "." + GetSelectorSrc1(swizzle);
+                AppendSwizzle(src1, GetSelectorSrc1(swizzle));
 
                 std::string src2 = swizzle.negate_src2 ? "-" : "";
                 src2 += GetSourceRegister(instr.mad.GetSrc2(is_inverted),
                                           !is_inverted * instr.mad.address_register_index);
-                src2 += "." + GetSelectorSrc2(swizzle);
+                AppendSwizzle(src2, GetSelectorSrc2(swizzle));
 
                 std::string src3 = swizzle.negate_src3 ? "-" : "";
                 src3 += GetSourceRegister(instr.mad.GetSrc3(is_inverted),
                                           is_inverted * instr.mad.address_register_index);
-                src3 += "." + GetSelectorSrc3(swizzle);
+                AppendSwizzle(src3, GetSelectorSrc3(swizzle));
 
                 std::string dest_reg =
                     (instr.mad.dest.Value() < 0x10)
@@ -744,15 +992,17 @@ private:
             }
 
             case OpCode::Id::LOOP: {
-                const std::string int_uniform =
-                    fmt::format("uniforms.i[{}]", instr.flow_control.int_uniform_id.Value());
+                const u32 int_uniform_id = instr.flow_control.int_uniform_id.Value();
 
-                shader.AddLine("address_registers.z = int({}.y);", int_uniform);
+                shader.AddLine("address_registers.z = int({});",
+                               GetUniformInt(int_uniform_id, 1));
 
+                // With constant uniforms, the loop bounds are known to the GLSL compiler
                 const std::string loop_var = fmt::format("loop{}", offset);
                 shader.AddLine(
-                    "for (uint {} = 0u; {} <= {}.x; address_registers.z += int({}.z), ++{}) {{",
-                    loop_var, loop_var, int_uniform, int_uniform, loop_var);
+                    "for (uint {} = 0u; {} <= {}; address_registers.z += int({}), ++{}) {{",
+                    loop_var, loop_var, GetUniformInt(int_uniform_id, 0),
+                    GetUniformInt(int_uniform_id, 2), loop_var);
                 ++shader.scope;
 
                 auto& loop_sub = GetSubroutine(offset + 1, instr.flow_control.dest_offset + 1);
@@ -769,10 +1019,26 @@ private:
                 break;
             }
 
-            case OpCode::Id::EMIT:
-            case OpCode::Id::SETEMIT:
-                LOG_ERROR(HW_GPU, "Geometry shader operation detected in vertex shader");
+            case OpCode::Id::EMIT: {
+                if (is_gs) {
+                    shader.AddLine("emit();");
+                } else {
+                    LOG_ERROR(HW_GPU, "Geometry shader operation detected in vertex shader");
+                }
+                break;
+            }
+
+            case OpCode::Id::SETEMIT: {
+                if (is_gs) {
+                    ASSERT(instr.setemit.vertex_id < 3);
+                    shader.AddLine("setemit({}u, {}, {});", instr.setemit.vertex_id.Value(),
+                                   instr.setemit.prim_emit != 0 ? "true" : "false",
+                                   instr.setemit.winding != 0 ? "true" : "false");
+                } else {
+                    LOG_ERROR(HW_GPU, "Geometry shader operation detected in vertex shader");
+                }
                 break;
+            }
 
             default: {
                 LOG_ERROR(HW_GPU, "Unhandled instruction: 0x{:02x} ({}): 0x{:08x}",
@@ -817,8 +1083,10 @@ private:
         // Add declarations for registers
         shader.AddLine("bvec2 conditional_code = bvec2(false);");
         shader.AddLine("ivec3 address_registers = ivec3(0);");
-        for (int i = 0; i < 16; ++i) {
-            shader.AddLine("vec4 reg_tmp{} = vec4(0.0, 0.0, 0.0, 1.0);", i);
+        for (u32 i = 0; i < 16; ++i) {
+            if (!dead_code || dead_code->IsTemporaryUsed(i)) {
+                shader.AddLine("vec4 reg_tmp{} = vec4(0.0, 0.0, 0.0, 1.0);", i);
+            }
         }
         shader.AddNewLine();
 
@@ -896,7 +1164,13 @@ private:
     const RegGetter& inputreg_getter;
     const RegGetter& outputreg_getter;
     const bool sanitize_mul;
+    const bool is_gs;
+    /// The uniform values folded into the program, null for a program reading the uniforms
+    const UniformConstants* uniform_constants;
+    /// The instructions to leave out, null to compile every instruction
+    const DeadCodeAnalyzer* dead_code;
 
+    std::set<u32> compiled_offsets;
     ShaderWriter shader;
 };
 
@@ -917,12 +1191,21 @@ std::optional<ProgramResult> DecompileProgram(const Pica::Shader::ProgramCode& p
                                               const Pica::Shader::SwizzleData& swizzle_data,
                                               u32 main_offset, const RegGetter& inputreg_getter,
                                               const RegGetter& outputreg_getter,
-                                              bool sanitize_mul) {
+                                              bool sanitize_mul, bool is_gs,
+                                              const UniformConstants* uniform_constants) {
 
     try {
         auto subroutines = ControlFlowAnalyzer(program_code, main_offset).MoveSubroutines();
+        // A first pass finds the instructions making up the program, and a second one generates
+        // the program again without the dead ones
+        const GLSLGenerator full_generator(subroutines, program_code, swizzle_data, main_offset,
+                                           inputreg_getter, outputreg_getter, sanitize_mul,
+                                           is_gs, uniform_constants, nullptr);
+        const DeadCodeAnalyzer dead_code(program_code, swizzle_data, outputreg_getter,
+                                         full_generator.GetCompiledOffsets());
         GLSLGenerator generator(subroutines, program_code, swizzle_data, main_offset,
-                                inputreg_getter, outputreg_getter, sanitize_mul);
+                                inputreg_getter, outputreg_getter, sanitize_mul, is_gs,
+                                uniform_constants, &dead_code);
         return {ProgramResult{generator.MoveShaderCode()}};
     } catch (const DecompileFail& exception) {
         LOG_INFO(HW_GPU, "Shader decompilation failed: {}", exception.what());
@@ -19,11 +19,19 @@ struct ProgramResult {
     std::string code;
 };
 
+/// Values of the bool and int uniforms folded into a specialized program
+struct UniformConstants {
+    std::array<bool, 16> b;
+    std::array<std::array<u8, 4>, 4> i;
+};
+
 std::string GetCommonDeclarations();
 
 std::optional<ProgramResult> DecompileProgram(const Pica::Shader::ProgramCode& program_code,
                                               const Pica::Shader::SwizzleData& swizzle_data,
                                               u32 main_offset, const RegGetter& inputreg_getter,
-                                              const RegGetter& outputreg_getter, bool sanitize_mul);
+                                              const RegGetter& outputreg_getter, bool sanitize_mul,
+                                              bool is_gs,
+                                              const UniformConstants* uniform_constants = nullptr);
 
 } // namespace OpenGL::ShaderDecompiler
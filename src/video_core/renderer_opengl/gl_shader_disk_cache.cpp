@@ -9,6 +9,7 @@
 #include "common/common_paths.h"
 #include "common/common_types.h"
 #include "common/file_util.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/scm_rev.h"
 #include "common/zstd_compression.h"
@@ -24,6 +25,7 @@ using ShaderCacheVersionHash = std::array<u8, HASH_LENGTH>;
 
 enum class TransferableEntryKind : u32 {
     Raw,
+    Blob,
 };
 
 enum class PrecompiledEntryKind : u32 {
@@ -31,7 +33,30 @@ enum class PrecompiledEntryKind : u32 {
     Dump,
 };
 
-constexpr u32 NativeVersion = 1;
+/// Version 1 stored every raw entry in full, one after another
+constexpr u32 LegacyVersion = 1;
+constexpr u32 NativeVersion = 2;
+
+/**
+ * Starting with version 2, the transferable file is a sequence of records, each prefixed with its
+ * kind and payload size so that readers can skip over them. Blob records hold zstd compressed
+ * data keyed by its hash. Raw records refer to the blobs holding their program code and their
+ * registers, which are split into fixed size blocks so that entries share the blocks they have in
+ * common. New records are only ever appended.
+ */
+struct TransferableRecordHeader {
+    TransferableEntryKind kind;
+    u32 size;
+};
+static_assert(sizeof(TransferableRecordHeader) == 8);
+
+/// Number of register words stored in each register blob
+constexpr std::size_t REGISTER_BLOCK_WORDS = 64;
+constexpr std::size_t NUM_REGISTER_BLOCKS = Pica::Regs::NUM_REGS / REGISTER_BLOCK_WORDS;
+static_assert(Pica::Regs::NUM_REGS % REGISTER_BLOCK_WORDS == 0);
+
+/// Code hash of raw entries without program code
+constexpr u64 NO_PROGRAM_CODE = 0;
 
 ShaderCacheVersionHash GetShaderCacheVersionHash() {
     ShaderCacheVersionHash hash{};
@@ -75,33 +100,6 @@ bool ShaderDiskCacheRaw::Load(FileUtil::IOFile& file) {
     return true;
 }
 
-bool ShaderDiskCacheRaw::Save(FileUtil::IOFile& file) const {
-    if (file.WriteObject(unique_identifier) != 1 ||
-        file.WriteObject(static_cast<u32>(program_type)) != 1) {
-        return false;
-    }
-
-    // Just for future proofing, save the sizes of the array to the file
-    const std::size_t reg_array_len = Pica::Regs::NUM_REGS;
-    if (file.WriteObject(static_cast<u64>(reg_array_len)) != 1) {
-        return false;
-    }
-    if (file.WriteArray(config.reg_array.data(), reg_array_len) != reg_array_len) {
-        return false;
-    }
-
-    if (program_type == ProgramType::VS) {
-        const std::size_t code_len = program_code.size();
-        if (file.WriteObject(static_cast<u64>(code_len)) != 1) {
-            return false;
-        }
-        if (file.WriteArray(program_code.data(), code_len) != code_len) {
-            return false;
-        }
-    }
-    return true;
-}
-
 ShaderDiskCache::ShaderDiskCache(bool separable) : separable{separable} {}
 
 std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable() {
@@ -118,6 +116,11 @@ std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable
                  GetTitleID());
         return std::nullopt;
     }
+    // Other instances may be appending to a shared cache
+    if (!file.Lock()) {
+        LOG_WARNING(Render_OpenGL, "Failed to lock transferable file, it may be read while being "
+                                   "written to");
+    }
 
     u32 version{};
     if (file.ReadBytes(&version, sizeof(version)) != sizeof(version)) {
@@ -127,7 +130,7 @@ std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable
         return std::nullopt;
     }
 
-    if (version < NativeVersion) {
+    if (version < LegacyVersion) {
         LOG_INFO(Render_OpenGL, "Transferable shader cache is old - removing");
         file.Close();
         InvalidateAll();
@@ -140,6 +143,40 @@ std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable
     }
 
     // Version is valid, load the shaders
+    auto raws = version == LegacyVersion ? LoadLegacyTransferableFile(file)
+                                         : LoadTransferableFile(file);
+    file.Close();
+    if (!raws) {
+        return std::nullopt;
+    }
+
+    if (version == LegacyVersion) {
+        LOG_INFO(Render_OpenGL, "Converting transferable shader cache to the current format");
+        if (!FileUtil::Delete(GetTransferablePath())) {
+            LOG_ERROR(Render_OpenGL, "Failed to remove the old transferable file - skipping");
+            return std::nullopt;
+        }
+        FileUtil::IOFile new_file = AppendTransferableFile();
+        for (const auto& raw : *raws) {
+            if (!new_file.IsOpen() || !SaveRawEntry(new_file, raw)) {
+                LOG_ERROR(Render_OpenGL, "Failed to convert transferable file - removing");
+                new_file.Close();
+                InvalidateAll();
+                return std::nullopt;
+            }
+        }
+    }
+
+    for (const auto& raw : *raws) {
+        transferable.insert(raw.GetUniqueIdentifier());
+    }
+
+    LOG_INFO(Render_OpenGL, "Found a transferable disk cache with {} entries", raws->size());
+    return raws;
+}
+
+std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadLegacyTransferableFile(
+    FileUtil::IOFile& file) {
     std::vector<ShaderDiskCacheRaw> raws;
     while (file.Tell() < file.GetSize()) {
         TransferableEntryKind kind{};
@@ -155,7 +192,6 @@ std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable
                 LOG_ERROR(Render_OpenGL, "Failed to load transferable raw entry - skipping");
                 return std::nullopt;
             }
-            transferable.emplace(entry.GetUniqueIdentifier(), ShaderDiskCacheRaw{});
             raws.push_back(std::move(entry));
             break;
         }
@@ -165,11 +201,217 @@ std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferable
             return std::nullopt;
         }
     }
+    return {std::move(raws)};
+}
+
+std::optional<std::vector<ShaderDiskCacheRaw>> ShaderDiskCache::LoadTransferableFile(
+    FileUtil::IOFile& file) {
+    // Read the file in one go, many small reads are slow on network storage
+    std::vector<u8> data(file.GetSize() - file.Tell());
+    if (file.ReadBytes(data.data(), data.size()) != data.size()) {
+        LOG_ERROR(Render_OpenGL, "Failed to read transferable file - skipping");
+        return std::nullopt;
+    }
+
+    std::size_t offset = 0;
+    const auto read = [&data, &offset](auto& object) {
+        if (data.size() - offset < sizeof(object)) {
+            return false;
+        }
+        std::memcpy(&object, data.data() + offset, sizeof(object));
+        offset += sizeof(object);
+        return true;
+    };
 
-    LOG_INFO(Render_OpenGL, "Found a transferable disk cache with {} entries", raws.size());
+    // Build the index of the blobs, they are only decompressed once an entry needs them
+    struct BlobLocation {
+        std::size_t offset;
+        std::size_t size;
+    };
+    struct RawRecord {
+        u64 unique_identifier;
+        ProgramType program_type;
+        u64 code_hash;
+        std::array<u64, NUM_REGISTER_BLOCKS> register_block_hashes;
+    };
+    std::unordered_map<u64, BlobLocation> blobs;
+    std::vector<RawRecord> records;
+    std::unordered_set<u64> record_ids;
+    while (offset < data.size()) {
+        TransferableRecordHeader header{};
+        if (!read(header) || data.size() - offset < header.size) {
+            LOG_ERROR(Render_OpenGL, "Truncated transferable file - skipping");
+            return std::nullopt;
+        }
+        const std::size_t record_end = offset + header.size;
+
+        switch (header.kind) {
+        case TransferableEntryKind::Raw: {
+            RawRecord record{};
+            u32 num_register_blocks{};
+            if (!read(record.unique_identifier) || !read(record.program_type) ||
+                !read(record.code_hash) || !read(num_register_blocks) ||
+                num_register_blocks != NUM_REGISTER_BLOCKS ||
+                !read(record.register_block_hashes) || offset != record_end) {
+                LOG_ERROR(Render_OpenGL, "Failed to load transferable raw entry - skipping");
+                return std::nullopt;
+            }
+            // Instances sharing a cache can append the same entry before seeing each other's
+            if (record_ids.insert(record.unique_identifier).second) {
+                records.push_back(record);
+            }
+            break;
+        }
+        case TransferableEntryKind::Blob: {
+            u64 hash{};
+            if (!read(hash) || offset > record_end) {
+                LOG_ERROR(Render_OpenGL, "Failed to load transferable blob - skipping");
+                return std::nullopt;
+            }
+            blobs.insert({hash, {offset, record_end - offset}});
+            saved_blobs.insert(hash);
+            break;
+        }
+        default:
+            LOG_ERROR(Render_OpenGL, "Unknown transferable shader cache entry kind={} - skipping",
+                      static_cast<u32>(header.kind));
+            return std::nullopt;
+        }
+        offset = record_end;
+    }
+
+    std::unordered_map<u64, std::vector<u8>> decompressed_blobs;
+    const auto get_blob = [&](u64 hash) -> const std::vector<u8>* {
+        if (const auto it = decompressed_blobs.find(hash); it != decompressed_blobs.end()) {
+            return &it->second;
+        }
+        const auto location = blobs.find(hash);
+        if (location == blobs.end()) {
+            return nullptr;
+        }
+        const auto begin = data.begin() + location->second.offset;
+        std::vector<u8> blob = Common::Compression::DecompressDataZSTD(
+            std::vector<u8>(begin, begin + location->second.size));
+        if (blob.empty()) {
+            return nullptr;
+        }
+        return &decompressed_blobs.emplace(hash, std::move(blob)).first->second;
+    };
+
+    std::vector<ShaderDiskCacheRaw> raws;
+    raws.reserve(records.size());
+    for (const auto& record : records) {
+        RawShaderConfig config{};
+        for (std::size_t i = 0; i < NUM_REGISTER_BLOCKS; ++i) {
+            const auto* block = get_blob(record.register_block_hashes[i]);
+            if (!block || block->size() != REGISTER_BLOCK_WORDS * sizeof(u32)) {
+                LOG_ERROR(Render_OpenGL, "Missing register block in entry={:016x} - skipping",
+                          record.unique_identifier);
+                return std::nullopt;
+            }
+            std::memcpy(config.reg_array.data() + i * REGISTER_BLOCK_WORDS, block->data(),
+                        block->size());
+        }
+
+        ProgramCode program_code;
+        if (record.code_hash != NO_PROGRAM_CODE) {
+            const auto* code = get_blob(record.code_hash);
+            if (!code || code->size() % sizeof(u32) != 0) {
+                LOG_ERROR(Render_OpenGL, "Missing program code in entry={:016x} - skipping",
+                          record.unique_identifier);
+                return std::nullopt;
+            }
+            program_code.resize(code->size() / sizeof(u32));
+            std::memcpy(program_code.data(), code->data(), code->size());
+        }
+
+        raws.emplace_back(record.unique_identifier, record.program_type, config,
+                          std::move(program_code));
+    }
     return {std::move(raws)};
 }
 
+bool ShaderDiskCache::MergeTransferableFiles(const std::string& destination,
+                                             const std::vector<std::string>& sources) {
+    FileUtil::IOFile file(destination, "a+b");
+    if (!file.IsOpen()) {
+        LOG_ERROR(Render_OpenGL, "Failed to open transferable cache in path={}", destination);
+        return false;
+    }
+    if (!file.Lock()) {
+        LOG_WARNING(Render_OpenGL, "Failed to lock transferable cache in path={}", destination);
+    }
+
+    // Find out which entries and blobs the destination already holds
+    ShaderDiskCache cache{false};
+    if (file.GetSize() == 0) {
+        if (file.WriteObject(NativeVersion) != 1) {
+            LOG_ERROR(Render_OpenGL, "Failed to write transferable cache version in path={}",
+                      destination);
+            return false;
+        }
+    } else {
+        u32 version{};
+        file.Seek(0, SEEK_SET);
+        if (file.ReadBytes(&version, sizeof(version)) != sizeof(version) ||
+            version != NativeVersion) {
+            LOG_ERROR(Render_OpenGL, "Transferable cache in path={} is not in the current format, "
+                                     "load it once in the emulator to convert it", destination);
+            return false;
+        }
+        const auto raws = cache.LoadTransferableFile(file);
+        if (!raws) {
+            return false;
+        }
+        for (const auto& raw : *raws) {
+            cache.transferable.insert(raw.GetUniqueIdentifier());
+        }
+        // Switching from reading to writing requires a seek
+        file.Seek(0, SEEK_END);
+    }
+
+    for (const auto& source : sources) {
+        FileUtil::IOFile source_file(source, "rb");
+        if (!source_file.IsOpen()) {
+            LOG_ERROR(Render_OpenGL, "Failed to open transferable cache in path={}", source);
+            return false;
+        }
+        source_file.Lock();
+
+        // Loading records the blobs as saved, which only holds for the destination
+        ShaderDiskCache reader{false};
+        u32 version{};
+        std::optional<std::vector<ShaderDiskCacheRaw>> raws;
+        if (source_file.ReadBytes(&version, sizeof(version)) == sizeof(version)) {
+            if (version == LegacyVersion) {
+                raws = reader.LoadLegacyTransferableFile(source_file);
+            } else if (version == NativeVersion) {
+                raws = reader.LoadTransferableFile(source_file);
+            }
+        }
+        if (!raws) {
+            LOG_ERROR(Render_OpenGL, "Failed to load transferable cache in path={}", source);
+            return false;
+        }
+
+        std::size_t num_merged = 0;
+        for (const auto& raw : *raws) {
+            if (!cache.transferable.insert(raw.GetUniqueIdentifier()).second) {
+                continue;
+            }
+            if (!cache.SaveRawEntry(file, raw)) {
+                LOG_ERROR(Render_OpenGL, "Failed to write transferable cache in path={}",
+                          destination);
+                return false;
+            }
+            ++num_merged;
+        }
+        LOG_INFO(Render_OpenGL, "Merged {} of {} entries from path={}", num_merged, raws->size(),
+                 source);
+    }
+    return file.Unlock();
+}
+
 std::pair<std::unordered_map<u64, ShaderDiskCacheDecompiled>, ShaderDumpsMap>
 ShaderDiskCache::LoadPrecompiled() {
     if (!IsUsable())
@@ -311,6 +553,9 @@ void ShaderDiskCache::InvalidateAll() {
         LOG_ERROR(Render_OpenGL, "Failed to invalidate transferable file={}",
                   GetTransferablePath());
     }
+    // New entries must not refer to the blobs of the deleted file
+    transferable.clear();
+    saved_blobs.clear();
     InvalidatePrecompiled();
 }
 
@@ -336,13 +581,66 @@ void ShaderDiskCache::SaveRaw(const ShaderDiskCacheRaw& entry) {
     FileUtil::IOFile file = AppendTransferableFile();
     if (!file.IsOpen())
         return;
-    if (file.WriteObject(TransferableEntryKind::Raw) != 1 || !entry.Save(file)) {
+    if (!SaveRawEntry(file, entry)) {
         LOG_ERROR(Render_OpenGL, "Failed to save raw transferable cache entry - removing");
         file.Close();
         InvalidateAll();
         return;
     }
-    transferable.insert({id, entry});
+    transferable.insert(id);
+}
+
+bool ShaderDiskCache::SaveRawEntry(FileUtil::IOFile& file, const ShaderDiskCacheRaw& entry) {
+    const auto& reg_array = entry.GetRawShaderConfig().reg_array;
+    std::array<u64, NUM_REGISTER_BLOCKS> register_block_hashes;
+    for (std::size_t i = 0; i < NUM_REGISTER_BLOCKS; ++i) {
+        const u32* block = reg_array.data() + i * REGISTER_BLOCK_WORDS;
+        register_block_hashes[i] = Common::ComputeHash64(block, REGISTER_BLOCK_WORDS * sizeof(u32));
+        if (!SaveBlob(file, register_block_hashes[i], block, REGISTER_BLOCK_WORDS * sizeof(u32))) {
+            return false;
+        }
+    }
+
+    u64 code_hash = NO_PROGRAM_CODE;
+    const auto& program_code = entry.GetProgramCode();
+    if (!program_code.empty()) {
+        const std::size_t code_size = program_code.size() * sizeof(u32);
+        code_hash = Common::ComputeHash64(program_code.data(), code_size);
+        if (!SaveBlob(file, code_hash, program_code.data(), code_size)) {
+            return false;
+        }
+    }
+
+    const TransferableRecordHeader header{
+        TransferableEntryKind::Raw,
+        static_cast<u32>(sizeof(u64) + sizeof(ProgramType) + sizeof(u64) + sizeof(u32) +
+                         sizeof(register_block_hashes))};
+    return file.WriteObject(header) == 1 && file.WriteObject(entry.GetUniqueIdentifier()) == 1 &&
+           file.WriteObject(entry.GetProgramType()) == 1 && file.WriteObject(code_hash) == 1 &&
+           file.WriteObject(static_cast<u32>(NUM_REGISTER_BLOCKS)) == 1 &&
+           file.WriteObject(register_block_hashes) == 1;
+}
+
+bool ShaderDiskCache::SaveBlob(FileUtil::IOFile& file, u64 hash, const void* data,
+                               std::size_t size) {
+    if (saved_blobs.find(hash) != saved_blobs.end()) {
+        return true;
+    }
+
+    const std::vector<u8> compressed =
+        Common::Compression::CompressDataZSTDDefault(static_cast<const u8*>(data), size);
+    if (compressed.empty()) {
+        return false;
+    }
+
+    const TransferableRecordHeader header{TransferableEntryKind::Blob,
+                                          static_cast<u32>(sizeof(u64) + compressed.size())};
+    if (file.WriteObject(header) != 1 || file.WriteObject(hash) != 1 ||
+        file.WriteBytes(compressed.data(), compressed.size()) != compressed.size()) {
+        return false;
+    }
+    saved_blobs.insert(hash);
+    return true;
 }
 
 void ShaderDiskCache::SaveDecompiled(u64 unique_identifier,
@@ -394,14 +692,21 @@ FileUtil::IOFile ShaderDiskCache::AppendTransferableFile() {
         return {};
 
     const auto transferable_path{GetTransferablePath()};
-    const bool existed = FileUtil::Exists(transferable_path);
 
     FileUtil::IOFile file(transferable_path, "ab");
     if (!file.IsOpen()) {
         LOG_ERROR(Render_OpenGL, "Failed to open transferable cache in path={}", transferable_path);
         return {};
     }
-    if (!existed || file.GetSize() == 0) {
+    // Keeps the records of instances sharing the file from interleaving, until the file is closed
+    if (!file.Lock()) {
+        LOG_WARNING(Render_OpenGL, "Failed to lock transferable cache in path={}",
+                    transferable_path);
+    }
+    if (file.GetSize() == 0) {
+        // Another instance may have removed the file, none of the known blobs are stored in it
+        saved_blobs.clear();
+
         // If the file didn't exist, write its version
         if (file.WriteObject(NativeVersion) != 1) {
             LOG_ERROR(Render_OpenGL, "Failed to write transferable cache version in path={}",
@@ -449,8 +754,17 @@ bool ShaderDiskCache::EnsureDirectories() const {
         return true;
     };
 
+    const auto CreateFullPath = [](const std::string& dir) {
+        if (!FileUtil::CreateFullPath(dir + DIR_SEP)) {
+            LOG_ERROR(Render_OpenGL, "Failed to create directory={}", dir);
+            return false;
+        }
+        return true;
+    };
+
+    // The shared cache directory may be anywhere
     return CreateDir(FileUtil::GetUserPath(FileUtil::UserPath::ShaderDir)) &&
-           CreateDir(GetBaseDir()) && CreateDir(GetTransferableDir()) &&
+           CreateDir(GetBaseDir()) && CreateFullPath(GetTransferableDir()) &&
            CreateDir(GetPrecompiledDir());
 }
 
@@ -463,6 +777,11 @@ std::string ShaderDiskCache::GetPrecompiledPath() {
 }
 
 std::string ShaderDiskCache::GetTransferableDir() const {
+    // Transferable entries don't depend on the driver, so instances can share them
+    if (!Settings::values.shared_shader_cache_dir.empty()) {
+        return FileUtil::SanitizePath(Settings::values.shared_shader_cache_dir +
+                                      DIR_SEP "opengl" DIR_SEP "transferable");
+    }
     return GetBaseDir() + DIR_SEP "transferable";
 }
 
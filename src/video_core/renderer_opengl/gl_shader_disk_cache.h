@@ -49,10 +49,9 @@ public:
     ShaderDiskCacheRaw() = default;
     ~ShaderDiskCacheRaw() = default;
 
+    /// Loads an entry stored in the legacy transferable format
     bool Load(FileUtil::IOFile& file);
 
-    bool Save(FileUtil::IOFile& file) const;
-
     u64 GetUniqueIdentifier() const {
         return unique_identifier;
     }
@@ -118,7 +117,31 @@ public:
     /// Serializes virtual precompiled shader cache file to real file
     void SaveVirtualPrecompiledFile();
 
+    /**
+     * Appends the entries of the source transferable files that are missing from the destination
+     * one, creating it if needed. Every file is locked while it is used, so the files may belong to
+     * running instances. Returns true on success.
+     */
+    static bool MergeTransferableFiles(const std::string& destination,
+                                       const std::vector<std::string>& sources);
+
 private:
+    /// Loads the raw entries of a transferable file in the legacy format. Returns empty on failure.
+    std::optional<std::vector<ShaderDiskCacheRaw>> LoadLegacyTransferableFile(
+        FileUtil::IOFile& file);
+
+    /// Loads the raw entries of a transferable file in the current format. Returns empty on
+    /// failure.
+    std::optional<std::vector<ShaderDiskCacheRaw>> LoadTransferableFile(FileUtil::IOFile& file);
+
+    /// Appends a raw entry and the blobs it needs to the transferable file. Returns true on
+    /// success.
+    bool SaveRawEntry(FileUtil::IOFile& file, const ShaderDiskCacheRaw& entry);
+
+    /// Appends a compressed blob to the transferable file unless it is already stored there.
+    /// Returns true on success.
+    bool SaveBlob(FileUtil::IOFile& file, u64 hash, const void* data, std::size_t size);
+
     /// Loads the transferable cache. Returns empty on failure.
     std::optional<std::pair<ShaderDecompiledMap, ShaderDumpsMap>> LoadPrecompiledFile(
         FileUtil::IOFile& file);
@@ -203,8 +226,10 @@ private:
     // Stores the current offset of the precompiled cache file for IO purposes
     std::size_t decompressed_precompiled_cache_offset = 0;
 
-    // Stored transferable shaders
-    std::unordered_map<u64, ShaderDiskCacheRaw> transferable;
+    // Identifiers of the stored transferable shaders
+    std::unordered_set<u64> transferable;
+    // Hashes of the blobs stored in the transferable file
+    std::unordered_set<u64> saved_blobs;
 
     // The cache has been loaded at boot
     bool tried_to_load{};
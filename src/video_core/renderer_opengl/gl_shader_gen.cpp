@@ -4,6 +4,7 @@
 
 #include <array>
 #include <cstddef>
+#include <cstring>
 #include <string_view>
 #include <fmt/format.h>
 #include "common/assert.h"
@@ -110,6 +111,183 @@ out gl_PerVertex {
     return out;
 }
 
+/// Number of arguments a TEV combiner operation reads, all three for an unknown operation
+static unsigned NumCombinerArgs(TevStageConfig::Operation operation, bool alpha) {
+    using Operation = TevStageConfig::Operation;
+    switch (operation) {
+    case Operation::Replace:
+        return 1;
+    case Operation::Modulate:
+    case Operation::Add:
+    case Operation::AddSigned:
+    case Operation::Subtract:
+        return 2;
+    case Operation::Dot3_RGB:
+    case Operation::Dot3_RGBA:
+        // The alpha combiner doesn't implement the dot products, its output is zero
+        return alpha ? 0 : 2;
+    default:
+        return 3;
+    }
+}
+
+/**
+ * Clears the fields of a TEV stage its operations don't read, which makes all pass-through stages
+ * identical.
+ * @returns the mask of the sources read by the stage, bit n for the source of value n
+ */
+static u32 CanonicalizeTevStage(TevStageConfigRaw& stage) {
+    const auto color_op = static_cast<TevStageConfig::Operation>(stage.ops_raw & 0xF);
+    // Dot3_RGBA also places its result in the alpha component, the alpha combiner isn't used
+    const bool alpha_used = color_op != TevStageConfig::Operation::Dot3_RGBA;
+    const auto alpha_op = static_cast<TevStageConfig::Operation>((stage.ops_raw >> 16) & 0xF);
+
+    u32 sources = 0;
+    u32 modifiers = 0;
+    u32 sources_read = 0;
+    for (unsigned i = 0; i < NumCombinerArgs(color_op, false); ++i) {
+        const u32 source = (stage.sources_raw >> (4 * i)) & 0xF;
+        sources |= source << (4 * i);
+        modifiers |= stage.modifiers_raw & (0xFu << (4 * i));
+        sources_read |= 1u << source;
+    }
+    if (alpha_used) {
+        for (unsigned i = 0; i < NumCombinerArgs(alpha_op, true); ++i) {
+            const u32 source = (stage.sources_raw >> (16 + 4 * i)) & 0xF;
+            sources |= source << (16 + 4 * i);
+            modifiers |= stage.modifiers_raw & (0x7u << (12 + 4 * i));
+            sources_read |= 1u << source;
+        }
+    }
+
+    // A scale of 3 multiplies by one, like a scale of 0
+    const auto canonical_scale = [](u32 scale) { return scale == 3 ? 0 : scale; };
+
+    stage.sources_raw = sources;
+    stage.modifiers_raw = modifiers;
+    stage.ops_raw = static_cast<u32>(color_op);
+    if (alpha_used) {
+        stage.ops_raw |= static_cast<u32>(alpha_op) << 16;
+    }
+    stage.scales_raw = canonical_scale(stage.scales_raw & 0x3) |
+                       canonical_scale((stage.scales_raw >> 16) & 0x3) << 16;
+    return sources_read;
+}
+
+/**
+ * Clears the fields of the configuration that GenerateFragmentShader ignores given the others, so
+ * that configurations only differing in them share their shader. The state is compared bytewise,
+ * hence the memsets.
+ */
+static void Canonicalize(PicaFSConfigState& state) {
+    // Nothing but the discard is generated
+    if (state.alpha_test_func == FramebufferRegs::CompareFunc::Never) {
+        std::memset(&state, 0, sizeof(state));
+        state.alpha_test_func = FramebufferRegs::CompareFunc::Never;
+        return;
+    }
+
+    u32 sources_read = 0;
+    for (auto& stage : state.tev_stages) {
+        sources_read |= CanonicalizeTevStage(stage);
+    }
+    const auto is_read = [&sources_read](TevStageConfig::Source source) {
+        return (sources_read & (1u << static_cast<u32>(source))) != 0;
+    };
+
+    if (!is_read(TevStageConfig::Source::PreviousBuffer)) {
+        state.combiner_buffer_input = 0;
+    }
+
+    auto& lighting = state.lighting;
+    if (!is_read(TevStageConfig::Source::PrimaryFragmentColor) &&
+        !is_read(TevStageConfig::Source::SecondaryFragmentColor)) {
+        std::memset(&lighting, 0, sizeof(lighting));
+    }
+    if (lighting.enable) {
+        if (lighting.bump_mode != LightingRegs::LightingBumpMode::NormalMap &&
+            lighting.bump_mode != LightingRegs::LightingBumpMode::TangentMap) {
+            lighting.bump_mode = LightingRegs::LightingBumpMode::None;
+            lighting.bump_selector = 0;
+        }
+        if (lighting.bump_mode != LightingRegs::LightingBumpMode::NormalMap) {
+            lighting.bump_renorm = false;
+        }
+
+        // Without a shadow texture the shadow attenuation is one
+        if (!lighting.enable_shadow) {
+            lighting.shadow_primary = false;
+            lighting.shadow_secondary = false;
+            lighting.shadow_invert = false;
+            lighting.shadow_alpha = false;
+            lighting.shadow_selector = 0;
+        }
+        if (!lighting.shadow_primary && !lighting.shadow_secondary) {
+            for (auto& light : lighting.light) {
+                light.shadow_enable = false;
+            }
+        }
+
+        bool spot_atten_used = false;
+        for (unsigned i = 0; i < lighting.src_num; ++i) {
+            spot_atten_used |= lighting.light[i].spot_atten_enable;
+        }
+        const auto canonicalize_lut = [&lighting](auto& lut, LightingRegs::LightingSampler sampler,
+                                                  bool used) {
+            if (!lut.enable || !used ||
+                !LightingRegs::IsLightingSamplerSupported(lighting.config, sampler)) {
+                // The spot attenuation LUT is always enabled
+                const bool enable = &lut == &lighting.lut_sp;
+                std::memset(&lut, 0, sizeof(lut));
+                lut.enable = enable;
+            }
+        };
+        using Sampler = LightingRegs::LightingSampler;
+        canonicalize_lut(lighting.lut_d0, Sampler::Distribution0, true);
+        canonicalize_lut(lighting.lut_d1, Sampler::Distribution1, true);
+        canonicalize_lut(lighting.lut_sp, Sampler::SpotlightAttenuation, spot_atten_used);
+        canonicalize_lut(lighting.lut_fr, Sampler::Fresnel,
+                         lighting.enable_primary_alpha || lighting.enable_secondary_alpha);
+        canonicalize_lut(lighting.lut_rr, Sampler::ReflectRed, true);
+        canonicalize_lut(lighting.lut_rg, Sampler::ReflectGreen, true);
+        canonicalize_lut(lighting.lut_rb, Sampler::ReflectBlue, true);
+
+        // The lighting samples the textures selected for the bump and the shadow
+        if (lighting.bump_mode != LightingRegs::LightingBumpMode::None) {
+            sources_read |= 1u << (static_cast<u32>(TevStageConfig::Source::Texture0) +
+                                   lighting.bump_selector);
+        }
+        if (lighting.enable_shadow) {
+            sources_read |= 1u << (static_cast<u32>(TevStageConfig::Source::Texture0) +
+                                   lighting.shadow_selector);
+        }
+    }
+
+    if (!is_read(TevStageConfig::Source::Texture0)) {
+        state.texture0_type = TexturingRegs::TextureConfig::Texture2D;
+    }
+    if (state.texture0_type != TexturingRegs::TextureConfig::Shadow2D) {
+        state.shadow_texture_orthographic = false;
+    }
+    if (!is_read(TevStageConfig::Source::Texture2)) {
+        state.texture2_use_coord1 = false;
+    }
+    if (!is_read(TevStageConfig::Source::Texture3)) {
+        std::memset(&state.proctex, 0, sizeof(state.proctex));
+    } else if (state.proctex.enable && !state.proctex.separate_alpha) {
+        state.proctex.alpha_combiner = {};
+    }
+
+    if (state.fog_mode != TexturingRegs::FogMode::Fog) {
+        state.fog_flip = false;
+    }
+}
+
+/// Returns whether the fragment shaders can read the color of the framebuffer
+static bool CanFetchFramebuffer() {
+    return GLES && (GLAD_GL_EXT_shader_framebuffer_fetch || GLAD_GL_ARM_shader_framebuffer_fetch);
+}
+
 PicaFSConfig PicaFSConfig::BuildFromRegs(const Pica::Regs& regs) {
     PicaFSConfig res;
 
@@ -244,6 +422,15 @@ PicaFSConfig PicaFSConfig::BuildFromRegs(const Pica::Regs& regs) {
 
     state.shadow_texture_orthographic = regs.texturing.shadow.orthographic != 0;
 
+    // GLES has no glLogicOp, the shader applies the op on the color fetched from the framebuffer
+    // where it can. Like on the PICA, the op replaces the blending.
+    state.logic_op = FramebufferRegs::LogicOp::Copy;
+    if (CanFetchFramebuffer() && !state.shadow_rendering &&
+        regs.framebuffer.output_merger.alphablend_enable == 0) {
+        state.logic_op = regs.framebuffer.output_merger.logic_op;
+    }
+
+    Canonicalize(state);
     return res;
 }
 
@@ -261,6 +448,17 @@ void PicaShaderConfigCommon::Init(const Pica::ShaderRegs& regs, Pica::Shader::Sh
     }
 }
 
+void PicaSpecializedVSConfigRaw::Init(const PicaVSConfig& config, const Pica::ShaderRegs& regs,
+                                      const Pica::Shader::ShaderSetup& setup) {
+    common = config.state;
+    uniforms.b = setup.uniforms.b;
+    std::transform(std::begin(regs.int_uniforms), std::end(regs.int_uniforms),
+                   uniforms.i.begin(), [](const auto& value) -> std::array<u8, 4> {
+                       return {static_cast<u8>(value.x.Value()), static_cast<u8>(value.y.Value()),
+                               static_cast<u8>(value.z.Value()), static_cast<u8>(value.w.Value())};
+                   });
+}
+
 void PicaGSConfigCommonRaw::Init(const Pica::Regs& regs) {
     vs_output_attributes = Common::BitSet<u32>(regs.vs.output_mask).Count();
     gs_output_attributes = vs_output_attributes;
@@ -285,6 +483,24 @@ void PicaGSConfigCommonRaw::Init(const Pica::Regs& regs) {
     }
 }
 
+void PicaGSConfigRaw::Init(const Pica::Regs& regs, Pica::Shader::ShaderSetup& setup) {
+    PicaShaderConfigCommon::Init(regs.gs, setup);
+    PicaGSConfigCommonRaw::Init(regs);
+
+    num_inputs = regs.gs.max_input_attribute_index + 1;
+    input_map.fill(16);
+
+    // Later attributes overwrite earlier ones mapped to the same register, as in LoadInput
+    for (u32 attr = 0; attr < num_inputs; ++attr) {
+        input_map[regs.gs.GetRegisterForAttribute(attr)] = attr;
+    }
+
+    attributes_per_vertex = regs.pipeline.vs_outmap_total_minus_1_a + 1;
+
+    // The rasterizer input comes from the geometry shader outputs
+    gs_output_attributes = num_outputs;
+}
+
 /// Detects if a TEV stage is configured to be skipped (to avoid generating unnecessary code)
 static bool IsPassThroughTevStage(const TevStageConfig& stage) {
     return (stage.color_op == TevStageConfig::Operation::Replace &&
@@ -604,6 +820,30 @@ static void AppendAlphaTestCondition(std::string& out, FramebufferRegs::CompareF
     }
 }
 
+/// Returns the expression of the logic op on the 8-bit logic_src and logic_dest colors
+static std::string_view GetLogicOpExpression(FramebufferRegs::LogicOp op) {
+    // Indexed by FramebufferRegs::LogicOp, the bits above the 8 of the channels are masked after
+    static constexpr std::array<std::string_view, 16> expressions{
+        "uvec4(0u)",
+        "(logic_src & logic_dest)",
+        "(logic_src & ~logic_dest)",
+        "logic_src",
+        "uvec4(0xFFu)",
+        "~logic_src",
+        "logic_dest",
+        "~logic_dest",
+        "~(logic_src & logic_dest)",
+        "(logic_src | logic_dest)",
+        "~(logic_src | logic_dest)",
+        "(logic_src ^ logic_dest)",
+        "~(logic_src ^ logic_dest)",
+        "(~logic_src & logic_dest)",
+        "(logic_src | ~logic_dest)",
+        "(~logic_src | logic_dest)",
+    };
+    return expressions[static_cast<u32>(op)];
+}
+
 /// Writes the code to emulate the specified TEV stage
 static void WriteTevStage(std::string& out, const PicaFSConfig& config, unsigned index) {
     const auto stage =
@@ -1218,10 +1458,8 @@ float ProcTexNoiseCoef(vec2 x) {
     }
 }
 
-ShaderDecompiler::ProgramResult GenerateFragmentShader(const PicaFSConfig& config,
-                                                       bool separable_shader) {
-    const auto& state = config.state;
-
+/// Writes the declarations and helper functions shared by every generated fragment shader
+static std::string GetFragmentShaderCommon(bool separable_shader, bool framebuffer_fetch = false) {
     std::string out = R"(
 #extension GL_ARB_shader_image_load_store : enable
 #extension GL_ARB_shader_image_size : enable
@@ -1242,8 +1480,26 @@ ShaderDecompiler::ProgramResult GenerateFragmentShader(const PicaFSConfig& confi
 #ifndef CITRA_GLES
 in vec4 gl_FragCoord;
 #endif // CITRA_GLES
+)";
 
+    if (framebuffer_fetch) {
+        // The EXT extension reads the color output before it is written, the ARM one a builtin
+        out += R"(
+#extension GL_EXT_shader_framebuffer_fetch : enable
+#extension GL_ARM_shader_framebuffer_fetch : enable
+#ifdef GL_EXT_shader_framebuffer_fetch
+inout vec4 color;
+#define last_frag_color color
+#else
 out vec4 color;
+#define last_frag_color gl_LastFragColorARM
+#endif
+)";
+    } else {
+        out += "\nout vec4 color;\n";
+    }
+
+    out += R"(
 
 uniform sampler2D tex0;
 uniform sampler2D tex1;
@@ -1313,7 +1569,19 @@ float getLod(vec2 coord) {
     vec2 d = max(abs(dFdx(coord)), abs(dFdy(coord)));
     return log2(max(d.x, d.y));
 }
+)";
 
+    return out;
+}
+
+ShaderDecompiler::ProgramResult GenerateFragmentShader(const PicaFSConfig& config,
+                                                       bool separable_shader) {
+    const auto& state = config.state;
+
+    std::string out =
+        GetFragmentShaderCommon(separable_shader, state.logic_op != FramebufferRegs::LogicOp::Copy);
+
+    out += R"(
 #if ALLOW_SHADOW
 
 uvec2 DecodeShadow(uint pixel) {
@@ -1569,7 +1837,15 @@ do {
     } else {
         out += "gl_FragDepth = depth;\n";
         // Round the final fragment color to maintain the PICA's 8 bits of precision
-        out += "color = byteround(last_tex_env_out);\n";
+        if (state.logic_op == FramebufferRegs::LogicOp::Copy) {
+            out += "color = byteround(last_tex_env_out);\n";
+        } else {
+            out += fmt::format(
+                "uvec4 logic_src = uvec4(round(clamp(last_tex_env_out, 0.0, 1.0) * 255.0));\n"
+                "uvec4 logic_dest = uvec4(round(last_frag_color * 255.0));\n"
+                "color = vec4({} & uvec4(0xFFu)) / 255.0;\n",
+                GetLogicOpExpression(state.logic_op));
+        }
     }
 
     out += '}';
@@ -1577,6 +1853,248 @@ do {
     return {std::move(out)};
 }
 
+bool CanUseUberFragmentShader(const PicaFSConfig& config) {
+    const auto& state = config.state;
+    return state.logic_op == FramebufferRegs::LogicOp::Copy && !state.lighting.enable &&
+           !state.proctex.enable && !state.shadow_rendering &&
+           state.texture0_type != TexturingRegs::TextureConfig::Shadow2D &&
+           state.texture0_type != TexturingRegs::TextureConfig::ShadowCube &&
+           state.fog_mode != TexturingRegs::FogMode::Gas;
+}
+
+ShaderDecompiler::ProgramResult GenerateUberFragmentShader(bool separable_shader) {
+    std::string out = GetFragmentShaderCommon(separable_shader);
+
+    using TextureConfig = TexturingRegs::TextureConfig;
+    out += fmt::format(R"(
+#define TEXTURE0_2D {}
+#define TEXTURE0_PROJECTION_2D {}
+#define TEXTURE0_CUBE {}
+
+#define ALPHA_TEST_NEVER {}
+#define ALPHA_TEST_ALWAYS {}
+#define ALPHA_TEST_EQUAL {}
+#define ALPHA_TEST_NOT_EQUAL {}
+#define ALPHA_TEST_LESS {}
+#define ALPHA_TEST_LESS_EQUAL {}
+#define ALPHA_TEST_GREATER {}
+
+#define SCISSOR_EXCLUDE {}
+#define SCISSOR_INCLUDE {}
+)",
+                       static_cast<u32>(TextureConfig::Texture2D),
+                       static_cast<u32>(TextureConfig::Projection2D),
+                       static_cast<u32>(TextureConfig::TextureCube),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::Never),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::Always),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::Equal),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::NotEqual),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::LessThan),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::LessThanOrEqual),
+                       static_cast<u32>(FramebufferRegs::CompareFunc::GreaterThan),
+                       static_cast<u32>(RasterizerRegs::ScissorMode::Exclude),
+                       static_cast<u32>(RasterizerRegs::ScissorMode::Include));
+
+    // The state baked into specialized shaders is read from these uniforms instead. Each TEV stage
+    // is given as its raw sources, modifiers, ops and scales words.
+    out += R"(
+uniform uvec4 uber_tev_stages[NUM_TEV_STAGES];
+uniform int uber_combiner_buffer_input;
+uniform int uber_alpha_test_func;
+uniform int uber_scissor_mode;
+uniform int uber_texture0_type;
+uniform bool uber_texture2_use_coord1;
+uniform bool uber_w_buffering;
+uniform bool uber_fog_enable;
+uniform bool uber_fog_flip;
+
+vec4 rounded_primary_color;
+vec4 texture_color[3];
+vec4 combiner_buffer;
+vec4 last_tex_env_out;
+
+vec4 GetSource(uint source, int stage) {
+    switch (source) {
+    case 0u: return rounded_primary_color;
+    case 3u: return texture_color[0];
+    case 4u: return texture_color[1];
+    case 5u: return texture_color[2];
+    case 13u: return combiner_buffer;
+    case 14u: return const_color[stage];
+    case 15u: return last_tex_env_out;
+    // Fragment lighting and procedural textures are not handled by this shader
+    default: return vec4(0.0);
+    }
+}
+
+vec3 GetColorModifier(uint modifier, vec4 value) {
+    switch (modifier) {
+    case 0u: return value.rgb;
+    case 1u: return vec3(1.0) - value.rgb;
+    case 2u: return value.aaa;
+    case 3u: return vec3(1.0) - value.aaa;
+    case 4u: return value.rrr;
+    case 5u: return vec3(1.0) - value.rrr;
+    case 8u: return value.ggg;
+    case 9u: return vec3(1.0) - value.ggg;
+    case 12u: return value.bbb;
+    case 13u: return vec3(1.0) - value.bbb;
+    default: return vec3(0.0);
+    }
+}
+
+float GetAlphaModifier(uint modifier, vec4 value) {
+    switch (modifier) {
+    case 0u: return value.a;
+    case 1u: return 1.0 - value.a;
+    case 2u: return value.r;
+    case 3u: return 1.0 - value.r;
+    case 4u: return value.g;
+    case 5u: return 1.0 - value.g;
+    case 6u: return value.b;
+    case 7u: return 1.0 - value.b;
+    default: return 0.0;
+    }
+}
+
+vec3 CombineColor(uint op, vec3 a, vec3 b, vec3 c) {
+    switch (op) {
+    case 0u: return clamp(a, vec3(0.0), vec3(1.0));
+    case 1u: return clamp(a * b, vec3(0.0), vec3(1.0));
+    case 2u: return clamp(a + b, vec3(0.0), vec3(1.0));
+    case 3u: return clamp(a + b - vec3(0.5), vec3(0.0), vec3(1.0));
+    case 4u: return clamp(a * c + b * (vec3(1.0) - c), vec3(0.0), vec3(1.0));
+    case 5u: return clamp(a - b, vec3(0.0), vec3(1.0));
+    case 6u:
+    case 7u: return clamp(vec3(dot(a - vec3(0.5), b - vec3(0.5)) * 4.0), vec3(0.0), vec3(1.0));
+    case 8u: return clamp(a * b + c, vec3(0.0), vec3(1.0));
+    case 9u: return clamp(min(a + b, vec3(1.0)) * c, vec3(0.0), vec3(1.0));
+    default: return vec3(0.0);
+    }
+}
+
+float CombineAlpha(uint op, float a, float b, float c) {
+    switch (op) {
+    case 0u: return clamp(a, 0.0, 1.0);
+    case 1u: return clamp(a * b, 0.0, 1.0);
+    case 2u: return clamp(a + b, 0.0, 1.0);
+    case 3u: return clamp(a + b - 0.5, 0.0, 1.0);
+    case 4u: return clamp(a * c + b * (1.0 - c), 0.0, 1.0);
+    case 5u: return clamp(a - b, 0.0, 1.0);
+    case 8u: return clamp(a * b + c, 0.0, 1.0);
+    case 9u: return clamp(min(a + b, 1.0) * c, 0.0, 1.0);
+    default: return 0.0;
+    }
+}
+
+float GetMultiplier(uint scale) {
+    return scale < 3u ? float(1u << scale) : 1.0;
+}
+
+void main() {
+rounded_primary_color = byteround(primary_color);
+
+if (uber_alpha_test_func == ALPHA_TEST_NEVER) discard;
+
+if (uber_scissor_mode != 0) {
+    bool inside = gl_FragCoord.x >= float(scissor_x1) && gl_FragCoord.y >= float(scissor_y1) &&
+                  gl_FragCoord.x < float(scissor_x2) && gl_FragCoord.y < float(scissor_y2);
+    if (inside == (uber_scissor_mode == SCISSOR_EXCLUDE)) discard;
+}
+
+float z_over_w = 2.0 * gl_FragCoord.z - 1.0;
+float depth = z_over_w * depth_scale + depth_offset;
+if (uber_w_buffering) depth /= gl_FragCoord.w;
+
+// Branches on uniforms only, so implicit derivatives stay well defined
+if (uber_texture0_type == TEXTURE0_2D) {
+    texture_color[0] = textureLod(tex0, texcoord0, getLod(texcoord0 * vec2(textureSize(tex0, 0))));
+} else if (uber_texture0_type == TEXTURE0_PROJECTION_2D) {
+    texture_color[0] = textureProj(tex0, vec3(texcoord0, texcoord0_w));
+} else if (uber_texture0_type == TEXTURE0_CUBE) {
+    texture_color[0] = texture(tex_cube, vec3(texcoord0, texcoord0_w));
+} else {
+    texture_color[0] = vec4(0.0);
+}
+texture_color[1] = textureLod(tex1, texcoord1, getLod(texcoord1 * vec2(textureSize(tex1, 0))));
+vec2 texcoord2_used = uber_texture2_use_coord1 ? texcoord1 : texcoord2;
+texture_color[2] = textureLod(tex2, texcoord2_used,
+                              getLod(texcoord2_used * vec2(textureSize(tex2, 0))));
+
+combiner_buffer = vec4(0.0);
+vec4 next_combiner_buffer = tev_combiner_buffer_color;
+last_tex_env_out = vec4(0.0);
+
+for (int i = 0; i < NUM_TEV_STAGES; ++i) {
+    uvec4 stage = uber_tev_stages[i];
+    uint sources = stage.x;
+    uint modifiers = stage.y;
+
+    vec3 color_results[3] = vec3[3](
+        GetColorModifier(modifiers & 0xFu, GetSource(sources & 0xFu, i)),
+        GetColorModifier((modifiers >> 4u) & 0xFu, GetSource((sources >> 4u) & 0xFu, i)),
+        GetColorModifier((modifiers >> 8u) & 0xFu, GetSource((sources >> 8u) & 0xFu, i)));
+    uint color_op = stage.z & 0xFu;
+    vec3 color_output = byteround(
+        CombineColor(color_op, color_results[0], color_results[1], color_results[2]));
+
+    float alpha_output;
+    if (color_op == 7u) {
+        // Dot3_RGBA also places its result in the alpha component
+        alpha_output = color_output[0];
+    } else {
+        float alpha_results[3] = float[3](
+            GetAlphaModifier((modifiers >> 12u) & 0x7u, GetSource((sources >> 16u) & 0xFu, i)),
+            GetAlphaModifier((modifiers >> 16u) & 0x7u, GetSource((sources >> 20u) & 0xFu, i)),
+            GetAlphaModifier((modifiers >> 20u) & 0x7u, GetSource((sources >> 24u) & 0xFu, i)));
+        alpha_output = byteround(CombineAlpha((stage.z >> 16u) & 0xFu, alpha_results[0],
+                                              alpha_results[1], alpha_results[2]));
+    }
+
+    last_tex_env_out = vec4(
+        clamp(color_output * GetMultiplier(stage.w & 0x3u), vec3(0.0), vec3(1.0)),
+        clamp(alpha_output * GetMultiplier((stage.w >> 16u) & 0x3u), 0.0, 1.0));
+
+    combiner_buffer = next_combiner_buffer;
+    if (i < 4) {
+        if ((uber_combiner_buffer_input & (1 << i)) != 0)
+            next_combiner_buffer.rgb = last_tex_env_out.rgb;
+        if (((uber_combiner_buffer_input >> 4) & (1 << i)) != 0)
+            next_combiner_buffer.a = last_tex_env_out.a;
+    }
+}
+
+if (uber_alpha_test_func != ALPHA_TEST_ALWAYS) {
+    int alpha = int(last_tex_env_out.a * 255.0);
+    bool pass;
+    switch (uber_alpha_test_func) {
+    case ALPHA_TEST_EQUAL: pass = alpha == alphatest_ref; break;
+    case ALPHA_TEST_NOT_EQUAL: pass = alpha != alphatest_ref; break;
+    case ALPHA_TEST_LESS: pass = alpha < alphatest_ref; break;
+    case ALPHA_TEST_LESS_EQUAL: pass = alpha <= alphatest_ref; break;
+    case ALPHA_TEST_GREATER: pass = alpha > alphatest_ref; break;
+    default: pass = alpha >= alphatest_ref; break;
+    }
+    if (!pass) discard;
+}
+
+if (uber_fog_enable) {
+    float fog_index = (uber_fog_flip ? 1.0 - depth : depth) * 128.0;
+    float fog_i = clamp(floor(fog_index), 0.0, 127.0);
+    float fog_f = fog_index - fog_i;
+    vec2 fog_lut_entry = texelFetch(texture_buffer_lut_rg, int(fog_i) + fog_lut_offset).rg;
+    float fog_factor = clamp(fog_lut_entry.r + fog_lut_entry.g * fog_f, 0.0, 1.0);
+    last_tex_env_out.rgb = mix(fog_color.rgb, last_tex_env_out.rgb, fog_factor);
+}
+
+gl_FragDepth = depth;
+color = byteround(last_tex_env_out);
+}
+)";
+
+    return {std::move(out)};
+}
+
 ShaderDecompiler::ProgramResult GenerateTrivialVertexShader(bool separable_shader) {
     std::string out;
     if (separable_shader) {
@@ -1622,8 +2140,9 @@ void main() {
     return {std::move(out)};
 }
 
-std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
-    const Pica::Shader::ShaderSetup& setup, const PicaVSConfig& config, bool separable_shader) {
+static std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaVSConfig& config, bool separable_shader,
+    const ShaderDecompiler::UniformConstants* uniform_constants) {
     std::string out = "";
     if (separable_shader) {
         out += "#extension GL_ARB_separate_shader_objects : enable\n";
@@ -1648,7 +2167,7 @@ std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
 
     auto program_source_opt = ShaderDecompiler::DecompileProgram(
         setup.program_code, setup.swizzle_data, config.state.main_offset, get_input_reg,
-        get_output_reg, config.state.sanitize_mul);
+        get_output_reg, config.state.sanitize_mul, false, uniform_constants);
 
     if (!program_source_opt)
         return {};
@@ -1687,6 +2206,18 @@ layout (std140) uniform vs_config {
     return {{std::move(out)}};
 }
 
+std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaVSConfig& config, bool separable_shader) {
+    return GenerateVertexShader(setup, config, separable_shader, nullptr);
+}
+
+std::optional<ShaderDecompiler::ProgramResult> GenerateSpecializedVertexShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaSpecializedVSConfig& config,
+    bool separable_shader) {
+    return GenerateVertexShader(setup, PicaVSConfig{config.state.common}, separable_shader,
+                                &config.state.uniforms);
+}
+
 static std::string GetGSCommonSource(const PicaGSConfigCommonRaw& config, bool separable_shader) {
     std::string out = GetVertexInterfaceDeclaration(true, separable_shader);
     out += UniformBlockDef;
@@ -1804,4 +2335,114 @@ void main() {
 
     return {std::move(out)};
 }
+
+std::optional<ShaderDecompiler::ProgramResult> GenerateGeometryShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaGSConfig& config, bool separable_shader) {
+    const auto& state = config.state;
+    if (state.num_outputs == 0 || state.attributes_per_vertex > state.vs_output_attributes ||
+        state.num_inputs % state.attributes_per_vertex != 0) {
+        LOG_DEBUG(Render_OpenGL, "Unsupported geometry shader layout: {} inputs, {} per vertex",
+                  state.num_inputs, state.attributes_per_vertex);
+        return {};
+    }
+
+    std::string out = "";
+    if (separable_shader) {
+        out += "#extension GL_ARB_separate_shader_objects : enable\n\n";
+    }
+
+    switch (state.num_inputs / state.attributes_per_vertex) {
+    case 1:
+        out += "layout(points) in;\n";
+        break;
+    case 2:
+        out += "layout(lines) in;\n";
+        break;
+    case 3:
+        out += "layout(triangles) in;\n";
+        break;
+    case 4:
+        out += "layout(lines_adjacency) in;\n";
+        break;
+    case 6:
+        out += "layout(triangles_adjacency) in;\n";
+        break;
+    default:
+        LOG_DEBUG(Render_OpenGL, "Unsupported geometry shader vertex count: {}",
+                  state.num_inputs / state.attributes_per_vertex);
+        return {};
+    }
+    // Emitting more vertices than declared drops them, which only affects unusually long programs
+    out += "layout(triangle_strip, max_vertices = 30) out;\n\n";
+
+    out += GetGSCommonSource(state, separable_shader);
+
+    const auto get_input_reg = [&state](u32 reg) -> std::string {
+        ASSERT(reg < 16);
+        const u32 attr = state.input_map[reg];
+        if (attr < state.num_inputs) {
+            return fmt::format("vs_out_attr{}[{}]", attr % state.attributes_per_vertex,
+                               attr / state.attributes_per_vertex);
+        }
+        return "vec4(0.0, 0.0, 0.0, 1.0)";
+    };
+
+    const auto get_output_reg = [&state](u32 reg) -> std::string {
+        ASSERT(reg < 16);
+        if (state.output_map[reg] < state.num_outputs) {
+            return fmt::format("output_buffer.attributes[{}]", state.output_map[reg]);
+        }
+        return "";
+    };
+
+    auto program_source_opt = ShaderDecompiler::DecompileProgram(
+        setup.program_code, setup.swizzle_data, state.main_offset, get_input_reg, get_output_reg,
+        state.sanitize_mul, true);
+
+    if (!program_source_opt)
+        return {};
+
+    std::string& program_source = program_source_opt->code;
+
+    out += R"(
+#define uniforms gs_uniforms
+layout (std140) uniform gs_config {
+    pica_uniforms uniforms;
+};
+
+Vertex output_buffer;
+Vertex prim_buffer[3];
+uint vertex_id = 0u;
+bool prim_emit = false;
+bool winding = false;
+
+void setemit(uint vertex_id_, bool prim_emit_, bool winding_) {
+    vertex_id = vertex_id_;
+    prim_emit = prim_emit_;
+    winding = winding_;
+}
+
+void emit() {
+    prim_buffer[vertex_id] = output_buffer;
+    if (prim_emit) {
+        // Like in the primitive assembler, the winding flips the first two vertices
+        if (winding) {
+            EmitPrim(prim_buffer[1], prim_buffer[0], prim_buffer[2]);
+        } else {
+            EmitPrim(prim_buffer[0], prim_buffer[1], prim_buffer[2]);
+        }
+    }
+}
+
+void main() {
+)";
+    for (u32 i = 0; i < state.num_outputs; ++i) {
+        out += fmt::format("    output_buffer.attributes[{}] = vec4(0.0, 0.0, 0.0, 1.0);\n", i);
+    }
+    out += "\n    exec_shader();\n}\n\n";
+
+    out += program_source;
+
+    return {{std::move(out)}};
+}
 } // namespace OpenGL
@@ -12,14 +12,11 @@
 #include <type_traits>
 #include "common/hash.h"
 #include "video_core/regs.h"
+#include "video_core/renderer_opengl/gl_shader_decompiler.h"
 #include "video_core/shader/shader.h"
 
 namespace OpenGL {
 
-namespace ShaderDecompiler {
-struct ProgramResult;
-}
-
 enum class ProgramType : u32 { VS, GS, FS };
 
 enum Attributes {
@@ -120,6 +117,9 @@ struct PicaFSConfigState {
 
     bool shadow_rendering;
     bool shadow_texture_orthographic;
+
+    /// Logic op applied by the shader on the framebuffer color it fetches, Copy when it doesn't
+    Pica::FramebufferRegs::LogicOp logic_op;
 };
 
 /**
@@ -132,7 +132,11 @@ struct PicaFSConfigState {
  */
 struct PicaFSConfig : Common::HashableStruct<PicaFSConfigState> {
 
-    /// Construct a PicaFSConfig with the given Pica register configuration.
+    /**
+     * Construct a PicaFSConfig with the given Pica register configuration. The fields the generated
+     * shader wouldn't read, like the arguments a TEV operation ignores or the LUTs of a disabled
+     * lighting, are cleared so that equivalent configurations share a shader.
+     */
     static PicaFSConfig BuildFromRegs(const Pica::Regs& regs);
 
     bool TevStageUpdatesCombinerBufferColor(unsigned stage_index) const {
@@ -175,6 +179,26 @@ struct PicaVSConfig : Common::HashableStruct<PicaShaderConfigCommon> {
     }
 };
 
+struct PicaSpecializedVSConfigRaw {
+    void Init(const PicaVSConfig& config, const Pica::ShaderRegs& regs,
+              const Pica::Shader::ShaderSetup& setup);
+
+    PicaShaderConfigCommon common;
+    ShaderDecompiler::UniformConstants uniforms;
+};
+
+/**
+ * This struct contains information to identify a GL vertex shader generated from PICA vertex
+ * shader, with the current values of the bool and int uniforms folded into the program.
+ */
+struct PicaSpecializedVSConfig : Common::HashableStruct<PicaSpecializedVSConfigRaw> {
+    PicaSpecializedVSConfig() = default;
+    explicit PicaSpecializedVSConfig(const PicaVSConfig& config, const Pica::ShaderRegs& regs,
+                                     const Pica::Shader::ShaderSetup& setup) {
+        state.Init(config, regs, setup);
+    }
+};
+
 struct PicaGSConfigCommonRaw {
     void Init(const Pica::Regs& regs);
 
@@ -200,6 +224,26 @@ struct PicaFixedGSConfig : Common::HashableStruct<PicaGSConfigCommonRaw> {
     }
 };
 
+struct PicaGSConfigRaw : PicaShaderConfigCommon, PicaGSConfigCommonRaw {
+    void Init(const Pica::Regs& regs, Pica::Shader::ShaderSetup& setup);
+
+    u32 num_inputs;
+    u32 attributes_per_vertex;
+
+    // input_map[input register index] -> input attribute index
+    std::array<u32, 16> input_map;
+};
+
+/**
+ * This struct contains information to identify a GL geometry shader generated from PICA geometry
+ * shader running in point mode.
+ */
+struct PicaGSConfig : Common::HashableStruct<PicaGSConfigRaw> {
+    explicit PicaGSConfig(const Pica::Regs& regs, Pica::Shader::ShaderSetup& setup) {
+        state.Init(regs, setup);
+    }
+};
+
 /**
  * Generates the GLSL vertex shader program source code that accepts vertices from software shader
  * and directly passes them to the fragment shader.
@@ -215,6 +259,15 @@ ShaderDecompiler::ProgramResult GenerateTrivialVertexShader(bool separable_shade
 std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
     const Pica::Shader::ShaderSetup& setup, const PicaVSConfig& config, bool separable_shader);
 
+/**
+ * Generates the GLSL vertex shader program source code for the given VS program, with its bool
+ * and int uniforms replaced by the given constants
+ * @returns String of the shader source code; boost::none on failure
+ */
+std::optional<ShaderDecompiler::ProgramResult> GenerateSpecializedVertexShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaSpecializedVSConfig& config,
+    bool separable_shader);
+
 /*
  * Generates the GLSL fixed geometry shader program source code for non-GS PICA pipeline
  * @returns String of the shader source code
@@ -222,6 +275,14 @@ std::optional<ShaderDecompiler::ProgramResult> GenerateVertexShader(
 ShaderDecompiler::ProgramResult GenerateFixedGeometryShader(const PicaFixedGSConfig& config,
                                                             bool separable_shader);
 
+/**
+ * Generates the GLSL geometry shader program source code for the given GS program. Only the point
+ * mode is supported, with each invocation taking 1, 2, 3, 4 or 6 vertices.
+ * @returns String of the shader source code; std::nullopt on failure
+ */
+std::optional<ShaderDecompiler::ProgramResult> GenerateGeometryShader(
+    const Pica::Shader::ShaderSetup& setup, const PicaGSConfig& config, bool separable_shader);
+
 /**
  * Generates the GLSL fragment shader program source code for the current Pica state
  * @param config ShaderCacheKey object generated for the current Pica state, used for the shader
@@ -232,6 +293,21 @@ ShaderDecompiler::ProgramResult GenerateFixedGeometryShader(const PicaFixedGSCon
 ShaderDecompiler::ProgramResult GenerateFragmentShader(const PicaFSConfig& config,
                                                        bool separable_shader);
 
+/**
+ * Checks whether the generic fragment shader can emulate the given configuration. It covers the
+ * TEV, texture units 0-2, alpha, scissor and depth tests and fog, but not fragment lighting,
+ * procedural textures or shadows.
+ */
+bool CanUseUberFragmentShader(const PicaFSConfig& config);
+
+/**
+ * Generates a generic fragment shader that reads the PicaFSConfig state from uniforms, used while
+ * the specialized shader for a configuration is compiled in the background
+ * @param separable_shader generates shader that can be used for separate shader object
+ * @returns String of the shader source code
+ */
+ShaderDecompiler::ProgramResult GenerateUberFragmentShader(bool separable_shader);
+
 } // namespace OpenGL
 
 namespace std {
@@ -249,10 +325,24 @@ struct hash<OpenGL::PicaVSConfig> {
     }
 };
 
+template <>
+struct hash<OpenGL::PicaSpecializedVSConfig> {
+    std::size_t operator()(const OpenGL::PicaSpecializedVSConfig& k) const noexcept {
+        return k.Hash();
+    }
+};
+
 template <>
 struct hash<OpenGL::PicaFixedGSConfig> {
     std::size_t operator()(const OpenGL::PicaFixedGSConfig& k) const noexcept {
         return k.Hash();
     }
 };
+
+template <>
+struct hash<OpenGL::PicaGSConfig> {
+    std::size_t operator()(const OpenGL::PicaGSConfig& k) const noexcept {
+        return k.Hash();
+    }
+};
 } // namespace std
@@ -3,11 +3,21 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <numeric>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <boost/functional/hash.hpp>
 #include <boost/variant.hpp>
+#include "common/thread.h"
+#include "common/thread_pool.h"
 #include "core/core.h"
+#include "core/frontend/emu_window.h"
+#include "core/frontend/scope_acquire_context.h"
 #include "video_core/renderer_opengl/gl_shader_disk_cache.h"
 #include "video_core/renderer_opengl/gl_shader_manager.h"
 #include "video_core/video_core.h"
@@ -63,6 +73,42 @@ static std::set<GLenum> GetSupportedFormats() {
     return supported_formats;
 }
 
+/**
+ * Calls func(std::size_t index) for every index in [0, count), spreading the calls over the
+ * calling thread and one thread per worker context. The GL objects created by func are complete
+ * for every shared context once this returns.
+ */
+template <typename Func>
+static void RunOnWorkerContexts(
+    const std::vector<std::unique_ptr<Frontend::GraphicsContext>>& worker_contexts,
+    std::size_t count, Func&& func) {
+    std::atomic<std::size_t> next_index{0};
+    const auto run_worker = [&] {
+        for (std::size_t index = next_index++; index < count; index = next_index++) {
+            func(index);
+        }
+        // Work submitted on one context is only guaranteed to be visible on the others after it
+        // has finished
+        glFinish();
+    };
+
+    std::vector<std::thread> threads;
+    const std::size_t num_threads = std::min(worker_contexts.size(), count > 0 ? count - 1 : 0);
+    threads.reserve(num_threads);
+    for (std::size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&run_worker, &context = *worker_contexts[i]] {
+            Common::SetCurrentThreadName("ShaderWorker");
+            Common::SetCurrentThreadRole(Common::ThreadRole::Background);
+            Frontend::ScopeAcquireContext scope{context};
+            run_worker();
+        });
+    }
+    run_worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
 static std::tuple<PicaVSConfig, Pica::Shader::ShaderSetup> BuildVSConfigFromRaw(
     const ShaderDiskCacheRaw& raw) {
     Pica::Shader::ProgramCode program_code{};
@@ -94,6 +140,7 @@ static void SetShaderUniformBlockBindings(GLuint shader) {
     SetShaderUniformBlockBinding(shader, "shader_data", UniformBindings::Common,
                                  sizeof(UniformData));
     SetShaderUniformBlockBinding(shader, "vs_config", UniformBindings::VS, sizeof(VSUniformData));
+    SetShaderUniformBlockBinding(shader, "gs_config", UniformBindings::GS, sizeof(GSUniformData));
 }
 
 static void SetShaderSamplerBinding(GLuint shader, const char* name,
@@ -229,10 +276,17 @@ public:
         return {cached_shader.GetHandle(), std::move(result)};
     }
 
-    void Inject(const KeyConfigType& key, OGLProgram&& program) {
+    /// Returns the handle cached for the config, or 0 if there is none yet
+    GLuint Find(const KeyConfigType& config) const {
+        const auto iter = shaders.find(config);
+        return iter != shaders.end() ? iter->second.GetHandle() : 0;
+    }
+
+    /// Adds a program built elsewhere, returning the handle of the one cached for the key
+    GLuint Inject(const KeyConfigType& key, OGLProgram&& program) {
         OGLShaderStage stage{separable};
         stage.Inject(std::move(program));
-        shaders.emplace(key, std::move(stage));
+        return shaders.emplace(key, std::move(stage)).first->second.GetHandle();
     }
 
 private:
@@ -281,12 +335,20 @@ public:
         return {map_it->second->GetHandle(), std::nullopt};
     }
 
-    void Inject(const KeyConfigType& key, std::string decomp, OGLProgram&& program) {
+    /// Returns the handle cached for the key, or 0 if there is none yet
+    GLuint Find(const KeyConfigType& key) const {
+        const auto iter = shader_map.find(key);
+        return iter != shader_map.end() && iter->second ? iter->second->GetHandle() : 0;
+    }
+
+    /// Adds a program built elsewhere, returning the handle of the one cached for its code
+    GLuint Inject(const KeyConfigType& key, std::string decomp, OGLProgram&& program) {
         OGLShaderStage stage{separable};
         stage.Inject(std::move(program));
         const auto iter = shader_cache.emplace(std::move(decomp), std::move(stage)).first;
         OGLShaderStage& cached_shader = iter->second;
         shader_map.insert_or_assign(key, &cached_shader);
+        return cached_shader.GetHandle();
     }
 
 private:
@@ -298,16 +360,204 @@ private:
 using ProgrammableVertexShaders =
     ShaderDoubleCache<PicaVSConfig, &GenerateVertexShader, GL_VERTEX_SHADER>;
 
+using SpecializedVertexShaders =
+    ShaderDoubleCache<PicaSpecializedVSConfig, &GenerateSpecializedVertexShader, GL_VERTEX_SHADER>;
+
+/// Number of draws in a row a program has to use the same uniforms with to get specialized
+constexpr u32 VSSpecializationDraws = 16;
+
+/// Number of specialized variants compiled for one program at most
+constexpr u32 MaxVSSpecializations = 8;
+
+using ProgrammableGeometryShaders =
+    ShaderDoubleCache<PicaGSConfig, &GenerateGeometryShader, GL_GEOMETRY_SHADER>;
+
 using FixedGeometryShaders =
     ShaderCache<PicaFixedGSConfig, &GenerateFixedGeometryShader, GL_GEOMETRY_SHADER>;
 
 using FragmentShaders = ShaderCache<PicaFSConfig, &GenerateFragmentShader, GL_FRAGMENT_SHADER>;
 
+/// The generic fragment shader, configured through uniforms for the configuration being drawn
+class UberFragmentShader {
+public:
+    UberFragmentShader() : program(true) {
+        program.Create(GenerateUberFragmentShader(true).code.c_str(), GL_FRAGMENT_SHADER);
+        const GLuint handle = program.GetHandle();
+        tev_stages_location = glGetUniformLocation(handle, "uber_tev_stages");
+        combiner_buffer_input_location = glGetUniformLocation(handle, "uber_combiner_buffer_input");
+        alpha_test_func_location = glGetUniformLocation(handle, "uber_alpha_test_func");
+        scissor_mode_location = glGetUniformLocation(handle, "uber_scissor_mode");
+        texture0_type_location = glGetUniformLocation(handle, "uber_texture0_type");
+        texture2_use_coord1_location = glGetUniformLocation(handle, "uber_texture2_use_coord1");
+        w_buffering_location = glGetUniformLocation(handle, "uber_w_buffering");
+        fog_enable_location = glGetUniformLocation(handle, "uber_fog_enable");
+        fog_flip_location = glGetUniformLocation(handle, "uber_fog_flip");
+    }
+
+    /// Returns the program handle after loading the config into its uniforms
+    GLuint Get(const PicaFSConfig& config) {
+        const GLuint handle = program.GetHandle();
+        if (last_config && *last_config == config) {
+            return handle;
+        }
+        last_config = config;
+
+        const auto& state = config.state;
+        std::array<GLuint, 4 * 6> tev_stages;
+        for (std::size_t i = 0; i < state.tev_stages.size(); ++i) {
+            const auto& stage = state.tev_stages[i];
+            tev_stages[i * 4 + 0] = stage.sources_raw;
+            tev_stages[i * 4 + 1] = stage.modifiers_raw;
+            tev_stages[i * 4 + 2] = stage.ops_raw;
+            tev_stages[i * 4 + 3] = stage.scales_raw;
+        }
+        glProgramUniform4uiv(handle, tev_stages_location,
+                             static_cast<GLsizei>(state.tev_stages.size()), tev_stages.data());
+        glProgramUniform1i(handle, combiner_buffer_input_location, state.combiner_buffer_input);
+        glProgramUniform1i(handle, alpha_test_func_location,
+                           static_cast<GLint>(state.alpha_test_func));
+        glProgramUniform1i(handle, scissor_mode_location,
+                           static_cast<GLint>(state.scissor_test_mode));
+        glProgramUniform1i(handle, texture0_type_location, static_cast<GLint>(state.texture0_type));
+        glProgramUniform1i(handle, texture2_use_coord1_location, state.texture2_use_coord1);
+        using DepthBuffering = Pica::RasterizerRegs::DepthBuffering;
+        glProgramUniform1i(handle, w_buffering_location,
+                           state.depthmap_enable == DepthBuffering::WBuffering);
+        glProgramUniform1i(handle, fog_enable_location,
+                           state.fog_mode == Pica::TexturingRegs::FogMode::Fog);
+        glProgramUniform1i(handle, fog_flip_location, state.fog_flip);
+        return handle;
+    }
+
+private:
+    OGLShaderStage program;
+    std::optional<PicaFSConfig> last_config;
+
+    GLint tev_stages_location;
+    GLint combiner_buffer_input_location;
+    GLint alpha_test_func_location;
+    GLint scissor_mode_location;
+    GLint texture0_type_location;
+    GLint texture2_use_coord1_location;
+    GLint w_buffering_location;
+    GLint fog_enable_location;
+    GLint fog_flip_location;
+};
+
+/**
+ * Builds fragment shaders on a background thread owning a context shared with the main one. The
+ * main thread queues the configurations it is missing and collects the finished programs later.
+ */
+class AsyncFragmentShaderCompiler {
+public:
+    struct Result {
+        PicaFSConfig config;
+        u64 unique_identifier;
+        ShaderDecompiler::ProgramResult code;
+        OGLProgram program;
+    };
+
+    explicit AsyncFragmentShaderCompiler(std::unique_ptr<Frontend::GraphicsContext> context_)
+        : context(std::move(context_)), thread([this] { WorkerLoop(); }) {}
+
+    ~AsyncFragmentShaderCompiler() {
+        {
+            std::scoped_lock lock{mutex};
+            stop = true;
+        }
+        job_cv.notify_one();
+        thread.join();
+    }
+
+    /// Returns whether a build for the config is queued or in flight
+    bool IsPending(const PicaFSConfig& config) const {
+        return pending.count(config) != 0;
+    }
+
+    /// Queues a build for the config
+    void Queue(const PicaFSConfig& config, u64 unique_identifier) {
+        pending.insert(config);
+        {
+            std::scoped_lock lock{mutex};
+            jobs.push_back({config, unique_identifier});
+        }
+        job_cv.notify_one();
+    }
+
+    /// Calls func(Result&&) for every program finished since the last call
+    template <typename Func>
+    void Collect(Func&& func) {
+        std::vector<Result> finished;
+        {
+            std::scoped_lock lock{mutex};
+            if (results.empty()) {
+                return;
+            }
+            finished = std::move(results);
+            results.clear();
+        }
+        for (auto& result : finished) {
+            pending.erase(result.config);
+            func(std::move(result));
+        }
+    }
+
+private:
+    struct Job {
+        PicaFSConfig config;
+        u64 unique_identifier;
+    };
+
+    void WorkerLoop() {
+        Common::SetCurrentThreadName("ShaderCompiler");
+        Common::SetCurrentThreadRole(Common::ThreadRole::Background);
+        Frontend::ScopeAcquireContext scope{*context};
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock{mutex};
+                job_cv.wait(lock, [this] { return stop || !jobs.empty(); });
+                if (stop) {
+                    return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+            }
+
+            auto code = GenerateFragmentShader(job.config, true);
+            OGLShader shader;
+            shader.Create(code.code.c_str(), GL_FRAGMENT_SHADER);
+            OGLProgram program;
+            program.Create(true, {shader.handle});
+            // The program is used from the main context as soon as it is collected
+            glFinish();
+
+            std::scoped_lock lock{mutex};
+            results.push_back({job.config, job.unique_identifier, std::move(code),
+                               std::move(program)});
+        }
+    }
+
+    std::unique_ptr<Frontend::GraphicsContext> context;
+    /// Configurations queued or being built, only accessed by the main thread
+    std::unordered_set<PicaFSConfig> pending;
+
+    std::mutex mutex;
+    std::condition_variable job_cv;
+    std::deque<Job> jobs;
+    std::vector<Result> results;
+    bool stop = false;
+
+    std::thread thread;
+};
+
 class ShaderProgramManager::Impl {
 public:
     explicit Impl(bool separable, bool is_amd)
         : is_amd(is_amd), separable(separable), programmable_vertex_shaders(separable),
-          trivial_vertex_shader(separable), fixed_geometry_shaders(separable),
+          specialized_vertex_shaders(separable), trivial_vertex_shader(separable),
+          programmable_geometry_shaders(separable),
+          fixed_geometry_shaders(separable),
           fragment_shaders(separable), disk_cache(separable) {
         if (separable)
             pipeline.Create();
@@ -342,15 +592,29 @@ public:
 
     ShaderTuple current;
 
+    /// How stable the bool and int uniforms of a vertex program have been
+    struct UniformHistory {
+        PicaSpecializedVSConfig last;
+        u32 stable_draws = 0;
+        u32 num_specializations = 0;
+    };
+
     ProgrammableVertexShaders programmable_vertex_shaders;
+    SpecializedVertexShaders specialized_vertex_shaders;
+    std::unordered_map<PicaVSConfig, UniformHistory> uniform_histories;
     TrivialVertexShader trivial_vertex_shader;
 
+    ProgrammableGeometryShaders programmable_geometry_shaders;
     FixedGeometryShaders fixed_geometry_shaders;
 
     FragmentShaders fragment_shaders;
     std::unordered_map<ShaderTuple, OGLProgram, ShaderTuple::Hash> program_cache;
     OGLPipeline pipeline;
     ShaderDiskCache disk_cache;
+
+    std::unique_ptr<AsyncFragmentShaderCompiler> async_compiler;
+    std::unique_ptr<UberFragmentShader> uber_fragment_shader;
+    bool using_uber_fragment_shader = false;
 };
 
 ShaderProgramManager::ShaderProgramManager(bool separable, bool is_amd)
@@ -365,6 +629,9 @@ bool ShaderProgramManager::UseProgrammableVertexShader(const Pica::Regs& regs,
     if (handle == 0)
         return false;
     impl->current.vs = handle;
+    if (VideoCore::g_hw_shader_specialize_uniforms) {
+        UseSpecializedVertexShader(config, regs, setup);
+    }
     // Save VS to the disk cache if its a new shader
     if (result) {
         auto& disk_cache = impl->disk_cache;
@@ -379,10 +646,53 @@ bool ShaderProgramManager::UseProgrammableVertexShader(const Pica::Regs& regs,
     return true;
 }
 
+void ShaderProgramManager::UseSpecializedVertexShader(const PicaVSConfig& config,
+                                                      const Pica::Regs& regs,
+                                                      const Pica::Shader::ShaderSetup& setup) {
+    // Programs whose uniforms change from draw to draw keep the generic variant, and so does a
+    // program as soon as its uniforms change
+    const PicaSpecializedVSConfig specialized{config, regs.vs, setup};
+    auto& history = impl->uniform_histories[config];
+    if (history.last != specialized) {
+        history.last = specialized;
+        history.stable_draws = 0;
+        return;
+    }
+    if (history.stable_draws < VSSpecializationDraws) {
+        ++history.stable_draws;
+        return;
+    }
+
+    if (impl->specialized_vertex_shaders.Find(specialized) == 0) {
+        if (history.num_specializations == MaxVSSpecializations) {
+            return;
+        }
+        ++history.num_specializations;
+    }
+    // The specialized variants aren't saved to the disk cache, as they are cheap to rebuild
+    // on the way
+    const auto [handle, _] = impl->specialized_vertex_shaders.Get(specialized, setup);
+    if (handle != 0) {
+        impl->current.vs = handle;
+    }
+}
+
 void ShaderProgramManager::UseTrivialVertexShader() {
     impl->current.vs = impl->trivial_vertex_shader.Get();
 }
 
+bool ShaderProgramManager::UseProgrammableGeometryShader(const Pica::Regs& regs,
+                                                         Pica::Shader::ShaderSetup& setup) {
+    // Geometry shaders are not saved to the disk cache, whose loader only rebuilds vertex and
+    // fragment shaders
+    PicaGSConfig config{regs, setup};
+    auto [handle, _] = impl->programmable_geometry_shaders.Get(config, setup);
+    if (handle == 0)
+        return false;
+    impl->current.gs = handle;
+    return true;
+}
+
 void ShaderProgramManager::UseFixedGeometryShader(const Pica::Regs& regs) {
     PicaFixedGSConfig gs_config(regs);
     auto [handle, _] = impl->fixed_geometry_shaders.Get(gs_config);
@@ -393,8 +703,43 @@ void ShaderProgramManager::UseTrivialGeometryShader() {
     impl->current.gs = 0;
 }
 
+void ShaderProgramManager::EnableAsyncCompilation(
+    std::unique_ptr<Frontend::GraphicsContext> context) {
+    if (!impl->separable) {
+        LOG_WARNING(Render_OpenGL,
+                    "Asynchronous shader compilation requires separate shader programs");
+        return;
+    }
+    impl->uber_fragment_shader = std::make_unique<UberFragmentShader>();
+    impl->async_compiler = std::make_unique<AsyncFragmentShaderCompiler>(std::move(context));
+}
+
+bool ShaderProgramManager::IsUsingUberFragmentShader() const {
+    return impl->using_uber_fragment_shader;
+}
+
 void ShaderProgramManager::UseFragmentShader(const Pica::Regs& regs) {
     PicaFSConfig config = PicaFSConfig::BuildFromRegs(regs);
+    if (impl->async_compiler) {
+        impl->async_compiler->Collect([this](AsyncFragmentShaderCompiler::Result&& result) {
+            impl->fragment_shaders.Inject(result.config, std::move(result.program));
+            impl->disk_cache.SaveDecompiled(result.unique_identifier, result.code, false);
+        });
+
+        // Draw with the generic shader while the specialized one is being built
+        impl->using_uber_fragment_shader = false;
+        if (impl->fragment_shaders.Find(config) == 0 && CanUseUberFragmentShader(config)) {
+            if (!impl->async_compiler->IsPending(config)) {
+                const u64 unique_identifier = GetUniqueIdentifier(regs, {});
+                const ShaderDiskCacheRaw raw{unique_identifier, ProgramType::FS, regs, {}};
+                impl->disk_cache.SaveRaw(raw);
+                impl->async_compiler->Queue(config, unique_identifier);
+            }
+            impl->current.fs = impl->uber_fragment_shader->Get(config);
+            impl->using_uber_fragment_shader = true;
+            return;
+        }
+    }
     auto [handle, result] = impl->fragment_shaders.Get(config);
     impl->current.fs = handle;
     // Save FS to the disk cache if its a new shader
@@ -434,8 +779,9 @@ void ShaderProgramManager::ApplyTo(OpenGLState& state) {
     }
 }
 
-void ShaderProgramManager::LoadDiskCache(const std::atomic_bool& stop_loading,
-                                         const VideoCore::DiskResourceLoadCallback& callback) {
+void ShaderProgramManager::LoadDiskCache(
+    const std::atomic_bool& stop_loading, const VideoCore::DiskResourceLoadCallback& callback,
+    const std::vector<std::unique_ptr<Frontend::GraphicsContext>>& worker_contexts) {
     if (!impl->separable) {
         LOG_ERROR(Render_OpenGL,
                   "Cannot load disk cache as separate shader programs are unsupported!");
@@ -454,161 +800,206 @@ void ShaderProgramManager::LoadDiskCache(const std::atomic_bool& stop_loading,
         return;
     }
 
+    // Reject the whole cache up front if any entry is corrupted, before spending time on it
+    for (const auto& raw : raws) {
+        const u64 unique_identifier{raw.GetUniqueIdentifier()};
+        const u64 calculated_hash =
+            GetUniqueIdentifier(raw.GetRawShaderConfig(), raw.GetProgramCode());
+        if (unique_identifier != calculated_hash) {
+            LOG_ERROR(Render_OpenGL,
+                      "Invalid hash in entry={:016x} (obtained hash={:016x}) - removing "
+                      "shader cache",
+                      raw.GetUniqueIdentifier(), calculated_hash);
+            disk_cache.InvalidateAll();
+            return;
+        }
+        if (raw.GetProgramType() != ProgramType::VS && raw.GetProgramType() != ProgramType::FS) {
+            // Unsupported shader type got stored somehow so nuke the cache
+            LOG_ERROR(Frontend, "failed to load raw programtype {}",
+                      static_cast<u32>(raw.GetProgramType()));
+            disk_cache.InvalidateAll();
+            return;
+        }
+    }
+
     std::set<GLenum> supported_formats = GetSupportedFormats();
 
     // Track if precompiled cache was altered during loading to know if we have to serialize the
     // virtual precompiled cache file back to the hard drive
     bool precompiled_cache_altered = false;
 
-    std::mutex mutex;
-    std::atomic_bool compilation_failed = false;
+    // Progress is reported from whichever thread finishes an entry
+    std::mutex callback_mutex;
+    std::size_t num_done = 0;
+    const auto report_progress = [&](VideoCore::LoadCallbackStage stage, std::size_t total) {
+        if (callback) {
+            std::scoped_lock lock{callback_mutex};
+            callback(stage, ++num_done, total);
+        }
+    };
+
     if (callback) {
         callback(VideoCore::LoadCallbackStage::Decompile, 0, raws.size());
     }
+
+    // Entries with both a decompiled and a dumped program are loaded from the driver binary, the
+    // rest are built from their raw configuration in the next phase
+    struct PrecompiledEntry {
+        std::size_t raw_index;
+        const ShaderDiskCacheDecompiled* decompiled;
+        const ShaderDiskCacheDump* dump;
+        OGLProgram program;
+    };
+    std::vector<PrecompiledEntry> precompiled_entries;
     std::vector<std::size_t> load_raws_index;
-    // Loads both decompiled and precompiled shaders from the cache. If either one is missing for
-    const auto LoadPrecompiledWorker =
-        [&](std::size_t begin, std::size_t end, const std::vector<ShaderDiskCacheRaw>& raw_cache,
-            const ShaderDecompiledMap& decompiled_map, const ShaderDumpsMap& dump_map) {
-            for (std::size_t i = 0; i < end; ++i) {
-                if (stop_loading || compilation_failed) {
-                    return;
-                }
-                const auto& raw{raw_cache[i]};
-                const u64 unique_identifier{raw.GetUniqueIdentifier()};
-
-                const u64 calculated_hash =
-                    GetUniqueIdentifier(raw.GetRawShaderConfig(), raw.GetProgramCode());
-                if (unique_identifier != calculated_hash) {
-                    LOG_ERROR(Render_OpenGL,
-                              "Invalid hash in entry={:016x} (obtained hash={:016x}) - removing "
-                              "shader cache",
-                              raw.GetUniqueIdentifier(), calculated_hash);
-                    disk_cache.InvalidateAll();
-                    return;
-                }
+    for (std::size_t i = 0; i < raws.size(); ++i) {
+        const auto& raw{raws[i]};
+        const u64 unique_identifier{raw.GetUniqueIdentifier()};
+        const auto dump{dumps.find(unique_identifier)};
+        const auto decomp{decompiled.find(unique_identifier)};
+        if (dump == dumps.end() || decomp == decompiled.end()) {
+            load_raws_index.push_back(i);
+            continue;
+        }
+        // Only load vertex shaders whose sanitize_mul setting matches, rebuild the others
+        if (raw.GetProgramType() == ProgramType::VS &&
+            decomp->second.sanitize_mul != VideoCore::g_hw_shader_accurate_mul) {
+            load_raws_index.push_back(i);
+            continue;
+        }
+        precompiled_entries.push_back({i, &decomp->second, &dump->second, {}});
+    }
 
-                const auto dump{dump_map.find(unique_identifier)};
-                const auto decomp{decompiled_map.find(unique_identifier)};
-
-                OGLProgram shader;
-
-                if (dump != dump_map.end() && decomp != decompiled_map.end()) {
-                    // Only load this shader if its sanitize_mul setting matches
-                    if (decomp->second.sanitize_mul == VideoCore::g_hw_shader_accurate_mul) {
-                        continue;
-                    }
-
-                    // If the shader is dumped, attempt to load it
-                    shader = GeneratePrecompiledProgram(dump->second, supported_formats);
-                    if (shader.handle == 0) {
-                        // If any shader failed, stop trying to compile, delete the cache, and start
-                        // loading from raws
-                        compilation_failed = true;
-                        return;
-                    }
-                    // we have both the binary shader and the decompiled, so inject it into the
-                    // cache
-                    if (raw.GetProgramType() == ProgramType::VS) {
-                        auto [conf, setup] = BuildVSConfigFromRaw(raw);
-                        std::scoped_lock lock(mutex);
-
-                        impl->programmable_vertex_shaders.Inject(conf, decomp->second.result.code,
-                                                                 std::move(shader));
-                    } else if (raw.GetProgramType() == ProgramType::FS) {
-                        PicaFSConfig conf = PicaFSConfig::BuildFromRegs(raw.GetRawShaderConfig());
-                        std::scoped_lock lock(mutex);
-                        impl->fragment_shaders.Inject(conf, std::move(shader));
-                    } else {
-                        // Unsupported shader type got stored somehow so nuke the cache
-
-                        LOG_CRITICAL(Frontend, "failed to load raw programtype {}",
-                                     static_cast<u32>(raw.GetProgramType()));
-                        compilation_failed = true;
-                        return;
-                    }
-                } else {
-                    // Since precompiled didn't have the dump, we'll load them in the next phase
-                    std::scoped_lock lock(mutex);
-                    load_raws_index.push_back(i);
-                }
-                if (callback) {
-                    callback(VideoCore::LoadCallbackStage::Decompile, i, raw_cache.size());
-                }
-            }
-        };
+    std::atomic_bool compilation_failed = false;
+    RunOnWorkerContexts(worker_contexts, precompiled_entries.size(), [&](std::size_t index) {
+        if (stop_loading || compilation_failed) {
+            return;
+        }
+        auto& entry = precompiled_entries[index];
+        entry.program = GeneratePrecompiledProgram(*entry.dump, supported_formats);
+        if (entry.program.handle == 0) {
+            // If any shader failed, stop trying to compile, delete the cache, and start
+            // loading from raws
+            compilation_failed = true;
+            return;
+        }
+        report_progress(VideoCore::LoadCallbackStage::Decompile, raws.size());
+    });
 
-    LoadPrecompiledWorker(0, raws.size(), raws, decompiled, dumps);
+    if (stop_loading) {
+        return;
+    }
 
     if (compilation_failed) {
         // Invalidate the precompiled cache if a shader dumped shader was rejected
         disk_cache.InvalidatePrecompiled();
         dumps.clear();
         precompiled_cache_altered = true;
+
+        load_raws_index.resize(raws.size());
+        std::iota(load_raws_index.begin(), load_raws_index.end(), std::size_t{0});
+    } else {
+        // We have both the binary shader and the decompiled, so inject it into the cache
+        for (auto& entry : precompiled_entries) {
+            const auto& raw{raws[entry.raw_index]};
+            if (raw.GetProgramType() == ProgramType::VS) {
+                auto [conf, setup] = BuildVSConfigFromRaw(raw);
+                impl->programmable_vertex_shaders.Inject(conf, entry.decompiled->result.code,
+                                                         std::move(entry.program));
+            } else {
+                PicaFSConfig conf = PicaFSConfig::BuildFromRegs(raw.GetRawShaderConfig());
+                impl->fragment_shaders.Inject(conf, std::move(entry.program));
+            }
+        }
     }
+    precompiled_entries.clear();
 
     if (callback) {
-        callback(VideoCore::LoadCallbackStage::Build, 0, raws.size());
+        callback(VideoCore::LoadCallbackStage::Build, 0, load_raws_index.size());
+    }
+    num_done = 0;
+
+    // Decompile and build the remaining shaders at boot and save the result to the precompiled
+    // file. Code generation only needs the CPU, so it is spread over a plain thread pool.
+    struct BuildEntry {
+        std::size_t raw_index;
+        std::optional<ShaderDecompiler::ProgramResult> result;
+        bool sanitize_mul = false;
+        OGLProgram program;
+    };
+    std::vector<BuildEntry> build_entries;
+    build_entries.reserve(load_raws_index.size());
+    for (const std::size_t raw_index : load_raws_index) {
+        build_entries.push_back({raw_index, std::nullopt, false, {}});
+    }
+
+    {
+        const std::size_t num_threads = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+        Common::ThreadPool pool{std::min(num_threads, build_entries.size()), "ShaderDecompiler"};
+        pool.ParallelFor(build_entries.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (stop_loading) {
+                    return;
+                }
+                auto& entry = build_entries[i];
+                const auto& raw{raws[entry.raw_index]};
+                if (raw.GetProgramType() == ProgramType::VS) {
+                    auto [conf, setup] = BuildVSConfigFromRaw(raw);
+                    entry.result = GenerateVertexShader(setup, conf, impl->separable);
+                    entry.sanitize_mul = conf.state.sanitize_mul;
+                } else {
+                    PicaFSConfig conf = PicaFSConfig::BuildFromRegs(raw.GetRawShaderConfig());
+                    entry.result = GenerateFragmentShader(conf, impl->separable);
+                }
+            }
+        });
+    }
+
+    RunOnWorkerContexts(worker_contexts, build_entries.size(), [&](std::size_t index) {
+        auto& entry = build_entries[index];
+        if (stop_loading || !entry.result) {
+            return;
+        }
+        const GLenum type = raws[entry.raw_index].GetProgramType() == ProgramType::VS
+                                ? GL_VERTEX_SHADER
+                                : GL_FRAGMENT_SHADER;
+        OGLShader shader;
+        shader.Create(entry.result->code.c_str(), type);
+        entry.program.Create(true, {shader.handle});
+        report_progress(VideoCore::LoadCallbackStage::Build, build_entries.size());
+    });
+
+    if (stop_loading) {
+        return;
     }
 
     compilation_failed = false;
+    for (auto& entry : build_entries) {
+        const auto& raw{raws[entry.raw_index]};
+        const u64 unique_identifier{raw.GetUniqueIdentifier()};
 
-    const auto LoadTransferable = [&](std::size_t begin, std::size_t end,
-                                      const std::vector<ShaderDiskCacheRaw>& raw_cache) {
-        for (std::size_t i = 0; i < end; ++i) {
-            if (stop_loading || compilation_failed) {
-                return;
-            }
-            const auto& raw{raw_cache[i]};
-            const u64 unique_identifier{raw.GetUniqueIdentifier()};
-
-            bool sanitize_mul = false;
-            GLuint handle{0};
-            std::optional<ShaderDecompiler::ProgramResult> result;
-            // Otherwise decompile and build the shader at boot and save the result to the
-            // precompiled file
+        GLuint handle{0};
+        if (entry.program.handle != 0) {
             if (raw.GetProgramType() == ProgramType::VS) {
-                // TODO: This isn't the ideal place to lock, since we really only want to
-                // lock access to the shared cache
                 auto [conf, setup] = BuildVSConfigFromRaw(raw);
-                std::scoped_lock lock(mutex);
-                auto [h, r] = impl->programmable_vertex_shaders.Get(conf, setup);
-                handle = h;
-                result = std::move(r);
-                sanitize_mul = conf.state.sanitize_mul;
-            } else if (raw.GetProgramType() == ProgramType::FS) {
-                PicaFSConfig conf = PicaFSConfig::BuildFromRegs(raw.GetRawShaderConfig());
-                std::scoped_lock lock(mutex);
-                auto [h, r] = impl->fragment_shaders.Get(conf);
-                handle = h;
-                result = std::move(r);
+                handle = impl->programmable_vertex_shaders.Inject(conf, entry.result->code,
+                                                                  std::move(entry.program));
             } else {
-                // Unsupported shader type got stored somehow so nuke the cache
-                LOG_ERROR(Frontend, "failed to load raw programtype {}",
-                          static_cast<u32>(raw.GetProgramType()));
-                compilation_failed = true;
-                return;
-            }
-            if (handle == 0) {
-                LOG_ERROR(Frontend, "compilation from raw failed {:x} {:x}",
-                          raw.GetProgramCode().at(0), raw.GetProgramCode().at(1));
-                compilation_failed = true;
-                return;
-            }
-            // If this is a new shader, add it the precompiled cache
-            if (result) {
-                disk_cache.SaveDecompiled(unique_identifier, *result, sanitize_mul);
-                disk_cache.SaveDump(unique_identifier, handle);
-                precompiled_cache_altered = true;
-            }
-
-            if (callback) {
-                callback(VideoCore::LoadCallbackStage::Build, i, raw_cache.size());
+                PicaFSConfig conf = PicaFSConfig::BuildFromRegs(raw.GetRawShaderConfig());
+                handle = impl->fragment_shaders.Inject(conf, std::move(entry.program));
             }
         }
-    };
-
-    LoadTransferable(0, raws.size(), raws);
+        if (handle == 0) {
+            LOG_ERROR(Frontend, "compilation from raw failed {:x} {:x}",
+                      raw.GetProgramCode().at(0), raw.GetProgramCode().at(1));
+            compilation_failed = true;
+            break;
+        }
+        // Add the new shader to the precompiled cache
+        disk_cache.SaveDecompiled(unique_identifier, *entry.result, entry.sanitize_mul);
+        disk_cache.SaveDump(unique_identifier, handle);
+        precompiled_cache_altered = true;
+    }
 
     if (compilation_failed) {
         disk_cache.InvalidateAll();
@@ -617,6 +1008,6 @@ void ShaderProgramManager::LoadDiskCache(const std::atomic_bool& stop_loading,
     if (precompiled_cache_altered) {
         disk_cache.SaveVirtualPrecompiledFile();
     }
-} // namespace OpenGL
+}
 
 } // namespace OpenGL
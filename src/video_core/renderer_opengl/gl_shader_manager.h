@@ -5,6 +5,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <glad/glad.h>
 #include "video_core/rasterizer_interface.h"
 #include "video_core/regs_lighting.h"
@@ -17,6 +18,10 @@ namespace Core {
 class System;
 }
 
+namespace Frontend {
+class GraphicsContext;
+}
+
 namespace OpenGL {
 
 enum class UniformBindings : GLuint { Common, VS, GS };
@@ -96,19 +101,44 @@ static_assert(
 static_assert(sizeof(VSUniformData) < 16384,
               "VSUniformData structure must be less than 16kb as per the OpenGL spec");
 
+struct GSUniformData {
+    PicaUniformsData uniforms;
+};
+static_assert(
+    sizeof(GSUniformData) == 1856,
+    "The size of the GSUniformData structure has changed, update the structure in the shader");
+static_assert(sizeof(GSUniformData) < 16384,
+              "GSUniformData structure must be less than 16kb as per the OpenGL spec");
+
 /// A class that manage different shader stages and configures them with given config data.
 class ShaderProgramManager {
 public:
     ShaderProgramManager(bool separable, bool is_amd);
     ~ShaderProgramManager();
 
-    void LoadDiskCache(const std::atomic_bool& stop_loading,
-                       const VideoCore::DiskResourceLoadCallback& callback);
+    /**
+     * Loads the disk shader cache, compiling programs on every worker context in parallel with
+     * the calling thread. The worker contexts must be shared with the current one.
+     */
+    void LoadDiskCache(
+        const std::atomic_bool& stop_loading, const VideoCore::DiskResourceLoadCallback& callback,
+        const std::vector<std::unique_ptr<Frontend::GraphicsContext>>& worker_contexts);
+
+    /**
+     * Makes fragment shaders missing from the cache build on a background thread using the given
+     * shared context. Draws use a generic shader until they are ready.
+     */
+    void EnableAsyncCompilation(std::unique_ptr<Frontend::GraphicsContext> context);
+
+    /// Returns whether the current fragment shader is the generic one, waiting for a build
+    bool IsUsingUberFragmentShader() const;
 
     bool UseProgrammableVertexShader(const Pica::Regs& config, Pica::Shader::ShaderSetup& setup);
 
     void UseTrivialVertexShader();
 
+    bool UseProgrammableGeometryShader(const Pica::Regs& regs, Pica::Shader::ShaderSetup& setup);
+
     void UseFixedGeometryShader(const Pica::Regs& regs);
 
     void UseTrivialGeometryShader();
@@ -118,6 +148,13 @@ public:
     void ApplyTo(OpenGLState& state);
 
 private:
+    /**
+     * Switches the current vertex shader to a variant of the given program with its bool and int
+     * uniforms folded in, once they have stayed the same for enough draws in a row
+     */
+    void UseSpecializedVertexShader(const PicaVSConfig& config, const Pica::Regs& regs,
+                                    const Pica::Shader::ShaderSetup& setup);
+
     class Impl;
     std::unique_ptr<Impl> impl;
 };
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <cstring>
+#include <tuple>
 #include <glad/glad.h>
 #include "common/common_funcs.h"
 #include "common/logging/log.h"
@@ -13,6 +15,9 @@ namespace OpenGL {
 OpenGLState OpenGLState::cur_state;
 
 OpenGLState::OpenGLState() {
+    // Zeroes the padding, which Apply compares along with the members
+    std::memset(static_cast<void*>(this), 0, sizeof(*this));
+
     // These all match default OpenGL values
     cull.enabled = false;
     cull.mode = GL_BACK;
@@ -93,40 +98,59 @@ OpenGLState::OpenGLState() {
     renderbuffer = 0;
 }
 
+/**
+ * Returns whether a group of the state holds the same bytes in both states. The padding is zeroed
+ * on construction and copied along with the members, so a group left alone compares equal. A group
+ * differing only in its padding or in the sign of a zero is merely applied member by member.
+ */
+template <typename T>
+static bool IsGroupEqual(const T& group, const T& cur_group) {
+    return std::memcmp(&group, &cur_group, sizeof(T)) == 0;
+}
+
 void OpenGLState::Apply() const {
+    // Most calls come from code setting up the same state again
+    if (IsGroupEqual(*this, cur_state)) {
+        return;
+    }
+
     // Culling
-    if (cull.enabled != cur_state.cull.enabled) {
-        if (cull.enabled) {
-            glEnable(GL_CULL_FACE);
-        } else {
-            glDisable(GL_CULL_FACE);
+    if (!IsGroupEqual(cull, cur_state.cull)) {
+        if (cull.enabled != cur_state.cull.enabled) {
+            if (cull.enabled) {
+                glEnable(GL_CULL_FACE);
+            } else {
+                glDisable(GL_CULL_FACE);
+            }
         }
-    }
 
-    if (cull.mode != cur_state.cull.mode) {
-        glCullFace(cull.mode);
-    }
+        if (cull.mode != cur_state.cull.mode) {
+            glCullFace(cull.mode);
+        }
 
-    if (cull.front_face != cur_state.cull.front_face) {
-        glFrontFace(cull.front_face);
+        if (cull.front_face != cur_state.cull.front_face) {
+            glFrontFace(cull.front_face);
+        }
     }
 
-    // Depth test
-    if (depth.test_enabled != cur_state.depth.test_enabled) {
-        if (depth.test_enabled) {
-            glEnable(GL_DEPTH_TEST);
-        } else {
-            glDisable(GL_DEPTH_TEST);
+    if (!IsGroupEqual(depth, cur_state.depth)) {
+        // Depth test
+        if (depth.test_enabled != cur_state.depth.test_enabled) {
+            if (depth.test_enabled) {
+                glEnable(GL_DEPTH_TEST);
+            } else {
+                glDisable(GL_DEPTH_TEST);
+            }
         }
-    }
 
-    if (depth.test_func != cur_state.depth.test_func) {
-        glDepthFunc(depth.test_func);
-    }
+        if (depth.test_func != cur_state.depth.test_func) {
+            glDepthFunc(depth.test_func);
+        }
 
-    // Depth mask
-    if (depth.write_mask != cur_state.depth.write_mask) {
-        glDepthMask(depth.write_mask);
+        // Depth mask
+        if (depth.write_mask != cur_state.depth.write_mask) {
+            glDepthMask(depth.write_mask);
+        }
     }
 
     // Color mask
@@ -138,62 +162,71 @@ void OpenGLState::Apply() const {
                     color_mask.alpha_enabled);
     }
 
-    // Stencil test
-    if (stencil.test_enabled != cur_state.stencil.test_enabled) {
-        if (stencil.test_enabled) {
-            glEnable(GL_STENCIL_TEST);
-        } else {
-            glDisable(GL_STENCIL_TEST);
+    if (!IsGroupEqual(stencil, cur_state.stencil)) {
+        // Stencil test
+        if (stencil.test_enabled != cur_state.stencil.test_enabled) {
+            if (stencil.test_enabled) {
+                glEnable(GL_STENCIL_TEST);
+            } else {
+                glDisable(GL_STENCIL_TEST);
+            }
         }
-    }
 
-    if (stencil.test_func != cur_state.stencil.test_func ||
-        stencil.test_ref != cur_state.stencil.test_ref ||
-        stencil.test_mask != cur_state.stencil.test_mask) {
-        glStencilFunc(stencil.test_func, stencil.test_ref, stencil.test_mask);
-    }
+        if (stencil.test_func != cur_state.stencil.test_func ||
+            stencil.test_ref != cur_state.stencil.test_ref ||
+            stencil.test_mask != cur_state.stencil.test_mask) {
+            glStencilFunc(stencil.test_func, stencil.test_ref, stencil.test_mask);
+        }
 
-    if (stencil.action_depth_fail != cur_state.stencil.action_depth_fail ||
-        stencil.action_depth_pass != cur_state.stencil.action_depth_pass ||
-        stencil.action_stencil_fail != cur_state.stencil.action_stencil_fail) {
-        glStencilOp(stencil.action_stencil_fail, stencil.action_depth_fail,
-                    stencil.action_depth_pass);
-    }
+        if (stencil.action_depth_fail != cur_state.stencil.action_depth_fail ||
+            stencil.action_depth_pass != cur_state.stencil.action_depth_pass ||
+            stencil.action_stencil_fail != cur_state.stencil.action_stencil_fail) {
+            glStencilOp(stencil.action_stencil_fail, stencil.action_depth_fail,
+                        stencil.action_depth_pass);
+        }
 
-    // Stencil mask
-    if (stencil.write_mask != cur_state.stencil.write_mask) {
-        glStencilMask(stencil.write_mask);
+        // Stencil mask
+        if (stencil.write_mask != cur_state.stencil.write_mask) {
+            glStencilMask(stencil.write_mask);
+        }
     }
 
     // Blending
-    if (blend.enabled != cur_state.blend.enabled) {
-        if (blend.enabled) {
-            glEnable(GL_BLEND);
-            glDisable(GL_COLOR_LOGIC_OP);
-        } else {
-            glDisable(GL_BLEND);
-            glEnable(GL_COLOR_LOGIC_OP);
+    if (!IsGroupEqual(blend, cur_state.blend)) {
+        if (blend.enabled != cur_state.blend.enabled) {
+            // GLES3 has no GL_COLOR_LOGIC_OP, the fragment shaders apply the logic op there
+            if (blend.enabled) {
+                glEnable(GL_BLEND);
+                if (!GLES) {
+                    glDisable(GL_COLOR_LOGIC_OP);
+                }
+            } else {
+                glDisable(GL_BLEND);
+                if (!GLES) {
+                    glEnable(GL_COLOR_LOGIC_OP);
+                }
+            }
         }
-    }
 
-    if (blend.color.red != cur_state.blend.color.red ||
-        blend.color.green != cur_state.blend.color.green ||
-        blend.color.blue != cur_state.blend.color.blue ||
-        blend.color.alpha != cur_state.blend.color.alpha) {
-        glBlendColor(blend.color.red, blend.color.green, blend.color.blue, blend.color.alpha);
-    }
+        if (blend.color.red != cur_state.blend.color.red ||
+            blend.color.green != cur_state.blend.color.green ||
+            blend.color.blue != cur_state.blend.color.blue ||
+            blend.color.alpha != cur_state.blend.color.alpha) {
+            glBlendColor(blend.color.red, blend.color.green, blend.color.blue, blend.color.alpha);
+        }
 
-    if (blend.src_rgb_func != cur_state.blend.src_rgb_func ||
-        blend.dst_rgb_func != cur_state.blend.dst_rgb_func ||
-        blend.src_a_func != cur_state.blend.src_a_func ||
-        blend.dst_a_func != cur_state.blend.dst_a_func) {
-        glBlendFuncSeparate(blend.src_rgb_func, blend.dst_rgb_func, blend.src_a_func,
-                            blend.dst_a_func);
-    }
+        if (blend.src_rgb_func != cur_state.blend.src_rgb_func ||
+            blend.dst_rgb_func != cur_state.blend.dst_rgb_func ||
+            blend.src_a_func != cur_state.blend.src_a_func ||
+            blend.dst_a_func != cur_state.blend.dst_a_func) {
+            glBlendFuncSeparate(blend.src_rgb_func, blend.dst_rgb_func, blend.src_a_func,
+                                blend.dst_a_func);
+        }
 
-    if (blend.rgb_equation != cur_state.blend.rgb_equation ||
-        blend.a_equation != cur_state.blend.a_equation) {
-        glBlendEquationSeparate(blend.rgb_equation, blend.a_equation);
+        if (blend.rgb_equation != cur_state.blend.rgb_equation ||
+            blend.a_equation != cur_state.blend.a_equation) {
+            glBlendEquationSeparate(blend.rgb_equation, blend.a_equation);
+        }
     }
 
     // GLES3 does not support glLogicOp
@@ -206,13 +239,36 @@ void OpenGLState::Apply() const {
     }
 
     // Textures
-    for (u32 i = 0; i < texture_units.size(); ++i) {
-        if (texture_units[i].texture_2d != cur_state.texture_units[i].texture_2d) {
-            glActiveTexture(TextureUnits::PicaTexture(i).Enum());
-            glBindTexture(GL_TEXTURE_2D, texture_units[i].texture_2d);
-        }
-        if (texture_units[i].sampler != cur_state.texture_units[i].sampler) {
-            glBindSampler(i, texture_units[i].sampler);
+    if (!IsGroupEqual(texture_units, cur_state.texture_units)) {
+        if (GLAD_GL_ARB_multi_bind) {
+            // The units of the PICA textures are the first ones, bound in a single call each
+            std::array<GLuint, std::tuple_size_v<decltype(texture_units)>> textures;
+            std::array<GLuint, std::tuple_size_v<decltype(texture_units)>> samplers;
+            bool textures_changed = false;
+            bool samplers_changed = false;
+            for (u32 i = 0; i < texture_units.size(); ++i) {
+                textures[i] = texture_units[i].texture_2d;
+                samplers[i] = texture_units[i].sampler;
+                textures_changed |= textures[i] != cur_state.texture_units[i].texture_2d;
+                samplers_changed |= samplers[i] != cur_state.texture_units[i].sampler;
+            }
+            static_assert(TextureUnits::PicaTexture(0).id == 0);
+            if (textures_changed) {
+                glBindTextures(0, static_cast<GLsizei>(textures.size()), textures.data());
+            }
+            if (samplers_changed) {
+                glBindSamplers(0, static_cast<GLsizei>(samplers.size()), samplers.data());
+            }
+        } else {
+            for (u32 i = 0; i < texture_units.size(); ++i) {
+                if (texture_units[i].texture_2d != cur_state.texture_units[i].texture_2d) {
+                    glActiveTexture(TextureUnits::PicaTexture(i).Enum());
+                    glBindTexture(GL_TEXTURE_2D, texture_units[i].texture_2d);
+                }
+                if (texture_units[i].sampler != cur_state.texture_units[i].sampler) {
+                    glBindSampler(i, texture_units[i].sampler);
+                }
+            }
         }
     }
 
@@ -273,51 +329,56 @@ void OpenGLState::Apply() const {
                            GL_READ_ONLY, GL_R32UI);
     }
 
-    // Framebuffer
-    if (draw.read_framebuffer != cur_state.draw.read_framebuffer) {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, draw.read_framebuffer);
-    }
-    if (draw.draw_framebuffer != cur_state.draw.draw_framebuffer) {
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw.draw_framebuffer);
-    }
+    if (!IsGroupEqual(draw, cur_state.draw)) {
+        // Framebuffer
+        if (draw.read_framebuffer != cur_state.draw.read_framebuffer) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, draw.read_framebuffer);
+        }
+        if (draw.draw_framebuffer != cur_state.draw.draw_framebuffer) {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw.draw_framebuffer);
+        }
 
-    // Vertex array
-    if (draw.vertex_array != cur_state.draw.vertex_array) {
-        glBindVertexArray(draw.vertex_array);
-    }
+        // Vertex array
+        if (draw.vertex_array != cur_state.draw.vertex_array) {
+            glBindVertexArray(draw.vertex_array);
+        }
 
-    // Vertex buffer
-    if (draw.vertex_buffer != cur_state.draw.vertex_buffer) {
-        glBindBuffer(GL_ARRAY_BUFFER, draw.vertex_buffer);
-    }
+        // Vertex buffer
+        if (draw.vertex_buffer != cur_state.draw.vertex_buffer) {
+            glBindBuffer(GL_ARRAY_BUFFER, draw.vertex_buffer);
+        }
 
-    // Uniform buffer
-    if (draw.uniform_buffer != cur_state.draw.uniform_buffer) {
-        glBindBuffer(GL_UNIFORM_BUFFER, draw.uniform_buffer);
-    }
+        // Uniform buffer
+        if (draw.uniform_buffer != cur_state.draw.uniform_buffer) {
+            glBindBuffer(GL_UNIFORM_BUFFER, draw.uniform_buffer);
+        }
 
-    // Shader program
-    if (draw.shader_program != cur_state.draw.shader_program) {
-        glUseProgram(draw.shader_program);
-    }
+        // Shader program
+        if (draw.shader_program != cur_state.draw.shader_program) {
+            glUseProgram(draw.shader_program);
+        }
 
-    // Program pipeline
-    if (draw.program_pipeline != cur_state.draw.program_pipeline) {
-        glBindProgramPipeline(draw.program_pipeline);
+        // Program pipeline
+        if (draw.program_pipeline != cur_state.draw.program_pipeline) {
+            glBindProgramPipeline(draw.program_pipeline);
+        }
     }
 
-    // Scissor test
-    if (scissor.enabled != cur_state.scissor.enabled) {
-        if (scissor.enabled) {
-            glEnable(GL_SCISSOR_TEST);
-        } else {
-            glDisable(GL_SCISSOR_TEST);
+    if (!IsGroupEqual(scissor, cur_state.scissor)) {
+        // Scissor test
+        if (scissor.enabled != cur_state.scissor.enabled) {
+            if (scissor.enabled) {
+                glEnable(GL_SCISSOR_TEST);
+            } else {
+                glDisable(GL_SCISSOR_TEST);
+            }
         }
-    }
 
-    if (scissor.x != cur_state.scissor.x || scissor.y != cur_state.scissor.y ||
-        scissor.width != cur_state.scissor.width || scissor.height != cur_state.scissor.height) {
-        glScissor(scissor.x, scissor.y, scissor.width, scissor.height);
+        if (scissor.x != cur_state.scissor.x || scissor.y != cur_state.scissor.y ||
+            scissor.width != cur_state.scissor.width ||
+            scissor.height != cur_state.scissor.height) {
+            glScissor(scissor.x, scissor.y, scissor.width, scissor.height);
+        }
     }
 
     if (viewport.x != cur_state.viewport.x || viewport.y != cur_state.viewport.y ||
@@ -2,22 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <deque>
-#include <vector>
+#include <algorithm>
 #include "common/alignment.h"
 #include "common/assert.h"
 #include "common/microprofile.h"
 #include "video_core/renderer_opengl/gl_state.h"
 #include "video_core/renderer_opengl/gl_stream_buffer.h"
 
-MICROPROFILE_DEFINE(OpenGL_StreamBuffer, "OpenGL", "Stream Buffer Orphaning",
-                    MP_RGB(128, 128, 192));
+MICROPROFILE_DEFINE(OpenGL_StreamBuffer, "OpenGL", "Stream Buffer Wait", MP_RGB(128, 128, 192));
 
 namespace OpenGL {
 
 OGLStreamBuffer::OGLStreamBuffer(GLenum target, GLsizeiptr size, bool array_buffer_for_amd,
                                  bool prefer_coherent)
-    : gl_target(target), buffer_size(size) {
+    : gl_target(target), buffer_size(size), region_size(size / NUM_REGIONS) {
+    ASSERT(size > 0 && static_cast<std::size_t>(size) % NUM_REGIONS == 0);
     gl_buffer.Create();
     glBindBuffer(gl_target, gl_buffer.handle);
 
@@ -31,12 +30,16 @@ OGLStreamBuffer::OGLStreamBuffer(GLenum target, GLsizeiptr size, bool array_buff
         allocate_size *= 2;
     }
 
-    if (GLAD_GL_ARB_buffer_storage) {
+    if (GLAD_GL_ARB_buffer_storage || GLAD_GL_EXT_buffer_storage) {
         persistent = true;
         coherent = prefer_coherent;
         GLbitfield flags =
             GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | (coherent ? GL_MAP_COHERENT_BIT : 0);
-        glBufferStorage(gl_target, allocate_size, nullptr, flags);
+        if (GLAD_GL_ARB_buffer_storage) {
+            glBufferStorage(gl_target, allocate_size, nullptr, flags);
+        } else {
+            glBufferStorageEXT(gl_target, allocate_size, nullptr, flags);
+        }
         mapped_ptr = static_cast<u8*>(glMapBufferRange(
             gl_target, 0, buffer_size, flags | (coherent ? 0 : GL_MAP_FLUSH_EXPLICIT_BIT)));
     } else {
@@ -45,6 +48,11 @@ OGLStreamBuffer::OGLStreamBuffer(GLenum target, GLsizeiptr size, bool array_buff
 }
 
 OGLStreamBuffer::~OGLStreamBuffer() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
     if (persistent) {
         glBindBuffer(gl_target, gl_buffer.handle);
         glUnmapBuffer(gl_target);
@@ -69,21 +77,29 @@ std::tuple<u8*, GLintptr, bool> OGLStreamBuffer::Map(GLsizeiptr size, GLintptr a
         buffer_pos = Common::AlignUp<std::size_t>(buffer_pos, alignment);
     }
 
-    bool invalidate = false;
+    bool wrapped = false;
     if (buffer_pos + size > buffer_size) {
+        // Continue at the start of the buffer. The regions past the last chunk were not written
+        // since they were fenced last time.
+        FenceRegions(static_cast<std::size_t>((buffer_pos + region_size - 1) / region_size));
+        next_fence_region = 0;
         buffer_pos = 0;
-        invalidate = true;
-
-        if (persistent) {
-            glUnmapBuffer(gl_target);
-        }
+        wrapped = true;
+    } else {
+        FenceRegions(static_cast<std::size_t>(buffer_pos / region_size));
     }
+    WaitRegions(buffer_pos, buffer_pos + size);
 
-    if (invalidate || !persistent) {
-        MICROPROFILE_SCOPE(OpenGL_StreamBuffer);
-        GLbitfield flags = GL_MAP_WRITE_BIT | (persistent ? GL_MAP_PERSISTENT_BIT : 0) |
-                           (coherent ? GL_MAP_COHERENT_BIT : GL_MAP_FLUSH_EXPLICIT_BIT) |
-                           (invalidate ? GL_MAP_INVALIDATE_BUFFER_BIT : GL_MAP_UNSYNCHRONIZED_BIT);
+    // Chunks handed out earlier may be rewritten once the regions holding them are reused, so the
+    // callers upload again whatever they keep referring to every time a new region is entered
+    const std::size_t region = static_cast<std::size_t>(buffer_pos / region_size);
+    const bool invalidate = wrapped || region != current_region;
+    current_region = region;
+
+    if (!persistent) {
+        // The GPU is done with the range, so the driver doesn't need to synchronize either
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT |
+                                 GL_MAP_UNSYNCHRONIZED_BIT;
         mapped_ptr = static_cast<u8*>(
             glMapBufferRange(gl_target, buffer_pos, buffer_size - buffer_pos, flags));
         mapped_offset = buffer_pos;
@@ -106,4 +122,31 @@ void OGLStreamBuffer::Unmap(GLsizeiptr size) {
     buffer_pos += size;
 }
 
+void OGLStreamBuffer::FenceRegions(std::size_t end_region) {
+    for (; next_fence_region < std::min(end_region, NUM_REGIONS); ++next_fence_region) {
+        GLsync& fence = fences[next_fence_region];
+        if (fence) {
+            // The region was skipped over, the new fence covers everything the old one did
+            glDeleteSync(fence);
+        }
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void OGLStreamBuffer::WaitRegions(GLintptr begin, GLintptr end) {
+    const std::size_t first_region = static_cast<std::size_t>(begin / region_size);
+    const std::size_t last_region =
+        std::min(static_cast<std::size_t>((end - 1) / region_size), NUM_REGIONS - 1);
+    for (std::size_t region = first_region; region <= last_region; ++region) {
+        GLsync& fence = fences[region];
+        if (!fence) {
+            continue;
+        }
+        MICROPROFILE_SCOPE(OpenGL_StreamBuffer);
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
 } // namespace OpenGL
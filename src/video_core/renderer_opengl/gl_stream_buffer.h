@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <tuple>
 #include <glad/glad.h>
 #include "common/common_types.h"
@@ -23,9 +25,12 @@ public:
     /*
      * Allocates a linear chunk of memory in the GPU buffer with at least "size" bytes
      * and the optional alignment requirement.
-     * If the buffer is full, the whole buffer is reallocated which invalidates old chunks.
+     * The buffer is split into regions that are reused in a ring. Each region is fenced once all
+     * its chunks were handed out, and waited on before it is written again, so writes never wait
+     * on the driver synchronizing the buffer.
      * The return values are the pointer to the new chunk, the offset within the buffer,
-     * and the invalidation flag for previous chunks.
+     * and the invalidation flag for previous chunks, which is set when the chunk starts a new
+     * region. Previous chunks must not be used by later draws after that.
      * The actual used size must be specified on unmapping the chunk.
      */
     std::tuple<u8*, GLintptr, bool> Map(GLsizeiptr size, GLintptr alignment = 0);
@@ -33,6 +38,14 @@ public:
     void Unmap(GLsizeiptr size);
 
 private:
+    static constexpr std::size_t NUM_REGIONS = 8;
+
+    /// Fences the regions that all chunks have moved past, from next_fence_region to end_region
+    void FenceRegions(std::size_t end_region);
+
+    /// Waits until the GPU is done with the regions overlapping [begin, end)
+    void WaitRegions(GLintptr begin, GLintptr end);
+
     OGLBuffer gl_buffer;
     GLenum gl_target;
 
@@ -44,6 +57,11 @@ private:
     GLintptr mapped_offset = 0;
     GLsizeiptr mapped_size = 0;
     u8* mapped_ptr = nullptr;
+
+    GLsizeiptr region_size = 0;
+    std::size_t current_region = 0;
+    std::size_t next_fence_region = 0;
+    std::array<GLsync, NUM_REGIONS> fences{};
 };
 
 } // namespace OpenGL
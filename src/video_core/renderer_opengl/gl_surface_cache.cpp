@@ -0,0 +1,83 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "video_core/renderer_opengl/gl_surface_cache.h"
+
+namespace OpenGL {
+
+void SurfaceCache::Insert(const Surface& surface, SurfaceInterval interval) {
+    const PAddr start = boost::icl::first(interval);
+    const PAddr end = boost::icl::last_next(interval);
+    ASSERT(start < end);
+
+    u32 index;
+    if (!free_nodes.empty()) {
+        index = free_nodes.back();
+        free_nodes.pop_back();
+    } else {
+        index = static_cast<u32>(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& node = nodes[index];
+    node.surface = surface;
+    node.start = start;
+    node.end = end;
+
+    for (u32 bucket = start >> BUCKET_BITS; bucket <= (end - 1) >> BUCKET_BITS; ++bucket) {
+        buckets[bucket].push_back(index);
+    }
+    ++num_surfaces;
+}
+
+void SurfaceCache::Erase(const Surface& surface, SurfaceInterval interval) {
+    const PAddr start = boost::icl::first(interval);
+    const PAddr end = boost::icl::last_next(interval);
+
+    const auto& first_bucket = buckets[start >> BUCKET_BITS];
+    const auto node_it = std::find_if(first_bucket.begin(), first_bucket.end(),
+                                      [&](u32 index) { return nodes[index].surface == surface; });
+    ASSERT_MSG(node_it != first_bucket.end(), "Surface is not in the cache");
+    const u32 index = *node_it;
+
+    for (u32 bucket = start >> BUCKET_BITS; bucket <= (end - 1) >> BUCKET_BITS; ++bucket) {
+        auto& entries = buckets[bucket];
+        const auto it = std::find(entries.begin(), entries.end(), index);
+        ASSERT(it != entries.end());
+        *it = entries.back();
+        entries.pop_back();
+    }
+
+    nodes[index].surface.reset();
+    free_nodes.push_back(index);
+    --num_surfaces;
+}
+
+void SurfaceCache::Clear() {
+    nodes.clear();
+    free_nodes.clear();
+    // Keep the bucket storage around for the surfaces that will be created next
+    for (auto& [bucket_index, bucket] : buckets) {
+        bucket.clear();
+    }
+    num_surfaces = 0;
+}
+
+Surface SurfaceCache::Front() const {
+    ASSERT(!Empty());
+    const auto it = std::find_if(nodes.begin(), nodes.end(),
+                                 [](const Node& node) { return node.surface != nullptr; });
+    return it->surface;
+}
+
+u32& CachedPageCounter::GetCount(u32 page) {
+    auto& chunk = chunks[page >> CHUNK_BITS];
+    if (!chunk) {
+        chunk = std::make_unique<std::array<u32, CHUNK_SIZE>>();
+        chunk->fill(0);
+    }
+    return (*chunk)[page & (CHUNK_SIZE - 1)];
+}
+
+} // namespace OpenGL
@@ -0,0 +1,181 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "common/assert.h"
+#include "common/common_types.h"
+#include "core/memory.h"
+#include "video_core/renderer_opengl/gl_surface_params.h"
+
+namespace OpenGL {
+
+/**
+ * Index of the surfaces registered in the rasterizer cache. The physical address space is split
+ * into fixed size buckets and every surface is listed in each bucket it overlaps, so a lookup
+ * only looks at surfaces close to the queried range. Entries are pooled and reused, and lookups
+ * never allocate.
+ */
+class SurfaceCache {
+public:
+    /// Adds a surface covering the given interval. The interval must not change until removal.
+    void Insert(const Surface& surface, SurfaceInterval interval);
+
+    /// Removes a surface that was inserted with the given interval
+    void Erase(const Surface& surface, SurfaceInterval interval);
+
+    /// Removes every surface
+    void Clear();
+
+    bool Empty() const {
+        return num_surfaces == 0;
+    }
+
+    /// Returns one of the surfaces in the cache, which must not be empty
+    Surface Front() const;
+
+    /**
+     * Calls func(const Surface&) once for every surface overlapping the interval, in no
+     * particular order. func must not modify the cache or look up other surfaces in it.
+     */
+    template <typename Func>
+    void ForEachOverlapping(SurfaceInterval interval, Func&& func) const {
+        const PAddr start = boost::icl::first(interval);
+        const PAddr end = boost::icl::last_next(interval);
+        if (start >= end) {
+            return;
+        }
+
+        // Surfaces spanning several buckets are only reported the first time they are seen
+        ++current_visit;
+        const auto visit_bucket = [&](const std::vector<u32>& bucket) {
+            for (const u32 index : bucket) {
+                const Node& node = nodes[index];
+                if (node.visit == current_visit || node.end <= start || node.start >= end) {
+                    continue;
+                }
+                node.visit = current_visit;
+                func(node.surface);
+            }
+        };
+
+        const u32 first_bucket = start >> BUCKET_BITS;
+        const u32 last_bucket = (end - 1) >> BUCKET_BITS;
+        if (last_bucket - first_bucket >= buckets.size()) {
+            // Huge ranges, e.g. a full flush, are cheaper to handle by walking the used buckets
+            for (const auto& [bucket_index, bucket] : buckets) {
+                if (bucket_index >= first_bucket && bucket_index <= last_bucket) {
+                    visit_bucket(bucket);
+                }
+            }
+            return;
+        }
+        for (u32 bucket_index = first_bucket;; ++bucket_index) {
+            const auto it = buckets.find(bucket_index);
+            if (it != buckets.end()) {
+                visit_bucket(it->second);
+            }
+            if (bucket_index == last_bucket) {
+                break;
+            }
+        }
+    }
+
+private:
+    /// Each bucket covers 64KiB of the physical address space
+    static constexpr u32 BUCKET_BITS = 16;
+
+    struct Node {
+        Surface surface;
+        PAddr start = 0;
+        PAddr end = 0;
+        mutable u64 visit = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<u32> free_nodes;
+    std::unordered_map<u32, std::vector<u32>> buckets;
+    std::size_t num_surfaces = 0;
+    mutable u64 current_visit = 0;
+};
+
+/**
+ * Counts how many cached surfaces touch each page of the physical address space. Counts are
+ * stored in lazily allocated chunks of consecutive pages.
+ */
+class CachedPageCounter {
+public:
+    /**
+     * Adds delta to the count of every page in [page_start, page_end). For every run of pages
+     * whose count went from zero to non-zero, or back to zero, calls
+     * func(u32 run_start, u32 run_end, bool cached).
+     */
+    template <typename Func>
+    void Update(u32 page_start, u32 page_end, int delta, Func&& func) {
+        u32 run_start = 0;
+        bool in_run = false;
+        for (u32 page = page_start; page < page_end; ++page) {
+            u32& count = GetCount(page);
+            ASSERT(delta >= 0 || count >= static_cast<u32>(-delta));
+            const bool was_zero = count == 0;
+            count += delta;
+
+            const bool changed = delta > 0 ? was_zero : count == 0;
+            if (changed && !in_run) {
+                run_start = page;
+                in_run = true;
+            } else if (!changed && in_run) {
+                func(run_start, page, delta > 0);
+                in_run = false;
+            }
+        }
+        if (in_run) {
+            func(run_start, page_end, delta > 0);
+        }
+    }
+
+    /// Resets every count to zero, calling func(u32 run_start, u32 run_end) for each run of pages
+    /// that had a non-zero count
+    template <typename Func>
+    void Clear(Func&& func) {
+        for (std::size_t chunk_index = 0; chunk_index < chunks.size(); ++chunk_index) {
+            auto& chunk = chunks[chunk_index];
+            if (!chunk) {
+                continue;
+            }
+            const u32 chunk_start = static_cast<u32>(chunk_index << CHUNK_BITS);
+            u32 run_start = 0;
+            bool in_run = false;
+            for (u32 i = 0; i < CHUNK_SIZE; ++i) {
+                const bool cached = (*chunk)[i] != 0;
+                if (cached && !in_run) {
+                    run_start = chunk_start + i;
+                    in_run = true;
+                } else if (!cached && in_run) {
+                    func(run_start, chunk_start + i);
+                    in_run = false;
+                }
+            }
+            if (in_run) {
+                func(run_start, chunk_start + CHUNK_SIZE);
+            }
+            chunk.reset();
+        }
+    }
+
+private:
+    static constexpr u32 CHUNK_BITS = 10;
+    static constexpr u32 CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr u32 NUM_CHUNKS = (1 << (32 - Memory::PAGE_BITS)) >> CHUNK_BITS;
+
+    u32& GetCount(u32 page);
+
+    std::array<std::unique_ptr<std::array<u32, CHUNK_SIZE>>, NUM_CHUNKS> chunks;
+};
+
+} // namespace OpenGL
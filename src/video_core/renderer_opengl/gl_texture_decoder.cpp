@@ -0,0 +1,550 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string_view>
+#include "common/alignment.h"
+#include "common/assert.h"
+#include "common/microprofile.h"
+#include "common/scope_exit.h"
+#include "video_core/renderer_opengl/gl_rasterizer_cache.h"
+#include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_texture_decoder.h"
+#include "video_core/renderer_opengl/gl_vars.h"
+
+namespace OpenGL {
+
+using PixelFormat = SurfaceParams::PixelFormat;
+using SurfaceType = SurfaceParams::SurfaceType;
+
+constexpr u32 WORKGROUP_SIZE = 64;
+
+// Each invocation produces one 32-bit word of the output. When decoding, output words belong to
+// the linear OpenGL layout and texture formats produce one RGBA8 texel per word. When encoding,
+// output words belong to the tiled layout. Everything else is a byte shuffle that mirrors
+// MortonCopyTile in gl_rasterizer_cache.cpp.
+constexpr std::string_view decoder_source = R"(
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) readonly buffer input_buffer {
+    uint input_words[];
+};
+
+layout(std430, binding = 1) writeonly buffer output_buffer {
+    uint output_words[];
+};
+
+uniform uint format;
+uniform bool encode;
+uniform uint width;
+uniform uint height;
+uniform uint tile_size;
+uniform uint bytes_per_pixel;
+uniform uint gl_bytes_per_pixel;
+uniform uint input_offset;
+uniform uint output_offset;
+uniform uint word_count;
+
+#define FORMAT_RGBA8 0u
+#define FORMAT_RGB8 1u
+#define FORMAT_IA8 5u
+#define FORMAT_RG8 6u
+#define FORMAT_I8 7u
+#define FORMAT_A8 8u
+#define FORMAT_IA4 9u
+#define FORMAT_I4 10u
+#define FORMAT_A4 11u
+#define FORMAT_ETC1 12u
+#define FORMAT_ETC1A4 13u
+#define FORMAT_D24S8 17u
+
+const int etc1_modifier_table[16] =
+    int[16](2, 8, 5, 17, 9, 29, 13, 42, 18, 60, 24, 80, 33, 106, 47, 183);
+
+uint ReadByte(uint offset) {
+    if (offset < input_offset) {
+        return 0u;
+    }
+    uint index = offset - input_offset;
+    if (index / 4u >= uint(input_words.length())) {
+        return 0u;
+    }
+    return (input_words[index / 4u] >> (index % 4u * 8u)) & 0xFFu;
+}
+
+uint ReadWord(uint offset) {
+    return ReadByte(offset) | (ReadByte(offset + 1u) << 8) | (ReadByte(offset + 2u) << 16) |
+           (ReadByte(offset + 3u) << 24);
+}
+
+uint MortonInterleave(uint x, uint y) {
+    return (x & 1u) | ((y & 1u) << 1) | ((x & 2u) << 1) | ((y & 2u) << 2) | ((x & 4u) << 2) |
+           ((y & 4u) << 3);
+}
+
+uvec2 MortonDeinterleave(uint index) {
+    return uvec2((index & 1u) | ((index >> 1) & 2u) | ((index >> 2) & 4u),
+                 ((index >> 1) & 1u) | ((index >> 2) & 2u) | ((index >> 3) & 4u));
+}
+
+uint Convert4To8(uint value) {
+    return (value << 4) | value;
+}
+
+uint Convert5To8(uint value) {
+    return ((value << 3) | (value >> 2)) & 0xFFu;
+}
+
+uint PackRGBA(uvec4 color) {
+    return color.r | (color.g << 8) | (color.b << 16) | (color.a << 24);
+}
+
+// Byte of the guest pixel that ends up in byte k of the OpenGL pixel, or -1 if there is none
+int GuestByte(uint k) {
+#ifdef CITRA_GLES
+    // GLES has no BGR(A) formats, so these are byteswapped here
+    if (format == FORMAT_RGBA8) {
+        return 3 - int(k);
+    }
+    if (format == FORMAT_RGB8) {
+        return 2 - int(k);
+    }
+#endif
+    if (format == FORMAT_D24S8) {
+        return k == 0u ? 3 : int(k) - 1;
+    }
+    return int(k) - int(gl_bytes_per_pixel - bytes_per_pixel);
+}
+
+// Byte of the OpenGL pixel that is stored in byte j of the guest pixel
+uint HostByte(uint j) {
+    if (format == FORMAT_D24S8) {
+        return j == 3u ? 0u : j + 1u;
+    }
+    return j + gl_bytes_per_pixel - bytes_per_pixel;
+}
+
+uvec3 DecodeETC1(uint lo, uint hi, uint x, uint y) {
+    uint texel = 4u * x + y;
+    bool flip = (hi & 1u) != 0u;
+    bool second_half = (flip ? y : x) >= 2u;
+
+    ivec3 base;
+    if ((hi & 2u) != 0u) {
+        // Differential mode
+        ivec3 color = ivec3((hi >> 27) & 0x1Fu, (hi >> 19) & 0x1Fu, (hi >> 11) & 0x1Fu);
+        if (second_half) {
+            // The deltas are sign extended 3-bit fields
+            color += (ivec3(uvec3(hi >> 24, hi >> 16, hi >> 8) & 7u) ^ 4) - 4;
+        }
+        base = ivec3(Convert5To8(uint(color.r) & 0xFFu), Convert5To8(uint(color.g) & 0xFFu),
+                     Convert5To8(uint(color.b) & 0xFFu));
+    } else {
+        uint shift = second_half ? 0u : 4u;
+        base = ivec3(Convert4To8((hi >> (24u + shift)) & 0xFu),
+                     Convert4To8((hi >> (16u + shift)) & 0xFu),
+                     Convert4To8((hi >> (8u + shift)) & 0xFu));
+    }
+
+    uint table_index = second_half ? (hi >> 2) & 7u : (hi >> 5) & 7u;
+    int modifier = etc1_modifier_table[table_index * 2u + ((lo >> texel) & 1u)];
+    if (((lo >> (16u + texel)) & 1u) != 0u) {
+        modifier = -modifier;
+    }
+    return uvec3(clamp(base + modifier, 0, 255));
+}
+
+uvec4 DecodeTexel(uint pixel) {
+    uint x = pixel % width;
+    uint y = height - 1u - pixel / width;
+    uint offset = ((y / 8u) * (width / 8u) + x / 8u) * tile_size;
+    x %= 8u;
+    y %= 8u;
+    uint morton = MortonInterleave(x, y);
+
+    switch (format) {
+    case FORMAT_IA8: {
+        uint i = ReadByte(offset + morton * 2u + 1u);
+        return uvec4(i, i, i, ReadByte(offset + morton * 2u));
+    }
+    case FORMAT_RG8: {
+        uint r = ReadByte(offset + morton * 2u + 1u);
+        return uvec4(r, ReadByte(offset + morton * 2u), 0u, 255u);
+    }
+    case FORMAT_I8: {
+        uint i = ReadByte(offset + morton);
+        return uvec4(i, i, i, 255u);
+    }
+    case FORMAT_A8:
+        return uvec4(0u, 0u, 0u, ReadByte(offset + morton));
+    case FORMAT_IA4: {
+        uint value = ReadByte(offset + morton);
+        uint i = Convert4To8(value >> 4);
+        return uvec4(i, i, i, Convert4To8(value & 0xFu));
+    }
+    case FORMAT_I4:
+    case FORMAT_A4: {
+        uint value = ReadByte(offset + morton / 2u);
+        value = Convert4To8((morton % 2u) != 0u ? value >> 4 : value & 0xFu);
+        return format == FORMAT_I4 ? uvec4(value, value, value, 255u) : uvec4(0u, 0u, 0u, value);
+    }
+    default: {
+        // ETC1 and ETC1A4 split each tile into four 4x4 subtiles
+        bool has_alpha = format == FORMAT_ETC1A4;
+        uint subtile = offset + (x / 4u + 2u * (y / 4u)) * (has_alpha ? 16u : 8u);
+        x %= 4u;
+        y %= 4u;
+
+        uint alpha = 255u;
+        if (has_alpha) {
+            uint nibble = x * 4u + y;
+            uint packed_alpha = ReadWord(subtile + nibble / 8u * 4u);
+            alpha = Convert4To8((packed_alpha >> (nibble % 8u * 4u)) & 0xFu);
+            subtile += 8u;
+        }
+        return uvec4(DecodeETC1(ReadWord(subtile), ReadWord(subtile + 4u), x, y), alpha);
+    }
+    }
+}
+
+uint DecodeWord(uint offset) {
+    uint word = 0u;
+    for (uint i = 0u; i < 4u; ++i) {
+        uint pixel = (offset + i) / gl_bytes_per_pixel;
+        int guest_byte = GuestByte((offset + i) % gl_bytes_per_pixel);
+        if (guest_byte < 0) {
+            continue;
+        }
+
+        uint x = pixel % width;
+        uint y = height - 1u - pixel / width;
+        uint tile = (y / 8u) * (width / 8u) + x / 8u;
+        uint source = tile * tile_size + MortonInterleave(x % 8u, y % 8u) * bytes_per_pixel +
+                      uint(guest_byte);
+        word |= ReadByte(source) << (i * 8u);
+    }
+    return word;
+}
+
+uint EncodeWord(uint offset) {
+    uint word = 0u;
+    for (uint i = 0u; i < 4u; ++i) {
+        uint tile = (offset + i) / tile_size;
+        uint tile_byte = (offset + i) % tile_size;
+        uvec2 fine = MortonDeinterleave(tile_byte / bytes_per_pixel);
+
+        uint x = tile % (width / 8u) * 8u + fine.x;
+        uint y = tile / (width / 8u) * 8u + fine.y;
+        if (y >= height) {
+            continue;
+        }
+        uint source = ((height - 1u - y) * width + x) * gl_bytes_per_pixel +
+                      HostByte(tile_byte % bytes_per_pixel);
+        word |= ReadByte(source) << (i * 8u);
+    }
+    return word;
+}
+
+void main() {
+    uint word = gl_GlobalInvocationID.x;
+    if (word >= word_count) {
+        return;
+    }
+
+    uint offset = output_offset + word * 4u;
+    uint value;
+    if (encode) {
+        value = EncodeWord(offset);
+    } else if (format >= FORMAT_IA8 && format <= FORMAT_ETC1A4) {
+        value = PackRGBA(DecodeTexel(offset / 4u));
+    } else {
+        value = DecodeWord(offset);
+    }
+    output_words[offset / 4u] = value;
+}
+)";
+
+// Each invocation packs one 32-bit word of a row of the rectangle, which holds two D16 pixels or
+// one D24/D24S8 pixel. D24S8 takes a second pass with the texture sampled as stencil, since a
+// texture can only be sampled as depth or as stencil at a time.
+constexpr std::string_view depth_packer_source = R"(
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(std430, binding = 1) buffer output_buffer {
+    uint output_words[];
+};
+
+uniform highp sampler2D depth_texture;
+uniform highp usampler2D stencil_texture;
+uniform uint format;
+uniform bool stencil_pass;
+uniform uint row_words;
+uniform uvec2 origin;
+uniform uvec2 size;
+uniform uint res_scale;
+
+#define FORMAT_D16 14u
+
+ivec2 TexelCoord(uint x, uint y) {
+    return ivec2(uvec2(x, y) * res_scale + res_scale / 2u);
+}
+
+uint ReadDepth(uint x, uint y, float max_value) {
+    return uint(round(texelFetch(depth_texture, TexelCoord(x, y), 0).r * max_value));
+}
+
+void main() {
+    uvec2 word = gl_GlobalInvocationID.xy;
+    if (word.x >= size.x || word.y >= size.y) {
+        return;
+    }
+
+    uint y = origin.y + word.y;
+    if (format == FORMAT_D16) {
+        uint x = origin.x + word.x * 2u;
+        output_words[y * row_words + x / 2u] =
+            ReadDepth(x, y, 65535.0) | (ReadDepth(x + 1u, y, 65535.0) << 16);
+        return;
+    }
+
+    uint x = origin.x + word.x;
+    uint index = y * row_words + x;
+    if (stencil_pass) {
+        output_words[index] |= texelFetch(stencil_texture, TexelCoord(x, y), 0).r & 0xFFu;
+    } else {
+        output_words[index] = ReadDepth(x, y, 16777215.0) << 8;
+    }
+}
+)";
+
+/// Grows a buffer object to hold at least size bytes, discarding its contents if it does
+static void ReserveBuffer(OGLBuffer& buffer, GLsizeiptr& buffer_size, GLsizeiptr size,
+                          GLenum usage) {
+    if (size <= buffer_size) {
+        return;
+    }
+    buffer_size = size;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.handle);
+    glBufferData(GL_COPY_WRITE_BUFFER, buffer_size, nullptr, usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+TextureDecoderOpenGL::TextureDecoderOpenGL() {
+    OGLShader shader;
+    shader.Create(decoder_source.data(), GL_COMPUTE_SHADER);
+    program.Create(false, {shader.handle});
+
+    format_loc = glGetUniformLocation(program.handle, "format");
+    encode_loc = glGetUniformLocation(program.handle, "encode");
+    width_loc = glGetUniformLocation(program.handle, "width");
+    height_loc = glGetUniformLocation(program.handle, "height");
+    tile_size_loc = glGetUniformLocation(program.handle, "tile_size");
+    bytes_per_pixel_loc = glGetUniformLocation(program.handle, "bytes_per_pixel");
+    gl_bytes_per_pixel_loc = glGetUniformLocation(program.handle, "gl_bytes_per_pixel");
+    input_offset_loc = glGetUniformLocation(program.handle, "input_offset");
+    output_offset_loc = glGetUniformLocation(program.handle, "output_offset");
+    word_count_loc = glGetUniformLocation(program.handle, "word_count");
+
+    OGLShader depth_shader;
+    depth_shader.Create(depth_packer_source.data(), GL_COMPUTE_SHADER);
+    depth_program.Create(false, {depth_shader.handle});
+
+    depth_format_loc = glGetUniformLocation(depth_program.handle, "format");
+    stencil_pass_loc = glGetUniformLocation(depth_program.handle, "stencil_pass");
+    row_words_loc = glGetUniformLocation(depth_program.handle, "row_words");
+    origin_loc = glGetUniformLocation(depth_program.handle, "origin");
+    size_loc = glGetUniformLocation(depth_program.handle, "size");
+    res_scale_loc = glGetUniformLocation(depth_program.handle, "res_scale");
+    glProgramUniform1i(depth_program.handle,
+                       glGetUniformLocation(depth_program.handle, "depth_texture"), 0);
+    glProgramUniform1i(depth_program.handle,
+                       glGetUniformLocation(depth_program.handle, "stencil_texture"), 1);
+
+    // Stencil sampling treats the texture as an integer one, which only nearest filtering allows
+    depth_sampler.Create();
+    glSamplerParameteri(depth_sampler.handle, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(depth_sampler.handle, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(depth_sampler.handle, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    guest_buffer.Create();
+    host_buffer.Create();
+}
+
+TextureDecoderOpenGL::~TextureDecoderOpenGL() = default;
+
+bool TextureDecoderOpenGL::IsSupported() {
+    if (GLES) {
+        return GLAD_GL_ES_VERSION_3_1;
+    }
+    return GLAD_GL_ARB_compute_shader && GLAD_GL_ARB_shader_storage_buffer_object &&
+           GLAD_GL_ARB_shader_image_load_store;
+}
+
+bool TextureDecoderOpenGL::IsFormatSupported(PixelFormat format) {
+    return SurfaceParams::GetFormatType(format) != SurfaceType::Invalid;
+}
+
+bool TextureDecoderOpenGL::CanPackDepth(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::D16:
+    case PixelFormat::D24:
+        return true;
+    case PixelFormat::D24S8:
+        return GLES ? GLAD_GL_ES_VERSION_3_1 : GLAD_GL_ARB_stencil_texturing;
+    default:
+        return false;
+    }
+}
+
+void TextureDecoderOpenGL::ReserveHostBuffer(std::size_t size) {
+    ReserveBuffer(host_buffer, host_buffer_size, static_cast<GLsizeiptr>(size), GL_STREAM_COPY);
+}
+
+MICROPROFILE_DEFINE(OpenGL_TextureDecode, "OpenGL", "GPU Texture Decode", MP_RGB(128, 192, 64));
+void TextureDecoderOpenGL::Decode(const SurfaceParams& surface, const u8* source,
+                                  PAddr load_start, PAddr load_end) {
+    MICROPROFILE_SCOPE(OpenGL_TextureDecode);
+    ASSERT(surface.is_tiled);
+
+    const u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(surface.pixel_format);
+    const u32 row_size = surface.stride * gl_bytes_per_pixel;
+    ReserveHostBuffer(row_size * surface.height);
+
+    const u32 load_size = load_end - load_start;
+    ReserveBuffer(guest_buffer, guest_buffer_size, load_size, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, guest_buffer.handle);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, load_size, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Only the rows covered by the range are written
+    const auto rect =
+        surface.GetSubRect(surface.FromInterval(SurfaceInterval(load_start, load_end)));
+    Dispatch(surface, false, guest_buffer.handle, load_start - surface.addr, load_size,
+             host_buffer.handle, rect.bottom * row_size, rect.GetHeight() * row_size);
+
+    glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT);
+}
+
+MICROPROFILE_DEFINE(OpenGL_TextureEncode, "OpenGL", "GPU Texture Encode", MP_RGB(128, 192, 64));
+void TextureDecoderOpenGL::Encode(const SurfaceParams& surface, u8* dest, PAddr flush_start,
+                                  PAddr flush_end) {
+    MICROPROFILE_SCOPE(OpenGL_TextureEncode);
+    ASSERT(surface.is_tiled && surface.type != SurfaceType::Texture);
+
+    const u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(surface.pixel_format);
+    const u32 tile_size = surface.GetFormatBpp() * 8;
+    const u32 start_offset = flush_start - surface.addr;
+    const u32 end_offset = flush_end - surface.addr;
+    const u32 aligned_start = Common::AlignDown(start_offset, tile_size);
+    const u32 aligned_end = Common::AlignUp(end_offset, tile_size);
+
+    ReserveBuffer(guest_buffer, guest_buffer_size, aligned_end, GL_STREAM_READ);
+    Dispatch(surface, true, host_buffer.handle, 0,
+             surface.stride * surface.height * gl_bytes_per_pixel, guest_buffer.handle,
+             aligned_start, aligned_end - aligned_start);
+
+    // Mapping waits for the shader to finish
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_COPY_READ_BUFFER, guest_buffer.handle);
+    const void* data = glMapBufferRange(GL_COPY_READ_BUFFER, start_offset,
+                                        end_offset - start_offset, GL_MAP_READ_BIT);
+    if (data != nullptr) {
+        std::memcpy(dest + start_offset, data, end_offset - start_offset);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    } else {
+        LOG_ERROR(Render_OpenGL, "Failed to map the texture encode buffer");
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+MICROPROFILE_DEFINE(OpenGL_DepthPack, "OpenGL", "GPU Depth Pack", MP_RGB(128, 192, 64));
+void TextureDecoderOpenGL::PackDepth(const SurfaceParams& surface, GLuint texture,
+                                     const Common::Rectangle<u32>& rect, GLuint buffer) {
+    MICROPROFILE_SCOPE(OpenGL_DepthPack);
+    ASSERT(CanPackDepth(surface.pixel_format));
+
+    const bool is_d16 = surface.pixel_format == PixelFormat::D16;
+    ASSERT(!is_d16 || (rect.left % 2 == 0 && rect.GetWidth() % 2 == 0));
+
+    OpenGLState prev_state = OpenGLState::GetCurState();
+    SCOPE_EXIT({ prev_state.Apply(); });
+
+    OpenGLState state = prev_state;
+    state.draw.shader_program = depth_program.handle;
+    state.texture_units[0].texture_2d = texture;
+    state.texture_units[0].sampler = depth_sampler.handle;
+    state.texture_units[1].texture_2d = 0;
+    state.texture_units[1].sampler = depth_sampler.handle;
+    state.Apply();
+
+    const u32 gl_bytes_per_pixel = CachedSurface::GetGLBytesPerPixel(surface.pixel_format);
+    const u32 width_words = rect.GetWidth() * gl_bytes_per_pixel / 4;
+    glUniform1ui(depth_format_loc, static_cast<GLuint>(surface.pixel_format));
+    glUniform1i(stencil_pass_loc, GL_FALSE);
+    glUniform1ui(row_words_loc, surface.stride * gl_bytes_per_pixel / 4);
+    glUniform2ui(origin_loc, rect.left, rect.bottom);
+    glUniform2ui(size_loc, width_words, rect.GetHeight());
+    glUniform1ui(res_scale_loc, surface.res_scale);
+
+    const GLuint groups_x = (width_words + 7) / 8;
+    const GLuint groups_y = (rect.GetHeight() + 7) / 8;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffer);
+    glDispatchCompute(groups_x, groups_y, 1);
+
+    if (surface.pixel_format == PixelFormat::D24S8) {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        state.texture_units[0].texture_2d = 0;
+        state.texture_units[1].texture_2d = texture;
+        state.Apply();
+
+        glActiveTexture(GL_TEXTURE1);
+        glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_STENCIL_INDEX);
+        glUniform1i(stencil_pass_loc, GL_TRUE);
+        glDispatchCompute(groups_x, groups_y, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+
+    // The buffer is read next by the encoder, or through a mapping once a fence is signaled
+    GLbitfield barriers = GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT;
+    if (GLAD_GL_ARB_buffer_storage) {
+        barriers |= GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT;
+    }
+    glMemoryBarrier(barriers);
+}
+
+void TextureDecoderOpenGL::Dispatch(const SurfaceParams& surface, bool encode,
+                                    GLuint input_buffer, u32 input_offset, u32 input_size,
+                                    GLuint output_buffer, u32 output_offset, u32 output_size) {
+    OpenGLState prev_state = OpenGLState::GetCurState();
+    SCOPE_EXIT({ prev_state.Apply(); });
+
+    OpenGLState state = prev_state;
+    state.draw.shader_program = program.handle;
+    state.Apply();
+
+    const u32 bits_per_pixel = surface.GetFormatBpp();
+    glUniform1ui(format_loc, static_cast<GLuint>(surface.pixel_format));
+    glUniform1i(encode_loc, encode ? GL_TRUE : GL_FALSE);
+    glUniform1ui(width_loc, surface.stride);
+    glUniform1ui(height_loc, surface.height);
+    glUniform1ui(tile_size_loc, bits_per_pixel * 8);
+    glUniform1ui(bytes_per_pixel_loc, bits_per_pixel / 8);
+    glUniform1ui(gl_bytes_per_pixel_loc, CachedSurface::GetGLBytesPerPixel(surface.pixel_format));
+    glUniform1ui(input_offset_loc, input_offset);
+    glUniform1ui(output_offset_loc, output_offset);
+
+    const u32 word_count = output_size / 4;
+    glUniform1ui(word_count_loc, word_count);
+
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, input_buffer, 0, input_size);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, output_buffer);
+    glDispatchCompute((word_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+}
+
+} // namespace OpenGL
@@ -0,0 +1,107 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "common/math_util.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+#include "video_core/renderer_opengl/gl_surface_params.h"
+
+namespace OpenGL {
+
+/**
+ * Converts surface data between the Morton tiled layout of PICA memory and the linear layout
+ * OpenGL expects, using a compute shader instead of the CPU. The linear side lives in the host
+ * buffer, a buffer object with the same layout as CachedSurface::gl_buffer that can be bound as a
+ * pixel unpack or pack buffer. Texture formats are decoded to RGBA8 in the process, ETC1 included.
+ */
+class TextureDecoderOpenGL : NonCopyable {
+public:
+    TextureDecoderOpenGL();
+    ~TextureDecoderOpenGL();
+
+    /// Returns true if the driver supports the compute shaders the decoder relies on
+    static bool IsSupported();
+
+    /// Returns true if tiled surfaces of the given format can be converted on the GPU
+    static bool IsFormatSupported(SurfaceParams::PixelFormat format);
+
+    /// Grows the host buffer to hold at least size bytes. Growing discards its contents.
+    void ReserveHostBuffer(std::size_t size);
+
+    /// Returns the handle of the host buffer
+    GLuint GetHostBuffer() const {
+        return host_buffer.handle;
+    }
+
+    /**
+     * Decodes a tile aligned range of a surface's memory into the host buffer, reserving a buffer
+     * big enough for the whole surface.
+     * @param surface Surface the memory belongs to
+     * @param source Pointer to the memory at load_start
+     * @param load_start,load_end Range of the surface to decode
+     */
+    void Decode(const SurfaceParams& surface, const u8* source, PAddr load_start, PAddr load_end);
+
+    /**
+     * Encodes the host buffer contents back into the tiled layout and writes the given range to
+     * memory. The range does not have to be tile aligned.
+     * @param surface Surface the host buffer contents belong to
+     * @param dest Pointer to the memory at surface.addr
+     * @param flush_start,flush_end Range of the surface to write
+     */
+    void Encode(const SurfaceParams& surface, u8* dest, PAddr flush_start, PAddr flush_end);
+
+    /// Returns true if depth surfaces of the given format can be read back with PackDepth
+    static bool CanPackDepth(SurfaceParams::PixelFormat format);
+
+    /**
+     * Packs the depth, and stencil for D24S8, of a rectangle of a depth texture into a buffer in
+     * the layout glReadPixels would give CachedSurface::gl_buffer, so reading back depth needs no
+     * conversion by the driver. Scaled textures are sampled in the middle of each unscaled pixel,
+     * like the nearest filtered blit used for other downloads.
+     * @param surface Surface the texture belongs to
+     * @param texture Texture to read, at the surface's resolution scale
+     * @param rect Unscaled rectangle of the surface to pack
+     * @param buffer Buffer to pack into, at least as large as the surface's gl_buffer
+     */
+    void PackDepth(const SurfaceParams& surface, GLuint texture,
+                   const Common::Rectangle<u32>& rect, GLuint buffer);
+
+private:
+    /// Runs the conversion shader, reading from input_buffer and writing to output_buffer
+    void Dispatch(const SurfaceParams& surface, bool encode, GLuint input_buffer, u32 input_offset,
+                  u32 input_size, GLuint output_buffer, u32 output_offset, u32 output_size);
+
+    OGLProgram program;
+    GLint format_loc = -1;
+    GLint encode_loc = -1;
+    GLint width_loc = -1;
+    GLint height_loc = -1;
+    GLint tile_size_loc = -1;
+    GLint bytes_per_pixel_loc = -1;
+    GLint gl_bytes_per_pixel_loc = -1;
+    GLint input_offset_loc = -1;
+    GLint output_offset_loc = -1;
+    GLint word_count_loc = -1;
+
+    OGLProgram depth_program;
+    OGLSampler depth_sampler;
+    GLint depth_format_loc = -1;
+    GLint stencil_pass_loc = -1;
+    GLint row_words_loc = -1;
+    GLint origin_loc = -1;
+    GLint size_loc = -1;
+    GLint res_scale_loc = -1;
+
+    OGLBuffer guest_buffer;
+    GLsizeiptr guest_buffer_size = 0;
+    OGLBuffer host_buffer;
+    GLsizeiptr host_buffer_size = 0;
+};
+
+} // namespace OpenGL
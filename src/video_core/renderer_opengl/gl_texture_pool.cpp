@@ -0,0 +1,109 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <boost/functional/hash.hpp>
+#include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_texture_pool.h"
+
+namespace OpenGL {
+
+/// Released textures are deleted when they haven't been reused for this many frames
+constexpr int MAX_UNUSED_FRAMES = 60;
+/// Released textures beyond this many are deleted right away
+constexpr std::size_t MAX_FREE_TEXTURES = 256;
+
+bool TexturePool::Key::operator==(const Key& rhs) const {
+    return std::tie(internal_format, format, type, width, height, levels) ==
+           std::tie(rhs.internal_format, rhs.format, rhs.type, rhs.width, rhs.height, rhs.levels);
+}
+
+std::size_t TexturePool::KeyHash::operator()(const Key& key) const {
+    std::size_t hash = 0;
+    boost::hash_combine(hash, key.internal_format);
+    boost::hash_combine(hash, key.format);
+    boost::hash_combine(hash, key.type);
+    boost::hash_combine(hash, key.width);
+    boost::hash_combine(hash, key.height);
+    boost::hash_combine(hash, key.levels);
+    return hash;
+}
+
+OGLTexture TexturePool::Acquire(GLint internal_format, GLenum format, GLenum type, u32 width,
+                                u32 height, u32 levels) {
+    OpenGLState cur_state = OpenGLState::GetCurState();
+
+    // Keep track of previous texture bindings
+    GLuint old_tex = cur_state.texture_units[0].texture_2d;
+
+    OGLTexture texture;
+    const auto it = free_textures.find({internal_format, format, type, width, height, levels});
+    if (it != free_textures.end() && !it->second.empty()) {
+        texture = std::move(it->second.back().texture);
+        it->second.pop_back();
+        --num_free_textures;
+
+        cur_state.texture_units[0].texture_2d = texture.handle;
+        cur_state.Apply();
+        glActiveTexture(GL_TEXTURE0);
+    } else {
+        texture.Create();
+
+        cur_state.texture_units[0].texture_2d = texture.handle;
+        cur_state.Apply();
+        glActiveTexture(GL_TEXTURE0);
+
+        // Not immutable storage, custom textures and mipmaps respecify levels later
+        for (u32 level = 0; level < levels; ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, internal_format, std::max(width >> level, 1U),
+                         std::max(height >> level, 1U), 0, format, type, nullptr);
+        }
+    }
+
+    // The previous user may have changed these
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Restore previous texture bindings
+    cur_state.texture_units[0].texture_2d = old_tex;
+    cur_state.Apply();
+
+    return texture;
+}
+
+void TexturePool::Release(OGLTexture&& texture, GLint internal_format, GLenum format, GLenum type,
+                          u32 width, u32 height, u32 levels) {
+    if (texture.handle == 0 || num_free_textures >= MAX_FREE_TEXTURES) {
+        texture.Release();
+        return;
+    }
+    free_textures[{internal_format, format, type, width, height, levels}].push_back(
+        {std::move(texture), last_trim_frame});
+    ++num_free_textures;
+}
+
+void TexturePool::Trim(int current_frame) {
+    if (current_frame == last_trim_frame) {
+        return;
+    }
+    last_trim_frame = current_frame;
+
+    for (auto it = free_textures.begin(); it != free_textures.end();) {
+        auto& entries = it->second;
+        // Entries are released in order, so the oldest ones are at the front
+        const auto first_kept =
+            std::find_if(entries.begin(), entries.end(), [current_frame](const Entry& entry) {
+                return current_frame - entry.release_frame <= MAX_UNUSED_FRAMES;
+            });
+        num_free_textures -= std::distance(entries.begin(), first_kept);
+        entries.erase(entries.begin(), first_kept);
+        it = entries.empty() ? free_textures.erase(it) : std::next(it);
+    }
+}
+
+} // namespace OpenGL
@@ -0,0 +1,62 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+namespace OpenGL {
+
+/**
+ * Recycles the 2D textures backing cached surfaces and temporary blit targets. Released textures
+ * are kept around for a few frames and handed out again to requests with the same format, size
+ * and level count, which avoids allocation stalls in games that recreate render targets often.
+ */
+class TexturePool : NonCopyable {
+public:
+    /// Returns an uninitialized texture, reusing a released one with the same properties if any
+    OGLTexture Acquire(GLint internal_format, GLenum format, GLenum type, u32 width, u32 height,
+                       u32 levels = 1);
+
+    /// Hands back a texture obtained from Acquire with the same properties for reuse
+    void Release(OGLTexture&& texture, GLint internal_format, GLenum format, GLenum type,
+                 u32 width, u32 height, u32 levels = 1);
+
+    /// Deletes the textures that have not been reused for a while, once per frame
+    void Trim(int current_frame);
+
+private:
+    struct Key {
+        GLint internal_format;
+        GLenum format;
+        GLenum type;
+        u32 width;
+        u32 height;
+        u32 levels;
+
+        bool operator==(const Key& rhs) const;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        OGLTexture texture;
+        int release_frame;
+    };
+
+    std::unordered_map<Key, std::vector<Entry>, KeyHash> free_textures;
+    std::size_t num_free_textures = 0;
+    /// Frame of the last call to Trim, released textures are stamped with it
+    int last_trim_frame = -1;
+};
+
+} // namespace OpenGL
@@ -0,0 +1,180 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include "common/hash.h"
+#include "core/memory.h"
+#include "video_core/renderer_base.h"
+#include "video_core/renderer_opengl/gl_rasterizer_cache.h"
+#include "video_core/renderer_opengl/gl_vertex_buffer_cache.h"
+#include "video_core/video_core.h"
+
+namespace OpenGL {
+
+/// Smaller regions are cheaper to stream than to bind a buffer for
+constexpr u32 MIN_ENTRY_SIZE = 512;
+/// Total size of the copies kept around
+constexpr std::size_t MAX_TOTAL_SIZE = 64 * 1024 * 1024;
+/// Regions found changed this many times are not considered anymore
+constexpr u32 MAX_MISSES = 4;
+/// The candidates are forgotten when there are more than this many
+constexpr std::size_t MAX_CANDIDATES = 4096;
+
+std::size_t VertexBufferCache::KeyHash::operator()(const Key& key) const {
+    std::size_t hash = 0;
+    boost::hash_combine(hash, key.addr);
+    boost::hash_combine(hash, key.size);
+    return hash;
+}
+
+VertexBufferCache::VertexBufferCache(RasterizerCacheOpenGL& res_cache) : res_cache(res_cache) {}
+
+VertexBufferCache::~VertexBufferCache() {
+    Clear();
+}
+
+VertexBufferCache::Entry* VertexBufferCache::Get(PAddr addr, u32 size) {
+    const Key key{addr, size};
+    const int current_frame = VideoCore::g_renderer->GetCurrentFrame();
+    if (const auto it = entries.find(key); it != entries.end()) {
+        it->second->last_used_frame = current_frame;
+        return it->second.get();
+    }
+
+    if (size < MIN_ENTRY_SIZE || size > MAX_TOTAL_SIZE / 4) {
+        return nullptr;
+    }
+    const u8* data = VideoCore::g_memory->GetPhysicalPointer(addr);
+    if (data == nullptr) {
+        return nullptr;
+    }
+
+    if (candidates.size() >= MAX_CANDIDATES && candidates.count(key) == 0) {
+        candidates.clear();
+    }
+    Candidate& candidate = candidates[key];
+    if (candidate.misses >= MAX_MISSES) {
+        return nullptr;
+    }
+    const u64 hash = Common::ComputeHash64(data, size);
+    if (!candidate.seen || candidate.hash != hash) {
+        if (candidate.seen) {
+            ++candidate.misses;
+        }
+        candidate.seen = true;
+        candidate.hash = hash;
+        return nullptr;
+    }
+
+    if (!Evict(size)) {
+        return nullptr;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->addr = addr;
+    entry->size = size;
+    entry->last_used_frame = current_frame;
+    entry->buffer.Create();
+    // The copy binding point leaves the vertex array state alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, entry->buffer.handle);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    res_cache.MarkRegionCached(addr, size, true);
+    const u32 page_end = ((addr + size - 1) >> Memory::PAGE_BITS) + 1;
+    for (u32 page = addr >> Memory::PAGE_BITS; page < page_end; ++page) {
+        page_entries[page].push_back(entry.get());
+    }
+    total_size += size;
+
+    return entries.emplace(key, std::move(entry)).first->second.get();
+}
+
+VertexBufferCache::Entry* VertexBufferCache::Find(PAddr addr, u32 size) {
+    const auto it = entries.find({addr, size});
+    return it != entries.end() ? it->second.get() : nullptr;
+}
+
+void VertexBufferCache::InvalidateRegion(PAddr addr, u32 size) {
+    if (entries.empty() || size == 0) {
+        return;
+    }
+
+    std::vector<Entry*> invalid_entries;
+    const PAddr end = addr + size;
+    const u32 page_end = ((end - 1) >> Memory::PAGE_BITS) + 1;
+    for (u32 page = addr >> Memory::PAGE_BITS; page < page_end; ++page) {
+        const auto it = page_entries.find(page);
+        if (it == page_entries.end()) {
+            continue;
+        }
+        for (Entry* entry : it->second) {
+            if (entry->addr < end && entry->addr + entry->size > addr &&
+                std::find(invalid_entries.begin(), invalid_entries.end(), entry) ==
+                    invalid_entries.end()) {
+                invalid_entries.push_back(entry);
+            }
+        }
+    }
+
+    for (Entry* entry : invalid_entries) {
+        // Copying the region again needs it to stay unchanged for two more draws
+        Candidate& candidate = candidates[{entry->addr, entry->size}];
+        candidate.seen = false;
+        ++candidate.misses;
+        Remove(entry);
+    }
+}
+
+void VertexBufferCache::Clear() {
+    for (const auto& [key, entry] : entries) {
+        res_cache.MarkRegionCached(entry->addr, entry->size, false);
+    }
+    entries.clear();
+    candidates.clear();
+    page_entries.clear();
+    total_size = 0;
+}
+
+void VertexBufferCache::Remove(Entry* entry) {
+    res_cache.MarkRegionCached(entry->addr, entry->size, false);
+    const u32 page_end = ((entry->addr + entry->size - 1) >> Memory::PAGE_BITS) + 1;
+    for (u32 page = entry->addr >> Memory::PAGE_BITS; page < page_end; ++page) {
+        auto& page_list = page_entries[page];
+        page_list.erase(std::find(page_list.begin(), page_list.end(), entry));
+        if (page_list.empty()) {
+            page_entries.erase(page);
+        }
+    }
+    total_size -= entry->size;
+    entries.erase({entry->addr, entry->size});
+}
+
+bool VertexBufferCache::Evict(std::size_t size) {
+    if (total_size + size <= MAX_TOTAL_SIZE) {
+        return true;
+    }
+
+    // Copies used by the current frame may still be needed by the draw being set up
+    const int current_frame = VideoCore::g_renderer->GetCurrentFrame();
+    std::vector<Entry*> lru_entries;
+    for (const auto& [key, entry] : entries) {
+        if (entry->last_used_frame != current_frame) {
+            lru_entries.push_back(entry.get());
+        }
+    }
+    std::sort(lru_entries.begin(), lru_entries.end(), [](const Entry* lhs, const Entry* rhs) {
+        return lhs->last_used_frame < rhs->last_used_frame;
+    });
+    for (Entry* entry : lru_entries) {
+        if (total_size + size <= MAX_TOTAL_SIZE) {
+            break;
+        }
+        Remove(entry);
+    }
+    return total_size + size <= MAX_TOTAL_SIZE;
+}
+
+} // namespace OpenGL
@@ -0,0 +1,94 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "common/common_funcs.h"
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+namespace OpenGL {
+
+class RasterizerCacheOpenGL;
+
+/**
+ * Keeps copies of the vertex and index data read by hardware shader draws in static buffers, so
+ * that geometry which stays the same in memory is uploaded once. A region is copied once it has
+ * been drawn twice with the same contents. Its pages are then marked as cached, and guest writes
+ * to them drop the copy through InvalidateRegion.
+ */
+class VertexBufferCache : NonCopyable {
+public:
+    struct Entry {
+        OGLBuffer buffer;
+        PAddr addr = 0;
+        u32 size = 0;
+        int last_used_frame = 0;
+
+        /// Range of the indices in the buffer, filled in the first time it is used as indices
+        bool has_index_range = false;
+        u32 min_index = 0;
+        u32 max_index = 0;
+    };
+
+    explicit VertexBufferCache(RasterizerCacheOpenGL& res_cache);
+    ~VertexBufferCache();
+
+    /**
+     * Returns the copy of the region, creating it if the region was drawn with the same contents
+     * before. Returns nullptr if the data has to be streamed. Memory must be up to date with the
+     * surfaces overlapping the region.
+     */
+    Entry* Get(PAddr addr, u32 size);
+
+    /// Returns the existing copy of the region, nullptr if there is none
+    Entry* Find(PAddr addr, u32 size);
+
+    /// Drops the copies overlapping the region
+    void InvalidateRegion(PAddr addr, u32 size);
+
+    /// Drops every copy
+    void Clear();
+
+private:
+    struct Key {
+        PAddr addr;
+        u32 size;
+
+        bool operator==(const Key& rhs) const {
+            return addr == rhs.addr && size == rhs.size;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    /// A region that has been drawn but not copied yet
+    struct Candidate {
+        u64 hash = 0;
+        bool seen = false;
+        /// Number of times the contents were found changed, regions changing often are streamed
+        u32 misses = 0;
+    };
+
+    void Remove(Entry* entry);
+
+    /// Drops the least recently used copies until size more bytes fit in the budget, returns
+    /// whether they do
+    bool Evict(std::size_t size);
+
+    RasterizerCacheOpenGL& res_cache;
+    std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> entries;
+    std::unordered_map<Key, Candidate, KeyHash> candidates;
+    /// Entries overlapping each page of the physical address space
+    std::unordered_map<u32, std::vector<Entry*>> page_entries;
+    std::size_t total_size = 0;
+};
+
+} // namespace OpenGL
@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <cstdlib>
 #include <deque>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <glad/glad.h>
@@ -136,6 +137,15 @@ public:
         present_cv.notify_one();
     }
 
+    /// Returns whether the GPU has finished drawing the frame
+    static bool IsRenderDone(const Frontend::Frame* frame) {
+        if (!frame->render_fence) {
+            return false;
+        }
+        const GLenum status = glClientWaitSync(frame->render_fence, 0, 0);
+        return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+    }
+
     // This is virtual as it is to be overriden in OGLVideoDumpingMailbox below.
     virtual void LoadPresentFrame() {
         // free the previous frame and add it back to the free queue
@@ -144,14 +154,19 @@ public:
             free_cv.notify_one();
         }
 
-        // the newest entries are pushed to the front of the queue
-        Frontend::Frame* frame = present_queue.front();
-        present_queue.pop_front();
-        // remove all old entries from the present queue and move them back to the free_queue
-        for (auto f : present_queue) {
-            free_queue.push(f);
+        // the newest entries are pushed to the front of the queue. Present the newest one the GPU
+        // has finished drawing, so that a frame still being drawn doesn't delay the presentation
+        // when a complete one is available. Newer frames stay queued for the next presentation.
+        auto it = std::find_if(present_queue.begin(), present_queue.end(), IsRenderDone);
+        if (it == present_queue.end()) {
+            it = present_queue.begin();
         }
-        present_queue.clear();
+        Frontend::Frame* frame = *it;
+        // remove all older entries from the present queue and move them back to the free_queue
+        for (auto f = std::next(it); f != present_queue.end(); ++f) {
+            free_queue.push(*f);
+        }
+        present_queue.erase(it, present_queue.end());
         previous_frame = frame;
     }
 
@@ -356,6 +371,17 @@ static std::array<GLfloat, 3 * 2> MakeOrthographicMatrix(const float width, cons
     return matrix;
 }
 
+/// Returns the address of the image the LCD displays for the given eye
+static PAddr GetFramebufferAddress(const GPU::Regs::FramebufferConfig& framebuffer,
+                                   bool right_eye) {
+    if (framebuffer.address_right1 == 0 || framebuffer.address_right2 == 0)
+        right_eye = false;
+
+    return framebuffer.active_fb == 0
+               ? (!right_eye ? framebuffer.address_left1 : framebuffer.address_right1)
+               : (!right_eye ? framebuffer.address_left2 : framebuffer.address_right2);
+}
+
 RendererOpenGL::RendererOpenGL(Frontend::EmuWindow& window)
     : RendererBase{window}, frame_dumper(Core::System::GetInstance().VideoDumper(), window) {
 
@@ -365,6 +391,10 @@ RendererOpenGL::RendererOpenGL(Frontend::EmuWindow& window)
 
 RendererOpenGL::~RendererOpenGL() = default;
 
+/// When fast forwarding, the screens are drawn for the window at most at this interval, which is
+/// about as often as a display can show them
+constexpr auto FastForwardWindowFrameInterval = std::chrono::microseconds(16667);
+
 MICROPROFILE_DEFINE(OpenGL_RenderFrame, "OpenGL", "Render Frame", MP_RGB(128, 128, 64));
 MICROPROFILE_DEFINE(OpenGL_WaitPresent, "OpenGL", "Wait For Present", MP_RGB(128, 128, 128));
 
@@ -374,36 +404,60 @@ void RendererOpenGL::SwapBuffers() {
     OpenGLState prev_state = OpenGLState::GetCurState();
     state.Apply();
 
-    PrepareRendertarget();
-
-    RenderScreenshot();
-
-    const auto& layout = render_window.GetFramebufferLayout();
-    RenderToMailbox(layout, render_window.mailbox, false);
+    {
+        Core::ScopedPerfSubsystem present_time{Core::PerfSubsystem::Present};
+        PrepareRendertarget();
+
+        RenderScreenshot();
+
+        // When fast forwarding, the guest can produce frames much faster than the display shows
+        // them. Drawing and waiting on every one of them would tie the speed to the presentation,
+        // so the frames in between are only emulated (still dumped and captured in screenshots).
+        const auto now = Core::PerfStats::Clock::now();
+        if (frame_shown && (!Core::System::GetInstance().frame_limiter.IsFastForwarding() ||
+                            now - last_window_frame >= FastForwardWindowFrameInterval)) {
+            const auto& layout = render_window.GetFramebufferLayout();
+            RenderToMailbox(layout, render_window.mailbox, false);
+            last_window_frame = now;
+        }
 
-    if (frame_dumper.IsDumping()) {
-        try {
-            RenderToMailbox(frame_dumper.GetLayout(), frame_dumper.mailbox, true);
-        } catch (const OGLTextureMailboxException& exception) {
-            LOG_DEBUG(Render_OpenGL, "Frame dumper exception caught: {}", exception.what());
+        if (frame_shown && frame_dumper.IsDumping()) {
+            try {
+                RenderToMailbox(frame_dumper.GetLayout(), frame_dumper.mailbox, true);
+            } catch (const OGLTextureMailboxException& exception) {
+                LOG_DEBUG(Render_OpenGL, "Frame dumper exception caught: {}", exception.what());
+            }
         }
     }
 
     m_current_frame++;
 
+    {
+        std::lock_guard lock{present_stats_mutex};
+        Core::System::GetInstance().perf_stats->AddPresentedFrames(
+            presented_frames, present_latency, max_present_interval);
+        presented_frames = 0;
+        present_latency = {};
+        max_present_interval = {};
+    }
     Core::System::GetInstance().perf_stats->EndSystemFrame();
 
     render_window.PollEvents();
 
-    Core::System::GetInstance().frame_limiter.DoFrameLimiting(
-        Core::System::GetInstance().CoreTiming().GetGlobalTimeUs());
+    // The hidden frames are run ahead of the shown ones, between which the time is limited
+    if (frame_shown) {
+        Core::System::GetInstance().frame_limiter.DoFrameLimiting(
+            Core::System::GetInstance().CoreTiming().GetGlobalTimeUs());
+    }
     Core::System::GetInstance().perf_stats->BeginSystemFrame();
+    frame_begin = Core::PerfStats::Clock::now();
 
     prev_state.Apply();
     RefreshRasterizerSetting();
 
-    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
-        Pica::g_debug_context->recorder->FrameFinished();
+    Pica::DebugContext* const debug_context = Pica::GetAttachedDebugContext();
+    if (debug_context && debug_context->recorder) {
+        debug_context->recorder->FrameFinished();
     }
 }
 
@@ -446,6 +500,18 @@ void RendererOpenGL::PrepareRendertarget() {
         int fb_id = i == 2 ? 1 : 0;
         const auto& framebuffer = GPU::g_regs.framebuffer_config[fb_id];
 
+        // The right eye is only displayed in 3D, and applications rendering a single image point
+        // both eyes to it. The left eye is then displayed again instead of loading it twice.
+        if (i == 1 && (Settings::values.render_3d == Settings::StereoRenderOption::Off ||
+                       GetFramebufferAddress(framebuffer, true) ==
+                           GetFramebufferAddress(framebuffer, false))) {
+            screen_infos[1].display_texture = screen_infos[0].display_texture;
+            screen_infos[1].display_texcoords = screen_infos[0].display_texcoords;
+            screen_infos[1].texture.width = screen_infos[0].texture.width;
+            screen_infos[1].texture.height = screen_infos[0].texture.height;
+            continue;
+        }
+
         // Main LCD (0): 0x1ED02204, Sub LCD (1): 0x1ED02A04
         u32 lcd_color_addr =
             (fb_id == 0) ? LCD_REG_INDEX(color_fill_top) : LCD_REG_INDEX(color_fill_bottom);
@@ -522,6 +588,7 @@ void RendererOpenGL::RenderToMailbox(const Layout::FramebufferLayout& layout,
         state.draw.draw_framebuffer = frame->render.handle;
         state.Apply();
         DrawScreens(layout, flipped);
+        frame->frame_begin = frame_begin;
         // Create a fence for the frontend to wait on and swap this frame to OffTex
         frame->render_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
         glFlush();
@@ -535,13 +602,7 @@ void RendererOpenGL::RenderToMailbox(const Layout::FramebufferLayout& layout,
 void RendererOpenGL::LoadFBToScreenInfo(const GPU::Regs::FramebufferConfig& framebuffer,
                                         ScreenInfo& screen_info, bool right_eye) {
 
-    if (framebuffer.address_right1 == 0 || framebuffer.address_right2 == 0)
-        right_eye = false;
-
-    const PAddr framebuffer_addr =
-        framebuffer.active_fb == 0
-            ? (!right_eye ? framebuffer.address_left1 : framebuffer.address_right1)
-            : (!right_eye ? framebuffer.address_left2 : framebuffer.address_right2);
+    const PAddr framebuffer_addr = GetFramebufferAddress(framebuffer, right_eye);
 
     LOG_TRACE(Render_OpenGL, "0x{:08x} bytes from 0x{:08x}({}x{}), fmt {:x}",
               framebuffer.stride * framebuffer.height, framebuffer_addr, framebuffer.width.Value(),
@@ -1098,6 +1159,20 @@ void RendererOpenGL::TryPresent(int timeout_ms) {
     glFlush();
 
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // Frames presented again after a timeout don't count, the time is when the presentation is
+    // submitted as the swap itself is up to the frontend
+    if (frame->frame_begin != last_presented_frame_begin) {
+        const auto now = Core::PerfStats::Clock::now();
+        std::lock_guard lock{present_stats_mutex};
+        ++presented_frames;
+        present_latency += now - frame->frame_begin;
+        if (last_present_time != Core::PerfStats::Clock::time_point{}) {
+            max_present_interval = std::max(max_present_interval, now - last_present_time);
+        }
+        last_present_time = now;
+        last_presented_frame_begin = frame->frame_begin;
+    }
 }
 
 /// Updates the framerate
@@ -5,10 +5,12 @@
 #pragma once
 
 #include <array>
+#include <mutex>
 #include <glad/glad.h>
 #include "common/common_types.h"
 #include "common/math_util.h"
 #include "core/hw/gpu.h"
+#include "core/perf_stats.h"
 #include "video_core/renderer_base.h"
 #include "video_core/renderer_opengl/frame_dumper_opengl.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
@@ -29,6 +31,8 @@ struct Frame {
     OpenGL::OGLFramebuffer present{}; /// FBO created on the present thread
     GLsync render_fence{};            /// Fence created on the render thread
     GLsync present_fence{};           /// Fence created on the presentation thread
+    /// Start of the emulated frame, to measure the presentation latency
+    Core::PerfStats::Clock::time_point frame_begin{};
 };
 } // namespace Frontend
 
@@ -134,6 +138,22 @@ private:
     GLuint attrib_tex_coord;
 
     FrameDumperOpenGL frame_dumper;
+
+    /// Start of the emulated frame being rendered
+    Core::PerfStats::Clock::time_point frame_begin = Core::PerfStats::Clock::now();
+
+    /// When the screens were last drawn for the window, used to skip frames when fast forwarding
+    Core::PerfStats::Clock::time_point last_window_frame{};
+
+    /// Presentation statistics, gathered by the presentation thread and handed to the perf stats
+    /// by the render thread
+    std::mutex present_stats_mutex;
+    u32 presented_frames = 0;
+    Core::PerfStats::Clock::duration present_latency{};
+    Core::PerfStats::Clock::duration max_present_interval{};
+    /// Only accessed by the presentation thread
+    Core::PerfStats::Clock::time_point last_present_time{};
+    Core::PerfStats::Clock::time_point last_presented_frame_begin{};
 };
 
 } // namespace OpenGL
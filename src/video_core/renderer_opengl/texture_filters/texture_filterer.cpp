@@ -5,16 +5,29 @@
 #include <algorithm>
 #include <functional>
 #include <unordered_map>
+#include <vector>
+#include <boost/functional/hash.hpp>
 #include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/scope_exit.h"
+#include "video_core/renderer_base.h"
+#include "video_core/renderer_opengl/gl_rasterizer_cache.h"
+#include "video_core/renderer_opengl/gl_state.h"
 #include "video_core/renderer_opengl/texture_filters/anime4k/anime4k_ultrafast.h"
 #include "video_core/renderer_opengl/texture_filters/bicubic/bicubic.h"
 #include "video_core/renderer_opengl/texture_filters/scale_force/scale_force.h"
 #include "video_core/renderer_opengl/texture_filters/texture_filter_base.h"
 #include "video_core/renderer_opengl/texture_filters/texture_filterer.h"
 #include "video_core/renderer_opengl/texture_filters/xbrz/xbrz_freescale.h"
+#include "video_core/video_core.h"
 
 namespace OpenGL {
 
+/// Total size of the filtered copies kept around
+constexpr std::size_t MAX_CACHE_SIZE = 128 * 1024 * 1024;
+/// Filtered pixels written per frame by the queued filters, past the first one
+constexpr std::size_t MAX_QUEUED_PIXELS_PER_FRAME = 2048 * 2048;
+
 namespace {
 
 using TextureFilterContructor = std::function<std::unique_ptr<TextureFilterBase>(u16)>;
@@ -32,8 +45,56 @@ static const std::unordered_map<std::string_view, TextureFilterContructor> filte
     FilterMapPair<XbrzFreescale>(),
 };
 
+/// Copies src_rect of a color texture to dst_rect of another one of the same size
+void CopyColor(GLuint src_tex, const Common::Rectangle<u32>& src_rect, GLuint dst_tex,
+               const Common::Rectangle<u32>& dst_rect, GLuint read_fb_handle,
+               GLuint draw_fb_handle) {
+    OpenGLState prev_state = OpenGLState::GetCurState();
+    SCOPE_EXIT({ prev_state.Apply(); });
+
+    OpenGLState state;
+    state.draw.read_framebuffer = read_fb_handle;
+    state.draw.draw_framebuffer = draw_fb_handle;
+    state.Apply();
+
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, src_tex, 0);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dst_tex, 0);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+
+    glBlitFramebuffer(src_rect.left, src_rect.bottom, src_rect.right, src_rect.top, dst_rect.left,
+                      dst_rect.bottom, dst_rect.right, dst_rect.top, GL_COLOR_BUFFER_BIT,
+                      GL_NEAREST);
+}
+
+void AllocateCacheTexture(GLuint texture, u32 width, u32 height) {
+    OpenGLState cur_state = OpenGLState::GetCurState();
+    const GLuint old_tex = cur_state.texture_units[0].texture_2d;
+    cur_state.texture_units[0].texture_2d = texture;
+    cur_state.Apply();
+
+    glActiveTexture(GL_TEXTURE0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    cur_state.texture_units[0].texture_2d = old_tex;
+    cur_state.Apply();
+}
+
 } // namespace
 
+std::size_t TextureFilterer::CacheKeyHash::operator()(const CacheKey& key) const {
+    std::size_t hash = 0;
+    boost::hash_combine(hash, key.source_hash);
+    boost::hash_combine(hash, key.src_width);
+    boost::hash_combine(hash, key.src_height);
+    boost::hash_combine(hash, key.dst_width);
+    boost::hash_combine(hash, key.dst_height);
+    return hash;
+}
+
 TextureFilterer::TextureFilterer(std::string_view filter_name, u16 scale_factor) {
     Reset(filter_name, scale_factor);
 }
@@ -51,6 +112,7 @@ bool TextureFilterer::Reset(std::string_view new_filter_name, u16 new_scale_fact
 
     filter_name = iter->first;
     filter = iter->second(new_scale_factor);
+    Clear();
     return true;
 }
 
@@ -58,18 +120,133 @@ bool TextureFilterer::IsNull() const {
     return !filter;
 }
 
+bool TextureFilterer::CanFilter(SurfaceParams::SurfaceType type) const {
+    // depth / stencil texture filtering is not supported for now
+    return !IsNull() && (type == SurfaceParams::SurfaceType::Color ||
+                         type == SurfaceParams::SurfaceType::Texture);
+}
+
 bool TextureFilterer::Filter(GLuint src_tex, const Common::Rectangle<u32>& src_rect, GLuint dst_tex,
                              const Common::Rectangle<u32>& dst_rect,
                              SurfaceParams::SurfaceType type, GLuint read_fb_handle,
                              GLuint draw_fb_handle) {
-    // depth / stencil texture filtering is not supported for now
-    if (IsNull() ||
-        (type != SurfaceParams::SurfaceType::Color && type != SurfaceParams::SurfaceType::Texture))
+    if (!CanFilter(type))
         return false;
     filter->Filter(src_tex, src_rect, dst_tex, dst_rect, read_fb_handle, draw_fb_handle);
     return true;
 }
 
+bool TextureFilterer::FilterCached(u64 source_hash, const Common::Rectangle<u32>& src_rect,
+                                   GLuint dst_tex, const Common::Rectangle<u32>& dst_rect,
+                                   GLuint read_fb_handle, GLuint draw_fb_handle) {
+    const auto it = cache.find(MakeKey(source_hash, src_rect, dst_rect));
+    if (it == cache.end()) {
+        return false;
+    }
+    it->second.last_used_frame = VideoCore::g_renderer->GetCurrentFrame();
+    CopyColor(it->second.texture.handle, {0, dst_rect.GetHeight(), dst_rect.GetWidth(), 0},
+              dst_tex, dst_rect, read_fb_handle, draw_fb_handle);
+    return true;
+}
+
+void TextureFilterer::QueueFilter(u64 source_hash, OGLTexture&& src_tex,
+                                  const Common::Rectangle<u32>& src_rect,
+                                  std::shared_ptr<SurfaceWatcher> watcher,
+                                  const Common::Rectangle<u32>& dst_rect) {
+    queue.push_back({MakeKey(source_hash, src_rect, dst_rect), std::move(src_tex), src_rect,
+                     std::move(watcher), dst_rect});
+}
+
+MICROPROFILE_DEFINE(OpenGL_QueuedFilter, "OpenGL", "Queued Texture Filter", MP_RGB(128, 64, 192));
+void TextureFilterer::ProcessQueue(int current_frame, GLuint read_fb_handle,
+                                   GLuint draw_fb_handle) {
+    if (queue.empty() || current_frame == last_processed_frame) {
+        return;
+    }
+    last_processed_frame = current_frame;
+    MICROPROFILE_SCOPE(OpenGL_QueuedFilter);
+
+    std::size_t filtered_pixels = 0;
+    while (!queue.empty() && filtered_pixels < MAX_QUEUED_PIXELS_PER_FRAME) {
+        FilterJob job = std::move(queue.front());
+        queue.pop_front();
+
+        // The surface was written to or destroyed since the upload, the result would be stale
+        if (!job.watcher->IsValid()) {
+            continue;
+        }
+        const Surface surface = job.watcher->Get();
+        const u32 width = job.dst_rect.GetWidth();
+        const u32 height = job.dst_rect.GetHeight();
+        const std::size_t size = static_cast<std::size_t>(width) * height * 4;
+        filtered_pixels += static_cast<std::size_t>(width) * height;
+
+        if (cache.count(job.key) == 0 && Evict(size)) {
+            OGLTexture texture;
+            texture.Create();
+            AllocateCacheTexture(texture.handle, width, height);
+            filter->Filter(job.src_tex.handle, job.src_rect, texture.handle, {0, height, width, 0},
+                           read_fb_handle, draw_fb_handle);
+            cache.emplace(job.key, CacheEntry{std::move(texture), current_frame});
+            cache_size += size;
+        }
+        if (!FilterCached(job.key.source_hash, job.src_rect, surface->texture.handle,
+                          job.dst_rect, read_fb_handle, draw_fb_handle)) {
+            filter->Filter(job.src_tex.handle, job.src_rect, surface->texture.handle,
+                           job.dst_rect, read_fb_handle, draw_fb_handle);
+        }
+
+        // Texture cubes and mipmaps copied from the surface have to pick up the filtered image,
+        // while the other filters queued for the surface still apply to it
+        std::vector<SurfaceWatcher*> pending_watchers;
+        for (const FilterJob& other : queue) {
+            if (other.watcher->IsValid() && other.watcher->Get() == surface) {
+                pending_watchers.push_back(other.watcher.get());
+            }
+        }
+        surface->InvalidateAllWatcher();
+        for (SurfaceWatcher* pending_watcher : pending_watchers) {
+            pending_watcher->Validate();
+        }
+    }
+}
+
+TextureFilterer::CacheKey TextureFilterer::MakeKey(u64 source_hash,
+                                                   const Common::Rectangle<u32>& src_rect,
+                                                   const Common::Rectangle<u32>& dst_rect) {
+    return {source_hash, src_rect.GetWidth(), src_rect.GetHeight(), dst_rect.GetWidth(),
+            dst_rect.GetHeight()};
+}
+
+bool TextureFilterer::Evict(std::size_t size) {
+    if (size > MAX_CACHE_SIZE / 4) {
+        return false;
+    }
+    // Copies used by the current frame may still be read by the surfaces being set up
+    const int current_frame = VideoCore::g_renderer->GetCurrentFrame();
+    while (cache_size + size > MAX_CACHE_SIZE) {
+        auto lru = cache.end();
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->second.last_used_frame != current_frame &&
+                (lru == cache.end() || it->second.last_used_frame < lru->second.last_used_frame)) {
+                lru = it;
+            }
+        }
+        if (lru == cache.end()) {
+            return false;
+        }
+        cache_size -= static_cast<std::size_t>(lru->first.dst_width) * lru->first.dst_height * 4;
+        cache.erase(lru);
+    }
+    return true;
+}
+
+void TextureFilterer::Clear() {
+    cache.clear();
+    cache_size = 0;
+    queue.clear();
+}
+
 std::vector<std::string_view> TextureFilterer::GetFilterNames() {
     std::vector<std::string_view> ret;
     std::transform(filter_map.begin(), filter_map.end(), std::back_inserter(ret),
@@ -4,17 +4,23 @@
 
 #pragma once
 
+#include <cstddef>
+#include <deque>
 #include <memory>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <glad/glad.h>
 #include "common/common_types.h"
 #include "common/math_util.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
 #include "video_core/renderer_opengl/gl_surface_params.h"
 #include "video_core/renderer_opengl/texture_filters/texture_filter_base.h"
 
 namespace OpenGL {
 
+struct SurfaceWatcher;
+
 class TextureFilterer {
 public:
     static constexpr std::string_view NONE = "none";
@@ -24,16 +30,84 @@ public:
     bool Reset(std::string_view new_filter_name, u16 new_scale_factor);
     // returns true if there is no active filter
     bool IsNull() const;
+    // returns true if surfaces of the type can be filtered
+    bool CanFilter(SurfaceParams::SurfaceType type) const;
     // returns true if the texture was able to be filtered
     bool Filter(GLuint src_tex, const Common::Rectangle<u32>& src_rect, GLuint dst_tex,
                 const Common::Rectangle<u32>& dst_rect, SurfaceParams::SurfaceType type,
                 GLuint read_fb_handle, GLuint draw_fb_handle);
 
+    /**
+     * Writes the filtered copy of a source that was filtered before to dst_tex.
+     * @param source_hash hash of the data the source texture was decoded from
+     * @returns false if there is no such copy
+     */
+    bool FilterCached(u64 source_hash, const Common::Rectangle<u32>& src_rect, GLuint dst_tex,
+                      const Common::Rectangle<u32>& dst_rect, GLuint read_fb_handle,
+                      GLuint draw_fb_handle);
+
+    /**
+     * Queues the filtering of src_tex, which is taken over, into the surface of the watcher. The
+     * result is cached for the next uploads of the same source, and only written to the surface
+     * if the surface hasn't changed in the meantime.
+     */
+    void QueueFilter(u64 source_hash, OGLTexture&& src_tex, const Common::Rectangle<u32>& src_rect,
+                     std::shared_ptr<SurfaceWatcher> watcher,
+                     const Common::Rectangle<u32>& dst_rect);
+
+    /// Runs the queued filters that fit in the budget of a frame, once per frame
+    void ProcessQueue(int current_frame, GLuint read_fb_handle, GLuint draw_fb_handle);
+
     static std::vector<std::string_view> GetFilterNames();
 
 private:
+    struct CacheKey {
+        u64 source_hash;
+        u32 src_width;
+        u32 src_height;
+        u32 dst_width;
+        u32 dst_height;
+
+        bool operator==(const CacheKey& other) const {
+            return source_hash == other.source_hash && src_width == other.src_width &&
+                   src_height == other.src_height && dst_width == other.dst_width &&
+                   dst_height == other.dst_height;
+        }
+    };
+
+    struct CacheKeyHash {
+        std::size_t operator()(const CacheKey& key) const;
+    };
+
+    struct CacheEntry {
+        OGLTexture texture;
+        int last_used_frame;
+    };
+
+    struct FilterJob {
+        CacheKey key;
+        OGLTexture src_tex;
+        Common::Rectangle<u32> src_rect;
+        std::shared_ptr<SurfaceWatcher> watcher;
+        Common::Rectangle<u32> dst_rect;
+    };
+
+    static CacheKey MakeKey(u64 source_hash, const Common::Rectangle<u32>& src_rect,
+                            const Common::Rectangle<u32>& dst_rect);
+
+    /// Makes room for a new entry of the size, returns false if there is none
+    bool Evict(std::size_t size);
+
+    /// Drops the cached copies and the queued filters
+    void Clear();
+
     std::string_view filter_name = NONE;
     std::unique_ptr<TextureFilterBase> filter;
+
+    std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> cache;
+    std::size_t cache_size = 0;
+    std::deque<FilterJob> queue;
+    int last_processed_frame = -1;
 };
 
 } // namespace OpenGL
@@ -132,6 +132,16 @@ void GSUnitState::ConfigOutput(const ShaderRegs& config) {
     emitter.output_mask = config.output_mask;
 }
 
+void ShaderEngine::RunBatch(const ShaderSetup& setup, const ShaderRegs& config,
+                            UnitState& state, const AttributeBuffer* inputs,
+                            AttributeBuffer* outputs, std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i) {
+        state.LoadInput(config, inputs[i]);
+        Run(setup, state);
+        state.WriteOutput(config, outputs[i]);
+    }
+}
+
 MICROPROFILE_DEFINE(GPU_Shader, "GPU", "Shader", MP_RGB(50, 50, 240));
 
 #ifdef ARCHITECTURE_x86_64
@@ -340,6 +340,22 @@ public:
      * @param state Shader unit state, must be setup with input data before each shader invocation.
      */
     virtual void Run(const ShaderSetup& setup, UnitState& state) const = 0;
+
+    /**
+     * Runs the currently setup shader over a batch of vertices on a single shader unit. This is
+     * equivalent to calling LoadInput, Run and WriteOutput for each vertex, but lets engines
+     * amortize their per-invocation overhead across the whole batch.
+     *
+     * @param setup Shader engine state, must be setup with SetupBatch on each shader change.
+     * @param config Shader configuration registers corresponding to the unit.
+     * @param state Shader unit state used for every invocation of the batch.
+     * @param inputs Array of `count` input attribute buffers.
+     * @param outputs Array of `count` attribute buffers receiving the shader outputs.
+     * @param count Number of vertices in the batch.
+     */
+    virtual void RunBatch(const ShaderSetup& setup, const ShaderRegs& config, UnitState& state,
+                          const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                          std::size_t count) const;
 };
 
 // TODO(yuriks): Remove and make it non-global state somewhere
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <memory>
 #include <numeric>
 #include <boost/container/static_vector.hpp>
 #include <boost/range/algorithm/fill.hpp>
@@ -666,19 +667,875 @@ static void RunInterpreter(const ShaderSetup& setup, UnitState& state, DebugData
     }
 }
 
+// Operations of the decoded programs. Arithmetic instructions differing only in the order of
+// their sources share an operation, the order is resolved when decoding.
+#define INTERPRETER_MICRO_OPS(X)                                                                   \
+    X(ADD)                                                                                         \
+    X(MUL)                                                                                         \
+    X(FLR)                                                                                         \
+    X(MAX)                                                                                         \
+    X(MIN)                                                                                         \
+    X(DP3)                                                                                         \
+    X(DP4)                                                                                         \
+    X(DPH)                                                                                         \
+    X(RCP)                                                                                         \
+    X(RSQ)                                                                                         \
+    X(MOVA)                                                                                        \
+    X(MOV)                                                                                         \
+    X(SGE)                                                                                         \
+    X(SLT)                                                                                         \
+    X(CMP)                                                                                         \
+    X(EX2)                                                                                         \
+    X(LG2)                                                                                         \
+    X(MAD)                                                                                         \
+    X(UnhandledArithmetic)                                                                         \
+    X(UnhandledMultiplyAdd)                                                                        \
+    X(END)                                                                                         \
+    X(JMPC)                                                                                        \
+    X(JMPU)                                                                                        \
+    X(CALL)                                                                                        \
+    X(CALLU)                                                                                       \
+    X(CALLC)                                                                                       \
+    X(NOP)                                                                                         \
+    X(IFU)                                                                                         \
+    X(IFC)                                                                                         \
+    X(LOOP)                                                                                        \
+    X(EMIT)                                                                                        \
+    X(SETEMIT)                                                                                     \
+    X(Unhandled)
+
+enum class MicroOpType : u8 {
+#define MICRO_OP_ENUM(name) name,
+    INTERPRETER_MICRO_OPS(MICRO_OP_ENUM)
+#undef MICRO_OP_ENUM
+};
+
+/// Register banks the operands of the decoded instructions are resolved to
+enum RegisterBank : u8 {
+    BankInput = 0,
+    BankTemporary = 1,
+    BankFloatUniform = 2,
+    BankOutput = 2,
+    BankDummy = 3,
+};
+
+struct MicroOperand {
+    RegisterBank bank;
+    u8 index;
+    bool negate;
+    std::array<u8, 4> selectors;
+};
+
+struct MicroOp {
+    MicroOpType type;
+    /// Components of the destination written, bit n for component n
+    u8 dest_mask;
+    RegisterBank dest_bank;
+    u8 dest_index;
+    /// Address register added to the relative source, 0 if the instruction doesn't use one
+    u8 address_register_index;
+    /// Which of the sources the address register is added to
+    u8 relative_source;
+    std::array<MicroOperand, 3> sources;
+    /// The instruction word, left to be read by the flow control instructions
+    u32 hex;
+};
+
+/// A program decoded with its swizzle patterns, so that running it doesn't decode them again
+struct InterpreterProgram {
+    std::array<MicroOp, MAX_PROGRAM_CODE_LENGTH> ops;
+};
+
+static MicroOperand DecodeOperand(const SourceRegister& source_reg, bool negate,
+                                  const std::array<u8, 4>& selectors) {
+    MicroOperand operand{BankDummy, 0, negate, selectors};
+    switch (source_reg.GetRegisterType()) {
+    case RegisterType::Input:
+        operand.bank = BankInput;
+        break;
+    case RegisterType::Temporary:
+        operand.bank = BankTemporary;
+        break;
+    case RegisterType::FloatUniform:
+        operand.bank = BankFloatUniform;
+        break;
+    default:
+        return operand;
+    }
+    operand.index = static_cast<u8>(source_reg.GetIndex());
+    return operand;
+}
+
+template <typename DestType>
+static void DecodeDest(MicroOp& op, const DestType& dest) {
+    if (dest.Value() < 0x10) {
+        op.dest_bank = BankOutput;
+    } else if (dest.Value() < 0x20) {
+        op.dest_bank = BankTemporary;
+    } else {
+        op.dest_bank = BankDummy;
+        return;
+    }
+    op.dest_index = static_cast<u8>(dest.Value().GetIndex());
+}
+
+static MicroOp DecodeInstruction(u32 hex, const SwizzleData& swizzle_data) {
+    const Instruction instr = {hex};
+    MicroOp op{};
+    op.hex = hex;
+    op.dest_bank = BankDummy;
+    for (auto& source : op.sources) {
+        source.bank = BankDummy;
+    }
+
+    const auto decode_swizzle = [&op](const SwizzlePattern& swizzle) {
+        for (int i = 0; i < 4; ++i) {
+            if (swizzle.DestComponentEnabled(i)) {
+                op.dest_mask |= 1 << i;
+            }
+        }
+    };
+
+    switch (instr.opcode.Value().GetInfo().type) {
+    case OpCode::Type::Arithmetic: {
+        const SwizzlePattern swizzle = {swizzle_data[instr.common.operand_desc_id]};
+        const bool is_inverted =
+            (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+        decode_swizzle(swizzle);
+        DecodeDest(op, instr.common.dest);
+        op.address_register_index = static_cast<u8>(instr.common.address_register_index);
+        op.relative_source = is_inverted ? 1 : 0;
+        op.sources[0] = DecodeOperand(instr.common.GetSrc1(is_inverted), swizzle.negate_src1,
+                                      {static_cast<u8>(swizzle.src1_selector_0.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_1.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_2.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_3.Value())});
+        op.sources[1] = DecodeOperand(instr.common.GetSrc2(is_inverted), swizzle.negate_src2,
+                                      {static_cast<u8>(swizzle.src2_selector_0.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_1.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_2.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_3.Value())});
+
+        switch (instr.opcode.Value().EffectiveOpCode()) {
+        case OpCode::Id::ADD:
+            op.type = MicroOpType::ADD;
+            break;
+        case OpCode::Id::MUL:
+            op.type = MicroOpType::MUL;
+            break;
+        case OpCode::Id::FLR:
+            op.type = MicroOpType::FLR;
+            break;
+        case OpCode::Id::MAX:
+            op.type = MicroOpType::MAX;
+            break;
+        case OpCode::Id::MIN:
+            op.type = MicroOpType::MIN;
+            break;
+        case OpCode::Id::DP3:
+            op.type = MicroOpType::DP3;
+            break;
+        case OpCode::Id::DP4:
+            op.type = MicroOpType::DP4;
+            break;
+        case OpCode::Id::DPH:
+        case OpCode::Id::DPHI:
+            op.type = MicroOpType::DPH;
+            break;
+        case OpCode::Id::RCP:
+            op.type = MicroOpType::RCP;
+            break;
+        case OpCode::Id::RSQ:
+            op.type = MicroOpType::RSQ;
+            break;
+        case OpCode::Id::MOVA:
+            op.type = MicroOpType::MOVA;
+            break;
+        case OpCode::Id::MOV:
+            op.type = MicroOpType::MOV;
+            break;
+        case OpCode::Id::SGE:
+        case OpCode::Id::SGEI:
+            op.type = MicroOpType::SGE;
+            break;
+        case OpCode::Id::SLT:
+        case OpCode::Id::SLTI:
+            op.type = MicroOpType::SLT;
+            break;
+        case OpCode::Id::CMP:
+            op.type = MicroOpType::CMP;
+            break;
+        case OpCode::Id::EX2:
+            op.type = MicroOpType::EX2;
+            break;
+        case OpCode::Id::LG2:
+            op.type = MicroOpType::LG2;
+            break;
+        default:
+            op.type = MicroOpType::UnhandledArithmetic;
+            break;
+        }
+        break;
+    }
+
+    case OpCode::Type::MultiplyAdd: {
+        if ((instr.opcode.Value().EffectiveOpCode() != OpCode::Id::MAD) &&
+            (instr.opcode.Value().EffectiveOpCode() != OpCode::Id::MADI)) {
+            op.type = MicroOpType::UnhandledMultiplyAdd;
+            break;
+        }
+
+        const SwizzlePattern swizzle = {swizzle_data[instr.mad.operand_desc_id]};
+        const bool is_inverted = (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI);
+
+        op.type = MicroOpType::MAD;
+        decode_swizzle(swizzle);
+        DecodeDest(op, instr.mad.dest);
+        op.address_register_index = static_cast<u8>(instr.mad.address_register_index);
+        op.relative_source = is_inverted ? 2 : 1;
+        op.sources[0] = DecodeOperand(instr.mad.GetSrc1(is_inverted), swizzle.negate_src1,
+                                      {static_cast<u8>(swizzle.src1_selector_0.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_1.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_2.Value()),
+                                       static_cast<u8>(swizzle.src1_selector_3.Value())});
+        op.sources[1] = DecodeOperand(instr.mad.GetSrc2(is_inverted), swizzle.negate_src2,
+                                      {static_cast<u8>(swizzle.src2_selector_0.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_1.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_2.Value()),
+                                       static_cast<u8>(swizzle.src2_selector_3.Value())});
+        op.sources[2] = DecodeOperand(instr.mad.GetSrc3(is_inverted), swizzle.negate_src3,
+                                      {static_cast<u8>(swizzle.src3_selector_0.Value()),
+                                       static_cast<u8>(swizzle.src3_selector_1.Value()),
+                                       static_cast<u8>(swizzle.src3_selector_2.Value()),
+                                       static_cast<u8>(swizzle.src3_selector_3.Value())});
+        break;
+    }
+
+    default:
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::END:
+            op.type = MicroOpType::END;
+            break;
+        case OpCode::Id::JMPC:
+            op.type = MicroOpType::JMPC;
+            break;
+        case OpCode::Id::JMPU:
+            op.type = MicroOpType::JMPU;
+            break;
+        case OpCode::Id::CALL:
+            op.type = MicroOpType::CALL;
+            break;
+        case OpCode::Id::CALLU:
+            op.type = MicroOpType::CALLU;
+            break;
+        case OpCode::Id::CALLC:
+            op.type = MicroOpType::CALLC;
+            break;
+        case OpCode::Id::NOP:
+            op.type = MicroOpType::NOP;
+            break;
+        case OpCode::Id::IFU:
+            op.type = MicroOpType::IFU;
+            break;
+        case OpCode::Id::IFC:
+            op.type = MicroOpType::IFC;
+            break;
+        case OpCode::Id::LOOP:
+            op.type = MicroOpType::LOOP;
+            break;
+        case OpCode::Id::EMIT:
+            op.type = MicroOpType::EMIT;
+            break;
+        case OpCode::Id::SETEMIT:
+            op.type = MicroOpType::SETEMIT;
+            break;
+        default:
+            op.type = MicroOpType::Unhandled;
+            break;
+        }
+        break;
+    }
+    return op;
+}
+
+static std::unique_ptr<InterpreterProgram> DecodeProgram(const ProgramCode& program_code,
+                                                         const SwizzleData& swizzle_data) {
+    auto program = std::make_unique<InterpreterProgram>();
+    for (std::size_t i = 0; i < program_code.size(); ++i) {
+        program->ops[i] = DecodeInstruction(program_code[i], swizzle_data);
+    }
+    return program;
+}
+
+/**
+ * Runs a decoded program, doing what RunInterpreter does without producing debug data. Each
+ * operation jumps straight to the next one where the compiler supports a table of labels, which
+ * gives every operation its own branch history for the jump.
+ */
+static void RunProgram(const InterpreterProgram& program, const ShaderSetup& setup,
+                       UnitState& state, unsigned offset) {
+    boost::container::static_vector<CallStackElement, 16> call_stack;
+    u32 program_counter = offset;
+
+    state.conditional_code[0] = false;
+    state.conditional_code[1] = false;
+
+    auto call = [&program_counter, &call_stack](u32 offset, u32 num_instructions, u32 return_offset,
+                                                u8 repeat_count, u8 loop_increment) {
+        // -1 to make sure when incrementing the PC we end up at the correct offset
+        program_counter = offset - 1;
+        ASSERT(call_stack.size() < call_stack.capacity());
+        call_stack.push_back(
+            {offset + num_instructions, return_offset, repeat_count, loop_increment, offset});
+    };
+
+    auto evaluate_condition = [&state](Instruction::FlowControlType flow_control) {
+        using Op = Instruction::FlowControlType::Op;
+
+        bool result_x = flow_control.refx.Value() == state.conditional_code[0];
+        bool result_y = flow_control.refy.Value() == state.conditional_code[1];
+
+        switch (flow_control.op) {
+        case Op::Or:
+            return result_x || result_y;
+        case Op::And:
+            return result_x && result_y;
+        case Op::JustX:
+            return result_x;
+        case Op::JustY:
+            return result_y;
+        default:
+            UNREACHABLE();
+            return false;
+        }
+    };
+
+    const auto& uniforms = setup.uniforms;
+
+    // Placeholder for invalid inputs
+    static float24 dummy_vec4_float24[4];
+
+    const std::array<const float24*, 4> source_banks{
+        &state.registers.input[0].x,
+        &state.registers.temporary[0].x,
+        &uniforms.f[0].x,
+        dummy_vec4_float24,
+    };
+    const std::array<float24*, 4> dest_banks{
+        nullptr,
+        &state.registers.temporary[0].x,
+        &state.registers.output[0].x,
+        dummy_vec4_float24,
+    };
+
+    auto LookupSourceRegister = [&](const SourceRegister& source_reg) -> const float24* {
+        switch (source_reg.GetRegisterType()) {
+        case RegisterType::Input:
+            return &state.registers.input[source_reg.GetIndex()].x;
+
+        case RegisterType::Temporary:
+            return &state.registers.temporary[source_reg.GetIndex()].x;
+
+        case RegisterType::FloatUniform:
+            return &uniforms.f[source_reg.GetIndex()].x;
+
+        default:
+            return dummy_vec4_float24;
+        }
+    };
+
+    // Only the source the address register is added to is looked up when running
+    auto RelativeSource = [&](const MicroOp& op) -> const float24* {
+        const Instruction instr = {op.hex};
+        const int address_offset = state.address_registers[op.address_register_index - 1];
+        if (op.type == MicroOpType::MAD) {
+            return op.relative_source == 1 ? LookupSourceRegister(instr.mad.GetSrc2(false) +
+                                                                  address_offset)
+                                           : LookupSourceRegister(instr.mad.GetSrc3(true) +
+                                                                  address_offset);
+        }
+        return op.relative_source == 0
+                   ? LookupSourceRegister(instr.common.GetSrc1(false) + address_offset)
+                   : LookupSourceRegister(instr.common.GetSrc2(true) + address_offset);
+    };
+
+    auto LoadSource = [&](const MicroOp& op, std::size_t n, float24 (&values)[4]) {
+        const MicroOperand& operand = op.sources[n];
+        const float24* source = (op.address_register_index != 0 && op.relative_source == n)
+                                    ? RelativeSource(op)
+                                    : source_banks[operand.bank] + operand.index * 4;
+        for (int i = 0; i < 4; ++i) {
+            values[i] = operand.negate ? -source[operand.selectors[i]]
+                                       : source[operand.selectors[i]];
+        }
+    };
+
+    auto GetDest = [&](const MicroOp& op) {
+        return dest_banks[op.dest_bank] + op.dest_index * 4;
+    };
+
+    const MicroOp* op = nullptr;
+    float24 src1[4];
+    float24 src2[4];
+    float24 src3[4];
+
+// Leaves the calls and loops ending at the program counter, then runs the instruction there
+#define FINISH_SCOPES()                                                                            \
+    while (!call_stack.empty() && program_counter == call_stack.back().final_address) {           \
+        auto& top = call_stack.back();                                                             \
+        state.address_registers[2] += top.loop_increment;                                          \
+        if (top.repeat_counter-- == 0) {                                                           \
+            program_counter = top.return_address;                                                  \
+            call_stack.pop_back();                                                                 \
+        } else {                                                                                   \
+            program_counter = top.loop_address;                                                    \
+        }                                                                                          \
+    }                                                                                              \
+    op = &program.ops[program_counter]
+
+// GCC and Clang have a C++ extension to support a lookup table of labels. Otherwise, fallback to a
+// switch statement.
+#if defined __GNUC__ || defined __clang__
+#define MICRO_OP_LABEL(name) &&Op_##name,
+    static void* const op_labels[] = {INTERPRETER_MICRO_OPS(MICRO_OP_LABEL)};
+#undef MICRO_OP_LABEL
+#define DISPATCH()                                                                                 \
+    do {                                                                                           \
+        FINISH_SCOPES();                                                                           \
+        goto* op_labels[static_cast<std::size_t>(op->type)];                                       \
+    } while (0)
+#else
+#define MICRO_OP_CASE(name)                                                                        \
+    case MicroOpType::name:                                                                        \
+        goto Op_##name;
+#define DISPATCH()                                                                                 \
+    do {                                                                                           \
+        FINISH_SCOPES();                                                                           \
+        switch (op->type) { INTERPRETER_MICRO_OPS(MICRO_OP_CASE) }                                 \
+    } while (0)
+#endif
+#define NEXT()                                                                                     \
+    do {                                                                                           \
+        ++program_counter;                                                                         \
+        DISPATCH();                                                                                \
+    } while (0)
+
+    DISPATCH();
+
+Op_ADD : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = src1[i] + src2[i];
+    }
+    NEXT();
+}
+
+Op_MUL : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = src1[i] * src2[i];
+    }
+    NEXT();
+}
+
+Op_FLR : {
+    LoadSource(*op, 0, src1);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = float24::FromFloat32(std::floor(src1[i].ToFloat32()));
+    }
+    NEXT();
+}
+
+Op_MAX : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   max(0, NaN) -> NaN
+        //   max(NaN, 0) -> 0
+        if (op->dest_mask & (1 << i))
+            dest[i] = (src1[i] > src2[i]) ? src1[i] : src2[i];
+    }
+    NEXT();
+}
+
+Op_MIN : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   min(0, NaN) -> NaN
+        //   min(NaN, 0) -> 0
+        if (op->dest_mask & (1 << i))
+            dest[i] = (src1[i] < src2[i]) ? src1[i] : src2[i];
+    }
+    NEXT();
+}
+
+Op_DP3 : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    const float24 dot = std::inner_product(src1, src1 + 3, src2, float24::FromFloat32(0.f));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = dot;
+    }
+    NEXT();
+}
+
+Op_DP4 : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    const float24 dot = std::inner_product(src1, src1 + 4, src2, float24::FromFloat32(0.f));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = dot;
+    }
+    NEXT();
+}
+
+Op_DPH : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    src1[3] = float24::FromFloat32(1.0f);
+    const float24 dot = std::inner_product(src1, src1 + 4, src2, float24::FromFloat32(0.f));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = dot;
+    }
+    NEXT();
+}
+
+Op_RCP : {
+    LoadSource(*op, 0, src1);
+    const float24 rcp_res = float24::FromFloat32(1.0f / src1[0].ToFloat32());
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = rcp_res;
+    }
+    NEXT();
+}
+
+Op_RSQ : {
+    LoadSource(*op, 0, src1);
+    const float24 rsq_res = float24::FromFloat32(1.0f / std::sqrt(src1[0].ToFloat32()));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = rsq_res;
+    }
+    NEXT();
+}
+
+Op_MOVA : {
+    LoadSource(*op, 0, src1);
+    for (int i = 0; i < 2; ++i) {
+        // TODO: Figure out how the rounding is done on hardware
+        if (op->dest_mask & (1 << i))
+            state.address_registers[i] = static_cast<s32>(src1[i].ToFloat32());
+    }
+    NEXT();
+}
+
+Op_MOV : {
+    LoadSource(*op, 0, src1);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = src1[i];
+    }
+    NEXT();
+}
+
+Op_SGE : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = (src1[i] >= src2[i]) ? float24::FromFloat32(1.0f)
+                                           : float24::FromFloat32(0.0f);
+    }
+    NEXT();
+}
+
+Op_SLT : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = (src1[i] < src2[i]) ? float24::FromFloat32(1.0f)
+                                          : float24::FromFloat32(0.0f);
+    }
+    NEXT();
+}
+
+Op_CMP : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    const Instruction instr = {op->hex};
+    for (int i = 0; i < 2; ++i) {
+        auto compare_op = instr.common.compare_op;
+        auto cmp = (i == 0) ? compare_op.x.Value() : compare_op.y.Value();
+
+        switch (cmp) {
+        case Instruction::Common::CompareOpType::Equal:
+            state.conditional_code[i] = (src1[i] == src2[i]);
+            break;
+
+        case Instruction::Common::CompareOpType::NotEqual:
+            state.conditional_code[i] = (src1[i] != src2[i]);
+            break;
+
+        case Instruction::Common::CompareOpType::LessThan:
+            state.conditional_code[i] = (src1[i] < src2[i]);
+            break;
+
+        case Instruction::Common::CompareOpType::LessEqual:
+            state.conditional_code[i] = (src1[i] <= src2[i]);
+            break;
+
+        case Instruction::Common::CompareOpType::GreaterThan:
+            state.conditional_code[i] = (src1[i] > src2[i]);
+            break;
+
+        case Instruction::Common::CompareOpType::GreaterEqual:
+            state.conditional_code[i] = (src1[i] >= src2[i]);
+            break;
+
+        default:
+            LOG_ERROR(HW_GPU, "Unknown compare mode {:x}", static_cast<int>(cmp));
+            break;
+        }
+    }
+    NEXT();
+}
+
+Op_EX2 : {
+    LoadSource(*op, 0, src1);
+    // EX2 only takes first component exp2 and writes it to all dest components
+    const float24 ex2_res = float24::FromFloat32(std::exp2(src1[0].ToFloat32()));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = ex2_res;
+    }
+    NEXT();
+}
+
+Op_LG2 : {
+    LoadSource(*op, 0, src1);
+    // LG2 only takes the first component log2 and writes it to all dest components
+    const float24 lg2_res = float24::FromFloat32(std::log2(src1[0].ToFloat32()));
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = lg2_res;
+    }
+    NEXT();
+}
+
+Op_MAD : {
+    LoadSource(*op, 0, src1);
+    LoadSource(*op, 1, src2);
+    LoadSource(*op, 2, src3);
+    float24* dest = GetDest(*op);
+    for (int i = 0; i < 4; ++i) {
+        if (op->dest_mask & (1 << i))
+            dest[i] = src1[i] * src2[i] + src3[i];
+    }
+    NEXT();
+}
+
+Op_UnhandledArithmetic : {
+    const Instruction instr = {op->hex};
+    LOG_ERROR(HW_GPU, "Unhandled arithmetic instruction: 0x{:02x} ({}): 0x{:08x}",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+    DEBUG_ASSERT(false);
+    NEXT();
+}
+
+Op_UnhandledMultiplyAdd : {
+    const Instruction instr = {op->hex};
+    LOG_ERROR(HW_GPU, "Unhandled multiply-add instruction: 0x{:02x} ({}): 0x{:08x}",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+    NEXT();
+}
+
+Op_END:
+    return;
+
+Op_JMPC : {
+    const Instruction instr = {op->hex};
+    if (evaluate_condition(instr.flow_control)) {
+        program_counter = instr.flow_control.dest_offset - 1;
+    }
+    NEXT();
+}
+
+Op_JMPU : {
+    const Instruction instr = {op->hex};
+    if (uniforms.b[instr.flow_control.bool_uniform_id] ==
+        !(instr.flow_control.num_instructions & 1)) {
+        program_counter = instr.flow_control.dest_offset - 1;
+    }
+    NEXT();
+}
+
+Op_CALL : {
+    const Instruction instr = {op->hex};
+    call(instr.flow_control.dest_offset, instr.flow_control.num_instructions, program_counter + 1,
+         0, 0);
+    NEXT();
+}
+
+Op_CALLU : {
+    const Instruction instr = {op->hex};
+    if (uniforms.b[instr.flow_control.bool_uniform_id]) {
+        call(instr.flow_control.dest_offset, instr.flow_control.num_instructions,
+             program_counter + 1, 0, 0);
+    }
+    NEXT();
+}
+
+Op_CALLC : {
+    const Instruction instr = {op->hex};
+    if (evaluate_condition(instr.flow_control)) {
+        call(instr.flow_control.dest_offset, instr.flow_control.num_instructions,
+             program_counter + 1, 0, 0);
+    }
+    NEXT();
+}
+
+Op_NOP:
+    NEXT();
+
+Op_IFU : {
+    const Instruction instr = {op->hex};
+    if (uniforms.b[instr.flow_control.bool_uniform_id]) {
+        call(program_counter + 1, instr.flow_control.dest_offset - program_counter - 1,
+             instr.flow_control.dest_offset + instr.flow_control.num_instructions, 0, 0);
+    } else {
+        call(instr.flow_control.dest_offset, instr.flow_control.num_instructions,
+             instr.flow_control.dest_offset + instr.flow_control.num_instructions, 0, 0);
+    }
+    NEXT();
+}
+
+Op_IFC : {
+    const Instruction instr = {op->hex};
+    if (evaluate_condition(instr.flow_control)) {
+        call(program_counter + 1, instr.flow_control.dest_offset - program_counter - 1,
+             instr.flow_control.dest_offset + instr.flow_control.num_instructions, 0, 0);
+    } else {
+        call(instr.flow_control.dest_offset, instr.flow_control.num_instructions,
+             instr.flow_control.dest_offset + instr.flow_control.num_instructions, 0, 0);
+    }
+    NEXT();
+}
+
+Op_LOOP : {
+    const Instruction instr = {op->hex};
+    Common::Vec4<u8> loop_param(uniforms.i[instr.flow_control.int_uniform_id].x,
+                                uniforms.i[instr.flow_control.int_uniform_id].y,
+                                uniforms.i[instr.flow_control.int_uniform_id].z,
+                                uniforms.i[instr.flow_control.int_uniform_id].w);
+    state.address_registers[2] = loop_param.y;
+    call(program_counter + 1, instr.flow_control.dest_offset - program_counter,
+         instr.flow_control.dest_offset + 1, loop_param.x, loop_param.z);
+    NEXT();
+}
+
+Op_EMIT : {
+    GSEmitter* emitter = state.emitter_ptr;
+    ASSERT_MSG(emitter, "Execute EMIT on VS");
+    emitter->Emit(state.registers.output);
+    NEXT();
+}
+
+Op_SETEMIT : {
+    const Instruction instr = {op->hex};
+    GSEmitter* emitter = state.emitter_ptr;
+    ASSERT_MSG(emitter, "Execute SETEMIT on VS");
+    emitter->vertex_id = instr.setemit.vertex_id;
+    emitter->prim_emit = instr.setemit.prim_emit != 0;
+    emitter->winding = instr.setemit.winding != 0;
+    NEXT();
+}
+
+Op_Unhandled : {
+    const Instruction instr = {op->hex};
+    LOG_ERROR(HW_GPU, "Unhandled instruction: 0x{:02x} ({}): 0x{:08x}",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+    NEXT();
+}
+
+#undef NEXT
+#undef DISPATCH
+#undef MICRO_OP_CASE
+#undef FINISH_SCOPES
+}
+
+InterpreterEngine::InterpreterEngine() = default;
+
+InterpreterEngine::~InterpreterEngine() = default;
+
 void InterpreterEngine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
     ASSERT(entry_point < MAX_PROGRAM_CODE_LENGTH);
     setup.engine_data.entry_point = entry_point;
+
+    const u64 cache_key = setup.GetProgramCodeHash() ^ setup.GetSwizzleDataHash();
+    auto iter = cache.find(cache_key);
+    if (iter == cache.end()) {
+        iter = cache.emplace_hint(iter, cache_key,
+                                  DecodeProgram(setup.program_code, setup.swizzle_data));
+    }
+    setup.engine_data.cached_shader = iter->second.get();
 }
 
 MICROPROFILE_DECLARE(GPU_Shader);
 
 void InterpreterEngine::Run(const ShaderSetup& setup, UnitState& state) const {
+    ASSERT(setup.engine_data.cached_shader != nullptr);
 
     MICROPROFILE_SCOPE(GPU_Shader);
 
-    DebugData<false> dummy_debug_data;
-    RunInterpreter(setup, state, dummy_debug_data, setup.engine_data.entry_point);
+    const auto* program = static_cast<const InterpreterProgram*>(setup.engine_data.cached_shader);
+    RunProgram(*program, setup, state, setup.engine_data.entry_point);
+}
+
+void InterpreterEngine::RunBatch(const ShaderSetup& setup, const ShaderRegs& config,
+                                 UnitState& state, const AttributeBuffer* inputs,
+                                 AttributeBuffer* outputs, std::size_t count) const {
+    ASSERT(setup.engine_data.cached_shader != nullptr);
+
+    MICROPROFILE_SCOPE(GPU_Shader);
+
+    const auto* program = static_cast<const InterpreterProgram*>(setup.engine_data.cached_shader);
+    for (std::size_t i = 0; i < count; ++i) {
+        state.LoadInput(config, inputs[i]);
+        RunProgram(*program, setup, state, setup.engine_data.entry_point);
+        state.WriteOutput(config, outputs[i]);
+    }
 }
 
 DebugData<true> InterpreterEngine::ProduceDebugInfo(const ShaderSetup& setup,
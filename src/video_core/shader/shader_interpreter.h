@@ -4,15 +4,26 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_map>
+#include "common/common_types.h"
 #include "video_core/shader/debug_data.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica::Shader {
 
+struct InterpreterProgram;
+
 class InterpreterEngine final : public ShaderEngine {
 public:
+    InterpreterEngine();
+    ~InterpreterEngine() override;
+
     void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
+    void RunBatch(const ShaderSetup& setup, const ShaderRegs& config, UnitState& state,
+                  const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                  std::size_t count) const override;
 
     /**
      * Produce debug information based on the given shader and input vertex
@@ -23,6 +34,10 @@ public:
      */
     DebugData<true> ProduceDebugInfo(const ShaderSetup& setup, const AttributeBuffer& input,
                                      const ShaderRegs& config) const;
+
+private:
+    /// Programs decoded with their swizzle patterns, by the hashes of both
+    std::unordered_map<u64, std::unique_ptr<InterpreterProgram>> cache;
 };
 
 } // namespace Pica::Shader
@@ -2,14 +2,36 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include "common/logging/log.h"
+#include "common/metrics.h"
 #include "common/microprofile.h"
+#include "core/settings.h"
 #include "video_core/shader/shader.h"
 #include "video_core/shader/shader_jit_x64.h"
 #include "video_core/shader/shader_jit_x64_compiler.h"
+#include "video_core/shader/shader_jit_x64_disk_cache.h"
+#include "video_core/video_core.h"
 
 namespace Pica::Shader {
 
-JitX64Engine::JitX64Engine() = default;
+static Common::Metrics::Counter cache_hits_metric{
+    "citra_shader_jit_cache_hits_total", "Shader setups finding their program compiled already"};
+static Common::Metrics::Counter compiles_metric{"citra_shader_jit_compiles_total",
+                                                "Programs compiled by the shader JIT"};
+static Common::Metrics::Counter disk_cache_loads_metric{
+    "citra_shader_jit_disk_cache_loads_total", "Shader JIT programs loaded from the disk cache"};
+static Common::Metrics::Gauge cache_size_metric{"citra_shader_jit_cache_bytes",
+                                                "Memory taken by the compiled shader programs"};
+
+JitX64Engine::JitX64Engine()
+    : cache_budget(static_cast<std::size_t>(Settings::values.shader_jit_cache_budget_mb) << 20),
+      compiler(std::make_unique<JitShader>()) {
+    if (VideoCore::g_use_disk_shader_cache) {
+        disk_cache = std::make_unique<JitDiskCache>();
+        stored_programs = disk_cache->Load();
+    }
+}
+
 JitX64Engine::~JitX64Engine() = default;
 
 void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
@@ -22,12 +44,59 @@ void JitX64Engine::SetupBatch(ShaderSetup& setup, unsigned int entry_point) {
     u64 cache_key = code_hash ^ swizzle_hash;
     auto iter = cache.find(cache_key);
     if (iter != cache.end()) {
-        setup.engine_data.cached_shader = iter->second.get();
-    } else {
-        auto shader = std::make_unique<JitShader>();
-        shader->Compile(&setup.program_code, &setup.swizzle_data);
-        setup.engine_data.cached_shader = shader.get();
-        cache.emplace_hint(iter, cache_key, std::move(shader));
+        lru.splice(lru.begin(), lru, iter->second.lru_position);
+        setup.engine_data.cached_shader = iter->second.shader.get();
+        cache_hits_metric.Add();
+        return;
+    }
+
+    bool loaded = false;
+    if (auto stored = stored_programs.find(cache_key); stored != stored_programs.end()) {
+        loaded = compiler->Deserialize(stored->second);
+        if (!loaded) {
+            LOG_WARNING(HW_GPU, "Discarding invalid stored shader JIT program {:016X}", cache_key);
+        }
+        stored_programs.erase(stored);
+    }
+
+    const std::vector<u8> blob = [&] {
+        if (loaded) {
+            disk_cache_loads_metric.Add();
+            return compiler->Serialize();
+        }
+        compiler->Compile(&setup.program_code, &setup.swizzle_data);
+        compiles_metric.Add();
+        std::vector<u8> compiled = compiler->Serialize();
+        if (disk_cache) {
+            disk_cache->Save(cache_key, compiled);
+        }
+        return compiled;
+    }();
+
+    auto shader = std::make_unique<JitShader>(compiler->getSize());
+    const bool copied = shader->Deserialize(blob);
+    ASSERT_MSG(copied, "Could not copy a compiled shader out of the compile buffer");
+
+    setup.engine_data.cached_shader = shader.get();
+    lru.push_front(cache_key);
+    const std::size_t size = sizeof(JitShader) + shader->getSize();
+    cache_size += size;
+    cache.emplace_hint(iter, cache_key, CacheEntry{std::move(shader), size, lru.begin()});
+    EvictPrograms();
+    cache_size_metric.Set(static_cast<s64>(cache_size));
+}
+
+void JitX64Engine::EvictPrograms() {
+    if (cache_budget == 0) {
+        return;
+    }
+    // The vertex and geometry shaders of the current draw are the two most recently setup, and
+    // must stay valid until they are setup again
+    while (cache_size > cache_budget && cache.size() > 2) {
+        const auto victim = cache.find(lru.back());
+        cache_size -= victim->second.size;
+        cache.erase(victim);
+        lru.pop_back();
     }
 }
 
@@ -42,4 +111,15 @@ void JitX64Engine::Run(const ShaderSetup& setup, UnitState& state) const {
     shader->Run(setup, state, setup.engine_data.entry_point);
 }
 
+void JitX64Engine::RunBatch(const ShaderSetup& setup, const ShaderRegs& config, UnitState& state,
+                            const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                            std::size_t count) const {
+    ASSERT(setup.engine_data.cached_shader != nullptr);
+
+    MICROPROFILE_SCOPE(GPU_Shader);
+
+    const JitShader* shader = static_cast<const JitShader*>(setup.engine_data.cached_shader);
+    shader->RunBatch(setup, state, setup.engine_data.entry_point, config, inputs, outputs, count);
+}
+
 } // namespace Pica::Shader
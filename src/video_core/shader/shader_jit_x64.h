@@ -4,13 +4,16 @@
 
 #pragma once
 
+#include <list>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 #include "common/common_types.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica::Shader {
 
+class JitDiskCache;
 class JitShader;
 
 class JitX64Engine final : public ShaderEngine {
@@ -20,9 +23,33 @@ public:
 
     void SetupBatch(ShaderSetup& setup, unsigned int entry_point) override;
     void Run(const ShaderSetup& setup, UnitState& state) const override;
+    void RunBatch(const ShaderSetup& setup, const ShaderRegs& config, UnitState& state,
+                  const AttributeBuffer* inputs, AttributeBuffer* outputs,
+                  std::size_t count) const override;
 
 private:
-    std::unordered_map<u64, std::unique_ptr<JitShader>> cache;
+    struct CacheEntry {
+        std::unique_ptr<JitShader> shader;
+        /// Memory the shader takes, its code buffer included
+        std::size_t size;
+        std::list<u64>::iterator lru_position;
+    };
+
+    /// Drops the least recently used programs until the cache fits in its budget
+    void EvictPrograms();
+
+    std::unordered_map<u64, CacheEntry> cache;
+    /// Keys of the cached programs, the most recently used first
+    std::list<u64> lru;
+    std::size_t cache_size = 0;
+    std::size_t cache_budget;
+
+    /// Programs are compiled in this buffer, then copied to one of the size they need
+    std::unique_ptr<JitShader> compiler;
+
+    /// Programs stored by a previous session that have not been needed yet
+    std::unordered_map<u64, std::vector<u8>> stored_programs;
+    std::unique_ptr<JitDiskCache> disk_cache;
 };
 
 } // namespace Pica::Shader
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <nihstro/shader_bytecode.h>
 #include <smmintrin.h>
 #include <xmmintrin.h>
@@ -162,11 +163,28 @@ static void LogCritical(const char* msg) {
     LOG_CRITICAL(HW_GPU, "{}", msg);
 }
 
+static void Emit(GSEmitter* emitter, Common::Vec4<float24> (*output)[16]) {
+    emitter->Emit(*output);
+}
+
 void JitShader::Compile_Assert(bool condition, const char* msg) {
     if (!condition) {
-        mov(ABI_PARAM1, reinterpret_cast<std::size_t>(msg));
-        CallFarFunction(*this, LogCritical);
+        Compile_LogCritical(msg);
+    }
+}
+
+void JitShader::Compile_LogCritical(const char* msg) {
+    // The message is embedded in the code buffer so that no host address ends up in the code
+    Label message, skip;
+    jmp(skip, T_NEAR);
+    L(message);
+    for (const char* c = msg; *c != '\0'; ++c) {
+        db(*c);
     }
+    db(0);
+    L(skip);
+    lea(ABI_PARAM1, ptr[rip + message]);
+    call(qword[rip + log_critical_slot]);
 }
 
 /**
@@ -777,10 +795,6 @@ void JitShader::Compile_JMP(Instruction instr) {
     }
 }
 
-static void Emit(GSEmitter* emitter, Common::Vec4<float24> (*output)[16]) {
-    emitter->Emit(*output);
-}
-
 void JitShader::Compile_EMIT(Instruction instr) {
     Label have_emitter, end;
     mov(rax, qword[STATE + offsetof(UnitState, emitter_ptr)]);
@@ -788,8 +802,7 @@ void JitShader::Compile_EMIT(Instruction instr) {
     jnz(have_emitter);
 
     ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
-    mov(ABI_PARAM1, reinterpret_cast<std::size_t>("Execute EMIT on VS"));
-    CallFarFunction(*this, LogCritical);
+    Compile_LogCritical("Execute EMIT on VS");
     ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
     jmp(end);
 
@@ -798,7 +811,7 @@ void JitShader::Compile_EMIT(Instruction instr) {
     mov(ABI_PARAM1, rax);
     mov(ABI_PARAM2, STATE);
     add(ABI_PARAM2, static_cast<Xbyak::uint32>(offsetof(UnitState, registers.output)));
-    CallFarFunction(*this, Emit);
+    call(qword[rip + emit_slot]);
     ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
     L(end);
 }
@@ -810,8 +823,7 @@ void JitShader::Compile_SETE(Instruction instr) {
     jnz(have_emitter);
 
     ABI_PushRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
-    mov(ABI_PARAM1, reinterpret_cast<std::size_t>("Execute SETEMIT on VS"));
-    CallFarFunction(*this, LogCritical);
+    Compile_LogCritical("Execute SETEMIT on VS");
     ABI_PopRegistersAndAdjustStack(*this, PersistentCallerSavedRegs(), 0);
     jmp(end);
 
@@ -889,6 +901,10 @@ void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_
     program_code = program_code_;
     swizzle_data = swizzle_data_;
 
+    // The buffer may already hold a program, as the engine compiles every program in the same one
+    reset();
+    CompilePrelude();
+
     // Reset flow control state
     program = (CompiledShader*)getCurr();
     program_counter = 0;
@@ -920,14 +936,10 @@ void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_
     mov(COND1, byte[STATE + offsetof(UnitState, conditional_code[1])]);
 
     // Used to set a register to one
-    static const __m128 one = {1.f, 1.f, 1.f, 1.f};
-    mov(rax, reinterpret_cast<std::size_t>(&one));
-    movaps(ONE, xword[rax]);
+    movaps(ONE, xword[rip + one_vector]);
 
     // Used to negate registers
-    static const __m128 neg = {-0.f, -0.f, -0.f, -0.f};
-    mov(rax, reinterpret_cast<std::size_t>(&neg));
-    movaps(NEGBIT, xword[rax]);
+    movaps(NEGBIT, xword[rip + negbit_vector]);
 
     // Jump to start of the shader program
     jmp(ABI_PARAM3);
@@ -943,15 +955,133 @@ void JitShader::Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_
 
     ready();
 
+    for (std::size_t i = 0; i < instruction_labels.size(); ++i) {
+        entry_points[i] = instruction_labels[i].getAddress();
+    }
+    log_critical_slot_offset = static_cast<u32>(log_critical_slot.getAddress() - getCode());
+    emit_slot_offset = static_cast<u32>(emit_slot.getAddress() - getCode());
+
     ASSERT_MSG(getSize() <= MAX_SHADER_SIZE, "Compiled a shader that exceeds the allocated size!");
     LOG_DEBUG(HW_GPU, "Compiled shader size={}", getSize());
 }
 
-JitShader::JitShader() : Xbyak::CodeGenerator(MAX_SHADER_SIZE) {
+namespace {
+/// Layout of the blob produced by JitShader::Serialize, followed by the code bytes and the
+/// entry point table
+struct SerializedShaderHeader {
+    u32 code_size;
+    u32 program_offset;
+    u32 log_critical_slot_offset;
+    u32 emit_slot_offset;
+    u32 num_entry_points;
+};
+
+struct SerializedEntryPoint {
+    u32 pica_offset;
+    u32 code_offset;
+};
+} // Anonymous namespace
+
+std::vector<u8> JitShader::Serialize() const {
+    const u8* code = getCode();
+
+    std::vector<SerializedEntryPoint> entries;
+    for (std::size_t i = 0; i < entry_points.size(); ++i) {
+        if (entry_points[i] != nullptr) {
+            entries.push_back({static_cast<u32>(i), static_cast<u32>(entry_points[i] - code)});
+        }
+    }
+
+    SerializedShaderHeader header;
+    header.code_size = static_cast<u32>(getSize());
+    header.program_offset = static_cast<u32>((const u8*)program - code);
+    header.log_critical_slot_offset = log_critical_slot_offset;
+    header.emit_slot_offset = emit_slot_offset;
+    header.num_entry_points = static_cast<u32>(entries.size());
+
+    std::vector<u8> blob(sizeof(header) + header.code_size +
+                         entries.size() * sizeof(SerializedEntryPoint));
+    u8* out = blob.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, code, header.code_size);
+    out += header.code_size;
+    std::memcpy(out, entries.data(), entries.size() * sizeof(SerializedEntryPoint));
+    return blob;
+}
+
+bool JitShader::Deserialize(const std::vector<u8>& blob) {
+    SerializedShaderHeader header;
+    if (blob.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, blob.data(), sizeof(header));
+
+    const std::size_t expected_size = sizeof(header) + std::size_t{header.code_size} +
+                                      std::size_t{header.num_entry_points} *
+                                          sizeof(SerializedEntryPoint);
+    if (blob.size() != expected_size || header.code_size > maxSize_ ||
+        header.program_offset >= header.code_size ||
+        header.log_critical_slot_offset + sizeof(u64) > header.code_size ||
+        header.emit_slot_offset + sizeof(u64) > header.code_size) {
+        return false;
+    }
+
+    // Host function addresses change between runs, so the slots are patched before the code is
+    // copied into the executable buffer.
+    std::vector<u8> code(blob.begin() + sizeof(header),
+                         blob.begin() + sizeof(header) + header.code_size);
+    const u64 log_critical_address = reinterpret_cast<u64>(&LogCritical);
+    const u64 emit_address = reinterpret_cast<u64>(&Emit);
+    std::memcpy(code.data() + header.log_critical_slot_offset, &log_critical_address,
+                sizeof(u64));
+    std::memcpy(code.data() + header.emit_slot_offset, &emit_address, sizeof(u64));
+
+    reset();
+    for (u8 byte : code) {
+        db(byte);
+    }
+    ready();
+
+    const u8* base = getCode();
+    program = (CompiledShader*)(base + header.program_offset);
+    log_critical_slot_offset = header.log_critical_slot_offset;
+    emit_slot_offset = header.emit_slot_offset;
+
+    entry_points.fill(nullptr);
+    const u8* entry_data = blob.data() + sizeof(header) + header.code_size;
+    for (u32 i = 0; i < header.num_entry_points; ++i) {
+        SerializedEntryPoint entry;
+        std::memcpy(&entry, entry_data + i * sizeof(entry), sizeof(entry));
+        if (entry.pica_offset >= entry_points.size() || entry.code_offset >= header.code_size) {
+            return false;
+        }
+        entry_points[entry.pica_offset] = base + entry.code_offset;
+    }
+    return true;
+}
+
+JitShader::JitShader(std::size_t code_size) : Xbyak::CodeGenerator(code_size) {
     CompilePrelude();
 }
 
 void JitShader::CompilePrelude() {
+    // Constants and host function pointers are kept in the code buffer and addressed relative to
+    // RIP, which keeps the generated code position independent.
+    align(16);
+    L(one_vector);
+    for (int i = 0; i < 4; ++i) {
+        dd(0x3f800000); // 1.0f
+    }
+    L(negbit_vector);
+    for (int i = 0; i < 4; ++i) {
+        dd(0x80000000); // -0.0f
+    }
+    L(log_critical_slot);
+    dq(reinterpret_cast<u64>(&LogCritical));
+    L(emit_slot);
+    dq(reinterpret_cast<u64>(&Emit));
+
     log2_subroutine = CompilePrelude_Log2();
     exp2_subroutine = CompilePrelude_Exp2();
 }
@@ -21,7 +21,7 @@ using nihstro::SwizzlePattern;
 
 namespace Pica::Shader {
 
-/// Memory allocated for each compiled shader
+/// Memory allocated for compiling a shader
 constexpr std::size_t MAX_SHADER_SIZE = MAX_PROGRAM_CODE_LENGTH * 64;
 
 /**
@@ -30,15 +30,47 @@ constexpr std::size_t MAX_SHADER_SIZE = MAX_PROGRAM_CODE_LENGTH * 64;
  */
 class JitShader : public Xbyak::CodeGenerator {
 public:
-    JitShader();
+    /**
+     * @param code_size Size of the code buffer, programs compiled into it must fit in it. A shader
+     *                  only holding a program loaded with Deserialize needs no more than its size.
+     */
+    explicit JitShader(std::size_t code_size = MAX_SHADER_SIZE);
 
     void Run(const ShaderSetup& setup, UnitState& state, unsigned offset) const {
-        program(&setup.uniforms, &state, instruction_labels[offset].getAddress());
+        program(&setup.uniforms, &state, entry_points[offset]);
+    }
+
+    /**
+     * Runs the program over a batch of vertices. The entry address is resolved once and the
+     * compiled code is invoked back to back, without going through the engine per vertex.
+     */
+    void RunBatch(const ShaderSetup& setup, UnitState& state, unsigned offset,
+                  const ShaderRegs& config, const AttributeBuffer* inputs,
+                  AttributeBuffer* outputs, std::size_t count) const {
+        const u8* start_addr = entry_points[offset];
+        for (std::size_t i = 0; i < count; ++i) {
+            state.LoadInput(config, inputs[i]);
+            program(&setup.uniforms, &state, start_addr);
+            state.WriteOutput(config, outputs[i]);
+        }
     }
 
     void Compile(const std::array<u32, MAX_PROGRAM_CODE_LENGTH>* program_code,
                  const std::array<u32, MAX_SWIZZLE_DATA_LENGTH>* swizzle_data);
 
+    /**
+     * Serializes the compiled program. The generated code only refers to host memory through
+     * a few patchable slots, so the result can be stored and reloaded in a later session.
+     */
+    std::vector<u8> Serialize() const;
+
+    /**
+     * Replaces the contents of this shader with a program produced by Serialize.
+     * @returns false if the data is malformed or doesn't fit in the code buffer, in which case the
+     *          shader must not be run.
+     */
+    bool Deserialize(const std::vector<u8>& blob);
+
     void Compile_ADD(Instruction instr);
     void Compile_DP3(Instruction instr);
     void Compile_DP4(Instruction instr);
@@ -100,6 +132,9 @@ private:
      */
     void Compile_Assert(bool condition, const char* msg);
 
+    /// Emits a call logging the given message as critical. The string is copied into the code.
+    void Compile_LogCritical(const char* msg);
+
     /**
      * Analyzes the entire shader program for `CALL` instructions before emitting any code,
      * identifying the locations where a return needs to be inserted.
@@ -119,6 +154,9 @@ private:
     /// Mapping of Pica VS instructions to pointers in the emitted code
     std::array<Xbyak::Label, MAX_PROGRAM_CODE_LENGTH> instruction_labels;
 
+    /// Resolved addresses of instruction_labels, filled once the code is ready
+    std::array<const u8*, MAX_PROGRAM_CODE_LENGTH> entry_points{};
+
     /// Label pointing to the end of the current LOOP block. Used by the BREAKC instruction to break
     /// out of the loop.
     std::optional<Xbyak::Label> loop_break_label;
@@ -134,6 +172,13 @@ private:
 
     Xbyak::Label log2_subroutine;
     Xbyak::Label exp2_subroutine;
+
+    Xbyak::Label one_vector;
+    Xbyak::Label negbit_vector;
+    Xbyak::Label log_critical_slot;
+    Xbyak::Label emit_slot;
+    u32 log_critical_slot_offset = 0;
+    u32 emit_slot_offset = 0;
 };
 
 } // namespace Pica::Shader
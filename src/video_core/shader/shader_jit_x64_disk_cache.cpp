@@ -0,0 +1,137 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstring>
+#include <fmt/format.h>
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/x64/cpu_detect.h"
+#include "core/core.h"
+#include "core/loader/loader.h"
+#include "video_core/shader/shader_jit_x64_compiler.h"
+#include "video_core/shader/shader_jit_x64_disk_cache.h"
+
+namespace Pica::Shader {
+
+constexpr u32 JIT_CACHE_MAGIC = 0x54494A43; // "CJIT"
+constexpr u32 JIT_CACHE_VERSION = 1;
+
+/// Upper bound for a single serialized program, used to reject corrupted entries early
+constexpr u32 MAX_ENTRY_SIZE = static_cast<u32>(MAX_SHADER_SIZE + MAX_PROGRAM_CODE_LENGTH * 16);
+
+struct JitCacheHeader {
+    u32 magic;
+    u32 version;
+    /// Generated code differs depending on the instruction set extensions it was compiled for
+    u32 host_features;
+    /// Build that produced the code, since host function addresses and layouts change with it
+    std::array<char, 64> build;
+};
+
+static JitCacheHeader MakeHeader() {
+    JitCacheHeader header{};
+    header.magic = JIT_CACHE_MAGIC;
+    header.version = JIT_CACHE_VERSION;
+    header.host_features = Common::GetCPUCaps().sse4_1 ? 1 : 0;
+    std::strncpy(header.build.data(), Common::g_scm_rev, header.build.size() - 1);
+    return header;
+}
+
+JitDiskCache::JitDiskCache() {
+    u64 program_id = 0;
+    if (Core::System::GetInstance().GetAppLoader().ReadProgramId(program_id) !=
+            Loader::ResultStatus::Success ||
+        program_id == 0) {
+        return;
+    }
+
+    const std::string dir =
+        FileUtil::GetUserPath(FileUtil::UserPath::ShaderDir) + DIR_SEP "shader_jit_x64";
+    if (!FileUtil::CreateFullPath(dir + DIR_SEP)) {
+        LOG_ERROR(HW_GPU, "Failed to create directory={}", dir);
+        return;
+    }
+    path = FileUtil::SanitizePath(fmt::format("{}{}{:016X}.bin", dir, DIR_SEP, program_id));
+}
+
+JitProgramMap JitDiskCache::Load() {
+    JitProgramMap programs;
+    if (!IsUsable()) {
+        return programs;
+    }
+
+    FileUtil::IOFile file(path, "rb");
+    if (!file.IsOpen()) {
+        return programs;
+    }
+
+    const JitCacheHeader expected = MakeHeader();
+    JitCacheHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        LOG_INFO(HW_GPU, "Shader JIT cache is outdated - removing");
+        file.Close();
+        Invalidate();
+        return programs;
+    }
+
+    while (file.Tell() < file.GetSize()) {
+        u64 key;
+        u32 size;
+        if (file.ReadBytes(&key, sizeof(key)) != sizeof(key) ||
+            file.ReadBytes(&size, sizeof(size)) != sizeof(size) || size > MAX_ENTRY_SIZE) {
+            LOG_ERROR(HW_GPU, "Failed to read shader JIT cache - removing");
+            file.Close();
+            Invalidate();
+            return {};
+        }
+        std::vector<u8> blob(size);
+        if (file.ReadBytes(blob.data(), size) != size) {
+            LOG_ERROR(HW_GPU, "Failed to read shader JIT cache - removing");
+            file.Close();
+            Invalidate();
+            return {};
+        }
+        programs.insert_or_assign(key, std::move(blob));
+    }
+
+    LOG_INFO(HW_GPU, "Loaded {} programs from the shader JIT cache", programs.size());
+    return programs;
+}
+
+void JitDiskCache::Save(u64 key, const std::vector<u8>& blob) {
+    if (!IsUsable()) {
+        return;
+    }
+
+    const bool existed = FileUtil::Exists(path);
+    FileUtil::IOFile file(path, "ab");
+    if (!file.IsOpen()) {
+        LOG_ERROR(HW_GPU, "Failed to open shader JIT cache in path={}", path);
+        return;
+    }
+    if (!existed || file.GetSize() == 0) {
+        if (file.WriteObject(MakeHeader()) != 1) {
+            LOG_ERROR(HW_GPU, "Failed to write shader JIT cache header in path={}", path);
+            return;
+        }
+    }
+
+    const u32 size = static_cast<u32>(blob.size());
+    if (file.WriteObject(key) != 1 || file.WriteObject(size) != 1 ||
+        file.WriteBytes(blob.data(), blob.size()) != blob.size()) {
+        LOG_ERROR(HW_GPU, "Failed to write shader JIT cache entry in path={}", path);
+    }
+}
+
+void JitDiskCache::Invalidate() {
+    if (!FileUtil::Delete(path)) {
+        LOG_ERROR(HW_GPU, "Failed to invalidate shader JIT cache file={}", path);
+    }
+}
+
+} // namespace Pica::Shader
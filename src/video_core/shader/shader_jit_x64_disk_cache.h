@@ -0,0 +1,44 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Pica::Shader {
+
+/// Serialized JIT programs of the current title, keyed by their program/swizzle hash
+using JitProgramMap = std::unordered_map<u64, std::vector<u8>>;
+
+/**
+ * Stores the machine code generated by the x64 shader JIT for the running title in the user's
+ * shader directory, next to the OpenGL shader disk cache. The file is tied to the exact build and
+ * host CPU features that produced it and is discarded when either changes.
+ */
+class JitDiskCache {
+public:
+    JitDiskCache();
+
+    /// Returns whether the cache has a file to work with, i.e. the title has a program id
+    bool IsUsable() const {
+        return !path.empty();
+    }
+
+    /// Loads every program stored for the current title. Deletes the file if it is invalid.
+    JitProgramMap Load();
+
+    /// Appends a freshly compiled program to the file
+    void Save(u64 key, const std::vector<u8>& blob);
+
+private:
+    /// Removes the cache file of the current title
+    void Invalidate();
+
+    std::string path;
+};
+
+} // namespace Pica::Shader
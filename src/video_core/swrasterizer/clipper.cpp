@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <optional>
 #include <boost/container/static_vector.hpp>
 #include "common/bit_field.h"
 #include "common/common_types.h"
@@ -16,6 +17,10 @@
 #include "video_core/swrasterizer/clipper.h"
 #include "video_core/swrasterizer/rasterizer.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include <xmmintrin.h>
+#endif
+
 using Pica::Rasterizer::Vertex;
 
 namespace Pica::Clipper {
@@ -84,9 +89,160 @@ static void InitScreenCoordinates(Vertex& vtx) {
     vtx.screenpos[2] = vtx.pos.z * inv_w;
 }
 
+/// Bits of the outcodes, set for the clipping planes a vertex is outside of
+enum OutcodeBits : u32 {
+    OutsidePosX = 1 << 0,
+    OutsideNegX = 1 << 1,
+    OutsidePosY = 1 << 2,
+    OutsideNegY = 1 << 3,
+    OutsideNear = 1 << 4,
+    OutsideFar = 1 << 5,
+    OutsideW = 1 << 6,
+    OutsideCustom = 1 << 7,
+
+    /// Planes of the viewport edges, which the rasterizer can handle within the guard band
+    OutsideViewport = OutsidePosX | OutsideNegX | OutsidePosY | OutsideNegY,
+};
+
+// NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
+// TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
+//       epsilon possible within float24 accuracy.
+static const float24 EPSILON = float24::FromFloat32(0.00001f);
+
+/**
+ * Size in pixels of the guard band, the screen region the vertices of the triangles left unclipped
+ * against the viewport edges must lie in. Within it the 12.4 fixed-point coordinates and the edge
+ * functions of the rasterizer can't overflow.
+ */
+constexpr float GuardBandSize = 1024.0f;
+
+/**
+ * Computes the outcode of a vertex against the planes of the clipping edges in ProcessTriangle,
+ * each bit matching the result of ClippingEdge::IsOutSide.
+ */
+static u32 GetOutcode(const Vertex& vertex, const ClippingEdge* custom_edge) {
+    u32 outcode = 0;
+#ifdef ARCHITECTURE_x86_64
+    // Same sums as the dot products with the plane coefficients, without the terms multiplied by
+    // 0. These only matter for NaN, which makes every dot product NaN, while 0 * inf is 0.
+    const __m128 pos = _mm_setr_ps(vertex.pos.x.ToFloat32(), vertex.pos.y.ToFloat32(),
+                                   vertex.pos.z.ToFloat32(), vertex.pos.w.ToFloat32());
+    const __m128 sign_mask = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    // (w - x, w + x, w - y, w + y)
+    const __m128 viewport_distances =
+        _mm_add_ps(_mm_shuffle_ps(pos, pos, _MM_SHUFFLE(3, 3, 3, 3)),
+                   _mm_xor_ps(_mm_shuffle_ps(pos, pos, _MM_SHUFFLE(1, 1, 0, 0)), sign_mask));
+    // (-z, z + w, w + EPSILON), the last lane is unused
+    const __m128 depth_distances =
+        _mm_add_ps(_mm_xor_ps(_mm_shuffle_ps(pos, pos, _MM_SHUFFLE(0, 3, 2, 2)),
+                              _mm_setr_ps(-0.0f, 0.0f, 0.0f, 0.0f)),
+                   _mm_setr_ps(0.0f, vertex.pos.w.ToFloat32(), EPSILON.ToFloat32(), 0.0f));
+    const __m128 zero = _mm_setzero_ps();
+    if (_mm_movemask_ps(_mm_cmpunord_ps(pos, pos)) != 0) {
+        outcode = OutsideViewport | OutsideNear | OutsideFar | OutsideW;
+    } else {
+        outcode =
+            static_cast<u32>(_mm_movemask_ps(_mm_cmpnge_ps(viewport_distances, zero))) |
+            static_cast<u32>(_mm_movemask_ps(_mm_cmpnge_ps(depth_distances, zero)) & 0x7) << 4;
+    }
+#else
+    static const float24 f0 = float24::FromFloat32(0.0);
+    static const float24 f1 = float24::FromFloat32(1.0);
+    static const std::array<ClippingEdge, 7> edges = {{
+        {Common::MakeVec(-f1, f0, f0, f1)},
+        {Common::MakeVec(f1, f0, f0, f1)},
+        {Common::MakeVec(f0, -f1, f0, f1)},
+        {Common::MakeVec(f0, f1, f0, f1)},
+        {Common::MakeVec(f0, f0, -f1, f0)},
+        {Common::MakeVec(f0, f0, f1, f1)},
+        {Common::MakeVec(f0, f0, f0, f1), Common::Vec4<float24>(f0, f0, f0, EPSILON)},
+    }};
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        if (edges[i].IsOutSide(vertex)) {
+            outcode |= 1u << i;
+        }
+    }
+#endif
+    if (custom_edge != nullptr && custom_edge->IsOutSide(vertex)) {
+        outcode |= OutsideCustom;
+    }
+    return outcode;
+}
+
+/// Whether the screen position of the vertex, from InitScreenCoordinates, lies in the guard band
+static bool IsInGuardBand(const Vertex& vtx) {
+    // Written so that NaN fails
+    auto InRange = [](float24 coord) {
+        return coord.ToFloat32() >= 0.0f && coord.ToFloat32() < GuardBandSize;
+    };
+    // Vertices behind the eye would be projected mirrored, w is inverted at this point
+    return vtx.pos.w > float24::Zero() && InRange(vtx.screenpos.x) && InRange(vtx.screenpos.y);
+}
+
+static void EmitTriangle(std::size_t index, std::size_t count, const Vertex& vtx0,
+                         const Vertex& vtx1, const Vertex& vtx2, const TriangleHandler& handler) {
+    LOG_TRACE(Render_Software,
+              "Triangle {}/{} at position ({:.3}, {:.3}, {:.3}, {:.3f}), "
+              "({:.3}, {:.3}, {:.3}, {:.3}), ({:.3}, {:.3}, {:.3}, {:.3}) and "
+              "screen position ({:.2}, {:.2}, {:.2}), ({:.2}, {:.2}, {:.2}), ({:.2}, {:.2}, {:.2})",
+              index + 1, count, vtx0.pos.x.ToFloat32(), vtx0.pos.y.ToFloat32(),
+              vtx0.pos.z.ToFloat32(), vtx0.pos.w.ToFloat32(), vtx1.pos.x.ToFloat32(),
+              vtx1.pos.y.ToFloat32(), vtx1.pos.z.ToFloat32(), vtx1.pos.w.ToFloat32(),
+              vtx2.pos.x.ToFloat32(), vtx2.pos.y.ToFloat32(), vtx2.pos.z.ToFloat32(),
+              vtx2.pos.w.ToFloat32(), vtx0.screenpos.x.ToFloat32(), vtx0.screenpos.y.ToFloat32(),
+              vtx0.screenpos.z.ToFloat32(), vtx1.screenpos.x.ToFloat32(),
+              vtx1.screenpos.y.ToFloat32(), vtx1.screenpos.z.ToFloat32(),
+              vtx2.screenpos.x.ToFloat32(), vtx2.screenpos.y.ToFloat32(),
+              vtx2.screenpos.z.ToFloat32());
+
+    handler(vtx0, vtx1, vtx2);
+}
+
 void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+    ProcessTriangle(v0, v1, v2, [](const Vertex& vtx0, const Vertex& vtx1, const Vertex& vtx2) {
+        Rasterizer::ProcessTriangle(vtx0, vtx1, vtx2);
+    });
+}
+
+void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2,
+                     const TriangleHandler& handler) {
     using boost::container::static_vector;
 
+    std::optional<ClippingEdge> custom_edge;
+    if (g_state.regs.rasterizer.clip_enable) {
+        custom_edge.emplace(g_state.regs.rasterizer.GetClipCoef());
+    }
+
+    auto FlipQuaternionIfOpposite = [](auto& a, const auto& b) {
+        if (Common::Dot(a, b) < float24::Zero())
+            a = a * float24::FromFloat32(-1.0f);
+    };
+
+    // Most triangles are either wholly inside or wholly outside of one of the planes, which the
+    // outcodes tell without clipping. Triangles only crossing the viewport edges are left to the
+    // rasterizer, which doesn't draw outside of the viewport, while their vertices stay in the
+    // guard band. Either way the result is the same as clipping them.
+    const ClippingEdge* custom_edge_ptr = custom_edge ? &*custom_edge : nullptr;
+    const u32 outcode0 = GetOutcode(v0, custom_edge_ptr);
+    const u32 outcode1 = GetOutcode(v1, custom_edge_ptr);
+    const u32 outcode2 = GetOutcode(v2, custom_edge_ptr);
+    if ((outcode0 & outcode1 & outcode2) != 0) {
+        return;
+    }
+    const u32 crossed_planes = outcode0 | outcode1 | outcode2;
+    if ((crossed_planes & ~OutsideViewport) == 0) {
+        std::array<Vertex, 3> vertices{v0, v1, v2};
+        FlipQuaternionIfOpposite(vertices[1].quat, vertices[0].quat);
+        FlipQuaternionIfOpposite(vertices[2].quat, vertices[0].quat);
+        for (auto& vertex : vertices) {
+            InitScreenCoordinates(vertex);
+        }
+        if (crossed_planes == 0 || std::all_of(vertices.begin(), vertices.end(), IsInGuardBand)) {
+            EmitTriangle(0, 1, vertices[0], vertices[1], vertices[2], handler);
+            return;
+        }
+    }
+
     // Clipping a planar n-gon against a plane will remove at least 1 vertex and introduces 2 at
     // the new edge (or less in degenerate cases). As such, we can say that each clipping plane
     // introduces at most 1 new vertex to the polygon. Since we start with a triangle and have a
@@ -95,11 +251,6 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
     static_vector<Vertex, MAX_VERTICES> buffer_a = {v0, v1, v2};
     static_vector<Vertex, MAX_VERTICES> buffer_b;
 
-    auto FlipQuaternionIfOpposite = [](auto& a, const auto& b) {
-        if (Common::Dot(a, b) < float24::Zero())
-            a = a * float24::FromFloat32(-1.0f);
-    };
-
     // Flip the quaternions if they are opposite to prevent interpolating them over the wrong
     // direction.
     FlipQuaternionIfOpposite(buffer_a[1].quat, buffer_a[0].quat);
@@ -108,10 +259,6 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
     auto* output_list = &buffer_a;
     auto* input_list = &buffer_b;
 
-    // NOTE: We clip against a w=epsilon plane to guarantee that the output has a positive w value.
-    // TODO: Not sure if this is a valid approach. Also should probably instead use the smallest
-    //       epsilon possible within float24 accuracy.
-    static const float24 EPSILON = float24::FromFloat32(0.00001f);
     static const float24 f0 = float24::FromFloat32(0.0);
     static const float24 f1 = float24::FromFloat32(1.0);
     static const std::array<ClippingEdge, 7> clipping_edges = {{
@@ -156,9 +303,8 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
             return;
     }
 
-    if (g_state.regs.rasterizer.clip_enable) {
-        ClippingEdge custom_edge{g_state.regs.rasterizer.GetClipCoef()};
-        Clip(custom_edge);
+    if (custom_edge) {
+        Clip(*custom_edge);
 
         if (output_list->size() < 3)
             return;
@@ -174,22 +320,7 @@ void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const Outpu
 
         InitScreenCoordinates(vtx2);
 
-        LOG_TRACE(
-            Render_Software,
-            "Triangle {}/{} at position ({:.3}, {:.3}, {:.3}, {:.3f}), "
-            "({:.3}, {:.3}, {:.3}, {:.3}), ({:.3}, {:.3}, {:.3}, {:.3}) and "
-            "screen position ({:.2}, {:.2}, {:.2}), ({:.2}, {:.2}, {:.2}), ({:.2}, {:.2}, {:.2})",
-            i + 1, output_list->size() - 2, vtx0.pos.x.ToFloat32(), vtx0.pos.y.ToFloat32(),
-            vtx0.pos.z.ToFloat32(), vtx0.pos.w.ToFloat32(), vtx1.pos.x.ToFloat32(),
-            vtx1.pos.y.ToFloat32(), vtx1.pos.z.ToFloat32(), vtx1.pos.w.ToFloat32(),
-            vtx2.pos.x.ToFloat32(), vtx2.pos.y.ToFloat32(), vtx2.pos.z.ToFloat32(),
-            vtx2.pos.w.ToFloat32(), vtx0.screenpos.x.ToFloat32(), vtx0.screenpos.y.ToFloat32(),
-            vtx0.screenpos.z.ToFloat32(), vtx1.screenpos.x.ToFloat32(),
-            vtx1.screenpos.y.ToFloat32(), vtx1.screenpos.z.ToFloat32(),
-            vtx2.screenpos.x.ToFloat32(), vtx2.screenpos.y.ToFloat32(),
-            vtx2.screenpos.z.ToFloat32());
-
-        Rasterizer::ProcessTriangle(vtx0, vtx1, vtx2);
+        EmitTriangle(i, output_list->size() - 2, vtx0, vtx1, vtx2, handler);
     }
 }
 
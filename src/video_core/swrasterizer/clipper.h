@@ -4,16 +4,32 @@
 
 #pragma once
 
+#include <functional>
+
 namespace Pica {
 namespace Shader {
 struct OutputVertex;
 }
 
+namespace Rasterizer {
+struct Vertex;
+}
+
 namespace Clipper {
 
 using Shader::OutputVertex;
 
+/// Receives the screen-space triangles produced by clipping
+using TriangleHandler = std::function<void(const Rasterizer::Vertex& v0,
+                                           const Rasterizer::Vertex& v1,
+                                           const Rasterizer::Vertex& v2)>;
+
+/// Clips the triangle and immediately rasterizes the resulting triangles
 void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2);
 
+/// Clips the triangle and passes the resulting triangles to the given handler
+void ProcessTriangle(const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2,
+                     const TriangleHandler& handler);
+
 } // namespace Clipper
 } // namespace Pica
@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include "common/assert.h"
 #include "common/color.h"
 #include "common/common_types.h"
@@ -18,6 +19,25 @@
 
 namespace Pica::Rasterizer {
 
+namespace {
+/// Bounds of the depth values of a block of the depth buffer
+struct DepthBlock {
+    /// Generation of the bounds they were computed in, stale if not the current one
+    u32 generation = 0;
+    DepthBounds bounds;
+};
+
+/// Rasterizer coordinates are 12.4 fixed point, so 4096 pixels cover them all
+constexpr int DepthBlocksPerAxis = 4096 / DepthBlockSize;
+
+std::array<DepthBlock, DepthBlocksPerAxis * DepthBlocksPerAxis> depth_blocks;
+u32 depth_bounds_generation = 1;
+
+DepthBlock& GetDepthBlock(int x, int y) {
+    return depth_blocks[(y / DepthBlockSize) * DepthBlocksPerAxis + x / DepthBlockSize];
+}
+} // Anonymous namespace
+
 void DrawPixel(int x, int y, const Common::Vec4<u8>& color) {
     const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
     const PAddr addr = framebuffer.GetColorBufferPhysicalAddress();
@@ -156,6 +176,12 @@ u8 GetStencil(int x, int y) {
 }
 
 void SetDepth(int x, int y, u32 value) {
+    DepthBlock& block = GetDepthBlock(x, y);
+    if (block.generation == depth_bounds_generation) {
+        block.bounds.min = std::min(block.bounds.min, value);
+        block.bounds.max = std::max(block.bounds.max, value);
+    }
+
     const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
     const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
     u8* depth_buffer = VideoCore::g_memory->GetPhysicalPointer(addr);
@@ -190,6 +216,38 @@ void SetDepth(int x, int y, u32 value) {
     }
 }
 
+std::optional<DepthBounds> GetDepthBlockBounds(int x, int y) {
+    DepthBlock& block = GetDepthBlock(x, y);
+    if (block.generation == depth_bounds_generation) {
+        return block.bounds;
+    }
+
+    // Blocks reaching out of the buffer are left without bounds, they aren't all in memory
+    const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
+    const int left = x & ~(DepthBlockSize - 1);
+    const int top = y & ~(DepthBlockSize - 1);
+    if (left + DepthBlockSize > static_cast<int>(framebuffer.GetWidth()) ||
+        top + DepthBlockSize > static_cast<int>(framebuffer.GetHeight())) {
+        return std::nullopt;
+    }
+
+    DepthBounds bounds{0xFFFFFFFF, 0};
+    for (int pixel_y = top; pixel_y < top + DepthBlockSize; ++pixel_y) {
+        for (int pixel_x = left; pixel_x < left + DepthBlockSize; ++pixel_x) {
+            const u32 depth = GetDepth(pixel_x, pixel_y);
+            bounds.min = std::min(bounds.min, depth);
+            bounds.max = std::max(bounds.max, depth);
+        }
+    }
+    block.generation = depth_bounds_generation;
+    block.bounds = bounds;
+    return bounds;
+}
+
+void InvalidateDepthBounds() {
+    ++depth_bounds_generation;
+}
+
 void SetStencil(int x, int y, u8 value) {
     const auto& framebuffer = g_state.regs.framebuffer.framebuffer;
     const PAddr addr = framebuffer.GetDepthBufferPhysicalAddress();
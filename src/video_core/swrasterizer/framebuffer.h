@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <optional>
 #include "common/common_types.h"
 #include "common/vector_math.h"
 #include "video_core/regs_framebuffer.h"
@@ -16,6 +17,25 @@ u32 GetDepth(int x, int y);
 u8 GetStencil(int x, int y);
 void SetDepth(int x, int y, u32 value);
 void SetStencil(int x, int y, u8 value);
+
+/// Width and height in pixels of the blocks of the depth bounds
+constexpr int DepthBlockSize = 8;
+
+/// Range of the depth values of a block of the depth buffer
+struct DepthBounds {
+    u32 min;
+    u32 max;
+};
+
+/**
+ * Returns bounds of the depth values of the block containing the pixel, read from the depth
+ * buffer the first time and then kept up to date by SetDepth. The bounds are conservative, they
+ * only ever widen until InvalidateDepthBounds. Empty if the block reaches out of the buffer.
+ */
+std::optional<DepthBounds> GetDepthBlockBounds(int x, int y);
+
+/// Drops the depth bounds of every block, for when the depth buffer may change outside SetDepth
+void InvalidateDepthBounds();
 u8 PerformStencilAction(FramebufferRegs::StencilAction action, u8 old_stencil, u8 ref);
 
 Common::Vec4<u8> EvaluateBlendEquation(const Common::Vec4<u8>& src,
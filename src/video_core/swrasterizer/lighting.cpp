@@ -7,21 +7,47 @@
 
 namespace Pica {
 
-static float LookupLightingLut(const Pica::State::Lighting& lighting, std::size_t lut_index,
-                               u8 index, float delta) {
-    ASSERT_MSG(lut_index < lighting.luts.size(), "Out of range lut");
-    ASSERT_MSG(index < lighting.luts[lut_index].size(), "Out of range index");
+void LightingTables::UpdateLights(const LightingRegs& lighting) {
+    for (std::size_t num = 0; num < lights.size(); ++num) {
+        const auto& light_config = lighting.light[num];
+        Light& light = lights[num];
+        light.position = {float16::FromRaw(light_config.x).ToFloat32(),
+                          float16::FromRaw(light_config.y).ToFloat32(),
+                          float16::FromRaw(light_config.z).ToFloat32()};
+        light.spot_direction =
+            Common::Vec3<s32>{light_config.spot_x.Value(), light_config.spot_y.Value(),
+                              light_config.spot_z.Value()}
+                .Cast<float>() /
+            2047.0f;
+        light.dist_atten_scale = float20::FromRaw(light_config.dist_atten_scale).ToFloat32();
+        light.dist_atten_bias = float20::FromRaw(light_config.dist_atten_bias).ToFloat32();
+        light.specular_0 = light_config.specular_0.ToVec3f();
+        light.specular_1 = light_config.specular_1.ToVec3f();
+        light.diffuse = light_config.diffuse.ToVec3f();
+        light.ambient = light_config.ambient.ToVec3f();
+    }
+    global_ambient = lighting.global_ambient.ToVec3f();
+}
 
-    const auto& lut = lighting.luts[lut_index][index];
+void LightingTables::UpdateLuts(const State::Lighting& lighting_state) {
+    for (std::size_t lut_index = 0; lut_index < luts.size(); ++lut_index) {
+        for (std::size_t index = 0; index < luts[lut_index].size(); ++index) {
+            const auto& lut = lighting_state.luts[lut_index][index];
+            luts[lut_index][index] = {lut.ToFloat(), lut.DiffToFloat()};
+        }
+    }
+}
 
-    float lut_value = lut.ToFloat();
-    float lut_diff = lut.DiffToFloat();
+static float LookupLightingLut(const LightingTables& tables, std::size_t lut_index, u8 index,
+                               float delta) {
+    ASSERT_MSG(lut_index < tables.luts.size(), "Out of range lut");
 
-    return lut_value + lut_diff * delta;
+    const auto& lut = tables.luts[lut_index][index];
+    return lut.value + lut.diff * delta;
 }
 
 std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
-    const Pica::LightingRegs& lighting, const Pica::State::Lighting& lighting_state,
+    const Pica::LightingRegs& lighting, const LightingTables& tables,
     const Common::Quaternion<float>& normquat, const Common::Vec3<float>& view,
     const Common::Vec4<u8> (&texture_color)[4]) {
 
@@ -71,11 +97,10 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
     for (unsigned light_index = 0; light_index <= lighting.max_light_index; ++light_index) {
         unsigned num = lighting.light_enable.GetNum(light_index);
         const auto& light_config = lighting.light[num];
+        const auto& light = tables.lights[num];
 
         Common::Vec3<float> refl_value = {};
-        Common::Vec3<float> position = {float16::FromRaw(light_config.x).ToFloat32(),
-                                        float16::FromRaw(light_config.y).ToFloat32(),
-                                        float16::FromRaw(light_config.z).ToFloat32()};
+        const Common::Vec3<float>& position = light.position;
         Common::Vec3<float> light_vector;
 
         if (light_config.config.directional)
@@ -91,8 +116,8 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
         float dist_atten = 1.0f;
         if (!lighting.IsDistAttenDisabled(num)) {
             auto distance = (-view - position).Length();
-            float scale = Pica::float20::FromRaw(light_config.dist_atten_scale).ToFloat32();
-            float bias = Pica::float20::FromRaw(light_config.dist_atten_bias).ToFloat32();
+            float scale = light.dist_atten_scale;
+            float bias = light.dist_atten_bias;
             std::size_t lut =
                 static_cast<std::size_t>(LightingRegs::LightingSampler::DistanceAttenuation) + num;
 
@@ -101,7 +126,7 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
             u8 lutindex =
                 static_cast<u8>(std::clamp(std::floor(sample_loc * 256.0f), 0.0f, 255.0f));
             float delta = sample_loc * 256 - lutindex;
-            dist_atten = LookupLightingLut(lighting_state, lut, lutindex, delta);
+            dist_atten = LookupLightingLut(tables, lut, lutindex, delta);
         }
 
         auto GetLutValue = [&](LightingRegs::LightingLutInput input, bool abs,
@@ -126,12 +151,10 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
                 result = Common::Dot(light_vector, normal);
                 break;
 
-            case LightingRegs::LightingLutInput::SP: {
-                Common::Vec3<s32> spot_dir{light_config.spot_x.Value(), light_config.spot_y.Value(),
-                                           light_config.spot_z.Value()};
-                result = Common::Dot(light_vector, spot_dir.Cast<float>() / 2047.0f);
+            case LightingRegs::LightingLutInput::SP:
+                result = Common::Dot(light_vector, light.spot_direction);
                 break;
-            }
+
             case LightingRegs::LightingLutInput::CP:
                 if (lighting.config0.config == LightingRegs::LightingConfig::Config7) {
                     const Common::Vec3<float> norm_half_vector = half_vector.Normalized();
@@ -168,8 +191,8 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
             }
 
             float scale = lighting.lut_scale.GetScale(scale_enum);
-            return scale * LookupLightingLut(lighting_state, static_cast<std::size_t>(sampler),
-                                             index, delta);
+            return scale *
+                   LookupLightingLut(tables, static_cast<std::size_t>(sampler), index, delta);
         };
 
         // If enabled, compute spot light attenuation value
@@ -192,7 +215,7 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
                             lighting.lut_scale.d0, LightingRegs::LightingSampler::Distribution0);
         }
 
-        Common::Vec3<float> specular_0 = d0_lut_value * light_config.specular_0.ToVec3f();
+        Common::Vec3<float> specular_0 = d0_lut_value * light.specular_0;
 
         // If enabled, lookup ReflectRed value, otherwise, 1.0 is used
         if (lighting.config1.disable_lut_rr == 0 &&
@@ -238,7 +261,7 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
         }
 
         Common::Vec3<float> specular_1 =
-            d1_lut_value * refl_value * light_config.specular_1.ToVec3f();
+            d1_lut_value * refl_value * light.specular_1;
 
         // Fresnel
         // Note: only the last entry in the light slots applies the Fresnel factor
@@ -283,9 +306,7 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
             }
         }
 
-        auto diffuse =
-            (light_config.diffuse.ToVec3f() * dot_product + light_config.ambient.ToVec3f()) *
-            dist_atten * spot_atten;
+        auto diffuse = (light.diffuse * dot_product + light.ambient) * dist_atten * spot_atten;
         auto specular = (specular_0 + specular_1) * clamp_highlights * dist_atten * spot_atten;
 
         if (!lighting.IsShadowDisabled(num)) {
@@ -314,7 +335,7 @@ std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
         }
     }
 
-    diffuse_sum += Common::MakeVec(lighting.global_ambient.ToVec3f(), 0.0f);
+    diffuse_sum += Common::MakeVec(tables.global_ambient, 0.0f);
 
     auto diffuse = Common::MakeVec<float>(std::clamp(diffuse_sum.x, 0.0f, 1.0f) * 255,
                                           std::clamp(diffuse_sum.y, 0.0f, 1.0f) * 255,
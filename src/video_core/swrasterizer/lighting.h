@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <tuple>
 #include "common/quaternion.h"
 #include "common/vector_math.h"
@@ -11,8 +12,38 @@
 
 namespace Pica {
 
+/**
+ * The lighting LUTs and the light parameters decoded to floats, once instead of for every fragment
+ * and light. They have to be updated whenever the lighting registers, respectively the LUTs,
+ * change.
+ */
+struct LightingTables {
+    struct LutEntry {
+        float value;
+        float diff;
+    };
+
+    struct Light {
+        Common::Vec3<float> position;
+        Common::Vec3<float> spot_direction;
+        float dist_atten_scale;
+        float dist_atten_bias;
+        Common::Vec3<float> specular_0;
+        Common::Vec3<float> specular_1;
+        Common::Vec3<float> diffuse;
+        Common::Vec3<float> ambient;
+    };
+
+    void UpdateLights(const LightingRegs& lighting);
+    void UpdateLuts(const State::Lighting& lighting_state);
+
+    std::array<std::array<LutEntry, 256>, 24> luts;
+    std::array<Light, 8> lights;
+    Common::Vec3<float> global_ambient;
+};
+
 std::tuple<Common::Vec4<u8>, Common::Vec4<u8>> ComputeFragmentsColors(
-    const Pica::LightingRegs& lighting, const Pica::State::Lighting& lighting_state,
+    const Pica::LightingRegs& lighting, const LightingTables& tables,
     const Common::Quaternion<float>& normquat, const Common::Vec3<float>& view,
     const Common::Vec4<u8> (&texture_color)[4]);
 
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include "common/common_types.h"
 #include "common/vector_math.h"
 #include "video_core/pica_state.h"
@@ -11,6 +12,30 @@
 namespace Pica::Rasterizer {
 
 /// Generates procedural texture color for the given coordinates
-Common::Vec4<u8> ProcTex(float u, float v, const TexturingRegs& regs, const State::ProcTex& state);
+/**
+ * The procedural texture LUTs and noise parameters decoded to floats, once instead of for every
+ * texel. They have to be updated whenever the procedural texture registers or LUTs change.
+ */
+struct ProcTexTables {
+    struct LutEntry {
+        float value;
+        float diff;
+    };
+
+    void Update(const TexturingRegs& regs, const State::ProcTex& state);
+
+    std::array<LutEntry, 128> noise_table;
+    std::array<LutEntry, 128> color_map_table;
+    std::array<LutEntry, 128> alpha_map_table;
+    std::array<Common::Vec4<u8>, 256> color_table;
+    std::array<Common::Vec4<float>, 256> color_value_table;
+    std::array<Common::Vec4<float>, 256> color_diff_table;
+    float noise_frequency_u;
+    float noise_frequency_v;
+    float noise_phase_u;
+    float noise_phase_v;
+};
+
+Common::Vec4<u8> ProcTex(float u, float v, const TexturingRegs& regs, const ProcTexTables& tables);
 
 } // namespace Pica::Rasterizer
@@ -11,6 +11,7 @@
 #include "common/color.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
+#include "common/math_util.h"
 #include "common/microprofile.h"
 #include "common/quaternion.h"
 #include "common/vector_math.h"
@@ -27,6 +28,8 @@
 #include "video_core/swrasterizer/lighting.h"
 #include "video_core/swrasterizer/proctex.h"
 #include "video_core/swrasterizer/rasterizer.h"
+#include "video_core/swrasterizer/span.h"
+#include "video_core/swrasterizer/texture_cache.h"
 #include "video_core/swrasterizer/texturing.h"
 #include "video_core/texture/texture_decode.h"
 #include "video_core/utils.h"
@@ -119,25 +122,120 @@ static std::tuple<float24, float24, float24, PAddr> ConvertCubeCoord(float24 u,
 
 MICROPROFILE_DEFINE(GPU_Rasterization, "GPU", "Rasterization", MP_RGB(50, 50, 240));
 
+/// Only written by the Update functions, between the triangles
+static LightingTables lighting_tables;
+static ProcTexTables proctex_tables;
+
+/// Where the output merger writes a covered pixel
+struct Fragment {
+    int x;
+    int y;
+    float depth;
+};
+
+/// Number of TEV sources interpolated or sampled per fragment, PrimaryColor to Texture3
+constexpr std::size_t NumFragmentSources = 7;
+
+/// Detects if a TEV stage leaves the previous output unchanged, so that it can be skipped
+static bool IsPassThroughTevStage(const TexturingRegs::TevStageConfig& stage) {
+    using TevStageConfig = TexturingRegs::TevStageConfig;
+    return (stage.color_op == TevStageConfig::Operation::Replace &&
+            stage.alpha_op == TevStageConfig::Operation::Replace &&
+            stage.color_source1 == TevStageConfig::Source::Previous &&
+            stage.alpha_source1 == TevStageConfig::Source::Previous &&
+            stage.color_modifier1 == TevStageConfig::ColorModifier::SourceColor &&
+            stage.alpha_modifier1 == TevStageConfig::AlphaModifier::SourceAlpha &&
+            stage.GetColorMultiplier() == 1 && stage.GetAlphaMultiplier() == 1);
+}
+
+// vertex positions in rasterizer coordinates
+static Fix12P4 FloatToFix(float24 flt) {
+    // TODO: Rounding here is necessary to prevent garbage pixels at
+    //       triangle borders. Is it that the correct solution, though?
+    return Fix12P4(static_cast<unsigned short>(round(flt.ToFloat32() * 16.0f)));
+}
+
+static Common::Vec3<Fix12P4> ScreenToRasterizerCoordinates(const Common::Vec3<float24>& vec) {
+    return Common::Vec3<Fix12P4>{FloatToFix(vec.x), FloatToFix(vec.y), FloatToFix(vec.z)};
+}
+
+static bool TestDepth(FramebufferRegs::CompareFunc func, u32 z, u32 ref_z) {
+    switch (func) {
+    case FramebufferRegs::CompareFunc::Never:
+        return false;
+    case FramebufferRegs::CompareFunc::Always:
+        return true;
+    case FramebufferRegs::CompareFunc::Equal:
+        return z == ref_z;
+    case FramebufferRegs::CompareFunc::NotEqual:
+        return z != ref_z;
+    case FramebufferRegs::CompareFunc::LessThan:
+        return z < ref_z;
+    case FramebufferRegs::CompareFunc::LessThanOrEqual:
+        return z <= ref_z;
+    case FramebufferRegs::CompareFunc::GreaterThan:
+        return z > ref_z;
+    case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+        return z >= ref_z;
+    }
+    return false;
+}
+
+/**
+ * Whether every fragment with a depth in [z_min, z_max] fails the depth test against a buffer
+ * with depths in the given bounds.
+ */
+static bool FailsDepthTest(FramebufferRegs::CompareFunc func, u32 z_min, u32 z_max,
+                           const DepthBounds& bounds) {
+    switch (func) {
+    case FramebufferRegs::CompareFunc::Never:
+        return true;
+    case FramebufferRegs::CompareFunc::Equal:
+        return z_max < bounds.min || z_min > bounds.max;
+    case FramebufferRegs::CompareFunc::LessThan:
+        return z_min >= bounds.max;
+    case FramebufferRegs::CompareFunc::LessThanOrEqual:
+        return z_min > bounds.max;
+    case FramebufferRegs::CompareFunc::GreaterThan:
+        return z_max <= bounds.min;
+    case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+        return z_max < bounds.min;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Returns the region in 12.4 fixed point (right/bottom exclusive, on whole pixels) of the pixels
+ * whose center lies in the viewport. The clipper passes on the triangles reaching out of the
+ * viewport within its guard band unclipped, their pixels outside of it are not drawn.
+ */
+static Common::Rectangle<int> GetViewportBounds() {
+    const auto& regs = g_state.regs.rasterizer;
+    const float left = static_cast<float>(regs.viewport_corner.x);
+    const float top = static_cast<float>(regs.viewport_corner.y);
+    const float width = float24::FromRaw(regs.viewport_size_x).ToFloat32() * 2.0f;
+    const float height = float24::FromRaw(regs.viewport_size_y).ToFloat32() * 2.0f;
+
+    // Pixel centers are sampled at +0.5
+    auto ToPixelEdge = [](float edge) {
+        return std::max(0, static_cast<int>(std::ceil(edge - 0.5f))) << 4;
+    };
+    return {ToPixelEdge(left), ToPixelEdge(top), ToPixelEdge(left + width),
+            ToPixelEdge(top + height)};
+}
+
 /**
  * Helper function for ProcessTriangle with the "reversed" flag to allow for implementing
  * culling via recursion.
+ * @param tile If not null, only pixels inside this region (in pixels, right/bottom exclusive)
+ *             are rasterized.
  */
 static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Vertex& v2,
-                                    bool reversed = false) {
+                                    const Common::Rectangle<u16>* tile, bool reversed = false) {
     const auto& regs = g_state.regs;
     MICROPROFILE_SCOPE(GPU_Rasterization);
 
-    // vertex positions in rasterizer coordinates
-    static auto FloatToFix = [](float24 flt) {
-        // TODO: Rounding here is necessary to prevent garbage pixels at
-        //       triangle borders. Is it that the correct solution, though?
-        return Fix12P4(static_cast<unsigned short>(round(flt.ToFloat32() * 16.0f)));
-    };
-    static auto ScreenToRasterizerCoordinates = [](const Common::Vec3<float24>& vec) {
-        return Common::Vec3<Fix12P4>{FloatToFix(vec.x), FloatToFix(vec.y), FloatToFix(vec.z)};
-    };
-
     Common::Vec3<Fix12P4> vtxpos[3]{ScreenToRasterizerCoordinates(v0.screenpos),
                                     ScreenToRasterizerCoordinates(v1.screenpos),
                                     ScreenToRasterizerCoordinates(v2.screenpos)};
@@ -145,13 +243,13 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
     if (regs.rasterizer.cull_mode == RasterizerRegs::CullMode::KeepAll) {
         // Make sure we always end up with a triangle wound counter-clockwise
         if (!reversed && SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), vtxpos[2].xy()) <= 0) {
-            ProcessTriangleInternal(v0, v2, v1, true);
+            ProcessTriangleInternal(v0, v2, v1, tile, true);
             return;
         }
     } else {
         if (!reversed && regs.rasterizer.cull_mode == RasterizerRegs::CullMode::KeepClockWise) {
             // Reverse vertex order and use the CCW code path.
-            ProcessTriangleInternal(v0, v2, v1, true);
+            ProcessTriangleInternal(v0, v2, v1, tile, true);
             return;
         }
 
@@ -185,6 +283,23 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
     max_x = ((max_x + Fix12P4::FracMask()) & Fix12P4::IntMask());
     max_y = ((max_y + Fix12P4::FracMask()) & Fix12P4::IntMask());
 
+    const auto viewport = GetViewportBounds();
+    min_x = static_cast<u16>(std::max<int>(min_x, viewport.left));
+    min_y = static_cast<u16>(std::max<int>(min_y, viewport.top));
+    max_x = static_cast<u16>(std::min<int>(max_x, viewport.right));
+    max_y = static_cast<u16>(std::min<int>(max_y, viewport.bottom));
+
+    if (tile != nullptr) {
+        // Pixel centers are sampled at +8, so clamping to whole pixels keeps every pixel in
+        // exactly one tile. The arithmetic is done in int since tile edges may reach 4096 pixels.
+        min_x = static_cast<u16>(std::max<int>(min_x, tile->left << 4));
+        min_y = static_cast<u16>(std::max<int>(min_y, tile->top << 4));
+        max_x = static_cast<u16>(std::min<int>(max_x, tile->right << 4));
+        max_y = static_cast<u16>(std::min<int>(max_y, tile->bottom << 4));
+    }
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
     // Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
     // drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
     // values which are added to the barycentric coordinates w0, w1 and w2, respectively.
@@ -214,12 +329,435 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
 
     auto textures = regs.texturing.GetTextures();
     auto tev_stages = regs.texturing.GetTevStages();
+    // The stages configured to do nothing are taken out of the combiner pipeline of the triangle
+    std::array<bool, 6> passthrough_stages;
+    std::transform(tev_stages.begin(), tev_stages.end(), passthrough_stages.begin(),
+                   IsPassThroughTevStage);
 
     bool stencil_action_enable =
         g_state.regs.framebuffer.output_merger.stencil_test.enable &&
         g_state.regs.framebuffer.framebuffer.depth_format == FramebufferRegs::DepthFormat::D24S8;
     const auto stencil_test = g_state.regs.framebuffer.output_merger.stencil_test;
 
+    const auto& output_merger = regs.framebuffer.output_merger;
+
+    // Convert float to integer
+    const unsigned num_bits =
+        FramebufferRegs::DepthBitsPerPixel(regs.framebuffer.framebuffer.depth_format);
+    auto ToDepthValue = [num_bits](float depth) {
+        return static_cast<u32>(depth * ((1 << num_bits) - 1));
+    };
+    const bool depth_write = regs.framebuffer.framebuffer.allow_depth_stencil_write != 0 &&
+                             output_merger.depth_write_enable;
+
+    // Without the shadow mode, the alpha test and the stencil test, nothing but the depth test
+    // can drop a fragment, and a dropped fragment has no effect. The depth test is then done right
+    // when the depth is interpolated, before the much more expensive texturing, lighting and
+    // combiners.
+    const bool early_depth =
+        output_merger.depth_test_enable &&
+        output_merger.fragment_operation_mode != FramebufferRegs::FragmentOperationMode::Shadow &&
+        !output_merger.alpha_test.enable && !stencil_action_enable;
+
+    // With a Z-buffer, z / w is linear in screen space, so the depth of the triangle lies between
+    // the ones of its vertices. Blocks of the depth buffer whose bounds fail the test against
+    // the range are skipped whole. Drawing to the depth buffer as the color buffer would keep the
+    // bounds from following the buffer.
+    const bool hierarchical_depth =
+        early_depth && regs.rasterizer.depthmap_enable ==
+                           Pica::RasterizerRegs::DepthBuffering::ZBuffering &&
+        regs.framebuffer.framebuffer.GetColorBufferPhysicalAddress() !=
+            regs.framebuffer.framebuffer.GetDepthBufferPhysicalAddress();
+    u32 triangle_z_min = 0;
+    u32 triangle_z_max = 0;
+    if (hierarchical_depth) {
+        const float depth_scale =
+            float24::FromRaw(regs.rasterizer.viewport_depth_range).ToFloat32();
+        const float depth_offset =
+            float24::FromRaw(regs.rasterizer.viewport_depth_near_plane).ToFloat32();
+        std::array<float, 3> depths;
+        for (std::size_t i = 0; i < 3; ++i) {
+            const Vertex& vtx = i == 0 ? v0 : i == 1 ? v1 : v2;
+            depths[i] = vtx.screenpos[2].ToFloat32() * depth_scale + depth_offset;
+        }
+        const auto [depth_min, depth_max] = std::minmax_element(depths.begin(), depths.end());
+        // Widened for the rounding of the interpolation
+        constexpr float DepthMargin = 1.0f / 0x10000;
+        triangle_z_min = ToDepthValue(std::clamp(*depth_min - DepthMargin, 0.0f, 1.0f));
+        triangle_z_max = ToDepthValue(std::clamp(*depth_max + DepthMargin, 0.0f, 1.0f));
+    }
+    bool block_rejected = false;
+
+    const Common::Vec3<u8> fog_color =
+        Common::MakeVec(regs.texturing.fog_color.r.Value(), regs.texturing.fog_color.g.Value(),
+                        regs.texturing.fog_color.b.Value())
+            .Cast<u8>();
+
+    const auto blend_params = output_merger.alpha_blending;
+    const BlendState blend_state{
+        blend_params.blend_equation_rgb,
+        blend_params.blend_equation_a,
+        blend_params.factor_source_rgb,
+        blend_params.factor_dest_rgb,
+        blend_params.factor_source_a,
+        blend_params.factor_dest_a,
+        Common::MakeVec(output_merger.blend_const.r.Value(), output_merger.blend_const.g.Value(),
+                        output_merger.blend_const.b.Value(), output_merger.blend_const.a.Value())
+            .Cast<u8>(),
+    };
+
+    // Covered pixels are collected into spans, which then go through the texture combiners, fog
+    // and blending together so that the color math can be vectorized. All pixels of a span are
+    // distinct, so running each step for the whole span before starting the next one produces
+    // the same result as shading the pixels one after another.
+    std::array<Fragment, SPAN_SIZE> span;
+    std::size_t span_size = 0;
+    // The per-fragment TEV sources are stored one array per source, so that a combiner input is
+    // a whole array that the span functions can run through
+    std::array<Common::Vec4<u8>, SPAN_SIZE> span_sources[NumFragmentSources];
+
+    // Sampling a texture while drawing into it is undefined anyway, so the textures are decoded
+    // once for the whole draw
+    auto& texture_cache = DecodedTextureCache::GetThreadInstance();
+    std::array<DecodedTexture*, 3> decoded_textures{};
+
+    auto ShadeSpan = [&] {
+        // Texture environment - consists of 6 stages of color and alpha combining.
+        //
+        // Color combiners take three input color values from some source (e.g. interpolated
+        // vertex color, texture color, previous stage, etc), perform some very simple
+        // operations on each of them (e.g. inversion) and then calculate the output color
+        // with some basic arithmetic. Alpha combiners can be configured separately but work
+        // analogously.
+        std::array<Common::Vec4<u8>, SPAN_SIZE> combiner_output;
+        std::array<Common::Vec4<u8>, SPAN_SIZE> combiner_buffer;
+        std::array<Common::Vec4<u8>, SPAN_SIZE> next_combiner_buffer;
+        std::array<Common::Vec4<u8>, SPAN_SIZE> constants;
+        combiner_output.fill({0, 0, 0, 0});
+        combiner_buffer.fill({0, 0, 0, 0});
+        next_combiner_buffer.fill(
+            Common::MakeVec(regs.texturing.tev_combiner_buffer_color.r.Value(),
+                            regs.texturing.tev_combiner_buffer_color.g.Value(),
+                            regs.texturing.tev_combiner_buffer_color.b.Value(),
+                            regs.texturing.tev_combiner_buffer_color.a.Value())
+                .Cast<u8>());
+
+        for (unsigned tev_stage_index = 0; tev_stage_index < tev_stages.size();
+             ++tev_stage_index) {
+            const auto& tev_stage = tev_stages[tev_stage_index];
+            using Source = TexturingRegs::TevStageConfig::Source;
+
+            if (!passthrough_stages[tev_stage_index]) {
+                bool constants_filled = false;
+                auto GetSourceSpan = [&](Source source) -> const Common::Vec4<u8>* {
+                    switch (source) {
+                    case Source::PrimaryColor:
+                    case Source::PrimaryFragmentColor:
+                    case Source::SecondaryFragmentColor:
+                    case Source::Texture0:
+                    case Source::Texture1:
+                    case Source::Texture2:
+                    case Source::Texture3:
+                        return span_sources[static_cast<std::size_t>(source)].data();
+
+                    case Source::PreviousBuffer:
+                        return combiner_buffer.data();
+
+                    case Source::Constant:
+                        if (!constants_filled) {
+                            constants.fill(Common::MakeVec(tev_stage.const_r.Value(),
+                                                           tev_stage.const_g.Value(),
+                                                           tev_stage.const_b.Value(),
+                                                           tev_stage.const_a.Value())
+                                               .Cast<u8>());
+                            constants_filled = true;
+                        }
+                        return constants.data();
+
+                    case Source::Previous:
+                        return combiner_output.data();
+
+                    default:
+                        LOG_ERROR(HW_GPU, "Unknown color combiner source {}", (int)source);
+                        UNIMPLEMENTED();
+                        constants.fill({0, 0, 0, 0});
+                        constants_filled = false;
+                        return constants.data();
+                    }
+                };
+
+                // Gather the combiner inputs, with RGB taken from the color modifiers and alpha
+                // from the alpha modifiers.
+                // NOTE: Not sure if the alpha combiner might use the color output of the previous
+                //       stage as input. Hence, we currently don't directly write the result to
+                //       combiner_output, but instead store it in a temporary array until alpha
+                //       combining has been done.
+                std::array<Common::Vec4<u8>, SPAN_SIZE> inputs[3];
+                ModifyColorSpan(tev_stage.color_modifier1, GetSourceSpan(tev_stage.color_source1),
+                                inputs[0].data(), span_size);
+                ModifyColorSpan(tev_stage.color_modifier2, GetSourceSpan(tev_stage.color_source2),
+                                inputs[1].data(), span_size);
+                ModifyColorSpan(tev_stage.color_modifier3, GetSourceSpan(tev_stage.color_source3),
+                                inputs[2].data(), span_size);
+
+                // result of Dot3_RGBA operation is also placed to the alpha component, so the
+                // alpha inputs are unused
+                if (tev_stage.color_op != TexturingRegs::TevStageConfig::Operation::Dot3_RGBA) {
+                    ModifyAlphaSpan(tev_stage.alpha_modifier1,
+                                    GetSourceSpan(tev_stage.alpha_source1), inputs[0].data(),
+                                    span_size);
+                    ModifyAlphaSpan(tev_stage.alpha_modifier2,
+                                    GetSourceSpan(tev_stage.alpha_source2), inputs[1].data(),
+                                    span_size);
+                    ModifyAlphaSpan(tev_stage.alpha_modifier3,
+                                    GetSourceSpan(tev_stage.alpha_source3), inputs[2].data(),
+                                    span_size);
+                } else {
+                    for (auto& input : inputs) {
+                        for (std::size_t i = 0; i < span_size; ++i) {
+                            input[i].a() = 0;
+                        }
+                    }
+                }
+
+                CombineSpan(tev_stage.color_op, tev_stage.alpha_op, inputs[0].data(),
+                            inputs[1].data(), inputs[2].data(), combiner_output.data(),
+                            span_size);
+                ScaleSpan(combiner_output.data(), tev_stage.GetColorMultiplier(),
+                          tev_stage.GetAlphaMultiplier(), span_size);
+            }
+
+            const bool update_buffer_color =
+                regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferColor(
+                    tev_stage_index);
+            const bool update_buffer_alpha =
+                regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferAlpha(
+                    tev_stage_index);
+            for (std::size_t i = 0; i < span_size; ++i) {
+                combiner_buffer[i] = next_combiner_buffer[i];
+
+                if (update_buffer_color) {
+                    next_combiner_buffer[i].r() = combiner_output[i].r();
+                    next_combiner_buffer[i].g() = combiner_output[i].g();
+                    next_combiner_buffer[i].b() = combiner_output[i].b();
+                }
+
+                if (update_buffer_alpha) {
+                    next_combiner_buffer[i].a() = combiner_output[i].a();
+                }
+            }
+        }
+
+        // Depth, stencil and alpha tests are evaluated per fragment. The surviving fragments are
+        // then packed together for fog and blending.
+        std::array<Common::Vec4<u8>, SPAN_SIZE> src;
+        std::array<Common::Vec4<u8>, SPAN_SIZE> dest;
+        std::array<float, SPAN_SIZE> fog_factors;
+        std::array<const Fragment*, SPAN_SIZE> survivors;
+        std::size_t num_survivors = 0;
+
+        for (std::size_t i = 0; i < span_size; ++i) {
+            const Fragment& fragment = span[i];
+            const Common::Vec4<u8>& color = combiner_output[i];
+
+            if (output_merger.fragment_operation_mode ==
+                FramebufferRegs::FragmentOperationMode::Shadow) {
+                u32 depth_int = static_cast<u32>(fragment.depth * 0xFFFFFF);
+                // use green color as the shadow intensity
+                u8 stencil = color.y;
+                DrawShadowMapPixel(fragment.x, fragment.y, depth_int, stencil);
+                // skip the normal output merger pipeline if it is in shadow mode
+                continue;
+            }
+
+            // TODO: Does alpha testing happen before or after stencil?
+            if (output_merger.alpha_test.enable) {
+                bool pass = false;
+
+                switch (output_merger.alpha_test.func) {
+                case FramebufferRegs::CompareFunc::Never:
+                    pass = false;
+                    break;
+
+                case FramebufferRegs::CompareFunc::Always:
+                    pass = true;
+                    break;
+
+                case FramebufferRegs::CompareFunc::Equal:
+                    pass = color.a() == output_merger.alpha_test.ref;
+                    break;
+
+                case FramebufferRegs::CompareFunc::NotEqual:
+                    pass = color.a() != output_merger.alpha_test.ref;
+                    break;
+
+                case FramebufferRegs::CompareFunc::LessThan:
+                    pass = color.a() < output_merger.alpha_test.ref;
+                    break;
+
+                case FramebufferRegs::CompareFunc::LessThanOrEqual:
+                    pass = color.a() <= output_merger.alpha_test.ref;
+                    break;
+
+                case FramebufferRegs::CompareFunc::GreaterThan:
+                    pass = color.a() > output_merger.alpha_test.ref;
+                    break;
+
+                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+                    pass = color.a() >= output_merger.alpha_test.ref;
+                    break;
+                }
+
+                if (!pass)
+                    continue;
+            }
+
+            // Compute the fog factor, the fog itself is blended in below.
+            // Not fully accurate. We'd have to know what data type is used to
+            // store the depth etc. Using float for now until we know more
+            // about Pica datatypes
+            float fog_factor = 1.0f;
+            if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
+                // Get index into fog LUT
+                float fog_index;
+                if (g_state.regs.texturing.fog_flip) {
+                    fog_index = (1.0f - fragment.depth) * 128.0f;
+                } else {
+                    fog_index = fragment.depth * 128.0f;
+                }
+
+                // Generate clamped fog factor from LUT for given fog index
+                float fog_i = std::clamp(floorf(fog_index), 0.0f, 127.0f);
+                float fog_f = fog_index - fog_i;
+                const auto& fog_lut_entry = g_state.fog.lut[static_cast<unsigned int>(fog_i)];
+                fog_factor = fog_lut_entry.ToFloat() + fog_lut_entry.DiffToFloat() * fog_f;
+                fog_factor = std::clamp(fog_factor, 0.0f, 1.0f);
+            }
+
+            u8 old_stencil = 0;
+
+            auto UpdateStencil = [stencil_test, &fragment,
+                                  &old_stencil](Pica::FramebufferRegs::StencilAction action) {
+                u8 new_stencil =
+                    PerformStencilAction(action, old_stencil, stencil_test.reference_value);
+                if (g_state.regs.framebuffer.framebuffer.allow_depth_stencil_write != 0)
+                    SetStencil(fragment.x, fragment.y,
+                               (new_stencil & stencil_test.write_mask) |
+                                   (old_stencil & ~stencil_test.write_mask));
+            };
+
+            if (stencil_action_enable) {
+                old_stencil = GetStencil(fragment.x, fragment.y);
+                u8 dest = old_stencil & stencil_test.input_mask;
+                u8 ref = stencil_test.reference_value & stencil_test.input_mask;
+
+                bool pass = false;
+                switch (stencil_test.func) {
+                case FramebufferRegs::CompareFunc::Never:
+                    pass = false;
+                    break;
+
+                case FramebufferRegs::CompareFunc::Always:
+                    pass = true;
+                    break;
+
+                case FramebufferRegs::CompareFunc::Equal:
+                    pass = (ref == dest);
+                    break;
+
+                case FramebufferRegs::CompareFunc::NotEqual:
+                    pass = (ref != dest);
+                    break;
+
+                case FramebufferRegs::CompareFunc::LessThan:
+                    pass = (ref < dest);
+                    break;
+
+                case FramebufferRegs::CompareFunc::LessThanOrEqual:
+                    pass = (ref <= dest);
+                    break;
+
+                case FramebufferRegs::CompareFunc::GreaterThan:
+                    pass = (ref > dest);
+                    break;
+
+                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
+                    pass = (ref >= dest);
+                    break;
+                }
+
+                if (!pass) {
+                    UpdateStencil(stencil_test.action_stencil_fail);
+                    continue;
+                }
+            }
+
+            // The early depth test already took care of the depth
+            if (!early_depth) {
+                const u32 z = ToDepthValue(fragment.depth);
+
+                if (output_merger.depth_test_enable) {
+                    u32 ref_z = GetDepth(fragment.x, fragment.y);
+
+                    if (!TestDepth(output_merger.depth_test_func, z, ref_z)) {
+                        if (stencil_action_enable)
+                            UpdateStencil(stencil_test.action_depth_fail);
+                        continue;
+                    }
+                }
+
+                if (depth_write) {
+                    SetDepth(fragment.x, fragment.y, z);
+                }
+            }
+
+            // The stencil depth_pass action is executed even if depth testing is disabled
+            if (stencil_action_enable)
+                UpdateStencil(stencil_test.action_depth_pass);
+
+            src[num_survivors] = color;
+            dest[num_survivors] = GetPixel(fragment.x, fragment.y);
+            fog_factors[num_survivors] = fog_factor;
+            survivors[num_survivors] = &fragment;
+            ++num_survivors;
+        }
+
+        if (num_survivors == 0)
+            return;
+
+        // Apply fog combiner
+        if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
+            FogSpan(src.data(), fog_factors.data(), fog_color, num_survivors);
+        }
+
+        std::array<Common::Vec4<u8>, SPAN_SIZE> blend_output;
+        if (output_merger.alphablend_enable) {
+            BlendSpan(src.data(), dest.data(), blend_output.data(), blend_state, num_survivors);
+        } else {
+            for (std::size_t i = 0; i < num_survivors; ++i) {
+                blend_output[i] =
+                    Common::MakeVec(LogicOp(src[i].r(), dest[i].r(), output_merger.logic_op),
+                                    LogicOp(src[i].g(), dest[i].g(), output_merger.logic_op),
+                                    LogicOp(src[i].b(), dest[i].b(), output_merger.logic_op),
+                                    LogicOp(src[i].a(), dest[i].a(), output_merger.logic_op));
+            }
+        }
+
+        if (regs.framebuffer.framebuffer.allow_color_write == 0)
+            return;
+
+        for (std::size_t i = 0; i < num_survivors; ++i) {
+            const Common::Vec4<u8> result = {
+                output_merger.red_enable ? blend_output[i].r() : dest[i].r(),
+                output_merger.green_enable ? blend_output[i].g() : dest[i].g(),
+                output_merger.blue_enable ? blend_output[i].b() : dest[i].b(),
+                output_merger.alpha_enable ? blend_output[i].a() : dest[i].a(),
+            };
+
+            DrawPixel(survivors[i]->x, survivors[i]->y, result);
+        }
+    };
+
     // Enter rasterization loop, starting at the center of the topleft bounding box corner.
     // TODO: Not sure if looping through x first might be faster
     for (u16 y = min_y + 8; y < max_y; y += 0x10) {
@@ -232,6 +770,21 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
                     continue;
             }
 
+            if (hierarchical_depth) {
+                const int pixel_x = x >> 4;
+                if (x == min_x + 8 || pixel_x % DepthBlockSize == 0) {
+                    const auto bounds = GetDepthBlockBounds(pixel_x, y >> 4);
+                    block_rejected = bounds && FailsDepthTest(output_merger.depth_test_func,
+                                                              triangle_z_min, triangle_z_max,
+                                                              *bounds);
+                }
+                if (block_rejected) {
+                    // Skip to the last pixel of the block
+                    x = static_cast<u16>(((pixel_x | (DepthBlockSize - 1)) << 4) + 8);
+                    continue;
+                }
+            }
+
             // Calculate the barycentric coordinates w0, w1 and w2
             int w0 = bias0 + SignedArea(vtxpos[1].xy(), vtxpos[2].xy(), {x, y});
             int w1 = bias1 + SignedArea(vtxpos[2].xy(), vtxpos[0].xy(), {x, y});
@@ -272,6 +825,15 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
             // Clamp the result
             depth = std::clamp(depth, 0.0f, 1.0f);
 
+            if (early_depth) {
+                const u32 z = ToDepthValue(depth);
+                if (!TestDepth(output_merger.depth_test_func, z, GetDepth(x >> 4, y >> 4)))
+                    continue;
+                // The fragment can't be dropped anymore
+                if (depth_write)
+                    SetDepth(x >> 4, y >> 4, z);
+            }
+
             // Perspective correct attribute interpolation:
             // Attribute values cannot be calculated by simple linear interpolation since
             // they are not linear in screen space. For example, when interpolating a
@@ -410,7 +972,10 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
                         Texture::TextureInfo::FromPicaRegister(texture.config, texture.format);
 
                     // TODO: Apply the min and mag filters to the texture
-                    texture_color[i] = Texture::LookupTexture(texture_data, s, t, info);
+                    auto& decoded_texture = decoded_textures[i];
+                    if (decoded_texture == nullptr || !decoded_texture->Matches(texture_data, info))
+                        decoded_texture = &texture_cache.Get(texture_data, info);
+                    texture_color[i] = decoded_texture->Lookup(s, t);
                 }
 
                 if (i == 0 && (texture.config.type == TexturingRegs::TextureConfig::Shadow2D ||
@@ -434,25 +999,9 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
             if (regs.texturing.main_config.texture3_enable) {
                 const auto& proctex_uv = uv[regs.texturing.main_config.texture3_coordinates];
                 texture_color[3] = ProcTex(proctex_uv.u().ToFloat32(), proctex_uv.v().ToFloat32(),
-                                           g_state.regs.texturing, g_state.proctex);
+                                           g_state.regs.texturing, proctex_tables);
             }
 
-            // Texture environment - consists of 6 stages of color and alpha combining.
-            //
-            // Color combiners take three input color values from some source (e.g. interpolated
-            // vertex color, texture color, previous stage, etc), perform some very simple
-            // operations on each of them (e.g. inversion) and then calculate the output color
-            // with some basic arithmetic. Alpha combiners can be configured separately but work
-            // analogously.
-            Common::Vec4<u8> combiner_output;
-            Common::Vec4<u8> combiner_buffer = {0, 0, 0, 0};
-            Common::Vec4<u8> next_combiner_buffer =
-                Common::MakeVec(regs.texturing.tev_combiner_buffer_color.r.Value(),
-                                regs.texturing.tev_combiner_buffer_color.g.Value(),
-                                regs.texturing.tev_combiner_buffer_color.b.Value(),
-                                regs.texturing.tev_combiner_buffer_color.a.Value())
-                    .Cast<u8>();
-
             Common::Vec4<u8> primary_fragment_color = {0, 0, 0, 0};
             Common::Vec4<u8> secondary_fragment_color = {0, 0, 0, 0};
 
@@ -472,427 +1021,84 @@ static void ProcessTriangleInternal(const Vertex& v0, const Vertex& v1, const Ve
                     GetInterpolatedAttribute(v0.view.z, v1.view.z, v2.view.z).ToFloat32(),
                 };
                 std::tie(primary_fragment_color, secondary_fragment_color) = ComputeFragmentsColors(
-                    g_state.regs.lighting, g_state.lighting, normquat, view, texture_color);
+                    g_state.regs.lighting, lighting_tables, normquat, view, texture_color);
             }
 
-            for (unsigned tev_stage_index = 0; tev_stage_index < tev_stages.size();
-                 ++tev_stage_index) {
-                const auto& tev_stage = tev_stages[tev_stage_index];
-                using Source = TexturingRegs::TevStageConfig::Source;
-
-                auto GetSource = [&](Source source) -> Common::Vec4<u8> {
-                    switch (source) {
-                    case Source::PrimaryColor:
-                        return primary_color;
-
-                    case Source::PrimaryFragmentColor:
-                        return primary_fragment_color;
-
-                    case Source::SecondaryFragmentColor:
-                        return secondary_fragment_color;
-
-                    case Source::Texture0:
-                        return texture_color[0];
-
-                    case Source::Texture1:
-                        return texture_color[1];
-
-                    case Source::Texture2:
-                        return texture_color[2];
-
-                    case Source::Texture3:
-                        return texture_color[3];
-
-                    case Source::PreviousBuffer:
-                        return combiner_buffer;
-
-                    case Source::Constant:
-                        return Common::MakeVec(tev_stage.const_r.Value(), tev_stage.const_g.Value(),
-                                               tev_stage.const_b.Value(), tev_stage.const_a.Value())
-                            .Cast<u8>();
-
-                    case Source::Previous:
-                        return combiner_output;
-
-                    default:
-                        LOG_ERROR(HW_GPU, "Unknown color combiner source {}", (int)source);
-                        UNIMPLEMENTED();
-                        return {0, 0, 0, 0};
-                    }
-                };
-
-                // color combiner
-                // NOTE: Not sure if the alpha combiner might use the color output of the previous
-                //       stage as input. Hence, we currently don't directly write the result to
-                //       combiner_output.rgb(), but instead store it in a temporary variable until
-                //       alpha combining has been done.
-                Common::Vec3<u8> color_result[3] = {
-                    GetColorModifier(tev_stage.color_modifier1, GetSource(tev_stage.color_source1)),
-                    GetColorModifier(tev_stage.color_modifier2, GetSource(tev_stage.color_source2)),
-                    GetColorModifier(tev_stage.color_modifier3, GetSource(tev_stage.color_source3)),
-                };
-                auto color_output = ColorCombine(tev_stage.color_op, color_result);
-
-                u8 alpha_output;
-                if (tev_stage.color_op == TexturingRegs::TevStageConfig::Operation::Dot3_RGBA) {
-                    // result of Dot3_RGBA operation is also placed to the alpha component
-                    alpha_output = color_output.x;
-                } else {
-                    // alpha combiner
-                    std::array<u8, 3> alpha_result = {{
-                        GetAlphaModifier(tev_stage.alpha_modifier1,
-                                         GetSource(tev_stage.alpha_source1)),
-                        GetAlphaModifier(tev_stage.alpha_modifier2,
-                                         GetSource(tev_stage.alpha_source2)),
-                        GetAlphaModifier(tev_stage.alpha_modifier3,
-                                         GetSource(tev_stage.alpha_source3)),
-                    }};
-                    alpha_output = AlphaCombine(tev_stage.alpha_op, alpha_result);
-                }
-
-                combiner_output[0] =
-                    std::min((unsigned)255, color_output.r() * tev_stage.GetColorMultiplier());
-                combiner_output[1] =
-                    std::min((unsigned)255, color_output.g() * tev_stage.GetColorMultiplier());
-                combiner_output[2] =
-                    std::min((unsigned)255, color_output.b() * tev_stage.GetColorMultiplier());
-                combiner_output[3] =
-                    std::min((unsigned)255, alpha_output * tev_stage.GetAlphaMultiplier());
-
-                combiner_buffer = next_combiner_buffer;
-
-                if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferColor(
-                        tev_stage_index)) {
-                    next_combiner_buffer.r() = combiner_output.r();
-                    next_combiner_buffer.g() = combiner_output.g();
-                    next_combiner_buffer.b() = combiner_output.b();
-                }
-
-                if (regs.texturing.tev_combiner_buffer_input.TevStageUpdatesCombinerBufferAlpha(
-                        tev_stage_index)) {
-                    next_combiner_buffer.a() = combiner_output.a();
-                }
-            }
-
-            const auto& output_merger = regs.framebuffer.output_merger;
-
-            if (output_merger.fragment_operation_mode ==
-                FramebufferRegs::FragmentOperationMode::Shadow) {
-                u32 depth_int = static_cast<u32>(depth * 0xFFFFFF);
-                // use green color as the shadow intensity
-                u8 stencil = combiner_output.y;
-                DrawShadowMapPixel(x >> 4, y >> 4, depth_int, stencil);
-                // skip the normal output merger pipeline if it is in shadow mode
-                continue;
-            }
-
-            // TODO: Does alpha testing happen before or after stencil?
-            if (output_merger.alpha_test.enable) {
-                bool pass = false;
-
-                switch (output_merger.alpha_test.func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = combiner_output.a() == output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = combiner_output.a() != output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = combiner_output.a() < output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = combiner_output.a() <= output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = combiner_output.a() > output_merger.alpha_test.ref;
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = combiner_output.a() >= output_merger.alpha_test.ref;
-                    break;
-                }
-
-                if (!pass)
-                    continue;
-            }
-
-            // Apply fog combiner
-            // Not fully accurate. We'd have to know what data type is used to
-            // store the depth etc. Using float for now until we know more
-            // about Pica datatypes
-            if (regs.texturing.fog_mode == TexturingRegs::FogMode::Fog) {
-                const Common::Vec3<u8> fog_color =
-                    Common::MakeVec(regs.texturing.fog_color.r.Value(),
-                                    regs.texturing.fog_color.g.Value(),
-                                    regs.texturing.fog_color.b.Value())
-                        .Cast<u8>();
-
-                // Get index into fog LUT
-                float fog_index;
-                if (g_state.regs.texturing.fog_flip) {
-                    fog_index = (1.0f - depth) * 128.0f;
-                } else {
-                    fog_index = depth * 128.0f;
-                }
-
-                // Generate clamped fog factor from LUT for given fog index
-                float fog_i = std::clamp(floorf(fog_index), 0.0f, 127.0f);
-                float fog_f = fog_index - fog_i;
-                const auto& fog_lut_entry = g_state.fog.lut[static_cast<unsigned int>(fog_i)];
-                float fog_factor = fog_lut_entry.ToFloat() + fog_lut_entry.DiffToFloat() * fog_f;
-                fog_factor = std::clamp(fog_factor, 0.0f, 1.0f);
-
-                // Blend the fog
-                for (unsigned i = 0; i < 3; i++) {
-                    combiner_output[i] = static_cast<u8>(fog_factor * combiner_output[i] +
-                                                         (1.0f - fog_factor) * fog_color[i]);
-                }
-            }
-
-            u8 old_stencil = 0;
-
-            auto UpdateStencil = [stencil_test, x, y,
-                                  &old_stencil](Pica::FramebufferRegs::StencilAction action) {
-                u8 new_stencil =
-                    PerformStencilAction(action, old_stencil, stencil_test.reference_value);
-                if (g_state.regs.framebuffer.framebuffer.allow_depth_stencil_write != 0)
-                    SetStencil(x >> 4, y >> 4,
-                               (new_stencil & stencil_test.write_mask) |
-                                   (old_stencil & ~stencil_test.write_mask));
-            };
-
-            if (stencil_action_enable) {
-                old_stencil = GetStencil(x >> 4, y >> 4);
-                u8 dest = old_stencil & stencil_test.input_mask;
-                u8 ref = stencil_test.reference_value & stencil_test.input_mask;
-
-                bool pass = false;
-                switch (stencil_test.func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = (ref == dest);
-                    break;
-
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = (ref != dest);
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = (ref < dest);
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = (ref <= dest);
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = (ref > dest);
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = (ref >= dest);
-                    break;
-                }
-
-                if (!pass) {
-                    UpdateStencil(stencil_test.action_stencil_fail);
-                    continue;
-                }
-            }
-
-            // Convert float to integer
-            unsigned num_bits =
-                FramebufferRegs::DepthBitsPerPixel(regs.framebuffer.framebuffer.depth_format);
-            u32 z = (u32)(depth * ((1 << num_bits) - 1));
-
-            if (output_merger.depth_test_enable) {
-                u32 ref_z = GetDepth(x >> 4, y >> 4);
-
-                bool pass = false;
-
-                switch (output_merger.depth_test_func) {
-                case FramebufferRegs::CompareFunc::Never:
-                    pass = false;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Always:
-                    pass = true;
-                    break;
-
-                case FramebufferRegs::CompareFunc::Equal:
-                    pass = z == ref_z;
-                    break;
-
-                case FramebufferRegs::CompareFunc::NotEqual:
-                    pass = z != ref_z;
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThan:
-                    pass = z < ref_z;
-                    break;
-
-                case FramebufferRegs::CompareFunc::LessThanOrEqual:
-                    pass = z <= ref_z;
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThan:
-                    pass = z > ref_z;
-                    break;
-
-                case FramebufferRegs::CompareFunc::GreaterThanOrEqual:
-                    pass = z >= ref_z;
-                    break;
-                }
-
-                if (!pass) {
-                    if (stencil_action_enable)
-                        UpdateStencil(stencil_test.action_depth_fail);
-                    continue;
-                }
+            span_sources[0][span_size] = primary_color;
+            span_sources[1][span_size] = primary_fragment_color;
+            span_sources[2][span_size] = secondary_fragment_color;
+            for (std::size_t i = 0; i < 4; ++i) {
+                span_sources[3 + i][span_size] = texture_color[i];
             }
+            span[span_size++] = {x >> 4, y >> 4, depth};
 
-            if (regs.framebuffer.framebuffer.allow_depth_stencil_write != 0 &&
-                output_merger.depth_write_enable) {
-
-                SetDepth(x >> 4, y >> 4, z);
+            if (span_size == SPAN_SIZE) {
+                ShadeSpan();
+                span_size = 0;
             }
+        }
+    }
 
-            // The stencil depth_pass action is executed even if depth testing is disabled
-            if (stencil_action_enable)
-                UpdateStencil(stencil_test.action_depth_pass);
-
-            auto dest = GetPixel(x >> 4, y >> 4);
-            Common::Vec4<u8> blend_output = combiner_output;
-
-            if (output_merger.alphablend_enable) {
-                auto params = output_merger.alpha_blending;
-
-                auto LookupFactor = [&](unsigned channel,
-                                        FramebufferRegs::BlendFactor factor) -> u8 {
-                    DEBUG_ASSERT(channel < 4);
-
-                    const Common::Vec4<u8> blend_const =
-                        Common::MakeVec(output_merger.blend_const.r.Value(),
-                                        output_merger.blend_const.g.Value(),
-                                        output_merger.blend_const.b.Value(),
-                                        output_merger.blend_const.a.Value())
-                            .Cast<u8>();
-
-                    switch (factor) {
-                    case FramebufferRegs::BlendFactor::Zero:
-                        return 0;
-
-                    case FramebufferRegs::BlendFactor::One:
-                        return 255;
-
-                    case FramebufferRegs::BlendFactor::SourceColor:
-                        return combiner_output[channel];
-
-                    case FramebufferRegs::BlendFactor::OneMinusSourceColor:
-                        return 255 - combiner_output[channel];
-
-                    case FramebufferRegs::BlendFactor::DestColor:
-                        return dest[channel];
-
-                    case FramebufferRegs::BlendFactor::OneMinusDestColor:
-                        return 255 - dest[channel];
-
-                    case FramebufferRegs::BlendFactor::SourceAlpha:
-                        return combiner_output.a();
-
-                    case FramebufferRegs::BlendFactor::OneMinusSourceAlpha:
-                        return 255 - combiner_output.a();
+    if (span_size != 0)
+        ShadeSpan();
+}
 
-                    case FramebufferRegs::BlendFactor::DestAlpha:
-                        return dest.a();
+void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2) {
+    ProcessTriangleInternal(v0, v1, v2, nullptr);
+}
 
-                    case FramebufferRegs::BlendFactor::OneMinusDestAlpha:
-                        return 255 - dest.a();
+void UpdateLightingTables(bool update_luts) {
+    lighting_tables.UpdateLights(g_state.regs.lighting);
+    if (update_luts) {
+        lighting_tables.UpdateLuts(g_state.lighting);
+    }
+}
 
-                    case FramebufferRegs::BlendFactor::ConstantColor:
-                        return blend_const[channel];
+void UpdateProcTexTables() {
+    proctex_tables.Update(g_state.regs.texturing, g_state.proctex);
+}
 
-                    case FramebufferRegs::BlendFactor::OneMinusConstantColor:
-                        return 255 - blend_const[channel];
+void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                     const Common::Rectangle<u16>& tile) {
+    ProcessTriangleInternal(v0, v1, v2, &tile);
+}
 
-                    case FramebufferRegs::BlendFactor::ConstantAlpha:
-                        return blend_const.a();
+Common::Rectangle<u16> GetTriangleBounds(const Vertex& v0, const Vertex& v1, const Vertex& v2) {
+    const auto& regs = g_state.regs;
 
-                    case FramebufferRegs::BlendFactor::OneMinusConstantAlpha:
-                        return 255 - blend_const.a();
+    const Common::Vec3<Fix12P4> vtxpos[3]{ScreenToRasterizerCoordinates(v0.screenpos),
+                                          ScreenToRasterizerCoordinates(v1.screenpos),
+                                          ScreenToRasterizerCoordinates(v2.screenpos)};
 
-                    case FramebufferRegs::BlendFactor::SourceAlphaSaturate:
-                        // Returns 1.0 for the alpha channel
-                        if (channel == 3)
-                            return 255;
-                        return std::min(combiner_output.a(), static_cast<u8>(255 - dest.a()));
+    int min_x = std::min({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
+    int min_y = std::min({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
+    int max_x = std::max({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
+    int max_y = std::max({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
 
-                    default:
-                        LOG_CRITICAL(HW_GPU, "Unknown blend factor {:x}", static_cast<u32>(factor));
-                        UNIMPLEMENTED();
-                        break;
-                    }
-
-                    return combiner_output[channel];
-                };
+    if (regs.rasterizer.scissor_test.mode == RasterizerRegs::ScissorMode::Include) {
+        min_x = std::max<int>(min_x, regs.rasterizer.scissor_test.x1 << 4);
+        min_y = std::max<int>(min_y, regs.rasterizer.scissor_test.y1 << 4);
+        max_x = std::min<int>(max_x, (regs.rasterizer.scissor_test.x2 + 1) << 4);
+        max_y = std::min<int>(max_y, (regs.rasterizer.scissor_test.y2 + 1) << 4);
+    }
 
-                auto srcfactor = Common::MakeVec(LookupFactor(0, params.factor_source_rgb),
-                                                 LookupFactor(1, params.factor_source_rgb),
-                                                 LookupFactor(2, params.factor_source_rgb),
-                                                 LookupFactor(3, params.factor_source_a));
-
-                auto dstfactor = Common::MakeVec(LookupFactor(0, params.factor_dest_rgb),
-                                                 LookupFactor(1, params.factor_dest_rgb),
-                                                 LookupFactor(2, params.factor_dest_rgb),
-                                                 LookupFactor(3, params.factor_dest_a));
-
-                blend_output = EvaluateBlendEquation(combiner_output, srcfactor, dest, dstfactor,
-                                                     params.blend_equation_rgb);
-                blend_output.a() = EvaluateBlendEquation(combiner_output, srcfactor, dest,
-                                                         dstfactor, params.blend_equation_a)
-                                       .a();
-            } else {
-                blend_output =
-                    Common::MakeVec(LogicOp(combiner_output.r(), dest.r(), output_merger.logic_op),
-                                    LogicOp(combiner_output.g(), dest.g(), output_merger.logic_op),
-                                    LogicOp(combiner_output.b(), dest.b(), output_merger.logic_op),
-                                    LogicOp(combiner_output.a(), dest.a(), output_merger.logic_op));
-            }
+    // Same rounding as the rasterization loop, so the bounds cover exactly the visited pixels
+    min_x &= Fix12P4::IntMask();
+    min_y &= Fix12P4::IntMask();
+    max_x = (max_x + Fix12P4::FracMask()) & Fix12P4::IntMask();
+    max_y = (max_y + Fix12P4::FracMask()) & Fix12P4::IntMask();
 
-            const Common::Vec4<u8> result = {
-                output_merger.red_enable ? blend_output.r() : dest.r(),
-                output_merger.green_enable ? blend_output.g() : dest.g(),
-                output_merger.blue_enable ? blend_output.b() : dest.b(),
-                output_merger.alpha_enable ? blend_output.a() : dest.a(),
-            };
+    const auto viewport = GetViewportBounds();
+    min_x = std::max(min_x, viewport.left);
+    min_y = std::max(min_y, viewport.top);
+    max_x = std::min(max_x, viewport.right);
+    max_y = std::min(max_y, viewport.bottom);
 
-            if (regs.framebuffer.framebuffer.allow_color_write != 0)
-                DrawPixel(x >> 4, y >> 4, result);
-        }
-    }
-}
+    if (min_x >= max_x || min_y >= max_y)
+        return {};
 
-void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2) {
-    ProcessTriangleInternal(v0, v1, v2);
+    return {static_cast<u16>(min_x >> 4), static_cast<u16>(min_y >> 4),
+            static_cast<u16>(max_x >> 4), static_cast<u16>(max_y >> 4)};
 }
 
 } // namespace Pica::Rasterizer
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "common/math_util.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica::Rasterizer {
@@ -41,4 +42,32 @@ struct Vertex : Shader::OutputVertex {
 
 void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2);
 
+/**
+ * Rasterizes only the pixels of the triangle that fall inside the given tile. Rasterizing a
+ * triangle once for each tile of a partition of the screen gives the same result as a single
+ * ProcessTriangle call.
+ * @param tile Region in pixels, with right/bottom exclusive
+ */
+void ProcessTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2,
+                     const Common::Rectangle<u16>& tile);
+
+/**
+ * Returns the pixel region (right/bottom exclusive) that ProcessTriangle visits for the given
+ * triangle, taking the viewport and the scissor box into account. Empty if no pixel can be
+ * covered.
+ */
+Common::Rectangle<u16> GetTriangleBounds(const Vertex& v0, const Vertex& v1, const Vertex& v2);
+
+/**
+ * Decodes the light registers, and the lighting LUTs if requested, into the tables used by the
+ * rasterization. Must be called after they change, before rasterizing any triangle again.
+ */
+void UpdateLightingTables(bool update_luts);
+
+/**
+ * Decodes the procedural texture registers and LUTs into the tables used by the rasterization.
+ * Must be called after they change, before rasterizing any triangle again.
+ */
+void UpdateProcTexTables();
+
 } // namespace Pica::Rasterizer
@@ -0,0 +1,577 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "video_core/swrasterizer/framebuffer.h"
+#include "video_core/swrasterizer/span.h"
+#include "video_core/swrasterizer/texturing.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+namespace Pica::Rasterizer {
+
+using TevStageConfig = TexturingRegs::TevStageConfig;
+using BlendEquation = FramebufferRegs::BlendEquation;
+using BlendFactor = FramebufferRegs::BlendFactor;
+
+static_assert(sizeof(Common::Vec4<u8>) == 4, "Spans are loaded as packed RGBA8 data");
+
+static Common::Vec4<u8> CombineFragment(TevStageConfig::Operation color_op,
+                                        TevStageConfig::Operation alpha_op,
+                                        const Common::Vec4<u8>& input0,
+                                        const Common::Vec4<u8>& input1,
+                                        const Common::Vec4<u8>& input2) {
+    const Common::Vec3<u8> color_input[3] = {
+        Common::MakeVec(input0.r(), input0.g(), input0.b()),
+        Common::MakeVec(input1.r(), input1.g(), input1.b()),
+        Common::MakeVec(input2.r(), input2.g(), input2.b()),
+    };
+    const auto color = ColorCombine(color_op, color_input);
+    if (color_op == TevStageConfig::Operation::Dot3_RGBA) {
+        // result of Dot3_RGBA operation is also placed to the alpha component
+        return {color.r(), color.g(), color.b(), color.x};
+    }
+    const u8 alpha = AlphaCombine(alpha_op, {input0.a(), input1.a(), input2.a()});
+    return {color.r(), color.g(), color.b(), alpha};
+}
+
+static u8 LookupBlendFactor(unsigned channel, BlendFactor factor, const Common::Vec4<u8>& src,
+                            const Common::Vec4<u8>& dest, const Common::Vec4<u8>& blend_const) {
+    DEBUG_ASSERT(channel < 4);
+
+    switch (factor) {
+    case BlendFactor::Zero:
+        return 0;
+
+    case BlendFactor::One:
+        return 255;
+
+    case BlendFactor::SourceColor:
+        return src[channel];
+
+    case BlendFactor::OneMinusSourceColor:
+        return 255 - src[channel];
+
+    case BlendFactor::DestColor:
+        return dest[channel];
+
+    case BlendFactor::OneMinusDestColor:
+        return 255 - dest[channel];
+
+    case BlendFactor::SourceAlpha:
+        return src.a();
+
+    case BlendFactor::OneMinusSourceAlpha:
+        return 255 - src.a();
+
+    case BlendFactor::DestAlpha:
+        return dest.a();
+
+    case BlendFactor::OneMinusDestAlpha:
+        return 255 - dest.a();
+
+    case BlendFactor::ConstantColor:
+        return blend_const[channel];
+
+    case BlendFactor::OneMinusConstantColor:
+        return 255 - blend_const[channel];
+
+    case BlendFactor::ConstantAlpha:
+        return blend_const.a();
+
+    case BlendFactor::OneMinusConstantAlpha:
+        return 255 - blend_const.a();
+
+    case BlendFactor::SourceAlphaSaturate:
+        // Returns 1.0 for the alpha channel
+        if (channel == 3)
+            return 255;
+        return std::min(src.a(), static_cast<u8>(255 - dest.a()));
+
+    default:
+        LOG_CRITICAL(HW_GPU, "Unknown blend factor {:x}", static_cast<u32>(factor));
+        UNIMPLEMENTED();
+        break;
+    }
+
+    return src[channel];
+}
+
+static Common::Vec4<u8> BlendFragment(const Common::Vec4<u8>& src, const Common::Vec4<u8>& dest,
+                                      const BlendState& state) {
+    const auto srcfactor = Common::MakeVec(
+        LookupBlendFactor(0, state.factor_source_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(1, state.factor_source_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(2, state.factor_source_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(3, state.factor_source_a, src, dest, state.blend_const));
+
+    const auto dstfactor = Common::MakeVec(
+        LookupBlendFactor(0, state.factor_dest_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(1, state.factor_dest_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(2, state.factor_dest_rgb, src, dest, state.blend_const),
+        LookupBlendFactor(3, state.factor_dest_a, src, dest, state.blend_const));
+
+    auto output = EvaluateBlendEquation(src, srcfactor, dest, dstfactor, state.equation_rgb);
+    output.a() = EvaluateBlendEquation(src, srcfactor, dest, dstfactor, state.equation_a).a();
+    return output;
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+// Four RGBA8 fragments fit in one register. Products of two channels are computed in 16-bit
+// lanes, after unpacking the low and high two fragments separately.
+
+static __m128i Load(const Common::Vec4<u8>* fragments) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(fragments));
+}
+
+static void Store(Common::Vec4<u8>* fragments, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(fragments), value);
+}
+
+static __m128i AlphaMask() {
+    return _mm_set1_epi32(static_cast<int>(0xFF000000));
+}
+
+/// Takes RGB from color and A from alpha
+static __m128i MergeAlpha(__m128i color, __m128i alpha) {
+    const __m128i mask = AlphaMask();
+    return _mm_or_si128(_mm_andnot_si128(mask, color), _mm_and_si128(mask, alpha));
+}
+
+/// Exact x / 255 for all unsigned 16-bit lanes
+static __m128i Div255(__m128i x) {
+    return _mm_srli_epi16(_mm_mulhi_epu16(x, _mm_set1_epi16(static_cast<s16>(0x8081))), 7);
+}
+
+/// a * b / 255 for each byte
+static __m128i MulDiv255(__m128i a, __m128i b) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo =
+        Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+    const __m128i hi =
+        Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+    return _mm_packus_epi16(lo, hi);
+}
+
+/// Copies the alpha channel of every fragment into all four of its channels
+static __m128i BroadcastAlpha(__m128i x) {
+    const __m128i a = _mm_srli_epi32(x, 24);
+    const __m128i aa = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+    return _mm_or_si128(aa, _mm_slli_epi32(aa, 16));
+}
+
+/// Per-channel combiner math. Returns false if the operation has no vector implementation.
+static bool CombineChannels(TevStageConfig::Operation op, __m128i a, __m128i b, __m128i c,
+                            __m128i& output) {
+    using Operation = TevStageConfig::Operation;
+    const __m128i zero = _mm_setzero_si128();
+
+    switch (op) {
+    case Operation::Replace:
+        output = a;
+        return true;
+
+    case Operation::Modulate:
+        output = MulDiv255(a, b);
+        return true;
+
+    case Operation::Add:
+        output = _mm_adds_epu8(a, b);
+        return true;
+
+    case Operation::AddSigned: {
+        // The sum minus 128 stays within a signed 16-bit lane, and packing saturates to [0, 255]
+        const __m128i bias = _mm_set1_epi16(128);
+        const __m128i lo = _mm_sub_epi16(
+            _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)), bias);
+        const __m128i hi = _mm_sub_epi16(
+            _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)), bias);
+        output = _mm_packus_epi16(lo, hi);
+        return true;
+    }
+
+    case Operation::Lerp: {
+        // a * c + b * (255 - c) is at most 255 * 255, so it fits an unsigned 16-bit lane
+        const __m128i inv_c = _mm_xor_si128(c, _mm_set1_epi8(-1));
+        const __m128i lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero)),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(inv_c, zero)));
+        const __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero)),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(inv_c, zero)));
+        output = _mm_packus_epi16(Div255(lo), Div255(hi));
+        return true;
+    }
+
+    case Operation::Subtract:
+        output = _mm_subs_epu8(a, b);
+        return true;
+
+    case Operation::MultiplyThenAdd:
+        // (a * b + 255 * c) / 255 == a * b / 255 + c
+        output = _mm_adds_epu8(MulDiv255(a, b), c);
+        return true;
+
+    case Operation::AddThenMultiply:
+        output = MulDiv255(_mm_adds_epu8(a, b), c);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/// Vector version of LookupBlendFactor, valid for the RGB channels and for the alpha channel
+static bool LookupBlendFactors(BlendFactor factor, __m128i src, __m128i dest, __m128i blend_const,
+                               __m128i& output) {
+    const __m128i ones = _mm_set1_epi8(-1);
+
+    switch (factor) {
+    case BlendFactor::Zero:
+        output = _mm_setzero_si128();
+        return true;
+
+    case BlendFactor::One:
+        output = ones;
+        return true;
+
+    case BlendFactor::SourceColor:
+        output = src;
+        return true;
+
+    case BlendFactor::OneMinusSourceColor:
+        output = _mm_xor_si128(src, ones);
+        return true;
+
+    case BlendFactor::DestColor:
+        output = dest;
+        return true;
+
+    case BlendFactor::OneMinusDestColor:
+        output = _mm_xor_si128(dest, ones);
+        return true;
+
+    case BlendFactor::SourceAlpha:
+        output = BroadcastAlpha(src);
+        return true;
+
+    case BlendFactor::OneMinusSourceAlpha:
+        output = _mm_xor_si128(BroadcastAlpha(src), ones);
+        return true;
+
+    case BlendFactor::DestAlpha:
+        output = BroadcastAlpha(dest);
+        return true;
+
+    case BlendFactor::OneMinusDestAlpha:
+        output = _mm_xor_si128(BroadcastAlpha(dest), ones);
+        return true;
+
+    case BlendFactor::ConstantColor:
+        output = blend_const;
+        return true;
+
+    case BlendFactor::OneMinusConstantColor:
+        output = _mm_xor_si128(blend_const, ones);
+        return true;
+
+    case BlendFactor::ConstantAlpha:
+        output = BroadcastAlpha(blend_const);
+        return true;
+
+    case BlendFactor::OneMinusConstantAlpha:
+        output = _mm_xor_si128(BroadcastAlpha(blend_const), ones);
+        return true;
+
+    case BlendFactor::SourceAlphaSaturate:
+        // Returns 1.0 for the alpha channel
+        output = _mm_or_si128(
+            _mm_min_epu8(BroadcastAlpha(src), _mm_xor_si128(BroadcastAlpha(dest), ones)),
+            AlphaMask());
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/// Vector version of EvaluateBlendEquation
+static bool BlendChannels(BlendEquation equation, __m128i src, __m128i srcfactor, __m128i dest,
+                          __m128i destfactor, __m128i& output) {
+    const __m128i zero = _mm_setzero_si128();
+
+    switch (equation) {
+    case BlendEquation::Add:
+    case BlendEquation::Subtract:
+    case BlendEquation::ReverseSubtract: {
+        const __m128i src_lo =
+            _mm_mullo_epi16(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(srcfactor, zero));
+        const __m128i src_hi =
+            _mm_mullo_epi16(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(srcfactor, zero));
+        const __m128i dst_lo =
+            _mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), _mm_unpacklo_epi8(destfactor, zero));
+        const __m128i dst_hi =
+            _mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), _mm_unpackhi_epi8(destfactor, zero));
+
+        // Saturating sums only differ from the exact ones once the quotient exceeds 255, and
+        // saturating differences produce the clamp to zero.
+        __m128i lo, hi;
+        if (equation == BlendEquation::Add) {
+            lo = _mm_adds_epu16(src_lo, dst_lo);
+            hi = _mm_adds_epu16(src_hi, dst_hi);
+        } else if (equation == BlendEquation::Subtract) {
+            lo = _mm_subs_epu16(src_lo, dst_lo);
+            hi = _mm_subs_epu16(src_hi, dst_hi);
+        } else {
+            lo = _mm_subs_epu16(dst_lo, src_lo);
+            hi = _mm_subs_epu16(dst_hi, src_hi);
+        }
+        output = _mm_packus_epi16(Div255(lo), Div255(hi));
+        return true;
+    }
+
+    case BlendEquation::Min:
+        output = _mm_min_epu8(src, dest);
+        return true;
+
+    case BlendEquation::Max:
+        output = _mm_max_epu8(src, dest);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+/// Copies the given channel, or the RGB channels if negative, to the RGB channels of the output
+template <int Channel, bool Invert>
+static void ModifyColors(const Common::Vec4<u8>* input, Common::Vec4<u8>* output,
+                         std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t c = 0; c < 3; ++c) {
+            const u8 value = input[i][Channel < 0 ? c : static_cast<std::size_t>(Channel)];
+            output[i][c] = Invert ? 255 - value : value;
+        }
+    }
+}
+
+/// Copies the given channel to the alpha channel of the output
+template <int Channel, bool Invert>
+static void ModifyAlphas(const Common::Vec4<u8>* input, Common::Vec4<u8>* output,
+                         std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const u8 value = input[i][Channel];
+        output[i].a() = Invert ? 255 - value : value;
+    }
+}
+
+void ModifyColorSpan(TevStageConfig::ColorModifier modifier, const Common::Vec4<u8>* input,
+                     Common::Vec4<u8>* output, std::size_t count) {
+    using ColorModifier = TevStageConfig::ColorModifier;
+
+    switch (modifier) {
+    case ColorModifier::SourceColor:
+        return ModifyColors<-1, false>(input, output, count);
+    case ColorModifier::OneMinusSourceColor:
+        return ModifyColors<-1, true>(input, output, count);
+    case ColorModifier::SourceAlpha:
+        return ModifyColors<3, false>(input, output, count);
+    case ColorModifier::OneMinusSourceAlpha:
+        return ModifyColors<3, true>(input, output, count);
+    case ColorModifier::SourceRed:
+        return ModifyColors<0, false>(input, output, count);
+    case ColorModifier::OneMinusSourceRed:
+        return ModifyColors<0, true>(input, output, count);
+    case ColorModifier::SourceGreen:
+        return ModifyColors<1, false>(input, output, count);
+    case ColorModifier::OneMinusSourceGreen:
+        return ModifyColors<1, true>(input, output, count);
+    case ColorModifier::SourceBlue:
+        return ModifyColors<2, false>(input, output, count);
+    case ColorModifier::OneMinusSourceBlue:
+        return ModifyColors<2, true>(input, output, count);
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto color = GetColorModifier(modifier, input[i]);
+        output[i] = Common::MakeVec(color, output[i].a());
+    }
+}
+
+void ModifyAlphaSpan(TevStageConfig::AlphaModifier modifier, const Common::Vec4<u8>* input,
+                     Common::Vec4<u8>* output, std::size_t count) {
+    using AlphaModifier = TevStageConfig::AlphaModifier;
+
+    switch (modifier) {
+    case AlphaModifier::SourceAlpha:
+        return ModifyAlphas<3, false>(input, output, count);
+    case AlphaModifier::OneMinusSourceAlpha:
+        return ModifyAlphas<3, true>(input, output, count);
+    case AlphaModifier::SourceRed:
+        return ModifyAlphas<0, false>(input, output, count);
+    case AlphaModifier::OneMinusSourceRed:
+        return ModifyAlphas<0, true>(input, output, count);
+    case AlphaModifier::SourceGreen:
+        return ModifyAlphas<1, false>(input, output, count);
+    case AlphaModifier::OneMinusSourceGreen:
+        return ModifyAlphas<1, true>(input, output, count);
+    case AlphaModifier::SourceBlue:
+        return ModifyAlphas<2, false>(input, output, count);
+    case AlphaModifier::OneMinusSourceBlue:
+        return ModifyAlphas<2, true>(input, output, count);
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        output[i].a() = GetAlphaModifier(modifier, input[i]);
+    }
+}
+
+void CombineSpan(TevStageConfig::Operation color_op, TevStageConfig::Operation alpha_op,
+                 const Common::Vec4<u8>* input0, const Common::Vec4<u8>* input1,
+                 const Common::Vec4<u8>* input2, Common::Vec4<u8>* output, std::size_t count) {
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    for (; i + 4 <= count; i += 4) {
+        const __m128i a = Load(input0 + i);
+        const __m128i b = Load(input1 + i);
+        const __m128i c = Load(input2 + i);
+
+        __m128i color, alpha;
+        if (!CombineChannels(color_op, a, b, c, color))
+            break;
+        if (alpha_op == color_op) {
+            alpha = color;
+        } else if (!CombineChannels(alpha_op, a, b, c, alpha)) {
+            break;
+        }
+        Store(output + i, MergeAlpha(color, alpha));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        output[i] = CombineFragment(color_op, alpha_op, input0[i], input1[i], input2[i]);
+    }
+}
+
+void ScaleSpan(Common::Vec4<u8>* colors, unsigned color_multiplier, unsigned alpha_multiplier,
+               std::size_t count) {
+    if (color_multiplier == 1 && alpha_multiplier == 1)
+        return;
+
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    const s16 color_mul = static_cast<s16>(color_multiplier);
+    const s16 alpha_mul = static_cast<s16>(alpha_multiplier);
+    const __m128i multiplier = _mm_setr_epi16(color_mul, color_mul, color_mul, alpha_mul,
+                                              color_mul, color_mul, color_mul, alpha_mul);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i value = Load(colors + i);
+        const __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), multiplier);
+        const __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(value, zero), multiplier);
+        Store(colors + i, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        auto& color = colors[i];
+        color.r() = std::min(255u, color.r() * color_multiplier);
+        color.g() = std::min(255u, color.g() * color_multiplier);
+        color.b() = std::min(255u, color.b() * color_multiplier);
+        color.a() = std::min(255u, color.a() * alpha_multiplier);
+    }
+}
+
+void FogSpan(Common::Vec4<u8>* colors, const float* fog_factors,
+             const Common::Vec3<u8>& fog_color, std::size_t count) {
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    // Evaluated in the same order as the scalar code so that the rounding is identical
+    const __m128 fog = _mm_setr_ps(fog_color.r(), fog_color.g(), fog_color.b(), 0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i value = Load(colors + i);
+        const __m128i lo = _mm_unpacklo_epi8(value, zero);
+        const __m128i hi = _mm_unpackhi_epi8(value, zero);
+        const __m128i channels[4] = {
+            _mm_unpacklo_epi16(lo, zero),
+            _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero),
+            _mm_unpackhi_epi16(hi, zero),
+        };
+
+        __m128i mixed[4];
+        for (std::size_t j = 0; j < 4; ++j) {
+            const __m128 factor = _mm_set1_ps(fog_factors[i + j]);
+            const __m128 color = _mm_cvtepi32_ps(channels[j]);
+            mixed[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(factor, color),
+                                                   _mm_mul_ps(_mm_sub_ps(one, factor), fog)));
+        }
+
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(mixed[0], mixed[1]),
+                                                _mm_packs_epi32(mixed[2], mixed[3]));
+        Store(colors + i, MergeAlpha(packed, value));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const float fog_factor = fog_factors[i];
+        for (unsigned channel = 0; channel < 3; channel++) {
+            colors[i][channel] = static_cast<u8>(fog_factor * colors[i][channel] +
+                                                 (1.0f - fog_factor) * fog_color[channel]);
+        }
+    }
+}
+
+void BlendSpan(const Common::Vec4<u8>* src, const Common::Vec4<u8>* dest,
+               Common::Vec4<u8>* output, const BlendState& state, std::size_t count) {
+    std::size_t i = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    const __m128i blend_const = _mm_set1_epi32(static_cast<int>(
+        state.blend_const.r() | (state.blend_const.g() << 8) | (state.blend_const.b() << 16) |
+        (static_cast<u32>(state.blend_const.a()) << 24)));
+    for (; i + 4 <= count; i += 4) {
+        const __m128i s = Load(src + i);
+        const __m128i d = Load(dest + i);
+
+        __m128i srcfactor_rgb, srcfactor_a, dstfactor_rgb, dstfactor_a;
+        if (!LookupBlendFactors(state.factor_source_rgb, s, d, blend_const, srcfactor_rgb) ||
+            !LookupBlendFactors(state.factor_source_a, s, d, blend_const, srcfactor_a) ||
+            !LookupBlendFactors(state.factor_dest_rgb, s, d, blend_const, dstfactor_rgb) ||
+            !LookupBlendFactors(state.factor_dest_a, s, d, blend_const, dstfactor_a)) {
+            break;
+        }
+        const __m128i srcfactor = MergeAlpha(srcfactor_rgb, srcfactor_a);
+        const __m128i dstfactor = MergeAlpha(dstfactor_rgb, dstfactor_a);
+
+        __m128i color, alpha;
+        if (!BlendChannels(state.equation_rgb, s, srcfactor, d, dstfactor, color))
+            break;
+        if (state.equation_a == state.equation_rgb) {
+            alpha = color;
+        } else if (!BlendChannels(state.equation_a, s, srcfactor, d, dstfactor, alpha)) {
+            break;
+        }
+        Store(output + i, MergeAlpha(color, alpha));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        output[i] = BlendFragment(src[i], dest[i], state);
+    }
+}
+
+} // namespace Pica::Rasterizer
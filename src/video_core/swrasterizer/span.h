@@ -0,0 +1,67 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/regs_framebuffer.h"
+#include "video_core/regs_texturing.h"
+
+namespace Pica::Rasterizer {
+
+/**
+ * Operations on spans of fragments. Each function handles `count` fragments stored back to back,
+ * using SSE2 where available and the scalar per-fragment code otherwise. The results are bit
+ * exact with ColorCombine, AlphaCombine and EvaluateBlendEquation.
+ */
+
+/// Maximum number of fragments the rasterizer shades together
+constexpr std::size_t SPAN_SIZE = 8;
+
+/**
+ * Applies a TEV color modifier to each input, writing the RGB channels of the outputs. The
+ * modifier is resolved once for the span instead of for every fragment.
+ */
+void ModifyColorSpan(TexturingRegs::TevStageConfig::ColorModifier modifier,
+                     const Common::Vec4<u8>* input, Common::Vec4<u8>* output, std::size_t count);
+
+/// Applies a TEV alpha modifier to each input, writing the alpha channel of the outputs
+void ModifyAlphaSpan(TexturingRegs::TevStageConfig::AlphaModifier modifier,
+                     const Common::Vec4<u8>* input, Common::Vec4<u8>* output, std::size_t count);
+
+/**
+ * Runs a TEV stage's combiner math: RGB with color_op and alpha with alpha_op. Dot3_RGBA also
+ * writes the dot product to the alpha channel, ignoring alpha_op.
+ */
+void CombineSpan(TexturingRegs::TevStageConfig::Operation color_op,
+                 TexturingRegs::TevStageConfig::Operation alpha_op, const Common::Vec4<u8>* input0,
+                 const Common::Vec4<u8>* input1, const Common::Vec4<u8>* input2,
+                 Common::Vec4<u8>* output, std::size_t count);
+
+/// Applies the TEV stage output scale, saturating each channel at 255
+void ScaleSpan(Common::Vec4<u8>* colors, unsigned color_multiplier, unsigned alpha_multiplier,
+               std::size_t count);
+
+/// Mixes the RGB channels towards the fog color, weighting the fragment color by fog_factors[i]
+void FogSpan(Common::Vec4<u8>* colors, const float* fog_factors,
+             const Common::Vec3<u8>& fog_color, std::size_t count);
+
+/// Alpha blending parameters, unpacked from the output merger registers
+struct BlendState {
+    FramebufferRegs::BlendEquation equation_rgb;
+    FramebufferRegs::BlendEquation equation_a;
+    FramebufferRegs::BlendFactor factor_source_rgb;
+    FramebufferRegs::BlendFactor factor_dest_rgb;
+    FramebufferRegs::BlendFactor factor_source_a;
+    FramebufferRegs::BlendFactor factor_dest_a;
+    Common::Vec4<u8> blend_const;
+};
+
+/// Blends the source fragments with the destination pixels
+void BlendSpan(const Common::Vec4<u8>* src, const Common::Vec4<u8>* dest,
+               Common::Vec4<u8>* output, const BlendState& state, std::size_t count);
+
+} // namespace Pica::Rasterizer
@@ -2,15 +2,172 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <thread>
+#include "common/microprofile.h"
+#include "video_core/regs.h"
 #include "video_core/swrasterizer/clipper.h"
+#include "video_core/swrasterizer/framebuffer.h"
 #include "video_core/swrasterizer/swrasterizer.h"
+#include "video_core/swrasterizer/texture_cache.h"
+#include "video_core/video_core.h"
 
 namespace VideoCore {
 
+MICROPROFILE_DEFINE(GPU_TileRasterization, "GPU", "Tile Rasterization", MP_RGB(70, 70, 240));
+
+static std::size_t GetNumRasterizerWorkers() {
+    return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+SWRasterizer::SWRasterizer()
+    : bins(TILES_PER_AXIS * TILES_PER_AXIS), pool(GetNumRasterizerWorkers(), "SwRasterizer") {}
+
+SWRasterizer::~SWRasterizer() = default;
+
 void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
                                const Pica::Shader::OutputVertex& v1,
                                const Pica::Shader::OutputVertex& v2) {
-    Pica::Clipper::ProcessTriangle(v0, v1, v2);
+    // The registers are fixed for the whole draw, binned triangles included
+    SyncTables();
+
+    if (!g_parallel_sw_rasterizer) {
+        // Keep the output ordered if the setting was turned off in the middle of a draw
+        FlushTiles();
+        Pica::Clipper::ProcessTriangle(v0, v1, v2);
+        return;
+    }
+
+    Pica::Clipper::ProcessTriangle(v0, v1, v2,
+                                   [this](const Pica::Rasterizer::Vertex& vtx0,
+                                          const Pica::Rasterizer::Vertex& vtx1,
+                                          const Pica::Rasterizer::Vertex& vtx2) {
+                                       BinTriangle(vtx0, vtx1, vtx2);
+                                   });
+}
+
+void SWRasterizer::AddTriangles(const Pica::Shader::OutputVertex* vertices,
+                                std::size_t num_triangles) {
+    for (std::size_t i = 0; i < num_triangles; ++i, vertices += 3) {
+        SWRasterizer::AddTriangle(vertices[0], vertices[1], vertices[2]);
+    }
+}
+
+void SWRasterizer::DrawTriangles() {
+    // Triangles are only binned between draw calls, which keeps the rasterizer registers fixed
+    // for everything that is pending here.
+    FlushTiles();
+
+    // Until the next draw, the depth buffer and the textures may be written by the CPU, filled
+    // or moved
+    Pica::Rasterizer::InvalidateDepthBounds();
+    Pica::Rasterizer::DecodedTextureCache::InvalidateAll();
+}
+
+void SWRasterizer::NotifyPicaRegisterChanged(u32 id) {
+    constexpr u32 lighting_begin = PICA_REG_INDEX(lighting);
+    constexpr u32 lighting_end = lighting_begin + sizeof(Pica::LightingRegs) / sizeof(u32);
+    if (id >= lighting_begin && id < lighting_end) {
+        lighting_dirty = true;
+    }
+    if (id >= PICA_REG_INDEX(lighting.lut_data[0]) && id <= PICA_REG_INDEX(lighting.lut_data[7])) {
+        lighting_luts_dirty = true;
+    }
+    if (id >= PICA_REG_INDEX(texturing.proctex) &&
+        id <= PICA_REG_INDEX(texturing.proctex_lut_data[7])) {
+        proctex_dirty = true;
+    }
+}
+
+void SWRasterizer::FlushAll() {
+    FlushTiles();
+}
+
+void SWRasterizer::FlushRegion(PAddr addr, u32 size) {
+    FlushTiles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    FlushTiles();
+}
+
+void SWRasterizer::ClearAll(bool flush) {
+    FlushTiles();
+}
+
+void SWRasterizer::SyncEntireState() {
+    lighting_dirty = true;
+    lighting_luts_dirty = true;
+    proctex_dirty = true;
+}
+
+void SWRasterizer::SyncTables() {
+    if (lighting_dirty) {
+        Pica::Rasterizer::UpdateLightingTables(lighting_luts_dirty);
+        lighting_dirty = false;
+        lighting_luts_dirty = false;
+    }
+    if (proctex_dirty) {
+        Pica::Rasterizer::UpdateProcTexTables();
+        proctex_dirty = false;
+    }
+}
+
+void SWRasterizer::BinTriangle(const Pica::Rasterizer::Vertex& v0,
+                               const Pica::Rasterizer::Vertex& v1,
+                               const Pica::Rasterizer::Vertex& v2) {
+    const auto bounds = Pica::Rasterizer::GetTriangleBounds(v0, v1, v2);
+    if (bounds.left >= bounds.right || bounds.top >= bounds.bottom) {
+        return;
+    }
+
+    const u32 index = static_cast<u32>(triangles.size());
+    triangles.push_back({v0, v1, v2});
+
+    const u32 first_x = std::min<u32>(bounds.left / TILE_SIZE, TILES_PER_AXIS - 1);
+    const u32 first_y = std::min<u32>(bounds.top / TILE_SIZE, TILES_PER_AXIS - 1);
+    const u32 last_x = std::min<u32>((bounds.right - 1) / TILE_SIZE, TILES_PER_AXIS - 1);
+    const u32 last_y = std::min<u32>((bounds.bottom - 1) / TILE_SIZE, TILES_PER_AXIS - 1);
+    for (u32 y = first_y; y <= last_y; ++y) {
+        for (u32 x = first_x; x <= last_x; ++x) {
+            const u32 tile = y * TILES_PER_AXIS + x;
+            auto& bin = bins[tile];
+            if (bin.empty()) {
+                active_tiles.push_back(tile);
+            }
+            bin.push_back(index);
+        }
+    }
+}
+
+void SWRasterizer::FlushTiles() {
+    if (active_tiles.empty()) {
+        triangles.clear();
+        return;
+    }
+
+    pool.ParallelFor(active_tiles.size(), 1, [this](std::size_t begin, std::size_t end) {
+        MICROPROFILE_SCOPE(GPU_TileRasterization);
+        for (std::size_t i = begin; i < end; ++i) {
+            const u32 tile = active_tiles[i];
+            const u32 tile_x = tile % TILES_PER_AXIS;
+            const u32 tile_y = tile / TILES_PER_AXIS;
+            const Common::Rectangle<u16> region{
+                static_cast<u16>(tile_x * TILE_SIZE), static_cast<u16>(tile_y * TILE_SIZE),
+                static_cast<u16>((tile_x + 1) * TILE_SIZE),
+                static_cast<u16>((tile_y + 1) * TILE_SIZE)};
+
+            auto& bin = bins[tile];
+            for (const u32 index : bin) {
+                const auto& triangle = triangles[index];
+                Pica::Rasterizer::ProcessTriangle(triangle[0], triangle[1], triangle[2], region);
+            }
+            bin.clear();
+        }
+    });
+
+    active_tiles.clear();
+    triangles.clear();
 }
 
 } // namespace VideoCore
@@ -4,8 +4,12 @@
 
 #pragma once
 
+#include <array>
+#include <vector>
 #include "common/common_types.h"
+#include "common/thread_pool.h"
 #include "video_core/rasterizer_interface.h"
+#include "video_core/swrasterizer/rasterizer.h"
 
 namespace Pica::Shader {
 struct OutputVertex;
@@ -13,16 +17,62 @@ struct OutputVertex;
 
 namespace VideoCore {
 
+/**
+ * Software rasterizer frontend. When parallel rasterization is enabled, the clipped triangles of
+ * a draw are binned into screen-space tiles instead of being rasterized right away. The tiles are
+ * then rasterized concurrently at the next flush point. Tiles never share pixels and each tile
+ * processes its triangles in submission order, so depth, stencil and blending results are the
+ * same as when rasterizing serially.
+ */
 class SWRasterizer : public RasterizerInterface {
+public:
+    SWRasterizer();
+    ~SWRasterizer() override;
+
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
-    void DrawTriangles() override {}
-    void NotifyPicaRegisterChanged(u32 id) override {}
-    void FlushAll() override {}
-    void FlushRegion(PAddr addr, u32 size) override {}
+    void AddTriangles(const Pica::Shader::OutputVertex* vertices,
+                      std::size_t num_triangles) override;
+    void DrawTriangles() override;
+    void NotifyPicaRegisterChanged(u32 id) override;
+    void FlushAll() override;
+    void FlushRegion(PAddr addr, u32 size) override;
     void InvalidateRegion(PAddr addr, u32 size) override {}
-    void FlushAndInvalidateRegion(PAddr addr, u32 size) override {}
-    void ClearAll(bool flush) override {}
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
+    void ClearAll(bool flush) override;
+    void SyncEntireState() override;
+
+private:
+    using Triangle = std::array<Pica::Rasterizer::Vertex, 3>;
+
+    /// Width and height of a bin in pixels
+    static constexpr u32 TILE_SIZE = 32;
+    /// Bins per axis. Rasterizer coordinates are 12.4 fixed point, so 4096 pixels cover them all.
+    static constexpr u32 TILES_PER_AXIS = 4096 / TILE_SIZE;
+
+    /// Records a clipped triangle in every bin its bounding box touches
+    void BinTriangle(const Pica::Rasterizer::Vertex& v0, const Pica::Rasterizer::Vertex& v1,
+                     const Pica::Rasterizer::Vertex& v2);
+
+    /// Rasterizes and clears all binned triangles
+    void FlushTiles();
+
+    /// Rebuilds the lighting and procedural texture tables of the rasterizer that are out of date
+    void SyncTables();
+
+    std::vector<Triangle> triangles;
+    /// Indices into `triangles`, one list per tile in row-major order
+    std::vector<std::vector<u32>> bins;
+    /// Tiles with at least one triangle since the last flush
+    std::vector<u32> active_tiles;
+
+    /// Whether the light registers, the lighting LUTs and the procedural texture state changed
+    /// since the tables were last built
+    bool lighting_dirty = true;
+    bool lighting_luts_dirty = true;
+    bool proctex_dirty = true;
+
+    Common::ThreadPool pool;
 };
 
 } // namespace VideoCore
@@ -0,0 +1,56 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include "video_core/swrasterizer/texture_cache.h"
+
+namespace Pica::Rasterizer {
+
+void DecodedTexture::Reset(const u8* texture_source, const Texture::TextureInfo& texture_info,
+                           u32 texture_generation) {
+    source = texture_source;
+    info = texture_info;
+    generation = texture_generation;
+    tiles_per_row = (info.width + 7) / 8;
+    const std::size_t num_tiles = tiles_per_row * ((info.height + 7) / 8);
+    texels.resize(num_tiles * 64);
+    decoded_tiles.assign(num_tiles, 0);
+}
+
+void DecodedTexture::DecodeTile(std::size_t tile) {
+    const std::size_t tile_x = tile % tiles_per_row;
+    const std::size_t tile_y = tile / tiles_per_row;
+    const u8* tile_source =
+        source + tile_y * info.stride + tile_x * Texture::CalculateTileSize(info.format);
+    Texture::DecodeTile(tile_source, info, texels.data() + tile * 64);
+    decoded_tiles[tile] = 1;
+}
+
+DecodedTextureCache& DecodedTextureCache::GetThreadInstance() {
+    thread_local DecodedTextureCache instance;
+    return instance;
+}
+
+DecodedTexture& DecodedTextureCache::Get(const u8* source, const Texture::TextureInfo& info) {
+    const u32 current_generation = generation.load(std::memory_order_relaxed);
+    const auto it = std::find_if(textures.begin(), textures.end(), [&](const auto& texture) {
+        return texture.generation == current_generation && texture.Matches(source, info);
+    });
+    if (it != textures.end()) {
+        return *it;
+    }
+
+    // The textures of an older draw go first
+    auto replaced = std::find_if(textures.begin(), textures.end(), [&](const auto& texture) {
+        return texture.generation != current_generation;
+    });
+    if (replaced == textures.end()) {
+        replaced = textures.begin() + next_replaced;
+        next_replaced = (next_replaced + 1) % NumTextures;
+    }
+    replaced->Reset(source, info, current_generation);
+    return *replaced;
+}
+
+} // namespace Pica::Rasterizer
@@ -0,0 +1,86 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/texture/texture_decode.h"
+
+namespace Pica::Rasterizer {
+
+/**
+ * A texture decoded to RGBA8 as it is sampled. Each 8x8 tile is decoded the first time one of its
+ * texels is looked up, after which a lookup is a single load.
+ */
+class DecodedTexture {
+public:
+    /// Whether this is the texture at the given address with the given layout
+    bool Matches(const u8* texture_source, const Texture::TextureInfo& texture_info) const {
+        return source == texture_source && info.format == texture_info.format &&
+               info.width == texture_info.width && info.height == texture_info.height &&
+               info.stride == texture_info.stride;
+    }
+
+    /// Returns the texel at the given coordinates, which must be inside the texture
+    Common::Vec4<u8> Lookup(unsigned s, unsigned t) {
+        const std::size_t tile = (t / 8) * tiles_per_row + s / 8;
+        if (!decoded_tiles[tile]) {
+            DecodeTile(tile);
+        }
+        // The texels are stored tile after tile, as Texture::DecodeTile outputs them
+        return texels[tile * 64 + (t % 8) * 8 + s % 8];
+    }
+
+private:
+    friend class DecodedTextureCache;
+
+    /// Starts over with another texture, keeping the allocations
+    void Reset(const u8* texture_source, const Texture::TextureInfo& texture_info,
+               u32 texture_generation);
+
+    void DecodeTile(std::size_t tile);
+
+    const u8* source = nullptr;
+    Texture::TextureInfo info{};
+    /// Generation of the caches the texture was decoded in, stale if not the current one
+    u32 generation = 0;
+    std::size_t tiles_per_row = 0;
+    std::vector<Common::Vec4<u8>> texels;
+    std::vector<u8> decoded_tiles;
+};
+
+/**
+ * The textures sampled by the software rasterizer during the current draw. Texture memory can't
+ * change in the middle of a draw, so the decoded texels stay valid until InvalidateAll is called
+ * after it. Every rasterizer thread has its own cache, which needs no locking.
+ */
+class DecodedTextureCache {
+public:
+    /// Returns the cache of the calling thread
+    static DecodedTextureCache& GetThreadInstance();
+
+    /// Drops the textures of the caches of every thread, for when texture memory may change
+    static void InvalidateAll() {
+        generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Returns the decoded texture for the given source, reusing the least recent one if needed
+    DecodedTexture& Get(const u8* source, const Texture::TextureInfo& info);
+
+private:
+    /// Enough for the six faces of a cube map and the two other units
+    static constexpr std::size_t NumTextures = 8;
+
+    static inline std::atomic<u32> generation{1};
+
+    std::array<DecodedTexture, NumTextures> textures;
+    std::size_t next_replaced = 0;
+};
+
+} // namespace Pica::Rasterizer
@@ -10,6 +10,10 @@
 #include "common/vector_math.h"
 #include "video_core/texture/etc1.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 namespace Pica::Texture {
 
 namespace {
@@ -69,19 +73,14 @@ union ETC1Tile {
         BitField<60, 4, u64> r1;
     } separate;
 
-    const Common::Vec3<u8> GetRGB(unsigned int x, unsigned int y) const {
-        int texel = 4 * x + y;
-
-        if (flip)
-            std::swap(x, y);
-
-        // Lookup base value
+    /// Base color of the first (x < 2 after flipping) or second half of the subtile
+    Common::Vec3<int> GetBaseColor(bool second_half) const {
         Common::Vec3<int> ret;
         if (differential_mode) {
             ret.r() = static_cast<int>(differential.r);
             ret.g() = static_cast<int>(differential.g);
             ret.b() = static_cast<int>(differential.b);
-            if (x >= 2) {
+            if (second_half) {
                 ret.r() += static_cast<int>(differential.dr);
                 ret.g() += static_cast<int>(differential.dg);
                 ret.b() += static_cast<int>(differential.db);
@@ -90,7 +89,7 @@ union ETC1Tile {
             ret.g() = Color::Convert5To8(ret.g());
             ret.b() = Color::Convert5To8(ret.b());
         } else {
-            if (x < 2) {
+            if (!second_half) {
                 ret.r() = Color::Convert4To8(static_cast<u8>(separate.r1));
                 ret.g() = Color::Convert4To8(static_cast<u8>(separate.g1));
                 ret.b() = Color::Convert4To8(static_cast<u8>(separate.b1));
@@ -100,12 +99,24 @@ union ETC1Tile {
                 ret.b() = Color::Convert4To8(static_cast<u8>(separate.b2));
             }
         }
+        return ret;
+    }
 
-        // Add modifier
-        unsigned table_index =
-            static_cast<int>((x < 2) ? table_index_1.Value() : table_index_2.Value());
+    const std::array<u8, 2>& GetModifiers(bool second_half) const {
+        return etc1_modifier_table[second_half ? table_index_2.Value() : table_index_1.Value()];
+    }
+
+    const Common::Vec3<u8> GetRGB(unsigned int x, unsigned int y) const {
+        int texel = 4 * x + y;
 
-        int modifier = etc1_modifier_table[table_index][GetTableSubIndex(texel)];
+        if (flip)
+            std::swap(x, y);
+
+        // Lookup base value
+        Common::Vec3<int> ret = GetBaseColor(x >= 2);
+
+        // Add modifier
+        int modifier = GetModifiers(x >= 2)[GetTableSubIndex(texel)];
         if (GetNegationFlag(texel))
             modifier *= -1;
 
@@ -124,4 +135,87 @@ Common::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y) {
     return tile.GetRGB(x, y);
 }
 
+#ifdef ARCHITECTURE_x86_64
+
+void DecodeETC1Subtile(u64 value, Common::Vec4<u8>* output) {
+    const ETC1Tile tile{value};
+
+    // Every 16-bit lane holds one texel, in output order (y * 4 + x). The per-texel bits of the
+    // block are indexed by 4 * x + y instead.
+    const __m128i texel_bits[2] = {
+        _mm_setr_epi16(1 << 0, 1 << 4, 1 << 8, 1 << 12, 1 << 1, 1 << 5, 1 << 9, 1 << 13),
+        _mm_setr_epi16(1 << 2, 1 << 6, 1 << 10, static_cast<s16>(1 << 14), 1 << 3, 1 << 7,
+                       1 << 11, static_cast<s16>(1 << 15)),
+    };
+    // Texels in the second half: x >= 2, or y >= 2 for flipped blocks
+    const __m128i second_half[2] = {
+        tile.flip ? _mm_setzero_si128() : _mm_setr_epi16(0, 0, -1, -1, 0, 0, -1, -1),
+        tile.flip ? _mm_set1_epi16(-1) : _mm_setr_epi16(0, 0, -1, -1, 0, 0, -1, -1),
+    };
+
+    const __m128i subindexes = _mm_set1_epi16(static_cast<s16>(tile.table_subindexes.Value()));
+    const __m128i negations = _mm_set1_epi16(static_cast<s16>(tile.negation_flags.Value()));
+
+    const auto& modifiers1 = tile.GetModifiers(false);
+    const auto& modifiers2 = tile.GetModifiers(true);
+    const Common::Vec3<int> base1 = tile.GetBaseColor(false);
+    const Common::Vec3<int> base2 = tile.GetBaseColor(true);
+
+    auto Select = [](__m128i mask, __m128i if_set, __m128i if_clear) {
+        return _mm_or_si128(_mm_and_si128(mask, if_set), _mm_andnot_si128(mask, if_clear));
+    };
+
+    __m128i channels[3][2];
+    for (std::size_t i = 0; i < 2; ++i) {
+        const __m128i use_high =
+            _mm_cmpeq_epi16(_mm_and_si128(subindexes, texel_bits[i]), texel_bits[i]);
+        const __m128i negate =
+            _mm_cmpeq_epi16(_mm_and_si128(negations, texel_bits[i]), texel_bits[i]);
+
+        const __m128i modifier1 =
+            Select(use_high, _mm_set1_epi16(modifiers1[1]), _mm_set1_epi16(modifiers1[0]));
+        const __m128i modifier2 =
+            Select(use_high, _mm_set1_epi16(modifiers2[1]), _mm_set1_epi16(modifiers2[0]));
+        __m128i modifier = Select(second_half[i], modifier2, modifier1);
+        // Two's complement negation of the lanes selected by the mask
+        modifier = _mm_sub_epi16(_mm_xor_si128(modifier, negate), negate);
+
+        for (std::size_t c = 0; c < 3; ++c) {
+            const __m128i base = Select(second_half[i], _mm_set1_epi16(static_cast<s16>(base2[c])),
+                                        _mm_set1_epi16(static_cast<s16>(base1[c])));
+            channels[c][i] = _mm_add_epi16(base, modifier);
+        }
+    }
+
+    // Packing saturates to [0, 255], which is the clamp of the scalar decoder
+    const __m128i r = _mm_packus_epi16(channels[0][0], channels[0][1]);
+    const __m128i g = _mm_packus_epi16(channels[1][0], channels[1][1]);
+    const __m128i b = _mm_packus_epi16(channels[2][0], channels[2][1]);
+    const __m128i a = _mm_set1_epi8(-1);
+
+    const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+    const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+    const __m128i ba_lo = _mm_unpacklo_epi8(b, a);
+    const __m128i ba_hi = _mm_unpackhi_epi8(b, a);
+
+    __m128i* const out = reinterpret_cast<__m128i*>(output);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg_lo, ba_lo));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg_hi, ba_hi));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg_hi, ba_hi));
+}
+
+#else
+
+void DecodeETC1Subtile(u64 value, Common::Vec4<u8>* output) {
+    const ETC1Tile tile{value};
+    for (unsigned int y = 0; y < 4; ++y) {
+        for (unsigned int x = 0; x < 4; ++x) {
+            output[y * 4 + x] = Common::MakeVec(tile.GetRGB(x, y), static_cast<u8>(255));
+        }
+    }
+}
+
+#endif
+
 } // namespace Pica::Texture
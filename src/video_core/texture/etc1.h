@@ -11,4 +11,10 @@ namespace Pica::Texture {
 
 Common::Vec3<u8> SampleETC1Subtile(u64 value, unsigned int x, unsigned int y);
 
+/**
+ * Decodes all texels of a 4x4 ETC1 subtile. Texel (x, y) is written to output[y * 4 + x], with
+ * its alpha set to 255.
+ */
+void DecodeETC1Subtile(u64 value, Common::Vec4<u8>* output);
+
 } // namespace Pica::Texture
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <array>
+#include <cstring>
 #include "common/assert.h"
 #include "common/color.h"
 #include "common/logging/log.h"
@@ -13,6 +15,10 @@
 #include "video_core/texture/texture_decode.h"
 #include "video_core/utils.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 using TextureFormat = Pica::TexturingRegs::TextureFormat;
 
 namespace Pica::Texture {
@@ -211,6 +217,217 @@ Common::Vec4<u8> LookupTexelInTile(const u8* source, unsigned int x, unsigned in
     }
 }
 
+#ifdef ARCHITECTURE_x86_64
+
+// The vector decoders below convert texels in memory (Morton) order. Each 16-bit lane holds one
+// texel, with the red and green channels built in `rg` and blue and alpha in `ba`.
+
+static void StoreRGBA(Common::Vec4<u8>* output, __m128i rg, __m128i ba) {
+    __m128i* const out = reinterpret_cast<__m128i*>(output);
+    _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg, ba));
+}
+
+/// Builds `low | (high << 8)` from two vectors of 16-bit lanes holding byte values
+static __m128i PackBytes(__m128i low, __m128i high) {
+    return _mm_or_si128(low, _mm_slli_epi16(high, 8));
+}
+
+/// Convert4To8 for 16-bit lanes
+static __m128i Expand4To8(__m128i value) {
+    return _mm_or_si128(value, _mm_slli_epi16(value, 4));
+}
+
+/// Convert5To8 for 16-bit lanes
+static __m128i Expand5To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+/// Convert6To8 for 16-bit lanes
+static __m128i Expand6To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 2), _mm_srli_epi16(value, 4));
+}
+
+static void Decode16BitTexels(TextureFormat format, const u8* source, Common::Vec4<u8>* output) {
+    const __m128i mask4 = _mm_set1_epi16(0xF);
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask6 = _mm_set1_epi16(0x3F);
+    const __m128i mask8 = _mm_set1_epi16(0xFF);
+
+    for (std::size_t i = 0; i < TILE_SIZE; i += 8) {
+        const __m128i pixel = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        __m128i r, g, b, a;
+        switch (format) {
+        case TextureFormat::RGB5A1:
+            r = Expand5To8(_mm_srli_epi16(pixel, 11));
+            g = Expand5To8(_mm_and_si128(_mm_srli_epi16(pixel, 6), mask5));
+            b = Expand5To8(_mm_and_si128(_mm_srli_epi16(pixel, 1), mask5));
+            a = _mm_and_si128(_mm_sub_epi16(_mm_setzero_si128(),
+                                            _mm_and_si128(pixel, _mm_set1_epi16(1))),
+                              mask8);
+            break;
+        case TextureFormat::RGB565:
+            r = Expand5To8(_mm_srli_epi16(pixel, 11));
+            g = Expand6To8(_mm_and_si128(_mm_srli_epi16(pixel, 5), mask6));
+            b = Expand5To8(_mm_and_si128(pixel, mask5));
+            a = mask8;
+            break;
+        case TextureFormat::RGBA4:
+            r = Expand4To8(_mm_srli_epi16(pixel, 12));
+            g = Expand4To8(_mm_and_si128(_mm_srli_epi16(pixel, 8), mask4));
+            b = Expand4To8(_mm_and_si128(_mm_srli_epi16(pixel, 4), mask4));
+            a = Expand4To8(_mm_and_si128(pixel, mask4));
+            break;
+        case TextureFormat::IA8:
+            r = g = b = _mm_srli_epi16(pixel, 8);
+            a = _mm_and_si128(pixel, mask8);
+            break;
+        default:
+            UNREACHABLE();
+        }
+        StoreRGBA(output + i, PackBytes(r, g), PackBytes(b, a));
+    }
+}
+
+/// Decodes 8 texels given as bytes in the low half of the 16-bit lanes of `value`
+static void DecodeByteTexels(TextureFormat format, __m128i value, Common::Vec4<u8>* output) {
+    const __m128i mask4 = _mm_set1_epi16(0xF);
+    const __m128i mask8 = _mm_set1_epi16(0xFF);
+
+    switch (format) {
+    case TextureFormat::I8:
+    case TextureFormat::I4:
+        StoreRGBA(output, PackBytes(value, value), PackBytes(value, mask8));
+        break;
+    case TextureFormat::A8:
+    case TextureFormat::A4:
+        StoreRGBA(output, _mm_setzero_si128(), _mm_slli_epi16(value, 8));
+        break;
+    case TextureFormat::IA4: {
+        const __m128i i = Expand4To8(_mm_srli_epi16(value, 4));
+        const __m128i a = Expand4To8(_mm_and_si128(value, mask4));
+        StoreRGBA(output, PackBytes(i, i), PackBytes(i, a));
+        break;
+    }
+    default:
+        UNREACHABLE();
+    }
+}
+
+static void Decode8BitTexels(TextureFormat format, const u8* source, Common::Vec4<u8>* output) {
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t i = 0; i < TILE_SIZE; i += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        DecodeByteTexels(format, _mm_unpacklo_epi8(bytes, zero), output + i);
+        DecodeByteTexels(format, _mm_unpackhi_epi8(bytes, zero), output + i + 8);
+    }
+}
+
+static void Decode4BitTexels(TextureFormat format, const u8* source, Common::Vec4<u8>* output) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask4 = _mm_set1_epi8(0xF);
+    for (std::size_t i = 0; i < TILE_SIZE; i += 32) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i / 2));
+        // Even texels are stored in the low nibble, odd texels in the high nibble
+        const __m128i low = _mm_and_si128(bytes, mask4);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask4);
+        const __m128i first = _mm_unpacklo_epi8(low, high);
+        const __m128i second = _mm_unpackhi_epi8(low, high);
+
+        // Nibble values shifted by 4 stay within their byte
+        const __m128i texels[2] = {_mm_or_si128(first, _mm_slli_epi16(first, 4)),
+                                   _mm_or_si128(second, _mm_slli_epi16(second, 4))};
+        for (std::size_t j = 0; j < 2; ++j) {
+            DecodeByteTexels(format, _mm_unpacklo_epi8(texels[j], zero), output + i + j * 16);
+            DecodeByteTexels(format, _mm_unpackhi_epi8(texels[j], zero), output + i + j * 16 + 8);
+        }
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+void DecodeTile(const u8* source, const TextureInfo& info, Common::Vec4<u8>* output) {
+    using VideoCore::MortonInterleave;
+
+    if (info.format == TextureFormat::ETC1 || info.format == TextureFormat::ETC1A4) {
+        const bool has_alpha = (info.format == TextureFormat::ETC1A4);
+        const std::size_t subtile_size = has_alpha ? 16 : 8;
+
+        for (unsigned int subtile_index = 0; subtile_index < ETC1_SUBTILES; ++subtile_index) {
+            const u8* subtile_ptr = source + subtile_index * subtile_size;
+
+            u64_le packed_alpha = 0;
+            if (has_alpha) {
+                memcpy(&packed_alpha, subtile_ptr, sizeof(u64));
+                subtile_ptr += sizeof(u64);
+            }
+
+            u64_le subtile_data;
+            memcpy(&subtile_data, subtile_ptr, sizeof(u64));
+
+            std::array<Common::Vec4<u8>, 16> subtile;
+            DecodeETC1Subtile(subtile_data, subtile.data());
+
+            const unsigned int base_x = (subtile_index % 2) * 4;
+            const unsigned int base_y = (subtile_index / 2) * 4;
+            for (unsigned int y = 0; y < 4; ++y) {
+                for (unsigned int x = 0; x < 4; ++x) {
+                    auto& texel = output[(base_y + y) * 8 + base_x + x];
+                    texel = subtile[y * 4 + x];
+                    if (has_alpha) {
+                        texel.a() = Color::Convert4To8((packed_alpha >> (4 * (x * 4 + y))) & 0xF);
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    // Decode the texels in memory order, then move them to their place in the tile
+    std::array<Common::Vec4<u8>, TILE_SIZE> texels;
+    bool decoded = false;
+
+#ifdef ARCHITECTURE_x86_64
+    switch (info.format) {
+    case TextureFormat::RGB5A1:
+    case TextureFormat::RGB565:
+    case TextureFormat::RGBA4:
+    case TextureFormat::IA8:
+        Decode16BitTexels(info.format, source, texels.data());
+        decoded = true;
+        break;
+    case TextureFormat::I8:
+    case TextureFormat::A8:
+    case TextureFormat::IA4:
+        Decode8BitTexels(info.format, source, texels.data());
+        decoded = true;
+        break;
+    case TextureFormat::I4:
+    case TextureFormat::A4:
+        Decode4BitTexels(info.format, source, texels.data());
+        decoded = true;
+        break;
+    default:
+        break;
+    }
+#endif
+
+    if (!decoded) {
+        for (unsigned int y = 0; y < 8; ++y) {
+            for (unsigned int x = 0; x < 8; ++x) {
+                output[y * 8 + x] = LookupTexelInTile(source, x, y, info, false);
+            }
+        }
+        return;
+    }
+
+    for (unsigned int y = 0; y < 8; ++y) {
+        for (unsigned int x = 0; x < 8; ++x) {
+            output[y * 8 + x] = texels[MortonInterleave(x, y)];
+        }
+    }
+}
+
 TextureInfo TextureInfo::FromPicaRegister(const TexturingRegs::TextureConfig& config,
                                           const TexturingRegs::TextureFormat& format) {
     TextureInfo info;
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <memory>
 #include <boost/range/algorithm/fill.hpp>
 #include "common/alignment.h"
@@ -17,18 +18,58 @@
 
 namespace Pica {
 
+template <typename T, u32 NumElements>
+static void LoadAttribute(const u8* source, Shader::AttributeBuffer& input, u32 attribute) {
+    for (u32 comp = 0; comp < NumElements; ++comp) {
+        T value;
+        std::memcpy(&value, source + comp * sizeof(T), sizeof(T));
+        input.attr[attribute][comp] = float24::FromFloat32(static_cast<float>(value));
+    }
+
+    // Default attribute values set if array elements have < 4 components. This
+    // is *not* carried over from the default attribute settings even if they're
+    // enabled for this attribute.
+    for (u32 comp = NumElements; comp < 4; ++comp) {
+        input.attr[attribute][comp] =
+            comp == 3 ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+}
+
+template <typename T>
+static constexpr std::array<VertexLoader::LoadFunction, 4> LoadFunctions{
+    &LoadAttribute<T, 1>,
+    &LoadAttribute<T, 2>,
+    &LoadAttribute<T, 3>,
+    &LoadAttribute<T, 4>,
+};
+
+static VertexLoader::LoadFunction GetLoadFunction(PipelineRegs::VertexAttributeFormat format,
+                                                  u32 num_elements) {
+    switch (format) {
+    case PipelineRegs::VertexAttributeFormat::BYTE:
+        return LoadFunctions<s8>[num_elements - 1];
+    case PipelineRegs::VertexAttributeFormat::UBYTE:
+        return LoadFunctions<u8>[num_elements - 1];
+    case PipelineRegs::VertexAttributeFormat::SHORT:
+        return LoadFunctions<s16>[num_elements - 1];
+    case PipelineRegs::VertexAttributeFormat::FLOAT:
+        return LoadFunctions<float>[num_elements - 1];
+    }
+    UNREACHABLE();
+    return nullptr;
+}
+
 void VertexLoader::Setup(const PipelineRegs& regs) {
     ASSERT_MSG(!is_setup, "VertexLoader is not intended to be setup more than once.");
 
     const auto& attribute_config = regs.vertex_attributes;
     num_total_attributes = attribute_config.GetNumTotalAttributes();
 
+    std::array<u32, 16> vertex_attribute_sources;
+    std::array<u32, 16> vertex_attribute_strides{};
+    std::array<u32, 16> vertex_attribute_elements{};
     boost::fill(vertex_attribute_sources, 0xdeadbeef);
 
-    for (int i = 0; i < 16; i++) {
-        vertex_attribute_is_default[i] = attribute_config.IsDefaultAttribute(i);
-    }
-
     // Setup attribute data from loaders
     for (int loader = 0; loader < 12; ++loader) {
         const auto& loader_config = attribute_config.attribute_loaders[loader];
@@ -51,8 +92,6 @@ void VertexLoader::Setup(const PipelineRegs& regs) {
                 vertex_attribute_sources[attribute_index] = loader_config.data_offset + offset;
                 vertex_attribute_strides[attribute_index] =
                     static_cast<u32>(loader_config.byte_count);
-                vertex_attribute_formats[attribute_index] =
-                    attribute_config.GetFormat(attribute_index);
                 vertex_attribute_elements[attribute_index] =
                     attribute_config.GetNumElements(attribute_index);
                 offset += attribute_config.GetStride(attribute_index);
@@ -68,96 +107,75 @@ void VertexLoader::Setup(const PipelineRegs& regs) {
         }
     }
 
-    is_setup = true;
-}
-
-void VertexLoader::LoadVertex(u32 base_address, int index, int vertex,
-                              Shader::AttributeBuffer& input,
-                              DebugUtils::MemoryAccessTracker& memory_accesses) {
-    ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
-
+    // Specialize the loading of each attribute for its layout
+    const PAddr base_address = attribute_config.GetPhysicalBaseAddress();
     for (int i = 0; i < num_total_attributes; ++i) {
         if (vertex_attribute_elements[i] != 0) {
-            // Load per-vertex data from the loader arrays
-            u32 source_addr =
-                base_address + vertex_attribute_sources[i] + vertex_attribute_strides[i] * vertex;
-
-            if (g_debug_context && Pica::g_debug_context->recorder) {
-                memory_accesses.AddAccess(
-                    source_addr,
-                    vertex_attribute_elements[i] *
-                        ((vertex_attribute_formats[i] == PipelineRegs::VertexAttributeFormat::FLOAT)
-                             ? 4
-                             : (vertex_attribute_formats[i] ==
-                                PipelineRegs::VertexAttributeFormat::SHORT)
-                                   ? 2
-                                   : 1));
-            }
-
-            switch (vertex_attribute_formats[i]) {
-            case PipelineRegs::VertexAttributeFormat::BYTE: {
-                const s8* srcdata = reinterpret_cast<const s8*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::UBYTE: {
-                const u8* srcdata = reinterpret_cast<const u8*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::SHORT: {
-                const s16* srcdata = reinterpret_cast<const s16*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case PipelineRegs::VertexAttributeFormat::FLOAT: {
-                const float* srcdata = reinterpret_cast<const float*>(
-                    VideoCore::g_memory->GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            }
-
-            // Default attribute values set if array elements have < 4 components. This
-            // is *not* carried over from the default attribute settings even if they're
-            // enabled for this attribute.
-            for (unsigned int comp = vertex_attribute_elements[i]; comp < 4; ++comp) {
-                input.attr[i][comp] =
-                    comp == 3 ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+            const PAddr source_address = base_address + vertex_attribute_sources[i];
+            const u8* source = VideoCore::g_memory->GetPhysicalPointer(source_address);
+            if (source == nullptr) {
+                LOG_ERROR(HW_GPU, "Vertex attribute {} at invalid address {:#010X}", i,
+                          source_address);
+                continue;
             }
-
-            LOG_TRACE(HW_GPU,
-                      "Loaded {} components of attribute {:x} for vertex {:x} (index {:x}) from "
-                      "0x{:08x} + 0x{:08x} + 0x{:04x}: {} {} {} {}",
-                      vertex_attribute_elements[i], i, vertex, index, base_address,
-                      vertex_attribute_sources[i], vertex_attribute_strides[i] * vertex,
-                      input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
-                      input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
-        } else if (vertex_attribute_is_default[i]) {
-            // Load the default attribute if we're configured to do so
-            input.attr[i] = g_state.input_default_attributes.attr[i];
-            LOG_TRACE(
-                HW_GPU,
-                "Loaded default attribute {:x} for vertex {:x} (index {:x}): ({}, {}, {}, {})", i,
-                vertex, index, input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
-                input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
+            const auto format = attribute_config.GetFormat(i);
+            array_attributes[num_array_attributes++] = {
+                GetLoadFunction(format, vertex_attribute_elements[i]),
+                source,
+                source_address,
+                vertex_attribute_strides[i],
+                attribute_config.GetStride(i),
+                static_cast<u32>(i),
+            };
+        } else if (attribute_config.IsDefaultAttribute(i)) {
+            default_attributes[num_default_attributes++] = static_cast<u32>(i);
         } else {
             // TODO(yuriks): In this case, no data gets loaded and the vertex
             // remains with the last value it had. This isn't currently maintained
             // as global state, however, and so won't work in Citra yet.
         }
     }
+
+    is_setup = true;
+}
+
+void VertexLoader::LoadVertex(int index, int vertex, Shader::AttributeBuffer& input,
+                              DebugUtils::MemoryAccessTracker& memory_accesses) const {
+    ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
+
+    // Load per-vertex data from the loader arrays
+    for (std::size_t i = 0; i < num_array_attributes; ++i) {
+        const ArrayAttribute& array = array_attributes[i];
+        array.load(array.source + array.stride * vertex, input, array.attribute);
+
+        LOG_TRACE(HW_GPU,
+                  "Loaded attribute {:x} for vertex {:x} (index {:x}) from 0x{:08x} + 0x{:04x}: "
+                  "{} {} {} {}",
+                  array.attribute, vertex, index, array.source_address, array.stride * vertex,
+                  input.attr[array.attribute][0].ToFloat32(),
+                  input.attr[array.attribute][1].ToFloat32(),
+                  input.attr[array.attribute][2].ToFloat32(),
+                  input.attr[array.attribute][3].ToFloat32());
+    }
+
+    const DebugContext* debug_context = GetAttachedDebugContext();
+    if (debug_context && debug_context->recorder) {
+        for (std::size_t i = 0; i < num_array_attributes; ++i) {
+            const ArrayAttribute& array = array_attributes[i];
+            memory_accesses.AddAccess(array.source_address + array.stride * vertex, array.size);
+        }
+    }
+
+    // Load the default attributes of the attributes configured to take them
+    for (std::size_t i = 0; i < num_default_attributes; ++i) {
+        const u32 attribute = default_attributes[i];
+        input.attr[attribute] = g_state.input_default_attributes.attr[attribute];
+        LOG_TRACE(HW_GPU,
+                  "Loaded default attribute {:x} for vertex {:x} (index {:x}): ({}, {}, {}, {})",
+                  attribute, vertex, index, input.attr[attribute][0].ToFloat32(),
+                  input.attr[attribute][1].ToFloat32(), input.attr[attribute][2].ToFloat32(),
+                  input.attr[attribute][3].ToFloat32());
+    }
 }
 
 } // namespace Pica
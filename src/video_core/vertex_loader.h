@@ -14,6 +14,11 @@ namespace Shader {
 struct AttributeBuffer;
 }
 
+/**
+ * Loads the attributes of vertices from the vertex arrays. Setup specializes the loader for the
+ * attribute layout: each array attribute gets a conversion function made for its format and
+ * element count, and its data is located once for the whole draw.
+ */
 class VertexLoader {
 public:
     VertexLoader() = default;
@@ -22,19 +27,36 @@ public:
     }
 
     void Setup(const PipelineRegs& regs);
-    void LoadVertex(u32 base_address, int index, int vertex, Shader::AttributeBuffer& input,
-                    DebugUtils::MemoryAccessTracker& memory_accesses);
+
+    /// Loads the attributes of one vertex, this may be called from several threads at once
+    void LoadVertex(int index, int vertex, Shader::AttributeBuffer& input,
+                    DebugUtils::MemoryAccessTracker& memory_accesses) const;
 
     int GetNumTotalAttributes() const {
         return num_total_attributes;
     }
 
+    /// Converts the elements of an attribute to float24, filling in the missing components
+    using LoadFunction = void (*)(const u8* source, Shader::AttributeBuffer& input, u32 attribute);
+
 private:
-    std::array<u32, 16> vertex_attribute_sources;
-    std::array<u32, 16> vertex_attribute_strides{};
-    std::array<PipelineRegs::VertexAttributeFormat, 16> vertex_attribute_formats;
-    std::array<u32, 16> vertex_attribute_elements{};
-    std::array<bool, 16> vertex_attribute_is_default;
+    /// An attribute loaded from a vertex array
+    struct ArrayAttribute {
+        LoadFunction load;
+        /// Data of the attribute for vertex 0
+        const u8* source;
+        PAddr source_address;
+        u32 stride;
+        /// Size of the attribute data of a vertex in bytes
+        u32 size;
+        u32 attribute;
+    };
+
+    std::array<ArrayAttribute, 16> array_attributes;
+    std::size_t num_array_attributes = 0;
+    /// Attributes taking the default attribute values
+    std::array<u32, 16> default_attributes;
+    std::size_t num_default_attributes = 0;
     int num_total_attributes = 0;
     bool is_setup = false;
 };
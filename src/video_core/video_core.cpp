@@ -3,9 +3,11 @@
 // Refer to the license.txt file included.
 
 #include <memory>
+#include <utility>
 #include "common/archives.h"
 #include "common/logging/log.h"
 #include "core/settings.h"
+#include "video_core/gpu_thread.h"
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
 #include "video_core/renderer_base.h"
@@ -19,12 +21,16 @@
 namespace VideoCore {
 
 std::unique_ptr<RendererBase> g_renderer; ///< Renderer plugin
+std::unique_ptr<GPUThread> g_gpu_thread;
 
 std::atomic<bool> g_hw_renderer_enabled;
 std::atomic<bool> g_shader_jit_enabled;
+std::atomic<bool> g_parallel_vertex_shading;
+std::atomic<bool> g_parallel_sw_rasterizer;
 std::atomic<bool> g_hw_shader_enabled;
 std::atomic<bool> g_separable_shader_enabled;
 std::atomic<bool> g_hw_shader_accurate_mul;
+std::atomic<bool> g_hw_shader_specialize_uniforms;
 std::atomic<bool> g_use_disk_shader_cache;
 std::atomic<bool> g_renderer_bg_color_update_requested;
 std::atomic<bool> g_renderer_sampler_update_requested;
@@ -43,6 +49,17 @@ ResultStatus Init(Frontend::EmuWindow& emu_window, Memory::MemorySystem& memory)
     g_memory = &memory;
     Pica::Init();
 
+#ifndef ARCHITECTURE_x86_64
+    if (g_shader_jit_enabled) {
+        LOG_WARNING(HW_GPU, "The shader JIT is not available on this host, using the interpreter");
+    }
+#endif
+
+    if (g_renderer) {
+        // Kept by ShutdownForStateLoad
+        return ResultStatus::Success;
+    }
+
     OpenGL::GLES = Settings::values.use_gles;
 
     g_renderer = std::make_unique<OpenGL::RendererOpenGL>(emu_window);
@@ -52,6 +69,9 @@ ResultStatus Init(Frontend::EmuWindow& emu_window, Memory::MemorySystem& memory)
         LOG_ERROR(Render, "initialization failed !");
     } else {
         LOG_DEBUG(Render, "initialized OK");
+        if (Settings::values.use_gpu_thread) {
+            g_gpu_thread = std::make_unique<GPUThread>(emu_window);
+        }
     }
 
     return result;
@@ -59,6 +79,9 @@ ResultStatus Init(Frontend::EmuWindow& emu_window, Memory::MemorySystem& memory)
 
 /// Shutdown the video core
 void Shutdown() {
+    // Runs the remaining jobs and makes the context current here again
+    g_gpu_thread.reset();
+
     Pica::Shutdown();
 
     g_renderer->ShutDown();
@@ -67,6 +90,27 @@ void Shutdown() {
     LOG_DEBUG(Render, "shutdown OK");
 }
 
+void ShutdownForStateLoad() {
+    // The surfaces are looked at while the memory they were loaded from is still there
+    RunOnGPUThread([] { g_renderer->Rasterizer()->DetachCaches(false); });
+}
+
+void RunOnGPUThread(std::function<void()> job) {
+    if (g_gpu_thread) {
+        g_gpu_thread->PushAndWait(std::move(job));
+    } else {
+        job();
+    }
+}
+
+void QueueOnGPUThread(std::function<void()> job) {
+    if (g_gpu_thread) {
+        g_gpu_thread->Push(std::move(job));
+    } else {
+        job();
+    }
+}
+
 void RequestScreenshot(void* data, std::function<void()> callback,
                        const Layout::FramebufferLayout& layout) {
     if (g_renderer_screenshot_requested) {
@@ -92,6 +136,9 @@ u16 GetResolutionScaleFactor() {
 
 template <class Archive>
 void serialize(Archive& ar, const unsigned int) {
+    if (g_gpu_thread) {
+        g_gpu_thread->WaitIdle();
+    }
     ar& Pica::g_state;
 }
 
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include "core/frontend/emu_window.h"
@@ -24,15 +25,21 @@ class MemorySystem;
 
 namespace VideoCore {
 
+class GPUThread;
+
 extern std::unique_ptr<RendererBase> g_renderer; ///< Renderer plugin
+extern std::unique_ptr<GPUThread> g_gpu_thread;  ///< Null unless the GPU thread is enabled
 
 // TODO: Wrap these in a user settings struct along with any other graphics settings (often set from
 // qt ui)
 extern std::atomic<bool> g_hw_renderer_enabled;
 extern std::atomic<bool> g_shader_jit_enabled;
+extern std::atomic<bool> g_parallel_vertex_shading;
+extern std::atomic<bool> g_parallel_sw_rasterizer;
 extern std::atomic<bool> g_hw_shader_enabled;
 extern std::atomic<bool> g_separable_shader_enabled;
 extern std::atomic<bool> g_hw_shader_accurate_mul;
+extern std::atomic<bool> g_hw_shader_specialize_uniforms;
 extern std::atomic<bool> g_use_disk_shader_cache;
 extern std::atomic<bool> g_renderer_bg_color_update_requested;
 extern std::atomic<bool> g_renderer_sampler_update_requested;
@@ -52,12 +59,25 @@ enum class ResultStatus {
     ErrorBelowGL33,
 };
 
-/// Initialize the video core
+/// Initialize the video core, or attach the renderer kept by ShutdownForStateLoad to the memory
 ResultStatus Init(Frontend::EmuWindow& emu_window, Memory::MemorySystem& memory);
 
 /// Shutdown the video core
 void Shutdown();
 
+/**
+ * Shuts the video core down for a state to be loaded, but for the renderer with its compiled
+ * shaders, the GPU thread and the shader JIT. The surfaces holding the contents of the memory
+ * are kept aside, the loading puts back those whose memory is the same in the state.
+ */
+void ShutdownForStateLoad();
+
+/// Runs the job on the GPU thread and waits for it when the thread is enabled, right away otherwise
+void RunOnGPUThread(std::function<void()> job);
+
+/// Queues the job on the GPU thread when the thread is enabled, runs it right away otherwise
+void QueueOnGPUThread(std::function<void()> job);
+
 /// Request a screenshot of the next frame
 void RequestScreenshot(void* data, std::function<void()> callback,
                        const Layout::FramebufferLayout& layout);
@@ -4,9 +4,9 @@
 
 #include <future>
 #include <json.hpp>
-#include "common/detached_tasks.h"
 #include "common/logging/log.h"
 #include "web_service/announce_room_json.h"
+#include "web_service/submission_queue.h"
 #include "web_service/web_backend.h"
 
 namespace AnnounceMultiplayerRoom {
@@ -146,11 +146,8 @@ void RoomJson::Delete() {
         LOG_ERROR(WebService, "Room must be registered to be deleted");
         return;
     }
-    Common::DetachedTasks::AddTask(
-        [host{this->host}, username{this->username}, token{this->token}, room_id{this->room_id}]() {
-            // create a new client here because the this->client might be destroyed.
-            Client{host, username, token}.DeleteJson(fmt::format("/lobby/{}", room_id), "", false);
-        });
+    // The request is sent with a new client because this->client might be destroyed
+    SubmitJsonAsync(host, username, token, "DELETE", fmt::format("/lobby/{}", room_id), "", false);
 }
 
 } // namespace WebService
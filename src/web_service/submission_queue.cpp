@@ -0,0 +1,103 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "common/detached_tasks.h"
+#include "common/logging/log.h"
+#include "web_service/submission_queue.h"
+#include "web_service/web_backend.h"
+
+namespace WebService {
+
+namespace {
+
+/// Requests kept while the web service is slow, the oldest ones are dropped past this
+constexpr std::size_t MaxPendingRequests = 64;
+
+struct PendingRequest {
+    std::string host;
+    std::string username;
+    std::string token;
+    bool allow_anonymous;
+    Client::JsonRequest request;
+
+    bool SameClient(const PendingRequest& other) const {
+        return host == other.host && username == other.username && token == other.token &&
+               allow_anonymous == other.allow_anonymous;
+    }
+};
+
+struct SubmissionQueue {
+    std::mutex mutex;
+    std::deque<PendingRequest> pending;
+    /// Whether a task is sending the pending requests
+    bool draining = false;
+};
+
+SubmissionQueue& GetQueue() {
+    static SubmissionQueue queue;
+    return queue;
+}
+
+void Drain() {
+    SubmissionQueue& queue = GetQueue();
+    while (true) {
+        std::deque<PendingRequest> batch;
+        {
+            std::lock_guard lock{queue.mutex};
+            if (queue.pending.empty()) {
+                queue.draining = false;
+                return;
+            }
+            batch.swap(queue.pending);
+        }
+
+        // Consecutive requests to the same client share a connection
+        while (!batch.empty()) {
+            const PendingRequest& first = batch.front();
+            const auto end = std::find_if(
+                batch.begin(), batch.end(),
+                [&first](const PendingRequest& request) { return !request.SameClient(first); });
+
+            std::vector<Client::JsonRequest> requests;
+            for (auto it = batch.begin(); it != end; ++it) {
+                requests.push_back(std::move(it->request));
+            }
+            // Errors are not handled since they were written to the log
+            Client{first.host, first.username, first.token}.SendJsonBatch(requests,
+                                                                          first.allow_anonymous);
+            batch.erase(batch.begin(), end);
+        }
+    }
+}
+
+} // Anonymous namespace
+
+void SubmitJsonAsync(std::string host, std::string username, std::string token,
+                     std::string method, std::string path, std::string data,
+                     bool allow_anonymous) {
+    SubmissionQueue& queue = GetQueue();
+    {
+        std::lock_guard lock{queue.mutex};
+        if (queue.pending.size() >= MaxPendingRequests) {
+            LOG_WARNING(WebService, "Dropping {} to {}, too many requests are pending",
+                        queue.pending.front().request.method,
+                        queue.pending.front().host + queue.pending.front().request.path);
+            queue.pending.pop_front();
+        }
+        queue.pending.push_back({std::move(host), std::move(username), std::move(token),
+                                 allow_anonymous,
+                                 {std::move(method), std::move(path), std::move(data)}});
+        if (queue.draining) {
+            return;
+        }
+        queue.draining = true;
+    }
+    Common::DetachedTasks::AddTask(Drain);
+}
+
+} // namespace WebService
@@ -0,0 +1,27 @@
+// Copyright 2020 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+namespace WebService {
+
+/**
+ * Queues a JSON request whose reply is not needed, it is sent in the background. The requests
+ * queued while others are in flight are sent together over a single connection, and the oldest
+ * ones are dropped when the web service can't keep up with them.
+ * @param host the web API URL
+ * @param username Citra username to use for authentication.
+ * @param token Citra token to use for authentication.
+ * @param method the HTTP method of the request.
+ * @param path the URL segment after the host address.
+ * @param data the JSON to send.
+ * @param allow_anonymous If true, allow anonymous unauthenticated requests.
+ */
+void SubmitJsonAsync(std::string host, std::string username, std::string token,
+                     std::string method, std::string path, std::string data,
+                     bool allow_anonymous);
+
+} // namespace WebService
@@ -3,8 +3,8 @@
 // Refer to the license.txt file included.
 
 #include <json.hpp>
-#include "common/detached_tasks.h"
 #include "common/web_result.h"
+#include "web_service/submission_queue.h"
 #include "web_service/telemetry_json.h"
 #include "web_service/web_backend.h"
 
@@ -107,9 +107,7 @@ void TelemetryJson::Complete() {
 
     auto content = impl->TopSection().dump();
     // Send the telemetry async but don't handle the errors since they were written to the log
-    Common::DetachedTasks::AddTask([host{impl->host}, content]() {
-        Client{host, "", ""}.PostJson("/telemetry", content, true);
-    });
+    SubmitJsonAsync(impl->host, "", "", "POST", "/telemetry", std::move(content), true);
 }
 
 bool TelemetryJson::SubmitTestcase() {
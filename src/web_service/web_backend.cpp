@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <mutex>
 #include <string>
+#include <vector>
 #include <LUrlParser.h>
 #include <fmt/format.h>
 #if defined(__ANDROID__)
@@ -59,6 +60,56 @@ struct Client::Impl {
         return result;
     }
 
+    /// Sends requests one after the other over a single connection, returns how many succeeded
+    std::size_t GenericRequests(const std::vector<Client::JsonRequest>& requests,
+                                bool allow_anonymous, bool retry_expired = true) {
+        if (jwt.empty()) {
+            UpdateJWT();
+        }
+
+        if (jwt.empty() && !allow_anonymous) {
+            LOG_ERROR(WebService, "Credentials must be provided for authenticated requests");
+            return 0;
+        }
+
+        if (CreateClient().result_code != Common::WebResult::Code::Success) {
+            return 0;
+        }
+
+        std::vector<httplib::Request> http_requests;
+        http_requests.reserve(requests.size());
+        for (const auto& request : requests) {
+            http_requests.push_back(MakeRequest(request.method, request.path, request.data, jwt));
+        }
+
+        // The responses stop at the first request that went unanswered
+        std::vector<httplib::Response> responses;
+        cli->send(http_requests, responses);
+        if (responses.size() < requests.size()) {
+            LOG_ERROR(WebService, "{} of {} requests to {} returned null",
+                      requests.size() - responses.size(), requests.size(), host);
+        }
+
+        std::size_t succeeded = 0;
+        std::vector<Client::JsonRequest> expired;
+        for (std::size_t i = 0; i < responses.size(); i++) {
+            const auto result = ParseResponse(requests[i].method, requests[i].path, responses[i],
+                                              "application/json");
+            if (result.result_code == Common::WebResult::Code::Success) {
+                succeeded++;
+            } else if (result.result_string == "401") {
+                expired.push_back(requests[i]);
+            }
+        }
+
+        if (!expired.empty() && retry_expired && !username.empty()) {
+            // Try again with new JWT
+            UpdateJWT();
+            succeeded += GenericRequests(expired, allow_anonymous, false);
+        }
+        return succeeded;
+    }
+
     /**
      * A generic function with explicit authentication method specified
      * JWT is used if the jwt parameter is not empty
@@ -69,6 +120,21 @@ struct Client::Impl {
                                      const std::string& data, const std::string& accept,
                                      const std::string& jwt = "", const std::string& username = "",
                                      const std::string& token = "") {
+        const auto client_result = CreateClient();
+        if (client_result.result_code != Common::WebResult::Code::Success) {
+            return client_result;
+        }
+
+        httplib::Response response;
+        if (!cli->send(MakeRequest(method, path, data, jwt, username, token), response)) {
+            LOG_ERROR(WebService, "{} to {} returned null", method, host + path);
+            return Common::WebResult{Common::WebResult::Code::LibError, "Null response"};
+        }
+        return ParseResponse(method, path, response, accept);
+    }
+
+    /// Creates the HTTP client of the host on first use, it is kept for the next requests
+    Common::WebResult CreateClient() {
         if (cli == nullptr) {
             auto parsedUrl = LUrlParser::clParseURL::ParseURL(host);
             int port;
@@ -90,10 +156,17 @@ struct Client::Impl {
             }
         }
         if (cli == nullptr) {
-            LOG_ERROR(WebService, "Invalid URL {}", host + path);
+            LOG_ERROR(WebService, "Invalid URL {}", host);
             return Common::WebResult{Common::WebResult::Code::InvalidURL, "Invalid URL"};
         }
+        return Common::WebResult{Common::WebResult::Code::Success, ""};
+    }
 
+    /// Builds a request, authenticated like described for GenericRequest
+    static httplib::Request MakeRequest(const std::string& method, const std::string& path,
+                                        const std::string& data, const std::string& jwt,
+                                        const std::string& username = "",
+                                        const std::string& token = "") {
         httplib::Headers params;
         if (!jwt.empty()) {
             params = {
@@ -117,14 +190,13 @@ struct Client::Impl {
         request.path = path;
         request.headers = params;
         request.body = data;
+        return request;
+    }
 
-        httplib::Response response;
-
-        if (!cli->send(request, response)) {
-            LOG_ERROR(WebService, "{} to {} returned null", method, host + path);
-            return Common::WebResult{Common::WebResult::Code::LibError, "Null response"};
-        }
-
+    /// Checks the status and the content type of a response
+    Common::WebResult ParseResponse(const std::string& method, const std::string& path,
+                                    const httplib::Response& response,
+                                    const std::string& accept) const {
         if (response.status >= 400) {
             LOG_ERROR(WebService, "{} to {} returned error status code: {}", method, host + path,
                       response.status);
@@ -206,6 +278,11 @@ Common::WebResult Client::GetImage(const std::string& path, bool allow_anonymous
     return impl->GenericRequest("GET", path, "", allow_anonymous, "image/png");
 }
 
+std::size_t Client::SendJsonBatch(const std::vector<JsonRequest>& requests,
+                                  bool allow_anonymous) {
+    return impl->GenericRequests(requests, allow_anonymous);
+}
+
 Common::WebResult Client::GetExternalJWT(const std::string& audience) {
     return impl->GenericRequest("POST", fmt::format("/jwt/external/{}", audience), "", false,
                                 "text/html");
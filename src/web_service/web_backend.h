@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Common {
 struct WebResult;
@@ -15,6 +16,13 @@ namespace WebService {
 
 class Client {
 public:
+    /// A request to a JSON endpoint, whose reply is not needed
+    struct JsonRequest {
+        std::string method;
+        std::string path;
+        std::string data;
+    };
+
     Client(std::string host, std::string username, std::string token);
     ~Client();
 
@@ -62,6 +70,14 @@ public:
      */
     Common::WebResult GetImage(const std::string& path, bool allow_anonymous);
 
+    /**
+     * Sends JSON requests one after the other over a single connection.
+     * @param requests the requests to send, in order.
+     * @param allow_anonymous If true, allow anonymous unauthenticated requests.
+     * @return the number of requests that succeeded.
+     */
+    std::size_t SendJsonBatch(const std::vector<JsonRequest>& requests, bool allow_anonymous);
+
     /**
      * Requests an external JWT for the specific audience provided.
      * @param audience the audience of the JWT requested.